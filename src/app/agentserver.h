@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_AGENTSERVER_H
+#define KLOGG_AGENTSERVER_H
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include <QFileInfo>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QStringList>
+
+#include "agentprotocol.h"
+#include "log.h"
+#include "logdata.h"
+#include "logfiltereddata.h"
+#include "regularexpressionpattern.h"
+
+// One client of the agent, it opens one of the served files and gets its
+// lines and search results. The file is indexed by its own LogData,
+// the index cache on disk is shared with other clients of the same file.
+class AgentSession : public QObject {
+    Q_OBJECT
+
+  public:
+    AgentSession( QLocalSocket* socket, const QStringList& servedFiles )
+        : QObject( socket )
+        , socket_( socket )
+        , servedFiles_( servedFiles )
+    {
+        connect( socket_, &QLocalSocket::readyRead, this, &AgentSession::readMessages );
+        connect( socket_, &QLocalSocket::disconnected, socket_, &QObject::deleteLater );
+    }
+
+  private:
+    void readMessages()
+    {
+        reader_.append( socket_->readAll() );
+        while ( auto message = reader_.next() ) {
+            handleMessage( *message );
+        }
+
+        if ( reader_.isBroken() ) {
+            socket_->disconnectFromHost();
+        }
+    }
+
+    void handleMessage( const agent::Message& message )
+    {
+        switch ( message.type ) {
+        case agent::MessageType::Open:
+            open( message.payload );
+            break;
+        case agent::MessageType::GetLines:
+            sendLines( message.payload );
+            break;
+        case agent::MessageType::Search:
+            search( message.payload );
+            break;
+        case agent::MessageType::StopSearch:
+            if ( filteredData_ ) {
+                pattern_.reset();
+                filteredData_->interruptSearch();
+            }
+            break;
+        default:
+            sendError( QString( "Unexpected message %1" ).arg( static_cast<int>( message.type ) ) );
+            break;
+        }
+    }
+
+    void open( const QByteArray& payload )
+    {
+        quint32 version = 0;
+        QString fileName;
+        if ( !agent::readPayload( payload, version, fileName )
+             || version != agent::ProtocolVersion ) {
+            sendError( "Unsupported protocol version" );
+            return;
+        }
+
+        // Only files passed to the agent are opened
+        fileName = QFileInfo( fileName ).absoluteFilePath();
+        if ( logData_ || !servedFiles_.contains( fileName ) ) {
+            sendError( QString( "File %1 is not served" ).arg( fileName ) );
+            return;
+        }
+
+        LOG_INFO << "Agent client opened " << fileName;
+
+        logData_ = std::make_unique<LogData>();
+        filteredData_ = logData_->getNewFilteredData();
+
+        connect( logData_.get(), &LogData::loadingProgressed, this,
+                 [ this ]( int percent ) { sendFileInfo( false, percent ); } );
+        connect( logData_.get(), &LogData::loadingFinished, this,
+                 &AgentSession::handleLoadingFinished );
+        connect( logData_.get(), &LogData::fileChanged, this,
+                 [ this ]( MonitoredFileStatus status ) { fileStatus_ = status; } );
+        connect( filteredData_.get(), &LogFilteredData::searchProgressed, this,
+                 &AgentSession::sendSearchResults );
+
+        logData_->attachFile( fileName );
+    }
+
+    void handleLoadingFinished( LoadingStatus status )
+    {
+        sendFileInfo( status == LoadingStatus::Successful, 100 );
+
+        const auto fileStatus = std::exchange( fileStatus_, MonitoredFileStatus::Unchanged );
+        if ( !pattern_ || status != LoadingStatus::Successful ) {
+            return;
+        }
+
+        // Lines added to the file are searched, changed files are searched again
+        if ( fileStatus == MonitoredFileStatus::DataAdded ) {
+            filteredData_->updateSearch( 0_lnum, LineNumber( logData_->getNbLine().get() ) );
+        }
+        else if ( fileStatus != MonitoredFileStatus::Unchanged ) {
+            startSearch();
+        }
+    }
+
+    void sendFileInfo( bool isLoaded, int percent )
+    {
+        const auto* encoding = logData_->getDetectedEncoding();
+        send( agent::MessageType::FileInfo,
+              agent::writePayload( isLoaded, static_cast<qint32>( percent ),
+                                   static_cast<quint64>( logData_->getNbLine().get() ),
+                                   logData_->getFileSize(),
+                                   static_cast<qint32>( logData_->getMaxLength().get() ),
+                                   encoding ? encoding->name() : QByteArray{} ) );
+    }
+
+    void sendLines( const QByteArray& payload )
+    {
+        quint64 first = 0;
+        quint64 count = 0;
+        if ( !logData_ || !agent::readPayload( payload, first, count ) ) {
+            sendError( "Invalid lines request" );
+            return;
+        }
+
+        const auto nbLines = static_cast<quint64>( logData_->getNbLine().get() );
+        first = std::min( first, nbLines );
+        count = std::min( { count, nbLines - first, agent::MaxLinesPerRequest } );
+
+        const auto firstLine = LineNumber( first );
+        const auto linesCount = LinesCount( count );
+
+        // Bytes are sent as they are in the file unless reading changes them
+        auto isUtf8 = false;
+        auto lines = logData_->getLinesBytes( firstLine, linesCount );
+        if ( !lines ) {
+            isUtf8 = true;
+            lines = QByteArray{};
+            for ( const auto& line : logData_->getLines( firstLine, linesCount ) ) {
+                lines->append( line.toUtf8() ).append( '\n' );
+            }
+        }
+
+        send( agent::MessageType::Lines, agent::writePayload( first, count, isUtf8, *lines ) );
+    }
+
+    void search( const QByteArray& payload )
+    {
+        RegularExpressionPattern pattern;
+        if ( !logData_
+             || !agent::readPayload( payload, pattern.pattern, pattern.isCaseSensitive,
+                                     pattern.isExclude, pattern.isBoolean,
+                                     pattern.isPlainText ) ) {
+            sendError( "Invalid search request" );
+            return;
+        }
+
+        pattern_ = pattern;
+        startSearch();
+    }
+
+    void startSearch()
+    {
+        filteredData_->interruptSearch();
+        sentMatches_.reset();
+        filteredData_->runSearch( *pattern_ );
+    }
+
+    // Only lines matched since the previous results are sent
+    void sendSearchResults( LinesCount nbMatches, int progress, LineNumber )
+    {
+        const auto matches = filteredData_->getMatchingLines();
+        const auto isReset = !sentMatches_;
+        auto newMatches = sentMatches_ ? *matches - *sentMatches_ : *matches;
+        newMatches.runOptimize();
+        sentMatches_ = matches;
+
+        send( agent::MessageType::SearchResults,
+              agent::writePayload( isReset, static_cast<qint32>( progress ),
+                                   static_cast<quint64>( nbMatches.get() ),
+                                   agent::encodeLines( newMatches ) ) );
+    }
+
+    void sendError( const QString& description )
+    {
+        LOG_WARNING << "Agent client: " << description;
+        send( agent::MessageType::Error, agent::writePayload( description ) );
+    }
+
+    void send( agent::MessageType type, const QByteArray& payload )
+    {
+        socket_->write( agent::encodeMessage( type, payload ) );
+    }
+
+  private:
+    QLocalSocket* socket_;
+    QStringList servedFiles_;
+    agent::MessageReader reader_;
+
+    std::unique_ptr<LogData> logData_;
+    std::unique_ptr<LogFilteredData> filteredData_;
+    MonitoredFileStatus fileStatus_ = MonitoredFileStatus::Unchanged;
+
+    std::optional<RegularExpressionPattern> pattern_;
+    // Results are shared with the search until it changes them
+    std::shared_ptr<const SearchResultArray> sentMatches_;
+};
+
+// Accepts clients of the agent, each of them gets its own session. Clients
+// connect to a local socket only the user running the agent can open, other
+// hosts reach it through an ssh tunnel forwarding a port to the socket.
+class AgentServer : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit AgentServer( const QStringList& servedFiles )
+        : servedFiles_( servedFiles )
+    {
+        server_.setSocketOptions( QLocalServer::UserAccessOption );
+        connect( &server_, &QLocalServer::newConnection, this, [ this ] {
+            while ( auto* socket = server_.nextPendingConnection() ) {
+                LOG_INFO << "Agent client connected";
+                new AgentSession( socket, servedFiles_ );
+            }
+        } );
+    }
+
+    bool listen( const QString& socketName )
+    {
+        // Socket left by an agent that didn't exit cleanly
+        QLocalServer::removeServer( socketName );
+
+        if ( !server_.listen( socketName ) ) {
+            LOG_ERROR << "Agent can't listen on " << socketName << ": " << server_.errorString();
+            return false;
+        }
+
+        LOG_INFO << "Agent listens on " << server_.fullServerName() << ", serving "
+                 << servedFiles_.size() << " files";
+        return true;
+    }
+
+  private:
+    QStringList servedFiles_;
+    QLocalServer server_;
+};
+
+#endif
@@ -33,6 +33,9 @@
 #include "log.h"
 
 struct CliParameters {
+    // File name that opens the standard input
+    static constexpr const char* StandardInputName = "-";
+
     bool new_session = false;
     bool load_session = false;
     bool multi_instance = false;
@@ -48,6 +51,12 @@ struct CliParameters {
     int window_height = 0;
 
     QString pattern;
+    bool is_boolean = false;
+    bool is_exclude = false;
+    bool is_case_insensitive = false;
+    bool is_plain_text = false;
+    bool count_only = false;
+    bool line_numbers = false;
 
     CliParameters( QCoreApplication& app, bool console = false )
     {
@@ -80,9 +89,33 @@ struct CliParameters {
                                                "follow initial opened files" );
 
         const QCommandLineOption patternOption( QStringList() << "e"
-                                                              << "pattern",
+                                                              << "pattern"
+                                                              << "search",
                                                 "pattern to search for", "pattern" );
 
+        const QCommandLineOption booleanOption( QStringList() << "b"
+                                                              << "boolean",
+                                                "pattern is a boolean combination of patterns" );
+
+        const QCommandLineOption excludeOption( "exclude",
+                                                "select lines not matching the pattern" );
+
+        const QCommandLineOption ignoreCaseOption( QStringList() << "i"
+                                                                 << "ignore-case",
+                                                   "ignore case of the pattern" );
+
+        const QCommandLineOption plainTextOption( QStringList() << "F"
+                                                                << "fixed-strings",
+                                                  "pattern is plain text" );
+
+        const QCommandLineOption countOption( QStringList() << "c"
+                                                            << "count",
+                                              "print only the number of matching lines" );
+
+        const QCommandLineOption lineNumberOption( QStringList() << "n"
+                                                                 << "line-number",
+                                                   "prefix matching lines with their number" );
+
         const QCommandLineOption debugOption(
             QStringList() << "d"
                           << "debug",
@@ -105,6 +138,12 @@ struct CliParameters {
         }
         else {
             parser.addOption( patternOption );
+            parser.addOption( booleanOption );
+            parser.addOption( excludeOption );
+            parser.addOption( ignoreCaseOption );
+            parser.addOption( plainTextOption );
+            parser.addOption( countOption );
+            parser.addOption( lineNumberOption );
         }
 
         parser.process( app );
@@ -150,14 +189,39 @@ struct CliParameters {
             if ( parser.isSet( patternOption ) ) {
                 pattern = parser.value( patternOption );
             }
+
+            is_boolean = parser.isSet( booleanOption );
+            is_exclude = parser.isSet( excludeOption );
+            is_case_insensitive = parser.isSet( ignoreCaseOption );
+            is_plain_text = parser.isSet( plainTextOption );
+            count_only = parser.isSet( countOption );
+            line_numbers = parser.isSet( lineNumberOption );
         }
 
         for ( const auto& file : parser.positionalArguments() ) {
+            // Standard input is read by the window that shows it
+            if ( file == StandardInputName ) {
+                filenames.emplace_back( file );
+                continue;
+            }
+
             const auto fileInfo = QFileInfo( file );
             filenames.emplace_back( fileInfo.absoluteFilePath() );
         }
     }
 
+    // Whether klogg is started to search files without the GUI
+    static bool is_headless( int argc, char* argv[] )
+    {
+        for ( auto i = 1; i < argc; ++i ) {
+            const auto argument = QString::fromLocal8Bit( argv[ i ] );
+            if ( argument == "--search" || argument.startsWith( "--search=" ) ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     static void print_version()
     {
         std::cout << "klogg " << kloggVersion().data() << "\n";
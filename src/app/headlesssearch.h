@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_HEADLESSSEARCH_H
+#define KLOGG_HEADLESSSEARCH_H
+
+#include <algorithm>
+#include <iostream>
+
+#include <QCoreApplication>
+
+#include "dispatch_to.h"
+#include "logdata.h"
+#include "logfiltereddata.h"
+#include "regularexpressionpattern.h"
+
+#include "cli.h"
+
+// Search the files of the command line with the same engine as the GUI
+// and print matching lines or their count to stdout, like grep.
+// Several files are searched as one log. Returns the exit code:
+// 0 if some lines matched, 1 if none did and 2 on errors.
+inline int runHeadlessSearch( QCoreApplication& app, const CliParameters& parameters )
+{
+    qRegisterMetaType<LinesCount>( "LinesCount" );
+    qRegisterMetaType<LineNumber>( "LineNumber" );
+
+    if ( parameters.pattern.isEmpty() || parameters.filenames.empty() ) {
+        std::cerr << "A pattern and at least one file are needed to search\n";
+        return 2;
+    }
+
+    const auto regExp = RegularExpressionPattern(
+        parameters.pattern, !parameters.is_case_insensitive, parameters.is_exclude,
+        parameters.is_boolean, parameters.is_plain_text );
+
+    LogData logData;
+    auto filteredData = logData.getNewFilteredData();
+
+    const auto printMatches = [ & ]( LinesCount nbMatches ) {
+        if ( parameters.count_only ) {
+            std::cout << nbMatches.get() << "\n";
+            return;
+        }
+
+        const auto defaultChunkSize = 1000_lcount;
+        for ( auto chunkStart = 0_lnum; chunkStart < nbMatches;
+              chunkStart = chunkStart + defaultChunkSize ) {
+            const auto chunkSize = LinesCount(
+                std::min( defaultChunkSize.get(), nbMatches.get() - chunkStart.get() ) );
+            const auto lines = filteredData->getLines( chunkStart, chunkSize );
+            const auto lineNumbers
+                = parameters.line_numbers
+                      ? filteredData->getMatchingLineNumbers( chunkStart, chunkSize )
+                      : klogg::vector<LineNumber>{};
+            for ( auto i = 0u; i < lines.size(); ++i ) {
+                if ( !lineNumbers.empty() ) {
+                    std::cout << lineNumbers[ i ].get() + 1 << ":";
+                }
+                std::cout << lines[ i ].toStdString() << "\n";
+            }
+        }
+    };
+
+    // Results are printed once the search is over, parallel searches
+    // finish parts of the file out of order.
+    QObject::connect( filteredData.get(), &LogFilteredData::searchProgressed,
+                      [ & ]( LinesCount nbMatches, int progress, LineNumber ) {
+                          if ( progress == 100 ) {
+                              LOG_INFO << "Search finished, got " << nbMatches.get() << " matches";
+                              printMatches( nbMatches );
+                              std::cout.flush();
+                              app.exit( nbMatches.get() > 0 ? 0 : 1 );
+                          }
+                      } );
+
+    QObject::connect( &logData, &LogData::loadingFinished, [ & ]( LoadingStatus status ) {
+        if ( status != LoadingStatus::Successful ) {
+            std::cerr << "Failed to load files\n";
+            app.exit( 2 );
+            return;
+        }
+
+        dispatchToMainThread( [ & ] {
+            if ( parameters.count_only ) {
+                filteredData->runCount( regExp, 0_lnum, LineNumber( logData.getNbLine().get() ) );
+            }
+            else {
+                filteredData->runSearch( regExp );
+            }
+        } );
+    } );
+
+    // Several files are searched as one log
+    logData.attachFiles(
+        klogg::vector<QString>( parameters.filenames.begin(), parameters.filenames.end() ) );
+    return app.exec();
+}
+
+#endif
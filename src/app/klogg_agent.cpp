@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include <iostream>
+
+#include "agentprotocol.h"
+#include "agentserver.h"
+#include "configuration.h"
+#include "klogg_version.h"
+#include "logger.h"
+#include "persistentinfo.h"
+
+const bool PersistentInfo::ForcePortable = true;
+
+int main( int argc, char* argv[] )
+{
+    QCoreApplication app( argc, argv );
+    app.setApplicationVersion( kloggVersion() );
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Klogg agent, indexes and searches log files for klogg on another host" );
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    // Socket is created with permissions for the user only, in the runtime
+    // directory of the user if there is one
+    auto runtimeDirectory = QStandardPaths::writableLocation( QStandardPaths::RuntimeLocation );
+    if ( runtimeDirectory.isEmpty() ) {
+        runtimeDirectory = QDir::tempPath();
+    }
+    const QCommandLineOption socketOption(
+        QStringList() << "s"
+                      << "socket",
+        "local socket to listen on, only the current user can connect to it", "socket",
+        QDir( runtimeDirectory ).filePath( agent::DefaultSocketName ) );
+    const QCommandLineOption debugOption( QStringList() << "d"
+                                                        << "debug",
+                                          "output more debug" );
+    parser.addOption( socketOption );
+    parser.addOption( debugOption );
+    parser.addPositionalArgument( "files", "files that clients can open" );
+    parser.process( app );
+
+    logging::enableLogging( true, parser.isSet( debugOption ) ? logging::LogLevel::Debug
+                                                              : logging::LogLevel::Info );
+
+    auto configuration = Configuration::getSynced();
+
+    qRegisterMetaType<LinesCount>( "LinesCount" );
+    qRegisterMetaType<LineNumber>( "LineNumber" );
+
+    QStringList servedFiles;
+    for ( const auto& file : parser.positionalArguments() ) {
+        servedFiles.append( QFileInfo( file ).absoluteFilePath() );
+    }
+    if ( servedFiles.isEmpty() ) {
+        std::cerr << "At least one file to serve is needed\n";
+        return 2;
+    }
+
+    AgentServer server( servedFiles );
+    if ( !server.listen( parser.value( socketOption ) ) ) {
+        return 2;
+    }
+
+    return app.exec();
+}
@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Runs the indexing and the searches of klogg on a synthetic dataset
+// and reports their speed as JSON, so builds can be compared on the same hardware.
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+#include "configuration.h"
+#include "filewatcher.h"
+#include "klogg_version.h"
+#include "logdata.h"
+#include "logfiltereddata.h"
+#include "logger.h"
+#include "loggenerator.h"
+#include "memory_info.h"
+#include "persistentinfo.h"
+#include "quickfind.h"
+#include "regularexpressionpattern.h"
+#include "tracing.h"
+
+const bool PersistentInfo::ForcePortable = true;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr double MiB = 1024.0 * 1024.0;
+
+double secondsSince( Clock::time_point start )
+{
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+QJsonObject stageResult( double seconds, qint64 bytes, LinesCount lines )
+{
+    QJsonObject result;
+    result[ "seconds" ] = seconds;
+    if ( seconds > 0 ) {
+        if ( bytes > 0 ) {
+            result[ "MiBPerSecond" ] = static_cast<double>( bytes ) / MiB / seconds;
+        }
+        result[ "linesPerSecond" ] = static_cast<double>( lines.get() ) / seconds;
+    }
+    result[ "peakRssBytes" ] = static_cast<double>( peakResidentMemory() );
+    return result;
+}
+
+// Starts the operation and waits for the signal telling it is done
+template <typename Sender, typename Signal, typename Start, typename IsDone>
+void runUntil( Sender* sender, Signal signal, Start start, IsDone isDone )
+{
+    QEventLoop loop;
+    const auto connection = QObject::connect( sender, signal, &loop, [ & ]( auto... arguments ) {
+        if ( isDone( arguments... ) ) {
+            loop.quit();
+        }
+    } );
+    start();
+    loop.exec();
+    QObject::disconnect( connection );
+}
+
+void generate( const QString& fileName, const LogGeneratorOptions& options )
+{
+    std::ofstream file( QFile::encodeName( fileName ).toStdString(),
+                        std::ios::binary | std::ios::app );
+    LogGenerator( options ).write( file );
+}
+
+QJsonObject runSearch( LogFilteredData& filteredData, const RegularExpressionPattern& pattern,
+                       qint64 bytes, LinesCount lines )
+{
+    // Results of the previous runs are not reused
+    filteredData.clearSearch( true );
+
+    LinesCount matches;
+    const auto start = Clock::now();
+    runUntil(
+        &filteredData, &LogFilteredData::searchProgressed,
+        [ & ] { filteredData.runSearch( pattern ); },
+        [ & ]( LinesCount nbMatches, int progress, LineNumber ) {
+            matches = nbMatches;
+            return progress == 100;
+        } );
+
+    auto result = stageResult( secondsSince( start ), bytes, lines );
+    result[ "matches" ] = static_cast<double>( matches.get() );
+    return result;
+}
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+    qRegisterMetaType<LoadingStatus>( "LoadingStatus" );
+    qRegisterMetaType<LinesCount>( "LinesCount" );
+    qRegisterMetaType<LineNumber>( "LineNumber" );
+    qRegisterMetaType<Portion>( "Portion" );
+    qRegisterMetaType<QFNotification>( "QFNotification" );
+
+    QCoreApplication app( argc, argv );
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription( "Klogg benchmark" );
+    parser.addHelpOption();
+
+    const QCommandLineOption linesOption( "lines", "number of generated lines", "lines",
+                                          "1000000" );
+    const QCommandLineOption lengthOption(
+        "length", "fixed, uniform or lognormal message length", "distribution", "lognormal" );
+    const QCommandLineOption meanLengthOption( "mean-length", "mean message length", "length",
+                                               "100" );
+    const QCommandLineOption encodingOption( "encoding", "utf8, utf16le or latin1", "encoding",
+                                             "utf8" );
+    const QCommandLineOption tabsOption( "tabs", "probability of a tab between words",
+                                         "probability", "0" );
+    const QCommandLineOption ansiOption( "ansi", "probability of ANSI colors in a line",
+                                         "probability", "0" );
+    const QCommandLineOption seedOption( "seed", "seed of the dataset", "seed", "42" );
+    const QCommandLineOption datasetOption( "dataset", "use this file instead of generating one",
+                                            "file" );
+    const QCommandLineOption outputOption( "output", "write the JSON report to the file",
+                                           "file" );
+    const QCommandLineOption indexCacheOption( "index-cache", "use the index cache on disk" );
+    const QCommandLineOption traceOption(
+        "trace", "write the Chrome trace of all stages to the file", "file" );
+    const QCommandLineOption debugOption( "debug", "log level of klogg", "level", "0" );
+
+    parser.addOptions( { linesOption, lengthOption, meanLengthOption, encodingOption, tabsOption,
+                         ansiOption, seedOption, datasetOption, outputOption, indexCacheOption,
+                         traceOption, debugOption } );
+    parser.process( app );
+
+    const auto debugLevel = parser.value( debugOption ).toInt();
+    logging::enableLogging( debugLevel > 0, static_cast<logging::LogLevel>( 3 + debugLevel ) );
+
+    Tracing::get().setEnabled( parser.isSet( traceOption ) );
+
+    LogGeneratorOptions options;
+    options.lines = parser.value( linesOption ).toULongLong();
+    options.meanLength = parser.value( meanLengthOption ).toULongLong();
+    options.tabDensity = parser.value( tabsOption ).toDouble();
+    options.ansiDensity = parser.value( ansiOption ).toDouble();
+    options.seed = parser.value( seedOption ).toULongLong();
+
+    const auto length
+        = LogGeneratorOptions::parseLength( parser.value( lengthOption ).toStdString() );
+    const auto encoding
+        = LogGeneratorOptions::parseEncoding( parser.value( encodingOption ).toStdString() );
+    if ( !length || !encoding ) {
+        parser.showHelp( EXIT_FAILURE );
+    }
+    options.length = *length;
+    options.encoding = *encoding;
+
+    auto& config = Configuration::getSynced();
+    config.setUseIndexCache( parser.isSet( indexCacheOption ) );
+    config.setKeepSearchResultsOnDisk( false );
+
+    QJsonObject report;
+    report[ "version" ] = QString::fromLatin1( kloggVersion().data() );
+    report[ "commit" ] = QString::fromLatin1( kloggCommit().data() );
+
+    QJsonObject dataset;
+    QTemporaryDir tempDir;
+    auto fileName = parser.value( datasetOption );
+    if ( fileName.isEmpty() ) {
+        fileName = tempDir.filePath( "dataset.log" );
+
+        const auto start = Clock::now();
+        generate( fileName, options );
+
+        dataset[ "lines" ] = static_cast<double>( options.lines );
+        dataset[ "length" ] = parser.value( lengthOption );
+        dataset[ "meanLength" ] = static_cast<double>( options.meanLength );
+        dataset[ "encoding" ] = parser.value( encodingOption );
+        dataset[ "tabs" ] = options.tabDensity;
+        dataset[ "ansi" ] = options.ansiDensity;
+        dataset[ "seed" ] = static_cast<double>( options.seed );
+        dataset[ "generationSeconds" ] = secondsSince( start );
+    }
+    dataset[ "file" ] = fileName;
+
+    const auto fileSize = QFileInfo( fileName ).size();
+    dataset[ "bytes" ] = static_cast<double>( fileSize );
+
+    QJsonObject stages;
+
+    LogData logData;
+    auto filteredData = logData.getNewFilteredData();
+
+    {
+        const auto start = Clock::now();
+        auto status = LoadingStatus::Successful;
+        runUntil(
+            &logData, &LogData::loadingFinished, [ & ] { logData.attachFile( fileName ); },
+            [ & ]( LoadingStatus loadingStatus ) {
+                status = loadingStatus;
+                return true;
+            } );
+        if ( status != LoadingStatus::Successful ) {
+            std::cerr << "Failed to index " << fileName.toStdString() << "\n";
+            return EXIT_FAILURE;
+        }
+        stages[ "indexing" ] = stageResult( secondsSince( start ), fileSize, logData.getNbLine() );
+    }
+
+    const auto nbLines = logData.getNbLine();
+    dataset[ "indexedLines" ] = static_cast<double>( nbLines.get() );
+
+    const auto rareWord = QString::fromLatin1( LogGenerator::RareWord.data(),
+                                               static_cast<int>( LogGenerator::RareWord.size() ) );
+    const auto regularExpression = RegularExpressionPattern( "ERROR.*" + rareWord );
+
+    QJsonObject searches;
+    QJsonObject engines;
+#ifdef KLOGG_HAS_HS
+    config.setRegexpEnging( RegexpEngine::Hyperscan );
+    engines[ "hyperscan" ] = runSearch( *filteredData, regularExpression, fileSize, nbLines );
+#endif
+    config.setRegexpEnging( RegexpEngine::QRegularExpression );
+    engines[ "qregularexpression" ]
+        = runSearch( *filteredData, regularExpression, fileSize, nbLines );
+    searches[ "regularExpression" ] = engines;
+
+    searches[ "plainText" ] = runSearch(
+        *filteredData, RegularExpressionPattern( rareWord, true, false, false, true ), fileSize,
+        nbLines );
+    searches[ "boolean" ] = runSearch(
+        *filteredData,
+        RegularExpressionPattern( "\"ERROR\" and not \"" + rareWord + "\"", true, false, true,
+                                  false ),
+        fileSize, nbLines );
+    stages[ "search" ] = searches;
+
+    // Lines are only appended to generated datasets
+    if ( parser.value( datasetOption ).isEmpty() ) {
+        // Appended lines are indexed and only they are searched
+        auto appended = options;
+        appended.firstLine = nbLines.get();
+        appended.lines = std::max<uint64_t>( 1, nbLines.get() / 10 );
+        generate( fileName, appended );
+
+        runUntil(
+            &logData, &LogData::loadingFinished,
+            [ & ] { FileWatcher::getFileWatcher().fileChangedOnDisk( fileName ); },
+            []( LoadingStatus ) { return true; } );
+
+        const auto appendedLines = logData.getNbLine() - nbLines;
+        const auto endLine = LineNumber( logData.getNbLine().get() );
+        const auto start = Clock::now();
+        runUntil(
+            filteredData.get(), &LogFilteredData::searchProgressed,
+            [ & ] { filteredData->updateSearch( 0_lnum, endLine ); },
+            []( LinesCount, int progress, LineNumber ) { return progress == 100; } );
+
+        auto result = stageResult( secondsSince( start ),
+                                   QFileInfo( fileName ).size() - fileSize, appendedLines );
+        result[ "appendedLines" ] = static_cast<double>( appendedLines.get() );
+        stages[ "updateSearch" ] = result;
+    }
+
+    const auto totalLines = logData.getNbLine();
+    const auto totalSize = QFileInfo( fileName ).size();
+
+    {
+        // Pattern that is not found reads the whole file
+        QuickFind quickFind( logData );
+        const auto matcher = QuickFindMatcher(
+            true, static_cast<QRegularExpression>( RegularExpressionPattern( "no-such-word" ) ) );
+
+        const auto start = Clock::now();
+        runUntil(
+            &quickFind, &QuickFind::searchDone,
+            [ & ] { quickFind.searchForward( Selection(), matcher ); },
+            []( bool, Portion ) { return true; } );
+        stages[ "quickFind" ] = stageResult( secondsSince( start ), totalSize, totalLines );
+    }
+
+    {
+        QJsonObject retrieval;
+        constexpr auto PageSize = 100_lcount;
+
+        // Scrolling through the file page by page
+        const auto sequentialLines
+            = LinesCount( std::min<LinesCount::UnderlyingType>( totalLines.get(), 1000000 ) );
+        auto start = Clock::now();
+        for ( auto line = 0_lnum; line + PageSize <= LineNumber( sequentialLines.get() );
+              line = line + PageSize ) {
+            logData.getExpandedLines( line, PageSize );
+        }
+        retrieval[ "sequential" ] = stageResult( secondsSince( start ), 0, sequentialLines );
+
+        // Jumping to random places, e.g. from search results
+        constexpr auto Jumps = 10000;
+        LogRandom random( options.seed );
+        start = Clock::now();
+        for ( auto jump = 0; jump < Jumps && PageSize < totalLines; ++jump ) {
+            const auto line = LineNumber( random.below( ( totalLines - PageSize ).get() ) );
+            logData.getExpandedLines( line, PageSize );
+        }
+        retrieval[ "random" ] = stageResult( secondsSince( start ), 0,
+                                             LinesCount( Jumps * PageSize.get() ) );
+        stages[ "lineRetrieval" ] = retrieval;
+    }
+
+    report[ "dataset" ] = dataset;
+    report[ "stages" ] = stages;
+    report[ "peakRssBytes" ] = static_cast<double>( peakResidentMemory() );
+
+    if ( parser.isSet( traceOption ) ) {
+        QFile trace( parser.value( traceOption ) );
+        if ( !trace.open( QIODevice::WriteOnly ) ) {
+            std::cerr << "Failed to write " << trace.fileName().toStdString() << "\n";
+            return EXIT_FAILURE;
+        }
+        trace.write( Tracing::get().chromeTrace() );
+    }
+
+    const auto json = QJsonDocument( report ).toJson();
+    if ( parser.isSet( outputOption ) ) {
+        QFile output( parser.value( outputOption ) );
+        if ( !output.open( QIODevice::WriteOnly ) ) {
+            std::cerr << "Failed to write " << output.fileName().toStdString() << "\n";
+            return EXIT_FAILURE;
+        }
+        output.write( json );
+    }
+    else {
+        std::cout << json.toStdString();
+    }
+
+    return EXIT_SUCCESS;
+}
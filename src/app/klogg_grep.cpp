@@ -20,13 +20,11 @@
 #include <mimalloc.h>
 
 #include "configuration.h"
-#include "logdata.h"
-#include "logfiltereddata.h"
-#include "dispatch_to.h"
 #include "logger.h"
 #include "persistentinfo.h"
 
 #include "cli.h"
+#include "headlesssearch.h"
 
 const bool PersistentInfo::ForcePortable = true;
 
@@ -35,8 +33,6 @@ int main( int argc, char* argv[] )
 #ifdef KLOGG_USE_MIMALLOC
     mi_stats_reset();
 #endif
-    qRegisterMetaType<LinesCount>( "LinesCount" );
-    qRegisterMetaType<LineNumber>( "LineNumber" );
 
     QCoreApplication app( argc, argv );
     CliParameters parameters( app, true );
@@ -45,36 +41,5 @@ int main( int argc, char* argv[] )
 
     auto configuration = Configuration::getSynced();
 
-    LogData logData;
-    auto filteredData = logData.getNewFilteredData();
-
-    filteredData->connect(
-        filteredData.get(), &LogFilteredData::searchProgressed,
-        [ & ]( LinesCount nbMatches, int progress, LineNumber ) {
-            if ( progress == 100 ) {
-
-                LOG_INFO << "Searched finished, got " << nbMatches.get() << " matches";
-
-                const auto defaultChunkSize = 1000_lcount;
-                for ( auto chunkStart = 0_lnum; chunkStart < nbMatches;
-                      chunkStart = chunkStart + defaultChunkSize ) {
-                    auto chunkSize
-                        = std::min( defaultChunkSize.get(), nbMatches.get() - chunkStart.get() );
-                    auto lines = filteredData->getLines( chunkStart, LinesCount( chunkSize ) );
-                    for ( const auto& l : lines ) {
-                        std::cout << l.toStdString() << "\n";
-                    }
-                }
-
-                exit( EXIT_SUCCESS );
-            }
-        } );
-
-    logData.connect( &logData, &LogData::loadingFinished, [ & ]() {
-        dispatchToMainThread(
-            [ & ] { filteredData->runSearch( RegularExpressionPattern( parameters.pattern ) ); } );
-    } );
-
-    logData.attachFile( parameters.filenames.front() );
-    return app.exec();
-}
\ No newline at end of file
+    return runHeadlessSearch( app, parameters );
+}
@@ -37,7 +37,10 @@
  */
 
 #include "log.h"
+#include <QTimer>
 #include <QtGlobal>
+#include <algorithm>
+#include <chrono>
 #include <qapplication.h>
 #include <qthreadpool.h>
 
@@ -55,12 +58,16 @@
 
 #include "tbb/global_control.h"
 
+#include "backgroundrelease.h"
 #include "configuration.h"
 #include "logger.h"
 #include "mainwindow.h"
+#include "metrics.h"
 #include "styles.h"
+#include "tracing.h"
 
 #include "cli.h"
+#include "headlesssearch.h"
 #include "kloggapp.h"
 
 #ifdef KLOGG_PORTABLE
@@ -69,6 +76,54 @@ const bool PersistentInfo::ForcePortable = true;
 const bool PersistentInfo::ForcePortable = false;
 #endif
 
+namespace {
+// Records durations of startup phases as startup.<name>_us metrics,
+// trace spans and log lines. Names must be string literals.
+class StartupPhases {
+  public:
+    StartupPhases() = default;
+
+    ~StartupPhases()
+    {
+        finish();
+    }
+
+    StartupPhases( const StartupPhases& ) = delete;
+    StartupPhases& operator=( const StartupPhases& ) = delete;
+
+    // Ends the current phase and starts the next one
+    void start( const char* name )
+    {
+        finish();
+        name_ = name;
+        start_ = Tracing::now();
+    }
+
+    void finish()
+    {
+        if ( name_ == nullptr ) {
+            return;
+        }
+
+        const auto end = Tracing::now();
+        const auto duration = ( end - start_ ) / 1000;
+        Metrics::get()
+            .histogram( QString( "startup.%1_us" ).arg( name_ ) )
+            .record( static_cast<uint64_t>( duration ) );
+        if ( Tracing::isEnabled() ) {
+            Tracing::record( name_, "startup", start_, end, nullptr, 0 );
+        }
+        LOG_INFO << "Startup phase " << name_ << " took " << duration << " us";
+
+        name_ = nullptr;
+    }
+
+  private:
+    const char* name_ = nullptr;
+    int64_t start_ = 0;
+};
+} // namespace
+
 void setApplicationAttributes( bool enableQtHdpi, int scaleFactorRounding )
 {
     // When QNetworkAccessManager is instantiated it regularly starts polling
@@ -119,9 +174,27 @@ int main( int argc, char* argv[] )
     mi_process_init();
 #endif
 
+    // Searching from scripts needs no windows, so no GUI application is created
+    if ( CliParameters::is_headless( argc, argv ) ) {
+        QCoreApplication app( argc, argv );
+        CliParameters parameters( app, true );
+        logging::enableLogging( parameters.enable_logging,
+                                static_cast<logging::LogLevel>( parameters.log_level ) );
+        Configuration::getSynced();
+        return runHeadlessSearch( app, parameters );
+    }
+
+    StartupPhases startupPhases;
+
+    startupPhases.start( "settings" );
     const auto& config = Configuration::getSynced();
+    // Memory taken from the system from now on is in large pages when it can be
+    if ( config.useHugePages() ) {
+        mi_option_enable( mi_option_large_os_pages );
+    }
     setApplicationAttributes( config.enableQtHighDpi(), config.scaleFactorRounding() );
 
+    startupPhases.start( "application" );
     KloggApp app( argc, argv );
 
 
@@ -133,8 +206,6 @@ int main( int argc, char* argv[] )
     logging::enableLogging( parameters.enable_logging || config.enableLogging(), logLevel );
     logging::enableFileLogging( parameters.log_to_file || config.enableLogging(), logLevel );
 
-    app.initCrashHandler();
-
     auto maxConcurrency
         = tbb::global_control::active_value( tbb::global_control::max_allowed_parallelism );
 
@@ -164,11 +235,18 @@ int main( int argc, char* argv[] )
         QThreadPool::globalInstance()->setMaxThreadCount( static_cast<int>( maxConcurrency ) );
     }
 
-    if ( !parameters.multi_instance && app.isSecondary() ) {
+    // Standard input can be read only by this process
+    const auto isReadingStandardInput
+        = std::find( parameters.filenames.begin(), parameters.filenames.end(),
+                     CliParameters::StandardInputName )
+          != parameters.filenames.end();
+
+    if ( !parameters.multi_instance && !isReadingStandardInput && app.isSecondary() ) {
         LOG_INFO << "Found another klogg, pid " << app.primaryPid();
         app.sendFilesToPrimaryInstance( parameters.filenames );
     }
     else {
+        startupPhases.start( "windows" );
         StyleManager::applyStyle( config.style() );
 
         auto startNewSession = true;
@@ -192,13 +270,30 @@ int main( int argc, char* argv[] )
         for ( const auto& filename : parameters.filenames ) {
             mw->loadInitialFile( filename, parameters.follow_file );
         }
-
-        if ( startNewSession ) {
-            app.clearInactiveSessions();
-        }
-
-        app.startBackgroundTasks();
+        startupPhases.finish();
+
+        // Work not needed to show windows is done once the event loop runs
+        QTimer::singleShot( 0, &app, [ &app, startNewSession ] {
+            static auto& firstWindow = Metrics::get().gauge( "startup.first_window_ms" );
+            const auto sinceStart = static_cast<double>( Tracing::now() / 1000 ) / 1000.0;
+            firstWindow.set( sinceStart );
+            LOG_INFO << "Windows shown " << sinceStart << " ms after start";
+
+            StartupPhases deferredPhases;
+            deferredPhases.start( "crash_handler" );
+            app.initCrashHandler();
+
+            deferredPhases.start( "background_tasks" );
+            if ( startNewSession ) {
+                app.clearInactiveSessions();
+            }
+            app.startBackgroundTasks();
+        } );
     }
+    startupPhases.finish();
 
-    return app.exec();
+    const auto exitCode = app.exec();
+    // Files closed later, e.g. by the main window, are freed before the process ends
+    BackgroundRelease::get().stop();
+    return exitCode;
 }
@@ -24,5 +24,7 @@
 
 uint64_t physicalMemory();
 uint64_t usedMemory();
+// Highest resident memory of the process so far
+uint64_t peakResidentMemory();
 
 #endif
\ No newline at end of file
@@ -44,6 +44,13 @@ uint64_t usedMemory()
     return static_cast<uint64_t>( pmc.PagefileUsage );
 }
 
+uint64_t peakResidentMemory()
+{
+    PROCESS_MEMORY_COUNTERS pmc;
+    GetProcessMemoryInfo( GetCurrentProcess(), &pmc, sizeof( pmc ) );
+    return static_cast<uint64_t>( pmc.PeakWorkingSetSize );
+}
+
 #elif defined( Q_OS_APPLE )
 
 #include <sys/sysctl.h>
@@ -52,6 +59,7 @@ uint64_t usedMemory()
 #include <AvailabilityMacros.h>
 #include <mach/mach.h>
 #include <mach/shared_region.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
 #if SHARED_TEXT_REGION_SIZE || SHARED_DATA_REGION_SIZE
@@ -83,6 +91,16 @@ uint64_t usedMemory()
     }
 }
 
+uint64_t peakResidentMemory()
+{
+    struct rusage usage;
+    if ( getrusage( RUSAGE_SELF, &usage ) != 0 ) {
+        return 0;
+    }
+    // Bytes on macOS
+    return static_cast<uint64_t>( usage.ru_maxrss );
+}
+
 #else
 
 #include <unistd.h>
@@ -97,7 +115,9 @@ uint64_t systemPhysicalMemory()
     return pages * pageSize;
 }
 
-uint64_t usedMemory()
+namespace {
+// Value in kB of the field of /proc/self/status
+uint64_t processStatusValue( const char* pattern )
 {
     long unsigned size = 0;
     FILE* statusFile = fopen( "/proc/self/status", "r" );
@@ -106,7 +126,6 @@ uint64_t usedMemory()
     }
 
     std::array<char, 200> status;
-    static constexpr auto pattern = "VmSize: %lu";
     while ( NULL != fgets( status.data(), status.size(), statusFile ) ) {
         if ( 1 == sscanf( status.data(), pattern, &size ) ) {
             break;
@@ -116,6 +135,17 @@ uint64_t usedMemory()
     fclose( statusFile );
     return size * 1024;
 }
+} // namespace
+
+uint64_t usedMemory()
+{
+    return processStatusValue( "VmSize: %lu" );
+}
+
+uint64_t peakResidentMemory()
+{
+    return processStatusValue( "VmHWM: %lu" );
+}
 
 #endif
 
@@ -40,7 +40,9 @@
 #define FILEWATCHER_H
 
 #include <QObject>
+#include <QThreadPool>
 
+#include <atomic>
 #include <memory>
 
 class EfswFileWatcher;
@@ -94,6 +96,8 @@ class FileWatcher : public QObject {
     ~FileWatcher() override; // for complete EfswFileWatcher
 
     QTimer* checkTimer_;
+    QThreadPool pollingPool_;
+    std::atomic<bool> isPolling_{ false };
     KDToolBox::KDGenericSignalThrottler* throttler_;
     std::vector<QString> changes_;
 
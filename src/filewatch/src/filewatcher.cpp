@@ -22,6 +22,8 @@
 #include "configuration.h"
 #include "dispatch_to.h"
 #include "log.h"
+#include "metrics.h"
+#include "runnable_lambda.h"
 #include "synchronization.h"
 
 #include <KDSignalThrottler.h>
@@ -38,11 +40,22 @@
 
 namespace {
 
+// Changes of followed files are indexed as soon as possible with fast follow
+constexpr int ChangesThrottleMs = 250;
+constexpr int FastFollowChangesThrottleMs = 5;
+
+// Files not changed for a while are polled up to this many times less often
+constexpr int64_t MaxPollBackoff = 8;
+
 struct WatchedFile {
     std::string name;
     int64_t mTime;
     int64_t size;
 
+    // Polling interval grows while the file is not changed
+    int64_t pollIntervalMs = 0;
+    int64_t nextPollMs = 0;
+
     bool operator==( const std::string& filename ) const
     {
         return name == filename;
@@ -198,40 +211,79 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
         }
     }
 
-    void checkWatches()
+    void checkWatches( int64_t pollIntervalMs )
     {
-        const auto collectChangedFiles = [ this ]() {
+        struct PolledFile {
+            std::string directory;
+            WatchedFile file;
+        };
+
+        const auto now = QDateTime::currentMSecsSinceEpoch();
+
+        // Files are checked without the lock, slow mounts don't block adding files
+        std::vector<PolledFile> polledFiles;
+        {
             ScopedRecursiveLock lock( mutex_ );
+            for ( const auto& dir : watchedPaths_ ) {
+                for ( const auto& file : dir.files ) {
+                    if ( file.nextPollMs <= now ) {
+                        polledFiles.push_back( { dir.name, file } );
+                    }
+                }
+            }
+        }
 
-            std::vector<QString> changedFiles;
+        for ( auto& polledFile : polledFiles ) {
+            const auto fileInfo = QFileInfo{ polledPath( polledFile.directory,
+                                                         polledFile.file.name ) };
+            polledFile.file.mTime = fileInfo.lastModified().toMSecsSinceEpoch();
+            polledFile.file.size = fileInfo.size();
+        }
 
-            for ( auto& dir : watchedPaths_ ) {
-                for ( auto& file : dir.files ) {
-                    const auto path
-                        = QDir::cleanPath( QString::fromStdString( dir.name ) + QDir::separator()
-                                           + QString::fromStdString( file.name ) );
+        std::vector<QString> changedFiles;
+        {
+            ScopedRecursiveLock lock( mutex_ );
+            for ( const auto& polledFile : polledFiles ) {
+                auto watchedDirectory = std::find_if(
+                    watchedPaths_.begin(), watchedPaths_.end(),
+                    [ &polledFile ]( const auto& wd ) { return wd.name == polledFile.directory; } );
+                if ( watchedDirectory == watchedPaths_.end() ) {
+                    continue;
+                }
 
-                    const auto fileInfo = QFileInfo{ path };
+                auto file = std::find( watchedDirectory->files.begin(),
+                                       watchedDirectory->files.end(), polledFile.file.name );
+                if ( file == watchedDirectory->files.end() ) {
+                    continue;
+                }
 
-                    auto watchedFile = WatchedFile{ fileInfo.fileName().toStdString(),
-                                                    fileInfo.lastModified().toMSecsSinceEpoch(),
-                                                    fileInfo.size() };
+                const auto isChanged = *file != polledFile.file;
+                file->mTime = polledFile.file.mTime;
+                file->size = polledFile.file.size;
 
-                    if ( file != watchedFile ) {
-                        changedFiles.push_back( path );
-                        LOG_INFO << "will notify for " << path;
-                    }
+                // Active files are polled at each tick, idle ones back off
+                file->pollIntervalMs
+                    = isChanged ? pollIntervalMs
+                                : std::min( std::max( file->pollIntervalMs, pollIntervalMs ) * 2,
+                                            pollIntervalMs * MaxPollBackoff );
+                file->nextPollMs = now + file->pollIntervalMs;
 
-                    file = std::move( watchedFile );
+                if ( isChanged ) {
+                    changedFiles.push_back( polledPath( polledFile.directory, file->name ) );
+                    LOG_INFO << "will notify for " << changedFiles.back();
                 }
             }
+        }
 
-            return changedFiles;
-        };
+        LOG_DEBUG << "Polled " << polledFiles.size() << " files, " << changedFiles.size()
+                  << " changed";
 
-        for ( const auto& changedFile : collectChangedFiles() ) {
-            dispatchToMainThread( [ watcher = parent_, changedFile ]() {
-                watcher->fileChangedOnDisk( changedFile );
+        // Changes of one tick are sent at once
+        if ( !changedFiles.empty() ) {
+            dispatchToMainThread( [ watcher = parent_, changedFiles ]() {
+                for ( const auto& changedFile : changedFiles ) {
+                    watcher->fileChangedOnDisk( changedFile );
+                }
             } );
         }
     }
@@ -314,6 +366,12 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
     }
 
   private:
+    static QString polledPath( const std::string& directory, const std::string& filename )
+    {
+        return QDir::cleanPath( QString::fromStdString( directory ) + QDir::separator()
+                                + QString::fromStdString( filename ) );
+    }
+
     efsw::FileWatcher watcher_;
     std::vector<WatchedDirecotry> watchedPaths_;
     FileWatcher* parent_;
@@ -334,8 +392,9 @@ FileWatcher::FileWatcher()
     , efswWatcher_{ new EfswFileWatcher( this ) }
 {
     connect( checkTimer_, &QTimer::timeout, this, &FileWatcher::checkWatches );
+    pollingPool_.setMaxThreadCount( 1 );
 
-    throttler_->setTimeout( 250 );
+    throttler_->setTimeout( ChangesThrottleMs );
     connect( this, &FileWatcher::notifyFileChangedOnDisk, throttler_,
              &KDToolBox::KDGenericSignalThrottler::throttle );
     connect( throttler_, &KDToolBox::KDGenericSignalThrottler::triggered, this,
@@ -364,6 +423,9 @@ void FileWatcher::removeFile( const QString& fileName )
 
 void FileWatcher::fileChangedOnDisk( const QString& fileName )
 {
+    static auto& changes = Metrics::get().counter( "filewatch.changes" );
+    changes.add();
+
     if ( std::find( changes_.begin(), changes_.end(), fileName ) == changes_.end() ) {
         changes_.push_back( fileName );
     }
@@ -373,6 +435,9 @@ void FileWatcher::fileChangedOnDisk( const QString& fileName )
 
 void FileWatcher::sendChangesNotifications()
 {
+    static auto& notifications = Metrics::get().counter( "filewatch.notifications" );
+    notifications.add( changes_.size() );
+
     for ( const auto& fileName : changes_ ) {
         Q_EMIT fileChanged( fileName );
     }
@@ -394,9 +459,21 @@ void FileWatcher::updateConfiguration()
     }
 
     efswWatcher_->enableWatch( config.nativeFileWatchEnabled() );
+
+    throttler_->setTimeout( config.useFastFollow() ? FastFollowChangesThrottleMs
+                                                   : ChangesThrottleMs );
 }
 
 void FileWatcher::checkWatches()
 {
-    efswWatcher_->checkWatches();
+    // Files are polled in the background, a tick is skipped while the previous one runs
+    if ( isPolling_.exchange( true ) ) {
+        return;
+    }
+
+    const int64_t pollIntervalMs = Configuration::get().pollIntervalMs();
+    pollingPool_.start( createRunnable( [ this, pollIntervalMs ] {
+        efswWatcher_->checkWatches( pollIntervalMs );
+        isPolling_ = false;
+    } ) );
 }
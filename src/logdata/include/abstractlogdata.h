@@ -39,6 +39,9 @@
 #ifndef ABSTRACTLOGDATA_H
 #define ABSTRACTLOGDATA_H
 
+#include <optional>
+
+#include <QByteArray>
 #include <QObject>
 #include <QString>
 #include <QStringList>
@@ -60,6 +63,16 @@ class AbstractLogData : public QObject {
     klogg::vector<QString> getLines( LineNumber first_line, LinesCount number ) const;
     // Returns a set of lines with tabs expanded
     klogg::vector<QString> getExpandedLines( LineNumber first_line, LinesCount number ) const;
+    // Returns at most length columns of the line with tabs expanded,
+    // starting at about the first column. Only this part of the line
+    // is read and decoded, columns are approximated from its bytes.
+    QString getExpandedLineWindow( LineNumber line, LineColumn firstColumn,
+                                   LineLength length ) const;
+    // Returns the size in bytes of the line in the file, with its end of line
+    qint64 getLineSize( LineNumber line ) const;
+    // Returns the bytes of a set of lines as they are in the file, with their ends of line.
+    // Empty if lines are changed when they are read, e.g. by a prefilter.
+    std::optional<QByteArray> getLinesBytes( LineNumber first_line, LinesCount number ) const;
     // Returns the line numer
     LineNumber getLineNumber( LineNumber index ) const;
     // Returns the total number of lines
@@ -88,6 +101,8 @@ class AbstractLogData : public QObject {
         Plain = 0, // 0 can be checked like a proper flag in QFlags
         Match = 1 << 0,
         Mark = 1 << 1,
+        // First line shown after lines that are not shown
+        Gap = 1 << 2,
     };
     Q_DECLARE_FLAGS( LineType, LineTypeFlags )
 
@@ -101,6 +116,14 @@ class AbstractLogData : public QObject {
     // Internal function called to get a set of expanded lines
     virtual klogg::vector<QString> doGetExpandedLines( LineNumber first_line,
                                                      LinesCount number ) const = 0;
+    // Internal function called to get a part of an expanded line
+    virtual QString doGetExpandedLineWindow( LineNumber line, LineColumn firstColumn,
+                                             LineLength length ) const = 0;
+    // Internal function called to get the size of a line in the file
+    virtual qint64 doGetLineSize( LineNumber line ) const = 0;
+    // Internal function called to get the bytes of a set of lines in the file
+    virtual std::optional<QByteArray> doGetLinesBytes( LineNumber first_line,
+                                                       LinesCount number ) const = 0;
 
     // Internal function called to get the index of given line
     virtual LineNumber doGetLineNumber( LineNumber index ) const = 0;
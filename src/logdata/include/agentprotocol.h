@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_AGENTPROTOCOL_H
+#define KLOGG_AGENTPROTOCOL_H
+
+#include <optional>
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QIODevice>
+#include <QtGlobal>
+
+#include "logfiltereddataworker.h"
+
+// Messages between a client and klogg_agent, which indexes and searches
+// files on the host where they are, so only requested lines and changes
+// of search results are sent over the network. A message is its size as
+// a 32 bit big endian number, its type and a payload of values written
+// with QDataStream in the order given for each type. New matches of a
+// search are sent as a roaring bitmap in the portable format.
+namespace agent {
+
+// Agent listens on a local socket, not on a network port
+constexpr const char* DefaultSocketName = "klogg-agent";
+constexpr quint32 ProtocolVersion = 1;
+
+// Larger messages are treated as a broken stream
+constexpr int MaxMessageSize = 64 * 1024 * 1024;
+// Lines sent for one request
+constexpr quint64 MaxLinesPerRequest = 100000;
+
+enum class MessageType : quint8 {
+    // Client, quint32 version, QString file name
+    Open = 1,
+    // Agent, bool is loaded, qint32 loading percent, quint64 lines,
+    // qint64 file size, qint32 max length, QByteArray encoding
+    FileInfo,
+    // Client, quint64 first line, quint64 number of lines
+    GetLines,
+    // Agent, quint64 first line, quint64 number of lines, bool is UTF-8,
+    // QByteArray lines with their ends of line, as they are in the file
+    // or converted to UTF-8 if they are changed when read
+    Lines,
+    // Client, QString pattern, bool is case sensitive, bool is exclude,
+    // bool is boolean, bool is plain text
+    Search,
+    // Client, no payload
+    StopSearch,
+    // Agent, bool results are reset, qint32 percent, quint64 matches,
+    // QByteArray bitmap of lines matched since the previous message
+    SearchResults,
+    // Agent, QString description
+    Error,
+};
+
+struct Message {
+    MessageType type;
+    QByteArray payload;
+};
+
+QByteArray encodeMessage( MessageType type, const QByteArray& payload = {} );
+
+// Splits received data into messages
+class MessageReader {
+  public:
+    void append( const QByteArray& data );
+
+    // Nothing until all data of the next message is received
+    std::optional<Message> next();
+
+    // Size of a message is over the limit, nothing is read anymore
+    bool isBroken() const
+    {
+        return isBroken_;
+    }
+
+  private:
+    QByteArray buffer_;
+    bool isBroken_ = false;
+};
+
+template <typename... Values>
+QByteArray writePayload( const Values&... values )
+{
+    QByteArray payload;
+    QDataStream stream( &payload, QIODevice::WriteOnly );
+    stream.setVersion( QDataStream::Qt_5_9 );
+    ( stream << ... << values );
+    return payload;
+}
+
+// False if the payload has fewer values
+template <typename... Values>
+bool readPayload( const QByteArray& payload, Values&... values )
+{
+    QDataStream stream( payload );
+    stream.setVersion( QDataStream::Qt_5_9 );
+    ( stream >> ... >> values );
+    return stream.status() == QDataStream::Ok;
+}
+
+QByteArray encodeLines( const SearchResultArray& lines );
+std::optional<SearchResultArray> decodeLines( const QByteArray& data );
+
+} // namespace agent
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_ANSICOLORSEQUENCES_H
+#define KLOGG_ANSICOLORSEQUENCES_H
+
+#include <cstddef>
+#include <string_view>
+
+// Same sequences as stripAnsiColorSequences removes, for text already decoded
+// from encodings not compatible with ASCII. Matched without case sensitivity.
+constexpr char AnsiColorSequenceRegex[] = "\\x1B\\[([0-9]{1,2}(;[0-9]{1,2})?)?[mK]";
+
+// Copy text in an ASCII compatible encoding to out without ANSI color sequences:
+// ESC [, optionally one or two numbers of up to 2 digits separated by ';',
+// and 'm' or 'K' in any case. Out must have space for the whole text,
+// it can be the text itself. Returns the size of the copied text.
+size_t stripAnsiColorSequences( std::string_view text, char* out );
+
+#endif
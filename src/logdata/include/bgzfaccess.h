@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_BGZFACCESS_H
+#define KLOGG_BGZFACCESS_H
+
+#include <atomic>
+#include <memory>
+
+#include <QtGlobal>
+
+#include "framedaccess.h"
+#include "gzipaccess.h"
+#include "synchronization.h"
+
+// Random access to the decompressed data of a BGZF file, a gzip file made of
+// members of at most 64 KiB, e.g. written by bgzip. The size of each member is
+// in its header and the size of its data in its trailer, so members are found
+// without decompressing them and then decompressed independently.
+// Files are detected by their first member, if one of the next members is not
+// a BGZF block the file is read as plain gzip.
+class BgzfAccess : public FramedAccess {
+  public:
+    // Header of a BGZF member up to the end of its block size field
+    static constexpr qint64 BlockHeaderSize = 18;
+
+    // Data starts with the header of a BGZF member
+    static bool isBgzfHeader( const char* data, qint64 size );
+
+    bool build( const ReadCompressed& readCompressed, qint64 compressedSize ) override;
+    bool isBuilt() const override;
+    qint64 size() const override;
+
+    std::unique_ptr<CompressedAccess::Reader> makeReader(
+        ReadCompressed readCompressed ) const override;
+
+  private:
+    // Frames are the members of the file
+    bool readFrames( const ReadCompressed& readCompressed, qint64 compressedSize,
+                     klogg::vector<Frame>& frames ) const override;
+
+    bool decompressFrame( const char* compressed, qint64 compressedSize, char* data,
+                          qint64 size ) const override;
+
+  private:
+    Mutex buildMutex_;
+    // Set once before the gzip access is built
+    std::atomic<bool> isGzip_{ false };
+    std::shared_ptr<GzipAccess> gzipAccess_;
+};
+
+#endif
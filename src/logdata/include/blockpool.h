@@ -22,12 +22,25 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 
 #include <containers.h>
 
+class QTemporaryFile;
+
+// Blocks are allocated one after another in fixed size chunks of memory,
+// so growing the pool never moves existing blocks. Chunks are released
+// when their blocks are freed.
+// When chunks of all pools take more memory than perf.lineIndexMemoryMb,
+// new chunks are mapped from a temporary file in the cache directory,
+// so the page cache keeps the used ones in memory.
+// With perf.useHugePages chunks are aligned to huge pages and the system
+// is asked to back them with huge pages, so lookups miss the TLB less.
 class BlockPoolBase
 {
 public:
+    ~BlockPoolBase();
+
     BlockPoolBase( const BlockPoolBase& ) = delete;
     BlockPoolBase& operator =( const BlockPoolBase& ) = delete;
 
@@ -43,6 +56,13 @@ public:
     uint32_t currentBlock() const;
 
     size_t allocatedSize() const;
+    // Part of allocated size in mapped chunks
+    size_t mappedSize() const;
+
+    // Memory of chunks of all pools that are not mapped
+    static size_t heapChunksSize();
+    // Part of it backed by huge pages
+    static size_t hugePageChunksSize();
 
 protected:
     BlockPoolBase( size_t elementSize, size_t alignment );
@@ -55,14 +75,43 @@ protected:
     size_t lastBlockSize() const;
 
 private:
-  klogg::vector<uint8_t> pool_;
+  struct FreeChunkMemory {
+      void operator()( uint8_t* memory ) const;
+  };
+
+  struct Chunk {
+      uint8_t* data;
+      size_t size;
+      // Bytes used by blocks from the start of chunk
+      size_t used;
+      // Empty if the chunk is mapped from the spill file
+      std::unique_ptr<uint8_t, FreeChunkMemory> memory;
+      bool isHugePages = false;
+  };
+
+  // Start a new block in the last chunk, or in a new one if it doesn't fit
+  uint8_t* allocate( size_t size );
+
+  // Chunk is mapped if memory of chunks is over the limit and the file can be mapped
+  Chunk newChunk( size_t size, size_t used );
+  // Returns false if the spill file can't be used
+  bool mapChunk( Chunk& chunk );
+  void releaseLastChunk();
+  void releaseChunks();
+
+  klogg::vector<Chunk> chunks_;
+
+  std::unique_ptr<QTemporaryFile> spillFile_;
+  // End of the last mapped chunk in the file
+  size_t spillFileUsed_ = 0;
 
   size_t elementSize_;
   size_t alignment_;
 
   size_t allocationSize_;
 
-  klogg::vector<size_t> blockIndex_;
+  // Start of each block, the last one is in the last chunk
+  klogg::vector<uint8_t*> blockIndex_;
 };
 
 template<typename ElementType>
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_BLOCKREADQUEUE_H
+#define KLOGG_BLOCKREADQUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <thread>
+
+#include <QtGlobal>
+
+#include "containers.h"
+#include "synchronization.h"
+
+// Reads of file blocks with several of them in flight at once. One synchronous
+// read after another leaves a fast disk idle between the requests, so each read
+// of the queue is done by its own thread and the device gets as many requests
+// as the depth of the queue. One thread submits blocks and takes them in the
+// order they were submitted, each once its read is done.
+class BlockReadQueue {
+  public:
+    // Reads up to size bytes at the offset, returns the number of bytes read or -1
+    using ReadFunction = std::function<qint64( qint64 offset, char* data, qint64 size )>;
+
+    struct Read {
+        qint64 offset = 0;
+        char* data = nullptr;
+        qint64 size = 0;
+        qint64 bytesRead = 0;
+        std::chrono::microseconds duration{ 0 };
+    };
+
+    BlockReadQueue( ReadFunction read, size_t depth );
+    // Waits for the reads in flight, reads not started yet are dropped
+    ~BlockReadQueue();
+
+    BlockReadQueue( const BlockReadQueue& ) = delete;
+    BlockReadQueue& operator=( const BlockReadQueue& ) = delete;
+
+    size_t depth() const
+    {
+        return depth_;
+    }
+
+    // Called by the submitting thread
+    bool isFull() const;
+    bool isEmpty() const;
+    void submit( qint64 offset, char* data, qint64 size );
+    // Waits for the oldest submitted read to be done, some read must be submitted
+    Read take();
+
+  private:
+    struct QueuedRead {
+        Read read;
+        bool isDone = false;
+    };
+
+    void readBlocks();
+
+  private:
+    const ReadFunction read_;
+    const size_t depth_;
+
+    mutable Mutex mutex_;
+    std::condition_variable_any submitted_;
+    std::condition_variable_any done_;
+    // In the order of submission, references stay valid while reads are added
+    std::deque<QueuedRead> reads_;
+    size_t startedReads_ = 0;
+    bool isStopping_ = false;
+
+    klogg::vector<std::thread> threads_;
+};
+
+#endif
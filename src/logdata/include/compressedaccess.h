@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_COMPRESSEDACCESS_H
+#define KLOGG_COMPRESSEDACCESS_H
+
+#include <functional>
+#include <memory>
+
+#include <QString>
+#include <QtGlobal>
+
+// Random access to the decompressed data of a compressed file,
+// the file is not decompressed to disk.
+class CompressedAccess : public std::enable_shared_from_this<CompressedAccess> {
+  public:
+    // Reads up to size bytes of the compressed file at the offset,
+    // returns the number of bytes read or -1.
+    using ReadCompressed = std::function<qint64( qint64 offset, char* data, qint64 size )>;
+
+    // Reads of the decompressed data, each thread uses its own reader
+    class Reader {
+      public:
+        virtual ~Reader() = default;
+
+        // Read up to size bytes at the offset of the decompressed data,
+        // returns the number of bytes read or -1.
+        virtual qint64 read( qint64 offset, char* data, qint64 size ) = 0;
+
+        // Offset of the next decompressed byte, reads from there are the fastest
+        virtual qint64 position() const = 0;
+    };
+
+    virtual ~CompressedAccess() = default;
+
+    // Access for the compression format of the file, empty if the file
+    // is not compressed or can't be read at random offsets.
+    static std::shared_ptr<CompressedAccess> create( const QString& fileName );
+
+    // Find where decompression can start and the size of the data,
+    // does nothing if they are found already. False if the file can't be decompressed.
+    virtual bool build( const ReadCompressed& readCompressed, qint64 compressedSize ) = 0;
+    virtual bool isBuilt() const = 0;
+
+    // Size of the decompressed data, 0 until the access is built
+    virtual qint64 size() const = 0;
+
+    // Reader of the built access, it keeps the access alive
+    virtual std::unique_ptr<Reader> makeReader( ReadCompressed readCompressed ) const = 0;
+};
+
+#endif
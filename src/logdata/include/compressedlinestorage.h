@@ -96,6 +96,16 @@
  * long-ish (30 KB) lines.
  *
  * The table32 always starts at 0, the table64 starts at first_long_line_
+ *
+ * When the next block is started, the finished one is packed if it gets smaller.
+ * Packed blocks store offsets of their lines from the first one, all with the
+ * number of bits of the largest offset (at most 56), so any line is read
+ * without decoding the lines before it:
+ * 00 - Absolute EOF address (4 or 8 bytes)
+ * +0 - 0xC0, never the first byte of a varint entry (1 byte)
+ * +1 - Bits per offset (1 byte)
+ * +2 - Offsets of the 255 following lines, little endian bit order
+ *      (followed by 8 bytes of padding for 64 bits loads)
  */
 
 #ifndef COMPRESSEDLINESTORAGE_H
@@ -160,16 +170,29 @@ class CompressedLinePositionStorage {
     }
     OffsetInFile at( LineNumber i, Cache* lastPosition = nullptr ) const;
 
+    // Write count elements starting at first to out,
+    // each block is decoded once. Decoding continues from the last position
+    // if it is in the block of first element.
+    void at_range( LineNumber first, LinesCount count, OffsetInFile* out,
+                   Cache* lastPosition = nullptr ) const;
+
     // Add one list to the other
     void append_list( const klogg::vector<OffsetInFile>& positions );
 
     // Pop the last element of the storage
     void pop_back();
 
+    // Keep only the first newSize elements of the storage,
+    // pop_back is not available until the next append
+    void truncate( LinesCount newSize );
+
   private:
     // Utility for move ctor/assign
     void move_from( CompressedLinePositionStorage&& orig ) noexcept;
 
+    // Packs the last finished block if it gets smaller
+    void pack_finished_block();
+
     // The two indexes
     BlockPool<uint32_t> pool32_;
     BlockPool<OffsetInFile::UnderlyingType> pool64_;
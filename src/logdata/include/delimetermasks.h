@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_DELIMETERMASKS_H
+#define KLOGG_DELIMETERMASKS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "containers.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Positions of line feeds, tabs and non ASCII bytes in a block of single byte encoded text,
+// found in one vectorized pass over the block.
+// Bit N of mask word M is set if byte 64 * M + N is a delimeter.
+class DelimeterMasks {
+  public:
+    void scan( const char* data, size_t size );
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    // Returns position of the first line feed in [from, size()) or size() if there is none.
+    size_t nextLineFeed( size_t from ) const;
+
+    // Calls callback with position of each tab in [from, to).
+    template <typename Callback>
+    void forEachTab( size_t from, size_t to, Callback&& callback ) const
+    {
+        if ( from >= to ) {
+            return;
+        }
+
+        auto word = from / MaskBits;
+        const auto lastWord = ( to - 1 ) / MaskBits;
+
+        auto bits = tabs_[ word ] & ( ~uint64_t{ 0 } << ( from % MaskBits ) );
+        while ( true ) {
+            if ( word == lastWord && to % MaskBits != 0 ) {
+                bits &= ~( ~uint64_t{ 0 } << ( to % MaskBits ) );
+            }
+
+            while ( bits != 0 ) {
+                callback( word * MaskBits + countTrailingZeros( bits ) );
+                bits &= bits - 1;
+            }
+
+            if ( word == lastWord ) {
+                break;
+            }
+
+            bits = tabs_[ ++word ];
+        }
+    }
+
+    // Returns true if there is a tab in [from, to).
+    bool hasTab( size_t from, size_t to ) const
+    {
+        return hasBits( tabs_, from, to );
+    }
+
+    // Returns true if there is a byte with the high bit set in [from, to).
+    bool hasNonAscii( size_t from, size_t to ) const
+    {
+        return hasBits( nonAscii_, from, to );
+    }
+
+    static constexpr size_t MaskBits = 64;
+
+  private:
+    static bool hasBits( const klogg::vector<uint64_t>& mask, size_t from, size_t to )
+    {
+        if ( from >= to ) {
+            return false;
+        }
+
+        const auto firstWord = from / MaskBits;
+        const auto lastWord = ( to - 1 ) / MaskBits;
+        const auto firstBits = ~uint64_t{ 0 } << ( from % MaskBits );
+        const auto lastBits = ( to % MaskBits ) != 0 ? ~( ~uint64_t{ 0 } << ( to % MaskBits ) )
+                                                     : ~uint64_t{ 0 };
+
+        if ( firstWord == lastWord ) {
+            return ( mask[ firstWord ] & firstBits & lastBits ) != 0;
+        }
+
+        if ( ( mask[ firstWord ] & firstBits ) != 0 || ( mask[ lastWord ] & lastBits ) != 0 ) {
+            return true;
+        }
+
+        for ( auto word = firstWord + 1; word < lastWord; ++word ) {
+            if ( mask[ word ] != 0 ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static size_t countTrailingZeros( uint64_t bits )
+    {
+#if defined( _MSC_VER ) && defined( _M_X64 )
+        unsigned long index = 0;
+        _BitScanForward64( &index, bits );
+        return index;
+#elif defined( _MSC_VER )
+        size_t index = 0;
+        while ( ( bits & 1 ) == 0 ) {
+            bits >>= 1;
+            ++index;
+        }
+        return index;
+#else
+        return static_cast<size_t>( __builtin_ctzll( bits ) );
+#endif
+    }
+
+  private:
+    size_t size_ = 0;
+    klogg::vector<uint64_t> lineFeeds_;
+    klogg::vector<uint64_t> tabs_;
+    klogg::vector<uint64_t> nonAscii_;
+};
+
+// Finds the first code unit of unitWidth bytes (2 or 4) that encodes the delimeter,
+// code units start at data. Returns position of the delimeter byte,
+// that is delimeterIndex bytes after the start of the unit, or size if there is none.
+size_t findWideDelimeter( const char* data, size_t size, char delimeter, int unitWidth,
+                          int delimeterIndex );
+
+#endif
@@ -25,6 +25,7 @@
 
 #include <QByteArray>
 #include <memory>
+#include <string_view>
 
 class QTextCodec;
 class QTextDecoder;
@@ -35,6 +36,8 @@ struct EncodingParameters {
 
     bool isUtf8Compatible{ false };
     bool isUtf16LE{ false };
+    bool isUtf16BE{ false };
+    bool isLatin1{ false };
 
     int lineFeedWidth{ 1 };
     int lineFeedIndex{ 0 };
@@ -73,13 +76,18 @@ class EncodingDetector {
     EncodingDetector( const EncodingDetector&& ) = delete;
     EncodingDetector& operator=( const EncodingDetector&& ) = delete;
 
-    QTextCodec* detectEncoding( const klogg::vector<char>& block ) const;
+    // Thread safe, each call uses its own detector
+    QTextCodec* detectEncoding( std::string_view block ) const;
+
+    // Guesses encoding of a file from blocks sampled across it, the first one
+    // at its beginning. Byte order mark of the first block decides, otherwise
+    // the most common guess of blocks with non-ASCII data wins. Blocks are
+    // detected in parallel. Returns nullptr if all blocks are plain ASCII.
+    QTextCodec* detectEncoding( const klogg::vector<QByteArray>& samples ) const;
 
   private:
     EncodingDetector() = default;
     ~EncodingDetector() = default;
-
-    mutable SharedMutex mutex_;
 };
 
 struct TextDecoder {
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_FIELDFACETS_H
+#define KLOGG_FIELDFACETS_H
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <QRegularExpression>
+#include <QString>
+
+#include <robin_hood.h>
+#include <roaring64map.hh>
+
+#include "atomicflag.h"
+#include "containers.h"
+#include "linetypes.h"
+
+class LogData;
+
+// Field of lines whose values are counted: a column $1, $2..., a field of
+// JSON and logfmt lines as in field searches, or the first capture group of
+// a regular expression (the whole match if it has no groups).
+class FacetField {
+  public:
+    // Empty if the text is not a valid regular expression
+    static std::optional<FacetField> parse( const QString& text );
+
+    const QString& text() const
+    {
+        return text_;
+    }
+
+    // Value of the field of the line, empty if the line doesn't have it.
+    // The value can be in the buffer.
+    std::optional<std::string_view> value( std::string_view line, std::string& buffer ) const;
+
+    // Number at the start of the value of the field of the line, units after it are ignored
+    std::optional<double> number( std::string_view line, std::string& buffer ) const;
+
+    // Field search for lines with the value, empty for regular expressions
+    QString searchPattern( const QString& value ) const;
+
+  private:
+    QString text_;
+    std::string key_;
+    // Column of the line for keys $1, $2..., 0 for named fields
+    size_t column_ = 0;
+    std::optional<QRegularExpression> regularExpression_;
+};
+
+// Most common values of a field of lines with their counts.
+struct FieldFacets {
+    static constexpr size_t MaxListedValues = 1000;
+
+    struct Value {
+        QString value;
+        uint64_t count = 0;
+        // The count is more than the actual one by up to this when values don't fit in memory
+        uint64_t error = 0;
+    };
+
+    // Most common first
+    klogg::vector<Value> values;
+    LinesCount countedLines = 0_lcount;
+    LinesCount linesWithField = 0_lcount;
+    bool isApproximate = false;
+
+    // Values of the field of the lines of the data, chunks of lines are counted
+    // in parallel until counting is interrupted.
+    static FieldFacets count( const LogData& logData, const FacetField& field,
+                              const roaring::Roaring64Map& lines,
+                              const AtomicFlag& interruptRequested );
+};
+
+// Distribution of numbers in buckets as HDR histograms have, buckets split
+// each power of two in SubBuckets, so percentiles are within 0.4% of the
+// actual numbers. Buckets are kept only for the numbers added. Numbers are
+// added by one thread, histograms of different threads are merged.
+class NumberHistogram {
+  public:
+    static constexpr int32_t SubBuckets = 128;
+
+    void add( double number );
+    void merge( const NumberHistogram& other );
+
+    uint64_t count() const
+    {
+        return count_;
+    }
+
+    double sum() const
+    {
+        return sum_;
+    }
+
+    double min() const
+    {
+        return count_ > 0 ? min_ : 0;
+    }
+
+    double max() const
+    {
+        return count_ > 0 ? max_ : 0;
+    }
+
+    double mean() const
+    {
+        return count_ > 0 ? sum_ / static_cast<double>( count_ ) : 0;
+    }
+
+    // Number not less than the fraction of numbers, e.g. 0.99 for the 99th percentile
+    double percentile( double fraction ) const;
+
+  private:
+    // Lower than the exponents of the smallest doubles
+    static constexpr int32_t MinExponent = -1100;
+
+    // Buckets are ordered as their numbers, 0 is the bucket of zeros
+    static int32_t bucketOf( double number );
+    static double numberOf( int32_t bucket );
+
+    robin_hood::unordered_flat_map<int32_t, uint64_t> buckets_;
+    uint64_t count_ = 0;
+    double sum_ = 0;
+    double min_ = std::numeric_limits<double>::max();
+    double max_ = std::numeric_limits<double>::lowest();
+};
+
+// Numbers in the values of a field of lines, e.g. durations or sizes.
+// Values starting with a number count, units after it are ignored.
+struct FieldStatistics {
+    NumberHistogram numbers;
+    LinesCount countedLines = 0_lcount;
+
+    // Numbers of the field of the lines of the data, chunks of lines are read
+    // in parallel until it is interrupted.
+    static FieldStatistics compute( const LogData& logData, const FacetField& field,
+                                    const roaring::Roaring64Map& lines,
+                                    const AtomicFlag& interruptRequested );
+};
+
+// Counts values in bounded memory as the Space-Saving algorithm does. Values
+// are counted exactly until there are MaxValues of them. Then the less common
+// half is evicted, and values added later start at the highest evicted count,
+// so counts are overestimated by at most it and common values are kept.
+// Values are added by one thread, counters of different threads are merged.
+class FacetCounter {
+  public:
+    static constexpr size_t MaxValues = 64 * 1024;
+
+    void add( std::string_view value );
+    void merge( FacetCounter&& other );
+
+    // Counts are exact if no value was evicted
+    bool isApproximate() const
+    {
+        return evictedCount_ > 0;
+    }
+
+    // Most common first, at most the number of values
+    klogg::vector<FieldFacets::Value> takeTop( size_t number );
+
+  private:
+    struct Count {
+        uint64_t count = 0;
+        uint64_t error = 0;
+    };
+
+    // Keeps the more common half of the values
+    void evict();
+
+    robin_hood::unordered_flat_map<std::string, Count> counts_;
+    // Highest count of evicted values
+    uint64_t evictedCount_ = 0;
+
+    std::string key_;
+};
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_FIELDINDEX_H
+#define KLOGG_FIELDINDEX_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <robin_hood.h>
+#include <roaring64map.hh>
+
+#include "containers.h"
+#include "fieldquery.h"
+#include "linetypes.h"
+#include "synchronization.h"
+
+// Lines each value of the fields of structured lines was found in.
+//
+// Lines are added in order from the first one, fields are found by
+// FieldQuery::forEachField. Only fields with few distinct values are kept,
+// queries on other fields are answered by scanning the lines. The index is
+// built for a generation of line positions of the file and is reset when
+// lines are added for another one. This class is thread-safe, lines are
+// added by one thread.
+class FieldIndex {
+  public:
+    static constexpr size_t MaxValuesPerField = 1024;
+    static constexpr size_t MaxValueLength = 256;
+    static constexpr size_t MaxFields = 4096;
+
+    // Where the next lines are added, taken before they are read
+    struct Position {
+        uint64_t epoch = 0;
+        LineNumber nextLine;
+    };
+
+    FieldIndex() = default;
+
+    FieldIndex( const FieldIndex& ) = delete;
+    FieldIndex& operator=( const FieldIndex& ) = delete;
+
+    // The index is reset if it was built for another generation of line positions
+    Position position( uint64_t linesGeneration );
+
+    // Lines are parsed in parallel. They are dropped if the index was cleared or
+    // other lines were added since the position was taken.
+    bool addLines( const Position& position, const klogg::vector<std::string_view>& lines );
+
+    // Lines must be added again, e.g. because they are decoded differently
+    void clear();
+
+    // Lines of the range matching all predicates of the query, empty if the lines
+    // are not indexed for this generation or some field of the query is not kept
+    std::optional<roaring::Roaring64Map> matchingLines( const FieldQuery& query,
+                                                        uint64_t linesGeneration, LineNumber first,
+                                                        LinesCount number ) const;
+
+    LinesCount indexedLines() const;
+
+    size_t allocatedSize() const;
+
+  private:
+    struct Field {
+        // Too many or too long values, lines of the field are not kept
+        bool isDropped = false;
+        robin_hood::unordered_node_map<std::string, roaring::Roaring64Map> values;
+    };
+
+    void reset();
+
+  private:
+    mutable Mutex mutex_;
+
+    uint64_t epoch_ = 0;
+    uint64_t linesGeneration_ = 0;
+    LineNumber nextLine_;
+
+    // Too many different fields, the index is not used
+    bool isOverflown_ = false;
+    robin_hood::unordered_node_map<std::string, Field> fields_;
+};
+
+#endif
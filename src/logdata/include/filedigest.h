@@ -23,7 +23,10 @@
 #include <memory>
 #include <QByteArray>
 
+#include "containers.h"
+
 class DigestInternalState;
+class QIODevice;
 
 class FileDigest {
   public:
@@ -38,8 +41,56 @@ class FileDigest {
 
     void reset();
 
+    // Raw state of the digest, only valid for the same build of klogg
+    QByteArray state() const;
+    bool restoreState( const QByteArray& state );
+
   private:
     std::unique_ptr<DigestInternalState> m_state;
 };
 
+// Digests of consecutive blocks of data, the last block may be incomplete.
+// Allows to check only some parts of a file instead of hashing all of it.
+class BlockDigests {
+  public:
+    static constexpr qint64 DefaultBlockSize = 1024 * 1024;
+
+    explicit BlockDigests( qint64 blockSize = DefaultBlockSize );
+
+    BlockDigests( const BlockDigests& other );
+    BlockDigests& operator=( const BlockDigests& other );
+
+    void addData( const char* data, size_t length );
+    void reset();
+
+    // Keep digests of the first complete blocks only
+    void truncate( size_t blocksCount );
+
+    qint64 blockSize() const
+    {
+        return blockSize_;
+    }
+
+    // Total size of hashed data
+    qint64 size() const
+    {
+        return size_;
+    }
+
+    // Number of blocks including the incomplete one
+    size_t blocksCount() const;
+
+    // Digest of data in [block * blockSize(), min( ( block + 1 ) * blockSize(), size() ))
+    uint64_t digest( size_t block ) const;
+
+  private:
+    qint64 blockSize_;
+    qint64 size_ = 0;
+    klogg::vector<uint64_t> completeBlocks_;
+    FileDigest currentBlock_;
+};
+
+// Whether size bytes of the file at offset have the expected digest
+bool hasSameDigest( QIODevice& file, qint64 offset, qint64 size, quint64 expectedDigest );
+
 #endif // KLOGG_FILEDIGEST_H
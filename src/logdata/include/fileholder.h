@@ -2,8 +2,12 @@
 #define FILEHOLDER_H
 
 #include <QFile>
+#include <algorithm>
 #include <memory>
+#include <string_view>
 
+#include "containers.h"
+#include "compressedaccess.h"
 #include "synchronization.h"
 
 struct FileId {
@@ -15,9 +19,251 @@ struct FileId {
         return fileIndex != other.fileIndex || volumeIndex != other.volumeIndex;
     }
 
+    bool operator==( const FileId& other ) const
+    {
+        return !( *this != other );
+    }
+
     static FileId getFileId( const QString& filename );
 };
 
+// Pipes, devices and files on network shares should not be mapped into memory
+bool canMapFile( const QFile& file );
+// File is on NFS, SMB or another network file system
+bool isOnNetworkShare( const QFile& file );
+// File is on a read-only file system or no one has write permission
+bool isFileReadOnly( const QFile& file );
+// Reading a mapped page past the end of a file truncated by another process
+// (logrotate copytruncate, "> file") raises SIGBUS, so files that can be written
+// are mapped only if perf.mapWritableFiles is set
+bool isMappingAllowed( const QFile& file );
+
+// Read-only mapping of the beginning of a file. It has its own handle of
+// the file, so it stays valid while referenced, even after the file is reopened
+// or mapped again when it grows.
+class FileMapping {
+  public:
+    // Map size bytes of the file, empty if it can't be mapped
+    static std::shared_ptr<const FileMapping> map( const QString& fileName, const FileId& fileId,
+                                                   qint64 size );
+
+    qint64 size() const
+    {
+        return size_;
+    }
+
+    // Mapped data, it must be inside the mapping
+    std::string_view data( qint64 offset, qint64 size ) const
+    {
+        return std::string_view( data_ + offset, static_cast<size_t>( size ) );
+    }
+
+    // Hint that the mapped data will be read soon
+    void willNeed( qint64 offset, qint64 size ) const;
+
+  private:
+    FileMapping() = default;
+
+    std::unique_ptr<QFile> file_;
+    const char* data_ = nullptr;
+    qint64 size_ = 0;
+};
+
+class FileReader;
+class NetworkFileCache;
+
+// Files the log was rotated from, still open by their handles. They are read
+// as if they were concatenated before the file currently having the log's name,
+// so the index of the rotated data stays valid.
+class FileChain {
+  public:
+    struct Segment {
+        std::shared_ptr<const FileReader> reader;
+        // Offset of the segment in the concatenated data
+        qint64 offset = 0;
+        qint64 size = 0;
+        // Last byte of the segment is a line feed that is not in the file
+        bool addsLineFeed = false;
+    };
+    using Segments = klogg::vector<Segment>;
+
+    // Chained files at the moment, the snapshot doesn't change when more files are chained
+    std::shared_ptr<const Segments> segments() const;
+
+    // Line feed can be added after the data of the file so that its last line
+    // is not joined with the first line of the next file
+    void append( std::shared_ptr<const FileReader> reader, qint64 size,
+                 bool addLineFeed = false );
+
+    // Read size bytes at the offset of the chained files followed by the current file,
+    // readFile reads the current file at its own offsets. Returns the number of bytes read or -1.
+    template <typename ReadFile>
+    static qint64 read( const Segments& segments, qint64 offset, char* data, qint64 size,
+                        ReadFile&& readFile );
+
+    static qint64 size( const Segments& segments );
+
+    // Current file is a compressed file read through its access
+    void setCompressedAccess( std::shared_ptr<CompressedAccess> compressedAccess );
+    std::shared_ptr<CompressedAccess> compressedAccess() const;
+
+  private:
+    mutable Mutex mutex_;
+    std::shared_ptr<const Segments> segments_ = std::make_shared<const Segments>();
+    std::shared_ptr<CompressedAccess> compressedAccess_;
+};
+
+// Positional reads of an opened file, any number of threads can read at once
+// without moving a shared file pointer. The file stays open while the reader
+// is referenced, even after the holder closes or reopens it.
+class FileReader {
+  public:
+    // Offsets start in the chained files if they are passed,
+    // the file is decompressed if its compressed access is passed,
+    // data of the file is read through the network cache if it is passed
+    explicit FileReader( std::shared_ptr<QFile> file,
+                         std::shared_ptr<const FileChain::Segments> chain = {},
+                         std::shared_ptr<const CompressedAccess> compressedAccess = {},
+                         std::shared_ptr<NetworkFileCache> networkCache = {} );
+
+    // Read up to size bytes at offset, returns the number of bytes read or -1
+    qint64 read( qint64 offset, char* data, qint64 size ) const;
+
+    // Hint that the data will be read soon
+    void willNeed( qint64 offset, qint64 size ) const;
+
+  private:
+    Q_DISABLE_COPY( FileReader )
+
+    // Reads of the file itself
+    qint64 readFile( qint64 offset, char* data, qint64 size ) const;
+    qint64 readFileData( qint64 offset, char* data, qint64 size ) const;
+    qint64 readFileHandle( qint64 offset, char* data, qint64 size ) const;
+    qint64 readCompressedFile( qint64 offset, char* data, qint64 size ) const;
+
+    std::shared_ptr<QFile> file_;
+    std::shared_ptr<const FileChain::Segments> chain_;
+    std::shared_ptr<const CompressedAccess> compressedAccess_;
+    std::shared_ptr<NetworkFileCache> networkCache_;
+
+    // Readers not used by any thread, they keep their position in the data
+    mutable Mutex compressedReadersMutex_;
+    mutable klogg::vector<std::unique_ptr<CompressedAccess::Reader>> compressedReaders_;
+
+#ifdef Q_OS_WIN
+    void* handle_ = nullptr;
+#else
+    int handle_ = -1;
+#endif
+
+    // Used when the native handle is not available
+    mutable Mutex fileMutex_;
+};
+
+template <typename ReadFile>
+qint64 FileChain::read( const Segments& segments, qint64 offset, char* data, qint64 size,
+                        ReadFile&& readFile )
+{
+    // Segment holding the offset is found by the offsets of the segments,
+    // so reads of many chained files don't depend on their number.
+    auto segment = std::upper_bound(
+        segments.begin(), segments.end(), offset,
+        []( qint64 position, const Segment& candidate ) { return position < candidate.offset; } );
+    if ( segment != segments.begin() ) {
+        --segment;
+    }
+
+    qint64 bytesRead = 0;
+    for ( ; segment != segments.end() && bytesRead < size; ++segment ) {
+        const auto segmentEnd = segment->offset + segment->size;
+        const auto fileEnd = segment->addsLineFeed ? segmentEnd - 1 : segmentEnd;
+        const auto position = offset + bytesRead;
+        if ( position >= segmentEnd ) {
+            continue;
+        }
+
+        if ( position < fileEnd ) {
+            const auto toRead = std::min( size - bytesRead, fileEnd - position );
+            const auto chunkRead
+                = segment->reader->read( position - segment->offset, data + bytesRead, toRead );
+            if ( chunkRead < toRead ) {
+                return chunkRead < 0 ? ( bytesRead > 0 ? bytesRead : -1 ) : bytesRead + chunkRead;
+            }
+            bytesRead += chunkRead;
+        }
+
+        if ( segment->addsLineFeed && bytesRead < size ) {
+            data[ bytesRead++ ] = '\n';
+        }
+    }
+
+    if ( bytesRead < size ) {
+        const auto chainedSize = FileChain::size( segments );
+        const auto chunkRead
+            = readFile( offset + bytesRead - chainedSize, data + bytesRead, size - bytesRead );
+        if ( chunkRead < 0 ) {
+            return bytesRead > 0 ? bytesRead : -1;
+        }
+        bytesRead += chunkRead;
+    }
+
+    return bytesRead;
+}
+
+// File having the log's name, preceded by the files of the chain.
+// Offsets are the ones of the concatenated data, as in the index.
+class ChainedFile : public QIODevice {
+  public:
+    ChainedFile() = default;
+    ChainedFile( const QString& fileName, const std::shared_ptr<const FileChain>& chain );
+    ~ChainedFile() override;
+
+    void setFile( const QString& fileName, const std::shared_ptr<const FileChain>& chain );
+    QString fileName() const
+    {
+        return file_->fileName();
+    }
+
+    // Chained files are taken when the file is opened
+    bool open( OpenMode mode ) override;
+    void close() override;
+
+    bool isSequential() const override;
+    qint64 size() const override;
+
+    // Size of the chained files, the current file starts after them
+    qint64 chainedSize() const
+    {
+        return chainedSize_;
+    }
+
+    // Only the file without chained files can be mapped, compressed files and files
+    // that mapping is not allowed for are not mapped
+    bool canMap() const;
+    uchar* map( qint64 offset, qint64 size );
+
+    // Positional reads of the opened file and its chain, which many threads can do
+    // at once, e.g. to have several reads in flight. Empty for compressed files,
+    // they are decompressed in order by this file.
+    std::shared_ptr<const FileReader> reader() const;
+
+  protected:
+    qint64 readData( char* data, qint64 maxSize ) override;
+    qint64 writeData( const char* data, qint64 maxSize ) override;
+
+  private:
+    Q_DISABLE_COPY( ChainedFile )
+
+    qint64 readFile( qint64 offset, char* data, qint64 size );
+
+    std::shared_ptr<QFile> file_ = std::make_shared<QFile>();
+    std::shared_ptr<const FileChain> chain_;
+    std::shared_ptr<const FileChain::Segments> segments_;
+    qint64 chainedSize_ = 0;
+    std::unique_ptr<CompressedAccess::Reader> compressedReader_;
+    qint64 decompressedSize_ = 0;
+};
+
 template <typename T> class ScopedFileHolder {
   public:
     explicit ScopedFileHolder( T* file )
@@ -33,9 +279,9 @@ template <typename T> class ScopedFileHolder {
         file_holder_->detachReader();
     }
 
-    QFile* getFile()
+    std::shared_ptr<const FileReader> getReader()
     {
-        return file_holder_->getFile();
+        return file_holder_->getReader();
     }
 
   private:
@@ -48,9 +294,11 @@ class FileHolder {
     friend class ScopedFileHolder<FileHolder>;
 
   public:
-    explicit FileHolder( bool keepClosed );
+    // Reads continue in the files of the chain, it can be shared with the indexing
+    FileHolder( bool keepClosed, std::shared_ptr<FileChain> chain );
     ~FileHolder();
     FileId getFileId();
+    // Size of the chained files and the opened file
     qint64 size();
 
     bool isOpen();
@@ -65,20 +313,35 @@ class FileHolder {
 
     void reOpenFile();
 
+    // Keeps the opened file in the chain, e.g. after it was rotated,
+    // and opens the file having the name now. False if the file is not open.
+    bool chainOpenedFile();
+
+    // Mapping of the opened file covering data up to the end offset, empty if
+    // the file is kept closed, can't be mapped or mapping it is not allowed.
+    std::shared_ptr<const FileMapping> getMapping( qint64 endOffset );
+
+    // Ask the system to start reading the data if the file is open
+    void adviseWillNeed( qint64 offset, qint64 size );
+
   private:
     Q_DISABLE_COPY( FileHolder )
 
-    QFile* getFile();
+    std::shared_ptr<const FileReader> getReader();
 
   private:
     RecursiveMutex file_mutex_;
 
     QString file_name_;
-    std::unique_ptr<QFile> attached_file_;
+    std::shared_ptr<QFile> attached_file_;
     FileId attached_file_id_;
+    std::shared_ptr<const FileReader> reader_;
+    std::shared_ptr<const FileMapping> mapping_;
+    std::shared_ptr<FileChain> chain_;
 
     uint32_t counter_ = 0;
     bool keep_closed_ = false;
+    bool can_map_ = false;
 };
 
 #endif // FILEHOLDER_H
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_FILTERSTATISTICS_H
+#define KLOGG_FILTERSTATISTICS_H
+
+#include <QString>
+
+#include "containers.h"
+#include "linetypes.h"
+#include "regularexpressionpattern.h"
+#include "atomicflag.h"
+
+class LogData;
+
+// Numbers of lines matching each of several patterns, e.g. predefined filters.
+//
+// All patterns are compiled in one multi-pattern expression, so the data is
+// read and scanned once whatever the number of patterns.
+struct FilterStatistics {
+    // Lines matching each pattern, in the order of the patterns
+    klogg::vector<LinesCount> matches;
+    LinesCount processedLines = 0_lcount;
+
+    bool isValid = false;
+    QString errorString;
+
+    // Statistics of the lines of the data when the scan is started,
+    // lines are counted until the scan is interrupted.
+    static FilterStatistics collect( const LogData& logData,
+                                     const klogg::vector<RegularExpressionPattern>& patterns,
+                                     const AtomicFlag& interruptRequested );
+};
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_FINDINFILES_H
+#define KLOGG_FINDINFILES_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include <QString>
+
+#include "containers.h"
+#include "linetypes.h"
+#include "regularexpression.h"
+
+// Search of many files without opening them as logs. Files are read once in
+// blocks and split into lines as they are read, no index is kept, so memory
+// doesn't grow with the size or the number of files. Files are searched in
+// parallel, each by one thread with its own matcher. Lines are matched in
+// the encoding detected from the beginning of the file.
+class FindInFiles {
+  public:
+    static constexpr size_t MaxFirstMatches = 10;
+    static constexpr int MaxMatchTextLength = 500;
+
+    struct Match {
+        LineNumber line;
+        // Offset of the beginning of the line in the file
+        qint64 offset = 0;
+        QString text;
+    };
+
+    struct FileMatches {
+        QString fileName;
+        uint64_t nbMatches = 0;
+        uint64_t nbLines = 0;
+        klogg::vector<Match> firstMatches;
+        // Not empty if the file can't be read
+        QString error;
+    };
+
+    using FileSearched = std::function<void( FileMatches matches )>;
+
+    explicit FindInFiles( const RegularExpressionPattern& pattern );
+
+    bool isValid() const;
+    QString errorString() const;
+
+    // Calls fileSearched from the searching threads once each file is searched,
+    // files not searched before the interrupt are not reported
+    void run( const klogg::vector<QString>& fileNames, const FileSearched& fileSearched,
+              const std::atomic<bool>& interruptRequested ) const;
+
+    FileMatches searchFile( const QString& fileName, const PatternMatcher& matcher,
+                            const std::atomic<bool>& interruptRequested ) const;
+
+  private:
+    RegularExpression expression_;
+};
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_FRAMEDACCESS_H
+#define KLOGG_FRAMEDACCESS_H
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include <QtGlobal>
+
+#include "compressedaccess.h"
+#include "containers.h"
+#include "synchronization.h"
+
+// Random access to compressed data made of independent frames whose sizes are
+// known without decompressing them, e.g. seekable zstd or BGZF.
+//
+// Only frames holding the read data are decompressed. Sequential reads,
+// e.g. by the indexing, decompress the next frames in parallel on the TBB pool,
+// so reading the file is not limited by one decompressing thread.
+// Recently used frames are kept decompressed.
+class FramedAccess : public CompressedAccess {
+  public:
+    // Find the frames of the file
+    bool build( const ReadCompressed& readCompressed, qint64 compressedSize ) override;
+    bool isBuilt() const override;
+    qint64 size() const override;
+
+    std::unique_ptr<CompressedAccess::Reader> makeReader(
+        ReadCompressed readCompressed ) const override;
+
+    class Reader : public CompressedAccess::Reader {
+      public:
+        Reader( std::shared_ptr<const FramedAccess> access, ReadCompressed readCompressed );
+
+        qint64 read( qint64 offset, char* data, qint64 size ) override;
+        qint64 position() const override;
+
+      private:
+        std::shared_ptr<const FramedAccess> access_;
+        ReadCompressed readCompressed_;
+        qint64 position_ = 0;
+    };
+
+  protected:
+    struct Frame {
+        qint64 compressedOffset = 0;
+        qint64 compressedSize = 0;
+        qint64 decompressedOffset = 0;
+        qint64 decompressedSize = 0;
+    };
+
+    // Compressed offsets and sizes and decompressed sizes of all frames,
+    // decompressed offsets are filled by the caller
+    virtual bool readFrames( const ReadCompressed& readCompressed, qint64 compressedSize,
+                             klogg::vector<Frame>& frames ) const = 0;
+
+    // Decompress the whole frame, called by many threads at once
+    virtual bool decompressFrame( const char* compressed, qint64 compressedSize, char* data,
+                                  qint64 size ) const = 0;
+
+    static bool readExactly( const ReadCompressed& readCompressed, qint64 offset, char* data,
+                             qint64 size );
+
+  private:
+    using FrameData = std::shared_ptr<const klogg::vector<char>>;
+
+    // Frame holding the decompressed offset
+    size_t frameIndex( qint64 offset ) const;
+
+    // Decompressed data of the frame, empty if it can't be decompressed.
+    // Following frames are decompressed along with it if reads are sequential.
+    FrameData frameData( size_t frame, const ReadCompressed& readCompressed,
+                         bool isSequential ) const;
+
+    FrameData cachedFrame( size_t frame ) const;
+    void cacheFrame( size_t frame, FrameData data ) const;
+
+  private:
+    Mutex buildMutex_;
+    std::atomic<bool> isBuilt_{ false };
+
+    // Written once before frames are found
+    qint64 size_ = 0;
+    klogg::vector<Frame> frames_;
+
+    // Recently used frames, the last one is the most recent
+    mutable Mutex cacheMutex_;
+    mutable klogg::vector<std::pair<size_t, FrameData>> cache_;
+    mutable qint64 cachedSize_ = 0;
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_GZIPACCESS_H
+#define KLOGG_GZIPACCESS_H
+
+#include <atomic>
+#include <memory>
+
+#include <QtGlobal>
+
+#include "compressedaccess.h"
+#include "containers.h"
+#include "synchronization.h"
+
+// Random access to the decompressed data of a gzip file.
+//
+// The file is decompressed once to save decompression state at access points
+// every few megabytes of data, as in zlib's zran example. Data at an offset
+// is then decompressed starting from the access point before it.
+// Several gzip members in one file are read one after another.
+class GzipAccess : public CompressedAccess {
+  public:
+    // Decompressed data between access points, each point keeps 32 KiB of data
+    static constexpr qint64 AccessPointSpan = 4 * 1024 * 1024;
+
+    // Decompress the file to find access points and the size of the data
+    bool build( const ReadCompressed& readCompressed, qint64 compressedSize ) override;
+    bool isBuilt() const override;
+    qint64 size() const override;
+
+    std::unique_ptr<CompressedAccess::Reader> makeReader(
+        ReadCompressed readCompressed ) const override;
+
+    // Decompresses the data of built access points. Reads following each other
+    // continue decompression without going back to an access point.
+    class Reader : public CompressedAccess::Reader {
+      public:
+        Reader( std::shared_ptr<const GzipAccess> access, ReadCompressed readCompressed );
+        ~Reader() override;
+
+        Reader( const Reader& ) = delete;
+        Reader& operator=( const Reader& ) = delete;
+
+        qint64 read( qint64 offset, char* data, qint64 size ) override;
+        qint64 position() const override;
+
+      private:
+        struct State;
+
+        bool start( qint64 offset );
+        qint64 inflateTo( char* data, qint64 size );
+
+        std::shared_ptr<const GzipAccess> access_;
+        ReadCompressed readCompressed_;
+        std::unique_ptr<State> state_;
+    };
+
+  private:
+    struct AccessPoint {
+        qint64 decompressedOffset = 0;
+        qint64 compressedOffset = 0;
+        // Bits of the byte before the compressed offset where the point starts
+        int bits = 0;
+        // Decompression starts with a gzip header instead of the window
+        bool isMemberStart = false;
+        klogg::vector<unsigned char> window;
+    };
+
+    // Last access point at or before the offset
+    const AccessPoint& accessPoint( qint64 offset ) const;
+
+  private:
+    Mutex buildMutex_;
+    std::atomic<bool> isBuilt_{ false };
+
+    // Written once before access points are built
+    qint64 size_ = 0;
+    klogg::vector<AccessPoint> points_;
+};
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_INDEXCACHE_H
+#define KLOGG_INDEXCACHE_H
+
+#include <QString>
+
+class IndexingData;
+
+// Index of large files is kept on disk between sessions.
+// Cached index is used only if file size, modification time and
+// header and tail digests show that the file was only appended to.
+
+// Replaces indexing data with cached index of the file.
+// Returns false if there is no valid cache entry.
+bool loadCachedIndex( const QString& fileName, IndexingData& indexingData );
+
+// Writes index of the file to the cache, small files are skipped.
+void saveIndexToCache( const QString& fileName, const IndexingData& indexingData );
+
+#endif
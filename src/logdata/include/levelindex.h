@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LEVELINDEX_H
+#define KLOGG_LEVELINDEX_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include <roaring64map.hh>
+
+#include "containers.h"
+#include "linetypes.h"
+#include "synchronization.h"
+
+// Levels of log lines, from the most severe one
+enum class LogLevel : uint8_t { Error, Warning, Info, Debug, Trace };
+
+// Lines of each log level.
+//
+// The level of a line is the first level word, e.g. "ERROR", "warn" or "Info",
+// found at the beginning of the line. Lines are added in order from the first
+// one, the index is built for a generation of line positions of the file and is
+// reset when lines are added for another one. This class is thread-safe, lines
+// are added by one thread.
+class LevelIndex {
+  public:
+    static constexpr size_t LevelsCount = 5;
+    static constexpr size_t DefaultSearchedBytes = 128;
+
+    // Where the next lines are added, taken before they are read
+    struct Position {
+        uint64_t epoch = 0;
+        LineNumber nextLine;
+    };
+
+    explicit LevelIndex( size_t searchedBytes = DefaultSearchedBytes );
+
+    LevelIndex( const LevelIndex& ) = delete;
+    LevelIndex& operator=( const LevelIndex& ) = delete;
+
+    // Level word found in the first searched bytes of the line.
+    // Words are made of ASCII letters, digits and underscores.
+    static std::optional<LogLevel> levelOf( std::string_view line, size_t searchedBytes );
+
+    // The index is reset if it was built for another generation of line positions
+    Position position( uint64_t linesGeneration );
+
+    // Lines are dropped if the index was cleared or
+    // other lines were added since the position was taken.
+    bool addLines( const Position& position, const klogg::vector<std::string_view>& lines );
+
+    // Lines must be added again, e.g. because they are decoded differently
+    void clear();
+
+    // Lines of the level and of the more severe ones, empty unless
+    // all the lines are indexed for this generation
+    std::optional<roaring::Roaring64Map> linesUpTo( LogLevel level, uint64_t linesGeneration,
+                                                    LinesCount nbLines ) const;
+
+    LinesCount indexedLines() const;
+
+    size_t allocatedSize() const;
+
+  private:
+    void reset();
+
+  private:
+    const size_t searchedBytes_;
+
+    mutable Mutex mutex_;
+
+    uint64_t epoch_ = 0;
+    uint64_t linesGeneration_ = 0;
+    LineNumber nextLine_;
+
+    std::array<roaring::Roaring64Map, LevelsCount> levelLines_;
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LINEHASHINDEX_H
+#define KLOGG_LINEHASHINDEX_H
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include <robin_hood.h>
+#include <roaring64map.hh>
+
+#include "containers.h"
+#include "linetypes.h"
+#include "synchronization.h"
+
+// Lines with the same content, found by a 64-bit hash of each line.
+//
+// Lines of each hash are linked in a cycle, so the lines identical to one
+// are found by following it, without reading the file. Lines are added in
+// order from the first one, the index is built for a generation of line
+// positions of the file and is reset when lines are added for another one.
+// This class is thread-safe, lines are added by one thread.
+class LineHashIndex {
+  public:
+    // Where the next lines are added, taken before they are read
+    struct Position {
+        uint64_t epoch = 0;
+        LineNumber nextLine;
+    };
+
+    LineHashIndex() = default;
+
+    LineHashIndex( const LineHashIndex& ) = delete;
+    LineHashIndex& operator=( const LineHashIndex& ) = delete;
+
+    static uint64_t hash( std::string_view line );
+
+    // The index is reset if it was built for another generation of line positions
+    Position position( uint64_t linesGeneration );
+
+    // Lines are hashed in parallel. They are dropped if the index was cleared or
+    // other lines were added since the position was taken.
+    bool addLines( const Position& position, const klogg::vector<std::string_view>& lines );
+
+    // Lines must be added again, e.g. because they are decoded differently
+    void clear();
+
+    // Lines with the same hash as the line, including it,
+    // empty if the line is not indexed for this generation
+    std::optional<roaring::Roaring64Map> identicalLines( LineNumber line,
+                                                         uint64_t linesGeneration ) const;
+
+    LinesCount indexedLines() const;
+
+    size_t allocatedSize() const;
+
+  private:
+    void reset();
+
+  private:
+    mutable Mutex mutex_;
+
+    uint64_t epoch_ = 0;
+    uint64_t linesGeneration_ = 0;
+
+    // Next line with the same hash for each indexed line,
+    // the last line of a hash links back to the first one
+    klogg::vector<uint64_t> nextIdenticalLines_;
+    // Last added line of each hash
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> lastLines_;
+};
+
+#endif
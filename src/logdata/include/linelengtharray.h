@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LINELENGTHARRAY_H
+#define KLOGG_LINELENGTHARRAY_H
+
+#include <cstdint>
+#include <optional>
+
+#include "blockpool.h"
+#include "containers.h"
+#include "linetypes.h"
+
+// Lengths of lines with tabs expanded, collected while one block is parsed.
+// Length of a line is not known if it can't be found without decoding the line.
+class FastLineLengthArray {
+  public:
+    void append( std::optional<LineLength> length )
+    {
+        lengths_.push_back( length ? length->get() : UnknownLength );
+    }
+
+    size_t size() const
+    {
+        return lengths_.size();
+    }
+
+    std::optional<LineLength> at( size_t i ) const
+    {
+        const auto length = lengths_.at( i );
+        return length != UnknownLength ? std::make_optional( LineLength( length ) ) : std::nullopt;
+    }
+
+    void append_list( const FastLineLengthArray& other )
+    {
+        lengths_.insert( lengths_.end(), other.lengths_.begin(), other.lengths_.end() );
+    }
+
+  private:
+    static constexpr LineLength::UnderlyingType UnknownLength = -1;
+
+    klogg::vector<LineLength::UnderlyingType> lengths_;
+};
+
+// Compressed storage of expanded line lengths, one for each indexed line.
+//
+// Lines are divided in blocks of LinesPerBlock lines, each block is a stream of
+// varints (7 bits per byte, high bit set if more bytes follow) in a block pool.
+// A value is the line length plus one, zero is stored for lines which length
+// is not known and for lengths too long to be encoded in MaxEncodedBytes bytes,
+// these are measured from file data instead.
+class LineLengthArray {
+  public:
+    LineLengthArray() = default;
+
+    LineLengthArray( const LineLengthArray& ) = delete;
+    LineLengthArray& operator=( const LineLengthArray& ) = delete;
+
+    LineLengthArray( LineLengthArray&& ) = default;
+    LineLengthArray& operator=( LineLengthArray&& ) = default;
+
+    void append( std::optional<LineLength> length );
+    void append_list( const FastLineLengthArray& lengths );
+
+    // Add lines which lengths are not known
+    void appendUnknown( LinesCount count );
+
+    LinesCount size() const
+    {
+        return LinesCount( nbLines_ );
+    }
+
+    size_t allocatedSize() const
+    {
+        return pool_.allocatedSize();
+    }
+
+    // Length of the line, empty if it is not known
+    std::optional<LineLength> at( LineNumber line ) const;
+
+    // Lengths of consecutive lines decoded in one pass,
+    // lengths of lines past the end are not known
+    FastLineLengthArray range( LineNumber first, LinesCount count ) const;
+
+    // Keep only the first newSize lines
+    void truncate( LinesCount newSize );
+
+  private:
+    static constexpr LinesCount::UnderlyingType LinesPerBlock = 256;
+    static constexpr size_t MaxEncodedBytes = 3;
+
+    void appendEncoded( uint32_t value );
+
+    BlockPool<uint8_t> pool_;
+    LinesCount::UnderlyingType nbLines_ = 0;
+    // Bytes used in the last block
+    size_t lastBlockSize_ = 0;
+};
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LINEPAGECACHE_H
+#define KLOGG_LINEPAGECACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#include <QString>
+
+#include "containers.h"
+#include "synchronization.h"
+
+// Recently used pages of decoded lines, limited by the memory taken by lines.
+// Page n holds PageLines lines starting at line n * PageLines.
+// This class is thread-safe.
+class LinePageCache {
+  public:
+    static constexpr uint64_t PageLines = 256;
+
+    using Page = std::shared_ptr<const klogg::vector<QString>>;
+
+    struct Stats {
+        uint64_t hits{};
+        uint64_t misses{};
+        size_t pages{};
+        size_t bytes{};
+    };
+
+    explicit LinePageCache( size_t maxBytes );
+
+    // Generation of cached pages to read lines of the passed index generation,
+    // pages of other index generations are dropped.
+    uint64_t startReading( uint64_t indexGeneration );
+
+    // Cached page or empty one, the most recently used pages are kept
+    Page get( uint64_t page );
+
+    // Whether the page is cached, it is not counted as read
+    bool contains( uint64_t page ) const;
+
+    // Add lines read since generation was returned by startReading,
+    // they are not added if pages were dropped since then.
+    void add( uint64_t page, Page lines, uint64_t generation );
+
+    // Drop all pages, e.g. when lines are decoded differently
+    void clear();
+
+    Stats stats() const;
+
+  private:
+    struct CachedPage {
+        uint64_t page;
+        Page lines;
+        size_t bytes;
+    };
+
+    void dropPages();
+
+    mutable Mutex mutex_;
+
+    size_t maxBytes_;
+    uint64_t indexGeneration_{};
+    // Changed each time pages are dropped
+    uint64_t generation_{};
+
+    // Most recently used pages first
+    std::list<CachedPage> pages_;
+    std::unordered_map<uint64_t, std::list<CachedPage>::iterator> pagesIndex_;
+    size_t bytes_{};
+
+    uint64_t hits_{};
+    uint64_t misses_{};
+};
+
+#endif
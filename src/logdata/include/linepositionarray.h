@@ -39,7 +39,12 @@
 #ifndef LINEPOSITIONARRAY_H
 #define LINEPOSITIONARRAY_H
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 #include "compressedlinestorage.h"
@@ -104,6 +109,14 @@ class SimpleLinePositionStorage {
         storage_.pop_back();
     }
 
+    // Keep only the first newSize elements of the storage
+    void truncate( LinesCount newSize )
+    {
+        if ( newSize < size() ) {
+            storage_.resize( newSize.get() );
+        }
+    }
+
     operator const klogg::vector<OffsetInFile>&() const
     {
         return storage_;
@@ -113,6 +126,238 @@ class SimpleLinePositionStorage {
     klogg::vector<OffsetInFile> storage_;
 };
 
+// Flat storage of positions that fit in 32 bits
+class ShortLinePositionStorage {
+  public:
+    static constexpr OffsetInFile::UnderlyingType MaxPosition
+        = std::numeric_limits<uint32_t>::max();
+
+    ShortLinePositionStorage() = default;
+
+    ShortLinePositionStorage( const ShortLinePositionStorage& ) = delete;
+    ShortLinePositionStorage& operator=( const ShortLinePositionStorage& ) = delete;
+
+    ShortLinePositionStorage( ShortLinePositionStorage&& ) = default;
+    ShortLinePositionStorage& operator=( ShortLinePositionStorage&& ) = default;
+
+    using Cache = void*;
+    // Append the passed end-of-line to the storage, it must not be greater than MaxPosition
+    void append( OffsetInFile pos )
+    {
+        storage_.push_back( static_cast<uint32_t>( pos.get() ) );
+    }
+
+    void push_back( OffsetInFile pos )
+    {
+        append( pos );
+    }
+
+    // Size of the array
+    LinesCount size() const
+    {
+        return LinesCount( static_cast<LinesCount::UnderlyingType>( storage_.size() ) );
+    }
+
+    size_t allocatedSize() const
+    {
+        return storage_.capacity() * sizeof( uint32_t );
+    }
+
+    // Element at index
+    OffsetInFile at( size_t i, Cache* = nullptr ) const
+    {
+        if ( i >= storage_.size() ) {
+            LOG_ERROR << "Line number not in storage: " << i << ", storage size is "
+                      << storage_.size();
+            throw std::runtime_error( "Line number not in storage" );
+        }
+
+        return OffsetInFile( static_cast<OffsetInFile::UnderlyingType>( storage_[ i ] ) );
+    }
+
+    OffsetInFile at( LineNumber i, Cache* = nullptr ) const
+    {
+        return at( static_cast<size_t>( i.get() ) );
+    }
+
+    void at_range( LineNumber first, LinesCount count, OffsetInFile* out, Cache* = nullptr ) const
+    {
+        const auto last = first.get() + count.get();
+        if ( last > storage_.size() ) {
+            LOG_ERROR << "Lines not in storage: " << first.get() << " to " << last
+                      << ", storage size is " << storage_.size();
+            throw std::runtime_error( "Line number not in storage" );
+        }
+
+        const auto begin = storage_.begin() + static_cast<std::ptrdiff_t>( first.get() );
+        std::transform( begin, begin + static_cast<std::ptrdiff_t>( count.get() ), out,
+                        []( uint32_t pos ) {
+                            return OffsetInFile( static_cast<OffsetInFile::UnderlyingType>( pos ) );
+                        } );
+    }
+
+    // Add one list to the other
+    void append_list( const klogg::vector<OffsetInFile>& positions )
+    {
+        storage_.reserve( storage_.size() + positions.size() );
+        for ( const auto pos : positions ) {
+            append( pos );
+        }
+    }
+
+    // Pop the last element of the storage
+    void pop_back()
+    {
+        storage_.pop_back();
+    }
+
+    // Keep only the first newSize elements of the storage
+    void truncate( LinesCount newSize )
+    {
+        if ( newSize < size() ) {
+            storage_.resize( static_cast<size_t>( newSize.get() ) );
+        }
+    }
+
+  private:
+    klogg::vector<uint32_t> storage_;
+};
+
+// Storage picked for each file when it is indexed. Flat 32 bit positions are
+// faster to access, compressed ones take less memory and are used by default.
+// Flat positions are compressed once a position doesn't fit in 32 bits.
+class AdaptiveLinePositionStorage {
+  public:
+    AdaptiveLinePositionStorage() = default;
+
+    explicit AdaptiveLinePositionStorage( bool useShortPositions )
+        : isShort_( useShortPositions )
+    {
+    }
+
+    // Positions in files smaller than 4 GiB fit in 32 bits,
+    // they are compressed if the file grows bigger.
+    static AdaptiveLinePositionStorage forFileSize( int64_t fileSize )
+    {
+        return AdaptiveLinePositionStorage( fileSize < ShortLinePositionStorage::MaxPosition );
+    }
+
+    AdaptiveLinePositionStorage( const AdaptiveLinePositionStorage& ) = delete;
+    AdaptiveLinePositionStorage& operator=( const AdaptiveLinePositionStorage& ) = delete;
+
+    AdaptiveLinePositionStorage( AdaptiveLinePositionStorage&& ) = default;
+    AdaptiveLinePositionStorage& operator=( AdaptiveLinePositionStorage&& ) = default;
+
+    using Cache = CompressedLinePositionStorage::Cache;
+
+    void append( OffsetInFile pos )
+    {
+        if ( isShort_ && pos.get() > ShortLinePositionStorage::MaxPosition ) {
+            compressPositions();
+        }
+
+        if ( isShort_ ) {
+            short_.append( pos );
+        }
+        else {
+            compressed_.append( pos );
+        }
+    }
+
+    void push_back( OffsetInFile pos )
+    {
+        append( pos );
+    }
+
+    LinesCount size() const
+    {
+        return isShort_ ? short_.size() : compressed_.size();
+    }
+
+    size_t allocatedSize() const
+    {
+        return isShort_ ? short_.allocatedSize() : compressed_.allocatedSize();
+    }
+
+    bool isShort() const
+    {
+        return isShort_;
+    }
+
+    OffsetInFile at( size_t i, Cache* lastPosition = nullptr ) const
+    {
+        return isShort_ ? short_.at( i ) : compressed_.at( i, lastPosition );
+    }
+
+    OffsetInFile at( LineNumber i, Cache* lastPosition = nullptr ) const
+    {
+        return isShort_ ? short_.at( i ) : compressed_.at( i, lastPosition );
+    }
+
+    void at_range( LineNumber first, LinesCount count, OffsetInFile* out,
+                   Cache* lastPosition = nullptr ) const
+    {
+        if ( isShort_ ) {
+            short_.at_range( first, count, out );
+        }
+        else {
+            compressed_.at_range( first, count, out, lastPosition );
+        }
+    }
+
+    void append_list( const klogg::vector<OffsetInFile>& positions )
+    {
+        if ( isShort_ && !positions.empty()
+             && positions.back().get() > ShortLinePositionStorage::MaxPosition ) {
+            compressPositions();
+        }
+
+        if ( isShort_ ) {
+            short_.append_list( positions );
+        }
+        else {
+            compressed_.append_list( positions );
+        }
+    }
+
+    void pop_back()
+    {
+        if ( isShort_ ) {
+            short_.pop_back();
+        }
+        else {
+            compressed_.pop_back();
+        }
+    }
+
+    void truncate( LinesCount newSize )
+    {
+        if ( isShort_ ) {
+            short_.truncate( newSize );
+        }
+        else {
+            compressed_.truncate( newSize );
+        }
+    }
+
+  private:
+    void compressPositions()
+    {
+        LOG_INFO << "Compressing " << short_.size() << " line positions";
+
+        for ( LinesCount::UnderlyingType i = 0; i < short_.size().get(); ++i ) {
+            compressed_.append( short_.at( LineNumber( i ) ) );
+        }
+
+        short_ = ShortLinePositionStorage();
+        isShort_ = false;
+    }
+
+    bool isShort_ = false;
+    ShortLinePositionStorage short_;
+    CompressedLinePositionStorage compressed_;
+};
+
 // This class is a list of end of lines position,
 // in addition to a list of uint64_t (positions within the files)
 // it can keep track of whether the final LF was added (for non-LF terminated
@@ -123,7 +368,15 @@ class LinePosition {
     template <typename>
     friend class LinePosition;
 
+    using Cache = typename Storage::Cache;
+
     LinePosition() = default;
+
+    explicit LinePosition( Storage&& storage )
+        : array( std::move( storage ) )
+    {
+    }
+
     LinePosition( const LinePosition& ) = delete;
     LinePosition& operator=( const LinePosition& ) = delete;
 
@@ -170,6 +423,13 @@ class LinePosition {
         return pos;
     }
 
+    // Extract count elements starting at first to out
+    void at_range( LineNumber first, LinesCount count, OffsetInFile* out,
+                   typename Storage::Cache* lastPosition = nullptr ) const
+    {
+        array.at_range( first, count, out, lastPosition );
+    }
+
     // Set the presence of a fake final LF
     // Must be used after 'append'-ing a fake LF at the end.
     void setFakeFinalLF( bool finalLF = true )
@@ -177,6 +437,25 @@ class LinePosition {
         fakeFinalLF_ = finalLF;
     }
 
+    bool hasFakeFinalLF() const
+    {
+        return fakeFinalLF_;
+    }
+
+    const Storage& storage() const
+    {
+        return array;
+    }
+
+    // Keep only the first newSize lines, the last one is always a real end of line
+    void truncate( LinesCount newSize )
+    {
+        if ( newSize < array.size() ) {
+            array.truncate( newSize );
+            fakeFinalLF_ = false;
+        }
+    }
+
     // Add another list to this one, removing any fake LF on this list.
     // Invariant: all pos in other must be greater than any pos in this
     // (this is NOT checked!)
@@ -201,6 +480,6 @@ class LinePosition {
 
 // Use the non-optimised storage
 using FastLinePositionArray = LinePosition<SimpleLinePositionStorage>;
-using LinePositionArray = LinePosition<CompressedLinePositionStorage>;
+using LinePositionArray = LinePosition<AdaptiveLinePositionStorage>;
 
 #endif
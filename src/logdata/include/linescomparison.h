@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LINESCOMPARISON_H
+#define KLOGG_LINESCOMPARISON_H
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include <roaring64map.hh>
+
+#include "atomicflag.h"
+
+class LogData;
+
+// Lines of two files compared by their content regardless of their order,
+// e.g. messages of today's startup log that were not in yesterday's one.
+struct LinesComparison {
+    // Lines of each file whose content is in none of the lines of the other file
+    roaring::Roaring64Map onlyInFirst;
+    roaring::Roaring64Map onlyInSecond;
+
+    // Hashes of the lines of both data are computed in parallel when the comparison
+    // is started, lines are then looked up in the set of hashes of the other data.
+    // With masked numbers, tokens of lines with digits, such as numbers, ids and
+    // times, are the same token as they are for log templates. Empty if the
+    // comparison is interrupted or some of the lines can't be read.
+    static std::optional<LinesComparison> compare( const LogData& first, const LogData& second,
+                                                   bool maskNumbers,
+                                                   const AtomicFlag& interruptRequested );
+
+    // Hash of the content of the line
+    static uint64_t lineHash( std::string_view line, bool maskNumbers );
+};
+
+#endif
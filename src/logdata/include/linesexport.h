@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LINESEXPORT_H
+#define KLOGG_LINESEXPORT_H
+
+#include <roaring64map.hh>
+
+#include "atomicflag.h"
+
+class LogData;
+class QIODevice;
+
+// What is written for each exported line
+enum class LinesExportFormat {
+    // Lines as they are in the file
+    Lines,
+    // Numbers of the lines from 1, one per line
+    LineNumbers,
+    // Offsets in the file where the lines start, one per line
+    ByteOffsets,
+    // Roaring bitmap of the line numbers from 0, in the portable format
+    Bitmap,
+};
+
+// Writes the lines to the output in chunks as they are read, so lines are never
+// all in memory. Consecutive and close lines of a chunk are read from the file at
+// once. Writes to sequential outputs, e.g. commands, wait for the output to take
+// the chunk. Returns false if writing fails or is interrupted.
+bool exportLines( const LogData& logData, const roaring::Roaring64Map& lines,
+                  LinesExportFormat format, QIODevice& output,
+                  const AtomicFlag& interruptRequested );
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LINESORTER_H
+#define KLOGG_LINESORTER_H
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+
+#include <QString>
+#include <QTemporaryFile>
+
+#include <roaring64map.hh>
+
+#include "atomicflag.h"
+#include "containers.h"
+#include "linetypes.h"
+
+class LogData;
+
+// What lines are sorted by: the number at the start of the value of a field,
+// as field statistics read it, or the timestamp of the line.
+struct SortKey {
+    enum class Kind { Field, Timestamp };
+
+    Kind kind = Kind::Field;
+    // Facet field text for fields, QDateTime format for timestamps
+    QString text;
+};
+
+// Sorts lines by keys in bounded memory. Keys and lines are kept in records
+// sorted by radix sort, when the records don't fit in memory they are sorted
+// in runs written to temporary files, and runs are merged. Records are added
+// by one thread, sorters of different threads are merged.
+class KeySorter {
+  public:
+    // Key of the lines that don't have one, they are last
+    static constexpr uint64_t MissingKey = std::numeric_limits<uint64_t>::max();
+
+    struct Record {
+        uint64_t key;
+        uint64_t line;
+    };
+
+    explicit KeySorter( size_t maxRecords );
+
+    // Keys are ordered as the numbers
+    static uint64_t keyOf( double number );
+
+    void add( uint64_t key, uint64_t line );
+
+    // False if a run could not be written
+    bool isValid() const
+    {
+        return isValid_;
+    }
+
+    size_t runs() const
+    {
+        return runs_.size();
+    }
+
+    // Calls recordSorted with the records of the sorters by key, records
+    // of the same key by line. Returns false if the sorters are not valid
+    // or merging is interrupted.
+    static bool merge( klogg::vector<KeySorter>& sorters, const AtomicFlag& interruptRequested,
+                       const std::function<void( const Record& )>& recordSorted );
+
+    // Stable LSD radix sort by key, first by line if byLines is set
+    static void radixSort( klogg::vector<Record>& records, bool byLines );
+
+  private:
+    void writeRun();
+
+    size_t maxRecords_;
+    klogg::vector<Record> records_;
+    klogg::vector<std::unique_ptr<QTemporaryFile>> runs_;
+    bool isValid_ = true;
+};
+
+// Order of lines sorted by a key, lines with the same key are in file order.
+struct LineOrder {
+    // Lines in sorted order
+    klogg::vector<uint64_t> lines;
+    // Position in the sorted order of each line, by rank of the line
+    klogg::vector<uint32_t> positions;
+    LinesCount linesWithKey = 0_lcount;
+
+    // Lines of the data sorted in the order of their keys or in the reverse
+    // order, lines without a key are last. Keys are read in parallel and sorted
+    // within the memory, empty if sorting is interrupted or fails.
+    static std::optional<LineOrder> sort( const LogData& logData, const SortKey& key,
+                                          const roaring::Roaring64Map& lines, bool isDescending,
+                                          uint64_t memoryBytes,
+                                          const AtomicFlag& interruptRequested );
+};
+
+#endif
@@ -306,24 +306,61 @@ class FilePosition {
 // Length of a tab stop
 constexpr int TabStop = 8;
 
+// Spaces untabify puts in place of the tab at tabPosition of the original line,
+// not counting the tab itself, when addedSpaces were added for previous tabs
+inline LineLength::UnderlyingType untabifiedTabSpaces( LineLength::UnderlyingType tabPosition,
+                                                       LineLength::UnderlyingType addedSpaces )
+{
+    // Tab stops are counted from the position of the tab in the expanded line
+    // plus the spaces added before it
+    const auto position = tabPosition + addedSpaces;
+    return TabStop - ( ( position + addedSpaces ) % TabStop ) - 1;
+}
+
 inline QString untabify( QString&& line, LineColumn initialPosition = 0_lcol )
 {
-    LineLength::UnderlyingType totalSpaces = 0;
-    line.replace( QChar::Null, QChar::Space );
-
-    LineLength::UnderlyingType position = 0;
-    position = type_safe::narrow_cast<LineLength::UnderlyingType>(
-        line.indexOf( QChar::Tabulation, position ) );
-    while ( position >= 0 ) {
-        const auto spaces
-            = TabStop - ( ( initialPosition.get() + position + totalSpaces ) % TabStop );
-        line.replace( position, 1, QString( spaces, QChar::Space ) );
-        totalSpaces += spaces - 1;
-        position = type_safe::narrow_cast<LineLength::UnderlyingType>(
-            line.indexOf( QChar::Tabulation, position ) );
+    constexpr ushort Tab = QChar::Tabulation;
+
+    const auto* begin = line.utf16();
+    const auto* end = begin + line.size();
+    const auto* firstTab = std::find( begin, end, Tab );
+    if ( firstTab == end ) {
+        line.replace( QChar::Null, QChar::Space );
+        return std::move( line );
+    }
+
+    const auto tabSpaces = [ begin, &initialPosition ]( const ushort* tab,
+                                                        LineLength::UnderlyingType addedSpaces ) {
+        const auto tabPosition = type_safe::narrow_cast<LineLength::UnderlyingType>(
+            initialPosition.get() + ( tab - begin ) );
+        return untabifiedTabSpaces( tabPosition, addedSpaces ) + 1;
+    };
+
+    // Size of the expanded line is found first, so it is written in one pass
+    LineLength::UnderlyingType addedSpaces = 0;
+    for ( const auto* tab = firstTab; tab != end; tab = std::find( tab + 1, end, Tab ) ) {
+        addedSpaces += tabSpaces( tab, addedSpaces ) - 1;
+    }
+
+    QString expandedLine( line.size() + addedSpaces, Qt::Uninitialized );
+    auto* const output = reinterpret_cast<ushort*>( expandedLine.data() );
+
+    auto* written = output;
+    const auto* copied = begin;
+    addedSpaces = 0;
+    for ( const auto* tab = firstTab; tab != end; tab = std::find( tab + 1, end, Tab ) ) {
+        written = std::copy( copied, tab, written );
+
+        const auto spaces = tabSpaces( tab, addedSpaces );
+        written = std::fill_n( written, spaces, ushort{ QChar::Space } );
+        addedSpaces += spaces - 1;
+
+        copied = tab + 1;
     }
+    written = std::copy( copied, end, written );
 
-    return std::move( line );
+    std::replace( output, written, ushort{ QChar::Null }, ushort{ QChar::Space } );
+    return expandedLine;
 }
 
 template <typename LineType>
@@ -32,7 +32,9 @@ enum class LoadingStatus {
 enum class MonitoredFileStatus { 
 	Unchanged, 
 	DataAdded, 
-	Truncated 
+	Truncated,
+	// Data after the beginning of the file has been rewritten
+	Modified
 };
 
 // Data status (whether new, not seen, data is available)
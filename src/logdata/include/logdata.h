@@ -39,24 +39,41 @@
 #ifndef LOGDATA_H
 #define LOGDATA_H
 
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
 
 #include <QDateTime>
 #include <QFile>
 #include <QObject>
 #include <QString>
 #include <QTextCodec>
+#include <QThreadPool>
+#include <QTimer>
 #include <qregularexpression.h>
 #include <qtextcodec.h>
 #include <string_view>
 #include <vector>
 
 #include "abstractlogdata.h"
+#include "atomicflag.h"
+#include "fieldindex.h"
 #include "fileholder.h"
 #include "filewatcher.h"
+#include "levelindex.h"
+#include "linehashindex.h"
+#include "linepagecache.h"
 #include "loadingstatus.h"
 #include "logdataoperation.h"
 #include "logdataworker.h"
+#include "operationprogress.h"
+#include "searchresultscache.h"
+#include "taskscheduler.h"
+#include "timestampindex.h"
 
 class LogFilteredData;
 
@@ -85,6 +102,9 @@ class LogData : public AbstractLogData {
     // to be empty.
     // Reattaching is forbidden and will throw.
     void attachFile( const QString& fileName );
+    // Attaches to several files read as one log, in the passed order.
+    // Only the last file is followed, the others are expected not to change.
+    void attachFiles( const klogg::vector<QString>& fileNames );
     // Interrupt the loading and report a null file.
     // Does nothing if no loading in progress.
     void interruptLoading();
@@ -93,36 +113,208 @@ class LogData : public AbstractLogData {
     std::unique_ptr<LogFilteredData> getNewFilteredData() const;
     // Returns the size if the file in bytes
     qint64 getFileSize() const;
+    // Size of the data on disk, more than the indexed size while the file is indexed.
+    // Indexed size for compressed files.
+    qint64 getFileSizeOnDisk() const;
+    // Lines the file is expected to have while it is indexed, from the average
+    // size of the indexed lines. Indexed lines if the file is already indexed.
+    LinesCount getEstimatedNbLine() const;
+
+    // Line at the offset in the file, empty if the file is not indexed up to it.
+    OptionalLineNumber getLineAtOffset( qint64 offset ) const;
+
+    // Lines read around an offset in the file without the line index, so they can be
+    // shown before the file is indexed up to them. Number of the first line is
+    // estimated from the average size of the indexed lines.
+    struct LinesAtOffset {
+        qint64 firstLineOffset = 0;
+        // Line of the offset among the read ones
+        size_t offsetLine = 0;
+        LineNumber estimatedFirstLine;
+        klogg::vector<QString> lines;
+    };
+    LinesAtOffset getLinesAtOffset( qint64 offset, LinesCount number ) const;
     // Returns the last modification date for the file.
     // Null if the file is not on disk.
     QDateTime getLastModifiedDate() const;
-    // Throw away all the file data and reload/reindex.
+    // Throw away all the file data and reload/reindex,
+    // current data is still available until the new index is complete.
     void reload( QTextCodec* forcedEncoding = nullptr );
 
     // Get the auto-detected encoding for the indexed text.
     QTextCodec* getDetectedEncoding() const;
 
+    // Whether a file is attached, the log can be shared by views of the file
+    bool isAttached() const;
+    // Status of the last finished loading, empty until the first one is finished.
+    // Views added to a shared log use it instead of waiting for loadingFinished.
+    std::optional<LoadingStatus> lastLoadingStatus() const;
+
     void setPrefilter(const QString& prefilterPattern);
 
+    // Indexed part of the file and settings that change lines seen by searches
+    SearchedContent getSearchedContent() const;
+
+    // False only if none of the lines can contain the UTF-8 text with the whole tokens,
+    // it is known only for indexed data of lines seen as they are in the file.
+    bool mayContainText( LineNumber first, LinesCount number, std::string_view text,
+                         const klogg::vector<std::string>& tokens ) const;
+
+    // Lines of the range matching all predicates of the field query, empty if the
+    // fields of these lines are not indexed yet. Lines are the ones seen by searches.
+    std::optional<roaring::Roaring64Map> getFieldMatches( const FieldQuery& query,
+                                                          LineNumber first,
+                                                          LinesCount number ) const;
+
+    // Lines with the same content as the line, empty if the line is not hashed yet.
+    // Lines are the ones seen by searches.
+    std::optional<roaring::Roaring64Map> getIdenticalLines( LineNumber line ) const;
+
+    // Lines of the level and of the more severe ones, empty if not all the lines
+    // are indexed by level yet. Lines are the ones seen by searches.
+    std::optional<roaring::Roaring64Map> getLevelLines( LogLevel level ) const;
+
+    // Calls lineRead with the number and the UTF-8 view of each of the lines. Chunks of
+    // lines are read in parallel until reading is interrupted, lines of a chunk are passed
+    // by the thread reading it. Returns the number of read lines.
+    using LineRead = std::function<void( LineNumber, std::string_view )>;
+    LinesCount readLinesInParallel( const roaring::Roaring64Map& lines,
+                                    const AtomicFlag& interruptRequested,
+                                    const LineRead& lineRead ) const;
+
+    // Lengths of lines found during indexing, with tabs expanded,
+    // empty if they are not the lengths of lines as they are displayed.
+    FastLineLengthArray getIndexedLineLengths( LineNumber first, LinesCount number ) const;
+
+    // First line with a timestamp, in the configured format, not earlier than the time.
+    // The number of lines if all timestamps are earlier or none is found.
+    LineNumber getLineAtTime( const QDateTime& time ) const;
+
+    // Remove ANSI color sequences from lines, faster than an equivalent prefilter
+    void setHideAnsiColorSequences( bool hide );
+
+    // Bytes of the ascending lines as they are in the file, with their ends of line.
+    // Empty if lines are changed when they are read or can't be read.
+    std::optional<QByteArray> readLinesBytes( const klogg::vector<LineNumber>& lines ) const;
+
+    // Offsets in the file where the ascending lines start,
+    // empty if some of the lines are not indexed.
+    std::optional<klogg::vector<qint64>>
+    getLinesOffsets( const klogg::vector<LineNumber>& lines ) const;
+
+    // Read and cache the pages of the lines in the background, e.g. matches a view
+    // is about to show. Pages are read in the order of the lines, a later call
+    // replaces the pages not read yet.
+    void prefetchLines( const klogg::vector<LineNumber>& lines ) const;
+
     struct RawLines {
         LineNumber startLine;
 
         klogg::vector<char> buffer;
+        // Lines data in the mapped file, used instead of the buffer
+        std::shared_ptr<const FileMapping> mapping;
+        std::string_view mappedData;
         klogg::vector<qint64> endOfLines;
 
         TextDecoder textDecoder;
 
         QRegularExpression prefilterPattern;
+        // Color sequences are removed before decoding
+        bool hideAnsiColorSequences = false;
 
       public:
         klogg::vector<QString> decodeLines() const;
-        klogg::vector<std::string_view> buildUtf8View() const;
+        // Views are valid until the lines are built again or cleared
+        const klogg::vector<std::string_view>& buildUtf8View() const;
+        // Lines data in UTF-16 as it is in the file, empty if lines are in other
+        // encoding or have to be changed before matching
+        std::string_view utf16Data() const;
+
+        // Drop the lines, memory is kept to read other lines
+        void clear();
 
       private:
+        friend class LogData;
+
+        std::string_view data() const;
+
+        klogg::vector<OffsetInFile> lineEndsInFile_;
+
         mutable klogg::vector<char> utf8Data_;
+        mutable klogg::vector<char> strippedData_;
+        mutable klogg::vector<std::string_view> utf8Lines_;
+    };
+
+    // Cursor of a caller reading consecutive ranges of lines
+    // speeds up finding where they start.
+    RawLines getLinesRaw( LineNumber first, LinesCount number,
+                          LineCursor* cursor = nullptr ) const;
+
+    // Read lines reusing memory of previously read ones
+    void getLinesRaw( LineNumber first, LinesCount number, RawLines& rawLines,
+                      LineCursor* cursor = nullptr ) const;
+
+    // Lines read once for several searches, their UTF-8 view is built once
+    // and can be used by any thread.
+    class SharedRawLines {
+      public:
+        explicit SharedRawLines( RawLines lines );
+
+        const RawLines& rawLines() const
+        {
+            return lines_;
+        }
+
+        const klogg::vector<std::string_view>& utf8View() const;
+
+      private:
+        RawLines lines_;
+
+        mutable std::once_flag utf8ViewBuilt_;
+        mutable const klogg::vector<std::string_view>* utf8View_ = nullptr;
     };
 
-    RawLines getLinesRaw( LineNumber first, LinesCount number ) const;
+    // While several searches run, chunks of lines read by one of them are kept
+    // for the others, so the file is read and decoded once for all of them.
+    void beginSearch() const;
+    void endSearch() const;
+
+    // Lines shared with other running searches, empty if no other search runs
+    std::shared_ptr<const SharedRawLines> getSharedLinesRaw( LineNumber first, LinesCount number,
+                                                             LineCursor* cursor = nullptr ) const;
+
+    // Most lines from the first one that end within the bytes of the file after
+    // its beginning, but at least minLines and at most maxLines of the indexed lines.
+    LinesCount getLinesInBytes( LineNumber first, qint64 bytes, LinesCount minLines,
+                                LinesCount maxLines ) const;
+
+    // Reads the UTF-8 bytes of a line without its line feed in parts of at most partBytes,
+    // passed to the function until it returns false. Returns false if the bytes in the
+    // file are not the searched ones, e.g. in other encodings or with a prefilter.
+    bool readLineParts( LineNumber line, qint64 partBytes,
+                        const std::function<bool( std::string_view )>& consume ) const;
+
+    // Bytes of the chunks searches read, 0 until a search has measured them.
+    // Searches of the file share them, so searches running at once
+    // split the file in the same chunks and share the lines they read.
+    qint64 searchChunkBytes() const
+    {
+        return searchChunkBytes_.load( std::memory_order_relaxed );
+    }
+    void setSearchChunkBytes( qint64 bytes ) const
+    {
+        searchChunkBytes_.store( bytes, std::memory_order_relaxed );
+    }
+
+    // Priority of indexing and searches of this log against other opened logs,
+    // running operations keep the priority they started with.
+    // Caches of a foreground log are dropped last when memory is short.
+    // A log loaded in the background is watched for changes once in the foreground.
+    void setTaskPriority( TaskPriority priority );
+    TaskPriority taskPriority() const;
+
+    // NUMA node of the task scheduler indexing and searches of this log run on
+    int numaNode() const;
 
   Q_SIGNALS:
     // Sent during the 'attach' process to signal progress
@@ -130,17 +322,28 @@ class LogData : public AbstractLogData {
     void loadingProgressed( int percent );
     // Signal the client the file is fully loaded and available.
     void loadingFinished( LoadingStatus status );
+    // Sent when the end of the file is available while
+    // the beginning is still loading.
+    void loadingPreviewReady();
     // Sent when the file on disk has changed, will be followed
     // by loadingProgressed if needed and then a loadingFinished.
     void fileChanged( MonitoredFileStatus status );
+    // Sent when the file on disk has been modified after the beginning,
+    // lines from the passed one are dropped and loaded again.
+    void fileModified( LineNumber firstModifiedLine );
 
   private Q_SLOTS:
     // Consider reloading the file when it changes on disk updated
     void fileChangedOnDisk( const QString& filename );
+    // Called when the worker thread starts indexing, progress is polled until it ends
+    void indexingProgressed( int percent );
+    void pollIndexingProgress();
     // Called when the worker thread signals the current operation ended
     void indexingFinished( LoadingStatus status );
     // Called when the worker thread signals the current operation ended
     void checkFileChangesFinished( MonitoredFileStatus status );
+    // Called when the worker thread drops index of modified lines
+    void indexTruncated( LinesCount keptLines );
 
   private:
     // Implementation of virtual functions
@@ -148,6 +351,11 @@ class LogData : public AbstractLogData {
     QString doGetExpandedLineString( LineNumber line ) const override;
     klogg::vector<QString> doGetLines( LineNumber first, LinesCount number ) const override;
     klogg::vector<QString> doGetExpandedLines( LineNumber first, LinesCount number ) const override;
+    QString doGetExpandedLineWindow( LineNumber line, LineColumn firstColumn,
+                                     LineLength length ) const override;
+    qint64 doGetLineSize( LineNumber line ) const override;
+    std::optional<QByteArray> doGetLinesBytes( LineNumber first,
+                                               LinesCount number ) const override;
     LineNumber doGetLineNumber( LineNumber index ) const override;
     LinesCount doGetNbLine() const override;
     LineLength doGetMaxLength() const override;
@@ -162,12 +370,45 @@ class LogData : public AbstractLogData {
     klogg::vector<QString> getLinesFromFile( LineNumber first, LinesCount number,
                                            QString ( *processLine )( QString&& ) ) const;
 
+    // Decoded lines, taken from cached pages for small ranges
+    klogg::vector<QString> getDecodedLines( LineNumber first, LinesCount number ) const;
+
+    // Drop lines shared by searches, e.g. when lines are decoded differently
+    void dropSharedChunks() const;
+    // Bytes of the raw lines shared by searches
+    uint64_t sharedChunksSize() const;
+
+    // Read and cache a page of lines, empty if it can't be read
+    LinePageCache::Page readLinePage( uint64_t page, uint64_t generation ) const;
+
+    // Start reading pages next to the read lines in the background
+    // if lines are read one range after another in the same direction.
+    void readAheadIfSequential( uint64_t firstLine, uint64_t endLine, LinesCount nbLines ) const;
+    void readAhead( uint64_t firstPage, uint64_t endPage, bool isBackward ) const;
+    // Read the pages passed to prefetchLines until none are left
+    void prefetchPages() const;
+
+    // Index fields and hashes of lines not indexed yet in the background, if enabled
+    void startIndexingFields();
+    template <typename Index>
+    void indexLines( Index& index, const char* name );
+
   private:
     mutable std::unique_ptr<FileHolder> attached_file_;
+    // Files read before the attached one, shared by reads and indexing
+    std::shared_ptr<FileChain> fileChain_ = std::make_shared<FileChain>();
 
     // Indexing data, read by us, written by the worker thread
     std::shared_ptr<IndexingData> indexing_data_;
 
+    std::atomic<TaskPriority> taskPriority_{ TaskPriority::Foreground };
+    const int numaNode_;
+
+    // Written by the worker thread, outlives it
+    OperationProgress indexingProgress_;
+    QTimer indexingProgressTimer_;
+    uint64_t indexingProgressGeneration_ = 0;
+
     OperationQueue operationQueue_;
 
     QString indexingFileName_;
@@ -175,14 +416,69 @@ class LogData : public AbstractLogData {
     // mutable FileId attached_file_id_;
 
     bool keepFileClosed_;
+    bool useMappedFileReading_;
 
     QDateTime lastModifiedDate_;
+    std::optional<LoadingStatus> lastLoadingStatus_;
+
+    // Registration in the file watcher waits until the log is in the foreground
+    bool isFileWatched_ = false;
+    bool isWatchDeferred_ = false;
 
     // Codec to decode text
     TextCodecHolder codec_;
     MonitoredFileStatus fileChangedOnDisk_;
 
     QString prefilterPattern_;
+    bool hideAnsiColorSequences_ = false;
+
+    // Recently read lines, decoded with the current codec
+    mutable LinePageCache linePageCache_;
+
+    // Times of the decoded lines
+    mutable TimestampIndex timestampIndex_;
+
+    struct ReadPattern {
+        uint64_t firstLine = 0;
+        uint64_t endLine = 0;
+        int direction = 0;
+        int sequentialReads = 0;
+    };
+
+    mutable Mutex readPatternMutex_;
+    mutable ReadPattern lastRead_;
+
+    mutable std::atomic<bool> isReadingAhead_{ false };
+    mutable QThreadPool readAheadPool_;
+
+    // Pages to prefetch, read by the pool after the pages read ahead
+    mutable Mutex prefetchMutex_;
+    mutable klogg::vector<uint64_t> prefetchPages_;
+    mutable bool isPrefetching_ = false;
+
+    // Fields, hashes and levels of indexed lines,
+    // added in the background once indexing finishes
+    FieldIndex fieldIndex_;
+    std::atomic<bool> isIndexingFields_{ false };
+    LineHashIndex lineHashIndex_;
+    std::atomic<bool> isHashingLines_{ false };
+    LevelIndex levelIndex_;
+    std::atomic<bool> isIndexingLevels_{ false };
+    std::atomic<bool> stopIndexingFields_{ false };
+    QThreadPool fieldIndexPool_;
+
+    struct SharedChunk {
+        LineNumber firstLine;
+        LinesCount linesCount;
+        std::shared_future<std::shared_ptr<const SharedRawLines>> lines;
+    };
+
+    mutable std::atomic<int> runningSearches_{ 0 };
+    mutable std::atomic<qint64> searchChunkBytes_{ 0 };
+    mutable Mutex sharedChunksMutex_;
+    // Index generation the chunks were read with, oldest chunks first
+    mutable uint64_t sharedChunksGeneration_ = 0;
+    mutable std::deque<SharedChunk> sharedChunks_;
 };
 
 #endif
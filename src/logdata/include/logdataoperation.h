@@ -76,20 +76,27 @@ class LogDataOperation {
 // Attaching a new file (change name + full index)
 class AttachOperation : public LogDataOperation {
   public:
-    explicit AttachOperation( const QString& fileName )
+    AttachOperation( const QString& fileName, const std::shared_ptr<const FileChain>& fileChain )
         : LogDataOperation( fileName )
+        , fileChain_( fileChain )
     {
     }
 
   protected:
     void doStart( LogDataWorker& workerThread ) const override;
+
+  private:
+    std::shared_ptr<const FileChain> fileChain_;
 };
 
-// Reindexing the current file
+// Reindexing the current file, current index can be
+// kept until the new one is complete
 class FullReindexOperation : public LogDataOperation {
   public:
-    explicit FullReindexOperation( QTextCodec* forcedEncoding = nullptr )
+    explicit FullReindexOperation( QTextCodec* forcedEncoding = nullptr,
+                                   bool keepCurrentIndex = false )
         : forcedEncoding_( forcedEncoding )
+        , keepCurrentIndex_( keepCurrentIndex )
     {
     }
 
@@ -98,6 +105,7 @@ class FullReindexOperation : public LogDataOperation {
 
   private:
     QTextCodec* forcedEncoding_;
+    bool keepCurrentIndex_;
 };
 
 // Indexing part of the current file (from fileSize)
@@ -106,12 +114,25 @@ class PartialReindexOperation : public LogDataOperation {
     void doStart( LogDataWorker& workerThread ) const override;
 };
 
+// Indexing the current file again from the first modified block
+class DifferentialReindexOperation : public LogDataOperation {
+  protected:
+    void doStart( LogDataWorker& workerThread ) const override;
+};
+
 // Attaching a new file (change name + full index)
 class CheckDataChangesOperation : public LogDataOperation {
   protected:
     void doStart( LogDataWorker& workerThread ) const override;
 };
 
+// Indexing data appended to the followed file, the file is checked
+// instead if it changed otherwise
+class FollowAppendOperation : public LogDataOperation {
+  protected:
+    void doStart( LogDataWorker& workerThread ) const override;
+};
+
 class OperationQueue {
   public:
     explicit OperationQueue( std::function<void()> beforeOperationStart );
@@ -131,7 +152,8 @@ class OperationQueue {
 
   private:
     using OperationVariant = std::variant<std::monostate, AttachOperation, FullReindexOperation,
-                                           PartialReindexOperation, CheckDataChangesOperation>;
+                                           PartialReindexOperation, CheckDataChangesOperation,
+                                           DifferentialReindexOperation, FollowAppendOperation>;
 
     void enqueueOperation( OperationVariant&& operation );
     void tryStartPendingOperation();
@@ -40,7 +40,11 @@
 #define LOGDATAWORKERTHREAD_H
 
 #include "containers.h"
+#include <atomic>
+#include <memory>
+#include <optional>
 #include <qthreadpool.h>
+#include <string_view>
 #include <variant>
 
 #include <QObject>
@@ -48,6 +52,7 @@
 #include <QTextCodec>
 
 #if !defined(Q_MOC_RUN)
+#include <tbb/concurrent_queue.h>
 #include <tbb/enumerable_thread_specific.h>
 #include <tbb/flow_graph.h>
 #include <tbb/task_group.h>
@@ -58,8 +63,16 @@
 #include "synchronization.h"
 
 #include "encodingdetector.h"
+#include "fileholder.h"
+#include "linelengtharray.h"
 #include "linepositionarray.h"
 #include "loadingstatus.h"
+#include "operationprogress.h"
+#include "prefetchdepth.h"
+#include "sparselinepositionarray.h"
+#include "taskscheduler.h"
+#include "tokenfilters.h"
+#include "trigramindex.h"
 
 struct IndexedHash {
     qint64 size = 0;
@@ -73,6 +86,28 @@ struct IndexedHash {
     quint64 tailDigest = 0;
 };
 
+// Parser state at the end of indexed data, indexing continues from it
+struct IndexingCheckpoint {
+    // Beginning of the line not terminated in indexed data
+    OffsetInFile::UnderlyingType lineStart{};
+    LineLength::UnderlyingType additionalSpaces{};
+    // Indexing was interrupted before reaching the end of file
+    bool isInterrupted{};
+};
+
+class IndexingData;
+
+// Position of the last line end read with it, reading the following lines
+// continues decoding from there. Each reader of nearby lines keeps its own,
+// it is reset when the index is changed.
+class LineCursor {
+  private:
+    friend class IndexingData;
+
+    LinePositionArray::Cache lastPosition_;
+    uint64_t generation_{};
+};
+
 template <typename Data, typename LockGuard>
 class IndexingDataAccessor {
   public:
@@ -108,9 +143,44 @@ class IndexingDataAccessor {
 
     // Get the position (in byte from the beginning of the file)
     // of the end of the passed line.
-    OffsetInFile getEndOfLineOffset( LineNumber line ) const
+    OffsetInFile getEndOfLineOffset( LineNumber line, LineCursor* cursor = nullptr ) const
+    {
+        return data_->getEndOfLineOffset( line, cursor );
+    }
+
+    // Get the positions of the ends of count lines starting at first line,
+    // all of them must be indexed.
+    void getEndOfLineOffsets( LineNumber first, LinesCount count, OffsetInFile* out,
+                              LineCursor* cursor = nullptr ) const
+    {
+        data_->getEndOfLineOffsets( first, count, out, cursor );
+    }
+
+    // Get the length of the passed line with tabs expanded,
+    // empty if it was not found during indexing.
+    std::optional<LineLength> getLineLength( LineNumber line ) const
+    {
+        return data_->getLineLength( line );
+    }
+
+    // Get the lengths of consecutive lines found during indexing
+    FastLineLengthArray getLineLengths( LineNumber first, LinesCount count ) const
+    {
+        return data_->getLineLengths( first, count );
+    }
+
+    // Get the position of the beginning of the first indexed line,
+    // it is not 0 while only the tail of the file is indexed.
+    OffsetInFile getFirstLineOffset() const
     {
-        return data_->getEndOfLineOffset( line );
+        return data_->getFirstLineOffset();
+    }
+
+    // Changed when already indexed lines may be different,
+    // it stays the same when lines are only added.
+    uint64_t getLinePositionGeneration() const
+    {
+        return data_->getLinePositionGeneration();
     }
 
     // Get the guessed encoding for the content.
@@ -134,10 +204,11 @@ class IndexingDataAccessor {
 
     // Atomically add to all the existing
     // indexing data.
-    void addAll( const klogg::vector<char>& block, LineLength length,
-                 const FastLinePositionArray& linePosition, QTextCodec* encoding )
+    void addAll( std::string_view block, LineLength length,
+                 const FastLinePositionArray& linePosition,
+                 const FastLineLengthArray& lineLengths, QTextCodec* encoding )
     {
-        data_->addAll( block, length, linePosition, encoding );
+        data_->addAll( block, length, linePosition, lineLengths, encoding );
     }
 
     void setHeaderHash( quint64 digest, qint64 size )
@@ -174,6 +245,139 @@ class IndexingDataAccessor {
         return data_->allocatedSize();
     }
 
+    // State needed to persist the index and continue it later.
+    bool hasFakeFinalLF() const
+    {
+        return data_->hasFakeFinalLF();
+    }
+
+    bool isFastModificationDetectionUsed() const
+    {
+        return data_->isFastModificationDetectionUsed();
+    }
+
+    QByteArray getHashBuilderState() const
+    {
+        return data_->getHashBuilderState();
+    }
+
+    // Publish full digest of indexed data calculated outside of the lock
+    void setHashBuilderState( const QByteArray& state )
+    {
+        data_->setHashBuilderState( state );
+    }
+
+    // Digests of indexed data blocks, only calculated with full digest
+    BlockDigests getBlockDigests() const
+    {
+        return data_->getBlockDigests();
+    }
+    void setBlockDigests( const BlockDigests& blockDigests )
+    {
+        data_->setBlockDigests( blockDigests );
+    }
+
+    // Replace all indexing data with previously persisted index,
+    // forced encoding is kept.
+    bool restore( LinePositionArray&& linePosition, LineLength maxLength, const IndexedHash& hash,
+                  const QByteArray& hashBuilderState, QTextCodec* encodingGuess )
+    {
+        return data_->restore( std::move( linePosition ), maxLength, hash, hashBuilderState,
+                               encodingGuess );
+    }
+
+    IndexingCheckpoint getCheckpoint() const
+    {
+        return data_->getCheckpoint();
+    }
+
+    void setCheckpoint( LineLength::UnderlyingType additionalSpaces, bool isInterrupted )
+    {
+        data_->setCheckpoint( additionalSpaces, isInterrupted );
+    }
+
+    // Start index at the beginning of the line at the passed offset,
+    // data before it is indexed later and prepended.
+    void startIndexAt( OffsetInFile firstLineOffset )
+    {
+        data_->startIndexAt( firstLineOffset );
+    }
+
+    // Prepend index of the beginning of the file, up to the first indexed line.
+    // Prefix data is moved from and must not be shared with other threads.
+    void prependIndex( IndexingData& prefix, const QByteArray& hashBuilderState,
+                       const BlockDigests& blockDigests )
+    {
+        data_->prependIndex( prefix, hashBuilderState, blockDigests );
+    }
+
+    // Drop index after the first nbLines lines, digests must cover
+    // the data up to the end of the last kept line.
+    void truncateIndex( LinesCount nbLines, const QByteArray& hashBuilderState,
+                        const BlockDigests& blockDigests )
+    {
+        data_->truncateIndex( nbLines, hashBuilderState, blockDigests );
+    }
+
+    // Replace all indexing data with the index built separately.
+    // Other data is moved from and must not be shared with other threads.
+    void replaceIndex( IndexingData& other )
+    {
+        data_->replaceIndex( other );
+    }
+
+    // Pick storage of line positions for a file of the passed size,
+    // it is kept if some lines are already indexed.
+    void selectLinePositionStorage( qint64 fileSize )
+    {
+        data_->selectLinePositionStorage( fileSize );
+    }
+
+    // Keep only some line positions of the file indexed from now on,
+    // the others are found from file data when needed.
+    void enableSparseIndex( const QString& fileName,
+                            const std::shared_ptr<const FileChain>& fileChain )
+    {
+        data_->enableSparseIndex( fileName, fileChain );
+    }
+
+    // Blocks which tabs were not expanded yet when max length was calculated
+    void addBlockWithTabs( OffsetInFile::UnderlyingType blockBeginning )
+    {
+        data_->addBlockWithTabs( blockBeginning );
+    }
+    klogg::vector<OffsetInFile::UnderlyingType> takeBlocksWithTabs()
+    {
+        return data_->takeBlocksWithTabs();
+    }
+
+    // Raise max length to the length found after tabs are expanded
+    void extendMaxLength( LineLength length )
+    {
+        data_->extendMaxLength( length );
+    }
+
+    // Trigrams of indexed data if it is built, the index is filled
+    // by the indexing thread while searches use it.
+    std::shared_ptr<TrigramIndex> getTrigramIndex() const
+    {
+        return data_->getTrigramIndex();
+    }
+    void setTrigramIndex( std::shared_ptr<TrigramIndex> trigramIndex )
+    {
+        data_->setTrigramIndex( std::move( trigramIndex ) );
+    }
+
+    // Token filters of indexed data if they are built, filled the same way
+    std::shared_ptr<TokenFilters> getTokenFilters() const
+    {
+        return data_->getTokenFilters();
+    }
+    void setTokenFilters( std::shared_ptr<TokenFilters> tokenFilters )
+    {
+        data_->setTokenFilters( std::move( tokenFilters ) );
+    }
+
   private:
     Data data_;
     LockGuard guard_;
@@ -182,8 +386,8 @@ class IndexingDataAccessor {
 // This class is a thread-safe set of indexing data.
 class IndexingData {
   public:
-    using ConstAccessor = IndexingDataAccessor<const IndexingData*, SharedLock>;
-    using MutateAccessor = IndexingDataAccessor<IndexingData*, UniqueLock>;
+    using ConstAccessor = IndexingDataAccessor<const IndexingData*, ShardedSharedLock>;
+    using MutateAccessor = IndexingDataAccessor<IndexingData*, ShardedUniqueLock>;
 
   private:
     qint64 getIndexedSize() const;
@@ -198,7 +402,15 @@ class IndexingData {
 
     // Get the position (in byte from the beginning of the file)
     // of the end of the passed line.
-    OffsetInFile getEndOfLineOffset( LineNumber line ) const;
+    OffsetInFile getEndOfLineOffset( LineNumber line, LineCursor* cursor = nullptr ) const;
+    void getEndOfLineOffsets( LineNumber first, LinesCount count, OffsetInFile* out,
+                              LineCursor* cursor = nullptr ) const;
+
+    std::optional<LineLength> getLineLength( LineNumber line ) const;
+    FastLineLengthArray getLineLengths( LineNumber first, LinesCount count ) const;
+
+    OffsetInFile getFirstLineOffset() const;
+    uint64_t getLinePositionGeneration() const;
 
     // Get the guessed encoding for the content.
     QTextCodec* getEncodingGuess() const;
@@ -209,8 +421,9 @@ class IndexingData {
 
     // Atomically add to all the existing
     // indexing data.
-    void addAll( const klogg::vector<char>& block, LineLength length,
-                 const FastLinePositionArray& linePosition, QTextCodec* encoding );
+    void addAll( std::string_view block, LineLength length,
+                 const FastLinePositionArray& linePosition,
+                 const FastLineLengthArray& lineLengths, QTextCodec* encoding );
 
     // Completely clear the indexing data.
     void clear();
@@ -220,19 +433,76 @@ class IndexingData {
     int getProgress() const;
     void setProgress( int progress );
 
+    bool hasFakeFinalLF() const;
+    bool isFastModificationDetectionUsed() const;
+    QByteArray getHashBuilderState() const;
+    void setHashBuilderState( const QByteArray& state );
+    BlockDigests getBlockDigests() const;
+    void setBlockDigests( const BlockDigests& blockDigests );
+
+    bool restore( LinePositionArray&& linePosition, LineLength maxLength, const IndexedHash& hash,
+                  const QByteArray& hashBuilderState, QTextCodec* encodingGuess );
+
+    IndexingCheckpoint getCheckpoint() const;
+    void setCheckpoint( LineLength::UnderlyingType additionalSpaces, bool isInterrupted );
+
+    void startIndexAt( OffsetInFile firstLineOffset );
+    void prependIndex( IndexingData& prefix, const QByteArray& hashBuilderState,
+                       const BlockDigests& blockDigests );
+    void truncateIndex( LinesCount nbLines, const QByteArray& hashBuilderState,
+                        const BlockDigests& blockDigests );
+    void replaceIndex( IndexingData& other );
+
+    void selectLinePositionStorage( qint64 fileSize );
+    void enableSparseIndex( const QString& fileName,
+                            const std::shared_ptr<const FileChain>& fileChain );
+
+    void addBlockWithTabs( OffsetInFile::UnderlyingType blockBeginning );
+    klogg::vector<OffsetInFile::UnderlyingType> takeBlocksWithTabs();
+    void extendMaxLength( LineLength length );
+
+    std::shared_ptr<TrigramIndex> getTrigramIndex() const;
+    void setTrigramIndex( std::shared_ptr<TrigramIndex> trigramIndex );
+    std::shared_ptr<TokenFilters> getTokenFilters() const;
+    void setTokenFilters( std::shared_ptr<TokenFilters> tokenFilters );
+
+    // Position from the cursor, empty if it is from another generation of the index
+    LinePositionArray::Cache* cursorPosition( LineCursor* cursor ) const;
+
   private:
-    mutable SharedMutex dataMutex_;
+    // Read by the GUI and all search threads, only changed by indexing
+    mutable ShardedSharedMutex dataMutex_;
 
     LinePositionArray linePosition_;
-    mutable tbb::enumerable_thread_specific<CompressedLinePositionStorage::Cache> linePositionCache_;
+    // Changed when lines already read with cursors may be different
+    uint64_t linePositionGeneration_{};
+    // One length for each line, except the one with a fake final LF
+    LineLengthArray lineLengths_;
+
+    // Used instead of linePosition_ once the first lines of sparse index are added,
+    // line lengths are not kept then.
+    QString sparseIndexFileName_;
+    std::shared_ptr<const FileChain> sparseIndexFileChain_;
+    std::unique_ptr<SparseLinePositionArray> sparseLinePosition_;
 
     LineLength maxLength_;
+    OffsetInFile firstLineOffset_;
+
+    LineLength::UnderlyingType partialLineSpaces_{};
+    bool isInterrupted_ = false;
+
+    // Beginnings of indexed blocks with tabs not yet accounted for in max length
+    klogg::vector<OffsetInFile::UnderlyingType> blocksWithTabs_;
 
     int progress_{};
 
     FileDigest hashBuilder_;
+    BlockDigests blockDigests_;
     IndexedHash hash_;
 
+    std::shared_ptr<TrigramIndex> trigramIndex_;
+    std::shared_ptr<TokenFilters> tokenFilters_;
+
     QTextCodec* encodingGuess_{};
     QTextCodec* encodingForced_{};
 
@@ -242,6 +512,19 @@ class IndexingData {
     friend MutateAccessor;
 };
 
+// Lines found in parsed data
+struct ParsedLines {
+    FastLinePositionArray positions;
+    // Lengths of lines that are known without decoding them
+    FastLineLengthArray lengths;
+
+    void append_list( const ParsedLines& other )
+    {
+        positions.append_list( other.positions );
+        lengths.append_list( other.lengths );
+    }
+};
+
 struct IndexingState {
 
     EncodingParameters encodingParams;
@@ -250,6 +533,8 @@ struct IndexingState {
     LineLength::UnderlyingType additional_spaces{};
     OffsetInFile::UnderlyingType end{};
     OffsetInFile::UnderlyingType file_size{};
+    // If false, lengths are raw and blocks with tabs are recorded instead
+    bool expand_tabs = true;
 
     QTextCodec* encodingGuess{};
     QTextCodec* fileTextCodec{};
@@ -257,12 +542,32 @@ struct IndexingState {
 
 using OperationResult = std::variant<bool, MonitoredFileStatus>;
 
+// File kept open while it grows, with the end of indexed data,
+// so appended data is indexed without reading the file again.
+struct FollowedFile {
+    ChainedFile file;
+    // Indexed data covered by the tail hash
+    QByteArray tail;
+    qint64 tailOffset = 0;
+    // Appended data, memory is reused for each append
+    klogg::vector<char> buffer;
+
+    void reset()
+    {
+        file.close();
+        tail.clear();
+        tailOffset = 0;
+    }
+};
+
 class IndexOperation : public QObject {
     Q_OBJECT
   public:
-    IndexOperation( const QString& fileName, const std::shared_ptr<IndexingData>& indexingData,
+    IndexOperation( const QString& fileName, const std::shared_ptr<const FileChain>& fileChain,
+                    const std::shared_ptr<IndexingData>& indexingData,
                     AtomicFlag& interruptRequest )
         : fileName_( fileName )
+        , fileChain_( fileChain )
         , indexing_data_( indexingData )
         , interruptRequest_( interruptRequest )
     {
@@ -272,77 +577,253 @@ class IndexOperation : public QObject {
     // and false if it has been cancelled (results not copied)
     virtual OperationResult run() = 0;
 
+    // Progress of blocks is written there instead of sending indexingProgressed
+    void setProgress( OperationProgress* progress )
+    {
+        progress_ = progress;
+    }
+
+    // Find lines of the block in the encoding of the state, positions are
+    // offsets in the file. Doesn't use the operation, so it is also benchmarked alone.
+    static ParsedLines parseDataBlock( OffsetInFile::UnderlyingType blockBegining,
+                                       std::string_view block, IndexingState& state );
+
   Q_SIGNALS:
     void indexingProgressed( int );
     void indexingFinished( bool );
+    void indexingPreviewReady();
+    void indexTruncated( LinesCount );
     void fileCheckFinished( MonitoredFileStatus );
 
   protected:
     using BlockBuffer = klogg::vector<char>;
-    using BlockData = std::pair<OffsetInFile::UnderlyingType, BlockBuffer*>;
+
+    // File data of one block, either read into the buffer
+    // or pointing into the mapped file
+    struct BlockContent {
+        BlockBuffer buffer;
+        std::string_view data;
+    };
+
+    // Recycles block buffers between the reader and the parsers.
+    // Blocks in flight are bounded by the prefetch limiter, so
+    // the pool capacity matches the limiter threshold.
+    class BlockContentPool {
+      public:
+        BlockContentPool() = default;
+        ~BlockContentPool();
+
+        BlockContentPool( const BlockContentPool& ) = delete;
+        BlockContentPool& operator=( const BlockContentPool& ) = delete;
+
+        void setCapacity( size_t capacity );
+
+        BlockContent* acquire();
+        void release( BlockContent* content );
+
+      private:
+        tbb::concurrent_queue<BlockContent*> freeBlocks_;
+        std::atomic<size_t> freeBlocksCount_{ 0 };
+        size_t capacity_ = 0;
+    };
+
+    using BlockData = std::pair<OffsetInFile::UnderlyingType, BlockContent*>;
     using BlockPrefetcher = tbb::flow::limiter_node<BlockData>;
 
+    // Block which lines were found by one of parallel parsers.
+    // Everything after the first line feed of the block does not depend
+    // on previous blocks, so it can be parsed out of order. The first
+    // line is completed when blocks are stitched together in order.
+    struct ParsedBlock {
+        size_t sequence{};
+        BlockData blockData;
+
+        EncodingParameters encodingParams;
+        QTextCodec* encodingGuess{};
+        QTextCodec* fileTextCodec{};
+        bool expandTabs = true;
+
+        // Lines after the first line feed of the block
+        OffsetInFile::UnderlyingType tailBeginning{};
+        ParsedLines lines;
+        // State at the end of block, empty if there is no line feed in the block
+        std::optional<IndexingState> tailState;
+    };
+
     // Returns the total size indexed
     // Modify the passed linePosition and maxLength
+    // If interrupted, data indexed so far is kept as a checkpoint.
     void doIndex( OffsetInFile initialPosition );
 
+    // Compares indexed part of the file with its current content
+    MonitoredFileStatus checkFileChanges() const;
+
+    // Indexes a small amount of data appended to the file without the indexing graph.
+    // Returns the status of the file if it changed otherwise and has to be indexed
+    // by other operations.
+    std::optional<MonitoredFileStatus> indexAppendedData( FollowedFile& followedFile );
+
     QString fileName_;
+    // Rotated files read before the file, empty unless rotations are chained
+    std::shared_ptr<const FileChain> fileChain_;
     std::shared_ptr<IndexingData> indexing_data_;
     AtomicFlag& interruptRequest_;
+    OperationProgress* progress_ = nullptr;
 
-  private:
-    FastLinePositionArray parseDataBlock( OffsetInFile::UnderlyingType blockBegining,
-                                          const BlockBuffer& block, IndexingState& state ) const;
+    BlockContentPool blockContentPool_;
+    // Blocks read ahead of indexing, set up for each indexing run
+    std::unique_ptr<PrefetchDepth> prefetchDepth_;
+
+    // Position to stop reading at, the whole file is indexed if negative
+    qint64 indexingEnd_ = -1;
 
-    void guessEncoding( const BlockBuffer& block, IndexingData::MutateAccessor& scopedAccessor,
+  private:
+    template <typename Accessor>
+    void guessEncoding( std::string_view block, Accessor& scopedAccessor,
                         IndexingState& state ) const;
 
-    std::chrono::microseconds readFileInBlocks( QFile& file, BlockPrefetcher& blockPrefetcher );
+    qint64 indexingEndPosition( const ChainedFile& file ) const;
+
+    std::chrono::microseconds readFileInBlocks( ChainedFile& file,
+                                                BlockPrefetcher& blockPrefetcher );
+    void sendBlock( BlockPrefetcher& blockPrefetcher, const BlockData& blockData );
+    // Reads from the file position with several blocks in flight until the indexing end,
+    // the file is left at the end of the blocks sent. Does nothing if the file can't be
+    // read at many positions at once.
+    void readFileInQueue( ChainedFile& file, BlockPrefetcher& blockPrefetcher,
+                          std::chrono::microseconds& ioDuration );
+    // Returns false if file can't be mapped and should be read instead
+    bool readMappedFileInBlocks( ChainedFile& file, BlockPrefetcher& blockPrefetcher,
+                                 std::chrono::microseconds& ioDuration );
     void indexNextBlock( IndexingState& state, const BlockData& blockData );
+
+    void parseBlockTail( ParsedBlock& parsedBlock ) const;
+    void stitchParsedBlock( IndexingState& state, ParsedBlock& parsedBlock );
+
+    // Appends parsed lines to indexing data under the writer lock
+    void publishParsedLines( const IndexingState& state,
+                             OffsetInFile::UnderlyingType blockBeginning, std::string_view block,
+                             const ParsedLines& lines );
+
+    // Parses lines of blocks with tabs again to find their expanded max length,
+    // used when tabs are not expanded during indexing.
+    void expandTabsInRecordedBlocks( const IndexingState& state );
+
+    // Reads and parses blocks one after another in the calling thread without the
+    // indexing graph, its setup costs more than indexing a small file.
+    void runSmallFileIndexing( ChainedFile& file, IndexingState& state, FileDigest* fullDigest,
+                               BlockDigests* blockDigests, TrigramIndex* trigramIndex,
+                               TokenFilters* tokenFilters, std::chrono::microseconds& ioDuration );
+    void runSerialIndexing( ChainedFile& file, IndexingState& state, size_t prefetchBufferSize,
+                            FileDigest* fullDigest, BlockDigests* blockDigests,
+                            TrigramIndex* trigramIndex, TokenFilters* tokenFilters,
+                            std::chrono::microseconds& ioDuration );
+    void runParallelIndexing( ChainedFile& file, IndexingState& state, size_t prefetchBufferSize,
+                              FileDigest* fullDigest, BlockDigests* blockDigests,
+                              TrigramIndex* trigramIndex, TokenFilters* tokenFilters,
+                              std::chrono::microseconds& ioDuration );
 };
 
 class FullIndexOperation : public IndexOperation {
     Q_OBJECT
   public:
-    FullIndexOperation( const QString& fileName, const std::shared_ptr<IndexingData>& indexingData,
-                        AtomicFlag& interruptRequest, QTextCodec* forcedEncoding = nullptr )
-        : IndexOperation( fileName, indexingData, interruptRequest )
+    FullIndexOperation( const QString& fileName,
+                        const std::shared_ptr<const FileChain>& fileChain,
+                        const std::shared_ptr<IndexingData>& indexingData,
+                        AtomicFlag& interruptRequest, QTextCodec* forcedEncoding = nullptr,
+                        bool keepCurrentIndex = false )
+        : IndexOperation( fileName, fileChain, indexingData, interruptRequest )
         , forcedEncoding_( forcedEncoding )
+        , keepCurrentIndex_( keepCurrentIndex )
     {
     }
     OperationResult run() override;
 
   private:
+    // Indexes the end of the file first, so it can be followed
+    // while the rest is indexed. Returns false if the tail was not
+    // indexed separately.
+    bool indexTailFirst();
+    // Continues indexing interrupted earlier if indexed data is still valid
+    bool resumeInterruptedIndex();
+    qint64 findTailFirstLineStart( ChainedFile& file, QTextCodec* codec ) const;
+
+    // Indexes the file from the beginning with the encoding guessed from its
+    // first block, while the encoding is guessed again from blocks sampled
+    // across the file. The file is indexed again only if the sampled guess
+    // has a different line feed.
+    void indexWithSampledEncoding( bool useSparseIndex );
+    // Returns nullptr if the file is too small or samples have no opinion
+    QTextCodec* guessEncodingFromSamples() const;
+
     QTextCodec* forcedEncoding_;
+    // Current index stays available until the new one is complete
+    bool keepCurrentIndex_;
 };
 
 class PartialIndexOperation : public IndexOperation {
     Q_OBJECT
   public:
     PartialIndexOperation( const QString& fileName,
+                           const std::shared_ptr<const FileChain>& fileChain,
                            const std::shared_ptr<IndexingData>& indexingData,
                            AtomicFlag& interruptRequest )
-        : IndexOperation( fileName, indexingData, interruptRequest )
+        : IndexOperation( fileName, fileChain, indexingData, interruptRequest )
     {
     }
 
     OperationResult run() override;
 };
 
+class DifferentialIndexOperation : public IndexOperation {
+    Q_OBJECT
+  public:
+    DifferentialIndexOperation( const QString& fileName,
+                                const std::shared_ptr<const FileChain>& fileChain,
+                                const std::shared_ptr<IndexingData>& indexingData,
+                                AtomicFlag& interruptRequest )
+        : IndexOperation( fileName, fileChain, indexingData, interruptRequest )
+    {
+    }
+
+    OperationResult run() override;
+
+  private:
+    // Drops index of lines after the first modified block,
+    // returns false if nothing can be kept
+    bool truncateModifiedIndex();
+};
+
 class CheckFileChangesOperation : public IndexOperation {
     Q_OBJECT
   public:
     CheckFileChangesOperation( const QString& fileName,
+                               const std::shared_ptr<const FileChain>& fileChain,
                                const std::shared_ptr<IndexingData>& indexingData,
                                AtomicFlag& interruptRequest )
-        : IndexOperation( fileName, indexingData, interruptRequest )
+        : IndexOperation( fileName, fileChain, indexingData, interruptRequest )
+    {
+    }
+
+    OperationResult run() override;
+};
+
+class AppendIndexOperation : public IndexOperation {
+    Q_OBJECT
+  public:
+    AppendIndexOperation( const QString& fileName,
+                          const std::shared_ptr<const FileChain>& fileChain,
+                          const std::shared_ptr<IndexingData>& indexingData,
+                          AtomicFlag& interruptRequest, FollowedFile& followedFile )
+        : IndexOperation( fileName, fileChain, indexingData, interruptRequest )
+        , followedFile_( followedFile )
     {
     }
 
     OperationResult run() override;
 
   private:
-    MonitoredFileStatus doCheckFileChanges();
+    FollowedFile& followedFile_;
 };
 
 class LogDataWorker : public QObject {
@@ -351,7 +832,12 @@ class LogDataWorker : public QObject {
   public:
     // Pass a pointer to the IndexingData (initially empty)
     // This object will change it when indexing (IndexingData must be thread safe!)
-    explicit LogDataWorker( const std::shared_ptr<IndexingData>& indexing_data );
+    // Operations run with the owner's priority at the time they start,
+    // on the NUMA node of the owner.
+    // Progress of indexing is written to the owner's progress.
+    LogDataWorker( const std::shared_ptr<IndexingData>& indexing_data,
+                   const std::atomic<TaskPriority>& taskPriority, int numaNode,
+                   OperationProgress& progress );
     ~LogDataWorker() noexcept override;
 
     LogDataWorker( const LogDataWorker& ) = delete;
@@ -362,13 +848,21 @@ class LogDataWorker : public QObject {
 
     // Attaches to a file on disk. Attaching to a non existant file
     // will work, it will just appear as an empty file.
-    void attachFile( const QString& fileName );
+    // Files the log was rotated from are read before it if chained.
+    void attachFile( const QString& fileName, const std::shared_ptr<const FileChain>& fileChain );
     // Instructs the thread to start a new full indexing of the file, sending
-    // signals as it progresses.
-    void indexAll( QTextCodec* forcedEncoding = nullptr );
+    // signals as it progresses. If keepCurrentIndex is set, the new index
+    // is built separately and replaces the current one when complete.
+    void indexAll( QTextCodec* forcedEncoding = nullptr, bool keepCurrentIndex = false );
     // Instructs the thread to start a partial indexing (starting at
     // the end of the file as indexed).
     void indexAdditionalLines();
+    // Instructs the thread to reindex the file starting
+    // from the first block modified since indexing.
+    void indexModifiedLines();
+    // Instructs the thread to index data appended to the followed file,
+    // falls back to checking the file if it changed otherwise.
+    void indexAppendedData();
 
     void checkFileChanges();
 
@@ -383,6 +877,14 @@ class LogDataWorker : public QObject {
     // to copy the new data back.
     void indexingFinished( LoadingStatus status );
 
+    // Sent when the end of a large file is indexed
+    // and the beginning is still being indexed.
+    void indexingPreviewReady();
+
+    // Sent when index is dropped after the first keptLines
+    // before modified data is indexed again.
+    void indexTruncated( LinesCount keptLines );
+
     // Sent when check file is finished, signals the client
     // to copy the new data back.
     void checkFileChangesFinished( MonitoredFileStatus status );
@@ -400,9 +902,17 @@ class LogDataWorker : public QObject {
     AtomicFlag interruptRequest_;
 
     QString fileName_;
+    std::shared_ptr<const FileChain> fileChain_;
+
+    // Used only by operations while they hold the mutex
+    FollowedFile followedFile_;
 
     // Pointer to the owner's indexing data (we modify it)
     std::shared_ptr<IndexingData> indexing_data_;
+
+    const std::atomic<TaskPriority>& taskPriority_;
+    const int numaNode_;
+    OperationProgress& progress_;
 };
 
 #endif
@@ -42,6 +42,7 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <tuple>
 #include <unordered_map>
 
@@ -49,8 +50,8 @@
 #include <QList>
 #include <QObject>
 #include <QStringList>
+#include <QTimer>
 
-#include <KDSignalThrottler.h>
 
 #include "abstractlogdata.h"
 #include "hsregularexpression.h"
@@ -59,6 +60,8 @@
 #include "synchronization.h"
 
 class LogData;
+class MappedSearchResults;
+struct LineOrder;
 class QTimer;
 
 // A list of matches found in a LogData, it stores all the matching lines,
@@ -72,40 +75,93 @@ class LogFilteredData : public AbstractLogData {
   public:
     // Constructor used by LogData
     explicit LogFilteredData( const LogData* logData );
+    ~LogFilteredData();
+
+    // Memory taken by cached search results of all open files
+    static uint64_t searchResultsCacheBytes();
+
+    // Whether results of the search are in the cache, so running it is instant
+    bool hasCachedSearchResults( const RegularExpressionPattern& regExp, LineNumber startLine,
+                                 LineNumber endLine ) const;
+    // Move results cached by other filtered data of the same file to this cache,
+    // the least recently used ones are evicted if it gets over the limits.
+    void takeCachedSearchResults( LogFilteredData& other );
 
     // Starts the async search, sending newDataAvailable() when new data found.
+    // If the pattern narrows the one of the last complete search over the same lines,
+    // only lines it matched are searched.
     // If a search is already in progress this function will block until
     // it is done, so the application should call interruptSearch() first.
+    // Lines around focusLine, e.g. the ones shown, can be searched first.
     void runSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
-                    LineNumber endLine );
+                    LineNumber endLine, OptionalLineNumber focusLine = {} );
     // Shortcut for runSearch on all file
     void runSearch( const RegularExpressionPattern& regExp );
 
+    // Next searches and counts only search these lines between their start and end
+    // lines, e.g. regions between markers, all lines if not set. Chunks of other lines
+    // are not read, and refined searches stay in them. Results are not cached.
+    void setSearchedLines( std::shared_ptr<const SearchResultArray> lines );
+    std::shared_ptr<const SearchResultArray> searchedLines() const;
+
+    // Starts the async count of matching lines, the lines are not kept,
+    // so there are no results to show. Matches are also counted in bucketsCount
+    // parts of the file if it is not 0. runSearch replaces the count with the results.
+    void runCount( const RegularExpressionPattern& regExp, LineNumber startLine,
+                   LineNumber endLine, size_t bucketsCount = 0 );
+    // Shows the passed lines as results of a search, e.g. lines of a message
+    // template. They are not searched for again when the file is updated.
+    // Lines are shown in the order if it is set, until the next search. They are
+    // in file order while they are not those of the order, e.g. after marks
+    // change, and while context lines are shown.
+    void showLines( SearchResultArray lines, std::shared_ptr<const LineOrder> order = {} );
+    // Whether the current search only counts matches
+    bool isCountOnly() const;
+    // Counts of the finished count only search
+    MatchCounts getMatchCounts() const;
+    // Matching lines by their time, updated as the search progresses
+    TimeHistogram getTimeHistogram() const;
+
     // Add to the existing search, starting at the line when the search was
     // last stopped. Used when the file on disk has been added too.
+    // Count only search only counts the lines added since the last count.
     void updateSearch( LineNumber startLine, LineNumber endLine );
     // Interrupt the running search if one is in progress.
     // Nothing is done if no search is in progress.
     void interruptSearch();
     // Clear the search and the list of results.
     void clearSearch( bool dropCache = false );
+    // Drop results and marks starting from the passed line, used when
+    // the file on disk has been modified after it. The search can then
+    // be continued with updateSearch.
+    void truncateSearch( LineNumber firstModifiedLine );
 
     // Returns the line number in the original LogData where the element
     // 'index' was found.
     LineNumber getMatchingLineNumber( LineNumber index ) const;
+    // Same for consecutive elements, found walking the results from the first one
+    klogg::vector<LineNumber> getMatchingLineNumbers( LineNumber first, LinesCount number ) const;
     // Returns the line 'index' in filterd log data that matches
     // given original line number
     LineNumber getLineIndexNumber( LineNumber lineNumber ) const;
 
+    // Returns the log data the search is done in
+    const LogData* getSourceLogData() const;
+
     // Returns the number of lines in the source log data
     LinesCount getNbTotalLines() const;
     // Returns the number of matches (independently of the visibility)
     LinesCount getNbMatches() const;
+    // Returns the lines matched so far, they are copied before the search changes them
+    std::shared_ptr<const SearchResultArray> getMatchingLines() const;
     // Returns the number of marks (independently of the visibility)
     LinesCount getNbMarks() const;
 
     LineType lineTypeByIndex( LineNumber index ) const;
+    klogg::vector<LineType> lineTypesByIndex( LineNumber first, LinesCount number ) const;
     LineType lineTypeByLine( LineNumber lineNumber ) const;
+    // Types of consecutive lines, found in one pass over matches and marks
+    klogg::vector<LineType> lineTypesByLine( LineNumber first, LinesCount number ) const;
 
     // Marks interface (delegated to a Marks object)
 
@@ -136,16 +192,27 @@ class LogFilteredData : public AbstractLogData {
     void setVisibility( Visibility visibility );
     Visibility visibility() const;
 
+    // Lines shown before and after each visible line, like grep --context.
+    // Other lines have no line type, the first line after hidden ones is a Gap.
+    void setContextLines( LinesCount contextLines );
+    LinesCount contextLines() const;
+
     void iterateOverLines( const std::function<void( LineNumber )>& callback ) const;
+
+    // Numbers of shown lines before the passed line and of those that are matches
+    std::pair<LinesCount, LinesCount> getNbShownLinesBefore( LineNumber line ) const;
+    // First line of the matches the search added since the last call,
+    // empty if the search was restarted or has added nothing.
+    OptionalLineNumber takeFirstNewMatch();
   Q_SIGNALS:
     // Sent when the search has progressed, give the number of matches (so far)
     // and the percentage of completion
     void searchProgressed( LinesCount nbMatches, int progress, LineNumber initialLine );
-    void searchProgressedThrottled();
 
   private Q_SLOTS:
+    // Called when a search ends, its progress is polled while it runs
     void handleSearchProgressed( LinesCount nbMatches, int progress, LineNumber initialLine );
-    void handleSearchProgressedThrottled();
+    void pollSearchProgress();
 
   private:
     // Implementation of virtual functions
@@ -153,8 +220,20 @@ class LogFilteredData : public AbstractLogData {
     QString doGetExpandedLineString( LineNumber line ) const override;
     klogg::vector<QString> doGetLines( LineNumber first, LinesCount number ) const override;
     klogg::vector<QString> doGetExpandedLines( LineNumber first, LinesCount number ) const override;
+    QString doGetExpandedLineWindow( LineNumber line, LineColumn firstColumn,
+                                     LineLength length ) const override;
+    qint64 doGetLineSize( LineNumber line ) const override;
+    std::optional<QByteArray> doGetLinesBytes( LineNumber first,
+                                               LinesCount number ) const override;
+    // Source lines close to each other are read together
     klogg::vector<QString> doGetLines( LineNumber first, LinesCount number,
-                                     const std::function<QString( LineNumber )>& lineGetter ) const;
+                                     QString ( *processLine )( QString&& ) ) const;
+
+    // Read the source pages of the lines in the background, so the view finds them
+    // decoded. Lines past the end of results are skipped.
+    void prefetchLines( const klogg::vector<LineNumber>& lines ) const;
+    // Prefetch the lines after the read ones, or before them when scrolling up
+    void prefetchNextLines( LineNumber first, LinesCount number ) const;
     LineNumber doGetLineNumber( LineNumber index ) const override;
     LinesCount doGetNbLine() const override;
     LineLength doGetMaxLength() const override;
@@ -174,32 +253,65 @@ class LogFilteredData : public AbstractLogData {
     // Returns wheither the passed line has a mark on it.
     bool isLineMarked( LineNumber line ) const;
 
-    // List of the matching line numbers
-    SearchResultArray matching_lines_;
+    // List of the matching line numbers, shared with cached results.
+    // Union with marks is the same array while there are no marks.
+    std::shared_ptr<SearchResultArray> matching_lines_ = std::make_shared<SearchResultArray>();
     SearchResultArray marks_;
-    SearchResultArray marks_and_matches_;
+    std::shared_ptr<SearchResultArray> marks_and_matches_ = matching_lines_;
 
     const LogData* sourceLogData_;
 
     RegularExpressionPattern currentRegExp_;
+    // Buckets of the count only search, the search keeps matching lines if not set
+    std::optional<size_t> countBuckets_;
+    MatchCounts matchCounts_;
+    TimeHistogram timeHistogram_;
     LineLength maxLength_;
     LineLength maxLengthMarks_;
     // Number of lines of the LogData that has been searched for:
     LinesCount nbLinesProcessed_;
+    // First of the matches added by the search progress
+    OptionalLineNumber firstNewMatch_;
+
+    // Lines last read by the view, prefetched as matches are added
+    mutable LineNumber shownFirstLine_;
+    mutable LinesCount shownLines_;
 
     Visibility visibility_;
 
-    LogFilteredDataWorker workerThread_;
+    // Visible lines with their context, made when they are first used
+    // after visible lines change and when the number of lines changes
+    LinesCount contextLines_;
+    mutable std::shared_ptr<const SearchResultArray> linesWithContext_;
+    mutable LinesCount linesWithContextNbLines_;
 
-    Mutex searchProgressMutex_;
-    std::tuple<LinesCount, int, LineNumber> searchProgress_;
+    // Order of the matches, valid while they are those it was made for
+    std::shared_ptr<const LineOrder> order_;
+    uint64_t orderMatchesGeneration_ = 0;
+    // Incremented when the matches change
+    uint64_t matchesGeneration_ = 0;
 
-    KDToolBox::KDSignalThrottler searchProgressThrottler_;
+    std::shared_ptr<const SearchResultArray> searchedLines_;
+
+    LogFilteredDataWorker workerThread_;
+
+    QTimer searchProgressTimer_;
+    uint64_t searchProgressGeneration_ = 0;
+    // Searches started by the worker that have not signalled their end
+    int runningSearches_ = 0;
 
   private:
     struct CachedSearchResult {
-        SearchResultArray matching_lines;
+        // Shared with current results, they are copied before they are changed
+        std::shared_ptr<SearchResultArray> matching_lines;
         LineLength maxLength;
+        uint64_t bytes = 0;
+        // Value of the uses counter when the results were last used
+        uint64_t lastUse = 0;
+        // Results over the limits of the cache are mapped from a file instead,
+        // matching lines of them are loaded only while they are current
+        std::shared_ptr<const MappedSearchResults> mapped;
+        TimeHistogram timeHistogram;
     };
 
     using SearchCacheKey = std::tuple<RegularExpressionPattern, LineNumber::UnderlyingType,
@@ -224,8 +336,11 @@ class LogFilteredData : public AbstractLogData {
         }
     };
 
-    std::unordered_map<SearchCacheKey, CachedSearchResult, SearchCacheKeyHash> searchResultsCache_;
+    using SearchResultsCache
+        = std::unordered_map<SearchCacheKey, CachedSearchResult, SearchCacheKeyHash>;
+    SearchResultsCache searchResultsCache_;
     SearchCacheKey currentSearchKey_;
+    uint64_t searchResultsCacheBytes_ = 0;
 
     SearchCacheKey makeCacheKey( const RegularExpressionPattern& regExp, LineNumber startLine,
                                  LineNumber endLine )
@@ -233,7 +348,35 @@ class LogFilteredData : public AbstractLogData {
         return std::make_tuple( regExp, startLine.get(), endLine.get() );
     }
 
-    void updateSearchResultsCache();
+    // Keep results of the finished search, they are also saved
+    // to disk unless they were just loaded from there
+    void updateSearchResultsCache( bool saveToDisk = true );
+
+    // Drop least recently used results other than the current ones until the cache
+    // is within the line limit and caches of all files are within the memory limit
+    void evictSearchResults( uint64_t maxLines, uint64_t maxBytes );
+    // End of the cache if all results are current or mapped
+    SearchResultsCache::iterator leastRecentlyUsedSearchResult();
+    void evictSearchResult( SearchResultsCache::iterator cachedResult );
+    void evictMappedSearchResults( size_t maxCount );
+    void releaseMappedSearchResults();
+    void clearSearchResultsCache();
+
+    // Matches of the last complete search, kept when it is cleared,
+    // so searches for narrower patterns only check these lines.
+    SearchCacheKey refineBaseKey_;
+    std::shared_ptr<const SearchResultArray> refineBase_;
+
+    bool isSearchComplete() const;
+    bool canRefineSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
+                          LineNumber endLine ) const;
+
+    // Use results saved to disk by an earlier session, lines added
+    // to the file since then are searched. Returns false if there are none.
+    bool restoreSavedSearchResults( LineNumber startLine, LineNumber endLine );
+
+    // Called after the worker starts a search, its progress is polled until it ends
+    void pollSearchProgressUntilEnd();
 
     inline LineNumber getExpectedSearchEnd( const SearchCacheKey& cacheKey ) const
     {
@@ -242,9 +385,19 @@ class LogFilteredData : public AbstractLogData {
 
     // Utility functions
     const SearchResultArray& currentResultArray() const;
+    const SearchResultArray& visibleResultArray() const;
+    // Order of the current lines if they are sorted
+    const LineOrder* currentOrder() const;
     LineNumber findLogDataLine( LineNumber lineNum ) const;
+    // Lines of indexes past the end of results are maxValue<LineNumber>()
+    klogg::vector<LineNumber> findLogDataLines( LineNumber first, LinesCount number ) const;
     LineNumber findFilteredLine( LineNumber lineNum ) const;
 
+    // Change matches and their union with marks the same way
+    template <typename Change>
+    void changeMatches( Change change );
+    void updateMarksAndMatches();
+
     // update maxLengthMarks_ when a Marks was changed.
     void updateMaxLengthMarks( OptionalLineNumber added_line, OptionalLineNumber removed_line );
 };
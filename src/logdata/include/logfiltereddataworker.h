@@ -39,6 +39,10 @@
 #ifndef LOGFILTEREDDATAWORKERTHREAD_H
 #define LOGFILTEREDDATAWORKERTHREAD_H
 
+#include <atomic>
+#include <memory>
+#include <optional>
+
 #include <QObject>
 
 #include <qthreadpool.h>
@@ -51,11 +55,16 @@
 #endif
 
 #include "atomicflag.h"
+#include "configuration.h"
+#include "levelindex.h"
 #include "regularexpression.h"
 #include "linetypes.h"
+#include "operationprogress.h"
 #include "synchronization.h"
+#include "timehistogram.h"
 
 class LogData;
+class QRegularExpression;
 
 // Class encapsulating a single matching line
 // Contains the line number the line was found in and its content.
@@ -86,12 +95,61 @@ class MatchingLine {
 // a fixed "in-place" array (vector) is probably fine.
 using SearchResultArray = roaring::Roaring64Map;
 
+// Returns lines of the array before the passed one
+SearchResultArray linesBefore( const SearchResultArray& lines, LineNumber line );
+// Returns lines of the array with the lines up to context lines before and after them,
+// only lines before nbLines are returned. Runs of lines are added as ranges.
+SearchResultArray linesAround( const SearchResultArray& lines, LinesCount context,
+                               LinesCount nbLines );
+// Returns the lines from each begin line to the next end line, or to the end of the file
+// if there is none. Begin lines inside a region don't start another one.
+SearchResultArray linesBetween( const SearchResultArray& beginLines,
+                                const SearchResultArray& endLines, LinesCount nbLines );
+// Returns the lines of the data between lines matching the begin and end expressions,
+// e.g. "BEGIN TX" and "END TX", as linesBetween does. Chunks of lines are matched
+// in parallel, empty if matching is interrupted.
+std::optional<SearchResultArray> linesBetweenMarkers( const LogData& logData,
+                                                      const QRegularExpression& begin,
+                                                      const QRegularExpression& end,
+                                                      const AtomicFlag& interruptRequested );
+// Returns the lines of the level and of the more severe ones. Lines are taken from the
+// level index when all of them are indexed, otherwise chunks of lines are read and
+// classified in parallel. Empty if reading is interrupted.
+std::optional<SearchResultArray> linesOfLevel( const LogData& logData, LogLevel level,
+                                               const AtomicFlag& interruptRequested );
+
 struct SearchResults {
     SearchResultArray newMatches;
     LineLength maxLength;
     LinesCount processedLines;
 };
 
+// Number of matching lines found by a search that doesn't keep the lines themselves,
+// optionally also per buckets of consecutive lines of the file, e.g. for the overview.
+struct MatchCounts {
+    MatchCounts() = default;
+    MatchCounts( LinesCount nbLines, size_t bucketsCount );
+
+    // Offsets of matching lines from the start of the chunk
+    void add( LineNumber chunkStart, const klogg::vector<size_t>& offsets );
+    void merge( const MatchCounts& other );
+
+    // Counts with the same buckets and no matches
+    MatchCounts emptyCopy() const;
+    // Buckets are merged by pairs until the lines of the file fit in them
+    void fit( LinesCount nbLines );
+    // Line is counted again, its match is removed if it was the last one
+    void recount( LineNumber line );
+
+    LinesCount nbMatches{ 0 };
+    // Lines of the file in each bucket
+    LinesCount bucketLines{ 0 };
+    klogg::vector<uint64_t> buckets;
+    OptionalLineNumber lastMatch;
+    // All lines before it are counted, counts of appended lines are added to these
+    LinesCount countedLines{ 0 };
+};
+
 // This class is a mutex protected set of search result data.
 // It is thread safe.
 class SearchData {
@@ -99,8 +157,17 @@ class SearchData {
     // will clear new matches
     SearchResults takeCurrentResults() const;
 
+    // Counts of the last count only search
+    MatchCounts getMatchCounts() const;
+    void setMatchCounts( MatchCounts counts );
+
+    // Matching lines by their time, empty if the results were restored
+    // without it or the lines have no timestamps
+    TimeHistogram getTimeHistogram() const;
+    void addTimeHistogram( const TimeHistogram& histogram );
+
     // Atomically add to all the existing search data.
-    void addAll( LineLength length, const SearchResultArray& matches, LinesCount nbLinesProcessed );
+    void addAll( LineLength length, SearchResultArray&& matches, LinesCount nbLinesProcessed );
     // Get the number of matches
     LinesCount getNbMatches() const;
     // Get the last matched line number
@@ -116,6 +183,14 @@ class SearchData {
     // Atomically clear the data.
     void clear();
 
+    // Drop matches from the passed line, nbKeptMatches counts
+    // matched lines already taken that are before it.
+    void truncate( LinesCount nbLines, LinesCount nbKeptMatches );
+
+    // Replace the data with results already taken, e.g. from a cache,
+    // so that the search can be continued after them.
+    void restore( LineLength maxLength, LinesCount nbLinesProcessed, LinesCount nbMatches );
+
   private:
     mutable SharedMutex dataMutex_;
 
@@ -124,55 +199,112 @@ class SearchData {
     LineLength maxLength_{ 0 };
     LinesCount nbLinesProcessed_{ 0 };
     LinesCount nbMatches_{ 0 };
+
+    MatchCounts matchCounts_;
+
+    TimeHistogram timeHistogram_;
+    bool isTimeHistogramKnown_ = true;
+};
+
+// Matchers of the last search, used again by the next searches of the same pattern,
+// e.g. updates of the search when the file grows. Used by one search at a time.
+struct SearchMatchers {
+    std::optional<RegularExpressionPattern> pattern;
+    RegexpEngine engine = RegexpEngine::Hyperscan;
+
+    std::unique_ptr<RegularExpression> expression;
+    klogg::vector<std::unique_ptr<PatternMatcher>> matchers;
+
+    // Bytes of the expression and the matchers, read without the lock
+    std::atomic<uint64_t> allocatedSize{ 0 };
 };
 
 class SearchOperation : public QObject {
     Q_OBJECT
   public:
     SearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
-                     const RegularExpressionPattern& regExp, LineNumber startLine,
-                     LineNumber endLine );
+                     SearchMatchers& matchers, const RegularExpressionPattern& regExp,
+                     LineNumber startLine, LineNumber endLine );
 
     // Run the search operation, returns true if it has been done
     // and false if it has been cancelled (results not copied)
     virtual void run( SearchData& result ) = 0;
 
+    // Progress of the blocks is written there instead of being signalled
+    void setProgress( OperationProgress* progress )
+    {
+        progress_ = progress;
+    }
+
+    // Only these lines between the start and end lines are searched, all if not set
+    void setSearchedLines( std::shared_ptr<const SearchResultArray> lines )
+    {
+        searchedLines_ = std::move( lines );
+    }
+
   Q_SIGNALS:
     void searchProgressed( LinesCount nbMatches, int percent, LineNumber initialLine );
     void searchFinished();
 
   protected:
+    // Progress of a block, the end of the search is always signalled
+    void reportProgress( LinesCount nbMatches, int percent, LineNumber initialLine );
+
     // Implement the common part of the search, passing
     // the shared results and the line to begin the search from.
-    void doSearch( SearchData& result, LineNumber initialLine );
+    // If focusLine is passed, lines around it are searched first.
+    // If counts are passed, matching lines are only counted and added to them.
+    void doSearch( SearchData& result, LineNumber initialLine, OptionalLineNumber focusLine = {},
+                   const MatchCounts* baseCounts = nullptr );
+
+    // Matchers of the pattern are created once and kept for the next searches
+    void prepareMatchers( uint32_t matchersCount );
+
+    // Matching lines counted by their time, if the histogram is enabled
+    void addToTimeHistogram( TimeHistogram& histogram,
+                             const klogg::vector<std::string_view>& lines, LineNumber firstLine,
+                             const SearchResultArray& matchingLines ) const;
 
     AtomicFlag& interruptRequested_;
+    SearchMatchers& matchers_;
     const RegularExpressionPattern regexp_;
     const LogData& sourceLogData_;
     LineNumber startLine_;
     LineNumber endLine_;
+    std::shared_ptr<const SearchResultArray> searchedLines_;
+
+    OperationProgress* progress_ = nullptr;
+
+    // Empty if matching lines are not counted by their time
+    std::optional<TimestampParser> timestampParser_;
 };
 
 class FullSearchOperation : public SearchOperation {
     Q_OBJECT
   public:
     FullSearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
-                         const RegularExpressionPattern& regExp, LineNumber startLine,
-                         LineNumber endLine )
-        : SearchOperation( sourceLogData, interruptRequested, regExp, startLine, endLine )
+                         SearchMatchers& matchers, const RegularExpressionPattern& regExp,
+                         LineNumber startLine, LineNumber endLine, OptionalLineNumber focusLine )
+        : SearchOperation( sourceLogData, interruptRequested, matchers, regExp, startLine,
+                           endLine )
+        , focusLine_( focusLine )
     {
     }
 
     void run( SearchData& result ) override;
+
+  private:
+    OptionalLineNumber focusLine_;
 };
 
 class UpdateSearchOperation : public SearchOperation {
     Q_OBJECT
   public:
     UpdateSearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
-                           const RegularExpressionPattern& regExp, LineNumber startLine,
-                           LineNumber endLine, LineNumber position )
-        : SearchOperation( sourceLogData, interruptRequested, regExp, startLine, endLine )
+                           SearchMatchers& matchers, const RegularExpressionPattern& regExp,
+                           LineNumber startLine, LineNumber endLine, LineNumber position )
+        : SearchOperation( sourceLogData, interruptRequested, matchers, regExp, startLine,
+                           endLine )
         , initialPosition_( position )
     {
     }
@@ -180,9 +312,55 @@ class UpdateSearchOperation : public SearchOperation {
     void run( SearchData& result ) override;
 
   private:
+    // Matches lines appended since the last update directly with the kept matcher,
+    // returns false if there are too many of them and the search graph is used instead.
+    bool searchAppendedLines( SearchData& result, LineNumber initialLine );
+
     LineNumber initialPosition_;
 };
 
+// Counts matching lines without keeping them, so memory doesn't grow with the matches
+class CountSearchOperation : public SearchOperation {
+    Q_OBJECT
+  public:
+    CountSearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
+                          SearchMatchers& matchers, const RegularExpressionPattern& regExp,
+                          LineNumber startLine, LineNumber endLine, MatchCounts counts )
+        : SearchOperation( sourceLogData, interruptRequested, matchers, regExp, startLine,
+                           endLine )
+        , counts_( std::move( counts ) )
+    {
+    }
+
+    void run( SearchData& result ) override;
+
+  private:
+    // Counts of the lines before the ones counted by the operation
+    MatchCounts counts_;
+};
+
+// Searches only lines matched by a wider pattern, e.g. the previous one the user has extended
+class RefineSearchOperation : public SearchOperation {
+    Q_OBJECT
+  public:
+    RefineSearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
+                           SearchMatchers& matchers, const RegularExpressionPattern& regExp,
+                           LineNumber startLine, LineNumber endLine,
+                           std::shared_ptr<const SearchResultArray> candidateLines )
+        : SearchOperation( sourceLogData, interruptRequested, matchers, regExp, startLine,
+                           endLine )
+        , candidateLines_( std::move( candidateLines ) )
+    {
+    }
+
+    void run( SearchData& result ) override;
+
+  private:
+    void doRefine( SearchData& result );
+
+    std::shared_ptr<const SearchResultArray> candidateLines_;
+};
+
 class LogFilteredDataWorker : public QObject {
     Q_OBJECT
 
@@ -197,17 +375,53 @@ class LogFilteredDataWorker : public QObject {
     LogFilteredDataWorker& operator=( LogFilteredDataWorker&& ) = delete;
 
     // Start the search with the passed regexp
-    void search( const RegularExpressionPattern& regExp, LineNumber startLine, LineNumber endLine );
+    // Lines around focusLine are searched first, e.g. the ones shown to the user
+    void search( const RegularExpressionPattern& regExp, LineNumber startLine, LineNumber endLine,
+                 OptionalLineNumber focusLine = {} );
     // Continue the previous search starting at the passed position
     // in the source file (line number)
     void updateSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
                        LineNumber endLine, LineNumber position );
+    // Search only the candidate lines, they must contain all lines matching the regexp
+    void refineSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
+                       LineNumber endLine,
+                       std::shared_ptr<const SearchResultArray> candidateLines );
+    // Count the lines matching the regexp without keeping them, also in buckets
+    // of consecutive lines of the file if the counts have them. Lines after the
+    // counted lines of the counts are counted and added to them.
+    void countMatches( const RegularExpressionPattern& regExp, LineNumber startLine,
+                       LineNumber endLine, MatchCounts counts );
+
+    // Next searches and counts only search these lines, all lines if not set.
+    // Refined searches search their candidate lines.
+    void setSearchedLines( std::shared_ptr<const SearchResultArray> lines );
 
     // Interrupts the search if one is in progress
     void interrupt();
 
+    // Drops search results from the passed line, waiting
+    // for the interrupted search to stop
+    void truncateSearch( LinesCount nbLines, LinesCount nbKeptMatches );
+
+    // Continues from results found before, e.g. loaded from a cache,
+    // waiting for the interrupted search to stop
+    void restoreSearch( LineLength maxLength, LinesCount nbLines, LinesCount nbMatches );
+
     // get the current indexing data
     SearchResults getSearchResults() const;
+    // get counts of the last count only search
+    MatchCounts getMatchCounts() const;
+    // get matching lines by their time
+    TimeHistogram getTimeHistogram() const;
+
+    // Bytes held by compiled patterns and matchers of the last search
+    uint64_t matchersSize() const;
+
+    // Progress of the running search, read by polling
+    const OperationProgress& progress() const
+    {
+        return progress_;
+    }
 
   Q_SIGNALS:
     // Sent during the indexing process to signal progress
@@ -227,8 +441,14 @@ class LogFilteredDataWorker : public QObject {
     QThreadPool operationsPool_;
     Mutex operationsMutex_;
 
+    // Protected by operationsMutex_
+    SearchMatchers searchMatchers_;
+    std::shared_ptr<const SearchResultArray> searchedLines_;
+
     // Shared indexing data
     SearchData searchData_;
+
+    OperationProgress progress_;
 };
 
 #endif
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LOGTEMPLATES_H
+#define KLOGG_LOGTEMPLATES_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <QString>
+
+#include <robin_hood.h>
+#include <roaring64map.hh>
+
+#include "atomicflag.h"
+#include "containers.h"
+#include "linetypes.h"
+
+class LogData;
+
+// Shapes of the messages of a file, e.g. "user <*> logged in from <*>",
+// with the lines of each shape.
+struct LogTemplates {
+    struct Template {
+        // Tokens of the lines separated by spaces, tokens that differ are "<*>"
+        QString text;
+        roaring::Roaring64Map lines;
+    };
+
+    // Most common first
+    klogg::vector<Template> templates;
+    LinesCount minedLines = 0_lcount;
+    // Lines that didn't fit any template when there were too many of them
+    LinesCount unclusteredLines = 0_lcount;
+
+    // Templates of the lines of the data when mining is started. Chunks of lines
+    // are mined in parallel, lines are mined until mining is interrupted.
+    static LogTemplates mine( const LogData& logData, const AtomicFlag& interruptRequested );
+};
+
+// Finds templates of lines as the Drain log parser does. Tokens with digits,
+// such as numbers, ids and times, are masked first. Lines are then grouped by
+// their number of tokens and first token, and each line joins the most similar
+// template of its group, tokens of the template that differ become "<*>".
+// Lines are added by one thread, miners of different threads are merged.
+class TemplateMiner {
+  public:
+    static constexpr size_t MaxTemplates = 4096;
+    static constexpr size_t MaxTokens = 64;
+    static constexpr std::string_view Wildcard = "<*>";
+
+    void add( std::string_view line, LineNumber lineNumber );
+    void merge( TemplateMiner&& other );
+
+    uint64_t unclusteredLines() const
+    {
+        return unclusteredLines_;
+    }
+
+    // Most common first
+    klogg::vector<LogTemplates::Template> takeTemplates();
+
+  private:
+    struct Cluster {
+        klogg::vector<std::string> tokens;
+        roaring::Roaring64Map lines;
+        uint64_t count = 0;
+    };
+
+    // Cluster of the group with most tokens equal to the passed ones, if enough of them are.
+    // If the group is full the most similar cluster is returned anyway.
+    template <typename Token>
+    Cluster* similarCluster( const klogg::vector<size_t>& group,
+                             const klogg::vector<Token>& tokens );
+
+    // There must be room for another cluster
+    template <typename Token>
+    Cluster& addCluster( klogg::vector<size_t>& group, const klogg::vector<Token>& tokens );
+
+    // Group of the tokens, empty if there is none and no room for another cluster
+    template <typename Token>
+    klogg::vector<size_t>* findGroup( const klogg::vector<Token>& tokens );
+
+    klogg::vector<Cluster> clusters_;
+    // Indices of clusters by the number of tokens and the first token
+    robin_hood::unordered_map<std::string, klogg::vector<size_t>> groups_;
+    uint64_t unclusteredLines_ = 0;
+
+    klogg::vector<std::string_view> lineTokens_;
+    std::string groupKey_;
+};
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_MEMORYGOVERNOR_H
+#define KLOGG_MEMORYGOVERNOR_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include "containers.h"
+#include "synchronization.h"
+
+// Keeps memory used by klogg within perf.memoryBudgetMb.
+// Caches of opened files register how much memory they hold and how to drop it.
+// When the process uses more memory than the budget, caches of the least
+// recently used files are dropped first, the current file is the last one.
+// Indexes of files are not dropped. Checks are done in the GUI thread.
+// Memory that can't be dropped is registered too, so the memory of each
+// file is accounted by the subsystem holding it.
+class MemoryGovernor : public QObject {
+    Q_OBJECT
+
+  public:
+    enum class Kind {
+        LineIndex,
+        SearchIndex,
+        SearchResults,
+        SearchCache,
+        ReadBuffers,
+        LineCache,
+        ViewCache,
+        RegexEngine,
+    };
+    static constexpr size_t KindsCount = static_cast<size_t>( Kind::RegexEngine ) + 1;
+
+    static const char* kindName( Kind kind );
+
+    // Memory held by the cache and dropping it, called in the GUI thread.
+    // Memory without evict is only accounted.
+    struct Cache {
+        std::function<uint64_t()> bytes;
+        std::function<void()> evict;
+    };
+
+    // Memory of one file, or of all files for the group without a file
+    struct GroupUsage {
+        QString name;
+        std::array<uint64_t, KindsCount> bytes{};
+    };
+
+    static MemoryGovernor& get();
+
+    // Caches of one owner belong to the group of a file, e.g. its LogData.
+    void addCache( const void* owner, const void* group, Kind kind, Cache cache );
+    void addUsage( const void* owner, const void* group, Kind kind,
+                   std::function<uint64_t()> bytes );
+    void removeCaches( const void* owner );
+
+    // Name shown for the memory of the group, e.g. the name of the file
+    void setGroupName( const void* group, const QString& name );
+
+    // Memory of each group, most recently used first. Called in the GUI thread.
+    klogg::vector<GroupUsage> usage() const;
+
+    // The file of the group is used, its caches are dropped after others
+    void markUsed( const void* group );
+
+    // Bytes of the budget, 0 if memory is not limited
+    static uint64_t budget();
+
+    // Drop caches until the memory used is within the budget
+    void enforceBudget();
+
+  private:
+    MemoryGovernor();
+
+  private:
+    struct RegisteredCache {
+        const void* owner;
+        const void* group;
+        Kind kind;
+        Cache cache;
+    };
+
+    mutable Mutex mutex_;
+    klogg::vector<RegisteredCache> caches_;
+    // Least recently used groups first
+    klogg::vector<const void*> groupsUsage_;
+    std::unordered_map<const void*, QString> groupNames_;
+
+    QTimer checkTimer_;
+};
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_MERGEDACCESS_H
+#define KLOGG_MERGEDACCESS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+#include "compressedaccess.h"
+#include "containers.h"
+#include "synchronization.h"
+
+class FileReader;
+
+// Lines of several logs interleaved by their timestamps, read through a merge
+// list: a text file with the path of one log per line. Relative paths start in
+// the directory of the list, empty lines and lines starting with # are skipped.
+//
+// A record is a line with a timestamp and the lines without one after it, e.g.
+// a stack trace. Records of all logs are merged by time once, when the access is
+// built, records with the same time keep the order of the logs in the list.
+// The merge order is kept as runs of consecutive records of one log, not per line.
+// Logs are expected to have the same ASCII compatible encoding.
+class MergedAccess : public CompressedAccess {
+  public:
+    // Timestamps are found at the beginning of lines
+    static constexpr qint64 MaxTimestampOffset = 256;
+
+    // Merge lists are found by the extension of their name
+    static bool isMergeList( const QString& fileName );
+
+    // Write the merge list of the logs, false if it can't be written
+    static bool writeMergeList( const QString& listFileName, const QStringList& logFileNames );
+
+    // Timestamps are parsed with the format of the timestamp index
+    MergedAccess( const QString& listFileName, const QString& timestampFormat );
+
+    // Read the list and the logs to merge their records
+    bool build( const ReadCompressed& readCompressed, qint64 compressedSize ) override;
+    bool isBuilt() const override;
+    qint64 size() const override;
+
+    // Logs of the built access
+    QStringList logFileNames() const;
+
+    std::unique_ptr<CompressedAccess::Reader> makeReader(
+        ReadCompressed readCompressed ) const override;
+
+    // Reads runs of the merged logs, the list is not read again
+    class Reader : public CompressedAccess::Reader {
+      public:
+        explicit Reader( std::shared_ptr<const MergedAccess> access );
+
+        qint64 read( qint64 offset, char* data, qint64 size ) override;
+        qint64 position() const override;
+
+      private:
+        std::shared_ptr<const MergedAccess> access_;
+        qint64 position_ = 0;
+    };
+
+  private:
+    // Consecutive bytes of one log in the merged data,
+    // the run ends where the next one starts
+    struct Run {
+        qint64 mergedOffset = 0;
+        qint64 logOffset = 0;
+        uint32_t log = 0;
+        // Last line of the log has no line feed, one is added after it
+        bool addsLineFeed = false;
+    };
+
+    void appendRun( uint32_t log, qint64 logOffset, qint64 size, bool addsLineFeed );
+
+    // Run with the offset of the merged data
+    klogg::vector<Run>::const_iterator findRun( qint64 offset ) const;
+
+  private:
+    const QString listFileName_;
+    const QString timestampFormat_;
+
+    Mutex buildMutex_;
+    std::atomic<bool> isBuilt_{ false };
+
+    // Written once before the access is built
+    qint64 size_ = 0;
+    QStringList logFileNames_;
+    klogg::vector<std::shared_ptr<const FileReader>> logs_;
+    klogg::vector<Run> runs_;
+};
+
+#endif
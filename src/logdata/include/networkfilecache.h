@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_NETWORKFILECACHE_H
+#define KLOGG_NETWORKFILECACHE_H
+
+#include <functional>
+#include <memory>
+
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+
+#include "containers.h"
+#include "fileholder.h"
+#include "synchronization.h"
+
+// Local copy of the blocks of a file on a network share. Blocks read from
+// the share are written to a file in the cache directory, so after the first
+// pass, which the indexing makes, pages, searches and reloads read them from
+// the local disk. Only complete blocks are kept, the block at the end of a
+// growing file is always read from the share. Blocks are checked by their
+// digests the first time they are read from the cache. If the file on the
+// share has changed since the blocks were cached, its first and last cached
+// blocks are compared with the share and the cache is kept only if the file
+// was appended to. The cache is shared by all readers of the file.
+class NetworkFileCache {
+  public:
+    static constexpr qint64 BlockSize = 1024 * 1024;
+
+    using ReadFunction = std::function<qint64( qint64 offset, char* data, qint64 size )>;
+
+    // Empty if caching is disabled or the file is not on a network share
+    static std::shared_ptr<NetworkFileCache> forFile( const QFile& file, const FileId& fileId );
+    // Cache of the file wherever it is, empty if the cache can't be written
+    static std::shared_ptr<NetworkFileCache> forAnyFile( const QFile& file, const FileId& fileId );
+
+    ~NetworkFileCache();
+
+    NetworkFileCache( const NetworkFileCache& ) = delete;
+    NetworkFileCache& operator=( const NetworkFileCache& ) = delete;
+
+    // Reads up to size bytes at offset, blocks that are not cached are read
+    // with readShare and cached. Returns the number of bytes read or -1.
+    qint64 read( qint64 offset, char* data, qint64 size, const ReadFunction& readShare );
+
+    size_t cachedBlocks() const;
+
+  private:
+    NetworkFileCache( const QString& fileName, const QString& cacheName, size_t maxBlocks );
+
+    void load();
+    void validate();
+    void reset();
+    void save();
+
+    bool readCachedBlock( size_t block, qint64 offset, char* data, qint64 size );
+    void storeBlock( size_t block, const char* data );
+
+  private:
+    QString fileName_;
+    QString metadataFileName_;
+
+    mutable Mutex mutex_;
+    QFile blocksFile_;
+
+    // Size and modification time of the file when the blocks were checked
+    qint64 fileSize_ = 0;
+    QDateTime lastModified_;
+
+    // Digests of cached blocks, 0 for blocks not cached
+    klogg::vector<uint64_t> digests_;
+    // Blocks whose data was checked against their digest
+    klogg::vector<bool> isChecked_;
+    // Blocks are not cached over the size limit of the cache
+    size_t maxBlocks_ = 0;
+    size_t nbCachedBlocks_ = 0;
+    size_t blocksSinceSave_ = 0;
+};
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_OPERATIONPROGRESS_H
+#define KLOGG_OPERATIONPROGRESS_H
+
+#include <atomic>
+#include <cstdint>
+
+// Progress of a running indexing or search. The operation updates it for
+// each block it processes and the GUI thread polls it on a timer, so updates
+// don't post events to the GUI thread. Signals are sent only when operations
+// start and finish. One thread updates the progress at a time, any thread
+// reads it without locks.
+class OperationProgress {
+  public:
+    // How often the GUI thread reads the progress
+    static constexpr int PollIntervalMs = 50;
+
+    struct State {
+        int percent = 0;
+        uint64_t matches = 0;
+        uint64_t initialLine = 0;
+        // Changed by each update
+        uint64_t generation = 0;
+    };
+
+    void update( int percent, uint64_t matches = 0, uint64_t initialLine = 0 )
+    {
+        // Odd sequence while the values are written
+        const auto sequence = sequence_.load( std::memory_order_relaxed );
+        sequence_.store( sequence + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+
+        percent_.store( percent, std::memory_order_relaxed );
+        matches_.store( matches, std::memory_order_relaxed );
+        initialLine_.store( initialLine, std::memory_order_relaxed );
+
+        sequence_.store( sequence + 2, std::memory_order_release );
+    }
+
+    State load() const
+    {
+        State state;
+        uint64_t sequence = 0;
+        do {
+            sequence = sequence_.load( std::memory_order_acquire );
+
+            state.percent = percent_.load( std::memory_order_relaxed );
+            state.matches = matches_.load( std::memory_order_relaxed );
+            state.initialLine = initialLine_.load( std::memory_order_relaxed );
+
+            std::atomic_thread_fence( std::memory_order_acquire );
+        } while ( ( sequence & 1 ) != 0
+                  || sequence != sequence_.load( std::memory_order_relaxed ) );
+
+        state.generation = sequence / 2;
+        return state;
+    }
+
+  private:
+    std::atomic<uint64_t> sequence_{ 0 };
+    std::atomic<int> percent_{ 0 };
+    std::atomic<uint64_t> matches_{ 0 };
+    std::atomic<uint64_t> initialLine_{ 0 };
+};
+
+#endif
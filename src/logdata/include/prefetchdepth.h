@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_PREFETCHDEPTH_H
+#define KLOGG_PREFETCHDEPTH_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+
+#include "atomicflag.h"
+#include "synchronization.h"
+
+// Number of blocks read ahead of indexing. A fixed number is either too small to
+// keep indexing busy while a slow disk or a network share stalls, or takes memory
+// a fast disk doesn't need. An adaptive depth follows the times blocks take to be
+// read and to be indexed: it is recomputed for each window of indexed blocks, so
+// that blocks read ahead keep indexing busy for as long as the slowest read of
+// the window took. The reader sends a block only while the depth allows it,
+// it sleeps until a block is indexed otherwise.
+class PrefetchDepth {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t MaxAdaptiveDepth = 64;
+    static constexpr size_t WindowBlocks = 16;
+
+    // Depth is fixed to the initial one unless it is adaptive,
+    // adaptive depth is never less than the minimum
+    PrefetchDepth( size_t initialDepth, size_t minDepth, bool isAdaptive );
+
+    size_t depth() const
+    {
+        return depth_.load( std::memory_order_relaxed );
+    }
+
+    size_t maxDepth() const
+    {
+        return maxDepth_;
+    }
+
+    // Called by the reader
+    bool canSend() const
+    {
+        return inFlight_.load( std::memory_order_acquire ) < static_cast<int64_t>( depth() );
+    }
+    void blockSent()
+    {
+        ++inFlight_;
+    }
+    void blockRead( std::chrono::microseconds duration );
+    // Returns false if interrupted before the depth allows to send a block
+    bool waitToSend( const AtomicFlag& interruptRequest );
+
+    // Called when the block is done with, blocks are indexed in order
+    void blockIndexed( Clock::time_point time );
+
+  private:
+    const size_t minDepth_;
+    const size_t maxDepth_;
+    const bool isAdaptive_;
+
+    std::atomic<size_t> depth_;
+    // Block can be indexed before the reader counts it as sent
+    std::atomic<int64_t> inFlight_{ 0 };
+
+    Mutex mutex_;
+    std::condition_variable_any blockIndexed_;
+    std::chrono::microseconds slowestRead_{ 0 };
+    std::chrono::microseconds indexingDuration_{ 0 };
+    size_t indexedBlocks_ = 0;
+    Clock::time_point lastIndexed_{};
+};
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_SEARCHRESULTSCACHE_H
+#define KLOGG_SEARCHRESULTSCACHE_H
+
+#include <memory>
+#include <optional>
+
+#include <QByteArray>
+#include <QString>
+
+#include "linetypes.h"
+#include "logdataworker.h"
+#include "logfiltereddataworker.h"
+#include "regularexpressionpattern.h"
+
+class QTemporaryFile;
+
+// Results of searches in large files are kept on disk between sessions.
+// Cached results are used only if header and tail digests show that
+// the file was only appended to since they were found.
+
+// Lines of a file as they are seen by searches
+struct SearchedContent {
+    QString fileName;
+    IndexedHash hash;
+    // Lines are numbered from the beginning of the file
+    bool isFromFileStart = false;
+
+    QByteArray encoding;
+    QString prefilter;
+    bool hideAnsiColorSequences = false;
+};
+
+struct CachedSearchResults {
+    SearchResultArray matchingLines;
+    LineLength maxLength;
+    // Lines before it were searched
+    LineNumber endLine;
+};
+
+// Results of the search started at startLine, they can cover fewer
+// lines than the content has if the file was appended to.
+// Returns nothing if there is no valid cache entry.
+std::optional<CachedSearchResults> loadCachedSearchResults( const SearchedContent& content,
+                                                            const RegularExpressionPattern& pattern,
+                                                            LineNumber startLine );
+
+// Writes results of the search to the cache, small files are skipped.
+void saveSearchResultsToCache( const SearchedContent& content,
+                               const RegularExpressionPattern& pattern, LineNumber startLine,
+                               LineNumber endLine, const SearchResultArray& matchingLines,
+                               LineLength maxLength );
+
+// Results too large for the memory cache of a session are written
+// to a temporary file in the portable format and mapped read-only.
+// Their pages belong to the page cache, so the system can drop them
+// under memory pressure, and they are read back when the same search
+// is run again. The file is removed with the results.
+class MappedSearchResults {
+  public:
+    // Returns nothing if the file can't be written or mapped
+    static std::unique_ptr<MappedSearchResults> create( const SearchResultArray& matchingLines );
+
+    ~MappedSearchResults();
+
+    MappedSearchResults( const MappedSearchResults& ) = delete;
+    MappedSearchResults& operator=( const MappedSearchResults& ) = delete;
+
+    std::optional<SearchResultArray> load() const;
+
+    uint64_t size() const
+    {
+        return static_cast<uint64_t>( size_ );
+    }
+
+  private:
+    MappedSearchResults() = default;
+
+  private:
+    std::unique_ptr<QTemporaryFile> file_;
+    const uchar* data_ = nullptr;
+    qint64 size_ = 0;
+};
+
+#endif
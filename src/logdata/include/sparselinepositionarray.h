@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_SPARSELINEPOSITIONARRAY_H
+#define KLOGG_SPARSELINEPOSITIONARRAY_H
+
+#include <functional>
+
+#include "compressedlinestorage.h"
+#include "containers.h"
+#include "linepositionarray.h"
+#include "linetypes.h"
+#include "synchronization.h"
+
+// List of end of lines positions for files too big to keep all of them.
+//
+// Only the end of every Step-th line is stored, ends of lines in between are
+// found by scanning the data of their group of lines when they are accessed.
+// A few recently scanned groups are cached. Ends of the lines after the last
+// stored one are kept as is, so the last line can be replaced if its final LF
+// is fake. Lines are indexed from the beginning of the file.
+class SparseLinePositionArray {
+  public:
+    static constexpr LinesCount::UnderlyingType DefaultStep = 64;
+
+    // Returns ends of lines terminated in the data between begin and end
+    using LineEndsScanner
+        = std::function<klogg::vector<OffsetInFile>( OffsetInFile begin, OffsetInFile end )>;
+
+    explicit SparseLinePositionArray( LineEndsScanner scanner,
+                                      LinesCount::UnderlyingType step = DefaultStep );
+
+    SparseLinePositionArray( const SparseLinePositionArray& ) = delete;
+    SparseLinePositionArray& operator=( const SparseLinePositionArray& ) = delete;
+
+    // Add another list to this one, removing any fake LF on this list.
+    // Invariant: all pos in other must be greater than any pos in this
+    void append_list( const FastLinePositionArray& other );
+
+    LinesCount size() const
+    {
+        return LinesCount( checkpoints_.size().get() * step_ + tail_.size() );
+    }
+
+    size_t allocatedSize() const;
+
+    bool hasFakeFinalLF() const
+    {
+        return fakeFinalLF_;
+    }
+
+    // End of the line, lines not stored are found by the scanner
+    OffsetInFile at( LineNumber line ) const;
+
+    // Keep only the first newSize lines, the last one is always a real end of line
+    void truncate( LinesCount newSize );
+
+  private:
+    struct ScannedGroup {
+        LinesCount::UnderlyingType group;
+        klogg::vector<OffsetInFile> lineEnds;
+    };
+
+    static constexpr size_t CachedGroups = 16;
+
+    void append( OffsetInFile pos );
+
+    // End of a line in a group before its stored end
+    OffsetInFile scannedLineEnd( LinesCount::UnderlyingType group,
+                                 LinesCount::UnderlyingType lineInGroup ) const;
+
+    LineEndsScanner scanner_;
+    LinesCount::UnderlyingType step_;
+
+    // End of the last line of each complete group
+    CompressedLinePositionStorage checkpoints_;
+    // Ends of lines after the last checkpoint, at most step_ of them
+    klogg::vector<OffsetInFile> tail_;
+    bool fakeFinalLF_ = false;
+
+    // Most recently used groups first
+    mutable Mutex cacheMutex_;
+    mutable klogg::vector<ScannedGroup> cache_;
+};
+
+#endif
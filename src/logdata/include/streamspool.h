@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_STREAMSPOOL_H
+#define KLOGG_STREAMSPOOL_H
+
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <thread>
+
+#include <QString>
+#include <QtGlobal>
+
+// Data of a stream, e.g. the standard input of a pipe, written to a spool file
+// that is opened as a log and followed as it grows, so it is indexed and
+// searched as more data is added. A thread reads the stream and appends what
+// each read gets to the file at once, so lines of a slow stream are shown
+// without waiting for buffers to fill. A limited spool keeps the newer half
+// of the data when the file reaches the limit: lines after the middle are written
+// to a new file that replaces the spool file, and the log loads them again.
+class StreamSpool {
+  public:
+    // Size limit of 0 lets the file grow while the stream has data
+    StreamSpool( int inputDescriptor, const QString& fileName, qint64 sizeLimit );
+    // Spooling stops, a thread waiting for the stream is left to end with the process
+    ~StreamSpool();
+
+    StreamSpool( const StreamSpool& ) = delete;
+    StreamSpool& operator=( const StreamSpool& ) = delete;
+
+    QString fileName() const;
+
+    // Stream has ended or can't be spooled anymore
+    bool isAtEnd() const;
+    // Bytes dropped from the beginning of the file to keep it within the limit
+    qint64 droppedBytes() const;
+
+    // Offset in the data at the middle of the file where the kept lines start,
+    // the data starts at an even offset of the file
+    static qint64 findKeptStart( std::string_view data );
+
+  private:
+    struct State {
+        int inputDescriptor = -1;
+        QString fileName;
+        qint64 sizeLimit = 0;
+
+        std::atomic<bool> isStopping{ false };
+        std::atomic<bool> isAtEnd{ false };
+        std::atomic<qint64> droppedBytes{ 0 };
+    };
+
+    static void spool( const std::shared_ptr<State>& state );
+
+  private:
+    // Shared with the thread that can outlive the spool
+    std::shared_ptr<State> state_;
+    std::thread thread_;
+};
+
+#endif
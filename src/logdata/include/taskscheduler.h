@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TASKSCHEDULER_H
+#define KLOGG_TASKSCHEDULER_H
+
+#include <memory>
+#include <utility>
+
+#include <QString>
+
+#include <tbb/global_control.h>
+#include <tbb/task_arena.h>
+
+#include "containers.h"
+#include "synchronization.h"
+
+enum class TaskPriority { Foreground, Background };
+
+// Indexing and searches of all opened files share the TBB threads.
+// Work of the current tab runs in an arena of higher priority, so it is
+// not slowed down by files loading in background tabs. The total number
+// of threads is limited by perf.maxConcurrency, read once at start.
+//
+// With perf.useNumaArenas on machines with several NUMA nodes each node has its
+// own arenas, with threads bound to the cores of the node. Each file is assigned
+// to a node, so buffers allocated while indexing and searching it are in the
+// memory of the node whose threads read them.
+class TaskScheduler {
+  public:
+    // Work that is not assigned to a node runs on all nodes
+    static constexpr int AnyNode = -1;
+
+    static TaskScheduler& get();
+
+    TaskScheduler( const TaskScheduler& ) = delete;
+    TaskScheduler& operator=( const TaskScheduler& ) = delete;
+
+    TaskScheduler( TaskScheduler&& ) = delete;
+    TaskScheduler& operator=( TaskScheduler&& ) = delete;
+
+    // Runs the function in the calling thread inside the arena of the priority,
+    // TBB algorithms and graphs created by it run in that arena too.
+    template <typename F>
+    auto execute( TaskPriority priority, F&& f ) -> decltype( f() )
+    {
+        return execute( priority, AnyNode, std::forward<F>( f ) );
+    }
+
+    // Same in the arena of the node, threads entering it are bound to the node
+    template <typename F>
+    auto execute( TaskPriority priority, int node, F&& f ) -> decltype( f() )
+    {
+        return arena( priority, node ).execute( std::forward<F>( f ) );
+    }
+
+    // Node with the fewest files assigned, AnyNode if arenas are not bound to nodes.
+    // Each acquired node is released when the file is closed.
+    int acquireNode();
+    void releaseNode( int node );
+
+    int maxConcurrency() const;
+
+  private:
+    TaskScheduler();
+
+    struct NodeArenas {
+        NodeArenas( int id, int concurrency );
+
+        QString metricsName( const char* name ) const;
+
+        int nodeId;
+        int files = 0;
+
+        tbb::task_arena foreground;
+        tbb::task_arena background;
+    };
+
+    tbb::task_arena& arena( TaskPriority priority, int node );
+
+  private:
+    int maxConcurrency_;
+    std::unique_ptr<tbb::global_control> concurrencyControl_;
+
+    tbb::task_arena foreground_;
+    tbb::task_arena background_;
+
+    // Empty if arenas are not bound to nodes
+    klogg::vector<std::unique_ptr<NodeArenas>> nodes_;
+    Mutex nodesMutex_;
+};
+
+#endif
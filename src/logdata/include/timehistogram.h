@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TIMEHISTOGRAM_H
+#define KLOGG_TIMEHISTOGRAM_H
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string_view>
+
+#include <QString>
+
+#include "containers.h"
+#include "linetypes.h"
+
+// Parses timestamps at the beginning of UTF-8 lines like TimestampIndex does.
+// Formats made of fixed width numeric fields, e.g. "yyyy-MM-dd HH:mm:ss.zzz",
+// are parsed in place, lines are converted to QString for other formats.
+// Parsing is thread-safe.
+class TimestampParser {
+  public:
+    explicit TimestampParser( const QString& format );
+
+    // Seconds since epoch of the time as it is written, time zones are ignored
+    std::optional<int64_t> parse( std::string_view line ) const;
+    // Same in milliseconds
+    std::optional<int64_t> parseMilliseconds( std::string_view line ) const;
+
+    // Format is parsed without QDateTime
+    bool isFast() const
+    {
+        return !fields_.empty();
+    }
+
+  private:
+    enum class FieldType { Literal, Year, Month, Day, Hour, Minute, Second, Millisecond };
+
+    struct Field {
+        FieldType type;
+        // Digits of a number or the character of a literal
+        int width;
+        char literal;
+    };
+
+    std::optional<int64_t> parseFields( std::string_view text ) const;
+    std::optional<int64_t> parseWithQt( std::string_view text ) const;
+
+    QString format_;
+    klogg::vector<Field> fields_;
+};
+
+// Numbers of matching lines per interval of time, found by a search. Intervals
+// get wider as more of them are needed, so there are at most MaxBuckets of them.
+// Intervals are aligned to multiples of their width since epoch.
+class TimeHistogram {
+  public:
+    static constexpr size_t MaxBuckets = 2048;
+
+    struct Bucket {
+        // Seconds since epoch
+        int64_t start = 0;
+        uint64_t count = 0;
+        // First and last matching lines with a time in the interval
+        LineNumber firstLine;
+        LineNumber lastLine;
+        // Some lines of the interval were dropped by a truncation, the count is not known
+        bool isKnown = true;
+    };
+
+    void add( int64_t time, LineNumber line );
+    void merge( const TimeHistogram& other );
+
+    // Drop intervals which first line is not kept, intervals having both kept
+    // and dropped lines are not known anymore
+    void truncate( LinesCount keptLines );
+    void clear();
+
+    bool isEmpty() const
+    {
+        return buckets_.empty();
+    }
+
+    int64_t bucketSeconds() const
+    {
+        return bucketSeconds_;
+    }
+
+    // In time order
+    klogg::vector<Bucket> buckets() const;
+
+  private:
+    // Rebuckets at the first width that is not narrower and keeps at most MaxBuckets
+    void widen( int64_t seconds );
+
+    int64_t bucketSeconds_ = 1;
+    // Buckets by their start divided by the width
+    std::map<int64_t, Bucket> buckets_;
+};
+
+#endif
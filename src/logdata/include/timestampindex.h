@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_TIMESTAMPINDEX_H
+#define KLOGG_TIMESTAMPINDEX_H
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+#include <QString>
+
+#include <robin_hood.h>
+
+#include "containers.h"
+#include "linetypes.h"
+#include "synchronization.h"
+
+// Times of the first lines of blocks of the file, found on demand
+// to look up lines by time.
+//
+// Timestamps are parsed with a QDateTime format at the beginning of lines,
+// lines without one (e.g. continuation of a multiline message) belong to
+// the previous timestamp. Lines are expected to be in time order.
+// Sampled times are kept until the lines change, so looking up a time takes
+// a logarithmic number of line reads. This class is thread-safe.
+class TimestampIndex {
+  public:
+    using LinesReader = std::function<klogg::vector<QString>( LineNumber, LinesCount )>;
+
+    // Lines in a block with one sampled time
+    static constexpr uint64_t SampleInterval = 256;
+
+    explicit TimestampIndex( const QString& format = {} );
+
+    TimestampIndex( const TimestampIndex& ) = delete;
+    TimestampIndex& operator=( const TimestampIndex& ) = delete;
+
+    // Sampled times are dropped if the format changes
+    void setFormat( const QString& format );
+    QString format() const;
+
+    // Milliseconds since epoch of the timestamp at the beginning of the line,
+    // the timestamp can follow spaces or an opening bracket.
+    std::optional<qint64> parse( const QString& line ) const;
+
+    // Drop times of the lines that are not kept
+    void truncate( LinesCount keptLines );
+    void clear();
+
+    // First line with a timestamp not earlier than the time,
+    // the number of lines if all timestamps are earlier.
+    LineNumber lineAtTime( qint64 time, LinesCount nbLines, const LinesReader& readLines );
+
+  private:
+    std::optional<qint64> parseWithFormat( const QString& line, const QString& format ) const;
+
+    // Time of the first line with a timestamp among the first ones of the block
+    std::optional<qint64> blockTime( uint64_t block, LinesCount nbLines,
+                                     const LinesReader& readLines );
+
+    mutable Mutex mutex_;
+
+    QString format_;
+    robin_hood::unordered_flat_map<uint64_t, std::optional<qint64>> blockTimes_;
+};
+
+#endif
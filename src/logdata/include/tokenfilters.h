@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TOKENFILTERS_H
+#define KLOGG_TOKENFILTERS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <QtGlobal>
+
+#include "containers.h"
+#include "synchronization.h"
+
+class QDataStream;
+
+// Bloom filter of the tokens of each block of file data.
+//
+// Tokens are runs of ASCII letters and digits. Blocks are added in file order
+// as they are indexed, a token spanning two blocks belongs to the second one.
+// Filters are sized by the number of different tokens in a block. Searches
+// use them to skip parts of the file that can't contain whole words of a
+// literal. This class is thread-safe, blocks are added by one thread.
+class TokenFilters {
+  public:
+    explicit TokenFilters( qint64 startOffset = 0 );
+
+    TokenFilters( const TokenFilters& ) = delete;
+    TokenFilters& operator=( const TokenFilters& ) = delete;
+
+    // Tokens of the text that are whole tokens of lines containing it,
+    // edges of the text may be known to be token boundaries.
+    static klogg::vector<std::string> wholeTokens( std::string_view text, bool isTokenStart,
+                                                   bool isTokenEnd );
+
+    // Data from the start offset to the end of the last block is filtered
+    qint64 startOffset() const;
+    qint64 endOffset() const;
+
+    // Block must start at the end offset, otherwise filters stop being used
+    void addBlock( qint64 offset, std::string_view data );
+
+    // Add blocks of the filters starting at the end of these ones
+    void append( const TokenFilters& other );
+
+    // False only if one of the tokens is in none of the blocks between begin and end,
+    // parts of the file that are not filtered may contain anything.
+    bool mayContain( qint64 begin, qint64 end, const klogg::vector<std::string>& tokens ) const;
+
+    size_t allocatedSize() const;
+
+    void write( QDataStream& stream ) const;
+    bool read( QDataStream& stream );
+
+  private:
+    struct BlockFilter {
+        qint64 offset;
+        size_t firstWord;
+        size_t wordsCount;
+    };
+
+    mutable Mutex mutex_;
+
+    qint64 startOffset_;
+    qint64 endOffset_;
+    bool isValid_ = true;
+
+    // Beginning of the token at the end of the previous block
+    std::string lastToken_;
+
+    klogg::vector<BlockFilter> blocks_;
+    // Bits of all filters
+    klogg::vector<uint64_t> words_;
+
+    // Hashes of tokens of the block being added, only used by the indexing thread
+    klogg::vector<uint64_t> blockHashes_;
+};
+
+#endif
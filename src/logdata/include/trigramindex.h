@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TRIGRAMINDEX_H
+#define KLOGG_TRIGRAMINDEX_H
+
+#include <cstdint>
+#include <string_view>
+
+#include <QtGlobal>
+
+#include <robin_hood.h>
+#include <roaring.hh>
+
+#include "containers.h"
+#include "synchronization.h"
+
+class QDataStream;
+
+// Blocks of file data each trigram of bytes was found in.
+//
+// Blocks are added in file order as they are indexed, a trigram spanning
+// two blocks belongs to the second one. Searches use it to skip parts of the
+// file that can't contain a literal. This class is thread-safe, blocks are
+// added by one thread.
+class TrigramIndex {
+  public:
+    explicit TrigramIndex( qint64 startOffset = 0 );
+
+    TrigramIndex( const TrigramIndex& ) = delete;
+    TrigramIndex& operator=( const TrigramIndex& ) = delete;
+
+    // Data from the start offset to the end of the last block is indexed
+    qint64 startOffset() const;
+    qint64 endOffset() const;
+
+    // Block must start at the end offset, otherwise the index stops being used
+    void addBlock( qint64 offset, std::string_view data );
+
+    // Add blocks of the index starting at the end of this one
+    void append( const TrigramIndex& other );
+
+    // False only if the bytes between begin and end can't contain the text,
+    // parts of the file that are not indexed may contain anything.
+    bool mayContain( qint64 begin, qint64 end, std::string_view text ) const;
+
+    // Compress bitmaps once all blocks are added
+    void optimize();
+
+    size_t allocatedSize() const;
+
+    void write( QDataStream& stream ) const;
+    bool read( QDataStream& stream );
+
+  private:
+    static constexpr uint32_t TrigramMask = 0xffffff;
+
+    mutable Mutex mutex_;
+
+    qint64 startOffset_;
+    qint64 endOffset_;
+    bool isValid_ = true;
+
+    // Last bytes of the previous block start trigrams of the next one
+    uint32_t lastBytes_{};
+    uint32_t lastBytesCount_{};
+
+    // Start offset of each block
+    klogg::vector<qint64> blockOffsets_;
+    robin_hood::unordered_flat_map<uint32_t, roaring::Roaring> blocks_;
+
+    // Trigrams found in the block being added, only used by the indexing thread
+    klogg::vector<uint64_t> seenTrigrams_;
+    klogg::vector<uint32_t> blockTrigrams_;
+};
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_ZSTDACCESS_H
+#define KLOGG_ZSTDACCESS_H
+
+#ifdef KLOGG_HAS_ZSTD
+
+#include <cstdint>
+
+#include <QtGlobal>
+
+#include "framedaccess.h"
+
+// Random access to the decompressed data of a seekable zstd file,
+// made of independent frames followed by a seek table of their sizes.
+class ZstdAccess : public FramedAccess {
+  public:
+    // Last bytes of the seek table footer
+    static constexpr uint32_t SeekableMagic = 0x8F92EAB1;
+
+  private:
+    // Frames from the seek table
+    bool readFrames( const ReadCompressed& readCompressed, qint64 compressedSize,
+                     klogg::vector<Frame>& frames ) const override;
+
+    bool decompressFrame( const char* compressed, qint64 compressedSize, char* data,
+                          qint64 size ) const override;
+};
+
+#endif
+
+#endif
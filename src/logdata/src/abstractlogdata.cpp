@@ -69,6 +69,26 @@ klogg::vector<QString> AbstractLogData::getExpandedLines( LineNumber first_line,
     return doGetExpandedLines( first_line, number );
 }
 
+// Simple wrapper in order to use a clean Template Method
+QString AbstractLogData::getExpandedLineWindow( LineNumber line, LineColumn firstColumn,
+                                                LineLength length ) const
+{
+    return doGetExpandedLineWindow( line, firstColumn, length );
+}
+
+// Simple wrapper in order to use a clean Template Method
+qint64 AbstractLogData::getLineSize( LineNumber line ) const
+{
+    return doGetLineSize( line );
+}
+
+// Simple wrapper in order to use a clean Template Method
+std::optional<QByteArray> AbstractLogData::getLinesBytes( LineNumber first_line,
+                                                          LinesCount number ) const
+{
+    return doGetLinesBytes( first_line, number );
+}
+
 LineNumber AbstractLogData::getLineNumber( LineNumber index ) const
 {
     LineNumber ln = doGetLineNumber( index );
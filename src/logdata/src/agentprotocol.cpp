@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "agentprotocol.h"
+
+#include <exception>
+
+#include <QtEndian>
+
+#include "log.h"
+
+namespace agent {
+
+namespace {
+constexpr int SizeFieldSize = sizeof( quint32 );
+constexpr int TypeFieldSize = sizeof( quint8 );
+} // namespace
+
+QByteArray encodeMessage( MessageType type, const QByteArray& payload )
+{
+    QByteArray message( SizeFieldSize, Qt::Uninitialized );
+    qToBigEndian( static_cast<quint32>( TypeFieldSize + payload.size() ), message.data() );
+    message.append( static_cast<char>( type ) );
+    message.append( payload );
+    return message;
+}
+
+void MessageReader::append( const QByteArray& data )
+{
+    if ( !isBroken_ ) {
+        buffer_.append( data );
+    }
+}
+
+std::optional<Message> MessageReader::next()
+{
+    if ( isBroken_ || buffer_.size() < SizeFieldSize ) {
+        return {};
+    }
+
+    const auto size = qFromBigEndian<quint32>( buffer_.constData() );
+    if ( size < TypeFieldSize || size > static_cast<quint32>( MaxMessageSize ) ) {
+        LOG_WARNING << "Invalid agent message size " << size;
+        isBroken_ = true;
+        buffer_.clear();
+        return {};
+    }
+
+    const auto messageSize = SizeFieldSize + static_cast<int>( size );
+    if ( buffer_.size() < messageSize ) {
+        return {};
+    }
+
+    Message message{ static_cast<MessageType>( buffer_.at( SizeFieldSize ) ),
+                     buffer_.mid( SizeFieldSize + TypeFieldSize,
+                                  messageSize - SizeFieldSize - TypeFieldSize ) };
+    buffer_.remove( 0, messageSize );
+    return message;
+}
+
+QByteArray encodeLines( const SearchResultArray& lines )
+{
+    QByteArray data( static_cast<int>( lines.getSizeInBytes( true ) ), Qt::Uninitialized );
+    lines.write( data.data(), true );
+    return data;
+}
+
+std::optional<SearchResultArray> decodeLines( const QByteArray& data )
+{
+    try {
+        return SearchResultArray::readSafe( data.constData(), static_cast<size_t>( data.size() ) );
+    } catch ( const std::exception& err ) {
+        LOG_WARNING << "Can't read lines of agent message: " << err.what();
+        return {};
+    }
+}
+
+} // namespace agent
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ansicolorsequences.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr char Escape = '\x1B';
+
+bool isDigit( char c )
+{
+    return c >= '0' && c <= '9';
+}
+
+// Length of the color sequence at the beginning of the text, 0 if there is none
+size_t colorSequenceLength( std::string_view text )
+{
+    if ( text.size() < 3 || text[ 0 ] != Escape || text[ 1 ] != '[' ) {
+        return 0;
+    }
+
+    size_t pos = 2;
+    const auto skipNumber = [ &text, &pos ]() {
+        size_t digits = 0;
+        while ( digits < 2 && pos < text.size() && isDigit( text[ pos ] ) ) {
+            ++pos;
+            ++digits;
+        }
+        return digits;
+    };
+
+    if ( skipNumber() > 0 && pos < text.size() && text[ pos ] == ';' ) {
+        // Semicolon is only a part of the sequence if a number follows it
+        const auto semicolon = pos++;
+        if ( skipNumber() == 0 ) {
+            pos = semicolon;
+        }
+    }
+
+    if ( pos < text.size() ) {
+        switch ( text[ pos ] ) {
+        case 'm':
+        case 'M':
+        case 'k':
+        case 'K':
+            return pos + 1;
+        default:
+            break;
+        }
+    }
+
+    return 0;
+}
+} // namespace
+
+size_t stripAnsiColorSequences( std::string_view text, char* out )
+{
+    const auto* const outBegin = out;
+
+    while ( !text.empty() ) {
+        // Plain text is copied at once, find uses vectorized memchr
+        const auto plainSize = std::min( text.find( Escape ), text.size() );
+        std::memmove( out, text.data(), plainSize );
+        out += plainSize;
+        text.remove_prefix( plainSize );
+
+        if ( text.empty() ) {
+            break;
+        }
+
+        const auto sequenceLength = colorSequenceLength( text );
+        if ( sequenceLength > 0 ) {
+            text.remove_prefix( sequenceLength );
+        }
+        else {
+            *out++ = Escape;
+            text.remove_prefix( 1 );
+        }
+    }
+
+    return static_cast<size_t>( out - outBegin );
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgzfaccess.h"
+
+#include <algorithm>
+
+#include <QtEndian>
+
+#include <zlib.h>
+
+#include "log.h"
+
+namespace {
+// Block headers are read in chunks holding many blocks
+constexpr qint64 HeadersBufferSize = 1024 * 1024;
+
+// CRC32 and size of the data
+constexpr qint64 GzipTrailerSize = 8;
+
+constexpr int GzipWindowBits = 15 + 16;
+} // namespace
+
+bool BgzfAccess::isBgzfHeader( const char* data, qint64 size )
+{
+    // Gzip member with extra field starting with the BC subfield of the block size
+    const auto* bytes = reinterpret_cast<const unsigned char*>( data );
+    return size >= BlockHeaderSize && bytes[ 0 ] == 0x1f && bytes[ 1 ] == 0x8b && bytes[ 2 ] == 8
+           && ( bytes[ 3 ] & 0x04 ) != 0 && bytes[ 12 ] == 'B' && bytes[ 13 ] == 'C'
+           && qFromLittleEndian<quint16>( data + 14 ) == 2;
+}
+
+bool BgzfAccess::build( const ReadCompressed& readCompressed, qint64 compressedSize )
+{
+    ScopedLock lock( buildMutex_ );
+    if ( !isGzip_ && FramedAccess::build( readCompressed, compressedSize ) ) {
+        return true;
+    }
+
+    if ( !isGzip_ ) {
+        LOG_INFO << "File is not made of BGZF blocks, reading it as gzip";
+        gzipAccess_ = std::make_shared<GzipAccess>();
+        isGzip_ = true;
+    }
+    return gzipAccess_->build( readCompressed, compressedSize );
+}
+
+bool BgzfAccess::isBuilt() const
+{
+    return isGzip_ ? gzipAccess_->isBuilt() : FramedAccess::isBuilt();
+}
+
+qint64 BgzfAccess::size() const
+{
+    return isGzip_ ? gzipAccess_->size() : FramedAccess::size();
+}
+
+std::unique_ptr<CompressedAccess::Reader>
+BgzfAccess::makeReader( ReadCompressed readCompressed ) const
+{
+    return isGzip_ ? gzipAccess_->makeReader( std::move( readCompressed ) )
+                   : FramedAccess::makeReader( std::move( readCompressed ) );
+}
+
+bool BgzfAccess::readFrames( const ReadCompressed& readCompressed, qint64 compressedSize,
+                             klogg::vector<Frame>& frames ) const
+{
+    klogg::vector<char> buffer( static_cast<size_t>( HeadersBufferSize ) );
+    qint64 bufferStart = 0;
+    qint64 bufferEnd = 0;
+
+    // Data of the file in the buffer, read from the offset if it is not there
+    const auto dataAt = [ & ]( qint64 offset, qint64 size ) -> const char* {
+        if ( offset < bufferStart || offset + size > bufferEnd ) {
+            const auto toRead = std::min( HeadersBufferSize, compressedSize - offset );
+            if ( toRead < size || !readExactly( readCompressed, offset, buffer.data(), toRead ) ) {
+                return nullptr;
+            }
+            bufferStart = offset;
+            bufferEnd = offset + toRead;
+        }
+        return buffer.data() + ( offset - bufferStart );
+    };
+
+    qint64 offset = 0;
+    while ( offset < compressedSize ) {
+        const auto* header = dataAt( offset, BlockHeaderSize );
+        if ( header == nullptr || !isBgzfHeader( header, BlockHeaderSize ) ) {
+            LOG_WARNING << "Invalid BGZF block at " << offset;
+            return false;
+        }
+
+        const auto blockSize = static_cast<qint64>( qFromLittleEndian<quint16>( header + 16 ) ) + 1;
+        const auto* block = blockSize >= BlockHeaderSize + GzipTrailerSize
+                                ? dataAt( offset, blockSize )
+                                : nullptr;
+        if ( block == nullptr ) {
+            LOG_WARNING << "Invalid BGZF block size at " << offset;
+            return false;
+        }
+
+        Frame frame;
+        frame.compressedOffset = offset;
+        frame.compressedSize = blockSize;
+        frame.decompressedSize = qFromLittleEndian<quint32>( block + blockSize - 4 );
+        frames.push_back( frame );
+
+        offset += blockSize;
+    }
+
+    return true;
+}
+
+bool BgzfAccess::decompressFrame( const char* compressed, qint64 compressedSize, char* data,
+                                  qint64 size ) const
+{
+    z_stream stream{};
+    if ( inflateInit2( &stream, GzipWindowBits ) != Z_OK ) {
+        return false;
+    }
+
+    // Empty blocks, e.g. the end of file marker, still need an output buffer
+    char empty = 0;
+    stream.next_in = reinterpret_cast<Bytef*>( const_cast<char*>( compressed ) );
+    stream.avail_in = static_cast<uInt>( compressedSize );
+    stream.next_out = reinterpret_cast<Bytef*>( size > 0 ? data : &empty );
+    stream.avail_out = static_cast<uInt>( size > 0 ? size : 1 );
+
+    const auto result = inflate( &stream, Z_FINISH );
+    const auto decompressedSize = static_cast<qint64>( stream.total_out );
+    inflateEnd( &stream );
+
+    return result == Z_STREAM_END && decompressedSize == size;
+}
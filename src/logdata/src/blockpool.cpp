@@ -19,10 +19,68 @@
 
 #include "blockpool.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include <QDir>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#endif
+
+#include <mimalloc.h>
+
+#include "configuration.h"
 #include "log.h"
 
 namespace {
 
+constexpr size_t ChunkSize = 1024 * 1024;
+constexpr size_t HugePageSize = 2 * 1024 * 1024;
+
+// Memory of chunks that are not mapped, in all pools
+std::atomic<size_t> HeapChunksSize{ 0 };
+std::atomic<size_t> HugePageChunksSize{ 0 };
+
+// Returns false if the system doesn't back the memory with huge pages
+bool adviseHugePages( uint8_t* data, size_t size )
+{
+#ifdef Q_OS_LINUX
+    if ( ::madvise( data, size, MADV_HUGEPAGE ) == 0 ) {
+        return true;
+    }
+
+    static std::atomic_flag isFailureLogged = ATOMIC_FLAG_INIT;
+    if ( !isFailureLogged.test_and_set() ) {
+        LOG_WARNING << "Transparent huge pages are not available, errno " << errno;
+    }
+    return false;
+#else
+    // Windows large pages are taken by mimalloc if they are enabled
+    Q_UNUSED( data );
+    Q_UNUSED( size );
+    return false;
+#endif
+}
+
+QString spillDirectory()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + "/spill";
+}
+
+bool isOverMemoryLimit( size_t newChunkSize )
+{
+    const auto limitMb = Configuration::get().lineIndexMemoryMb();
+    return limitMb > 0
+           && HeapChunksSize.load() + newChunkSize > static_cast<size_t>( limitMb ) * 1024 * 1024;
+}
+
 size_t getElementSizeWithHeader( std::size_t elementSize )
 {
     return elementSize + sizeof( uint16_t );
@@ -40,24 +98,21 @@ size_t getBlockStorageSize( size_t elementsCount, std::size_t elementSize, size_
     return getAlignedSize( elementSize + 2 * elementsCount * getElementSizeWithHeader( elementSize ), alignement );
 }
 
-template<typename PoolType>
-void increasePool(PoolType& pool)
-{
-    const auto oldSize = pool.size();
-    pool.resize( oldSize + (oldSize >> 1 ) );
-}
-
 }
 
 BlockPoolBase::BlockPoolBase( size_t elementSize, size_t alignment )
-    : pool_(1024*1024)
-    , elementSize_ {elementSize}
+    : elementSize_ {elementSize}
     , alignment_ {alignment}
     , allocationSize_{}
 {
     blockIndex_.reserve( 10000 );
 }
 
+BlockPoolBase::~BlockPoolBase()
+{
+    releaseChunks();
+}
+
 BlockPoolBase::BlockPoolBase( BlockPoolBase&& other ) noexcept
 {
     *this = std::move( other );
@@ -65,7 +120,12 @@ BlockPoolBase::BlockPoolBase( BlockPoolBase&& other ) noexcept
 
 BlockPoolBase& BlockPoolBase::operator=( BlockPoolBase&& other ) noexcept
 {
-    pool_ = std::move( other.pool_ );
+    releaseChunks();
+
+    chunks_ = std::move( other.chunks_ );
+    other.chunks_.clear();
+    spillFile_ = std::move( other.spillFile_ );
+    spillFileUsed_ = std::exchange( other.spillFileUsed_, 0 );
 
     elementSize_ = other.elementSize_;
     alignment_ = other.alignment_;
@@ -79,12 +139,12 @@ BlockPoolBase& BlockPoolBase::operator=( BlockPoolBase&& other ) noexcept
 
 uint8_t* BlockPoolBase::at(size_t index)
 {
-    return pool_.data() + blockIndex_.at( index );
+    return blockIndex_.at( index );
 }
 
 const uint8_t* BlockPoolBase::at(size_t index) const
 {
-    return pool_.data() + blockIndex_.at( index );
+    return blockIndex_.at( index );
 }
 
 size_t BlockPoolBase::getElementSize() const
@@ -102,25 +162,128 @@ uint32_t BlockPoolBase::currentBlock() const
     return blockIndex_.empty() ? 0 : type_safe::narrow_cast<uint32_t>( blockIndex_.size() - 1 );
 }
 
+uint8_t* BlockPoolBase::allocate( size_t size )
+{
+    if ( !chunks_.empty() ) {
+        auto& chunk = chunks_.back();
+        const auto blockStart = getAlignedSize( chunk.used, alignment_ );
+        if ( blockStart + size <= chunk.size ) {
+            chunk.used = blockStart + size;
+            return chunk.data + blockStart;
+        }
+    }
+
+    chunks_.push_back( newChunk( std::max( ChunkSize, size ), size ) );
+
+    LOG_TRACE << "New chunk " << chunks_.back().size << " chunks " << chunks_.size();
+
+    return chunks_.back().data;
+}
+
+BlockPoolBase::Chunk BlockPoolBase::newChunk( size_t size, size_t used )
+{
+    Chunk chunk{ nullptr, size, used, {} };
+    if ( isOverMemoryLimit( size ) && mapChunk( chunk ) ) {
+        return chunk;
+    }
+
+    // Memory of a new chunk is not touched until blocks are written,
+    // so it is advised before the system gives it pages
+    if ( Configuration::get().useHugePages() ) {
+        chunk.size = getAlignedSize( size - 1, HugePageSize );
+        chunk.memory.reset(
+            static_cast<uint8_t*>( mi_malloc_aligned( chunk.size, HugePageSize ) ) );
+        chunk.isHugePages = adviseHugePages( chunk.memory.get(), chunk.size );
+    }
+    else {
+        chunk.memory.reset( static_cast<uint8_t*>( mi_malloc( size ) ) );
+    }
+
+    if ( !chunk.memory ) {
+        throw std::bad_alloc();
+    }
+
+    chunk.data = chunk.memory.get();
+    HeapChunksSize += chunk.size;
+    if ( chunk.isHugePages ) {
+        HugePageChunksSize += chunk.size;
+    }
+    return chunk;
+}
+
+bool BlockPoolBase::mapChunk( Chunk& chunk )
+{
+    if ( !spillFile_ ) {
+        if ( !QDir().mkpath( spillDirectory() ) ) {
+            return false;
+        }
+
+        // The file is removed when the pool is destroyed
+        spillFile_ = std::make_unique<QTemporaryFile>( spillDirectory() + "/lines-XXXXXX.tmp" );
+        if ( !spillFile_->open() ) {
+            LOG_WARNING << "Can't create line index file in " << spillDirectory().toStdString();
+            spillFile_.reset();
+            return false;
+        }
+        LOG_INFO << "Line index is over the memory limit, new blocks are kept in "
+                 << spillFile_->fileName().toStdString();
+    }
+
+    const auto offset = static_cast<qint64>( spillFileUsed_ );
+    const auto size = static_cast<qint64>( chunk.size );
+    if ( !spillFile_->resize( offset + size ) ) {
+        return false;
+    }
+
+    chunk.data = spillFile_->map( offset, size );
+    if ( chunk.data == nullptr ) {
+        spillFile_->resize( offset );
+        return false;
+    }
+
+    spillFileUsed_ += chunk.size;
+    return true;
+}
+
+void BlockPoolBase::releaseLastChunk()
+{
+    auto& chunk = chunks_.back();
+    if ( chunk.memory ) {
+        HeapChunksSize -= chunk.size;
+    }
+    if ( chunk.isHugePages ) {
+        HugePageChunksSize -= chunk.size;
+    }
+    else {
+        spillFile_->unmap( chunk.data );
+        spillFileUsed_ -= chunk.size;
+        spillFile_->resize( static_cast<qint64>( spillFileUsed_ ) );
+    }
+
+    chunks_.pop_back();
+}
+
+void BlockPoolBase::releaseChunks()
+{
+    while ( !chunks_.empty() ) {
+        releaseLastChunk();
+    }
+    spillFile_.reset();
+}
+
 uint8_t* BlockPoolBase::getBlock( size_t elementsCount )
 {
     const auto requiredSize = getBlockStorageSize( elementsCount, elementSize_, alignment_ );
 
-    const auto alignedAllocationSize = getAlignedSize(allocationSize_, alignment_);
-
-    LOG_DEBUG << "Get block " << elementSize_
-                   << " pool " << pool_.size()
+    LOG_TRACE << "Get block " << elementSize_
+                   << " chunks " << chunks_.size()
                    << " alloc " << allocationSize_
                    << " blocks " << blockIndex_.size();
 
-    if ( alignedAllocationSize + requiredSize >= pool_.size() ) {
-        increasePool( pool_ );
-    }
-
-    blockIndex_.push_back( alignedAllocationSize );
-    allocationSize_ = alignedAllocationSize + requiredSize;
+    blockIndex_.push_back( allocate( requiredSize ) );
+    allocationSize_ += requiredSize;
 
-    return pool_.data() + blockIndex_.back();
+    return blockIndex_.back();
 }
 
 uint8_t* BlockPoolBase::resizeLastBlock( size_t newSize )
@@ -128,28 +291,39 @@ uint8_t* BlockPoolBase::resizeLastBlock( size_t newSize )
     const auto alignedNewSize = getAlignedSize( newSize, alignment_ );
     const auto currentBlockSize = lastBlockSize();
 
-    LOG_DEBUG << "Resizing block "
+    LOG_TRACE << "Resizing block "
                     << " from " << currentBlockSize
                     << " to " << newSize
                     << " aligned " << alignedNewSize
                     << " alloc " << allocationSize_;
 
-    if ( alignedNewSize <= currentBlockSize ) {
-        allocationSize_ -= ( currentBlockSize - alignedNewSize );
+    auto& chunk = chunks_.back();
+    const auto blockStart = static_cast<size_t>( blockIndex_.back() - chunk.data );
+
+    if ( blockStart + alignedNewSize <= chunk.size ) {
+        chunk.used = blockStart + alignedNewSize;
     }
     else {
-        const auto delta = alignedNewSize - currentBlockSize;
-        LOG_DEBUG << "Increasing last block size by " << delta;
+        // Block is moved to a new chunk, existing blocks stay in place
+        LOG_TRACE << "Moving last block to a new chunk";
 
-        if ( allocationSize_ + delta >= pool_.size() ) {
-            increasePool( pool_ );
+        auto movedChunk = newChunk( std::max( ChunkSize, alignedNewSize ), alignedNewSize );
+        std::memcpy( movedChunk.data, blockIndex_.back(), currentBlockSize );
+
+        chunk.used = blockStart;
+        if ( chunk.used == 0 ) {
+            releaseLastChunk();
         }
-        allocationSize_ += delta;
+
+        chunks_.push_back( std::move( movedChunk ) );
+        blockIndex_.back() = chunks_.back().data;
     }
 
-    LOG_DEBUG << "Resized block, alloc " << allocationSize_;
+    allocationSize_ = allocationSize_ - currentBlockSize + alignedNewSize;
+
+    LOG_TRACE << "Resized block, alloc " << allocationSize_;
 
-    return pool_.data() + blockIndex_.back();
+    return blockIndex_.back();
 }
 
 size_t BlockPoolBase::lastBlockSize() const
@@ -158,7 +332,8 @@ size_t BlockPoolBase::lastBlockSize() const
         return 0;
     }
 
-    return allocationSize_ - blockIndex_.back();
+    const auto& chunk = chunks_.back();
+    return static_cast<size_t>( chunk.data + chunk.used - blockIndex_.back() );
 }
 
 void BlockPoolBase::freeLastBlock()
@@ -168,16 +343,47 @@ void BlockPoolBase::freeLastBlock()
     }
 
     const auto freeSize = lastBlockSize();
-    LOG_DEBUG << "Free block " << freeSize;
+    LOG_TRACE << "Free block " << freeSize;
 
-    allocationSize_ = blockIndex_.back();
-
-    LOG_DEBUG << "Free block, alloc " << allocationSize_;
+    allocationSize_ -= freeSize;
 
+    auto& chunk = chunks_.back();
+    chunk.used = static_cast<size_t>( blockIndex_.back() - chunk.data );
     blockIndex_.pop_back();
+
+    // Chunk without blocks is released
+    if ( chunk.used == 0 ) {
+        releaseLastChunk();
+    }
+
+    LOG_TRACE << "Free block, alloc " << allocationSize_;
 }
 
 size_t BlockPoolBase::allocatedSize() const
 {
     return allocationSize_;
 }
+
+size_t BlockPoolBase::mappedSize() const
+{
+    size_t size = 0;
+    for ( const auto& chunk : chunks_ ) {
+        size += chunk.memory ? 0 : chunk.used;
+    }
+    return size;
+}
+
+size_t BlockPoolBase::heapChunksSize()
+{
+    return HeapChunksSize.load();
+}
+
+size_t BlockPoolBase::hugePageChunksSize()
+{
+    return HugePageChunksSize.load();
+}
+
+void BlockPoolBase::FreeChunkMemory::operator()( uint8_t* memory ) const
+{
+    mi_free( memory );
+}
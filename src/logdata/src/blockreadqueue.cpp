@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "blockreadqueue.h"
+
+#include <algorithm>
+#include <utility>
+
+BlockReadQueue::BlockReadQueue( ReadFunction read, size_t depth )
+    : read_( std::move( read ) )
+    , depth_( std::max( depth, size_t{ 1 } ) )
+{
+    threads_.reserve( depth_ );
+    for ( size_t i = 0; i < depth_; ++i ) {
+        threads_.emplace_back( [ this ] { readBlocks(); } );
+    }
+}
+
+BlockReadQueue::~BlockReadQueue()
+{
+    {
+        ScopedLock lock( mutex_ );
+        isStopping_ = true;
+    }
+    submitted_.notify_all();
+
+    for ( auto& thread : threads_ ) {
+        thread.join();
+    }
+}
+
+bool BlockReadQueue::isFull() const
+{
+    ScopedLock lock( mutex_ );
+    return reads_.size() >= depth_;
+}
+
+bool BlockReadQueue::isEmpty() const
+{
+    ScopedLock lock( mutex_ );
+    return reads_.empty();
+}
+
+void BlockReadQueue::submit( qint64 offset, char* data, qint64 size )
+{
+    {
+        ScopedLock lock( mutex_ );
+        reads_.push_back( { Read{ offset, data, size }, false } );
+    }
+    submitted_.notify_one();
+}
+
+BlockReadQueue::Read BlockReadQueue::take()
+{
+    ScopedLock lock( mutex_ );
+    done_.wait( lock, [ this ] { return !reads_.empty() && reads_.front().isDone; } );
+
+    auto read = reads_.front().read;
+    reads_.pop_front();
+    --startedReads_;
+    return read;
+}
+
+void BlockReadQueue::readBlocks()
+{
+    using clock = std::chrono::steady_clock;
+
+    ScopedLock lock( mutex_ );
+    while ( true ) {
+        submitted_.wait( lock,
+                         [ this ] { return isStopping_ || startedReads_ < reads_.size(); } );
+        if ( isStopping_ ) {
+            return;
+        }
+
+        auto& queuedRead = reads_[ startedReads_++ ];
+        auto& read = queuedRead.read;
+
+        lock.unlock();
+        const auto readStart = clock::now();
+        read.bytesRead = read_( read.offset, read.data, read.size );
+        read.duration
+            = std::chrono::duration_cast<std::chrono::microseconds>( clock::now() - readStart );
+        lock.lock();
+
+        queuedRead.isDone = true;
+        done_.notify_all();
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "compressedaccess.h"
+
+#include <QFile>
+#include <QtEndian>
+
+#include "bgzfaccess.h"
+#include "configuration.h"
+#include "gzipaccess.h"
+#include "log.h"
+#include "mergedaccess.h"
+#include "zstdaccess.h"
+
+namespace {
+constexpr quint16 GzipMagic = 0x8b1f;
+constexpr quint32 ZstdMagic = 0xFD2FB528;
+
+template <typename T> bool hasMagic( const QByteArray& data, T magic )
+{
+    return data.size() >= static_cast<int>( sizeof( T ) )
+           && qFromLittleEndian<T>( data.constData() ) == magic;
+}
+} // namespace
+
+std::shared_ptr<CompressedAccess> CompressedAccess::create( const QString& fileName )
+{
+    if ( MergedAccess::isMergeList( fileName ) ) {
+        return std::make_shared<MergedAccess>( fileName, Configuration::get().timestampFormat() );
+    }
+
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly ) || file.isSequential() ) {
+        return {};
+    }
+
+    const auto header = file.read( BgzfAccess::BlockHeaderSize );
+    if ( hasMagic( header, GzipMagic ) ) {
+        // Members of BGZF files are found without decompressing them
+        if ( BgzfAccess::isBgzfHeader( header.constData(), header.size() ) ) {
+            return std::make_shared<BgzfAccess>();
+        }
+        return std::make_shared<GzipAccess>();
+    }
+
+#ifdef KLOGG_HAS_ZSTD
+    // Only zstd files with a seek table can be read at random offsets
+    if ( hasMagic( header, ZstdMagic ) && file.seek( file.size() - 4 ) ) {
+        if ( hasMagic( file.read( 4 ), ZstdAccess::SeekableMagic ) ) {
+            return std::make_shared<ZstdAccess>();
+        }
+
+        LOG_INFO << "Zstd file " << fileName << " has no seek table";
+    }
+#endif
+
+    return {};
+}
@@ -37,7 +37,10 @@
  */
 
 #include <QtEndian>
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstring>
 #include <limits>
 #include <stdexcept>
 
@@ -47,6 +50,12 @@
 
 static constexpr size_t IndexBlockSize = 256;
 
+// Packed blocks store offsets of lines from the first one with the same
+// number of bits, each offset is read with one unaligned 64 bit load.
+static constexpr uint8_t PackedBlockMarker = 0xC0;
+static constexpr int MaxPackedBits = 56;
+static constexpr size_t PackedHeaderSize = 2;
+
 namespace {
 // Functions to manipulate blocks
 
@@ -179,6 +188,143 @@ OffsetInFile block_next_pos( const uint8_t* block, BlockOffset& offset, OffsetIn
 
     return pos;
 }
+
+template <typename ElementType>
+bool block_is_packed( const uint8_t* block )
+{
+    return get_value_at_offset( block, BlockOffset( sizeof( ElementType ) ) )
+           == PackedBlockMarker;
+}
+
+// Position of the line at the index in the packed block
+template <typename ElementType>
+OffsetInFile packed_block_pos( const uint8_t* block, size_t index )
+{
+    const auto initial = OffsetInFile( get_value_at_offset<ElementType>( block, BlockOffset{} ) );
+    if ( index == 0 ) {
+        return initial;
+    }
+
+    const auto bits = get_value_at_offset( block, BlockOffset( sizeof( ElementType ) + 1 ) );
+    const uint8_t* packed = block + sizeof( ElementType ) + PackedHeaderSize;
+    const auto bitOffset = ( index - 1 ) * bits;
+
+    uint64_t word = 0;
+    std::memcpy( &word, packed + bitOffset / 8, sizeof( word ) );
+    word = qFromLittleEndian( word ) >> ( bitOffset % 8 );
+
+    const auto mask = ( uint64_t{ 1 } << bits ) - 1;
+    return initial + OffsetInFile( static_cast<OffsetInFile::UnderlyingType>( word & mask ) );
+}
+
+int bit_width( uint64_t value )
+{
+    int bits = 0;
+    for ( ; value != 0; value >>= 1 ) {
+        ++bits;
+    }
+    return bits;
+}
+
+// Packs the last block of the pool, which holds IndexBlockSize lines,
+// if the packed block is smaller than its current size.
+template <typename ElementType, typename Pool>
+void block_pack( Pool& pool, uint32_t block_index, size_t block_size )
+{
+    uint8_t* block = pool.at( block_index );
+
+    std::array<uint64_t, IndexBlockSize> offsets{};
+    BlockOffset offset;
+    const auto initial = block_initial_pos<ElementType>( block, offset );
+    auto position = initial;
+    for ( size_t i = 1; i < IndexBlockSize; ++i ) {
+        position = block_next_pos<ElementType>( block, offset, position );
+        offsets[ i ] = static_cast<uint64_t>( ( position - initial ).get() );
+    }
+
+    // Positions grow, so the last offset needs the most bits
+    const auto bits = bit_width( offsets.back() );
+    const auto packedSize = PackedHeaderSize + ( ( IndexBlockSize - 1 ) * bits + 7 ) / 8;
+    // Offsets at the end are read with 64 bit loads too
+    const auto paddedSize = sizeof( ElementType ) + packedSize + sizeof( uint64_t );
+    if ( bits > MaxPackedBits || paddedSize >= block_size ) {
+        return;
+    }
+
+    klogg::vector<uint8_t> packed( packedSize + sizeof( uint64_t ), 0 );
+    packed[ 0 ] = PackedBlockMarker;
+    packed[ 1 ] = static_cast<uint8_t>( bits );
+    for ( size_t i = 1; i < IndexBlockSize; ++i ) {
+        const auto bitOffset = ( i - 1 ) * static_cast<size_t>( bits );
+        uint8_t* target = packed.data() + PackedHeaderSize + bitOffset / 8;
+
+        uint64_t word = 0;
+        std::memcpy( &word, target, sizeof( word ) );
+        word = qToLittleEndian( qFromLittleEndian( word ) | ( offsets[ i ] << ( bitOffset % 8 ) ) );
+        std::memcpy( target, &word, sizeof( word ) );
+    }
+
+    std::memcpy( block + sizeof( ElementType ), packed.data(), packed.size() );
+    pool.resize_last_block( paddedSize );
+}
+
+// Decode positions of lines from first to last (excluded) of the pool,
+// returns the end of the written positions.
+template <typename ElementType, typename Pool>
+OffsetInFile* block_decode_range( const Pool& pool, uint64_t first, uint64_t last,
+                                  OffsetInFile* out,
+                                  CompressedLinePositionStorage::Cache* last_read,
+                                  uint64_t first_index )
+{
+    BlockOffset offset;
+    OffsetInFile position;
+
+    auto line = first;
+    while ( line < last ) {
+        const auto block_first = line - line % IndexBlockSize;
+        const auto block_end = std::min( block_first + IndexBlockSize, last );
+        const uint8_t* block = pool.at( block_first / IndexBlockSize );
+
+        // Marker is written with the second line of the block
+        if ( block_end > block_first + 1 && block_is_packed<ElementType>( block ) ) {
+            for ( ; line < block_end; ++line ) {
+                position = packed_block_pos<ElementType>( block, line - block_first );
+                *out++ = position;
+            }
+            continue;
+        }
+
+        // Line which position is decoded
+        auto decoded = block_first;
+        if ( last_read != nullptr && last_read->index.get() >= first_index + block_first
+             && last_read->index.get() <= first_index + line ) {
+            decoded = last_read->index.get() - first_index;
+            offset = last_read->offset;
+            position = last_read->position;
+        }
+        else {
+            position = block_initial_pos<ElementType>( block, offset );
+        }
+
+        for ( auto i = decoded; i < line; ++i ) {
+            position = block_next_pos<ElementType>( block, offset, position );
+        }
+
+        *out++ = position;
+        for ( ++line; line < block_end; ++line ) {
+            position = block_next_pos<ElementType>( block, offset, position );
+            *out++ = position;
+        }
+    }
+
+    if ( last_read != nullptr ) {
+        last_read->index = LineNumber( first_index + last - 1 );
+        last_read->position = position;
+        last_read->offset = offset;
+    }
+
+    return out;
+}
 } // namespace
 
 void CompressedLinePositionStorage::move_from( CompressedLinePositionStorage&& orig ) noexcept
@@ -218,6 +364,12 @@ void CompressedLinePositionStorage::append( OffsetInFile pos )
     // Lines must be stored in order
     assert( ( pos > current_pos_ ) || ( pos == 0_offset ) );
 
+    // Finished block is packed when the next line is added, so pop_back
+    // of its last line still finds the block as it was written
+    if ( !block_offset_ && previous_block_offset_ ) {
+        pack_finished_block();
+    }
+
     // Save the pointer in case we need to "pop_back"
     previous_block_offset_ = block_offset_;
 
@@ -296,6 +448,20 @@ void CompressedLinePositionStorage::append( OffsetInFile pos )
     }
 }
 
+void CompressedLinePositionStorage::pack_finished_block()
+{
+    if ( !first_long_line_ ) {
+        const auto block_size
+            = type_safe::get( previous_block_offset_ ) + pool32_.getPaddedElementSize();
+        block_pack<uint32_t>( pool32_, block_index_, block_size );
+    }
+    else if ( nb_lines_.get() > first_long_line_->get() ) {
+        const auto block_size
+            = type_safe::get( previous_block_offset_ ) + pool64_.getPaddedElementSize();
+        block_pack<OffsetInFile::UnderlyingType>( pool64_, long_block_index_, block_size );
+    }
+}
+
 OffsetInFile CompressedLinePositionStorage::at( LineNumber index, Cache* lastPosition ) const
 {
     if ( index >= nb_lines_ ) {
@@ -313,7 +479,10 @@ OffsetInFile CompressedLinePositionStorage::at( LineNumber index, Cache* lastPos
     if ( !first_long_line_ || index < *first_long_line_ ) {
         block = pool32_.at( index.get() / IndexBlockSize );
 
-        if ( ( index.get() == last_read.index.get() + 1 )
+        if ( index.get() % IndexBlockSize != 0 && block_is_packed<uint32_t>( block ) ) {
+            position = packed_block_pos<uint32_t>( block, index.get() % IndexBlockSize );
+        }
+        else if ( ( index.get() == last_read.index.get() + 1 )
              && ( index.get() % IndexBlockSize != 0 ) ) {
             position = last_read.position;
             offset = last_read.offset;
@@ -333,7 +502,12 @@ OffsetInFile CompressedLinePositionStorage::at( LineNumber index, Cache* lastPos
         const auto index_in_64 = index - *first_long_line_;
         block = pool64_.at( index_in_64.get() / IndexBlockSize );
 
-        if ( ( index.get() == last_read.index.get() + 1 )
+        if ( index_in_64.get() % IndexBlockSize != 0
+             && block_is_packed<OffsetInFile::UnderlyingType>( block ) ) {
+            position = packed_block_pos<OffsetInFile::UnderlyingType>(
+                block, index_in_64.get() % IndexBlockSize );
+        }
+        else if ( ( index.get() == last_read.index.get() + 1 )
              && ( index_in_64.get() % IndexBlockSize != 0 ) ) {
             position = last_read.position;
             offset = last_read.offset;
@@ -360,6 +534,29 @@ OffsetInFile CompressedLinePositionStorage::at( LineNumber index, Cache* lastPos
     return position;
 }
 
+void CompressedLinePositionStorage::at_range( LineNumber first, LinesCount count,
+                                              OffsetInFile* out, Cache* lastPosition ) const
+{
+    const auto last = first.get() + count.get();
+    if ( last > nb_lines_.get() ) {
+        LOG_ERROR << "Lines not in storage: " << first.get() << " to " << last
+                  << ", storage size is " << nb_lines_;
+        throw std::runtime_error( "Line number not in storage" );
+    }
+
+    const auto lines_in_32 = first_long_line_ ? first_long_line_->get() : nb_lines_.get();
+    if ( first.get() < lines_in_32 ) {
+        out = block_decode_range<uint32_t>( pool32_, first.get(), std::min( last, lines_in_32 ),
+                                            out, lastPosition, 0 );
+    }
+
+    if ( last > lines_in_32 ) {
+        block_decode_range<OffsetInFile::UnderlyingType>(
+            pool64_, std::max( first.get(), lines_in_32 ) - lines_in_32, last - lines_in_32,
+            out, lastPosition, lines_in_32 );
+    }
+}
+
 void CompressedLinePositionStorage::append_list( const klogg::vector<OffsetInFile>& positions )
 {
     // This is not very clever, but caching should make it
@@ -402,6 +599,61 @@ void CompressedLinePositionStorage::pop_back()
     }
 }
 
+void CompressedLinePositionStorage::truncate( LinesCount newSize )
+{
+    if ( newSize >= nb_lines_ ) {
+        return;
+    }
+
+    const auto blocksCount = []( LinesCount::UnderlyingType lines ) {
+        return ( lines + IndexBlockSize - 1 ) / IndexBlockSize;
+    };
+
+    const auto linesIn32 = first_long_line_ ? first_long_line_->get() : nb_lines_.get();
+    const auto linesIn64 = nb_lines_.get() - linesIn32;
+
+    auto kept32Blocks = blocksCount( linesIn32 );
+    auto kept64Blocks = size_t{ 0 };
+    LinesCount::UnderlyingType keptBlocksEnd = 0;
+
+    // If the new end is the first long line, the partial block32 is written again
+    if ( first_long_line_ && newSize.get() > first_long_line_->get() ) {
+        kept64Blocks = ( newSize.get() - linesIn32 ) / IndexBlockSize;
+        keptBlocksEnd = linesIn32 + kept64Blocks * IndexBlockSize;
+    }
+    else {
+        kept32Blocks = newSize.get() / IndexBlockSize;
+        keptBlocksEnd = kept32Blocks * IndexBlockSize;
+    }
+
+    // Blocks can only be written sequentially, so lines of the block
+    // holding the new end are appended again after the block is freed.
+    klogg::vector<OffsetInFile> lastBlockLines;
+    lastBlockLines.reserve( IndexBlockSize );
+    Cache cache;
+    for ( auto line = keptBlocksEnd; line < newSize.get(); ++line ) {
+        lastBlockLines.push_back( at( LineNumber( line ), &cache ) );
+    }
+
+    for ( auto block = blocksCount( linesIn64 ); block > kept64Blocks; --block ) {
+        long_block_index_ = pool64_.free_last_block();
+    }
+    for ( auto block = blocksCount( linesIn32 ); block > kept32Blocks; --block ) {
+        block_index_ = pool32_.free_last_block();
+    }
+
+    if ( kept64Blocks == 0 ) {
+        first_long_line_ = {};
+    }
+
+    nb_lines_ = LinesCount( keptBlocksEnd );
+    block_offset_ = {};
+    previous_block_offset_ = {};
+    current_pos_ = keptBlocksEnd > 0 ? at( LineNumber( keptBlocksEnd - 1 ) ) : 0_offset;
+
+    append_list( lastBlockLines );
+}
+
 size_t CompressedLinePositionStorage::allocatedSize() const
 {
     return pool32_.allocatedSize() + pool64_.allocatedSize();
@@ -0,0 +1,374 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "delimetermasks.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "cpu_info.h"
+#include "log.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define KLOGG_HAS_SSE2_SCANNER
+#include <immintrin.h>
+#endif
+
+#if defined( __aarch64__ ) || defined( _M_ARM64 )
+#define KLOGG_HAS_NEON_SCANNER
+#include <arm_neon.h>
+#endif
+
+#if defined( KLOGG_HAS_SSE2_SCANNER ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define KLOGG_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#else
+#define KLOGG_TARGET_AVX2
+#endif
+
+namespace {
+
+constexpr auto ChunkSize = DelimeterMasks::MaskBits;
+
+// Fills masks for chunksCount chunks of 64 bytes each
+using ScanChunks = void ( * )( const char* data, size_t chunksCount, uint64_t* lineFeeds,
+                               uint64_t* tabs, uint64_t* nonAscii );
+
+void scanChunksScalar( const char* data, size_t chunksCount, uint64_t* lineFeeds, uint64_t* tabs,
+                       uint64_t* nonAscii )
+{
+    for ( size_t chunk = 0; chunk < chunksCount; ++chunk ) {
+        uint64_t lineFeedBits = 0;
+        uint64_t tabBits = 0;
+        uint64_t nonAsciiBits = 0;
+        for ( size_t i = 0; i < ChunkSize; ++i ) {
+            const auto c = data[ chunk * ChunkSize + i ];
+            lineFeedBits |= uint64_t{ c == '\n' } << i;
+            tabBits |= uint64_t{ c == '\t' } << i;
+            nonAsciiBits |= uint64_t{ ( static_cast<uint8_t>( c ) & 0x80 ) != 0 } << i;
+        }
+        lineFeeds[ chunk ] = lineFeedBits;
+        tabs[ chunk ] = tabBits;
+        nonAscii[ chunk ] = nonAsciiBits;
+    }
+}
+
+#ifdef KLOGG_HAS_SSE2_SCANNER
+void scanChunksSse2( const char* data, size_t chunksCount, uint64_t* lineFeeds, uint64_t* tabs,
+                     uint64_t* nonAscii )
+{
+    const auto lineFeed = _mm_set1_epi8( '\n' );
+    const auto tab = _mm_set1_epi8( '\t' );
+
+    for ( size_t chunk = 0; chunk < chunksCount; ++chunk ) {
+        uint64_t lineFeedBits = 0;
+        uint64_t tabBits = 0;
+        uint64_t nonAsciiBits = 0;
+        for ( size_t i = 0; i < ChunkSize; i += 16 ) {
+            const auto bytes = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>( data + chunk * ChunkSize + i ) );
+            lineFeedBits |= uint64_t{ static_cast<uint16_t>(
+                                _mm_movemask_epi8( _mm_cmpeq_epi8( bytes, lineFeed ) ) ) }
+                            << i;
+            tabBits |= uint64_t{ static_cast<uint16_t>(
+                           _mm_movemask_epi8( _mm_cmpeq_epi8( bytes, tab ) ) ) }
+                       << i;
+            nonAsciiBits |= uint64_t{ static_cast<uint16_t>( _mm_movemask_epi8( bytes ) ) } << i;
+        }
+        lineFeeds[ chunk ] = lineFeedBits;
+        tabs[ chunk ] = tabBits;
+        nonAscii[ chunk ] = nonAsciiBits;
+    }
+}
+
+KLOGG_TARGET_AVX2
+uint64_t avx2ToMask( __m256i lowMatches, __m256i highMatches )
+{
+    return uint64_t{ static_cast<uint32_t>( _mm256_movemask_epi8( lowMatches ) ) }
+           | uint64_t{ static_cast<uint32_t>( _mm256_movemask_epi8( highMatches ) ) } << 32;
+}
+
+KLOGG_TARGET_AVX2
+void scanChunksAvx2( const char* data, size_t chunksCount, uint64_t* lineFeeds, uint64_t* tabs,
+                     uint64_t* nonAscii )
+{
+    const auto lineFeed = _mm256_set1_epi8( '\n' );
+    const auto tab = _mm256_set1_epi8( '\t' );
+
+    for ( size_t chunk = 0; chunk < chunksCount; ++chunk ) {
+        const auto chunkStart = data + chunk * ChunkSize;
+        const auto low = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( chunkStart ) );
+        const auto high = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( chunkStart + 32 ) );
+
+        lineFeeds[ chunk ] = avx2ToMask( _mm256_cmpeq_epi8( low, lineFeed ),
+                                         _mm256_cmpeq_epi8( high, lineFeed ) );
+        tabs[ chunk ]
+            = avx2ToMask( _mm256_cmpeq_epi8( low, tab ), _mm256_cmpeq_epi8( high, tab ) );
+        nonAscii[ chunk ] = avx2ToMask( low, high );
+    }
+}
+#endif
+
+#ifdef KLOGG_HAS_NEON_SCANNER
+uint64_t neonToMask( uint8x16_t m0, uint8x16_t m1, uint8x16_t m2, uint8x16_t m3 )
+{
+    const uint8x16_t bitWeights
+        = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+            0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+
+    auto sum0 = vpaddq_u8( vandq_u8( m0, bitWeights ), vandq_u8( m1, bitWeights ) );
+    const auto sum1 = vpaddq_u8( vandq_u8( m2, bitWeights ), vandq_u8( m3, bitWeights ) );
+    sum0 = vpaddq_u8( sum0, sum1 );
+    sum0 = vpaddq_u8( sum0, sum0 );
+    return vgetq_lane_u64( vreinterpretq_u64_u8( sum0 ), 0 );
+}
+
+void scanChunksNeon( const char* data, size_t chunksCount, uint64_t* lineFeeds, uint64_t* tabs,
+                     uint64_t* nonAscii )
+{
+    const auto lineFeed = vdupq_n_u8( '\n' );
+    const auto tab = vdupq_n_u8( '\t' );
+    const auto highBit = vdupq_n_u8( 0x80 );
+
+    for ( size_t chunk = 0; chunk < chunksCount; ++chunk ) {
+        const auto chunkStart = reinterpret_cast<const uint8_t*>( data + chunk * ChunkSize );
+        const auto b0 = vld1q_u8( chunkStart );
+        const auto b1 = vld1q_u8( chunkStart + 16 );
+        const auto b2 = vld1q_u8( chunkStart + 32 );
+        const auto b3 = vld1q_u8( chunkStart + 48 );
+
+        lineFeeds[ chunk ] = neonToMask( vceqq_u8( b0, lineFeed ), vceqq_u8( b1, lineFeed ),
+                                         vceqq_u8( b2, lineFeed ), vceqq_u8( b3, lineFeed ) );
+        tabs[ chunk ] = neonToMask( vceqq_u8( b0, tab ), vceqq_u8( b1, tab ), vceqq_u8( b2, tab ),
+                                    vceqq_u8( b3, tab ) );
+        nonAscii[ chunk ] = neonToMask( vcgeq_u8( b0, highBit ), vcgeq_u8( b1, highBit ),
+                                        vcgeq_u8( b2, highBit ), vcgeq_u8( b3, highBit ) );
+    }
+}
+#endif
+
+ScanChunks selectChunkScanner()
+{
+#if defined( KLOGG_HAS_SSE2_SCANNER )
+    if ( hasRequiredInstructions( supportedCpuInstructions(), CpuInstructions::AVX2 ) ) {
+        LOG_INFO << "Using AVX2 line scanner";
+        return scanChunksAvx2;
+    }
+    LOG_INFO << "Using SSE2 line scanner";
+    return scanChunksSse2;
+#elif defined( KLOGG_HAS_NEON_SCANNER )
+    LOG_INFO << "Using NEON line scanner";
+    return scanChunksNeon;
+#else
+    LOG_INFO << "Using scalar line scanner";
+    return scanChunksScalar;
+#endif
+}
+
+using FindWideDelimeter = size_t ( * )( const char* data, size_t size, size_t from,
+                                        char delimeter, int unitWidth, int delimeterIndex );
+
+size_t findWideDelimeterScalar( const char* data, size_t size, size_t from, char delimeter,
+                                int unitWidth, int delimeterIndex )
+{
+    const auto width = static_cast<size_t>( unitWidth );
+    const auto index = static_cast<size_t>( delimeterIndex );
+
+    for ( auto unit = from; unit + width <= size; unit += width ) {
+        if ( data[ unit + index ] != delimeter ) {
+            continue;
+        }
+
+        auto isDelimeter = true;
+        for ( size_t i = 0; i < width && isDelimeter; ++i ) {
+            isDelimeter = i == index || data[ unit + i ] == '\0';
+        }
+
+        if ( isDelimeter ) {
+            return unit + index;
+        }
+    }
+
+    return size;
+}
+
+// Value of a code unit with the delimeter as loaded by little endian vector loads
+uint32_t wideDelimeterPattern( char delimeter, int delimeterIndex )
+{
+    return uint32_t{ static_cast<uint8_t>( delimeter ) }
+           << ( 8 * static_cast<uint32_t>( delimeterIndex ) );
+}
+
+#ifdef KLOGG_HAS_SSE2_SCANNER
+size_t firstSetBit( uint32_t mask )
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward( &index, mask );
+    return index;
+#else
+    return static_cast<size_t>( __builtin_ctz( mask ) );
+#endif
+}
+
+size_t findWideDelimeterSse2( const char* data, size_t size, size_t from, char delimeter,
+                              int unitWidth, int delimeterIndex )
+{
+    const auto pattern = wideDelimeterPattern( delimeter, delimeterIndex );
+    const auto units16 = _mm_set1_epi16( static_cast<short>( pattern ) );
+    const auto units32 = _mm_set1_epi32( static_cast<int>( pattern ) );
+
+    constexpr size_t VectorSize = 16;
+
+    auto pos = from;
+    for ( ; pos + VectorSize <= size; pos += VectorSize ) {
+        const auto bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + pos ) );
+        const auto matches = unitWidth == 2 ? _mm_cmpeq_epi16( bytes, units16 )
+                                            : _mm_cmpeq_epi32( bytes, units32 );
+        const auto mask = static_cast<uint32_t>( _mm_movemask_epi8( matches ) );
+        if ( mask != 0 ) {
+            return pos + firstSetBit( mask ) + static_cast<size_t>( delimeterIndex );
+        }
+    }
+
+    return findWideDelimeterScalar( data, size, pos, delimeter, unitWidth, delimeterIndex );
+}
+
+KLOGG_TARGET_AVX2
+size_t findWideDelimeterAvx2( const char* data, size_t size, size_t from, char delimeter,
+                              int unitWidth, int delimeterIndex )
+{
+    const auto pattern = wideDelimeterPattern( delimeter, delimeterIndex );
+    const auto units16 = _mm256_set1_epi16( static_cast<short>( pattern ) );
+    const auto units32 = _mm256_set1_epi32( static_cast<int>( pattern ) );
+
+    constexpr size_t VectorSize = 32;
+
+    auto pos = from;
+    for ( ; pos + VectorSize <= size; pos += VectorSize ) {
+        const auto bytes = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data + pos ) );
+        const auto matches = unitWidth == 2 ? _mm256_cmpeq_epi16( bytes, units16 )
+                                            : _mm256_cmpeq_epi32( bytes, units32 );
+        const auto mask = static_cast<uint32_t>( _mm256_movemask_epi8( matches ) );
+        if ( mask != 0 ) {
+            return pos + firstSetBit( mask ) + static_cast<size_t>( delimeterIndex );
+        }
+    }
+
+    return findWideDelimeterSse2( data, size, pos, delimeter, unitWidth, delimeterIndex );
+}
+#endif
+
+#if defined( KLOGG_HAS_NEON_SCANNER ) && !defined( __ARM_BIG_ENDIAN )
+size_t findWideDelimeterNeon( const char* data, size_t size, size_t from, char delimeter,
+                              int unitWidth, int delimeterIndex )
+{
+    const auto pattern = wideDelimeterPattern( delimeter, delimeterIndex );
+    const auto units16 = vdupq_n_u16( static_cast<uint16_t>( pattern ) );
+    const auto units32 = vdupq_n_u32( pattern );
+
+    constexpr size_t VectorSize = 16;
+
+    auto pos = from;
+    for ( ; pos + VectorSize <= size; pos += VectorSize ) {
+        const auto bytes = vld1q_u8( reinterpret_cast<const uint8_t*>( data + pos ) );
+        const auto matches
+            = unitWidth == 2
+                  ? vreinterpretq_u8_u16( vceqq_u16( vreinterpretq_u16_u8( bytes ), units16 ) )
+                  : vreinterpretq_u8_u32( vceqq_u32( vreinterpretq_u32_u8( bytes ), units32 ) );
+        if ( vmaxvq_u8( matches ) != 0 ) {
+            return findWideDelimeterScalar( data, pos + VectorSize, pos, delimeter, unitWidth,
+                                            delimeterIndex );
+        }
+    }
+
+    return findWideDelimeterScalar( data, size, pos, delimeter, unitWidth, delimeterIndex );
+}
+#endif
+
+FindWideDelimeter selectWideDelimeterFinder()
+{
+#if defined( KLOGG_HAS_SSE2_SCANNER )
+    if ( hasRequiredInstructions( supportedCpuInstructions(), CpuInstructions::AVX2 ) ) {
+        return findWideDelimeterAvx2;
+    }
+    return findWideDelimeterSse2;
+#elif defined( KLOGG_HAS_NEON_SCANNER ) && !defined( __ARM_BIG_ENDIAN )
+    return findWideDelimeterNeon;
+#else
+    return findWideDelimeterScalar;
+#endif
+}
+
+} // namespace
+
+void DelimeterMasks::scan( const char* data, size_t size )
+{
+    static const ScanChunks scanChunks = selectChunkScanner();
+
+    size_ = size;
+
+    const auto fullChunks = size / ChunkSize;
+    const auto wordsCount = ( size + ChunkSize - 1 ) / ChunkSize;
+
+    lineFeeds_.resize( wordsCount );
+    tabs_.resize( wordsCount );
+    nonAscii_.resize( wordsCount );
+
+    scanChunks( data, fullChunks, lineFeeds_.data(), tabs_.data(), nonAscii_.data() );
+
+    if ( fullChunks < wordsCount ) {
+        // Zero padding does not match any delimeter
+        std::array<char, ChunkSize> lastChunk{};
+        std::memcpy( lastChunk.data(), data + fullChunks * ChunkSize, size % ChunkSize );
+        scanChunksScalar( lastChunk.data(), 1, lineFeeds_.data() + fullChunks,
+                          tabs_.data() + fullChunks, nonAscii_.data() + fullChunks );
+    }
+}
+
+size_t DelimeterMasks::nextLineFeed( size_t from ) const
+{
+    if ( from >= size_ ) {
+        return size_;
+    }
+
+    auto word = from / MaskBits;
+    auto bits = lineFeeds_[ word ] & ( ~uint64_t{ 0 } << ( from % MaskBits ) );
+
+    while ( bits == 0 ) {
+        if ( ++word == lineFeeds_.size() ) {
+            return size_;
+        }
+        bits = lineFeeds_[ word ];
+    }
+
+    return word * MaskBits + countTrailingZeros( bits );
+}
+
+size_t findWideDelimeter( const char* data, size_t size, char delimeter, int unitWidth,
+                          int delimeterIndex )
+{
+    static const FindWideDelimeter findDelimeter = selectWideDelimeterFinder();
+
+    if ( unitWidth != 2 && unitWidth != 4 ) {
+        return findWideDelimeterScalar( data, size, 0, delimeter, unitWidth, delimeterIndex );
+    }
+
+    return findDelimeter( data, size, 0, delimeter, unitWidth, delimeterIndex );
+}
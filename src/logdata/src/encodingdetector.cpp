@@ -19,8 +19,12 @@
 
 #include "encodingdetector.h"
 
+#include <algorithm>
+
 #include <QTextCodec>
 
+#include <tbb/parallel_for.h>
+
 #include "containers.h"
 #include "log.h"
 #include <uchardet.h>
@@ -63,17 +67,29 @@ class UchardetHolder {
     uchardet_t ud_;
 };
 
+// Such blocks look the same in any ASCII compatible encoding
+bool isPlainAscii( const QByteArray& block )
+{
+    return std::all_of( block.begin(), block.end(), []( char c ) {
+        return c != '\0' && static_cast<unsigned char>( c ) < 0x80;
+    } );
+}
+
 } // namespace
 
 EncodingParameters::EncodingParameters( const QTextCodec* codec )
 {
     static constexpr QChar LineFeed( QChar::LineFeed );
     static constexpr int Utf8Mib = 106;
+    static constexpr int Utf16BEMib = 1013;
     static constexpr int Utf16LEMib = 1014;
     static constexpr int UsAsciiMib = 3;
+    static constexpr int Latin1Mib = 4;
 
     isUtf8Compatible = codec->mibEnum() == Utf8Mib || codec->mibEnum() == UsAsciiMib;
     isUtf16LE = codec->mibEnum() == Utf16LEMib;
+    isUtf16BE = codec->mibEnum() == Utf16BEMib;
+    isLatin1 = codec->mibEnum() == Latin1Mib;
 
     QTextCodec::ConverterState convertState( QTextCodec::IgnoreHeader );
     const QByteArray encodedLineFeed = codec->fromUnicode( &LineFeed, 1, &convertState );
@@ -83,10 +99,8 @@ EncodingParameters::EncodingParameters( const QTextCodec* codec )
         = encodedLineFeed[ 0 ] == '\n' ? 0 : ( static_cast<int>( encodedLineFeed.size() ) - 1 );
 }
 
-QTextCodec* EncodingDetector::detectEncoding( const klogg::vector<char>& block ) const
+QTextCodec* EncodingDetector::detectEncoding( std::string_view block ) const
 {
-    UniqueLock lock( mutex_ );
-
     UchardetHolder ud;
 
     auto rc = ud.handle_data( block.data(), block.size() );
@@ -117,6 +131,43 @@ QTextCodec* EncodingDetector::detectEncoding( const klogg::vector<char>& block )
     return encodingGuess;
 }
 
+QTextCodec* EncodingDetector::detectEncoding( const klogg::vector<QByteArray>& samples ) const
+{
+    if ( samples.empty() ) {
+        return nullptr;
+    }
+
+    if ( auto* bomCodec = QTextCodec::codecForUtfText( samples.front(), nullptr ) ) {
+        return bomCodec;
+    }
+
+    klogg::vector<QTextCodec*> guesses( samples.size(), nullptr );
+    tbb::parallel_for( size_t{ 0 }, samples.size(), [ & ]( size_t index ) {
+        const auto& sample = samples[ index ];
+        if ( !isPlainAscii( sample ) ) {
+            guesses[ index ] = detectEncoding(
+                std::string_view( sample.constData(), static_cast<size_t>( sample.size() ) ) );
+        }
+    } );
+
+    // Ties go to the guess of the earlier sample
+    QTextCodec* bestGuess = nullptr;
+    std::ptrdiff_t bestVotes = 0;
+    for ( auto* guess : guesses ) {
+        const auto votes = std::count( guesses.begin(), guesses.end(), guess );
+        if ( guess && votes > bestVotes ) {
+            bestGuess = guess;
+            bestVotes = votes;
+        }
+    }
+
+    if ( bestGuess ) {
+        LOG_INFO << "Encoding guess of " << samples.size() << " samples "
+                 << bestGuess->name().toStdString() << ", " << bestVotes << " votes";
+    }
+    return bestGuess;
+}
+
 TextCodecHolder::TextCodecHolder( QTextCodec* codec )
     : codec_{ codec }
     , encodingParams_{ codec }
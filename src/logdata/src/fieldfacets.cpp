@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fieldfacets.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <tbb/enumerable_thread_specific.h>
+
+#include "fieldquery.h"
+#include "log.h"
+#include "logdata.h"
+
+namespace {
+const QRegularExpression ColumnKey( "^\\$[1-9][0-9]*$" );
+const QRegularExpression FieldKey( "^[A-Za-z_][A-Za-z0-9_.\\-]*$" );
+
+bool needsQuotes( const QString& value )
+{
+    return value.isEmpty()
+           || std::any_of( value.begin(), value.end(), []( QChar c ) {
+                  return c == ' ' || c == '\t' || c == '\r' || c == '"';
+              } );
+}
+
+// Calls valueFound for the value of the field of each of the lines that has it,
+// lines are read in parallel. Returns the number of read lines.
+template <typename ValueFound>
+LinesCount forEachValue( const LogData& logData, const FacetField& field,
+                         const roaring::Roaring64Map& lines, const AtomicFlag& interruptRequested,
+                         const ValueFound& valueFound )
+{
+    struct Reader {
+        // Regular expressions are not shared by threads
+        FacetField field;
+        std::string buffer;
+    };
+
+    tbb::enumerable_thread_specific<Reader> readers(
+        [ &field ] { return Reader{ *FacetField::parse( field.text() ), {} }; } );
+    return logData.readLinesInParallel(
+        lines, interruptRequested, [ &readers, &valueFound ]( LineNumber, std::string_view line ) {
+            auto& reader = readers.local();
+            if ( const auto value = reader.field.value( line, reader.buffer ) ) {
+                valueFound( *value );
+            }
+        } );
+}
+
+// Number at the start of the value, so units after numbers are ignored, e.g. 12ms
+std::optional<double> parseNumber( std::string_view value )
+{
+    if ( const auto number = FieldQuery::number( value ) ) {
+        return number;
+    }
+
+    const auto numberEnd = value.find_first_not_of( "+-.0123456789eE" );
+    if ( numberEnd == 0 || numberEnd == std::string_view::npos ) {
+        return {};
+    }
+    return FieldQuery::number( value.substr( 0, numberEnd ) );
+}
+} // namespace
+
+std::optional<FacetField> FacetField::parse( const QString& text )
+{
+    FacetField field;
+    field.text_ = text.trimmed();
+    if ( field.text_.isEmpty() ) {
+        return {};
+    }
+
+    if ( ColumnKey.match( field.text_ ).hasMatch() ) {
+        field.key_ = field.text_.toStdString();
+        field.column_ = field.text_.mid( 1 ).toULongLong();
+        return field;
+    }
+
+    if ( FieldKey.match( field.text_ ).hasMatch() ) {
+        field.key_ = field.text_.toStdString();
+        return field;
+    }
+
+    QRegularExpression regularExpression( field.text_ );
+    if ( !regularExpression.isValid() ) {
+        return {};
+    }
+    regularExpression.optimize();
+    field.regularExpression_ = std::move( regularExpression );
+    return field;
+}
+
+std::optional<std::string_view> FacetField::value( std::string_view line,
+                                                   std::string& buffer ) const
+{
+    if ( regularExpression_ ) {
+        const auto match = regularExpression_->match(
+            QString::fromUtf8( line.data(), static_cast<int>( line.size() ) ) );
+        const auto group = regularExpression_->captureCount() > 0 ? 1 : 0;
+        if ( !match.hasMatch() || match.capturedStart( group ) < 0 ) {
+            return {};
+        }
+        buffer = match.captured( group ).toStdString();
+        return std::string_view( buffer );
+    }
+
+    if ( column_ > 0 ) {
+        return FieldQuery::column( line, column_ );
+    }
+
+    // The first field with the key is counted
+    bool isFound = false;
+    FieldQuery::forEachField( line, [ this, &buffer, &isFound ]( std::string_view key,
+                                                                 std::string_view value ) {
+        if ( !isFound && key == key_ ) {
+            buffer.assign( value );
+            isFound = true;
+        }
+    } );
+    if ( !isFound ) {
+        return {};
+    }
+    return std::string_view( buffer );
+}
+
+std::optional<double> FacetField::number( std::string_view line, std::string& buffer ) const
+{
+    const auto fieldValue = value( line, buffer );
+    return fieldValue ? parseNumber( *fieldValue ) : std::nullopt;
+}
+
+QString FacetField::searchPattern( const QString& value ) const
+{
+    if ( regularExpression_ ) {
+        return {};
+    }
+
+    if ( !needsQuotes( value ) ) {
+        return QString( "@%1=%2" ).arg( text_, value );
+    }
+
+    auto quotedValue = value;
+    quotedValue.replace( '\\', "\\\\" ).replace( '"', "\\\"" );
+    return QString( "@%1=\"%2\"" ).arg( text_, quotedValue );
+}
+
+void FacetCounter::add( std::string_view value )
+{
+    key_.assign( value );
+    const auto count = counts_.find( key_ );
+    if ( count != counts_.end() ) {
+        count->second.count++;
+        return;
+    }
+
+    if ( counts_.size() >= MaxValues ) {
+        evict();
+    }
+    counts_.emplace( key_, Count{ evictedCount_ + 1, evictedCount_ } );
+}
+
+void FacetCounter::merge( FacetCounter&& other )
+{
+    // Values evicted by a counter were counted by it at most its highest evicted count
+    for ( auto& [ value, count ] : counts_ ) {
+        const auto otherCount = other.counts_.find( value );
+        if ( otherCount != other.counts_.end() ) {
+            count.count += otherCount->second.count;
+            count.error += otherCount->second.error;
+        }
+        else {
+            count.count += other.evictedCount_;
+            count.error += other.evictedCount_;
+        }
+    }
+
+    for ( const auto& [ value, count ] : other.counts_ ) {
+        if ( counts_.find( value ) == counts_.end() ) {
+            counts_.emplace( value, Count{ count.count + evictedCount_,
+                                           count.error + evictedCount_ } );
+        }
+    }
+
+    evictedCount_ += other.evictedCount_;
+    other.counts_.clear();
+
+    while ( counts_.size() > MaxValues ) {
+        evict();
+    }
+}
+
+void FacetCounter::evict()
+{
+    klogg::vector<uint64_t> counts;
+    counts.reserve( counts_.size() );
+    for ( const auto& [ value, count ] : counts_ ) {
+        counts.push_back( count.count );
+    }
+    const auto median = counts.begin() + static_cast<std::ptrdiff_t>( counts.size() / 2 );
+    std::nth_element( counts.begin(), median, counts.end() );
+    const auto evictedCount = *median;
+
+    // Values with the median count are evicted too, so at least half of the values are
+    decltype( counts_ ) keptCounts;
+    keptCounts.reserve( counts_.size() / 2 );
+    for ( const auto& [ value, count ] : counts_ ) {
+        if ( count.count > evictedCount ) {
+            keptCounts.emplace( value, count );
+        }
+    }
+
+    counts_ = std::move( keptCounts );
+    evictedCount_ = std::max( evictedCount_, evictedCount );
+}
+
+klogg::vector<FieldFacets::Value> FacetCounter::takeTop( size_t number )
+{
+    using CountedValue = decltype( counts_ )::value_type;
+    klogg::vector<const CountedValue*> countedValues;
+    countedValues.reserve( counts_.size() );
+    for ( const auto& countedValue : counts_ ) {
+        countedValues.push_back( &countedValue );
+    }
+
+    const auto top = countedValues.begin()
+                     + static_cast<std::ptrdiff_t>( std::min( number, countedValues.size() ) );
+    std::partial_sort( countedValues.begin(), top, countedValues.end(),
+                       []( const CountedValue* lhs, const CountedValue* rhs ) {
+                           return lhs->second.count > rhs->second.count
+                                  || ( lhs->second.count == rhs->second.count
+                                       && lhs->first < rhs->first );
+                       } );
+
+    klogg::vector<FieldFacets::Value> values;
+    values.reserve( static_cast<size_t>( top - countedValues.begin() ) );
+    for ( auto countedValue = countedValues.begin(); countedValue != top; ++countedValue ) {
+        values.push_back( { QString::fromStdString( ( *countedValue )->first ),
+                            ( *countedValue )->second.count, ( *countedValue )->second.error } );
+    }
+
+    counts_.clear();
+    return values;
+}
+
+FieldFacets FieldFacets::count( const LogData& logData, const FacetField& field,
+                                const roaring::Roaring64Map& lines,
+                                const AtomicFlag& interruptRequested )
+{
+    struct Counting {
+        FacetCounter counter;
+        uint64_t linesWithField = 0;
+    };
+
+    tbb::enumerable_thread_specific<Counting> countings;
+    const auto countedLines = forEachValue( logData, field, lines, interruptRequested,
+                                            [ &countings ]( std::string_view value ) {
+                                                auto& counting = countings.local();
+                                                counting.counter.add( value );
+                                                counting.linesWithField++;
+                                            } );
+
+    FacetCounter allValues;
+    uint64_t linesWithField = 0;
+    for ( auto& counting : countings ) {
+        allValues.merge( std::move( counting.counter ) );
+        linesWithField += counting.linesWithField;
+    }
+
+    FieldFacets facets;
+    facets.isApproximate = allValues.isApproximate();
+    facets.values = allValues.takeTop( MaxListedValues );
+    facets.countedLines = countedLines;
+    facets.linesWithField = LinesCount( linesWithField );
+
+    LOG_INFO << "Counted " << facets.values.size() << " values of " << field.text() << " in "
+             << facets.countedLines << " lines";
+    return facets;
+}
+
+void NumberHistogram::add( double number )
+{
+    const auto bucket = bucketOf( number );
+    const auto count = buckets_.find( bucket );
+    if ( count != buckets_.end() ) {
+        count->second++;
+    }
+    else {
+        buckets_.emplace( bucket, 1 );
+    }
+
+    count_++;
+    sum_ += number;
+    min_ = std::min( min_, number );
+    max_ = std::max( max_, number );
+}
+
+void NumberHistogram::merge( const NumberHistogram& other )
+{
+    for ( const auto& [ bucket, otherCount ] : other.buckets_ ) {
+        buckets_[ bucket ] += otherCount;
+    }
+
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min( min_, other.min_ );
+    max_ = std::max( max_, other.max_ );
+}
+
+double NumberHistogram::percentile( double fraction ) const
+{
+    if ( count_ == 0 ) {
+        return 0;
+    }
+
+    // Extremes are known exactly
+    const auto rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>( std::ceil( fraction * static_cast<double>( count_ ) ) ) );
+    if ( rank == 1 ) {
+        return min_;
+    }
+    if ( rank >= count_ ) {
+        return max_;
+    }
+
+    // Buckets in the order of their numbers
+    klogg::vector<std::pair<int32_t, uint64_t>> buckets( buckets_.begin(), buckets_.end() );
+    std::sort( buckets.begin(), buckets.end() );
+
+    uint64_t seen = 0;
+    for ( const auto& [ bucket, count ] : buckets ) {
+        seen += count;
+        if ( seen >= rank ) {
+            // Numbers of the bucket are between the extremes
+            return std::clamp( numberOf( bucket ), min_, max_ );
+        }
+    }
+    return max_;
+}
+
+int32_t NumberHistogram::bucketOf( double number )
+{
+    if ( number == 0 ) {
+        return 0;
+    }
+
+    // Mantissa is in [0.5, 1), its top bits select the sub-bucket
+    int exponent = 0;
+    const auto mantissa = std::frexp( std::abs( number ), &exponent );
+    const auto subBucket = std::min( static_cast<int32_t>( ( mantissa - 0.5 ) * 2 * SubBuckets ),
+                                     SubBuckets - 1 );
+    const auto index = ( exponent - MinExponent ) * SubBuckets + subBucket + 1;
+
+    // Buckets of negative numbers are ordered as the numbers
+    return number > 0 ? index : -index;
+}
+
+double NumberHistogram::numberOf( int32_t bucket )
+{
+    if ( bucket == 0 ) {
+        return 0;
+    }
+
+    const auto index = std::abs( bucket ) - 1;
+    const auto exponent = index / SubBuckets + MinExponent;
+    const auto subBucket = index % SubBuckets;
+
+    // Middle of the bucket
+    const auto mantissa = 0.5 + ( subBucket + 0.5 ) / ( 2.0 * SubBuckets );
+    const auto number = std::ldexp( mantissa, exponent );
+    return bucket > 0 ? number : -number;
+}
+
+FieldStatistics FieldStatistics::compute( const LogData& logData, const FacetField& field,
+                                          const roaring::Roaring64Map& lines,
+                                          const AtomicFlag& interruptRequested )
+{
+    tbb::enumerable_thread_specific<NumberHistogram> histograms;
+    const auto countedLines = forEachValue(
+        logData, field, lines, interruptRequested, [ &histograms ]( std::string_view value ) {
+            if ( const auto number = parseNumber( value ) ) {
+                histograms.local().add( *number );
+            }
+        } );
+
+    FieldStatistics statistics;
+    for ( const auto& histogram : histograms ) {
+        statistics.numbers.merge( histogram );
+    }
+    statistics.countedLines = countedLines;
+
+    LOG_INFO << "Found " << statistics.numbers.count() << " numbers of " << field.text()
+             << " in " << statistics.countedLines << " lines";
+    return statistics;
+}
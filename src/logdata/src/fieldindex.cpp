@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fieldindex.h"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include "log.h"
+
+namespace {
+constexpr size_t LinesPerTask = 4096;
+
+// Fields found by one thread, offsets are of the added lines
+struct LocalField {
+    bool isDropped = false;
+    robin_hood::unordered_node_map<std::string, klogg::vector<uint64_t>> values;
+};
+
+using LocalFields = robin_hood::unordered_node_map<std::string, LocalField>;
+} // namespace
+
+FieldIndex::Position FieldIndex::position( uint64_t linesGeneration )
+{
+    ScopedLock lock( mutex_ );
+    if ( linesGeneration != linesGeneration_ ) {
+        reset();
+        linesGeneration_ = linesGeneration;
+    }
+    return { epoch_, nextLine_ };
+}
+
+bool FieldIndex::addLines( const Position& position,
+                           const klogg::vector<std::string_view>& lines )
+{
+    robin_hood::unordered_flat_set<std::string> droppedFields;
+    {
+        ScopedLock lock( mutex_ );
+        if ( position.epoch != epoch_ || position.nextLine != nextLine_ ) {
+            return false;
+        }
+        if ( isOverflown_ ) {
+            nextLine_ = nextLine_ + LinesCount( lines.size() );
+            return true;
+        }
+
+        for ( const auto& field : fields_ ) {
+            if ( field.second.isDropped ) {
+                droppedFields.insert( field.first );
+            }
+        }
+    }
+
+    tbb::enumerable_thread_specific<LocalFields> localFields;
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>( 0, lines.size(), LinesPerTask ),
+        [ & ]( const tbb::blocked_range<size_t>& range ) {
+            auto& fields = localFields.local();
+            std::string key;
+            for ( auto offset = range.begin(); offset != range.end(); ++offset ) {
+                FieldQuery::forEachField(
+                    lines[ offset ], [ & ]( std::string_view fieldKey, std::string_view value ) {
+                        key.assign( fieldKey );
+                        if ( droppedFields.count( key ) > 0 ) {
+                            return;
+                        }
+
+                        auto& field = fields[ key ];
+                        if ( field.isDropped ) {
+                            return;
+                        }
+                        if ( value.size() > MaxValueLength ) {
+                            field.isDropped = true;
+                            field.values.clear();
+                            return;
+                        }
+
+                        auto& valueLines = field.values[ std::string( value ) ];
+                        // Duplicate keys of a line add it once
+                        if ( valueLines.empty() || valueLines.back() != offset ) {
+                            valueLines.push_back( offset );
+                        }
+                        if ( field.values.size() > MaxValuesPerField ) {
+                            field.isDropped = true;
+                            field.values.clear();
+                        }
+                    } );
+            }
+        } );
+
+    ScopedLock lock( mutex_ );
+    if ( position.epoch != epoch_ || position.nextLine != nextLine_ ) {
+        return false;
+    }
+
+    const auto firstLine = position.nextLine.get();
+    klogg::vector<uint64_t> lineNumbers;
+    for ( auto& fields : localFields ) {
+        for ( auto& localField : fields ) {
+            auto fieldIt = fields_.find( localField.first );
+            if ( fieldIt == fields_.end() ) {
+                if ( fields_.size() >= MaxFields ) {
+                    LOG_INFO << "More than " << MaxFields << " fields, field index is not used";
+                    isOverflown_ = true;
+                    fields_.clear();
+                    break;
+                }
+                fieldIt = fields_.emplace( localField.first, Field{} ).first;
+            }
+
+            auto& field = fieldIt->second;
+            if ( field.isDropped ) {
+                continue;
+            }
+            if ( localField.second.isDropped ) {
+                field.isDropped = true;
+                field.values.clear();
+                continue;
+            }
+
+            for ( const auto& value : localField.second.values ) {
+                lineNumbers.resize( value.second.size() );
+                std::transform( value.second.cbegin(), value.second.cend(), lineNumbers.begin(),
+                                [ firstLine ]( uint64_t offset ) { return firstLine + offset; } );
+                auto& valueLines = field.values[ value.first ];
+                valueLines.addMany( lineNumbers.size(), lineNumbers.data() );
+                valueLines.runOptimize();
+            }
+
+            if ( field.values.size() > MaxValuesPerField ) {
+                field.isDropped = true;
+                field.values.clear();
+            }
+        }
+
+        if ( isOverflown_ ) {
+            break;
+        }
+    }
+
+    nextLine_ = nextLine_ + LinesCount( lines.size() );
+    return true;
+}
+
+void FieldIndex::clear()
+{
+    ScopedLock lock( mutex_ );
+    reset();
+}
+
+void FieldIndex::reset()
+{
+    ++epoch_;
+    nextLine_ = {};
+    isOverflown_ = false;
+    fields_.clear();
+}
+
+std::optional<roaring::Roaring64Map> FieldIndex::matchingLines( const FieldQuery& query,
+                                                                uint64_t linesGeneration,
+                                                                LineNumber first,
+                                                                LinesCount number ) const
+{
+    klogg::vector<uint64_t> lineNumbers( number.get() );
+    std::iota( lineNumbers.begin(), lineNumbers.end(), first.get() );
+    roaring::Roaring64Map lines;
+    lines.addMany( lineNumbers.size(), lineNumbers.data() );
+
+    ScopedLock lock( mutex_ );
+    if ( isOverflown_ || linesGeneration != linesGeneration_ || first + number > nextLine_ ) {
+        return std::nullopt;
+    }
+
+    for ( const auto& predicate : query.predicates() ) {
+        // Columns are not indexed
+        if ( predicate.column > 0 ) {
+            return std::nullopt;
+        }
+
+        const auto field = fields_.find( predicate.key );
+        if ( field == fields_.end() ) {
+            // No indexed line has the field
+            return roaring::Roaring64Map{};
+        }
+        if ( field->second.isDropped ) {
+            return std::nullopt;
+        }
+
+        roaring::Roaring64Map predicateLines;
+        if ( query.isCaseSensitive() && predicate.op == FieldQuery::Operator::Equal ) {
+            const auto value = field->second.values.find( predicate.value );
+            if ( value != field->second.values.end() ) {
+                predicateLines = lines & value->second;
+            }
+        }
+        else {
+            for ( const auto& value : field->second.values ) {
+                if ( query.isMatchingValue( predicate, value.first ) ) {
+                    predicateLines |= lines & value.second;
+                }
+            }
+        }
+
+        lines = std::move( predicateLines );
+        if ( lines.isEmpty() ) {
+            break;
+        }
+    }
+
+    return lines;
+}
+
+LinesCount FieldIndex::indexedLines() const
+{
+    ScopedLock lock( mutex_ );
+    return LinesCount( nextLine_.get() );
+}
+
+size_t FieldIndex::allocatedSize() const
+{
+    ScopedLock lock( mutex_ );
+    size_t size = fields_.size() * sizeof( Field );
+    for ( const auto& field : fields_ ) {
+        size += field.first.capacity();
+        for ( const auto& value : field.second.values ) {
+            size += value.first.capacity() + value.second.getSizeInBytes();
+        }
+    }
+    return size;
+}
@@ -18,6 +18,13 @@
  */
 
 #include "filedigest.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QIODevice>
+
+#define XXH_STATIC_LINKING_ONLY
 #include "xxhash.h"
 
 class DigestInternalState {
@@ -48,6 +55,23 @@ class DigestInternalState {
         return XXH64_digest( m_state );
     }
 
+    QByteArray state() const
+    {
+        return QByteArray( reinterpret_cast<const char*>( m_state ), sizeof( XXH64_state_t ) );
+    }
+
+    bool restoreState( const QByteArray& state )
+    {
+        if ( state.size() != static_cast<int>( sizeof( XXH64_state_t ) ) ) {
+            return false;
+        }
+
+        XXH64_state_t restoredState;
+        std::memcpy( &restoredState, state.data(), sizeof( XXH64_state_t ) );
+        XXH64_copyState( m_state, &restoredState );
+        return true;
+    }
+
   private:
     XXH64_state_t* m_state;
 };
@@ -80,3 +104,104 @@ void FileDigest::reset()
 {
     m_state->reset();
 }
+
+QByteArray FileDigest::state() const
+{
+    return m_state->state();
+}
+
+bool FileDigest::restoreState( const QByteArray& state )
+{
+    return m_state->restoreState( state );
+}
+
+BlockDigests::BlockDigests( qint64 blockSize )
+    : blockSize_( blockSize )
+{
+}
+
+BlockDigests::BlockDigests( const BlockDigests& other )
+    : blockSize_( other.blockSize_ )
+    , size_( other.size_ )
+    , completeBlocks_( other.completeBlocks_ )
+{
+    currentBlock_.restoreState( other.currentBlock_.state() );
+}
+
+BlockDigests& BlockDigests::operator=( const BlockDigests& other )
+{
+    if ( this != &other ) {
+        blockSize_ = other.blockSize_;
+        size_ = other.size_;
+        completeBlocks_ = other.completeBlocks_;
+        currentBlock_.restoreState( other.currentBlock_.state() );
+    }
+    return *this;
+}
+
+void BlockDigests::addData( const char* data, size_t length )
+{
+    while ( length > 0 ) {
+        const auto blockTail = static_cast<size_t>( blockSize_ - size_ % blockSize_ );
+        const auto chunk = std::min( length, blockTail );
+
+        currentBlock_.addData( data, chunk );
+        size_ += static_cast<qint64>( chunk );
+
+        if ( chunk == blockTail ) {
+            completeBlocks_.push_back( currentBlock_.digest() );
+            currentBlock_.reset();
+        }
+
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+void BlockDigests::reset()
+{
+    size_ = 0;
+    completeBlocks_.clear();
+    currentBlock_.reset();
+}
+
+void BlockDigests::truncate( size_t blocksCount )
+{
+    if ( blocksCount >= this->blocksCount() ) {
+        return;
+    }
+
+    completeBlocks_.resize( blocksCount );
+    size_ = static_cast<qint64>( blocksCount ) * blockSize_;
+    currentBlock_.reset();
+}
+
+size_t BlockDigests::blocksCount() const
+{
+    return completeBlocks_.size() + ( size_ % blockSize_ != 0 ? 1 : 0 );
+}
+
+uint64_t BlockDigests::digest( size_t block ) const
+{
+    return block < completeBlocks_.size() ? completeBlocks_[ block ] : currentBlock_.digest();
+}
+
+bool hasSameDigest( QIODevice& file, qint64 offset, qint64 size, quint64 expectedDigest )
+{
+    if ( size <= 0 ) {
+        return true;
+    }
+
+    if ( !file.seek( offset ) ) {
+        return false;
+    }
+
+    const auto data = file.read( size );
+    if ( data.size() != size ) {
+        return false;
+    }
+
+    FileDigest digest;
+    digest.addData( data );
+    return digest.digest() == expectedDigest;
+}
@@ -7,11 +7,21 @@
 #include <windows.h>
 #include <io.h>
 #else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <limits>
+
+#include "configuration.h"
 #include "log.h"
+#include "networkfilecache.h"
 #include <QtCore/QFileInfo>
+#include <QtCore/QStorageInfo>
 
 namespace {
 void openFileByHandle( QFile* file )
@@ -59,8 +69,422 @@ void openFileByHandle( QFile* file )
 }
 } // namespace
 
-FileHolder::FileHolder( bool keepClosed )
-    : keep_closed_{ keepClosed }
+bool canMapFile( const QFile& file )
+{
+    // Pipes and devices can't be mapped, network shares may change
+    // under the mapping, so these are read into buffers.
+    if ( file.isSequential() ) {
+        return false;
+    }
+
+    if ( isOnNetworkShare( file ) ) {
+        LOG_INFO << "Not mapping file on a network share " << file.fileName();
+        return false;
+    }
+
+    return true;
+}
+
+bool isOnNetworkShare( const QFile& file )
+{
+    const auto fileSystemType = QStorageInfo( QFileInfo( file ).absolutePath() )
+                                    .fileSystemType()
+                                    .toLower();
+    for ( const auto& networkFileSystem : { "nfs", "cifs", "smb", "sshfs", "afp", "9p" } ) {
+        if ( fileSystemType.contains( networkFileSystem ) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool isFileReadOnly( const QFile& file )
+{
+    const QFileInfo fileInfo( file );
+    const auto writePermissions
+        = QFileDevice::WriteOwner | QFileDevice::WriteGroup | QFileDevice::WriteOther;
+    if ( !( fileInfo.permissions() & writePermissions ) ) {
+        return true;
+    }
+
+    return QStorageInfo( fileInfo.absolutePath() ).isReadOnly();
+}
+
+bool isMappingAllowed( const QFile& file )
+{
+    return Configuration::get().mapWritableFiles() || isFileReadOnly( file );
+}
+
+std::shared_ptr<const FileMapping> FileMapping::map( const QString& fileName,
+                                                     const FileId& fileId, qint64 size )
+{
+    std::shared_ptr<FileMapping> mapping( new FileMapping );
+    mapping->file_ = std::make_unique<QFile>( fileName );
+    openFileByHandle( mapping->file_.get() );
+
+    // File could be replaced under the same name
+    if ( !mapping->file_->isOpen() || FileId::getFileId( fileName ) != fileId
+         || mapping->file_->size() < size || !canMapFile( *mapping->file_ ) ) {
+        return {};
+    }
+
+    mapping->data_ = reinterpret_cast<const char*>( mapping->file_->map( 0, size ) );
+    if ( mapping->data_ == nullptr ) {
+        LOG_WARNING << "Failed to map file: " << mapping->file_->errorString();
+        return {};
+    }
+
+    mapping->size_ = size;
+    LOG_DEBUG << "Mapped " << size << " bytes of " << fileName;
+
+    return mapping;
+}
+
+void FileMapping::willNeed( qint64 offset, qint64 size ) const
+{
+#ifdef Q_OS_WIN
+    Q_UNUSED( offset );
+    Q_UNUSED( size );
+#else
+    // Mapping starts at the beginning of the file, so it is page aligned
+    const auto pageSize = static_cast<qint64>( ::sysconf( _SC_PAGESIZE ) );
+    const auto alignedOffset = pageSize > 0 ? offset - offset % pageSize : offset;
+    ::madvise( const_cast<char*>( data_ + alignedOffset ),
+               static_cast<size_t>( size + offset - alignedOffset ), MADV_WILLNEED );
+#endif
+}
+
+FileReader::FileReader( std::shared_ptr<QFile> file,
+                        std::shared_ptr<const FileChain::Segments> chain,
+                        std::shared_ptr<const CompressedAccess> compressedAccess,
+                        std::shared_ptr<NetworkFileCache> networkCache )
+    : file_( std::move( file ) )
+    , chain_( std::move( chain ) )
+    , compressedAccess_( std::move( compressedAccess ) )
+    , networkCache_( std::move( networkCache ) )
+{
+    const auto fd = file_->handle();
+#ifdef Q_OS_WIN
+    if ( fd != -1 ) {
+        const auto handle = ::_get_osfhandle( fd );
+        if ( handle != reinterpret_cast<intptr_t>( INVALID_HANDLE_VALUE ) ) {
+            handle_ = reinterpret_cast<void*>( handle );
+        }
+    }
+#else
+    handle_ = fd;
+#endif
+}
+
+qint64 FileReader::read( qint64 offset, char* data, qint64 size ) const
+{
+    if ( chain_ && !chain_->empty() ) {
+        return FileChain::read( *chain_, offset, data, size,
+                                [ this ]( qint64 fileOffset, char* fileData, qint64 fileSize ) {
+                                    return readFile( fileOffset, fileData, fileSize );
+                                } );
+    }
+
+    return readFile( offset, data, size );
+}
+
+qint64 FileReader::readFile( qint64 offset, char* data, qint64 size ) const
+{
+    return compressedAccess_ ? readCompressedFile( offset, data, size )
+                             : readFileData( offset, data, size );
+}
+
+qint64 FileReader::readCompressedFile( qint64 offset, char* data, qint64 size ) const
+{
+    // Reader closest before the offset continues decompression from its position
+    std::unique_ptr<CompressedAccess::Reader> reader;
+    {
+        ScopedLock lock( compressedReadersMutex_ );
+        auto closest = compressedReaders_.end();
+        for ( auto candidate = compressedReaders_.begin(); candidate != compressedReaders_.end();
+              ++candidate ) {
+            const auto position = ( *candidate )->position();
+            const auto isCloser
+                = closest == compressedReaders_.end() || position > ( *closest )->position();
+            if ( position <= offset && isCloser ) {
+                closest = candidate;
+            }
+        }
+
+        if ( closest == compressedReaders_.end() && !compressedReaders_.empty() ) {
+            closest = compressedReaders_.begin();
+        }
+
+        if ( closest != compressedReaders_.end() ) {
+            reader = std::move( *closest );
+            compressedReaders_.erase( closest );
+        }
+    }
+
+    if ( !reader ) {
+        reader = compressedAccess_->makeReader(
+            [ this ]( qint64 fileOffset, char* fileData, qint64 fileSize ) {
+                return readFileData( fileOffset, fileData, fileSize );
+            } );
+    }
+
+    const auto bytesRead = reader->read( offset, data, size );
+
+    constexpr size_t MaxCompressedReaders = 4;
+    ScopedLock lock( compressedReadersMutex_ );
+    if ( compressedReaders_.size() < MaxCompressedReaders ) {
+        compressedReaders_.push_back( std::move( reader ) );
+    }
+
+    return bytesRead;
+}
+
+qint64 FileReader::readFileData( qint64 offset, char* data, qint64 size ) const
+{
+    if ( networkCache_ ) {
+        return networkCache_->read( offset, data, size,
+                                    [ this ]( qint64 fileOffset, char* fileData, qint64 fileSize ) {
+                                        return readFileHandle( fileOffset, fileData, fileSize );
+                                    } );
+    }
+
+    return readFileHandle( offset, data, size );
+}
+
+qint64 FileReader::readFileHandle( qint64 offset, char* data, qint64 size ) const
+{
+#ifdef Q_OS_WIN
+    if ( handle_ == nullptr ) {
+#else
+    if ( handle_ == -1 ) {
+#endif
+        ScopedLock lock( fileMutex_ );
+        if ( !file_->seek( offset ) ) {
+            return -1;
+        }
+        return file_->read( data, size );
+    }
+
+    qint64 bytesRead = 0;
+    while ( bytesRead < size ) {
+        const auto position = offset + bytesRead;
+#ifdef Q_OS_WIN
+        // Offset of the overlapped structure is used instead of the file pointer
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>( position & 0xFFFFFFFF );
+        overlapped.OffsetHigh = static_cast<DWORD>( position >> 32 );
+
+        const auto toRead = static_cast<DWORD>(
+            std::min( size - bytesRead, qint64{ std::numeric_limits<DWORD>::max() / 2 } ) );
+        DWORD chunkRead = 0;
+        if ( !::ReadFile( handle_, data + bytesRead, toRead, &chunkRead, &overlapped ) ) {
+            const auto error = ::GetLastError();
+            if ( error != ERROR_HANDLE_EOF ) {
+                LOG_WARNING << "Failed to read " << file_->fileName() << " at " << position
+                            << ", gle " << error;
+                return bytesRead > 0 ? bytesRead : -1;
+            }
+        }
+#else
+        const auto toRead = static_cast<size_t>(
+            std::min( size - bytesRead, qint64{ std::numeric_limits<ssize_t>::max() } ) );
+        const auto chunkRead = ::pread( handle_, data + bytesRead, toRead, position );
+        if ( chunkRead < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            LOG_WARNING << "Failed to read " << file_->fileName() << " at " << position
+                        << ", errno " << errno;
+            return bytesRead > 0 ? bytesRead : -1;
+        }
+#endif
+        if ( chunkRead == 0 ) {
+            break;
+        }
+
+        bytesRead += static_cast<qint64>( chunkRead );
+    }
+
+    return bytesRead;
+}
+
+void FileReader::willNeed( qint64 offset, qint64 size ) const
+{
+#ifdef Q_OS_LINUX
+    // Offsets of decompressed data are not the ones of the file
+    if ( compressedAccess_ ) {
+        return;
+    }
+
+    // Advice is given for the file itself only
+    if ( chain_ && !chain_->empty() ) {
+        offset -= FileChain::size( *chain_ );
+        if ( offset < 0 ) {
+            return;
+        }
+    }
+
+    if ( handle_ != -1 ) {
+        ::posix_fadvise( handle_, offset, size, POSIX_FADV_WILLNEED );
+    }
+#else
+    Q_UNUSED( offset );
+    Q_UNUSED( size );
+#endif
+}
+
+std::shared_ptr<const FileChain::Segments> FileChain::segments() const
+{
+    ScopedLock lock( mutex_ );
+    return segments_;
+}
+
+void FileChain::append( std::shared_ptr<const FileReader> reader, qint64 size, bool addLineFeed )
+{
+    ScopedLock lock( mutex_ );
+    auto segments = std::make_shared<Segments>( *segments_ );
+    segments->push_back( { std::move( reader ), FileChain::size( *segments ),
+                           addLineFeed ? size + 1 : size, addLineFeed } );
+    segments_ = std::move( segments );
+}
+
+qint64 FileChain::size( const Segments& segments )
+{
+    return segments.empty() ? 0 : segments.back().offset + segments.back().size;
+}
+
+void FileChain::setCompressedAccess( std::shared_ptr<CompressedAccess> compressedAccess )
+{
+    ScopedLock lock( mutex_ );
+    compressedAccess_ = std::move( compressedAccess );
+}
+
+std::shared_ptr<CompressedAccess> FileChain::compressedAccess() const
+{
+    ScopedLock lock( mutex_ );
+    return compressedAccess_;
+}
+
+ChainedFile::ChainedFile( const QString& fileName, const std::shared_ptr<const FileChain>& chain )
+{
+    setFile( fileName, chain );
+}
+
+ChainedFile::~ChainedFile() = default;
+
+void ChainedFile::setFile( const QString& fileName, const std::shared_ptr<const FileChain>& chain )
+{
+    close();
+    file_->setFileName( fileName );
+    chain_ = chain;
+    compressedReader_.reset();
+}
+
+bool ChainedFile::open( OpenMode mode )
+{
+    segments_ = chain_ ? chain_->segments() : std::make_shared<const FileChain::Segments>();
+    chainedSize_ = FileChain::size( *segments_ );
+
+    // Chained files are read even if the file with the name is not there yet
+    if ( !file_->open( mode ) ) {
+        setErrorString( file_->errorString() );
+        if ( segments_->empty() ) {
+            return false;
+        }
+    }
+    else if ( auto compressedAccess = chain_ ? chain_->compressedAccess() : nullptr ) {
+        // Access is built the first time the file is opened
+        const auto readCompressed = [ this ]( qint64 offset, char* data, qint64 size ) {
+            return file_->seek( offset ) ? file_->read( data, size ) : qint64{ -1 };
+        };
+        if ( !compressedAccess->build( readCompressed, file_->size() ) ) {
+            setErrorString( "Failed to decompress file" );
+            file_->close();
+            return false;
+        }
+
+        decompressedSize_ = compressedAccess->size();
+        compressedReader_ = compressedAccess->makeReader( readCompressed );
+    }
+
+    return QIODevice::open( mode | QIODevice::Unbuffered );
+}
+
+void ChainedFile::close()
+{
+    compressedReader_.reset();
+    file_->close();
+    QIODevice::close();
+}
+
+bool ChainedFile::isSequential() const
+{
+    return file_->isOpen() && file_->isSequential();
+}
+
+qint64 ChainedFile::size() const
+{
+    if ( !file_->isOpen() ) {
+        return chainedSize_;
+    }
+    return chainedSize_ + ( compressedReader_ ? decompressedSize_ : file_->size() );
+}
+
+bool ChainedFile::canMap() const
+{
+    return segments_ && segments_->empty() && !compressedReader_ && file_->isOpen()
+           && canMapFile( *file_ ) && isMappingAllowed( *file_ );
+}
+
+uchar* ChainedFile::map( qint64 offset, qint64 size )
+{
+    return canMap() ? file_->map( offset, size ) : nullptr;
+}
+
+std::shared_ptr<const FileReader> ChainedFile::reader() const
+{
+    if ( !isOpen() || !file_->isOpen() || compressedReader_ || isSequential() ) {
+        return {};
+    }
+
+    return std::make_shared<FileReader>(
+        file_, segments_->empty() ? nullptr : segments_, nullptr,
+        NetworkFileCache::forFile( *file_, FileId::getFileId( file_->fileName() ) ) );
+}
+
+qint64 ChainedFile::readData( char* data, qint64 maxSize )
+{
+    return FileChain::read( *segments_, pos(), data, maxSize,
+                            [ this ]( qint64 fileOffset, char* fileData, qint64 fileSize ) {
+                                return readFile( fileOffset, fileData, fileSize );
+                            } );
+}
+
+qint64 ChainedFile::readFile( qint64 offset, char* data, qint64 size )
+{
+    if ( !file_->isOpen() ) {
+        return 0;
+    }
+    if ( compressedReader_ ) {
+        return compressedReader_->read( offset, data, size );
+    }
+    if ( !file_->seek( offset ) ) {
+        return -1;
+    }
+    return file_->read( data, size );
+}
+
+qint64 ChainedFile::writeData( const char* data, qint64 maxSize )
+{
+    Q_UNUSED( data );
+    Q_UNUSED( maxSize );
+    return -1;
+}
+
+FileHolder::FileHolder( bool keepClosed, std::shared_ptr<FileChain> chain )
+    : chain_{ std::move( chain ) }
+    , keep_closed_{ keepClosed }
 {
 }
 
@@ -85,7 +509,11 @@ FileId FileHolder::getFileId()
 qint64 FileHolder::size()
 {
     ScopedRecursiveLock locker( file_mutex_ );
-    return attached_file_ ? attached_file_->size() : 0;
+    const auto chainedSize = chain_ ? FileChain::size( *chain_->segments() ) : 0;
+    if ( const auto compressedAccess = chain_ ? chain_->compressedAccess() : nullptr ) {
+        return chainedSize + ( attached_file_ ? compressedAccess->size() : 0 );
+    }
+    return chainedSize + ( attached_file_ ? attached_file_->size() : 0 );
 }
 
 bool FileHolder::isOpen()
@@ -139,7 +567,9 @@ void FileHolder::detachReader()
     }
 
     if ( keep_closed_ && counter_ == 0 ) {
-        attached_file_->close();
+        // Readers still in use keep their handle until they are done
+        attached_file_ = std::make_shared<QFile>( file_name_ );
+        reader_.reset();
         LOG_DEBUG << "last reader closed for " << file_name_;
     }
 }
@@ -148,7 +578,7 @@ void FileHolder::reOpenFile()
 {
     LOG_DEBUG << "reopen " << file_name_;
 
-    auto reopened = std::make_unique<QFile>( file_name_ );
+    auto reopened = std::make_shared<QFile>( file_name_ );
     if ( QFileInfo( file_name_ ).isReadable() ) {
         openFileByHandle( reopened.get() );
     }
@@ -156,11 +586,84 @@ void FileHolder::reOpenFile()
     ScopedRecursiveLock locker( file_mutex_ );
     attached_file_ = std::move( reopened );
     attached_file_id_ = FileId::getFileId( file_name_ );
+    reader_.reset();
+    mapping_.reset();
+
+    // Files that can be written are read with positional reads unless mapping them
+    // is allowed, so truncating them doesn't fault in a mapped read
+    can_map_ = attached_file_->isOpen() && isMappingAllowed( *attached_file_ );
+}
+
+bool FileHolder::chainOpenedFile()
+{
+    ScopedRecursiveLock locker( file_mutex_ );
+    if ( !chain_ || !attached_file_ || !attached_file_->isOpen() || chain_->compressedAccess() ) {
+        return false;
+    }
+
+    LOG_INFO << "Chaining " << attached_file_->size() << " bytes of rotated " << file_name_;
+    chain_->append( std::make_shared<FileReader>( attached_file_ ), attached_file_->size() );
+    reOpenFile();
+    return true;
 }
 
-QFile* FileHolder::getFile()
+std::shared_ptr<const FileMapping> FileHolder::getMapping( qint64 endOffset )
 {
-    return attached_file_.get();
+#ifdef Q_OS_WIN
+    // Mapped files can't be truncated on Windows, that would break log rotation
+    Q_UNUSED( endOffset );
+    return {};
+#else
+    ScopedRecursiveLock locker( file_mutex_ );
+    if ( keep_closed_ || !attached_file_ || !can_map_
+         || ( chain_ && ( !chain_->segments()->empty() || chain_->compressedAccess() ) ) ) {
+        return {};
+    }
+
+    if ( !mapping_ || mapping_->size() < endOffset ) {
+        // Reads of data added since the last mapping map the whole file again,
+        // lines read before keep the previous mapping.
+        mapping_ = FileMapping::map( file_name_, attached_file_id_, attached_file_->size() );
+    }
+
+    return mapping_ && mapping_->size() >= endOffset ? mapping_ : nullptr;
+#endif
+}
+
+void FileHolder::adviseWillNeed( qint64 offset, qint64 size )
+{
+    ScopedRecursiveLock locker( file_mutex_ );
+    if ( mapping_ && mapping_->size() >= offset + size ) {
+        mapping_->willNeed( offset, size );
+    }
+    else if ( const auto reader = getReader() ) {
+        reader->willNeed( offset, size );
+    }
+}
+
+std::shared_ptr<const FileReader> FileHolder::getReader()
+{
+    ScopedRecursiveLock locker( file_mutex_ );
+    // Chained files are read even if the file with the name is not there yet
+    auto chain = chain_ ? chain_->segments() : nullptr;
+    const auto hasChain = chain && !chain->empty();
+    if ( !attached_file_ || ( !attached_file_->isOpen() && !hasChain ) ) {
+        return {};
+    }
+
+    if ( !reader_ ) {
+        // Compressed file is read once its access is built by the indexing
+        auto compressedAccess = chain_ ? chain_->compressedAccess() : nullptr;
+        if ( compressedAccess && !compressedAccess->isBuilt() ) {
+            return {};
+        }
+
+        reader_ = std::make_shared<FileReader>(
+            attached_file_, hasChain ? std::move( chain ) : nullptr, std::move( compressedAccess ),
+            NetworkFileCache::forFile( *attached_file_, attached_file_id_ ) );
+    }
+
+    return reader_;
 }
 
 FileId FileId::getFileId( const QString& filename )
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "filterstatistics.h"
+
+#include <algorithm>
+#include <variant>
+
+#include "log.h"
+#include "logdata.h"
+
+namespace {
+// Lines read and scanned at once
+constexpr LinesCount::UnderlyingType ChunkLines = 5000;
+} // namespace
+
+FilterStatistics FilterStatistics::collect( const LogData& logData,
+                                            const klogg::vector<RegularExpressionPattern>& patterns,
+                                            const AtomicFlag& interruptRequested )
+{
+    FilterStatistics statistics;
+    statistics.matches.resize( patterns.size(), 0_lcount );
+    if ( patterns.empty() ) {
+        statistics.isValid = true;
+        return statistics;
+    }
+
+    const HsRegularExpression expression{ patterns };
+    if ( !expression.isValid() ) {
+        statistics.errorString = expression.errorString();
+        LOG_WARNING << "Can't compile filters: " << statistics.errorString;
+        return statistics;
+    }
+    statistics.isValid = true;
+
+    const auto matcher = expression.createMatcher();
+    const auto nbLines = logData.getNbLine();
+
+    logData.attachReader();
+
+    LineCursor cursor;
+    LogData::RawLines rawLines;
+    std::visit(
+        [ & ]( const auto& patternsMatcher ) {
+            while ( statistics.processedLines < nbLines && !interruptRequested ) {
+                const auto first = LineNumber( statistics.processedLines.get() );
+                const auto number
+                    = std::min( LinesCount( ChunkLines ), nbLines - statistics.processedLines );
+                logData.getLinesRaw( first, number, rawLines, &cursor );
+
+                for ( const auto& line : rawLines.buildUtf8View() ) {
+                    const auto matchedPatterns = patternsMatcher.match( line );
+                    const auto matchedCount = std::min( matchedPatterns.size(), patterns.size() );
+                    for ( size_t pattern = 0; pattern < matchedCount; ++pattern ) {
+                        if ( matchedPatterns[ pattern ] > 0 ) {
+                            ++statistics.matches[ pattern ];
+                        }
+                    }
+                }
+
+                statistics.processedLines += number;
+            }
+        },
+        matcher );
+
+    logData.detachReader();
+
+    LOG_INFO << "Counted matches of " << patterns.size() << " filters in "
+             << statistics.processedLines << " lines";
+    return statistics;
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "findinfiles.h"
+
+#include <algorithm>
+
+#include <QFile>
+#include <QTextCodec>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include "encodingdetector.h"
+#include "log.h"
+
+namespace {
+constexpr qint64 ReadBlockSize = 1024 * 1024;
+
+std::string_view withoutCarriageReturn( std::string_view line )
+{
+    if ( !line.empty() && line.back() == '\r' ) {
+        line.remove_suffix( 1 );
+    }
+    return line;
+}
+
+// Offsets after the line feeds of complete lines in the data, which starts at
+// the beginning of a character. Bytes of a wide line feed other than '\n' are 0.
+void findLineEnds( std::string_view data, const EncodingParameters& encoding,
+                   klogg::vector<size_t>& lineEnds )
+{
+    const auto width = static_cast<size_t>( encoding.lineFeedWidth );
+    const auto index = static_cast<size_t>( encoding.lineFeedIndex );
+
+    auto lineFeed = data.find( '\n', index );
+    while ( lineFeed != std::string_view::npos ) {
+        const auto start = lineFeed - index;
+        if ( start % width == 0 && start + width <= data.size() ) {
+            auto isLineFeed = true;
+            for ( auto i = start; i < start + width; ++i ) {
+                isLineFeed = isLineFeed && ( i == lineFeed || data[ i ] == '\0' );
+            }
+            if ( isLineFeed ) {
+                lineEnds.push_back( start + width );
+            }
+        }
+        lineFeed = data.find( '\n', lineFeed + 1 );
+    }
+}
+} // namespace
+
+FindInFiles::FindInFiles( const RegularExpressionPattern& pattern )
+    : expression_( pattern )
+{
+}
+
+bool FindInFiles::isValid() const
+{
+    return expression_.isValid();
+}
+
+QString FindInFiles::errorString() const
+{
+    return expression_.errorString();
+}
+
+void FindInFiles::run( const klogg::vector<QString>& fileNames, const FileSearched& fileSearched,
+                       const std::atomic<bool>& interruptRequested ) const
+{
+    LOG_INFO << "Finding in " << fileNames.size() << " files";
+
+    tbb::enumerable_thread_specific<std::unique_ptr<PatternMatcher>> matchers(
+        [ this ] { return expression_.createMatcher(); } );
+
+    tbb::parallel_for( size_t{ 0 }, fileNames.size(), [ & ]( size_t index ) {
+        if ( interruptRequested ) {
+            return;
+        }
+
+        auto matches = searchFile( fileNames[ index ], *matchers.local(), interruptRequested );
+        if ( !interruptRequested ) {
+            fileSearched( std::move( matches ) );
+        }
+    } );
+}
+
+FindInFiles::FileMatches
+FindInFiles::searchFile( const QString& fileName, const PatternMatcher& matcher,
+                         const std::atomic<bool>& interruptRequested ) const
+{
+    FileMatches matches;
+    matches.fileName = fileName;
+
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        matches.error = file.errorString();
+        return matches;
+    }
+
+    // Bytes of the last incomplete line are kept for the next block
+    klogg::vector<char> buffer;
+    qint64 bufferOffset = 0;
+
+    QTextCodec* codec = nullptr;
+    // Keeps the byte order read from the BOM for the following blocks
+    std::unique_ptr<QTextDecoder> decoder;
+    EncodingParameters encoding;
+    klogg::vector<size_t> lineEnds;
+    klogg::vector<std::string_view> lines;
+    klogg::vector<size_t> matchingLines;
+    QByteArray utf8Data;
+
+    auto isAtEnd = false;
+    while ( !isAtEnd && !interruptRequested ) {
+        const auto keptSize = buffer.size();
+        buffer.resize( keptSize + static_cast<size_t>( ReadBlockSize ) );
+        const auto bytesRead = file.read( buffer.data() + keptSize, ReadBlockSize );
+        if ( bytesRead < 0 ) {
+            matches.error = file.errorString();
+            return matches;
+        }
+        buffer.resize( keptSize + static_cast<size_t>( bytesRead ) );
+        isAtEnd = bytesRead == 0;
+
+        const auto data = std::string_view( buffer.data(), buffer.size() );
+        if ( codec == nullptr ) {
+            codec = EncodingDetector::getInstance().detectEncoding( data );
+            encoding = EncodingParameters( codec );
+            decoder.reset( codec->makeDecoder() );
+        }
+
+        lineEnds.clear();
+        findLineEnds( data, encoding, lineEnds );
+        // Last line of the file has no line feed
+        if ( isAtEnd && ( lineEnds.empty() ? !data.empty() : lineEnds.back() < data.size() ) ) {
+            lineEnds.push_back( data.size() );
+        }
+        if ( lineEnds.empty() ) {
+            continue;
+        }
+
+        const auto completeSize = lineEnds.back();
+        lines.clear();
+        if ( encoding.isUtf8Compatible ) {
+            size_t lineStart = 0;
+            for ( const auto lineEnd : lineEnds ) {
+                const auto lineFeedSize = data[ lineEnd - 1 ] == '\n' ? 1u : 0u;
+                lines.push_back( withoutCarriageReturn(
+                    data.substr( lineStart, lineEnd - lineStart - lineFeedSize ) ) );
+                lineStart = lineEnd;
+            }
+        }
+        else {
+            // Complete lines start and end on characters, so they are decoded at once
+            utf8Data
+                = decoder->toUnicode( data.data(), static_cast<int>( completeSize ) ).toUtf8();
+            std::string_view text( utf8Data.constData(), static_cast<size_t>( utf8Data.size() ) );
+            while ( lines.size() < lineEnds.size() ) {
+                const auto lineFeed = text.find( '\n' );
+                lines.push_back( withoutCarriageReturn( text.substr( 0, lineFeed ) ) );
+                text.remove_prefix( lineFeed == std::string_view::npos ? text.size()
+                                                                       : lineFeed + 1 );
+            }
+        }
+
+        matchingLines.clear();
+        if ( !matcher.matchLines( lines, matchingLines ) ) {
+            matcher.findMatchingLines( lines, matchingLines );
+        }
+
+        matches.nbMatches += matchingLines.size();
+        for ( const auto index : matchingLines ) {
+            if ( matches.firstMatches.size() >= MaxFirstMatches ) {
+                break;
+            }
+
+            const auto lineStart = index == 0 ? 0 : lineEnds[ index - 1 ];
+            const auto& line = lines[ index ];
+            matches.firstMatches.push_back(
+                { LineNumber( matches.nbLines + index ),
+                  bufferOffset + static_cast<qint64>( lineStart ),
+                  QString::fromUtf8( line.data(),
+                                     static_cast<int>( std::min(
+                                         line.size(), size_t{ MaxMatchTextLength } ) ) ) } );
+        }
+        matches.nbLines += lineEnds.size();
+
+        buffer.erase( buffer.begin(),
+                      buffer.begin() + static_cast<std::ptrdiff_t>( completeSize ) );
+        bufferOffset += static_cast<qint64>( completeSize );
+    }
+
+    LOG_DEBUG << "Found " << matches.nbMatches << " matches in " << fileName.toStdString();
+    return matches;
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "framedaccess.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+#include "log.h"
+
+namespace {
+// Sequential reads decompress at least this much data per thread at once,
+// so small frames are not decompressed one task at a time.
+constexpr qint64 ReadAheadSizePerThread = 1024 * 1024;
+
+size_t concurrency()
+{
+    return static_cast<size_t>( std::max( 1, tbb::this_task_arena::max_concurrency() ) );
+}
+
+qint64 readAheadSize()
+{
+    return static_cast<qint64>( concurrency() ) * ReadAheadSizePerThread;
+}
+} // namespace
+
+bool FramedAccess::readExactly( const ReadCompressed& readCompressed, qint64 offset, char* data,
+                                qint64 size )
+{
+    qint64 bytesRead = 0;
+    while ( bytesRead < size ) {
+        const auto chunkRead
+            = readCompressed( offset + bytesRead, data + bytesRead, size - bytesRead );
+        if ( chunkRead <= 0 ) {
+            return false;
+        }
+        bytesRead += chunkRead;
+    }
+    return true;
+}
+
+bool FramedAccess::build( const ReadCompressed& readCompressed, qint64 compressedSize )
+{
+    ScopedLock lock( buildMutex_ );
+    if ( isBuilt_ ) {
+        return true;
+    }
+
+    klogg::vector<Frame> frames;
+    if ( !readFrames( readCompressed, compressedSize, frames ) ) {
+        return false;
+    }
+
+    qint64 decompressedOffset = 0;
+    for ( auto& frame : frames ) {
+        if ( frame.compressedOffset + frame.compressedSize > compressedSize ) {
+            LOG_WARNING << "Compressed frames don't fit the file";
+            return false;
+        }
+
+        frame.decompressedOffset = decompressedOffset;
+        decompressedOffset += frame.decompressedSize;
+    }
+
+    LOG_INFO << "Compressed frames " << frames.size() << ", decompressed size "
+             << decompressedOffset;
+
+    frames_ = std::move( frames );
+    size_ = decompressedOffset;
+    isBuilt_ = true;
+    return true;
+}
+
+bool FramedAccess::isBuilt() const
+{
+    return isBuilt_;
+}
+
+qint64 FramedAccess::size() const
+{
+    return isBuilt_ ? size_ : 0;
+}
+
+std::unique_ptr<CompressedAccess::Reader>
+FramedAccess::makeReader( ReadCompressed readCompressed ) const
+{
+    return std::make_unique<Reader>(
+        std::static_pointer_cast<const FramedAccess>( shared_from_this() ),
+        std::move( readCompressed ) );
+}
+
+size_t FramedAccess::frameIndex( qint64 offset ) const
+{
+    const auto next = std::upper_bound(
+        frames_.begin(), frames_.end(), offset,
+        []( qint64 value, const Frame& frame ) { return value < frame.decompressedOffset; } );
+    return static_cast<size_t>( std::distance( frames_.begin(), next ) ) - 1;
+}
+
+FramedAccess::FrameData FramedAccess::cachedFrame( size_t frame ) const
+{
+    ScopedLock lock( cacheMutex_ );
+    const auto cached
+        = std::find_if( cache_.begin(), cache_.end(),
+                        [ frame ]( const auto& entry ) { return entry.first == frame; } );
+    if ( cached == cache_.end() ) {
+        return {};
+    }
+
+    // Move the frame to the most recent end
+    auto data = cached->second;
+    std::rotate( cached, std::next( cached ), cache_.end() );
+    return data;
+}
+
+void FramedAccess::cacheFrame( size_t frame, FrameData data ) const
+{
+    ScopedLock lock( cacheMutex_ );
+
+    // Frames decompressed by two sequential reads ahead fit the cache
+    const auto maxCachedSize = 2 * readAheadSize();
+    const auto minCachedFrames = 2 * concurrency();
+    while ( !cache_.empty() && cachedSize_ > maxCachedSize && cache_.size() > minCachedFrames ) {
+        cachedSize_ -= klogg::ssize( *cache_.front().second );
+        cache_.erase( cache_.begin() );
+    }
+
+    cachedSize_ += klogg::ssize( *data );
+    cache_.emplace_back( frame, std::move( data ) );
+}
+
+FramedAccess::FrameData FramedAccess::frameData( size_t frame,
+                                                 const ReadCompressed& readCompressed,
+                                                 bool isSequential ) const
+{
+    if ( auto data = cachedFrame( frame ) ) {
+        return data;
+    }
+
+    // Frames decompressed together are next to each other in the file,
+    // so they are read at once and only decompressed in parallel.
+    auto endFrame = frame + 1;
+    if ( isSequential ) {
+        auto decompressedSize = frames_[ frame ].decompressedSize;
+        while ( endFrame < frames_.size()
+                && ( endFrame - frame < concurrency() || decompressedSize < readAheadSize() )
+                && !cachedFrame( endFrame ) ) {
+            decompressedSize += frames_[ endFrame ].decompressedSize;
+            ++endFrame;
+        }
+    }
+
+    const auto compressedStart = frames_[ frame ].compressedOffset;
+    const auto compressedEnd
+        = frames_[ endFrame - 1 ].compressedOffset + frames_[ endFrame - 1 ].compressedSize;
+    klogg::vector<char> compressed( static_cast<size_t>( compressedEnd - compressedStart ) );
+    if ( !readExactly( readCompressed, compressedStart, compressed.data(),
+                       klogg::ssize( compressed ) ) ) {
+        return {};
+    }
+
+    klogg::vector<FrameData> decompressed( endFrame - frame );
+    tbb::parallel_for( frame, endFrame, [ & ]( size_t index ) {
+        const auto& source = frames_[ index ];
+        auto data = std::make_shared<klogg::vector<char>>(
+            static_cast<size_t>( source.decompressedSize ) );
+        if ( !decompressFrame( compressed.data() + ( source.compressedOffset - compressedStart ),
+                               source.compressedSize, data->data(), source.decompressedSize ) ) {
+            LOG_WARNING << "Failed to decompress frame " << index;
+            return;
+        }
+        decompressed[ index - frame ] = std::move( data );
+    } );
+
+    for ( auto index = frame; index < endFrame; ++index ) {
+        if ( decompressed[ index - frame ] ) {
+            cacheFrame( index, decompressed[ index - frame ] );
+        }
+    }
+
+    return decompressed.front();
+}
+
+FramedAccess::Reader::Reader( std::shared_ptr<const FramedAccess> access,
+                              ReadCompressed readCompressed )
+    : access_( std::move( access ) )
+    , readCompressed_( std::move( readCompressed ) )
+{
+}
+
+qint64 FramedAccess::Reader::position() const
+{
+    return position_;
+}
+
+qint64 FramedAccess::Reader::read( qint64 offset, char* data, qint64 size )
+{
+    const auto dataSize = access_->size();
+    if ( offset < 0 || size < 0 ) {
+        return -1;
+    }
+    if ( offset >= dataSize ) {
+        return 0;
+    }
+    size = std::min( size, dataSize - offset );
+
+    const auto isSequential = offset == position_;
+
+    qint64 bytesRead = 0;
+    while ( bytesRead < size ) {
+        const auto position = offset + bytesRead;
+        const auto frame = access_->frameIndex( position );
+        const auto frameData = access_->frameData( frame, readCompressed_, isSequential );
+        if ( !frameData ) {
+            return bytesRead > 0 ? bytesRead : -1;
+        }
+
+        const auto frameOffset = position - access_->frames_[ frame ].decompressedOffset;
+        const auto toCopy = std::min( size - bytesRead, klogg::ssize( *frameData ) - frameOffset );
+        std::memcpy( data + bytesRead, frameData->data() + frameOffset,
+                     static_cast<size_t>( toCopy ) );
+        bytesRead += toCopy;
+    }
+
+    position_ = offset + bytesRead;
+    return bytesRead;
+}
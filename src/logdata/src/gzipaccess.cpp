@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gzipaccess.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+
+#include <zlib.h>
+
+#include "log.h"
+
+namespace {
+// Back references of deflate streams reach this far
+constexpr size_t WindowSize = 32 * 1024;
+constexpr qint64 InputChunkSize = 64 * 1024;
+
+// Window bits of gzip streams with their headers and of raw deflate data
+constexpr int GzipWindowBits = 15 + 16;
+constexpr int RawWindowBits = -15;
+
+// Size of gzip trailer, not read by raw inflate
+constexpr int GzipTrailerSize = 8;
+
+uInt availableSize( qint64 size )
+{
+    return static_cast<uInt>(
+        std::min( size, static_cast<qint64>( std::numeric_limits<int>::max() ) ) );
+}
+} // namespace
+
+struct GzipAccess::Reader::State {
+    z_stream stream{};
+    bool isStreamActive = false;
+    // Deflate data of a member is read without its gzip header and trailer
+    bool isRaw = false;
+    // Bytes of the gzip trailer to skip after raw deflate data
+    int trailerLeft = 0;
+
+    qint64 position = 0;
+    qint64 inputOffset = 0;
+    std::array<unsigned char, InputChunkSize> input{};
+};
+
+bool GzipAccess::isBuilt() const
+{
+    return isBuilt_;
+}
+
+qint64 GzipAccess::size() const
+{
+    return isBuilt_ ? size_ : 0;
+}
+
+bool GzipAccess::build( const ReadCompressed& readCompressed, qint64 compressedSize )
+{
+    Q_UNUSED( compressedSize );
+
+    ScopedLock lock( buildMutex_ );
+    if ( isBuilt_ ) {
+        return true;
+    }
+
+    z_stream stream{};
+    if ( inflateInit2( &stream, GzipWindowBits ) != Z_OK ) {
+        return false;
+    }
+
+    std::array<unsigned char, InputChunkSize> input{};
+    klogg::vector<unsigned char> window( WindowSize );
+
+    // Offsets of data consumed and produced by inflate
+    qint64 totalIn = 0;
+    qint64 totalOut = 0;
+    qint64 lastPoint = 0;
+    qint64 readOffset = 0;
+
+    points_.clear();
+    points_.push_back( { 0, 0, 0, true, {} } );
+
+    auto isValid = true;
+    while ( true ) {
+        if ( stream.avail_in == 0 ) {
+            const auto readBytes = readCompressed(
+                readOffset, reinterpret_cast<char*>( input.data() ), klogg::ssize( input ) );
+            if ( readBytes < 0 ) {
+                isValid = false;
+                break;
+            }
+            if ( readBytes == 0 ) {
+                // Data of a truncated file is available up to its end
+                break;
+            }
+
+            readOffset += readBytes;
+            stream.next_in = input.data();
+            stream.avail_in = static_cast<uInt>( readBytes );
+        }
+
+        if ( stream.avail_out == 0 ) {
+            stream.next_out = window.data();
+            stream.avail_out = static_cast<uInt>( window.size() );
+        }
+
+        totalIn += stream.avail_in;
+        totalOut += stream.avail_out;
+        const auto result = inflate( &stream, Z_BLOCK );
+        totalIn -= stream.avail_in;
+        totalOut -= stream.avail_out;
+
+        if ( result == Z_STREAM_END ) {
+            // Another gzip member can follow
+            if ( stream.avail_in == 0 ) {
+                const auto readBytes = readCompressed(
+                    readOffset, reinterpret_cast<char*>( input.data() ), klogg::ssize( input ) );
+                if ( readBytes <= 0 ) {
+                    break;
+                }
+
+                readOffset += readBytes;
+                stream.next_in = input.data();
+                stream.avail_in = static_cast<uInt>( readBytes );
+            }
+
+            inflateReset( &stream );
+            points_.push_back( { totalOut, totalIn, 0, true, {} } );
+            lastPoint = totalOut;
+            continue;
+        }
+
+        if ( result != Z_OK && result != Z_BUF_ERROR ) {
+            // Data after the last member that is not a gzip member is ignored
+            if ( points_.size() > 1 && points_.back().isMemberStart
+                 && points_.back().decompressedOffset == totalOut ) {
+                LOG_INFO << "Ignoring data after gzip member at " << totalIn;
+                points_.pop_back();
+            }
+            else {
+                LOG_WARNING << "Failed to decompress at " << totalIn << ": " << result;
+                isValid = false;
+            }
+            break;
+        }
+
+        // Access points are at the ends of deflate blocks, except the last one of a member
+        const auto isBlockEnd = ( stream.data_type & 128 ) != 0 && ( stream.data_type & 64 ) == 0;
+        if ( isBlockEnd && totalOut - lastPoint > AccessPointSpan ) {
+            AccessPoint point{ totalOut, totalIn, stream.data_type & 7, false,
+                               klogg::vector<unsigned char>( WindowSize ) };
+
+            // Window is filled circularly, the oldest data is after the next output
+            const auto left = static_cast<size_t>( stream.avail_out );
+            std::memcpy( point.window.data(), window.data() + WindowSize - left, left );
+            std::memcpy( point.window.data() + left, window.data(), WindowSize - left );
+
+            points_.push_back( std::move( point ) );
+            lastPoint = totalOut;
+        }
+    }
+
+    inflateEnd( &stream );
+
+    if ( !isValid ) {
+        points_.clear();
+        return false;
+    }
+
+    LOG_INFO << "Gzip access points " << points_.size() << ", decompressed size " << totalOut;
+
+    size_ = totalOut;
+    isBuilt_ = true;
+    return true;
+}
+
+std::unique_ptr<CompressedAccess::Reader>
+GzipAccess::makeReader( ReadCompressed readCompressed ) const
+{
+    return std::make_unique<Reader>(
+        std::static_pointer_cast<const GzipAccess>( shared_from_this() ),
+        std::move( readCompressed ) );
+}
+
+const GzipAccess::AccessPoint& GzipAccess::accessPoint( qint64 offset ) const
+{
+    const auto next = std::upper_bound(
+        points_.begin(), points_.end(), offset,
+        []( qint64 value, const AccessPoint& point ) { return value < point.decompressedOffset; } );
+    return *std::prev( next );
+}
+
+GzipAccess::Reader::Reader( std::shared_ptr<const GzipAccess> access,
+                            ReadCompressed readCompressed )
+    : access_( std::move( access ) )
+    , readCompressed_( std::move( readCompressed ) )
+    , state_( std::make_unique<State>() )
+{
+}
+
+GzipAccess::Reader::~Reader()
+{
+    if ( state_->isStreamActive ) {
+        inflateEnd( &state_->stream );
+    }
+}
+
+qint64 GzipAccess::Reader::position() const
+{
+    return state_->isStreamActive ? state_->position : -1;
+}
+
+bool GzipAccess::Reader::start( qint64 offset )
+{
+    auto& state = *state_;
+    if ( state.isStreamActive ) {
+        inflateEnd( &state.stream );
+        state.isStreamActive = false;
+    }
+
+    const auto& point = access_->accessPoint( offset );
+
+    state.stream = z_stream{};
+    state.isRaw = !point.isMemberStart;
+    state.trailerLeft = 0;
+    if ( inflateInit2( &state.stream, state.isRaw ? RawWindowBits : GzipWindowBits ) != Z_OK ) {
+        return false;
+    }
+    state.isStreamActive = true;
+
+    state.inputOffset = point.compressedOffset;
+    if ( state.isRaw ) {
+        if ( point.bits > 0 ) {
+            // Point starts inside of the previous byte
+            char byte = 0;
+            if ( readCompressed_( point.compressedOffset - 1, &byte, 1 ) != 1 ) {
+                return false;
+            }
+            inflatePrime( &state.stream, point.bits,
+                          static_cast<unsigned char>( byte ) >> ( 8 - point.bits ) );
+        }
+
+        inflateSetDictionary( &state.stream, point.window.data(),
+                              static_cast<uInt>( point.window.size() ) );
+    }
+
+    state.position = point.decompressedOffset;
+    return true;
+}
+
+qint64 GzipAccess::Reader::inflateTo( char* data, qint64 size )
+{
+    auto& state = *state_;
+    auto& stream = state.stream;
+
+    stream.next_out = reinterpret_cast<unsigned char*>( data );
+    stream.avail_out = availableSize( size );
+    const auto requested = stream.avail_out;
+
+    while ( stream.avail_out > 0 ) {
+        if ( stream.avail_in == 0 ) {
+            const auto readBytes
+                = readCompressed_( state.inputOffset, reinterpret_cast<char*>( state.input.data() ),
+                                   klogg::ssize( state.input ) );
+            if ( readBytes < 0 ) {
+                return -1;
+            }
+            if ( readBytes == 0 ) {
+                break;
+            }
+
+            state.inputOffset += readBytes;
+            stream.next_in = state.input.data();
+            stream.avail_in = static_cast<uInt>( readBytes );
+        }
+
+        if ( state.trailerLeft > 0 ) {
+            const auto skipped
+                = std::min( static_cast<uInt>( state.trailerLeft ), stream.avail_in );
+            stream.next_in += skipped;
+            stream.avail_in -= skipped;
+            state.trailerLeft -= static_cast<int>( skipped );
+            if ( state.trailerLeft == 0 ) {
+                inflateReset2( &stream, GzipWindowBits );
+                state.isRaw = false;
+            }
+            continue;
+        }
+
+        const auto result = inflate( &stream, Z_NO_FLUSH );
+        if ( result == Z_STREAM_END ) {
+            // Next gzip member follows the trailer
+            if ( state.isRaw ) {
+                state.trailerLeft = GzipTrailerSize;
+            }
+            else {
+                inflateReset( &stream );
+            }
+            continue;
+        }
+
+        if ( result != Z_OK && !( result == Z_BUF_ERROR && stream.avail_in == 0 ) ) {
+            LOG_WARNING << "Failed to decompress at " << state.inputOffset << ": " << result;
+            return -1;
+        }
+    }
+
+    const auto produced = static_cast<qint64>( requested - stream.avail_out );
+    state.position += produced;
+    return produced;
+}
+
+qint64 GzipAccess::Reader::read( qint64 offset, char* data, qint64 size )
+{
+    const auto dataSize = access_->size();
+    if ( offset < 0 || size < 0 ) {
+        return -1;
+    }
+    if ( offset >= dataSize ) {
+        return 0;
+    }
+    size = std::min( size, dataSize - offset );
+
+    // Decompression continues if no access point is closer to the offset
+    auto& state = *state_;
+    const auto& point = access_->accessPoint( offset );
+    if ( !state.isStreamActive || offset < state.position
+         || point.decompressedOffset > state.position ) {
+        if ( !start( offset ) ) {
+            state.isStreamActive = false;
+            return -1;
+        }
+    }
+
+    std::array<char, InputChunkSize> skipped;
+    while ( state.position < offset ) {
+        const auto skipSize = std::min( klogg::ssize( skipped ), offset - state.position );
+        if ( inflateTo( skipped.data(), skipSize ) <= 0 ) {
+            return -1;
+        }
+    }
+
+    qint64 bytesRead = 0;
+    while ( bytesRead < size ) {
+        const auto readBytes = inflateTo( data + bytesRead, size - bytesRead );
+        if ( readBytes < 0 ) {
+            return bytesRead > 0 ? bytesRead : -1;
+        }
+        if ( readBytes == 0 ) {
+            break;
+        }
+        bytesRead += readBytes;
+    }
+
+    return bytesRead;
+}
@@ -0,0 +1,529 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "indexcache.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <QTextCodec>
+
+#include "configuration.h"
+#include "encodingdetector.h"
+#include "filedigest.h"
+#include "linepositionarray.h"
+#include "log.h"
+#include "logdataworker.h"
+#include "tokenfilters.h"
+#include "trigramindex.h"
+
+namespace {
+constexpr quint32 IndexCacheMagic = 0x4b4c4958; // KLIX
+constexpr quint32 IndexCacheVersion = 4;
+
+constexpr qint64 MinCachedFileSize = 64 * 1024 * 1024;
+constexpr int MaxCacheEntries = 64;
+constexpr LineNumber::UnderlyingType LinesPerChunk = 64 * 1024;
+
+// Images in the shared directory are named after the digest of the beginning of the file
+constexpr qint64 ImageKeySize = 1024 * 1024;
+
+// Line ends of shared images checked against the file without its full digest
+constexpr LineNumber::UnderlyingType SampledLineEnds = 1024;
+constexpr LineNumber::UnderlyingType CheckedLastLineEnds = 64;
+constexpr qint64 DigestBlockSize = 1024 * 1024;
+
+QString cacheDirectory()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + "/index";
+}
+
+QString cacheFileName( const QString& absoluteFileName )
+{
+    FileDigest pathDigest;
+    pathDigest.addData( absoluteFileName.toUtf8() );
+    return cacheDirectory() + "/" + QString::number( pathDigest.digest(), 16 ) + ".idx";
+}
+
+// Image next to the file, used by everyone opening it
+QString imageNextToFile( const QFileInfo& fileInfo )
+{
+    return fileInfo.absoluteFilePath() + ".klogg-index";
+}
+
+// Image in the shared directory, found by anyone opening a file with the same name and
+// beginning, wherever it is mounted. Empty without the shared directory.
+QString sharedImageFileName( const QFileInfo& fileInfo )
+{
+    const auto sharedDirectory = Configuration::get().sharedIndexDirectory();
+    if ( sharedDirectory.isEmpty() ) {
+        return {};
+    }
+
+    QFile file( fileInfo.absoluteFilePath() );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        return {};
+    }
+
+    FileDigest headerDigest;
+    headerDigest.addData( file.read( ImageKeySize ) );
+    return sharedDirectory + "/" + fileInfo.fileName() + "."
+           + QString::number( headerDigest.digest(), 16 ) + ".klogg-index";
+}
+
+QByteArray codecName( const QTextCodec* codec )
+{
+    return codec != nullptr ? codec->name() : QByteArray{};
+}
+
+// Line positions are stored as LEB128 encoded deltas
+void writeVarint( QByteArray& buffer, quint64 value )
+{
+    while ( value >= 0x80 ) {
+        buffer.append( static_cast<char>( ( value & 0x7f ) | 0x80 ) );
+        value >>= 7;
+    }
+    buffer.append( static_cast<char>( value ) );
+}
+
+bool readVarint( const char*& current, const char* end, quint64& value )
+{
+    value = 0;
+    for ( int shift = 0; current != end && shift < 64; shift += 7 ) {
+        const auto byte = static_cast<quint8>( *current++ );
+        value |= static_cast<quint64>( byte & 0x7f ) << shift;
+        if ( ( byte & 0x80 ) == 0 ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool hasSameFullDigest( QFile& file, const IndexedHash& hash )
+{
+    if ( !file.seek( 0 ) ) {
+        return false;
+    }
+
+    FileDigest digest;
+    for ( qint64 offset = 0; offset < hash.size; ) {
+        const auto data = file.read( std::min( DigestBlockSize, hash.size - offset ) );
+        if ( data.isEmpty() ) {
+            return false;
+        }
+        digest.addData( data );
+        offset += data.size();
+    }
+    return digest.digest() == hash.fullDigest;
+}
+
+// Evenly spaced and last lines of the index must end with a line feed in the file
+bool hasLineEnds( QFile& file, const LinePositionArray& linePositions, bool fakeFinalLF,
+                  const QTextCodec* codec )
+{
+    if ( codec == nullptr ) {
+        return false;
+    }
+
+    const auto encodingParams = EncodingParameters( codec );
+    const auto hasLineEnd = [ &file, &encodingParams ]( OffsetInFile lineEnd ) {
+        const auto lineFeedStart = lineEnd.get() - encodingParams.lineFeedWidth;
+        if ( lineFeedStart < 0 || !file.seek( lineFeedStart ) ) {
+            return false;
+        }
+        const auto lineFeed = file.read( encodingParams.lineFeedWidth );
+        return lineFeed.size() == encodingParams.lineFeedWidth
+               && lineFeed[ encodingParams.lineFeedIndex ] == '\n';
+    };
+
+    // Last line without a line feed ends at the end of the indexed data
+    auto linesCount = static_cast<LineNumber::UnderlyingType>( linePositions.size().get() );
+    if ( fakeFinalLF && linesCount > 0 ) {
+        --linesCount;
+    }
+
+    const auto step = std::max( LineNumber::UnderlyingType{ 1 }, linesCount / SampledLineEnds );
+    for ( LineNumber::UnderlyingType line = 0; line < linesCount; line += step ) {
+        if ( !hasLineEnd( linePositions.at( line ) ) ) {
+            return false;
+        }
+    }
+
+    const auto lastLines = std::min( linesCount, CheckedLastLineEnds );
+    for ( auto line = linesCount - lastLines; line < linesCount; ++line ) {
+        if ( !hasLineEnd( linePositions.at( line ) ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void removeOldEntries()
+{
+    QDir cacheDir( cacheDirectory() );
+    const auto entries
+        = cacheDir.entryInfoList( { "*.idx" }, QDir::Files, QDir::Time | QDir::Reversed );
+
+    for ( auto i = 0; i < entries.size() - MaxCacheEntries; ++i ) {
+        LOG_INFO << "Removing old index cache " << entries[ i ].fileName().toStdString();
+        QFile::remove( entries[ i ].absoluteFilePath() );
+    }
+}
+
+// Modification time of a copy of the file can be different, images shared by
+// copies are checked by the digests and their line ends
+bool loadIndex( const QString& indexFileName, const QFileInfo& fileInfo,
+                IndexingData& indexingData, bool isSharedImage = false )
+{
+    const auto fileName = fileInfo.absoluteFilePath();
+
+    QFile cacheFile( indexFileName );
+    if ( !cacheFile.open( QIODevice::ReadOnly ) ) {
+        return false;
+    }
+
+    // Index is read from the mapped file, not copied to buffers of the stream first
+    const auto cacheSize = cacheFile.size();
+    const auto* mappedCache = cacheSize <= std::numeric_limits<int>::max()
+                                  ? cacheFile.map( 0, cacheSize )
+                                  : nullptr;
+    auto mappedData = mappedCache != nullptr
+                          ? QByteArray::fromRawData( reinterpret_cast<const char*>( mappedCache ),
+                                                     static_cast<int>( cacheSize ) )
+                          : QByteArray{};
+    QBuffer mappedBuffer( &mappedData );
+    if ( mappedCache != nullptr ) {
+        mappedBuffer.open( QIODevice::ReadOnly );
+    }
+
+    QDataStream cache( mappedCache != nullptr ? static_cast<QIODevice*>( &mappedBuffer )
+                                              : &cacheFile );
+    cache.setVersion( QDataStream::Qt_5_9 );
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint8 byteOrder = 0;
+    cache >> magic >> version >> byteOrder;
+    if ( magic != IndexCacheMagic || version != IndexCacheVersion ) {
+        LOG_INFO << "Index cache version mismatch for " << fileName.toStdString();
+        return false;
+    }
+
+    // Stream is big endian on all machines, but the state of the digest is saved as is
+    if ( byteOrder != static_cast<quint8>( QSysInfo::ByteOrder ) ) {
+        LOG_INFO << "Index cache byte order mismatch for " << fileName.toStdString();
+        return false;
+    }
+
+    QString cachedFileName;
+    qint64 modificationTime = 0;
+    bool fastModificationDetection = false;
+    QByteArray forcedEncoding;
+    IndexedHash hash;
+    QByteArray hashBuilderState;
+    qint64 maxLength = 0;
+    QByteArray encodingGuess;
+    bool fakeFinalLF = false;
+    qint64 linesCount = 0;
+
+    cache >> cachedFileName >> modificationTime >> fastModificationDetection >> forcedEncoding;
+    cache >> hash.size >> hash.fullDigest >> hash.headerSize >> hash.headerDigest
+        >> hash.tailSize >> hash.tailOffset >> hash.tailDigest;
+    cache >> hashBuilderState >> maxLength >> encodingGuess >> fakeFinalLF >> linesCount;
+
+    // Name of the indexed file is informational, the image can be used for a copy of the
+    // file at another path or renamed by rotation, digests tell if it is the same file
+    if ( cache.status() != QDataStream::Ok ) {
+        return false;
+    }
+
+    {
+        IndexingData::ConstAccessor scopedAccessor{ &indexingData };
+        if ( fastModificationDetection != scopedAccessor.isFastModificationDetectionUsed()
+             || forcedEncoding != codecName( scopedAccessor.getForcedEncoding() ) ) {
+            LOG_INFO << "Index cache settings mismatch for " << fileName.toStdString();
+            return false;
+        }
+    }
+
+    // File can only grow since the index was cached
+    const auto currentModificationTime = fileInfo.lastModified().toMSecsSinceEpoch();
+    if ( fileInfo.size() < hash.size
+         || ( !isSharedImage && fileInfo.size() == hash.size
+              && currentModificationTime != modificationTime ) ) {
+        LOG_INFO << "Index cache is outdated for " << fileName.toStdString();
+        return false;
+    }
+
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly )
+         || !hasSameDigest( file, 0, hash.headerSize, hash.headerDigest )
+         || !hasSameDigest( file, hash.tailOffset, hash.tailSize, hash.tailDigest ) ) {
+        LOG_INFO << "Index cache digest mismatch for " << fileName.toStdString();
+        return false;
+    }
+
+    LinePositionArray linePositions( AdaptiveLinePositionStorage::forFileSize( fileInfo.size() ) );
+    quint64 lastPosition = 0;
+    qint64 linesRead = 0;
+    while ( linesRead < linesCount ) {
+        QByteArray chunk;
+        cache >> chunk;
+        if ( cache.status() != QDataStream::Ok ) {
+            LOG_WARNING << "Index cache is truncated for " << fileName.toStdString();
+            return false;
+        }
+
+        FastLinePositionArray chunkPositions;
+        const char* current = chunk.constData();
+        const char* end = current + chunk.size();
+        while ( current != end ) {
+            quint64 delta = 0;
+            if ( !readVarint( current, end, delta ) ) {
+                LOG_WARNING << "Index cache is corrupted for " << fileName.toStdString();
+                return false;
+            }
+
+            lastPosition += delta;
+            chunkPositions.append( OffsetInFile( lastPosition ) );
+            ++linesRead;
+        }
+
+        if ( linesRead == linesCount ) {
+            chunkPositions.setFakeFinalLF( fakeFinalLF );
+        }
+        linePositions.append_list( chunkPositions );
+    }
+
+    if ( linesRead != linesCount ) {
+        return false;
+    }
+
+    // Copy with the same name, size, beginning and end can still differ in the middle
+    const auto codec = QTextCodec::codecForName( forcedEncoding.isEmpty() ? encodingGuess
+                                                                           : forcedEncoding );
+    if ( isSharedImage
+         && ( ( !fastModificationDetection && !hasSameFullDigest( file, hash ) )
+              || !hasLineEnds( file, linePositions, fakeFinalLF, codec ) ) ) {
+        LOG_INFO << "Shared index image " << indexFileName.toStdString()
+                 << " doesn't match the content of " << fileName.toStdString();
+        return false;
+    }
+
+    // Line positions are used even if trigrams and tokens are not, they are read
+    // to get to the data after them. Data after unreadable ones is not read.
+    const auto& config = Configuration::get();
+    bool hasTrigramIndex = false;
+    cache >> hasTrigramIndex;
+    auto trigramIndex = std::make_shared<TrigramIndex>();
+    const auto isTrigramIndexRead = hasTrigramIndex && trigramIndex->read( cache );
+    if ( hasTrigramIndex && !isTrigramIndexRead ) {
+        LOG_WARNING << "Can't read cached trigram index for " << fileName.toStdString();
+    }
+    if ( !isTrigramIndexRead || trigramIndex->endOffset() != hash.size
+         || !config.useTrigramIndex() ) {
+        trigramIndex.reset();
+    }
+
+    bool hasTokenFilters = false;
+    if ( !hasTrigramIndex || isTrigramIndexRead ) {
+        cache >> hasTokenFilters;
+    }
+    auto tokenFilters = std::make_shared<TokenFilters>();
+    const auto isTokenFiltersRead = hasTokenFilters && tokenFilters->read( cache );
+    if ( hasTokenFilters && !isTokenFiltersRead ) {
+        LOG_WARNING << "Can't read cached token filters for " << fileName.toStdString();
+    }
+    if ( !isTokenFiltersRead || tokenFilters->endOffset() != hash.size
+         || !config.useTokenFilters() ) {
+        tokenFilters.reset();
+    }
+
+    IndexingData::MutateAccessor scopedAccessor{ &indexingData };
+    const auto isRestored = scopedAccessor.restore(
+        std::move( linePositions ),
+        LineLength( type_safe::narrow_cast<LineLength::UnderlyingType>( maxLength ) ), hash,
+        hashBuilderState, QTextCodec::codecForName( encodingGuess ) );
+    if ( isRestored ) {
+        scopedAccessor.setTrigramIndex( std::move( trigramIndex ) );
+        scopedAccessor.setTokenFilters( std::move( tokenFilters ) );
+    }
+
+    LOG_INFO << "Index cache " << indexFileName.toStdString() << " loaded for "
+             << fileName.toStdString() << ", lines " << linesCount << ", indexed size "
+             << hash.size;
+
+    return isRestored;
+}
+
+bool saveIndex( const QString& indexFileName, const QFileInfo& fileInfo,
+                const IndexingData& indexingData )
+{
+    const auto fileName = fileInfo.absoluteFilePath();
+
+    // Image is replaced at once, others opening the file never read a partial one
+    QSaveFile cacheFile( indexFileName );
+    if ( !cacheFile.open( QIODevice::WriteOnly ) ) {
+        LOG_WARNING << "Can't write index cache " << indexFileName.toStdString() << " for "
+                    << fileName.toStdString();
+        return false;
+    }
+
+    // Index is copied with positions encoded as they are stored, then written
+    // without blocking the indexing
+    IndexedHash hash;
+    LineNumber::UnderlyingType linesCount = 0;
+    bool isFastModificationDetectionUsed = false;
+    QByteArray forcedEncoding;
+    QByteArray hashBuilderState;
+    qint64 maxLength = 0;
+    QByteArray encodingGuess;
+    bool fakeFinalLF = false;
+    klogg::vector<QByteArray> chunks;
+    std::shared_ptr<TrigramIndex> trigramIndex;
+    std::shared_ptr<TokenFilters> tokenFilters;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ &indexingData };
+
+        hash = scopedAccessor.getHash();
+        linesCount = scopedAccessor.getNbLines().get();
+        isFastModificationDetectionUsed = scopedAccessor.isFastModificationDetectionUsed();
+        forcedEncoding = codecName( scopedAccessor.getForcedEncoding() );
+        hashBuilderState = scopedAccessor.getHashBuilderState();
+        maxLength = static_cast<qint64>( scopedAccessor.getMaxLength().get() );
+        encodingGuess = codecName( scopedAccessor.getEncodingGuess() );
+        fakeFinalLF = scopedAccessor.hasFakeFinalLF();
+
+        quint64 lastPosition = 0;
+        klogg::vector<OffsetInFile> positions;
+        for ( LineNumber::UnderlyingType chunkBegin = 0; chunkBegin < linesCount;
+              chunkBegin += LinesPerChunk ) {
+            const auto chunkLines = std::min( LinesPerChunk, linesCount - chunkBegin );
+            positions.resize( static_cast<size_t>( chunkLines ) );
+            scopedAccessor.getEndOfLineOffsets( LineNumber( chunkBegin ), LinesCount( chunkLines ),
+                                                positions.data() );
+
+            QByteArray chunk;
+            for ( const auto& position : positions ) {
+                writeVarint( chunk, static_cast<quint64>( position.get() ) - lastPosition );
+                lastPosition = static_cast<quint64>( position.get() );
+            }
+            chunks.push_back( std::move( chunk ) );
+        }
+
+        // Trigrams and tokens are thread-safe, they are written after the index is released
+        trigramIndex = scopedAccessor.getTrigramIndex();
+        tokenFilters = scopedAccessor.getTokenFilters();
+    }
+
+    QDataStream cache( &cacheFile );
+    cache.setVersion( QDataStream::Qt_5_9 );
+
+    cache << IndexCacheMagic << IndexCacheVersion << static_cast<quint8>( QSysInfo::ByteOrder );
+    cache << fileInfo.fileName() << fileInfo.lastModified().toMSecsSinceEpoch()
+          << isFastModificationDetectionUsed << forcedEncoding;
+    cache << hash.size << hash.fullDigest << hash.headerSize << hash.headerDigest << hash.tailSize
+          << hash.tailOffset << hash.tailDigest;
+    cache << hashBuilderState << maxLength << encodingGuess << fakeFinalLF
+          << static_cast<qint64>( linesCount );
+
+    for ( const auto& chunk : chunks ) {
+        cache << chunk;
+    }
+
+    // Trigrams are cached only if they cover all indexed data
+    const auto hasTrigramIndex = trigramIndex && trigramIndex->startOffset() == 0
+                                 && trigramIndex->endOffset() == hash.size;
+    cache << hasTrigramIndex;
+    if ( hasTrigramIndex ) {
+        trigramIndex->write( cache );
+    }
+
+    const auto hasTokenFilters = tokenFilters && tokenFilters->startOffset() == 0
+                                 && tokenFilters->endOffset() == hash.size;
+    cache << hasTokenFilters;
+    if ( hasTokenFilters ) {
+        tokenFilters->write( cache );
+    }
+
+    if ( cache.status() != QDataStream::Ok || !cacheFile.commit() ) {
+        LOG_WARNING << "Failed to write index cache " << indexFileName.toStdString() << " for "
+                    << fileName.toStdString();
+        return false;
+    }
+
+    LOG_INFO << "Index cache " << indexFileName.toStdString() << " saved for "
+             << fileName.toStdString();
+    return true;
+}
+} // namespace
+
+bool loadCachedIndex( const QString& fileName, IndexingData& indexingData )
+{
+    const QFileInfo fileInfo( fileName );
+    if ( fileInfo.size() < MinCachedFileSize ) {
+        return false;
+    }
+
+    // Own cache is on a local disk, images shared by others are tried if it is missing
+    // or outdated
+    if ( loadIndex( cacheFileName( fileInfo.absoluteFilePath() ), fileInfo, indexingData )
+         || loadIndex( imageNextToFile( fileInfo ), fileInfo, indexingData ) ) {
+        return true;
+    }
+
+    const auto sharedImage = sharedImageFileName( fileInfo );
+    constexpr auto IsSharedImage = true;
+    return !sharedImage.isEmpty()
+           && loadIndex( sharedImage, fileInfo, indexingData, IsSharedImage );
+}
+
+void saveIndexToCache( const QString& fileName, const IndexingData& indexingData )
+{
+    const QFileInfo fileInfo( fileName );
+    if ( fileInfo.size() < MinCachedFileSize ) {
+        return;
+    }
+
+    if ( !QDir().mkpath( cacheDirectory() ) ) {
+        LOG_WARNING << "Can't create index cache directory " << cacheDirectory().toStdString();
+    }
+    else if ( saveIndex( cacheFileName( fileInfo.absoluteFilePath() ), fileInfo,
+                         indexingData ) ) {
+        removeOldEntries();
+    }
+
+    if ( Configuration::get().writeIndexNextToFile() ) {
+        saveIndex( imageNextToFile( fileInfo ), fileInfo, indexingData );
+    }
+
+    const auto sharedImage = sharedImageFileName( fileInfo );
+    if ( !sharedImage.isEmpty() ) {
+        saveIndex( sharedImage, fileInfo, indexingData );
+    }
+}
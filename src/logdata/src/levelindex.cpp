@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "levelindex.h"
+
+#include <algorithm>
+
+namespace {
+struct LevelWord {
+    std::string_view word;
+    LogLevel level;
+    // Words also used in the text of messages are only taken in upper case
+    bool isUpperCaseOnly;
+};
+
+constexpr std::array<LevelWord, 20> LevelWords = { {
+    { "ERROR", LogLevel::Error, false },
+    { "FATAL", LogLevel::Error, false },
+    { "ERR", LogLevel::Error, true },
+    { "CRIT", LogLevel::Error, true },
+    { "CRITICAL", LogLevel::Error, true },
+    { "SEVERE", LogLevel::Error, true },
+    { "EMERG", LogLevel::Error, true },
+    { "ALERT", LogLevel::Error, true },
+    { "PANIC", LogLevel::Error, true },
+    { "WARN", LogLevel::Warning, false },
+    { "WARNING", LogLevel::Warning, false },
+    { "INFO", LogLevel::Info, false },
+    { "NOTICE", LogLevel::Info, true },
+    { "DEBUG", LogLevel::Debug, false },
+    { "DBG", LogLevel::Debug, true },
+    { "FINE", LogLevel::Debug, true },
+    { "TRACE", LogLevel::Trace, false },
+    { "VERBOSE", LogLevel::Trace, true },
+    { "FINER", LogLevel::Trace, true },
+    { "FINEST", LogLevel::Trace, true },
+} };
+
+constexpr size_t MaxLevelWordLength = 8;
+
+bool isWordChar( char c )
+{
+    return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= '0' && c <= '9' )
+           || c == '_';
+}
+
+char toUpper( char c )
+{
+    return c >= 'a' && c <= 'z' ? static_cast<char>( c - 'a' + 'A' ) : c;
+}
+
+std::optional<LogLevel> wordLevel( std::string_view word )
+{
+    if ( word.size() < 3 || word.size() > MaxLevelWordLength ) {
+        return std::nullopt;
+    }
+
+    std::array<char, MaxLevelWordLength> upperCase{};
+    std::transform( word.begin(), word.end(), upperCase.begin(), toUpper );
+    const auto upperWord = std::string_view( upperCase.data(), word.size() );
+    const auto isUpperCase = upperWord == word;
+
+    for ( const auto& levelWord : LevelWords ) {
+        if ( levelWord.word == upperWord && ( isUpperCase || !levelWord.isUpperCaseOnly ) ) {
+            return levelWord.level;
+        }
+    }
+    return std::nullopt;
+}
+} // namespace
+
+LevelIndex::LevelIndex( size_t searchedBytes )
+    : searchedBytes_( searchedBytes )
+{
+}
+
+std::optional<LogLevel> LevelIndex::levelOf( std::string_view line, size_t searchedBytes )
+{
+    const auto searchedEnd = std::min( line.size(), searchedBytes );
+    size_t position = 0;
+    while ( position < searchedEnd ) {
+        if ( !isWordChar( line[ position ] ) ) {
+            ++position;
+            continue;
+        }
+
+        // Words starting in the searched bytes are taken whole
+        const auto wordStart = position;
+        while ( position < line.size() && isWordChar( line[ position ] ) ) {
+            ++position;
+        }
+
+        if ( const auto level = wordLevel( line.substr( wordStart, position - wordStart ) ) ) {
+            return level;
+        }
+    }
+    return std::nullopt;
+}
+
+LevelIndex::Position LevelIndex::position( uint64_t linesGeneration )
+{
+    ScopedLock lock( mutex_ );
+    if ( linesGeneration != linesGeneration_ ) {
+        reset();
+        linesGeneration_ = linesGeneration;
+    }
+    return { epoch_, nextLine_ };
+}
+
+bool LevelIndex::addLines( const Position& position, const klogg::vector<std::string_view>& lines )
+{
+    {
+        SharedLock lock( mutex_ );
+        if ( position.epoch != epoch_ || position.nextLine != nextLine_ ) {
+            return false;
+        }
+    }
+
+    std::array<klogg::vector<uint64_t>, LevelsCount> levelLines;
+    auto line = position.nextLine.get();
+    for ( const auto& text : lines ) {
+        if ( const auto level = levelOf( text, searchedBytes_ ) ) {
+            levelLines[ static_cast<size_t>( *level ) ].push_back( line );
+        }
+        ++line;
+    }
+
+    ScopedLock lock( mutex_ );
+    if ( position.epoch != epoch_ || position.nextLine != nextLine_ ) {
+        return false;
+    }
+
+    for ( size_t level = 0; level < LevelsCount; ++level ) {
+        levelLines_[ level ].addMany( levelLines[ level ].size(), levelLines[ level ].data() );
+        levelLines_[ level ].runOptimize();
+    }
+    nextLine_ = LineNumber( line );
+
+    return true;
+}
+
+void LevelIndex::clear()
+{
+    ScopedLock lock( mutex_ );
+    reset();
+}
+
+void LevelIndex::reset()
+{
+    ++epoch_;
+    nextLine_ = {};
+    levelLines_ = {};
+}
+
+std::optional<roaring::Roaring64Map>
+LevelIndex::linesUpTo( LogLevel level, uint64_t linesGeneration, LinesCount nbLines ) const
+{
+    SharedLock lock( mutex_ );
+    if ( linesGeneration != linesGeneration_ || nextLine_.get() < nbLines.get() ) {
+        return std::nullopt;
+    }
+
+    roaring::Roaring64Map lines;
+    for ( size_t mostSevere = 0; mostSevere <= static_cast<size_t>( level ); ++mostSevere ) {
+        lines |= levelLines_[ mostSevere ];
+    }
+    return lines;
+}
+
+LinesCount LevelIndex::indexedLines() const
+{
+    SharedLock lock( mutex_ );
+    return LinesCount( nextLine_.get() );
+}
+
+size_t LevelIndex::allocatedSize() const
+{
+    SharedLock lock( mutex_ );
+    size_t size = 0;
+    for ( const auto& lines : levelLines_ ) {
+        size += lines.getSizeInBytes();
+    }
+    return size;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "linehashindex.h"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "xxhash.h"
+
+namespace {
+constexpr size_t LinesPerTask = 4096;
+} // namespace
+
+uint64_t LineHashIndex::hash( std::string_view line )
+{
+    return XXH3_64bits( line.data(), line.size() );
+}
+
+LineHashIndex::Position LineHashIndex::position( uint64_t linesGeneration )
+{
+    ScopedLock lock( mutex_ );
+    if ( linesGeneration != linesGeneration_ ) {
+        reset();
+        linesGeneration_ = linesGeneration;
+    }
+    return { epoch_, LineNumber( nextIdenticalLines_.size() ) };
+}
+
+bool LineHashIndex::addLines( const Position& position,
+                              const klogg::vector<std::string_view>& lines )
+{
+    {
+        SharedLock lock( mutex_ );
+        if ( position.epoch != epoch_ || position.nextLine.get() != nextIdenticalLines_.size() ) {
+            return false;
+        }
+    }
+
+    klogg::vector<uint64_t> hashes( lines.size() );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, lines.size(), LinesPerTask ),
+                       [ & ]( const tbb::blocked_range<size_t>& range ) {
+                           for ( auto offset = range.begin(); offset != range.end(); ++offset ) {
+                               hashes[ offset ] = hash( lines[ offset ] );
+                           }
+                       } );
+
+    ScopedLock lock( mutex_ );
+    if ( position.epoch != epoch_ || position.nextLine.get() != nextIdenticalLines_.size() ) {
+        return false;
+    }
+
+    nextIdenticalLines_.reserve( nextIdenticalLines_.size() + hashes.size() );
+    lastLines_.reserve( lastLines_.size() + hashes.size() );
+    for ( const auto lineHash : hashes ) {
+        const auto line = static_cast<uint64_t>( nextIdenticalLines_.size() );
+        const auto lastLine = lastLines_.find( lineHash );
+        if ( lastLine == lastLines_.end() ) {
+            nextIdenticalLines_.push_back( line );
+            lastLines_.emplace( lineHash, line );
+        }
+        else {
+            // The new line goes between the last and the first line of the cycle
+            nextIdenticalLines_.push_back( nextIdenticalLines_[ lastLine->second ] );
+            nextIdenticalLines_[ lastLine->second ] = line;
+            lastLine->second = line;
+        }
+    }
+
+    return true;
+}
+
+void LineHashIndex::clear()
+{
+    ScopedLock lock( mutex_ );
+    reset();
+}
+
+void LineHashIndex::reset()
+{
+    ++epoch_;
+    nextIdenticalLines_ = {};
+    lastLines_ = {};
+}
+
+std::optional<roaring::Roaring64Map> LineHashIndex::identicalLines( LineNumber line,
+                                                                    uint64_t linesGeneration ) const
+{
+    klogg::vector<uint64_t> lines;
+    {
+        SharedLock lock( mutex_ );
+        if ( linesGeneration != linesGeneration_ || line.get() >= nextIdenticalLines_.size() ) {
+            return std::nullopt;
+        }
+
+        auto identicalLine = line.get();
+        do {
+            lines.push_back( identicalLine );
+            identicalLine = nextIdenticalLines_[ identicalLine ];
+        } while ( identicalLine != line.get() );
+    }
+
+    roaring::Roaring64Map identical;
+    identical.addMany( lines.size(), lines.data() );
+    identical.runOptimize();
+    return identical;
+}
+
+LinesCount LineHashIndex::indexedLines() const
+{
+    SharedLock lock( mutex_ );
+    return LinesCount( nextIdenticalLines_.size() );
+}
+
+size_t LineHashIndex::allocatedSize() const
+{
+    SharedLock lock( mutex_ );
+    return nextIdenticalLines_.capacity() * sizeof( uint64_t )
+           + lastLines_.size() * ( sizeof( uint64_t ) * 2 + 1 );
+}
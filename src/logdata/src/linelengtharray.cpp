@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "linelengtharray.h"
+
+#include "log.h"
+
+namespace {
+constexpr uint8_t MoreBytesFlag = 0x80;
+constexpr uint8_t ValueBits = 0x7F;
+
+// Returns value of the varint at data and moves data past it
+uint32_t decodeValue( const uint8_t*& data )
+{
+    uint32_t value = 0;
+    int shift = 0;
+    while ( true ) {
+        const auto byte = *data++;
+        value |= static_cast<uint32_t>( byte & ValueBits ) << shift;
+        if ( ( byte & MoreBytesFlag ) == 0 ) {
+            return value;
+        }
+        shift += 7;
+    }
+}
+} // namespace
+
+void LineLengthArray::append( std::optional<LineLength> length )
+{
+    constexpr auto MaxValue = ( uint32_t{ 1 } << ( 7 * MaxEncodedBytes ) ) - 1;
+
+    if ( !length || length->get() < 0 || static_cast<uint64_t>( length->get() ) >= MaxValue ) {
+        appendEncoded( 0 );
+    }
+    else {
+        appendEncoded( static_cast<uint32_t>( length->get() ) + 1 );
+    }
+}
+
+void LineLengthArray::append_list( const FastLineLengthArray& lengths )
+{
+    for ( size_t i = 0; i < lengths.size(); ++i ) {
+        append( lengths.at( i ) );
+    }
+}
+
+void LineLengthArray::appendUnknown( LinesCount count )
+{
+    for ( LinesCount::UnderlyingType i = 0; i < count.get(); ++i ) {
+        appendEncoded( 0 );
+    }
+}
+
+void LineLengthArray::appendEncoded( uint32_t value )
+{
+    if ( nbLines_ % LinesPerBlock == 0 ) {
+        pool_.get_block( LinesPerBlock * MaxEncodedBytes, uint8_t{ 0 }, nullptr );
+        lastBlockSize_ = 0;
+    }
+
+    auto block = pool_.at( pool_.currentBlock() );
+    do {
+        auto byte = static_cast<uint8_t>( value & ValueBits );
+        value >>= 7;
+        if ( value != 0 ) {
+            byte |= MoreBytesFlag;
+        }
+        block[ lastBlockSize_++ ] = byte;
+    } while ( value != 0 );
+
+    if ( ++nbLines_ % LinesPerBlock == 0 ) {
+        // Completed block is shrunk to the bytes used
+        pool_.resize_last_block( lastBlockSize_ );
+    }
+}
+
+std::optional<LineLength> LineLengthArray::at( LineNumber line ) const
+{
+    if ( line.get() >= nbLines_ ) {
+        return std::nullopt;
+    }
+
+    const auto* data = pool_.at( static_cast<size_t>( line.get() / LinesPerBlock ) );
+    for ( auto i = line.get() % LinesPerBlock; i > 0; --i ) {
+        while ( ( *data++ & MoreBytesFlag ) != 0 ) {
+        }
+    }
+
+    const auto value = decodeValue( data );
+    if ( value == 0 ) {
+        return std::nullopt;
+    }
+
+    return LineLength( static_cast<LineLength::UnderlyingType>( value - 1 ) );
+}
+
+FastLineLengthArray LineLengthArray::range( LineNumber first, LinesCount count ) const
+{
+    FastLineLengthArray lengths;
+    auto line = first.get();
+    const auto end = first.get() + count.get();
+
+    const uint8_t* data = nullptr;
+    if ( line < nbLines_ && line % LinesPerBlock != 0 ) {
+        data = pool_.at( static_cast<size_t>( line / LinesPerBlock ) );
+        for ( auto i = line % LinesPerBlock; i > 0; --i ) {
+            while ( ( *data++ & MoreBytesFlag ) != 0 ) {
+            }
+        }
+    }
+
+    for ( ; line < end; ++line ) {
+        if ( line >= nbLines_ ) {
+            lengths.append( std::nullopt );
+            continue;
+        }
+
+        if ( line % LinesPerBlock == 0 ) {
+            data = pool_.at( static_cast<size_t>( line / LinesPerBlock ) );
+        }
+
+        const auto value = decodeValue( data );
+        if ( value == 0 ) {
+            lengths.append( std::nullopt );
+        }
+        else {
+            lengths.append( LineLength( static_cast<LineLength::UnderlyingType>( value - 1 ) ) );
+        }
+    }
+
+    return lengths;
+}
+
+void LineLengthArray::truncate( LinesCount newSize )
+{
+    if ( newSize.get() >= nbLines_ ) {
+        return;
+    }
+
+    LOG_DEBUG << "Truncating line lengths from " << nbLines_ << " to " << newSize;
+
+    const auto lastKeptBlock = newSize.get() / LinesPerBlock;
+    const auto blocksCount = ( nbLines_ + LinesPerBlock - 1 ) / LinesPerBlock;
+
+    // Values of the partially kept block are appended again
+    klogg::vector<uint32_t> keptValues;
+    if ( lastKeptBlock < blocksCount ) {
+        const auto* data = pool_.at( static_cast<size_t>( lastKeptBlock ) );
+        for ( auto i = lastKeptBlock * LinesPerBlock; i < newSize.get(); ++i ) {
+            keptValues.push_back( decodeValue( data ) );
+        }
+    }
+
+    for ( auto block = blocksCount; block > lastKeptBlock; --block ) {
+        pool_.free_last_block();
+    }
+
+    nbLines_ = lastKeptBlock * LinesPerBlock;
+    lastBlockSize_ = 0;
+
+    for ( const auto value : keptValues ) {
+        appendEncoded( value );
+    }
+}
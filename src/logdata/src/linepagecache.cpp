@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "linepagecache.h"
+
+#include "log.h"
+#include "metrics.h"
+
+namespace {
+size_t pageBytes( const klogg::vector<QString>& lines )
+{
+    size_t bytes = lines.capacity() * sizeof( QString );
+    for ( const auto& line : lines ) {
+        bytes += static_cast<size_t>( line.capacity() ) * sizeof( QChar );
+    }
+    return bytes;
+}
+} // namespace
+
+LinePageCache::LinePageCache( size_t maxBytes )
+    : maxBytes_( maxBytes )
+{
+}
+
+void LinePageCache::dropPages()
+{
+    pages_.clear();
+    pagesIndex_.clear();
+    bytes_ = 0;
+    ++generation_;
+}
+
+uint64_t LinePageCache::startReading( uint64_t indexGeneration )
+{
+    ScopedLock lock( mutex_ );
+    if ( indexGeneration != indexGeneration_ ) {
+        LOG_DEBUG << "Index changed, dropping " << pages_.size() << " line pages";
+
+        dropPages();
+        indexGeneration_ = indexGeneration;
+    }
+
+    return generation_;
+}
+
+LinePageCache::Page LinePageCache::get( uint64_t page )
+{
+    static auto& cacheHits = Metrics::get().counter( "lines.page_cache_hits" );
+    static auto& cacheMisses = Metrics::get().counter( "lines.page_cache_misses" );
+
+    ScopedLock lock( mutex_ );
+    const auto cached = pagesIndex_.find( page );
+    if ( cached == pagesIndex_.end() ) {
+        ++misses_;
+        cacheMisses.add();
+        return {};
+    }
+
+    ++hits_;
+    cacheHits.add();
+    pages_.splice( pages_.begin(), pages_, cached->second );
+    return cached->second->lines;
+}
+
+bool LinePageCache::contains( uint64_t page ) const
+{
+    ScopedLock lock( mutex_ );
+    return pagesIndex_.find( page ) != pagesIndex_.end();
+}
+
+void LinePageCache::add( uint64_t page, Page lines, uint64_t generation )
+{
+    const auto bytes = pageBytes( *lines );
+
+    ScopedLock lock( mutex_ );
+    if ( generation != generation_ || bytes > maxBytes_
+         || pagesIndex_.find( page ) != pagesIndex_.end() ) {
+        return;
+    }
+
+    while ( bytes_ + bytes > maxBytes_ ) {
+        bytes_ -= pages_.back().bytes;
+        pagesIndex_.erase( pages_.back().page );
+        pages_.pop_back();
+    }
+
+    pages_.push_front( CachedPage{ page, std::move( lines ), bytes } );
+    pagesIndex_.emplace( page, pages_.begin() );
+    bytes_ += bytes;
+}
+
+void LinePageCache::clear()
+{
+    ScopedLock lock( mutex_ );
+    dropPages();
+}
+
+LinePageCache::Stats LinePageCache::stats() const
+{
+    ScopedLock lock( mutex_ );
+    return Stats{ hits_, misses_, pages_.size(), bytes_ };
+}
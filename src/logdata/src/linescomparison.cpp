@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "linescomparison.h"
+
+#include <robin_hood.h>
+#include <tbb/parallel_invoke.h>
+
+#include "containers.h"
+#include "linehashindex.h"
+#include "log.h"
+#include "logdata.h"
+#include "logtemplates.h"
+#include "xxhash.h"
+
+namespace {
+bool isSeparator( char c )
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Tokens are hashed one after another, each one seeded by the hash of the previous ones
+uint64_t maskedHash( std::string_view line )
+{
+    uint64_t hash = 0;
+    size_t position = 0;
+    while ( position < line.size() ) {
+        while ( position < line.size() && isSeparator( line[ position ] ) ) {
+            ++position;
+        }
+        const auto start = position;
+        auto hasDigit = false;
+        while ( position < line.size() && !isSeparator( line[ position ] ) ) {
+            hasDigit = hasDigit || ( line[ position ] >= '0' && line[ position ] <= '9' );
+            ++position;
+        }
+        if ( position > start ) {
+            const auto token
+                = hasDigit ? TemplateMiner::Wildcard : line.substr( start, position - start );
+            hash = XXH3_64bits_withSeed( token.data(), token.size(), hash );
+        }
+    }
+    return hash;
+}
+
+// Hash of each line of the data, empty if some lines are not read
+std::optional<klogg::vector<uint64_t>>
+hashLines( const LogData& logData, bool maskNumbers, const AtomicFlag& interruptRequested )
+{
+    const auto nbLines = logData.getNbLine().get();
+    klogg::vector<uint64_t> hashes( nbLines );
+
+    roaring::Roaring64Map allLines;
+    allLines.addRange( 0, nbLines );
+    const auto readLines = logData.readLinesInParallel(
+        allLines, interruptRequested,
+        [ &hashes, maskNumbers ]( LineNumber line, std::string_view text ) {
+            if ( line.get() < hashes.size() ) {
+                hashes[ line.get() ] = LinesComparison::lineHash( text, maskNumbers );
+            }
+        } );
+
+    if ( interruptRequested || readLines.get() < nbLines ) {
+        return std::nullopt;
+    }
+    return hashes;
+}
+
+// Lines with hashes not in the other hashes
+roaring::Roaring64Map linesNotIn( const klogg::vector<uint64_t>& hashes,
+                                  const klogg::vector<uint64_t>& otherHashes )
+{
+    const robin_hood::unordered_flat_set<uint64_t> otherSet( otherHashes.begin(),
+                                                             otherHashes.end() );
+
+    klogg::vector<uint64_t> lines;
+    for ( uint64_t line = 0; line < hashes.size(); ++line ) {
+        if ( otherSet.count( hashes[ line ] ) == 0 ) {
+            lines.push_back( line );
+        }
+    }
+
+    roaring::Roaring64Map bitmap;
+    bitmap.addMany( lines.size(), lines.data() );
+    bitmap.runOptimize();
+    return bitmap;
+}
+} // namespace
+
+uint64_t LinesComparison::lineHash( std::string_view line, bool maskNumbers )
+{
+    return maskNumbers ? maskedHash( line ) : LineHashIndex::hash( line );
+}
+
+std::optional<LinesComparison> LinesComparison::compare( const LogData& first,
+                                                         const LogData& second, bool maskNumbers,
+                                                         const AtomicFlag& interruptRequested )
+{
+    std::optional<klogg::vector<uint64_t>> firstHashes;
+    std::optional<klogg::vector<uint64_t>> secondHashes;
+    tbb::parallel_invoke(
+        [ & ] { firstHashes = hashLines( first, maskNumbers, interruptRequested ); },
+        [ & ] { secondHashes = hashLines( second, maskNumbers, interruptRequested ); } );
+    if ( !firstHashes || !secondHashes ) {
+        return std::nullopt;
+    }
+
+    LinesComparison comparison;
+    tbb::parallel_invoke(
+        [ & ] { comparison.onlyInFirst = linesNotIn( *firstHashes, *secondHashes ); },
+        [ & ] { comparison.onlyInSecond = linesNotIn( *secondHashes, *firstHashes ); } );
+
+    LOG_INFO << "Compared " << firstHashes->size() << " and " << secondHashes->size()
+             << " lines, " << comparison.onlyInFirst.cardinality() << " only in the first, "
+             << comparison.onlyInSecond.cardinality() << " only in the second";
+    return comparison;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "linesexport.h"
+
+#include <optional>
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QTextCodec>
+
+#include "containers.h"
+#include "log.h"
+#include "logdata.h"
+
+namespace {
+// Lines are read and written in chunks of this many lines
+constexpr size_t ChunkLines = 16 * 1024;
+
+bool writeBytes( QIODevice& output, const QByteArray& bytes )
+{
+    if ( output.write( bytes ) != bytes.size() ) {
+        return false;
+    }
+
+    // Commands read the chunk before the next one is read from the file
+    return !output.isSequential() || output.bytesToWrite() == 0
+           || output.waitForBytesWritten( -1 );
+}
+
+QByteArray linesBytes( const LogData& logData, const klogg::vector<LineNumber>& lines )
+{
+    if ( auto bytes = logData.readLinesBytes( lines ) ) {
+        return std::move( *bytes );
+    }
+
+    // Lines changed when they are read are encoded again, runs of lines are read at once
+    const QTextCodec* codec = logData.getDisplayEncoding();
+    if ( !codec ) {
+        codec = QTextCodec::codecForName( "utf-8" );
+    }
+
+    QByteArray bytes;
+    size_t runBegin = 0;
+    while ( runBegin < lines.size() ) {
+        auto runEnd = runBegin + 1;
+        while ( runEnd < lines.size() && lines[ runEnd ].get() == lines[ runEnd - 1 ].get() + 1 ) {
+            ++runEnd;
+        }
+
+        const auto runLines
+            = logData.getLines( lines[ runBegin ], LinesCount( lines[ runEnd - 1 ].get()
+                                                               - lines[ runBegin ].get() + 1 ) );
+        for ( const auto& line : runLines ) {
+            bytes.append( codec->fromUnicode( line ) );
+            bytes.append( '\n' );
+        }
+
+        runBegin = runEnd;
+    }
+
+    return bytes;
+}
+
+std::optional<QByteArray> chunkBytes( const LogData& logData,
+                                      const klogg::vector<LineNumber>& lines,
+                                      LinesExportFormat format )
+{
+    QByteArray bytes;
+    switch ( format ) {
+    case LinesExportFormat::Lines:
+        bytes = linesBytes( logData, lines );
+        break;
+    case LinesExportFormat::LineNumbers:
+        for ( const auto line : lines ) {
+            bytes.append( QByteArray::number( static_cast<qulonglong>( line.get() + 1 ) ) );
+            bytes.append( '\n' );
+        }
+        break;
+    case LinesExportFormat::ByteOffsets: {
+        const auto offsets = logData.getLinesOffsets( lines );
+        if ( !offsets ) {
+            return {};
+        }
+        for ( const auto offset : *offsets ) {
+            bytes.append( QByteArray::number( offset ) );
+            bytes.append( '\n' );
+        }
+        break;
+    }
+    case LinesExportFormat::Bitmap:
+        break;
+    }
+
+    return bytes;
+}
+} // namespace
+
+bool exportLines( const LogData& logData, const roaring::Roaring64Map& lines,
+                  LinesExportFormat format, QIODevice& output,
+                  const AtomicFlag& interruptRequested )
+{
+    if ( format == LinesExportFormat::Bitmap ) {
+        // Bitmap is compressed, so it is small enough to be written at once
+        QByteArray bitmap( static_cast<int>( lines.getSizeInBytes( true ) ), Qt::Uninitialized );
+        lines.write( bitmap.data(), true );
+        return writeBytes( output, bitmap );
+    }
+
+    klogg::vector<LineNumber> chunk;
+    chunk.reserve( ChunkLines );
+
+    const auto writeChunk = [ & ] {
+        if ( interruptRequested ) {
+            return false;
+        }
+
+        const auto bytes = chunkBytes( logData, chunk, format );
+        chunk.clear();
+        if ( !bytes || !writeBytes( output, *bytes ) ) {
+            LOG_ERROR << "Failed to export lines: " << output.errorString().toStdString();
+            return false;
+        }
+        return true;
+    };
+
+    for ( const auto line : lines ) {
+        chunk.emplace_back( line );
+        if ( chunk.size() == ChunkLines && !writeChunk() ) {
+            return false;
+        }
+    }
+
+    return chunk.empty() || writeChunk();
+}
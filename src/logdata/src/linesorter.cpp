@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "linesorter.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <queue>
+#include <utility>
+
+#include <QDir>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+#include "fieldfacets.h"
+#include "log.h"
+#include "logdata.h"
+#include "timestampindex.h"
+
+namespace {
+// Sorters keep at least that many records in memory
+constexpr size_t MinRecords = 1024;
+// Records read at once from a run file
+constexpr size_t RunBlockRecords = 4096;
+// Records merged between checks of the interrupt
+constexpr size_t MergedRecordsPerCheck = 64 * 1024;
+// Timestamps are at the beginning of lines
+constexpr size_t MaxTimestampBytes = 256;
+
+using Record = KeySorter::Record;
+
+bool isBefore( const Record& lhs, const Record& rhs )
+{
+    return lhs.key < rhs.key || ( lhs.key == rhs.key && lhs.line < rhs.line );
+}
+
+// Sorted records of a run file or of the memory of a sorter
+class RunReader {
+  public:
+    explicit RunReader( QTemporaryFile& file )
+        : file_( &file )
+    {
+        file_->seek( 0 );
+        readBlock();
+    }
+
+    explicit RunReader( const klogg::vector<Record>& records )
+        : records_( &records )
+    {
+    }
+
+    bool atEnd() const
+    {
+        return position_ == records().size();
+    }
+
+    const Record& record() const
+    {
+        return records()[ position_ ];
+    }
+
+    // False if the file could not be read
+    bool next()
+    {
+        ++position_;
+        return !atEnd() || !file_ || readBlock();
+    }
+
+  private:
+    // Records of files are read in blocks
+    const klogg::vector<Record>& records() const
+    {
+        return file_ ? block_ : *records_;
+    }
+
+    bool readBlock()
+    {
+        block_.resize( RunBlockRecords );
+        const auto bytes = file_->read( reinterpret_cast<char*>( block_.data() ),
+                                        static_cast<qint64>( block_.size() * sizeof( Record ) ) );
+        block_.resize( bytes > 0 ? static_cast<size_t>( bytes ) / sizeof( Record ) : 0 );
+        position_ = 0;
+        return bytes >= 0 && static_cast<size_t>( bytes ) % sizeof( Record ) == 0;
+    }
+
+    QTemporaryFile* file_ = nullptr;
+    klogg::vector<Record> block_;
+    const klogg::vector<Record>* records_ = nullptr;
+    size_t position_ = 0;
+};
+} // namespace
+
+KeySorter::KeySorter( size_t maxRecords )
+    : maxRecords_( std::max( maxRecords, MinRecords ) )
+{
+}
+
+uint64_t KeySorter::keyOf( double number )
+{
+    uint64_t bits = 0;
+    std::memcpy( &bits, &number, sizeof( bits ) );
+
+    // Negative numbers are in the reverse order of their bits and before positive ones
+    constexpr uint64_t SignBit = uint64_t{ 1 } << 63;
+    const auto key = ( bits & SignBit ) != 0 ? ~bits : bits | SignBit;
+    return std::min( key, MissingKey - 1 );
+}
+
+void KeySorter::add( uint64_t key, uint64_t line )
+{
+    records_.push_back( { key, line } );
+    if ( records_.size() >= maxRecords_ ) {
+        writeRun();
+    }
+}
+
+void KeySorter::writeRun()
+{
+    radixSort( records_, true );
+
+    auto run = std::make_unique<QTemporaryFile>( QDir::temp().filePath( "klogg_sort" ) );
+    const auto bytes = static_cast<qint64>( records_.size() * sizeof( Record ) );
+    if ( !run->open()
+         || run->write( reinterpret_cast<const char*>( records_.data() ), bytes ) != bytes ) {
+        LOG_ERROR << "Failed to write sorted lines to " << run->fileName() << ": "
+                  << run->errorString();
+        isValid_ = false;
+    }
+
+    runs_.push_back( std::move( run ) );
+    records_.clear();
+}
+
+void KeySorter::radixSort( klogg::vector<Record>& records, bool byLines )
+{
+    klogg::vector<Record> sorted( records.size() );
+    const auto sortByByte = [ &records, &sorted ]( uint64_t Record::*field, int shift ) {
+        const auto byteOf = [ field, shift ]( const Record& record ) {
+            return static_cast<size_t>( ( record.*field >> shift ) & 0xFF );
+        };
+
+        std::array<size_t, 256> offsets{};
+        for ( const auto& record : records ) {
+            ++offsets[ byteOf( record ) ];
+        }
+
+        // Nothing to sort if all records have the same byte
+        if ( records.empty() || offsets[ byteOf( records.front() ) ] == records.size() ) {
+            return;
+        }
+
+        size_t offset = 0;
+        for ( auto& byteOffset : offsets ) {
+            offset += std::exchange( byteOffset, offset );
+        }
+        for ( const auto& record : records ) {
+            sorted[ offsets[ byteOf( record ) ]++ ] = record;
+        }
+        records.swap( sorted );
+    };
+
+    // Records of the same key stay in the order of lines
+    if ( byLines ) {
+        for ( auto shift = 0; shift < 64; shift += 8 ) {
+            sortByByte( &Record::line, shift );
+        }
+    }
+    for ( auto shift = 0; shift < 64; shift += 8 ) {
+        sortByByte( &Record::key, shift );
+    }
+}
+
+bool KeySorter::merge( klogg::vector<KeySorter>& sorters, const AtomicFlag& interruptRequested,
+                       const std::function<void( const Record& )>& recordSorted )
+{
+    if ( std::any_of( sorters.begin(), sorters.end(),
+                      []( const auto& sorter ) { return !sorter.isValid(); } ) ) {
+        return false;
+    }
+
+    // Records in memory are the last run of each sorter
+    tbb::parallel_for( size_t{ 0 }, sorters.size(), [ &sorters ]( size_t index ) {
+        radixSort( sorters[ index ].records_, true );
+    } );
+
+    klogg::vector<RunReader> readers;
+    for ( auto& sorter : sorters ) {
+        for ( auto& run : sorter.runs_ ) {
+            readers.emplace_back( *run );
+        }
+        readers.emplace_back( sorter.records_ );
+    }
+
+    const auto isAfter = [ &readers ]( size_t lhs, size_t rhs ) {
+        return isBefore( readers[ rhs ].record(), readers[ lhs ].record() );
+    };
+    std::priority_queue<size_t, klogg::vector<size_t>, decltype( isAfter )> heads( isAfter );
+    for ( auto reader = 0u; reader < readers.size(); ++reader ) {
+        if ( !readers[ reader ].atEnd() ) {
+            heads.push( reader );
+        }
+    }
+
+    size_t mergedRecords = 0;
+    while ( !heads.empty() ) {
+        if ( ++mergedRecords % MergedRecordsPerCheck == 0 && interruptRequested ) {
+            return false;
+        }
+
+        const auto reader = heads.top();
+        heads.pop();
+        recordSorted( readers[ reader ].record() );
+
+        if ( !readers[ reader ].next() ) {
+            LOG_ERROR << "Failed to read sorted lines";
+            return false;
+        }
+        if ( !readers[ reader ].atEnd() ) {
+            heads.push( reader );
+        }
+    }
+
+    return true;
+}
+
+std::optional<LineOrder> LineOrder::sort( const LogData& logData, const SortKey& key,
+                                          const roaring::Roaring64Map& lines, bool isDescending,
+                                          uint64_t memoryBytes,
+                                          const AtomicFlag& interruptRequested )
+{
+    if ( lines.cardinality() > std::numeric_limits<uint32_t>::max() ) {
+        LOG_WARNING << "Too many lines to sort: " << lines.cardinality();
+        return {};
+    }
+
+    const auto field = key.kind == SortKey::Kind::Field ? FacetField::parse( key.text )
+                                                        : std::nullopt;
+    if ( key.kind == SortKey::Kind::Field && !field ) {
+        return {};
+    }
+
+    struct KeyReader {
+        // Regular expressions and timestamp formats are not shared by threads
+        std::optional<FacetField> field;
+        std::unique_ptr<TimestampIndex> timestamps;
+        std::string buffer;
+    };
+
+    tbb::enumerable_thread_specific<KeyReader> keyReaders( [ &key ] {
+        KeyReader reader;
+        if ( key.kind == SortKey::Kind::Timestamp ) {
+            reader.timestamps = std::make_unique<TimestampIndex>( key.text );
+        }
+        else {
+            reader.field = FacetField::parse( key.text );
+        }
+        return reader;
+    } );
+
+    // Records are sorted with a copy of them
+    const auto concurrency = static_cast<uint64_t>( tbb::this_task_arena::max_concurrency() );
+    const auto maxRecords
+        = static_cast<size_t>( memoryBytes / ( 2 * sizeof( Record ) * concurrency ) );
+    tbb::enumerable_thread_specific<KeySorter> sorters(
+        [ maxRecords ] { return KeySorter( maxRecords ); } );
+
+    const auto readLines = logData.readLinesInParallel(
+        lines, interruptRequested, [ & ]( LineNumber line, std::string_view text ) {
+            auto& reader = keyReaders.local();
+
+            std::optional<double> number;
+            if ( reader.timestamps ) {
+                const auto timestamp = reader.timestamps->parse( QString::fromUtf8(
+                    text.data(), static_cast<int>( std::min( text.size(), MaxTimestampBytes ) ) ) );
+                if ( timestamp ) {
+                    number = static_cast<double>( *timestamp );
+                }
+            }
+            else {
+                number = reader.field->number( text, reader.buffer );
+            }
+
+            auto sortKey = number ? KeySorter::keyOf( *number ) : KeySorter::MissingKey;
+            if ( isDescending && sortKey != KeySorter::MissingKey ) {
+                sortKey = std::min( ~sortKey, KeySorter::MissingKey - 1 );
+            }
+            sorters.local().add( sortKey, line.get() );
+        } );
+    if ( interruptRequested ) {
+        return {};
+    }
+
+    klogg::vector<KeySorter> allSorters;
+    size_t runs = 0;
+    for ( auto& sorter : sorters ) {
+        runs += sorter.runs();
+        allSorters.push_back( std::move( sorter ) );
+    }
+
+    LineOrder order;
+    order.lines.reserve( readLines.get() );
+    uint64_t linesWithKey = 0;
+    const auto isMerged = KeySorter::merge(
+        allSorters, interruptRequested, [ &order, &linesWithKey ]( const Record& record ) {
+            order.lines.push_back( record.line );
+            if ( record.key != KeySorter::MissingKey ) {
+                ++linesWithKey;
+            }
+        } );
+    if ( !isMerged ) {
+        return {};
+    }
+    if ( order.lines.size() != readLines.get() ) {
+        LOG_ERROR << "Sorted " << order.lines.size() << " of " << readLines << " lines";
+        return {};
+    }
+    allSorters.clear();
+    order.linesWithKey = LinesCount( linesWithKey );
+
+    // Sorting positions by lines gives the position of each line by its rank
+    klogg::vector<Record> positions( order.lines.size() );
+    tbb::parallel_for( size_t{ 0 }, positions.size(), [ &order, &positions ]( size_t position ) {
+        positions[ position ] = { order.lines[ position ], position };
+    } );
+    KeySorter::radixSort( positions, false );
+
+    order.positions.resize( positions.size() );
+    tbb::parallel_for( size_t{ 0 }, positions.size(), [ &order, &positions ]( size_t rank ) {
+        order.positions[ rank ] = static_cast<uint32_t>( positions[ rank ].line );
+    } );
+
+    LOG_INFO << "Sorted " << order.lines.size() << " lines by " << key.text << ", "
+             << order.linesWithKey << " lines with a key, " << runs << " runs written";
+    return order;
+}
@@ -39,8 +39,8 @@
 // This file implements LogData, the content of a log file.
 
 #include <algorithm>
+#include <chrono>
 #include <limits>
-#include <numeric>
 #include <qregularexpression.h>
 #include <qtextcodec.h>
 #include <string_view>
@@ -50,29 +50,132 @@
 #include <QFileInfo>
 
 #include <simdutf.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
+#include "ansicolorsequences.h"
+#include "backgroundrelease.h"
 #include "configuration.h"
 #include "containers.h"
+#include "compressedaccess.h"
 #include "linetypes.h"
 #include "log.h"
 #include "logfiltereddata.h"
+#include "memorygovernor.h"
+#include "mergedaccess.h"
+#include "metrics.h"
+#include "runnable_lambda.h"
+#include "tracing.h"
 
 #include "logdata.h"
 
+namespace {
+// Memory for decoded lines of recently read pages
+constexpr size_t LinePageCacheBytes = 32 * 1024 * 1024;
+constexpr size_t LowMemoryLinePageCacheBytes = 4 * 1024 * 1024;
+
+// Larger ranges, e.g. copied selection, are not cached
+constexpr LinesCount::UnderlyingType MaxCachedRangeLines = 4 * LinePageCache::PageLines;
+
+// Pages read ahead of sequential reads, e.g. when scrolling page by page
+constexpr uint64_t ReadAheadPages = 4;
+constexpr int SequentialReadsToReadAhead = 2;
+
+// Pages prefetched at once, e.g. for matches far from each other
+constexpr size_t MaxPrefetchPages = 64;
+
+// Chunks of lines kept for searches running at the same time
+constexpr size_t MaxSharedChunks = 32;
+
+// Lines read and parsed at once to index their fields or hashes
+constexpr uint64_t FieldIndexChunkLines = 64 * 1024;
+
+// Only the beginning of longer lines is decoded, views show the rest through windows
+constexpr qint64 MaxDecodedLineBytes = 16 * 1024 * 1024;
+
+// Latin-1 characters take one or two bytes in UTF-8
+size_t convertLatin1ToUtf8( std::string_view text, char* utf8 )
+{
+    auto* output = utf8;
+    for ( const auto c : text ) {
+        const auto code = static_cast<unsigned char>( c );
+        if ( code < 0x80 ) {
+            *output++ = c;
+        }
+        else {
+            *output++ = static_cast<char>( 0xC0 | ( code >> 6 ) );
+            *output++ = static_cast<char>( 0x80 | ( code & 0x3F ) );
+        }
+    }
+    return static_cast<size_t>( output - utf8 );
+}
+
+// UTF-8 text of encodings converted without the codec, empty for other encodings
+// and for invalid UTF-16. ASCII text in Latin-1 is returned as it is.
+std::optional<std::string_view> convertToUtf8( std::string_view text,
+                                               const EncodingParameters& encodingParams,
+                                               klogg::vector<char>& utf8Data )
+{
+    if ( encodingParams.isLatin1 ) {
+        if ( simdutf::validate_ascii( text.data(), text.size() ) ) {
+            return text;
+        }
+        utf8Data.resize( text.size() * 2 );
+        return std::string_view{ utf8Data.data(), convertLatin1ToUtf8( text, utf8Data.data() ) };
+    }
+
+    if ( !encodingParams.isUtf16LE && !encodingParams.isUtf16BE ) {
+        return std::nullopt;
+    }
+
+    const auto* utf16 = reinterpret_cast<const char16_t*>( text.data() );
+    const auto utf16Size = text.size() / 2;
+    if ( utf16Size == 0 ) {
+        return std::string_view{};
+    }
+
+    // A code unit takes at most three bytes in UTF-8
+    utf8Data.resize( utf16Size * 3 );
+    const auto utf8Size
+        = encodingParams.isUtf16LE
+              ? simdutf::convert_utf16le_to_utf8( utf16, utf16Size, utf8Data.data() )
+              : simdutf::convert_utf16be_to_utf8( utf16, utf16Size, utf8Data.data() );
+    if ( utf8Size == 0 ) {
+        return std::nullopt;
+    }
+    return std::string_view{ utf8Data.data(), utf8Size };
+}
+} // namespace
+
 LogData::LogData()
     : AbstractLogData()
     , indexing_data_( std::make_shared<IndexingData>() )
+    , numaNode_( TaskScheduler::get().acquireNode() )
     , operationQueue_( [ this ] { attached_file_->attachReader(); } )
     , codec_( QTextCodec::codecForName( "ISO-8859-1" ) )
+    , linePageCache_( Configuration::get().lowMemoryProfile() ? LowMemoryLinePageCacheBytes
+                                                              : LinePageCacheBytes )
+    , levelIndex_( static_cast<size_t>( Configuration::get().levelSearchedBytes() ) )
 {
+    readAheadPool_.setMaxThreadCount( 1 );
+    fieldIndexPool_.setMaxThreadCount( 2 );
+
     // Initialise the file watcher
     connect( &FileWatcher::getFileWatcher(), &FileWatcher::fileChanged, this,
              &LogData::fileChangedOnDisk, Qt::QueuedConnection );
 
-    auto worker = std::make_unique<LogDataWorker>( indexing_data_ );
+    auto worker = std::make_unique<LogDataWorker>( indexing_data_, taskPriority_, numaNode_,
+                                                   indexingProgress_ );
 
     // Forward the update signal
-    connect( worker.get(), &LogDataWorker::indexingProgressed, this, &LogData::loadingProgressed );
+    connect( worker.get(), &LogDataWorker::indexingProgressed, this, &LogData::indexingProgressed,
+             Qt::QueuedConnection );
+    connect( &indexingProgressTimer_, &QTimer::timeout, this, &LogData::pollIndexingProgress );
+    indexingProgressTimer_.setInterval( OperationProgress::PollIntervalMs );
+    connect( worker.get(), &LogDataWorker::indexingPreviewReady, this,
+             &LogData::loadingPreviewReady, Qt::QueuedConnection );
+    connect( worker.get(), &LogDataWorker::indexTruncated, this, &LogData::indexTruncated,
+             Qt::QueuedConnection );
     connect( worker.get(), &LogDataWorker::indexingFinished, this, &LogData::indexingFinished,
              Qt::QueuedConnection );
     connect( worker.get(), &LogDataWorker::checkFileChangesFinished, this,
@@ -82,6 +185,7 @@ LogData::LogData()
 
     const auto& config = Configuration::get();
     keepFileClosed_ = config.keepFileClosed();
+    useMappedFileReading_ = config.useMappedFileIndexing();
 
     if ( keepFileClosed_ ) {
         LOG_INFO << "Keep file closed option is set";
@@ -91,18 +195,247 @@ LogData::LogData()
     if ( defaultEncodingMib >= 0 ) {
         codec_.setCodec( QTextCodec::codecForMib( defaultEncodingMib ) );
     }
+
+    auto& memoryGovernor = MemoryGovernor::get();
+    memoryGovernor.addCache(
+        this, this, MemoryGovernor::Kind::LineCache,
+        { [ this ] { return static_cast<uint64_t>( linePageCache_.stats().bytes ); },
+          [ this ] { linePageCache_.clear(); } } );
+
+    memoryGovernor.addUsage( this, this, MemoryGovernor::Kind::LineIndex, [ this ] {
+        return static_cast<uint64_t>(
+            IndexingData::ConstAccessor{ indexing_data_.get() }.allocatedSize() );
+    } );
+    memoryGovernor.addUsage( this, this, MemoryGovernor::Kind::SearchIndex, [ this ] {
+        const IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        const auto trigramIndex = scopedAccessor.getTrigramIndex();
+        const auto tokenFilters = scopedAccessor.getTokenFilters();
+        return static_cast<uint64_t>( ( trigramIndex ? trigramIndex->allocatedSize() : 0 )
+                                      + ( tokenFilters ? tokenFilters->allocatedSize() : 0 )
+                                      + fieldIndex_.allocatedSize()
+                                      + lineHashIndex_.allocatedSize()
+                                      + levelIndex_.allocatedSize() );
+    } );
+    memoryGovernor.addUsage( this, this, MemoryGovernor::Kind::ReadBuffers,
+                             [ this ] { return sharedChunksSize(); } );
 }
 
 LogData::~LogData()
 {
     LOG_DEBUG << "Destroying log data";
+    MemoryGovernor::get().removeCaches( this );
+    readAheadPool_.waitForDone();
+    stopIndexingFields_ = true;
+    fieldIndexPool_.waitForDone();
     operationQueue_.shutdown();
+
+    // The worker is destroyed by the shutdown, so the index is freed by the background thread
+    auto& backgroundRelease = BackgroundRelease::get();
+    backgroundRelease.release( std::move( indexing_data_ ) );
+    backgroundRelease.releaseValue( std::move( sharedChunks_ ) );
+
+    TaskScheduler::get().releaseNode( numaNode_ );
 }
 
 void LogData::setPrefilter( const QString& prefilterPattern )
 {
     IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
-    prefilterPattern_ = prefilterPattern;
+    if ( prefilterPattern_ != prefilterPattern ) {
+        prefilterPattern_ = prefilterPattern;
+        linePageCache_.clear();
+        timestampIndex_.clear();
+        fieldIndex_.clear();
+        lineHashIndex_.clear();
+        levelIndex_.clear();
+        dropSharedChunks();
+        startIndexingFields();
+    }
+}
+
+SearchedContent LogData::getSearchedContent() const
+{
+    SearchedContent content;
+    content.fileName = QFileInfo( indexingFileName_ ).absoluteFilePath();
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        content.hash = scopedAccessor.getHash();
+        content.isFromFileStart = scopedAccessor.getFirstLineOffset().get() == 0;
+        content.prefilter = prefilterPattern_;
+        content.hideAnsiColorSequences = hideAnsiColorSequences_;
+    }
+
+    const auto* codec = codec_.codec();
+    content.encoding = codec != nullptr ? codec->name() : QByteArray{};
+
+    return content;
+}
+
+bool LogData::mayContainText( LineNumber first, LinesCount number, std::string_view text,
+                              const klogg::vector<std::string>& tokens ) const
+{
+    if ( number.get() == 0 || !codec_.encodingParameters().isUtf8Compatible ) {
+        return true;
+    }
+
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    const auto trigramIndex = scopedAccessor.getTrigramIndex();
+    const auto tokenFilters = scopedAccessor.getTokenFilters();
+    if ( ( !trigramIndex && !tokenFilters ) || !prefilterPattern_.isEmpty()
+         || hideAnsiColorSequences_
+         || first + number > LineNumber( scopedAccessor.getNbLines().get() ) ) {
+        return true;
+    }
+
+    const auto begin = first.get() > 0
+                           ? scopedAccessor.getEndOfLineOffset( first - 1_lcount )
+                           : scopedAccessor.getFirstLineOffset();
+    const auto end = scopedAccessor.getEndOfLineOffset( first + number - 1_lcount );
+    return ( !trigramIndex || trigramIndex->mayContain( begin.get(), end.get(), text ) )
+           && ( !tokenFilters || tokenFilters->mayContain( begin.get(), end.get(), tokens ) );
+}
+
+std::optional<roaring::Roaring64Map>
+LogData::getFieldMatches( const FieldQuery& query, LineNumber first, LinesCount number ) const
+{
+    const auto linesGeneration
+        = IndexingData::ConstAccessor{ indexing_data_.get() }.getLinePositionGeneration();
+    return fieldIndex_.matchingLines( query, linesGeneration, first, number );
+}
+
+std::optional<roaring::Roaring64Map> LogData::getIdenticalLines( LineNumber line ) const
+{
+    const auto linesGeneration
+        = IndexingData::ConstAccessor{ indexing_data_.get() }.getLinePositionGeneration();
+    return lineHashIndex_.identicalLines( line, linesGeneration );
+}
+
+std::optional<roaring::Roaring64Map> LogData::getLevelLines( LogLevel level ) const
+{
+    uint64_t linesGeneration = 0;
+    LinesCount nbLines;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        linesGeneration = scopedAccessor.getLinePositionGeneration();
+        nbLines = scopedAccessor.getNbLines();
+    }
+    return levelIndex_.linesUpTo( level, linesGeneration, nbLines );
+}
+
+LinesCount LogData::readLinesInParallel( const roaring::Roaring64Map& lines,
+                                         const AtomicFlag& interruptRequested,
+                                         const LineRead& lineRead ) const
+{
+    // Lines of the file taken at once by a task
+    constexpr uint64_t ChunkLines = 16 * 1024;
+    // Chunks with fewer lines to read than that share are read by runs of lines
+    constexpr uint64_t DenseChunkRatio = 8;
+
+    const auto nbLines = getNbLine().get();
+
+    // Only chunks with lines to read are read
+    klogg::vector<uint64_t> chunks;
+    if ( !lines.isEmpty() && nbLines > 0 ) {
+        const auto lastLine = std::min( lines.maximum(), nbLines - 1 );
+        for ( uint64_t chunkStart = 0; chunkStart <= lastLine; chunkStart += ChunkLines ) {
+            const auto linesBefore = chunkStart > 0 ? lines.rank( chunkStart - 1 ) : 0;
+            if ( lines.rank( chunkStart + ChunkLines - 1 ) > linesBefore ) {
+                chunks.push_back( chunkStart );
+            }
+        }
+    }
+
+    attachReader();
+
+    std::atomic<uint64_t> readLines{ 0 };
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>( 0, chunks.size(), 1 ),
+        [ & ]( const tbb::blocked_range<size_t>& range ) {
+            RawLines rawLines;
+            LineCursor cursor;
+            klogg::vector<uint64_t> chunkLines;
+            for ( auto chunk = range.begin(); chunk != range.end(); ++chunk ) {
+                if ( interruptRequested ) {
+                    return;
+                }
+
+                const auto chunkStart = chunks[ chunk ];
+                const auto chunkEnd = std::min( chunkStart + ChunkLines, nbLines );
+                chunkLines.clear();
+                auto line = lines.begin();
+                line.move( chunkStart );
+                for ( ; line != lines.end() && *line < chunkEnd; ++line ) {
+                    chunkLines.push_back( *line );
+                }
+
+                // Dense lines are read at once, sparse ones by runs of consecutive lines
+                const auto isDense
+                    = chunkLines.size() * DenseChunkRatio >= chunkEnd - chunkStart;
+                size_t runStart = 0;
+                while ( runStart < chunkLines.size() ) {
+                    auto runEnd = runStart + 1;
+                    if ( isDense ) {
+                        runEnd = chunkLines.size();
+                    }
+                    while ( runEnd < chunkLines.size()
+                            && chunkLines[ runEnd ] == chunkLines[ runEnd - 1 ] + 1 ) {
+                        ++runEnd;
+                    }
+
+                    const auto first = chunkLines[ runStart ];
+                    getLinesRaw( LineNumber( first ),
+                                 LinesCount( chunkLines[ runEnd - 1 ] - first + 1 ), rawLines,
+                                 &cursor );
+                    const auto& utf8Lines = rawLines.buildUtf8View();
+                    for ( auto index = runStart; index < runEnd; ++index ) {
+                        const auto offset = static_cast<size_t>( chunkLines[ index ] - first );
+                        if ( offset >= utf8Lines.size() ) {
+                            break;
+                        }
+                        lineRead( LineNumber( chunkLines[ index ] ), utf8Lines[ offset ] );
+                    }
+                    runStart = runEnd;
+                }
+                readLines += chunkLines.size();
+            }
+        } );
+
+    detachReader();
+
+    return LinesCount( readLines.load() );
+}
+
+FastLineLengthArray LogData::getIndexedLineLengths( LineNumber first, LinesCount number ) const
+{
+    if ( !prefilterPattern_.isEmpty() || hideAnsiColorSequences_
+         || !codec_.encodingParameters().isUtf8Compatible ) {
+        return {};
+    }
+
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    return scopedAccessor.getLineLengths( first, number );
+}
+
+LineNumber LogData::getLineAtTime( const QDateTime& time ) const
+{
+    timestampIndex_.setFormat( Configuration::get().timestampFormat() );
+    return timestampIndex_.lineAtTime(
+        time.toMSecsSinceEpoch(), doGetNbLine(),
+        [ this ]( LineNumber first, LinesCount number ) { return doGetLines( first, number ); } );
+}
+
+void LogData::setHideAnsiColorSequences( bool hide )
+{
+    IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+    if ( hideAnsiColorSequences_ != hide ) {
+        hideAnsiColorSequences_ = hide;
+        linePageCache_.clear();
+        timestampIndex_.clear();
+        fieldIndex_.clear();
+        lineHashIndex_.clear();
+        levelIndex_.clear();
+        dropSharedChunks();
+        startIndexingFields();
+    }
 }
 
 void LogData::attachFile( const QString& fileName )
@@ -115,10 +448,57 @@ void LogData::attachFile( const QString& fileName )
     }
 
     indexingFileName_ = fileName;
-    attached_file_.reset( new FileHolder( keepFileClosed_ ) );
+    MemoryGovernor::get().setGroupName( this, fileName );
+
+    // Compressed data is browsed without extracting it,
+    // logs of a merge list are always merged
+    if ( Configuration::get().openCompressedInPlace() || MergedAccess::isMergeList( fileName ) ) {
+        if ( auto compressedAccess = CompressedAccess::create( fileName ) ) {
+            LOG_INFO << "Opening compressed file in place";
+            fileChain_->setCompressedAccess( std::move( compressedAccess ) );
+        }
+    }
+
+    attached_file_.reset( new FileHolder( keepFileClosed_, fileChain_ ) );
     attached_file_->open( indexingFileName_ );
 
-    operationQueue_.enqueueOperation<AttachOperation>( fileName );
+    operationQueue_.enqueueOperation<AttachOperation>( fileName, fileChain_ );
+}
+
+void LogData::attachFiles( const klogg::vector<QString>& fileNames )
+{
+    LOG_DEBUG << "LogData::attachFiles " << fileNames.size() << " files";
+
+    if ( attached_file_ ) {
+        throw CantReattachErr();
+    }
+
+    if ( fileNames.empty() ) {
+        return;
+    }
+
+    // Files before the last one don't change, their handles are kept in the chain
+    for ( auto fileName = fileNames.begin(); fileName != std::prev( fileNames.end() );
+          ++fileName ) {
+        auto file = std::make_shared<QFile>( *fileName );
+        if ( !file->open( QIODevice::ReadOnly ) ) {
+            LOG_WARNING << "Cannot open file " << fileName->toStdString();
+            continue;
+        }
+
+        // Last line of a file without a final line feed is not joined with the next file
+        const auto size = file->size();
+        char lastByte = '\n';
+        if ( size > 0 && ( !file->seek( size - 1 ) || !file->getChar( &lastByte ) ) ) {
+            LOG_WARNING << "Cannot read file " << fileName->toStdString();
+            continue;
+        }
+
+        fileChain_->append( std::make_shared<const FileReader>( std::move( file ) ), size,
+                            lastByte != '\n' );
+    }
+
+    attachFile( fileNames.back() );
 }
 
 void LogData::interruptLoading()
@@ -131,6 +511,179 @@ qint64 LogData::getFileSize() const
     return IndexingData::ConstAccessor{ indexing_data_.get() }.getIndexedSize();
 }
 
+qint64 LogData::getFileSizeOnDisk() const
+{
+    // Size of the uncompressed data is not known
+    if ( fileChain_->compressedAccess() ) {
+        return getFileSize();
+    }
+
+    return FileChain::size( *fileChain_->segments() ) + QFileInfo( indexingFileName_ ).size();
+}
+
+LinesCount LogData::getEstimatedNbLine() const
+{
+    auto nbLines = 0_lcount;
+    qint64 indexedSize = 0;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        nbLines = scopedAccessor.getNbLines();
+        indexedSize = scopedAccessor.getIndexedSize();
+    }
+
+    if ( nbLines.get() == 0 || indexedSize <= 0 ) {
+        return nbLines;
+    }
+
+    const auto fileSize = getFileSizeOnDisk();
+    if ( fileSize <= indexedSize ) {
+        return nbLines;
+    }
+
+    return LinesCount( static_cast<LinesCount::UnderlyingType>(
+        static_cast<double>( nbLines.get() ) * static_cast<double>( fileSize )
+        / static_cast<double>( indexedSize ) ) );
+}
+
+OptionalLineNumber LogData::getLineAtOffset( qint64 offset ) const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    const auto nbLines = scopedAccessor.getNbLines();
+    if ( nbLines.get() == 0 || offset < scopedAccessor.getFirstLineOffset().get()
+         || offset >= scopedAccessor.getEndOfLineOffset( LineNumber( nbLines.get() - 1 ) ).get() ) {
+        return std::nullopt;
+    }
+
+    // First line ending after the offset
+    LineNumber::UnderlyingType first = 0;
+    auto count = nbLines.get();
+    while ( count > 0 ) {
+        const auto step = count / 2;
+        const auto line = first + step;
+        if ( scopedAccessor.getEndOfLineOffset( LineNumber( line ) ).get() <= offset ) {
+            first = line + 1;
+            count -= step + 1;
+        }
+        else {
+            count = step;
+        }
+    }
+
+    return LineNumber( first );
+}
+
+LogData::LinesAtOffset LogData::getLinesAtOffset( qint64 offset, LinesCount number ) const
+{
+    // Lines longer than the bytes read before or after the offset are cut
+    constexpr qint64 BytesBefore = 64 * 1024;
+    constexpr qint64 BytesAfter = 256 * 1024;
+
+    LinesAtOffset linesAtOffset;
+
+    auto nbLines = 0_lcount;
+    qint64 indexedSize = 0;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        nbLines = scopedAccessor.getNbLines();
+        indexedSize = scopedAccessor.getIndexedSize();
+    }
+
+    const auto textDecoder = codec_.makeDecoder();
+    const auto& encodingParams = textDecoder.encodingParams;
+    const auto lineFeedWidth = static_cast<qint64>( encodingParams.lineFeedWidth );
+
+    offset = std::max( qint64{ 0 }, std::min( offset, getFileSizeOnDisk() - 1 ) );
+    offset -= offset % lineFeedWidth;
+    const auto readStart = std::max( qint64{ 0 }, offset - BytesBefore );
+
+    std::shared_ptr<const FileReader> reader;
+    {
+        ScopedFileHolder<FileHolder> fileHolder( attached_file_.get() );
+        reader = fileHolder.getReader();
+    }
+
+    klogg::vector<char> buffer( static_cast<size_t>( offset - readStart + BytesAfter ) );
+    const auto bytesRead = reader ? reader->read( readStart, buffer.data(), klogg::ssize( buffer ) )
+                                  : qint64{ -1 };
+    if ( bytesRead <= 0 ) {
+        LOG_WARNING << "failed to read lines at offset " << offset;
+        return linesAtOffset;
+    }
+
+    const auto data = std::string_view( buffer.data(), static_cast<size_t>( bytesRead ) );
+    const auto isLineFeedAt = [ &data, &encodingParams, lineFeedWidth ]( size_t position ) {
+        for ( auto index = 0; index < lineFeedWidth; ++index ) {
+            const auto expected = index == encodingParams.lineFeedIndex ? '\n' : '\0';
+            if ( data[ position + static_cast<size_t>( index ) ] != expected ) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    const auto width = static_cast<size_t>( lineFeedWidth );
+    const auto offsetInData = static_cast<size_t>( offset - readStart );
+
+    // Line of the offset starts after the line feed before it,
+    // a quarter of the lines are shown before it
+    const auto findLineStart = [ &isLineFeedAt, width ]( size_t position ) {
+        while ( position >= width && !isLineFeedAt( position - width ) ) {
+            position -= width;
+        }
+        return position;
+    };
+    auto lineStart = findLineStart( offsetInData );
+    while ( linesAtOffset.offsetLine < static_cast<size_t>( number.get() / 4 )
+            && lineStart >= width ) {
+        lineStart = findLineStart( lineStart - width );
+        ++linesAtOffset.offsetLine;
+    }
+
+    auto position = lineStart;
+    auto lineBegin = lineStart;
+    while ( position + width <= data.size()
+            && linesAtOffset.lines.size() < static_cast<size_t>( number.get() ) ) {
+        if ( isLineFeedAt( position ) ) {
+            linesAtOffset.lines.push_back( textDecoder.decoder->toUnicode(
+                data.data() + lineBegin, static_cast<int>( position - lineBegin ) ) );
+            lineBegin = position + width;
+        }
+        position += width;
+    }
+    if ( linesAtOffset.lines.size() < static_cast<size_t>( number.get() )
+         && lineBegin < data.size() ) {
+        linesAtOffset.lines.push_back( textDecoder.decoder->toUnicode(
+            data.data() + lineBegin, static_cast<int>( data.size() - lineBegin ) ) );
+    }
+
+    linesAtOffset.firstLineOffset = readStart + static_cast<qint64>( lineStart );
+
+    // Indexed lines tell the average size of lines,
+    // lines read here are used until there are enough of them
+    if ( const auto line = getLineAtOffset( linesAtOffset.firstLineOffset ) ) {
+        linesAtOffset.estimatedFirstLine = *line;
+    }
+    else if ( nbLines.get() > 0 && indexedSize > 0 ) {
+        const auto bytesPerLine
+            = static_cast<double>( indexedSize ) / static_cast<double>( nbLines.get() );
+        const auto bytesAfterIndex
+            = std::max( qint64{ 0 }, linesAtOffset.firstLineOffset - indexedSize );
+        linesAtOffset.estimatedFirstLine = LineNumber(
+            nbLines.get()
+            + static_cast<LineNumber::UnderlyingType>(
+                static_cast<double>( bytesAfterIndex ) / bytesPerLine ) );
+    }
+    else if ( !linesAtOffset.lines.empty() ) {
+        const auto bytesPerLine = std::max( 1.0, static_cast<double>( lineBegin - lineStart )
+                                                     / static_cast<double>(
+                                                         linesAtOffset.lines.size() ) );
+        linesAtOffset.estimatedFirstLine = LineNumber( static_cast<LineNumber::UnderlyingType>(
+            static_cast<double>( linesAtOffset.firstLineOffset ) / bytesPerLine ) );
+    }
+
+    return linesAtOffset;
+}
+
 QDateTime LogData::getLastModifiedDate() const
 {
     return lastModifiedDate_;
@@ -146,19 +699,61 @@ void LogData::reload( QTextCodec* forcedEncoding )
 {
     operationQueue_.interrupt();
 
+    // Logs of a merge list are merged again with their new lines
+    if ( MergedAccess::isMergeList( indexingFileName_ ) ) {
+        fileChain_->setCompressedAccess( CompressedAccess::create( indexingFileName_ ) );
+    }
+
     // Re-open the file, useful in case the file has been moved
     attached_file_->reOpenFile();
 
-    operationQueue_.enqueueOperation<FullReindexOperation>( forcedEncoding );
+    // Lines stay available until the file is indexed again
+    constexpr auto KeepCurrentIndex = true;
+    operationQueue_.enqueueOperation<FullReindexOperation>( forcedEncoding, KeepCurrentIndex );
 }
 
 void LogData::fileChangedOnDisk( const QString& filename )
 {
-    LOG_INFO << "signalFileChanged " << filename << ", indexed file " << indexingFileName_;
+    // Not attached yet, e.g. a tab of the restored session not shown yet
+    if ( !attached_file_ ) {
+        return;
+    }
 
-    QFileInfo info( indexingFileName_ );
     const auto currentFileId = FileId::getFileId( indexingFileName_ );
     const auto attachedFileId = attached_file_->getFileId();
+    const bool isFileIdChanged = attachedFileId != currentFileId;
+
+    // Access of a changed compressed file is built again
+    if ( fileChain_->compressedAccess() ) {
+        if ( filename != indexingFileName_ ) {
+            return;
+        }
+
+        LOG_INFO << "Compressed file changed, decompressing it again";
+        fileChain_->setCompressedAccess( CompressedAccess::create( indexingFileName_ ) );
+        attached_file_->reOpenFile();
+        operationQueue_.enqueueOperation<FullReindexOperation>();
+        return;
+    }
+
+    // Followed file is indexed right away, the operation checks it
+    // as usual if data was not only appended.
+    if ( !isFileIdChanged && filename == indexingFileName_
+         && fileChangedOnDisk_ != MonitoredFileStatus::Truncated
+         && Configuration::get().useFastFollow() ) {
+        LOG_DEBUG << "signalFileChanged " << filename << ", following";
+
+        if ( !attached_file_->isOpen() ) {
+            attached_file_->reOpenFile();
+        }
+
+        operationQueue_.enqueueOperation<FollowAppendOperation>();
+        return;
+    }
+
+    LOG_INFO << "signalFileChanged " << filename << ", indexed file " << indexingFileName_;
+
+    QFileInfo info( indexingFileName_ );
 
     const auto indexedHash = IndexingData::ConstAccessor{ indexing_data_.get() }.getHash();
 
@@ -178,13 +773,21 @@ void LogData::fileChangedOnDisk( const QString& filename )
     // This is a crude heuristic but necessary for notification services that do not
     // give details (e.g. kqueues)
 
-    const bool isFileIdChanged = attachedFileId != currentFileId;
-
     if ( !isFileIdChanged && filename != indexingFileName_ ) {
         LOG_INFO << "ignore other file update";
         return;
     }
 
+    // Rotated file still holds all indexed data, the new file is read after it
+    // and is indexed as data added to the log.
+    if ( isFileIdChanged && Configuration::get().chainRotatedFiles()
+         && attached_file_->isOpen() && attached_file_->size() >= indexedHash.size
+         && attached_file_->chainOpenedFile() ) {
+        LOG_INFO << "File rotated, chained " << attached_file_->size() << " bytes";
+        operationQueue_.enqueueOperation<CheckDataChangesOperation>();
+        return;
+    }
+
     if ( isFileIdChanged || ( info.size() != attached_file_->size() )
          || ( !attached_file_->isOpen() ) ) {
 
@@ -196,16 +799,53 @@ void LogData::fileChangedOnDisk( const QString& filename )
     operationQueue_.enqueueOperation<CheckDataChangesOperation>();
 }
 
+void LogData::indexingProgressed( int percent )
+{
+    // Only the start and the end of indexing are signalled,
+    // progress polled before them is not reported after them
+    indexingProgressGeneration_ = indexingProgress_.load().generation;
+    if ( percent < 100 ) {
+        indexingProgressTimer_.start();
+    }
+    else {
+        indexingProgressTimer_.stop();
+    }
+
+    Q_EMIT loadingProgressed( percent );
+}
+
+void LogData::pollIndexingProgress()
+{
+    const auto progress = indexingProgress_.load();
+    if ( progress.generation != indexingProgressGeneration_ ) {
+        indexingProgressGeneration_ = progress.generation;
+        Q_EMIT loadingProgressed( progress.percent );
+    }
+}
+
 void LogData::indexingFinished( LoadingStatus status )
 {
+    indexingProgressTimer_.stop();
     attached_file_->detachReader();
 
     LOG_INFO << "indexingFinished for: " << indexingFileName_
              << ( status == LoadingStatus::Successful ) << ", found "
              << IndexingData::ConstAccessor{ indexing_data_.get() }.getNbLines() << " lines.";
 
+    const auto cacheStats = linePageCache_.stats();
+    LOG_INFO << "Line page cache: " << cacheStats.hits << " hits, " << cacheStats.misses
+             << " misses, " << cacheStats.pages << " pages of " << cacheStats.bytes << " bytes";
+
     if ( status == LoadingStatus::Successful ) {
-        FileWatcher::getFileWatcher().addFile( indexingFileName_ );
+        // Files first loaded in background tabs are watched once they are viewed
+        if ( !isFileWatched_ && taskPriority_ == TaskPriority::Background
+             && Configuration::get().deferInactiveUpdates() ) {
+            isWatchDeferred_ = true;
+        }
+        else {
+            FileWatcher::getFileWatcher().addFile( indexingFileName_ );
+            isFileWatched_ = true;
+        }
 
         // Update the modified date/time if the file exists
         lastModifiedDate_ = QDateTime();
@@ -216,7 +856,17 @@ void LogData::indexingFinished( LoadingStatus status )
 
     fileChangedOnDisk_ = MonitoredFileStatus::Unchanged;
 
+    // Lines could have been indexed again, times are sampled again on demand
+    timestampIndex_.clear();
+
+    // Fields of lines added to the index are indexed too,
+    // the field index is reset if lines were indexed again
+    if ( status == LoadingStatus::Successful ) {
+        startIndexingFields();
+    }
+
     LOG_DEBUG << "Sending indexingFinished.";
+    lastLoadingStatus_ = status;
     Q_EMIT loadingFinished( status );
 
     operationQueue_.finishOperationAndStartNext();
@@ -234,6 +884,10 @@ void LogData::checkFileChangesFinished( MonitoredFileStatus status )
             fileChangedOnDisk_ = MonitoredFileStatus::Truncated;
             operationQueue_.enqueueOperation<FullReindexOperation>();
             break;
+        case MonitoredFileStatus::Modified:
+            fileChangedOnDisk_ = MonitoredFileStatus::Modified;
+            operationQueue_.enqueueOperation<DifferentialReindexOperation>();
+            break;
         case MonitoredFileStatus::DataAdded:
             fileChangedOnDisk_ = MonitoredFileStatus::DataAdded;
             operationQueue_.enqueueOperation<PartialReindexOperation>();
@@ -255,6 +909,14 @@ void LogData::checkFileChangesFinished( MonitoredFileStatus status )
     operationQueue_.finishOperationAndStartNext();
 }
 
+void LogData::indexTruncated( LinesCount keptLines )
+{
+    LOG_INFO << "Index of " << indexingFileName_ << " truncated to " << keptLines << " lines";
+    timestampIndex_.truncate( keptLines );
+
+    Q_EMIT fileModified( LineNumber( keptLines.get() ) );
+}
+
 //
 // Implementation of virtual functions
 //
@@ -270,8 +932,20 @@ LineLength LogData::doGetMaxLength() const
 
 LineLength LogData::doGetLineLength( LineNumber line ) const
 {
-    if ( line >= IndexingData::ConstAccessor{ indexing_data_.get() }.getNbLines() ) {
-        return 0_length; /* exception? */
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        if ( line >= scopedAccessor.getNbLines() ) {
+            return 0_length; /* exception? */
+        }
+
+        // Lengths found during indexing are of ASCII lines,
+        // which are decoded the same way by any UTF-8 compatible codec.
+        if ( prefilterPattern_.isEmpty() && !hideAnsiColorSequences_
+             && codec_.encodingParameters().isUtf8Compatible ) {
+            if ( const auto length = scopedAccessor.getLineLength( line ) ) {
+                return *length;
+            }
+        }
     }
 
     return LineLength{ doGetExpandedLineString( line ).size() };
@@ -280,7 +954,21 @@ LineLength LogData::doGetLineLength( LineNumber line ) const
 void LogData::doSetDisplayEncoding( const char* encoding )
 {
     LOG_DEBUG << "AbstractLogData::setDisplayEncoding: " << encoding;
-    codec_.setCodec( QTextCodec::codecForName( encoding ) );
+
+    // Views set the encoding each time loading finishes,
+    // decoded lines are kept if it stays the same
+    auto* codec = QTextCodec::codecForName( encoding );
+    if ( codec != nullptr && codec_.codec() != nullptr && codec->mibEnum() == codec_.mibEnum() ) {
+        return;
+    }
+
+    codec_.setCodec( codec );
+    linePageCache_.clear();
+    timestampIndex_.clear();
+    fieldIndex_.clear();
+    lineHashIndex_.clear();
+    levelIndex_.clear();
+    dropSharedChunks();
     auto needReload = false;
     auto useGuessedCodec = false;
 
@@ -292,11 +980,18 @@ void LogData::doSetDisplayEncoding( const char* encoding )
             currentIndexCodec = scopedAccessor.getEncodingGuess();
         }
 
+        // Line feeds of encodings with the same width and position are found at
+        // the same offsets, so only the decoder changes. Lengths in the index are
+        // of bytes and tabs, they don't depend on the decoder either.
         if ( currentIndexCodec && codec_.mibEnum() != currentIndexCodec->mibEnum() ) {
             if ( codec_.encodingParameters() != EncodingParameters( currentIndexCodec ) ) {
                 needReload = true;
                 useGuessedCodec = codec_.mibEnum() == scopedAccessor.getEncodingGuess()->mibEnum();
             }
+            else {
+                LOG_INFO << "Lines are decoded as " << encoding << ", index of "
+                         << currentIndexCodec->name().toStdString() << " is kept";
+            }
         }
     }
 
@@ -341,73 +1036,515 @@ klogg::vector<QString> LogData::doGetExpandedLines( LineNumber first_line, Lines
     } );
 }
 
-LineNumber LogData::doGetLineNumber( LineNumber index ) const
+QString LogData::doGetExpandedLineWindow( LineNumber line, LineColumn firstColumn,
+                                          LineLength length ) const
 {
-    return index;
-}
+    // Columns of filtered lines can't be found from the bytes in the file
+    if ( !prefilterPattern_.isEmpty() || hideAnsiColorSequences_ ) {
+        return doGetExpandedLineString( line ).mid( firstColumn.get(), length.get() );
+    }
 
-LogData::RawLines LogData::getLinesRaw( LineNumber firstLine, LinesCount number ) const
-{
-    RawLines rawLines;
-    rawLines.startLine = firstLine;
+    qint64 lineStart = 0;
+    qint64 lineEnd = 0;
+    const auto charWidth = codec_.encodingParameters().lineFeedWidth;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        if ( line >= scopedAccessor.getNbLines() ) {
+            return {};
+        }
 
-    try {
-        rawLines.endOfLines.reserve( number.get() );
-        klogg::vector<LineNumber> lineNumbers{ static_cast<size_t>( number.get() ) };
-        std::iota( lineNumbers.begin(), lineNumbers.end(), firstLine );
+        lineStart = ( line == 0_lnum ? scopedAccessor.getFirstLineOffset()
+                                     : scopedAccessor.getEndOfLineOffset( line - 1_lcount ) )
+                        .get();
+        lineEnd = scopedAccessor.getEndOfLineOffset( line ).get() - charWidth;
+    }
 
-        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
-        rawLines.prefilterPattern
-            = !prefilterPattern_.isEmpty() ? QRegularExpression(
-                  prefilterPattern_, QRegularExpression::CaseInsensitiveOption )
-                                           : QRegularExpression{};
+    // Each character is taken as wide as a line feed and each tab as one column,
+    // it is exact for ASCII lines without tabs. Up to 4 bytes are read per column.
+    const auto windowStart
+        = std::clamp( lineStart + qint64{ firstColumn.get() } * charWidth, lineStart, lineEnd );
+    const auto windowEnd = std::min( lineEnd, windowStart + qint64{ length.get() } * 4 );
+    if ( windowStart >= windowEnd ) {
+        return {};
+    }
+
+    std::shared_ptr<const FileMapping> mapping;
+    if ( useMappedFileReading_ ) {
+        mapping = attached_file_->getMapping( windowEnd );
+    }
 
-        if ( lineNumbers.back() >= scopedAccessor.getNbLines() ) {
-            LOG_WARNING << "Lines out of bound asked for";
-            return {}; /* exception? */
+    klogg::vector<char> buffer;
+    std::string_view windowData;
+    if ( mapping ) {
+        windowData = mapping->data( windowStart, windowEnd - windowStart );
+    }
+    else {
+        std::shared_ptr<const FileReader> reader;
+        {
+            ScopedFileHolder<FileHolder> fileHolder( attached_file_.get() );
+            reader = fileHolder.getReader();
         }
 
-        ScopedFileHolder<FileHolder> fileHolder( attached_file_.get() );
+        buffer.resize( static_cast<size_t>( windowEnd - windowStart ) );
+        const auto bytesRead
+            = reader ? reader->read( windowStart, buffer.data(), klogg::ssize( buffer ) ) : -1;
+        windowData = std::string_view( buffer.data(),
+                                       static_cast<size_t>( std::max( bytesRead, qint64{} ) ) );
+    }
 
-        const auto firstByte
-            = ( firstLine == 0_lnum )
-                  ? 0
-                  : scopedAccessor.getEndOfLineOffset( firstLine - 1_lcount ).get();
-        const auto lastByte = scopedAccessor.getEndOfLineOffset( lineNumbers.back() ).get();
+    // Window starts at the next whole UTF-8 character
+    if ( codec_.encodingParameters().isUtf8Compatible ) {
+        const auto firstChar
+            = std::find_if( windowData.begin(), windowData.end(),
+                            []( char c ) { return ( static_cast<uint8_t>( c ) & 0xC0 ) != 0x80; } );
+        windowData.remove_prefix( static_cast<size_t>( firstChar - windowData.begin() ) );
+    }
 
-        std::transform( lineNumbers.begin(), lineNumbers.end(),
-                        std::back_inserter( rawLines.endOfLines ),
-                        [ &scopedAccessor, firstByte ]( const LineNumber& line ) {
-                            return scopedAccessor.getEndOfLineOffset( line ).get() - firstByte;
-                        } );
+    const auto textDecoder = codec_.makeDecoder();
+    auto windowText = textDecoder.decoder->toUnicode(
+        windowData.data(), type_safe::narrow_cast<int>( windowData.size() ) );
 
-        const auto bytesToRead = lastByte - firstByte;
-        LOG_DEBUG << "will try to read:" << bytesToRead << " bytes";
-        rawLines.buffer.resize( static_cast<std::size_t>( bytesToRead ) );
+    return untabify( std::move( windowText ), firstColumn ).left( length.get() );
+}
 
-        fileHolder.getFile()->seek( firstByte );
-        const auto bytesRead = fileHolder.getFile()->read( rawLines.buffer.data(), bytesToRead );
+bool LogData::readLineParts( LineNumber line, qint64 partBytes,
+                             const std::function<bool( std::string_view )>& consume ) const
+{
+    if ( !prefilterPattern_.isEmpty() || hideAnsiColorSequences_
+         || !codec_.encodingParameters().isUtf8Compatible ) {
+        return false;
+    }
 
-        if ( bytesRead != bytesToRead ) {
-            LOG_DEBUG << "failed to read " << bytesToRead << " bytes, got " << bytesRead;
+    qint64 lineStart = 0;
+    qint64 lineEnd = 0;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        if ( line >= scopedAccessor.getNbLines() ) {
+            return false;
+        }
+
+        lineStart = ( line == 0_lnum ? scopedAccessor.getFirstLineOffset()
+                                     : scopedAccessor.getEndOfLineOffset( line - 1_lcount ) )
+                        .get();
+        lineEnd = scopedAccessor.getEndOfLineOffset( line ).get() - 1;
+    }
+
+    std::shared_ptr<const FileMapping> mapping;
+    if ( useMappedFileReading_ ) {
+        mapping = attached_file_->getMapping( lineEnd );
+    }
+
+    std::shared_ptr<const FileReader> reader;
+    if ( !mapping ) {
+        ScopedFileHolder<FileHolder> fileHolder( attached_file_.get() );
+        reader = fileHolder.getReader();
+        if ( !reader ) {
+            return false;
+        }
+    }
+
+    klogg::vector<char> buffer;
+    for ( auto partStart = lineStart; partStart < lineEnd; partStart += partBytes ) {
+        const auto partSize = std::min( partBytes, lineEnd - partStart );
+
+        std::string_view part;
+        if ( mapping ) {
+            part = mapping->data( partStart, partSize );
+        }
+        else {
+            buffer.resize( static_cast<size_t>( partSize ) );
+            if ( reader->read( partStart, buffer.data(), partSize ) != partSize ) {
+                return false;
+            }
+            part = std::string_view( buffer.data(), buffer.size() );
+        }
+
+        if ( !consume( part ) ) {
+            break;
+        }
+    }
+
+    return true;
+}
+
+LinesCount LogData::getLinesInBytes( LineNumber first, qint64 bytes, LinesCount minLines,
+                                     LinesCount maxLines ) const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    const auto nbLines = scopedAccessor.getNbLines();
+    if ( first.get() >= nbLines.get() ) {
+        return 0_lcount;
+    }
+
+    const auto linesAfter = nbLines.get() - first.get();
+    auto low = std::min( minLines.get(), linesAfter );
+    auto high = std::min( maxLines.get(), linesAfter );
+    if ( low >= high ) {
+        return LinesCount( high );
+    }
+
+    const auto begin = first.get() > 0 ? scopedAccessor.getEndOfLineOffset( first - 1_lcount )
+                                       : scopedAccessor.getFirstLineOffset();
+    const auto end = begin.get() + bytes;
+
+    while ( low < high ) {
+        const auto middle = low + ( high - low + 1 ) / 2;
+        if ( scopedAccessor.getEndOfLineOffset( first + LinesCount( middle - 1 ) ).get() <= end ) {
+            low = middle;
+        }
+        else {
+            high = middle - 1;
+        }
+    }
+
+    return LinesCount( low );
+}
+
+qint64 LogData::doGetLineSize( LineNumber line ) const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    if ( line >= scopedAccessor.getNbLines() ) {
+        return 0;
+    }
+
+    const auto lineStart = line == 0_lnum ? scopedAccessor.getFirstLineOffset()
+                                          : scopedAccessor.getEndOfLineOffset( line - 1_lcount );
+    return scopedAccessor.getEndOfLineOffset( line ).get() - lineStart.get();
+}
+
+std::optional<QByteArray> LogData::doGetLinesBytes( LineNumber first, LinesCount number ) const
+{
+    klogg::vector<LineNumber> lines( number.get() );
+    std::generate( lines.begin(), lines.end(),
+                   [ line = first ]() mutable { return line++; } );
+    return readLinesBytes( lines );
+}
+
+std::optional<QByteArray> LogData::readLinesBytes( const klogg::vector<LineNumber>& lines ) const
+{
+    if ( !prefilterPattern_.isEmpty() || hideAnsiColorSequences_ ) {
+        return {};
+    }
+
+    // Lines between the asked ones are read too if there are only a few of them
+    constexpr LineNumber::UnderlyingType MaxLinesGap = 16;
+    constexpr LineNumber::UnderlyingType MaxRangeLines = 1024;
+    constexpr qint64 MaxBytes = std::numeric_limits<int>::max() / 2;
+
+    QByteArray bytes;
+    RawLines rawLines;
+    size_t rangeBegin = 0;
+    while ( rangeBegin < lines.size() ) {
+        const auto firstLine = lines[ rangeBegin ];
+        auto rangeEnd = rangeBegin + 1;
+        while ( rangeEnd < lines.size() && lines[ rangeEnd ] > lines[ rangeEnd - 1 ]
+                && lines[ rangeEnd ].get() - lines[ rangeEnd - 1 ].get() <= MaxLinesGap
+                && lines[ rangeEnd ].get() - firstLine.get() < MaxRangeLines ) {
+            ++rangeEnd;
+        }
+
+        const auto rangeLines = LinesCount( lines[ rangeEnd - 1 ].get() - firstLine.get() + 1 );
+        getLinesRaw( firstLine, rangeLines, rawLines );
+
+        const auto data = rawLines.data();
+        if ( rawLines.endOfLines.size() != rangeLines.get()
+             || rawLines.endOfLines.back() > klogg::ssize( data ) ) {
+            return {};
+        }
+
+        // Consecutive lines are copied at once
+        auto runBegin = rangeBegin;
+        while ( runBegin < rangeEnd ) {
+            auto runEnd = runBegin + 1;
+            while ( runEnd < rangeEnd && lines[ runEnd ].get() == lines[ runEnd - 1 ].get() + 1 ) {
+                ++runEnd;
+            }
+
+            const auto firstIndex = lines[ runBegin ].get() - firstLine.get();
+            const auto lastIndex = lines[ runEnd - 1 ].get() - firstLine.get();
+            const auto runStart = firstIndex == 0 ? 0 : rawLines.endOfLines[ firstIndex - 1 ];
+            const auto runSize = rawLines.endOfLines[ lastIndex ] - runStart;
+            if ( bytes.size() + runSize > MaxBytes ) {
+                return {};
+            }
+
+            bytes.append( data.data() + runStart, static_cast<int>( runSize ) );
+            runBegin = runEnd;
+        }
+
+        rangeBegin = rangeEnd;
+    }
+
+    return bytes;
+}
+
+std::optional<klogg::vector<qint64>>
+LogData::getLinesOffsets( const klogg::vector<LineNumber>& lines ) const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    if ( !lines.empty() && lines.back() >= scopedAccessor.getNbLines() ) {
+        return {};
+    }
+
+    klogg::vector<qint64> offsets;
+    offsets.reserve( lines.size() );
+
+    LineCursor cursor;
+    for ( const auto line : lines ) {
+        const auto lineStart
+            = line == 0_lnum ? scopedAccessor.getFirstLineOffset()
+                             : scopedAccessor.getEndOfLineOffset( line - 1_lcount, &cursor );
+        offsets.push_back( lineStart.get() );
+    }
+    return offsets;
+}
+
+LineNumber LogData::doGetLineNumber( LineNumber index ) const
+{
+    return index;
+}
+
+LogData::RawLines LogData::getLinesRaw( LineNumber firstLine, LinesCount number,
+                                        LineCursor* cursor ) const
+{
+    RawLines rawLines;
+    getLinesRaw( firstLine, number, rawLines, cursor );
+    return rawLines;
+}
+
+void LogData::getLinesRaw( LineNumber firstLine, LinesCount number, RawLines& rawLines,
+                           LineCursor* cursor ) const
+{
+    static auto& readDuration = Metrics::get().histogram( "lines.read_us" );
+    static auto& readLines = Metrics::get().counter( "lines.read" );
+    const Metrics::ScopedTimer timer( readDuration );
+    const TraceSpan span( "get lines", "lines", "line", static_cast<int64_t>( firstLine.get() ) );
+    readLines.add( number.get() );
+
+    rawLines.clear();
+    rawLines.startLine = firstLine;
+
+    try {
+        rawLines.endOfLines.reserve( number.get() );
+
+        // Color sequences are removed from bytes of ASCII compatible encodings,
+        // text decoded from others is filtered with the equivalent regex.
+        auto prefilterPattern = prefilterPattern_;
+        rawLines.hideAnsiColorSequences
+            = hideAnsiColorSequences_ && codec_.encodingParameters().isUtf8Compatible;
+        if ( hideAnsiColorSequences_ && !rawLines.hideAnsiColorSequences ) {
+            prefilterPattern = prefilterPattern.isEmpty()
+                                   ? QString( AnsiColorSequenceRegex )
+                                   : QString( "(?:%1)|(?:%2)" )
+                                         .arg( AnsiColorSequenceRegex, prefilterPattern );
         }
 
-        LOG_DEBUG << "done reading lines:" << rawLines.buffer.size();
+        rawLines.prefilterPattern
+            = !prefilterPattern.isEmpty() ? QRegularExpression(
+                  prefilterPattern, QRegularExpression::CaseInsensitiveOption )
+                                          : QRegularExpression{};
+
+        // End of the line before the first one is decoded along with the lines
+        const auto previousLines = firstLine == 0_lnum ? 0_lcount : 1_lcount;
+        const auto linesToDecode = number + previousLines;
+        auto& lineEnds = rawLines.lineEndsInFile_;
+        lineEnds.resize( static_cast<size_t>( linesToDecode.get() ) );
+        OffsetInFile::UnderlyingType firstByte = 0;
+
+        // Index is not locked while the file is read
+        {
+            IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+            if ( firstLine + number - 1_lcount >= scopedAccessor.getNbLines() ) {
+                LOG_WARNING << "Lines out of bound asked for";
+                return; /* exception? */
+            }
+
+            scopedAccessor.getEndOfLineOffsets( firstLine - previousLines, linesToDecode,
+                                                lineEnds.data(), cursor );
+
+            firstByte = ( firstLine == 0_lnum ) ? scopedAccessor.getFirstLineOffset().get()
+                                                : lineEnds.front().get();
+        }
+
+        const auto lastByte = lineEnds.back().get();
+
+        std::transform( lineEnds.begin() + static_cast<std::ptrdiff_t>( previousLines.get() ),
+                        lineEnds.end(), std::back_inserter( rawLines.endOfLines ),
+                        [ firstByte ]( const OffsetInFile& lineEnd ) {
+                            return lineEnd.get() - firstByte;
+                        } );
+
+        const auto bytesToRead = lastByte - firstByte;
         rawLines.textDecoder = codec_.makeDecoder();
-        return rawLines;
+
+        if ( useMappedFileReading_ && bytesToRead > 0 ) {
+            if ( auto mapping = attached_file_->getMapping( lastByte ) ) {
+                rawLines.mappedData = mapping->data( firstByte, bytesToRead );
+                rawLines.mapping = std::move( mapping );
+                return;
+            }
+        }
+
+        LOG_TRACE << "will try to read:" << bytesToRead << " bytes";
+        rawLines.buffer.resize( static_cast<std::size_t>( bytesToRead ) );
+
+        // The file is read without holding its lock, so other threads can read at once
+        std::shared_ptr<const FileReader> reader;
+        {
+            ScopedFileHolder<FileHolder> fileHolder( attached_file_.get() );
+            reader = fileHolder.getReader();
+        }
+
+        const auto bytesRead
+            = reader ? reader->read( firstByte, rawLines.buffer.data(), bytesToRead ) : -1;
+
+        if ( bytesRead != bytesToRead ) {
+            LOG_TRACE << "failed to read " << bytesToRead << " bytes, got " << bytesRead;
+        }
+
+        LOG_TRACE << "done reading lines:" << rawLines.buffer.size();
+        return;
 
     } catch ( const std::bad_alloc& ) {
         LOG_ERROR << "not enough memory";
-        rawLines.endOfLines.clear();
-        rawLines.buffer.clear();
-        return rawLines;
+        rawLines.clear();
+    }
+}
+
+LogData::SharedRawLines::SharedRawLines( RawLines lines )
+    : lines_( std::move( lines ) )
+{
+}
+
+const klogg::vector<std::string_view>& LogData::SharedRawLines::utf8View() const
+{
+    std::call_once( utf8ViewBuilt_, [ this ] { utf8View_ = &lines_.buildUtf8View(); } );
+    return *utf8View_;
+}
+
+void LogData::beginSearch() const
+{
+    ++runningSearches_;
+}
+
+void LogData::endSearch() const
+{
+    if ( --runningSearches_ < 2 ) {
+        dropSharedChunks();
+    }
+}
+
+void LogData::dropSharedChunks() const
+{
+    ScopedLock lock( sharedChunksMutex_ );
+    sharedChunks_.clear();
+}
+
+uint64_t LogData::sharedChunksSize() const
+{
+    ScopedLock lock( sharedChunksMutex_ );
+
+    uint64_t size = 0;
+    for ( const auto& chunk : sharedChunks_ ) {
+        // Chunks being read are not accounted yet
+        if ( chunk.lines.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready ) {
+            continue;
+        }
+
+        try {
+            const auto& lines = chunk.lines.get();
+            if ( lines ) {
+                const auto& rawLines = lines->rawLines();
+                size += rawLines.buffer.capacity()
+                        + rawLines.endOfLines.capacity() * sizeof( qint64 );
+            }
+        } catch ( ... ) {
+            // Lines that failed to be read hold no memory
+        }
+    }
+    return size;
+}
+
+void LogData::setTaskPriority( TaskPriority priority )
+{
+    taskPriority_ = priority;
+
+    if ( priority == TaskPriority::Foreground ) {
+        MemoryGovernor::get().markUsed( this );
+
+        if ( isWatchDeferred_ ) {
+            isWatchDeferred_ = false;
+            FileWatcher::getFileWatcher().addFile( indexingFileName_ );
+            isFileWatched_ = true;
+
+            // File could have changed before it was watched
+            operationQueue_.enqueueOperation<CheckDataChangesOperation>();
+        }
+    }
+}
+
+TaskPriority LogData::taskPriority() const
+{
+    return taskPriority_;
+}
+
+int LogData::numaNode() const
+{
+    return numaNode_;
+}
+
+std::shared_ptr<const LogData::SharedRawLines>
+LogData::getSharedLinesRaw( LineNumber firstLine, LinesCount number, LineCursor* cursor ) const
+{
+    if ( runningSearches_ < 2 ) {
+        return {};
+    }
+
+    const auto indexGeneration
+        = IndexingData::ConstAccessor{ indexing_data_.get() }.getLinePositionGeneration();
+
+    std::promise<std::shared_ptr<const SharedRawLines>> linesRead;
+    {
+        ScopedLock lock( sharedChunksMutex_ );
+        if ( sharedChunksGeneration_ != indexGeneration ) {
+            sharedChunks_.clear();
+            sharedChunksGeneration_ = indexGeneration;
+        }
+
+        const auto chunk = std::find_if( sharedChunks_.cbegin(), sharedChunks_.cend(),
+                                         [ firstLine, number ]( const SharedChunk& sharedChunk ) {
+                                             return sharedChunk.firstLine == firstLine
+                                                    && sharedChunk.linesCount == number;
+                                         } );
+
+        if ( chunk != sharedChunks_.cend() ) {
+            // Lines can still be read by other search
+            auto lines = chunk->lines;
+            lock.unlock();
+            return lines.get();
+        }
+
+        sharedChunks_.push_back( SharedChunk{ firstLine, number, linesRead.get_future().share() } );
+        if ( sharedChunks_.size() > MaxSharedChunks ) {
+            sharedChunks_.pop_front();
+        }
+    }
+
+    try {
+        auto lines
+            = std::make_shared<const SharedRawLines>( getLinesRaw( firstLine, number, cursor ) );
+        linesRead.set_value( lines );
+        return lines;
+    } catch ( ... ) {
+        linesRead.set_exception( std::current_exception() );
+        throw;
     }
 }
 
 klogg::vector<QString> LogData::getLinesFromFile( LineNumber firstLine, LinesCount number,
                                                   QString ( *processLine )( QString&& ) ) const
 {
-    LOG_DEBUG << "firstLine:" << firstLine << " nb:" << number;
+    LOG_TRACE << "firstLine:" << firstLine << " nb:" << number;
 
     if ( number.get() == 0 ) {
         return klogg::vector<QString>();
@@ -415,8 +1552,7 @@ klogg::vector<QString> LogData::getLinesFromFile( LineNumber firstLine, LinesCou
 
     klogg::vector<QString> processedLines;
     try {
-        const auto rawLines = getLinesRaw( firstLine, number );
-        auto decodedLines = rawLines.decodeLines();
+        auto decodedLines = getDecodedLines( firstLine, number );
 
         processedLines.reserve( decodedLines.size() );
 
@@ -437,11 +1573,363 @@ klogg::vector<QString> LogData::getLinesFromFile( LineNumber firstLine, LinesCou
     return processedLines;
 }
 
+klogg::vector<QString> LogData::getDecodedLines( LineNumber firstLine, LinesCount number ) const
+{
+    if ( number.get() > MaxCachedRangeLines ) {
+        return getLinesRaw( firstLine, number ).decodeLines();
+    }
+
+    auto nbLines = 0_lcount;
+    uint64_t indexGeneration = 0;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        nbLines = scopedAccessor.getNbLines();
+        indexGeneration = scopedAccessor.getLinePositionGeneration();
+    }
+
+    const auto generation = linePageCache_.startReading( indexGeneration );
+
+    klogg::vector<QString> lines;
+    lines.reserve( number.get() );
+
+    const auto endLine = firstLine.get() + number.get();
+    auto line = firstLine.get();
+    while ( line < endLine ) {
+        const auto page = line / LinePageCache::PageLines;
+        const auto pageFirstLine = page * LinePageCache::PageLines;
+        const auto pageEndLine = pageFirstLine + LinePageCache::PageLines;
+
+        // Lines of the last page can still change or be added,
+        // it is cached when a line after it is indexed.
+        if ( pageEndLine >= nbLines.get() ) {
+            auto tailLines
+                = getLinesRaw( LineNumber( line ), LinesCount( endLine - line ) ).decodeLines();
+            std::move( tailLines.begin(), tailLines.end(), std::back_inserter( lines ) );
+            break;
+        }
+
+        auto pageLines = linePageCache_.get( page );
+        if ( !pageLines ) {
+            pageLines = readLinePage( page, generation );
+            if ( !pageLines ) {
+                break;
+            }
+        }
+
+        const auto pageEnd = std::min( pageEndLine, endLine );
+        lines.insert( lines.end(),
+                      pageLines->begin() + static_cast<std::ptrdiff_t>( line - pageFirstLine ),
+                      pageLines->begin() + static_cast<std::ptrdiff_t>( pageEnd - pageFirstLine ) );
+        line = pageEnd;
+    }
+
+    readAheadIfSequential( firstLine.get(), endLine, nbLines );
+
+    return lines;
+}
+
+LinePageCache::Page LogData::readLinePage( uint64_t page, uint64_t generation ) const
+{
+    auto pageLines = std::make_shared<const klogg::vector<QString>>(
+        getLinesRaw( LineNumber( page * LinePageCache::PageLines ),
+                     LinesCount( LinePageCache::PageLines ) )
+            .decodeLines() );
+
+    if ( pageLines->size() != LinePageCache::PageLines ) {
+        LOG_WARNING << "Failed to read lines of page " << page;
+        return {};
+    }
+
+    linePageCache_.add( page, pageLines, generation );
+    return pageLines;
+}
+
+void LogData::readAheadIfSequential( uint64_t firstLine, uint64_t endLine,
+                                     LinesCount nbLines ) const
+{
+    constexpr auto NearbyLines = ReadAheadPages * LinePageCache::PageLines;
+
+    int direction = 0;
+    {
+        ScopedLock lock( readPatternMutex_ );
+        // Same lines are read again when the view is repainted
+        if ( firstLine == lastRead_.firstLine ) {
+            return;
+        }
+
+        if ( firstLine > lastRead_.firstLine && firstLine <= lastRead_.endLine + NearbyLines ) {
+            direction = 1;
+        }
+        else if ( firstLine < lastRead_.firstLine
+                  && endLine + NearbyLines >= lastRead_.firstLine ) {
+            direction = -1;
+        }
+
+        if ( direction == 0 ) {
+            lastRead_.sequentialReads = 0;
+        }
+        else if ( direction == lastRead_.direction ) {
+            ++lastRead_.sequentialReads;
+        }
+        else {
+            lastRead_.sequentialReads = 1;
+        }
+        lastRead_.direction = direction;
+        lastRead_.firstLine = firstLine;
+        lastRead_.endLine = endLine;
+
+        if ( lastRead_.sequentialReads < SequentialReadsToReadAhead ) {
+            return;
+        }
+    }
+
+    // Only pages before the last indexed line are cached
+    const auto cachedPages
+        = nbLines.get() > 0 ? ( nbLines.get() - 1 ) / LinePageCache::PageLines : 0;
+
+    uint64_t firstPage = 0;
+    uint64_t endPage = 0;
+    if ( direction > 0 ) {
+        firstPage = std::min( endLine / LinePageCache::PageLines, cachedPages );
+        endPage = std::min( firstPage + ReadAheadPages, cachedPages );
+    }
+    else {
+        endPage = std::min( firstLine / LinePageCache::PageLines, cachedPages );
+        firstPage = endPage > ReadAheadPages ? endPage - ReadAheadPages : 0;
+    }
+
+    if ( firstPage == endPage || isReadingAhead_.exchange( true ) ) {
+        return;
+    }
+
+    readAheadPool_.start( createRunnable( [ this, firstPage, endPage, direction ] {
+        try {
+            readAhead( firstPage, endPage, direction < 0 );
+        } catch ( const std::exception& e ) {
+            LOG_ERROR << "Failed to read lines ahead: " << e.what();
+        }
+        isReadingAhead_ = false;
+    } ) );
+}
+
+void LogData::readAhead( uint64_t firstPage, uint64_t endPage, bool isBackward ) const
+{
+    uint64_t indexGeneration = 0;
+    qint64 firstByte = 0;
+    qint64 lastByte = 0;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        if ( endPage * LinePageCache::PageLines > scopedAccessor.getNbLines().get() ) {
+            return;
+        }
+
+        indexGeneration = scopedAccessor.getLinePositionGeneration();
+        firstByte = firstPage == 0 ? scopedAccessor.getFirstLineOffset().get()
+                                   : scopedAccessor
+                                         .getEndOfLineOffset( LineNumber(
+                                             firstPage * LinePageCache::PageLines - 1 ) )
+                                         .get();
+        lastByte = scopedAccessor
+                       .getEndOfLineOffset( LineNumber( endPage * LinePageCache::PageLines - 1 ) )
+                       .get();
+    }
+
+    const auto generation = linePageCache_.startReading( indexGeneration );
+
+    LOG_DEBUG << "Reading ahead pages " << firstPage << " to " << endPage;
+    attached_file_->adviseWillNeed( firstByte, lastByte - firstByte );
+
+    for ( uint64_t i = 0; i < endPage - firstPage; ++i ) {
+        const auto page = isBackward ? endPage - 1 - i : firstPage + i;
+        if ( !linePageCache_.contains( page ) && !readLinePage( page, generation ) ) {
+            return;
+        }
+    }
+}
+
+void LogData::prefetchLines( const klogg::vector<LineNumber>& lines ) const
+{
+    klogg::vector<uint64_t> pages;
+    for ( const auto line : lines ) {
+        const auto page = line.get() / LinePageCache::PageLines;
+        if ( std::find( pages.begin(), pages.end(), page ) == pages.end()
+             && !linePageCache_.contains( page ) ) {
+            pages.push_back( page );
+            if ( pages.size() == MaxPrefetchPages ) {
+                break;
+            }
+        }
+    }
+
+    if ( pages.empty() ) {
+        return;
+    }
+
+    {
+        ScopedLock lock( prefetchMutex_ );
+        prefetchPages_ = std::move( pages );
+        if ( isPrefetching_ ) {
+            return;
+        }
+        isPrefetching_ = true;
+    }
+
+    readAheadPool_.start( createRunnable( [ this ] {
+        try {
+            prefetchPages();
+        } catch ( const std::exception& e ) {
+            LOG_ERROR << "Failed to prefetch lines: " << e.what();
+            ScopedLock lock( prefetchMutex_ );
+            prefetchPages_.clear();
+            isPrefetching_ = false;
+        }
+    } ) );
+}
+
+void LogData::prefetchPages() const
+{
+    static auto& prefetchedPages = Metrics::get().counter( "lines.prefetched_pages" );
+
+    klogg::vector<uint64_t> pages;
+    while ( true ) {
+        {
+            ScopedLock lock( prefetchMutex_ );
+            if ( prefetchPages_.empty() ) {
+                isPrefetching_ = false;
+                return;
+            }
+            pages.clear();
+            pages.swap( prefetchPages_ );
+        }
+
+        uint64_t indexGeneration = 0;
+        uint64_t cachedPages = 0;
+        {
+            IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+            indexGeneration = scopedAccessor.getLinePositionGeneration();
+            // Only pages before the last indexed line are cached
+            const auto nbLines = scopedAccessor.getNbLines().get();
+            cachedPages = nbLines > 0 ? ( nbLines - 1 ) / LinePageCache::PageLines : 0;
+        }
+
+        const auto generation = linePageCache_.startReading( indexGeneration );
+
+        const TraceSpan span( "prefetch lines", "lines", "pages",
+                              static_cast<int64_t>( pages.size() ) );
+        for ( const auto page : pages ) {
+            {
+                // Pages of the newer call are read instead
+                ScopedLock lock( prefetchMutex_ );
+                if ( !prefetchPages_.empty() ) {
+                    break;
+                }
+            }
+
+            if ( page >= cachedPages || linePageCache_.contains( page ) ) {
+                continue;
+            }
+            if ( !readLinePage( page, generation ) ) {
+                break;
+            }
+            prefetchedPages.add();
+        }
+    }
+}
+
+void LogData::startIndexingFields()
+{
+    const auto& config = Configuration::get();
+    if ( config.useFieldIndex() && !isIndexingFields_.exchange( true ) ) {
+        fieldIndexPool_.start( createRunnable( [ this ] {
+            try {
+                indexLines( fieldIndex_, "fields" );
+            } catch ( const std::exception& e ) {
+                LOG_ERROR << "Failed to index fields: " << e.what();
+            }
+            isIndexingFields_ = false;
+        } ) );
+    }
+
+    if ( config.useLineHashIndex() && !isHashingLines_.exchange( true ) ) {
+        fieldIndexPool_.start( createRunnable( [ this ] {
+            try {
+                indexLines( lineHashIndex_, "hashes" );
+            } catch ( const std::exception& e ) {
+                LOG_ERROR << "Failed to index hashes: " << e.what();
+            }
+            isHashingLines_ = false;
+        } ) );
+    }
+
+    if ( config.useLevelIndex() && !isIndexingLevels_.exchange( true ) ) {
+        fieldIndexPool_.start( createRunnable( [ this ] {
+            try {
+                indexLines( levelIndex_, "levels" );
+            } catch ( const std::exception& e ) {
+                LOG_ERROR << "Failed to index levels: " << e.what();
+            }
+            isIndexingLevels_ = false;
+        } ) );
+    }
+}
+
+template <typename Index>
+void LogData::indexLines( Index& index, const char* name )
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto firstLine = index.indexedLines();
+
+    LineCursor cursor;
+    RawLines lines;
+    while ( !stopIndexingFields_ ) {
+        uint64_t linesGeneration = 0;
+        LinesCount nbLines;
+        {
+            IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+            linesGeneration = scopedAccessor.getLinePositionGeneration();
+            nbLines = scopedAccessor.getNbLines();
+        }
+
+        // Lines read after the index is cleared or reset are not added
+        const auto position = index.position( linesGeneration );
+        if ( position.nextLine.get() >= nbLines.get() ) {
+            break;
+        }
+
+        const auto number = LinesCount(
+            std::min( FieldIndexChunkLines, nbLines.get() - position.nextLine.get() ) );
+        const TraceSpan span( "index lines", "indexing", "line",
+                              static_cast<int64_t>( position.nextLine.get() ) );
+        getLinesRaw( position.nextLine, number, lines, &cursor );
+        if ( lines.endOfLines.size() != number.get() ) {
+            LOG_WARNING << "Cannot read lines at " << position.nextLine << " to index " << name;
+            break;
+        }
+        index.addLines( position, lines.buildUtf8View() );
+    }
+
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime );
+    LOG_INFO << "Indexed " << name << " from line " << firstLine << " to "
+             << index.indexedLines() << " in " << duration.count() << " ms, "
+             << index.allocatedSize() << " bytes";
+}
+
 QTextCodec* LogData::getDetectedEncoding() const
 {
     return IndexingData::ConstAccessor{ indexing_data_.get() }.getEncodingGuess();
 }
 
+bool LogData::isAttached() const
+{
+    return attached_file_ != nullptr;
+}
+
+std::optional<LoadingStatus> LogData::lastLoadingStatus() const
+{
+    return lastLoadingStatus_;
+}
+
 void LogData::doAttachReader() const
 {
     attached_file_->attachReader();
@@ -452,6 +1940,22 @@ void LogData::doDetachReader() const
     attached_file_->detachReader();
 }
 
+std::string_view LogData::RawLines::data() const
+{
+    return mapping ? mappedData : std::string_view( buffer.data(), buffer.size() );
+}
+
+std::string_view LogData::RawLines::utf16Data() const
+{
+    const auto& encodingParams = textDecoder.encodingParams;
+    if ( encodingParams.lineFeedWidth != 2 || encodingParams.isUtf8Compatible
+         || hideAnsiColorSequences || !prefilterPattern.pattern().isEmpty() ) {
+        return {};
+    }
+
+    return data();
+}
+
 klogg::vector<QString> LogData::RawLines::decodeLines() const
 {
     if ( this->endOfLines.empty() ) {
@@ -461,34 +1965,77 @@ klogg::vector<QString> LogData::RawLines::decodeLines() const
     klogg::vector<QString> decodedLines;
     decodedLines.reserve( this->endOfLines.size() );
 
+    const auto buffer = data();
+    klogg::vector<char> strippedLine;
+
+    // Stateless conversions of Qt are vectorized and skip the codec,
+    // other encodings go through the decoder
+    const auto& encodingParams = textDecoder.encodingParams;
+    const auto decode = [ this, &encodingParams ]( std::string_view text, bool isFirstLine ) {
+        const auto size = type_safe::narrow_cast<int>( text.size() );
+        if ( encodingParams.isLatin1 ) {
+            return QString::fromLatin1( text.data(), size );
+        }
+        if ( !encodingParams.isUtf8Compatible ) {
+            return textDecoder.decoder->toUnicode( text.data(), size );
+        }
+
+        // Decoder drops byte order mark at the beginning of the data
+        constexpr std::string_view Utf8Bom = "\xEF\xBB\xBF";
+        if ( isFirstLine && text.substr( 0, Utf8Bom.size() ) == Utf8Bom ) {
+            text.remove_prefix( Utf8Bom.size() );
+        }
+        return QString::fromUtf8( text.data(), type_safe::narrow_cast<int>( text.size() ) );
+    };
+
     try {
         qint64 lineStart = 0;
         size_t currentLineIndex = 0;
-        const auto lineFeedWidth = textDecoder.encodingParams.lineFeedWidth;
+        const auto lineFeedWidth = encodingParams.lineFeedWidth;
         for ( const auto& lineEnd : this->endOfLines ) {
             const auto length = lineEnd - lineStart - lineFeedWidth;
-            LOG_DEBUG << "line " << this->startLine.get() + currentLineIndex << ", length "
+            LOG_TRACE << "line " << this->startLine.get() + currentLineIndex << ", length "
                       << length;
 
-            constexpr auto maxlength = std::numeric_limits<int>::max() / 2;
-            if ( length >= maxlength ) {
-                decodedLines.emplace_back( "KLOGG WARNING: this line is too long" );
-                break;
-            }
-
             if ( lineStart + length > klogg::ssize( buffer ) ) {
                 decodedLines.emplace_back( "KLOGG WARNING: file read failed" );
                 LOG_WARNING << "not enough data in buffer";
                 break;
             }
 
-            auto decodedLine = textDecoder.decoder->toUnicode(
-                buffer.data() + lineStart, type_safe::narrow_cast<int>( length ) );
+            auto lineText = std::string_view( buffer.data() + lineStart,
+                                              static_cast<size_t>( std::max( length, qint64{} ) ) );
+
+            // Truncated line ends before a whole character
+            const auto isTruncated = length > MaxDecodedLineBytes;
+            if ( isTruncated ) {
+                auto truncatedLength = static_cast<size_t>( MaxDecodedLineBytes
+                                                            - MaxDecodedLineBytes % lineFeedWidth );
+                const auto isContinuationByte = [ &lineText ]( size_t position ) {
+                    return ( static_cast<uint8_t>( lineText[ position ] ) & 0xC0 ) == 0x80;
+                };
+                while ( encodingParams.isUtf8Compatible && truncatedLength > 0
+                        && isContinuationByte( truncatedLength ) ) {
+                    --truncatedLength;
+                }
+                lineText = lineText.substr( 0, truncatedLength );
+            }
+            if ( hideAnsiColorSequences ) {
+                strippedLine.resize( lineText.size() );
+                lineText = { strippedLine.data(),
+                             stripAnsiColorSequences( lineText, strippedLine.data() ) };
+            }
+
+            auto decodedLine = decode( lineText, decodedLines.empty() );
 
             if ( !prefilterPattern.pattern().isEmpty() ) {
                 decodedLine.remove( prefilterPattern );
             }
 
+            if ( isTruncated ) {
+                decodedLine.append( QString( " [KLOGG: line truncated, %1 bytes]" ).arg( length ) );
+            }
+
             decodedLines.push_back( std::move( decodedLine ) );
 
             lineStart = lineEnd;
@@ -506,9 +2053,19 @@ klogg::vector<QString> LogData::RawLines::decodeLines() const
     return decodedLines;
 }
 
-klogg::vector<std::string_view> LogData::RawLines::buildUtf8View() const
+void LogData::RawLines::clear()
+{
+    buffer.clear();
+    mapping.reset();
+    mappedData = {};
+    endOfLines.clear();
+    utf8Lines_.clear();
+}
+
+const klogg::vector<std::string_view>& LogData::RawLines::buildUtf8View() const
 {
-    klogg::vector<std::string_view> lines;
+    auto& lines = utf8Lines_;
+    lines.clear();
     if ( this->endOfLines.empty() || textDecoder.decoder == nullptr ) {
         return lines;
     }
@@ -519,39 +2076,51 @@ klogg::vector<std::string_view> LogData::RawLines::buildUtf8View() const
 
         lines.reserve( endOfLines.size() );
 
+        const auto buffer = data();
         std::string_view wholeString;
 
         if ( prefilterPattern.pattern().isEmpty() && textDecoder.encodingParams.isUtf8Compatible ) {
-            wholeString = std::string_view( buffer.data(), buffer.size() );
+            if ( hideAnsiColorSequences ) {
+                utf8Data_.resize( buffer.size() );
+                wholeString
+                    = { utf8Data_.data(), stripAnsiColorSequences( buffer, utf8Data_.data() ) };
+            }
+            else {
+                // Lines point to the mapped file or the buffer
+                wholeString = buffer;
+            }
         }
         else {
+            auto text = buffer;
+            if ( hideAnsiColorSequences ) {
+                strippedData_.resize( text.size() );
+                text = { strippedData_.data(),
+                         stripAnsiColorSequences( text, strippedData_.data() ) };
+            }
 
-            QString utf16Data;
-            if ( prefilterPattern.pattern().isEmpty() && textDecoder.encodingParams.isUtf16LE ) {
-                utf16Data = QString::fromRawData( reinterpret_cast<const QChar*>( buffer.data() ),
-                                                  klogg::isize( buffer ) / 2 );
+            // Latin-1 and UTF-16 are converted to UTF-8 directly, without decoding
+            // each chunk to QString and encoding it again
+            const auto utf8Text
+                = prefilterPattern.pattern().isEmpty()
+                      ? convertToUtf8( text, textDecoder.encodingParams, utf8Data_ )
+                      : std::nullopt;
+            if ( utf8Text ) {
+                wholeString = *utf8Text;
             }
             else {
-                utf16Data = textDecoder.decoder->toUnicode( buffer.data(), klogg::isize( buffer ) );
+                auto utf16Data
+                    = textDecoder.decoder->toUnicode( text.data(), klogg::isize( text ) );
+                if ( !prefilterPattern.pattern().isEmpty() ) {
+                    utf16Data.remove( prefilterPattern );
+                }
+
+                utf8Data_.resize( static_cast<size_t>( utf16Data.size() ) * 3 );
+                const auto resultSize = simdutf::convert_utf16_to_utf8(
+                    reinterpret_cast<const char16_t*>( utf16Data.utf16() ),
+                    static_cast<size_t>( utf16Data.size() ), utf8Data_.data() );
+
+                wholeString = { utf8Data_.data(), resultSize };
             }
-
-            if ( !prefilterPattern.pattern().isEmpty() ) {
-                utf16Data.remove( prefilterPattern );
-            }
-
-            size_t resultSize = 0;
-            // if ( !optimizeForNotLatinEncodings ) {
-            //     utf8Data_ = utf16Data.toUtf8();
-            //     resultSize = static_cast<size_t>( utf8Data_.size() );
-            // }
-            // else {
-            utf8Data_.resize( buffer.size() * 2 );
-            resultSize = simdutf::convert_utf16_to_utf8(
-                reinterpret_cast<const char16_t*>( utf16Data.utf16() ),
-                static_cast<size_t>( utf16Data.size() ), utf8Data_.data() );
-            // }
-
-            wholeString = { utf8Data_.data(), resultSize };
         }
 
         auto nextLineFeed = wholeString.find( '\n' );
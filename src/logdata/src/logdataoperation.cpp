@@ -47,15 +47,15 @@ void AttachOperation::doStart( LogDataWorker& workerThread ) const
 {
     const auto defaultEncodingMib = Configuration::get().defaultEncodingMib();
     LOG_INFO << "Attaching " << filename_ << ", encoding " << defaultEncodingMib;
-    workerThread.attachFile( filename_ );
+    workerThread.attachFile( filename_, fileChain_ );
     workerThread.indexAll( defaultEncodingMib >= 0 ? QTextCodec::codecForMib( defaultEncodingMib )
                                                    : nullptr );
 }
 
 void FullReindexOperation::doStart( LogDataWorker& workerThread ) const
 {
-    LOG_INFO << "Reindexing (full)";
-    workerThread.indexAll( forcedEncoding_ );
+    LOG_INFO << "Reindexing (full), keep current index " << keepCurrentIndex_;
+    workerThread.indexAll( forcedEncoding_, keepCurrentIndex_ );
 }
 
 void PartialReindexOperation::doStart( LogDataWorker& workerThread ) const
@@ -64,12 +64,24 @@ void PartialReindexOperation::doStart( LogDataWorker& workerThread ) const
     workerThread.indexAdditionalLines();
 }
 
+void DifferentialReindexOperation::doStart( LogDataWorker& workerThread ) const
+{
+    LOG_INFO << "Reindexing (differential)";
+    workerThread.indexModifiedLines();
+}
+
 void CheckDataChangesOperation::doStart( LogDataWorker& workerThread ) const
 {
     LOG_INFO << "Checking file changes";
     workerThread.checkFileChanges();
 }
 
+void FollowAppendOperation::doStart( LogDataWorker& workerThread ) const
+{
+    LOG_DEBUG << "Indexing appended data";
+    workerThread.indexAppendedData();
+}
+
 OperationQueue::OperationQueue( std::function<void()> beforeOperationStart )
     : beforeOperationStart_( std::move( beforeOperationStart ) )
 {
@@ -36,7 +36,11 @@
  * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
+#include <deque>
 #include <exception>
 #include <functional>
 #include <qglobal.h>
@@ -49,23 +53,235 @@
 #include <QMessageBox>
 #include <QSemaphore>
 #include <tuple>
+#include <utility>
 
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "blockpool.h"
+#include "blockreadqueue.h"
 #include "configuration.h"
+#include "delimetermasks.h"
 #include "dispatch_to.h"
 #include "encodingdetector.h"
+#include "indexcache.h"
 #include "issuereporter.h"
 #include "linetypes.h"
 #include "log.h"
 #include "logdata.h"
 #include "memory_info.h"
+#include "metrics.h"
 #include "progress.h"
 #include "readablesize.h"
 #include "runnable_lambda.h"
+#include "tracing.h"
 
 #include "logdataworker.h"
 
 constexpr int IndexingBlockSize = 1 * 1024 * 1024;
 
+// Readers wait for indexing no longer than one publish step,
+// which appends positions of one block and should fit in this budget.
+constexpr auto MaxPublishLockDuration = std::chrono::milliseconds( 2 );
+
+// Amount of data at the end of large files indexed first when following
+constexpr qint64 TailFirstIndexingSize = 64 * 1024 * 1024;
+constexpr qint64 TailFirstMinFileSize = 4 * TailFirstIndexingSize;
+
+// Blocks checked at the end of indexed data when a file grows
+constexpr size_t CheckedTailBlocks = 4;
+
+// Larger appends to a followed file are indexed by the indexing graph
+constexpr qint64 FollowedAppendMaxSize = IndexingBlockSize;
+// End of indexed data read again before each append to see it was not rewritten
+constexpr qint64 FollowedGuardSize = 4 * 1024;
+
+// Blocks sampled across files larger than one indexing block to guess their encoding
+constexpr int EncodingSamplesCount = 8;
+constexpr int EncodingSampleSize = 64 * 1024;
+
+namespace {
+// Buffers of small files indexed without the graph, shared by all of them
+// instead of a block pool for each file
+tbb::concurrent_queue<klogg::vector<char>>& smallFileBuffers()
+{
+    static tbb::concurrent_queue<klogg::vector<char>> buffers;
+    return buffers;
+}
+
+klogg::vector<char> acquireSmallFileBuffer()
+{
+    klogg::vector<char> buffer;
+    smallFileBuffers().try_pop( buffer );
+    return buffer;
+}
+
+void releaseSmallFileBuffer( klogg::vector<char>&& buffer )
+{
+    // No more buffers are kept than files are indexed at once
+    auto& buffers = smallFileBuffers();
+    if ( buffers.unsafe_size() < static_cast<size_t>( TaskScheduler::get().maxConcurrency() ) ) {
+        buffers.push( std::move( buffer ) );
+    }
+}
+
+// Completes blocks after they were parsed and, if the full file digest is used,
+// hashed together with digests of each block. Hashing runs in its own serial node
+// concurrently with parsing, both branches keep file order, so a queueing join pairs them.
+// Trigrams and tokens of blocks are indexed in the same branch after hashing.
+template <typename BlockData, typename ReleaseBlock>
+class BlockCompletion {
+  public:
+    BlockCompletion( tbb::flow::graph& graph, tbb::flow::limiter_node<BlockData>& blockPrefetcher,
+                     FileDigest* fullDigest, BlockDigests* blockDigests,
+                     TrigramIndex* trigramIndex, TokenFilters* tokenFilters,
+                     ReleaseBlock releaseBlock )
+        : isHashed_( fullDigest != nullptr || trigramIndex != nullptr || tokenFilters != nullptr )
+        , hashQueue_( graph )
+        , blockHasher_( graph, tbb::flow::serial,
+                        [ fullDigest, blockDigests ]( const BlockData& blockData ) {
+                            const TraceSpan span( "hash block", "indexing", "offset",
+                                                  blockData.first );
+                            if ( fullDigest && blockData.first >= 0 ) {
+                                const auto& data = blockData.second->data;
+                                fullDigest->addData( data.data(), data.size() );
+                                if ( blockDigests ) {
+                                    blockDigests->addData( data.data(), data.size() );
+                                }
+                            }
+                            return blockData;
+                        } )
+        , trigramIndexer_( graph, tbb::flow::serial,
+                           [ trigramIndex ]( const BlockData& blockData ) {
+                               const TraceSpan span( "index trigrams", "indexing", "offset",
+                                                     blockData.first );
+                               if ( trigramIndex && blockData.first >= 0 ) {
+                                   trigramIndex->addBlock( blockData.first,
+                                                           blockData.second->data );
+                               }
+                               return blockData;
+                           } )
+        , tokenFilterBuilder_( graph, tbb::flow::serial,
+                               [ tokenFilters ]( const BlockData& blockData ) {
+                                   const TraceSpan span( "build token filters", "indexing",
+                                                         "offset", blockData.first );
+                                   if ( tokenFilters && blockData.first >= 0 ) {
+                                       tokenFilters->addBlock( blockData.first,
+                                                               blockData.second->data );
+                                   }
+                                   return blockData;
+                               } )
+        , hashedAndParsed_( graph )
+        , pairCompleter_( graph, tbb::flow::serial,
+                          [ releaseBlock ]( const std::tuple<BlockData, BlockData>& blocks ) {
+                              releaseBlock( std::get<0>( blocks ) );
+                              return tbb::flow::continue_msg{};
+                          } )
+        , parsedCompleter_( graph, tbb::flow::serial,
+                            [ releaseBlock ]( const BlockData& blockData ) {
+                                releaseBlock( blockData );
+                                return tbb::flow::continue_msg{};
+                            } )
+    {
+        if ( isHashed_ ) {
+            tbb::flow::make_edge( blockPrefetcher, hashQueue_ );
+            tbb::flow::make_edge( hashQueue_, blockHasher_ );
+            tbb::flow::make_edge( blockHasher_, trigramIndexer_ );
+            tbb::flow::make_edge( trigramIndexer_, tokenFilterBuilder_ );
+            tbb::flow::make_edge( tokenFilterBuilder_,
+                                  tbb::flow::input_port<1>( hashedAndParsed_ ) );
+            tbb::flow::make_edge( hashedAndParsed_, pairCompleter_ );
+            tbb::flow::make_edge( pairCompleter_, blockPrefetcher.decrementer() );
+        }
+        else {
+            tbb::flow::make_edge( parsedCompleter_, blockPrefetcher.decrementer() );
+        }
+    }
+
+    tbb::flow::receiver<BlockData>& parsedBlocks()
+    {
+        if ( isHashed_ ) {
+            return tbb::flow::input_port<0>( hashedAndParsed_ );
+        }
+        return parsedCompleter_;
+    }
+
+  private:
+    bool isHashed_;
+
+    tbb::flow::queue_node<BlockData> hashQueue_;
+    tbb::flow::function_node<BlockData, BlockData> blockHasher_;
+    tbb::flow::function_node<BlockData, BlockData> trigramIndexer_;
+    tbb::flow::function_node<BlockData, BlockData> tokenFilterBuilder_;
+    tbb::flow::join_node<std::tuple<BlockData, BlockData>, tbb::flow::queueing> hashedAndParsed_;
+    tbb::flow::function_node<std::tuple<BlockData, BlockData>, tbb::flow::continue_msg>
+        pairCompleter_;
+    tbb::flow::function_node<BlockData, tbb::flow::continue_msg> parsedCompleter_;
+};
+
+void adviseSequentialAccess( const char* mapping, qint64 size )
+{
+#ifdef Q_OS_UNIX
+    // QFile::map returns pointer to requested offset, madvise needs page boundary
+    const auto pageSize = static_cast<uintptr_t>( sysconf( _SC_PAGESIZE ) );
+    const auto address = reinterpret_cast<uintptr_t>( mapping );
+    const auto pageStart = address & ~( pageSize - 1 );
+    if ( madvise( reinterpret_cast<void*>( pageStart ),
+                  static_cast<size_t>( size ) + ( address - pageStart ), MADV_SEQUENTIAL )
+         != 0 ) {
+        LOG_DEBUG << "madvise failed: " << errno;
+    }
+#else
+    Q_UNUSED( mapping );
+    Q_UNUSED( size );
+#endif
+}
+
+// Ends of lines terminated in the file data between begin and end
+klogg::vector<OffsetInFile> scanLineEnds( const QString& fileName,
+                                          const std::shared_ptr<const FileChain>& fileChain,
+                                          const EncodingParameters& encodingParams,
+                                          OffsetInFile begin, OffsetInFile end )
+{
+    klogg::vector<OffsetInFile> lineEnds;
+
+    ChainedFile file( fileName, fileChain );
+    if ( !file.open( QIODevice::ReadOnly ) || !file.seek( begin.get() ) ) {
+        LOG_WARNING << "Cannot read lines at " << begin;
+        return lineEnds;
+    }
+
+    const auto data = file.read( end.get() - begin.get() );
+    const auto lines = std::string_view( data.data(), static_cast<size_t>( data.size() ) );
+    const auto afterLineFeed = static_cast<size_t>( encodingParams.getAfterCrOffset() ) + 1;
+
+    size_t searchPos = 0;
+    while ( searchPos < lines.size() ) {
+        const auto nextLineFeed
+            = encodingParams.lineFeedWidth == 1
+                  ? lines.find( '\n', searchPos )
+                  : searchPos
+                        + findWideDelimeter( lines.data() + searchPos, lines.size() - searchPos,
+                                             '\n', encodingParams.lineFeedWidth,
+                                             encodingParams.lineFeedIndex );
+        if ( nextLineFeed >= lines.size() ) {
+            break;
+        }
+
+        searchPos = nextLineFeed + afterLineFeed;
+        lineEnds.push_back( begin + OffsetInFile( static_cast<int64_t>( searchPos ) ) );
+    }
+
+    return lineEnds;
+}
+} // namespace
+
 qint64 IndexingData::getIndexedSize() const
 {
     return hash_.size;
@@ -83,12 +299,60 @@ LineLength IndexingData::getMaxLength() const
 
 LinesCount IndexingData::getNbLines() const
 {
-    return LinesCount( linePosition_.size() );
+    return sparseLinePosition_ ? sparseLinePosition_->size() : LinesCount( linePosition_.size() );
+}
+
+LinePositionArray::Cache* IndexingData::cursorPosition( LineCursor* cursor ) const
+{
+    if ( cursor == nullptr ) {
+        return nullptr;
+    }
+
+    if ( cursor->generation_ != linePositionGeneration_ ) {
+        cursor->lastPosition_ = {};
+        cursor->generation_ = linePositionGeneration_;
+    }
+
+    return &cursor->lastPosition_;
+}
+
+OffsetInFile IndexingData::getEndOfLineOffset( LineNumber line, LineCursor* cursor ) const
+{
+    return sparseLinePosition_ ? sparseLinePosition_->at( line )
+                               : linePosition_.at( line.get(), cursorPosition( cursor ) );
+}
+
+void IndexingData::getEndOfLineOffsets( LineNumber first, LinesCount count, OffsetInFile* out,
+                                        LineCursor* cursor ) const
+{
+    if ( sparseLinePosition_ ) {
+        for ( auto line = first; line < first + count; ++line ) {
+            *out++ = sparseLinePosition_->at( line );
+        }
+    }
+    else {
+        linePosition_.at_range( first, count, out, cursorPosition( cursor ) );
+    }
+}
+
+std::optional<LineLength> IndexingData::getLineLength( LineNumber line ) const
+{
+    return lineLengths_.at( line );
 }
 
-OffsetInFile IndexingData::getEndOfLineOffset( LineNumber line ) const
+FastLineLengthArray IndexingData::getLineLengths( LineNumber first, LinesCount count ) const
 {
-    return linePosition_.at( line.get(), &linePositionCache_.local() );
+    return lineLengths_.range( first, count );
+}
+
+OffsetInFile IndexingData::getFirstLineOffset() const
+{
+    return firstLineOffset_;
+}
+
+uint64_t IndexingData::getLinePositionGeneration() const
+{
+    return linePositionGeneration_;
 }
 
 QTextCodec* IndexingData::getEncodingGuess() const
@@ -111,20 +375,48 @@ QTextCodec* IndexingData::getForcedEncoding() const
     return encodingForced_;
 }
 
-void IndexingData::addAll( const klogg::vector<char>& block, LineLength length,
-                           const FastLinePositionArray& linePosition, QTextCodec* encoding )
+void IndexingData::addAll( std::string_view block, LineLength length,
+                           const FastLinePositionArray& linePosition,
+                           const FastLineLengthArray& lineLengths, QTextCodec* encoding )
 
 {
     maxLength_ = std::max( maxLength_, length );
-    linePosition_.append_list( linePosition );
 
-    if ( !block.empty() ) {
-        hash_.size += klogg::ssize( block );
+    if ( !sparseIndexFileName_.isEmpty() && linePosition_.size().get() == 0 ) {
+        if ( !sparseLinePosition_ ) {
+            const auto* codec = encodingForced_ ? encodingForced_ : encoding;
+            const auto encodingParams = codec ? EncodingParameters( codec ) : EncodingParameters{};
+            sparseLinePosition_ = std::make_unique<SparseLinePositionArray>(
+                [ fileName = sparseIndexFileName_, fileChain = sparseIndexFileChain_,
+                  encodingParams ]( OffsetInFile begin, OffsetInFile end ) {
+                    return scanLineEnds( fileName, fileChain, encodingParams, begin, end );
+                } );
+        }
+
+        sparseLinePosition_->append_list( linePosition );
+    }
+    else {
+        // Lines added without lengths, e.g. restored from cache, are measured from file data
+        const auto nbLines
+            = linePosition_.size().get() - ( linePosition_.hasFakeFinalLF() ? 1 : 0 );
+        if ( lineLengths_.size().get() < nbLines ) {
+            lineLengths_.appendUnknown( LinesCount( nbLines - lineLengths_.size().get() ) );
+        }
+        else {
+            lineLengths_.truncate( LinesCount( nbLines ) );
+        }
 
-        if ( !useFastModificationDetection_ ) {
-            hashBuilder_.addData( block.data(), block.size() );
-            hash_.fullDigest = hashBuilder_.digest();
+        // Line with the fake final LF is replaced
+        if ( linePosition_.hasFakeFinalLF() ) {
+            ++linePositionGeneration_;
         }
+
+        linePosition_.append_list( linePosition );
+        lineLengths_.append_list( lineLengths );
+    }
+
+    if ( !block.empty() ) {
+        hash_.size += klogg::ssize( block );
     }
 
     encodingGuess_ = encoding;
@@ -143,14 +435,24 @@ void IndexingData::setProgress( int progress )
 void IndexingData::clear()
 {
     maxLength_ = 0_length;
+    firstLineOffset_ = 0_offset;
+    partialLineSpaces_ = 0;
+    isInterrupted_ = false;
+    blocksWithTabs_.clear();
     hash_ = {};
     hashBuilder_.reset();
+    blockDigests_.reset();
     linePosition_ = LinePositionArray();
+    lineLengths_ = LineLengthArray();
+    sparseIndexFileName_.clear();
+    sparseLinePosition_.reset();
+    trigramIndex_.reset();
+    tokenFilters_.reset();
     encodingGuess_ = nullptr;
     encodingForced_ = nullptr;
 
     progress_ = {};
-    linePositionCache_.clear();
+    ++linePositionGeneration_;
 
     const auto& config = Configuration::get();
     useFastModificationDetection_ = config.fastModificationDetection();
@@ -158,11 +460,282 @@ void IndexingData::clear()
 
 size_t IndexingData::allocatedSize() const
 {
-    return linePosition_.allocatedSize();
+    return linePosition_.allocatedSize() + lineLengths_.allocatedSize()
+           + ( sparseLinePosition_ ? sparseLinePosition_->allocatedSize() : 0 );
+}
+
+bool IndexingData::hasFakeFinalLF() const
+{
+    return sparseLinePosition_ ? sparseLinePosition_->hasFakeFinalLF()
+                               : linePosition_.hasFakeFinalLF();
+}
+
+bool IndexingData::isFastModificationDetectionUsed() const
+{
+    return useFastModificationDetection_;
+}
+
+QByteArray IndexingData::getHashBuilderState() const
+{
+    return hashBuilder_.state();
+}
+
+void IndexingData::setHashBuilderState( const QByteArray& state )
+{
+    if ( hashBuilder_.restoreState( state ) ) {
+        hash_.fullDigest = hashBuilder_.digest();
+    }
+}
+
+BlockDigests IndexingData::getBlockDigests() const
+{
+    return blockDigests_;
+}
+
+void IndexingData::setBlockDigests( const BlockDigests& blockDigests )
+{
+    blockDigests_ = blockDigests;
+}
+
+bool IndexingData::restore( LinePositionArray&& linePosition, LineLength maxLength,
+                            const IndexedHash& hash, const QByteArray& hashBuilderState,
+                            QTextCodec* encodingGuess )
+{
+    if ( !hashBuilder_.restoreState( hashBuilderState ) ) {
+        return false;
+    }
+
+    linePosition_ = std::move( linePosition );
+    ++linePositionGeneration_;
+    lineLengths_ = LineLengthArray();
+    sparseIndexFileName_.clear();
+    sparseLinePosition_.reset();
+    trigramIndex_.reset();
+    tokenFilters_.reset();
+    maxLength_ = maxLength;
+    blocksWithTabs_.clear();
+    hash_ = hash;
+    encodingGuess_ = encodingGuess;
+    return true;
+}
+
+IndexingCheckpoint IndexingData::getCheckpoint() const
+{
+    IndexingCheckpoint checkpoint;
+    checkpoint.additionalSpaces = partialLineSpaces_;
+    checkpoint.isInterrupted = isInterrupted_;
+
+    // Fake final line feed ends the line that is still not terminated
+    const auto nbLines = getNbLines().get();
+    const auto terminatedLines = hasFakeFinalLF() ? nbLines - 1 : nbLines;
+    checkpoint.lineStart = terminatedLines > 0
+                               ? getEndOfLineOffset( LineNumber( terminatedLines - 1 ) ).get()
+                               : firstLineOffset_.get();
+
+    return checkpoint;
+}
+
+void IndexingData::setCheckpoint( LineLength::UnderlyingType additionalSpaces,
+                                  bool isInterrupted )
+{
+    partialLineSpaces_ = additionalSpaces;
+    isInterrupted_ = isInterrupted;
+}
+
+void IndexingData::startIndexAt( OffsetInFile firstLineOffset )
+{
+    firstLineOffset_ = firstLineOffset;
+    hash_.size = firstLineOffset.get();
+}
+
+void IndexingData::prependIndex( IndexingData& prefix, const QByteArray& hashBuilderState,
+                                 const BlockDigests& blockDigests )
+{
+    constexpr LinesCount::UnderlyingType LinesPerChunk = 64 * 1024;
+
+    LinePositionArray linePosition = std::move( prefix.linePosition_ );
+    LineLengthArray lineLengths = std::move( prefix.lineLengths_ );
+    const auto prefixLines
+        = linePosition.size().get() - ( linePosition.hasFakeFinalLF() ? 1 : 0 );
+    if ( lineLengths.size().get() < prefixLines ) {
+        lineLengths.appendUnknown( LinesCount( prefixLines - lineLengths.size().get() ) );
+    }
+
+    const auto nbLines = linePosition_.size().get();
+    LinePositionArray::Cache cache;
+    for ( LinesCount::UnderlyingType chunkBegin = 0; chunkBegin < nbLines;
+          chunkBegin += LinesPerChunk ) {
+        const auto chunkEnd = std::min( chunkBegin + LinesPerChunk, nbLines );
+
+        FastLinePositionArray chunk;
+        FastLineLengthArray lengthsChunk;
+        for ( auto line = chunkBegin; line < chunkEnd; ++line ) {
+            chunk.append( linePosition_.at( line, &cache ) );
+            if ( line < lineLengths_.size().get() ) {
+                lengthsChunk.append( lineLengths_.at( LineNumber( line ) ) );
+            }
+        }
+
+        if ( chunkEnd == nbLines ) {
+            chunk.setFakeFinalLF( linePosition_.hasFakeFinalLF() );
+        }
+
+        linePosition.append_list( chunk );
+        lineLengths.append_list( lengthsChunk );
+    }
+
+    linePosition_ = std::move( linePosition );
+    ++linePositionGeneration_;
+    lineLengths_ = std::move( lineLengths );
+
+    maxLength_ = std::max( maxLength_, prefix.maxLength_ );
+    firstLineOffset_ = 0_offset;
+
+    blocksWithTabs_.insert( blocksWithTabs_.begin(), prefix.blocksWithTabs_.begin(),
+                            prefix.blocksWithTabs_.end() );
+
+    // Trigrams of the tail follow the ones of the prefix, prefix index is not shared
+    if ( prefix.trigramIndex_ && trigramIndex_ ) {
+        prefix.trigramIndex_->append( *trigramIndex_ );
+        trigramIndex_ = std::move( prefix.trigramIndex_ );
+    }
+    else {
+        trigramIndex_.reset();
+    }
+    if ( prefix.tokenFilters_ && tokenFilters_ ) {
+        prefix.tokenFilters_->append( *tokenFilters_ );
+        tokenFilters_ = std::move( prefix.tokenFilters_ );
+    }
+    else {
+        tokenFilters_.reset();
+    }
+
+    if ( hashBuilder_.restoreState( hashBuilderState ) ) {
+        hash_.fullDigest = hashBuilder_.digest();
+    }
+    blockDigests_ = blockDigests;
+}
+
+void IndexingData::truncateIndex( LinesCount nbLines, const QByteArray& hashBuilderState,
+                                  const BlockDigests& blockDigests )
+{
+    linePosition_.truncate( nbLines );
+    ++linePositionGeneration_;
+    lineLengths_.truncate( nbLines );
+    if ( sparseLinePosition_ ) {
+        sparseLinePosition_->truncate( nbLines );
+    }
+
+    // Max length is kept, it can't be found without parsing kept lines again.
+    // Trigrams and tokens of dropped data can't be removed, so they are built again.
+    trigramIndex_.reset();
+    tokenFilters_.reset();
+    hash_.size
+        = nbLines.get() > 0 ? getEndOfLineOffset( LineNumber( nbLines.get() - 1 ) ).get() : 0;
+    partialLineSpaces_ = 0;
+    isInterrupted_ = false;
+
+    blocksWithTabs_.erase( std::remove_if( blocksWithTabs_.begin(), blocksWithTabs_.end(),
+                                           [ this ]( OffsetInFile::UnderlyingType block ) {
+                                               return block >= hash_.size;
+                                           } ),
+                           blocksWithTabs_.end() );
+
+    if ( hashBuilder_.restoreState( hashBuilderState ) ) {
+        hash_.fullDigest = hashBuilder_.digest();
+    }
+    blockDigests_ = blockDigests;
+}
+
+void IndexingData::replaceIndex( IndexingData& other )
+{
+    linePosition_ = std::move( other.linePosition_ );
+    ++linePositionGeneration_;
+    lineLengths_ = std::move( other.lineLengths_ );
+    sparseIndexFileName_ = other.sparseIndexFileName_;
+    sparseLinePosition_ = std::move( other.sparseLinePosition_ );
+
+    maxLength_ = other.maxLength_;
+    firstLineOffset_ = other.firstLineOffset_;
+    partialLineSpaces_ = other.partialLineSpaces_;
+    isInterrupted_ = other.isInterrupted_;
+    blocksWithTabs_ = std::move( other.blocksWithTabs_ );
+    progress_ = other.progress_;
+
+    hashBuilder_.restoreState( other.hashBuilder_.state() );
+    blockDigests_ = other.blockDigests_;
+    hash_ = other.hash_;
+    trigramIndex_ = std::move( other.trigramIndex_ );
+    tokenFilters_ = std::move( other.tokenFilters_ );
+
+    encodingGuess_ = other.encodingGuess_;
+    encodingForced_ = other.encodingForced_;
+
+    useFastModificationDetection_ = other.useFastModificationDetection_;
+}
+
+void IndexingData::selectLinePositionStorage( qint64 fileSize )
+{
+    if ( linePosition_.size().get() > 0 ) {
+        return;
+    }
+
+    linePosition_ = LinePositionArray( AdaptiveLinePositionStorage::forFileSize( fileSize ) );
+    ++linePositionGeneration_;
+
+    LOG_INFO << "Using " << ( linePosition_.storage().isShort() ? "flat" : "compressed" )
+             << " line positions";
+}
+
+void IndexingData::enableSparseIndex( const QString& fileName,
+                                      const std::shared_ptr<const FileChain>& fileChain )
+{
+    sparseIndexFileName_ = fileName;
+    sparseIndexFileChain_ = fileChain;
 }
 
-LogDataWorker::LogDataWorker( const std::shared_ptr<IndexingData>& indexing_data )
+void IndexingData::addBlockWithTabs( OffsetInFile::UnderlyingType blockBeginning )
+{
+    blocksWithTabs_.push_back( blockBeginning );
+}
+
+klogg::vector<OffsetInFile::UnderlyingType> IndexingData::takeBlocksWithTabs()
+{
+    return std::exchange( blocksWithTabs_, {} );
+}
+
+void IndexingData::extendMaxLength( LineLength length )
+{
+    maxLength_ = std::max( maxLength_, length );
+}
+
+std::shared_ptr<TrigramIndex> IndexingData::getTrigramIndex() const
+{
+    return trigramIndex_;
+}
+
+void IndexingData::setTrigramIndex( std::shared_ptr<TrigramIndex> trigramIndex )
+{
+    trigramIndex_ = std::move( trigramIndex );
+}
+
+std::shared_ptr<TokenFilters> IndexingData::getTokenFilters() const
+{
+    return tokenFilters_;
+}
+
+void IndexingData::setTokenFilters( std::shared_ptr<TokenFilters> tokenFilters )
+{
+    tokenFilters_ = std::move( tokenFilters );
+}
+
+LogDataWorker::LogDataWorker( const std::shared_ptr<IndexingData>& indexing_data,
+                              const std::atomic<TaskPriority>& taskPriority, int numaNode,
+                              OperationProgress& progress )
     : indexing_data_( indexing_data )
+    , taskPriority_( taskPriority )
+    , numaNode_( numaNode )
+    , progress_( progress )
 {
     operationsPool_.setMaxThreadCount( 1 );
 }
@@ -179,30 +752,36 @@ LogDataWorker::~LogDataWorker() noexcept
     }
 }
 
-void LogDataWorker::attachFile( const QString& fileName )
+void LogDataWorker::attachFile( const QString& fileName,
+                                const std::shared_ptr<const FileChain>& fileChain )
 {
     ScopedLock locker( operationsMutex_ );
     interruptRequest_.clear();
     fileName_ = fileName;
+    fileChain_ = fileChain;
+    followedFile_.reset();
 }
 
-void LogDataWorker::indexAll( QTextCodec* forcedEncoding )
+void LogDataWorker::indexAll( QTextCodec* forcedEncoding, bool keepCurrentIndex )
 {
     ScopedLock locker( operationsMutex_ );
     operationsPool_.waitForDone();
     interruptRequest_.clear();
+    followedFile_.reset();
 
     LOG_INFO << "FullIndex requested, forced encoding: "
              << ( forcedEncoding != nullptr ? forcedEncoding->name().toStdString()
                                             : std::string{ "none" } );
     QSemaphore operationStarted;
     operationsPool_.start(
-        createRunnable( [ this, &operationStarted, forcedEncoding, fileName = fileName_ ] {
+        createRunnable( [ this, &operationStarted, forcedEncoding, keepCurrentIndex,
+                          fileName = fileName_ ] {
             LOG_INFO << "FullIndex thread started";
             operationStarted.release();
             ScopedLock operationLock( operationsMutex_ );
             auto operationRequested = std::make_unique<FullIndexOperation>(
-                fileName, indexing_data_, interruptRequest_, forcedEncoding );
+                fileName, fileChain_, indexing_data_, interruptRequest_, forcedEncoding,
+                keepCurrentIndex );
             return connectSignalsAndRun( operationRequested.get() );
         } ) );
     operationStarted.acquire();
@@ -222,8 +801,49 @@ void LogDataWorker::indexAdditionalLines()
         LOG_INFO << "PartialIndex thread started";
         operationStarted.release();
         ScopedLock operationLock( operationsMutex_ );
-        auto operationRequested = std::make_unique<PartialIndexOperation>( fileName, indexing_data_,
-                                                                           interruptRequest_ );
+        auto operationRequested = std::make_unique<PartialIndexOperation>(
+            fileName, fileChain_, indexing_data_, interruptRequest_ );
+        return connectSignalsAndRun( operationRequested.get() );
+    } ) );
+    operationStarted.acquire();
+}
+
+void LogDataWorker::indexModifiedLines()
+{
+    ScopedLock locker( operationsMutex_ );
+    operationsPool_.waitForDone();
+    interruptRequest_.clear();
+    followedFile_.reset();
+
+    LOG_INFO << "DifferentialIndex requested";
+
+    QSemaphore operationStarted;
+    operationsPool_.start( createRunnable( [ this, &operationStarted, fileName = fileName_ ] {
+        QThread::currentThread()->setObjectName( "DifferentialIndex" );
+        LOG_INFO << "DifferentialIndex thread started";
+        operationStarted.release();
+        ScopedLock operationLock( operationsMutex_ );
+        auto operationRequested = std::make_unique<DifferentialIndexOperation>(
+            fileName, fileChain_, indexing_data_, interruptRequest_ );
+        return connectSignalsAndRun( operationRequested.get() );
+    } ) );
+    operationStarted.acquire();
+}
+
+void LogDataWorker::indexAppendedData()
+{
+    ScopedLock locker( operationsMutex_ );
+    operationsPool_.waitForDone();
+    interruptRequest_.clear();
+
+    LOG_DEBUG << "AppendIndex requested";
+
+    QSemaphore operationStarted;
+    operationsPool_.start( createRunnable( [ this, &operationStarted, fileName = fileName_ ] {
+        operationStarted.release();
+        ScopedLock operationLock( operationsMutex_ );
+        auto operationRequested = std::make_unique<AppendIndexOperation>(
+            fileName, fileChain_, indexing_data_, interruptRequest_, followedFile_ );
         return connectSignalsAndRun( operationRequested.get() );
     } ) );
     operationStarted.acquire();
@@ -234,6 +854,8 @@ void LogDataWorker::checkFileChanges()
     ScopedLock locker( operationsMutex_ );
     operationsPool_.waitForDone();
     interruptRequest_.clear();
+    // Files may have been chained since the followed file was opened
+    followedFile_.reset();
 
     LOG_INFO << "Check file changes requested";
 
@@ -242,7 +864,7 @@ void LogDataWorker::checkFileChanges()
         operationStarted.release();
         ScopedLock operationLock( operationsMutex_ );
         auto operationRequested = std::make_unique<CheckFileChangesOperation>(
-            fileName, indexing_data_, interruptRequest_ );
+            fileName, fileChain_, indexing_data_, interruptRequest_ );
 
         return connectSignalsAndRun( operationRequested.get() );
     } ) );
@@ -251,16 +873,26 @@ void LogDataWorker::checkFileChanges()
 
 OperationResult LogDataWorker::connectSignalsAndRun( IndexOperation* operationRequested )
 {
+    operationRequested->setProgress( &progress_ );
+
     connect( operationRequested, &IndexOperation::indexingProgressed, this,
              &LogDataWorker::indexingProgressed );
 
+    connect( operationRequested, &IndexOperation::indexingPreviewReady, this,
+             &LogDataWorker::indexingPreviewReady );
+
+    connect( operationRequested, &IndexOperation::indexTruncated, this,
+             &LogDataWorker::indexTruncated );
+
     connect( operationRequested, &IndexOperation::indexingFinished, this,
              &LogDataWorker::onIndexingFinished );
 
     connect( operationRequested, &IndexOperation::fileCheckFinished, this,
              &LogDataWorker::onCheckFileFinished );
 
-    auto result = operationRequested->run();
+    auto result = TaskScheduler::get().execute(
+        taskPriority_.load(), numaNode_,
+        [ operationRequested ] { return operationRequested->run(); } );
 
     operationRequested->disconnect( this );
 
@@ -296,170 +928,295 @@ void LogDataWorker::onCheckFileFinished( const MonitoredFileStatus result )
 //
 namespace parse_data_block {
 
+// Data must start at a code unit boundary
 std::string_view::size_type findNextMultiByteDelimeter( EncodingParameters encodingParams,
                                                         std::string_view data, char delimeter )
 {
-    auto nextDelimeter = data.find( delimeter );
+    const auto nextDelimeter
+        = findWideDelimeter( data.data(), data.size(), delimeter, encodingParams.lineFeedWidth,
+                             encodingParams.lineFeedIndex );
 
-    if ( nextDelimeter == std::string_view::npos ) {
-        return nextDelimeter;
-    }
+    return nextDelimeter < data.size() ? nextDelimeter : std::string_view::npos;
+}
 
-    const auto isNotDelimeter = [ &encodingParams, data ]( std::string_view::size_type checkPos ) {
-        const auto lineFeedWidth
-            = static_cast<std::string_view::size_type>( encodingParams.lineFeedWidth );
+std::string_view::size_type findNextSingleByteDelimeter( EncodingParameters, std::string_view data,
+                                                         char delimeter )
+{
+    return data.find( delimeter );
+}
 
-        const auto isCheckForward = encodingParams.lineFeedIndex == 0;
+using FindDelimeter = std::string_view::size_type ( * )( EncodingParameters encodingParams,
+                                                         std::string_view, char );
 
-        if ( isCheckForward && checkPos + lineFeedWidth > data.size() ) {
-            return true;
-        }
-        else if ( !isCheckForward && checkPos < lineFeedWidth - 1 ) {
-            return true;
+// Width of code units and position of the line feed byte in its unit.
+// Block parser is instantiated for each layout, so delimeter search
+// and offsets within blocks are resolved at compile time.
+template <int Width, int LineFeedIndex>
+struct CodeUnitLayout {
+    static constexpr int width = Width;
+    static constexpr int beforeCrOffset = LineFeedIndex;
+    static constexpr int afterCrOffset = Width - LineFeedIndex - 1;
+
+    // Data must start at a code unit boundary
+    static std::string_view::size_type findDelimeter( std::string_view data, char delimeter )
+    {
+        if constexpr ( Width == 1 ) {
+            return data.find( delimeter );
         }
-
-        for ( auto i = 1u; i < lineFeedWidth; ++i ) {
-            const auto nextByte = isCheckForward ? data[ checkPos + i ] : data[ checkPos - i ];
-            if ( nextByte != '\0' ) {
-                return true;
-            }
+        else {
+            const auto nextDelimeter
+                = findWideDelimeter( data.data(), data.size(), delimeter, Width, LineFeedIndex );
+            return nextDelimeter < data.size() ? nextDelimeter : std::string_view::npos;
         }
-
-        return false;
-    };
-
-    while ( nextDelimeter != std::string_view::npos && isNotDelimeter( nextDelimeter ) ) {
-        nextDelimeter = data.find( delimeter, nextDelimeter + 1 );
     }
+};
 
-    return nextDelimeter;
-}
-
-std::string_view::size_type findNextSingleByteDelimeter( EncodingParameters, std::string_view data,
-                                                         char delimeter )
+// Calls parse with the code unit layout of the encoding,
+// encodings with other layouts are parsed as single byte ones.
+template <typename Parse>
+auto withCodeUnitLayout( const EncodingParameters& encodingParams, Parse&& parse )
 {
-    return data.find( delimeter );
+    const auto isLineFeedFirst = encodingParams.lineFeedIndex == 0;
+    switch ( encodingParams.lineFeedWidth ) {
+    case 2:
+        return isLineFeedFirst ? parse( CodeUnitLayout<2, 0>{} ) : parse( CodeUnitLayout<2, 1>{} );
+    case 4:
+        return isLineFeedFirst ? parse( CodeUnitLayout<4, 0>{} ) : parse( CodeUnitLayout<4, 3>{} );
+    default:
+        return parse( CodeUnitLayout<1, 0>{} );
+    }
 }
 
-int charOffsetWithinBlock( const char* blockStart, const char* pointer,
-                           const EncodingParameters& encodingParams )
+template <typename Layout>
+int charOffsetWithinBlock( const char* blockStart, const char* pointer )
 {
     return type_safe::narrow_cast<int>( std::distance( blockStart, pointer ) )
-           - encodingParams.getBeforeCrOffset();
+           - Layout::beforeCrOffset;
 }
 
-using FindDelimeter = std::string_view::size_type ( * )( EncodingParameters encodingParams,
-                                                         std::string_view, char );
+LineLength::UnderlyingType expandTab( int tabPosWithinBlock, int posWithinBlock,
+                                      LineLength::UnderlyingType additionalSpaces )
+{
+    const auto currentExpandedSize = tabPosWithinBlock - posWithinBlock + additionalSpaces;
+    return additionalSpaces + TabStop - ( currentExpandedSize % TabStop ) - 1;
+}
 
+template <typename Layout>
 LineLength::UnderlyingType
-expandTabsInLine( const klogg::vector<char>& block, std::string_view blockToExpand,
-                  int posWithinBlock, EncodingParameters encodingParams,
-                  FindDelimeter findNextDelimeter,
+expandTabsInLine( std::string_view block, std::string_view blockToExpand, int posWithinBlock,
                   LineLength::UnderlyingType initialAdditionalSpaces = 0 )
 {
     auto additionalSpaces = initialAdditionalSpaces;
     while ( !blockToExpand.empty() ) {
-        const auto nextTab = findNextDelimeter( encodingParams, blockToExpand, '\t' );
+        const auto nextTab = Layout::findDelimeter( blockToExpand, '\t' );
         if ( nextTab == std::string_view::npos ) {
             break;
         }
 
         const auto tabPosWithinBlock
-            = charOffsetWithinBlock( block.data(), blockToExpand.data() + nextTab, encodingParams );
-
-        LOG_DEBUG << "Tab at " << tabPosWithinBlock;
+            = charOffsetWithinBlock<Layout>( block.data(), blockToExpand.data() + nextTab );
 
-        const auto currentExpandedSize = tabPosWithinBlock - posWithinBlock + additionalSpaces;
+        LOG_TRACE << "Tab at " << tabPosWithinBlock;
 
-        additionalSpaces += TabStop - ( currentExpandedSize % TabStop ) - 1;
-        if ( nextTab >= blockToExpand.size() ) {
+        additionalSpaces = expandTab( tabPosWithinBlock, posWithinBlock, additionalSpaces );
+        // Continue from the next code unit
+        const auto nextUnit = nextTab + 1 + static_cast<size_t>( Layout::afterCrOffset );
+        if ( nextUnit >= blockToExpand.size() ) {
             break;
         }
 
-        blockToExpand.remove_prefix( nextTab + 1 );
+        blockToExpand.remove_prefix( nextUnit );
     }
 
     return additionalSpaces;
 }
 
+template <typename Layout>
 std::tuple<bool, int, LineLength::UnderlyingType>
-findNextLineFeed( const klogg::vector<char>& block, int posWithinBlock, const IndexingState& state,
-                  FindDelimeter findNextDelimeter )
+findNextLineFeed( std::string_view block, int posWithinBlock, const IndexingState& state )
 {
     const auto searchStart = block.data() + posWithinBlock;
     const auto searchLineSize = static_cast<size_t>( klogg::ssize( block ) - posWithinBlock );
 
     const auto blockView = std::string_view( searchStart, searchLineSize );
-    const auto nextLineFeed = findNextDelimeter( state.encodingParams, blockView, '\n' );
+    const auto nextLineFeed = Layout::findDelimeter( blockView, '\n' );
 
     const auto isEndOfBlock = nextLineFeed == std::string_view::npos;
     const auto nextLineSize = !isEndOfBlock ? nextLineFeed : searchLineSize;
 
-    posWithinBlock
-        = charOffsetWithinBlock( block.data(), searchStart + nextLineSize, state.encodingParams );
+    posWithinBlock = charOffsetWithinBlock<Layout>( block.data(), searchStart + nextLineSize );
 
-    const auto additionalSpaces
-        = expandTabsInLine( block, blockView.substr( 0, nextLineSize ), posWithinBlock,
-                            state.encodingParams, findNextDelimeter, state.additional_spaces );
+    if ( !state.expand_tabs ) {
+        return std::make_tuple( isEndOfBlock, posWithinBlock, state.additional_spaces );
+    }
+
+    const auto additionalSpaces = expandTabsInLine<Layout>(
+        block, blockView.substr( 0, nextLineSize ), posWithinBlock, state.additional_spaces );
 
     return std::make_tuple( isEndOfBlock, posWithinBlock, additionalSpaces );
 }
-} // namespace parse_data_block
 
-FastLinePositionArray IndexOperation::parseDataBlock( OffsetInFile::UnderlyingType blockBeginning,
-                                                      const klogg::vector<char>& block,
-                                                      IndexingState& state ) const
+// Same as above, but uses line feed and tab positions precomputed for single byte encodings
+std::tuple<bool, int, LineLength::UnderlyingType>
+findNextLineFeed( const DelimeterMasks& masks, int posWithinBlock, const IndexingState& state )
 {
-    using namespace parse_data_block;
+    const auto searchStart = static_cast<size_t>( posWithinBlock );
+    const auto nextLineFeed = masks.nextLineFeed( searchStart );
 
-    FindDelimeter findNextDelimeter;
-    if ( state.encodingParams.lineFeedWidth == 1 ) {
-        findNextDelimeter = findNextSingleByteDelimeter;
-    }
-    else {
-        findNextDelimeter = findNextMultiByteDelimeter;
+    const auto isEndOfBlock = nextLineFeed == masks.size();
+
+    posWithinBlock = type_safe::narrow_cast<int>( nextLineFeed );
+
+    auto additionalSpaces = state.additional_spaces;
+    if ( !state.expand_tabs ) {
+        return std::make_tuple( isEndOfBlock, posWithinBlock, additionalSpaces );
     }
 
-    bool isEndOfBlock = false;
-    FastLinePositionArray linePositions;
+    masks.forEachTab( searchStart, nextLineFeed, [ & ]( size_t tabPos ) {
+        additionalSpaces = expandTab( type_safe::narrow_cast<int>( tabPos ), posWithinBlock,
+                                      additionalSpaces );
+    } );
 
-    while ( !isEndOfBlock ) {
-        if ( state.pos > blockBeginning + klogg::ssize( block ) ) {
-            LOG_ERROR << "Trying to parse out of block: " << state.pos << " " << blockBeginning
-                      << " " << block.size();
-            break;
-        }
+    return std::make_tuple( isEndOfBlock, posWithinBlock, additionalSpaces );
+}
 
-        auto posWithinBlock
-            = type_safe::narrow_cast<int>( state.pos >= blockBeginning ? ( state.pos - blockBeginning ) : 0 );
+// Returns length of the line in [lineStart, lineEnd) of the block as it is displayed,
+// if all characters of the line are ASCII and so the length is the same in any
+// UTF-8 compatible encoding. Carriage return before the line feed is not displayed.
+std::optional<LineLength> asciiLineLength( std::string_view block, const DelimeterMasks& masks,
+                                           int lineStart, int lineEnd, bool expandTabs )
+{
+    const auto from = static_cast<size_t>( lineStart );
+    const auto to = static_cast<size_t>( lineEnd );
 
-        isEndOfBlock = posWithinBlock == klogg::ssize( block );
+    if ( masks.hasNonAscii( from, to ) ) {
+        return std::nullopt;
+    }
 
-        if ( !isEndOfBlock ) {
-            std::tie( isEndOfBlock, posWithinBlock, state.additional_spaces )
-                = findNextLineFeed( block, posWithinBlock, state, findNextDelimeter );
-        }
+    auto length = static_cast<LineLength::UnderlyingType>( to - from );
+    if ( length > 0 && block[ to - 1 ] == '\r' ) {
+        --length;
+    }
 
-        const auto currentDataEnd = posWithinBlock + blockBeginning;
+    if ( !masks.hasTab( from, to ) ) {
+        return LineLength( length );
+    }
+    else if ( !expandTabs ) {
+        return std::nullopt;
+    }
 
-        const auto length = type_safe::narrow_cast<LineLength::UnderlyingType>( currentDataEnd - state.pos ) / state.encodingParams.lineFeedWidth
-                            + state.additional_spaces;
+    LineLength::UnderlyingType addedSpaces = 0;
+    masks.forEachTab( from, to, [ from, &addedSpaces ]( size_t tabPos ) {
+        addedSpaces += untabifiedTabSpaces(
+            static_cast<LineLength::UnderlyingType>( tabPos - from ), addedSpaces );
+    } );
 
-        state.max_length = std::max( state.max_length, length );
+    return LineLength( length + addedSpaces );
+}
 
-        if ( !isEndOfBlock ) {
-            state.end = currentDataEnd;
-            state.pos = state.end + state.encodingParams.lineFeedWidth;
-            state.additional_spaces = 0;
-            linePositions.append( OffsetInFile( state.pos ) );
-        }
+FindDelimeter delimeterFinder( const EncodingParameters& encodingParams )
+{
+    if ( encodingParams.lineFeedWidth == 1 ) {
+        return findNextSingleByteDelimeter;
+    }
+    else {
+        return findNextMultiByteDelimeter;
+    }
+}
+
+// Parses one line starting at state.pos, returns true if
+// the end of block was reached before the line feed.
+// If masks are passed for single byte encodings they are used instead of searching the block.
+template <typename Layout>
+bool parseNextLine( OffsetInFile::UnderlyingType blockBeginning, std::string_view block,
+                    IndexingState& state, ParsedLines& lines,
+                    const DelimeterMasks* masks = nullptr )
+{
+    if constexpr ( Layout::width != 1 ) {
+        masks = nullptr;
+    }
+
+    if ( state.pos > blockBeginning + klogg::ssize( block ) ) {
+        LOG_ERROR << "Trying to parse out of block: " << state.pos << " " << blockBeginning << " "
+                  << block.size();
+        return true;
+    }
+
+    const auto isLineInBlock = state.pos >= blockBeginning;
+    auto posWithinBlock
+        = type_safe::narrow_cast<int>( isLineInBlock ? ( state.pos - blockBeginning ) : 0 );
+    const auto lineStartWithinBlock = posWithinBlock;
+
+    auto isEndOfBlock = posWithinBlock == klogg::ssize( block );
+
+    if ( !isEndOfBlock ) {
+        std::tie( isEndOfBlock, posWithinBlock, state.additional_spaces )
+            = masks != nullptr ? findNextLineFeed( *masks, posWithinBlock, state )
+                               : findNextLineFeed<Layout>( block, posWithinBlock, state );
+    }
+
+    const auto currentDataEnd = posWithinBlock + blockBeginning;
+
+    const auto length = type_safe::narrow_cast<LineLength::UnderlyingType>( currentDataEnd
+                                                                            - state.pos )
+                            / Layout::width
+                        + state.additional_spaces;
+
+    state.max_length = std::max( state.max_length, length );
+
+    if ( !isEndOfBlock ) {
+        state.end = currentDataEnd;
+        state.pos = state.end + Layout::width;
+        state.additional_spaces = 0;
+        lines.positions.append( OffsetInFile( state.pos ) );
+
+        // Lines split between blocks are measured from file data
+        const auto isMeasured
+            = masks != nullptr && isLineInBlock && state.encodingParams.isUtf8Compatible;
+        lines.lengths.append( isMeasured ? asciiLineLength( block, *masks, lineStartWithinBlock,
+                                                            posWithinBlock, state.expand_tabs )
+                                         : std::nullopt );
     }
 
-    return linePositions;
+    return isEndOfBlock;
 }
 
-void IndexOperation::guessEncoding( const klogg::vector<char>& block,
-                                    IndexingData::MutateAccessor& scopedAccessor,
+template <typename Layout>
+ParsedLines parseLines( OffsetInFile::UnderlyingType blockBeginning, std::string_view block,
+                        IndexingState& state )
+{
+    // Single byte encodings get line feeds and tabs for the whole block in one pass,
+    // mask buffers are reused between blocks parsed by the same thread.
+    const DelimeterMasks* masks = nullptr;
+    if constexpr ( Layout::width == 1 ) {
+        thread_local DelimeterMasks delimeterMasks;
+        delimeterMasks.scan( block.data(), block.size() );
+        masks = &delimeterMasks;
+    }
+
+    bool isEndOfBlock = false;
+    ParsedLines lines;
+
+    while ( !isEndOfBlock ) {
+        isEndOfBlock = parseNextLine<Layout>( blockBeginning, block, state, lines, masks );
+    }
+
+    return lines;
+}
+} // namespace parse_data_block
+
+ParsedLines IndexOperation::parseDataBlock( OffsetInFile::UnderlyingType blockBeginning,
+                                            std::string_view block, IndexingState& state )
+{
+    using namespace parse_data_block;
+
+    return withCodeUnitLayout( state.encodingParams, [ & ]( auto layout ) {
+        return parseLines<decltype( layout )>( blockBeginning, block, state );
+    } );
+}
+
+template <typename Accessor>
+void IndexOperation::guessEncoding( std::string_view block, Accessor& scopedAccessor,
                                     IndexingState& state ) const
 {
     if ( !state.encodingGuess ) {
@@ -485,7 +1242,50 @@ void IndexOperation::guessEncoding( const klogg::vector<char>& block,
               << state.encodingParams.lineFeedWidth;
 }
 
-std::chrono::microseconds IndexOperation::readFileInBlocks( QFile& file,
+IndexOperation::BlockContentPool::~BlockContentPool()
+{
+    BlockContent* content = nullptr;
+    while ( freeBlocks_.try_pop( content ) ) {
+        delete content;
+    }
+}
+
+void IndexOperation::BlockContentPool::setCapacity( size_t capacity )
+{
+    capacity_ = capacity;
+}
+
+IndexOperation::BlockContent* IndexOperation::BlockContentPool::acquire()
+{
+    BlockContent* content = nullptr;
+    if ( freeBlocks_.try_pop( content ) ) {
+        --freeBlocksCount_;
+        return content;
+    }
+
+    return new BlockContent;
+}
+
+void IndexOperation::BlockContentPool::release( BlockContent* content )
+{
+    if ( freeBlocksCount_.load() >= capacity_ ) {
+        delete content;
+        return;
+    }
+
+    // Buffer is kept as is, reader resizes it only for the last short block
+    content->data = {};
+
+    ++freeBlocksCount_;
+    freeBlocks_.push( content );
+}
+
+qint64 IndexOperation::indexingEndPosition( const ChainedFile& file ) const
+{
+    return indexingEnd_ >= 0 ? std::min( indexingEnd_, file.size() ) : file.size();
+}
+
+std::chrono::microseconds IndexOperation::readFileInBlocks( ChainedFile& file,
                                                             BlockPrefetcher& blockPrefetcher )
 {
     using namespace std::chrono;
@@ -494,161 +1294,843 @@ std::chrono::microseconds IndexOperation::readFileInBlocks( QFile& file,
     LOG_INFO << "Starting IO thread";
 
     microseconds ioDuration{};
-    while ( !file.atEnd() ) {
+    const auto isMapped = readMappedFileInBlocks( file, blockPrefetcher, ioDuration );
+    if ( !isMapped ) {
+        readFileInQueue( file, blockPrefetcher, ioDuration );
+    }
+
+    // Data appended while reading in the queue and files that can't be read in the queue
+    // are read one block after another
+    while ( !isMapped && !file.atEnd() ) {
 
         if ( interruptRequest_ ) {
             break;
         }
 
-        BlockData blockData{ file.pos(), new klogg::vector<char>( IndexingBlockSize ) };
+        auto blockSize = qint64{ IndexingBlockSize };
+        if ( indexingEnd_ >= 0 ) {
+            blockSize = std::min( blockSize, indexingEnd_ - file.pos() );
+            if ( blockSize <= 0 ) {
+                break;
+            }
+        }
+
+        BlockData blockData{ file.pos(), blockContentPool_.acquire() };
+        auto& buffer = blockData.second->buffer;
+        buffer.resize( static_cast<size_t>( blockSize ) );
 
         clock::time_point ioT1 = clock::now();
-        const auto readBytes
-            = file.read( blockData.second->data(), klogg::ssize( *blockData.second ) );
+        qint64 readBytes = 0;
+        {
+            const TraceSpan span( "read block", "indexing", "offset", blockData.first );
+            readBytes = file.read( buffer.data(), klogg::ssize( buffer ) );
+        }
 
         if ( readBytes < 0 ) {
             LOG_ERROR << "Reading past the end of file";
+            blockContentPool_.release( blockData.second );
             break;
         }
 
-        if ( readBytes < klogg::ssize( *blockData.second ) ) {
-            blockData.second->resize( static_cast<size_t>( readBytes ) );
+        if ( readBytes < klogg::ssize( buffer ) ) {
+            buffer.resize( static_cast<size_t>( readBytes ) );
         }
 
         clock::time_point ioT2 = clock::now();
 
         ioDuration += duration_cast<microseconds>( ioT2 - ioT1 );
+        prefetchDepth_->blockRead( duration_cast<microseconds>( ioT2 - ioT1 ) );
 
-        LOG_DEBUG << "Sending block " << blockData.first << " size " << blockData.second->size();
+        blockData.second->data = std::string_view( buffer.data(), buffer.size() );
 
-        while ( !blockPrefetcher.try_put( std::move( blockData ) ) && !interruptRequest_ ) {
-            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
-        }
-    }
+        LOG_TRACE << "Sending block " << blockData.first << " size " << buffer.size();
 
-    auto lastBlock = std::make_pair( -1, new klogg::vector<char>{} );
-    while ( !blockPrefetcher.try_put( lastBlock ) && !interruptRequest_ ) {
-        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        sendBlock( blockPrefetcher, blockData );
     }
 
+    sendBlock( blockPrefetcher, { -1, blockContentPool_.acquire() } );
+
     LOG_INFO << "IO thread done";
     return ioDuration;
 }
 
-void IndexOperation::indexNextBlock( IndexingState& state, const BlockData& blockData )
+void IndexOperation::sendBlock( BlockPrefetcher& blockPrefetcher, const BlockData& blockData )
 {
-    const auto& blockBeginning = blockData.first;
-    const auto& block = *blockData.second;
+    // Time waiting for blocks in flight to complete shows backpressure of the graph
+    if ( !prefetchDepth_->canSend() ) {
+        const TraceSpan waitSpan( "wait for prefetcher", "indexing", "offset", blockData.first );
+        if ( !prefetchDepth_->waitToSend( interruptRequest_ ) ) {
+            blockContentPool_.release( blockData.second );
+            return;
+        }
+    }
 
-    LOG_DEBUG << "Indexing block " << blockBeginning << " start";
+    // The limiter counts one block more than the depth allows at most,
+    // the last indexed block until its completion decrements the limiter
+    while ( !blockPrefetcher.try_put( blockData ) ) {
+        std::this_thread::yield();
+    }
+    prefetchDepth_->blockSent();
+}
 
-    if ( blockBeginning < 0 ) {
+void IndexOperation::readFileInQueue( ChainedFile& file, BlockPrefetcher& blockPrefetcher,
+                                      std::chrono::microseconds& ioDuration )
+{
+    using namespace std::chrono;
+    using clock = high_resolution_clock;
+
+    const auto queueDepth = Configuration::get().indexReadQueueDepth();
+    if ( queueDepth < 2 ) {
         return;
     }
 
-    IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+    const auto reader = file.reader();
+    const auto endPosition = indexingEndPosition( file );
+    auto readPosition = file.pos();
+    if ( !reader || readPosition >= endPosition ) {
+        return;
+    }
 
-    guessEncoding( block, scopedAccessor, state );
+    LOG_INFO << "Reading file with " << queueDepth << " blocks in flight";
 
-    if ( !block.empty() ) {
-        const auto linePositions = parseDataBlock( blockBeginning, block, state );
-        auto maxLength = state.max_length;
-        if ( maxLength > std::numeric_limits<LineLength::UnderlyingType>::max() ) {
-            LOG_ERROR << "Too long lines " << maxLength;
-            maxLength = std::numeric_limits<LineLength::UnderlyingType>::max();
+    BlockReadQueue readQueue(
+        [ &reader ]( qint64 offset, char* data, qint64 size ) {
+            return reader->read( offset, data, size );
+        },
+        static_cast<size_t>( queueDepth ) );
+
+    std::deque<BlockData> blocksInFlight;
+    auto sentPosition = readPosition;
+    // Blocks after a failed or a short read are dropped, they are read again one by one
+    auto isSending = true;
+
+    while ( true ) {
+        while ( isSending && !interruptRequest_ && readPosition < endPosition
+                && !readQueue.isFull() ) {
+            const auto blockSize
+                = std::min( endPosition - readPosition, qint64{ IndexingBlockSize } );
+
+            BlockData blockData{ readPosition, blockContentPool_.acquire() };
+            auto& buffer = blockData.second->buffer;
+            buffer.resize( static_cast<size_t>( blockSize ) );
+
+            readQueue.submit( readPosition, buffer.data(), blockSize );
+            blocksInFlight.push_back( blockData );
+            readPosition += blockSize;
         }
 
-        scopedAccessor.addAll( block,
-                               LineLength( type_safe::narrow_cast<LineLength::UnderlyingType>( maxLength ) ),
-                               linePositions, state.encodingGuess );
+        if ( blocksInFlight.empty() ) {
+            break;
+        }
 
-        // Update the caller for progress indication
-        const auto progress
-            = ( state.file_size > 0 ) ? calculateProgress( state.pos, state.file_size ) : 100;
+        auto blockData = blocksInFlight.front();
+        blocksInFlight.pop_front();
 
-        if ( progress != scopedAccessor.getProgress() ) {
-            scopedAccessor.setProgress( progress );
-            LOG_DEBUG << "Indexing progress " << progress << ", indexed size " << state.pos;
-            Q_EMIT indexingProgressed( progress );
+        // Only the time waiting for reads is not overlapped with indexing
+        clock::time_point ioT1 = clock::now();
+        BlockReadQueue::Read read;
+        {
+            const TraceSpan span( "wait for block read", "indexing", "offset", blockData.first );
+            read = readQueue.take();
+        }
+        ioDuration += duration_cast<microseconds>( clock::now() - ioT1 );
+        prefetchDepth_->blockRead( read.duration );
+
+        if ( !isSending || interruptRequest_ || read.bytesRead <= 0 ) {
+            blockContentPool_.release( blockData.second );
+            isSending = false;
+            continue;
+        }
+
+        auto& buffer = blockData.second->buffer;
+        if ( read.bytesRead < klogg::ssize( buffer ) ) {
+            buffer.resize( static_cast<size_t>( read.bytesRead ) );
+            isSending = false;
+        }
+        blockData.second->data = std::string_view( buffer.data(), buffer.size() );
+
+        LOG_TRACE << "Sending block " << blockData.first << " size " << buffer.size();
+
+        sendBlock( blockPrefetcher, blockData );
+        sentPosition = blockData.first + read.bytesRead;
+    }
+
+    file.seek( sentPosition );
+}
+
+bool IndexOperation::readMappedFileInBlocks( ChainedFile& file,
+                                             BlockPrefetcher& blockPrefetcher,
+                                             std::chrono::microseconds& ioDuration )
+{
+    using namespace std::chrono;
+    using clock = high_resolution_clock;
+
+    if ( !Configuration::get().useMappedFileIndexing() || !file.canMap() ) {
+        return false;
+    }
+
+    const auto mappingStart = file.pos();
+    const auto mappingSize = indexingEndPosition( file ) - mappingStart;
+    if ( mappingSize <= 0 ) {
+        return false;
+    }
+
+    clock::time_point mapT1 = clock::now();
+    // Mapping stays valid until the file is closed,
+    // that is after all blocks have been indexed.
+    const char* mapping = nullptr;
+    {
+        const TraceSpan span( "map file", "indexing", "size", mappingSize );
+        mapping = reinterpret_cast<const char*>( file.map( mappingStart, mappingSize ) );
+    }
+    if ( mapping == nullptr ) {
+        LOG_WARNING << "Failed to map file for indexing: " << file.errorString();
+        return false;
+    }
+
+    adviseSequentialAccess( mapping, mappingSize );
+    ioDuration += duration_cast<microseconds>( clock::now() - mapT1 );
+
+    LOG_INFO << "Indexing mapped file, size " << mappingSize;
+
+    qint64 blockOffset = 0;
+    while ( blockOffset < mappingSize ) {
+
+        if ( interruptRequest_ ) {
+            break;
         }
+
+        const auto blockSize = std::min( mappingSize - blockOffset, qint64{ IndexingBlockSize } );
+
+        BlockData blockData{ mappingStart + blockOffset, blockContentPool_.acquire() };
+        blockData.second->data
+            = std::string_view( mapping + blockOffset, static_cast<size_t>( blockSize ) );
+
+        LOG_TRACE << "Sending mapped block " << blockData.first << " size " << blockSize;
+
+        sendBlock( blockPrefetcher, blockData );
+
+        blockOffset += blockSize;
+    }
+
+    // Tail hash is computed relative to the indexed end of file
+    file.seek( mappingStart + blockOffset );
+    return true;
+}
+
+void IndexOperation::indexNextBlock( IndexingState& state, const BlockData& blockData )
+{
+    const auto& blockBeginning = blockData.first;
+    const auto block = blockData.second->data;
+
+    LOG_TRACE << "Indexing block " << blockBeginning << " start";
+
+    if ( blockBeginning < 0 ) {
+        return;
+    }
+
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        guessEncoding( block, scopedAccessor, state );
+    }
+
+    if ( !block.empty() ) {
+        // Block is parsed on local state, readers are blocked only while lines are published
+        const auto lines = parseDataBlock( blockBeginning, block, state );
+        publishParsedLines( state, blockBeginning, block, lines );
     }
     else {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
         scopedAccessor.setEncodingGuess( state.encodingGuess );
     }
 
-    LOG_DEBUG << "Indexing block " << blockBeginning << " done";
+    LOG_TRACE << "Indexing block " << blockBeginning << " done";
 }
 
-void IndexOperation::doIndex( OffsetInFile initialPosition )
+void IndexOperation::parseBlockTail( ParsedBlock& parsedBlock ) const
 {
-    QFile file( fileName_ );
+    using namespace parse_data_block;
 
-    if ( !( file.isOpen() || file.open( QIODevice::ReadOnly ) ) ) {
-        // TODO: Check that the file is seekable?
-        // If the file cannot be open, we do as if it was empty
-        LOG_WARNING << "Cannot open file " << fileName_.toStdString();
+    const auto& blockBeginning = parsedBlock.blockData.first;
+    const auto block = parsedBlock.blockData.second->data;
 
-        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+    if ( blockBeginning < 0 || block.empty() ) {
+        return;
+    }
 
-        scopedAccessor.clear();
-        scopedAccessor.setEncodingGuess( QTextCodec::codecForLocale() );
+    IndexingState tailState;
+    tailState.encodingParams = parsedBlock.encodingParams;
+    tailState.expand_tabs = parsedBlock.expandTabs;
+    tailState.pos = blockBeginning;
+
+    // Only the position of the first line feed is needed here,
+    // its line length is calculated during stitching.
+    ParsedLines firstLine;
+    const auto isEndOfBlock
+        = withCodeUnitLayout( tailState.encodingParams, [ & ]( auto layout ) {
+              return parseNextLine<decltype( layout )>( blockBeginning, block, tailState,
+                                                        firstLine );
+          } );
+    if ( isEndOfBlock ) {
+        return;
+    }
 
-        scopedAccessor.setProgress( 100 );
-        Q_EMIT indexingProgressed( 100 );
+    tailState.max_length = 0;
+    parsedBlock.tailBeginning = tailState.pos;
+    parsedBlock.lines = parseDataBlock( blockBeginning, block, tailState );
+    parsedBlock.tailState = tailState;
+}
+
+void IndexOperation::stitchParsedBlock( IndexingState& state, ParsedBlock& parsedBlock )
+{
+    using namespace parse_data_block;
+
+    const auto& blockBeginning = parsedBlock.blockData.first;
+    const auto block = parsedBlock.blockData.second->data;
+
+    LOG_TRACE << "Stitching block " << blockBeginning << " start";
+
+    if ( blockBeginning < 0 ) {
         return;
     }
 
-    IndexingState state;
-    state.pos = initialPosition.get();
-    state.file_size = file.size();
+    state.encodingGuess = parsedBlock.encodingGuess;
+    state.fileTextCodec = parsedBlock.fileTextCodec;
+    state.encodingParams = parsedBlock.encodingParams;
+
+    if ( !block.empty() ) {
+        ParsedLines lines;
+        const auto isEndOfBlock = withCodeUnitLayout( state.encodingParams, [ & ]( auto layout ) {
+            return parseNextLine<decltype( layout )>( blockBeginning, block, state, lines );
+        } );
+
+        if ( !isEndOfBlock ) {
+            if ( parsedBlock.tailState && state.pos == parsedBlock.tailBeginning ) {
+                const auto& tailState = *parsedBlock.tailState;
+
+                lines.append_list( parsedBlock.lines );
 
+                state.pos = tailState.pos;
+                state.end = tailState.end;
+                state.additional_spaces = tailState.additional_spaces;
+                state.max_length = std::max( state.max_length, tailState.max_length );
+            }
+            else {
+                // Previous block ended inside of a line feed,
+                // parsed tail does not match, so parse it again.
+                lines.append_list( parseDataBlock( blockBeginning, block, state ) );
+            }
+        }
+
+        publishParsedLines( state, blockBeginning, block, lines );
+    }
+    else {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        scopedAccessor.setEncodingGuess( state.encodingGuess );
+    }
+
+    LOG_TRACE << "Stitching block " << blockBeginning << " done";
+}
+
+void IndexOperation::publishParsedLines( const IndexingState& state,
+                                         OffsetInFile::UnderlyingType blockBeginning,
+                                         std::string_view block, const ParsedLines& lines )
+{
+    using namespace std::chrono;
+    using clock = high_resolution_clock;
+
+    // Tabs are found before the lock is taken, lines of blocks
+    // with tabs are measured again when indexing is done.
+    const auto hasUnexpandedTabs
+        = !state.expand_tabs
+          && parse_data_block::delimeterFinder( state.encodingParams )(
+                 state.encodingParams, block, '\t' )
+                 != std::string_view::npos;
+
+    auto maxLength = state.max_length;
+    if ( maxLength > std::numeric_limits<LineLength::UnderlyingType>::max() ) {
+        LOG_ERROR << "Too long lines " << maxLength;
+        maxLength = std::numeric_limits<LineLength::UnderlyingType>::max();
+    }
+
+    // Update the caller for progress indication
+    const auto progress
+        = ( state.file_size > 0 ) ? calculateProgress( state.pos, state.file_size ) : 100;
+
+    bool isProgressChanged = false;
+    microseconds lockDuration{};
     {
-        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        const auto lockStart = clock::now();
 
-        state.fileTextCodec = scopedAccessor.getForcedEncoding();
-        if ( !state.fileTextCodec ) {
-            state.fileTextCodec = scopedAccessor.getEncodingGuess();
+        scopedAccessor.addAll(
+            block, LineLength( type_safe::narrow_cast<LineLength::UnderlyingType>( maxLength ) ),
+            lines.positions, lines.lengths, state.encodingGuess );
+
+        if ( hasUnexpandedTabs ) {
+            scopedAccessor.addBlockWithTabs( blockBeginning );
         }
 
-        state.encodingGuess = scopedAccessor.getEncodingGuess();
-        LOG_INFO << "Initial encoding "
-                 << ( state.fileTextCodec != nullptr ? state.fileTextCodec->name().toStdString()
-                                                     : std::string{ "auto" } );
+        if ( progress != scopedAccessor.getProgress() ) {
+            scopedAccessor.setProgress( progress );
+            isProgressChanged = true;
+        }
+
+        lockDuration = duration_cast<microseconds>( clock::now() - lockStart );
     }
 
-    const auto& config = Configuration::get();
-    const auto prefetchBufferSize = static_cast<size_t>( config.indexReadBufferSizeMb() );
+    if ( lockDuration > MaxPublishLockDuration ) {
+        LOG_TRACE << "Publishing " << lines.positions.size() << " lines took "
+                  << lockDuration.count() << " us";
+    }
 
-    LOG_INFO << "Prefetch buffer " << readableSize( prefetchBufferSize * IndexingBlockSize );
+    if ( isProgressChanged ) {
+        LOG_TRACE << "Indexing progress " << progress << ", indexed size " << state.pos;
+        if ( progress_ ) {
+            progress_->update( progress );
+        }
+        else {
+            Q_EMIT indexingProgressed( progress );
+        }
+    }
+}
 
+void IndexOperation::runSmallFileIndexing( ChainedFile& file, IndexingState& state,
+                                           FileDigest* fullDigest, BlockDigests* blockDigests,
+                                           TrigramIndex* trigramIndex, TokenFilters* tokenFilters,
+                                           std::chrono::microseconds& ioDuration )
+{
     using namespace std::chrono;
     using clock = high_resolution_clock;
-    microseconds ioDuration{};
 
-    const auto indexingStartTime = clock::now();
+    BlockContent content;
+    content.buffer = acquireSmallFileBuffer();
 
-    tbb::flow::graph indexingGraph;
-    auto blockPrefetcher = tbb::flow::limiter_node<BlockData>( indexingGraph, prefetchBufferSize );
-    auto blockQueue = tbb::flow::queue_node<BlockData>( indexingGraph );
+    while ( !file.atEnd() && !interruptRequest_ ) {
+        auto blockSize = qint64{ IndexingBlockSize };
+        if ( indexingEnd_ >= 0 ) {
+            blockSize = std::min( blockSize, indexingEnd_ - file.pos() );
+            if ( blockSize <= 0 ) {
+                break;
+            }
+        }
 
-    auto blockParser = tbb::flow::function_node<BlockData, tbb::flow::continue_msg>(
-        indexingGraph, tbb::flow::serial, [ this, &state ]( const BlockData& blockData ) {
-            indexNextBlock( state, blockData );
-            delete blockData.second;
-            return tbb::flow::continue_msg{};
-        } );
+        const auto blockBeginning = file.pos();
+        content.buffer.resize( static_cast<size_t>( blockSize ) );
 
-    tbb::flow::make_edge( blockPrefetcher, blockQueue );
-    tbb::flow::make_edge( blockQueue, blockParser );
-    tbb::flow::make_edge( blockParser, blockPrefetcher.decrementer() );
+        const auto ioStart = clock::now();
+        const auto readBytes = file.read( content.buffer.data(), blockSize );
+        ioDuration += duration_cast<microseconds>( clock::now() - ioStart );
 
-    file.seek( state.pos );
-    ioDuration = readFileInBlocks( file, blockPrefetcher );
-    indexingGraph.wait_for_all();
+        if ( readBytes < 0 ) {
+            LOG_ERROR << "Reading past the end of file";
+            break;
+        }
+        if ( readBytes == 0 ) {
+            break;
+        }
 
-    IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        content.data = std::string_view( content.buffer.data(), static_cast<size_t>( readBytes ) );
 
-    LOG_DEBUG << "Indexed up to " << state.pos;
+        indexNextBlock( state, { blockBeginning, &content } );
+
+        if ( fullDigest ) {
+            fullDigest->addData( content.data.data(), content.data.size() );
+            if ( blockDigests ) {
+                blockDigests->addData( content.data.data(), content.data.size() );
+            }
+        }
+        if ( trigramIndex ) {
+            trigramIndex->addBlock( blockBeginning, content.data );
+        }
+        if ( tokenFilters ) {
+            tokenFilters->addBlock( blockBeginning, content.data );
+        }
+    }
+
+    releaseSmallFileBuffer( std::move( content.buffer ) );
+}
+
+void IndexOperation::runSerialIndexing( ChainedFile& file, IndexingState& state,
+                                        size_t prefetchBufferSize, FileDigest* fullDigest,
+                                        BlockDigests* blockDigests, TrigramIndex* trigramIndex,
+                                        TokenFilters* tokenFilters,
+                                        std::chrono::microseconds& ioDuration )
+{
+    tbb::flow::graph indexingGraph;
+    auto blockPrefetcher = tbb::flow::limiter_node<BlockData>( indexingGraph, prefetchBufferSize );
+    auto blockQueue = tbb::flow::queue_node<BlockData>( indexingGraph );
+
+    auto blockParser = tbb::flow::function_node<BlockData, BlockData>(
+        indexingGraph, tbb::flow::serial, [ this, &state ]( const BlockData& blockData ) {
+            const TraceSpan span( "parse block", "indexing", "offset", blockData.first );
+            indexNextBlock( state, blockData );
+            return blockData;
+        } );
+
+    BlockCompletion blockCompletion(
+        indexingGraph, blockPrefetcher, fullDigest, blockDigests, trigramIndex, tokenFilters,
+        [ this ]( const BlockData& blockData ) {
+            blockContentPool_.release( blockData.second );
+            prefetchDepth_->blockIndexed( PrefetchDepth::Clock::now() );
+        } );
+
+    tbb::flow::make_edge( blockPrefetcher, blockQueue );
+    tbb::flow::make_edge( blockQueue, blockParser );
+    tbb::flow::make_edge( blockParser, blockCompletion.parsedBlocks() );
+
+    ioDuration = readFileInBlocks( file, blockPrefetcher );
+    indexingGraph.wait_for_all();
+}
+
+void IndexOperation::runParallelIndexing( ChainedFile& file, IndexingState& state,
+                                          size_t prefetchBufferSize, FileDigest* fullDigest,
+                                          BlockDigests* blockDigests, TrigramIndex* trigramIndex,
+                                          TokenFilters* tokenFilters,
+                                          std::chrono::microseconds& ioDuration )
+{
+    using ParsedBlockPtr = ParsedBlock*;
+
+    // Encoding is guessed in order before blocks are sent to parsers,
+    // stitcher takes encoding parameters from each parsed block.
+    IndexingState encodingState = state;
+    size_t nextSequence = 0;
+
+    tbb::flow::graph indexingGraph;
+    auto blockPrefetcher = tbb::flow::limiter_node<BlockData>( indexingGraph, prefetchBufferSize );
+    auto blockQueue = tbb::flow::queue_node<BlockData>( indexingGraph );
+
+    auto encodingGuesser = tbb::flow::function_node<BlockData, ParsedBlockPtr>(
+        indexingGraph, tbb::flow::serial,
+        [ this, &encodingState, &nextSequence ]( const BlockData& blockData ) {
+            const TraceSpan span( "guess encoding", "indexing", "offset", blockData.first );
+            auto parsedBlock = new ParsedBlock;
+            parsedBlock->sequence = nextSequence++;
+            parsedBlock->blockData = blockData;
+
+            if ( blockData.first >= 0 ) {
+                IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+                guessEncoding( blockData.second->data, scopedAccessor, encodingState );
+            }
+
+            parsedBlock->encodingParams = encodingState.encodingParams;
+            parsedBlock->encodingGuess = encodingState.encodingGuess;
+            parsedBlock->fileTextCodec = encodingState.fileTextCodec;
+            parsedBlock->expandTabs = encodingState.expand_tabs;
+            return parsedBlock;
+        } );
+
+    auto blockParser = tbb::flow::function_node<ParsedBlockPtr, ParsedBlockPtr>(
+        indexingGraph, tbb::flow::unlimited, [ this ]( ParsedBlockPtr parsedBlock ) {
+            const TraceSpan span( "parse block", "indexing", "offset",
+                                  parsedBlock->blockData.first );
+            parseBlockTail( *parsedBlock );
+            return parsedBlock;
+        } );
+
+    auto blockSequencer = tbb::flow::sequencer_node<ParsedBlockPtr>(
+        indexingGraph, []( const ParsedBlockPtr& parsedBlock ) { return parsedBlock->sequence; } );
+
+    auto blockStitcher = tbb::flow::function_node<ParsedBlockPtr, BlockData>(
+        indexingGraph, tbb::flow::serial, [ this, &state ]( ParsedBlockPtr parsedBlock ) {
+            const TraceSpan span( "stitch block", "indexing", "offset",
+                                  parsedBlock->blockData.first );
+            stitchParsedBlock( state, *parsedBlock );
+            const auto blockData = parsedBlock->blockData;
+            delete parsedBlock;
+            return blockData;
+        } );
+
+    BlockCompletion blockCompletion(
+        indexingGraph, blockPrefetcher, fullDigest, blockDigests, trigramIndex, tokenFilters,
+        [ this ]( const BlockData& blockData ) {
+            blockContentPool_.release( blockData.second );
+            prefetchDepth_->blockIndexed( PrefetchDepth::Clock::now() );
+        } );
+
+    tbb::flow::make_edge( blockPrefetcher, blockQueue );
+    tbb::flow::make_edge( blockQueue, encodingGuesser );
+    tbb::flow::make_edge( encodingGuesser, blockParser );
+    tbb::flow::make_edge( blockParser, blockSequencer );
+    tbb::flow::make_edge( blockSequencer, blockStitcher );
+    tbb::flow::make_edge( blockStitcher, blockCompletion.parsedBlocks() );
+
+    ioDuration = readFileInBlocks( file, blockPrefetcher );
+    indexingGraph.wait_for_all();
+}
+
+void IndexOperation::expandTabsInRecordedBlocks( const IndexingState& state )
+{
+    struct LinesRange {
+        OffsetInFile::UnderlyingType begin;
+        OffsetInFile::UnderlyingType end;
+    };
+
+    klogg::vector<OffsetInFile::UnderlyingType> blocksWithTabs;
+    klogg::vector<LinesRange> ranges;
+    {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        blocksWithTabs = scopedAccessor.takeBlocksWithTabs();
+        if ( blocksWithTabs.empty() ) {
+            return;
+        }
+
+        std::sort( blocksWithTabs.begin(), blocksWithTabs.end() );
+
+        const auto nbLines = scopedAccessor.getNbLines().get();
+        const auto lineEnd = [ &scopedAccessor ]( LinesCount::UnderlyingType line ) {
+            return scopedAccessor.getEndOfLineOffset( LineNumber( line ) ).get();
+        };
+
+        // Returns the line containing the byte at offset, nbLines if it is not terminated yet
+        const auto lineAt = [ &lineEnd, nbLines ]( OffsetInFile::UnderlyingType offset ) {
+            LinesCount::UnderlyingType first = 0;
+            auto count = nbLines;
+            while ( count > 0 ) {
+                const auto step = count / 2;
+                if ( lineEnd( first + step ) <= offset ) {
+                    first += step + 1;
+                    count -= step + 1;
+                }
+                else {
+                    count = step;
+                }
+            }
+            return first;
+        };
+
+        // Data after the last line feed is parsed too, it can end with a line
+        // that gets a fake line feed later.
+        OffsetInFile::UnderlyingType previousEnd = 0;
+        for ( const auto blockBeginning : blocksWithTabs ) {
+            const auto firstLine = lineAt( blockBeginning );
+            const auto lastLine = lineAt( blockBeginning + IndexingBlockSize - 1 );
+
+            const auto begin = std::max(
+                firstLine > 0 ? lineEnd( firstLine - 1 )
+                              : scopedAccessor.getFirstLineOffset().get(),
+                previousEnd );
+            const auto end = lastLine < nbLines ? std::min( lineEnd( lastLine ), state.file_size )
+                                                : state.file_size;
+
+            if ( begin < end ) {
+                ranges.push_back( { begin, end } );
+                previousEnd = end;
+            }
+        }
+    }
+
+    LOG_INFO << "Expanding tabs in " << ranges.size() << " ranges";
+
+    tbb::enumerable_thread_specific<LineLength::UnderlyingType> maxLengths;
+    tbb::parallel_for( size_t{ 0 }, ranges.size(), [ & ]( size_t rangeIndex ) {
+        if ( interruptRequest_ ) {
+            return;
+        }
+
+        const auto& range = ranges[ rangeIndex ];
+        const TraceSpan span( "expand tabs", "indexing", "offset", range.begin );
+
+        ChainedFile file( fileName_, fileChain_ );
+        if ( !file.open( QIODevice::ReadOnly ) || !file.seek( range.begin ) ) {
+            LOG_WARNING << "Cannot read lines at " << range.begin;
+            return;
+        }
+
+        const auto data = file.read( range.end - range.begin );
+        const auto lines = std::string_view( data.data(), static_cast<size_t>( data.size() ) );
+
+        IndexingState rangeState;
+        rangeState.encodingParams = state.encodingParams;
+        rangeState.pos = range.begin;
+        parseDataBlock( range.begin, lines, rangeState );
+
+        auto& maxLength = maxLengths.local();
+        maxLength = std::max( maxLength, rangeState.max_length );
+    } );
+
+    const auto maxLength
+        = maxLengths.combine( []( auto lhs, auto rhs ) { return std::max( lhs, rhs ); } );
+
+    IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+    if ( interruptRequest_ ) {
+        // Blocks are measured again when indexing is continued
+        for ( const auto blockBeginning : blocksWithTabs ) {
+            scopedAccessor.addBlockWithTabs( blockBeginning );
+        }
+        return;
+    }
+
+    scopedAccessor.extendMaxLength(
+        LineLength( type_safe::narrow_cast<LineLength::UnderlyingType>( maxLength ) ) );
+}
+
+void IndexOperation::doIndex( OffsetInFile initialPosition )
+{
+    const TraceSpan span( "index", "indexing", "offset", initialPosition.get() );
+
+    ChainedFile file( fileName_, fileChain_ );
+
+    if ( !( file.isOpen() || file.open( QIODevice::ReadOnly ) ) ) {
+        // TODO: Check that the file is seekable?
+        // If the file cannot be open, we do as if it was empty
+        LOG_WARNING << "Cannot open file " << fileName_.toStdString();
+
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+
+        scopedAccessor.clear();
+        scopedAccessor.setEncodingGuess( QTextCodec::codecForLocale() );
+
+        scopedAccessor.setProgress( 100 );
+        Q_EMIT indexingProgressed( 100 );
+        return;
+    }
+
+    IndexingState state;
+    state.pos = initialPosition.get();
+    state.file_size = indexingEndPosition( file );
+
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+
+        // Line not terminated in indexed data is parsed again from its beginning,
+        // file is still read from the end of indexed data.
+        const auto checkpoint = scopedAccessor.getCheckpoint();
+        if ( scopedAccessor.getIndexedSize() == state.pos && checkpoint.lineStart < state.pos ) {
+            LOG_INFO << "Continue line at " << checkpoint.lineStart;
+            state.pos = checkpoint.lineStart;
+            state.additional_spaces = checkpoint.additionalSpaces;
+        }
+
+        state.fileTextCodec = scopedAccessor.getForcedEncoding();
+        if ( !state.fileTextCodec ) {
+            state.fileTextCodec = scopedAccessor.getEncodingGuess();
+        }
+
+        state.encodingGuess = scopedAccessor.getEncodingGuess();
+        LOG_INFO << "Initial encoding "
+                 << ( state.fileTextCodec != nullptr ? state.fileTextCodec->name().toStdString()
+                                                     : std::string{ "auto" } );
+    }
+
+    IndexingData::MutateAccessor{ indexing_data_.get() }.selectLinePositionStorage( file.size() );
+
+    const auto& config = Configuration::get();
+    state.expand_tabs = !config.useLazyTabExpansion();
+
+    // Parallel parsers take blocks read ahead, so there are enough of them for all parsers
+    const auto minPrefetchDepth
+        = config.useParallelIndexing()
+              ? static_cast<size_t>( tbb::this_task_arena::max_concurrency() ) + 2
+              : size_t{ 2 };
+    prefetchDepth_ = std::make_unique<PrefetchDepth>(
+        static_cast<size_t>( config.indexReadBufferSizeMb() ), minPrefetchDepth,
+        config.autoIndexReadBuffer() );
+    const auto prefetchBufferSize = prefetchDepth_->maxDepth() + 1;
+
+    LOG_INFO << "Prefetch buffer " << readableSize( prefetchDepth_->depth() * IndexingBlockSize );
+    if ( config.autoIndexReadBuffer() ) {
+        LOG_INFO << "Prefetch buffer adapts up to "
+                 << readableSize( prefetchDepth_->maxDepth() * IndexingBlockSize );
+    }
+
+    // One more block for the reader waiting on the limiter,
+    // and the blocks being read in the queue
+    blockContentPool_.setCapacity(
+        prefetchBufferSize + 1
+        + static_cast<size_t>( std::max( config.indexReadQueueDepth(), 0 ) ) );
+
+    using namespace std::chrono;
+    using clock = high_resolution_clock;
+    microseconds ioDuration{};
+
+    const auto indexingStartTime = clock::now();
+
+    // Full digest continues from the state of previously indexed data
+    // and is published when all blocks are hashed.
+    // Block digests continue only if they cover all indexed data.
+    std::unique_ptr<FileDigest> fullDigest;
+    std::unique_ptr<BlockDigests> blockDigests;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        if ( !scopedAccessor.isFastModificationDetectionUsed() ) {
+            fullDigest = std::make_unique<FileDigest>();
+            fullDigest->restoreState( scopedAccessor.getHashBuilderState() );
+
+            blockDigests = std::make_unique<BlockDigests>( scopedAccessor.getBlockDigests() );
+            if ( blockDigests->size() != initialPosition.get() ) {
+                blockDigests.reset();
+            }
+        }
+    }
+
+    // Trigram index continues if it covers all indexed data,
+    // it is built only if indexing starts from the first indexed line.
+    std::shared_ptr<TrigramIndex> trigramIndex;
+    if ( config.useTrigramIndex() ) {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        trigramIndex = scopedAccessor.getTrigramIndex();
+        if ( !trigramIndex || trigramIndex->endOffset() != initialPosition.get() ) {
+            trigramIndex = scopedAccessor.getFirstLineOffset() == initialPosition
+                               ? std::make_shared<TrigramIndex>( initialPosition.get() )
+                               : nullptr;
+        }
+        scopedAccessor.setTrigramIndex( trigramIndex );
+    }
+
+    std::shared_ptr<TokenFilters> tokenFilters;
+    if ( config.useTokenFilters() ) {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        tokenFilters = scopedAccessor.getTokenFilters();
+        if ( !tokenFilters || tokenFilters->endOffset() != initialPosition.get() ) {
+            tokenFilters = scopedAccessor.getFirstLineOffset() == initialPosition
+                               ? std::make_shared<TokenFilters>( initialPosition.get() )
+                               : nullptr;
+        }
+        scopedAccessor.setTokenFilters( tokenFilters );
+    }
+
+    file.seek( initialPosition.get() );
+
+    const auto smallFileSize = static_cast<qint64>( config.smallFileSizeKb() ) * 1024;
+    if ( state.file_size - state.pos <= smallFileSize ) {
+        LOG_INFO << "Indexing small file without the indexing graph";
+        runSmallFileIndexing( file, state, fullDigest.get(), blockDigests.get(),
+                              trigramIndex.get(), tokenFilters.get(), ioDuration );
+    }
+    else if ( config.useParallelIndexing() ) {
+        LOG_INFO << "Using parallel indexing";
+        runParallelIndexing( file, state, prefetchBufferSize, fullDigest.get(), blockDigests.get(),
+                             trigramIndex.get(), tokenFilters.get(), ioDuration );
+    }
+    else {
+        runSerialIndexing( file, state, prefetchBufferSize, fullDigest.get(), blockDigests.get(),
+                           trigramIndex.get(), tokenFilters.get(), ioDuration );
+    }
+
+    if ( trigramIndex ) {
+        trigramIndex->optimize();
+        LOG_INFO << "Trigram index size "
+                 << readableSize( static_cast<uint64_t>( trigramIndex->allocatedSize() ) );
+    }
+    if ( tokenFilters ) {
+        LOG_INFO << "Token filters size "
+                 << readableSize( static_cast<uint64_t>( tokenFilters->allocatedSize() ) );
+    }
+
+    // Also covers blocks left from interrupted indexing
+    if ( !interruptRequest_ ) {
+        expandTabsInRecordedBlocks( state );
+    }
+
+    IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+
+    if ( fullDigest ) {
+        scopedAccessor.setHashBuilderState( fullDigest->state() );
+        scopedAccessor.setBlockDigests( blockDigests ? *blockDigests : BlockDigests{} );
+    }
+
+    LOG_DEBUG << "Indexed up to " << state.pos;
 
     // Check if there is a non LF terminated line at the end of the file
     if ( !interruptRequest_ && state.file_size > state.pos ) {
@@ -658,88 +2140,470 @@ void IndexOperation::doIndex( OffsetInFile initialPosition )
         line_position.append( OffsetInFile( state.file_size + 1 ) );
         line_position.setFakeFinalLF();
 
-        scopedAccessor.addAll( {}, 0_length, line_position, state.encodingGuess );
+        scopedAccessor.addAll( {}, 0_length, line_position, {}, state.encodingGuess );
+    }
+
+    scopedAccessor.setCheckpoint( state.additional_spaces,
+                                  static_cast<bool>( interruptRequest_ ) );
+
+    // Tail hash covers the end of indexed data, that is not the end of file if interrupted
+    const auto endFilePos = scopedAccessor.getIndexedSize();
+    file.reset();
+    QByteArray hashBuffer( IndexingBlockSize, Qt::Uninitialized );
+    const auto headerHashSize = file.read( hashBuffer.data(), hashBuffer.size() );
+    FileDigest fastHashDigest;
+    fastHashDigest.addData( hashBuffer.data(), static_cast<size_t>( headerHashSize ) );
+
+    scopedAccessor.setHeaderHash( fastHashDigest.digest(), headerHashSize );
+
+    if ( endFilePos <= hashBuffer.size() ) {
+        scopedAccessor.setTailHash( fastHashDigest.digest(), 0, headerHashSize );
+    }
+    else {
+        const auto tailHashOffset = endFilePos - hashBuffer.size();
+        file.seek( tailHashOffset );
+        const auto tailHashSize = file.read( hashBuffer.data(), hashBuffer.size() );
+        fastHashDigest.reset();
+        fastHashDigest.addData( hashBuffer.data(), static_cast<size_t>( tailHashSize ) );
+        scopedAccessor.setTailHash( fastHashDigest.digest(), tailHashOffset, tailHashSize );
+    }
+
+    const auto indexingEndTime = high_resolution_clock::now();
+    const auto duration = duration_cast<microseconds>( indexingEndTime - indexingStartTime );
+
+    LOG_INFO << "Indexing done, took " << duration << ", io " << ioDuration;
+    LOG_INFO << "Prefetch buffer at the end "
+             << readableSize( prefetchDepth_->depth() * IndexingBlockSize );
+    LOG_INFO << "Index size "
+             << readableSize( static_cast<uint64_t>( scopedAccessor.allocatedSize() ) );
+    LOG_INFO << "Indexed lines " << scopedAccessor.getNbLines();
+    LOG_INFO << "Max line " << scopedAccessor.getMaxLength();
+    LOG_INFO << "Indexing perf "
+             << ( 1000.f * 1000.f * static_cast<float>( state.file_size )
+                  / static_cast<float>( duration.count() ) )
+                    / ( 1024 * 1024 )
+             << " MiB/s";
+    const auto memoryUsage = usedMemory();
+    LOG_INFO << "Memory usage " << readableSize( memoryUsage );
+
+    const auto indexedBytes = static_cast<uint64_t>( state.file_size - initialPosition.get() );
+    auto& metrics = Metrics::get();
+    metrics.counter( "indexing.runs" ).add();
+    metrics.counter( "indexing.bytes" ).add( indexedBytes );
+    metrics.histogram( "indexing.duration_us" ).record( static_cast<uint64_t>( duration.count() ) );
+    metrics.histogram( "indexing.io_us" ).record( static_cast<uint64_t>( ioDuration.count() ) );
+    metrics.gauge( "indexing.prefetch_blocks" )
+        .set( static_cast<double>( prefetchDepth_->depth() ) );
+    metrics.gauge( "indexing.block_size_bytes" ).set( static_cast<double>( IndexingBlockSize ) );
+    if ( duration.count() > 0 ) {
+        metrics.gauge( "indexing.throughput_mib_s" )
+            .set( static_cast<double>( indexedBytes ) / ( 1024 * 1024 )
+                  / ( static_cast<double>( duration.count() ) / 1e6 ) );
+    }
+    metrics.gauge( "indexing.index_size_bytes" )
+        .set( static_cast<double>( scopedAccessor.allocatedSize() ) );
+    metrics.gauge( "memory.used_bytes" ).set( static_cast<double>( memoryUsage ) );
+    metrics.gauge( "memory.huge_page_bytes" )
+        .set( static_cast<double>( BlockPoolBase::hugePageChunksSize() ) );
+
+    if ( interruptRequest_ ) {
+        LOG_INFO << "Indexing interrupted, keeping " << scopedAccessor.getNbLines() << " lines";
+    }
+
+    // Offsets of long lines are indexed as others, only their length is not exact
+    if ( scopedAccessor.getMaxLength().get()
+         == std::numeric_limits<LineLength::UnderlyingType>::max() ) {
+        LOG_WARNING << "Some lines are longer than " << scopedAccessor.getMaxLength();
+    }
+
+    if ( !scopedAccessor.getEncodingGuess() ) {
+        scopedAccessor.setEncodingGuess( QTextCodec::codecForLocale() );
+    }
+}
+
+// Called in the worker thread's context
+void FullIndexOperation::indexWithSampledEncoding( bool useSparseIndex )
+{
+    QTextCodec* sampledGuess = nullptr;
+    tbb::task_group sampling;
+    if ( !forcedEncoding_ ) {
+        sampling.run( [ this, &sampledGuess ] { sampledGuess = guessEncodingFromSamples(); } );
+    }
+
+    doIndex( 0_offset );
+    sampling.wait();
+
+    const auto firstBlockGuess
+        = IndexingData::ConstAccessor{ indexing_data_.get() }.getEncodingGuess();
+    if ( !sampledGuess || !firstBlockGuess || sampledGuess == firstBlockGuess
+         || interruptRequest_ ) {
+        return;
+    }
+
+    LOG_INFO << "FullIndexOperation: sampled encoding " << sampledGuess->name().toStdString()
+             << " differs from " << firstBlockGuess->name().toStdString();
+
+    if ( EncodingParameters( sampledGuess ) == EncodingParameters( firstBlockGuess ) ) {
+        // Lines are the same, only their decoding changes
+        IndexingData::MutateAccessor{ indexing_data_.get() }.setEncodingGuess( sampledGuess );
+        return;
+    }
+
+    static auto& reindexCount = Metrics::get().counter( "indexing.encoding_reindex" );
+    reindexCount.add();
+
+    {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        scopedAccessor.clear();
+        if ( useSparseIndex ) {
+            scopedAccessor.enableSparseIndex( fileName_, fileChain_ );
+        }
+        scopedAccessor.setEncodingGuess( sampledGuess );
+    }
+    doIndex( 0_offset );
+}
+
+QTextCodec* FullIndexOperation::guessEncodingFromSamples() const
+{
+    const TraceSpan span( "sample encoding", "indexing" );
+
+    ChainedFile file( fileName_, fileChain_ );
+    if ( !file.open( QIODevice::ReadOnly ) || file.isSequential() ) {
+        return nullptr;
+    }
+
+    // First block has all the file
+    const auto fileSize = file.size();
+    if ( fileSize <= IndexingBlockSize ) {
+        return nullptr;
+    }
+
+    klogg::vector<QByteArray> samples;
+    samples.reserve( EncodingSamplesCount );
+    for ( auto sample = 0; sample < EncodingSamplesCount && !interruptRequest_; ++sample ) {
+        // Aligned to code units of any encoding
+        const auto offset = ( fileSize / EncodingSamplesCount * sample ) & ~qint64{ 3 };
+
+        QByteArray data( EncodingSampleSize, Qt::Uninitialized );
+        const auto read = file.seek( offset ) ? file.read( data.data(), data.size() ) : -1;
+        if ( read <= 0 ) {
+            break;
+        }
+        data.resize( static_cast<int>( read ) );
+        samples.push_back( std::move( data ) );
+    }
+
+    return EncodingDetector::getInstance().detectEncoding( samples );
+}
+
+OperationResult FullIndexOperation::run()
+{
+    // Index being replaced, it is still used by readers while the new one is built
+    std::shared_ptr<IndexingData> currentIndex;
+
+    try {
+        LOG_INFO << "FullIndexOperation::run(), file " << fileName_.toStdString();
+
+        Q_EMIT indexingProgressed( 0 );
+
+        // Sparse index would be restored from cache with all line positions,
+        // cache of the file name doesn't describe the chained files.
+        const auto useSparseIndex = Configuration::get().useSparseLineIndex();
+        const auto isChained = fileChain_ && !fileChain_->segments()->empty();
+        const auto useIndexCache
+            = Configuration::get().useIndexCache() && !useSparseIndex && !isChained;
+
+        auto initialPosition = 0_offset;
+        if ( resumeInterruptedIndex() ) {
+            initialPosition = OffsetInFile(
+                IndexingData::ConstAccessor{ indexing_data_.get() }.getIndexedSize() );
+            LOG_INFO << "FullIndexOperation: continue interrupted index at " << initialPosition;
+            doIndex( initialPosition );
+        }
+        else {
+            if ( keepCurrentIndex_
+                 && IndexingData::ConstAccessor{ indexing_data_.get() }.getNbLines().get() > 0 ) {
+                LOG_INFO << "FullIndexOperation: building new index separately";
+                currentIndex = std::exchange( indexing_data_, std::make_shared<IndexingData>() );
+            }
+
+            {
+                IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+                scopedAccessor.clear();
+                scopedAccessor.forceEncoding( forcedEncoding_ );
+                if ( useSparseIndex ) {
+                    scopedAccessor.enableSparseIndex( fileName_, fileChain_ );
+                }
+            }
+
+            if ( useIndexCache && loadCachedIndex( fileName_, *indexing_data_ ) ) {
+                initialPosition = OffsetInFile(
+                    IndexingData::ConstAccessor{ indexing_data_.get() }.getIndexedSize() );
+                LOG_INFO << "FullIndexOperation: continue cached index at " << initialPosition;
+                doIndex( initialPosition );
+            }
+            else if ( currentIndex || !indexTailFirst() ) {
+                // Tail preview is not needed while the current index is shown
+                indexWithSampledEncoding( useSparseIndex );
+            }
+        }
+
+        LOG_INFO << "FullIndexOperation: ... finished, interrupt = "
+                 << static_cast<bool>( interruptRequest_ );
+
+        const auto result = interruptRequest_ ? false : true;
+
+        // Interrupted new index is dropped, current one is kept
+        auto isIndexReplaced = true;
+        if ( currentIndex ) {
+            isIndexReplaced = result;
+            if ( isIndexReplaced ) {
+                IndexingData::MutateAccessor{ currentIndex.get() }.replaceIndex( *indexing_data_ );
+            }
+            indexing_data_ = std::move( currentIndex );
+        }
+
+        Q_EMIT indexingFinished( result );
+
+        // Interrupted index is cached too, so it is continued when the file is opened again
+        const auto indexedSize
+            = IndexingData::ConstAccessor{ indexing_data_.get() }.getIndexedSize();
+        if ( useIndexCache && isIndexReplaced && indexedSize != initialPosition.get() ) {
+            saveIndexToCache( fileName_, *indexing_data_ );
+        }
+
+        return result;
+    } catch ( const std::exception& err ) {
+        const auto errorString = QString( "FullIndexOperation failed: %1" ).arg( err.what() );
+        LOG_ERROR << errorString;
+        dispatchToMainThread( [ errorString ]() {
+            IssueReporter::askUserAndReportIssue( IssueTemplate::Exception, errorString );
+        } );
+
+        if ( currentIndex ) {
+            indexing_data_ = std::move( currentIndex );
+        }
+
+        {
+            IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+            scopedAccessor.clear();
+        }
+
+        Q_EMIT indexingFinished( false );
+        return false;
+    }
+}
+
+bool FullIndexOperation::resumeInterruptedIndex()
+{
+    bool canResume = false;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        canResume = scopedAccessor.getCheckpoint().isInterrupted
+                    && scopedAccessor.getNbLines().get() > 0
+                    && scopedAccessor.getFirstLineOffset().get() == 0
+                    && scopedAccessor.getForcedEncoding() == forcedEncoding_
+                    && scopedAccessor.isFastModificationDetectionUsed()
+                           == Configuration::get().fastModificationDetection();
+    }
+
+    if ( !canResume ) {
+        return false;
+    }
+
+    const auto fileStatus = checkFileChanges();
+    return fileStatus == MonitoredFileStatus::Unchanged
+           || fileStatus == MonitoredFileStatus::DataAdded;
+}
+
+bool FullIndexOperation::indexTailFirst()
+{
+    const auto& config = Configuration::get();
+    // Sparse index can't be prepended with the beginning of the file
+    if ( !config.useTailFirstIndexing() || !config.followFileOnLoad()
+         || !config.anyFileWatchEnabled() || config.useSparseLineIndex() ) {
+        return false;
+    }
+
+    ChainedFile file( fileName_, fileChain_ );
+    if ( !file.open( QIODevice::ReadOnly ) || file.isSequential()
+         || file.size() < TailFirstMinFileSize ) {
+        return false;
+    }
+
+    // Encoding is guessed from the beginning of the file
+    // as it would be during normal indexing.
+    auto encodingGuess = forcedEncoding_;
+    if ( !encodingGuess ) {
+        const auto header = file.read( IndexingBlockSize );
+        encodingGuess = EncodingDetector::getInstance().detectEncoding(
+            std::string_view( header.data(), static_cast<size_t>( header.size() ) ) );
+    }
+
+    const auto tailStart = findTailFirstLineStart( file, encodingGuess );
+    if ( tailStart <= 0 ) {
+        return false;
+    }
+
+    const auto fileSize = file.size();
+    file.close();
+
+    LOG_INFO << "FullIndexOperation: indexing tail first from " << tailStart;
+
+    {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        scopedAccessor.setEncodingGuess( encodingGuess );
+        scopedAccessor.startIndexAt( OffsetInFile( tailStart ) );
     }
 
-    const auto endFilePos = file.pos();
-    file.reset();
-    QByteArray hashBuffer( IndexingBlockSize, Qt::Uninitialized );
-    const auto headerHashSize = file.read( hashBuffer.data(), hashBuffer.size() );
-    FileDigest fastHashDigest;
-    fastHashDigest.addData( hashBuffer.data(), static_cast<size_t>( headerHashSize ) );
-
-    scopedAccessor.setHeaderHash( fastHashDigest.digest(), headerHashSize );
+    doIndex( OffsetInFile( tailStart ) );
 
-    if ( endFilePos <= hashBuffer.size() ) {
-        scopedAccessor.setTailHash( fastHashDigest.digest(), 0, headerHashSize );
+    // Index of the tail only can't be continued
+    if ( interruptRequest_ ) {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        scopedAccessor.clear();
+        return true;
     }
-    else {
-        const auto tailHashOffset = endFilePos - hashBuffer.size();
-        file.seek( tailHashOffset );
-        const auto tailHashSize = file.read( hashBuffer.data(), hashBuffer.size() );
-        fastHashDigest.reset();
-        fastHashDigest.addData( hashBuffer.data(), static_cast<size_t>( tailHashSize ) );
-        scopedAccessor.setTailHash( fastHashDigest.digest(), tailHashOffset, tailHashSize );
+
+    Q_EMIT indexingPreviewReady();
+
+    // Beginning of the file is indexed into separate data,
+    // readers keep seeing the tail until it is prepended.
+    auto prefixData = std::make_shared<IndexingData>();
+    {
+        IndexingData::MutateAccessor prefixAccessor{ prefixData.get() };
+        prefixAccessor.clear();
+        prefixAccessor.forceEncoding( forcedEncoding_ );
+        prefixAccessor.setEncodingGuess( encodingGuess );
     }
 
-    const auto indexingEndTime = high_resolution_clock::now();
-    const auto duration = duration_cast<microseconds>( indexingEndTime - indexingStartTime );
+    const auto tailData = std::exchange( indexing_data_, prefixData );
+    indexingEnd_ = tailStart;
 
-    LOG_INFO << "Indexing done, took " << duration << ", io " << ioDuration;
-    LOG_INFO << "Index size "
-             << readableSize( static_cast<uint64_t>( scopedAccessor.allocatedSize() ) );
-    LOG_INFO << "Indexed lines " << scopedAccessor.getNbLines();
-    LOG_INFO << "Max line " << scopedAccessor.getMaxLength();
-    LOG_INFO << "Indexing perf "
-             << ( 1000.f * 1000.f * static_cast<float>( state.file_size )
-                  / static_cast<float>( duration.count() ) )
-                    / ( 1024 * 1024 )
-             << " MiB/s";
-    LOG_INFO << "Memory usage " << readableSize( usedMemory() );
+    doIndex( 0_offset );
+
+    indexingEnd_ = -1;
+    indexing_data_ = tailData;
 
     if ( interruptRequest_ ) {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
         scopedAccessor.clear();
+        return true;
     }
 
-    if ( scopedAccessor.getMaxLength().get()
-         == std::numeric_limits<LineLength::UnderlyingType>::max() ) {
-        dispatchToMainThread( [] {
-            QMessageBox::critical( nullptr, "Klogg", "Can't index file: some lines are too long",
-                                   QMessageBox::Close );
-        } );
+    if ( IndexingData::ConstAccessor{ prefixData.get() }.getIndexedSize() != tailStart ) {
+        LOG_WARNING << "FullIndexOperation: beginning of the file was not indexed, restarting";
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        scopedAccessor.clear();
+        scopedAccessor.forceEncoding( forcedEncoding_ );
+        return false;
+    }
+
+    // Full digest of the tail is recalculated on top of the beginning of the file
+    QByteArray hashBuilderState;
+    BlockDigests blockDigests;
+    const auto isFullDigestUsed
+        = !IndexingData::ConstAccessor{ indexing_data_.get() }.isFastModificationDetectionUsed();
+    if ( isFullDigestUsed ) {
+        FileDigest fullDigest;
+        {
+            IndexingData::ConstAccessor prefixAccessor{ prefixData.get() };
+            fullDigest.restoreState( prefixAccessor.getHashBuilderState() );
+            blockDigests = prefixAccessor.getBlockDigests();
+        }
 
+        const auto indexedSize
+            = IndexingData::ConstAccessor{ indexing_data_.get() }.getIndexedSize();
+
+        file.open( QIODevice::ReadOnly );
+        file.seek( tailStart );
+        QByteArray hashBuffer( IndexingBlockSize, Qt::Uninitialized );
+        auto hashedSize = tailStart;
+        while ( hashedSize < indexedSize && !interruptRequest_ ) {
+            const auto readSize
+                = file.read( hashBuffer.data(),
+                             std::min( qint64{ hashBuffer.size() }, indexedSize - hashedSize ) );
+            if ( readSize <= 0 ) {
+                break;
+            }
+            fullDigest.addData( hashBuffer.data(), static_cast<size_t>( readSize ) );
+            blockDigests.addData( hashBuffer.data(), static_cast<size_t>( readSize ) );
+            hashedSize += readSize;
+        }
+        hashBuilderState = fullDigest.state();
+    }
+
+    IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+    if ( interruptRequest_ ) {
         scopedAccessor.clear();
+        return true;
     }
 
-    if ( !scopedAccessor.getEncodingGuess() ) {
-        scopedAccessor.setEncodingGuess( QTextCodec::codecForLocale() );
+    scopedAccessor.prependIndex( *prefixData, hashBuilderState, blockDigests );
+
+    LOG_INFO << "FullIndexOperation: prepended beginning of the file, "
+             << scopedAccessor.getNbLines() << " lines, file size " << fileSize;
+
+    return true;
+}
+
+qint64 FullIndexOperation::findTailFirstLineStart( ChainedFile& file, QTextCodec* codec ) const
+{
+    const auto encodingParams = EncodingParameters( codec );
+    const auto lineFeedWidth = static_cast<qint64>( encodingParams.lineFeedWidth );
+
+    // Keep code units aligned for multi-byte encodings
+    auto searchStart = file.size() - TailFirstIndexingSize;
+    searchStart -= searchStart % 4;
+
+    file.seek( searchStart );
+    const auto buffer = file.read( IndexingBlockSize );
+    const auto data = std::string_view( buffer.data(), static_cast<size_t>( buffer.size() ) );
+
+    const auto findNextDelimeter = parse_data_block::delimeterFinder( encodingParams );
+
+    auto searchPos = std::string_view::size_type{};
+    while ( searchPos < data.size() ) {
+        const auto nextLineFeed
+            = findNextDelimeter( encodingParams, data.substr( searchPos ), '\n' );
+        if ( nextLineFeed == std::string_view::npos ) {
+            break;
+        }
+
+        const auto lineFeedStart = static_cast<qint64>( searchPos + nextLineFeed )
+                                   - encodingParams.getBeforeCrOffset();
+        if ( lineFeedStart >= 0 && lineFeedStart % lineFeedWidth == 0 ) {
+            return searchStart + lineFeedStart + lineFeedWidth;
+        }
+
+        searchPos += nextLineFeed + 1 + static_cast<size_t>( encodingParams.getAfterCrOffset() );
     }
+
+    LOG_INFO << "FullIndexOperation: no line feed found to index tail first";
+    return -1;
 }
 
-// Called in the worker thread's context
-OperationResult FullIndexOperation::run()
+OperationResult PartialIndexOperation::run()
 {
     try {
-        LOG_INFO << "FullIndexOperation::run(), file " << fileName_.toStdString();
+        LOG_INFO << "PartialIndexOperation::run(), file " << fileName_.toStdString();
 
-        Q_EMIT indexingProgressed( 0 );
+        const auto initialPosition
+            = OffsetInFile( IndexingData::ConstAccessor{ indexing_data_.get() }.getIndexedSize() );
 
-        {
-            IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
-            scopedAccessor.clear();
-            scopedAccessor.forceEncoding( forcedEncoding_ );
-        }
+        LOG_INFO << "PartialIndexOperation: Starting the count at " << initialPosition << " ...";
 
-        doIndex( 0_offset );
+        Q_EMIT indexingProgressed( 0 );
 
-        LOG_INFO << "FullIndexOperation: ... finished, interrupt = "
-                 << static_cast<bool>( interruptRequest_ );
+        doIndex( initialPosition );
+
+        LOG_INFO << "PartialIndexOperation: ... finished counting.";
 
         const auto result = interruptRequest_ ? false : true;
         Q_EMIT indexingFinished( result );
         return result;
     } catch ( const std::exception& err ) {
-        const auto errorString = QString( "FullIndexOperation failed: %1" ).arg( err.what() );
+        const auto errorString = QString( "PartialIndexOperation failed: %1" ).arg( err.what() );
         LOG_ERROR << errorString;
         dispatchToMainThread( [ errorString ]() {
             IssueReporter::askUserAndReportIssue( IssueTemplate::Exception, errorString );
@@ -755,27 +2619,46 @@ OperationResult FullIndexOperation::run()
     }
 }
 
-OperationResult PartialIndexOperation::run()
+// Called in the worker thread's context
+OperationResult DifferentialIndexOperation::run()
 {
     try {
-        LOG_INFO << "PartialIndexOperation::run(), file " << fileName_.toStdString();
+        LOG_INFO << "DifferentialIndexOperation::run(), file " << fileName_.toStdString();
 
-        const auto initialPosition
-            = OffsetInFile( IndexingData::ConstAccessor{ indexing_data_.get() }.getIndexedSize() );
+        Q_EMIT indexingProgressed( 0 );
 
-        LOG_INFO << "PartialIndexOperation: Starting the count at " << initialPosition << " ...";
+        if ( !truncateModifiedIndex() && !interruptRequest_ ) {
+            LOG_INFO << "DifferentialIndexOperation: no unmodified data, reindexing all";
 
-        Q_EMIT indexingProgressed( 0 );
+            IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+            const auto forcedEncoding = scopedAccessor.getForcedEncoding();
+            scopedAccessor.clear();
+            scopedAccessor.forceEncoding( forcedEncoding );
+        }
 
-        doIndex( initialPosition );
+        if ( !interruptRequest_ ) {
+            OffsetInFile initialPosition;
+            LinesCount keptLines;
+            {
+                IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+                initialPosition = OffsetInFile( scopedAccessor.getIndexedSize() );
+                keptLines = scopedAccessor.getNbLines();
+            }
+            Q_EMIT indexTruncated( keptLines );
 
-        LOG_INFO << "PartialIndexOperation: ... finished counting.";
+            LOG_INFO << "DifferentialIndexOperation: reindexing from " << initialPosition;
+            doIndex( initialPosition );
+        }
+
+        LOG_INFO << "DifferentialIndexOperation: ... finished, interrupt = "
+                 << static_cast<bool>( interruptRequest_ );
 
         const auto result = interruptRequest_ ? false : true;
         Q_EMIT indexingFinished( result );
         return result;
     } catch ( const std::exception& err ) {
-        const auto errorString = QString( "PartialIndexOperation failed: %1" ).arg( err.what() );
+        const auto errorString
+            = QString( "DifferentialIndexOperation failed: %1" ).arg( err.what() );
         LOG_ERROR << errorString;
         dispatchToMainThread( [ errorString ]() {
             IssueReporter::askUserAndReportIssue( IssueTemplate::Exception, errorString );
@@ -786,16 +2669,158 @@ OperationResult PartialIndexOperation::run()
             scopedAccessor.clear();
         }
 
+        Q_EMIT indexTruncated( 0_lcount );
         Q_EMIT indexingFinished( false );
         return false;
     }
 }
 
+bool DifferentialIndexOperation::truncateModifiedIndex()
+{
+    IndexedHash indexedHash;
+    BlockDigests blockDigests;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        indexedHash = scopedAccessor.getHash();
+        blockDigests = scopedAccessor.getBlockDigests();
+
+        if ( scopedAccessor.isFastModificationDetectionUsed()
+             || scopedAccessor.getFirstLineOffset().get() != 0
+             || blockDigests.size() != indexedHash.size || indexedHash.size == 0 ) {
+            return false;
+        }
+    }
+
+    ChainedFile file( fileName_, fileChain_ );
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        LOG_WARNING << "Cannot open file " << fileName_.toStdString();
+        return false;
+    }
+
+    // Full digest state at the beginning of each checked block,
+    // used to restore it at the end of the last kept line.
+    klogg::vector<QByteArray> digestStates;
+    FileDigest fullDigest;
+
+    const auto blockSize = blockDigests.blockSize();
+    const auto blocksCount = blockDigests.blocksCount();
+    QByteArray buffer{ static_cast<int>( blockSize ), Qt::Uninitialized };
+
+    size_t modifiedBlock = 0;
+    for ( ; modifiedBlock < blocksCount; ++modifiedBlock ) {
+        if ( interruptRequest_ ) {
+            return false;
+        }
+
+        digestStates.push_back( fullDigest.state() );
+
+        const auto blockOffset = static_cast<qint64>( modifiedBlock ) * blockSize;
+        const auto blockLength = std::min( blockSize, indexedHash.size - blockOffset );
+        const auto readSize = file.read( buffer.data(), blockLength );
+        if ( readSize != blockLength ) {
+            break;
+        }
+
+        FileDigest blockDigest;
+        blockDigest.addData( buffer.data(), static_cast<size_t>( readSize ) );
+        if ( blockDigest.digest() != blockDigests.digest( modifiedBlock ) ) {
+            break;
+        }
+
+        fullDigest.addData( buffer.data(), static_cast<size_t>( readSize ) );
+    }
+
+    if ( modifiedBlock == blocksCount ) {
+        LOG_INFO << "No modified block, index is kept";
+        return true;
+    }
+
+    LOG_INFO << "First modified block " << modifiedBlock << " of " << blocksCount;
+
+    // Lines ending in modified block are indexed again
+    const auto modifiedOffset = OffsetInFile( static_cast<qint64>( modifiedBlock ) * blockSize );
+    LinesCount keptLines;
+    OffsetInFile keptSize;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+
+        auto first = LinesCount::UnderlyingType{ 0 };
+        auto last = scopedAccessor.getNbLines().get();
+        while ( first < last ) {
+            const auto middle = first + ( last - first ) / 2;
+            if ( scopedAccessor.getEndOfLineOffset( LineNumber( middle ) ) <= modifiedOffset ) {
+                first = middle + 1;
+            }
+            else {
+                last = middle;
+            }
+        }
+
+        keptLines = LinesCount( first );
+        if ( keptLines.get() > 0 ) {
+            keptSize = scopedAccessor.getEndOfLineOffset( LineNumber( first - 1 ) );
+        }
+    }
+
+    if ( keptLines.get() == 0 ) {
+        return false;
+    }
+
+    // Digests are continued from the beginning of the block holding the end of kept data
+    const auto keptBlock = static_cast<size_t>( keptSize.get() / blockSize );
+    fullDigest.restoreState( digestStates[ keptBlock ] );
+    blockDigests.truncate( keptBlock );
+
+    const auto keptBlockOffset = static_cast<qint64>( keptBlock ) * blockSize;
+    file.seek( keptBlockOffset );
+    const auto keptBlockLength = keptSize.get() - keptBlockOffset;
+    if ( file.read( buffer.data(), keptBlockLength ) != keptBlockLength ) {
+        return false;
+    }
+    fullDigest.addData( buffer.data(), static_cast<size_t>( keptBlockLength ) );
+    blockDigests.addData( buffer.data(), static_cast<size_t>( keptBlockLength ) );
+
+    LOG_INFO << "Keeping " << keptLines << " lines up to " << keptSize;
+
+    IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+    scopedAccessor.truncateIndex( keptLines, fullDigest.state(), blockDigests );
+    return true;
+}
+
+// Called in the worker thread's context
+OperationResult AppendIndexOperation::run()
+{
+    try {
+        const auto status = indexAppendedData( followedFile_ );
+        if ( status ) {
+            followedFile_.reset();
+            Q_EMIT fileCheckFinished( *status );
+            return *status;
+        }
+
+        if ( Configuration::get().keepFileClosed() ) {
+            followedFile_.file.close();
+        }
+
+        Q_EMIT indexingFinished( true );
+        return true;
+    } catch ( const std::exception& err ) {
+        const auto errorString = QString( "AppendIndexOperation failed: %1" ).arg( err.what() );
+        LOG_ERROR << errorString;
+        dispatchToMainThread( [ errorString ]() {
+            IssueReporter::askUserAndReportIssue( IssueTemplate::Exception, errorString );
+        } );
+        followedFile_.reset();
+        Q_EMIT fileCheckFinished( MonitoredFileStatus::Truncated );
+        return MonitoredFileStatus::Truncated;
+    }
+}
+
 OperationResult CheckFileChangesOperation::run()
 {
     try {
         LOG_INFO << "CheckFileChangesOperation::run(), file " << fileName_.toStdString();
-        const auto result = doCheckFileChanges();
+        const auto result = checkFileChanges();
         Q_EMIT fileCheckFinished( result );
         return result;
     } catch ( const std::exception& err ) {
@@ -810,23 +2835,40 @@ OperationResult CheckFileChangesOperation::run()
     }
 }
 
-MonitoredFileStatus CheckFileChangesOperation::doCheckFileChanges()
+MonitoredFileStatus IndexOperation::checkFileChanges() const
 {
     QFileInfo info( fileName_ );
-    const auto indexedHash = IndexingData::ConstAccessor{ indexing_data_.get() }.getHash();
-    const auto realFileSize = info.size();
+    IndexedHash indexedHash;
+    BlockDigests blockDigests;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        indexedHash = scopedAccessor.getHash();
+        blockDigests = scopedAccessor.getBlockDigests();
+    }
+    // Chained files are part of the data before the file
+    const auto chainedSize = fileChain_ ? FileChain::size( *fileChain_->segments() ) : 0;
+    const auto compressedAccess = fileChain_ ? fileChain_->compressedAccess() : nullptr;
+    const auto realFileSize
+        = chainedSize + ( compressedAccess ? compressedAccess->size() : info.size() );
 
-    if ( realFileSize == 0 || realFileSize < indexedHash.size ) {
+    const auto& config = Configuration::get();
+    const auto hasBlockDigests = !config.fastModificationDetection()
+                                 && blockDigests.size() == indexedHash.size
+                                 && indexedHash.size > 0;
+
+    // Data after the beginning of the file can be reindexed
+    // separately, even if the file became smaller
+    if ( realFileSize == 0 || ( realFileSize < indexedHash.size && !hasBlockDigests ) ) {
         LOG_INFO << "File truncated";
         return MonitoredFileStatus::Truncated;
     }
     else {
-        QFile file( fileName_ );
+        ChainedFile file( fileName_, fileChain_ );
 
         QByteArray buffer{ IndexingBlockSize, Qt::Uninitialized };
 
         bool isFileModified = false;
-        const auto& config = Configuration::get();
+        bool isBeginningModified = true;
 
         if ( !file.isOpen() && !file.open( QIODevice::ReadOnly ) ) {
             LOG_INFO << "File failed to open";
@@ -871,6 +2913,37 @@ MonitoredFileStatus CheckFileChangesOperation::doCheckFileChanges()
                 isFileModified = tailDigest != indexedHash.tailDigest;
             }
         }
+        else if ( hasBlockDigests ) {
+            const auto blocksCount = blockDigests.blocksCount();
+            const auto isBlockModified = [ & ]( size_t block ) {
+                const auto blockOffset = static_cast<qint64>( block ) * blockDigests.blockSize();
+                file.seek( blockOffset );
+                return getDigest( std::min( blockDigests.blockSize(),
+                                            indexedHash.size - blockOffset ) )
+                       != blockDigests.digest( block );
+            };
+
+            isBeginningModified = isBlockModified( 0 );
+            isFileModified = isBeginningModified || realFileSize < indexedHash.size;
+
+            if ( realFileSize > indexedHash.size ) {
+                // Growing file, only the beginning and the end of indexed data are checked
+                const auto firstTailBlock
+                    = blocksCount > CheckedTailBlocks ? blocksCount - CheckedTailBlocks : 0;
+                for ( auto block = std::max( firstTailBlock, size_t{ 1 } );
+                      block < blocksCount && !isFileModified; ++block ) {
+                    isFileModified = isBlockModified( block );
+                }
+            }
+            else {
+                for ( size_t block = 1; block < blocksCount && !isFileModified; ++block ) {
+                    isFileModified = isBlockModified( block );
+                    if ( isFileModified ) {
+                        LOG_INFO << "First modified block " << block;
+                    }
+                }
+            }
+        }
         else {
 
             const auto realHashDigest = getDigest( indexedHash.size );
@@ -881,7 +2954,11 @@ MonitoredFileStatus CheckFileChangesOperation::doCheckFileChanges()
             isFileModified = realHashDigest != indexedHash.fullDigest;
         }
 
-        if ( isFileModified ) {
+        if ( isFileModified && !isBeginningModified ) {
+            LOG_INFO << "File changed after the beginning of indexed range";
+            return MonitoredFileStatus::Modified;
+        }
+        else if ( isFileModified ) {
             LOG_INFO << "File changed in indexed range";
             return MonitoredFileStatus::Truncated;
         }
@@ -895,3 +2972,192 @@ MonitoredFileStatus CheckFileChangesOperation::doCheckFileChanges()
         }
     }
 }
+
+std::optional<MonitoredFileStatus> IndexOperation::indexAppendedData( FollowedFile& followedFile )
+{
+    using namespace std::chrono;
+    using clock = high_resolution_clock;
+    const auto startTime = clock::now();
+
+    IndexedHash indexedHash;
+    IndexingCheckpoint checkpoint;
+    IndexingState state;
+    std::unique_ptr<FileDigest> fullDigest;
+    std::unique_ptr<BlockDigests> blockDigests;
+    std::shared_ptr<TrigramIndex> trigramIndex;
+    std::shared_ptr<TokenFilters> tokenFilters;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        indexedHash = scopedAccessor.getHash();
+        checkpoint = scopedAccessor.getCheckpoint();
+
+        state.fileTextCodec = scopedAccessor.getForcedEncoding();
+        if ( !state.fileTextCodec ) {
+            state.fileTextCodec = scopedAccessor.getEncodingGuess();
+        }
+        state.encodingGuess = scopedAccessor.getEncodingGuess();
+
+        if ( !scopedAccessor.isFastModificationDetectionUsed() ) {
+            fullDigest = std::make_unique<FileDigest>();
+            fullDigest->restoreState( scopedAccessor.getHashBuilderState() );
+
+            blockDigests = std::make_unique<BlockDigests>( scopedAccessor.getBlockDigests() );
+            if ( blockDigests->size() != indexedHash.size ) {
+                blockDigests.reset();
+            }
+        }
+
+        trigramIndex = scopedAccessor.getTrigramIndex();
+        tokenFilters = scopedAccessor.getTokenFilters();
+    }
+
+    // Interrupted indexing and tail hash not ending with indexed data are left to the full check
+    const auto indexedSize = indexedHash.size;
+    if ( checkpoint.isInterrupted || indexedSize == 0 || state.fileTextCodec == nullptr
+         || indexedHash.tailOffset + indexedHash.tailSize != indexedSize ) {
+        return checkFileChanges();
+    }
+
+    auto& file = followedFile.file;
+    if ( file.fileName() != fileName_ ) {
+        followedFile.reset();
+        file.setFile( fileName_, fileChain_ );
+    }
+    if ( !( file.isOpen() || file.open( QIODevice::ReadOnly ) ) ) {
+        return checkFileChanges();
+    }
+
+    const auto fileSize = file.size();
+    const auto appendedSize = fileSize - indexedSize;
+    if ( appendedSize <= 0 || appendedSize > FollowedAppendMaxSize ) {
+        return checkFileChanges();
+    }
+
+    // Tail is read and checked once when the file starts growing,
+    // then only its end is compared with the file before each append.
+    auto& tail = followedFile.tail;
+    if ( followedFile.tailOffset != indexedHash.tailOffset
+         || tail.size() != indexedHash.tailSize ) {
+        tail.resize( static_cast<int>( indexedHash.tailSize ) );
+        followedFile.tailOffset = indexedHash.tailOffset;
+
+        const auto isTailRead = file.seek( indexedHash.tailOffset )
+                                && file.read( tail.data(), tail.size() ) == tail.size();
+
+        FileDigest tailDigest;
+        tailDigest.addData( tail.data(), static_cast<size_t>( tail.size() ) );
+        if ( !isTailRead || tailDigest.digest() != indexedHash.tailDigest ) {
+            LOG_INFO << "Followed file tail changed";
+            return checkFileChanges();
+        }
+    }
+    else {
+        const auto guardSize = std::min( FollowedGuardSize, static_cast<qint64>( tail.size() ) );
+        auto& guard = followedFile.buffer;
+        guard.resize( static_cast<size_t>( guardSize ) );
+        if ( !file.seek( indexedSize - guardSize )
+             || file.read( guard.data(), guardSize ) != guardSize
+             || std::memcmp( guard.data(), tail.data() + tail.size() - guardSize,
+                             static_cast<size_t>( guardSize ) )
+                    != 0 ) {
+            LOG_INFO << "Followed file tail changed";
+            return checkFileChanges();
+        }
+    }
+
+    BlockContent content;
+    content.buffer.swap( followedFile.buffer );
+    content.buffer.resize( static_cast<size_t>( appendedSize ) );
+    const auto readSize = file.seek( indexedSize )
+                              ? file.read( content.buffer.data(), appendedSize )
+                              : qint64{ -1 };
+    if ( readSize <= 0 ) {
+        followedFile.buffer.swap( content.buffer );
+        return checkFileChanges();
+    }
+    content.data = std::string_view( content.buffer.data(), static_cast<size_t>( readSize ) );
+
+    // Line not terminated in indexed data is parsed again from its beginning
+    state.pos = indexedSize;
+    state.file_size = indexedSize + readSize;
+    if ( checkpoint.lineStart < state.pos ) {
+        state.pos = checkpoint.lineStart;
+        state.additional_spaces = checkpoint.additionalSpaces;
+    }
+    state.expand_tabs = !Configuration::get().useLazyTabExpansion();
+
+    if ( fullDigest ) {
+        fullDigest->addData( content.data.data(), content.data.size() );
+        if ( blockDigests ) {
+            blockDigests->addData( content.data.data(), content.data.size() );
+        }
+    }
+
+    // Indexes of searched data are dropped if they can't continue
+    if ( trigramIndex && trigramIndex->endOffset() != indexedSize ) {
+        trigramIndex.reset();
+        IndexingData::MutateAccessor{ indexing_data_.get() }.setTrigramIndex( nullptr );
+    }
+    if ( trigramIndex ) {
+        trigramIndex->addBlock( indexedSize, content.data );
+    }
+    if ( tokenFilters && tokenFilters->endOffset() != indexedSize ) {
+        tokenFilters.reset();
+        IndexingData::MutateAccessor{ indexing_data_.get() }.setTokenFilters( nullptr );
+    }
+    if ( tokenFilters ) {
+        tokenFilters->addBlock( indexedSize, content.data );
+    }
+
+    indexNextBlock( state, { indexedSize, &content } );
+
+    if ( !state.expand_tabs ) {
+        expandTabsInRecordedBlocks( state );
+    }
+
+    // Header covers the beginning of the file while it is smaller than a block
+    const auto newTailSize = std::min( tail.size() + content.data.size(),
+                                       static_cast<size_t>( IndexingBlockSize ) );
+    const auto droppedSize = tail.size() + content.data.size() - newTailSize;
+    tail.append( content.data.data(), static_cast<int>( content.data.size() ) );
+    std::optional<FileDigest> headerDigest;
+    if ( indexedHash.headerSize < IndexingBlockSize && indexedHash.tailOffset == 0 ) {
+        headerDigest.emplace();
+        headerDigest->addData( tail.data(), newTailSize );
+    }
+    tail.remove( 0, static_cast<int>( droppedSize ) );
+    followedFile.tailOffset += static_cast<qint64>( droppedSize );
+
+    FileDigest tailDigest;
+    tailDigest.addData( tail.data(), static_cast<size_t>( tail.size() ) );
+
+    followedFile.buffer.swap( content.buffer );
+
+    IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+
+    if ( fullDigest ) {
+        scopedAccessor.setHashBuilderState( fullDigest->state() );
+        scopedAccessor.setBlockDigests( blockDigests ? *blockDigests : BlockDigests{} );
+    }
+
+    if ( state.file_size > state.pos ) {
+        FastLinePositionArray line_position;
+        line_position.append( OffsetInFile( state.file_size + 1 ) );
+        line_position.setFakeFinalLF();
+
+        scopedAccessor.addAll( {}, 0_length, line_position, {}, state.encodingGuess );
+    }
+
+    scopedAccessor.setCheckpoint( state.additional_spaces, false );
+
+    if ( headerDigest ) {
+        scopedAccessor.setHeaderHash( headerDigest->digest(),
+                                      static_cast<qint64>( newTailSize ) );
+    }
+    scopedAccessor.setTailHash( tailDigest.digest(), followedFile.tailOffset, tail.size() );
+
+    LOG_DEBUG << "Appended " << readSize << " bytes indexed in "
+              << duration_cast<microseconds>( clock::now() - startTime );
+
+    return {};
+}
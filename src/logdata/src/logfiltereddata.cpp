@@ -42,27 +42,59 @@
 
 #include "log.h"
 
-#include <KDSignalThrottler.h>
 #include <QString>
 #include <QTimer>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <functional>
-#include <numeric>
+#include <iterator>
+#include <limits>
 #include <tuple>
+#include <unordered_set>
 #include <vector>
 
 #include "logdata.h"
 #include "logfiltereddata.h"
 
+#include "backgroundrelease.h"
 #include "configuration.h"
+#include "linesorter.h"
+#include "memorygovernor.h"
 #include "readablesize.h"
 #include "synchronization.h"
 
+namespace {
+std::atomic<uint64_t> SessionSearchResultsCacheBytes{ 0 };
+
+// Filtered data of all open files, their caches share the memory limit.
+// Caches are only changed by the GUI thread.
+std::unordered_set<LogFilteredData*> SessionFilteredData;
+// Uses of all caches, so their results can be compared
+uint64_t SearchResultsCacheUses = 0;
+
+// Files of mapped results are kept in the cache directory
+constexpr size_t MaxMappedSearchResults = 4;
+
+// Lines prefetched before the view has read any, about a page of the view
+constexpr LinesCount::UnderlyingType DefaultPrefetchLines = 64;
+// Larger ranges, e.g. copied selection, don't move the view
+constexpr LinesCount::UnderlyingType MaxPrefetchLines = 1024;
+
+// Results shared with others are copied before they are changed
+SearchResultArray& writable( std::shared_ptr<SearchResultArray>& results )
+{
+    if ( results.use_count() > 1 ) {
+        results = std::make_shared<SearchResultArray>( *results );
+    }
+    return *results;
+}
+} // namespace
+
 // Usual constructor: just copy the data, the search is started by runSearch()
 LogFilteredData::LogFilteredData( const LogData* logData )
     : AbstractLogData()
-    , matching_lines_( SearchResultArray() )
     , currentRegExp_()
     , visibility_()
     , workerThread_( *logData )
@@ -71,6 +103,10 @@ LogFilteredData::LogFilteredData( const LogData* logData )
     maxLength_ = 0_length;
     maxLengthMarks_ = 0_length;
     nbLinesProcessed_ = 0_lcount;
+    contextLines_ = 0_lcount;
+    linesWithContextNbLines_ = 0_lcount;
+    shownFirstLine_ = 0_lnum;
+    shownLines_ = 0_lcount;
 
     sourceLogData_ = logData;
 
@@ -80,12 +116,81 @@ LogFilteredData::LogFilteredData( const LogData* logData )
     connect( &workerThread_, &LogFilteredDataWorker::searchProgressed, this,
              &LogFilteredData::handleSearchProgressed );
 
-    searchProgressThrottler_.setTimeout( 100 );
-    connect( this, &LogFilteredData::searchProgressedThrottled, &searchProgressThrottler_,
-             &KDToolBox::KDGenericSignalThrottler::throttle );
+    // Progress of blocks is polled, the worker signals only the end of searches
+    connect( &searchProgressTimer_, &QTimer::timeout, this, &LogFilteredData::pollSearchProgress );
+    searchProgressTimer_.setInterval( OperationProgress::PollIntervalMs );
+
+    // Results of the current search are kept
+    auto& memoryGovernor = MemoryGovernor::get();
+    memoryGovernor.addCache( this, sourceLogData_, MemoryGovernor::Kind::SearchCache,
+                             { [ this ] { return searchResultsCacheBytes_; },
+                               [ this ] {
+                                 evictSearchResults( 0, std::numeric_limits<uint64_t>::max() );
+                             } } );
+
+    memoryGovernor.addUsage( this, sourceLogData_, MemoryGovernor::Kind::SearchResults, [ this ] {
+        auto bytes = matching_lines_->getSizeInBytes( false ) + marks_.getSizeInBytes( false );
+        if ( marks_and_matches_ != matching_lines_ ) {
+            bytes += marks_and_matches_->getSizeInBytes( false );
+        }
+        return static_cast<uint64_t>( bytes );
+    } );
+    memoryGovernor.addUsage( this, sourceLogData_, MemoryGovernor::Kind::RegexEngine,
+                             [ this ] { return workerThread_.matchersSize(); } );
+
+    SessionFilteredData.insert( this );
+}
+
+LogFilteredData::~LogFilteredData()
+{
+    MemoryGovernor::get().removeCaches( this );
+    SessionFilteredData.erase( this );
+    SessionSearchResultsCacheBytes -= searchResultsCacheBytes_;
+
+    // Results of large files take long to free
+    auto& backgroundRelease = BackgroundRelease::get();
+    backgroundRelease.release( std::move( matching_lines_ ) );
+    backgroundRelease.release( std::move( marks_and_matches_ ) );
+    backgroundRelease.release( std::move( refineBase_ ) );
+    backgroundRelease.releaseValue( std::move( marks_ ) );
+    backgroundRelease.releaseValue( std::move( searchResultsCache_ ) );
+}
+
+uint64_t LogFilteredData::searchResultsCacheBytes()
+{
+    return SessionSearchResultsCacheBytes;
+}
 
-    connect( &searchProgressThrottler_, &KDToolBox::KDGenericSignalThrottler::triggered, this,
-             &LogFilteredData::handleSearchProgressedThrottled );
+bool LogFilteredData::hasCachedSearchResults( const RegularExpressionPattern& regExp,
+                                              LineNumber startLine, LineNumber endLine ) const
+{
+    return !searchedLines_
+           && searchResultsCache_.count( std::make_tuple( regExp, startLine.get(), endLine.get() ) )
+           > 0;
+}
+
+void LogFilteredData::takeCachedSearchResults( LogFilteredData& other )
+{
+    const auto& config = Configuration::get();
+    if ( !config.useSearchResultsCache() || &other == this ) {
+        return;
+    }
+
+    for ( auto& [ key, cachedResult ] : other.searchResultsCache_ ) {
+        auto& ownResult = searchResultsCache_[ key ];
+        searchResultsCacheBytes_ = searchResultsCacheBytes_ - ownResult.bytes + cachedResult.bytes;
+        SessionSearchResultsCacheBytes -= ownResult.bytes;
+        ownResult = std::move( cachedResult );
+        ownResult.lastUse = ++SearchResultsCacheUses;
+    }
+
+    // Bytes of the moved results are now counted by this cache
+    other.searchResultsCache_.clear();
+    other.searchResultsCacheBytes_ = 0;
+
+    evictSearchResults( config.searchResultsCacheLines(),
+                        static_cast<uint64_t>( config.searchResultsCacheSizeMb() ) * 1024 * 1024 );
+    evictMappedSearchResults( MaxMappedSearchResults );
 }
 
 void LogFilteredData::runSearch( const RegularExpressionPattern& regExp )
@@ -95,7 +200,7 @@ void LogFilteredData::runSearch( const RegularExpressionPattern& regExp )
 
 // Run the search and send newDataAvailable() signals.
 void LogFilteredData::runSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
-                                 LineNumber endLine )
+                                 LineNumber endLine, OptionalLineNumber focusLine )
 {
     LOG_DEBUG << "Entering runSearch";
 
@@ -108,35 +213,166 @@ void LogFilteredData::runSearch( const RegularExpressionPattern& regExp, LineNum
              << endLine.get();
 
     bool shouldRunSearch = true;
-    if ( config.useSearchResultsCache() ) {
-        const auto cachedResults = searchResultsCache_.find( currentSearchKey_ );
+    if ( config.useSearchResultsCache() && !searchedLines_ ) {
+        auto cachedResults = searchResultsCache_.find( currentSearchKey_ );
+        if ( cachedResults != std::end( searchResultsCache_ ) && cachedResults->second.mapped
+             && !cachedResults->second.matching_lines ) {
+            auto mappedLines = cachedResults->second.mapped->load();
+            if ( mappedLines ) {
+                cachedResults->second.matching_lines
+                    = std::make_shared<SearchResultArray>( std::move( *mappedLines ) );
+            }
+            else {
+                searchResultsCache_.erase( cachedResults );
+                cachedResults = std::end( searchResultsCache_ );
+            }
+        }
+
         if ( cachedResults != std::end( searchResultsCache_ ) ) {
             LOG_INFO << "Got result from cache";
             shouldRunSearch = false;
+            cachedResults->second.lastUse = ++SearchResultsCacheUses;
             matching_lines_ = cachedResults->second.matching_lines;
             maxLength_ = cachedResults->second.maxLength;
+            timeHistogram_ = cachedResults->second.timeHistogram;
 
-            marks_and_matches_ = matching_lines_ | marks_;
+            updateMarksAndMatches();
 
-            Q_EMIT searchProgressed( LinesCount( matching_lines_.cardinality() ), 100, startLine );
+            Q_EMIT searchProgressed( LinesCount( matching_lines_->cardinality() ), 100, startLine );
+        }
+        else if ( config.keepSearchResultsOnDisk() ) {
+            shouldRunSearch = !restoreSavedSearchResults( startLine, endLine );
         }
     }
 
-    if ( shouldRunSearch ) {
+    if ( shouldRunSearch && canRefineSearch( regExp, startLine, endLine ) ) {
+        LOG_INFO << "Refining results of " << std::get<0>( refineBaseKey_ ).pattern;
+        attachReader();
+        workerThread_.refineSearch( currentRegExp_, startLine, endLine, refineBase_ );
+        pollSearchProgressUntilEnd();
+    }
+    else if ( shouldRunSearch ) {
         attachReader();
-        workerThread_.search( currentRegExp_, startLine, endLine );
+        workerThread_.search( currentRegExp_, startLine, endLine, focusLine );
+        pollSearchProgressUntilEnd();
     }
 }
 
+void LogFilteredData::setSearchedLines( std::shared_ptr<const SearchResultArray> lines )
+{
+    // Results of other lines are not a base to refine the next searches
+    refineBase_.reset();
+    currentSearchKey_ = {};
+
+    searchedLines_ = std::move( lines );
+    workerThread_.setSearchedLines( searchedLines_ );
+}
+
+std::shared_ptr<const SearchResultArray> LogFilteredData::searchedLines() const
+{
+    return searchedLines_;
+}
+
+bool LogFilteredData::canRefineSearch( const RegularExpressionPattern& regExp,
+                                       LineNumber startLine, LineNumber endLine ) const
+{
+    return refineBase_ && std::get<1>( refineBaseKey_ ) == startLine.get()
+           && std::get<2>( refineBaseKey_ ) == endLine.get()
+           && regExp.narrows( std::get<0>( refineBaseKey_ ) );
+}
+
+bool LogFilteredData::isSearchComplete() const
+{
+    if ( countBuckets_ || currentSearchKey_ == SearchCacheKey{} ) {
+        return false;
+    }
+
+    // Results taken from the cache are complete without being searched
+    const auto cachedResults = searchResultsCache_.find( currentSearchKey_ );
+    return nbLinesProcessed_.get() == getExpectedSearchEnd( currentSearchKey_ ).get()
+           || ( cachedResults != std::end( searchResultsCache_ )
+                && cachedResults->second.matching_lines == matching_lines_ );
+}
+
+void LogFilteredData::runCount( const RegularExpressionPattern& regExp, LineNumber startLine,
+                                LineNumber endLine, size_t bucketsCount )
+{
+    LOG_DEBUG << "Entering runCount";
+
+    clearSearch();
+    currentRegExp_ = regExp;
+    countBuckets_ = bucketsCount;
+    // Counts are not cached
+    currentSearchKey_ = {};
+
+    attachReader();
+    workerThread_.countMatches( currentRegExp_, startLine, endLine,
+                                MatchCounts( getNbTotalLines(), bucketsCount ) );
+    pollSearchProgressUntilEnd();
+}
+
+bool LogFilteredData::isCountOnly() const
+{
+    return countBuckets_.has_value();
+}
+
+MatchCounts LogFilteredData::getMatchCounts() const
+{
+    return matchCounts_;
+}
+
+TimeHistogram LogFilteredData::getTimeHistogram() const
+{
+    return timeHistogram_;
+}
+
 void LogFilteredData::updateSearch( LineNumber startLine, LineNumber endLine )
 {
     LOG_DEBUG << "Entering updateSearch";
 
+    if ( countBuckets_ && matchCounts_.countedLines.get() == 0 ) {
+        const auto regExp = currentRegExp_;
+        runCount( regExp, startLine, endLine, *countBuckets_ );
+        return;
+    }
+
+    // Only lines after the counted ones are counted
+    if ( countBuckets_ ) {
+        attachReader();
+        workerThread_.countMatches( currentRegExp_, startLine, endLine, matchCounts_ );
+        pollSearchProgressUntilEnd();
+        return;
+    }
+
     currentSearchKey_ = {};
 
+    // Shown lines have no pattern to search for
+    if ( currentRegExp_.pattern.isEmpty() ) {
+        Q_EMIT searchProgressed( getNbMatches(), 100, startLine );
+        return;
+    }
+
     attachReader();
     workerThread_.updateSearch( currentRegExp_, startLine, endLine,
                                 LineNumber( nbLinesProcessed_.get() ) );
+    pollSearchProgressUntilEnd();
+}
+
+void LogFilteredData::showLines( SearchResultArray lines, std::shared_ptr<const LineOrder> order )
+{
+    LOG_DEBUG << "Entering showLines";
+
+    clearSearch();
+
+    const auto nbMatches = LinesCount( lines.cardinality() );
+    matching_lines_ = std::make_shared<SearchResultArray>( std::move( lines ) );
+    updateMarksAndMatches();
+    order_ = std::move( order );
+    orderMatchesGeneration_ = matchesGeneration_;
+    maxLength_ = sourceLogData_->getMaxLength();
+    nbLinesProcessed_ = sourceLogData_->getNbLine();
+
+    Q_EMIT searchProgressed( nbMatches, 100, 0_lnum );
 }
 
 void LogFilteredData::interruptSearch()
@@ -150,22 +386,64 @@ void LogFilteredData::clearSearch( bool dropCache )
 {
     interruptSearch();
 
+    if ( isSearchComplete() ) {
+        refineBaseKey_ = currentSearchKey_;
+        refineBase_ = matching_lines_;
+    }
+
     currentRegExp_ = {};
-    matching_lines_ = {};
-    marks_and_matches_ = marks_;
+    currentSearchKey_ = {};
+    countBuckets_ = {};
+    matchCounts_ = {};
+    timeHistogram_.clear();
+    matching_lines_ = std::make_shared<SearchResultArray>();
+    releaseMappedSearchResults();
+    updateMarksAndMatches();
     maxLength_ = 0_length;
     nbLinesProcessed_ = 0_lcount;
+    firstNewMatch_ = {};
+    order_.reset();
 
     if ( dropCache ) {
-        searchResultsCache_.clear();
+        refineBase_.reset();
+        clearSearchResultsCache();
     }
 }
 
+void LogFilteredData::truncateSearch( LineNumber firstModifiedLine )
+{
+    interruptSearch();
+
+    changeMatches( [ firstModifiedLine ]( SearchResultArray& lines ) {
+        lines = linesBefore( lines, firstModifiedLine );
+    } );
+    marks_ = linesBefore( marks_, firstModifiedLine );
+    linesWithContext_.reset();
+    nbLinesProcessed_ = qMin( nbLinesProcessed_, LinesCount( firstModifiedLine.get() ) );
+    timeHistogram_.truncate( nbLinesProcessed_ );
+    // Counts of modified lines can't be removed, they are counted again
+    if ( firstModifiedLine.get() < matchCounts_.countedLines.get() ) {
+        matchCounts_.countedLines = 0_lcount;
+    }
+
+    workerThread_.truncateSearch( nbLinesProcessed_, LinesCount( matching_lines_->cardinality() ) );
+
+    // Cached results cover modified lines
+    refineBase_.reset();
+    clearSearchResultsCache();
+}
+
 LineNumber LogFilteredData::getMatchingLineNumber( LineNumber matchNum ) const
 {
     return findLogDataLine( matchNum );
 }
 
+klogg::vector<LineNumber> LogFilteredData::getMatchingLineNumbers( LineNumber first,
+                                                                  LinesCount number ) const
+{
+    return findLogDataLines( first, number );
+}
+
 LineNumber LogFilteredData::getLineIndexNumber( LineNumber lineNumber ) const
 {
     return findFilteredLine( lineNumber );
@@ -174,7 +452,12 @@ LineNumber LogFilteredData::getLineIndexNumber( LineNumber lineNumber ) const
 // Scan the list for the 'lineNumber' passed
 bool LogFilteredData::isLineMatched( LineNumber lineNumber ) const
 {
-    return matching_lines_.contains( lineNumber.get() );
+    return matching_lines_->contains( lineNumber.get() );
+}
+
+const LogData* LogFilteredData::getSourceLogData() const
+{
+    return sourceLogData_;
 }
 
 LinesCount LogFilteredData::getNbTotalLines() const
@@ -184,7 +467,12 @@ LinesCount LogFilteredData::getNbTotalLines() const
 
 LinesCount LogFilteredData::getNbMatches() const
 {
-    return LinesCount( matching_lines_.cardinality() );
+    return countBuckets_ ? matchCounts_.nbMatches : LinesCount( matching_lines_->cardinality() );
+}
+
+std::shared_ptr<const SearchResultArray> LogFilteredData::getMatchingLines() const
+{
+    return matching_lines_;
 }
 
 LinesCount LogFilteredData::getNbMarks() const
@@ -194,7 +482,40 @@ LinesCount LogFilteredData::getNbMarks() const
 
 LogFilteredData::LineType LogFilteredData::lineTypeByIndex( LineNumber index ) const
 {
-    return lineTypeByLine( findLogDataLine( index ) );
+    if ( contextLines_.get() == 0 ) {
+        return lineTypeByLine( findLogDataLine( index ) );
+    }
+
+    const auto lineTypes = lineTypesByIndex( index, 1_lcount );
+    return lineTypes.empty() ? LineType{ LineTypeFlags::Plain } : lineTypes.front();
+}
+
+klogg::vector<LogFilteredData::LineType> LogFilteredData::lineTypesByIndex( LineNumber first,
+                                                                           LinesCount number ) const
+{
+    const auto lines = findLogDataLines( first, number );
+
+    klogg::vector<LineType> lineTypes;
+    lineTypes.reserve( lines.size() );
+    for ( const auto line : lines ) {
+        lineTypes.push_back( lineTypeByLine( line ) );
+    }
+
+    // Groups of lines with their context are separated
+    if ( contextLines_.get() > 0 && !lines.empty() ) {
+        OptionalLineNumber previousLine;
+        if ( first.get() > 0 ) {
+            previousLine = findLogDataLine( first - 1_lcount );
+        }
+        for ( auto index = 0u; index < lines.size(); ++index ) {
+            if ( previousLine && lines[ index ] != *previousLine + 1_lcount ) {
+                lineTypes[ index ] |= LineTypeFlags::Gap;
+            }
+            previousLine = lines[ index ];
+        }
+    }
+
+    return lineTypes;
 }
 
 LogFilteredData::LineType LogFilteredData::lineTypeByLine( LineNumber lineNumber ) const
@@ -210,6 +531,30 @@ LogFilteredData::LineType LogFilteredData::lineTypeByLine( LineNumber lineNumber
     return line_type;
 }
 
+klogg::vector<LogFilteredData::LineType> LogFilteredData::lineTypesByLine( LineNumber first,
+                                                                          LinesCount number ) const
+{
+    klogg::vector<LineType> lineTypes( number.get(), LineType{ LineTypeFlags::Plain } );
+    const auto endLine = first.get() + number.get();
+
+    const auto addLines = [ &lineTypes, first, endLine ]( const SearchResultArray& lines,
+                                                          LineTypeFlags flag ) {
+        if ( lines.isEmpty() || lines.maximum() < first.get() ) {
+            return;
+        }
+
+        auto line = lines.begin();
+        line.move( first.get() );
+        for ( ; line != lines.end() && *line < endLine; ++line ) {
+            lineTypes[ *line - first.get() ] |= flag;
+        }
+    };
+    addLines( *matching_lines_, LineTypeFlags::Match );
+    addLines( marks_, LineTypeFlags::Mark );
+
+    return lineTypes;
+}
+
 void LogFilteredData::iterateOverLines( const std::function<void( LineNumber )>& callback ) const
 {
     using CallbackFn = std::function<void( LineNumber )>;
@@ -223,6 +568,34 @@ void LogFilteredData::iterateOverLines( const std::function<void( LineNumber )>&
         static_cast<void*>( const_cast<CallbackFn*>( &callback ) ) );
 }
 
+std::pair<LinesCount, LinesCount> LogFilteredData::getNbShownLinesBefore( LineNumber line ) const
+{
+    if ( line == 0_lnum ) {
+        return std::make_pair( 0_lcount, 0_lcount );
+    }
+
+    const auto lastLine = line.get() - 1;
+    const auto nbShownLines = currentResultArray().rank( lastLine );
+
+    // Shown marks are matches if the line also matches, whatever is shown
+    uint64_t nbMatches = 0;
+    if ( visibility_.testFlag( VisibilityFlags::Matches ) ) {
+        nbMatches = matching_lines_->rank( lastLine );
+    }
+    else if ( visibility_.testFlag( VisibilityFlags::Marks ) ) {
+        nbMatches = ( marks_ & *matching_lines_ ).rank( lastLine );
+    }
+
+    return std::make_pair( LinesCount( nbShownLines ), LinesCount( nbMatches ) );
+}
+
+OptionalLineNumber LogFilteredData::takeFirstNewMatch()
+{
+    OptionalLineNumber firstNewMatch;
+    std::swap( firstNewMatch, firstNewMatch_ );
+    return firstNewMatch;
+}
+
 // Delegation to our Marks object
 
 void LogFilteredData::toggleMark( LineNumber line )
@@ -296,7 +669,18 @@ void LogFilteredData::deleteMark( LineNumber line )
 void LogFilteredData::updateMaxLengthMarks( OptionalLineNumber added_line,
                                             OptionalLineNumber removed_line )
 {
-    marks_and_matches_ = matching_lines_ | marks_;
+    linesWithContext_.reset();
+
+    // Only the changed mark is updated in the union, it stays if the line is matched
+    if ( marks_.isEmpty() ) {
+        marks_and_matches_ = matching_lines_;
+    }
+    else if ( added_line.has_value() ) {
+        writable( marks_and_matches_ ).add( added_line->get() );
+    }
+    else if ( removed_line.has_value() && !matching_lines_->contains( removed_line->get() ) ) {
+        writable( marks_and_matches_ ).remove( removed_line->get() );
+    }
 
     if ( added_line.has_value() ) {
         maxLengthMarks_ = qMax( maxLengthMarks_, sourceLogData_->getLineLength( *added_line ) );
@@ -322,6 +706,8 @@ void LogFilteredData::updateMaxLengthMarks( OptionalLineNumber added_line,
 void LogFilteredData::clearMarks()
 {
     marks_ = {};
+    marks_and_matches_ = matching_lines_;
+    linesWithContext_.reset();
     maxLengthMarks_ = 0_length;
 }
 
@@ -341,6 +727,7 @@ QList<LineNumber> LogFilteredData::getMarks() const
 void LogFilteredData::setVisibility( Visibility visi )
 {
     visibility_ = visi;
+    linesWithContext_.reset();
 }
 
 LogFilteredData::Visibility LogFilteredData::visibility() const
@@ -348,49 +735,240 @@ LogFilteredData::Visibility LogFilteredData::visibility() const
     return visibility_;
 }
 
-void LogFilteredData::updateSearchResultsCache()
+void LogFilteredData::setContextLines( LinesCount contextLines )
+{
+    contextLines_ = contextLines;
+    linesWithContext_.reset();
+}
+
+LinesCount LogFilteredData::contextLines() const
+{
+    return contextLines_;
+}
+
+bool LogFilteredData::restoreSavedSearchResults( LineNumber startLine, LineNumber endLine )
+{
+    const auto content = sourceLogData_->getSearchedContent();
+    auto savedResults = loadCachedSearchResults( content, currentRegExp_, startLine );
+    if ( !savedResults || savedResults->endLine <= startLine || savedResults->endLine > endLine ) {
+        return false;
+    }
+
+    matching_lines_
+        = std::make_shared<SearchResultArray>( std::move( savedResults->matchingLines ) );
+    maxLength_ = savedResults->maxLength;
+    nbLinesProcessed_ = LinesCount( savedResults->endLine.get() );
+    updateMarksAndMatches();
+
+    const auto nbMatches = LinesCount( matching_lines_->cardinality() );
+    if ( savedResults->endLine == endLine ) {
+        LOG_INFO << "Got result from disk cache";
+        updateSearchResultsCache( false );
+        Q_EMIT searchProgressed( nbMatches, 100, startLine );
+        return true;
+    }
+
+    LOG_INFO << "Got result from disk cache, searching from line " << savedResults->endLine;
+    workerThread_.restoreSearch( maxLength_, nbLinesProcessed_, nbMatches );
+
+    attachReader();
+    workerThread_.updateSearch( currentRegExp_, startLine, endLine, savedResults->endLine );
+    pollSearchProgressUntilEnd();
+    return true;
+}
+
+void LogFilteredData::updateSearchResultsCache( bool saveToDisk )
 {
     const auto& config = Configuration::get();
     if ( !config.useSearchResultsCache() ) {
         return;
     }
 
+    // Keys are of searches of all lines
+    if ( searchedLines_ ) {
+        return;
+    }
+
     if ( currentSearchKey_ == SearchCacheKey{} ) {
         return;
     }
 
     const uint64_t maxCacheLines = config.searchResultsCacheLines();
+    const auto maxCacheBytes
+        = static_cast<uint64_t>( config.searchResultsCacheSizeMb() ) * 1024 * 1024;
+
+    // Run containers take much less memory for dense matches
+    changeMatches( []( SearchResultArray& lines ) {
+        lines.runOptimize();
+        lines.shrinkToFit();
+    } );
+    const auto& results = *matching_lines_;
+    const auto bytes = static_cast<uint64_t>( results.getSizeInBytes( false ) );
+
+    std::shared_ptr<const MappedSearchResults> mappedResults;
+    if ( ( results.cardinality() > maxCacheLines || bytes > maxCacheBytes )
+         && config.mapLargeSearchResults() ) {
+        mappedResults = MappedSearchResults::create( results );
+    }
+
+    if ( mappedResults ) {
+        LOG_INFO << "LogFilteredData: mapping results for key "
+                 << std::get<0>( currentSearchKey_ ).pattern << "_"
+                 << std::get<1>( currentSearchKey_ ) << "_" << std::get<2>( currentSearchKey_ )
+                 << ", " << readableSize( mappedResults->size() );
+
+        // Mapped results don't take memory of the cache
+        auto& cachedResult = searchResultsCache_[ currentSearchKey_ ];
+        searchResultsCacheBytes_ -= cachedResult.bytes;
+        SessionSearchResultsCacheBytes -= cachedResult.bytes;
+        cachedResult = { matching_lines_, maxLength_, 0, ++SearchResultsCacheUses,
+                         std::move( mappedResults ), timeHistogram_ };
 
-    if ( matching_lines_.cardinality() > maxCacheLines ) {
+        evictMappedSearchResults( MaxMappedSearchResults );
+    }
+    else if ( results.cardinality() > maxCacheLines || bytes > maxCacheBytes ) {
         LOG_DEBUG << "LogFilteredData: too many matches to place in cache";
     }
     else {
         LOG_INFO << "LogFilteredData: caching results for key "
                  << std::get<0>( currentSearchKey_ ).pattern << "_"
-                 << std::get<1>( currentSearchKey_ ) << "_" << std::get<2>( currentSearchKey_ );
+                 << std::get<1>( currentSearchKey_ ) << "_" << std::get<2>( currentSearchKey_ )
+                 << ", " << readableSize( bytes );
+
+        if ( saveToDisk && config.keepSearchResultsOnDisk() ) {
+            saveSearchResultsToCache( sourceLogData_->getSearchedContent(),
+                                      std::get<0>( currentSearchKey_ ),
+                                      LineNumber( std::get<1>( currentSearchKey_ ) ),
+                                      getExpectedSearchEnd( currentSearchKey_ ), results,
+                                      maxLength_ );
+        }
 
-        searchResultsCache_[ currentSearchKey_ ] = { matching_lines_, maxLength_ };
-        auto cacheSize = std::accumulate( searchResultsCache_.cbegin(), searchResultsCache_.cend(),
-                                          uint64_t{ 0 }, []( const auto& acc, const auto& next ) {
-                                              return acc + next.second.matching_lines.cardinality();
-                                          } );
+        auto& cachedResult = searchResultsCache_[ currentSearchKey_ ];
+        searchResultsCacheBytes_ = searchResultsCacheBytes_ - cachedResult.bytes + bytes;
+        SessionSearchResultsCacheBytes -= cachedResult.bytes;
+        SessionSearchResultsCacheBytes += bytes;
+        cachedResult
+            = { matching_lines_, maxLength_, bytes, ++SearchResultsCacheUses, {}, timeHistogram_ };
 
-        LOG_INFO << "LogFilteredData: cache size " << cacheSize;
+        evictSearchResults( maxCacheLines, maxCacheBytes );
 
-        auto cachedResult = std::begin( searchResultsCache_ );
-        while ( cachedResult != std::end( searchResultsCache_ ) && cacheSize > maxCacheLines ) {
+        LOG_INFO << "LogFilteredData: cache size " << readableSize( searchResultsCacheBytes_ )
+                 << " in " << searchResultsCache_.size() << " results";
+    }
+}
 
-            if ( cachedResult->first == currentSearchKey_ ) {
-                ++cachedResult;
+LogFilteredData::SearchResultsCache::iterator LogFilteredData::leastRecentlyUsedSearchResult()
+{
+    auto leastRecentlyUsed = std::end( searchResultsCache_ );
+    for ( auto cachedResult = std::begin( searchResultsCache_ );
+          cachedResult != std::end( searchResultsCache_ ); ++cachedResult ) {
+        if ( cachedResult->first != currentSearchKey_ && !cachedResult->second.mapped
+             && ( leastRecentlyUsed == std::end( searchResultsCache_ )
+                  || cachedResult->second.lastUse < leastRecentlyUsed->second.lastUse ) ) {
+            leastRecentlyUsed = cachedResult;
+        }
+    }
+    return leastRecentlyUsed;
+}
+
+void LogFilteredData::evictSearchResult( SearchResultsCache::iterator cachedResult )
+{
+    LOG_DEBUG << "LogFilteredData: evicting cached results for "
+              << std::get<0>( cachedResult->first ).pattern;
+
+    searchResultsCacheBytes_ -= cachedResult->second.bytes;
+    SessionSearchResultsCacheBytes -= cachedResult->second.bytes;
+    searchResultsCache_.erase( cachedResult );
+}
+
+void LogFilteredData::evictSearchResults( uint64_t maxLines, uint64_t maxBytes )
+{
+    // Mapped results are not counted, they are evicted separately
+    uint64_t cachedLines = 0;
+    for ( const auto& [ key, cachedResult ] : searchResultsCache_ ) {
+        if ( !cachedResult.mapped ) {
+            cachedLines += cachedResult.matching_lines->cardinality();
+        }
+    }
+
+    while ( cachedLines > maxLines ) {
+        const auto leastRecentlyUsed = leastRecentlyUsedSearchResult();
+        if ( leastRecentlyUsed == std::end( searchResultsCache_ ) ) {
+            break;
+        }
+
+        cachedLines -= leastRecentlyUsed->second.matching_lines->cardinality();
+        evictSearchResult( leastRecentlyUsed );
+    }
+
+    // Memory limit is shared with caches of other files
+    while ( SessionSearchResultsCacheBytes > maxBytes ) {
+        LogFilteredData* owner = nullptr;
+        SearchResultsCache::iterator leastRecentlyUsed;
+        for ( auto* filteredData : SessionFilteredData ) {
+            const auto cachedResult = filteredData->leastRecentlyUsedSearchResult();
+            if ( cachedResult == std::end( filteredData->searchResultsCache_ ) ) {
                 continue;
             }
+            if ( !owner || cachedResult->second.lastUse < leastRecentlyUsed->second.lastUse ) {
+                owner = filteredData;
+                leastRecentlyUsed = cachedResult;
+            }
+        }
 
-            cacheSize -= cachedResult->second.matching_lines.cardinality();
-            cachedResult = searchResultsCache_.erase( cachedResult );
+        if ( !owner ) {
+            break;
         }
+
+        owner->evictSearchResult( leastRecentlyUsed );
     }
 }
 
+void LogFilteredData::evictMappedSearchResults( size_t maxCount )
+{
+    auto mappedCount = static_cast<size_t>(
+        std::count_if( searchResultsCache_.cbegin(), searchResultsCache_.cend(),
+                       []( const auto& cachedResult ) { return !!cachedResult.second.mapped; } ) );
+
+    while ( mappedCount > maxCount ) {
+        auto leastRecentlyUsed = std::end( searchResultsCache_ );
+        for ( auto cachedResult = std::begin( searchResultsCache_ );
+              cachedResult != std::end( searchResultsCache_ ); ++cachedResult ) {
+            if ( cachedResult->first != currentSearchKey_ && cachedResult->second.mapped
+                 && ( leastRecentlyUsed == std::end( searchResultsCache_ )
+                      || cachedResult->second.lastUse < leastRecentlyUsed->second.lastUse ) ) {
+                leastRecentlyUsed = cachedResult;
+            }
+        }
+
+        if ( leastRecentlyUsed == std::end( searchResultsCache_ ) ) {
+            break;
+        }
+
+        LOG_DEBUG << "LogFilteredData: evicting mapped results for "
+                  << std::get<0>( leastRecentlyUsed->first ).pattern;
+
+        --mappedCount;
+        searchResultsCache_.erase( leastRecentlyUsed );
+    }
+}
+
+void LogFilteredData::releaseMappedSearchResults()
+{
+    for ( auto& [ key, cachedResult ] : searchResultsCache_ ) {
+        if ( cachedResult.mapped ) {
+            cachedResult.matching_lines.reset();
+        }
+    }
+}
+
+void LogFilteredData::clearSearchResultsCache()
+{
+    searchResultsCache_.clear();
+    SessionSearchResultsCacheBytes -= searchResultsCacheBytes_;
+    searchResultsCacheBytes_ = 0;
+}
+
 //
 // Q_SLOTS:
 //
@@ -399,49 +977,122 @@ void LogFilteredData::handleSearchProgressed( LinesCount nbMatches, int progress
 {
     assert( nbMatches >= 0_lcount );
 
+    // End of a search replaced by a newer one may come after the newer one started
+    if ( progress == 100 && runningSearches_ > 0 && --runningSearches_ == 0 ) {
+        searchProgressTimer_.stop();
+    }
+
+    if ( countBuckets_ ) {
+        if ( progress == 100 ) {
+            matchCounts_ = workerThread_.getMatchCounts();
+            detachReader();
+        }
+
+        Q_EMIT searchProgressed( nbMatches, progress, initialLine );
+        return;
+    }
+
     const auto searchResults = workerThread_.getSearchResults();
 
-    matching_lines_ |= searchResults.newMatches;
-    marks_and_matches_ |= searchResults.newMatches;
+    changeMatches(
+        [ &searchResults ]( SearchResultArray& lines ) { lines |= searchResults.newMatches; } );
+
+    if ( !searchResults.newMatches.isEmpty() ) {
+        const auto firstMatch = LineNumber( searchResults.newMatches.minimum() );
+        if ( !firstNewMatch_ || firstMatch < *firstNewMatch_ ) {
+            firstNewMatch_ = firstMatch;
+        }
+
+        // First results and the shown ones are likely read next
+        const auto pageLines
+            = shownLines_.get() > 0 ? shownLines_ : LinesCount( DefaultPrefetchLines );
+        auto lines = findLogDataLines( 0_lnum, pageLines );
+        const auto shownLines = findLogDataLines( shownFirstLine_, pageLines );
+        lines.insert( lines.end(), shownLines.begin(), shownLines.end() );
+        prefetchLines( lines );
+    }
 
     maxLength_ = searchResults.maxLength;
     nbLinesProcessed_ = searchResults.processedLines;
+    timeHistogram_ = workerThread_.getTimeHistogram();
+
+    // Matches of searches for common text are mostly runs of lines
+    if ( progress == 100 ) {
+        changeMatches( []( SearchResultArray& lines ) { lines.runOptimize(); } );
+    }
 
     if ( progress == 100
          && nbLinesProcessed_.get() == getExpectedSearchEnd( currentSearchKey_ ).get() ) {
         updateSearchResultsCache();
     }
 
-    {
-        ScopedLock lock( searchProgressMutex_ );
-        searchProgress_ = std::make_tuple( nbMatches, progress, initialLine );
-    }
-
-    Q_EMIT searchProgressedThrottled();
+    Q_EMIT searchProgressed( nbMatches, progress, initialLine );
 
     if ( progress == 100 ) {
         detachReader();
 
-        LOG_INFO << "Matches size " << readableSize( matching_lines_.getSizeInBytes( false ) )
+        LOG_INFO << "Matches size " << readableSize( matching_lines_->getSizeInBytes( false ) )
                  << ", marks size " << readableSize( marks_.getSizeInBytes( false ) )
-                 << ", union size " << readableSize( marks_and_matches_.getSizeInBytes( false ) );
+                 << ", union size " << readableSize( marks_and_matches_->getSizeInBytes( false ) );
     }
 }
 
-void LogFilteredData::handleSearchProgressedThrottled()
+void LogFilteredData::pollSearchProgress()
 {
-    LinesCount nbMatches;
-    int progress;
-    LineNumber initialLine;
-    {
-        ScopedLock lock( searchProgressMutex_ );
-        std::tie( nbMatches, progress, initialLine ) = searchProgress_;
+    const auto progress = workerThread_.progress().load();
+    if ( progress.generation != searchProgressGeneration_ ) {
+        searchProgressGeneration_ = progress.generation;
+        handleSearchProgressed( LinesCount( progress.matches ), progress.percent,
+                                LineNumber( progress.initialLine ) );
     }
-    Q_EMIT searchProgressed( nbMatches, progress, initialLine );
+}
+
+void LogFilteredData::pollSearchProgressUntilEnd()
+{
+    // The worker has waited for the previous search,
+    // so its progress is not reported for this one
+    searchProgressGeneration_ = workerThread_.progress().load().generation;
+    ++runningSearches_;
+    searchProgressTimer_.start();
+}
+
+template <typename Change>
+void LogFilteredData::changeMatches( Change change )
+{
+    // Shared union is not a reason to copy matches
+    const auto isUnionShared = marks_and_matches_ == matching_lines_;
+    if ( isUnionShared ) {
+        marks_and_matches_.reset();
+    }
+
+    change( writable( matching_lines_ ) );
+    ++matchesGeneration_;
+    linesWithContext_.reset();
+
+    if ( isUnionShared ) {
+        marks_and_matches_ = matching_lines_;
+    }
+    else {
+        change( writable( marks_and_matches_ ) );
+    }
+}
+
+void LogFilteredData::updateMarksAndMatches()
+{
+    ++matchesGeneration_;
+    linesWithContext_.reset();
+    marks_and_matches_ = marks_.isEmpty()
+                             ? matching_lines_
+                             : std::make_shared<SearchResultArray>( *matching_lines_ | marks_ );
 }
 
 LineNumber LogFilteredData::findLogDataLine( LineNumber index ) const
 {
+    if ( const auto* order = currentOrder() ) {
+        return index.get() < order->lines.size() ? LineNumber( order->lines[ index.get() ] )
+                                                 : maxValue<LineNumber>();
+    }
+
     const auto& currentResults = currentResultArray();
 
     LineNumber::UnderlyingType line = {};
@@ -457,14 +1108,81 @@ LineNumber LogFilteredData::findLogDataLine( LineNumber index ) const
     }
 }
 
+klogg::vector<LineNumber> LogFilteredData::findLogDataLines( LineNumber first,
+                                                             LinesCount number ) const
+{
+    klogg::vector<LineNumber> lines;
+    lines.reserve( number.get() );
+    if ( number.get() == 0 ) {
+        return lines;
+    }
+
+    if ( const auto* order = currentOrder() ) {
+        for ( auto index = first.get();
+              index < order->lines.size() && lines.size() < number.get(); ++index ) {
+            lines.push_back( LineNumber( order->lines[ index ] ) );
+        }
+        lines.resize( number.get(), maxValue<LineNumber>() );
+        return lines;
+    }
+
+    // Select is linear in the number of containers, it is only done for the first line
+    const auto& currentResults = currentResultArray();
+    const auto firstLine = findLogDataLine( first );
+    if ( firstLine != maxValue<LineNumber>() ) {
+        lines.push_back( firstLine );
+
+        auto resultIt = currentResults.begin();
+        resultIt.move( firstLine.get() );
+        for ( ++resultIt; resultIt != currentResults.end() && lines.size() < number.get();
+              ++resultIt ) {
+            lines.push_back( LineNumber( *resultIt ) );
+        }
+    }
+
+    lines.resize( number.get(), maxValue<LineNumber>() );
+    return lines;
+}
+
 const SearchResultArray& LogFilteredData::currentResultArray() const
+{
+    if ( contextLines_.get() == 0 ) {
+        return visibleResultArray();
+    }
+
+    // Lines added to the file can be context of the last visible lines
+    const auto nbLines = sourceLogData_->getNbLine();
+    if ( !linesWithContext_ || linesWithContextNbLines_ != nbLines ) {
+        linesWithContext_ = std::make_shared<const SearchResultArray>(
+            linesAround( visibleResultArray(), contextLines_, nbLines ) );
+        linesWithContextNbLines_ = nbLines;
+    }
+    return *linesWithContext_;
+}
+
+const LineOrder* LogFilteredData::currentOrder() const
+{
+    if ( !order_ || contextLines_.get() > 0 || orderMatchesGeneration_ != matchesGeneration_ ) {
+        return nullptr;
+    }
+
+    // Marks shown with matches keep the order only if they are all matched
+    const auto& visibleLines = visibleResultArray();
+    if ( &visibleLines == &marks_
+         || visibleLines.cardinality() != matching_lines_->cardinality() ) {
+        return nullptr;
+    }
+    return order_.get();
+}
+
+const SearchResultArray& LogFilteredData::visibleResultArray() const
 {
     if ( visibility_.testFlag( VisibilityFlags::Marks )
          && visibility_.testFlag( VisibilityFlags::Matches ) ) {
-        return marks_and_matches_;
+        return *marks_and_matches_;
     }
     else if ( visibility_.testFlag( VisibilityFlags::Matches ) ) {
-        return matching_lines_;
+        return *matching_lines_;
     }
     else {
         return marks_;
@@ -478,6 +1196,11 @@ LineNumber LogFilteredData::findFilteredLine( LineNumber lineNum ) const
     if ( index > 0 ) {
         index--;
     }
+
+    // Sorted lines are found by their rank
+    if ( const auto* order = currentOrder(); order && index < order->positions.size() ) {
+        index = order->positions[ index ];
+    }
     return LineNumber( index );
 }
 
@@ -495,11 +1218,36 @@ QString LogFilteredData::doGetExpandedLineString( LineNumber index ) const
     return sourceLogData_->getExpandedLineString( line );
 }
 
+QString LogFilteredData::doGetExpandedLineWindow( LineNumber index, LineColumn firstColumn,
+                                                  LineLength length ) const
+{
+    const auto line = findLogDataLine( index );
+    return sourceLogData_->getExpandedLineWindow( line, firstColumn, length );
+}
+
+qint64 LogFilteredData::doGetLineSize( LineNumber index ) const
+{
+    const auto line = findLogDataLine( index );
+    return sourceLogData_->getLineSize( line );
+}
+
+std::optional<QByteArray> LogFilteredData::doGetLinesBytes( LineNumber first,
+                                                            LinesCount number ) const
+{
+    const auto sourceLines = findLogDataLines( first, number );
+    if ( std::find( sourceLines.begin(), sourceLines.end(), maxValue<LineNumber>() )
+         != sourceLines.end() ) {
+        return {};
+    }
+
+    return sourceLogData_->readLinesBytes( sourceLines );
+}
+
 // Implementation of the virtual function.
 klogg::vector<QString> LogFilteredData::doGetLines( LineNumber first_line, LinesCount number ) const
 {
     return doGetLines( first_line, number,
-                       [ this ]( const auto& line ) { return doGetLineString( line ); } );
+                       []( QString&& line ) { return std::move( line ); } );
 }
 
 // Implementation of the virtual function.
@@ -507,24 +1255,93 @@ klogg::vector<QString> LogFilteredData::doGetExpandedLines( LineNumber first_lin
                                                           LinesCount number ) const
 {
     return doGetLines( first_line, number,
-                       [ this ]( const auto& line ) { return doGetExpandedLineString( line ); } );
+                       []( QString&& line ) { return untabify( std::move( line ) ); } );
 }
 
 klogg::vector<QString>
 LogFilteredData::doGetLines( LineNumber first_line, LinesCount number,
-                             const std::function<QString( LineNumber )>& lineGetter ) const
+                             QString ( *processLine )( QString&& ) ) const
 {
-    klogg::vector<LineNumber::UnderlyingType> lineNumbers( number.get() );
-    std::iota( lineNumbers.begin(), lineNumbers.end(), first_line.get() );
+    // Lines between matches are read too if there are only a few of them
+    constexpr LineNumber::UnderlyingType MaxLinesGap = 16;
+    // Keeps ranges small enough to be in the page cache of source data
+    constexpr LineNumber::UnderlyingType MaxRangeLines = 1024;
+
+    const auto sourceLines = findLogDataLines( first_line, number );
+
+    klogg::vector<QString> lines;
+    lines.reserve( number.get() );
+
+    size_t rangeBegin = 0;
+    while ( rangeBegin < sourceLines.size() ) {
+        const auto firstSourceLine = sourceLines[ rangeBegin ];
+        if ( firstSourceLine == maxValue<LineNumber>() ) {
+            // Index is not in results, source data reports the error
+            lines.push_back( processLine( sourceLogData_->getLineString( firstSourceLine ) ) );
+            ++rangeBegin;
+            continue;
+        }
+
+        auto rangeEnd = rangeBegin + 1;
+        while ( rangeEnd < sourceLines.size() && sourceLines[ rangeEnd ] != maxValue<LineNumber>()
+                && sourceLines[ rangeEnd ].get() - sourceLines[ rangeEnd - 1 ].get() <= MaxLinesGap
+                && sourceLines[ rangeEnd ].get() - firstSourceLine.get() < MaxRangeLines ) {
+            ++rangeEnd;
+        }
+
+        const auto rangeLines = LinesCount(
+            sourceLines[ rangeEnd - 1 ].get() - firstSourceLine.get() + 1 );
+        auto sourceRange = sourceLogData_->getLines( firstSourceLine, rangeLines );
+
+        // Source data returns fewer lines if it changed since the matches were found
+        for ( auto i = rangeBegin; i < rangeEnd; ++i ) {
+            const auto rangeIndex = sourceLines[ i ].get() - firstSourceLine.get();
+            if ( rangeIndex < sourceRange.size() ) {
+                lines.push_back( processLine( std::move( sourceRange[ rangeIndex ] ) ) );
+            }
+            else {
+                lines.emplace_back();
+            }
+        }
+
+        rangeBegin = rangeEnd;
+    }
 
-    klogg::vector<QString> lines( number.get() );
-    std::transform(
-        lineNumbers.cbegin(), lineNumbers.cend(), lines.begin(),
-        [ &lineGetter ]( const auto& line ) { return lineGetter( LineNumber( line ) ); } );
+    prefetchNextLines( first_line, number );
 
     return lines;
 }
 
+void LogFilteredData::prefetchLines( const klogg::vector<LineNumber>& lines ) const
+{
+    klogg::vector<LineNumber> sourceLines;
+    sourceLines.reserve( lines.size() );
+    std::copy_if( lines.begin(), lines.end(), std::back_inserter( sourceLines ),
+                  []( const auto line ) { return line != maxValue<LineNumber>(); } );
+    sourceLogData_->prefetchLines( sourceLines );
+}
+
+void LogFilteredData::prefetchNextLines( LineNumber first, LinesCount number ) const
+{
+    // Same lines are read again when the view is repainted
+    if ( number.get() > MaxPrefetchLines
+         || ( first == shownFirstLine_ && number == shownLines_ ) ) {
+        return;
+    }
+
+    const auto isBackward = first < shownFirstLine_;
+    shownFirstLine_ = first;
+    shownLines_ = number;
+
+    if ( isBackward ) {
+        const auto nextFirst = first.get() > number.get() ? first.get() - number.get() : 0;
+        prefetchLines( findLogDataLines( LineNumber( nextFirst ), number ) );
+    }
+    else {
+        prefetchLines( findLogDataLines( first + number, number ) );
+    }
+}
+
 LineNumber LogFilteredData::doGetLineNumber(LineNumber index) const
 {
     return getMatchingLineNumber(index);
@@ -540,6 +1357,10 @@ LinesCount LogFilteredData::doGetNbLine() const
 // Implementation of the virtual function.
 LineLength LogFilteredData::doGetMaxLength() const
 {
+    // Context lines are not measured
+    if ( contextLines_.get() > 0 ) {
+        return sourceLogData_->getMaxLength();
+    }
     return qMax( maxLength_, maxLengthMarks_ );
 }
 
@@ -36,13 +36,22 @@
  * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <exception>
+#include <limits>
+#include <numeric>
+#include <optional>
 #include <qsemaphore.h>
+#include <string>
 #include <utility>
 
+#include <QRegularExpression>
+
 #include <robin_hood.h>
+#include <tbb/enumerable_thread_specific.h>
 #include <tbb/flow_graph.h>
 #include <vector>
 
@@ -50,11 +59,15 @@
 #include "dispatch_to.h"
 #include "issuereporter.h"
 #include "log.h"
+#include "metrics.h"
 #include "progress.h"
 #include "runnable_lambda.h"
 
 #include "logdata.h"
 #include "regularexpression.h"
+#include "taskscheduler.h"
+#include "tokenfilters.h"
+#include "tracing.h"
 
 #include "logfiltereddataworker.h"
 #include "synchronization.h"
@@ -69,19 +82,17 @@ struct PartialSearchResults {
     PartialSearchResults& operator=( PartialSearchResults&& ) = default;
 
     SearchResultArray matchingLines;
+    LinesCount nbMatches;
     LineLength maxLength;
 
     LineNumber chunkStart;
     LinesCount processedLines;
+
+    TimeHistogram timeHistogram;
 };
 
 struct SearchBlockData {
     SearchBlockData() = default;
-    SearchBlockData( LineNumber start, LogData::RawLines blockLines )
-        : chunkStart( start )
-        , lines( std::move( blockLines ) )
-    {
-    }
 
     SearchBlockData( const SearchBlockData& ) = delete;
     SearchBlockData( SearchBlockData&& ) = default;
@@ -89,47 +100,638 @@ struct SearchBlockData {
     SearchBlockData& operator=( const SearchBlockData& ) = delete;
     SearchBlockData& operator=( SearchBlockData&& ) = default;
 
+    // Chunks are read and matched out of order, results are combined in order
+    uint64_t chunkIndex = 0;
     LineNumber chunkStart;
+    LinesCount chunkLines;
+    // Chunk can't contain the required literal, it is not read
+    bool isSkipped = false;
+    // Chunk can't contain the literal of an exclude pattern, all its lines match.
+    // It is not read unless lengths of its lines are not indexed.
+    bool isAllMatching = false;
+    // Offsets of matching lines found in the field index, the chunk is not read
+    std::optional<klogg::vector<size_t>> fieldMatches;
+    // Chunk has lines too long to be read at once, its lines are matched one by one
+    bool hasLongLines = false;
     LogData::RawLines lines;
+    // Lines read by another running search, used instead of own lines
+    std::shared_ptr<const LogData::SharedRawLines> sharedLines;
 
     PartialSearchResults searchResults;
+
+    const LogData::RawLines& rawLines() const
+    {
+        return sharedLines ? sharedLines->rawLines() : lines;
+    }
+
+    const klogg::vector<std::string_view>& utf8Lines() const
+    {
+        return sharedLines ? sharedLines->utf8View() : lines.buildUtf8View();
+    }
 };
 
-PartialSearchResults filterLines( const PatternMatcher& matcher, const LogData::RawLines& rawLines,
-                                  LineNumber chunkStart )
+// Lets the source share chunks of lines with other searches while this one runs
+class RunningSearch {
+  public:
+    explicit RunningSearch( const LogData& logData )
+        : logData_( logData )
+    {
+        logData_.beginSearch();
+    }
+
+    ~RunningSearch()
+    {
+        logData_.endSearch();
+    }
+
+    RunningSearch( const RunningSearch& ) = delete;
+    RunningSearch& operator=( const RunningSearch& ) = delete;
+
+  private:
+    const LogData& logData_;
+};
+
+// Blocks are recycled with memory of their lines, so reading lines
+// does not allocate once there are as many blocks as can be in flight.
+// Blocks in flight are limited by the pool, the search waits for a block
+// to be released when all of them are in flight
+class SearchBlockPool {
+  public:
+    explicit SearchBlockPool( size_t maxBlocksInFlight )
+        : maxBlocks_( maxBlocksInFlight )
+    {
+        blocks_.reserve( maxBlocksInFlight );
+        freeBlocks_.reserve( maxBlocksInFlight );
+    }
+
+    // Returns nullptr if interrupted while all blocks are in flight
+    SearchBlockData* acquire( const AtomicFlag& interruptRequested )
+    {
+        ScopedLock lock( mutex_ );
+        if ( freeBlocks_.empty() && blocks_.size() < maxBlocks_ ) {
+            blocks_.push_back( std::make_unique<SearchBlockData>() );
+            return blocks_.back().get();
+        }
+
+        if ( freeBlocks_.empty() ) {
+            // Time waiting for chunks in flight to complete shows backpressure of the graph
+            const TraceSpan waitSpan( "wait for prefetcher", "search" );
+            while ( freeBlocks_.empty() && !interruptRequested ) {
+                blockReleased_.wait_for( lock, InterruptCheckInterval );
+            }
+        }
+
+        if ( freeBlocks_.empty() ) {
+            return nullptr;
+        }
+
+        auto block = freeBlocks_.back();
+        freeBlocks_.pop_back();
+        return block;
+    }
+
+    void release( SearchBlockData* block )
+    {
+        block->searchResults = {};
+        block->sharedLines.reset();
+
+        ScopedLock lock( mutex_ );
+        freeBlocks_.push_back( block );
+        blockReleased_.notify_one();
+    }
+
+  private:
+    // Blocks are released also when the search is interrupted,
+    // this is only for a graph that stopped passing them
+    static constexpr std::chrono::milliseconds InterruptCheckInterval{ 50 };
+
+    const size_t maxBlocks_;
+
+    Mutex mutex_;
+    std::condition_variable_any blockReleased_;
+    klogg::vector<std::unique_ptr<SearchBlockData>> blocks_;
+    klogg::vector<SearchBlockData*> freeBlocks_;
+};
+
+// Matching lines of a chunk are added at once, they fit in one 32 bit bitmap
+// unless the file has more than 4G lines
+SearchResultArray makeResultArray( LineNumber chunkStart, const klogg::vector<size_t>& offsets )
+{
+    if ( offsets.empty() ) {
+        return {};
+    }
+
+    const auto lastLine = chunkStart.get() + offsets.back();
+    if ( lastLine <= std::numeric_limits<uint32_t>::max() ) {
+        klogg::vector<uint32_t> lines( offsets.size() );
+        std::transform( offsets.cbegin(), offsets.cend(), lines.begin(),
+                        [ chunkStart ]( size_t offset ) {
+                            return static_cast<uint32_t>( chunkStart.get() + offset );
+                        } );
+
+        roaring::Roaring bitmap;
+        bitmap.addMany( lines.size(), lines.data() );
+        return SearchResultArray( bitmap );
+    }
+
+    klogg::vector<uint64_t> lines( offsets.size() );
+    std::transform( offsets.cbegin(), offsets.cend(), lines.begin(),
+                    [ chunkStart ]( size_t offset ) { return chunkStart.get() + offset; } );
+
+    SearchResultArray results;
+    results.addMany( lines.size(), lines.data() );
+    return results;
+}
+
+// Matching lines are only counted if counts are passed
+PartialSearchResults filterLines( const LogData& logData, const PatternMatcher& matcher,
+                                  const klogg::vector<std::string_view>& lines,
+                                  LinesCount processedLines, LineNumber chunkStart,
+                                  MatchCounts* counts )
 {
-    LOG_DEBUG << "Filter lines at " << chunkStart;
+    LOG_TRACE << "Filter lines at " << chunkStart;
     PartialSearchResults results;
     results.chunkStart = chunkStart;
-    results.processedLines = LinesCount{ rawLines.endOfLines.size() };
+    results.processedLines = processedLines;
 
-    const auto& lines = rawLines.buildUtf8View();
+    // Scanning the whole block at once saves per line overhead of the engine
+    klogg::vector<size_t> matchingLines;
+    if ( !matcher.matchLines( lines, matchingLines ) ) {
+        matcher.findMatchingLines( lines, matchingLines );
+    }
 
-    for ( auto offset = 0u; offset < lines.size(); ++offset ) {
-        const auto& line = lines[ offset ];
+    results.nbMatches = LinesCount( matchingLines.size() );
+    if ( counts != nullptr ) {
+        counts->add( chunkStart, matchingLines );
+        return results;
+    }
 
-        const auto hasMatch = matcher.hasMatch( line );
+    // Lengths found during indexing are decoded for the whole chunk in one pass,
+    // only lines which lengths are not known are measured
+    const auto indexedLengths
+        = matchingLines.empty() ? FastLineLengthArray{}
+                                : logData.getIndexedLineLengths( chunkStart, processedLines );
+    for ( const auto offset : matchingLines ) {
+        const auto indexedLength
+            = offset < indexedLengths.size() ? indexedLengths.at( offset ) : std::nullopt;
+        results.maxLength = qMax( results.maxLength,
+                                  indexedLength ? *indexedLength
+                                                : getUntabifiedLength( lines[ offset ] ) );
+    }
 
-        if ( hasMatch ) {
-            results.maxLength = qMax( results.maxLength, getUntabifiedLength( line ) );
-            const auto lineNumber = chunkStart + LinesCount{ offset };
-            results.matchingLines.add( lineNumber.get() );
+    results.matchingLines = makeResultArray( chunkStart, matchingLines );
+    // Results of exclude patterns are mostly long runs of lines
+    if ( matcher.isInverse() ) {
+        results.matchingLines.runOptimize();
+    }
+    return results;
+}
 
-            // LOG_INFO << "Match at " << lineNumber << ": " << line;
+// Results of matching UTF-16 lines as they are read, empty if the pattern has to be
+// matched in UTF-8 lines. Matching lines are only counted if counts are passed.
+std::optional<PartialSearchResults> filterUtf16Lines( const LogData& logData,
+                                                      const PatternMatcher& matcher,
+                                                      const LogData::RawLines& lines,
+                                                      LineNumber chunkStart, MatchCounts* counts )
+{
+    const auto data = lines.utf16Data();
+    if ( data.empty() ) {
+        return std::nullopt;
+    }
+
+    const auto isBigEndian = lines.textDecoder.encodingParams.lineFeedIndex == 1;
+    klogg::vector<size_t> matchingLines;
+    if ( !matcher.matchUtf16Lines( data, lines.endOfLines, isBigEndian, matchingLines ) ) {
+        return std::nullopt;
+    }
+
+    LOG_TRACE << "Filter UTF-16 lines at " << chunkStart;
+    PartialSearchResults results;
+    results.chunkStart = chunkStart;
+    results.processedLines = LinesCount{ lines.endOfLines.size() };
+    results.nbMatches = LinesCount( matchingLines.size() );
+    if ( counts != nullptr ) {
+        counts->add( chunkStart, matchingLines );
+        return results;
+    }
+
+    const auto indexedLengths
+        = matchingLines.empty()
+              ? FastLineLengthArray{}
+              : logData.getIndexedLineLengths( chunkStart, results.processedLines );
+    std::u16string line;
+    for ( const auto offset : matchingLines ) {
+        const auto indexedLength
+            = offset < indexedLengths.size() ? indexedLengths.at( offset ) : std::nullopt;
+        if ( indexedLength ) {
+            results.maxLength = qMax( results.maxLength, *indexedLength );
+            continue;
+        }
+
+        const auto lineStart = offset == 0 ? qint64{ 0 } : lines.endOfLines[ offset - 1 ];
+        const auto lineEnd = std::max( lineStart, lines.endOfLines[ offset ] - 2 );
+        const auto lineData = data.substr( static_cast<size_t>( lineStart ),
+                                           static_cast<size_t>( lineEnd - lineStart ) );
+        line.resize( lineData.size() / 2 );
+        for ( size_t index = 0; index < line.size(); ++index ) {
+            const auto first = static_cast<uint8_t>( lineData[ 2 * index ] );
+            const auto second = static_cast<uint8_t>( lineData[ 2 * index + 1 ] );
+            line[ index ] = static_cast<char16_t>( isBigEndian ? ( first << 8 ) | second
+                                                               : ( second << 8 ) | first );
+        }
+        results.maxLength = qMax( results.maxLength,
+                                  getUntabifiedLength( std::u16string_view( line ) ) );
+    }
+
+    results.matchingLines = makeResultArray( chunkStart, matchingLines );
+    if ( matcher.isInverse() ) {
+        results.matchingLines.runOptimize();
+    }
+    return results;
+}
+
+// Results of a chunk which matching lines are known without reading it, empty if
+// lengths of the matching lines are not indexed. Offsets are ascending.
+// Matching lines are only counted if counts are passed.
+std::optional<PartialSearchResults> knownLinesResults( const LogData& logData,
+                                                       LineNumber chunkStart, LinesCount chunkLines,
+                                                       const klogg::vector<size_t>& offsets,
+                                                       MatchCounts* counts )
+{
+    PartialSearchResults results;
+    results.chunkStart = chunkStart;
+    results.processedLines = chunkLines;
+    results.nbMatches = LinesCount( offsets.size() );
+
+    if ( counts != nullptr ) {
+        counts->add( chunkStart, offsets );
+        return results;
+    }
+    if ( offsets.empty() ) {
+        return results;
+    }
+
+    const auto indexedLengths = logData.getIndexedLineLengths( chunkStart, chunkLines );
+    if ( indexedLengths.size() <= offsets.back() ) {
+        return std::nullopt;
+    }
+    for ( const auto offset : offsets ) {
+        const auto indexedLength = indexedLengths.at( offset );
+        if ( !indexedLength ) {
+            return std::nullopt;
         }
+        results.maxLength = qMax( results.maxLength, *indexedLength );
     }
+
+    results.matchingLines = makeResultArray( chunkStart, offsets );
+    results.matchingLines.runOptimize();
+    return results;
+}
+
+// Results of a chunk which lines all match, empty if lengths of the lines are not indexed.
+// Matching lines are only counted if counts are passed.
+std::optional<PartialSearchResults> allLinesResults( const LogData& logData,
+                                                     LineNumber chunkStart, LinesCount chunkLines,
+                                                     MatchCounts* counts )
+{
+    klogg::vector<size_t> offsets( static_cast<size_t>( chunkLines.get() ) );
+    std::iota( offsets.begin(), offsets.end(), size_t{ 0 } );
+    return knownLinesResults( logData, chunkStart, chunkLines, offsets, counts );
+}
+
+// Offsets of the chunk lines found in the field index, of the other lines for exclude patterns
+klogg::vector<size_t> fieldMatchOffsets( const SearchResultArray& lines, LineNumber chunkStart,
+                                         LinesCount chunkLines, bool isInverse )
+{
+    klogg::vector<size_t> offsets;
+    if ( !isInverse ) {
+        offsets.reserve( static_cast<size_t>( lines.cardinality() ) );
+        for ( const auto line : lines ) {
+            offsets.push_back( static_cast<size_t>( line - chunkStart.get() ) );
+        }
+        return offsets;
+    }
+
+    offsets.reserve( static_cast<size_t>( chunkLines.get() - lines.cardinality() ) );
+    auto line = lines.begin();
+    for ( size_t offset = 0; offset < chunkLines.get(); ++offset ) {
+        if ( line != lines.end() && *line == chunkStart.get() + offset ) {
+            ++line;
+            continue;
+        }
+        offsets.push_back( offset );
+    }
+    return offsets;
+}
+
+// Chunk searched at the position in the search order, chunks are taken from
+// the focused one outwards, alternating between following and preceding ones
+uint64_t chunkAtPosition( uint64_t position, uint64_t chunksCount, uint64_t focusedChunk )
+{
+    const auto chunksBefore = focusedChunk;
+    const auto chunksAfter = chunksCount - focusedChunk - 1;
+    const auto chunksOnBothSides = std::min( chunksBefore, chunksAfter );
+
+    if ( position <= 2 * chunksOnBothSides ) {
+        const auto distance = ( position + 1 ) / 2;
+        return position % 2 != 0 ? focusedChunk + distance : focusedChunk - distance;
+    }
+
+    const auto distance = position - chunksOnBothSides;
+    return chunksAfter > chunksBefore ? focusedChunk + distance : focusedChunk - distance;
+}
+
+// Chunks take about the same bytes of the file, so chunks of long lines don't take
+// too much memory and chunks of short lines are worth passing through the graph
+constexpr qint64 DefaultChunkBytes = 4 * 1024 * 1024;
+constexpr qint64 MinChunkBytes = 256 * 1024;
+constexpr qint64 MaxChunkBytes = 64 * 1024 * 1024;
+constexpr LinesCount::UnderlyingType MinChunkLines = 16;
+constexpr LinesCount::UnderlyingType MaxChunkLines = 1000 * 1000;
+// Memory of the chunks in flight is limited
+constexpr qint64 MaxBytesInFlight = 1024 * 1024 * 1024;
+// Matchers that finish their chunks early get others
+constexpr qint64 ChunksPerMatcher = 4;
+
+// Chunks of the next searches are sized to be read and matched in about that time,
+// it is measured over enough chunks to be stable
+constexpr int64_t TargetChunkUs = 20 * 1000;
+constexpr uint64_t MinChunksToAdapt = 8;
+
+// Runs of consecutive lines of the array from the first line to the end line,
+// as pairs of the first line and the line after the run
+klogg::vector<std::pair<LineNumber, LineNumber>>
+lineRuns( const SearchResultArray& lines, LineNumber first, LineNumber end )
+{
+    klogg::vector<std::pair<LineNumber, LineNumber>> runs;
+    auto line = lines.begin();
+    if ( !line.move( first.get() ) ) {
+        return runs;
+    }
+
+    for ( ; line != lines.end() && *line < end.get(); ++line ) {
+        if ( !runs.empty() && runs.back().second.get() == *line ) {
+            runs.back().second = LineNumber( *line + 1 );
+        }
+        else {
+            runs.emplace_back( LineNumber( *line ), LineNumber( *line + 1 ) );
+        }
+    }
+    return runs;
+}
+
+// Starts of the chunks of about the bytes each from the first line to the end line
+klogg::vector<LineNumber> splitInChunks( const LogData& logData, LineNumber first,
+                                         LineNumber end, qint64 chunkBytes )
+{
+    klogg::vector<LineNumber> chunkStarts;
+    for ( auto chunkStart = first; chunkStart < end; ) {
+        chunkStarts.push_back( chunkStart );
+        const auto maxLines = std::min( MaxChunkLines, ( end - chunkStart ).get() );
+        const auto chunkLines = logData.getLinesInBytes(
+            chunkStart, chunkBytes, LinesCount( MinChunkLines ), LinesCount( maxLines ) );
+        chunkStart = chunkLines.get() > 0 ? chunkStart + chunkLines : end;
+    }
+    return chunkStarts;
+}
+
+// Longer lines are matched in parts if the pattern can be, they are alone in chunks
+// of the fewest lines since each of them is larger than any chunk
+constexpr qint64 LongLineBytes = MaxChunkBytes;
+constexpr qint64 LongLinePartBytes = 4 * 1024 * 1024;
+
+bool hasLongLines( const LogData& logData, LineNumber chunkStart, LinesCount chunkLines )
+{
+    if ( chunkLines.get() > MinChunkLines ) {
+        return false;
+    }
+
+    for ( auto offset = 0_lcount; offset < chunkLines; ++offset ) {
+        if ( logData.getLineSize( chunkStart + offset ) > LongLineBytes ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Long lines are read in parts, other lines and lines that can't be matched in parts
+// are read one by one. Matching lines are only counted if counts are passed.
+PartialSearchResults filterLongLines( const LogData& logData, const PatternMatcher& matcher,
+                                      LineNumber chunkStart, LinesCount chunkLines,
+                                      MatchCounts* counts )
+{
+    PartialSearchResults results;
+    results.chunkStart = chunkStart;
+    results.processedLines = chunkLines;
+
+    klogg::vector<size_t> matchingLines;
+    for ( auto offset = 0_lcount; offset < chunkLines; ++offset ) {
+        const auto line = chunkStart + offset;
+        const auto lineSize = logData.getLineSize( line );
+
+        std::optional<bool> isMatching;
+        if ( lineSize > LongLineBytes ) {
+            isMatching = matcher.hasMatchInParts( [ &logData, line ]( const auto& consume ) {
+                return logData.readLineParts( line, LongLinePartBytes, consume );
+            } );
+        }
+
+        if ( !isMatching ) {
+            const auto rawLine = logData.getLinesRaw( line, 1_lcount );
+            const auto& utf8Lines = rawLine.buildUtf8View();
+            isMatching = matcher.hasMatch( utf8Lines.empty() ? std::string_view{}
+                                                             : utf8Lines.front() );
+        }
+
+        if ( *isMatching ) {
+            matchingLines.push_back( offset.get() );
+        }
+    }
+
+    results.nbMatches = LinesCount( matchingLines.size() );
+    if ( counts != nullptr ) {
+        counts->add( chunkStart, matchingLines );
+        return results;
+    }
+
+    // Lengths of long lines are not decoded, their bytes are taken as their length
+    const auto indexedLengths = logData.getIndexedLineLengths( chunkStart, chunkLines );
+    for ( const auto offset : matchingLines ) {
+        const auto indexedLength
+            = offset < indexedLengths.size() ? indexedLengths.at( offset ) : std::nullopt;
+        const auto lineSize = std::min(
+            logData.getLineSize( chunkStart + LinesCount( offset ) ),
+            qint64{ std::numeric_limits<LineLength::UnderlyingType>::max() } );
+        const auto lineLength = LineLength( static_cast<LineLength::UnderlyingType>( lineSize ) );
+        results.maxLength = qMax( results.maxLength, indexedLength ? *indexedLength : lineLength );
+    }
+
+    results.matchingLines = makeResultArray( chunkStart, matchingLines );
     return results;
 }
 
 } // namespace
 
+SearchResultArray linesBefore( const SearchResultArray& lines, LineNumber line )
+{
+    // Range is a single run, so lines are copied by containers
+    SearchResultArray range;
+    range.addRange( 0, line.get() );
+    return lines & range;
+}
+
+SearchResultArray linesBetween( const SearchResultArray& beginLines,
+                                const SearchResultArray& endLines, LinesCount nbLines )
+{
+    SearchResultArray regions;
+
+    auto begin = beginLines.begin();
+    auto end = endLines.begin();
+    while ( begin != beginLines.end() && *begin < nbLines.get() ) {
+        const auto first = *begin;
+        if ( end == endLines.end() || !end.move( first ) ) {
+            regions.addRange( first, nbLines.get() );
+            break;
+        }
+
+        const auto last = std::min( *end + 1, nbLines.get() );
+        regions.addRange( first, last );
+        if ( !begin.move( last ) ) {
+            break;
+        }
+    }
+
+    regions.runOptimize();
+    return regions;
+}
+
+std::optional<SearchResultArray> linesBetweenMarkers( const LogData& logData,
+                                                      const QRegularExpression& begin,
+                                                      const QRegularExpression& end,
+                                                      const AtomicFlag& interruptRequested )
+{
+    struct Markers {
+        // Regular expressions are not shared by threads
+        QRegularExpression begin;
+        QRegularExpression end;
+        SearchResultArray beginLines;
+        SearchResultArray endLines;
+    };
+
+    tbb::enumerable_thread_specific<Markers> markers(
+        [ &begin, &end ] { return Markers{ begin, end, {}, {} }; } );
+
+    SearchResultArray allLines;
+    allLines.addRange( 0, logData.getNbLine().get() );
+    logData.readLinesInParallel(
+        allLines, interruptRequested, [ &markers ]( LineNumber line, std::string_view text ) {
+            auto& lineMarkers = markers.local();
+            const auto lineText
+                = QString::fromUtf8( text.data(), static_cast<int>( text.size() ) );
+            if ( lineMarkers.begin.match( lineText ).hasMatch() ) {
+                lineMarkers.beginLines.add( line.get() );
+            }
+            if ( lineMarkers.end.match( lineText ).hasMatch() ) {
+                lineMarkers.endLines.add( line.get() );
+            }
+        } );
+    if ( interruptRequested ) {
+        return {};
+    }
+
+    SearchResultArray beginLines;
+    SearchResultArray endLines;
+    for ( const auto& lineMarkers : markers ) {
+        beginLines |= lineMarkers.beginLines;
+        endLines |= lineMarkers.endLines;
+    }
+
+    auto lines = linesBetween( beginLines, endLines, LinesCount( allLines.cardinality() ) );
+    LOG_INFO << "Found " << lines.cardinality() << " lines between " << beginLines.cardinality()
+             << " begin markers and " << endLines.cardinality() << " end markers";
+    return lines;
+}
+
+std::optional<SearchResultArray> linesOfLevel( const LogData& logData, LogLevel level,
+                                               const AtomicFlag& interruptRequested )
+{
+    if ( auto lines = logData.getLevelLines( level ) ) {
+        LOG_INFO << "Found " << lines->cardinality() << " lines of level "
+                 << static_cast<int>( level ) << " in the level index";
+        return lines;
+    }
+
+    const auto searchedBytes = static_cast<size_t>( Configuration::get().levelSearchedBytes() );
+    tbb::enumerable_thread_specific<SearchResultArray> levelLines;
+
+    SearchResultArray allLines;
+    allLines.addRange( 0, logData.getNbLine().get() );
+    logData.readLinesInParallel(
+        allLines, interruptRequested,
+        [ &levelLines, level, searchedBytes ]( LineNumber line, std::string_view text ) {
+            const auto lineLevel = LevelIndex::levelOf( text, searchedBytes );
+            if ( lineLevel && *lineLevel <= level ) {
+                levelLines.local().add( line.get() );
+            }
+        } );
+    if ( interruptRequested ) {
+        return {};
+    }
+
+    SearchResultArray lines;
+    for ( const auto& threadLines : levelLines ) {
+        lines |= threadLines;
+    }
+    lines.runOptimize();
+
+    LOG_INFO << "Found " << lines.cardinality() << " lines of level " << static_cast<int>( level )
+             << " in " << allLines.cardinality() << " lines";
+    return lines;
+}
+
+SearchResultArray linesAround( const SearchResultArray& lines, LinesCount context,
+                               LinesCount nbLines )
+{
+    SearchResultArray linesWithContext;
+    if ( nbLines.get() == 0 ) {
+        return linesWithContext;
+    }
+
+    // Overlapping or adjacent ranges are merged before they are added
+    std::optional<std::pair<uint64_t, uint64_t>> range;
+    for ( const auto line : lines ) {
+        if ( line >= nbLines.get() ) {
+            break;
+        }
+
+        const auto first = line > context.get() ? line - context.get() : 0;
+        const auto last = std::min( line + context.get(), nbLines.get() - 1 );
+        if ( range && first <= range->second + 1 ) {
+            range->second = std::max( range->second, last );
+            continue;
+        }
+
+        if ( range ) {
+            linesWithContext.addRange( range->first, range->second + 1 );
+        }
+        range = std::make_pair( first, last );
+    }
+
+    if ( range ) {
+        linesWithContext.addRange( range->first, range->second + 1 );
+    }
+
+    linesWithContext.runOptimize();
+    return linesWithContext;
+}
+
 SearchResults SearchData::takeCurrentResults() const
 {
     UniqueLock lock( dataMutex_ );
     return SearchResults{ std::exchange( newMatches_, {} ), maxLength_, nbLinesProcessed_ };
 }
 
-void SearchData::addAll( LineLength length, const SearchResultArray& matches, LinesCount lines )
+void SearchData::addAll( LineLength length, SearchResultArray&& matches, LinesCount lines )
 {
     UniqueLock lock( dataMutex_ );
 
@@ -137,7 +739,123 @@ void SearchData::addAll( LineLength length, const SearchResultArray& matches, Li
     nbLinesProcessed_ = qMax( nbLinesProcessed_, lines );
     nbMatches_ += LinesCount( matches.cardinality() );
 
-    newMatches_ |= matches;
+    // Matches are usually taken after each chunk, so they are moved instead of merged
+    if ( newMatches_.isEmpty() ) {
+        newMatches_ = std::move( matches );
+    }
+    else {
+        newMatches_ |= matches;
+    }
+}
+
+MatchCounts::MatchCounts( LinesCount nbLines, size_t bucketsCount )
+{
+    if ( bucketsCount > 0 ) {
+        bucketLines = LinesCount( qMax( uint64_t{ 1 },
+                                        ( nbLines.get() + bucketsCount - 1 ) / bucketsCount ) );
+        buckets.resize( bucketsCount );
+    }
+}
+
+void MatchCounts::add( LineNumber chunkStart, const klogg::vector<size_t>& offsets )
+{
+    nbMatches += LinesCount( offsets.size() );
+    if ( offsets.empty() ) {
+        return;
+    }
+
+    const auto lastOffset = *std::max_element( offsets.begin(), offsets.end() );
+    const auto last = chunkStart + LinesCount( lastOffset );
+    if ( !lastMatch || *lastMatch < last ) {
+        lastMatch = last;
+    }
+
+    if ( buckets.empty() ) {
+        return;
+    }
+
+    for ( const auto offset : offsets ) {
+        const auto bucket = ( chunkStart.get() + offset ) / bucketLines.get();
+        buckets[ qMin( static_cast<size_t>( bucket ), buckets.size() - 1 ) ]++;
+    }
+}
+
+void MatchCounts::merge( const MatchCounts& other )
+{
+    nbMatches += other.nbMatches;
+    for ( size_t bucket = 0; bucket < qMin( buckets.size(), other.buckets.size() ); ++bucket ) {
+        buckets[ bucket ] += other.buckets[ bucket ];
+    }
+    if ( !lastMatch || ( other.lastMatch && *lastMatch < *other.lastMatch ) ) {
+        lastMatch = other.lastMatch;
+    }
+}
+
+MatchCounts MatchCounts::emptyCopy() const
+{
+    MatchCounts counts;
+    counts.bucketLines = bucketLines;
+    counts.buckets.resize( buckets.size() );
+    return counts;
+}
+
+void MatchCounts::fit( LinesCount nbLines )
+{
+    if ( buckets.empty() ) {
+        return;
+    }
+
+    while ( bucketLines.get() * buckets.size() < nbLines.get() ) {
+        for ( size_t bucket = 0; bucket < buckets.size(); ++bucket ) {
+            const auto first = bucket * 2;
+            buckets[ bucket ] = ( first < buckets.size() ? buckets[ first ] : 0 )
+                                + ( first + 1 < buckets.size() ? buckets[ first + 1 ] : 0 );
+        }
+        bucketLines = LinesCount( bucketLines.get() * 2 );
+    }
+}
+
+void MatchCounts::recount( LineNumber line )
+{
+    if ( !lastMatch || *lastMatch != line ) {
+        return;
+    }
+
+    nbMatches = LinesCount( nbMatches.get() - 1 );
+    if ( !buckets.empty() ) {
+        const auto bucket = qMin( static_cast<size_t>( line.get() / bucketLines.get() ),
+                                  buckets.size() - 1 );
+        buckets[ bucket ]--;
+    }
+    lastMatch = {};
+}
+
+MatchCounts SearchData::getMatchCounts() const
+{
+    SharedLock lock( dataMutex_ );
+    return matchCounts_;
+}
+
+void SearchData::setMatchCounts( MatchCounts counts )
+{
+    UniqueLock lock( dataMutex_ );
+    matchCounts_ = std::move( counts );
+}
+
+TimeHistogram SearchData::getTimeHistogram() const
+{
+    SharedLock lock( dataMutex_ );
+    return isTimeHistogramKnown_ ? timeHistogram_ : TimeHistogram{};
+}
+
+void SearchData::addTimeHistogram( const TimeHistogram& histogram )
+{
+    if ( histogram.isEmpty() ) {
+        return;
+    }
+
+    UniqueLock lock( dataMutex_ );
+    timeHistogram_.merge( histogram );
 }
 
 LinesCount SearchData::getNbMatches() const
@@ -167,6 +885,36 @@ void SearchData::clear()
     nbMatches_ = LinesCount( 0 );
     matches_ = {};
     newMatches_ = {};
+    matchCounts_ = {};
+    timeHistogram_.clear();
+    isTimeHistogramKnown_ = true;
+}
+
+void SearchData::truncate( LinesCount nbLines, LinesCount nbKeptMatches )
+{
+    UniqueLock locker( dataMutex_ );
+
+    const auto firstDroppedLine = LineNumber( nbLines.get() );
+    nbLinesProcessed_ = qMin( nbLinesProcessed_, nbLines );
+    matches_ = linesBefore( matches_, firstDroppedLine );
+    newMatches_ = linesBefore( newMatches_, firstDroppedLine );
+    nbMatches_ = nbKeptMatches + LinesCount( newMatches_.cardinality() );
+    timeHistogram_.truncate( nbLines );
+}
+
+void SearchData::restore( LineLength maxLength, LinesCount nbLinesProcessed,
+                          LinesCount nbMatches )
+{
+    UniqueLock locker( dataMutex_ );
+
+    maxLength_ = maxLength;
+    nbLinesProcessed_ = nbLinesProcessed;
+    nbMatches_ = nbMatches;
+    matches_ = {};
+    newMatches_ = {};
+    // Times of the restored matches are not known
+    timeHistogram_.clear();
+    isTimeHistogramKnown_ = false;
 }
 
 LogFilteredDataWorker::LogFilteredDataWorker( const LogData& sourceLogData )
@@ -194,13 +942,18 @@ void LogFilteredDataWorker::connectSignalsAndRun( SearchOperation* operationRequ
              &LogFilteredDataWorker::searchProgressed );
     connect( operationRequested, &SearchOperation::searchFinished, this,
              &LogFilteredDataWorker::searchFinished, Qt::QueuedConnection );
+    operationRequested->setProgress( &progress_ );
+    operationRequested->setSearchedLines( searchedLines_ );
 
-    operationRequested->run( searchData_ );
+    TaskScheduler::get().execute( sourceLogData_.taskPriority(), sourceLogData_.numaNode(),
+                                  [ this, operationRequested ] {
+                                      operationRequested->run( searchData_ );
+                                  } );
     operationRequested->disconnect( this );
 }
 
 void LogFilteredDataWorker::search( const RegularExpressionPattern& regExp, LineNumber startLine,
-                                    LineNumber endLine )
+                                    LineNumber endLine, OptionalLineNumber focusLine )
 {
     ScopedLock locker( operationsMutex_ ); // to protect operationRequested_
     operationsPool_.waitForDone();
@@ -208,13 +961,15 @@ void LogFilteredDataWorker::search( const RegularExpressionPattern& regExp, Line
 
     LOG_INFO << "Search requested";
     QSemaphore operationStarted;
-    operationsPool_.start( createRunnable( [ this, &operationStarted, regExp, startLine, endLine ] {
-        operationStarted.release();
-        ScopedLock operationLock( operationsMutex_ );
-        auto operationRequested = std::make_unique<FullSearchOperation>(
-            sourceLogData_, interruptRequested_, regExp, startLine, endLine );
-        connectSignalsAndRun( operationRequested.get() );
-    } ) );
+    operationsPool_.start(
+        createRunnable( [ this, &operationStarted, regExp, startLine, endLine, focusLine ] {
+            operationStarted.release();
+            ScopedLock operationLock( operationsMutex_ );
+            auto operationRequested = std::make_unique<FullSearchOperation>(
+                sourceLogData_, interruptRequested_, searchMatchers_, regExp, startLine, endLine,
+                focusLine );
+            connectSignalsAndRun( operationRequested.get() );
+        } ) );
     operationStarted.acquire();
 }
 
@@ -234,47 +989,203 @@ void LogFilteredDataWorker::updateSearch( const RegularExpressionPattern& regExp
             operationStarted.release();
             ScopedLock operationLock( operationsMutex_ );
             auto operationRequested = std::make_unique<UpdateSearchOperation>(
-                sourceLogData_, interruptRequested_, regExp, startLine, endLine, position );
+                sourceLogData_, interruptRequested_, searchMatchers_, regExp, startLine, endLine,
+                position );
+            connectSignalsAndRun( operationRequested.get() );
+        } ) );
+
+    operationStarted.acquire();
+}
+
+void LogFilteredDataWorker::refineSearch( const RegularExpressionPattern& regExp,
+                                          LineNumber startLine, LineNumber endLine,
+                                          std::shared_ptr<const SearchResultArray> candidateLines )
+{
+    ScopedLock locker( operationsMutex_ ); // to protect operationRequested_
+    operationsPool_.waitForDone();
+    interruptRequested_.clear();
+
+    LOG_INFO << "Search refine requested in " << candidateLines->cardinality() << " lines";
+
+    QSemaphore operationStarted;
+    operationsPool_.start( createRunnable(
+        [ this, &operationStarted, regExp, startLine, endLine, candidateLines ] {
+            operationStarted.release();
+            ScopedLock operationLock( operationsMutex_ );
+            auto operationRequested = std::make_unique<RefineSearchOperation>(
+                sourceLogData_, interruptRequested_, searchMatchers_, regExp, startLine, endLine,
+                candidateLines );
+            connectSignalsAndRun( operationRequested.get() );
+        } ) );
+
+    operationStarted.acquire();
+}
+
+void LogFilteredDataWorker::countMatches( const RegularExpressionPattern& regExp,
+                                          LineNumber startLine, LineNumber endLine,
+                                          MatchCounts counts )
+{
+    ScopedLock locker( operationsMutex_ ); // to protect operationRequested_
+    operationsPool_.waitForDone();
+    interruptRequested_.clear();
+
+    LOG_INFO << "Count of matches requested";
+
+    QSemaphore operationStarted;
+    operationsPool_.start(
+        createRunnable( [ this, &operationStarted, regExp, startLine, endLine,
+                          counts = std::move( counts ) ] {
+            operationStarted.release();
+            ScopedLock operationLock( operationsMutex_ );
+            auto operationRequested = std::make_unique<CountSearchOperation>(
+                sourceLogData_, interruptRequested_, searchMatchers_, regExp, startLine, endLine,
+                counts );
             connectSignalsAndRun( operationRequested.get() );
         } ) );
 
     operationStarted.acquire();
 }
 
+void LogFilteredDataWorker::setSearchedLines( std::shared_ptr<const SearchResultArray> lines )
+{
+    ScopedLock locker( operationsMutex_ );
+    searchedLines_ = std::move( lines );
+}
+
 void LogFilteredDataWorker::interrupt()
 {
     LOG_INFO << "Search interruption requested";
     interruptRequested_.set();
 }
 
+void LogFilteredDataWorker::truncateSearch( LinesCount nbLines, LinesCount nbKeptMatches )
+{
+    ScopedLock locker( operationsMutex_ );
+    operationsPool_.waitForDone();
+
+    LOG_INFO << "Search truncated to " << nbLines << " lines";
+    searchData_.truncate( nbLines, nbKeptMatches );
+}
+
+void LogFilteredDataWorker::restoreSearch( LineLength maxLength, LinesCount nbLines,
+                                           LinesCount nbMatches )
+{
+    ScopedLock locker( operationsMutex_ );
+    operationsPool_.waitForDone();
+
+    LOG_INFO << "Search restored to " << nbLines << " lines";
+    searchData_.restore( maxLength, nbLines, nbMatches );
+}
+
 // This will do an atomic copy of the object
 SearchResults LogFilteredDataWorker::getSearchResults() const
 {
     return searchData_.takeCurrentResults();
 }
 
+MatchCounts LogFilteredDataWorker::getMatchCounts() const
+{
+    return searchData_.getMatchCounts();
+}
+
+TimeHistogram LogFilteredDataWorker::getTimeHistogram() const
+{
+    return searchData_.getTimeHistogram();
+}
+
+uint64_t LogFilteredDataWorker::matchersSize() const
+{
+    return searchMatchers_.allocatedSize;
+}
+
 //
 // Operations implementation
 //
 
 SearchOperation::SearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
-                                  const RegularExpressionPattern& regExp, LineNumber startLine,
-                                  LineNumber endLine )
+                                  SearchMatchers& matchers, const RegularExpressionPattern& regExp,
+                                  LineNumber startLine, LineNumber endLine )
 
     : interruptRequested_( interruptRequested )
+    , matchers_( matchers )
     , regexp_( regExp )
     , sourceLogData_( sourceLogData )
     , startLine_( startLine )
     , endLine_( endLine )
 
 {
+    const auto& config = Configuration::get();
+    if ( config.searchTimeHistogram() && !config.timestampFormat().isEmpty() ) {
+        timestampParser_.emplace( config.timestampFormat() );
+    }
+}
+
+void SearchOperation::reportProgress( LinesCount nbMatches, int percent, LineNumber initialLine )
+{
+    if ( progress_ ) {
+        progress_->update( percent, nbMatches.get(), initialLine.get() );
+    }
+    else {
+        Q_EMIT searchProgressed( nbMatches, percent, initialLine );
+    }
+}
+
+void SearchOperation::prepareMatchers( uint32_t matchersCount )
+{
+    // Matchers, with their scratch spaces and statistics, are kept while the pattern is the same
+    const auto regexpEngine = Configuration::get().regexpEngine();
+    if ( !matchers_.pattern || !( *matchers_.pattern == regexp_ )
+         || matchers_.engine != regexpEngine ) {
+        matchers_.pattern = regexp_;
+        matchers_.engine = regexpEngine;
+        matchers_.expression = std::make_unique<RegularExpression>( regexp_ );
+        matchers_.matchers.clear();
+    }
+    else {
+        LOG_INFO << "Reusing " << matchers_.matchers.size() << " matchers";
+    }
+
+    while ( matchers_.matchers.size() < matchersCount ) {
+        matchers_.matchers.push_back( matchers_.expression->createMatcher() );
+    }
+
+    auto allocatedSize = static_cast<uint64_t>( matchers_.expression->allocatedSize() );
+    for ( const auto& matcher : matchers_.matchers ) {
+        allocatedSize += matcher->allocatedSize();
+    }
+    matchers_.allocatedSize = allocatedSize;
+}
+
+void SearchOperation::addToTimeHistogram( TimeHistogram& histogram,
+                                          const klogg::vector<std::string_view>& lines,
+                                          LineNumber firstLine,
+                                          const SearchResultArray& matchingLines ) const
+{
+    if ( !timestampParser_ ) {
+        return;
+    }
+
+    // Only matching lines are parsed
+    for ( const auto line : matchingLines ) {
+        const auto offset = static_cast<size_t>( line - firstLine.get() );
+        if ( offset >= lines.size() ) {
+            break;
+        }
+        if ( const auto time = timestampParser_->parse( lines[ offset ] ) ) {
+            histogram.add( *time, LineNumber( line ) );
+        }
+    }
 }
 
-void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
+void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine,
+                                OptionalLineNumber focusLine, std::optional<size_t> countBuckets )
 {
     const auto nbSourceLines = sourceLogData_.getNbLine();
 
     LOG_INFO << "Searching from line " << initialLine << " to " << nbSourceLines;
+    const TraceSpan span( "search", "search", "line", static_cast<int64_t>( initialLine.get() ) );
+
+    const RunningSearch runningSearch{ sourceLogData_ };
 
     using namespace std::chrono;
     high_resolution_clock::time_point t1 = high_resolution_clock::now();
@@ -285,11 +1196,14 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
             return 1;
         }
         const auto configuredThreadPoolSize = config.searchThreadPoolSize();
-        return qMax( 1, configuredThreadPoolSize == 0 ? tbb::info::default_concurrency()
+        return qMax( 1, configuredThreadPoolSize == 0 ? tbb::this_task_arena::max_concurrency()
                                                       : configuredThreadPoolSize );
     }() );
 
-    LOG_INFO << "Using " << matchingThreadsCount << " matching threads";
+    const auto readingThreadsCount = static_cast<uint32_t>( qMax( 1, config.searchReadThreads() ) );
+
+    LOG_INFO << "Using " << matchingThreadsCount << " matching threads, " << readingThreadsCount
+             << " reading threads";
 
     tbb::flow::graph searchGraph;
 
@@ -298,67 +1212,255 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
     }
 
     const auto endLine = qMin( LineNumber( nbSourceLines.get() ), endLine_ );
-    const auto nbLinesInChunk = LinesCount(
-        static_cast<LinesCount::UnderlyingType>( config.searchReadBufferSizeLines() ) );
+    const auto maxBlocksInFlight = matchingThreadsCount * 3 + readingThreadsCount;
+
+    // Chunks are sized as the last searches found best, but there are enough of them
+    // to keep all matchers busy and not more of them in flight than the memory allows
+    const auto maxChunkBytes = std::max(
+        MinChunkBytes,
+        std::min( { MaxChunkBytes, MaxBytesInFlight / static_cast<qint64>( maxBlocksInFlight ),
+                    sourceLogData_.getFileSize()
+                        / ( static_cast<qint64>( matchingThreadsCount ) * ChunksPerMatcher ) } ) );
+    const auto adaptedChunkBytes = sourceLogData_.searchChunkBytes();
+    const auto chunkBytes = std::min( adaptedChunkBytes > 0 ? adaptedChunkBytes : DefaultChunkBytes,
+                                      maxChunkBytes );
+
+    // Chunks only cover the searched lines, lines between them are not read
+    klogg::vector<LineNumber> chunkStarts;
+    klogg::vector<LineNumber> chunkEnds;
+    LinesCount totalLines = 0_lcount;
+    const auto addChunks = [ & ]( LineNumber first, LineNumber end ) {
+        const auto starts = splitInChunks( sourceLogData_, first, end, chunkBytes );
+        for ( auto index = 0u; index < starts.size(); ++index ) {
+            chunkStarts.push_back( starts[ index ] );
+            chunkEnds.push_back( index + 1 < starts.size() ? starts[ index + 1 ] : end );
+        }
+        totalLines += end - first;
+    };
+    if ( searchedLines_ ) {
+        const auto runs = lineRuns( *searchedLines_, initialLine, endLine );
+        for ( const auto& [ first, end ] : runs ) {
+            addChunks( first, end );
+        }
+        LOG_INFO << "Searching " << totalLines << " lines in " << runs.size() << " ranges";
+    }
+    else if ( initialLine < endLine ) {
+        addChunks( initialLine, endLine );
+    }
 
-    std::chrono::microseconds fileReadingDuration{ 0 };
+    const auto chunksCount = static_cast<uint64_t>( chunkStarts.size() );
+    const auto chunkOfLine = [ &chunkStarts ]( LineNumber line ) {
+        return static_cast<uint64_t>(
+            std::upper_bound( chunkStarts.cbegin(), chunkStarts.cend(), line )
+            - chunkStarts.cbegin() - 1 );
+    };
+
+    LOG_INFO << "Searching in " << chunksCount << " chunks of " << chunkBytes << " bytes";
+
+    // Chunks are searched in the file order unless the user looks at some other part of it
+    uint64_t focusedChunk = 0;
+    if ( focusLine && config.searchFromViewFirst() && *focusLine > initialLine
+         && chunksCount > 0 ) {
+        focusedChunk = chunkOfLine( *focusLine );
+        LOG_INFO << "Searching around line " << *focusLine << " first";
+    }
 
     using BlockDataType = SearchBlockData*;
-    auto blockPrefetcher
-        = tbb::flow::limiter_node<BlockDataType>( searchGraph, matchingThreadsCount * 3 );
+    SearchBlockPool blockPool( maxBlocksInFlight );
+
+    auto chunksQueue = tbb::flow::buffer_node<BlockDataType>( searchGraph );
+
+    using LineReaderNode
+        = tbb::flow::function_node<BlockDataType, BlockDataType, tbb::flow::rejecting>;
+
+    // Each reader reads consecutive chunks it gets from the same cursor
+    using ReaderContext = std::tuple<LineCursor, microseconds, LineReaderNode>;
+
+    klogg::vector<ReaderContext> lineReaders;
+    lineReaders.reserve( readingThreadsCount );
+    for ( auto index = 0u; index < readingThreadsCount; ++index ) {
+        lineReaders.emplace_back(
+            LineCursor{}, microseconds{ 0 },
+            LineReaderNode(
+                searchGraph, 1, [ &lineReaders, index, this ]( const BlockDataType& blockData ) {
+                    if ( interruptRequested_ || blockData->isSkipped || blockData->isAllMatching
+                         || blockData->fieldMatches || blockData->hasLongLines ) {
+                        blockData->sharedLines.reset();
+                        blockData->lines.clear();
+                        return blockData;
+                    }
+
+                    auto& readerContext = lineReaders.at( index );
+                    const TraceSpan readSpan( "read lines", "search", "line",
+                                              static_cast<int64_t>( blockData->chunkStart.get() ) );
+                    const auto lineSourceStartTime = high_resolution_clock::now();
+                    LOG_TRACE << "Reader " << index << " reading chunk starting at "
+                              << blockData->chunkStart;
+
+                    auto& cursor = std::get<LineCursor>( readerContext );
+                    blockData->sharedLines = sourceLogData_.getSharedLinesRaw(
+                        blockData->chunkStart, blockData->chunkLines, &cursor );
+                    if ( blockData->sharedLines ) {
+                        blockData->lines.clear();
+                    }
+                    else {
+                        sourceLogData_.getLinesRaw( blockData->chunkStart, blockData->chunkLines,
+                                                    blockData->lines, &cursor );
+                    }
+
+                    const auto lineSourceEndTime = high_resolution_clock::now();
+                    std::get<microseconds>( readerContext )
+                        += duration_cast<microseconds>( lineSourceEndTime - lineSourceStartTime );
+                    return blockData;
+                } ) );
+    }
 
     auto lineBlocksQueue = tbb::flow::buffer_node<BlockDataType>( searchGraph );
 
     using RegexMatcherNode
         = tbb::flow::function_node<BlockDataType, BlockDataType, tbb::flow::rejecting>;
 
-    using PatternMatcherPtr = std::unique_ptr<PatternMatcher>;
-    using MatcherContext = std::tuple<PatternMatcherPtr, microseconds, RegexMatcherNode>;
+    using PatternMatcherPtr = const PatternMatcher*;
+    // Each matching thread counts its matches in count only searches
+    using MatcherContext
+        = std::tuple<PatternMatcherPtr, microseconds, MatchCounts, RegexMatcherNode>;
+
+    prepareMatchers( matchingThreadsCount );
+
+    // Chunks which matching lines are known without reading them are read for their times
+    const auto countMatchesByTime = [ this ]( SearchBlockData& blockData ) {
+        auto& results = blockData.searchResults;
+        if ( !timestampParser_ || results.matchingLines.isEmpty() ) {
+            return;
+        }
+
+        const TraceSpan timeSpan( "count matches by time", "search", "line",
+                                  static_cast<int64_t>( blockData.chunkStart.get() ) );
+        if ( blockData.rawLines().endOfLines.empty() ) {
+            sourceLogData_.getLinesRaw( blockData.chunkStart, blockData.chunkLines,
+                                        blockData.lines );
+        }
+        addToTimeHistogram( results.timeHistogram, blockData.utf8Lines(), blockData.chunkStart,
+                            results.matchingLines );
+    };
 
     klogg::vector<MatcherContext> regexMatchers;
     regexMatchers.reserve( matchingThreadsCount );
-    RegularExpression regularExpression{ regexp_ };
     for ( auto index = 0u; index < matchingThreadsCount; ++index ) {
         regexMatchers.emplace_back(
-            regularExpression.createMatcher(), microseconds{ 0 },
+            matchers_.matchers[ index ].get(), microseconds{ 0 },
+            baseCounts ? baseCounts->emptyCopy() : MatchCounts{},
             RegexMatcherNode(
-                searchGraph, 1, [ &regexMatchers, index, this ]( const BlockDataType& blockData ) {
+                searchGraph, 1,
+                [ &regexMatchers, &countMatchesByTime, index,
+                  isCountOnly = baseCounts != nullptr,
+                  isNativeUtf16Search = config.nativeUtf16Search(),
+                  this ]( const BlockDataType& blockData ) {
                     if ( interruptRequested_ ) {
                         LOG_INFO << "Matcher " << index << " interrupted";
                         auto results = std::make_shared<PartialSearchResults>();
                         blockData->searchResults.chunkStart = blockData->chunkStart;
                         blockData->searchResults.processedLines
-                            = LinesCount{ blockData->lines.endOfLines.size() };
+                            = LinesCount{ blockData->rawLines().endOfLines.size() };
+                        return blockData;
+                    }
+
+                    if ( blockData->isSkipped ) {
+                        blockData->searchResults.chunkStart = blockData->chunkStart;
+                        blockData->searchResults.processedLines = blockData->chunkLines;
                         return blockData;
                     }
 
-                    const auto& matcher = std::get<PatternMatcherPtr>( regexMatchers.at( index ) );
+                    auto& matcherContext = regexMatchers.at( index );
+                    auto* counts = isCountOnly ? &std::get<MatchCounts>( matcherContext ) : nullptr;
+                    if ( blockData->hasLongLines ) {
+                        const TraceSpan matchSpan(
+                            "match long lines", "search", "line",
+                            static_cast<int64_t>( blockData->chunkStart.get() ) );
+                        blockData->searchResults = filterLongLines(
+                            sourceLogData_, *std::get<PatternMatcherPtr>( matcherContext ),
+                            blockData->chunkStart, blockData->chunkLines, counts );
+                        return blockData;
+                    }
+                    if ( blockData->isAllMatching ) {
+                        auto results = allLinesResults( sourceLogData_, blockData->chunkStart,
+                                                        blockData->chunkLines, counts );
+                        if ( results ) {
+                            blockData->searchResults = std::move( *results );
+                            countMatchesByTime( *blockData );
+                            return blockData;
+                        }
+
+                        // Lengths of matching lines are measured in the lines
+                        sourceLogData_.getLinesRaw( blockData->chunkStart, blockData->chunkLines,
+                                                    blockData->lines );
+                    }
+                    else if ( blockData->fieldMatches ) {
+                        auto results
+                            = knownLinesResults( sourceLogData_, blockData->chunkStart,
+                                                 blockData->chunkLines, *blockData->fieldMatches,
+                                                 counts );
+                        if ( results ) {
+                            blockData->searchResults = std::move( *results );
+                            countMatchesByTime( *blockData );
+                            return blockData;
+                        }
+
+                        sourceLogData_.getLinesRaw( blockData->chunkStart, blockData->chunkLines,
+                                                    blockData->lines );
+                    }
+
+                    const auto& matcher = std::get<PatternMatcherPtr>( matcherContext );
+                    const TraceSpan matchSpan(
+                        "match lines", "search", "line",
+                        static_cast<int64_t>( blockData->chunkStart.get() ) );
                     const auto matchStartTime = high_resolution_clock::now();
 
-                    blockData->searchResults
-                        = filterLines( *matcher, blockData->lines, blockData->chunkStart );
+                    // UTF-16 lines are transcoded only if the pattern can't be found in them
+                    auto utf16Results
+                        = isNativeUtf16Search
+                              ? filterUtf16Lines( sourceLogData_, *matcher, blockData->rawLines(),
+                                                  blockData->chunkStart, counts )
+                              : std::nullopt;
+                    if ( utf16Results ) {
+                        blockData->searchResults = std::move( *utf16Results );
+                    }
+                    else {
+                        blockData->searchResults = filterLines(
+                            sourceLogData_, *matcher, blockData->utf8Lines(),
+                            LinesCount{ blockData->rawLines().endOfLines.size() },
+                            blockData->chunkStart, counts );
+                    }
+                    countMatchesByTime( *blockData );
 
                     const auto matchEndTime = high_resolution_clock::now();
 
                     microseconds& matchDuration
                         = std::get<microseconds>( regexMatchers.at( index ) );
                     matchDuration += duration_cast<microseconds>( matchEndTime - matchStartTime );
-                    LOG_DEBUG << "Searcher " << index << " block " << blockData->chunkStart
+                    LOG_TRACE << "Searcher " << index << " block " << blockData->chunkStart
                               << " sending matches "
                               << blockData->searchResults.matchingLines.cardinality();
                     return blockData;
                 } ) );
     }
 
-    auto resultsQueue = tbb::flow::buffer_node<BlockDataType>( searchGraph );
+    // Progress and processed lines are reported for chunks in the search order
+    auto resultsQueue = tbb::flow::sequencer_node<BlockDataType>(
+        searchGraph, []( const BlockDataType& blockData ) { return blockData->chunkIndex; } );
 
-    const auto totalLines = endLine - initialLine;
     LinesCount totalProcessedLines = 0_lcount;
     LineLength maxLength = 0_length;
-    LinesCount nbMatches = searchData.getNbMatches();
+    LinesCount nbMatches = baseCounts ? baseCounts->nbMatches : searchData.getNbMatches();
     auto reportedMatches = nbMatches;
     int reportedPercentage = 0;
 
+    // Lines are reported as processed only when all lines before them are,
+    // so the search can be continued from there
+    klogg::vector<OptionalLineNumber> searchedChunkEnds( chunksCount );
+    uint64_t searchedChunksBefore = 0;
+    LinesCount processedLines = LinesCount{ initialLine.get() };
+
     std::chrono::microseconds matchCombiningDuration{ 0 };
 
     auto matchProcessor
@@ -366,28 +1468,49 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
             searchGraph, 1, [ & ]( const BlockDataType& blockData ) {
                 if ( interruptRequested_ ) {
                     LOG_INFO << "Match processor interrupted";
+                    blockPool.release( blockData );
                     return tbb::flow::continue_msg{};
                 }
 
                 const auto& matchResults = blockData->searchResults;
+                const TraceSpan processSpan(
+                    "process matches", "search", "line",
+                    static_cast<int64_t>( matchResults.chunkStart.get() ) );
 
                 const auto matchProcessorStartTime = high_resolution_clock::now();
 
                 if ( matchResults.processedLines.get() ) {
 
                     maxLength = qMax( maxLength, matchResults.maxLength );
-                    nbMatches += LinesCount( matchResults.matchingLines.cardinality() );
-
-                    const auto processedLines = LinesCount{ matchResults.chunkStart.get()
-                                                            + matchResults.processedLines.get() };
+                    nbMatches += matchResults.nbMatches;
+
+                    // Lines after a searched chunk up to the next one are not searched
+                    const auto chunk = chunkOfLine( matchResults.chunkStart );
+                    const auto chunkEnd = matchResults.chunkStart + matchResults.processedLines;
+                    searchedChunkEnds[ chunk ]
+                        = chunkEnd != chunkEnds[ chunk ] ? chunkEnd
+                          : chunk + 1 < chunksCount  ? chunkStarts[ chunk + 1 ]
+                                                     : endLine;
+                    while ( searchedChunksBefore < chunksCount
+                            && searchedChunkEnds[ searchedChunksBefore ] ) {
+                        processedLines
+                            = LinesCount{ searchedChunkEnds[ searchedChunksBefore ]->get() };
+                        ++searchedChunksBefore;
+                    }
 
                     totalProcessedLines += matchResults.processedLines;
 
                     // After each block, copy the data to shared data
                     // and update the client
-                    searchData.addAll( maxLength, matchResults.matchingLines, processedLines );
+                    if ( !baseCounts ) {
+                        searchData.addAll( maxLength,
+                                           std::move( blockData->searchResults.matchingLines ),
+                                           processedLines );
+                        searchData.addTimeHistogram(
+                            std::exchange( blockData->searchResults.timeHistogram, {} ) );
+                    }
 
-                    LOG_DEBUG << "done Searching chunk starting at " << matchResults.chunkStart
+                    LOG_TRACE << "done Searching chunk starting at " << matchResults.chunkStart
                               << ", " << matchResults.processedLines << " lines read.";
                 }
 
@@ -396,7 +1519,7 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
 
                 if ( percentage > reportedPercentage || nbMatches > reportedMatches ) {
 
-                    Q_EMIT searchProgressed( nbMatches, std::min( 99, percentage ), initialLine );
+                    reportProgress( nbMatches, std::min( 99, percentage ), initialLine );
 
                     reportedPercentage = percentage;
                     reportedMatches = nbMatches;
@@ -405,11 +1528,14 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
                 const auto matchProcessorEndTime = high_resolution_clock::now();
                 matchCombiningDuration += duration_cast<microseconds>( matchProcessorEndTime
                                                                        - matchProcessorStartTime );
-                delete blockData;
+                blockPool.release( blockData );
                 return tbb::flow::continue_msg{};
             } );
 
-    tbb::flow::make_edge( blockPrefetcher, lineBlocksQueue );
+    for ( auto& lineReader : lineReaders ) {
+        tbb::flow::make_edge( chunksQueue, std::get<LineReaderNode>( lineReader ) );
+        tbb::flow::make_edge( std::get<LineReaderNode>( lineReader ), lineBlocksQueue );
+    }
 
     for ( auto& regexMatcher : regexMatchers ) {
         tbb::flow::make_edge( lineBlocksQueue, std::get<RegexMatcherNode>( regexMatcher ) );
@@ -417,59 +1543,122 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
     }
 
     tbb::flow::make_edge( resultsQueue, matchProcessor );
-    tbb::flow::make_edge( matchProcessor, blockPrefetcher.decrementer() );
-
-    auto chunkStart = initialLine;
-    while ( chunkStart < endLine && !interruptRequested_ ) {
-        const auto lineSourceStartTime = high_resolution_clock::now();
-        LOG_DEBUG << "Reading chunk starting at " << chunkStart;
-
-        const auto linesInChunk
-            = LinesCount( qMin( nbLinesInChunk.get(), ( endLine - chunkStart ).get() ) );
-        auto lines = sourceLogData_.getLinesRaw( chunkStart, linesInChunk );
-
-        /*LOG_DEBUG << "Sending chunk starting at " << chunkStart << ", " <<
-            lines.second.size()
-                << " lines read.";*/
-        BlockDataType blockData = new SearchBlockData{chunkStart, std::move(lines)};
-        
-        const auto lineSourceEndTime = high_resolution_clock::now();
-        const auto chunkReadTime
-            = duration_cast<microseconds>( lineSourceEndTime - lineSourceStartTime );
 
-        /*LOG_DEBUG << "Sent chunk starting at " << chunkStart << ", " <<
-        blockData->lines.second.size()
-                << " lines read in " << static_cast<float>( chunkReadTime.count() )
-        / 1000.f
-                << " ms";*/
-
-        chunkStart = chunkStart + nbLinesInChunk;
-        fileReadingDuration += chunkReadTime;
+    // Chunks without trigrams or tokens of the literal still go through the graph,
+    // so they are counted as processed in order.
+    const auto requiredLiteral = matchers_.expression->requiredLiteral();
+    const auto requiredTokens = TokenFilters::wholeTokens(
+        requiredLiteral.text, requiredLiteral.isWordStart, requiredLiteral.isWordEnd );
+    uint64_t skippedChunks = 0;
+
+    // Chunks without the literal of an exclude pattern match as a whole
+    const auto excludedLiteral = matchers_.expression->excludedLiteral();
+    const auto excludedTokens = TokenFilters::wholeTokens(
+        excludedLiteral.text, excludedLiteral.isWordStart, excludedLiteral.isWordEnd );
+    uint64_t allMatchingChunks = 0;
+
+    // Lines matching a field query are taken from the field index where it is built
+    const auto fieldQuery = matchers_.expression->fieldQuery();
+    const auto isInverse = matchers_.matchers.front()->isInverse();
+    uint64_t fieldIndexedChunks = 0;
+
+    for ( uint64_t chunkIndex = 0; chunkIndex < chunksCount && !interruptRequested_;
+          ++chunkIndex ) {
+        const auto chunk = chunkAtPosition( chunkIndex, chunksCount, focusedChunk );
+        const auto chunkStart = chunkStarts[ chunk ];
+        const auto chunkEnd = chunkEnds[ chunk ];
+        LOG_TRACE << "Sending chunk starting at " << chunkStart;
+
+        BlockDataType blockData = blockPool.acquire( interruptRequested_ );
+        if ( blockData == nullptr ) {
+            break;
+        }
 
-        while ( !blockPrefetcher.try_put( blockData ) && !interruptRequested_ ) {
-            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        blockData->chunkIndex = chunkIndex;
+        blockData->chunkStart = chunkStart;
+        blockData->chunkLines = chunkEnd - chunkStart;
+        blockData->isSkipped
+            = !requiredLiteral.text.empty()
+              && !sourceLogData_.mayContainText( chunkStart, blockData->chunkLines,
+                                                 requiredLiteral.text, requiredTokens );
+        skippedChunks += blockData->isSkipped ? 1 : 0;
+        blockData->isAllMatching
+            = !excludedLiteral.text.empty()
+              && !sourceLogData_.mayContainText( chunkStart, blockData->chunkLines,
+                                                 excludedLiteral.text, excludedTokens );
+        allMatchingChunks += blockData->isAllMatching ? 1 : 0;
+        blockData->fieldMatches.reset();
+        if ( fieldQuery ) {
+            if ( const auto lines = sourceLogData_.getFieldMatches( *fieldQuery, chunkStart,
+                                                                    blockData->chunkLines ) ) {
+                blockData->fieldMatches
+                    = fieldMatchOffsets( *lines, chunkStart, blockData->chunkLines, isInverse );
+                ++fieldIndexedChunks;
+            }
         }
+        // Chunks with long lines are read line by line when they are matched
+        blockData->hasLongLines
+            = !blockData->isSkipped && !blockData->isAllMatching && !blockData->fieldMatches
+              && hasLongLines( sourceLogData_, chunkStart, blockData->chunkLines );
+
+        chunksQueue.try_put( blockData );
     }
 
     searchGraph.wait_for_all();
 
+    // Searched lines can be none of the lines after the initial one
+    if ( searchedLines_ && chunksCount == 0 && !interruptRequested_ && !baseCounts ) {
+        searchData.addAll( maxLength, {}, LinesCount( endLine.get() ) );
+    }
+
     high_resolution_clock::time_point t2 = high_resolution_clock::now();
     const auto durationUs = duration_cast<microseconds>( t2 - t1 );
     const auto durationMs = duration_cast<milliseconds>( t2 - t1 );
 
     LOG_INFO << "Searching done, overall duration " << durationUs;
-    LOG_INFO << "Line reading took " << fileReadingDuration;
+    LOG_INFO << "Skipped " << skippedChunks << " of " << chunksCount
+             << " chunks without the required literal, " << allMatchingChunks
+             << " without the excluded one, " << fieldIndexedChunks
+             << " found in the field index";
+    for ( const auto& lineReader : lineReaders ) {
+        LOG_INFO << "Line reading took " << std::get<microseconds>( lineReader );
+    }
     LOG_INFO << "Results combining took " << matchCombiningDuration;
 
     for ( const auto& regexMatcher : regexMatchers ) {
         LOG_INFO << "Matching took " << std::get<microseconds>( regexMatcher );
     }
 
+    // Next searches use chunks that are read and matched in about the target time
+    const auto searchedChunks
+        = chunksCount - skippedChunks - allMatchingChunks - fieldIndexedChunks;
+    if ( !interruptRequested_ && searchedChunks >= MinChunksToAdapt ) {
+        microseconds chunksDuration{ 0 };
+        for ( const auto& lineReader : lineReaders ) {
+            chunksDuration += std::get<microseconds>( lineReader );
+        }
+        for ( const auto& regexMatcher : regexMatchers ) {
+            chunksDuration += std::get<microseconds>( regexMatcher );
+        }
+
+        const auto chunkUs = std::max( int64_t{ 1 }, static_cast<int64_t>( chunksDuration.count() )
+                                                         / static_cast<int64_t>( searchedChunks ) );
+        // Chunks change gradually, a search of a different pattern can take longer
+        const auto nextChunkBytes
+            = std::clamp( std::clamp( chunkBytes * TargetChunkUs / chunkUs, chunkBytes / 4,
+                                      chunkBytes * 4 ),
+                          MinChunkBytes, MaxChunkBytes );
+        sourceLogData_.setSearchChunkBytes( nextChunkBytes );
+
+        LOG_INFO << "Chunks took " << chunkUs << " us, next searches use chunks of "
+                 << nextChunkBytes << " bytes";
+    }
+
     const auto totalFileSize = sourceLogData_.getFileSize();
 
     LOG_INFO << "Searching perf "
              << static_cast<uint64_t>(
-                    std::floor( 1000.f * static_cast<float>( ( endLine - initialLine ).get() )
+                    std::floor( 1000.f * static_cast<float>( totalLines.get() )
                                 / static_cast<float>( durationMs.count() ) ) )
              << " lines/s";
     LOG_INFO << "Searching io perf "
@@ -478,6 +1667,41 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
                     / ( 1024 * 1024 )
              << " MiB/s";
 
+    auto& metrics = Metrics::get();
+    metrics.counter( "search.runs" ).add();
+    metrics.counter( "search.lines" ).add( totalLines.get() );
+    metrics.counter( "search.skipped_chunks" ).add( skippedChunks );
+    metrics.counter( "search.all_matching_chunks" ).add( allMatchingChunks );
+    metrics.gauge( "search.chunk_bytes" ).set( static_cast<double>( chunkBytes ) );
+    metrics.histogram( "search.duration_us" ).record( static_cast<uint64_t>( durationUs.count() ) );
+    metrics.histogram( "search.combining_us" )
+        .record( static_cast<uint64_t>( matchCombiningDuration.count() ) );
+    auto& lineReadingDuration = metrics.histogram( "search.line_reading_us" );
+    for ( const auto& lineReader : lineReaders ) {
+        lineReadingDuration.record(
+            static_cast<uint64_t>( std::get<microseconds>( lineReader ).count() ) );
+    }
+    auto& matchingDuration = metrics.histogram( "search.matching_us" );
+    for ( const auto& regexMatcher : regexMatchers ) {
+        matchingDuration.record(
+            static_cast<uint64_t>( std::get<microseconds>( regexMatcher ).count() ) );
+    }
+    if ( durationUs.count() > 0 ) {
+        metrics.gauge( "search.throughput_lines_s" )
+            .set( 1e6 * static_cast<double>( totalLines.get() )
+                  / static_cast<double>( durationUs.count() ) );
+    }
+
+    if ( baseCounts ) {
+        auto counts = *baseCounts;
+        for ( const auto& regexMatcher : regexMatchers ) {
+            counts.merge( std::get<MatchCounts>( regexMatcher ) );
+        }
+        // Counts of chunks after an interruption can't be continued
+        counts.countedLines = interruptRequested_ ? 0_lcount : processedLines;
+        searchData.setMatchCounts( std::move( counts ) );
+    }
+
     Q_EMIT searchProgressed( nbMatches, 100, initialLine );
     Q_EMIT searchFinished();
 }
@@ -488,7 +1712,7 @@ void FullSearchOperation::run( SearchData& searchData )
     try {
         // Clear the shared data
         searchData.clear();
-        doSearch( searchData, 0_lnum );
+        doSearch( searchData, 0_lnum, focusLine_ );
     } catch ( const std::exception& err ) {
         const auto errorString = QString( "FullSearchOperation failed: %1" ).arg( err.what() );
         LOG_ERROR << errorString;
@@ -499,6 +1723,32 @@ void FullSearchOperation::run( SearchData& searchData )
     }
 }
 
+// Called in the worker thread's context
+void CountSearchOperation::run( SearchData& searchData )
+{
+    try {
+        searchData.clear();
+
+        // Last counted line is counted again, it might have been updated
+        // if it was not LF-terminated
+        auto initialLine = 0_lnum;
+        if ( counts_.countedLines.get() > 0 ) {
+            initialLine = LineNumber( counts_.countedLines.get() - 1 );
+            counts_.recount( initialLine );
+        }
+        counts_.fit( sourceLogData_.getNbLine() );
+
+        doSearch( searchData, initialLine, {}, &counts_ );
+    } catch ( const std::exception& err ) {
+        const auto errorString = QString( "CountSearchOperation failed: %1" ).arg( err.what() );
+        LOG_ERROR << errorString;
+        dispatchToMainThread( [ errorString ]() {
+            IssueReporter::askUserAndReportIssue( IssueTemplate::Exception, errorString );
+        } );
+        searchData.clear();
+    }
+}
+
 // Called in the worker thread's context
 void UpdateSearchOperation::run( SearchData& searchData )
 {
@@ -513,7 +1763,9 @@ void UpdateSearchOperation::run( SearchData& searchData )
             searchData.deleteMatch( initialLine );
         }
 
-        doSearch( searchData, initialLine );
+        if ( !searchAppendedLines( searchData, initialLine ) ) {
+            doSearch( searchData, initialLine );
+        }
     } catch ( const std::exception& err ) {
         const auto errorString = QString( "UpdateSearchOpertaion failed: %1" ).arg( err.what() );
         LOG_ERROR << errorString;
@@ -523,3 +1775,201 @@ void UpdateSearchOperation::run( SearchData& searchData )
         searchData.clear();
     }
 }
+
+bool UpdateSearchOperation::searchAppendedLines( SearchData& searchData, LineNumber initialLine )
+{
+    using namespace std::chrono;
+    const auto startTime = high_resolution_clock::now();
+
+    initialLine = qMax( initialLine, startLine_ );
+    const auto endLine = qMin( LineNumber( sourceLogData_.getNbLine().get() ), endLine_ );
+    const auto nbLines = endLine > initialLine ? endLine - initialLine : 0_lcount;
+
+    // Searched lines are only searched by chunks
+    if ( searchedLines_ ) {
+        return false;
+    }
+
+    // Lines that fit in one search chunk are appended by following the file
+    const auto maxLines = static_cast<LinesCount::UnderlyingType>(
+        Configuration::get().searchReadBufferSizeLines() );
+    if ( nbLines.get() > maxLines ) {
+        return false;
+    }
+
+    prepareMatchers( 1 );
+
+    auto nbMatches = searchData.getNbMatches();
+    if ( nbLines.get() > 0 ) {
+        const auto lines = sourceLogData_.getLinesRaw( initialLine, nbLines );
+        auto results = filterLines( sourceLogData_, *matchers_.matchers.front(),
+                                    lines.buildUtf8View(), LinesCount{ lines.endOfLines.size() },
+                                    initialLine, nullptr );
+
+        TimeHistogram timeHistogram;
+        addToTimeHistogram( timeHistogram, lines.buildUtf8View(), initialLine,
+                            results.matchingLines );
+        searchData.addTimeHistogram( timeHistogram );
+
+        nbMatches += results.nbMatches;
+        searchData.addAll( results.maxLength, std::move( results.matchingLines ),
+                           LinesCount{ initialLine.get() + results.processedLines.get() } );
+    }
+
+    LOG_DEBUG << "Searched " << nbLines << " appended lines in "
+              << duration_cast<microseconds>( high_resolution_clock::now() - startTime );
+
+    Q_EMIT searchProgressed( nbMatches, 100, initialLine );
+    Q_EMIT searchFinished();
+    return true;
+}
+
+void RefineSearchOperation::doRefine( SearchData& searchData )
+{
+    const auto endLine = qMin( LineNumber( sourceLogData_.getNbLine().get() ), endLine_ );
+    const auto totalCandidates = candidateLines_->cardinality();
+
+    LOG_INFO << "Refining " << totalCandidates << " lines from line " << startLine_ << " to "
+             << endLine;
+
+    using namespace std::chrono;
+    const auto startTime = high_resolution_clock::now();
+
+    // Matching lines are few, one matcher scanning them in batches keeps up with the reading
+    prepareMatchers( 1 );
+    const auto& matcher = *matchers_.matchers.front();
+
+    const auto linesInBatch = static_cast<uint64_t>(
+        qMax( 1, Configuration::get().searchReadBufferSizeLines() ) );
+    // Candidates close to each other are read at once with the lines between them
+    constexpr uint64_t MaxLinesGap = 16;
+
+    LogData::RawLines rawLines;
+    LineCursor cursor;
+
+    // Text of the candidates is copied, views of the read lines don't outlive the next read
+    klogg::vector<char> batchText;
+    klogg::vector<size_t> batchLineEnds;
+    klogg::vector<uint64_t> batchLines;
+    klogg::vector<std::string_view> batchViews;
+    klogg::vector<size_t> matchingOffsets;
+
+    LinesCount nbMatches = 0_lcount;
+    LineLength maxLength = 0_length;
+    uint64_t processedCandidates = 0;
+    uint64_t readLines = 0;
+    int reportedPercentage = 0;
+
+    const auto matchBatch = [ & ]( LinesCount processedLines ) {
+        batchViews.clear();
+        size_t lineStart = 0;
+        for ( const auto lineEnd : batchLineEnds ) {
+            batchViews.emplace_back( batchText.data() + lineStart, lineEnd - lineStart );
+            lineStart = lineEnd;
+        }
+
+        matchingOffsets.clear();
+        if ( !matcher.matchLines( batchViews, matchingOffsets ) ) {
+            matcher.findMatchingLines( batchViews, matchingOffsets );
+        }
+
+        SearchResultArray matches;
+        TimeHistogram timeHistogram;
+        for ( const auto offset : matchingOffsets ) {
+            matches.add( batchLines[ offset ] );
+            maxLength = qMax( maxLength, getUntabifiedLength( batchViews[ offset ] ) );
+
+            const auto time = timestampParser_ ? timestampParser_->parse( batchViews[ offset ] )
+                                               : std::nullopt;
+            if ( time ) {
+                timeHistogram.add( *time, LineNumber( batchLines[ offset ] ) );
+            }
+        }
+
+        nbMatches += LinesCount( matchingOffsets.size() );
+        processedCandidates += batchLines.size();
+        searchData.addAll( maxLength, std::move( matches ), processedLines );
+        searchData.addTimeHistogram( timeHistogram );
+
+        batchText.clear();
+        batchLineEnds.clear();
+        batchLines.clear();
+
+        const auto percentage = calculateProgress( processedCandidates, totalCandidates );
+        if ( percentage > reportedPercentage ) {
+            reportProgress( nbMatches, std::min( 99, percentage ), startLine_ );
+            reportedPercentage = percentage;
+        }
+    };
+
+    klogg::vector<uint64_t> rangeLines;
+    auto candidate = candidateLines_->begin();
+    if ( !candidate.move( startLine_.get() ) ) {
+        candidate = candidateLines_->end();
+    }
+
+    while ( candidate != candidateLines_->end() && *candidate < endLine.get()
+            && !interruptRequested_ ) {
+        const auto rangeStart = *candidate;
+        rangeLines.assign( 1, rangeStart );
+        for ( ++candidate; candidate != candidateLines_->end() && *candidate < endLine.get()
+                           && *candidate - rangeLines.back() <= MaxLinesGap
+                           && *candidate - rangeStart < linesInBatch;
+              ++candidate ) {
+            rangeLines.push_back( *candidate );
+        }
+
+        sourceLogData_.getLinesRaw( LineNumber( rangeStart ),
+                                    LinesCount( rangeLines.back() - rangeStart + 1 ), rawLines,
+                                    &cursor );
+        readLines += rangeLines.back() - rangeStart + 1;
+
+        const auto& lines = rawLines.buildUtf8View();
+        for ( const auto line : rangeLines ) {
+            const auto offset = static_cast<size_t>( line - rangeStart );
+            if ( offset < lines.size() ) {
+                batchText.insert( batchText.end(), lines[ offset ].begin(),
+                                  lines[ offset ].end() );
+                batchLineEnds.push_back( batchText.size() );
+                batchLines.push_back( line );
+            }
+        }
+
+        // Lines before the next candidate can't match, the search can be continued from there
+        if ( batchLines.size() >= linesInBatch ) {
+            matchBatch( LinesCount( rangeLines.back() + 1 ) );
+        }
+    }
+
+    if ( interruptRequested_ ) {
+        LOG_INFO << "Refine interrupted";
+        Q_EMIT searchProgressed( nbMatches, 100, startLine_ );
+        Q_EMIT searchFinished();
+        return;
+    }
+
+    matchBatch( LinesCount( endLine.get() ) );
+
+    const auto duration
+        = duration_cast<microseconds>( high_resolution_clock::now() - startTime );
+    LOG_INFO << "Refining done, " << readLines << " lines read, overall duration " << duration;
+
+    Q_EMIT searchProgressed( nbMatches, 100, startLine_ );
+    Q_EMIT searchFinished();
+}
+
+// Called in the worker thread's context
+void RefineSearchOperation::run( SearchData& searchData )
+{
+    try {
+        searchData.clear();
+        doRefine( searchData );
+    } catch ( const std::exception& err ) {
+        const auto errorString = QString( "RefineSearchOperation failed: %1" ).arg( err.what() );
+        LOG_ERROR << errorString;
+        dispatchToMainThread( [ errorString ]() {
+            IssueReporter::askUserAndReportIssue( IssueTemplate::Exception, errorString );
+        } );
+        searchData.clear();
+    }
+}
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logtemplates.h"
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include "log.h"
+#include "logdata.h"
+
+namespace {
+// Lines read and mined at once by a task
+constexpr LinesCount::UnderlyingType ChunkLines = 16 * 1024;
+// Share of tokens a line must have equal to a template to join it
+constexpr double SimilarityThreshold = 0.5;
+
+bool isWildcard( std::string_view token )
+{
+    return token == TemplateMiner::Wildcard;
+}
+
+bool isSeparator( char c )
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Tokens of the line separated by spaces, the ones with digits are wildcards
+void tokenize( std::string_view line, klogg::vector<std::string_view>& tokens )
+{
+    tokens.clear();
+    size_t position = 0;
+    while ( position < line.size() ) {
+        while ( position < line.size() && isSeparator( line[ position ] ) ) {
+            ++position;
+        }
+        const auto start = position;
+        auto hasDigit = false;
+        while ( position < line.size() && !isSeparator( line[ position ] ) ) {
+            hasDigit = hasDigit || ( line[ position ] >= '0' && line[ position ] <= '9' );
+            ++position;
+        }
+        if ( position > start ) {
+            tokens.push_back( hasDigit ? TemplateMiner::Wildcard
+                                       : line.substr( start, position - start ) );
+        }
+    }
+
+    // Tails of very long lines are one token
+    if ( tokens.size() > TemplateMiner::MaxTokens ) {
+        tokens.resize( TemplateMiner::MaxTokens );
+        tokens.back() = TemplateMiner::Wildcard;
+    }
+}
+
+template <typename Token>
+size_t equalTokens( const klogg::vector<std::string>& templateTokens,
+                    const klogg::vector<Token>& tokens )
+{
+    size_t equal = 0;
+    for ( size_t index = 0; index < tokens.size(); ++index ) {
+        const auto& templateToken = templateTokens[ index ];
+        if ( isWildcard( templateToken ) || isWildcard( tokens[ index ] )
+             || templateToken == tokens[ index ] ) {
+            ++equal;
+        }
+    }
+    return equal;
+}
+
+// Tokens of the template that differ from the tokens become wildcards
+template <typename Token>
+void generalize( klogg::vector<std::string>& templateTokens, const klogg::vector<Token>& tokens )
+{
+    for ( size_t index = 0; index < tokens.size(); ++index ) {
+        auto& templateToken = templateTokens[ index ];
+        if ( !isWildcard( templateToken ) && templateToken != tokens[ index ] ) {
+            templateToken = TemplateMiner::Wildcard;
+        }
+    }
+}
+} // namespace
+
+template <typename Token>
+klogg::vector<size_t>* TemplateMiner::findGroup( const klogg::vector<Token>& tokens )
+{
+    groupKey_ = std::to_string( tokens.size() );
+    if ( !tokens.empty() ) {
+        groupKey_.push_back( ' ' );
+        groupKey_.append( tokens.front() );
+    }
+
+    auto group = groups_.find( groupKey_ );
+    if ( group == groups_.end() ) {
+        if ( clusters_.size() >= MaxTemplates ) {
+            return nullptr;
+        }
+        group = groups_.emplace( groupKey_, klogg::vector<size_t>{} ).first;
+    }
+    return &group->second;
+}
+
+template <typename Token>
+TemplateMiner::Cluster* TemplateMiner::similarCluster( const klogg::vector<size_t>& group,
+                                                       const klogg::vector<Token>& tokens )
+{
+    Cluster* similar = nullptr;
+    size_t similarEqualTokens = 0;
+    for ( const auto index : group ) {
+        auto& cluster = clusters_[ index ];
+        const auto equal = equalTokens( cluster.tokens, tokens );
+        if ( similar == nullptr || equal > similarEqualTokens ) {
+            similar = &cluster;
+            similarEqualTokens = equal;
+        }
+    }
+
+    if ( similar == nullptr || clusters_.size() >= MaxTemplates
+         || static_cast<double>( similarEqualTokens )
+                >= SimilarityThreshold * static_cast<double>( tokens.size() ) ) {
+        return similar;
+    }
+    return nullptr;
+}
+
+template <typename Token>
+TemplateMiner::Cluster& TemplateMiner::addCluster( klogg::vector<size_t>& group,
+                                                   const klogg::vector<Token>& tokens )
+{
+    group.push_back( clusters_.size() );
+    auto& cluster = clusters_.emplace_back();
+    cluster.tokens.assign( tokens.begin(), tokens.end() );
+    return cluster;
+}
+
+void TemplateMiner::add( std::string_view line, LineNumber lineNumber )
+{
+    tokenize( line, lineTokens_ );
+
+    auto* group = findGroup( lineTokens_ );
+    if ( group == nullptr ) {
+        ++unclusteredLines_;
+        return;
+    }
+
+    auto* cluster = similarCluster( *group, lineTokens_ );
+    if ( cluster == nullptr ) {
+        cluster = &addCluster( *group, lineTokens_ );
+    }
+
+    generalize( cluster->tokens, lineTokens_ );
+    cluster->lines.add( lineNumber.get() );
+    ++cluster->count;
+}
+
+void TemplateMiner::merge( TemplateMiner&& other )
+{
+    unclusteredLines_ += other.unclusteredLines_;
+
+    for ( auto& otherCluster : other.clusters_ ) {
+        auto* group = findGroup( otherCluster.tokens );
+        if ( group == nullptr ) {
+            unclusteredLines_ += otherCluster.count;
+            continue;
+        }
+
+        auto* cluster = similarCluster( *group, otherCluster.tokens );
+        if ( cluster == nullptr ) {
+            auto& addedCluster = addCluster( *group, otherCluster.tokens );
+            addedCluster.lines = std::move( otherCluster.lines );
+            addedCluster.count = otherCluster.count;
+            continue;
+        }
+
+        generalize( cluster->tokens, otherCluster.tokens );
+        cluster->lines |= otherCluster.lines;
+        cluster->count += otherCluster.count;
+    }
+
+    other.clusters_.clear();
+    other.groups_.clear();
+    other.unclusteredLines_ = 0;
+}
+
+klogg::vector<LogTemplates::Template> TemplateMiner::takeTemplates()
+{
+    klogg::vector<size_t> order( clusters_.size() );
+    std::iota( order.begin(), order.end(), size_t{ 0 } );
+    std::sort( order.begin(), order.end(), [ this ]( size_t lhs, size_t rhs ) {
+        const auto& left = clusters_[ lhs ];
+        const auto& right = clusters_[ rhs ];
+        return left.count != right.count ? left.count > right.count
+                                         : left.lines.minimum() < right.lines.minimum();
+    } );
+
+    klogg::vector<LogTemplates::Template> templates;
+    templates.reserve( clusters_.size() );
+    std::string text;
+    for ( const auto index : order ) {
+        auto& cluster = clusters_[ index ];
+
+        text.clear();
+        for ( const auto& token : cluster.tokens ) {
+            if ( !text.empty() ) {
+                text.push_back( ' ' );
+            }
+            text.append( token );
+        }
+
+        templates.push_back( LogTemplates::Template{
+            QString::fromUtf8( text.data(), static_cast<int>( text.size() ) ),
+            std::move( cluster.lines ) } );
+    }
+
+    clusters_.clear();
+    groups_.clear();
+    return templates;
+}
+
+LogTemplates LogTemplates::mine( const LogData& logData, const AtomicFlag& interruptRequested )
+{
+    const auto nbLines = logData.getNbLine();
+    const auto chunksCount = ( nbLines.get() + ChunkLines - 1 ) / ChunkLines;
+
+    logData.attachReader();
+
+    // Each thread mines its own templates
+    tbb::enumerable_thread_specific<TemplateMiner> miners;
+    std::atomic<uint64_t> minedLines{ 0 };
+    tbb::parallel_for( tbb::blocked_range<uint64_t>( 0, chunksCount, 1 ),
+                       [ & ]( const tbb::blocked_range<uint64_t>& range ) {
+                           auto& miner = miners.local();
+                           LogData::RawLines rawLines;
+                           LineCursor cursor;
+                           for ( auto chunk = range.begin(); chunk != range.end(); ++chunk ) {
+                               if ( interruptRequested ) {
+                                   return;
+                               }
+
+                               const auto first = LineNumber( chunk * ChunkLines );
+                               const auto number = std::min(
+                                   LinesCount( ChunkLines ), nbLines - LinesCount( first.get() ) );
+                               logData.getLinesRaw( first, number, rawLines, &cursor );
+
+                               const auto& lines = rawLines.buildUtf8View();
+                               for ( size_t offset = 0; offset < lines.size(); ++offset ) {
+                                   miner.add( lines[ offset ], first + LinesCount( offset ) );
+                               }
+                               minedLines += lines.size();
+                           }
+                       } );
+
+    logData.detachReader();
+
+    TemplateMiner allTemplates;
+    for ( auto& miner : miners ) {
+        allTemplates.merge( std::move( miner ) );
+    }
+
+    LogTemplates templates;
+    templates.templates = allTemplates.takeTemplates();
+    templates.minedLines = LinesCount( minedLines.load() );
+    templates.unclusteredLines = LinesCount( allTemplates.unclusteredLines() );
+
+    LOG_INFO << "Found " << templates.templates.size() << " templates in "
+             << templates.minedLines << " lines";
+    return templates;
+}
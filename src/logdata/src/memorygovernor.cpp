@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "memorygovernor.h"
+
+#include <algorithm>
+
+#include "configuration.h"
+#include "log.h"
+#include "memory_info.h"
+#include "readablesize.h"
+
+#ifdef KLOGG_HAS_HS
+#include "hsdatabasecache.h"
+#include "hsregularexpression.h"
+#endif
+
+namespace {
+constexpr int BudgetCheckIntervalMs = 2000;
+} // namespace
+
+MemoryGovernor& MemoryGovernor::get()
+{
+    static auto* const instance = new MemoryGovernor;
+    return *instance;
+}
+
+const char* MemoryGovernor::kindName( Kind kind )
+{
+    switch ( kind ) {
+    case Kind::LineIndex:
+        return "line index";
+    case Kind::SearchIndex:
+        return "search index";
+    case Kind::SearchResults:
+        return "search results";
+    case Kind::SearchCache:
+        return "search cache";
+    case Kind::ReadBuffers:
+        return "read buffers";
+    case Kind::LineCache:
+        return "decoded lines";
+    case Kind::ViewCache:
+        return "view caches";
+    case Kind::RegexEngine:
+        return "regex engine";
+    }
+    return "";
+}
+
+MemoryGovernor::MemoryGovernor()
+{
+    connect( &checkTimer_, &QTimer::timeout, this, &MemoryGovernor::enforceBudget );
+    checkTimer_.start( BudgetCheckIntervalMs );
+
+#ifdef KLOGG_HAS_HS
+    // Compiled patterns and scratch spaces are shared by searches of all files
+    addUsage( this, nullptr, Kind::RegexEngine, [] {
+        return static_cast<uint64_t>( HsDatabaseCache::instance().allocatedSize()
+                                      + pooledHsScratchSize() );
+    } );
+#endif
+    setGroupName( nullptr, tr( "Shared" ) );
+}
+
+void MemoryGovernor::addCache( const void* owner, const void* group, Kind kind, Cache cache )
+{
+    ScopedLock lock( mutex_ );
+    caches_.push_back( { owner, group, kind, std::move( cache ) } );
+
+    if ( std::find( groupsUsage_.begin(), groupsUsage_.end(), group ) == groupsUsage_.end() ) {
+        groupsUsage_.push_back( group );
+    }
+}
+
+void MemoryGovernor::addUsage( const void* owner, const void* group, Kind kind,
+                               std::function<uint64_t()> bytes )
+{
+    addCache( owner, group, kind, { std::move( bytes ), {} } );
+}
+
+void MemoryGovernor::removeCaches( const void* owner )
+{
+    ScopedLock lock( mutex_ );
+    caches_.erase(
+        std::remove_if( caches_.begin(), caches_.end(),
+                        [ owner ]( const auto& cache ) { return cache.owner == owner; } ),
+        caches_.end() );
+
+    groupsUsage_.erase(
+        std::remove_if( groupsUsage_.begin(), groupsUsage_.end(),
+                        [ this ]( const void* group ) {
+                            return std::none_of(
+                                caches_.begin(), caches_.end(),
+                                [ group ]( const auto& cache ) { return cache.group == group; } );
+                        } ),
+        groupsUsage_.end() );
+
+    for ( auto name = groupNames_.begin(); name != groupNames_.end(); ) {
+        if ( name->first != nullptr
+             && std::find( groupsUsage_.begin(), groupsUsage_.end(), name->first )
+                    == groupsUsage_.end() ) {
+            name = groupNames_.erase( name );
+        }
+        else {
+            ++name;
+        }
+    }
+}
+
+void MemoryGovernor::setGroupName( const void* group, const QString& name )
+{
+    ScopedLock lock( mutex_ );
+    groupNames_[ group ] = name;
+}
+
+klogg::vector<MemoryGovernor::GroupUsage> MemoryGovernor::usage() const
+{
+    SharedLock lock( mutex_ );
+
+    klogg::vector<GroupUsage> groups;
+    groups.reserve( groupsUsage_.size() );
+    for ( auto group = groupsUsage_.rbegin(); group != groupsUsage_.rend(); ++group ) {
+        GroupUsage groupUsage;
+        const auto name = groupNames_.find( *group );
+        if ( name != groupNames_.end() ) {
+            groupUsage.name = name->second;
+        }
+
+        for ( const auto& registered : caches_ ) {
+            if ( registered.group == *group ) {
+                groupUsage.bytes[ static_cast<size_t>( registered.kind ) ]
+                    += registered.cache.bytes();
+            }
+        }
+
+        groups.push_back( std::move( groupUsage ) );
+    }
+
+    return groups;
+}
+
+void MemoryGovernor::markUsed( const void* group )
+{
+    ScopedLock lock( mutex_ );
+    const auto usage = std::find( groupsUsage_.begin(), groupsUsage_.end(), group );
+    if ( usage != groupsUsage_.end() ) {
+        std::rotate( usage, std::next( usage ), groupsUsage_.end() );
+    }
+}
+
+uint64_t MemoryGovernor::budget()
+{
+    return static_cast<uint64_t>( std::max( 0, Configuration::get().memoryBudgetMb() ) ) * 1024
+           * 1024;
+}
+
+void MemoryGovernor::enforceBudget()
+{
+    const auto budgetBytes = budget();
+    if ( budgetBytes == 0 ) {
+        return;
+    }
+
+    const auto used = usedMemory();
+    if ( used <= budgetBytes ) {
+        return;
+    }
+
+    // Freed memory is not always returned to the system at once,
+    // so caches are dropped by their own accounting.
+    auto excess = used - budgetBytes;
+    LOG_INFO << "Memory used " << readableSize( used ) << " is over the budget by "
+             << readableSize( excess );
+
+    ScopedLock lock( mutex_ );
+    for ( const auto* group : groupsUsage_ ) {
+        for ( const auto& registered : caches_ ) {
+            if ( registered.group != group || !registered.cache.evict ) {
+                continue;
+            }
+
+            const auto bytes = registered.cache.bytes();
+            if ( bytes == 0 ) {
+                continue;
+            }
+
+            registered.cache.evict();
+            const auto freed = bytes - std::min( bytes, registered.cache.bytes() );
+            LOG_INFO << "Dropped cache of " << readableSize( freed );
+
+            excess -= std::min( excess, freed );
+            if ( excess == 0 ) {
+                return;
+            }
+        }
+    }
+}
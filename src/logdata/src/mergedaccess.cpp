@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mergedaccess.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <string_view>
+#include <utility>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "fileholder.h"
+#include "log.h"
+#include "timehistogram.h"
+
+namespace {
+constexpr qint64 ReadChunkSize = 1024 * 1024;
+
+// Lines before the first timestamp of a log come first
+constexpr int64_t LeadingTime = std::numeric_limits<int64_t>::min();
+
+struct Line {
+    qint64 offset = 0;
+    // With the line feed if the line has one
+    qint64 size = 0;
+    bool hasLineFeed = false;
+    // Valid until the next line is read
+    std::string_view text;
+};
+
+struct Record {
+    int64_t time = LeadingTime;
+    qint64 offset = 0;
+    qint64 size = 0;
+    bool hasLineFeed = false;
+};
+
+// Lines of a log read in chunks
+class LineReader {
+  public:
+    LineReader( const FileReader& file, qint64 fileSize )
+        : file_( file )
+        , fileSize_( fileSize )
+    {
+    }
+
+    // Next line, empty at the end of the log
+    std::optional<Line> next()
+    {
+        for ( ;; ) {
+            const auto available = buffer_.size() - begin_;
+            const auto* start = buffer_.data() + begin_;
+            const auto* lineFeed
+                = available > 0
+                      ? static_cast<const char*>( std::memchr( start, '\n', available ) )
+                      : nullptr;
+            if ( lineFeed != nullptr ) {
+                return takeLine( static_cast<size_t>( lineFeed - start ) + 1, true );
+            }
+
+            const auto bufferEnd = bufferOffset_ + static_cast<qint64>( buffer_.size() );
+            if ( bufferEnd >= fileSize_ ) {
+                // Last line without a line feed
+                return available > 0 ? takeLine( available, false ) : std::optional<Line>{};
+            }
+
+            // Beginning of the line is kept while the rest is read
+            buffer_.erase( buffer_.begin(), buffer_.begin() + static_cast<ptrdiff_t>( begin_ ) );
+            bufferOffset_ += static_cast<qint64>( begin_ );
+            begin_ = 0;
+
+            const auto kept = buffer_.size();
+            const auto toRead = std::min( ReadChunkSize, fileSize_ - bufferEnd );
+            buffer_.resize( kept + static_cast<size_t>( toRead ) );
+            const auto bytesRead = file_.read( bufferEnd, buffer_.data() + kept, toRead );
+            buffer_.resize( kept + static_cast<size_t>( std::max( bytesRead, qint64{ 0 } ) ) );
+            if ( bytesRead <= 0 ) {
+                LOG_WARNING << "Merged log is shorter than expected at " << bufferEnd;
+                fileSize_ = bufferEnd;
+            }
+        }
+    }
+
+  private:
+    Line takeLine( size_t size, bool hasLineFeed )
+    {
+        const Line line{ bufferOffset_ + static_cast<qint64>( begin_ ),
+                         static_cast<qint64>( size ), hasLineFeed,
+                         std::string_view( buffer_.data() + begin_, size ) };
+        begin_ += size;
+        return line;
+    }
+
+    const FileReader& file_;
+    qint64 fileSize_;
+
+    klogg::vector<char> buffer_;
+    // Offset of the buffer in the log and of the next line in the buffer
+    qint64 bufferOffset_ = 0;
+    size_t begin_ = 0;
+};
+
+// Records of a log: a line with a timestamp and the lines without one after it
+class RecordReader {
+  public:
+    RecordReader( const FileReader& file, qint64 fileSize, const TimestampParser& parser )
+        : lines_( file, fileSize )
+        , parser_( parser )
+    {
+        if ( const auto line = lines_.next() ) {
+            pending_ = makeRecord( *line, parseTime( *line ).value_or( LeadingTime ) );
+        }
+    }
+
+    // Next record, empty at the end of the log
+    std::optional<Record> next()
+    {
+        auto record = std::exchange( pending_, std::nullopt );
+        if ( !record ) {
+            return {};
+        }
+
+        while ( const auto line = lines_.next() ) {
+            if ( const auto time = parseTime( *line ) ) {
+                pending_ = makeRecord( *line, *time );
+                break;
+            }
+
+            record->size += line->size;
+            record->hasLineFeed = line->hasLineFeed;
+        }
+
+        return record;
+    }
+
+  private:
+    static Record makeRecord( const Line& line, int64_t time )
+    {
+        return Record{ time, line.offset, line.size, line.hasLineFeed };
+    }
+
+    std::optional<int64_t> parseTime( const Line& line ) const
+    {
+        return parser_.parseMilliseconds(
+            line.text.substr( 0, static_cast<size_t>( MergedAccess::MaxTimestampOffset ) ) );
+    }
+
+    LineReader lines_;
+    const TimestampParser& parser_;
+    std::optional<Record> pending_;
+};
+
+QStringList readMergeList( const QString& listFileName,
+                           const CompressedAccess::ReadCompressed& readCompressed,
+                           qint64 listSize )
+{
+    QByteArray list( static_cast<int>( listSize ), Qt::Uninitialized );
+    qint64 listRead = 0;
+    while ( listRead < listSize ) {
+        const auto bytesRead
+            = readCompressed( listRead, list.data() + listRead, listSize - listRead );
+        if ( bytesRead <= 0 ) {
+            break;
+        }
+        listRead += bytesRead;
+    }
+    list.truncate( static_cast<int>( listRead ) );
+
+    const auto listDir = QFileInfo( listFileName ).absoluteDir();
+
+    QStringList logFileNames;
+    for ( const auto& entry : QString::fromUtf8( list ).split( '\n' ) ) {
+        const auto path = entry.trimmed();
+        if ( path.isEmpty() || path.startsWith( '#' ) ) {
+            continue;
+        }
+        logFileNames.append( QDir::cleanPath( listDir.absoluteFilePath( path ) ) );
+    }
+    return logFileNames;
+}
+} // namespace
+
+bool MergedAccess::isMergeList( const QString& fileName )
+{
+    return fileName.endsWith( ".klogg-merge", Qt::CaseInsensitive );
+}
+
+bool MergedAccess::writeMergeList( const QString& listFileName, const QStringList& logFileNames )
+{
+    QFile list( listFileName );
+    if ( !list.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        return false;
+    }
+
+    for ( const auto& logFileName : logFileNames ) {
+        list.write( QDir::toNativeSeparators( logFileName ).toUtf8() );
+        list.write( "\n" );
+    }
+    return list.flush();
+}
+
+MergedAccess::MergedAccess( const QString& listFileName, const QString& timestampFormat )
+    : listFileName_( listFileName )
+    , timestampFormat_( timestampFormat )
+{
+}
+
+bool MergedAccess::isBuilt() const
+{
+    return isBuilt_;
+}
+
+qint64 MergedAccess::size() const
+{
+    return isBuilt_ ? size_ : 0;
+}
+
+QStringList MergedAccess::logFileNames() const
+{
+    return isBuilt_ ? logFileNames_ : QStringList{};
+}
+
+bool MergedAccess::build( const ReadCompressed& readCompressed, qint64 compressedSize )
+{
+    ScopedLock lock( buildMutex_ );
+    if ( isBuilt_ ) {
+        return true;
+    }
+
+    logFileNames_ = readMergeList( listFileName_, readCompressed, compressedSize );
+
+    klogg::vector<qint64> logSizes;
+    for ( const auto& logFileName : logFileNames_ ) {
+        auto file = std::make_shared<QFile>( logFileName );
+        if ( !file->open( QIODevice::ReadOnly ) ) {
+            LOG_WARNING << "Can't open merged log " << logFileName << ": " << file->errorString();
+            logFileNames_.clear();
+            logs_.clear();
+            return false;
+        }
+
+        logSizes.push_back( file->size() );
+        logs_.push_back( std::make_shared<const FileReader>( std::move( file ) ) );
+    }
+
+    const TimestampParser parser( timestampFormat_ );
+
+    klogg::vector<RecordReader> records;
+    records.reserve( logs_.size() );
+    for ( size_t log = 0; log < logs_.size(); ++log ) {
+        records.emplace_back( *logs_[ log ], logSizes[ log ], parser );
+    }
+
+    // Next record of each log, the earliest one is merged first
+    using Head = std::pair<int64_t, uint32_t>;
+    std::priority_queue<Head, klogg::vector<Head>, std::greater<>> heads;
+    klogg::vector<std::optional<Record>> nextRecords( logs_.size() );
+    for ( uint32_t log = 0; log < logs_.size(); ++log ) {
+        nextRecords[ log ] = records[ log ].next();
+        if ( nextRecords[ log ] ) {
+            heads.emplace( nextRecords[ log ]->time, log );
+        }
+    }
+
+    size_ = 0;
+    runs_.clear();
+    while ( !heads.empty() ) {
+        const auto log = heads.top().second;
+        heads.pop();
+
+        const auto& record = *nextRecords[ log ];
+        appendRun( log, record.offset, record.size, !record.hasLineFeed );
+
+        nextRecords[ log ] = records[ log ].next();
+        if ( nextRecords[ log ] ) {
+            heads.emplace( nextRecords[ log ]->time, log );
+        }
+    }
+    runs_.shrink_to_fit();
+
+    LOG_INFO << "Merged " << logs_.size() << " logs, " << size_ << " bytes in " << runs_.size()
+             << " runs";
+
+    isBuilt_ = true;
+    return true;
+}
+
+void MergedAccess::appendRun( uint32_t log, qint64 logOffset, qint64 size, bool addsLineFeed )
+{
+    const auto mergedSize = size + ( addsLineFeed ? 1 : 0 );
+
+    // Records following each other in the log are one run
+    if ( !runs_.empty() ) {
+        auto& last = runs_.back();
+        if ( last.log == log && !last.addsLineFeed
+             && last.logOffset + ( size_ - last.mergedOffset ) == logOffset ) {
+            last.addsLineFeed = addsLineFeed;
+            size_ += mergedSize;
+            return;
+        }
+    }
+
+    runs_.push_back( { size_, logOffset, log, addsLineFeed } );
+    size_ += mergedSize;
+}
+
+klogg::vector<MergedAccess::Run>::const_iterator MergedAccess::findRun( qint64 offset ) const
+{
+    if ( offset < 0 || offset >= size_ ) {
+        return runs_.end();
+    }
+
+    const auto next = std::upper_bound(
+        runs_.begin(), runs_.end(), offset,
+        []( qint64 value, const Run& run ) { return value < run.mergedOffset; } );
+    return std::prev( next );
+}
+
+std::unique_ptr<CompressedAccess::Reader>
+MergedAccess::makeReader( ReadCompressed readCompressed ) const
+{
+    Q_UNUSED( readCompressed );
+
+    return std::make_unique<Reader>(
+        std::static_pointer_cast<const MergedAccess>( shared_from_this() ) );
+}
+
+MergedAccess::Reader::Reader( std::shared_ptr<const MergedAccess> access )
+    : access_( std::move( access ) )
+{
+}
+
+qint64 MergedAccess::Reader::position() const
+{
+    return position_;
+}
+
+qint64 MergedAccess::Reader::read( qint64 offset, char* data, qint64 size )
+{
+    const auto& access = *access_;
+    const auto& runs = access.runs_;
+
+    qint64 bytesRead = 0;
+    auto run = access.findRun( offset );
+    while ( bytesRead < size && run != runs.end() ) {
+        const auto position = offset + bytesRead;
+        const auto next = std::next( run );
+        const auto runEnd = next != runs.end() ? next->mergedOffset : access.size_;
+        if ( position >= runEnd ) {
+            run = next;
+            continue;
+        }
+
+        const auto dataEnd = runEnd - ( run->addsLineFeed ? 1 : 0 );
+        if ( position == dataEnd ) {
+            data[ bytesRead++ ] = '\n';
+            continue;
+        }
+
+        const auto toRead = std::min( size - bytesRead, dataEnd - position );
+        const auto logRead = access.logs_[ run->log ]->read(
+            run->logOffset + ( position - run->mergedOffset ), data + bytesRead, toRead );
+        if ( logRead < 0 ) {
+            return bytesRead > 0 ? bytesRead : -1;
+        }
+
+        bytesRead += logRead;
+        if ( logRead < toRead ) {
+            // Log got shorter after it was merged
+            break;
+        }
+    }
+
+    position_ = offset + bytesRead;
+    return bytesRead;
+}
@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "networkfilecache.h"
+
+#include <algorithm>
+#include <map>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "configuration.h"
+#include "filedigest.h"
+#include "log.h"
+
+namespace {
+constexpr quint32 NetworkCacheMagic = 0x4b4c4e43; // KLNC
+constexpr quint32 NetworkCacheVersion = 1;
+
+// Metadata is saved after this number of new blocks, so a crash loses few of them
+constexpr size_t SaveInterval = 64;
+
+QString cacheDirectory()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + "/network";
+}
+
+uint64_t blockDigest( const char* data )
+{
+    // Digest 0 marks missing blocks, such blocks are just read again
+    return FileDigest{}
+        .addData( data, static_cast<size_t>( NetworkFileCache::BlockSize ) )
+        .digest();
+}
+
+// Caches not written to for the longest time are removed first
+void trimCacheDirectory( qint64 sizeLimit, const QStringList& openedCaches )
+{
+    auto caches = QDir( cacheDirectory() )
+                      .entryInfoList( { "*.blocks" }, QDir::Files, QDir::Time | QDir::Reversed );
+
+    qint64 totalSize = 0;
+    for ( const auto& cache : qAsConst( caches ) ) {
+        totalSize += cache.size();
+    }
+
+    for ( const auto& cache : qAsConst( caches ) ) {
+        if ( totalSize <= sizeLimit ) {
+            break;
+        }
+        if ( openedCaches.contains( cache.completeBaseName() ) ) {
+            continue;
+        }
+
+        LOG_INFO << "Removing network file cache " << cache.fileName();
+        QFile::remove( cache.absoluteFilePath() );
+        QFile::remove( cache.absolutePath() + "/" + cache.completeBaseName() + ".meta" );
+        totalSize -= cache.size();
+    }
+}
+} // namespace
+
+std::shared_ptr<NetworkFileCache> NetworkFileCache::forFile( const QFile& file,
+                                                             const FileId& fileId )
+{
+    if ( !Configuration::get().cacheNetworkFiles() || !file.isOpen()
+         || !isOnNetworkShare( file ) ) {
+        return {};
+    }
+
+    return forAnyFile( file, fileId );
+}
+
+std::shared_ptr<NetworkFileCache> NetworkFileCache::forAnyFile( const QFile& file,
+                                                                const FileId& fileId )
+{
+    const auto fileName = QFileInfo( file ).absoluteFilePath();
+
+    // Another file can have the name of a rotated one, so it gets another cache
+    FileDigest keyDigest;
+    keyDigest.addData( fileName.toUtf8() );
+    keyDigest.addData( reinterpret_cast<const char*>( &fileId.fileIndex ),
+                       sizeof( fileId.fileIndex ) );
+    keyDigest.addData( reinterpret_cast<const char*>( &fileId.volumeIndex ),
+                       sizeof( fileId.volumeIndex ) );
+    const auto cacheName = QString::number( keyDigest.digest(), 16 );
+
+    static Mutex cachesMutex;
+    static std::map<QString, std::weak_ptr<NetworkFileCache>> caches;
+
+    ScopedLock lock( cachesMutex );
+    if ( auto cache = caches[ cacheName ].lock() ) {
+        return cache;
+    }
+
+    if ( !QDir().mkpath( cacheDirectory() ) ) {
+        LOG_WARNING << "Can't create network file cache directory " << cacheDirectory();
+        return {};
+    }
+
+    const auto sizeLimit
+        = static_cast<qint64>( Configuration::get().networkFileCacheMb() ) * 1024 * 1024;
+
+    QStringList openedCaches{ cacheName };
+    for ( const auto& [ name, openedCache ] : caches ) {
+        if ( !openedCache.expired() ) {
+            openedCaches.append( name );
+        }
+    }
+    trimCacheDirectory( sizeLimit, openedCaches );
+
+    const auto maxBlocks = static_cast<size_t>( std::max( sizeLimit / BlockSize, qint64{ 0 } ) );
+    std::shared_ptr<NetworkFileCache> cache(
+        new NetworkFileCache( fileName, cacheName, maxBlocks ) );
+    if ( !cache->blocksFile_.isOpen() ) {
+        return {};
+    }
+
+    caches[ cacheName ] = cache;
+    return cache;
+}
+
+NetworkFileCache::NetworkFileCache( const QString& fileName, const QString& cacheName,
+                                    size_t maxBlocks )
+    : fileName_( fileName )
+    , metadataFileName_( cacheDirectory() + "/" + cacheName + ".meta" )
+    , blocksFile_( cacheDirectory() + "/" + cacheName + ".blocks" )
+    , maxBlocks_( maxBlocks )
+{
+    if ( !blocksFile_.open( QIODevice::ReadWrite ) ) {
+        LOG_WARNING << "Can't open network file cache " << blocksFile_.fileName();
+        return;
+    }
+
+    load();
+    validate();
+
+    LOG_INFO << "Network file cache of " << fileName_ << " has " << nbCachedBlocks_
+             << " blocks";
+}
+
+NetworkFileCache::~NetworkFileCache()
+{
+    if ( blocksFile_.isOpen() && blocksSinceSave_ > 0 ) {
+        save();
+    }
+}
+
+void NetworkFileCache::load()
+{
+    QFile metadataFile( metadataFileName_ );
+    if ( !metadataFile.open( QIODevice::ReadOnly ) ) {
+        reset();
+        return;
+    }
+
+    QDataStream metadata( &metadataFile );
+    metadata.setVersion( QDataStream::Qt_5_9 );
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString fileName;
+    qint64 blockSize = 0;
+    quint64 nbBlocks = 0;
+    metadata >> magic >> version >> fileName >> blockSize >> fileSize_ >> lastModified_
+        >> nbBlocks;
+
+    if ( metadata.status() != QDataStream::Ok || magic != NetworkCacheMagic
+         || version != NetworkCacheVersion || fileName != fileName_ || blockSize != BlockSize
+         || nbBlocks > static_cast<quint64>( blocksFile_.size() / BlockSize ) ) {
+        reset();
+        return;
+    }
+
+    digests_.resize( static_cast<size_t>( nbBlocks ) );
+    for ( auto& digest : digests_ ) {
+        quint64 value = 0;
+        metadata >> value;
+        digest = value;
+    }
+
+    if ( metadata.status() != QDataStream::Ok ) {
+        reset();
+        return;
+    }
+
+    isChecked_.assign( digests_.size(), false );
+    nbCachedBlocks_ = static_cast<size_t>( std::count_if(
+        digests_.begin(), digests_.end(), []( auto digest ) { return digest != 0; } ) );
+}
+
+void NetworkFileCache::validate()
+{
+    const QFileInfo fileInfo( fileName_ );
+    const auto fileSize = fileInfo.size();
+    const auto lastModified = fileInfo.lastModified();
+    if ( fileSize == fileSize_ && lastModified == lastModified_ ) {
+        return;
+    }
+
+    const auto isCached = []( auto digest ) { return digest != 0; };
+    const auto firstCached = std::find_if( digests_.begin(), digests_.end(), isCached );
+    const auto lastCached = std::find_if( digests_.rbegin(), digests_.rend(), isCached );
+
+    auto isAppended = fileSize >= fileSize_;
+    if ( isAppended && firstCached != digests_.end() ) {
+        QFile file( fileName_ );
+        klogg::vector<char> block( static_cast<size_t>( BlockSize ) );
+
+        const auto isBlockUnchanged = [ & ]( size_t index ) {
+            return file.seek( static_cast<qint64>( index ) * BlockSize )
+                   && file.read( block.data(), BlockSize ) == BlockSize
+                   && blockDigest( block.data() ) == digests_[ index ];
+        };
+
+        isAppended
+            = file.open( QIODevice::ReadOnly )
+              && isBlockUnchanged( static_cast<size_t>( firstCached - digests_.begin() ) )
+              && isBlockUnchanged( static_cast<size_t>( digests_.rend() - lastCached - 1 ) );
+    }
+
+    if ( !isAppended ) {
+        LOG_INFO << "Network file " << fileName_ << " was changed, its cache is dropped";
+        reset();
+    }
+
+    fileSize_ = fileSize;
+    lastModified_ = lastModified;
+    save();
+}
+
+void NetworkFileCache::reset()
+{
+    digests_.clear();
+    isChecked_.clear();
+    nbCachedBlocks_ = 0;
+    blocksFile_.resize( 0 );
+}
+
+void NetworkFileCache::save()
+{
+    QSaveFile metadataFile( metadataFileName_ );
+    if ( !metadataFile.open( QIODevice::WriteOnly ) ) {
+        LOG_WARNING << "Can't write network file cache " << metadataFileName_;
+        return;
+    }
+
+    QDataStream metadata( &metadataFile );
+    metadata.setVersion( QDataStream::Qt_5_9 );
+
+    metadata << NetworkCacheMagic << NetworkCacheVersion << fileName_ << BlockSize << fileSize_
+             << lastModified_ << static_cast<quint64>( digests_.size() );
+    for ( const auto digest : digests_ ) {
+        metadata << static_cast<quint64>( digest );
+    }
+
+    blocksFile_.flush();
+    if ( metadataFile.commit() ) {
+        blocksSinceSave_ = 0;
+    }
+}
+
+size_t NetworkFileCache::cachedBlocks() const
+{
+    ScopedLock lock( mutex_ );
+    return nbCachedBlocks_;
+}
+
+qint64 NetworkFileCache::read( qint64 offset, char* data, qint64 size,
+                               const ReadFunction& readShare )
+{
+    klogg::vector<char> block;
+
+    qint64 bytesRead = 0;
+    while ( bytesRead < size ) {
+        const auto position = offset + bytesRead;
+        const auto index = static_cast<size_t>( position / BlockSize );
+        const auto blockStart = static_cast<qint64>( index ) * BlockSize;
+        const auto blockOffset = position - blockStart;
+        const auto toCopy = std::min( size - bytesRead, BlockSize - blockOffset );
+
+        if ( readCachedBlock( index, blockOffset, data + bytesRead, toCopy ) ) {
+            bytesRead += toCopy;
+            continue;
+        }
+
+        // Whole blocks are read from the share, so they can be cached
+        const auto isWholeBlock = blockOffset == 0 && toCopy == BlockSize;
+        if ( !isWholeBlock ) {
+            block.resize( static_cast<size_t>( BlockSize ) );
+        }
+        auto* blockData = isWholeBlock ? data + bytesRead : block.data();
+
+        const auto blockRead = readShare( blockStart, blockData, BlockSize );
+        if ( blockRead < 0 ) {
+            return bytesRead > 0 ? bytesRead : -1;
+        }
+
+        if ( blockRead == BlockSize ) {
+            storeBlock( index, blockData );
+        }
+
+        const auto copied = std::clamp( blockRead - blockOffset, qint64{ 0 }, toCopy );
+        if ( !isWholeBlock && copied > 0 ) {
+            std::copy_n( blockData + blockOffset, copied, data + bytesRead );
+        }
+        bytesRead += copied;
+
+        // End of the file
+        if ( copied < toCopy ) {
+            break;
+        }
+    }
+
+    return bytesRead;
+}
+
+bool NetworkFileCache::readCachedBlock( size_t block, qint64 offset, char* data, qint64 size )
+{
+    ScopedLock lock( mutex_ );
+    if ( block >= digests_.size() || digests_[ block ] == 0 ) {
+        return false;
+    }
+
+    const auto blockStart = static_cast<qint64>( block ) * BlockSize;
+    if ( isChecked_[ block ] ) {
+        return blocksFile_.seek( blockStart + offset ) && blocksFile_.read( data, size ) == size;
+    }
+
+    // Block is read whole once to check its digest
+    klogg::vector<char> blockData( static_cast<size_t>( BlockSize ) );
+    if ( !blocksFile_.seek( blockStart )
+         || blocksFile_.read( blockData.data(), BlockSize ) != BlockSize
+         || blockDigest( blockData.data() ) != digests_[ block ] ) {
+        LOG_WARNING << "Cached block " << block << " of " << fileName_ << " is corrupted";
+        digests_[ block ] = 0;
+        --nbCachedBlocks_;
+        return false;
+    }
+
+    isChecked_[ block ] = true;
+    std::copy_n( blockData.data() + offset, size, data );
+    return true;
+}
+
+void NetworkFileCache::storeBlock( size_t block, const char* data )
+{
+    const auto digest = blockDigest( data );
+
+    ScopedLock lock( mutex_ );
+    if ( digest == 0 || nbCachedBlocks_ >= maxBlocks_
+         || ( block < digests_.size() && digests_[ block ] != 0 ) ) {
+        return;
+    }
+
+    if ( !blocksFile_.seek( static_cast<qint64>( block ) * BlockSize )
+         || blocksFile_.write( data, BlockSize ) != BlockSize ) {
+        return;
+    }
+
+    if ( block >= digests_.size() ) {
+        digests_.resize( block + 1, 0 );
+        isChecked_.resize( block + 1, false );
+    }
+    digests_[ block ] = digest;
+    isChecked_[ block ] = true;
+    ++nbCachedBlocks_;
+
+    if ( ++blocksSinceSave_ >= SaveInterval ) {
+        save();
+    }
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "prefetchdepth.h"
+
+#include <algorithm>
+
+namespace {
+// Interruption is noticed when a block is indexed, this is only for graphs
+// that stopped indexing blocks
+constexpr std::chrono::milliseconds InterruptCheckInterval{ 50 };
+} // namespace
+
+PrefetchDepth::PrefetchDepth( size_t initialDepth, size_t minDepth, bool isAdaptive )
+    : minDepth_( isAdaptive ? std::max( minDepth, size_t{ 1 } ) : initialDepth )
+    , maxDepth_( isAdaptive ? std::max( MaxAdaptiveDepth, minDepth_ ) : initialDepth )
+    , isAdaptive_( isAdaptive )
+    , depth_( std::clamp( initialDepth, minDepth_, maxDepth_ ) )
+{
+}
+
+void PrefetchDepth::blockRead( std::chrono::microseconds duration )
+{
+    if ( !isAdaptive_ ) {
+        return;
+    }
+
+    ScopedLock lock( mutex_ );
+    slowestRead_ = std::max( slowestRead_, duration );
+}
+
+bool PrefetchDepth::waitToSend( const AtomicFlag& interruptRequest )
+{
+    ScopedLock lock( mutex_ );
+    while ( !canSend() ) {
+        if ( interruptRequest ) {
+            return false;
+        }
+        blockIndexed_.wait_for( lock, InterruptCheckInterval );
+    }
+    return !interruptRequest;
+}
+
+void PrefetchDepth::blockIndexed( Clock::time_point time )
+{
+    using namespace std::chrono;
+
+    ScopedLock lock( mutex_ );
+    --inFlight_;
+    blockIndexed_.notify_one();
+
+    if ( !isAdaptive_ ) {
+        return;
+    }
+
+    if ( lastIndexed_ == Clock::time_point{} ) {
+        lastIndexed_ = time;
+        return;
+    }
+
+    indexingDuration_ += duration_cast<microseconds>( time - lastIndexed_ );
+    lastIndexed_ = time;
+    if ( ++indexedBlocks_ < WindowBlocks ) {
+        return;
+    }
+
+    // Blocks read ahead are indexed one after another while the reader waits,
+    // one more is being indexed
+    const auto blockDuration = std::max(
+        microseconds{ 1 }, indexingDuration_ / static_cast<int64_t>( indexedBlocks_ ) );
+    const auto blocksToCover = static_cast<size_t>(
+        ( slowestRead_ + blockDuration - microseconds{ 1 } ) / blockDuration );
+    depth_.store( std::clamp( blocksToCover + 1, minDepth_, maxDepth_ ),
+                  std::memory_order_relaxed );
+
+    slowestRead_ = {};
+    indexingDuration_ = {};
+    indexedBlocks_ = 0;
+}
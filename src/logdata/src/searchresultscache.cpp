@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "searchresultscache.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+
+#include "filedigest.h"
+#include "log.h"
+
+namespace {
+constexpr quint32 SearchCacheMagic = 0x4b4c5352; // KLSR
+constexpr quint32 SearchCacheVersion = 1;
+
+constexpr qint64 MinCachedFileSize = 64 * 1024 * 1024;
+constexpr int MaxCacheEntries = 256;
+
+QString cacheDirectory()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + "/search";
+}
+
+QString spillDirectory()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + "/spill";
+}
+
+// Everything the results depend on except the file data
+QByteArray searchKey( const SearchedContent& content, const RegularExpressionPattern& pattern,
+                      LineNumber startLine )
+{
+    QByteArray key;
+    QDataStream stream( &key, QIODevice::WriteOnly );
+    stream.setVersion( QDataStream::Qt_5_9 );
+
+    stream << content.fileName << content.encoding << content.prefilter
+           << content.hideAnsiColorSequences;
+    stream << pattern.pattern << pattern.isCaseSensitive << pattern.isExclude << pattern.isBoolean
+           << pattern.isPlainText << static_cast<quint64>( startLine.get() );
+
+    return key;
+}
+
+QString cacheFileName( const QByteArray& key )
+{
+    FileDigest keyDigest;
+    keyDigest.addData( key );
+    return cacheDirectory() + "/" + QString::number( keyDigest.digest(), 16 ) + ".res";
+}
+
+// Data hashed for the cached results is still at the beginning of the file
+bool isFileAppendedTo( const SearchedContent& content, const IndexedHash& hash )
+{
+    if ( content.hash.size < hash.size ) {
+        return false;
+    }
+
+    if ( content.hash.size == hash.size && hash.fullDigest != 0
+         && content.hash.fullDigest == hash.fullDigest ) {
+        return true;
+    }
+
+    QFile file( content.fileName );
+    return file.open( QIODevice::ReadOnly )
+           && hasSameDigest( file, 0, hash.headerSize, hash.headerDigest )
+           && hasSameDigest( file, hash.tailOffset, hash.tailSize, hash.tailDigest );
+}
+
+void removeOldEntries()
+{
+    QDir cacheDir( cacheDirectory() );
+    const auto entries
+        = cacheDir.entryInfoList( { "*.res" }, QDir::Files, QDir::Time | QDir::Reversed );
+
+    for ( auto i = 0; i < entries.size() - MaxCacheEntries; ++i ) {
+        LOG_INFO << "Removing old search results cache " << entries[ i ].fileName().toStdString();
+        QFile::remove( entries[ i ].absoluteFilePath() );
+    }
+}
+} // namespace
+
+std::optional<CachedSearchResults> loadCachedSearchResults( const SearchedContent& content,
+                                                            const RegularExpressionPattern& pattern,
+                                                            LineNumber startLine )
+{
+    if ( content.hash.size < MinCachedFileSize || !content.isFromFileStart ) {
+        return {};
+    }
+
+    const auto key = searchKey( content, pattern, startLine );
+    QFile cacheFile( cacheFileName( key ) );
+    if ( !cacheFile.open( QIODevice::ReadOnly ) ) {
+        return {};
+    }
+
+    QDataStream cache( &cacheFile );
+    cache.setVersion( QDataStream::Qt_5_9 );
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    cache >> magic >> version;
+    if ( magic != SearchCacheMagic || version != SearchCacheVersion ) {
+        LOG_INFO << "Search results cache version mismatch for "
+                 << content.fileName.toStdString();
+        return {};
+    }
+
+    QByteArray cachedKey;
+    IndexedHash hash;
+    qint64 maxLength = 0;
+    quint64 endLine = 0;
+    QByteArray matches;
+    quint64 matchesDigest = 0;
+
+    cache >> cachedKey;
+    cache >> hash.size >> hash.fullDigest >> hash.headerSize >> hash.headerDigest >> hash.tailSize
+        >> hash.tailOffset >> hash.tailDigest;
+    cache >> maxLength >> endLine >> matches >> matchesDigest;
+
+    if ( cache.status() != QDataStream::Ok || cachedKey != key ) {
+        return {};
+    }
+
+    if ( FileDigest{}.addData( matches ).digest() != matchesDigest ) {
+        LOG_WARNING << "Search results cache is corrupted for " << content.fileName.toStdString();
+        return {};
+    }
+
+    if ( !isFileAppendedTo( content, hash ) ) {
+        LOG_INFO << "Search results cache is outdated for " << content.fileName.toStdString();
+        return {};
+    }
+
+    CachedSearchResults results;
+    try {
+        // Data of the cache is not trusted, it is not read past the end of the buffer
+        results.matchingLines = SearchResultArray::readSafe(
+            matches.constData(), static_cast<size_t>( matches.size() ) );
+    } catch ( const std::exception& err ) {
+        LOG_WARNING << "Can't read cached search results: " << err.what();
+        return {};
+    }
+    results.maxLength
+        = LineLength( type_safe::narrow_cast<LineLength::UnderlyingType>( maxLength ) );
+    results.endLine = LineNumber( endLine );
+
+    LOG_INFO << "Search results cache loaded for " << content.fileName.toStdString()
+             << ", matches " << results.matchingLines.cardinality() << ", searched lines "
+             << endLine;
+
+    return results;
+}
+
+void saveSearchResultsToCache( const SearchedContent& content,
+                               const RegularExpressionPattern& pattern, LineNumber startLine,
+                               LineNumber endLine, const SearchResultArray& matchingLines,
+                               LineLength maxLength )
+{
+    if ( content.hash.size < MinCachedFileSize || !content.isFromFileStart ) {
+        return;
+    }
+
+    if ( !QDir().mkpath( cacheDirectory() ) ) {
+        LOG_WARNING << "Can't create search results cache directory "
+                    << cacheDirectory().toStdString();
+        return;
+    }
+
+    const auto key = searchKey( content, pattern, startLine );
+    QSaveFile cacheFile( cacheFileName( key ) );
+    if ( !cacheFile.open( QIODevice::WriteOnly ) ) {
+        LOG_WARNING << "Can't write search results cache for " << content.fileName.toStdString();
+        return;
+    }
+
+    QByteArray matches( static_cast<int>( matchingLines.getSizeInBytes( true ) ),
+                        Qt::Uninitialized );
+    matchingLines.write( matches.data(), true );
+
+    QDataStream cache( &cacheFile );
+    cache.setVersion( QDataStream::Qt_5_9 );
+
+    const auto& hash = content.hash;
+    cache << SearchCacheMagic << SearchCacheVersion << key;
+    cache << hash.size << hash.fullDigest << hash.headerSize << hash.headerDigest << hash.tailSize
+          << hash.tailOffset << hash.tailDigest;
+    cache << static_cast<qint64>( maxLength.get() ) << static_cast<quint64>( endLine.get() )
+          << matches
+          << static_cast<quint64>( FileDigest{}.addData( matches ).digest() );
+
+    if ( cache.status() != QDataStream::Ok || !cacheFile.commit() ) {
+        LOG_WARNING << "Failed to write search results cache for "
+                    << content.fileName.toStdString();
+        return;
+    }
+
+    LOG_INFO << "Search results cache saved for " << content.fileName.toStdString();
+    removeOldEntries();
+}
+
+std::unique_ptr<MappedSearchResults>
+MappedSearchResults::create( const SearchResultArray& matchingLines )
+{
+    if ( !QDir().mkpath( spillDirectory() ) ) {
+        return {};
+    }
+
+    std::unique_ptr<MappedSearchResults> results{ new MappedSearchResults };
+    results->file_ = std::make_unique<QTemporaryFile>( spillDirectory() + "/results-XXXXXX.tmp" );
+    results->size_ = static_cast<qint64>( matchingLines.getSizeInBytes( true ) );
+
+    auto& file = *results->file_;
+    if ( !file.open() || !file.resize( results->size_ ) ) {
+        LOG_WARNING << "Can't create search results file in " << spillDirectory().toStdString();
+        return {};
+    }
+
+    // Results are written to the mapping, so they are not copied in memory
+    auto* data = file.map( 0, results->size_ );
+    if ( data == nullptr ) {
+        LOG_WARNING << "Can't map search results file " << file.fileName().toStdString();
+        return {};
+    }
+
+    matchingLines.write( reinterpret_cast<char*>( data ), true );
+    results->data_ = data;
+
+    LOG_INFO << "Search results with " << matchingLines.cardinality() << " matches are kept in "
+             << file.fileName().toStdString();
+    return results;
+}
+
+MappedSearchResults::~MappedSearchResults()
+{
+    if ( data_ != nullptr ) {
+        file_->unmap( const_cast<uchar*>( data_ ) );
+    }
+}
+
+std::optional<SearchResultArray> MappedSearchResults::load() const
+{
+    try {
+        return SearchResultArray::readSafe( reinterpret_cast<const char*>( data_ ),
+                                            static_cast<size_t>( size_ ) );
+    } catch ( const std::exception& err ) {
+        LOG_WARNING << "Can't read mapped search results: " << err.what();
+        return {};
+    }
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sparselinepositionarray.h"
+
+#include <algorithm>
+
+#include "log.h"
+
+SparseLinePositionArray::SparseLinePositionArray( LineEndsScanner scanner,
+                                                  LinesCount::UnderlyingType step )
+    : scanner_( std::move( scanner ) )
+    , step_( std::max( step, LinesCount::UnderlyingType{ 1 } ) )
+{
+}
+
+void SparseLinePositionArray::append( OffsetInFile pos )
+{
+    // The last line stays in the tail, it is dropped if its final LF is fake
+    if ( tail_.size() == step_ ) {
+        checkpoints_.append( tail_.back() );
+        tail_.clear();
+    }
+
+    tail_.push_back( pos );
+}
+
+void SparseLinePositionArray::append_list( const FastLinePositionArray& other )
+{
+    if ( fakeFinalLF_ ) {
+        tail_.pop_back();
+    }
+
+    for ( LinesCount::UnderlyingType i = 0; i < other.size().get(); ++i ) {
+        append( other.at( i ) );
+    }
+
+    fakeFinalLF_ = other.hasFakeFinalLF();
+}
+
+size_t SparseLinePositionArray::allocatedSize() const
+{
+    size_t cacheSize = 0;
+    {
+        ScopedLock lock( cacheMutex_ );
+        for ( const auto& group : cache_ ) {
+            cacheSize += group.lineEnds.capacity() * sizeof( OffsetInFile );
+        }
+    }
+
+    return checkpoints_.allocatedSize() + tail_.capacity() * sizeof( OffsetInFile ) + cacheSize;
+}
+
+OffsetInFile SparseLinePositionArray::scannedLineEnd( LinesCount::UnderlyingType group,
+                                                     LinesCount::UnderlyingType lineInGroup ) const
+{
+    const auto index = static_cast<size_t>( lineInGroup );
+    {
+        ScopedLock lock( cacheMutex_ );
+        const auto cached = std::find_if( cache_.begin(), cache_.end(),
+                                          [ group ]( const ScannedGroup& scannedGroup ) {
+                                              return scannedGroup.group == group;
+                                          } );
+        if ( cached != cache_.end() ) {
+            std::rotate( cache_.begin(), cached, cached + 1 );
+            return cache_.front().lineEnds[ index ];
+        }
+    }
+
+    const auto begin = group > 0 ? checkpoints_.at( group - 1 ) : 0_offset;
+    const auto end = checkpoints_.at( group );
+
+    auto lineEnds = scanner_( begin, end );
+    if ( lineEnds.size() < step_ ) {
+        LOG_WARNING << "Found " << lineEnds.size() << " lines between " << begin << " and "
+                    << end << ", expected " << step_;
+    }
+    lineEnds.resize( step_ - 1, end );
+    const auto lineEnd = lineEnds[ index ];
+
+    ScopedLock lock( cacheMutex_ );
+    if ( cache_.size() == CachedGroups ) {
+        cache_.pop_back();
+    }
+    cache_.insert( cache_.begin(), ScannedGroup{ group, std::move( lineEnds ) } );
+
+    return lineEnd;
+}
+
+OffsetInFile SparseLinePositionArray::at( LineNumber line ) const
+{
+    const auto group = line.get() / step_;
+    const auto lineInGroup = line.get() % step_;
+
+    if ( group >= checkpoints_.size().get() ) {
+        return tail_.at( static_cast<size_t>( line.get() - checkpoints_.size().get() * step_ ) );
+    }
+    else if ( lineInGroup == step_ - 1 ) {
+        return checkpoints_.at( group );
+    }
+    else {
+        return scannedLineEnd( group, lineInGroup );
+    }
+}
+
+void SparseLinePositionArray::truncate( LinesCount newSize )
+{
+    if ( newSize >= size() ) {
+        return;
+    }
+
+    // Kept lines of the last group go to the tail
+    const auto groupsCount = ( newSize.get() + step_ - 1 ) / step_;
+    const auto tailSize = newSize.get() - ( groupsCount > 0 ? ( groupsCount - 1 ) * step_ : 0 );
+
+    klogg::vector<OffsetInFile> tail;
+    tail.reserve( static_cast<size_t>( tailSize ) );
+    for ( auto line = newSize.get() - tailSize; line < newSize.get(); ++line ) {
+        tail.push_back( at( LineNumber( line ) ) );
+    }
+
+    checkpoints_.truncate( LinesCount( groupsCount > 0 ? groupsCount - 1 : 0 ) );
+    tail_ = std::move( tail );
+    fakeFinalLF_ = false;
+
+    ScopedLock lock( cacheMutex_ );
+    cache_.clear();
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "streamspool.h"
+
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <QFile>
+#include <QSaveFile>
+
+#include "containers.h"
+#include "log.h"
+
+namespace {
+constexpr qint64 ReadBufferSize = 1024 * 1024;
+
+qint64 readInput( int descriptor, char* data, qint64 size )
+{
+#ifdef Q_OS_WIN
+    return _read( descriptor, data, static_cast<unsigned>( size ) );
+#else
+    return ::read( descriptor, data, static_cast<size_t>( size ) );
+#endif
+}
+
+// Newer half of the data is written to a new file that replaces the spool file
+// at once, so readers of the old file never see its data rewritten or truncated
+// under them. The file is opened again at the end of its data, returns the new
+// size or -1 if the file could not be replaced.
+qint64 keepNewerHalf( QFile& file, qint64 size, qint64 sizeLimit, klogg::vector<char>& buffer )
+{
+    // Code units of UTF-16 text start at even offsets
+    auto middle = size - sizeLimit / 2;
+    middle -= middle % 2;
+
+    file.seek( middle );
+    const auto middleBytes = file.read( buffer.data(), klogg::ssize( buffer ) );
+    const auto keptStart
+        = middle
+          + ( middleBytes > 0 ? StreamSpool::findKeptStart( std::string_view(
+                                    buffer.data(), static_cast<size_t>( middleBytes ) ) )
+                              : 0 );
+
+    QSaveFile keptFile( file.fileName() );
+    if ( !keptFile.open( QIODevice::WriteOnly ) ) {
+        LOG_ERROR << "Can't create file replacing spool file " << file.fileName();
+        return -1;
+    }
+
+    qint64 keptSize = 0;
+    while ( keptStart + keptSize < size ) {
+        file.seek( keptStart + keptSize );
+        const auto bytesRead = file.read(
+            buffer.data(), std::min( klogg::ssize( buffer ), size - keptStart - keptSize ) );
+        if ( bytesRead <= 0 || keptFile.write( buffer.data(), bytesRead ) != bytesRead ) {
+            keptFile.cancelWriting();
+            break;
+        }
+        keptSize += bytesRead;
+    }
+
+    // Opened file can't be replaced on Windows
+    file.close();
+    const auto isReplaced = keptFile.commit();
+    if ( !file.open( QIODevice::ReadWrite ) || !file.seek( isReplaced ? keptSize : size ) ) {
+        LOG_ERROR << "Can't open spool file " << file.fileName() << " again";
+        file.close();
+        return -1;
+    }
+
+    if ( !isReplaced ) {
+        LOG_ERROR << "Can't replace spool file " << file.fileName();
+        return -1;
+    }
+    return keptSize;
+}
+} // namespace
+
+StreamSpool::StreamSpool( int inputDescriptor, const QString& fileName, qint64 sizeLimit )
+    : state_( std::make_shared<State>() )
+{
+    state_->inputDescriptor = inputDescriptor;
+    state_->fileName = fileName;
+    state_->sizeLimit = std::max( sizeLimit, qint64{ 0 } );
+
+    // The file exists when the spool is constructed, so it can be opened at once
+    QFile file( fileName );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        LOG_ERROR << "Can't create spool file " << fileName;
+        state_->isAtEnd = true;
+        return;
+    }
+    file.close();
+
+    LOG_INFO << "Spooling stream to " << fileName << ", limit " << state_->sizeLimit << " bytes";
+    thread_ = std::thread( [ state = state_ ] { spool( state ); } );
+}
+
+StreamSpool::~StreamSpool()
+{
+    state_->isStopping = true;
+    if ( !thread_.joinable() ) {
+        return;
+    }
+
+    if ( state_->isAtEnd ) {
+        thread_.join();
+    }
+    else {
+        thread_.detach();
+    }
+}
+
+QString StreamSpool::fileName() const
+{
+    return state_->fileName;
+}
+
+bool StreamSpool::isAtEnd() const
+{
+    return state_->isAtEnd;
+}
+
+qint64 StreamSpool::droppedBytes() const
+{
+    return state_->droppedBytes;
+}
+
+qint64 StreamSpool::findKeptStart( std::string_view data )
+{
+    const auto lineFeed = data.find( '\n' );
+    if ( lineFeed == std::string_view::npos ) {
+        return 0;
+    }
+
+    // Line feed of UTF-16LE is followed by its zero byte at an odd offset,
+    // the one of UTF-16BE ends its code unit, so the next line starts after it
+    auto start = lineFeed + 1;
+    if ( lineFeed % 2 == 0 && start < data.size() && data[ start ] == '\0' ) {
+        ++start;
+    }
+    return static_cast<qint64>( start );
+}
+
+void StreamSpool::spool( const std::shared_ptr<State>& state )
+{
+    QFile file( state->fileName );
+    if ( !file.open( QIODevice::ReadWrite ) ) {
+        LOG_ERROR << "Can't open spool file " << state->fileName;
+        state->isAtEnd = true;
+        return;
+    }
+
+    klogg::vector<char> buffer( static_cast<size_t>( ReadBufferSize ) );
+    auto sizeLimit = state->sizeLimit;
+    qint64 size = 0;
+    while ( !state->isStopping ) {
+        const auto bytesRead
+            = readInput( state->inputDescriptor, buffer.data(), klogg::ssize( buffer ) );
+        if ( bytesRead <= 0 || state->isStopping ) {
+            break;
+        }
+
+        if ( file.write( buffer.data(), bytesRead ) != bytesRead ) {
+            LOG_ERROR << "Can't write to spool file " << state->fileName;
+            break;
+        }
+        file.flush();
+        size += bytesRead;
+
+        if ( sizeLimit > 0 && size >= sizeLimit ) {
+            const auto keptSize = keepNewerHalf( file, size, sizeLimit, buffer );
+            if ( keptSize < 0 ) {
+                if ( !file.isOpen() ) {
+                    break;
+                }
+                LOG_WARNING << "Spool file " << state->fileName << " is kept growing";
+                sizeLimit = 0;
+                continue;
+            }
+
+            state->droppedBytes += size - keptSize;
+            LOG_INFO << "Spool file reached " << size << " bytes, kept " << keptSize;
+            size = keptSize;
+        }
+    }
+
+    LOG_INFO << "Stream spooled to " << state->fileName << " has ended";
+    state->isAtEnd = true;
+}
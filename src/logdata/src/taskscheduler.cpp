@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "taskscheduler.h"
+
+#include <algorithm>
+
+#include <tbb/info.h>
+
+#include "configuration.h"
+#include "log.h"
+#include "metrics.h"
+
+TaskScheduler& TaskScheduler::get()
+{
+    static TaskScheduler scheduler;
+    return scheduler;
+}
+
+TaskScheduler::TaskScheduler()
+    : maxConcurrency_( [] {
+        const auto configuredConcurrency = Configuration::get().maxConcurrency();
+        return configuredConcurrency > 0 ? configuredConcurrency
+                                         : tbb::info::default_concurrency();
+    }() )
+    , foreground_( maxConcurrency_, 1, tbb::task_arena::priority::high )
+    , background_( maxConcurrency_, 1, tbb::task_arena::priority::low )
+{
+    if ( Configuration::get().maxConcurrency() > 0 ) {
+        // Worker threads are shared by all arenas
+        concurrencyControl_ = std::make_unique<tbb::global_control>(
+            tbb::global_control::max_allowed_parallelism,
+            static_cast<size_t>( maxConcurrency_ ) );
+    }
+
+    LOG_INFO << "Task scheduler concurrency " << maxConcurrency_;
+
+    // Without the hwloc library TBB reports one node of unknown id
+    const auto numaNodes = tbb::info::numa_nodes();
+    LOG_INFO << "NUMA nodes " << numaNodes.size();
+    if ( Configuration::get().useNumaArenas() && numaNodes.size() > 1 ) {
+        for ( const auto nodeId : numaNodes ) {
+            const auto concurrency
+                = std::min( maxConcurrency_, tbb::info::default_concurrency( nodeId ) );
+            nodes_.push_back( std::make_unique<NodeArenas>( nodeId, concurrency ) );
+
+            LOG_INFO << "NUMA node " << nodeId << " arena concurrency " << concurrency;
+            Metrics::get()
+                .gauge( nodes_.back()->metricsName( "threads" ) )
+                .set( static_cast<double>( concurrency ) );
+        }
+    }
+
+    Metrics::get().gauge( "scheduler.numa_arenas" ).set( static_cast<double>( nodes_.size() ) );
+}
+
+TaskScheduler::NodeArenas::NodeArenas( int id, int concurrency )
+    : nodeId( id )
+    , foreground( tbb::task_arena::constraints{ id, concurrency }, 1,
+                  tbb::task_arena::priority::high )
+    , background( tbb::task_arena::constraints{ id, concurrency }, 1,
+                  tbb::task_arena::priority::low )
+{
+}
+
+QString TaskScheduler::NodeArenas::metricsName( const char* name ) const
+{
+    return QString( "scheduler.node%1.%2" ).arg( nodeId ).arg( name );
+}
+
+int TaskScheduler::acquireNode()
+{
+    ScopedLock lock( nodesMutex_ );
+    if ( nodes_.empty() ) {
+        return AnyNode;
+    }
+
+    const auto node = std::min_element(
+        nodes_.begin(), nodes_.end(),
+        []( const auto& lhs, const auto& rhs ) { return lhs->files < rhs->files; } );
+    ( *node )->files++;
+    Metrics::get()
+        .gauge( ( *node )->metricsName( "files" ) )
+        .set( static_cast<double>( ( *node )->files ) );
+
+    return static_cast<int>( std::distance( nodes_.begin(), node ) );
+}
+
+void TaskScheduler::releaseNode( int node )
+{
+    if ( node == AnyNode ) {
+        return;
+    }
+
+    ScopedLock lock( nodesMutex_ );
+    auto& arenas = *nodes_[ static_cast<size_t>( node ) ];
+    arenas.files--;
+    Metrics::get()
+        .gauge( arenas.metricsName( "files" ) )
+        .set( static_cast<double>( arenas.files ) );
+}
+
+int TaskScheduler::maxConcurrency() const
+{
+    return maxConcurrency_;
+}
+
+tbb::task_arena& TaskScheduler::arena( TaskPriority priority, int node )
+{
+    if ( node == AnyNode || nodes_.empty() ) {
+        return priority == TaskPriority::Foreground ? foreground_ : background_;
+    }
+
+    auto& arenas = *nodes_[ static_cast<size_t>( node ) ];
+    return priority == TaskPriority::Foreground ? arenas.foreground : arenas.background;
+}
@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timehistogram.h"
+
+#include <algorithm>
+#include <array>
+
+#include <QDateTime>
+
+namespace {
+constexpr int64_t SecondsPerDay = 24 * 60 * 60;
+constexpr int64_t JulianDayOfEpoch = 2440588;
+
+// Each width is a multiple of the previous one, so buckets are merged when widened
+constexpr std::array<int64_t, 13> BucketWidths = {
+    1, 5, 15, 30, 60, 300, 900, 1800, 3600, 6 * 3600, 12 * 3600, SecondsPerDay, 7 * SecondsPerDay,
+};
+
+int64_t floorDiv( int64_t value, int64_t divisor )
+{
+    const auto quotient = value / divisor;
+    return ( value % divisor != 0 && value < 0 ) ? quotient - 1 : quotient;
+}
+
+// Days since epoch of the date of the proleptic Gregorian calendar
+int64_t daysFromCivil( int64_t year, int64_t month, int64_t day )
+{
+    year -= month <= 2 ? 1 : 0;
+    const auto era = floorDiv( year, 400 );
+    const auto yearOfEra = year - era * 400;
+    const auto dayOfYear = ( 153 * ( month + ( month > 2 ? -3 : 9 ) ) + 2 ) / 5 + day - 1;
+    const auto dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+int daysInMonth( int year, int month )
+{
+    static constexpr std::array<int, 12> Days = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    const auto isLeap = ( year % 4 == 0 && year % 100 != 0 ) || year % 400 == 0;
+    return month == 2 && isLeap ? 29 : Days[ static_cast<size_t>( month - 1 ) ];
+}
+
+void mergeBucket( TimeHistogram::Bucket& bucket, const TimeHistogram::Bucket& other )
+{
+    bucket.count += other.count;
+    bucket.firstLine = qMin( bucket.firstLine, other.firstLine );
+    bucket.lastLine = qMax( bucket.lastLine, other.lastLine );
+    bucket.isKnown = bucket.isKnown && other.isKnown;
+}
+
+// Timestamps can follow spaces or an opening bracket
+std::string_view skipTimestampPrefix( std::string_view line )
+{
+    size_t start = 0;
+    while ( start < line.size()
+            && ( line[ start ] == ' ' || line[ start ] == '\t' || line[ start ] == '[' ) ) {
+        ++start;
+    }
+    return line.substr( start );
+}
+} // namespace
+
+TimestampParser::TimestampParser( const QString& format )
+    : format_( format )
+{
+    const auto addNumber = [ this ]( QChar letter, int count ) {
+        struct Token {
+            char letter;
+            int count;
+            FieldType type;
+        };
+        static constexpr std::array<Token, 7> Tokens = { {
+            { 'y', 4, FieldType::Year },
+            { 'M', 2, FieldType::Month },
+            { 'd', 2, FieldType::Day },
+            { 'H', 2, FieldType::Hour },
+            { 'm', 2, FieldType::Minute },
+            { 's', 2, FieldType::Second },
+            { 'z', 3, FieldType::Millisecond },
+        } };
+
+        const auto token
+            = std::find_if( Tokens.begin(), Tokens.end(), [ letter, count ]( const Token& t ) {
+                  return letter == QLatin1Char( t.letter ) && count == t.count;
+              } );
+        if ( token == Tokens.end() ) {
+            return false;
+        }
+        fields_.push_back( Field{ token->type, token->count, 0 } );
+        return true;
+    };
+
+    bool isQuoted = false;
+    for ( int index = 0; index < format.size(); ) {
+        const auto letter = format[ index ];
+        if ( letter.unicode() > 0x7f ) {
+            fields_.clear();
+            return;
+        }
+
+        if ( letter == QLatin1Char( '\'' ) ) {
+            // Two quotes are a literal quote
+            if ( index + 1 < format.size() && format[ index + 1 ] == letter ) {
+                fields_.push_back( Field{ FieldType::Literal, 1, '\'' } );
+                index += 2;
+            }
+            else {
+                isQuoted = !isQuoted;
+                ++index;
+            }
+            continue;
+        }
+
+        if ( isQuoted || !letter.isLetter() ) {
+            fields_.push_back( Field{ FieldType::Literal, 1, letter.toLatin1() } );
+            ++index;
+            continue;
+        }
+
+        auto count = 1;
+        while ( index + count < format.size() && format[ index + count ] == letter ) {
+            ++count;
+        }
+        if ( !addNumber( letter, count ) ) {
+            fields_.clear();
+            return;
+        }
+        index += count;
+    }
+
+    if ( isQuoted ) {
+        fields_.clear();
+    }
+}
+
+std::optional<int64_t> TimestampParser::parse( std::string_view line ) const
+{
+    const auto time = parseMilliseconds( line );
+    if ( !time ) {
+        return {};
+    }
+
+    return floorDiv( *time, 1000 );
+}
+
+std::optional<int64_t> TimestampParser::parseMilliseconds( std::string_view line ) const
+{
+    if ( format_.isEmpty() ) {
+        return {};
+    }
+
+    const auto text = skipTimestampPrefix( line );
+    return isFast() ? parseFields( text ) : parseWithQt( text );
+}
+
+std::optional<int64_t> TimestampParser::parseFields( std::string_view text ) const
+{
+    // Missing fields have the same defaults as in QDateTime
+    int year = 1900;
+    int month = 1;
+    int day = 1;
+    int hour = 0;
+    int minute = 0;
+    int second = 0;
+    int millisecond = 0;
+
+    size_t position = 0;
+    for ( const auto& field : fields_ ) {
+        const auto width = static_cast<size_t>( field.width );
+        if ( position + width > text.size() ) {
+            return {};
+        }
+
+        if ( field.type == FieldType::Literal ) {
+            if ( text[ position ] != field.literal ) {
+                return {};
+            }
+            ++position;
+            continue;
+        }
+
+        int value = 0;
+        for ( const auto digit : text.substr( position, width ) ) {
+            if ( digit < '0' || digit > '9' ) {
+                return {};
+            }
+            value = value * 10 + ( digit - '0' );
+        }
+        position += width;
+
+        switch ( field.type ) {
+        case FieldType::Year:
+            year = value;
+            break;
+        case FieldType::Month:
+            month = value;
+            break;
+        case FieldType::Day:
+            day = value;
+            break;
+        case FieldType::Hour:
+            hour = value;
+            break;
+        case FieldType::Minute:
+            minute = value;
+            break;
+        case FieldType::Second:
+            second = value;
+            break;
+        case FieldType::Millisecond:
+            millisecond = value;
+            break;
+        case FieldType::Literal:
+            break;
+        }
+    }
+
+    if ( month < 1 || month > 12 || day < 1 || day > daysInMonth( year, month ) || hour > 23
+         || minute > 59 || second > 59 ) {
+        return {};
+    }
+
+    const auto seconds
+        = daysFromCivil( year, month, day ) * SecondsPerDay + hour * 3600 + minute * 60 + second;
+    return seconds * 1000 + millisecond;
+}
+
+std::optional<int64_t> TimestampParser::parseWithQt( std::string_view text ) const
+{
+    // Characters of the format take at most 4 bytes each
+    const auto bytes = std::min( text.size(), static_cast<size_t>( format_.size() ) * 4 );
+    const auto line = QString::fromUtf8( text.data(), static_cast<int>( bytes ) );
+    const auto dateTime = QDateTime::fromString( line.left( format_.size() ), format_ );
+    if ( !dateTime.isValid() ) {
+        return {};
+    }
+
+    return ( dateTime.date().toJulianDay() - JulianDayOfEpoch ) * SecondsPerDay * 1000
+           + dateTime.time().msecsSinceStartOfDay();
+}
+
+void TimeHistogram::add( int64_t time, LineNumber line )
+{
+    const auto key = floorDiv( time, bucketSeconds_ );
+    auto bucket = buckets_.find( key );
+    if ( bucket == buckets_.end() ) {
+        bucket = buckets_.emplace( key, Bucket{ key * bucketSeconds_, 0, line, line } ).first;
+    }
+
+    mergeBucket( bucket->second, Bucket{ bucket->second.start, 1, line, line } );
+
+    if ( buckets_.size() > MaxBuckets ) {
+        widen( bucketSeconds_ + 1 );
+    }
+}
+
+void TimeHistogram::merge( const TimeHistogram& other )
+{
+    if ( other.bucketSeconds_ > bucketSeconds_ ) {
+        widen( other.bucketSeconds_ );
+    }
+
+    for ( const auto& [ otherKey, otherBucket ] : other.buckets_ ) {
+        const auto key = floorDiv( otherBucket.start, bucketSeconds_ );
+        auto bucket = buckets_.find( key );
+        if ( bucket == buckets_.end() ) {
+            auto wideBucket = otherBucket;
+            wideBucket.start = key * bucketSeconds_;
+            buckets_.emplace( key, wideBucket );
+            continue;
+        }
+
+        mergeBucket( bucket->second, otherBucket );
+    }
+
+    if ( buckets_.size() > MaxBuckets ) {
+        widen( bucketSeconds_ + 1 );
+    }
+}
+
+void TimeHistogram::truncate( LinesCount keptLines )
+{
+    for ( auto bucket = buckets_.begin(); bucket != buckets_.end(); ) {
+        if ( bucket->second.firstLine.get() >= keptLines.get() ) {
+            bucket = buckets_.erase( bucket );
+            continue;
+        }
+
+        // Dropped lines are searched again and added to the count, so the count
+        // of the kept ones is not known. It can't be recounted without their times.
+        if ( bucket->second.lastLine.get() >= keptLines.get() ) {
+            bucket->second.isKnown = false;
+            bucket->second.lastLine = LineNumber( keptLines.get() - 1 );
+        }
+        ++bucket;
+    }
+}
+
+void TimeHistogram::clear()
+{
+    bucketSeconds_ = 1;
+    buckets_.clear();
+}
+
+klogg::vector<TimeHistogram::Bucket> TimeHistogram::buckets() const
+{
+    klogg::vector<Bucket> buckets;
+    buckets.reserve( buckets_.size() );
+    for ( const auto& [ key, bucket ] : buckets_ ) {
+        buckets.push_back( bucket );
+    }
+    return buckets;
+}
+
+void TimeHistogram::widen( int64_t seconds )
+{
+    const auto nextWidth = []( int64_t width ) {
+        const auto next = std::upper_bound( BucketWidths.begin(), BucketWidths.end(), width );
+        return next != BucketWidths.end() ? *next : width * 2;
+    };
+
+    auto width = bucketSeconds_;
+    while ( width < seconds ) {
+        width = nextWidth( width );
+    }
+
+    while ( true ) {
+        std::map<int64_t, Bucket> buckets;
+        for ( const auto& [ key, bucket ] : buckets_ ) {
+            const auto wideKey = floorDiv( bucket.start, width );
+            auto wideBucket = buckets.find( wideKey );
+            if ( wideBucket == buckets.end() ) {
+                auto newBucket = bucket;
+                newBucket.start = wideKey * width;
+                buckets.emplace( wideKey, newBucket );
+                continue;
+            }
+
+            mergeBucket( wideBucket->second, bucket );
+        }
+
+        if ( buckets.size() <= MaxBuckets ) {
+            bucketSeconds_ = width;
+            buckets_ = std::move( buckets );
+            return;
+        }
+        width = nextWidth( width );
+    }
+}
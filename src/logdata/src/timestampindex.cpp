@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "timestampindex.h"
+
+#include <algorithm>
+
+#include <QDateTime>
+
+namespace {
+// Lines at the beginning of a block where its time is looked for
+constexpr uint64_t SampledLines = 16;
+} // namespace
+
+TimestampIndex::TimestampIndex( const QString& format )
+    : format_( format )
+{
+}
+
+void TimestampIndex::setFormat( const QString& format )
+{
+    ScopedLock lock( mutex_ );
+    if ( format_ != format ) {
+        format_ = format;
+        blockTimes_.clear();
+    }
+}
+
+QString TimestampIndex::format() const
+{
+    ScopedLock lock( mutex_ );
+    return format_;
+}
+
+std::optional<qint64> TimestampIndex::parse( const QString& line ) const
+{
+    ScopedLock lock( mutex_ );
+    return parseWithFormat( line, format_ );
+}
+
+std::optional<qint64> TimestampIndex::parseWithFormat( const QString& line,
+                                                       const QString& format ) const
+{
+    if ( format.isEmpty() ) {
+        return {};
+    }
+
+    int start = 0;
+    while ( start < line.size() && ( line[ start ].isSpace() || line[ start ] == '[' ) ) {
+        ++start;
+    }
+
+    const auto dateTime = QDateTime::fromString( line.mid( start, format.size() ), format );
+    if ( !dateTime.isValid() ) {
+        return {};
+    }
+
+    return dateTime.toMSecsSinceEpoch();
+}
+
+void TimestampIndex::truncate( LinesCount keptLines )
+{
+    ScopedLock lock( mutex_ );
+
+    // Time of the block with the last kept line could be at a dropped line
+    const auto keptBlocks = keptLines.get() / SampleInterval;
+    for ( auto block = blockTimes_.begin(); block != blockTimes_.end(); ) {
+        if ( block->first >= keptBlocks ) {
+            block = blockTimes_.erase( block );
+        }
+        else {
+            ++block;
+        }
+    }
+}
+
+void TimestampIndex::clear()
+{
+    ScopedLock lock( mutex_ );
+    blockTimes_.clear();
+}
+
+std::optional<qint64> TimestampIndex::blockTime( uint64_t block, LinesCount nbLines,
+                                                 const LinesReader& readLines )
+{
+    const auto time = blockTimes_.find( block );
+    if ( time != blockTimes_.end() ) {
+        return time->second;
+    }
+
+    const auto firstLine = block * SampleInterval;
+    const auto linesCount = std::min( SampledLines, nbLines.get() - firstLine );
+
+    std::optional<qint64> firstTime;
+    const auto lines = readLines( LineNumber( firstLine ), LinesCount( linesCount ) );
+    for ( const auto& line : lines ) {
+        firstTime = parseWithFormat( line, format_ );
+        if ( firstTime ) {
+            break;
+        }
+    }
+
+    // Lines added to the end of the file can have a timestamp
+    if ( firstTime || linesCount == SampledLines ) {
+        blockTimes_.emplace( block, firstTime );
+    }
+
+    return firstTime;
+}
+
+LineNumber TimestampIndex::lineAtTime( qint64 time, LinesCount nbLines,
+                                       const LinesReader& readLines )
+{
+    ScopedLock lock( mutex_ );
+
+    if ( nbLines.get() == 0 || format_.isEmpty() ) {
+        return LineNumber( nbLines.get() );
+    }
+
+    // Time of the first block with a time at or after the block
+    const auto nextTime = [ this, nbLines, &readLines ]( uint64_t block, uint64_t endBlock ) {
+        for ( ; block < endBlock; ++block ) {
+            if ( const auto blockStart = blockTime( block, nbLines, readLines ) ) {
+                return blockStart;
+            }
+        }
+        return std::optional<qint64>{};
+    };
+
+    // Find the first block starting at or after the time
+    const auto blocksCount = ( nbLines.get() + SampleInterval - 1 ) / SampleInterval;
+    uint64_t firstBlock = 0;
+    uint64_t endBlock = blocksCount;
+    while ( firstBlock < endBlock ) {
+        const auto middle = firstBlock + ( endBlock - firstBlock ) / 2;
+        const auto middleTime = nextTime( middle, endBlock );
+        if ( !middleTime || *middleTime >= time ) {
+            endBlock = middle;
+        }
+        else {
+            firstBlock = middle + 1;
+        }
+    }
+
+    // The line is after the time of the previous block and at or before the time of this one
+    const auto firstLine = firstBlock > 0 ? ( firstBlock - 1 ) * SampleInterval : 0;
+    const auto endLine = std::min( firstBlock * SampleInterval + SampledLines, nbLines.get() );
+    const auto lines = readLines( LineNumber( firstLine ), LinesCount( endLine - firstLine ) );
+    for ( size_t index = 0; index < lines.size(); ++index ) {
+        const auto lineTime = parseWithFormat( lines[ index ], format_ );
+        if ( lineTime && *lineTime >= time ) {
+            return LineNumber( firstLine + index );
+        }
+    }
+
+    return LineNumber( nbLines.get() );
+}
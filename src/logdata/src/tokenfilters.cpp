@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tokenfilters.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <QByteArray>
+#include <QDataStream>
+
+#include "log.h"
+
+namespace {
+// Longer tokens are not added, they are not used to skip blocks either
+constexpr size_t MaxTokenLength = 64;
+
+// About 1% of false positives with 4 probes
+constexpr size_t BitsPerToken = 10;
+constexpr size_t MinFilterBits = 512;
+constexpr size_t MaxFilterBits = 128 * 1024;
+constexpr uint64_t ProbesCount = 4;
+
+bool isTokenCharacter( char c )
+{
+    return ( c >= '0' && c <= '9' ) || ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' );
+}
+
+uint64_t tokenHash( std::string_view token )
+{
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325;
+    for ( const auto c : token ) {
+        hash = ( hash ^ static_cast<uint8_t>( c ) ) * 0x100000001b3;
+    }
+    return hash;
+}
+
+// Probes are derived from two halves of the hash
+template <typename Probe>
+bool forEachProbe( uint64_t hash, size_t wordsCount, Probe probe )
+{
+    const auto bitsMask = wordsCount * 64 - 1;
+    const auto step = ( hash >> 32 ) | 1;
+    for ( uint64_t index = 0; index < ProbesCount; ++index ) {
+        const auto bit = static_cast<size_t>( ( hash + index * step ) & bitsMask );
+        if ( !probe( bit / 64, uint64_t{ 1 } << ( bit % 64 ) ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+TokenFilters::TokenFilters( qint64 startOffset )
+    : startOffset_( startOffset )
+    , endOffset_( startOffset )
+{
+}
+
+klogg::vector<std::string> TokenFilters::wholeTokens( std::string_view text, bool isTokenStart,
+                                                      bool isTokenEnd )
+{
+    klogg::vector<std::string> tokens;
+    size_t tokenStart = 0;
+    for ( size_t index = 0; index <= text.size(); ++index ) {
+        if ( index < text.size() && isTokenCharacter( text[ index ] ) ) {
+            continue;
+        }
+
+        const auto isWhole = ( tokenStart > 0 || isTokenStart )
+                             && ( index < text.size() || isTokenEnd );
+        const auto length = index - tokenStart;
+        if ( isWhole && length > 0 && length <= MaxTokenLength ) {
+            tokens.emplace_back( text.substr( tokenStart, length ) );
+        }
+        tokenStart = index + 1;
+    }
+
+    std::sort( tokens.begin(), tokens.end() );
+    tokens.erase( std::unique( tokens.begin(), tokens.end() ), tokens.end() );
+    return tokens;
+}
+
+qint64 TokenFilters::startOffset() const
+{
+    ScopedLock lock( mutex_ );
+    return startOffset_;
+}
+
+qint64 TokenFilters::endOffset() const
+{
+    ScopedLock lock( mutex_ );
+    return endOffset_;
+}
+
+void TokenFilters::addBlock( qint64 offset, std::string_view data )
+{
+    {
+        ScopedLock lock( mutex_ );
+        if ( !isValid_ ) {
+            return;
+        }
+        if ( offset != endOffset_ ) {
+            LOG_WARNING << "Token filters end at " << endOffset_ << ", got block at " << offset
+                        << ", filters are not used";
+            isValid_ = false;
+            blocks_.clear();
+            words_.clear();
+            return;
+        }
+    }
+
+    blockHashes_.clear();
+    const auto addToken = [ this ]( std::string_view token ) {
+        if ( !token.empty() && token.size() <= MaxTokenLength ) {
+            blockHashes_.push_back( tokenHash( token ) );
+        }
+    };
+
+    // Beginning of the first token is at the end of the previous block
+    auto continuedToken = lastToken_;
+    size_t tokenStart = 0;
+    for ( size_t index = 0; index < data.size(); ++index ) {
+        if ( isTokenCharacter( data[ index ] ) ) {
+            continue;
+        }
+
+        if ( tokenStart == 0 && !continuedToken.empty() ) {
+            continuedToken.append( data.substr( 0, std::min( index, MaxTokenLength + 1 ) ) );
+            addToken( continuedToken );
+        }
+        else {
+            addToken( data.substr( tokenStart, index - tokenStart ) );
+        }
+        tokenStart = index + 1;
+    }
+
+    // Token at the end of the block may end there, so it is added to this block too
+    std::string lastToken;
+    if ( tokenStart == 0 ) {
+        lastToken = continuedToken;
+    }
+    if ( tokenStart < data.size() ) {
+        lastToken.append( data.substr( tokenStart, MaxTokenLength + 1 ) );
+    }
+    lastToken.resize( std::min( lastToken.size(), MaxTokenLength + 1 ) );
+    addToken( lastToken );
+
+    std::sort( blockHashes_.begin(), blockHashes_.end() );
+    blockHashes_.erase( std::unique( blockHashes_.begin(), blockHashes_.end() ),
+                        blockHashes_.end() );
+
+    auto filterBits = MinFilterBits;
+    while ( filterBits < blockHashes_.size() * BitsPerToken && filterBits < MaxFilterBits ) {
+        filterBits *= 2;
+    }
+
+    ScopedLock lock( mutex_ );
+    const auto firstWord = words_.size();
+    const auto wordsCount = filterBits / 64;
+    words_.resize( firstWord + wordsCount );
+    for ( const auto hash : blockHashes_ ) {
+        forEachProbe( hash, wordsCount, [ this, firstWord ]( size_t word, uint64_t bit ) {
+            words_[ firstWord + word ] |= bit;
+            return true;
+        } );
+    }
+    blocks_.push_back( BlockFilter{ offset, firstWord, wordsCount } );
+
+    endOffset_ = offset + static_cast<qint64>( data.size() );
+    lastToken_ = std::move( lastToken );
+}
+
+void TokenFilters::append( const TokenFilters& other )
+{
+    klogg::vector<BlockFilter> otherBlocks;
+    klogg::vector<uint64_t> otherWords;
+    qint64 otherStart = 0;
+    qint64 otherEnd = 0;
+    bool isOtherValid = false;
+    std::string otherLastToken;
+    {
+        ScopedLock lock( other.mutex_ );
+        otherBlocks = other.blocks_;
+        otherWords = other.words_;
+        otherStart = other.startOffset_;
+        otherEnd = other.endOffset_;
+        isOtherValid = other.isValid_;
+        otherLastToken = other.lastToken_;
+    }
+
+    ScopedLock lock( mutex_ );
+    if ( !isValid_ || !isOtherValid || otherStart != endOffset_ ) {
+        isValid_ = false;
+        blocks_.clear();
+        words_.clear();
+        return;
+    }
+
+    const auto firstWord = words_.size();
+    for ( auto& block : otherBlocks ) {
+        block.firstWord += firstWord;
+    }
+    blocks_.insert( blocks_.end(), otherBlocks.begin(), otherBlocks.end() );
+    words_.insert( words_.end(), otherWords.begin(), otherWords.end() );
+
+    endOffset_ = otherEnd;
+    lastToken_ = std::move( otherLastToken );
+}
+
+bool TokenFilters::mayContain( qint64 begin, qint64 end,
+                               const klogg::vector<std::string>& tokens ) const
+{
+    klogg::vector<uint64_t> hashes;
+    for ( const auto& token : tokens ) {
+        if ( !token.empty() && token.size() <= MaxTokenLength ) {
+            hashes.push_back( tokenHash( token ) );
+        }
+    }
+
+    if ( hashes.empty() || begin >= end ) {
+        return true;
+    }
+
+    ScopedLock lock( mutex_ );
+    if ( !isValid_ || blocks_.empty() || begin < startOffset_ || end > endOffset_ ) {
+        return true;
+    }
+
+    const auto blockAt = [ this ]( qint64 offset ) {
+        const auto next = std::upper_bound(
+            blocks_.begin(), blocks_.end(), offset,
+            []( qint64 value, const BlockFilter& block ) { return value < block.offset; } );
+        return static_cast<size_t>( std::distance( blocks_.begin(), next ) - 1 );
+    };
+
+    // Line having all tokens can span blocks, so each token may be in
+    // any of the blocks of the range, as trigrams of the trigram index
+    const auto firstBlock = blockAt( begin );
+    const auto lastBlock = blockAt( end - 1 );
+    return std::all_of( hashes.begin(), hashes.end(), [ & ]( uint64_t hash ) {
+        for ( auto block = firstBlock; block <= lastBlock; ++block ) {
+            const auto& filter = blocks_[ block ];
+            const auto hasToken = forEachProbe(
+                hash, filter.wordsCount, [ this, &filter ]( size_t word, uint64_t bit ) {
+                    return ( words_[ filter.firstWord + word ] & bit ) != 0;
+                } );
+            if ( hasToken ) {
+                return true;
+            }
+        }
+        return false;
+    } );
+}
+
+size_t TokenFilters::allocatedSize() const
+{
+    ScopedLock lock( mutex_ );
+    return blocks_.capacity() * sizeof( BlockFilter ) + words_.capacity() * sizeof( uint64_t );
+}
+
+void TokenFilters::write( QDataStream& stream ) const
+{
+    ScopedLock lock( mutex_ );
+    stream << startOffset_ << endOffset_ << isValid_
+           << QByteArray::fromStdString( lastToken_ );
+
+    stream << static_cast<quint64>( blocks_.size() );
+    for ( const auto& block : blocks_ ) {
+        stream << block.offset << static_cast<quint64>( block.wordsCount );
+        for ( auto word = 0u; word < block.wordsCount; ++word ) {
+            stream << static_cast<quint64>( words_[ block.firstWord + word ] );
+        }
+    }
+}
+
+bool TokenFilters::read( QDataStream& stream )
+{
+    qint64 startOffset = 0;
+    qint64 endOffset = 0;
+    bool isValid = false;
+    QByteArray lastToken;
+    quint64 blocksCount = 0;
+    stream >> startOffset >> endOffset >> isValid >> lastToken >> blocksCount;
+    if ( stream.status() != QDataStream::Ok ) {
+        return false;
+    }
+
+    klogg::vector<BlockFilter> blocks;
+    klogg::vector<uint64_t> words;
+    for ( quint64 index = 0; index < blocksCount && stream.status() == QDataStream::Ok;
+          ++index ) {
+        qint64 offset = 0;
+        quint64 wordsCount = 0;
+        stream >> offset >> wordsCount;
+
+        // Filters have a power of two bits
+        if ( wordsCount * 64 < MinFilterBits || wordsCount * 64 > MaxFilterBits
+             || ( wordsCount & ( wordsCount - 1 ) ) != 0 ) {
+            return false;
+        }
+
+        blocks.push_back( BlockFilter{ offset, words.size(), static_cast<size_t>( wordsCount ) } );
+        for ( quint64 word = 0; word < wordsCount; ++word ) {
+            quint64 bits = 0;
+            stream >> bits;
+            words.push_back( bits );
+        }
+    }
+
+    if ( stream.status() != QDataStream::Ok ) {
+        return false;
+    }
+
+    ScopedLock lock( mutex_ );
+    startOffset_ = startOffset;
+    endOffset_ = endOffset;
+    isValid_ = isValid;
+    lastToken_ = lastToken.toStdString();
+    blocks_ = std::move( blocks );
+    words_ = std::move( words );
+    return true;
+}
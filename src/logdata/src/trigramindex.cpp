@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trigramindex.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include <QByteArray>
+#include <QDataStream>
+
+#include "log.h"
+
+namespace {
+constexpr size_t TrigramsCount = size_t{ 1 } << 24;
+} // namespace
+
+TrigramIndex::TrigramIndex( qint64 startOffset )
+    : startOffset_( startOffset )
+    , endOffset_( startOffset )
+{
+}
+
+qint64 TrigramIndex::startOffset() const
+{
+    ScopedLock lock( mutex_ );
+    return startOffset_;
+}
+
+qint64 TrigramIndex::endOffset() const
+{
+    ScopedLock lock( mutex_ );
+    return endOffset_;
+}
+
+void TrigramIndex::addBlock( qint64 offset, std::string_view data )
+{
+    {
+        ScopedLock lock( mutex_ );
+        if ( !isValid_ ) {
+            return;
+        }
+        if ( offset != endOffset_ ) {
+            LOG_WARNING << "Trigram index ends at " << endOffset_ << ", got block at " << offset
+                        << ", index is not used";
+            isValid_ = false;
+            blocks_.clear();
+            blockOffsets_.clear();
+            return;
+        }
+    }
+
+    // Trigrams are seen at most once per block, only the bits set are cleared
+    seenTrigrams_.resize( TrigramsCount / 64 );
+    blockTrigrams_.clear();
+
+    auto trigram = lastBytes_;
+    auto bytesCount = lastBytesCount_;
+    for ( const auto c : data ) {
+        trigram = ( ( trigram << 8 ) | static_cast<uint8_t>( c ) ) & TrigramMask;
+        if ( ++bytesCount < 3 ) {
+            continue;
+        }
+
+        auto& word = seenTrigrams_[ trigram / 64 ];
+        const auto bit = uint64_t{ 1 } << ( trigram % 64 );
+        if ( ( word & bit ) == 0 ) {
+            word |= bit;
+            blockTrigrams_.push_back( trigram );
+        }
+    }
+
+    for ( const auto seenTrigram : blockTrigrams_ ) {
+        seenTrigrams_[ seenTrigram / 64 ] = 0;
+    }
+
+    ScopedLock lock( mutex_ );
+    const auto block = static_cast<uint32_t>( blockOffsets_.size() );
+    for ( const auto blockTrigram : blockTrigrams_ ) {
+        blocks_[ blockTrigram ].add( block );
+    }
+    blockOffsets_.push_back( offset );
+
+    endOffset_ = offset + static_cast<qint64>( data.size() );
+    lastBytes_ = trigram & 0xffff;
+    lastBytesCount_ = std::min( bytesCount, 2u );
+}
+
+void TrigramIndex::append( const TrigramIndex& other )
+{
+    klogg::vector<qint64> otherOffsets;
+    robin_hood::unordered_flat_map<uint32_t, klogg::vector<uint32_t>> otherBlocks;
+    qint64 otherStart = 0;
+    qint64 otherEnd = 0;
+    bool isOtherValid = false;
+    uint32_t otherLastBytes = 0;
+    uint32_t otherLastBytesCount = 0;
+    {
+        ScopedLock lock( other.mutex_ );
+        otherOffsets = other.blockOffsets_;
+        for ( const auto& [ trigram, blocks ] : other.blocks_ ) {
+            klogg::vector<uint32_t> trigramBlocks( blocks.cardinality() );
+            blocks.toUint32Array( trigramBlocks.data() );
+            otherBlocks.emplace( trigram, std::move( trigramBlocks ) );
+        }
+        otherStart = other.startOffset_;
+        otherEnd = other.endOffset_;
+        isOtherValid = other.isValid_;
+        otherLastBytes = other.lastBytes_;
+        otherLastBytesCount = other.lastBytesCount_;
+    }
+
+    ScopedLock lock( mutex_ );
+    if ( !isValid_ || !isOtherValid || otherStart != endOffset_ ) {
+        isValid_ = false;
+        blocks_.clear();
+        blockOffsets_.clear();
+        return;
+    }
+
+    const auto firstBlock = static_cast<uint32_t>( blockOffsets_.size() );
+    for ( auto& [ trigram, trigramBlocks ] : otherBlocks ) {
+        for ( auto& block : trigramBlocks ) {
+            block += firstBlock;
+        }
+        blocks_[ trigram ].addMany( trigramBlocks.size(), trigramBlocks.data() );
+    }
+    blockOffsets_.insert( blockOffsets_.end(), otherOffsets.begin(), otherOffsets.end() );
+
+    endOffset_ = otherEnd;
+    lastBytes_ = otherLastBytes;
+    lastBytesCount_ = otherLastBytesCount;
+}
+
+bool TrigramIndex::mayContain( qint64 begin, qint64 end, std::string_view text ) const
+{
+    if ( text.size() < 3 || begin >= end ) {
+        return true;
+    }
+
+    ScopedLock lock( mutex_ );
+    if ( !isValid_ || blockOffsets_.empty() || begin < startOffset_ || end > endOffset_ ) {
+        return true;
+    }
+
+    const auto blockAt = [ this ]( qint64 offset ) {
+        const auto next = std::upper_bound( blockOffsets_.begin(), blockOffsets_.end(), offset );
+        return static_cast<uint32_t>( std::distance( blockOffsets_.begin(), next ) - 1 );
+    };
+    const auto firstBlock = blockAt( begin );
+    const auto lastBlock = blockAt( end - 1 );
+
+    uint32_t trigram = 0;
+    for ( auto index = 0u; index < text.size(); ++index ) {
+        trigram = ( ( trigram << 8 ) | static_cast<uint8_t>( text[ index ] ) ) & TrigramMask;
+        if ( index < 2 ) {
+            continue;
+        }
+
+        const auto blocks = blocks_.find( trigram );
+        if ( blocks == blocks_.end() ) {
+            return false;
+        }
+
+        const auto blocksBefore = firstBlock > 0 ? blocks->second.rank( firstBlock - 1 ) : 0;
+        if ( blocks->second.rank( lastBlock ) == blocksBefore ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void TrigramIndex::optimize()
+{
+    // Scratch memory is allocated again if more blocks are added later
+    seenTrigrams_ = {};
+    blockTrigrams_ = {};
+
+    ScopedLock lock( mutex_ );
+    for ( auto& [ trigram, blocks ] : blocks_ ) {
+        blocks.runOptimize();
+        blocks.shrinkToFit();
+    }
+}
+
+size_t TrigramIndex::allocatedSize() const
+{
+    ScopedLock lock( mutex_ );
+    size_t size = blockOffsets_.capacity() * sizeof( qint64 )
+                  + ( blocks_.mask() + 1 ) * sizeof( std::pair<uint32_t, roaring::Roaring> );
+    for ( const auto& [ trigram, blocks ] : blocks_ ) {
+        size += blocks.getSizeInBytes( false );
+    }
+    return size;
+}
+
+void TrigramIndex::write( QDataStream& stream ) const
+{
+    ScopedLock lock( mutex_ );
+    stream << startOffset_ << endOffset_ << isValid_ << lastBytes_ << lastBytesCount_;
+
+    stream << static_cast<quint64>( blockOffsets_.size() );
+    for ( const auto offset : blockOffsets_ ) {
+        stream << offset;
+    }
+
+    stream << static_cast<quint64>( blocks_.size() );
+    QByteArray buffer;
+    for ( const auto& [ trigram, blocks ] : blocks_ ) {
+        buffer.resize( static_cast<int>( blocks.getSizeInBytes( true ) ) );
+        blocks.write( buffer.data(), true );
+        stream << trigram << buffer;
+    }
+}
+
+bool TrigramIndex::read( QDataStream& stream )
+{
+    qint64 startOffset = 0;
+    qint64 endOffset = 0;
+    bool isValid = false;
+    quint32 lastBytes = 0;
+    quint32 lastBytesCount = 0;
+    quint64 blocksCount = 0;
+    stream >> startOffset >> endOffset >> isValid >> lastBytes >> lastBytesCount >> blocksCount;
+    if ( stream.status() != QDataStream::Ok || lastBytesCount > 2 ) {
+        return false;
+    }
+
+    klogg::vector<qint64> blockOffsets;
+    for ( quint64 block = 0; block < blocksCount && stream.status() == QDataStream::Ok;
+          ++block ) {
+        qint64 offset = 0;
+        stream >> offset;
+        blockOffsets.push_back( offset );
+    }
+
+    quint64 trigramsCount = 0;
+    stream >> trigramsCount;
+
+    robin_hood::unordered_flat_map<uint32_t, roaring::Roaring> blocks;
+    QByteArray buffer;
+    for ( quint64 index = 0; index < trigramsCount && stream.status() == QDataStream::Ok;
+          ++index ) {
+        quint32 trigram = 0;
+        stream >> trigram >> buffer;
+        try {
+            blocks.emplace( trigram,
+                            roaring::Roaring::readSafe( buffer.constData(),
+                                                        static_cast<size_t>( buffer.size() ) ) );
+        } catch ( const std::exception& err ) {
+            LOG_WARNING << "Can't read trigram index: " << err.what();
+            return false;
+        }
+    }
+
+    if ( stream.status() != QDataStream::Ok ) {
+        return false;
+    }
+
+    ScopedLock lock( mutex_ );
+    startOffset_ = startOffset;
+    endOffset_ = endOffset;
+    isValid_ = isValid;
+    lastBytes_ = lastBytes;
+    lastBytesCount_ = lastBytesCount;
+    blockOffsets_ = std::move( blockOffsets );
+    blocks_ = std::move( blocks );
+    return true;
+}
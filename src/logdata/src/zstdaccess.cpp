@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "zstdaccess.h"
+
+#ifdef KLOGG_HAS_ZSTD
+
+#include <QtEndian>
+
+#include <zstd.h>
+
+#include "log.h"
+
+namespace {
+// Seek table is a skippable frame: header, entries and footer
+constexpr uint32_t SkippableFrameMagic = 0x184D2A5E;
+constexpr qint64 SkippableHeaderSize = 8;
+constexpr qint64 SeekTableFooterSize = 9;
+constexpr uint8_t ChecksumFlag = 0x80;
+
+uint32_t readLittleEndian( const char* data )
+{
+    return qFromLittleEndian<quint32>( data );
+}
+} // namespace
+
+bool ZstdAccess::readFrames( const ReadCompressed& readCompressed, qint64 compressedSize,
+                             klogg::vector<Frame>& frames ) const
+{
+    if ( compressedSize < SkippableHeaderSize + SeekTableFooterSize ) {
+        return false;
+    }
+
+    char footer[ SeekTableFooterSize ];
+    if ( !readExactly( readCompressed, compressedSize - SeekTableFooterSize, footer,
+                       SeekTableFooterSize )
+         || readLittleEndian( footer + 5 ) != SeekableMagic ) {
+        LOG_WARNING << "No zstd seek table";
+        return false;
+    }
+
+    const auto framesCount = static_cast<qint64>( readLittleEndian( footer ) );
+    const auto entrySize = ( static_cast<uint8_t>( footer[ 4 ] ) & ChecksumFlag ) ? 12 : 8;
+    const auto tableSize = SkippableHeaderSize + framesCount * entrySize + SeekTableFooterSize;
+    if ( tableSize > compressedSize ) {
+        LOG_WARNING << "Invalid zstd seek table of " << framesCount << " frames";
+        return false;
+    }
+
+    klogg::vector<char> table( static_cast<size_t>( tableSize - SeekTableFooterSize ) );
+    if ( !readExactly( readCompressed, compressedSize - tableSize, table.data(),
+                       klogg::ssize( table ) )
+         || readLittleEndian( table.data() ) != SkippableFrameMagic ) {
+        LOG_WARNING << "Invalid zstd seek table header";
+        return false;
+    }
+
+    frames.reserve( static_cast<size_t>( framesCount ) );
+
+    Frame frame;
+    for ( auto entry = table.data() + SkippableHeaderSize; entry < table.data() + table.size();
+          entry += entrySize ) {
+        frame.compressedSize = readLittleEndian( entry );
+        frame.decompressedSize = readLittleEndian( entry + 4 );
+        frames.push_back( frame );
+
+        frame.compressedOffset += frame.compressedSize;
+    }
+
+    // Frames are followed by the seek table
+    return frame.compressedOffset <= compressedSize - tableSize;
+}
+
+bool ZstdAccess::decompressFrame( const char* compressed, qint64 compressedSize, char* data,
+                                  qint64 size ) const
+{
+    const auto result = ZSTD_decompress( data, static_cast<size_t>( size ), compressed,
+                                         static_cast<size_t>( compressedSize ) );
+    if ( ZSTD_isError( result ) ) {
+        LOG_WARNING << "Failed to decompress zstd frame: " << ZSTD_getErrorName( result );
+        return false;
+    }
+
+    return static_cast<qint64>( result ) == size;
+}
+
+#endif
@@ -41,6 +41,20 @@
 #define LOG_WARNING LOG_IF_( QtWarningMsg ) qWarning().nospace()
 #define LOG_ERROR LOG_IF_( QtCriticalMsg ) qCritical().nospace()
 
+// Debug logs for each line, block or chunk in indexing, search and drawing.
+// They are compiled only with KLOGG_ENABLE_TRACE_LOGS, otherwise the message
+// is never evaluated, so debug logging doesn't slow these loops down.
+#ifdef KLOGG_ENABLE_TRACE_LOGS
+#define LOG_TRACE LOG_DEBUG
+#else
+#define LOG_TRACE                                                                                  \
+    if ( true ) {                                                                                  \
+        ;                                                                                          \
+    }                                                                                              \
+    else                                                                                           \
+        qDebug().nospace()
+#endif
+
 namespace logging {
 bool needLogging( QtMsgType type );
 } // namespace logging
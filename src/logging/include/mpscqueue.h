@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_MPSCQUEUE_H
+#define KLOGG_MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Unbounded queue with many producers and one consumer. Producers push
+// without locks by swapping the head of a linked list of nodes, the consumer
+// pops from its tail. Values are popped in the order their pushes finished
+// swapping the head. A value that is being pushed may be not visible to pop
+// for a moment, the consumer sees it on the next pop.
+template <typename T>
+class MpscQueue {
+  public:
+    MpscQueue()
+        : head_( new Node )
+        , tail_( head_.load( std::memory_order_relaxed ) )
+    {
+    }
+
+    ~MpscQueue()
+    {
+        T value;
+        while ( pop( value ) ) {
+        }
+        delete tail_;
+    }
+
+    MpscQueue( const MpscQueue& ) = delete;
+    MpscQueue& operator=( const MpscQueue& ) = delete;
+
+    // Called by any thread
+    void push( T value )
+    {
+        auto* node = new Node;
+        node->value = std::move( value );
+
+        auto* previous = head_.exchange( node, std::memory_order_acq_rel );
+        previous->next.store( node, std::memory_order_release );
+    }
+
+    // Called by the consumer thread only
+    bool pop( T& value )
+    {
+        auto* next = tail_->next.load( std::memory_order_acquire );
+        if ( next == nullptr ) {
+            return false;
+        }
+
+        value = std::move( next->value );
+        delete tail_;
+        tail_ = next;
+        return true;
+    }
+
+  private:
+    struct Node {
+        std::atomic<Node*> next{ nullptr };
+        T value{};
+    };
+
+    // Last pushed node
+    std::atomic<Node*> head_;
+    // Node before the first value to pop, its value is already popped
+    Node* tail_;
+};
+
+#endif
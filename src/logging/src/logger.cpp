@@ -19,12 +19,17 @@
 
 #include "logger.h"
 #include "log.h"
+#include "mpscqueue.h"
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <shared_mutex>
+#include <thread>
 
 #include <QCoreApplication>
 #include <QDateTime>
@@ -40,6 +45,8 @@ void kloggConsoleMessageHandler( QtMsgType type, const QMessageLogContext& conte
                                  const QString& msg );
 void kloggNoopMessageHandler( QtMsgType, const QMessageLogContext&, const QString& ) {}
 
+// Messages are formatted by the threads logging them and written by one writer thread,
+// so logging from indexing and search doesn't wait for the file or the console.
 class Logger {
   public:
     static Logger& instance()
@@ -48,36 +55,20 @@ class Logger {
         return l;
     }
 
-    void fileMessageHandler( QtMsgType type, const QMessageLogContext& context, const QString& msg )
+    ~Logger()
     {
-        if ( !needLogging( type ) ) {
-            return;
-        }
-        
-        const auto formattedMessage = qFormatLogMessage( type, context, msg );
-        const auto messageToPrint = formattedMessage.toUtf8();
-
-        ScopedLock lock( mutex_ );
-        QTextStream ts( logFile_.get() );
-        ts << messageToPrint << '\n';
+        stopWriter();
+    }
 
-        if ( isConsoleLogEnabled_ ) {
-            std::cout << messageToPrint.constData() << std::endl;
-        }
+    void fileMessageHandler( QtMsgType type, const QMessageLogContext& context, const QString& msg )
+    {
+        handleMessage( type, context, msg, Destination::File );
     }
 
     void consoleMessageHandler( QtMsgType type, const QMessageLogContext& context,
                                 const QString& msg )
     {
-        if ( !needLogging( type ) ) {
-            return;
-        }
-
-        const auto formattedMessage = qFormatLogMessage( type, context, msg );
-        const auto messageToPrint = formattedMessage.toUtf8();
-
-        ScopedLock lock( mutex_ );
-        std::cout << messageToPrint.constData() << std::endl;
+        handleMessage( type, context, msg, Destination::Console );
     }
 
     void enableLogging( bool isEnabled, uint8_t logLevel )
@@ -135,12 +126,22 @@ class Logger {
   private:
     Logger() = default;
 
+    enum class Destination { File, Console };
+
+    struct Message {
+        QByteArray text;
+        Destination destination = Destination::Console;
+    };
+
     void setMessageHandler()
     {
         if ( !isAnyEnabled() ) {
             qInstallMessageHandler( logging::kloggNoopMessageHandler );
+            return;
         }
-        else if ( logFile_ ) {
+
+        startWriter();
+        if ( logFile_ ) {
             qInstallMessageHandler( logging::kloggFileMessageHandler );
         }
         else {
@@ -148,6 +149,114 @@ class Logger {
         }
     }
 
+    void handleMessage( QtMsgType type, const QMessageLogContext& context, const QString& msg,
+                        Destination destination )
+    {
+        if ( !needLogging( type ) ) {
+            return;
+        }
+
+        // Time and thread of the message are taken by the thread logging it
+        messages_.push( { qFormatLogMessage( type, context, msg ).toUtf8(), destination } );
+        const auto ticket = pushedMessages_.fetch_add( 1 ) + 1;
+
+        // The writer checks for messages after it says it waits, so it either
+        // sees this one or is woken up. The lock is taken only when it sleeps.
+        if ( isWriterWaiting_ ) {
+            std::unique_lock<std::mutex> lock( writerMutex_ );
+            lock.unlock();
+            writerWakeUp_.notify_one();
+        }
+
+        // Application is aborted after the handler returns
+        if ( type == QtFatalMsg ) {
+            waitWritten( ticket );
+        }
+    }
+
+    void waitWritten( uint64_t ticket )
+    {
+        while ( isWriterRunning_ && writtenMessages_.load( std::memory_order_acquire ) < ticket ) {
+            writerWakeUp_.notify_one();
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        }
+    }
+
+    void startWriter()
+    {
+        if ( writer_.joinable() ) {
+            return;
+        }
+
+        isWriterRunning_ = true;
+        writer_ = std::thread( [ this ] { writeMessages(); } );
+    }
+
+    void stopWriter()
+    {
+        if ( !writer_.joinable() ) {
+            return;
+        }
+
+        isWriterRunning_ = false;
+        writerWakeUp_.notify_one();
+        writer_.join();
+    }
+
+    void writeMessages()
+    {
+        while ( true ) {
+            const auto isRunning = isWriterRunning_.load();
+            writePending();
+            if ( !isRunning ) {
+                // Messages pushed before stopping are written
+                return;
+            }
+
+            std::unique_lock<std::mutex> lock( writerMutex_ );
+            isWriterWaiting_ = true;
+            if ( pushedMessages_ == writtenMessages_ && isWriterRunning_ ) {
+                writerWakeUp_.wait_for( lock, MaxWriterSleep );
+            }
+            isWriterWaiting_ = false;
+        }
+    }
+
+    void writePending()
+    {
+        Message message;
+        if ( !messages_.pop( message ) ) {
+            return;
+        }
+
+        SharedLock lock( mutex_ );
+        std::optional<QTextStream> fileStream;
+        if ( logFile_ ) {
+            fileStream.emplace( logFile_.get() );
+        }
+
+        auto isConsoleWritten = false;
+        do {
+            if ( message.destination == Destination::File && fileStream ) {
+                *fileStream << message.text << '\n';
+            }
+
+            if ( message.destination == Destination::Console || isConsoleLogEnabled_ ) {
+                std::cout << message.text.constData() << '\n';
+                isConsoleWritten = true;
+            }
+
+            writtenMessages_.fetch_add( 1, std::memory_order_acq_rel );
+        } while ( messages_.pop( message ) );
+
+        if ( fileStream ) {
+            fileStream->flush();
+        }
+        if ( isConsoleWritten ) {
+            std::cout.flush();
+        }
+    }
+
   private:
     static LogLevel logLevel( QtMsgType type )
     {
@@ -170,15 +279,30 @@ class Logger {
     }
 
   private:
+    // Writer wakes up to write messages it was not woken up for, e.g. on stop
+    static constexpr std::chrono::milliseconds MaxWriterSleep{ 50 };
+
     mutable std::shared_mutex mutex_;
     using ScopedLock = std::unique_lock<std::shared_mutex>;
+    using SharedLock = std::shared_lock<std::shared_mutex>;
 
     std::atomic_bool isConsoleLogEnabled_ = false;
     std::atomic_bool isFileLogEnabled_ = false;
 
     std::atomic_int logLevel_ = 0;
 
+    // Protected by mutex_, written by the writer thread
     std::unique_ptr<QFile> logFile_;
+
+    MpscQueue<Message> messages_;
+    std::atomic<uint64_t> pushedMessages_{ 0 };
+    std::atomic<uint64_t> writtenMessages_{ 0 };
+
+    std::mutex writerMutex_;
+    std::condition_variable writerWakeUp_;
+    std::atomic_bool isWriterWaiting_ = false;
+    std::atomic_bool isWriterRunning_ = false;
+    std::thread writer_;
 };
 
 void enableLogging( bool isEnabled, LogLevel logLevel )
@@ -17,17 +17,28 @@
  * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <exprtk.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
 #include <string_view>
 
+#include <robin_hood.h>
+
 #include "containers.h"
+#include "fieldquery.h"
 
 #include "regularexpressionpattern.h"
 
-class BooleanExpressionEvaluator {
+class ExprtkBooleanExpression;
+
+// Boolean combination of patterns compiled once by the regular expression and shared
+// by the evaluators of all matching threads. Results of all combinations of up to
+// 16 patterns are computed when it is compiled, so evaluators only look them up.
+class BooleanProgram {
   public:
-    BooleanExpressionEvaluator( const std::string& expression,
-                                const klogg::vector<RegularExpressionPattern>& patterns );
+    BooleanProgram( const std::string& expression,
+                    const klogg::vector<RegularExpressionPattern>& patterns );
 
     bool isValid() const
     {
@@ -39,19 +50,106 @@ class BooleanExpressionEvaluator {
         return errorString_;
     }
 
-    bool evaluate( std::string_view variables );
+    size_t patternsCount() const
+    {
+        return variableNames_.size();
+    }
+
+    // Whether results of all combinations are known
+    bool isTabulated() const
+    {
+        return !resultsTable_.empty();
+    }
+
+    // Result for the combination of all patterns of a tabulated program
+    bool result( uint64_t combination ) const
+    {
+        return resultsTable_[ combination ] != 0;
+    }
 
   private:
+    friend class BooleanExpressionEvaluator;
+
+    std::string expression_;
+    klogg::vector<std::string> variableNames_;
+
     bool isValid_ = true;
     std::string errorString_;
 
-    
+    klogg::vector<uint8_t> resultsTable_;
+};
+
+// Evaluates the program for one matching thread, it keeps only what the
+// thread learns about the lines, e.g. the order of lazy evaluation.
+class BooleanExpressionEvaluator {
+  public:
+    using FieldQueries = klogg::vector<std::shared_ptr<const FieldQuery>>;
+
+    // Patterns with a field query are matched in the fields of lines
+    // instead of by the regular expression engine
+    explicit BooleanExpressionEvaluator( std::shared_ptr<const BooleanProgram> program,
+                                         const FieldQueries& fieldQueries = {} );
+    ~BooleanExpressionEvaluator();
+
+    BooleanExpressionEvaluator( const BooleanExpressionEvaluator& ) = delete;
+    BooleanExpressionEvaluator& operator=( const BooleanExpressionEvaluator& ) = delete;
+
+    bool isValid() const
+    {
+        return program_->isValid();
+    }
+
+    std::string errorString() const
+    {
+        return program_->errorString();
+    }
+
+    // Results of tabulated programs are looked up, for larger programs they are
+    // memoized for each combination of matched patterns seen.
+    bool evaluate( std::string_view variables );
+
+    // Match patterns one by one until the result is known. Patterns that decide
+    // the result most often on the first evaluated lines are matched first.
+    bool evaluateLazily( size_t patternsCount, const std::function<bool( size_t )>& isMatched );
+
+    bool isFieldPattern( size_t pattern ) const
+    {
+        return pattern < fieldQueries_.size() && fieldQueries_[ pattern ] != nullptr;
+    }
+
+    bool hasFieldMatch( size_t pattern, std::string_view line ) const
+    {
+        return fieldQueries_[ pattern ]->matches( line );
+    }
+
+    // Patterns matched by the engine with the field patterns matched in the line,
+    // a view of a buffer valid until the next call
+    std::string_view withFieldMatches( std::string_view line, std::string_view variables );
+
+  private:
+    bool evaluateExpression( std::string_view variables );
+
+    // Result if it is the same for all values of the unknown patterns
+    uint8_t partialResult( uint32_t knownPatterns, uint32_t combination );
+
+    void planEvaluationOrder();
+
+  private:
+    std::shared_ptr<const BooleanProgram> program_;
+    // Programs that are not tabulated are compiled by each evaluator
+    std::unique_ptr<ExprtkBooleanExpression> expression_;
 
-    exprtk::symbol_table<double> symbols_;
-    exprtk::expression<double> expression_;
-    exprtk::parser<double> parser_;
+    FieldQueries fieldQueries_;
+    klogg::vector<size_t> fieldPatterns_;
+    std::string fieldVariables_;
 
-    klogg::vector<double*> variables_;
+    // Results of the combinations seen when there are more patterns than tabulated
+    robin_hood::unordered_flat_map<uint64_t, bool> resultsCache_;
 
-    double precomputedResults_[16];
+    // Lazy evaluation, results keyed by known patterns and their combination
+    robin_hood::unordered_flat_map<uint32_t, uint8_t> partialResults_;
+    klogg::vector<size_t> evaluationOrder_;
+    // Combinations of all patterns on the first lines, used to plan the order
+    robin_hood::unordered_flat_map<uint32_t, uint32_t> sampledCombinations_;
+    size_t sampledLines_ = 0;
 };
\ No newline at end of file
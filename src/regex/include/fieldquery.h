@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_FIELDQUERY_H
+#define KLOGG_FIELDQUERY_H
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <QString>
+
+#include "containers.h"
+
+// Search of structured lines by the values of their fields.
+//
+// Lines are JSON objects or logfmt pairs (key=value key2="quoted value").
+// Fields are the top level members of JSON objects, with string, number or
+// literal values; nested objects and arrays are skipped. A pattern made only
+// of @key=value terms, e.g. `@level=error @service=billing`, matches lines
+// where each key has exactly this value. Values with spaces are quoted.
+//
+// Terms also compare values with !=, <, <=, > and >=, as numbers if the value
+// of the term is one and as text otherwise, e.g. `@latency_ms>500`. Keys $1, $2
+// and so on are the columns of words separated by spaces, e.g. `@$9>=500`.
+class FieldQuery {
+  public:
+    enum class Operator { Equal, NotEqual, Less, LessOrEqual, Greater, GreaterOrEqual };
+
+    struct Predicate {
+        std::string key;
+        std::string value;
+        Operator op = Operator::Equal;
+        // Column of the line for keys $1, $2..., 0 for named fields
+        size_t column = 0;
+        // Values are compared as numbers if the predicate value is one, except for equality
+        std::optional<double> number;
+    };
+
+    using FieldFound = std::function<void( std::string_view key, std::string_view value )>;
+
+    // Empty if the pattern is not a field query
+    static std::optional<FieldQuery> parse( const QString& pattern, bool isCaseSensitive );
+
+    // Calls fieldFound for each field of the line, views are valid during the call.
+    // Escapes in JSON and quoted logfmt strings are decoded.
+    static void forEachField( std::string_view line, const FieldFound& fieldFound );
+
+    // Word of the line at the column starting from 1, empty if the line has fewer words
+    static std::optional<std::string_view> column( std::string_view line, size_t number );
+
+    // Value as a finite number, empty if it is not one
+    static std::optional<double> number( std::string_view value );
+
+    const klogg::vector<Predicate>& predicates() const;
+    bool isCaseSensitive() const;
+
+    // Whether the field value satisfies the predicate
+    bool isMatchingValue( const Predicate& predicate, std::string_view value ) const;
+
+    bool matches( std::string_view line ) const;
+
+  private:
+    klogg::vector<Predicate> predicates_;
+    bool isCaseSensitive_ = true;
+    bool hasNamedFields_ = false;
+};
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_HS_DATABASE_CACHE
+#define KLOGG_HS_DATABASE_CACHE
+
+#ifdef KLOGG_HAS_HS
+
+#include <functional>
+#include <list>
+#include <utility>
+
+#include <QByteArray>
+#include <QString>
+
+#include <hs.h>
+
+#include "resourcewrapper.h"
+#include "synchronization.h"
+
+using HsDatabase = SharedResource<hs_database_t>;
+
+// Process-wide cache of compiled Hyperscan databases. Recently used databases
+// are kept in memory, they can also be saved to disk to be used after restart.
+// This class is thread-safe.
+class HsDatabaseCache {
+  public:
+    using Compile = std::function<hs_database_t*( QString& errorMessage )>;
+
+    static HsDatabaseCache& instance();
+
+    // Database of the key, it is compiled if it is not cached.
+    // Key must have all that changes the database, e.g. patterns and flags.
+    HsDatabase get( const QByteArray& key, const Compile& compile, QString& errorMessage );
+
+    // Bytes of databases kept in memory
+    size_t allocatedSize() const;
+
+  private:
+    HsDatabaseCache() = default;
+
+    void insert( const QByteArray& key, HsDatabase database );
+
+    static HsDatabase load( const QByteArray& key );
+    static void save( const QByteArray& key, const hs_database_t* database );
+
+  private:
+    mutable Mutex mutex_;
+
+    // Most recently used first
+    std::list<std::pair<QByteArray, HsDatabase>> entries_;
+    size_t entriesSize_ = 0;
+};
+
+#endif
+
+#endif
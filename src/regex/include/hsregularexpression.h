@@ -22,7 +22,9 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <functional>
 #include <iterator>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <variant>
@@ -39,9 +41,27 @@
 #include "resourcewrapper.h"
 #endif
 
+#include "pcre2regularexpression.h"
+#include "plaintextmatcher.h"
 #include "regularexpressionpattern.h"
 
-using MatchedPatterns = std::string;
+// Non-zero for each matched pattern, a view of the matcher's buffer valid until the next match
+using MatchedPatterns = std::string_view;
+
+// Reads a line in parts one after another, each part is passed to the function
+// until it returns false. Returns false if the line can't be read in parts.
+using LinePartsReader = std::function<bool( const std::function<bool( std::string_view )>& )>;
+
+// Whether lines are consecutive parts of one buffer separated by line feeds
+inline bool areConsecutiveLines( const klogg::vector<std::string_view>& lines )
+{
+    for ( size_t index = 1; index < lines.size(); ++index ) {
+        if ( lines[ index ].data() != lines[ index - 1 ].data() + lines[ index - 1 ].size() + 1 ) {
+            return false;
+        }
+    }
+    return true;
+}
 
 class DefaultRegularExpressionMatcher {
   public:
@@ -51,30 +71,58 @@ class DefaultRegularExpressionMatcher {
         std::transform(
             patterns.cbegin(), patterns.cend(), std::back_inserter( regexp_ ),
             []( const auto& pattern ) { return static_cast<QRegularExpression>( pattern ); } );
+        matchedPatterns_.resize( regexp_.size() );
     }
 
     MatchedPatterns match( const std::string_view& utf8Data ) const
     {
-        MatchedPatterns matchedPatterns( regexp_.size(), 0 );
-        std::transform( regexp_.cbegin(), regexp_.cend(), matchedPatterns.begin(),
-                        [ utf8Data ]( const auto& regexp ) {
-                            return regexp
-                                .match(
-                                    QString::fromUtf8( utf8Data.data(), klogg::isize( utf8Data ) ) )
-                                .hasMatch();
-                            ;
-                        } );
-
-        return matchedPatterns;
+        const auto text = QString::fromUtf8( utf8Data.data(), klogg::isize( utf8Data ) );
+        std::transform(
+            regexp_.cbegin(), regexp_.cend(), matchedPatterns_.begin(),
+            [ &text ]( const auto& regexp ) { return regexp.match( text ).hasMatch(); } );
+
+        return matchedPatterns_;
+    }
+
+    // Match of the first pattern
+    bool hasMatch( std::string_view utf8Data ) const
+    {
+        return !regexp_.empty()
+               && regexp_.front()
+                      .match( QString::fromUtf8( utf8Data.data(), klogg::isize( utf8Data ) ) )
+                      .hasMatch();
+    }
+
+    size_t patternsCount() const
+    {
+        return regexp_.size();
+    }
+
+    // Match one of the patterns, text is decoded once for all of them
+    bool hasMatch( const QString& text, size_t pattern ) const
+    {
+        return regexp_[ pattern ].match( text ).hasMatch();
     }
 
   private:
     klogg::vector<QRegularExpression> regexp_;
+    mutable std::string matchedPatterns_;
 };
 
+#ifdef KLOGG_HAS_PCRE2
+using DefaultMatcherVariant = std::variant<DefaultRegularExpressionMatcher, Pcre2Matcher>;
+#else
+using DefaultMatcherVariant = std::variant<DefaultRegularExpressionMatcher>;
+#endif
+
 #ifdef KLOGG_HAS_HS
 
-using HsScratch = UniqueResource<hs_scratch_t, hs_free_scratch>;
+// Scratch spaces of finished matchers are kept in a pool to be used by the next ones
+void releaseHsScratch( hs_scratch_t* scratch );
+// Bytes of scratch spaces kept in the pool
+size_t pooledHsScratchSize();
+
+using HsScratch = UniqueResource<hs_scratch_t, releaseHsScratch>;
 using HsDatabase = SharedResource<hs_database_t>;
 
 struct HsMatcherContext {
@@ -83,16 +131,14 @@ struct HsMatcherContext {
 
     void reset();
 
-    MatchedPatterns matchingPatterns;
-
-  private:
-    MatchedPatterns matchingPatternsTemplate_;
+    std::string matchingPatterns;
 };
 
 class HsMatcher {
   public:
     HsMatcher() = default;
-    HsMatcher( HsDatabase database, HsScratch scratch, std::size_t numberOfPatterns );
+    HsMatcher( HsDatabase database, HsScratch scratch, std::size_t numberOfPatterns,
+               HsDatabase literalDatabase = {} );
 
     HsMatcher( const HsMatcher& ) = delete;
     HsMatcher& operator=( const HsMatcher& ) = delete;
@@ -100,8 +146,17 @@ class HsMatcher {
     HsMatcher( HsMatcher&& other ) = default;
     HsMatcher& operator=( HsMatcher&& other ) = default;
 
+    // Bytes of the scratch space, the database is shared with the expression
+    size_t scratchSize() const;
+
+  protected:
+    // Marks patterns matched by the database and the literals in the context
+    void scanPatterns( const std::string_view& utf8Data ) const;
+
   protected:
     HsDatabase database_;
+    // Plain text patterns of a set that also has regular expressions
+    HsDatabase literalDatabase_;
     HsScratch scratch_;
 
     mutable HsMatcherContext context_;
@@ -110,26 +165,67 @@ class HsMatcher {
 class HsSingleMatcher : public HsMatcher {
   public:
     HsSingleMatcher() = default;
-    HsSingleMatcher( HsDatabase database, HsScratch scratch );
+    HsSingleMatcher( HsDatabase database, HsScratch scratch, HsDatabase linesDatabase,
+                     RegularExpressionPattern pattern );
 
     MatchedPatterns match( const std::string_view& utf8Data ) const;
+    bool hasMatch( std::string_view utf8Data ) const;
+
+    // Match a line read in parts in the stream mode of Hyperscan, e.g. a line too long
+    // to be read at once. Parts are read until the first match. The pattern is compiled
+    // for streams on first use, nullopt if it can't be or if the line can't be read.
+    std::optional<bool> hasStreamMatch( const LinePartsReader& readParts ) const;
+
+    // Scan consecutive lines of one buffer, separated by line feeds, at once.
+    // Adds indexes of lines with matches, returns false if lines can't be scanned this way.
+    bool matchLines( const klogg::vector<std::string_view>& lines,
+                     klogg::vector<size_t>& matchingLines ) const;
+
+  private:
+    // Pattern compiled with ^ and $ matching at line feeds, if it can't match them
+    HsDatabase linesDatabase_;
+
+    RegularExpressionPattern pattern_;
+    // Null if the pattern can't be compiled for streams
+    mutable std::optional<HsDatabase> streamDatabase_;
 };
 
 class HsMultiMatcher : public HsMatcher {
   public:
     HsMultiMatcher() = default;
-    HsMultiMatcher( HsDatabase database, HsScratch scratch, std::size_t numberOfPatterns );
+    HsMultiMatcher( HsDatabase database, HsScratch scratch, std::size_t numberOfPatterns,
+                    HsDatabase literalDatabase = {} );
 
     MatchedPatterns match( const std::string_view& utf8Data ) const;
+    bool hasMatch( std::string_view utf8Data ) const;
+};
+
+// Patterns that Hyperscan can't compile are matched by the default matcher
+class HsMixedMatcher : public HsMatcher {
+  public:
+    HsMixedMatcher( HsDatabase database, HsScratch scratch, std::size_t numberOfPatterns,
+                    klogg::vector<size_t> defaultPatterns, DefaultMatcherVariant defaultMatcher,
+                    HsDatabase literalDatabase = {} );
+
+    MatchedPatterns match( const std::string_view& utf8Data ) const;
+    bool hasMatch( std::string_view utf8Data ) const;
+
+  private:
+    klogg::vector<size_t> defaultPatterns_;
+    DefaultMatcherVariant defaultMatcher_;
 };
 
 class HsNoopMatcher {
   public:
     MatchedPatterns match( const std::string_view& utf8Data ) const;
+    bool hasMatch( std::string_view utf8Data ) const;
 };
 
-using MatcherVariant
-    = std::variant<DefaultRegularExpressionMatcher, HsNoopMatcher, HsSingleMatcher, HsMultiMatcher>;
+using MatcherVariant = std::variant<DefaultRegularExpressionMatcher, PlainTextMatcher,
+#ifdef KLOGG_HAS_PCRE2
+                                    Pcre2Matcher,
+#endif
+                                    HsNoopMatcher, HsSingleMatcher, HsMultiMatcher, HsMixedMatcher>;
 
 class HsRegularExpression {
   public:
@@ -146,23 +242,46 @@ class HsRegularExpression {
     bool isValid() const;
     QString errorString() const;
 
+    // Bytes of compiled databases and the prototype scratch space
+    size_t allocatedSize() const;
+
     MatcherVariant createMatcher() const;
 
+    // Matcher used when Hyperscan is not: plain text search for case insensitive text,
+    // otherwise PCRE2 on UTF-8 lines if it is available
+    MatcherVariant createDefaultMatcher() const;
+
   private:
     bool isHsValid() const;
 
+    DefaultMatcherVariant createDefaultMatcher( const klogg::vector<size_t>& patterns ) const;
+
   private:
+    // Plain text is compiled as literals, without escaping. Literals of a set with
+    // regular expressions are in the literal database, both are scanned by matchers.
     HsDatabase database_;
+    HsDatabase linesDatabase_;
+    HsDatabase literalDatabase_;
     HsScratch scratch_;
 
     klogg::vector<RegularExpressionPattern> patterns_;
+    // Patterns missing from the database because Hyperscan can't compile them
+    klogg::vector<size_t> defaultPatterns_;
+#ifdef KLOGG_HAS_PCRE2
+    Pcre2RegularExpression pcre2Expression_;
+#endif
 
     bool isValid_ = true;
     QString errorMessage_;
 };
 #else
 
-using MatcherVariant = std::variant<DefaultRegularExpressionMatcher>;
+#ifdef KLOGG_HAS_PCRE2
+using MatcherVariant
+    = std::variant<DefaultRegularExpressionMatcher, PlainTextMatcher, Pcre2Matcher>;
+#else
+using MatcherVariant = std::variant<DefaultRegularExpressionMatcher, PlainTextMatcher>;
+#endif
 
 class HsRegularExpression {
   public:
@@ -175,6 +294,9 @@ class HsRegularExpression {
 
     explicit HsRegularExpression( const klogg::vector<RegularExpressionPattern>& patterns )
         : patterns_( patterns )
+#ifdef KLOGG_HAS_PCRE2
+        , pcre2Expression_( patterns )
+#endif
     {
         for ( const auto& pattern : patterns_ ) {
             const auto& regex = static_cast<QRegularExpression>( pattern );
@@ -196,8 +318,28 @@ class HsRegularExpression {
         return errorString_;
     }
 
+    size_t allocatedSize() const
+    {
+        return 0;
+    }
+
     MatcherVariant createMatcher() const
     {
+        return createDefaultMatcher();
+    }
+
+    // Plain text search for case insensitive text, otherwise PCRE2 on UTF-8 lines
+    // if it is available
+    MatcherVariant createDefaultMatcher() const
+    {
+        if ( patterns_.size() == 1 && PlainTextMatcher::isSupported( patterns_.front() ) ) {
+            return MatcherVariant{ PlainTextMatcher( patterns_.front() ) };
+        }
+#ifdef KLOGG_HAS_PCRE2
+        if ( pcre2Expression_.isValid() ) {
+            return MatcherVariant{ pcre2Expression_.createMatcher() };
+        }
+#endif
         return MatcherVariant{ DefaultRegularExpressionMatcher( patterns_ ) };
     }
 
@@ -206,6 +348,9 @@ class HsRegularExpression {
     QString errorString_;
 
     klogg::vector<RegularExpressionPattern> patterns_;
+#ifdef KLOGG_HAS_PCRE2
+    Pcre2RegularExpression pcre2Expression_;
+#endif
 };
 
 #endif
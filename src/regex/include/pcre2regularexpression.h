@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_PCRE2_REGULAR_EXPRESSION
+#define KLOGG_PCRE2_REGULAR_EXPRESSION
+
+#ifdef KLOGG_HAS_PCRE2
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifndef PCRE2_CODE_UNIT_WIDTH
+#define PCRE2_CODE_UNIT_WIDTH 8
+#endif
+#include <pcre2.h>
+
+#include "containers.h"
+#include "regularexpressionpattern.h"
+#include "resourcewrapper.h"
+
+using MatchedPatterns = std::string_view;
+
+using Pcre2Code = SharedResource<pcre2_code>;
+using Pcre2MatchData = UniqueResource<pcre2_match_data, pcre2_match_data_free>;
+using Pcre2MatchContext = UniqueResource<pcre2_match_context, pcre2_match_context_free>;
+using Pcre2JitStack = UniqueResource<pcre2_jit_stack, pcre2_jit_stack_free>;
+
+// Matches UTF-8 lines as they are, without converting them to QString.
+// Match data and JIT stack are not shared, each thread needs its own matcher.
+class Pcre2Matcher {
+  public:
+    explicit Pcre2Matcher( klogg::vector<Pcre2Code> codes );
+
+    Pcre2Matcher( const Pcre2Matcher& ) = delete;
+    Pcre2Matcher& operator=( const Pcre2Matcher& ) = delete;
+
+    Pcre2Matcher( Pcre2Matcher&& other ) = default;
+    Pcre2Matcher& operator=( Pcre2Matcher&& other ) = default;
+
+    MatchedPatterns match( const std::string_view& utf8Data ) const;
+
+    // Match of the first pattern
+    bool hasMatch( std::string_view utf8Data ) const
+    {
+        return !codes_.empty() && hasMatch( utf8Data, 0 );
+    }
+
+    size_t patternsCount() const
+    {
+        return codes_.size();
+    }
+
+    bool hasMatch( std::string_view utf8Data, size_t pattern ) const;
+
+  private:
+    klogg::vector<Pcre2Code> codes_;
+
+    Pcre2MatchData matchData_;
+    Pcre2JitStack jitStack_;
+    Pcre2MatchContext matchContext_;
+
+    mutable std::string matchedPatterns_;
+};
+
+// Patterns compiled with the same options as QRegularExpression uses for them
+class Pcre2RegularExpression {
+  public:
+    Pcre2RegularExpression() = default;
+    explicit Pcre2RegularExpression( const klogg::vector<RegularExpressionPattern>& patterns );
+
+    // False if some of the patterns can't be compiled
+    bool isValid() const
+    {
+        return isValid_;
+    }
+
+    Pcre2Matcher createMatcher() const
+    {
+        return Pcre2Matcher{ codes_ };
+    }
+
+    // Matcher of some of the patterns, in the given order
+    Pcre2Matcher createMatcher( const klogg::vector<size_t>& patterns ) const
+    {
+        klogg::vector<Pcre2Code> codes;
+        codes.reserve( patterns.size() );
+        for ( const auto pattern : patterns ) {
+            codes.push_back( codes_[ pattern ] );
+        }
+        return Pcre2Matcher{ std::move( codes ) };
+    }
+
+  private:
+    klogg::vector<Pcre2Code> codes_;
+    bool isValid_ = false;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_PLAINTEXTMATCHER_H
+#define KLOGG_PLAINTEXTMATCHER_H
+
+#include <string>
+#include <string_view>
+
+#include <QString>
+
+#include "regularexpressionpattern.h"
+
+// Case insensitive search of plain text in UTF-8 lines, without regular expressions.
+// ASCII text is searched with ASCII case folding, vectorized where possible.
+// Other text, or lines with characters that fold to ASCII letters of the text,
+// are decoded and searched with Unicode case folding.
+class PlainTextMatcher {
+  public:
+    explicit PlainTextMatcher( const RegularExpressionPattern& pattern );
+
+    // Whether the pattern is searched by this matcher rather than a regular expression
+    static bool isSupported( const RegularExpressionPattern& pattern );
+
+    std::string_view match( const std::string_view& utf8Data ) const;
+    bool hasMatch( std::string_view utf8Data ) const;
+
+  private:
+    bool hasAsciiMatch( std::string_view utf8Data ) const;
+    bool hasUnicodeMatch( std::string_view utf8Data ) const;
+
+  private:
+    // Lower case text if it is ASCII
+    std::string asciiText_;
+    QString text_;
+
+    bool isAscii_ = true;
+    // Some non ASCII characters fold to k and s
+    bool hasUnicodeFolds_ = false;
+
+    mutable std::string matchedPatterns_;
+};
+
+#endif
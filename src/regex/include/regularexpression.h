@@ -21,18 +21,30 @@
 #define KLOGG_PATTERN_MATHCHER_H
 
 #include <memory>
+#include <optional>
+#include <string>
 #include <string_view>
 #include <unordered_map>
 
 #include <QString>
 
 #include "containers.h"
+#include "fieldquery.h"
 
 #include "hsregularexpression.h"
 
 
 class PatternMatcher;
 class BooleanExpressionEvaluator;
+class BooleanProgram;
+
+struct RequiredLiteral {
+    // UTF-8 text every matching line contains, empty if not known
+    std::string text;
+    // Matches have a word boundary or the line edge before or after the text
+    bool isWordStart = false;
+    bool isWordEnd = false;
+};
 
 class RegularExpression {
   public:
@@ -43,6 +55,16 @@ class RegularExpression {
     bool isValid() const;
     QString errorString() const;
 
+    RequiredLiteral requiredLiteral() const;
+    // Lines without this literal all match an inverse pattern, empty for other patterns
+    RequiredLiteral excludedLiteral() const;
+
+    // Bytes held by the compiled expression
+    size_t allocatedSize() const;
+
+    // Query of field values if the pattern is one, lines are matched by their fields then
+    std::shared_ptr<const FieldQuery> fieldQuery() const;
+
   private:
     bool isInverse_ = false;
     bool isBooleanCombination_ = false;
@@ -53,7 +75,14 @@ class RegularExpression {
     bool isValid_ = false;
     QString errorString_;
 
+    RequiredLiteral requiredLiteral_;
+
     HsRegularExpression hsExpression_;
+    std::shared_ptr<const FieldQuery> fieldQuery_;
+    // Field query of each sub-pattern of a boolean combination, null for regular expressions
+    klogg::vector<std::shared_ptr<const FieldQuery>> subPatternFields_;
+    // Compiled once and shared by the evaluators of all matchers
+    std::shared_ptr<const BooleanProgram> booleanProgram_;
 
     friend class PatternMatcher;
 };
@@ -65,16 +94,56 @@ class PatternMatcher {
 
     bool hasMatch( std::string_view line ) const;
 
+    bool isInverse() const;
+
+    // Indexes of matching lines, the matcher is chosen once for all of them
+    void findMatchingLines( const klogg::vector<std::string_view>& lines,
+                            klogg::vector<size_t>& matchingLines ) const;
+
+    // Match consecutive lines of one buffer, separated by line feeds, in one scan.
+    // Sets indexes of matching lines, returns false if the pattern can't be used this way.
+    bool matchLines( const klogg::vector<std::string_view>& lines,
+                     klogg::vector<size_t>& matchingLines ) const;
+
+    // Match UTF-16 lines as they are in the file, each ending at its offset in the data
+    // after its line feed. The required literal is encoded in UTF-16 and searched in the
+    // data, so only lines with it are decoded. Sets indexes of matching lines, returns
+    // false if the pattern has no ASCII required literal.
+    bool matchUtf16Lines( std::string_view data, const klogg::vector<qint64>& endOfLines,
+                          bool isBigEndian, klogg::vector<size_t>& matchingLines ) const;
+
+    // Match a UTF-8 line read in parts, e.g. a line too long to be read at once.
+    // Only single patterns matched by Hyperscan can be matched this way,
+    // nullopt if the pattern can't be or if the line can't be read in parts.
+    std::optional<bool> hasMatchInParts( const LinePartsReader& readParts ) const;
+
+    using MatchFunc = bool ( * )( std::string_view line, const MatcherVariant& matcher,
+                                  BooleanExpressionEvaluator* evaluator );
+    using FindLinesFunc = void ( * )( const klogg::vector<std::string_view>& lines,
+                                      const MatcherVariant& matcher,
+                                      BooleanExpressionEvaluator* evaluator,
+                                      klogg::vector<size_t>& matchingLines );
+
   private:
-    using MatchFunc = bool ( * )( std::string_view line, const MatcherVariant& matcher, BooleanExpressionEvaluator* evaluator );
     MatchFunc hasMatchImpl_;
+    FindLinesFunc findMatchingLinesImpl_;
+
+  private:
+    // Lines with the required literal, checked by the matcher unless pattern is the literal
+    bool matchLinesWithLiteral( const klogg::vector<std::string_view>& lines,
+                                klogg::vector<size_t>& matchingLines ) const;
+    // Matching lines become the other lines for inverse patterns
+    void invertMatchingLines( size_t linesCount, klogg::vector<size_t>& matchingLines ) const;
 
   private:
     bool isInverse_ = false;
     bool isBooleanCombination_ = false;
+    bool isPlainText_ = false;
 
     std::string mainPatternId_;
+    std::string requiredLiteral_;
 
+    std::shared_ptr<const FieldQuery> fieldQuery_;
     MatcherVariant matcher_;
     std::unique_ptr<BooleanExpressionEvaluator> evaluator_;
 };
@@ -22,9 +22,11 @@
 
 #include <QRegularExpression>
 #include <QString>
+#include <algorithm>
 #include <cstdint>
 #include <qregularexpression.h>
 #include <string>
+#include <tuple>
 
 #include "uuid.h"
 
@@ -76,11 +78,40 @@ struct RegularExpressionPattern {
         return QRegularExpression( finalPattern, patternOptions );
     }
 
+    // Whether lines matching this pattern are known to be a subset of lines
+    // matching the other one, e.g. it was extended while the user was typing.
+    // Regular expressions are only compared with a word that starts them.
+    bool narrows( const RegularExpressionPattern& other ) const
+    {
+        if ( isExclude || isBoolean || other.pattern.isEmpty() || pattern == other.pattern
+             || std::tie( isCaseSensitive, isExclude, isBoolean, isPlainText )
+                    != std::tie( other.isCaseSensitive, other.isExclude, other.isBoolean,
+                                 other.isPlainText ) ) {
+            return false;
+        }
+
+        if ( isPlainText ) {
+            return pattern.contains( other.pattern, isCaseSensitive ? Qt::CaseSensitive
+                                                                    : Qt::CaseInsensitive );
+        }
+
+        const auto isWord
+            = std::all_of( other.pattern.cbegin(), other.pattern.cend(),
+                           []( QChar c ) { return c.isLetterOrNumber() || c == '_'; } );
+        if ( !isWord || !pattern.startsWith( other.pattern ) ) {
+            return false;
+        }
+
+        // Quantifiers change the word and alternatives may not contain it
+        const auto suffix = pattern.mid( other.pattern.size() );
+        return !suffix.contains( '|' ) && !QString( "*+?{" ).contains( suffix.front() );
+    }
+
     bool operator==( const RegularExpressionPattern& other ) const
     {
         return std::tie( pattern, isCaseSensitive, isExclude, isBoolean, isPlainText )
-               == std::tie( other.pattern, other.isCaseSensitive, isExclude, isBoolean,
-                            isPlainText );
+               == std::tie( other.pattern, other.isCaseSensitive, other.isExclude,
+                            other.isBoolean, other.isPlainText );
     }
 
   private:
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_WORDSMATCHER_H
+#define KLOGG_WORDSMATCHER_H
+
+#include <cstdint>
+#include <utility>
+
+#include <QString>
+#include <QStringList>
+
+#include "containers.h"
+
+// Case sensitive search of several words in a line in one pass, with an
+// Aho-Corasick automaton over UTF-16 code units. Each word is found as a
+// regular expression of the escaped word finds it: occurrences of the same
+// word don't overlap, occurrences of different words can. Built once for a
+// set of words, then used from any thread.
+class WordsMatcher {
+  public:
+    struct Match {
+        // Index of the word in the list the matcher was built from
+        int word;
+        int start;
+        int length;
+    };
+
+    WordsMatcher() = default;
+    // Empty words are never found
+    explicit WordsMatcher( const QStringList& words );
+
+    bool isEmpty() const;
+
+    // Appends the occurrences of the words in the line, sorted by word then by start
+    void match( const QString& line, klogg::vector<Match>& matches ) const;
+
+  private:
+    static constexpr uint32_t NoState = UINT32_MAX;
+
+    struct State {
+        // Sorted by code unit
+        klogg::vector<std::pair<char16_t, uint32_t>> next;
+        uint32_t failure = 0;
+        // Closest state on the failure chain ending words, if any
+        uint32_t output = NoState;
+        klogg::vector<int> words;
+    };
+
+    uint32_t next( uint32_t state, char16_t unit ) const;
+
+  private:
+    klogg::vector<State> states_;
+    klogg::vector<int> lengths_;
+};
+
+#endif
@@ -19,26 +19,37 @@
 
 #include "booleanevaluator.h"
 
+#include <algorithm>
+#include <iterator>
+#include <numeric>
 #include <string>
 
+#include <exprtk.hpp>
+
 #include "log.h"
 
 namespace {
 
-static constexpr size_t MaxPrecomputedPatterns = 4;
-static constexpr size_t PrecomputedCombinations[] = { 0, 2, 4, 8, 16 };
+// Table of all combinations takes 64KiB for 16 patterns
+static constexpr size_t MaxTablePatterns = 16;
+// Combinations of more patterns are kept in a bit mask
+static constexpr size_t MaxCachedPatterns = 64;
+static constexpr size_t MaxCachedResults = 64 * 1024;
 
-bool isBitSet( unsigned num, unsigned bit )
-{
-    return 1 == ( ( num >> bit ) & 1 );
-}
+static constexpr uint8_t NotEvaluated = 0;
+static constexpr uint8_t FalseResult = 1;
+static constexpr uint8_t TrueResult = 2;
+static constexpr uint8_t UndecidedResult = 3;
 
-uint32_t buildPatternCombination( std::string_view variables )
+// Lines with all patterns matched before the order of lazy evaluation is chosen
+static constexpr size_t PlanningLines = 1000;
+
+uint64_t buildPatternCombination( std::string_view variables )
 {
-    uint32_t combination = 0;
+    uint64_t combination = 0;
     for ( auto bit = 0u; bit < variables.size(); ++bit ) {
         if ( variables[ bit ] ) {
-            combination = combination | ( 1u << bit );
+            combination = combination | ( uint64_t{ 1 } << bit );
         }
     }
 
@@ -47,57 +58,287 @@ uint32_t buildPatternCombination( std::string_view variables )
 
 } // namespace
 
-BooleanExpressionEvaluator::BooleanExpressionEvaluator(
-    const std::string& expression, const klogg::vector<RegularExpressionPattern>& patterns )
-{
-    variables_.reserve( patterns.size() );
+// Expression evaluated by exprtk with a variable for each pattern, only one thread
+// can evaluate it since the variables are set before evaluating it
+class ExprtkBooleanExpression {
+  public:
+    ExprtkBooleanExpression( const std::string& expression,
+                             const klogg::vector<std::string>& variableNames )
+    {
+        variables_.reserve( variableNames.size() );
+        for ( const auto& name : variableNames ) {
+            if ( symbols_.create_variable( name ) ) {
+                variableNames_.push_back( name );
+                variables_.push_back( &symbols_.get_variable( name )->ref() );
+            }
+        }
 
-    for ( const auto& p : patterns ) {
-        if ( symbols_.create_variable( p.id() ) ) {
-            variables_.push_back( &symbols_.get_variable( p.id() )->ref() );
+        expression_.register_symbol_table( symbols_ );
+
+        exprtk::parser<double> parser;
+        isValid_ = parser.compile( expression, expression_ );
+        if ( !isValid_ && parser.error_count() > 0 ) {
+            auto error = parser.get_error( 0 );
+            exprtk::parser_error::update_error( error, expression );
+            errorString_ = error.diagnostic + " at " + std::to_string( error.column_no );
         }
     }
 
-    expression_.register_symbol_table( symbols_ );
-    isValid_ = parser_.compile( expression, expression_ );
-    if ( !isValid_ && parser_.error_count() > 0 ) {
-        auto error = parser_.get_error( 0 );
-        exprtk::parser_error::update_error( error, expression );
-        errorString_ = error.diagnostic + " at " + std::to_string( error.column_no );
+    bool isValid() const
+    {
+        return isValid_;
     }
-    else if ( patterns.size() <= MaxPrecomputedPatterns ) {
-        const auto patternVariants = PrecomputedCombinations[ patterns.size() ];
-        for ( auto patternCombination = 0u; patternCombination < patternVariants;
-              ++patternCombination ) {
-            for ( auto p = 0u; p < patterns.size(); ++p ) {
-                *variables_[ p ] = isBitSet( patternCombination, p );
-            }
-            precomputedResults_[ patternCombination ] = expression_.value();
-            LOG_INFO << "precomputed result for " << patternCombination << " is "
-                     << ( precomputedResults_[ patternCombination ] > 0 );
+
+    const std::string& errorString() const
+    {
+        return errorString_;
+    }
+
+    // Names of the variables that could be created
+    const klogg::vector<std::string>& variableNames() const
+    {
+        return variableNames_;
+    }
+
+    bool value( uint64_t combination )
+    {
+        for ( auto index = 0u; index < variables_.size(); ++index ) {
+            *variables_[ index ] = ( combination >> index ) & 1;
+        }
+        return expression_.value() > 0;
+    }
+
+    bool value( std::string_view variables )
+    {
+        for ( auto index = 0u; index < variables_.size(); ++index ) {
+            *variables_[ index ] = variables[ index ];
         }
+        return expression_.value() > 0;
+    }
+
+  private:
+    exprtk::symbol_table<double> symbols_;
+    exprtk::expression<double> expression_;
+    klogg::vector<std::string> variableNames_;
+    klogg::vector<double*> variables_;
+
+    bool isValid_ = true;
+    std::string errorString_;
+};
+
+BooleanProgram::BooleanProgram( const std::string& expression,
+                                const klogg::vector<RegularExpressionPattern>& patterns )
+    : expression_( expression )
+{
+    klogg::vector<std::string> names;
+    names.reserve( patterns.size() );
+    std::transform( patterns.cbegin(), patterns.cend(), std::back_inserter( names ),
+                    []( const auto& pattern ) { return pattern.id(); } );
+
+    ExprtkBooleanExpression compiledExpression( expression, names );
+    variableNames_ = compiledExpression.variableNames();
+    isValid_ = compiledExpression.isValid();
+    errorString_ = compiledExpression.errorString();
+    if ( !isValid_ || variableNames_.size() > MaxTablePatterns ) {
+        return;
+    }
+
+    resultsTable_.resize( size_t{ 1 } << variableNames_.size() );
+    for ( auto combination = 0u; combination < resultsTable_.size(); ++combination ) {
+        resultsTable_[ combination ] = compiledExpression.value( uint64_t{ combination } );
+    }
+}
+
+BooleanExpressionEvaluator::BooleanExpressionEvaluator(
+    std::shared_ptr<const BooleanProgram> program, const FieldQueries& fieldQueries )
+    : program_( std::move( program ) )
+    , fieldQueries_( fieldQueries )
+{
+    for ( auto pattern = 0u; pattern < fieldQueries_.size(); ++pattern ) {
+        if ( fieldQueries_[ pattern ] ) {
+            fieldPatterns_.push_back( pattern );
+        }
+    }
+
+    if ( program_->isValid() && !program_->isTabulated() ) {
+        expression_ = std::make_unique<ExprtkBooleanExpression>( program_->expression_,
+                                                                 program_->variableNames_ );
     }
 }
 
+BooleanExpressionEvaluator::~BooleanExpressionEvaluator() = default;
+
 bool BooleanExpressionEvaluator::evaluate( std::string_view variables )
 {
     if ( !isValid() ) {
         return false;
     }
 
-    if ( variables_.size() != variables.size() ) {
+    if ( program_->patternsCount() != variables.size() ) {
         LOG_ERROR << "Wrong number of matched patterns";
         return false;
     }
 
-    if ( variables.size() <= MaxPrecomputedPatterns ) {
+    if ( program_->isTabulated() ) {
+        return program_->result( buildPatternCombination( variables ) );
+    }
+
+    if ( variables.size() <= MaxCachedPatterns ) {
         const auto patternCombination = buildPatternCombination( variables );
-        return precomputedResults_[ patternCombination ] > 0;
+        const auto cachedResult = resultsCache_.find( patternCombination );
+        if ( cachedResult != resultsCache_.end() ) {
+            return cachedResult->second;
+        }
+
+        const auto result = evaluateExpression( variables );
+        if ( resultsCache_.size() < MaxCachedResults ) {
+            resultsCache_.emplace( patternCombination, result );
+        }
+        return result;
+    }
+
+    return evaluateExpression( variables );
+}
+
+std::string_view BooleanExpressionEvaluator::withFieldMatches( std::string_view line,
+                                                              std::string_view variables )
+{
+    if ( fieldPatterns_.empty() ) {
+        return variables;
+    }
+
+    fieldVariables_.assign( variables.begin(), variables.end() );
+    for ( const auto pattern : fieldPatterns_ ) {
+        if ( pattern < fieldVariables_.size() ) {
+            fieldVariables_[ pattern ] = fieldQueries_[ pattern ]->matches( line );
+        }
+    }
+    return fieldVariables_;
+}
+
+bool BooleanExpressionEvaluator::evaluateLazily( size_t patternsCount,
+                                                 const std::function<bool( size_t )>& isMatched )
+{
+    if ( !isValid() ) {
+        return false;
+    }
+
+    if ( program_->patternsCount() != patternsCount ) {
+        LOG_ERROR << "Wrong number of matched patterns";
+        return false;
     }
 
-    for ( auto index = 0u; index < variables_.size(); ++index ) {
-        *variables_[ index ] = variables[ index ];
+    if ( !program_->isTabulated() || sampledLines_ < PlanningLines ) {
+        std::string variables( patternsCount, 0 );
+        for ( auto pattern = 0u; pattern < patternsCount; ++pattern ) {
+            variables[ pattern ] = isMatched( pattern );
+        }
+
+        if ( program_->isTabulated() ) {
+            sampledCombinations_[ static_cast<uint32_t>( buildPatternCombination( variables ) ) ]++;
+            if ( ++sampledLines_ == PlanningLines ) {
+                planEvaluationOrder();
+            }
+        }
+
+        return evaluate( variables );
+    }
+
+    uint32_t knownPatterns = 0;
+    uint32_t combination = 0;
+    for ( const auto pattern : evaluationOrder_ ) {
+        const auto patternBit = uint32_t{ 1 } << pattern;
+        knownPatterns |= patternBit;
+        if ( isMatched( pattern ) ) {
+            combination |= patternBit;
+        }
+
+        const auto result = partialResult( knownPatterns, combination );
+        if ( result != UndecidedResult ) {
+            return result == TrueResult;
+        }
     }
 
-    return expression_.value() > 0;
+    return program_->result( combination );
+}
+
+uint8_t BooleanExpressionEvaluator::partialResult( uint32_t knownPatterns, uint32_t combination )
+{
+    const auto key = ( knownPatterns << MaxTablePatterns ) | combination;
+    auto& result = partialResults_[ key ];
+    if ( result != NotEvaluated ) {
+        return result;
+    }
+
+    // Check all combinations of the unknown patterns
+    const auto allPatterns
+        = static_cast<uint32_t>( ( uint64_t{ 1 } << program_->patternsCount() ) - 1 );
+    const auto unknownPatterns = allPatterns & ~knownPatterns;
+    const auto firstResult = program_->result( combination );
+    result = firstResult ? TrueResult : FalseResult;
+    for ( auto unknown = unknownPatterns; unknown != 0;
+          unknown = ( unknown - 1 ) & unknownPatterns ) {
+        if ( program_->result( combination | unknown ) != firstResult ) {
+            result = UndecidedResult;
+            break;
+        }
+    }
+
+    return result;
+}
+
+void BooleanExpressionEvaluator::planEvaluationOrder()
+{
+    // Greedily pick the pattern that decides the result for most of the sampled lines
+    // that are still undecided by the patterns picked before it
+    klogg::vector<size_t> remainingPatterns( program_->patternsCount() );
+    std::iota( remainingPatterns.begin(), remainingPatterns.end(), 0 );
+
+    evaluationOrder_.clear();
+    uint32_t knownPatterns = 0;
+    klogg::vector<std::pair<uint32_t, uint32_t>> undecided( sampledCombinations_.begin(),
+                                                            sampledCombinations_.end() );
+    while ( !remainingPatterns.empty() ) {
+        auto bestPattern = remainingPatterns.begin();
+        uint32_t bestDecided = 0;
+        for ( auto pattern = remainingPatterns.begin(); pattern != remainingPatterns.end();
+              ++pattern ) {
+            const auto known = knownPatterns | ( uint32_t{ 1 } << *pattern );
+            uint32_t decided = 0;
+            for ( const auto& [ combination, lines ] : undecided ) {
+                if ( partialResult( known, combination & known ) != UndecidedResult ) {
+                    decided += lines;
+                }
+            }
+            if ( decided > bestDecided ) {
+                bestPattern = pattern;
+                bestDecided = decided;
+            }
+        }
+
+        knownPatterns |= uint32_t{ 1 } << *bestPattern;
+        evaluationOrder_.push_back( *bestPattern );
+        remainingPatterns.erase( bestPattern );
+
+        undecided.erase( std::remove_if( undecided.begin(), undecided.end(),
+                                         [ this, knownPatterns ]( const auto& sample ) {
+                                             return partialResult( knownPatterns,
+                                                                   sample.first & knownPatterns )
+                                                    != UndecidedResult;
+                                         } ),
+                         undecided.end() );
+    }
+
+    sampledCombinations_.clear();
+
+    std::string order;
+    for ( const auto pattern : evaluationOrder_ ) {
+        order += " " + std::to_string( pattern );
+    }
+    LOG_INFO << "Boolean expression patterns are matched in order" << order;
+}
+
+bool BooleanExpressionEvaluator::evaluateExpression( std::string_view variables )
+{
+    return expression_->value( variables );
 }
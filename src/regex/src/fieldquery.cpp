@@ -0,0 +1,536 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fieldquery.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include <QByteArray>
+
+namespace {
+constexpr auto Spaces = std::string_view( " \t\r" );
+constexpr size_t MaxPredicates = 64;
+
+char toLower( char c )
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>( c - 'A' + 'a' ) : c;
+}
+
+// Numbers are written the same way in any locale
+std::optional<double> toNumber( std::string_view text )
+{
+    if ( text.empty() || Spaces.find( text.front() ) != std::string_view::npos ) {
+        return {};
+    }
+
+    auto isNumber = false;
+    const auto data = QByteArray::fromRawData( text.data(), static_cast<int>( text.size() ) );
+    const auto number = data.toDouble( &isNumber );
+    if ( !isNumber || !std::isfinite( number ) ) {
+        return {};
+    }
+    return number;
+}
+
+int compareText( std::string_view lhs, std::string_view rhs, bool isCaseSensitive )
+{
+    if ( isCaseSensitive ) {
+        return lhs.compare( rhs );
+    }
+
+    const auto size = std::min( lhs.size(), rhs.size() );
+    for ( size_t index = 0; index < size; ++index ) {
+        const auto left = static_cast<uint8_t>( toLower( lhs[ index ] ) );
+        const auto right = static_cast<uint8_t>( toLower( rhs[ index ] ) );
+        if ( left != right ) {
+            return left < right ? -1 : 1;
+        }
+    }
+    return lhs.size() == rhs.size() ? 0 : ( lhs.size() < rhs.size() ? -1 : 1 );
+}
+
+// Operator at the position, empty if there is none
+std::optional<std::pair<FieldQuery::Operator, size_t>> readOperator( std::string_view text,
+                                                                     size_t position )
+{
+    using Operator = FieldQuery::Operator;
+    const auto next = position + 1 < text.size() ? text[ position + 1 ] : '\0';
+    switch ( text[ position ] ) {
+    case '=':
+        return std::make_pair( Operator::Equal, size_t{ 1 } );
+    case '!':
+        if ( next == '=' ) {
+            return std::make_pair( Operator::NotEqual, size_t{ 2 } );
+        }
+        return {};
+    case '<':
+        return next == '=' ? std::make_pair( Operator::LessOrEqual, size_t{ 2 } )
+                           : std::make_pair( Operator::Less, size_t{ 1 } );
+    case '>':
+        return next == '=' ? std::make_pair( Operator::GreaterOrEqual, size_t{ 2 } )
+                           : std::make_pair( Operator::Greater, size_t{ 1 } );
+    default:
+        return {};
+    }
+}
+
+// Column number of keys $1, $2..., 0 for other keys
+size_t columnNumber( std::string_view key )
+{
+    if ( key.size() < 2 || key.size() > 6 || key.front() != '$' ) {
+        return 0;
+    }
+
+    size_t number = 0;
+    for ( const auto c : key.substr( 1 ) ) {
+        if ( c < '0' || c > '9' ) {
+            return 0;
+        }
+        number = number * 10 + static_cast<size_t>( c - '0' );
+    }
+    return number;
+}
+
+size_t skipSpaces( std::string_view text, size_t position )
+{
+    const auto next = text.find_first_not_of( Spaces, position );
+    return next == std::string_view::npos ? text.size() : next;
+}
+
+size_t findAny( std::string_view text, std::string_view chars, size_t position )
+{
+    const auto next = text.find_first_of( chars, position );
+    return next == std::string_view::npos ? text.size() : next;
+}
+
+std::optional<uint32_t> readHex( std::string_view text, size_t position )
+{
+    if ( position + 4 > text.size() ) {
+        return {};
+    }
+
+    uint32_t code = 0;
+    for ( const auto c : text.substr( position, 4 ) ) {
+        code <<= 4;
+        if ( c >= '0' && c <= '9' ) {
+            code |= static_cast<uint32_t>( c - '0' );
+        }
+        else if ( c >= 'a' && c <= 'f' ) {
+            code |= static_cast<uint32_t>( c - 'a' + 10 );
+        }
+        else if ( c >= 'A' && c <= 'F' ) {
+            code |= static_cast<uint32_t>( c - 'A' + 10 );
+        }
+        else {
+            return {};
+        }
+    }
+    return code;
+}
+
+void appendUtf8( std::string& text, uint32_t code )
+{
+    if ( code < 0x80 ) {
+        text.push_back( static_cast<char>( code ) );
+    }
+    else if ( code < 0x800 ) {
+        text.push_back( static_cast<char>( 0xc0 | ( code >> 6 ) ) );
+        text.push_back( static_cast<char>( 0x80 | ( code & 0x3f ) ) );
+    }
+    else if ( code < 0x10000 ) {
+        text.push_back( static_cast<char>( 0xe0 | ( code >> 12 ) ) );
+        text.push_back( static_cast<char>( 0x80 | ( ( code >> 6 ) & 0x3f ) ) );
+        text.push_back( static_cast<char>( 0x80 | ( code & 0x3f ) ) );
+    }
+    else {
+        text.push_back( static_cast<char>( 0xf0 | ( code >> 18 ) ) );
+        text.push_back( static_cast<char>( 0x80 | ( ( code >> 12 ) & 0x3f ) ) );
+        text.push_back( static_cast<char>( 0x80 | ( ( code >> 6 ) & 0x3f ) ) );
+        text.push_back( static_cast<char>( 0x80 | ( code & 0x3f ) ) );
+    }
+}
+
+// Text of the string starting at the quote and the position after its closing quote.
+// Strings with escapes are decoded in the buffer. Empty if the string is not closed.
+std::optional<std::pair<std::string_view, size_t>> readString( std::string_view text,
+                                                               size_t quote, std::string& buffer )
+{
+    auto position = quote + 1;
+    const auto end = text.find_first_of( "\"\\", position );
+    if ( end == std::string_view::npos ) {
+        return {};
+    }
+    if ( text[ end ] == '"' ) {
+        return std::make_pair( text.substr( position, end - position ), end + 1 );
+    }
+
+    buffer.assign( text.substr( position, end - position ) );
+    position = end;
+    while ( position < text.size() ) {
+        const auto c = text[ position ];
+        if ( c == '"' ) {
+            return std::make_pair( std::string_view( buffer ), position + 1 );
+        }
+        if ( c != '\\' ) {
+            buffer.push_back( c );
+            ++position;
+            continue;
+        }
+        if ( position + 1 >= text.size() ) {
+            return {};
+        }
+
+        const auto escaped = text[ position + 1 ];
+        position += 2;
+        switch ( escaped ) {
+        case 'n':
+            buffer.push_back( '\n' );
+            break;
+        case 't':
+            buffer.push_back( '\t' );
+            break;
+        case 'r':
+            buffer.push_back( '\r' );
+            break;
+        case 'b':
+            buffer.push_back( '\b' );
+            break;
+        case 'f':
+            buffer.push_back( '\f' );
+            break;
+        case 'u': {
+            auto code = readHex( text, position );
+            if ( !code ) {
+                return {};
+            }
+            position += 4;
+
+            // Characters out of the BMP are escaped as surrogate pairs
+            if ( *code >= 0xd800 && *code < 0xdc00 && text.substr( position, 2 ) == "\\u" ) {
+                const auto low = readHex( text, position + 2 );
+                if ( low && *low >= 0xdc00 && *low < 0xe000 ) {
+                    code = 0x10000 + ( ( *code - 0xd800 ) << 10 ) + ( *low - 0xdc00 );
+                    position += 6;
+                }
+            }
+            appendUtf8( buffer, *code );
+            break;
+        }
+        default:
+            buffer.push_back( escaped );
+        }
+    }
+    return {};
+}
+
+// Position after the JSON object or array starting at the position, npos if it is not closed
+size_t skipNested( std::string_view line, size_t position )
+{
+    auto depth = 0;
+    while ( position < line.size() ) {
+        const auto c = line[ position ];
+        if ( c == '"' ) {
+            ++position;
+            while ( position < line.size() && line[ position ] != '"' ) {
+                position += line[ position ] == '\\' ? 2 : 1;
+            }
+            if ( position >= line.size() ) {
+                return std::string_view::npos;
+            }
+        }
+        else if ( c == '{' || c == '[' ) {
+            ++depth;
+        }
+        else if ( c == '}' || c == ']' ) {
+            if ( --depth == 0 ) {
+                return position + 1;
+            }
+        }
+        ++position;
+    }
+    return std::string_view::npos;
+}
+
+// Fields found before a syntax error are kept
+void parseJson( std::string_view line, size_t position, const FieldQuery::FieldFound& fieldFound )
+{
+    std::string keyBuffer;
+    std::string valueBuffer;
+
+    position = skipSpaces( line, position + 1 );
+    while ( position < line.size() && line[ position ] == '"' ) {
+        const auto key = readString( line, position, keyBuffer );
+        if ( !key ) {
+            return;
+        }
+
+        position = skipSpaces( line, key->second );
+        if ( position >= line.size() || line[ position ] != ':' ) {
+            return;
+        }
+        position = skipSpaces( line, position + 1 );
+        if ( position >= line.size() ) {
+            return;
+        }
+
+        const auto c = line[ position ];
+        if ( c == '"' ) {
+            const auto value = readString( line, position, valueBuffer );
+            if ( !value ) {
+                return;
+            }
+            fieldFound( key->first, value->first );
+            position = value->second;
+        }
+        else if ( c == '{' || c == '[' ) {
+            position = skipNested( line, position );
+            if ( position == std::string_view::npos ) {
+                return;
+            }
+        }
+        else {
+            const auto valueEnd = findAny( line, ",} \t\r", position );
+            fieldFound( key->first, line.substr( position, valueEnd - position ) );
+            position = valueEnd;
+        }
+
+        position = skipSpaces( line, position );
+        if ( position >= line.size() || line[ position ] != ',' ) {
+            return;
+        }
+        position = skipSpaces( line, position + 1 );
+    }
+}
+
+// Words without '=' are not fields, e.g. the text of a message around them
+void parseLogfmt( std::string_view line, const FieldQuery::FieldFound& fieldFound )
+{
+    std::string valueBuffer;
+
+    auto position = skipSpaces( line, 0 );
+    while ( position < line.size() ) {
+        const auto keyEnd = findAny( line, " \t\r=\"", position );
+        const auto key = line.substr( position, keyEnd - position );
+        position = keyEnd;
+
+        if ( key.empty() || position >= line.size() || line[ position ] != '=' ) {
+            if ( position < line.size() && line[ position ] == '"' ) {
+                const auto text = readString( line, position, valueBuffer );
+                if ( !text ) {
+                    return;
+                }
+                position = text->second;
+            }
+            else if ( position < line.size() && line[ position ] == '=' ) {
+                position = findAny( line, Spaces, position );
+            }
+            position = skipSpaces( line, position );
+            continue;
+        }
+
+        ++position;
+        if ( position < line.size() && line[ position ] == '"' ) {
+            const auto value = readString( line, position, valueBuffer );
+            if ( !value ) {
+                return;
+            }
+            fieldFound( key, value->first );
+            position = value->second;
+        }
+        else {
+            const auto valueEnd = findAny( line, Spaces, position );
+            fieldFound( key, line.substr( position, valueEnd - position ) );
+            position = valueEnd;
+        }
+        position = skipSpaces( line, position );
+    }
+}
+} // namespace
+
+std::optional<FieldQuery> FieldQuery::parse( const QString& pattern, bool isCaseSensitive )
+{
+    const auto patternText = pattern.toStdString();
+    const auto text = std::string_view( patternText );
+
+    FieldQuery query;
+    query.isCaseSensitive_ = isCaseSensitive;
+
+    std::string buffer;
+    auto position = skipSpaces( text, 0 );
+    while ( position < text.size() ) {
+        if ( text[ position ] != '@' ) {
+            return {};
+        }
+
+        const auto keyEnd = findAny( text, " \t\r=\"!<>", position + 1 );
+        if ( keyEnd == position + 1 || keyEnd >= text.size() ) {
+            return {};
+        }
+        const auto op = readOperator( text, keyEnd );
+        if ( !op ) {
+            return {};
+        }
+
+        Predicate predicate;
+        predicate.key = std::string( text.substr( position + 1, keyEnd - position - 1 ) );
+        predicate.op = op->first;
+        predicate.column = columnNumber( predicate.key );
+        position = keyEnd + op->second;
+
+        if ( position < text.size() && text[ position ] == '"' ) {
+            const auto value = readString( text, position, buffer );
+            if ( !value ) {
+                return {};
+            }
+            predicate.value = std::string( value->first );
+            position = value->second;
+        }
+        else {
+            const auto valueEnd = findAny( text, Spaces, position );
+            predicate.value = std::string( text.substr( position, valueEnd - position ) );
+            position = valueEnd;
+        }
+
+        if ( position < text.size() && Spaces.find( text[ position ] ) == std::string_view::npos ) {
+            return {};
+        }
+
+        predicate.number = toNumber( predicate.value );
+        query.hasNamedFields_ = query.hasNamedFields_ || predicate.column == 0;
+        query.predicates_.push_back( std::move( predicate ) );
+        if ( query.predicates_.size() > MaxPredicates ) {
+            return {};
+        }
+        position = skipSpaces( text, position );
+    }
+
+    if ( query.predicates_.empty() ) {
+        return {};
+    }
+    return query;
+}
+
+std::optional<double> FieldQuery::number( std::string_view value )
+{
+    return toNumber( value );
+}
+
+void FieldQuery::forEachField( std::string_view line, const FieldFound& fieldFound )
+{
+    const auto start = skipSpaces( line, 0 );
+    if ( start < line.size() && line[ start ] == '{' ) {
+        parseJson( line, start, fieldFound );
+    }
+    else {
+        parseLogfmt( line, fieldFound );
+    }
+}
+
+const klogg::vector<FieldQuery::Predicate>& FieldQuery::predicates() const
+{
+    return predicates_;
+}
+
+bool FieldQuery::isCaseSensitive() const
+{
+    return isCaseSensitive_;
+}
+
+std::optional<std::string_view> FieldQuery::column( std::string_view line, size_t number )
+{
+    auto position = skipSpaces( line, 0 );
+    for ( size_t index = 1; position < line.size(); ++index ) {
+        const auto wordEnd = findAny( line, Spaces, position );
+        if ( index == number ) {
+            return line.substr( position, wordEnd - position );
+        }
+        position = skipSpaces( line, wordEnd );
+    }
+    return {};
+}
+
+bool FieldQuery::isMatchingValue( const Predicate& predicate, std::string_view value ) const
+{
+    if ( predicate.op == Operator::Equal || predicate.op == Operator::NotEqual ) {
+        const auto isEqual
+            = predicate.value.size() == value.size()
+              && compareText( predicate.value, value, isCaseSensitive_ ) == 0;
+        return isEqual == ( predicate.op == Operator::Equal );
+    }
+
+    int order = 0;
+    if ( predicate.number ) {
+        const auto number = toNumber( value );
+        if ( !number ) {
+            return false;
+        }
+        order = *number < *predicate.number ? -1 : ( *number > *predicate.number ? 1 : 0 );
+    }
+    else {
+        order = compareText( value, predicate.value, isCaseSensitive_ );
+    }
+
+    switch ( predicate.op ) {
+    case Operator::Less:
+        return order < 0;
+    case Operator::LessOrEqual:
+        return order <= 0;
+    case Operator::Greater:
+        return order > 0;
+    case Operator::GreaterOrEqual:
+        return order >= 0;
+    default:
+        return false;
+    }
+}
+
+bool FieldQuery::matches( std::string_view line ) const
+{
+    const auto allMatched = predicates_.size() == MaxPredicates
+                                ? ~uint64_t{ 0 }
+                                : ( uint64_t{ 1 } << predicates_.size() ) - 1;
+
+    uint64_t matched = 0;
+    for ( size_t index = 0; index < predicates_.size(); ++index ) {
+        const auto& predicate = predicates_[ index ];
+        if ( predicate.column == 0 ) {
+            continue;
+        }
+        const auto value = column( line, predicate.column );
+        if ( value && isMatchingValue( predicate, *value ) ) {
+            matched |= uint64_t{ 1 } << index;
+        }
+    }
+
+    if ( hasNamedFields_ ) {
+        forEachField( line, [ this, &matched ]( std::string_view key, std::string_view value ) {
+            for ( size_t index = 0; index < predicates_.size(); ++index ) {
+                const auto& predicate = predicates_[ index ];
+                if ( predicate.column == 0 && predicate.key == key
+                     && isMatchingValue( predicate, value ) ) {
+                    matched |= uint64_t{ 1 } << index;
+                }
+            }
+        } );
+    }
+    return matched == allMatched;
+}
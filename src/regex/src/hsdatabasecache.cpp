@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "hsdatabasecache.h"
+
+#ifdef KLOGG_HAS_HS
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "configuration.h"
+#include "log.h"
+
+namespace {
+constexpr size_t MaxCachedDatabases = 32;
+constexpr size_t MaxCachedSize = 64 * 1024 * 1024;
+constexpr int MaxCacheFiles = 64;
+
+QString cacheDirectory()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + "/patterns";
+}
+
+// Databases are compiled for the features of the host CPU
+QByteArray platformKey()
+{
+    hs_platform_info_t platform{};
+    if ( hs_populate_platform( &platform ) != HS_SUCCESS ) {
+        return {};
+    }
+
+    return QByteArray::number( platform.tune ) + ':'
+           + QByteArray::number( static_cast<qulonglong>( platform.cpu_features ) );
+}
+
+QString cacheFileName( const QByteArray& key )
+{
+    static const auto platform = platformKey();
+
+    // Databases built by other versions of Hyperscan or for other CPUs can't be used
+    QCryptographicHash digest( QCryptographicHash::Sha1 );
+    digest.addData( key );
+    digest.addData( hs_version() );
+    digest.addData( platform );
+    return cacheDirectory() + "/" + QString::fromLatin1( digest.result().toHex() ) + ".hsdb";
+}
+
+size_t databaseSize( const hs_database_t* database )
+{
+    size_t size = 0;
+    return hs_database_size( database, &size ) == HS_SUCCESS ? size : 0;
+}
+
+void removeOldFiles()
+{
+    QDir cacheDir( cacheDirectory() );
+    const auto entries
+        = cacheDir.entryInfoList( { "*.hsdb" }, QDir::Files, QDir::Time | QDir::Reversed );
+
+    for ( auto i = 0; i < entries.size() - MaxCacheFiles; ++i ) {
+        QFile::remove( entries[ i ].absoluteFilePath() );
+    }
+}
+} // namespace
+
+HsDatabaseCache& HsDatabaseCache::instance()
+{
+    static HsDatabaseCache cache;
+    return cache;
+}
+
+HsDatabase HsDatabaseCache::get( const QByteArray& key, const Compile& compile,
+                                 QString& errorMessage )
+{
+    {
+        ScopedLock lock( mutex_ );
+        const auto entry
+            = std::find_if( entries_.begin(), entries_.end(),
+                            [ &key ]( const auto& cached ) { return cached.first == key; } );
+        if ( entry != entries_.end() ) {
+            entries_.splice( entries_.begin(), entries_, entry );
+            return entry->second;
+        }
+    }
+
+    const auto keepOnDisk = Configuration::get().keepCompiledPatternsOnDisk();
+    auto database = keepOnDisk ? load( key ) : HsDatabase{};
+    if ( !database ) {
+        database = HsDatabase{ makeUniqueResource<hs_database_t, hs_free_database>(
+            compile, errorMessage ) };
+        if ( !database ) {
+            return {};
+        }
+
+        if ( keepOnDisk ) {
+            save( key, database.get() );
+        }
+    }
+
+    insert( key, database );
+    return database;
+}
+
+size_t HsDatabaseCache::allocatedSize() const
+{
+    SharedLock lock( mutex_ );
+    return entriesSize_;
+}
+
+void HsDatabaseCache::insert( const QByteArray& key, HsDatabase database )
+{
+    ScopedLock lock( mutex_ );
+
+    entriesSize_ += databaseSize( database.get() );
+    entries_.emplace_front( key, std::move( database ) );
+
+    // The last inserted database is kept even if it is larger than the limit
+    while ( entries_.size() > 1
+            && ( entries_.size() > MaxCachedDatabases || entriesSize_ > MaxCachedSize ) ) {
+        entriesSize_ -= databaseSize( entries_.back().second.get() );
+        entries_.pop_back();
+    }
+}
+
+HsDatabase HsDatabaseCache::load( const QByteArray& key )
+{
+    QFile cacheFile( cacheFileName( key ) );
+    if ( !cacheFile.open( QIODevice::ReadOnly ) ) {
+        return {};
+    }
+
+    const auto serialized = cacheFile.readAll();
+    hs_database_t* database = nullptr;
+    if ( hs_deserialize_database( serialized.constData(), static_cast<size_t>( serialized.size() ),
+                                  &database )
+         != HS_SUCCESS ) {
+        LOG_WARNING << "Can't load cached pattern database "
+                    << cacheFile.fileName().toStdString();
+        return {};
+    }
+
+    LOG_INFO << "Loaded cached pattern database " << cacheFile.fileName().toStdString();
+    return HsDatabase{ database, hs_free_database };
+}
+
+void HsDatabaseCache::save( const QByteArray& key, const hs_database_t* database )
+{
+    if ( !QDir().mkpath( cacheDirectory() ) ) {
+        LOG_WARNING << "Can't create pattern cache directory " << cacheDirectory().toStdString();
+        return;
+    }
+
+    char* serialized = nullptr;
+    size_t serializedSize = 0;
+    if ( hs_serialize_database( database, &serialized, &serializedSize ) != HS_SUCCESS ) {
+        return;
+    }
+
+    QSaveFile cacheFile( cacheFileName( key ) );
+    if ( cacheFile.open( QIODevice::WriteOnly ) ) {
+        cacheFile.write( serialized, static_cast<qint64>( serializedSize ) );
+        cacheFile.commit();
+    }
+    free( serialized );
+
+    removeOldFiles();
+}
+
+#endif
@@ -18,19 +18,114 @@
  */
 
 #include <algorithm>
+#include <cstdlib>
 #include <iterator>
+#include <limits>
 #include <numeric>
 #include <qregularexpression.h>
 #include <string_view>
+#include <utility>
 
 #ifdef KLOGG_HAS_HS
 #include "hsregularexpression.h"
 
 #include "cpu_info.h"
+#include "hsdatabasecache.h"
 #include "log.h"
+#include "synchronization.h"
+
+// Hyperscan compiles literals since 5.2
+#if HS_MAJOR > 5 || ( HS_MAJOR == 5 && HS_MINOR >= 2 )
+#define KLOGG_HS_HAS_LITERALS
+#endif
 
 namespace {
 
+size_t hsScratchSize( const hs_scratch_t* scratch )
+{
+    size_t size = 0;
+    return scratch != nullptr && hs_scratch_size( scratch, &size ) == HS_SUCCESS ? size : 0;
+}
+
+size_t hsDatabaseSize( const hs_database_t* database )
+{
+    size_t size = 0;
+    return database != nullptr && hs_database_size( database, &size ) == HS_SUCCESS ? size : 0;
+}
+
+// Scratch spaces are reused by matchers of the next searches, e.g. by
+// each matching thread, and grown when a database needs more space.
+class HsScratchPool {
+  public:
+    static HsScratchPool& instance()
+    {
+        static HsScratchPool pool;
+        return pool;
+    }
+
+    ~HsScratchPool()
+    {
+        for ( auto* scratch : scratches_ ) {
+            hs_free_scratch( scratch );
+        }
+    }
+
+    // Pooled scratch allocated for the databases, nullptr if the pool is empty
+    hs_scratch_t* acquire( const hs_database_t* database, const hs_database_t* linesDatabase,
+                           const hs_database_t* literalDatabase )
+    {
+        hs_scratch_t* scratch = nullptr;
+        {
+            ScopedLock lock( mutex_ );
+            if ( scratches_.empty() ) {
+                return nullptr;
+            }
+            scratch = scratches_.back();
+            scratches_.pop_back();
+        }
+
+        // Hyperscan frees the scratch if it fails to grow it
+        if ( hs_alloc_scratch( database, &scratch ) != HS_SUCCESS
+             || ( linesDatabase != nullptr
+                  && hs_alloc_scratch( linesDatabase, &scratch ) != HS_SUCCESS )
+             || ( literalDatabase != nullptr
+                  && hs_alloc_scratch( literalDatabase, &scratch ) != HS_SUCCESS ) ) {
+            LOG_ERROR << "Failed to grow pooled scratch";
+            return nullptr;
+        }
+
+        return scratch;
+    }
+
+    size_t allocatedSize() const
+    {
+        SharedLock lock( mutex_ );
+        size_t size = 0;
+        for ( const auto* scratch : scratches_ ) {
+            size += hsScratchSize( scratch );
+        }
+        return size;
+    }
+
+    void release( hs_scratch_t* scratch )
+    {
+        {
+            ScopedLock lock( mutex_ );
+            if ( scratches_.size() < MaxScratches ) {
+                scratches_.push_back( scratch );
+                return;
+            }
+        }
+        hs_free_scratch( scratch );
+    }
+
+  private:
+    static constexpr size_t MaxScratches = 64;
+
+    mutable Mutex mutex_;
+    klogg::vector<hs_scratch_t*> scratches_;
+};
+
 int matchSingleCallback( unsigned int id, unsigned long long from, unsigned long long to,
                          unsigned int flags, void* context )
 {
@@ -59,54 +154,411 @@ int matchMultiCallback( unsigned int id, unsigned long long from, unsigned long
     return 0;
 }
 
+int matchLinesCallback( unsigned int id, unsigned long long from, unsigned long long to,
+                        unsigned int flags, void* context )
+{
+    Q_UNUSED( id );
+    Q_UNUSED( from );
+    Q_UNUSED( flags );
+
+    // Scan is started again after the line of the first match
+    *static_cast<unsigned long long*>( context ) = to;
+    return 1;
+}
+
+unsigned patternFlags( const RegularExpressionPattern& expression, unsigned extraFlags )
+{
+    auto expressionFlags = HS_FLAG_UTF8 | HS_FLAG_UCP | HS_FLAG_SINGLEMATCH | extraFlags;
+    if ( !expression.isCaseSensitive ) {
+        expressionFlags |= HS_FLAG_CASELESS;
+    }
+    return expressionFlags;
+}
+
+// Plain text is matched as it is, without escaping it. Caseless literals
+// are only ASCII caseless, so other caseless text is a regular expression.
+bool isLiteral( const RegularExpressionPattern& expression )
+{
+#ifdef KLOGG_HS_HAS_LITERALS
+    return expression.isPlainText && !expression.pattern.isEmpty()
+           && ( expression.isCaseSensitive
+                || std::all_of( expression.pattern.cbegin(), expression.pattern.cend(),
+                                []( QChar c ) { return c.unicode() < 0x80; } ) );
+#else
+    Q_UNUSED( expression );
+    return false;
+#endif
+}
+
+unsigned literalFlags( const RegularExpressionPattern& expression )
+{
+    unsigned flags = HS_FLAG_SINGLEMATCH;
+    if ( !expression.isCaseSensitive ) {
+        flags |= HS_FLAG_CASELESS;
+    }
+    return flags;
+}
+
+QByteArray utf8Pattern( const RegularExpressionPattern& expression )
+{
+    auto p = expression.pattern;
+    if ( expression.isPlainText ) {
+        p = QRegularExpression::escape( expression.pattern );
+    }
+    return p.toUtf8();
+}
+
+// Literals are compiled by the literal compiler of Hyperscan, extra flags are not used
+HsDatabase compileDatabaseWithIds( const klogg::vector<RegularExpressionPattern>& expressions,
+                                   const klogg::vector<unsigned>& expressionIds,
+                                   unsigned extraFlags, bool areLiterals, QString& errorMessage,
+                                   unsigned mode = HS_MODE_BLOCK )
+{
+    klogg::vector<unsigned> flags( expressions.size() );
+    std::transform( expressions.cbegin(), expressions.cend(), flags.begin(),
+                    [ extraFlags, areLiterals ]( const auto& expression ) {
+                        return areLiterals ? literalFlags( expression )
+                                           : patternFlags( expression, extraFlags );
+                    } );
+
+    klogg::vector<QByteArray> utf8Patterns( expressions.size() );
+    std::transform( expressions.cbegin(), expressions.cend(), utf8Patterns.begin(),
+                    [ areLiterals ]( const auto& expression ) {
+                        return areLiterals ? expression.pattern.toUtf8()
+                                           : utf8Pattern( expression );
+                    } );
+
+    // Same patterns with the same flags and ids are compiled to the same database
+    QByteArray key = areLiterals ? "literals:" : "";
+    if ( mode != HS_MODE_BLOCK ) {
+        key.prepend( "mode" + QByteArray::number( mode ) + ':' );
+    }
+    for ( size_t index = 0; index < utf8Patterns.size(); ++index ) {
+        key.append( QByteArray::number( expressionIds[ index ] ) )
+            .append( ':' )
+            .append( QByteArray::number( flags[ index ] ) )
+            .append( ':' )
+            .append( QByteArray::number( utf8Patterns[ index ].size() ) )
+            .append( ':' )
+            .append( utf8Patterns[ index ] );
+    }
+
+    const auto compile = [ & ]( QString& compileErrorMessage ) -> hs_database_t* {
+        klogg::vector<const char*> patternPointers( utf8Patterns.size() );
+        std::transform( utf8Patterns.cbegin(), utf8Patterns.cend(), patternPointers.begin(),
+                        []( const auto& pattern ) { return pattern.data(); } );
+
+        hs_database_t* db = nullptr;
+        hs_compile_error_t* error = nullptr;
+        auto compileResult = HS_COMPILER_ERROR;
+        if ( !areLiterals ) {
+            compileResult
+                = hs_compile_multi( patternPointers.data(), flags.data(), expressionIds.data(),
+                                    static_cast<unsigned>( expressions.size() ), mode, nullptr,
+                                    &db, &error );
+        }
+#ifdef KLOGG_HS_HAS_LITERALS
+        else {
+            // Literals may have any bytes, including NUL
+            klogg::vector<size_t> lengths( utf8Patterns.size() );
+            std::transform( utf8Patterns.cbegin(), utf8Patterns.cend(), lengths.begin(),
+                            []( const auto& pattern ) {
+                                return static_cast<size_t>( pattern.size() );
+                            } );
+            compileResult = hs_compile_lit_multi(
+                patternPointers.data(), flags.data(), expressionIds.data(), lengths.data(),
+                static_cast<unsigned>( expressions.size() ), mode, nullptr, &db, &error );
+        }
+#endif
+
+        if ( compileResult != HS_SUCCESS ) {
+            if ( error == nullptr ) {
+                return nullptr;
+            }
+            LOG_ERROR << "Failed to compile pattern " << error->message;
+            compileErrorMessage = error->message;
+            hs_free_compile_error( error );
+            return nullptr;
+        }
+
+        return db;
+    };
+
+    return HsDatabaseCache::instance().get( key, compile, errorMessage );
+}
+
+HsDatabase compileDatabase( const klogg::vector<RegularExpressionPattern>& expressions,
+                            unsigned extraFlags, QString& errorMessage )
+{
+    klogg::vector<unsigned> expressionIds( expressions.size() );
+    std::iota( expressionIds.begin(), expressionIds.end(), 0u );
+    return compileDatabaseWithIds( expressions, expressionIds, extraFlags, false, errorMessage );
+}
+
+// Database to scan a line in parts, plain text is compiled as a literal if it can be
+HsDatabase compileStreamDatabase( const RegularExpressionPattern& expression )
+{
+    QString errorMessage;
+    if ( isLiteral( expression ) ) {
+        auto database = compileDatabaseWithIds( { expression }, { 0u }, 0u, true, errorMessage,
+                                                HS_MODE_STREAM );
+        if ( database ) {
+            return database;
+        }
+    }
+
+    return compileDatabaseWithIds( { expression }, { 0u }, 0u, false, errorMessage,
+                                   HS_MODE_STREAM );
+}
+
+bool isSupported( const RegularExpressionPattern& expression )
+{
+    hs_expr_info_t* info = nullptr;
+    hs_compile_error_t* error = nullptr;
+    const auto result = hs_expression_info( utf8Pattern( expression ).constData(),
+                                            patternFlags( expression, 0u ), &info, &error );
+    if ( result != HS_SUCCESS ) {
+        hs_free_compile_error( error );
+        return false;
+    }
+
+    free( info );
+    return true;
+}
+
+// Patterns that can't match line feeds and don't use anchors of the whole data
+// find the same lines in a block of lines as in each line alone.
+bool isLineSafe( const RegularExpressionPattern& expression )
+{
+    if ( expression.pattern.contains( '\n' ) ) {
+        return false;
+    }
+
+    if ( expression.isPlainText ) {
+        return true;
+    }
+
+    for ( const auto* token : { "\\s", "\\S", "\\n", "\\W", "\\D", "\\v", "\\R", "\\X",
+                                "\\C", "\\x", "\\o", "\\0", "\\c", "\\p", "\\P", "\\A",
+                                "\\z", "\\Z", "\\Q", "[^", "[:", "(?",
+                                // Ranges of classes starting before a line feed, e.g. [\t-\r]
+                                "\\t-", "\\a-", "\\b-" } ) {
+        if ( expression.pattern.contains( QLatin1String( token ) ) ) {
+            return false;
+        }
+    }
+
+    // Literal control characters up to [\t-\r] can be ends of such ranges too
+    const auto hasControlCharacter
+        = std::any_of( expression.pattern.cbegin(), expression.pattern.cend(),
+                       []( QChar c ) { return c.unicode() <= QChar::CarriageReturn; } );
+    if ( hasControlCharacter ) {
+        return false;
+    }
+
+    return true;
+}
+
 } // namespace
 
+void releaseHsScratch( hs_scratch_t* scratch )
+{
+    HsScratchPool::instance().release( scratch );
+}
+
+size_t pooledHsScratchSize()
+{
+    return HsScratchPool::instance().allocatedSize();
+}
+
 HsMatcherContext::HsMatcherContext( std::size_t numberOfPatterns )
     : matchingPatterns( numberOfPatterns, 0 )
-    , matchingPatternsTemplate_( numberOfPatterns, 0 )
 {
 }
 
 void HsMatcherContext::reset()
 {
-    matchingPatterns = matchingPatternsTemplate_;
+    std::fill( matchingPatterns.begin(), matchingPatterns.end(), 0 );
 }
 
-HsMatcher::HsMatcher( HsDatabase db, HsScratch scratch, std::size_t numberOfPatterns )
+HsMatcher::HsMatcher( HsDatabase db, HsScratch scratch, std::size_t numberOfPatterns,
+                      HsDatabase literalDatabase )
     : database_{ std::move( db ) }
+    , literalDatabase_{ std::move( literalDatabase ) }
     , scratch_{ std::move( scratch ) }
     , context_( numberOfPatterns )
 {
 }
 
-HsSingleMatcher::HsSingleMatcher( HsDatabase db, HsScratch scratch )
+void HsMatcher::scanPatterns( const std::string_view& utf8Data ) const
+{
+    hs_scan( database_.get(), utf8Data.data(), static_cast<unsigned int>( utf8Data.size() ), 0,
+             scratch_.get(), matchMultiCallback, static_cast<void*>( &context_ ) );
+
+    if ( literalDatabase_ ) {
+        hs_scan( literalDatabase_.get(), utf8Data.data(),
+                 static_cast<unsigned int>( utf8Data.size() ), 0, scratch_.get(),
+                 matchMultiCallback, static_cast<void*>( &context_ ) );
+    }
+}
+
+size_t HsMatcher::scratchSize() const
+{
+    return hsScratchSize( scratch_.get() );
+}
+
+HsSingleMatcher::HsSingleMatcher( HsDatabase db, HsScratch scratch, HsDatabase linesDatabase,
+                                  RegularExpressionPattern pattern )
     : HsMatcher( db, std::move( scratch ), 1 )
+    , linesDatabase_( std::move( linesDatabase ) )
+    , pattern_( std::move( pattern ) )
 {
 }
 
 MatchedPatterns HsSingleMatcher::match( const std::string_view& utf8Data ) const
 {
+    context_.matchingPatterns[ 0 ] = hasMatch( utf8Data );
+    return context_.matchingPatterns;
+}
+
+bool HsSingleMatcher::hasMatch( std::string_view utf8Data ) const
+{
+    // Scan stops at the first match
+    return hs_scan( database_.get(), utf8Data.data(), static_cast<unsigned int>( utf8Data.size() ),
+                    0, scratch_.get(), matchSingleCallback, static_cast<void*>( &context_ ) )
+           == HS_SCAN_TERMINATED;
+}
+
+std::optional<bool> HsSingleMatcher::hasStreamMatch( const LinePartsReader& readParts ) const
+{
+    if ( !streamDatabase_ ) {
+        streamDatabase_ = compileStreamDatabase( pattern_ );
+    }
+    if ( !*streamDatabase_ ) {
+        return std::nullopt;
+    }
+
+    // Lines are rarely scanned in parts, the scratch space is not kept
+    hs_scratch_t* streamScratch = nullptr;
+    if ( hs_alloc_scratch( streamDatabase_->get(), &streamScratch ) != HS_SUCCESS ) {
+        LOG_ERROR << "Failed to allocate scratch for streams";
+        return std::nullopt;
+    }
+
+    hs_stream_t* stream = nullptr;
+    if ( hs_open_stream( streamDatabase_->get(), 0, &stream ) != HS_SUCCESS ) {
+        LOG_ERROR << "Failed to open stream";
+        hs_free_scratch( streamScratch );
+        return std::nullopt;
+    }
+
     context_.reset();
+    const auto isRead = readParts( [ & ]( std::string_view part ) {
+        // Scan is terminated by the first match
+        return hs_scan_stream( stream, part.data(), static_cast<unsigned int>( part.size() ), 0,
+                               streamScratch, matchSingleCallback,
+                               static_cast<void*>( &context_ ) )
+               == HS_SUCCESS;
+    } );
+
+    // Matches at the end of the line, e.g. of $, are found when the stream is closed
+    hs_close_stream( stream, streamScratch, matchSingleCallback, static_cast<void*>( &context_ ) );
+    hs_free_scratch( streamScratch );
+
+    if ( !isRead ) {
+        return std::nullopt;
+    }
+    return context_.matchingPatterns[ 0 ] != 0;
+}
 
-    hs_scan( database_.get(), utf8Data.data(), static_cast<unsigned int>( utf8Data.size() ), 0,
-             scratch_.get(), matchSingleCallback, static_cast<void*>( &context_ ) );
+bool HsSingleMatcher::matchLines( const klogg::vector<std::string_view>& lines,
+                                  klogg::vector<size_t>& matchingLines ) const
+{
+    if ( !linesDatabase_ || lines.empty() || !areConsecutiveLines( lines ) ) {
+        return false;
+    }
 
-    return std::move( context_.matchingPatterns );
+    const auto* dataEnd = lines.back().data() + lines.back().size();
+    if ( static_cast<size_t>( dataEnd - lines.front().data() )
+         > std::numeric_limits<unsigned int>::max() ) {
+        return false;
+    }
+
+    auto firstLine = lines.begin();
+    while ( firstLine != lines.end() ) {
+        const auto* scanStart = firstLine->data();
+        unsigned long long matchEnd = 0;
+
+        hs_scan( linesDatabase_.get(), scanStart,
+                 static_cast<unsigned int>( dataEnd - scanStart ), 0, scratch_.get(),
+                 matchLinesCallback, static_cast<void*>( &matchEnd ) );
+
+        if ( matchEnd == 0 ) {
+            break;
+        }
+
+        // Matches don't span lines, the last matched byte is in the matching line
+        const auto* lastMatched = scanStart + matchEnd - 1;
+        const auto matchingLine
+            = std::prev( std::upper_bound( firstLine, lines.end(), lastMatched,
+                                           []( const char* position, std::string_view line ) {
+                                               return position < line.data();
+                                           } ) );
+
+        matchingLines.push_back( static_cast<size_t>( matchingLine - lines.begin() ) );
+        firstLine = std::next( matchingLine );
+    }
+
+    return true;
 }
 
-HsMultiMatcher::HsMultiMatcher( HsDatabase db, HsScratch scratch, std::size_t numberOfPatterns )
-    : HsMatcher( db, std::move( scratch ), numberOfPatterns )
+HsMultiMatcher::HsMultiMatcher( HsDatabase db, HsScratch scratch, std::size_t numberOfPatterns,
+                                HsDatabase literalDatabase )
+    : HsMatcher( db, std::move( scratch ), numberOfPatterns, std::move( literalDatabase ) )
 {
 }
 
 MatchedPatterns HsMultiMatcher::match( const std::string_view& utf8Data ) const
 {
     context_.reset();
+    scanPatterns( utf8Data );
+    return context_.matchingPatterns;
+}
 
-    hs_scan( database_.get(), utf8Data.data(), static_cast<unsigned int>( utf8Data.size() ), 0,
-             scratch_.get(), matchMultiCallback, static_cast<void*>( &context_ ) );
+bool HsMultiMatcher::hasMatch( std::string_view utf8Data ) const
+{
+    const auto matchedPatterns = match( utf8Data );
+    return !matchedPatterns.empty() && matchedPatterns[ 0 ] > 0;
+}
 
-    return std::move( context_.matchingPatterns );
+HsMixedMatcher::HsMixedMatcher( HsDatabase db, HsScratch scratch, std::size_t numberOfPatterns,
+                                klogg::vector<size_t> defaultPatterns,
+                                DefaultMatcherVariant defaultMatcher, HsDatabase literalDatabase )
+    : HsMatcher( db, std::move( scratch ), numberOfPatterns, std::move( literalDatabase ) )
+    , defaultPatterns_( std::move( defaultPatterns ) )
+    , defaultMatcher_( std::move( defaultMatcher ) )
+{
+}
+
+MatchedPatterns HsMixedMatcher::match( const std::string_view& utf8Data ) const
+{
+    context_.reset();
+    scanPatterns( utf8Data );
+
+    const auto defaultMatches = std::visit(
+        [ &utf8Data ]( const auto& matcher ) { return matcher.match( utf8Data ); },
+        defaultMatcher_ );
+    for ( auto index = 0u; index < defaultPatterns_.size(); ++index ) {
+        context_.matchingPatterns[ defaultPatterns_[ index ] ] = defaultMatches[ index ];
+    }
+
+    return context_.matchingPatterns;
+}
+
+bool HsMixedMatcher::hasMatch( std::string_view utf8Data ) const
+{
+    const auto matchedPatterns = match( utf8Data );
+    return !matchedPatterns.empty() && matchedPatterns[ 0 ] > 0;
 }
 
 MatchedPatterns HsNoopMatcher::match( const std::string_view& ) const
@@ -114,6 +566,11 @@ MatchedPatterns HsNoopMatcher::match( const std::string_view& ) const
     return {};
 }
 
+bool HsNoopMatcher::hasMatch( std::string_view ) const
+{
+    return false;
+}
+
 HsRegularExpression::HsRegularExpression( const RegularExpressionPattern& pattern )
     : HsRegularExpression( klogg::vector<RegularExpressionPattern>{ pattern } )
 {
@@ -121,68 +578,107 @@ HsRegularExpression::HsRegularExpression( const RegularExpressionPattern& patter
 
 HsRegularExpression::HsRegularExpression( const klogg::vector<RegularExpressionPattern>& patterns )
     : patterns_( patterns )
+#ifdef KLOGG_HAS_PCRE2
+    , pcre2Expression_( patterns )
+#endif
 {
     auto requiredInstructuins = CpuInstructions::SSE2;
     requiredInstructuins |= CpuInstructions::SSSE3;
 
     if ( hasRequiredInstructions( supportedCpuInstructions(), requiredInstructuins ) ) {
-        database_ = HsDatabase{ makeUniqueResource<hs_database_t, hs_free_database>(
-            []( const klogg::vector<RegularExpressionPattern>& expressions,
-                QString& errorMessage ) -> hs_database_t* {
-                hs_database_t* db = nullptr;
-                hs_compile_error_t* error = nullptr;
-
-                klogg::vector<unsigned> flags( expressions.size() );
-                std::transform( expressions.cbegin(), expressions.cend(), flags.begin(),
-                                []( const auto& expression ) {
-                                    auto expressionFlags
-                                        = HS_FLAG_UTF8 | HS_FLAG_UCP | HS_FLAG_SINGLEMATCH;
-                                    if ( !expression.isCaseSensitive ) {
-                                        expressionFlags |= HS_FLAG_CASELESS;
-                                    }
-                                    return expressionFlags;
-                                } );
-
-                klogg::vector<QByteArray> utf8Patterns( expressions.size() );
-                std::transform( expressions.cbegin(), expressions.cend(), utf8Patterns.begin(),
-                                []( const auto& expression ) {
-                                    auto p = expression.pattern;
-                                    if ( expression.isPlainText ) {
-                                        p = QRegularExpression::escape( expression.pattern );
-                                    }
-                                    return p.toUtf8();
-                                } );
-
-                klogg::vector<const char*> patternPointers( utf8Patterns.size() );
-                std::transform( utf8Patterns.cbegin(), utf8Patterns.cend(), patternPointers.begin(),
-                                []( const auto& utf8Pattern ) { return utf8Pattern.data(); } );
-
-                klogg::vector<unsigned> expressionIds( expressions.size() );
+        // Plain text is compiled as literals, regular expressions are in another database
+        klogg::vector<RegularExpressionPattern> literals;
+        klogg::vector<unsigned> literalIds;
+        klogg::vector<RegularExpressionPattern> expressions;
+        klogg::vector<unsigned> expressionIds;
+        for ( auto index = 0u; index < patterns_.size(); ++index ) {
+            if ( isLiteral( patterns_[ index ] ) ) {
+                literals.push_back( patterns_[ index ] );
+                literalIds.push_back( index );
+            }
+            else {
+                expressions.push_back( patterns_[ index ] );
+                expressionIds.push_back( index );
+            }
+        }
+
+        if ( !literals.empty() ) {
+            literalDatabase_
+                = compileDatabaseWithIds( literals, literalIds, 0u, true, errorMessage_ );
+            if ( !literalDatabase_ ) {
+                LOG_WARNING << "Failed to compile literals, compiling them as regular expressions";
+                errorMessage_.clear();
+                expressions = patterns_;
+                expressionIds.resize( patterns_.size() );
                 std::iota( expressionIds.begin(), expressionIds.end(), 0u );
+            }
+        }
 
-                const auto compileResult
-                    = hs_compile_multi( patternPointers.data(), flags.data(), expressionIds.data(),
-                                        static_cast<unsigned>( expressions.size() ), HS_MODE_BLOCK,
-                                        nullptr, &db, &error );
+        if ( expressions.empty() ) {
+            database_ = std::move( literalDatabase_ );
+            literalDatabase_ = {};
+        }
+        else {
+            database_
+                = compileDatabaseWithIds( expressions, expressionIds, 0u, false, errorMessage_ );
+        }
 
-                if ( compileResult != HS_SUCCESS ) {
-                    LOG_ERROR << "Failed to compile pattern " << error->message;
-                    errorMessage = error->message;
-                    hs_free_compile_error( error );
-                    return nullptr;
+        // Compile the patterns Hyperscan supports, others are matched by the default matcher
+        if ( !database_ && patterns_.size() > 1 ) {
+            klogg::vector<RegularExpressionPattern> hsPatterns;
+            klogg::vector<unsigned> hsPatternIds;
+            for ( auto index = 0u; index < expressions.size(); ++index ) {
+                if ( isSupported( expressions[ index ] ) ) {
+                    hsPatterns.push_back( expressions[ index ] );
+                    hsPatternIds.push_back( expressionIds[ index ] );
+                }
+                else {
+                    defaultPatterns_.push_back( expressionIds[ index ] );
                 }
+            }
 
-                return db;
-            },
-            patterns, errorMessage_ ) };
+            if ( !hsPatterns.empty() ) {
+                LOG_INFO << "Patterns not supported by Hyperscan: " << defaultPatterns_.size();
+                database_ = compileDatabaseWithIds( hsPatterns, hsPatternIds, 0u, false,
+                                                    errorMessage_ );
+            }
+            else if ( literalDatabase_ ) {
+                database_ = std::move( literalDatabase_ );
+                literalDatabase_ = {};
+            }
+
+            if ( database_ ) {
+                errorMessage_.clear();
+            }
+            else {
+                defaultPatterns_.clear();
+            }
+        }
+
+        if ( !database_ ) {
+            literalDatabase_ = {};
+        }
+
+        if ( database_ && patterns_.size() == 1 && isLineSafe( patterns_.front() ) ) {
+            if ( isLiteral( patterns_.front() ) && expressions.empty() ) {
+                // Literals don't depend on line feeds
+                linesDatabase_ = database_;
+            }
+            else {
+                QString linesErrorMessage;
+                linesDatabase_ = compileDatabase(
+                    patterns, static_cast<unsigned>( HS_FLAG_MULTILINE ), linesErrorMessage );
+            }
+        }
     }
     else {
         LOG_WARNING << "Cpu doesn't have sse2 or ssse3, use qt regex engine";
     }
 
     if ( database_ ) {
-        scratch_ = makeUniqueResource<hs_scratch_t, hs_free_scratch>(
-            []( hs_database_t* db ) -> hs_scratch_t* {
+        scratch_ = makeUniqueResource<hs_scratch_t, releaseHsScratch>(
+            []( hs_database_t* db, hs_database_t* linesDb,
+                hs_database_t* literalDb ) -> hs_scratch_t* {
                 hs_scratch_t* scratch = nullptr;
 
                 const auto scratchResult = hs_alloc_scratch( db, &scratch );
@@ -191,12 +687,26 @@ HsRegularExpression::HsRegularExpression( const klogg::vector<RegularExpressionP
                     return nullptr;
                 }
 
+                // Scratch space is grown to scan lines with the same scratch
+                if ( linesDb != nullptr && hs_alloc_scratch( linesDb, &scratch ) != HS_SUCCESS ) {
+                    LOG_ERROR << "Failed to allocate scratch for lines";
+                    hs_free_scratch( scratch );
+                    return nullptr;
+                }
+
+                if ( literalDb != nullptr
+                     && hs_alloc_scratch( literalDb, &scratch ) != HS_SUCCESS ) {
+                    LOG_ERROR << "Failed to allocate scratch for literals";
+                    hs_free_scratch( scratch );
+                    return nullptr;
+                }
+
                 return scratch;
             },
-            database_.get() );
+            database_.get(), linesDatabase_.get(), literalDatabase_.get() );
     }
 
-    if ( !isHsValid() ) {
+    if ( !isHsValid() || !defaultPatterns_.empty() ) {
         for ( const auto& pattern : patterns_ ) {
             const auto regex = static_cast<QRegularExpression>( pattern );
             if ( !regex.isValid() ) {
@@ -216,6 +726,15 @@ bool HsRegularExpression::isValid() const
     return isValid_;
 }
 
+size_t HsRegularExpression::allocatedSize() const
+{
+    // Lines database of a literal is the database itself
+    const auto linesDatabaseSize
+        = linesDatabase_ != database_ ? hsDatabaseSize( linesDatabase_.get() ) : 0;
+    return hsDatabaseSize( database_.get() ) + linesDatabaseSize
+           + hsDatabaseSize( literalDatabase_.get() ) + hsScratchSize( scratch_.get() );
+}
+
 bool HsRegularExpression::isHsValid() const
 {
     return database_ != nullptr && scratch_ != nullptr;
@@ -226,15 +745,49 @@ QString HsRegularExpression::errorString() const
     return errorMessage_;
 }
 
+MatcherVariant HsRegularExpression::createDefaultMatcher() const
+{
+    if ( patterns_.size() == 1 && PlainTextMatcher::isSupported( patterns_.front() ) ) {
+        return MatcherVariant{ PlainTextMatcher( patterns_.front() ) };
+    }
+#ifdef KLOGG_HAS_PCRE2
+    if ( pcre2Expression_.isValid() ) {
+        return MatcherVariant{ pcre2Expression_.createMatcher() };
+    }
+#endif
+    return MatcherVariant{ DefaultRegularExpressionMatcher( patterns_ ) };
+}
+
+DefaultMatcherVariant
+HsRegularExpression::createDefaultMatcher( const klogg::vector<size_t>& patterns ) const
+{
+#ifdef KLOGG_HAS_PCRE2
+    if ( pcre2Expression_.isValid() ) {
+        return DefaultMatcherVariant{ pcre2Expression_.createMatcher( patterns ) };
+    }
+#endif
+    klogg::vector<RegularExpressionPattern> defaultPatterns;
+    defaultPatterns.reserve( patterns.size() );
+    for ( const auto pattern : patterns ) {
+        defaultPatterns.push_back( patterns_[ pattern ] );
+    }
+    return DefaultMatcherVariant{ DefaultRegularExpressionMatcher( defaultPatterns ) };
+}
+
 MatcherVariant HsRegularExpression::createMatcher() const
 {
     if ( !isHsValid() ) {
-        return MatcherVariant{ DefaultRegularExpressionMatcher( patterns_ ) };
+        return createDefaultMatcher();
     }
 
-    auto matcherScratch = makeUniqueResource<hs_scratch_t, hs_free_scratch>(
-        []( hs_scratch_t* prototype ) -> hs_scratch_t* {
-            hs_scratch_t* scratch = nullptr;
+    auto matcherScratch = makeUniqueResource<hs_scratch_t, releaseHsScratch>(
+        []( hs_scratch_t* prototype, hs_database_t* db, hs_database_t* linesDb,
+            hs_database_t* literalDb ) -> hs_scratch_t* {
+            // Prototype is cloned only if there are no scratch spaces to reuse
+            hs_scratch_t* scratch = HsScratchPool::instance().acquire( db, linesDb, literalDb );
+            if ( scratch != nullptr ) {
+                return scratch;
+            }
 
             const auto err = hs_clone_scratch( prototype, &scratch );
             if ( err != HS_SUCCESS ) {
@@ -244,16 +797,23 @@ MatcherVariant HsRegularExpression::createMatcher() const
 
             return scratch;
         },
-        scratch_.get() );
+        scratch_.get(), database_.get(), linesDatabase_.get(), literalDatabase_.get() );
 
     if ( !database_ || !scratch_ ) {
         return HsNoopMatcher();
     }
+    else if ( !defaultPatterns_.empty() ) {
+        return HsMixedMatcher{ database_, std::move( matcherScratch ), patterns_.size(),
+                               defaultPatterns_, createDefaultMatcher( defaultPatterns_ ),
+                               literalDatabase_ };
+    }
     else if ( patterns_.size() == 1 ) {
-        return HsSingleMatcher{ database_, std::move( matcherScratch ) };
+        return HsSingleMatcher{ database_, std::move( matcherScratch ), linesDatabase_,
+                                patterns_.front() };
     }
     else {
-        return HsMultiMatcher{ database_, std::move( matcherScratch ), patterns_.size() };
+        return HsMultiMatcher{ database_, std::move( matcherScratch ), patterns_.size(),
+                               literalDatabase_ };
     }
 }
 #endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "pcre2regularexpression.h"
+
+#ifdef KLOGG_HAS_PCRE2
+
+#include <QByteArray>
+#include <QRegularExpression>
+
+#include "log.h"
+
+namespace {
+constexpr size_t JitStackStartSize = 32 * 1024;
+constexpr size_t JitStackMaxSize = 1024 * 1024;
+
+pcre2_code* compilePattern( const RegularExpressionPattern& pattern )
+{
+    // Same as the options of QRegularExpression with UseUnicodePropertiesOption
+    // and DontCaptureOption, invalid UTF-8 in lines doesn't match
+    uint32_t options = PCRE2_UTF | PCRE2_UCP | PCRE2_NO_AUTO_CAPTURE | PCRE2_MATCH_INVALID_UTF;
+    if ( !pattern.isCaseSensitive ) {
+        options |= PCRE2_CASELESS;
+    }
+
+    const auto utf8Pattern
+        = ( pattern.isPlainText ? QRegularExpression::escape( pattern.pattern ) : pattern.pattern )
+              .toUtf8();
+
+    int errorCode = 0;
+    PCRE2_SIZE errorOffset = 0;
+    auto* code = pcre2_compile( reinterpret_cast<PCRE2_SPTR>( utf8Pattern.constData() ),
+                                static_cast<PCRE2_SIZE>( utf8Pattern.size() ), options,
+                                &errorCode, &errorOffset, nullptr );
+    if ( !code ) {
+        PCRE2_UCHAR message[ 256 ];
+        pcre2_get_error_message( errorCode, message, sizeof( message ) );
+        LOG_INFO << "Pcre2 can't compile pattern: " << reinterpret_cast<const char*>( message )
+                 << " at " << errorOffset;
+        return nullptr;
+    }
+
+    // Without JIT patterns are interpreted
+    if ( pcre2_jit_compile( code, PCRE2_JIT_COMPLETE ) != 0 ) {
+        LOG_INFO << "Pcre2 JIT is not available for pattern";
+    }
+
+    return code;
+}
+} // namespace
+
+Pcre2RegularExpression::Pcre2RegularExpression(
+    const klogg::vector<RegularExpressionPattern>& patterns )
+{
+    codes_.reserve( patterns.size() );
+    for ( const auto& pattern : patterns ) {
+        auto code = Pcre2Code{ compilePattern( pattern ), pcre2_code_free };
+        if ( !code ) {
+            codes_.clear();
+            return;
+        }
+        codes_.push_back( std::move( code ) );
+    }
+
+    isValid_ = !codes_.empty();
+}
+
+Pcre2Matcher::Pcre2Matcher( klogg::vector<Pcre2Code> codes )
+    : codes_( std::move( codes ) )
+    , matchData_( pcre2_match_data_create( 1, nullptr ) )
+    , jitStack_( pcre2_jit_stack_create( JitStackStartSize, JitStackMaxSize, nullptr ) )
+    , matchContext_( pcre2_match_context_create( nullptr ) )
+    , matchedPatterns_( codes_.size(), 0 )
+{
+    if ( matchContext_ && jitStack_ ) {
+        pcre2_jit_stack_assign( matchContext_.get(), nullptr, jitStack_.get() );
+    }
+}
+
+bool Pcre2Matcher::hasMatch( std::string_view utf8Data, size_t pattern ) const
+{
+    const auto result = pcre2_match( codes_[ pattern ].get(),
+                                     reinterpret_cast<PCRE2_SPTR>( utf8Data.data() ),
+                                     utf8Data.size(), 0, 0, matchData_.get(), matchContext_.get() );
+    return result >= 0;
+}
+
+MatchedPatterns Pcre2Matcher::match( const std::string_view& utf8Data ) const
+{
+    for ( size_t pattern = 0; pattern < codes_.size(); ++pattern ) {
+        matchedPatterns_[ pattern ] = hasMatch( utf8Data, pattern );
+    }
+
+    return matchedPatterns_;
+}
+
+#endif
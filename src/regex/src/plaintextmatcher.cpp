@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "plaintextmatcher.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "containers.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define KLOGG_HAS_SSE2_SEARCH
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+bool isAsciiLetter( char c )
+{
+    return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' );
+}
+
+char toLowerAscii( char c )
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>( c + ( 'a' - 'A' ) ) : c;
+}
+
+bool isAscii( std::string_view data )
+{
+    return std::all_of( data.begin(), data.end(),
+                        []( char c ) { return ( static_cast<uint8_t>( c ) & 0x80 ) == 0; } );
+}
+
+// Text is in lower case
+bool equalsIgnoringCase( const char* data, std::string_view text )
+{
+    for ( size_t index = 0; index < text.size(); ++index ) {
+        if ( toLowerAscii( data[ index ] ) != text[ index ] ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool findAsciiScalar( std::string_view data, std::string_view text, size_t from )
+{
+    for ( auto position = from; position + text.size() <= data.size(); ++position ) {
+        if ( toLowerAscii( data[ position ] ) == text.front()
+             && equalsIgnoringCase( data.data() + position, text ) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#ifdef KLOGG_HAS_SSE2_SEARCH
+size_t firstSetBit( uint32_t mask )
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward( &index, mask );
+    return index;
+#else
+    return static_cast<size_t>( __builtin_ctz( mask ) );
+#endif
+}
+
+// Setting bit 0x20 makes ASCII letters lower case, other bytes are compared as they are
+__m128i foldMask( char c )
+{
+    return _mm_set1_epi8( isAsciiLetter( c ) ? 0x20 : 0 );
+}
+
+// Positions where the first and the last bytes of the text match are checked in full
+bool findAsciiSse2( std::string_view data, std::string_view text )
+{
+    const auto lastOffset = text.size() - 1;
+    const auto firstMask = foldMask( text.front() );
+    const auto firstByte = _mm_set1_epi8( text.front() );
+    const auto lastMask = foldMask( text.back() );
+    const auto lastByte = _mm_set1_epi8( text.back() );
+
+    size_t position = 0;
+    for ( ; position + lastOffset + 16 <= data.size(); position += 16 ) {
+        const auto firstBytes
+            = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data.data() + position ) );
+        const auto lastBytes = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>( data.data() + position + lastOffset ) );
+
+        const auto candidates
+            = _mm_and_si128( _mm_cmpeq_epi8( _mm_or_si128( firstBytes, firstMask ), firstByte ),
+                             _mm_cmpeq_epi8( _mm_or_si128( lastBytes, lastMask ), lastByte ) );
+
+        auto mask = static_cast<uint32_t>( _mm_movemask_epi8( candidates ) );
+        while ( mask != 0 ) {
+            if ( equalsIgnoringCase( data.data() + position + firstSetBit( mask ), text ) ) {
+                return true;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    return findAsciiScalar( data, text, position );
+}
+#endif
+
+} // namespace
+
+PlainTextMatcher::PlainTextMatcher( const RegularExpressionPattern& pattern )
+    : text_( pattern.pattern )
+    , matchedPatterns_( 1, 0 )
+{
+    const auto utf8Text = pattern.pattern.toStdString();
+    isAscii_ = isAscii( utf8Text );
+    if ( isAscii_ ) {
+        asciiText_.resize( utf8Text.size() );
+        std::transform( utf8Text.begin(), utf8Text.end(), asciiText_.begin(), toLowerAscii );
+        hasUnicodeFolds_ = asciiText_.find_first_of( "ks" ) != std::string::npos;
+    }
+}
+
+bool PlainTextMatcher::isSupported( const RegularExpressionPattern& pattern )
+{
+    return pattern.isPlainText && !pattern.isCaseSensitive && !pattern.isBoolean;
+}
+
+std::string_view PlainTextMatcher::match( const std::string_view& utf8Data ) const
+{
+    matchedPatterns_[ 0 ] = hasMatch( utf8Data );
+    return matchedPatterns_;
+}
+
+bool PlainTextMatcher::hasMatch( std::string_view utf8Data ) const
+{
+    // Kelvin sign and long s fold to ASCII letters
+    if ( !isAscii_ || ( hasUnicodeFolds_ && !isAscii( utf8Data ) ) ) {
+        return hasUnicodeMatch( utf8Data );
+    }
+
+    return hasAsciiMatch( utf8Data );
+}
+
+bool PlainTextMatcher::hasAsciiMatch( std::string_view utf8Data ) const
+{
+    if ( asciiText_.empty() ) {
+        return true;
+    }
+
+#ifdef KLOGG_HAS_SSE2_SEARCH
+    return findAsciiSse2( utf8Data, asciiText_ );
+#else
+    return findAsciiScalar( utf8Data, asciiText_, 0 );
+#endif
+}
+
+bool PlainTextMatcher::hasUnicodeMatch( std::string_view utf8Data ) const
+{
+    return QString::fromUtf8( utf8Data.data(), klogg::isize( utf8Data ) )
+        .contains( text_, Qt::CaseInsensitive );
+}
@@ -17,10 +17,14 @@
  * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <exception>
+#include <functional>
+#include <iterator>
 #include <memory>
 #include <qregularexpression.h>
 #include <string>
+#include <type_traits>
 #include <variant>
 
 #include "configuration.h"
@@ -103,6 +107,169 @@ parseBooleanExpressions( QString& pattern, bool isCaseSensitive, bool isPlainTex
     return subPatterns;
 }
 
+// Position after the group or class starting at the position
+int skipGroup( const QString& pattern, int position )
+{
+    const auto isClass = pattern[ position ] == QChar( '[' );
+    int depth = 0;
+    for ( auto index = position; index < pattern.size(); ++index ) {
+        const auto c = pattern[ index ];
+        if ( c == QChar( '\\' ) ) {
+            ++index;
+        }
+        else if ( isClass ) {
+            // Closing bracket right after the opening one is a literal
+            const auto classStart = position + ( pattern.mid( position, 2 ) == "[^" ? 2 : 1 );
+            if ( c == QChar( ']' ) && index > classStart ) {
+                return index + 1;
+            }
+        }
+        else if ( c == QChar( '[' ) ) {
+            index = skipGroup( pattern, index ) - 1;
+        }
+        else if ( c == QChar( '(' ) ) {
+            ++depth;
+        }
+        else if ( c == QChar( ')' ) && --depth == 0 ) {
+            return index + 1;
+        }
+    }
+    return type_safe::narrow_cast<int>( pattern.size() );
+}
+
+// Longest run of characters every match of the pattern has, in UTF-8.
+// Parsing is conservative, anything not understood ends the run.
+RequiredLiteral findRequiredLiteral( const RegularExpressionPattern& pattern )
+{
+    if ( !pattern.isCaseSensitive || pattern.isBoolean || pattern.pattern.contains( '\n' ) ) {
+        return {};
+    }
+
+    if ( pattern.isPlainText ) {
+        return { pattern.pattern.toStdString(), false, false };
+    }
+
+    const auto& text = pattern.pattern;
+    if ( text.contains( '|' ) || text.contains( "(?" ) || text.contains( "\\Q" ) ) {
+        return {};
+    }
+
+    // Anchors and word boundaries around runs are kept
+    QString longestRun;
+    bool isLongestRunWordStart = false;
+    bool isLongestRunWordEnd = false;
+    QString currentRun;
+    bool isCurrentRunWordStart = false;
+    bool isAfterBoundary = false;
+    const auto endRun = [ & ]( bool isAtBoundary ) {
+        if ( currentRun.size() > longestRun.size() ) {
+            longestRun = currentRun;
+            isLongestRunWordStart = isCurrentRunWordStart;
+            isLongestRunWordEnd = isAtBoundary;
+        }
+        currentRun.clear();
+        isAfterBoundary = isAtBoundary;
+    };
+    const auto appendToRun = [ & ]( QChar c ) {
+        if ( currentRun.isEmpty() ) {
+            isCurrentRunWordStart = isAfterBoundary;
+        }
+        currentRun.append( c );
+    };
+
+    for ( auto index = 0; index < text.size(); ++index ) {
+        auto c = text[ index ];
+        if ( c == QChar( '[' ) || c == QChar( '(' ) ) {
+            endRun( false );
+            index = skipGroup( text, index ) - 1;
+            continue;
+        }
+
+        if ( c == QChar( '{' ) ) {
+            endRun( false );
+            index = type_safe::narrow_cast<int>( text.indexOf( '}', index ) );
+            if ( index < 0 ) {
+                break;
+            }
+            continue;
+        }
+
+        if ( c == QChar( '\\' ) ) {
+            if ( index + 1 >= text.size() ) {
+                break;
+            }
+
+            if ( text[ index + 1 ].isLetterOrNumber() ) {
+                // Classes and anchors, escapes with arguments are not parsed further
+                const auto escape = text[ ++index ];
+                endRun( QString( "bAzZ" ).contains( escape ) );
+                if ( !QString( "bBdDwWsShHvVRXAzZGK" ).contains( escape ) ) {
+                    break;
+                }
+                continue;
+            }
+            c = text[ ++index ];
+        }
+        else if ( QString( ".^$*+?}]|)" ).contains( c ) ) {
+            endRun( c == QChar( '^' ) || c == QChar( '$' ) );
+            continue;
+        }
+
+        const auto quantifier = index + 1 < text.size() ? text[ index + 1 ] : QChar();
+        if ( quantifier == QChar( '?' ) || quantifier == QChar( '*' )
+             || quantifier == QChar( '{' ) ) {
+            endRun( false );
+        }
+        else if ( quantifier == QChar( '+' ) ) {
+            appendToRun( c );
+            endRun( false );
+        }
+        else {
+            appendToRun( c );
+        }
+    }
+    endRun( false );
+
+    // Very short literals are found in too many lines to help
+    if ( longestRun.size() < 2 ) {
+        return {};
+    }
+    return { longestRun.toStdString(), isLongestRunWordStart, isLongestRunWordEnd };
+}
+
+bool isAsciiText( std::string_view text )
+{
+    return std::all_of( text.begin(), text.end(),
+                        []( char c ) { return ( static_cast<uint8_t>( c ) & 0x80 ) == 0; } );
+}
+
+std::string encodeAsciiAsUtf16( std::string_view text, bool isBigEndian )
+{
+    std::string encoded;
+    encoded.reserve( text.size() * 2 );
+    for ( const auto c : text ) {
+        encoded.push_back( isBigEndian ? '\0' : c );
+        encoded.push_back( isBigEndian ? c : '\0' );
+    }
+    return encoded;
+}
+
+std::string decodeUtf16AsUtf8( std::string_view data, bool isBigEndian )
+{
+    std::u16string units( data.size() / 2, u'\0' );
+    for ( size_t index = 0; index < units.size(); ++index ) {
+        const auto first = static_cast<uint8_t>( data[ 2 * index ] );
+        const auto second = static_cast<uint8_t>( data[ 2 * index + 1 ] );
+        units[ index ] = static_cast<char16_t>( isBigEndian ? ( first << 8 ) | second
+                                                            : ( second << 8 ) | first );
+    }
+
+    // Byte order mark is not part of the first line
+    const auto start = !units.empty() && units.front() == u'\xFEFF' ? 1 : 0;
+    return QString::fromUtf16( units.data() + start, klogg::isize( units ) - start )
+        .toStdString();
+}
+
 } // namespace
 
 RegularExpression::RegularExpression( const RegularExpressionPattern& pattern )
@@ -115,10 +282,22 @@ RegularExpression::RegularExpression( const RegularExpressionPattern& pattern )
             subPatterns_ = parseBooleanExpressions( expression_, pattern.isCaseSensitive,
                                                     pattern.isPlainText );
 
-            BooleanExpressionEvaluator evaluator{ expression_.toStdString(), subPatterns_ };
-            if ( !evaluator.isValid() ) {
+            // Engines match the text of field predicates as is, the results are replaced
+            for ( auto& subPattern : subPatterns_ ) {
+                std::optional<FieldQuery> query;
+                if ( !subPattern.isPlainText ) {
+                    query = FieldQuery::parse( subPattern.pattern, subPattern.isCaseSensitive );
+                }
+                subPattern.isPlainText = subPattern.isPlainText || query.has_value();
+                subPatternFields_.push_back(
+                    query ? std::make_shared<const FieldQuery>( std::move( *query ) ) : nullptr );
+            }
+
+            booleanProgram_
+                = std::make_shared<const BooleanProgram>( expression_.toStdString(), subPatterns_ );
+            if ( !booleanProgram_->isValid() ) {
                 isValid_ = false;
-                errorString_ = QString::fromStdString( evaluator.errorString() );
+                errorString_ = QString::fromStdString( booleanProgram_->errorString() );
                 return;
             }
         }
@@ -131,6 +310,20 @@ RegularExpression::RegularExpression( const RegularExpressionPattern& pattern )
         isValid_ = hsExpression_.isValid();
         errorString_ = hsExpression_.errorString();
 
+        // Fields are matched whatever the text between them is, so no literal is required
+        if ( !pattern.isBoolean && !pattern.isPlainText ) {
+            if ( auto query = FieldQuery::parse( pattern.pattern, pattern.isCaseSensitive ) ) {
+                fieldQuery_ = std::make_shared<const FieldQuery>( std::move( *query ) );
+                isValid_ = true;
+                errorString_.clear();
+                return;
+            }
+        }
+
+        if ( !pattern.isBoolean ) {
+            requiredLiteral_ = findRequiredLiteral( pattern );
+        }
+
     } catch ( std::exception& err ) {
         isValid_ = false;
         errorString_ = err.what();
@@ -147,6 +340,27 @@ QString RegularExpression::errorString() const
     return errorString_;
 }
 
+RequiredLiteral RegularExpression::requiredLiteral() const
+{
+    // Lines without the literal match an inverse pattern
+    return isInverse_ ? RequiredLiteral{} : requiredLiteral_;
+}
+
+RequiredLiteral RegularExpression::excludedLiteral() const
+{
+    return isInverse_ ? requiredLiteral_ : RequiredLiteral{};
+}
+
+size_t RegularExpression::allocatedSize() const
+{
+    return hsExpression_.allocatedSize();
+}
+
+std::shared_ptr<const FieldQuery> RegularExpression::fieldQuery() const
+{
+    return fieldQuery_;
+}
+
 std::unique_ptr<PatternMatcher> RegularExpression::createMatcher() const
 {
     return std::make_unique<PatternMatcher>( *this );
@@ -154,32 +368,85 @@ std::unique_ptr<PatternMatcher> RegularExpression::createMatcher() const
 
 namespace matching {
 
-bool hasSingleMatch( std::string_view line, const MatcherVariant& matcher,
-                     BooleanExpressionEvaluator* )
+template <typename Matcher>
+bool hasCombinedMatch( std::string_view line, const Matcher& matcher,
+                       BooleanExpressionEvaluator* evaluator )
 {
-    const auto result
-        = std::visit( [ &line ]( const auto& m ) { return m.match( line ); }, matcher );
+    if ( !evaluator ) {
+        return false;
+    }
 
-    return !result.empty() && result[ 0 ] > 0;
+    // Each pattern is a separate regular expression run, only the ones needed are matched
+#ifdef KLOGG_HAS_PCRE2
+    if constexpr ( std::is_same_v<Matcher, Pcre2Matcher> ) {
+        return evaluator->evaluateLazily(
+            matcher.patternsCount(), [ &matcher, evaluator, line ]( size_t pattern ) {
+                return evaluator->isFieldPattern( pattern )
+                           ? evaluator->hasFieldMatch( pattern, line )
+                           : matcher.hasMatch( line, pattern );
+            } );
+    }
+#endif
+    if constexpr ( std::is_same_v<Matcher, DefaultRegularExpressionMatcher> ) {
+        const auto text = QString::fromUtf8( line.data(), klogg::isize( line ) );
+        return evaluator->evaluateLazily(
+            matcher.patternsCount(), [ &matcher, evaluator, line, &text ]( size_t pattern ) {
+                return evaluator->isFieldPattern( pattern )
+                           ? evaluator->hasFieldMatch( pattern, line )
+                           : matcher.hasMatch( text, pattern );
+            } );
+    }
+    else {
+        return evaluator->evaluate( evaluator->withFieldMatches( line, matcher.match( line ) ) );
+    }
 }
 
-bool hasCombinedMatch( std::string_view line, const MatcherVariant& matcher,
-                       BooleanExpressionEvaluator* evaluator )
+template <bool IsCombined, bool IsInverse, typename Matcher>
+bool hasMatch( std::string_view line, const Matcher& matcher,
+               [[maybe_unused]] BooleanExpressionEvaluator* evaluator )
 {
-    auto result = std::visit( [ &line ]( const auto& m ) { return m.match( line ); }, matcher );
-    return evaluator && evaluator->evaluate( result );
+    if constexpr ( IsCombined ) {
+        return hasCombinedMatch( line, matcher, evaluator ) != IsInverse;
+    }
+    else {
+        return matcher.hasMatch( line ) != IsInverse;
+    }
 }
 
-bool hasInverseSingleMatch( std::string_view line, const MatcherVariant& matcher,
-                            BooleanExpressionEvaluator* evaluator )
+template <bool IsCombined, bool IsInverse>
+bool hasVariantMatch( std::string_view line, const MatcherVariant& matcher,
+                      BooleanExpressionEvaluator* evaluator )
 {
-    return !hasSingleMatch( line, matcher, evaluator );
+    return std::visit(
+        [ line, evaluator ]( const auto& m ) {
+            return hasMatch<IsCombined, IsInverse>( line, m, evaluator );
+        },
+        matcher );
 }
 
-bool hasInverseCombinedMatch( std::string_view line, const MatcherVariant& matcher,
-                              BooleanExpressionEvaluator* evaluator )
+// Matcher is visited once, the loop over lines is specialized for its type
+template <bool IsCombined, bool IsInverse>
+void findMatchingLines( const klogg::vector<std::string_view>& lines,
+                        const MatcherVariant& matcher, BooleanExpressionEvaluator* evaluator,
+                        klogg::vector<size_t>& matchingLines )
 {
-    return !hasCombinedMatch( line, matcher, evaluator );
+    std::visit(
+        [ &lines, evaluator, &matchingLines ]( const auto& m ) {
+            for ( size_t index = 0; index < lines.size(); ++index ) {
+                if ( hasMatch<IsCombined, IsInverse>( lines[ index ], m, evaluator ) ) {
+                    matchingLines.push_back( index );
+                }
+            }
+        },
+        matcher );
+}
+
+template <bool IsCombined, bool IsInverse>
+void selectImplementations( PatternMatcher::MatchFunc& matchFunc,
+                            PatternMatcher::FindLinesFunc& findLinesFunc )
+{
+    matchFunc = hasVariantMatch<IsCombined, IsInverse>;
+    findLinesFunc = findMatchingLines<IsCombined, IsInverse>;
 }
 
 } // namespace matching
@@ -187,25 +454,34 @@ bool hasInverseCombinedMatch( std::string_view line, const MatcherVariant& match
 PatternMatcher::PatternMatcher( const RegularExpression& expression )
     : isInverse_( expression.isInverse_ )
     , isBooleanCombination_( expression.isBooleanCombination_ )
+    , isPlainText_( expression.subPatterns_.front().isPlainText )
     , mainPatternId_( expression.subPatterns_.front().id() )
+    , requiredLiteral_( expression.requiredLiteral_.text )
+    , fieldQuery_( expression.fieldQuery_ )
     , matcher_( expression.hsExpression_.createMatcher() )
 {
     const auto& config = Configuration::get();
     const auto useHyperscanEngine = config.regexpEngine() == RegexpEngine::Hyperscan;
     if ( !useHyperscanEngine ) {
-        matcher_ = DefaultRegularExpressionMatcher( expression.subPatterns_ );
+        matcher_ = expression.hsExpression_.createDefaultMatcher();
     }
 
     if ( expression.isBooleanCombination_ ) {
         evaluator_ = std::make_unique<BooleanExpressionEvaluator>(
-            expression.expression_.toStdString(), expression.subPatterns_ );
+            expression.booleanProgram_, expression.subPatternFields_ );
     }
 
-    if ( !isBooleanCombination_ ) {
-        hasMatchImpl_ = isInverse_ ? matching::hasInverseSingleMatch : matching::hasSingleMatch;
+    if ( !isBooleanCombination_ && !isInverse_ ) {
+        matching::selectImplementations<false, false>( hasMatchImpl_, findMatchingLinesImpl_ );
+    }
+    else if ( !isBooleanCombination_ ) {
+        matching::selectImplementations<false, true>( hasMatchImpl_, findMatchingLinesImpl_ );
+    }
+    else if ( !isInverse_ ) {
+        matching::selectImplementations<true, false>( hasMatchImpl_, findMatchingLinesImpl_ );
     }
     else {
-        hasMatchImpl_ = isInverse_ ? matching::hasInverseCombinedMatch : matching::hasCombinedMatch;
+        matching::selectImplementations<true, true>( hasMatchImpl_, findMatchingLinesImpl_ );
     }
 }
 
@@ -213,5 +489,206 @@ PatternMatcher::~PatternMatcher() = default;
 
 bool PatternMatcher::hasMatch( std::string_view line ) const
 {
+    if ( fieldQuery_ ) {
+        return fieldQuery_->matches( line ) != isInverse_;
+    }
     return hasMatchImpl_( line, matcher_, evaluator_.get() );
+}
+
+bool PatternMatcher::isInverse() const
+{
+    return isInverse_;
+}
+
+void PatternMatcher::findMatchingLines( const klogg::vector<std::string_view>& lines,
+                                        klogg::vector<size_t>& matchingLines ) const
+{
+    matchingLines.clear();
+    if ( fieldQuery_ ) {
+        for ( size_t index = 0; index < lines.size(); ++index ) {
+            if ( fieldQuery_->matches( lines[ index ] ) != isInverse_ ) {
+                matchingLines.push_back( index );
+            }
+        }
+        return;
+    }
+    findMatchingLinesImpl_( lines, matcher_, evaluator_.get(), matchingLines );
+}
+
+size_t PatternMatcher::allocatedSize() const
+{
+#ifdef KLOGG_HAS_HS
+    return std::visit(
+        []( const auto& matcher ) -> size_t {
+            using Matcher = std::decay_t<decltype( matcher )>;
+            if constexpr ( std::is_base_of_v<HsMatcher, Matcher> ) {
+                return matcher.scratchSize();
+            }
+            else {
+                return 0;
+            }
+        },
+        matcher_ );
+#else
+    return 0;
+#endif
+}
+
+bool PatternMatcher::matchLines( const klogg::vector<std::string_view>& lines,
+                                 klogg::vector<size_t>& matchingLines ) const
+{
+    matchingLines.clear();
+    if ( isBooleanCombination_ || fieldQuery_ || lines.empty() ) {
+        return false;
+    }
+
+    auto isMatched = false;
+#ifdef KLOGG_HAS_HS
+    if ( const auto* hsMatcher = std::get_if<HsSingleMatcher>( &matcher_ ) ) {
+        isMatched = hsMatcher->matchLines( lines, matchingLines );
+    }
+#endif
+
+    if ( !isMatched ) {
+        isMatched = matchLinesWithLiteral( lines, matchingLines );
+    }
+
+    if ( !isMatched ) {
+        return false;
+    }
+
+    invertMatchingLines( lines.size(), matchingLines );
+    return true;
+}
+
+bool PatternMatcher::matchUtf16Lines( std::string_view data,
+                                      const klogg::vector<qint64>& endOfLines, bool isBigEndian,
+                                      klogg::vector<size_t>& matchingLines ) const
+{
+    matchingLines.clear();
+    if ( isBooleanCombination_ || requiredLiteral_.empty() || !isAsciiText( requiredLiteral_ )
+         || endOfLines.empty() ) {
+        return false;
+    }
+
+    constexpr qint64 LineFeedWidth = 2;
+    const auto literal = encodeAsciiAsUtf16( requiredLiteral_, isBigEndian );
+    const std::boyer_moore_horspool_searcher searcher( literal.begin(), literal.end() );
+
+    auto nextLine = endOfLines.begin();
+    auto position = data.begin();
+    while ( nextLine != endOfLines.end() ) {
+        position = std::search( position, data.end(), searcher );
+        if ( position == data.end() ) {
+            break;
+        }
+
+        // Literal starting in the middle of a code unit is not in the text
+        const auto offset = static_cast<qint64>( position - data.begin() );
+        if ( offset % 2 != 0 ) {
+            ++position;
+            continue;
+        }
+
+        const auto line = std::upper_bound( nextLine, endOfLines.end(), offset );
+        if ( line == endOfLines.end() ) {
+            break;
+        }
+
+        // Plain text pattern is the literal itself
+        const auto lineStart = line == endOfLines.begin() ? qint64{ 0 } : *std::prev( line );
+        const auto lineSize = std::max( *line - lineStart - LineFeedWidth, qint64{ 0 } );
+        if ( isPlainText_
+             || matching::hasVariantMatch<false, false>(
+                 decodeUtf16AsUtf8( data.substr( static_cast<size_t>( lineStart ),
+                                                 static_cast<size_t>( lineSize ) ),
+                                    isBigEndian ),
+                 matcher_, nullptr ) ) {
+            matchingLines.push_back( static_cast<size_t>( line - endOfLines.begin() ) );
+        }
+
+        nextLine = std::next( line );
+        position = data.begin() + std::min( *line, static_cast<qint64>( data.size() ) );
+    }
+
+    invertMatchingLines( endOfLines.size(), matchingLines );
+    return true;
+}
+
+std::optional<bool> PatternMatcher::hasMatchInParts( const LinePartsReader& readParts ) const
+{
+#ifdef KLOGG_HAS_HS
+    const auto* hsMatcher = std::get_if<HsSingleMatcher>( &matcher_ );
+    if ( isBooleanCombination_ || fieldQuery_ || hsMatcher == nullptr ) {
+        return std::nullopt;
+    }
+
+    const auto isMatching = hsMatcher->hasStreamMatch( readParts );
+    if ( !isMatching ) {
+        return std::nullopt;
+    }
+    return *isMatching != isInverse_;
+#else
+    Q_UNUSED( readParts );
+    return std::nullopt;
+#endif
+}
+
+void PatternMatcher::invertMatchingLines( size_t linesCount,
+                                          klogg::vector<size_t>& matchingLines ) const
+{
+    if ( !isInverse_ ) {
+        return;
+    }
+
+    klogg::vector<size_t> otherLines;
+    otherLines.reserve( linesCount - matchingLines.size() );
+    auto nextMatch = matchingLines.cbegin();
+    for ( size_t index = 0; index < linesCount; ++index ) {
+        if ( nextMatch != matchingLines.cend() && *nextMatch == index ) {
+            ++nextMatch;
+        }
+        else {
+            otherLines.push_back( index );
+        }
+    }
+    matchingLines = std::move( otherLines );
+}
+
+bool PatternMatcher::matchLinesWithLiteral( const klogg::vector<std::string_view>& lines,
+                                            klogg::vector<size_t>& matchingLines ) const
+{
+    if ( requiredLiteral_.empty() || !areConsecutiveLines( lines ) ) {
+        return false;
+    }
+
+    const auto* dataBegin = lines.front().data();
+    const auto data = std::string_view(
+        dataBegin,
+        static_cast<size_t>( lines.back().data() + lines.back().size() - dataBegin ) );
+
+    auto nextLine = lines.begin();
+    auto literalPosition = data.find( requiredLiteral_ );
+    while ( literalPosition != std::string_view::npos ) {
+        const auto* literal = data.data() + literalPosition;
+        const auto line = std::prev( std::upper_bound(
+            nextLine, lines.end(), literal,
+            []( const char* position, std::string_view l ) { return position < l.data(); } ) );
+
+        // Plain text pattern is the literal itself
+        if ( isPlainText_
+             || matching::hasVariantMatch<false, false>( *line, matcher_, nullptr ) ) {
+            matchingLines.push_back( static_cast<size_t>( line - lines.begin() ) );
+        }
+
+        nextLine = std::next( line );
+        if ( nextLine == lines.end() ) {
+            break;
+        }
+
+        literalPosition
+            = data.find( requiredLiteral_, static_cast<size_t>( nextLine->data() - dataBegin ) );
+    }
+
+    return true;
 }
\ No newline at end of file
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wordsmatcher.h"
+
+#include <algorithm>
+#include <queue>
+
+WordsMatcher::WordsMatcher( const QStringList& words )
+{
+    states_.emplace_back();
+    lengths_.reserve( static_cast<size_t>( words.size() ) );
+
+    // Trie of the words
+    for ( auto word = 0; word < words.size(); ++word ) {
+        const auto& text = words.at( word );
+        lengths_.push_back( klogg::isize( text ) );
+        if ( text.isEmpty() ) {
+            continue;
+        }
+
+        uint32_t state = 0;
+        for ( const auto character : text ) {
+            const auto unit = static_cast<char16_t>( character.unicode() );
+            auto& transitions = states_[ state ].next;
+            auto transition = std::lower_bound(
+                transitions.begin(), transitions.end(), unit,
+                []( const auto& lhs, char16_t rhs ) { return lhs.first < rhs; } );
+            if ( transition == transitions.end() || transition->first != unit ) {
+                const auto newState = static_cast<uint32_t>( states_.size() );
+                transitions.insert( transition, { unit, newState } );
+                states_.emplace_back();
+                state = newState;
+            }
+            else {
+                state = transition->second;
+            }
+        }
+        states_[ state ].words.push_back( word );
+    }
+
+    // Failure links by breadth first walk, a state fails to the longest
+    // suffix of its text that is also a prefix of a word
+    std::queue<uint32_t> pending;
+    for ( const auto& transition : states_[ 0 ].next ) {
+        pending.push( transition.second );
+    }
+
+    while ( !pending.empty() ) {
+        const auto state = pending.front();
+        pending.pop();
+
+        const auto failure = states_[ state ].failure;
+        states_[ state ].output
+            = states_[ failure ].words.empty() ? states_[ failure ].output : failure;
+
+        for ( const auto& [ unit, child ] : states_[ state ].next ) {
+            auto childFailure = state == 0 ? 0 : next( failure, unit );
+            states_[ child ].failure = childFailure;
+            pending.push( child );
+        }
+    }
+}
+
+bool WordsMatcher::isEmpty() const
+{
+    return states_.size() <= 1;
+}
+
+uint32_t WordsMatcher::next( uint32_t state, char16_t unit ) const
+{
+    while ( true ) {
+        const auto& transitions = states_[ state ].next;
+        const auto transition = std::lower_bound(
+            transitions.begin(), transitions.end(), unit,
+            []( const auto& lhs, char16_t rhs ) { return lhs.first < rhs; } );
+        if ( transition != transitions.end() && transition->first == unit ) {
+            return transition->second;
+        }
+        if ( state == 0 ) {
+            return 0;
+        }
+        state = states_[ state ].failure;
+    }
+}
+
+void WordsMatcher::match( const QString& line, klogg::vector<Match>& matches ) const
+{
+    if ( isEmpty() ) {
+        return;
+    }
+
+    const auto firstMatch = matches.size();
+
+    // End of the last occurrence of each word, later ones can't overlap it
+    klogg::vector<int> wordEnds( lengths_.size(), 0 );
+
+    const auto addWords = [ & ]( const State& state, int end ) {
+        for ( const auto word : state.words ) {
+            const auto length = lengths_[ static_cast<size_t>( word ) ];
+            const auto start = end - length;
+            if ( start >= wordEnds[ static_cast<size_t>( word ) ] ) {
+                wordEnds[ static_cast<size_t>( word ) ] = end;
+                matches.push_back( { word, start, length } );
+            }
+        }
+    };
+
+    uint32_t state = 0;
+    for ( auto position = 0; position < line.size(); ++position ) {
+        state = next( state, static_cast<char16_t>( line.at( position ).unicode() ) );
+
+        for ( auto output = state; output != NoState; output = states_[ output ].output ) {
+            addWords( states_[ output ], position + 1 );
+        }
+    }
+
+    // Occurrences are found by their end, which is also the order of
+    // their starts for each word
+    std::stable_sort( matches.begin() + static_cast<std::ptrdiff_t>( firstMatch ), matches.end(),
+                      []( const Match& lhs, const Match& rhs ) { return lhs.word < rhs.word; } );
+}
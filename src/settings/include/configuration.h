@@ -149,6 +149,15 @@ class Configuration final : public Persistable<Configuration> {
         fastModificationDetection_ = fastDetection;
     }
 
+    bool chainRotatedFiles() const
+    {
+        return chainRotatedFiles_;
+    }
+    void setChainRotatedFiles( bool chain )
+    {
+        chainRotatedFiles_ = chain;
+    }
+
     bool loadLastSession() const
     {
         return loadLastSession_;
@@ -157,6 +166,22 @@ class Configuration final : public Persistable<Configuration> {
     {
         loadLastSession_ = enabled;
     }
+    bool loadSessionLazily() const
+    {
+        return loadSessionLazily_;
+    }
+    void setLoadSessionLazily( bool enabled )
+    {
+        loadSessionLazily_ = enabled;
+    }
+    int sessionPreloadedFiles() const
+    {
+        return sessionPreloadedFiles_;
+    }
+    void setSessionPreloadedFiles( int files )
+    {
+        sessionPreloadedFiles_ = files;
+    }
     bool followFileOnLoad() const
     {
         return followFileOnLoad_;
@@ -183,6 +208,182 @@ class Configuration final : public Persistable<Configuration> {
     {
         useParallelSearch_ = enabled;
     }
+    bool useParallelIndexing() const
+    {
+        return useParallelIndexing_;
+    }
+    void setUseParallelIndexing( bool enabled )
+    {
+        useParallelIndexing_ = enabled;
+    }
+    bool useMappedFileIndexing() const
+    {
+        return useMappedFileIndexing_ || lowMemoryProfile_;
+    }
+    void setUseMappedFileIndexing( bool enabled )
+    {
+        useMappedFileIndexing_ = enabled;
+    }
+    bool mapWritableFiles() const
+    {
+        return mapWritableFiles_;
+    }
+    void setMapWritableFiles( bool enabled )
+    {
+        mapWritableFiles_ = enabled;
+    }
+    bool useIndexCache() const
+    {
+        return useIndexCache_;
+    }
+    void setUseIndexCache( bool enabled )
+    {
+        useIndexCache_ = enabled;
+    }
+    bool writeIndexNextToFile() const
+    {
+        return writeIndexNextToFile_;
+    }
+    void setWriteIndexNextToFile( bool enabled )
+    {
+        writeIndexNextToFile_ = enabled;
+    }
+    QString sharedIndexDirectory() const
+    {
+        return sharedIndexDirectory_;
+    }
+    void setSharedIndexDirectory( const QString& directory )
+    {
+        sharedIndexDirectory_ = directory;
+    }
+    bool cacheNetworkFiles() const
+    {
+        return cacheNetworkFiles_;
+    }
+    void setCacheNetworkFiles( bool enabled )
+    {
+        cacheNetworkFiles_ = enabled;
+    }
+    int networkFileCacheMb() const
+    {
+        return networkFileCacheMb_;
+    }
+    void setNetworkFileCacheMb( int limit )
+    {
+        networkFileCacheMb_ = limit;
+    }
+    bool deferInactiveUpdates() const
+    {
+        return deferInactiveUpdates_;
+    }
+    void setDeferInactiveUpdates( bool enabled )
+    {
+        deferInactiveUpdates_ = enabled;
+    }
+    bool useTailFirstIndexing() const
+    {
+        return useTailFirstIndexing_;
+    }
+    void setUseTailFirstIndexing( bool enabled )
+    {
+        useTailFirstIndexing_ = enabled;
+    }
+    bool liveViewWhileIndexing() const
+    {
+        return liveViewWhileIndexing_;
+    }
+    void setLiveViewWhileIndexing( bool enabled )
+    {
+        liveViewWhileIndexing_ = enabled;
+    }
+    int stdinSpoolLimitMb() const
+    {
+        return stdinSpoolLimitMb_;
+    }
+    void setStdinSpoolLimitMb( int limit )
+    {
+        stdinSpoolLimitMb_ = limit;
+    }
+    bool useLazyTabExpansion() const
+    {
+        return useLazyTabExpansion_;
+    }
+    void setUseLazyTabExpansion( bool enabled )
+    {
+        useLazyTabExpansion_ = enabled;
+    }
+    bool useSparseLineIndex() const
+    {
+        return useSparseLineIndex_ || lowMemoryProfile_;
+    }
+    void setUseSparseLineIndex( bool enabled )
+    {
+        useSparseLineIndex_ = enabled;
+    }
+    bool useTrigramIndex() const
+    {
+        return useTrigramIndex_ && !lowMemoryProfile_;
+    }
+    void setUseTrigramIndex( bool enabled )
+    {
+        useTrigramIndex_ = enabled;
+    }
+    bool useTokenFilters() const
+    {
+        return useTokenFilters_ && !lowMemoryProfile_;
+    }
+    void setUseTokenFilters( bool enabled )
+    {
+        useTokenFilters_ = enabled;
+    }
+    bool useFieldIndex() const
+    {
+        return useFieldIndex_ && !lowMemoryProfile_;
+    }
+    void setUseFieldIndex( bool enabled )
+    {
+        useFieldIndex_ = enabled;
+    }
+    bool useLineHashIndex() const
+    {
+        return useLineHashIndex_ && !lowMemoryProfile_;
+    }
+    void setUseLineHashIndex( bool enabled )
+    {
+        useLineHashIndex_ = enabled;
+    }
+    bool useLevelIndex() const
+    {
+        return useLevelIndex_ && !lowMemoryProfile_;
+    }
+    void setUseLevelIndex( bool enabled )
+    {
+        useLevelIndex_ = enabled;
+    }
+    int levelSearchedBytes() const
+    {
+        return levelSearchedBytes_;
+    }
+    void setLevelSearchedBytes( int bytes )
+    {
+        levelSearchedBytes_ = bytes;
+    }
+    bool searchTimeHistogram() const
+    {
+        return searchTimeHistogram_;
+    }
+    void setSearchTimeHistogram( bool enabled )
+    {
+        searchTimeHistogram_ = enabled;
+    }
+    bool keepCompiledPatternsOnDisk() const
+    {
+        return keepCompiledPatternsOnDisk_;
+    }
+    void setKeepCompiledPatternsOnDisk( bool enabled )
+    {
+        keepCompiledPatternsOnDisk_ = enabled;
+    }
     bool useSearchResultsCache() const
     {
         return useSearchResultsCache_;
@@ -191,6 +392,54 @@ class Configuration final : public Persistable<Configuration> {
     {
         useSearchResultsCache_ = enabled;
     }
+    int searchResultsCacheSizeMb() const
+    {
+        return lowMemoryLimit( searchResultsCacheSizeMb_, LowMemorySearchCacheMb );
+    }
+    void setSearchResultsCacheSizeMb( int sizeMb )
+    {
+        searchResultsCacheSizeMb_ = sizeMb;
+    }
+    bool searchFromViewFirst() const
+    {
+        return searchFromViewFirst_;
+    }
+    void setSearchFromViewFirst( bool enabled )
+    {
+        searchFromViewFirst_ = enabled;
+    }
+    bool keepSearchResultsOnDisk() const
+    {
+        return keepSearchResultsOnDisk_ || lowMemoryProfile_;
+    }
+    void setKeepSearchResultsOnDisk( bool enabled )
+    {
+        keepSearchResultsOnDisk_ = enabled;
+    }
+    bool mapLargeSearchResults() const
+    {
+        return mapLargeSearchResults_ || lowMemoryProfile_;
+    }
+    void setMapLargeSearchResults( bool enabled )
+    {
+        mapLargeSearchResults_ = enabled;
+    }
+    bool useSpeculativeSearches() const
+    {
+        return useSpeculativeSearches_ && !lowMemoryProfile_;
+    }
+    void setUseSpeculativeSearches( bool enabled )
+    {
+        useSpeculativeSearches_ = enabled;
+    }
+    int speculativeSearchesCount() const
+    {
+        return speculativeSearchesCount_;
+    }
+    void setSpeculativeSearchesCount( int count )
+    {
+        speculativeSearchesCount_ = count;
+    }
     unsigned searchResultsCacheLines() const
     {
         return searchResultsCacheLines_;
@@ -201,12 +450,36 @@ class Configuration final : public Persistable<Configuration> {
     }
     int indexReadBufferSizeMb() const
     {
-        return indexReadBufferSizeMb_;
+        return lowMemoryLimit( indexReadBufferSizeMb_, LowMemoryIndexReadBufferMb );
     }
     void setIndexReadBufferSizeMb( int bufferSizeMb )
     {
         indexReadBufferSizeMb_ = bufferSizeMb;
     }
+    bool autoIndexReadBuffer() const
+    {
+        return autoIndexReadBuffer_ && !lowMemoryProfile_;
+    }
+    void setAutoIndexReadBuffer( bool enabled )
+    {
+        autoIndexReadBuffer_ = enabled;
+    }
+    int indexReadQueueDepth() const
+    {
+        return indexReadQueueDepth_;
+    }
+    void setIndexReadQueueDepth( int depth )
+    {
+        indexReadQueueDepth_ = depth;
+    }
+    int smallFileSizeKb() const
+    {
+        return smallFileSizeKb_;
+    }
+    void setSmallFileSizeKb( int sizeKb )
+    {
+        smallFileSizeKb_ = sizeKb;
+    }
     int searchReadBufferSizeLines() const
     {
         return searchReadBufferSizeLines_;
@@ -217,12 +490,80 @@ class Configuration final : public Persistable<Configuration> {
     }
     int searchThreadPoolSize() const
     {
-        return searchThreadPoolSize_;
+        return lowMemoryLimit( searchThreadPoolSize_, LowMemorySearchThreads );
     }
     void setSearchThreadPoolSize( int threads )
     {
         searchThreadPoolSize_ = threads;
     }
+    int searchReadThreads() const
+    {
+        return searchReadThreads_;
+    }
+    void setSearchReadThreads( int threads )
+    {
+        searchReadThreads_ = threads;
+    }
+    bool nativeUtf16Search() const
+    {
+        return nativeUtf16Search_;
+    }
+    void setNativeUtf16Search( bool enabled )
+    {
+        nativeUtf16Search_ = enabled;
+    }
+    int maxConcurrency() const
+    {
+        return maxConcurrency_;
+    }
+    void setMaxConcurrency( int threads )
+    {
+        maxConcurrency_ = threads;
+    }
+    bool useNumaArenas() const
+    {
+        return useNumaArenas_;
+    }
+    void setUseNumaArenas( bool enabled )
+    {
+        useNumaArenas_ = enabled;
+    }
+    // The configured budget is kept by the low memory profile, it is its target
+    int memoryBudgetMb() const
+    {
+        return lowMemoryProfile_ && memoryBudgetMb_ <= 0 ? LowMemoryBudgetMb : memoryBudgetMb_;
+    }
+    void setMemoryBudgetMb( int budget )
+    {
+        memoryBudgetMb_ = budget;
+    }
+    int lineIndexMemoryMb() const
+    {
+        return lowMemoryLimit( lineIndexMemoryMb_, LowMemoryLineIndexMb );
+    }
+    void setLineIndexMemoryMb( int limit )
+    {
+        lineIndexMemoryMb_ = limit;
+    }
+    // Settings of features that take memory are overridden to keep the memory
+    // of klogg within a few hundred megabytes whatever the size of files.
+    // Values set for them are kept and used again without the profile.
+    bool lowMemoryProfile() const
+    {
+        return lowMemoryProfile_;
+    }
+    void setLowMemoryProfile( bool enabled )
+    {
+        lowMemoryProfile_ = enabled;
+    }
+    bool useHugePages() const
+    {
+        return useHugePages_;
+    }
+    void setUseHugePages( bool enabled )
+    {
+        useHugePages_ = enabled;
+    }
     bool keepFileClosed() const
     {
         return keepFileClosed_;
@@ -231,6 +572,14 @@ class Configuration final : public Persistable<Configuration> {
     {
         keepFileClosed_ = shouldKeepClosed;
     }
+    bool useFastFollow() const
+    {
+        return useFastFollow_;
+    }
+    void setUseFastFollow( bool enabled )
+    {
+        useFastFollow_ = enabled;
+    }
 
     RegexpEngine regexpEngine() const
     {
@@ -356,6 +705,15 @@ class Configuration final : public Persistable<Configuration> {
         extractArchivesAlways_ = extract;
     }
 
+    bool openCompressedInPlace() const
+    {
+        return openCompressedInPlace_;
+    }
+    void setOpenCompressedInPlace( bool inPlace )
+    {
+        openCompressedInPlace_ = inPlace;
+    }
+
     bool verifySslPeers() const
     {
         return verifySslPeers_;
@@ -491,6 +849,16 @@ class Configuration final : public Persistable<Configuration> {
         hideAnsiColorSequences_ = hide;
     }
 
+    // Format of timestamps at the beginning of lines, used to jump to a time
+    QString timestampFormat() const
+    {
+        return timestampFormat_;
+    }
+    void setTimestampFormat( const QString& format )
+    {
+        timestampFormat_ = format;
+    }
+
     int defaultEncodingMib() const
     {
         return defaultEncodingMib_;
@@ -508,9 +876,28 @@ class Configuration final : public Persistable<Configuration> {
     void saveToStorage( QSettings& settings ) const;
     void retrieveFromStorage( QSettings& settings );
 
+    // Font is resolved in the GUI thread, settings are written by another one
+    void prepareSave() const;
+
   private:
+    // Limits of the low memory profile
+    static constexpr int LowMemoryBudgetMb = 384;
+    static constexpr int LowMemoryLineIndexMb = 64;
+    static constexpr int LowMemoryIndexReadBufferMb = 4;
+    static constexpr int LowMemorySearchCacheMb = 32;
+    static constexpr int LowMemorySearchThreads = 2;
+
+    // Lower of the value and the limit while the low memory profile is used,
+    // values of 0 mean no limit or automatic
+    int lowMemoryLimit( int value, int limit ) const
+    {
+        return lowMemoryProfile_ && ( value <= 0 || value > limit ) ? limit : value;
+    }
+
     // Configuration settings
     mutable QFont mainFont_ = { "DejaVu Sans Mono", 10 };
+    mutable QString savedFontFamily_;
+    mutable int savedFontSize_ = 0;
     SearchRegexpType mainRegexpType_ = SearchRegexpType::ExtendedRegexp;
     SearchRegexpType quickfindRegexpType_ = SearchRegexpType::FixedString;
     bool quickfindIncremental_ = true;
@@ -527,8 +914,11 @@ class Configuration final : public Persistable<Configuration> {
     int pollIntervalMs_ = 2000;
 
     bool fastModificationDetection_ = false;
+    bool chainRotatedFiles_ = false;
 
     bool loadLastSession_ = true;
+    bool loadSessionLazily_ = false;
+    int sessionPreloadedFiles_ = 0;
     bool followFileOnLoad_ = false;
     bool allowMultipleWindows_ = false;
 
@@ -547,11 +937,53 @@ class Configuration final : public Persistable<Configuration> {
     // Performance settings
     bool useSearchResultsCache_ = true;
     unsigned searchResultsCacheLines_ = 1000000;
+    int searchResultsCacheSizeMb_ = 256;
+    bool keepSearchResultsOnDisk_ = true;
+    bool mapLargeSearchResults_ = true;
+    bool useSpeculativeSearches_ = false;
+    int speculativeSearchesCount_ = 3;
+    bool searchFromViewFirst_ = true;
     bool useParallelSearch_ = true;
+    bool useParallelIndexing_ = true;
+    bool useMappedFileIndexing_ = true;
+    bool mapWritableFiles_ = false;
+    bool useIndexCache_ = true;
+    bool writeIndexNextToFile_ = false;
+    QString sharedIndexDirectory_;
+    bool cacheNetworkFiles_ = false;
+    int networkFileCacheMb_ = 8192;
+    bool deferInactiveUpdates_ = true;
+    bool useTailFirstIndexing_ = true;
+    bool liveViewWhileIndexing_ = true;
+    // 0 to keep all data of the standard input
+    int stdinSpoolLimitMb_ = 1024;
+    bool useLazyTabExpansion_ = false;
+    bool useSparseLineIndex_ = false;
+    bool useTrigramIndex_ = false;
+    bool useTokenFilters_ = false;
+    bool useFieldIndex_ = false;
+    bool useLineHashIndex_ = false;
+    bool useLevelIndex_ = false;
+    // Level words are looked for at the beginning of lines
+    int levelSearchedBytes_ = 128;
+    bool searchTimeHistogram_ = true;
+    bool keepCompiledPatternsOnDisk_ = false;
     int indexReadBufferSizeMb_ = 16;
+    bool autoIndexReadBuffer_ = true;
+    int indexReadQueueDepth_ = 4;
+    int smallFileSizeKb_ = 1024;
     int searchReadBufferSizeLines_ = 10000;
     int searchThreadPoolSize_ = 0;
+    int searchReadThreads_ = 1;
+    bool nativeUtf16Search_ = true;
+    int maxConcurrency_ = 0;
+    bool useNumaArenas_ = false;
+    int memoryBudgetMb_ = 0;
+    int lineIndexMemoryMb_ = 0;
+    bool lowMemoryProfile_ = false;
+    bool useHugePages_ = false;
     bool keepFileClosed_ = false;
+    bool useFastFollow_ = true;
 
     bool enableLogging_ = false;
     int loggingLevel_ = 4;
@@ -560,6 +992,7 @@ class Configuration final : public Persistable<Configuration> {
 
     bool extractArchives_ = true;
     bool extractArchivesAlways_ = false;
+    bool openCompressedInPlace_ = false;
 
     bool verifySslPeers_ = true;
 
@@ -582,6 +1015,8 @@ class Configuration final : public Persistable<Configuration> {
 
     bool hideAnsiColorSequences_ = false;
 
+    QString timestampFormat_{ "yyyy-MM-dd HH:mm:ss" };
+
     int defaultEncodingMib_ = -1;
 
     bool qfIgnoreCase_ = false;
@@ -20,11 +20,13 @@
 #ifndef KLOGG_PERSISTABLE_H
 #define KLOGG_PERSISTABLE_H
 
+#include <memory>
 #include <type_traits>
 #include <stdexcept>
 
 #include "log.h"
 #include "persistentinfo.h"
+#include "tracing.h"
 
 class QSettings;
 
@@ -44,10 +46,23 @@ class Persistable {
         return persistable;
     }
 
+    // Settings are written by a background thread from a copy,
+    // several saves in a row are written once
     void save() const
     {
-        auto& settings = PersistentInfo::getSettings( SettingsType{} );
-        static_cast<const T&>( *this ).saveToStorage( settings );
+        const TraceSpan span( "save settings", "settings" );
+        static_cast<const T&>( *this ).prepareSave();
+        auto copy = std::make_shared<const T>( static_cast<const T&>( *this ) );
+        PersistentInfo::saveLater(
+            SettingsType{}, T::persistableName(),
+            [ copy ]( QSettings& settings ) { copy->saveToStorage( settings ); } );
+    }
+
+  protected:
+    // Called in the GUI thread before the copy to save is taken, e.g. to
+    // resolve values that can't be resolved by the thread writing settings
+    void prepareSave() const
+    {
     }
 
   private:
@@ -71,6 +86,7 @@ class Persistable {
     {
         auto& settings = PersistentInfo::getSettings( SettingsType{} );
 
+        PersistentInfo::flush();
         settings.sync();
         static_cast<T&>( *this ).retrieveFromStorage( settings );
     }
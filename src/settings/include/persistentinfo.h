@@ -39,6 +39,7 @@
 #ifndef KLOGG_PERSISTENTINFO_H
 #define KLOGG_PERSISTENTINFO_H
 
+#include <functional>
 #include <memory>
 
 #include <QSettings>
@@ -51,11 +52,24 @@ struct app_settings {
 struct session_settings {
 };
 
+class SettingsWriter;
+
 class PersistentInfo {
   public:
+    ~PersistentInfo();
+
     static QSettings& getSettings( app_settings );
     static QSettings& getSettings( session_settings );
 
+    // Writes are done by a background thread shortly after they are requested,
+    // a write replaces the not yet done one with the same name
+    using Write = std::function<void( QSettings& )>;
+    static void saveLater( app_settings, const QString& name, Write write );
+    static void saveLater( session_settings, const QString& name, Write write );
+
+    // Does the requested writes now and waits for them
+    static void flush();
+
   private:
     static const bool ForcePortable;
 
@@ -69,5 +83,8 @@ class PersistentInfo {
 
     std::unique_ptr<QSettings> appSettings_;
     std::unique_ptr<QSettings> sessionSettings_;
+
+    // Stopped before settings are destroyed
+    std::unique_ptr<SettingsWriter> writer_;
 };
 #endif
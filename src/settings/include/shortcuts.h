@@ -106,6 +106,8 @@ struct ShortcutAction {
     static constexpr auto LogViewReplaceSearch = "logview.replace_search";
     static constexpr auto LogViewSelectLinesUp = "logview.select_lines_up";
     static constexpr auto LogViewSelectLinesDown = "logview.select_lines_down";
+
+    static constexpr auto LogViewToggleRenderStats = "logview.toggle_render_stats";
     
     static const std::map<std::string, QStringList>& defaultShortcuts();
 
@@ -180,6 +180,10 @@ void Configuration::retrieveFromStorage( QSettings& settings )
                                              DefaultConfiguration.fastModificationDetection_ )
                                      .toBool();
 
+    chainRotatedFiles_
+        = settings.value( "filewatch.chainRotatedFiles", DefaultConfiguration.chainRotatedFiles_ )
+              .toBool();
+
     allowFollowOnScroll_
         = settings
               .value( "filewatch.allowFollowOnScroll", DefaultConfiguration.allowFollowOnScroll_ )
@@ -187,6 +191,11 @@ void Configuration::retrieveFromStorage( QSettings& settings )
 
     loadLastSession_
         = settings.value( "session.loadLast", DefaultConfiguration.loadLastSession_ ).toBool();
+    loadSessionLazily_
+        = settings.value( "session.loadLazily", DefaultConfiguration.loadSessionLazily_ ).toBool();
+    sessionPreloadedFiles_
+        = settings.value( "session.preloadedFiles", DefaultConfiguration.sessionPreloadedFiles_ )
+              .toInt();
     allowMultipleWindows_
         = settings.value( "session.multipleWindows", DefaultConfiguration.allowMultipleWindows_ )
               .toBool();
@@ -207,11 +216,88 @@ void Configuration::retrieveFromStorage( QSettings& settings )
     extractArchivesAlways_
         = settings.value( "archives.extractAlways", DefaultConfiguration.extractArchivesAlways_ )
               .toBool();
+    openCompressedInPlace_ = settings
+                                 .value( "archives.openCompressedInPlace",
+                                         DefaultConfiguration.openCompressedInPlace_ )
+                                 .toBool();
 
     // "Perf" settings
     useParallelSearch_
         = settings.value( "perf.useParallelSearch", DefaultConfiguration.useParallelSearch_ )
               .toBool();
+    useParallelIndexing_
+        = settings.value( "perf.useParallelIndexing", DefaultConfiguration.useParallelIndexing_ )
+              .toBool();
+    useMappedFileIndexing_ = settings
+                                 .value( "perf.useMappedFileIndexing",
+                                         DefaultConfiguration.useMappedFileIndexing_ )
+                                 .toBool();
+    mapWritableFiles_
+        = settings.value( "perf.mapWritableFiles", DefaultConfiguration.mapWritableFiles_ )
+              .toBool();
+    useIndexCache_
+        = settings.value( "perf.useIndexCache", DefaultConfiguration.useIndexCache_ ).toBool();
+    writeIndexNextToFile_ = settings
+                                .value( "perf.writeIndexNextToFile",
+                                        DefaultConfiguration.writeIndexNextToFile_ )
+                                .toBool();
+    sharedIndexDirectory_ = settings
+                                .value( "perf.sharedIndexDirectory",
+                                        DefaultConfiguration.sharedIndexDirectory_ )
+                                .toString();
+    cacheNetworkFiles_
+        = settings.value( "perf.cacheNetworkFiles", DefaultConfiguration.cacheNetworkFiles_ )
+              .toBool();
+    networkFileCacheMb_
+        = settings.value( "perf.networkFileCacheMb", DefaultConfiguration.networkFileCacheMb_ )
+              .toInt();
+    deferInactiveUpdates_ = settings
+                                .value( "perf.deferInactiveUpdates",
+                                        DefaultConfiguration.deferInactiveUpdates_ )
+                                .toBool();
+    useTailFirstIndexing_ = settings
+                                .value( "perf.useTailFirstIndexing",
+                                        DefaultConfiguration.useTailFirstIndexing_ )
+                                .toBool();
+    liveViewWhileIndexing_ = settings
+                                 .value( "perf.liveViewWhileIndexing",
+                                         DefaultConfiguration.liveViewWhileIndexing_ )
+                                 .toBool();
+    stdinSpoolLimitMb_
+        = settings.value( "perf.stdinSpoolLimitMb", DefaultConfiguration.stdinSpoolLimitMb_ )
+              .toInt();
+    useLazyTabExpansion_ = settings
+                               .value( "perf.useLazyTabExpansion",
+                                       DefaultConfiguration.useLazyTabExpansion_ )
+                               .toBool();
+    useSparseLineIndex_ = settings
+                              .value( "perf.useSparseLineIndex",
+                                      DefaultConfiguration.useSparseLineIndex_ )
+                              .toBool();
+    useTrigramIndex_
+        = settings.value( "perf.useTrigramIndex", DefaultConfiguration.useTrigramIndex_ )
+              .toBool();
+    useTokenFilters_
+        = settings.value( "perf.useTokenFilters", DefaultConfiguration.useTokenFilters_ )
+              .toBool();
+    useFieldIndex_
+        = settings.value( "perf.useFieldIndex", DefaultConfiguration.useFieldIndex_ ).toBool();
+    useLineHashIndex_
+        = settings.value( "perf.useLineHashIndex", DefaultConfiguration.useLineHashIndex_ )
+              .toBool();
+    useLevelIndex_
+        = settings.value( "perf.useLevelIndex", DefaultConfiguration.useLevelIndex_ ).toBool();
+    levelSearchedBytes_ = std::max(
+        1, settings.value( "perf.levelSearchedBytes", DefaultConfiguration.levelSearchedBytes_ )
+               .toInt() );
+    searchTimeHistogram_ = settings
+                               .value( "perf.searchTimeHistogram",
+                                       DefaultConfiguration.searchTimeHistogram_ )
+                               .toBool();
+    keepCompiledPatternsOnDisk_ = settings
+                                      .value( "perf.keepCompiledPatternsOnDisk",
+                                              DefaultConfiguration.keepCompiledPatternsOnDisk_ )
+                                      .toBool();
     useSearchResultsCache_
         = settings
               .value( "perf.useSearchResultsCache", DefaultConfiguration.useSearchResultsCache_ )
@@ -220,10 +306,42 @@ void Configuration::retrieveFromStorage( QSettings& settings )
                                    .value( "perf.searchResultsCacheLines",
                                            DefaultConfiguration.searchResultsCacheLines_ )
                                    .toUInt();
+    searchResultsCacheSizeMb_ = settings
+                                    .value( "perf.searchResultsCacheSizeMb",
+                                            DefaultConfiguration.searchResultsCacheSizeMb_ )
+                                    .toInt();
+    searchFromViewFirst_ = settings
+                               .value( "perf.searchFromViewFirst",
+                                       DefaultConfiguration.searchFromViewFirst_ )
+                               .toBool();
+    keepSearchResultsOnDisk_ = settings
+                                   .value( "perf.keepSearchResultsOnDisk",
+                                           DefaultConfiguration.keepSearchResultsOnDisk_ )
+                                   .toBool();
+    mapLargeSearchResults_ = settings
+                                 .value( "perf.mapLargeSearchResults",
+                                         DefaultConfiguration.mapLargeSearchResults_ )
+                                 .toBool();
+    useSpeculativeSearches_ = settings
+                                  .value( "perf.useSpeculativeSearches",
+                                          DefaultConfiguration.useSpeculativeSearches_ )
+                                  .toBool();
+    speculativeSearchesCount_ = settings
+                                    .value( "perf.speculativeSearchesCount",
+                                            DefaultConfiguration.speculativeSearchesCount_ )
+                                    .toInt();
     indexReadBufferSizeMb_
         = settings
               .value( "perf.indexReadBufferSizeMb", DefaultConfiguration.indexReadBufferSizeMb_ )
               .toInt();
+    autoIndexReadBuffer_
+        = settings.value( "perf.autoIndexReadBuffer", DefaultConfiguration.autoIndexReadBuffer_ )
+              .toBool();
+    indexReadQueueDepth_
+        = settings.value( "perf.indexReadQueueDepth", DefaultConfiguration.indexReadQueueDepth_ )
+              .toInt();
+    smallFileSizeKb_
+        = settings.value( "perf.smallFileSizeKb", DefaultConfiguration.smallFileSizeKb_ ).toInt();
     searchReadBufferSizeLines_ = settings
                                      .value( "perf.searchReadBufferSizeLines",
                                              DefaultConfiguration.searchReadBufferSizeLines_ )
@@ -231,8 +349,30 @@ void Configuration::retrieveFromStorage( QSettings& settings )
     searchThreadPoolSize_
         = settings.value( "perf.searchThreadPoolSize", DefaultConfiguration.searchThreadPoolSize_ )
               .toInt();
+    searchReadThreads_
+        = settings.value( "perf.searchReadThreads", DefaultConfiguration.searchReadThreads_ )
+              .toInt();
+    nativeUtf16Search_
+        = settings.value( "perf.nativeUtf16Search", DefaultConfiguration.nativeUtf16Search_ )
+              .toBool();
+    maxConcurrency_
+        = settings.value( "perf.maxConcurrency", DefaultConfiguration.maxConcurrency_ ).toInt();
+    useNumaArenas_
+        = settings.value( "perf.useNumaArenas", DefaultConfiguration.useNumaArenas_ ).toBool();
+    memoryBudgetMb_
+        = settings.value( "perf.memoryBudgetMb", DefaultConfiguration.memoryBudgetMb_ ).toInt();
+    lineIndexMemoryMb_
+        = settings.value( "perf.lineIndexMemoryMb", DefaultConfiguration.lineIndexMemoryMb_ )
+              .toInt();
+    lowMemoryProfile_
+        = settings.value( "perf.lowMemoryProfile", DefaultConfiguration.lowMemoryProfile_ )
+              .toBool();
+    useHugePages_
+        = settings.value( "perf.useHugePages", DefaultConfiguration.useHugePages_ ).toBool();
     keepFileClosed_
         = settings.value( "perf.keepFileClosed", DefaultConfiguration.keepFileClosed_ ).toBool();
+    useFastFollow_
+        = settings.value( "perf.useFastFollow", DefaultConfiguration.useFastFollow_ ).toBool();
 
     optimizeForNotLatinEncodings_ = settings
                                         .value( "perf.optimizeForNotLatinEncodings",
@@ -261,6 +401,10 @@ void Configuration::retrieveFromStorage( QSettings& settings )
               .value( "view.hideAnsiColorSequences", DefaultConfiguration.hideAnsiColorSequences_ )
               .toBool();
 
+    timestampFormat_
+        = settings.value( "view.timestampFormat", DefaultConfiguration.timestampFormat_ )
+              .toString();
+
     useTextWrap_ = settings.value( "view.textWrap", DefaultConfiguration.useTextWrap() ).toBool();
 
     style_ = settings.value( "view.style", DefaultConfiguration.style_ ).toString();
@@ -321,14 +465,19 @@ void Configuration::retrieveFromStorage( QSettings& settings )
     settings.endGroup();
 }
 
+void Configuration::prepareSave() const
+{
+    const QFontInfo fi( mainFont_ );
+    savedFontFamily_ = fi.family();
+    savedFontSize_ = fi.pointSize();
+}
+
 void Configuration::saveToStorage( QSettings& settings ) const
 {
     LOG_DEBUG << "Configuration::saveToStorage";
 
-    QFontInfo fi( mainFont_ );
-
-    settings.setValue( "mainFont.family", fi.family() );
-    settings.setValue( "mainFont.size", fi.pointSize() );
+    settings.setValue( "mainFont.family", savedFontFamily_ );
+    settings.setValue( "mainFont.size", savedFontSize_ );
     settings.setValue( "mainFont.antialiasing", forceFontAntialiasing_ );
 
     settings.setValue( "regexpType.engine", static_cast<int>( regexpEngine_ ) );
@@ -349,9 +498,12 @@ void Configuration::saveToStorage( QSettings& settings ) const
     settings.setValue( "filewatch.usePolling", pollingEnabled_ );
     settings.setValue( "filewatch.pollingIntervalMs", pollIntervalMs_ );
     settings.setValue( "filewatch.fastModificationDetection", fastModificationDetection_ );
+    settings.setValue( "filewatch.chainRotatedFiles", chainRotatedFiles_ );
     settings.setValue( "filewatch.allowFollowOnScroll", allowFollowOnScroll_ );
 
     settings.setValue( "session.loadLast", loadLastSession_ );
+    settings.setValue( "session.loadLazily", loadSessionLazily_ );
+    settings.setValue( "session.preloadedFiles", sessionPreloadedFiles_ );
     settings.setValue( "session.multipleWindows", allowMultipleWindows_ );
     settings.setValue( "session.followOnLoad", followFileOnLoad_ );
 
@@ -362,14 +514,55 @@ void Configuration::saveToStorage( QSettings& settings ) const
 
     settings.setValue( "archives.extract", extractArchives_ );
     settings.setValue( "archives.extractAlways", extractArchivesAlways_ );
+    settings.setValue( "archives.openCompressedInPlace", openCompressedInPlace_ );
 
     settings.setValue( "perf.useParallelSearch", useParallelSearch_ );
+    settings.setValue( "perf.useParallelIndexing", useParallelIndexing_ );
+    settings.setValue( "perf.useMappedFileIndexing", useMappedFileIndexing_ );
+    settings.setValue( "perf.mapWritableFiles", mapWritableFiles_ );
+    settings.setValue( "perf.useIndexCache", useIndexCache_ );
+    settings.setValue( "perf.writeIndexNextToFile", writeIndexNextToFile_ );
+    settings.setValue( "perf.sharedIndexDirectory", sharedIndexDirectory_ );
+    settings.setValue( "perf.cacheNetworkFiles", cacheNetworkFiles_ );
+    settings.setValue( "perf.networkFileCacheMb", networkFileCacheMb_ );
+    settings.setValue( "perf.deferInactiveUpdates", deferInactiveUpdates_ );
+    settings.setValue( "perf.useTailFirstIndexing", useTailFirstIndexing_ );
+    settings.setValue( "perf.liveViewWhileIndexing", liveViewWhileIndexing_ );
+    settings.setValue( "perf.stdinSpoolLimitMb", stdinSpoolLimitMb_ );
+    settings.setValue( "perf.useLazyTabExpansion", useLazyTabExpansion_ );
+    settings.setValue( "perf.useSparseLineIndex", useSparseLineIndex_ );
+    settings.setValue( "perf.useTrigramIndex", useTrigramIndex_ );
+    settings.setValue( "perf.useTokenFilters", useTokenFilters_ );
+    settings.setValue( "perf.useFieldIndex", useFieldIndex_ );
+    settings.setValue( "perf.useLineHashIndex", useLineHashIndex_ );
+    settings.setValue( "perf.useLevelIndex", useLevelIndex_ );
+    settings.setValue( "perf.levelSearchedBytes", levelSearchedBytes_ );
+    settings.setValue( "perf.searchTimeHistogram", searchTimeHistogram_ );
+    settings.setValue( "perf.keepCompiledPatternsOnDisk", keepCompiledPatternsOnDisk_ );
     settings.setValue( "perf.useSearchResultsCache", useSearchResultsCache_ );
     settings.setValue( "perf.searchResultsCacheLines", searchResultsCacheLines_ );
+    settings.setValue( "perf.searchResultsCacheSizeMb", searchResultsCacheSizeMb_ );
+    settings.setValue( "perf.keepSearchResultsOnDisk", keepSearchResultsOnDisk_ );
+    settings.setValue( "perf.mapLargeSearchResults", mapLargeSearchResults_ );
+    settings.setValue( "perf.useSpeculativeSearches", useSpeculativeSearches_ );
+    settings.setValue( "perf.speculativeSearchesCount", speculativeSearchesCount_ );
+    settings.setValue( "perf.searchFromViewFirst", searchFromViewFirst_ );
     settings.setValue( "perf.indexReadBufferSizeMb", indexReadBufferSizeMb_ );
+    settings.setValue( "perf.autoIndexReadBuffer", autoIndexReadBuffer_ );
+    settings.setValue( "perf.indexReadQueueDepth", indexReadQueueDepth_ );
+    settings.setValue( "perf.smallFileSizeKb", smallFileSizeKb_ );
     settings.setValue( "perf.searchReadBufferSizeLines", searchReadBufferSizeLines_ );
     settings.setValue( "perf.searchThreadPoolSize", searchThreadPoolSize_ );
+    settings.setValue( "perf.searchReadThreads", searchReadThreads_ );
+    settings.setValue( "perf.nativeUtf16Search", nativeUtf16Search_ );
+    settings.setValue( "perf.maxConcurrency", maxConcurrency_ );
+    settings.setValue( "perf.useNumaArenas", useNumaArenas_ );
+    settings.setValue( "perf.memoryBudgetMb", memoryBudgetMb_ );
+    settings.setValue( "perf.lineIndexMemoryMb", lineIndexMemoryMb_ );
+    settings.setValue( "perf.lowMemoryProfile", lowMemoryProfile_ );
+    settings.setValue( "perf.useHugePages", useHugePages_ );
     settings.setValue( "perf.keepFileClosed", keepFileClosed_ );
+    settings.setValue( "perf.useFastFollow", useFastFollow_ );
     settings.setValue( "perf.optimizeForNotLatinEncodings", optimizeForNotLatinEncodings_ );
 
     settings.setValue( "net.verifySslPeers", verifySslPeers_ );
@@ -386,6 +579,7 @@ void Configuration::saveToStorage( QSettings& settings ) const
     settings.setValue( "view.scaleFactorRounding", scaleFactorRounding_ );
 
     settings.setValue( "view.hideAnsiColorSequences", hideAnsiColorSequences_ );
+    settings.setValue( "view.timestampFormat", timestampFormat_ );
 
     settings.setValue( "defaultView.searchAutoRefresh", searchAutoRefresh_ );
     settings.setValue( "defaultView.searchIgnoreCase", searchIgnoreCase_ );
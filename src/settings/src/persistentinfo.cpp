@@ -39,13 +39,22 @@
 // Implements PersistentInfo, a singleton class which store/retrieve objects
 // to persistent storage.
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <thread>
+
 #include <QCoreApplication>
 #include <QDir>
 #include <QFileInfo>
 
 #include <whereami.h>
 
+#include "containers.h"
 #include "log.h"
+#include "synchronization.h"
+#include "tracing.h"
 #include "uuid.h"
 
 #include "persistentinfo.h"
@@ -64,8 +73,126 @@ QString makeSessionSettingsPath( const QString& appConfigPath )
         .absoluteDir()
         .filePath( QString( SessionSettingsFile ) + PortableExtension );
 }
+
+// Saves made one after another, e.g. on each tab switch, are written once
+constexpr auto WriteDelay = std::chrono::milliseconds{ 500 };
 } // namespace
 
+// Writes settings in its own thread with its own QSettings objects for the
+// files of the GUI thread ones, QSettings objects of different threads
+// share the cache of the file. QSettings replaces files atomically.
+class SettingsWriter {
+  public:
+    SettingsWriter()
+        : thread_( [ this ] { run(); } )
+    {
+    }
+
+    ~SettingsWriter()
+    {
+        {
+            ScopedLock lock( mutex_ );
+            isStopping_ = true;
+        }
+        wakeUp_.notify_all();
+        thread_.join();
+    }
+
+    SettingsWriter( const SettingsWriter& ) = delete;
+    SettingsWriter& operator=( const SettingsWriter& ) = delete;
+
+    void saveLater( const QSettings& settings, const QString& name, PersistentInfo::Write write )
+    {
+        {
+            ScopedLock lock( mutex_ );
+            const auto key = settings.fileName() + '/' + name;
+            pending_[ key ] = Write{ settings.fileName(), settings.format(), std::move( write ) };
+            ++requested_;
+        }
+        wakeUp_.notify_all();
+    }
+
+    void flush()
+    {
+        ScopedLock lock( mutex_ );
+        const auto requested = requested_;
+        if ( written_ >= requested ) {
+            return;
+        }
+
+        isFlushRequested_ = true;
+        wakeUp_.notify_all();
+        writtenChanged_.wait( lock, [ this, requested ] { return written_ >= requested; } );
+    }
+
+  private:
+    struct Write {
+        QString fileName;
+        QSettings::Format format;
+        PersistentInfo::Write write;
+    };
+
+    void run()
+    {
+        // Created and destroyed in this thread
+        std::map<QString, std::unique_ptr<QSettings>> settingsFiles;
+
+        ScopedLock lock( mutex_ );
+        while ( !isStopping_ || !pending_.empty() ) {
+            wakeUp_.wait( lock, [ this ] { return isStopping_ || !pending_.empty(); } );
+            wakeUp_.wait_for( lock, WriteDelay,
+                              [ this ] { return isStopping_ || isFlushRequested_; } );
+
+            auto writes = std::move( pending_ );
+            pending_.clear();
+            isFlushRequested_ = false;
+            const auto requested = requested_;
+            lock.unlock();
+
+            {
+                const TraceSpan span( "write settings", "settings" );
+                klogg::vector<QSettings*> changedSettings;
+                for ( auto& write : writes ) {
+                    auto& settings = settingsFiles[ write.second.fileName ];
+                    if ( !settings ) {
+                        settings = std::make_unique<QSettings>( write.second.fileName,
+                                                                write.second.format );
+                    }
+                    write.second.write( *settings );
+                    if ( std::find( changedSettings.begin(), changedSettings.end(),
+                                    settings.get() )
+                         == changedSettings.end() ) {
+                        changedSettings.push_back( settings.get() );
+                    }
+                }
+
+                for ( auto* settings : changedSettings ) {
+                    settings->sync();
+                    if ( settings->status() != QSettings::NoError ) {
+                        LOG_ERROR << "Failed to write settings to " << settings->fileName();
+                    }
+                }
+            }
+
+            lock.lock();
+            written_ = requested;
+            writtenChanged_.notify_all();
+        }
+    }
+
+  private:
+    Mutex mutex_;
+    std::condition_variable_any wakeUp_;
+    std::condition_variable_any writtenChanged_;
+    std::map<QString, Write> pending_;
+    uint64_t requested_ = 0;
+    uint64_t written_ = 0;
+    bool isFlushRequested_ = false;
+    bool isStopping_ = false;
+
+    std::thread thread_;
+};
+
 PersistentInfo::PersistentInfo()
 {
     QString executablePath;
@@ -93,8 +220,17 @@ PersistentInfo::PersistentInfo()
     }
 
     UpdateSettings();
+
+    appSettings_->sync();
+    sessionSettings_->sync();
+    writer_ = std::make_unique<SettingsWriter>();
+
+    // Pending writes are done before the application exits
+    qAddPostRoutine( [] { PersistentInfo::flush(); } );
 }
 
+PersistentInfo::~PersistentInfo() = default;
+
 void PersistentInfo::PreparePortableSettings( const QString& portableConfigPath )
 {
     const auto sessionSettingsPath = makeSessionSettingsPath( portableConfigPath );
@@ -242,3 +378,20 @@ QSettings& PersistentInfo::getSettings( session_settings )
 {
     return *getInstance().sessionSettings_;
 }
+
+void PersistentInfo::saveLater( app_settings, const QString& name, Write write )
+{
+    auto& instance = getInstance();
+    instance.writer_->saveLater( *instance.appSettings_, name, std::move( write ) );
+}
+
+void PersistentInfo::saveLater( session_settings, const QString& name, Write write )
+{
+    auto& instance = getInstance();
+    instance.writer_->saveLater( *instance.sessionSettings_, name, std::move( write ) );
+}
+
+void PersistentInfo::flush()
+{
+    getInstance().writer_->flush();
+}
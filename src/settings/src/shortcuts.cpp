@@ -150,6 +150,8 @@ const std::map<std::string, QStringList>& ShortcutAction::defaultShortcuts()
         shortcuts.emplace( LogViewSelectLinesUp, QStringList() << "Shift+Up" );
         shortcuts.emplace( LogViewSelectLinesDown, QStringList() << "Shift+Down" );
 
+        shortcuts.emplace( LogViewToggleRenderStats, QStringList() << "Ctrl+Shift+F12" );
+
         return shortcuts;
     }();
 
@@ -277,6 +279,9 @@ QString ShortcutAction::actionName( const std::string& action )
         shortcuts.emplace( LogViewSelectLinesUp, QApplication::tr( "Select lines down" ) );
         shortcuts.emplace( LogViewSelectLinesDown, QApplication::tr( "Select lines up" ) );
 
+        shortcuts.emplace( LogViewToggleRenderStats,
+                           QApplication::tr( "Show or hide drawing statistics" ) );
+
         return shortcuts;
     }();
 
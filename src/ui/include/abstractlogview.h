@@ -41,33 +41,45 @@
 #define ABSTRACTLOGVIEW_H
 
 #include <array>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <optional>
 #include <string_view>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include <QAbstractScrollArea>
 #include <QBasicTimer>
+#include <QCache>
 #include <QColor>
 #include <QEvent>
 #include <QFontMetrics>
+#include <QFutureWatcher>
+#include <QStaticText>
 
 #ifdef GLOGG_PERF_MEASURE_FPS
 #include "perfcounter.h"
 #endif
 
 #include "abstractlogdata.h"
+#include "highlighterset.h"
 #include "linetypes.h"
 #include "overviewwidget.h"
 #include "quickfind.h"
 #include "quickfindmux.h"
+#include "quickfindpattern.h"
 #include "regularexpressionpattern.h"
 #include "selection.h"
 #include "viewtools.h"
+#include "wordsmatcher.h"
+#include "wrappedrowsindex.h"
 
 class QMenu;
 class QAction;
+class QPainter;
 class QShortcut;
 
 // Utility class representing a buffer for number entered on the keyboard
@@ -124,6 +136,15 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
 
     // Refresh the widget when the data set has changed.
     void updateData();
+    // Refresh the widget when lines were added to the data, none of them before the line
+    // of the file. The widget is not repainted if they are all below the shown lines.
+    void updateDataAfter( LineNumber firstAddedLine );
+    // Lines the data is expected to have once it is loaded, the vertical scroll bar
+    // is sized for them while the lines are indexed. No estimate if empty.
+    void setEstimatedNbLines( LinesCount lines );
+    // Lines from the first changed one are not the same anymore,
+    // quick find forgets what it found in them.
+    void truncateQuickFindIndex( LineNumber firstChangedLine );
     // Instructs the widget to update it's content geometry,
     // used when the font is changed.
     void updateDisplaySize();
@@ -155,6 +176,9 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
 
     void registerShortcuts();
 
+    // Memory of the caches of the view is accounted to the group of the file
+    void setMemoryGroup( const void* group );
+
   protected:
     void mousePressEvent( QMouseEvent* mouseEvent ) override;
     void mouseMoveEvent( QMouseEvent* mouseEvent ) override;
@@ -172,12 +196,26 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     // Must be implemented to return what LineType the line number is
     // (used for coloured bullets)
     virtual AbstractLogData::LineType lineType( LineNumber lineNumber ) const = 0;
+    // Same for consecutive lines, views can find them all at once
+    virtual klogg::vector<AbstractLogData::LineType> lineTypes( LineNumber first,
+                                                                LinesCount number ) const;
 
     // Line number to display for line at the given index
     virtual LineNumber displayLineNumber( LineNumber lineNumber ) const;
+    virtual klogg::vector<LineNumber> displayLineNumbers( LineNumber first,
+                                                          LinesCount number ) const;
     virtual LineNumber lineIndex( LineNumber lineNumber ) const;
     virtual LineNumber maxDisplayLineNumber() const;
 
+    // True if updates of the data only append lines, unless the view is told otherwise
+    virtual bool isDataAppendOnly() const;
+
+    // Data the lines of the view are read from and the numbers of the lines in it,
+    // lines of that data can be read on another thread
+    virtual const AbstractLogData* sourceData() const;
+    virtual klogg::vector<LineNumber> sourceLineNumbers( LineNumber first,
+                                                         LinesCount number ) const;
+
     // Get the overview associated with this view, or NULL if there is none
     Overview* getOverview() const
     {
@@ -213,6 +251,10 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     // Sent up when the user wants to replace the search with the selection
     void replaceSearch( const QString& selection );
     void excludeFromSearch( const QString& selection );
+    // Sent up when the user wants to see the lines identical to the line
+    void showIdenticalLines( LineNumber line );
+    // Sent up when the user wants statistics of the numbers in the selected lines of the file
+    void showSelectionStatistics( const klogg::vector<LineNumber>& lines );
     // Sent up when the mouse is hovered over a line's margin
     void mouseHoveredOverLine( LineNumber line );
     // Sent up when the mouse leaves a line's margin
@@ -301,6 +343,7 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     void setQuickFindResult( bool hasMatch, const Portion& selection );
     void setHighlighterSet( QAction* action );
     void setColorLabel( QAction* action );
+    void handleHighlightsReady();
 
   private:
     // Graphic parameters
@@ -363,11 +406,17 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     // rather than the top of the top one.
     LineNumber firstLine_;
     bool lastLineAligned_ = false;
+    LinesCount estimatedNbLines_;
     bool useTextWrap_ = false;
     LineColumn firstCol_ = 0_lcol;
 
     klogg::vector<std::pair<LineNumber, size_t>> wrappedLinesNumbers_;
 
+    // Rows of lines wrapped at the visible columns, vertical scroll positions
+    // are rows while text is wrapped
+    WrappedRowsIndex wrappedRows_;
+    LineLength wrappedRowsColumns_ = 0_length;
+
     LineNumber searchStart_;
     LineNumber searchEnd_;
 
@@ -384,6 +433,7 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     QAction* markAction_;
     QAction* sendToScratchpadAction_;
     QAction* replaceInScratchpadAction_;
+    QAction* showSelectionStatisticsAction_;
     QAction* saveToFileAction_;
     QAction* saveSelectedToFileAction_;
     QAction* findNextAction_;
@@ -391,6 +441,7 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     QAction* addToSearchAction_;
     QAction* replaceSearchAction_;
     QAction* excludeFromSearchAction_;
+    QAction* showIdenticalLinesAction_;
     QAction* setSearchStartAction_;
     QAction* setSearchEndAction_;
     QAction* clearSearchLimitAction_;
@@ -412,6 +463,34 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     PerfCounter perfCounter_;
 #endif
 
+    // Statistics of drawing shown over the view, so slow drawing can be reported with numbers
+    struct RenderStats {
+        using Duration = std::chrono::steady_clock::duration;
+
+        // Last paint, phases of drawing the text area are zero if the cache was used
+        Duration paint{};
+        Duration textFetch{};
+        Duration highlighting{};
+        Duration drawing{};
+
+        // Since the statistics are shown
+        uint64_t highlightsHits = 0;
+        uint64_t highlightsMisses = 0;
+        uint64_t textAreaReused = 0;
+        uint64_t textAreaScrolled = 0;
+        uint64_t textAreaDrawn = 0;
+        // Counters of the line page cache when the statistics were shown
+        uint64_t linePagesHits = 0;
+        uint64_t linePagesMisses = 0;
+
+        uint32_t framesPerSecond = 0;
+    };
+    bool isRenderStatsVisible_ = false;
+    RenderStats renderStats_;
+    PerfCounter framesCounter_;
+    // Statistics are drawn again while background work changes
+    QBasicTimer renderStatsTimer_;
+
     // Vertical offset (in pixels) at which the first line of text is written
     int drawingTopOffset_ = 0;
 
@@ -429,10 +508,80 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     };
     TextAreaCache textAreaCache_ = { {}, true, 0_lnum, 0_lnum, 0_lcol };
     PullToFollowCache pullToFollowCache_ = { {}, 0_length };
+
+    // Words of quick highlighters and color labels with their colors, found in one pass.
+    // They are built again only when the words or their colors change.
+    struct QuickHighlights {
+        klogg::vector<std::tuple<QString, QColor, QColor>> words;
+        WordsMatcher matcher;
+    };
+    std::shared_ptr<const QuickHighlights> quickHighlights_;
+
+    // Highlights depend only on the line and the highlighters,
+    // they are reused while highlighters are the same
+    struct HighlightsKey {
+        HighlighterSet highlighterSet;
+        std::optional<Highlighter> patternHighlight;
+        std::shared_ptr<const QuickHighlights> quickHighlights;
+        uint64_t quickFindGeneration;
+        QColor quickFindBackColor;
+
+        bool operator==( const HighlightsKey& other ) const;
+    };
+    struct LineHighlights {
+        QString line;
+        // The search pattern is matched only in lines the search found
+        bool isSearchMatch = false;
+        HighlighterMatchType matchType = HighlighterMatchType::NoMatch;
+        // Columns of matches in the expanded line
+        klogg::vector<HighlightedMatch> matches;
+        klogg::vector<HighlightedMatch> quickFindMatches;
+    };
+    struct HighlightsResult {
+        uint64_t generation = 0;
+        klogg::vector<std::pair<LineNumber, LineHighlights>> lines;
+    };
+    // Cost is one for a line and one for each 4K characters of it
+    static constexpr int HighlightsCacheSize = 16 * 1024;
+    static constexpr int HighlightsCacheLineLength = 4 * 1024;
+    // Caches of the view are this many times smaller with the low memory profile
+    static constexpr int LowMemoryCacheDivisor = 8;
+    HighlightsKey highlightsKey_ = {};
+    QCache<LineNumber::UnderlyingType, LineHighlights> highlightsCache_{ HighlightsCacheSize };
+    // Bytes and cost of inserted highlights, to estimate the memory of the cache
+    uint64_t highlightsInsertedBytes_ = 0;
+    uint64_t highlightsInsertedCost_ = 0;
+    uint64_t quickFindGeneration_ = 0;
+    // Changed with the key, results matched for other highlighters are dropped
+    uint64_t highlightsGeneration_ = 0;
+    // Highlights are matched on the thread pool, one request at a time
+    QFutureWatcher<HighlightsResult> highlightsWatcher_;
     QFontMetrics pixmapFontMetrics_;
 
+    // Laid out text of drawn chunks of lines, cost is the length of the text,
+    // it is reused for any line drawing the same text
+    static constexpr int StaticTextCacheSize = 256 * 1024;
+    QCache<QString, QStaticText> staticTextCache_{ StaticTextCacheSize };
+
+    // Estimated bytes of the pixmaps and the caches of lines
+    uint64_t cachesSize() const;
+
+    // Longer lines are read only around the visible columns when they are not wrapped,
+    // their highlights are matched in this window of the line as it is drawn
+    static constexpr qint64 LongLineWindowSize = 64 * 1024;
+
+    static LineHighlights matchHighlights( const HighlightsKey& key,
+                                           const QuickFindMatcher& quickFindMatcher,
+                                           const QString& logLine, const QString& expandedLine,
+                                           bool isSearchMatch );
+    // Whether the search pattern is highlighted in the line of the type
+    bool isSearchHighlighted( AbstractLogData::LineType lineType ) const;
+    // Match lines and lines around the view on the thread pool
+    void requestHighlights( klogg::vector<LineNumber> lines, LinesCount nbLines );
+
     LinesCount getNbVisibleLines() const;
-    LinesCount getNbBottomWrappedVisibleLines() const;
+    // Lines the vertical scroll bar is sized for
+    LinesCount getNbScrolledLines() const;
     LineLength getNbVisibleCols() const;
 
     FilePosition convertCoordToFilePos( const QPoint& pos ) const;
@@ -461,17 +610,36 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     // Save specified lines in range [begin, end) to a file
     void saveLinesToFile( LineNumber begin, LineNumber end );
 
+    // Larger selections are copied on a background thread, with a progress dialog
+    static constexpr LinesCount::UnderlyingType BackgroundCopyLines = 50000;
+    // Saving larger selections to a file is offered instead of copying them
+    static constexpr LinesCount::UnderlyingType MaxCopiedLines = 2000000;
+
+    void copySelection( bool lineNumbers );
+
     // Search functions (for n/N)
     using QuickFindSearchFn = void ( QuickFind::* )( Selection, QuickFindMatcher );
     void searchUsingFunction( QuickFindSearchFn searchFunction );
 
     void updateScrollBars();
 
+    // Follow changes of lines and of the visible columns, then measure rows
+    // of lines shown from the line, returns true if any rows changed
+    bool updateWrappedRows( LineNumber line );
+
     LineNumber verticalScrollToLineNumber( int scrollPosition ) const;
     int lineNumberToVerticalScroll( LineNumber line ) const;
     double verticalScrollMultiplicator() const;
 
     void drawTextArea( QPaintDevice* paintDevice );
+    void toggleRenderStats();
+    void drawRenderStats( QPainter& painter ) const;
+    // Draw lines from the first one between top and bottom pixels
+    void drawTextArea( QPaintDevice* paintDevice, LineNumber firstLine, LinesCount maxLines,
+                       int top, int bottom );
+    // Move the cached text area drawn from the line to the first line of the view
+    // and draw only lines scrolled into it, returns false if it must be fully drawn
+    bool scrollTextArea( LineNumber cachedFirstLine );
     QPixmap drawPullToFollowBar( int width, qreal pixelRatio );
 
     void disableFollow();
@@ -45,23 +45,35 @@
 
 #include <QCheckBox>
 #include <QComboBox>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QMenu>
+#include <QPointer>
+#include <QProgressDialog>
 #include <QPushButton>
 #include <QSplitter>
 #include <QToolButton>
 #include <QVBoxLayout>
 
+#include "atomicflag.h"
 #include "colorlabelsmanager.h"
+#include "fieldfacets.h"
 #include "filteredview.h"
+#include "filterstatistics.h"
 #include "iconloader.h"
+#include "levelindex.h"
+#include "linescomparison.h"
+#include "linesorter.h"
 #include "linetypes.h"
 #include "loadingstatus.h"
 #include "logdata.h"
 #include "logfiltereddata.h"
+#include "logtemplates.h"
 #include "logmainview.h"
 #include "overview.h"
+#include "patternvalidator.h"
 #include "predefinedfilterscombobox.h"
 #include "signalmux.h"
 #include "viewinterface.h"
@@ -71,7 +83,10 @@ class QuickFindPattern;
 class SavedSearches;
 class QStandardItemModel;
 class QCompleter;
+class QDialog;
+class QSpinBox;
 class OverviewWidget;
+class TimeHistogramWidget;
 
 // Implements the central widget of the application.
 // It includes both windows, the search line, the info
@@ -84,6 +99,7 @@ class CrawlerWidget : public QSplitter,
 
   public:
     CrawlerWidget( QWidget* parent = nullptr );
+    ~CrawlerWidget() override;
 
     // Get the line number of the first line displayed.
     LineNumber getTopLine() const;
@@ -110,12 +126,38 @@ class CrawlerWidget : public QSplitter,
 
     bool isTextWrapEnabled() const;
 
+    // Selects the line at the offset in the file, lines around an offset
+    // that is not indexed yet are shown until indexing reaches it.
+    void jumpToOffset( qint64 offset );
+
     void registerShortcuts();
 
+    // Inactive views are in background tabs or minimized windows. Their files
+    // are indexed as they change, with a lower priority than the active one,
+    // but views and searches are updated only when they are activated again.
+    void setActive( bool isActive );
+
+    // Compare the lines of the file with the lines of the file of the other crawler in
+    // the background, lines only in one of the files are opened in a new tab of its
+    // filtered view. Tokens with digits are ignored with masked numbers.
+    void compareLines( CrawlerWidget* other, bool maskNumbers );
+
+    QString searchText() const;
+    // Pattern of the search text with the options of the search line
+    RegularExpressionPattern searchPattern( const QString& searchText ) const;
+    // Search the valid pattern in a new tab of the filtered view, the returned data
+    // of the tab reports the progress of the search
+    LogFilteredData* searchInNewTab( const QString& searchText,
+                                     const RegularExpressionPattern& pattern );
+    // Switch to the tab of the filtered view of the data, if it is still open
+    void showFilteredData( const LogFilteredData* filteredData );
+
   public Q_SLOTS:
     // Stop the asynchoronous loading of the file if one is in progress
     // The file is identified by the view attached to it.
     void stopLoading();
+    // Stop the search of this view, loading of the file goes on
+    void stopSearch();
     // Reload the displayed file
     void reload();
     // Set the encoding
@@ -123,6 +165,28 @@ class CrawlerWidget : public QSplitter,
 
     void focusSearchEdit();
     void goToLine();
+    // Find message templates of the file in the background and list them,
+    // lines of a template are opened in a new tab of the filtered view
+    void showLogTemplates();
+    // Count values of a field of the filtered lines, or of all lines when there
+    // are no matches, in the background and list the most common ones
+    void showFieldFacets();
+    // Statistics of the numbers of a field of the filtered lines, or of all lines
+    // when there are no matches, computed in the background
+    void showNumberStatistics();
+    // Sort the filtered lines, or all lines when there are no matches, by the
+    // numbers of a field or by timestamps in the background and open them in a new tab
+    void sortLines();
+    // Search only the lines between lines matching begin and end markers, found in the
+    // background, or all lines again
+    void searchBetweenMarkers();
+    // Search only the lines of a log level and of the more severe ones, taken from the
+    // level index or found in the background. Without a search pattern the lines are
+    // opened in a new tab instead.
+    void filterByLevel();
+    // Write the matching lines, their numbers, offsets or bitmap to a file or to the
+    // standard input of a command in the background, without reading them all at once
+    void exportSearchResults();
 
     // Instructs the widget to reconfigure itself because Config() has changed.
     void applyConfiguration();
@@ -206,8 +270,14 @@ class CrawlerWidget : public QSplitter,
     void markLinesFromFiltered( const klogg::vector<LineNumber>& lines );
 
     void loadingFinishedHandler( LoadingStatus status );
+    // Shows the end of the file while the beginning is loading.
+    void loadingPreviewHandler();
+    // Shows the lines indexed so far while the file is loading.
+    void loadingProgressHandler( int progress );
     // Manages the info lines to inform the user the file has changed.
     void fileChangedHandler( MonitoredFileStatus );
+    // Drops search results on lines that are loaded again.
+    void fileModifiedHandler( LineNumber firstModifiedLine );
 
     void searchForward();
     void searchBackward();
@@ -227,9 +297,15 @@ class CrawlerWidget : public QSplitter,
     // Called when the text on the search line is modified
     void searchTextChangeHandler( QString );
 
+    // Called when the pattern on the search line has been compiled in the background
+    void patternValidatedHandler( bool isValid, const QString& errorString );
+
     // Called when the user change the visibility combobox
     void changeFilteredViewVisibility( int index );
 
+    // Called when the user changes the number of context lines
+    void changeFilteredViewContextLines( int contextLines );
+
     // Called when the user add the string to the search
     void addToSearch( const QString& string );
 
@@ -240,12 +316,20 @@ class CrawlerWidget : public QSplitter,
     // works only in boolean combination mode
     void excludeFromSearch( const QString& string );
 
+    // Called when the user wants to see the lines identical to the line,
+    // searched for like the selection if lines are not hashed yet
+    void showIdenticalLines( LineNumber line );
+
     void clearSearchHistory();
     void editSearchHistory();
 
     // Save current search as predefined filter
     void saveAsPredefinedFilter();
     void setSearchPatternFromPredefinedFilters( const QList<PredefinedFilter>& filters );
+    // Count lines matching each predefined filter, unless they are counted for the lines
+    void updatePredefinedFiltersMatchCounts();
+    // Counts are dropped and not shown until the filters are counted again
+    void resetPredefinedFiltersMatchCounts();
 
     // Search Context Menu
     void showSearchContextMenu();
@@ -318,15 +402,45 @@ class CrawlerWidget : public QSplitter,
     // Private functions
     void setup();
     void setShortcuts();
-    void replaceCurrentSearch( const QString& searchText );
+    // Matching lines are only counted if countOnly is set
+    void replaceCurrentSearch( const QString& searchText, bool countOnly = false );
+    void clearCurrentSearch();
+    void runCurrentSearch( const RegularExpressionPattern& regexpPattern, bool countOnly );
     void updateSearchCombo();
     AbstractLogView* activeView() const;
     void printSearchInfoMessage( LinesCount nbMatches = 0_lcount );
     void changeDataStatus( DataStatus status );
     void updateEncoding();
+    // Refreshes views and searches for the lines loaded from the file
+    void updateLoadedData( LoadingStatus status );
     void changeTopViewSize( int32_t delta );
     void updatePredefinedFiltersWidget();
 
+    void showLinesAtOffset( qint64 offset );
+    void selectPendingJumpLine();
+
+    void showMinedLogTemplates();
+    void showCountedFieldFacets();
+    void showComputedNumberStatistics();
+    void showSortedLines();
+    void showComparedLines();
+    // Finds the regions of the last markers or level in the whole file
+    void findSearchRegions();
+    void searchFoundRegions();
+    // Regions found before the file changed are found again
+    void updateSearchRegions();
+    void finishLinesExport();
+    // Lines are the ones of the file
+    void showSelectionStatistics( const klogg::vector<LineNumber>& lines );
+    void computeNumberStatistics( std::shared_ptr<const SearchResultArray> lines );
+    // Asks for the field of values or numbers, false if none is entered
+    bool askFacetField( const QString& title );
+    // Matching lines of the filtered view, all lines if there are none
+    std::shared_ptr<const SearchResultArray> filteredOrAllLines() const;
+    // Lines in a new tab of the filtered view, not searched for again
+    void showLinesInNewTab( const QString& tabText, SearchResultArray lines,
+                            std::shared_ptr<const LineOrder> order = {} );
+
     // Reload predefined filters after changing settings
     void reloadPredefinedFilters() const;
 
@@ -336,9 +450,17 @@ class CrawlerWidget : public QSplitter,
 
     void resetStateOnSearchPatternChanges();
 
+    // Recent searches are run in the background after loading, one at a time,
+    // so that their results are in the cache when selected from the history.
+    void startSpeculativeSearches();
+    void runNextSpeculativeSearch();
+    void cancelSpeculativeSearches();
+
     void updateColorLabels( const ColorLabelsManager::QuickHighlightersCollection& labels );
 
     void connectAllFilteredViewSlots( FilteredView* view);
+    // New tab of the filtered view with new filtered data, made current
+    void addFilteredViewTab();
 
     void saveSplitterSizes() const;
 
@@ -347,6 +469,9 @@ class CrawlerWidget : public QSplitter,
     // Palette for error notification (yellow background)
     static const QPalette ErrorPalette;
 
+    // Parts of the file matches are counted in for the overview by count only searches
+    static constexpr size_t OverviewBuckets = 4096;
+
     IconLoader iconLoader_;
 
     SavedSearches* savedSearches_ = nullptr;
@@ -354,6 +479,10 @@ class CrawlerWidget : public QSplitter,
     std::shared_ptr<LogData> logData_;
     std::shared_ptr<LogFilteredData> logFilteredData_;
 
+    // Hidden filtered data running the recent searches left to run
+    std::shared_ptr<LogFilteredData> speculativeData_;
+    QStringList speculativeSearches_;
+
     // Matches overview
     Overview overview_;
 
@@ -369,13 +498,25 @@ class CrawlerWidget : public QSplitter,
     QComboBox* visibilityBox_;
     QStandardItemModel* visibilityModel_;
 
+    // Lines shown before and after each line of the filtered view
+    QSpinBox* contextLinesBox_;
+
     PredefinedFiltersComboBox* predefinedFilters_;
 
+    // Lines matching predefined filters, counted for the filters and number of lines
+    // of the key, which is dropped when lines change
+    using FilterStatisticsKey = std::pair<klogg::vector<RegularExpressionPattern>, LinesCount>;
+    std::optional<FilterStatisticsKey> filterStatisticsKey_;
+    klogg::vector<LinesCount> filterMatchCounts_;
+    QFutureWatcher<FilterStatistics> filterStatisticsWatcher_;
+    std::shared_ptr<AtomicFlag> filterStatisticsInterrupt_ = std::make_shared<AtomicFlag>();
+
     QComboBox* searchLineEdit_;
     QMenu* searchLineContextMenu_;
     QCompleter* searchLineCompleter_;
 
     InfoLine* searchInfoLine_;
+    TimeHistogramWidget* timeHistogram_;
 
     QToolButton* clearButton_;
     QToolButton* searchButton_;
@@ -393,6 +534,9 @@ class CrawlerWidget : public QSplitter,
     // Default palette to be remembered
     QPalette searchInfoLineDefaultPalette_;
 
+    PatternValidator patternValidator_;
+    bool isPatternErrorShown_ = false;
+
     // Reference to the QuickFind Pattern (not owned)
 
     QWidget* qfSavedFocus_ = nullptr;
@@ -416,6 +560,69 @@ class CrawlerWidget : public QSplitter,
     // should consider we are loading something.
     bool loadingInProgress_ = true;
     bool firstLoadDone_ = false;
+    bool loadingPreviewShown_ = false;
+
+    bool isActive_ = true;
+    // File changed while the view was inactive
+    bool isUpdateDeferred_ = false;
+
+    // Lines shown while the file is loading
+    LinesCount liveIndexedLines_;
+    QElapsedTimer liveUpdateTimer_;
+    // Search started while the file is loading is continued as more lines are loaded
+    bool isSearchFollowingLoading_ = false;
+    bool isSearchRunning_ = false;
+
+    // Offset to jump to when it is indexed
+    std::optional<qint64> pendingJumpOffset_;
+    QPointer<QDialog> linesAtOffsetDialog_;
+
+    QFutureWatcher<LogTemplates> logTemplatesWatcher_;
+    std::shared_ptr<AtomicFlag> logTemplatesInterrupt_ = std::make_shared<AtomicFlag>();
+    QPointer<QDialog> logTemplatesDialog_;
+
+    QFutureWatcher<FieldFacets> fieldFacetsWatcher_;
+    std::shared_ptr<AtomicFlag> fieldFacetsInterrupt_ = std::make_shared<AtomicFlag>();
+    QPointer<QDialog> fieldFacetsDialog_;
+    // Field of the values being counted or listed
+    std::optional<FacetField> facetField_;
+
+    QFutureWatcher<FieldStatistics> numberStatisticsWatcher_;
+    std::shared_ptr<AtomicFlag> numberStatisticsInterrupt_ = std::make_shared<AtomicFlag>();
+    QPointer<QDialog> numberStatisticsDialog_;
+
+    QFutureWatcher<std::optional<LineOrder>> lineOrderWatcher_;
+    std::shared_ptr<AtomicFlag> lineOrderInterrupt_ = std::make_shared<AtomicFlag>();
+    QPointer<QProgressDialog> lineOrderProgress_;
+    // Lines being sorted and the name of their order
+    std::shared_ptr<const SearchResultArray> sortedLines_;
+    QString sortedLinesText_;
+
+    QFutureWatcher<std::optional<LinesComparison>> linesComparisonWatcher_;
+    std::shared_ptr<AtomicFlag> linesComparisonInterrupt_ = std::make_shared<AtomicFlag>();
+    QPointer<QProgressDialog> linesComparisonProgress_;
+    QPointer<CrawlerWidget> comparedCrawler_;
+
+    QFutureWatcher<std::shared_ptr<const SearchResultArray>> searchRegionsWatcher_;
+    std::shared_ptr<AtomicFlag> searchRegionsInterrupt_ = std::make_shared<AtomicFlag>();
+    // Filtered data that searches the regions when they are found
+    std::weak_ptr<LogFilteredData> searchRegionsData_;
+    QString searchRegionsBegin_;
+    QString searchRegionsEnd_;
+    // Level of the lines being found, empty for lines between markers
+    QString searchRegionsLevel_;
+    LogLevel searchRegionsLogLevel_ = LogLevel::Error;
+    // Lines of the file when the regions were found, regions are not valid after it changes
+    LinesCount searchRegionsNbLines_;
+    // Regions are found again for the searched lines of the data
+    bool isSearchRegionsUpdate_ = false;
+    // Told with the number of matches when only some lines are searched
+    QString searchedLinesText_;
+
+    QFutureWatcher<bool> linesExportWatcher_;
+    std::shared_ptr<AtomicFlag> linesExportInterrupt_ = std::make_shared<AtomicFlag>();
+    QPointer<QProgressDialog> linesExportProgress_;
+    QString linesExportCommand_;
 
     klogg::vector<LineNumber> savedMarkedLines_;
 
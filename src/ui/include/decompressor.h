@@ -30,8 +30,14 @@ class Decompressor : public QObject {
     Q_OBJECT
   public:
     explicit Decompressor( QObject* parent = nullptr );
+    // Waits for the running decompression, it is interrupted
+    // if it was started without an interrupt flag.
+    ~Decompressor() override;
 
     bool decompress( const QString& path, QFile* outputFile, AtomicFlag& interrupt );
+    // Data is flushed to the output file as it is decompressed,
+    // so the file can be read while it grows.
+    bool decompress( const QString& path, QFile* outputFile );
     bool extract( const QString& archiveFilePath, const QString& destination,
                   AtomicFlag& interrupt );
 
@@ -45,6 +51,7 @@ class Decompressor : public QObject {
   private:
     QFuture<bool> future_;
     QFutureWatcher<bool> watcher_;
+    AtomicFlag interrupt_;
 };
 
 #endif // KLOGG_DECOMPRESSOR_H
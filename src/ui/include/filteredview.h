@@ -61,12 +61,20 @@ class FilteredView : public AbstractLogView
 
   protected:
     LogFilteredData::LineType lineType( LineNumber lineNumber ) const override;
+    klogg::vector<LogFilteredData::LineType> lineTypes( LineNumber first,
+                                                        LinesCount number ) const override;
 
     // Number of the filtered line relative to the unfiltered source
     LineNumber displayLineNumber(LineNumber lineNumber ) const override;
+    klogg::vector<LineNumber> displayLineNumbers( LineNumber first,
+                                                  LinesCount number ) const override;
     LineNumber lineIndex( LineNumber lineNumber ) const override;
     LineNumber maxDisplayLineNumber() const override;
 
+    const AbstractLogData* sourceData() const override;
+    klogg::vector<LineNumber> sourceLineNumbers( LineNumber first,
+                                                 LinesCount number ) const override;
+
     void doRegisterShortcuts() override;
 
   private:
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_FINDINFILESPANEL_H
+#define KLOGG_FINDINFILESPANEL_H
+
+#include <atomic>
+#include <memory>
+
+#include <QFuture>
+#include <QStringList>
+#include <QWidget>
+
+#include "findinfiles.h"
+
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QPushButton;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+// Window to search a pattern in a list of files without opening them.
+// Files with matches are listed with the number of matches and the first
+// matching lines, activating a file or a line opens it in a tab.
+class FindInFilesPanel : public QWidget {
+    Q_OBJECT
+
+  public:
+    explicit FindInFilesPanel( QWidget* parent = nullptr );
+    ~FindInFilesPanel() override;
+
+  Q_SIGNALS:
+    // Offset is negative when the file is opened without selecting a line
+    void openFileRequested( const QString& fileName, qint64 offset );
+
+  private:
+    void addFiles();
+    void addFolder();
+    void clearFiles();
+
+    void startSearch();
+    void stopSearch();
+
+    void addFileMatches( uint64_t searchId, const FindInFiles::FileMatches& matches );
+    void searchFinished( uint64_t searchId );
+    void updateStatus();
+
+    void openItem( QTreeWidgetItem* item );
+
+  private:
+    QLineEdit* patternEdit_;
+    QCheckBox* ignoreCaseCheck_;
+    QCheckBox* plainTextCheck_;
+    QCheckBox* booleanCheck_;
+    QLineEdit* nameFilterEdit_;
+    QPushButton* findButton_;
+    QPushButton* stopButton_;
+    QTreeWidget* resultsTree_;
+    QLabel* statusLabel_;
+
+    QStringList fileNames_;
+
+    // Results of previous searches that arrive late are dropped
+    uint64_t searchId_ = 0;
+    std::shared_ptr<std::atomic<bool>> interruptRequested_;
+    QFuture<void> searchFuture_;
+
+    int nbSearched_ = 0;
+    int nbWithMatches_ = 0;
+    uint64_t nbMatches_ = 0;
+};
+
+#endif
@@ -39,6 +39,11 @@
 #ifndef highlighterSet_H
 #define highlighterSet_H
 
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
 #include <QColor>
 #include <QMetaType>
 #include <QRegularExpression>
@@ -47,6 +52,7 @@
 #include "highlightedmatch.h"
 #include "persistable.h"
 #include "containers.h"
+#include "synchronization.h"
 
 struct HighlightColor {
     QColor foreColor;
@@ -64,6 +70,8 @@ class Highlighter {
 
     bool matchLine( const QString& line, klogg::vector<HighlightedMatch>& matches ) const;
 
+    bool operator==( const Highlighter& other ) const;
+
     // Accessor functions
     QString pattern() const;
     void setPattern( const QString& pattern );
@@ -94,8 +102,21 @@ class Highlighter {
   private:
     std::pair<QColor, QColor> vairateColors( const QString& match ) const;
 
+    void updateMatchingRegex();
+
   private:
+    // Varied colors of matched texts by the hash of their UTF-16 text,
+    // views full of the same IDs or addresses look their colors up
+    struct VariedColors {
+        SharedMutex mutex;
+        std::unordered_map<uint64_t, std::pair<QColor, QColor>> colors;
+    };
+
     QRegularExpression regexp_;
+    // Escaped pattern if regex is not used, compiled once and shared by copies
+    QRegularExpression matchingRegex_;
+    // Shared by copies, replaced when colors change
+    std::shared_ptr<VariedColors> variedColors_ = std::make_shared<VariedColors>();
 
     bool useRegex_ = true;
     bool highlightOnlyMatch_ = false;
@@ -129,6 +150,12 @@ class HighlighterSet {
 
     bool isEmpty() const;
 
+    // Copy having its own matcher of the compiled patterns, to match lines
+    // on another thread without waiting for the matcher of this set
+    HighlighterSet withOwnMatcher() const;
+
+    bool operator==( const HighlighterSet& other ) const;
+
     // Reads/writes the current config in the QSettings object passed
     void saveToStorage( QSettings& settings ) const;
     void retrieveFromStorage( QSettings& settings );
@@ -136,6 +163,14 @@ class HighlighterSet {
   private:
     explicit HighlighterSet( const QString& name );
 
+    bool hasSamePatterns( const HighlighterSet& other ) const;
+
+    // Match all highlighters in one pass to find the ones matching a line
+    void compileMatcher();
+
+  private:
+    struct Matcher;
+
   private:
     static constexpr int HighlighterSet_VERSION = 3;
     static constexpr int FilterSet_VERSION = 2;
@@ -144,6 +179,9 @@ class HighlighterSet {
     QString id_;
     QList<Highlighter> highlighterList_;
 
+    // Only set for the combined active set, copies share it
+    std::shared_ptr<Matcher> matcher_;
+
     // To simplify this class interface, HighlightersDialog can access our
     // internal structure directly.
     friend class HighlighterSetEdit;
@@ -189,6 +227,9 @@ class HighlighterSetCollection final : public Persistable<HighlighterSetCollecti
     QList<HighlighterSet> highlighters_;
     QStringList activeSets_;
 
+    // Last combined set, its matcher is reused while patterns are the same
+    mutable HighlighterSet activeSet_;
+
     QList<QuickHighlighter> quickHighlighters_;
 
     // To simplify this class interface, HighlightersDialog can access our
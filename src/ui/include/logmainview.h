@@ -62,6 +62,11 @@ class LogMainView : public AbstractLogView
   protected:
     // Implements the virtual function
     LogData::LineType lineType( LineNumber lineNumber ) const override;
+    klogg::vector<AbstractLogData::LineType> lineTypes( LineNumber first,
+                                                        LinesCount number ) const override;
+
+    // Lines of the file change only when the crawler says so
+    bool isDataAppendOnly() const override;
 
     void doRegisterShortcuts() override;
 
@@ -45,18 +45,22 @@
 
 #include <QTranslator>
 #include <array>
+#include <map>
 #include <memory>
 #include <mutex>
 
 #include "configuration.h"
 #include "crawlerwidget.h"
 #include "downloader.h"
+#include "findinfilespanel.h"
 #include "iconloader.h"
 #include "pathline.h"
+#include "performancepanel.h"
 #include "quickfindmux.h"
 #include "quickfindwidget.h"
 #include "session.h"
 #include "signalmux.h"
+#include "streamspool.h"
 #include "tabbedcrawlerwidget.h"
 #include "tabbedscratchpad.h"
 
@@ -115,11 +119,14 @@ class MainWindow : public QMainWindow {
     void copy();
     void find();
     void clearLog();
+    void compareWithFile();
+    void searchAllTabs();
     void copyFullPath();
     void openContainingFolder();
     void openInEditor();
     void openClipboard();
     void openUrl();
+    void openMerged();
     void editHighlighters();
     void editPredefinedFilters( const QString& newFilter = {} );
     void options();
@@ -127,6 +134,8 @@ class MainWindow : public QMainWindow {
     void aboutQt();
     void documentation();
     void showScratchPad();
+    void showPerformancePanel();
+    void showFindInFilesPanel();
     void sendToScratchpad( QString );
     void replaceDataInScratchpad( QString );
     void encodingChanged( QAction* action );
@@ -200,6 +209,7 @@ class MainWindow : public QMainWindow {
     void readSettings();
     void writeSettings();
     bool loadFile( const QString& fileName, bool followFile = false );
+    void loadStandardInput();
     bool extractAndLoadFile( const QString& fileName );
     void openRemoteFile( const QUrl& url );
     void updateTitleBar( const QString& fileName );
@@ -209,6 +219,8 @@ class MainWindow : public QMainWindow {
     void updateFavoritesMenu();
     void updateOpenedFilesMenu();
     void updateHighlightersMenu();
+    // Only the current tab of a shown window is active
+    void updateTabsActivity();
     QString strippedName( const QString& fullFileName ) const;
     CrawlerWidget* currentCrawlerWidget() const;
     void displayQuickFindBar( QuickFindMux::QFDirection direction );
@@ -261,6 +273,7 @@ class MainWindow : public QMainWindow {
     QAction* openInEditorAction;
     QAction* openClipboardAction;
     QAction* openUrlAction;
+    QAction* openMergedAction;
     QAction* overviewVisibleAction;
     QAction* lineNumbersVisibleInMainAction;
     QAction* lineNumbersVisibleInFilteredAction;
@@ -271,6 +284,17 @@ class MainWindow : public QMainWindow {
     QAction* editHighlightersAction;
     QAction* optionsAction;
     QAction* showScratchPadAction;
+    QAction* showPerformanceAction;
+    QAction* showFindInFilesAction;
+    QAction* showLogTemplatesAction;
+    QAction* showFieldFacetsAction;
+    QAction* showNumberStatisticsAction;
+    QAction* sortLinesAction;
+    QAction* searchBetweenMarkersAction;
+    QAction* filterByLevelAction;
+    QAction* compareWithFileAction;
+    QAction* searchAllTabsAction;
+    QAction* exportSearchResultsAction;
     QAction* showDocumentationAction;
     QAction* aboutAction;
     QAction* aboutQtAction;
@@ -313,11 +337,19 @@ class MainWindow : public QMainWindow {
     TabbedCrawlerWidget mainTabWidget_;
 
     TabbedScratchPad scratchPad_;
+    PerformancePanel performancePanel_;
+    FindInFilesPanel findInFilesPanel_;
 
     QTemporaryDir tempDir_;
+    // Owners of files decompressed to the temporary directory by their names,
+    // they are released with the last tab of the file
+    std::map<QString, QObject*> decompressedFiles_;
+    // Spool file of the standard input is in the temporary directory
+    std::unique_ptr<StreamSpool> stdinSpool_;
 
     bool isMaximized_ = false;
     bool isCloseFromTray_ = false;
+    bool isRestoringSession_ = false;
 
     std::once_flag screenChangesConnect_;
 };
@@ -58,6 +58,8 @@ extern const char* openClipboardText;
 extern const char* openClipboardStatusTip;
 extern const char* openUrlText;
 extern const char* openUrlStatusTip;
+extern const char* openMergedText;
+extern const char* openMergedStatusTip;
 extern const char* overviewVisibleText;
 extern const char* lineNumbersVisibleInMainText;
 extern const char* lineNumbersVisibleInFilteredText;
@@ -85,6 +87,28 @@ extern const char* generateDumpText;
 extern const char* generateDumpStatusTip;
 extern const char* showScratchPadText;
 extern const char* showScratchPadStatusTip;
+extern const char* showPerformanceText;
+extern const char* showPerformanceStatusTip;
+extern const char* showFindInFilesText;
+extern const char* showFindInFilesStatusTip;
+extern const char* showLogTemplatesText;
+extern const char* showLogTemplatesStatusTip;
+extern const char* showFieldFacetsText;
+extern const char* showFieldFacetsStatusTip;
+extern const char* showNumberStatisticsText;
+extern const char* showNumberStatisticsStatusTip;
+extern const char* sortLinesText;
+extern const char* sortLinesStatusTip;
+extern const char* searchBetweenMarkersText;
+extern const char* searchBetweenMarkersStatusTip;
+extern const char* filterByLevelText;
+extern const char* filterByLevelStatusTip;
+extern const char* compareWithFileText;
+extern const char* compareWithFileStatusTip;
+extern const char* searchAllTabsText;
+extern const char* searchAllTabsStatusTip;
+extern const char* exportSearchResultsText;
+extern const char* exportSearchResultsStatusTip;
 extern const char* addToFavoritesText;
 extern const char* removeFromFavoritesText;
 extern const char* selectOpenFileText;
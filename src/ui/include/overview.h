@@ -20,6 +20,8 @@
 #ifndef OVERVIEW_H
 #define OVERVIEW_H
 
+#include <optional>
+
 #include "linetypes.h"
 #include <QList>
 #include <QVector>
@@ -78,6 +80,9 @@ class Overview {
     // the overview must be updated with the provided total number
     // of line of the file.
     void updateData( LinesCount totalNbLine );
+    // Signal the overview matches have been added from the passed line,
+    // only the part of the overview below it is updated.
+    void updateMatches( LineNumber firstNewMatch );
     // Set the visibility flag of this overview.
     void setVisible( bool visible )
     {
@@ -128,12 +133,14 @@ class Overview {
     unsigned height_;
     // Does the cache (matchesLines, markLines) need to be recalculated.
     bool dirty_;
+    // First position of the cache to recalculate if it is not dirty
+    std::optional<unsigned> firstDirtyPosition_;
 
     // List of lines representing matches and marks (are shared with the client)
     klogg::vector<WeightedLine> matchLines_;
     klogg::vector<WeightedLine> markLines_;
 
-    void recalculatesLines();
+    void recalculatesLines( unsigned firstPosition = 0 );
 };
 
 #endif
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_PATTERNVALIDATOR_H
+#define KLOGG_PATTERNVALIDATOR_H
+
+#include <atomic>
+#include <memory>
+#include <optional>
+
+#include <QObject>
+#include <QThreadPool>
+
+#include "regularexpressionpattern.h"
+
+// Compiles search patterns in the background while they are typed, so
+// complex patterns don't block the GUI thread. Patterns are compiled one at
+// a time, a pattern replaced by a newer one before its compilation starts is
+// skipped, and results of replaced patterns are dropped.
+class PatternValidator : public QObject {
+    Q_OBJECT
+
+  public:
+    struct Result {
+        RegularExpressionPattern pattern;
+        bool isValid = false;
+        QString errorString;
+    };
+
+    explicit PatternValidator( QObject* parent = nullptr );
+    ~PatternValidator() override;
+
+    void validate( const RegularExpressionPattern& pattern );
+
+    // Empty until the pattern is the last one compiled
+    std::optional<Result> result( const RegularExpressionPattern& pattern ) const;
+
+  Q_SIGNALS:
+    // Sent for the last pattern passed to validate only
+    void validated( bool isValid, const QString& errorString );
+
+  private:
+    QThreadPool compilePool_;
+
+    // Shared with compilations, which are skipped when it changes
+    std::shared_ptr<std::atomic<uint64_t>> generation_;
+
+    std::optional<RegularExpressionPattern> pendingPattern_;
+    std::optional<Result> lastResult_;
+};
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_PERFORMANCEPANEL_H
+#define KLOGG_PERFORMANCEPANEL_H
+
+#include <QJsonObject>
+#include <QTimer>
+#include <QWidget>
+
+class QTreeWidget;
+class QStatusBar;
+
+// Window with the metrics of indexing, searching and drawing,
+// refreshed while it is shown. Metrics can be exported as json
+// along with the description of the machine and the memory held by each
+// subsystem for each opened file. Trace of the same work
+// is recorded on demand and exported for chrome://tracing or Perfetto.
+// Stalls of the event loop are watched on demand and listed by the spans
+// the GUI thread was in.
+class PerformancePanel : public QWidget {
+    Q_OBJECT
+  public:
+    explicit PerformancePanel( QWidget* parent = nullptr );
+
+    // Metrics and the machine they were measured on
+    static QJsonObject report();
+
+  protected:
+    void showEvent( QShowEvent* event ) override;
+    void hideEvent( QHideEvent* event ) override;
+
+  private:
+    void refresh();
+    void reset();
+    void copyJson();
+    void saveJson();
+    void saveTrace();
+
+  private:
+    QTreeWidget* metricsTree_;
+    QStatusBar* statusBar_;
+
+    QTimer refreshTimer_;
+};
+
+#endif
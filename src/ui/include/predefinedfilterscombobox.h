@@ -42,6 +42,8 @@
 
 #include <QComboBox>
 
+#include "containers.h"
+#include "linetypes.h"
 #include "predefinedfilters.h"
 
 class QStandardItemModel;
@@ -62,8 +64,17 @@ class PredefinedFiltersComboBox final : public QComboBox {
 
     virtual void showPopup();
 
+    // All filters in the order they are shown
+    QList<PredefinedFilter> filters() const;
+
+    // Numbers of lines matching each of the filters are shown after their names,
+    // names are shown alone if there are no counts.
+    void setMatchCounts( const klogg::vector<LinesCount>& counts );
+
   Q_SIGNALS:
     void filterChanged( const QList<PredefinedFilter>& selectedFilters);
+    // Filters are shown, numbers of matching lines can be updated
+    void matchCountsRequested();
 
   private:
     void setTitle( const QString& title );
@@ -39,17 +39,23 @@
 #ifndef QUICKFIND_H
 #define QUICKFIND_H
 
+#include <memory>
+
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QObject>
 #include <QPoint>
 #include <QTime>
 
+#include <roaring64map.hh>
+
 #include "atomicflag.h"
 #include "linetypes.h"
 #include "qfnotifications.h"
 #include "quickfindpattern.h"
+#include "regularexpression.h"
 #include "selection.h"
+#include "synchronization.h"
 
 class QuickFindPattern;
 class AbstractLogData;
@@ -107,6 +113,10 @@ class QuickFind : public QObject {
     // Make the object forget the 'no more match' flag.
     void resetLimits();
 
+    // Forget matches found in lines from the first changed one,
+    // lines only appended to the data keep them.
+    void truncateIndex( LineNumber firstChangedLine = 0_lnum );
+
   public Q_SLOTS:
     // Used for incremental searches
     // Return the first occurrence of the passed pattern from the starting
@@ -230,6 +240,50 @@ class QuickFind : public QObject {
     Portion doSearchBackward( const FilePosition& start_position, const Selection& selection,
                               const QuickFindMatcher& matcher );
 
+    // Lines are read and matched in chunks, columns are found only in matching lines
+    static constexpr LinesCount::UnderlyingType SearchChunkLines = 5000;
+
+    // Matcher of the engine of searches, empty if it can't use the pattern
+    std::unique_ptr<PatternMatcher> createPatternMatcher( const QuickFindMatcher& matcher );
+
+    // Indexes of lines that may match, all lines without a pattern matcher
+    static klogg::vector<size_t> findCandidateLines( const klogg::vector<QString>& lines,
+                                                     const PatternMatcher* patternMatcher );
+
+    // Expression of the last searched pattern, only used by the search thread
+    RegularExpressionPattern expressionPattern_;
+    std::unique_ptr<RegularExpression> expression_;
+
+    // Matching lines of the searched pattern between begin and end,
+    // built outward from where searches start. Only used by the search thread.
+    struct OccurrenceIndex {
+        RegularExpressionPattern pattern;
+        LineNumber begin;
+        LineNumber end;
+        roaring::Roaring64Map lines;
+
+        bool isIndexed( LineNumber line ) const
+        {
+            return line >= begin && line < end;
+        }
+    };
+    OccurrenceIndex index_;
+
+    // Truncation requested by the UI thread, applied when the next search starts
+    Mutex indexTruncationMutex_;
+    OptionalLineNumber indexTruncation_;
+
+    // Drop the index if it was built for another pattern or data changed
+    void prepareIndex( const QuickFindMatcher& matcher );
+
+    // Match all lines of the chunk and add it to the index, next to indexed lines if possible
+    void indexChunk( LineNumber chunkStart, LinesCount chunkLines, const QuickFindMatcher& matcher,
+                     const PatternMatcher* patternMatcher );
+
+    // Indexed match at or after the line and before the line, the line must be indexed
+    OptionalLineNumber nextIndexedMatch( LineNumber line ) const;
+    OptionalLineNumber previousIndexedMatch( LineNumber line ) const;
+
     AtomicFlag interruptRequested_;
     QFuture<Portion> operationFuture_;
     QFutureWatcher<Portion> operationWatcher_;
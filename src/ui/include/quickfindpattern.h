@@ -48,6 +48,7 @@
 #include "highlightedmatch.h"
 #include "containers.h"
 #include "linetypes.h"
+#include "regularexpressionpattern.h"
 
 class QuickFind;
 
@@ -74,10 +75,16 @@ class QuickFindMatcher {
     // Same as isLineMatching but search backward
     bool isLineMatchingBackward( const QString& line, LineColumn column = LineColumn{-1} ) const;
 
+    // Populates the passed list with all matches within the line
+    bool matchLine( const QString& line, klogg::vector<HighlightedMatch>& matches ) const;
+
     // Must be called when isLineMatching returns 'true', returns
     // the position of the first match found.
     std::pair<LineColumn, LineColumn> getLastMatch() const;
 
+    // Same pattern for the regular expression engine of searches
+    RegularExpressionPattern searchPattern() const;
+
   private:
     bool isActive_ = false;
     QRegularExpression regexp_;
@@ -20,14 +20,22 @@
 #ifndef SCRATCHPAD_H
 #define SCRATCHPAD_H
 
+#include <QTextCursor>
+#include <QTimer>
 #include <QWidget>
 
 #include <functional>
 #include <qobjectdefs.h>
 
 class QPlainTextEdit;
+class QProgressBar;
+class QPushButton;
 class QStatusBar;
 class QLineEdit;
+class QToolBar;
+
+template <typename T>
+class QFutureWatcher;
 
 class ScratchPad : public QWidget {
     Q_OBJECT
@@ -45,13 +53,14 @@ class ScratchPad : public QWidget {
   Q_SIGNALS:
     void updateTransformation();
 
+  protected:
+    void showEvent( QShowEvent* event ) override;
+
   private Q_SLOTS:
-    void crc32Hex();
-    void crc32Dec();
-    void unixTime();
-    void fileTime();
-    void decToHex();
-    void hexToDec();
+    // Boxes are updated only for the visible scratchpad,
+    // checksums of large text are calculated in the background
+    void updateBoxes();
+    void cancelTransformation();
 
   private:
     void decodeBase64();
@@ -65,13 +74,19 @@ class ScratchPad : public QWidget {
 
     void decodeUrl();
 
-    QString transformText( const std::function<QString( QString )>& transform );
+    QTextCursor selectedTextCursor() const;
 
+    // Transforms of large text run in the background
     void transformTextInPlace( const std::function<QString( QString )>& transform );
+    void insertTransformedText( QTextCursor cursor, const QString& transformedText );
+    void setTransformationRunning( bool isRunning );
 
   private:
     QPlainTextEdit* textEdit_;
+    QToolBar* toolBar_;
     QStatusBar* statusBar_;
+    QProgressBar* transformProgress_;
+    QPushButton* cancelTransformButton_;
 
     QLineEdit* crc32HexBox_;
     QLineEdit* crc32DecBox_;
@@ -79,6 +94,14 @@ class ScratchPad : public QWidget {
     QLineEdit* fileTimeBox_;
     QLineEdit* decToHexBox_;
     QLineEdit* hexToDecBox_;
+
+    QTimer boxesTimer_;
+    bool areBoxesOutdated_ = false;
+
+    // Results of replaced watchers are dropped
+    QFutureWatcher<QString>* transformWatcher_ = nullptr;
+    QFutureWatcher<quint32>* crc32Watcher_ = nullptr;
+    QTextCursor transformCursor_;
 };
 
 #endif // SCRATCHPAD_H
\ No newline at end of file
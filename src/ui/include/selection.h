@@ -23,6 +23,8 @@
 #include <QList>
 #include <QString>
 #include <cstddef>
+#include <functional>
+#include <optional>
 
 #include "linetypes.h"
 
@@ -150,8 +152,19 @@ class Selection {
     // Returns the line selected or -1 if not a single line selection
     OptionalLineNumber selectedLine() const;
 
+    // Returns the first and the last line of a selected range
+    std::optional<std::pair<LineNumber, LineNumber>> getSelectedRange() const;
+
     // Returns the text selected from the passed AbstractLogData
     QString getSelectedText( const AbstractLogData* logData, bool lineNumbers = false ) const;
+    // Idem, lines of a range are read in chunks and the progress is called with the number
+    // of lines added so far. Returns an empty text if the progress returns false.
+    QString getSelectedText( const AbstractLogData* logData, bool lineNumbers,
+                             const std::function<bool( LinesCount )>& progress ) const;
+    // Text of the passed lines of the AbstractLogData, read and reported as above
+    static QString getLinesText( const AbstractLogData* logData,
+                                 const klogg::vector<LineNumber>& lines, bool lineNumbers,
+                                 const std::function<bool( LinesCount )>& progress );
 
     // Return the position immediately after the current selection
     // (used for searches).
@@ -75,6 +75,13 @@ class Session : public std::enable_shared_from_this<Session> {
     // Throw an exception if it does not exist.
     void close( const ViewInterface* view );
 
+    // Start loading the file of a view restored without loading it,
+    // does nothing if the file is loaded already.
+    void loadIfDeferred( const ViewInterface* view );
+
+    // Whether other views show the same log
+    bool isLogShared( const ViewInterface* view ) const;
+
     // Get the file name for the passed view.
     QString getFilename( const ViewInterface* view ) const;
 
@@ -112,12 +119,18 @@ class Session : public std::enable_shared_from_this<Session> {
         std::shared_ptr<LogData> logData;
         std::shared_ptr<LogFilteredData> logFilteredData;
         ViewInterface* view;
+        // Restored file that is loaded when its view is shown
+        bool isDeferred;
     };
 
-    // Open a file without checking if it is existing/readable
+    // Open a file without checking if it is existing/readable,
+    // a deferred file is not loaded until loadIfDeferred is called.
     ViewInterface* openAlways( const QString& file_name,
                                const std::function<ViewInterface*()>& view_factory,
-                               const QString& view_context );
+                               const QString& view_context, bool isDeferred = false );
+
+    // Log of the file if another view has it open, empty otherwise
+    std::shared_ptr<LogData> findSharedLogData( const QString& file_name ) const;
 
     // Find an open file from its associated view
     OpenFile* findOpenFileFromView( const ViewInterface* view );
@@ -179,6 +192,16 @@ class WindowSession {
         return appSession_->getFileInfo( view, fileSize, fileNbLine, lastModified );
     }
 
+    void loadIfDeferred( const ViewInterface* view )
+    {
+        appSession_->loadIfDeferred( view );
+    }
+
+    bool isLogShared( const ViewInterface* view ) const
+    {
+        return appSession_->isLogShared( view );
+    }
+
     std::vector<QString> openedFiles() const
     {
         return openedFiles_;
@@ -204,6 +227,8 @@ class WindowSession {
     // (see ::open)
     // returns a vector of pairs (file_name, view) and the index of the
     // current file (or -1 if none).
+    // If lazy loading is configured, only the current file and the most
+    // recently opened ones are loaded, others wait for loadIfDeferred.
     OpenedFilesList restore( const std::function<ViewInterface*()>& view_factory,
                              int* current_file_index );
 
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TIMEHISTOGRAMWIDGET_H
+#define KLOGG_TIMEHISTOGRAMWIDGET_H
+
+#include <QWidget>
+
+#include "containers.h"
+#include "linetypes.h"
+#include "timehistogram.h"
+
+// Chart of matching lines of the search by their time, shown above the
+// filtered view while the results have timestamps. Clicking a bar jumps
+// to the first matching line of its interval.
+class TimeHistogramWidget : public QWidget {
+    Q_OBJECT
+
+  public:
+    explicit TimeHistogramWidget( QWidget* parent = nullptr );
+
+    // Hidden if the histogram is empty
+    void setHistogram( TimeHistogram histogram );
+
+  Q_SIGNALS:
+    void lineClicked( LineNumber line );
+
+  protected:
+    bool event( QEvent* event ) override;
+    void paintEvent( QPaintEvent* paintEvent ) override;
+    void mousePressEvent( QMouseEvent* mouseEvent ) override;
+    void resizeEvent( QResizeEvent* resizeEvent ) override;
+
+  private:
+    // Buckets drawn in one column of pixels
+    struct Column {
+        uint64_t count = 0;
+        LineNumber firstLine;
+        // Lines of the column were truncated, it has matches but their number is not known
+        bool isKnown = true;
+    };
+
+    void updateColumns();
+
+    // Seconds since epoch at the left edge of the column
+    int64_t columnTime( int column ) const;
+
+    TimeHistogram histogram_;
+
+    klogg::vector<Column> columns_;
+    uint64_t maxCount_ = 0;
+    int64_t startTime_ = 0;
+    int64_t endTime_ = 0;
+};
+
+#endif
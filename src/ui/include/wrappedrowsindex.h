@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_WRAPPEDROWSINDEX_H
+#define KLOGG_WRAPPEDROWSINDEX_H
+
+#include <cstdint>
+
+#include "containers.h"
+#include "linetypes.h"
+
+// Rows taken by wrapped lines of a view, summed over blocks of lines in a
+// Fenwick tree, so rows and lines are converted in logarithmic time.
+//
+// Blocks are measured lazily, lines of blocks that were not measured
+// are taken as one row each. Lines are added and dropped at the end.
+class WrappedRowsIndex {
+  public:
+    static constexpr LinesCount::UnderlyingType BlockLines = 1024;
+
+    // Drop measured rows of all lines
+    void reset( LinesCount nbLines );
+
+    // Lines are added or dropped at the end, rows of the last block are measured again
+    void resize( LinesCount nbLines );
+
+    LinesCount nbLines() const;
+    uint64_t nbRows() const;
+
+    size_t blockOfLine( LineNumber line ) const;
+    LineNumber firstLineOfBlock( size_t block ) const;
+    LinesCount linesInBlock( size_t block ) const;
+
+    bool isMeasured( size_t block ) const;
+
+    // Rows of each line of the block, from its first line
+    void setBlockRows( size_t block, const klogg::vector<uint64_t>& lineRows );
+
+    // Rows taken by the lines before the line
+    uint64_t rowsBefore( LineNumber line ) const;
+
+    // Line the row belongs to, the last line for rows past the end
+    LineNumber lineAtRow( uint64_t row ) const;
+
+  private:
+    // Rows of blocks before the block
+    uint64_t blocksRows( size_t endBlock ) const;
+
+    // Rows are added modulo 2^64, so they are removed by adding the complement
+    void addBlockRows( size_t block, uint64_t rows );
+
+    void appendBlocks( size_t blocksCount );
+
+  private:
+    LinesCount nbLines_ = 0_lcount;
+
+    // Fenwick tree of rows of blocks, element i sums blocks (i + 1 - lowbit(i + 1), i]
+    klogg::vector<uint64_t> tree_;
+    klogg::vector<uint64_t> blockRows_;
+
+    // Rows before each line of measured blocks, from the first line of the block,
+    // empty for other blocks
+    klogg::vector<klogg::vector<uint64_t>> lineRowsBefore_;
+};
+
+#endif
@@ -62,6 +62,7 @@
 #include <QGestureEvent>
 #include <QInputDialog>
 #include <QMenu>
+#include <QMessageBox>
 #include <QPaintEvent>
 #include <QPainter>
 #include <QPalette>
@@ -69,11 +70,14 @@
 #include <QRect>
 #include <QScrollBar>
 #include <QShortcut>
+#include <QStaticText>
+#include <QThreadPool>
 #if QT_VERSION >= QT_VERSION_CHECK( 5, 10, 0 )
 #include <QStringView>
 #else
 #include <QStringRef>
 #endif
+#include <QtConcurrent>
 #include <QtCore>
 
 #include <tbb/flow_graph.h>
@@ -86,11 +90,14 @@
 #include "highlighterset.h"
 #include "highlightersmenu.h"
 #include "log.h"
+#include "memorygovernor.h"
+#include "metrics.h"
 #include "overview.h"
 #include "quickfind.h"
 #include "quickfindpattern.h"
 #include "regularexpressionpattern.h"
 #include "shortcuts.h"
+#include "tracing.h"
 
 #ifdef Q_OS_WIN
 
@@ -349,6 +356,9 @@ class LineChunk {
 // each chunk having a different colour
 class LineDrawer {
   public:
+    // Longer chunks are drawn as plain strings
+    static constexpr int StaticTextMaxLength = 1024;
+
     explicit LineDrawer( const QColor& backColor )
         : backColor_( backColor )
     {
@@ -377,8 +387,10 @@ class LineDrawer {
     // leftExtraBackgroundPx is the an extra margin to start drawing
     // the coloured // background, going all the way to the element
     // left of the line looks better.
+    // Text of short chunks is laid out once and kept in the cache.
     void draw( QPainter* painter, int initialXPos, int initialYPos, int lineWidth,
-               const WrappedLinesView& wrappedLines, int leftExtraBackgroundPx )
+               const WrappedLinesView& wrappedLines, int leftExtraBackgroundPx,
+               QCache<QString, QStaticText>& staticTexts )
     {
         QFontMetrics fm = painter->fontMetrics();
         const int fontHeight = fm.height();
@@ -418,9 +430,25 @@ class LineDrawer {
                 }
 
                 painter->setPen( chunk.foreColor() );
-                painter->drawText(
-                    xPos, yPos + fontAscent,
-                    QString::fromRawData( chunkText.data(), klogg::isize( chunkText ) ) );
+                const auto text
+                    = QString::fromRawData( chunkText.data(), klogg::isize( chunkText ) );
+                if ( text.size() <= StaticTextMaxLength ) {
+                    const auto* staticText = staticTexts.object( text );
+                    if ( staticText == nullptr ) {
+                        // Cached text must not share the data of the line
+                        const auto textCopy = QString( text.constData(), text.size() );
+                        auto laidOutText = std::make_unique<QStaticText>( textCopy );
+                        laidOutText->setTextFormat( Qt::PlainText );
+                        laidOutText->prepare( painter->transform(), painter->font() );
+                        staticText = laidOutText.get();
+                        staticTexts.insert( textCopy, laidOutText.release(),
+                                            std::max( 1, klogg::isize( textCopy ) ) );
+                    }
+                    painter->drawStaticText( xPos, yPos, *staticText );
+                }
+                else {
+                    painter->drawText( xPos, yPos + fontAscent, text );
+                }
 
                 xPos += chunkWidth;
             }
@@ -493,6 +521,11 @@ AbstractLogView::AbstractLogView( const AbstractLogData* newLogData,
 
     useTextWrap_ = Configuration::get().useTextWrap();
 
+    if ( Configuration::get().lowMemoryProfile() ) {
+        highlightsCache_.setMaxCost( HighlightsCacheSize / LowMemoryCacheDivisor );
+        staticTextCache_.setMaxCost( StaticTextCacheSize / LowMemoryCacheDivisor );
+    }
+
     // Hovering
     setMouseTracking( true );
 
@@ -510,6 +543,9 @@ AbstractLogView::AbstractLogView( const AbstractLogData* newLogData,
     connect( &followElasticHook_, SIGNAL( lengthChanged() ), this, SLOT( repaint() ) );
     connect( &followElasticHook_, SIGNAL( hooked( bool ) ), this,
              SIGNAL( followModeChanged( bool ) ) );
+
+    connect( &highlightsWatcher_, &QFutureWatcher<HighlightsResult>::finished, this,
+             &AbstractLogView::handleHighlightsReady );
 }
 
 AbstractLogView::~AbstractLogView()
@@ -521,6 +557,9 @@ AbstractLogView::~AbstractLogView()
     } catch ( const std::exception& e ) {
         LOG_ERROR << "Failed to stop search: " << e.what();
     }
+
+    MemoryGovernor::get().removeCaches( this );
+    highlightsWatcher_.waitForFinished();
 }
 
 //
@@ -594,6 +633,7 @@ void AbstractLogView::mousePressEvent( QMouseEvent* mouseEvent )
 
             setSearchStartAction_->setEnabled( true );
             setSearchEndAction_->setEnabled( true );
+            showIdenticalLinesAction_->setEnabled( true );
 
             setSelectionStartAction_->setEnabled( true );
             setSelectionEndAction_->setEnabled( !!selectionStart_ );
@@ -606,6 +646,7 @@ void AbstractLogView::mousePressEvent( QMouseEvent* mouseEvent )
 
             setSearchStartAction_->setEnabled( false );
             setSearchEndAction_->setEnabled( false );
+            showIdenticalLinesAction_->setEnabled( false );
 
             setSelectionStartAction_->setEnabled( false );
             setSelectionEndAction_->setEnabled( false );
@@ -817,6 +858,9 @@ void AbstractLogView::timerEvent( QTimerEvent* timerEvent )
                                                         : QAbstractSlider::SliderSingleStepAdd );
         }
     }
+    else if ( timerEvent->timerId() == renderStatsTimer_.timerId() ) {
+        viewport()->update();
+    }
     QAbstractScrollArea::timerEvent( timerEvent );
 }
 
@@ -935,6 +979,9 @@ void AbstractLogView::doRegisterShortcuts()
                                     selectionCurrentEndPos_.column() );
         selectAndDisplayRange( newPosition );
     } );
+
+    registerShortcut( ShortcutAction::LogViewToggleRenderStats,
+                      [ this ]() { toggleRenderStats(); } );
 }
 
 void AbstractLogView::keyPressEvent( QKeyEvent* keyEvent )
@@ -1062,36 +1109,54 @@ bool AbstractLogView::event( QEvent* e )
 
 int AbstractLogView::lineNumberToVerticalScroll( LineNumber line ) const
 {
+    const auto position = useTextWrap_ ? wrappedRows_.rowsBefore( line ) : line.get();
     return static_cast<int>(
-        std::round( static_cast<double>( line.get() ) * verticalScrollMultiplicator() ) );
+        std::round( static_cast<double>( position ) * verticalScrollMultiplicator() ) );
 }
 
 LineNumber AbstractLogView::verticalScrollToLineNumber( int scrollPosition ) const
 {
-    return LineNumber( static_cast<LineNumber::UnderlyingType>(
-        std::round( static_cast<double>( scrollPosition ) / verticalScrollMultiplicator() ) ) );
+    const auto position = static_cast<uint64_t>(
+        std::round( static_cast<double>( scrollPosition ) / verticalScrollMultiplicator() ) );
+    return useTextWrap_ ? wrappedRows_.lineAtRow( position ) : LineNumber( position );
 }
 
 double AbstractLogView::verticalScrollMultiplicator() const
 {
+    const auto positions = useTextWrap_ ? wrappedRows_.nbRows() : getNbScrolledLines().get();
     return verticalScrollBar()->maximum() < std::numeric_limits<int>::max()
                ? 1.0
                : static_cast<double>( std::numeric_limits<int>::max() )
-                     / static_cast<double>( logData_->getNbLine().get() );
+                     / static_cast<double>( positions );
 }
 
 void AbstractLogView::scrollContentsBy( int dx, int dy )
 {
-    LOG_DEBUG << "scrollContentsBy received " << dy << "position " << verticalScrollBar()->value();
+    LOG_TRACE << "scrollContentsBy received " << dy << "position " << verticalScrollBar()->value();
 
     const auto lastTopLine = ( logData_->getNbLine() - getNbVisibleLines() );
 
-    const auto scrollPosition = verticalScrollToLineNumber( verticalScrollBar()->value() );
+    auto scrollPosition = verticalScrollToLineNumber( verticalScrollBar()->value() );
+
+    if ( useTextWrap_ ) {
+        if ( updateWrappedRows( scrollPosition ) ) {
+            scrollPosition = verticalScrollToLineNumber( verticalScrollBar()->value() );
+        }
+
+        // Scrolling down inside a line taller than the scroll step shows the next line
+        if ( scrollPosition == firstLine_
+             && verticalScrollBar()->value() > lineNumberToVerticalScroll( firstLine_ )
+             && firstLine_.get() + 1 < logData_->getNbLine().get() ) {
+            ++scrollPosition;
+        }
+    }
 
     if ( ( lastTopLine.get() > 0 ) && scrollPosition.get() > lastTopLine.get() ) {
         // The user is going further than the last line, we need to lock the last line at the bottom
         LOG_DEBUG << "scrollContentsBy beyond!";
-        firstLine_ = scrollPosition;
+        // Lines after the indexed ones are not there yet
+        firstLine_ = estimatedNbLines_ > logData_->getNbLine() ? LineNumber( lastTopLine.get() )
+                                                                : scrollPosition;
         lastLineAligned_ = true;
     }
     else {
@@ -1101,6 +1166,11 @@ void AbstractLogView::scrollContentsBy( int dx, int dy )
 
     firstCol_ = ( firstCol_.get() - dx ) >= 0 ? LineColumn{ firstCol_.get() - dx } : 0_lcol;
 
+    // Scroll bar is moved to the row of the first line
+    if ( useTextWrap_ ) {
+        updateScrollBars();
+    }
+
     // Update the overview if we have one
     if ( overview_ != nullptr ) {
         const auto lastLine = firstLine_ + getNbVisibleLines();
@@ -1121,7 +1191,7 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
     if ( ( invalidRect.isEmpty() ) || ( logData_ == nullptr ) )
         return;
 
-    LOG_DEBUG << "paintEvent received, firstLine_=" << firstLine_
+    LOG_TRACE << "paintEvent received, firstLine_=" << firstLine_
               << " lastLineAligned_=" << lastLineAligned_ << " rect: " << invalidRect.topLeft().x()
               << ", " << invalidRect.topLeft().y() << ", " << invalidRect.bottomRight().x() << ", "
               << invalidRect.bottomRight().y();
@@ -1138,6 +1208,19 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
 
     auto start = std::chrono::system_clock::now();
 
+    static auto& paintDuration = Metrics::get().histogram( "view.paint_us" );
+    static auto& textAreaDrawings = Metrics::get().counter( "view.text_area_drawings" );
+    static auto& textAreaDuration = Metrics::get().histogram( "view.draw_text_area_us" );
+    const Metrics::ScopedTimer paintTimer( paintDuration );
+    const TraceSpan paintSpan( "paint", "view", "line",
+                               static_cast<int64_t>( firstLine_.get() ) );
+
+    // Phases of drawing the text area are added by drawTextArea
+    const auto paintStart = std::chrono::steady_clock::now();
+    renderStats_.textFetch = {};
+    renderStats_.highlighting = {};
+    renderStats_.drawing = {};
+
     // Can we use our cache?
     auto deltaY = textAreaCache_.first_line_.get() - firstLine_.get();
 
@@ -1148,19 +1231,31 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
 
     if ( deltaY != 0 ) {
         // Full or partial redraw
-        drawTextArea( &textAreaCache_.pixmap_ );
+        const Metrics::ScopedTimer textAreaTimer( textAreaDuration );
+        const auto isCacheValid
+            = !textAreaCache_.invalid_ && textAreaCache_.first_column_ == firstCol_;
+        if ( !isCacheValid || !scrollTextArea( textAreaCache_.first_line_ ) ) {
+            const TraceSpan drawSpan( "draw text area", "view" );
+            drawTextArea( &textAreaCache_.pixmap_ );
+            textAreaDrawings.add();
+            ++renderStats_.textAreaDrawn;
+        }
+        else {
+            ++renderStats_.textAreaScrolled;
+        }
 
         textAreaCache_.invalid_ = false;
         textAreaCache_.first_line_ = firstLine_;
         textAreaCache_.first_column_ = firstCol_;
 
-        LOG_DEBUG << "End of writing "
+        LOG_TRACE << "End of writing "
                   << std::chrono::duration_cast<std::chrono::microseconds>(
                          std::chrono::system_clock::now() - start )
                          .count();
     }
     else {
         // Use the cache as is: nothing to do!
+        ++renderStats_.textAreaReused;
     }
 
     // Height including the potentially invisible last line
@@ -1173,7 +1268,7 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
                   : 0 );
 
     if ( pullToFollowHeight && ( pullToFollowCache_.nb_columns_ != getNbVisibleCols() ) ) {
-        LOG_DEBUG << "Drawing pull to follow bar";
+        LOG_TRACE << "Drawing pull to follow bar";
         pullToFollowCache_.pixmap_
             = drawPullToFollowBar( viewport()->width(), viewport()->devicePixelRatio() );
         pullToFollowCache_.nb_columns_ = getNbVisibleCols();
@@ -1211,7 +1306,17 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
         devicePainter.drawPixmap( 0, drawingPullToFollowTopPosition, pullToFollowCache_.pixmap_ );
     }
 
-    LOG_DEBUG << "End of repaint "
+    if ( !framesCounter_.addEvent() ) {
+        renderStats_.framesPerSecond = framesCounter_.readAndReset();
+        framesCounter_.addEvent();
+    }
+
+    if ( isRenderStatsVisible_ ) {
+        renderStats_.paint = std::chrono::steady_clock::now() - paintStart;
+        drawRenderStats( devicePainter );
+    }
+
+    LOG_TRACE << "End of repaint "
               << std::chrono::duration_cast<std::chrono::microseconds>(
                      std::chrono::system_clock::now() - start )
                      .count();
@@ -1225,6 +1330,28 @@ LineNumber AbstractLogView::displayLineNumber( LineNumber lineNumber ) const
     return lineNumber + 1_lcount; // show a 1-based index
 }
 
+klogg::vector<AbstractLogData::LineType> AbstractLogView::lineTypes( LineNumber first,
+                                                                     LinesCount number ) const
+{
+    klogg::vector<AbstractLogData::LineType> types;
+    types.reserve( number.get() );
+    for ( auto line = first; line < first + number; ++line ) {
+        types.push_back( lineType( line ) );
+    }
+    return types;
+}
+
+klogg::vector<LineNumber> AbstractLogView::displayLineNumbers( LineNumber first,
+                                                               LinesCount number ) const
+{
+    klogg::vector<LineNumber> lineNumbers;
+    lineNumbers.reserve( number.get() );
+    for ( auto line = first; line < first + number; ++line ) {
+        lineNumbers.push_back( displayLineNumber( line ) );
+    }
+    return lineNumbers;
+}
+
 LineNumber AbstractLogView::lineIndex( LineNumber lineNumber ) const
 {
     return lineNumber;
@@ -1235,6 +1362,27 @@ LineNumber AbstractLogView::maxDisplayLineNumber() const
     return LineNumber( logData_->getNbLine().get() );
 }
 
+bool AbstractLogView::isDataAppendOnly() const
+{
+    return false;
+}
+
+const AbstractLogData* AbstractLogView::sourceData() const
+{
+    return logData_;
+}
+
+klogg::vector<LineNumber> AbstractLogView::sourceLineNumbers( LineNumber first,
+                                                              LinesCount number ) const
+{
+    klogg::vector<LineNumber> lineNumbers;
+    lineNumbers.reserve( number.get() );
+    for ( auto line = first; line < first + number; ++line ) {
+        lineNumbers.push_back( line );
+    }
+    return lineNumbers;
+}
+
 void AbstractLogView::setOverview( Overview* overview, OverviewWidget* overviewWidget )
 {
     overview_ = overview;
@@ -1347,6 +1495,8 @@ void AbstractLogView::followSet( bool checked )
 void AbstractLogView::textWrapSet( bool checked )
 {
     useTextWrap_ = checked;
+    // Lines may have changed while they were not wrapped
+    wrappedRowsColumns_ = 0_length;
     updateScrollBars();
     forceRefresh();
 }
@@ -1372,6 +1522,7 @@ void AbstractLogView::handlePatternUpdated()
     LOG_DEBUG << "AbstractLogView::handlePatternUpdated()";
 
     quickFind_->resetLimits();
+    ++quickFindGeneration_;
     forceRefresh();
 }
 
@@ -1432,24 +1583,94 @@ void AbstractLogView::findPreviousSelected()
 // Copy the selection to the clipboard
 void AbstractLogView::copy()
 {
-    try {
-        auto clipboard = QApplication::clipboard();
-        auto text = selection_.getSelectedText( logData_ );
-        text.replace( QChar::Null, QChar::Space );
-        clipboard->setText( text );
-    } catch ( std::exception& err ) {
-        LOG_ERROR << "failed to copy data to clipboard " << err.what();
-    }
+    copySelection( false );
 }
 
 // Copy the selection with line numbers to the clipboard
 void AbstractLogView::copyWithLineNumbers()
 {
+    copySelection( true );
+}
+
+void AbstractLogView::copySelection( bool lineNumbers )
+{
+    const auto nbLines = selection_.getSelectedLinesCount();
+    const auto selectedRange = selection_.getSelectedRange();
+
+    if ( selectedRange && nbLines.get() > MaxCopiedLines ) {
+        const auto answer = QMessageBox::question(
+            this, tr( "Copy selection" ),
+            tr( "The selection has %1 lines, copying it to the clipboard needs a lot of "
+                "memory. Save it to a file instead?" )
+                .arg( nbLines.get() ),
+            QMessageBox::Save | QMessageBox::Ignore | QMessageBox::Cancel, QMessageBox::Save );
+
+        if ( answer == QMessageBox::Save ) {
+            saveLinesToFile( selectedRange->first, selectedRange->second + 1_lcount );
+        }
+        if ( answer != QMessageBox::Ignore ) {
+            return;
+        }
+    }
+
+    QString text;
     try {
-        auto clipboard = QApplication::clipboard();
-        auto text = selection_.getSelectedText( logData_, true );
+        if ( nbLines.get() <= BackgroundCopyLines ) {
+            text = selection_.getSelectedText( logData_, lineNumbers );
+        }
+        else {
+            QProgressDialog progressDialog( this );
+            progressDialog.setLabelText( tr( "Copying %1 lines" ).arg( nbLines.get() ) );
+            progressDialog.setRange( 0, 1000 );
+            progressDialog.setWindowModality( Qt::ApplicationModal );
+
+            AtomicFlag interruptRequest;
+            connect( &progressDialog, &QProgressDialog::canceled,
+                     [ &interruptRequest ]() { interruptRequest.set(); } );
+
+            // Lines are read and the text is built while the dialog is shown, search
+            // progress can change the view data meanwhile so they are read from the source
+            auto sourceLines = sourceLineNumbers( selectedRange->first, nbLines );
+            QFutureWatcher<QString> textWatcher;
+            QEventLoop copyLoop;
+            connect( &textWatcher, &QFutureWatcher<QString>::finished, &copyLoop,
+                     &QEventLoop::quit );
+
+            textWatcher.setFuture( QtConcurrent::run(
+                [ sourceLines = std::move( sourceLines ), logData = sourceData(), lineNumbers,
+                  nbLines, &interruptRequest, &progressDialog ]() {
+                    try {
+                        return Selection::getLinesText(
+                            logData, sourceLines, lineNumbers,
+                            [ nbLines, &interruptRequest,
+                              &progressDialog ]( LinesCount linesAdded ) {
+                                const auto progress
+                                    = static_cast<int>( linesAdded.get() * 1000 / nbLines.get() );
+                                QMetaObject::invokeMethod(
+                                    &progressDialog,
+                                    [ &progressDialog, progress ]() {
+                                        progressDialog.setValue( progress );
+                                    },
+                                    Qt::QueuedConnection );
+                                return !interruptRequest;
+                            } );
+                    } catch ( const std::bad_alloc& ) {
+                        LOG_ERROR << "not enough memory to copy the selection";
+                        return QString{};
+                    }
+                } ) );
+
+            progressDialog.open();
+            copyLoop.exec();
+
+            if ( interruptRequest ) {
+                return;
+            }
+            text = textWatcher.result();
+        }
+
         text.replace( QChar::Null, QChar::Space );
-        clipboard->setText( text );
+        QApplication::clipboard()->setText( text );
     } catch ( std::exception& err ) {
         LOG_ERROR << "failed to copy data to clipboard " << err.what();
     }
@@ -1521,15 +1742,28 @@ void AbstractLogView::saveLinesToFile( LineNumber begin, LineNumber end )
              [ &interruptRequest ]() { interruptRequest.set(); } );
 
     tbb::flow::graph saveFileGraph;
-    using LinesData = std::pair<klogg::vector<QString>, bool>;
+    struct LinesData {
+        klogg::vector<QString> lines;
+        // Lines as they are in the file are written without encoding them again
+        QByteArray bytes;
+        bool hasData = false;
+    };
     auto lineReader = tbb::flow::input_node<LinesData>(
         saveFileGraph,
         [ this, &offsets, &interruptRequest, &progressDialog, offsetIndex = 0u,
           finalLine = false ]( tbb::flow_control& fc ) mutable -> LinesData {
             if ( !interruptRequest && offsetIndex < offsets.size() ) {
                 const auto& offset = offsets.at( offsetIndex );
-                LinesData lines{ logData_->getLines( offset.first, offset.second ), true };
-                for ( auto& l : lines.first ) {
+                LinesData lines;
+                lines.hasData = true;
+                if ( auto bytes = logData_->getLinesBytes( offset.first, offset.second ) ) {
+                    lines.bytes = std::move( *bytes );
+                }
+                else {
+                    lines.lines = logData_->getLines( offset.first, offset.second );
+                }
+
+                for ( auto& l : lines.lines ) {
 #if !defined( Q_OS_WIN )
                     l.append( QChar::CarriageReturn );
 #endif
@@ -1556,7 +1790,7 @@ void AbstractLogView::saveLinesToFile( LineNumber begin, LineNumber end )
         saveFileGraph, 1,
         [ &interruptRequest, &codec, &saveFile,
           &progressDialog ]( const LinesData& lines ) mutable {
-            if ( !lines.second ) {
+            if ( !lines.hasData ) {
                 if ( !interruptRequest ) {
                     saveFile.commit();
                 }
@@ -1565,7 +1799,13 @@ void AbstractLogView::saveLinesToFile( LineNumber begin, LineNumber end )
                 return tbb::flow::continue_msg{};
             }
 
-            for ( const auto& l : lines.first ) {
+            if ( saveFile.write( lines.bytes ) != lines.bytes.size() ) {
+                LOG_ERROR << "Saving file write failed";
+                interruptRequest.set();
+                return tbb::flow::continue_msg{};
+            }
+
+            for ( const auto& l : lines.lines ) {
 
                 const auto encodedLine = codec->fromUnicode( l );
                 const auto written = saveFile.write( encodedLine );
@@ -1654,6 +1894,9 @@ void AbstractLogView::updateData()
 
     // Reset the QuickFind in case we have new stuff to search into
     quickFind_->resetLimits();
+    if ( !isDataAppendOnly() ) {
+        quickFind_->truncateIndex();
+    }
 
     if ( followMode_ )
         jumpToBottom();
@@ -1668,10 +1911,44 @@ void AbstractLogView::updateData()
     forceRefresh();
 }
 
+void AbstractLogView::updateDataAfter( LineNumber firstAddedLine )
+{
+    // Lines are added in file order, so the shown lines and the one below them
+    // are the same if that one is still before the added lines
+    const auto nbLines = logData_->getNbLine();
+    const auto lineBelowShown = firstLine_ + getNbVisibleLines();
+    if ( followMode_ || lineBelowShown >= LineNumber( nbLines.get() )
+         || logData_->getLineNumber( lineBelowShown ).get() - 1 >= firstAddedLine.get() ) {
+        updateData();
+        return;
+    }
+
+    LOG_DEBUG << "AbstractLogView::updateDataAfter, lines added below the view";
+
+    // Only the scroll bars change
+    updateScrollBars();
+
+    quickFind_->resetLimits();
+    if ( !isDataAppendOnly() ) {
+        quickFind_->truncateIndex( lineBelowShown );
+    }
+}
+
+void AbstractLogView::setEstimatedNbLines( LinesCount lines )
+{
+    estimatedNbLines_ = lines;
+}
+
+void AbstractLogView::truncateQuickFindIndex( LineNumber firstChangedLine )
+{
+    quickFind_->truncateIndex( firstChangedLine );
+}
+
 void AbstractLogView::updateFont( const QFont& font )
 {
     setFont( font );
     pixmapFontMetrics_ = pixmapFontMetrics( font );
+    staticTextCache_.clear();
     updateDisplaySize();
     update();
 }
@@ -1765,6 +2042,9 @@ void AbstractLogView::jumpToLine( LineNumber line )
 {
     // Put the selected line in the middle if possible
     const auto newTopLine = line - LinesCount( getNbVisibleLines().get() / 2 );
+    if ( useTextWrap_ && updateWrappedRows( newTopLine ) ) {
+        updateScrollBars();
+    }
     // This will also trigger a scrollContents event
     verticalScrollBar()->setValue( lineNumberToVerticalScroll( newTopLine ) );
 }
@@ -1774,6 +2054,14 @@ void AbstractLogView::setLineNumbersVisible( bool lineNumbersVisible )
     lineNumbersVisible_ = lineNumbersVisible;
 }
 
+bool AbstractLogView::HighlightsKey::operator==( const HighlightsKey& other ) const
+{
+    return highlighterSet == other.highlighterSet && patternHighlight == other.patternHighlight
+           && quickHighlights == other.quickHighlights
+           && quickFindGeneration == other.quickFindGeneration
+           && quickFindBackColor == other.quickFindBackColor;
+}
+
 void AbstractLogView::forceRefresh()
 {
     // Invalidate our cache
@@ -1800,6 +2088,11 @@ LinesCount AbstractLogView::getNbVisibleLines() const
         static_cast<LinesCount::UnderlyingType>( viewport()->height() / charHeight_ + 1 ) );
 }
 
+LinesCount AbstractLogView::getNbScrolledLines() const
+{
+    return qMax( logData_->getNbLine(), estimatedNbLines_ );
+}
+
 // Returns the number of columns visible in the viewport
 LineLength AbstractLogView::getNbVisibleCols() const
 {
@@ -1986,10 +2279,23 @@ void AbstractLogView::jumpToTop()
 // Jump to the last line
 void AbstractLogView::jumpToBottom()
 {
-    const auto newTopLine
-        = ( logData_->getNbLine().get() < getNbVisibleLines().get() )
-              ? 0
-              : logData_->getNbLine().get() - getNbBottomWrappedVisibleLines().get() + 1;
+    auto newTopLine = ( logData_->getNbLine().get() < getNbVisibleLines().get() )
+                          ? 0
+                          : logData_->getNbLine().get() - getNbVisibleLines().get() + 1;
+
+    if ( useTextWrap_ ) {
+        // First line with all rows from it to the end in the view
+        updateScrollBars();
+        const auto nbRows = wrappedRows_.nbRows();
+        const auto firstRow = nbRows > getNbVisibleLines().get()
+                                  ? nbRows - getNbVisibleLines().get()
+                                  : uint64_t{ 0 };
+        auto topLine = wrappedRows_.lineAtRow( firstRow );
+        if ( wrappedRows_.rowsBefore( topLine ) < firstRow ) {
+            ++topLine;
+        }
+        newTopLine = topLine.get();
+    }
 
     // This will also trigger a scrollContents event
     verticalScrollBar()->setValue( lineNumberToVerticalScroll( LineNumber( newTopLine ) ) );
@@ -2032,8 +2338,10 @@ void AbstractLogView::updateGlobalSelection()
     try {
         auto clipboard = QApplication::clipboard();
 
-        // Updating it only for "non-trivial" (range or portion) selections
-        if ( !selection_.isSingleLine() )
+        // Updating it only for "non-trivial" (range or portion) selections,
+        // large ones are only copied on request
+        if ( !selection_.isSingleLine()
+             && selection_.getSelectedLinesCount().get() <= BackgroundCopyLines )
             clipboard->setText( selection_.getSelectedText( logData_ ), QClipboard::Selection );
     } catch ( std::exception& err ) {
         LOG_ERROR << "failed to copy data to clipboard " << err.what();
@@ -2103,6 +2411,14 @@ void AbstractLogView::createMenu()
     connect( excludeFromSearchAction_, &QAction::triggered, this,
              [ this ]( auto ) { this->excludeFromSearch(); } );
 
+    showIdenticalLinesAction_ = new QAction( tr( "Show identical lines" ), this );
+    showIdenticalLinesAction_->setStatusTip( tr( "Show the lines identical to this one" ) );
+    connect( showIdenticalLinesAction_, &QAction::triggered, this, [ this ]( auto ) {
+        if ( const auto selectedLine = selection_.selectedLine() ) {
+            Q_EMIT showIdenticalLines( displayLineNumber( *selectedLine ) - 1_lcount );
+        }
+    } );
+
     setSearchStartAction_ = new QAction( tr( "Set search start" ), this );
     connect( setSearchStartAction_, &QAction::triggered, this,
              [ this ]( auto ) { this->setSearchStart(); } );
@@ -2131,6 +2447,19 @@ void AbstractLogView::createMenu()
     connect( sendToScratchpadAction_, &QAction::triggered, this,
              [ this ]( auto ) { Q_EMIT sendSelectionToScratchpad(); } );
 
+    showSelectionStatisticsAction_ = new QAction( tr( "Number statistics..." ), this );
+    showSelectionStatisticsAction_->setStatusTip(
+        tr( "Show statistics of the numbers of a field of the selected lines" ) );
+    connect( showSelectionStatisticsAction_, &QAction::triggered, this, [ this ]( auto ) {
+        auto lines = selection_.getLines();
+        for ( auto& line : lines ) {
+            line = displayLineNumber( line ) - 1_lcount;
+        }
+        if ( !lines.empty() ) {
+            Q_EMIT showSelectionStatistics( lines );
+        }
+    } );
+
     replaceInScratchpadAction_ = new QAction( tr( "Replace scratchpad" ), this );
     connect( replaceInScratchpadAction_, &QAction::triggered, this,
              [ this ]( auto ) { Q_EMIT replaceScratchpadWithSelection(); } );
@@ -2146,6 +2475,7 @@ void AbstractLogView::createMenu()
     popupMenu_->addAction( copyWithLineNumbersAction_ );
     popupMenu_->addAction( sendToScratchpadAction_ );
     popupMenu_->addAction( replaceInScratchpadAction_ );
+    popupMenu_->addAction( showSelectionStatisticsAction_ );
     popupMenu_->addSeparator();
     popupMenu_->addAction( findNextAction_ );
     popupMenu_->addAction( findPreviousAction_ );
@@ -2153,6 +2483,7 @@ void AbstractLogView::createMenu()
     popupMenu_->addAction( replaceSearchAction_ );
     popupMenu_->addAction( addToSearchAction_ );
     popupMenu_->addAction( excludeFromSearchAction_ );
+    popupMenu_->addAction( showIdenticalLinesAction_ );
     popupMenu_->addSeparator();
     popupMenu_->addAction( setSearchStartAction_ );
     popupMenu_->addAction( setSearchEndAction_ );
@@ -2186,40 +2517,80 @@ void AbstractLogView::considerMouseHovering( int xPos, int yPos )
     }
 }
 
-LinesCount AbstractLogView::getNbBottomWrappedVisibleLines() const
+bool AbstractLogView::updateWrappedRows( LineNumber line )
 {
-    const auto visibleLines = getNbVisibleLines();
+    const auto nbLines = logData_->getNbLine();
+    const auto nbVisibleCols = getNbVisibleCols();
 
-    if ( useTextWrap_ ) {
-        const auto totalLines = logData_->getNbLine();
+    auto isChanged = false;
+    if ( nbVisibleCols != wrappedRowsColumns_ ) {
+        wrappedRows_.reset( nbLines );
+        wrappedRowsColumns_ = nbVisibleCols;
+        isChanged = true;
+    }
+    else if ( wrappedRows_.nbLines() != nbLines ) {
+        wrappedRows_.resize( nbLines );
+        isChanged = true;
+    }
+
+    if ( nbLines.get() == 0 ) {
+        return isChanged;
+    }
+
+    // Lines are wrapped as WrappedLinesView does, empty ones take a row
+    const auto lastLineInData = LineNumber( nbLines.get() - 1 );
+    const auto firstLine = std::min( line, lastLineInData );
+    const auto lastLine = std::min( firstLine + getNbVisibleLines(), lastLineInData );
+    const auto columns = static_cast<uint64_t>(
+        std::max( nbVisibleCols.get(), LineLength::UnderlyingType{ 1 } ) );
+
+    for ( auto block = wrappedRows_.blockOfLine( firstLine );
+          block <= wrappedRows_.blockOfLine( lastLine ); ++block ) {
+        if ( wrappedRows_.isMeasured( block ) ) {
+            continue;
+        }
 
-        LinesCount wrappedLinesCount{ 0 };
-        LinesCount offset = 0_lcount;
-        for ( ; offset < visibleLines && offset < totalLines && wrappedLinesCount < visibleLines;
-              ++offset ) {
-            LineNumber line = LineNumber{ totalLines.get() } - offset;
-            wrappedLinesCount += LinesCount{ static_cast<LinesCount::UnderlyingType>(
-                logData_->getLineLength( line ).get() / getNbVisibleCols().get() + 1 ) };
+        const auto blockFirstLine = wrappedRows_.firstLineOfBlock( block );
+        klogg::vector<uint64_t> lineRows( wrappedRows_.linesInBlock( block ).get() );
+        for ( auto index = 0u; index < lineRows.size(); ++index ) {
+            const auto length = static_cast<uint64_t>(
+                logData_->getLineLength( blockFirstLine + LinesCount( index ) ).get() );
+            lineRows[ index ] = ( length + columns - 1 ) / columns;
         }
 
-        return offset;
+        wrappedRows_.setBlockRows( block, lineRows );
+        isChanged = true;
     }
-    return visibleLines;
+
+    return isChanged;
 }
 
 void AbstractLogView::updateScrollBars()
 {
-    if ( logData_->getNbLine() < getNbVisibleLines() ) {
+    if ( useTextWrap_ ) {
+        // Rows at the end are measured so the last line can be scrolled into the view
+        const auto nbLines = logData_->getNbLine().get();
+        const auto nbVisibleLines = getNbVisibleLines().get();
+        updateWrappedRows( LineNumber( nbLines > nbVisibleLines ? nbLines - nbVisibleLines : 0 ) );
+        updateWrappedRows( firstLine_ );
+
+        const auto nbRows = wrappedRows_.nbRows();
+        const auto maxRow = nbRows < nbVisibleLines ? 0 : nbRows - nbVisibleLines + 1;
+
+        // Position follows the first line, it is not moved by the new range
+        const QSignalBlocker blocker( verticalScrollBar() );
+        verticalScrollBar()->setRange(
+            0, static_cast<int>(
+                   std::min( maxRow, uint64_t{ std::numeric_limits<int>::max() } ) ) );
+        verticalScrollBar()->setValue( lineNumberToVerticalScroll( firstLine_ ) );
+    }
+    else if ( getNbScrolledLines() < getNbVisibleLines() ) {
         verticalScrollBar()->setRange( 0, 0 );
     }
     else {
-        const auto visibleWrappedLines = getNbBottomWrappedVisibleLines();
-        const auto wrappedLinesScrollAdjust = ( getNbVisibleLines() - visibleWrappedLines ).get();
-
         verticalScrollBar()->setRange(
-            0, static_cast<int>( qMin( logData_->getNbLine().get() - getNbVisibleLines().get()
-                                           + LinesCount::UnderlyingType{ 1 }
-                                           + wrappedLinesScrollAdjust,
+            0, static_cast<int>( qMin( getNbScrolledLines().get() - getNbVisibleLines().get()
+                                           + LinesCount::UnderlyingType{ 1 },
                                        maxValue<LinesCount>().get() ) ) );
     }
 
@@ -2234,8 +2605,209 @@ void AbstractLogView::updateScrollBars()
         type_safe::narrow_cast<int>( getNbVisibleCols().get() * 7 / 8 ) );
 }
 
+AbstractLogView::LineHighlights
+AbstractLogView::matchHighlights( const HighlightsKey& key,
+                                  const QuickFindMatcher& quickFindMatcher, const QString& logLine,
+                                  const QString& expandedLine, bool isSearchMatch )
+{
+    LineHighlights lineHighlights;
+    lineHighlights.line = logLine;
+    lineHighlights.isSearchMatch = isSearchMatch;
+
+    klogg::vector<HighlightedMatch> highlighterMatches;
+    lineHighlights.matchType = key.highlighterSet.matchLine( logLine, highlighterMatches );
+
+    if ( key.patternHighlight && isSearchMatch ) {
+        klogg::vector<HighlightedMatch> patternMatches;
+        key.patternHighlight->matchLine( logLine, patternMatches );
+        highlighterMatches.insert( highlighterMatches.end(), patternMatches.begin(),
+                                   patternMatches.end() );
+    }
+
+    if ( key.quickHighlights ) {
+        klogg::vector<WordsMatcher::Match> wordMatches;
+        key.quickHighlights->matcher.match( logLine, wordMatches );
+
+        highlighterMatches.reserve( highlighterMatches.size() + wordMatches.size() );
+        for ( const auto& match : wordMatches ) {
+            const auto& [ word, foreColor, backColor ]
+                = key.quickHighlights->words[ static_cast<size_t>( match.word ) ];
+            highlighterMatches.emplace_back( LineColumn{ match.start }, LineLength{ match.length },
+                                             foreColor, backColor );
+        }
+    }
+
+    const auto untabifyHighlight = [ &logLine ]( const auto& match ) {
+#if QT_VERSION >= QT_VERSION_CHECK( 5, 10, 0 )
+        const auto prefix = QStringView{ logLine }.left( match.startColumn().get() );
+        const auto matchPart
+            = QStringView{ logLine }.mid( match.startColumn().get(), match.size().get() );
+#else
+        const auto prefix = logLine.leftRef( match.startColumn().get() );
+        const auto matchPart = logLine.midRef( match.startColumn().get(), match.size().get() );
+#endif
+        const auto expandedPrefixLength = untabify( prefix.toString() ).size();
+        const LineLength startDelta
+            = LineLength{ type_safe::narrow_cast<LineLength::UnderlyingType>(
+                expandedPrefixLength - prefix.size() ) };
+
+        const LineLength expandedMatchLength = LineLength{
+            untabify( matchPart.toString(),
+                      LineColumn{ type_safe::narrow_cast<LineColumn::UnderlyingType>(
+                          expandedPrefixLength ) } )
+                .size()
+        };
+
+        const auto lengthDelta
+            = expandedMatchLength
+              - LineLength{ type_safe::narrow_cast<LineLength::UnderlyingType>(
+                  matchPart.size() ) };
+
+        return HighlightedMatch{ match.startColumn() + startDelta, match.size() + lengthDelta,
+                                 match.foreColor(), match.backColor() };
+    };
+
+    lineHighlights.matches.reserve( highlighterMatches.size() );
+    std::transform( highlighterMatches.cbegin(), highlighterMatches.cend(),
+                    std::back_inserter( lineHighlights.matches ), untabifyHighlight );
+
+    // Has the line got elements to be highlighted
+    quickFindMatcher.matchLine( expandedLine, lineHighlights.quickFindMatches );
+
+    return lineHighlights;
+}
+
+bool AbstractLogView::isSearchHighlighted( AbstractLogData::LineType lineType ) const
+{
+    // Matches of the search are known, other lines are not matched again
+    return highlightsKey_.patternHighlight.has_value()
+           && lineType.testFlag( AbstractLogData::LineTypeFlags::Match );
+}
+
+bool AbstractLogView::scrollTextArea( LineNumber cachedFirstLine )
+{
+    auto& pixmap = textAreaCache_.pixmap_;
+    const auto pixmapHeight
+        = static_cast<int>( std::floor( pixmap.height() / viewport()->devicePixelRatio() ) );
+    const auto linesInFile = logData_->getNbLine();
+    const auto nbVisibleLines = getNbVisibleLines();
+
+    if ( firstLine_ >= linesInFile || wrappedLinesNumbers_.empty() || charHeight_ <= 0 ) {
+        return false;
+    }
+
+    // A row is a line or a part of a wrapped line
+    using Row = std::pair<LineNumber, size_t>;
+    klogg::vector<Row> cachedRows;
+    int shiftedRows = 0;
+
+    auto firstDrawnLine = firstLine_;
+    auto drawnLinesCount = nbVisibleLines;
+    auto top = 0;
+    auto bottom = pixmapHeight;
+
+    if ( firstLine_ > cachedFirstLine ) {
+        // Rows of lines above the view are scrolled out
+        const auto firstRow = std::find_if(
+            wrappedLinesNumbers_.begin(), wrappedLinesNumbers_.end(),
+            [ this ]( const Row& row ) { return row.first >= firstLine_; } );
+        if ( firstRow == wrappedLinesNumbers_.end() || firstRow->first != firstLine_ ) {
+            return false;
+        }
+
+        // Last line may be cut by the bottom of the area, it is drawn again
+        const auto lastLine = wrappedLinesNumbers_.back().first;
+        const auto lastLineRow
+            = std::find_if( firstRow, wrappedLinesNumbers_.end(),
+                            [ lastLine ]( const Row& row ) { return row.first == lastLine; } );
+        if ( lastLineRow == firstRow || lastLine >= linesInFile ) {
+            return false;
+        }
+
+        shiftedRows = -static_cast<int>( std::distance( wrappedLinesNumbers_.begin(), firstRow ) );
+        cachedRows.assign( firstRow, lastLineRow );
+
+        firstDrawnLine = lastLine;
+        top = static_cast<int>( cachedRows.size() ) * charHeight_;
+    }
+    else {
+        // Lines above the cached ones are drawn at the top
+        const auto newLinesCount = cachedFirstLine - firstLine_;
+        if ( newLinesCount >= nbVisibleLines ) {
+            return false;
+        }
+
+        auto newRows = static_cast<int>( newLinesCount.get() );
+        if ( useTextWrap_ ) {
+            newRows = 0;
+            const auto nbVisibleCols = getNbVisibleCols();
+            for ( const auto& line : logData_->getExpandedLines( firstLine_, newLinesCount ) ) {
+                newRows += static_cast<int>(
+                    WrappedLinesView{ line, nbVisibleCols }.wrappedLinesCount() );
+            }
+        }
+        if ( newRows * charHeight_ >= pixmapHeight ) {
+            return false;
+        }
+
+        shiftedRows = newRows;
+        for ( const auto& row : wrappedLinesNumbers_ ) {
+            if ( ( static_cast<int>( cachedRows.size() ) + newRows ) * charHeight_
+                 >= pixmapHeight ) {
+                break;
+            }
+            cachedRows.push_back( row );
+        }
+
+        drawnLinesCount = newLinesCount;
+        bottom = newRows * charHeight_;
+    }
+
+    // Fractional scaling would leave seams between moved and drawn rows
+    const auto shift = shiftedRows * charHeight_ * pixmap.devicePixelRatio();
+    if ( std::abs( shift - std::round( shift ) ) > 0.01 ) {
+        return false;
+    }
+
+    pixmap.scroll( 0, static_cast<int>( std::round( shift ) ), pixmap.rect() );
+    drawTextArea( &pixmap, firstDrawnLine, drawnLinesCount, top, bottom );
+
+    if ( shiftedRows < 0 ) {
+        wrappedLinesNumbers_.insert( wrappedLinesNumbers_.begin(), cachedRows.begin(),
+                                     cachedRows.end() );
+    }
+    else {
+        wrappedLinesNumbers_.insert( wrappedLinesNumbers_.end(), cachedRows.begin(),
+                                     cachedRows.end() );
+    }
+
+    return true;
+}
+
 void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
 {
+    // First check the lines to be drawn are within range (might not be the case if
+    // the file has just changed)
+    const auto linesInFile = logData_->getNbLine();
+
+    if ( firstLine_ >= linesInFile )
+        firstLine_ = LineNumber( linesInFile.get() ? linesInFile.get() - 1 : 0 );
+
+    const int paintDeviceHeight
+        = static_cast<int>( std::floor( paintDevice->height() / viewport()->devicePixelRatio() ) );
+
+    drawTextArea( paintDevice, firstLine_, getNbVisibleLines(), 0, paintDeviceHeight );
+}
+
+void AbstractLogView::drawTextArea( QPaintDevice* paintDevice, LineNumber firstLine,
+                                    LinesCount maxLines, int top, int bottom )
+{
+    // Time of reading lines and matching highlights, the rest is drawing
+    using Clock = std::chrono::steady_clock;
+    const auto drawStart = Clock::now();
+    Clock::duration textFetch{};
+    Clock::duration highlighting{};
+
     // LOG_DEBUG << "devicePixelRatio: " << viewport()->devicePixelRatio();
     // LOG_DEBUG << "viewport size: " << viewport()->size().width();
     // LOG_DEBUG << "pixmap size: " << textPixmap.width();
@@ -2268,27 +2840,26 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
     static constexpr int ContentMarginWidth = 1;
     static constexpr int LineNumberPadding = 3;
 
-    // First check the lines to be drawn are within range (might not be the case if
-    // the file has just changed)
     const auto linesInFile = logData_->getNbLine();
+    const auto nbLines = firstLine < linesInFile
+                             ? qMin( maxLines, linesInFile - LinesCount( firstLine.get() ) )
+                             : 0_lcount;
 
-    if ( firstLine_ >= linesInFile )
-        firstLine_ = LineNumber( linesInFile.get() ? linesInFile.get() - 1 : 0 );
-
-    const auto nbLines = qMin( getNbVisibleLines(), linesInFile - LinesCount( firstLine_.get() ) );
+    const int bottomOfTextPx = top + static_cast<int>( nbLines.get() ) * fontHeight;
 
-    const int bottomOfTextPx = static_cast<int>( nbLines.get() ) * fontHeight;
-
-    LOG_DEBUG << "drawing lines from " << firstLine_ << " (" << nbLines << " lines)";
+    LOG_DEBUG << "drawing lines from " << firstLine << " (" << nbLines << " lines)";
     LOG_DEBUG << "bottomOfTextPx: " << bottomOfTextPx;
     LOG_DEBUG << "Height: " << paintDeviceHeight;
 
-    painter->fillRect( 0, 0, paintDeviceWidth, paintDeviceHeight,
-                       palette.color( QPalette::Window ) );
+    // Lines around the drawn ones are kept
+    painter->setClipRect( 0, top, paintDeviceWidth, bottom - top );
+    const int bandHeight = bottom - top;
+
+    painter->fillRect( 0, top, paintDeviceWidth, bandHeight, palette.color( QPalette::Window ) );
 
     // First draw the bullet left margin
     painter->setPen( palette.color( QPalette::Text ) );
-    painter->fillRect( 0, 0, BulletAreaWidth, paintDeviceHeight, Qt::darkGray );
+    painter->fillRect( 0, top, BulletAreaWidth, bandHeight, Qt::darkGray );
 
     // Column at which the content should start (pixels)
     int contentStartPosX = BulletAreaWidth + SeparatorWidth;
@@ -2307,23 +2878,22 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
         lineNumberAreaStartX = contentStartPosX;
 
         painter->setPen( palette.color( QPalette::Text ) );
-        painter->fillRect( contentStartPosX - SeparatorWidth, 0,
-                           lineNumberAreaWidth + SeparatorWidth, paintDeviceHeight, Qt::darkGray );
+        painter->fillRect( contentStartPosX - SeparatorWidth, top,
+                           lineNumberAreaWidth + SeparatorWidth, bandHeight, Qt::darkGray );
 
-        painter->drawLine( contentStartPosX + lineNumberAreaWidth - SeparatorWidth, 0,
-                           contentStartPosX + lineNumberAreaWidth - SeparatorWidth,
-                           paintDeviceHeight );
+        painter->drawLine( contentStartPosX + lineNumberAreaWidth - SeparatorWidth, top,
+                           contentStartPosX + lineNumberAreaWidth - SeparatorWidth, bottom );
 
         // Update for drawing the actual text
         contentStartPosX += lineNumberAreaWidth;
     }
     else {
-        painter->fillRect( contentStartPosX - SeparatorWidth, 0, SeparatorWidth + 1,
-                           paintDeviceHeight, palette.color( QPalette::Disabled, QPalette::Text ) );
+        painter->fillRect( contentStartPosX - SeparatorWidth, top, SeparatorWidth + 1, bandHeight,
+                           palette.color( QPalette::Disabled, QPalette::Text ) );
         // contentStartPosX += SEPARATOR_WIDTH;
     }
 
-    painter->drawLine( BulletAreaWidth, 0, BulletAreaWidth, paintDeviceHeight - 1 );
+    painter->drawLine( BulletAreaWidth, top, BulletAreaWidth, bottom - 1 );
 
     // This is the total width of the 'margin' (including line number if any)
     // used for mouse calculation etc...
@@ -2341,9 +2911,6 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
         return index;
     }();
 
-    // Lines to write
-    const auto expandedLines = logData_->getExpandedLines( firstLine_, nbLines );
-
     const auto highlightPatternMatches = Configuration::get().mainSearchHighlight();
     const auto variateHighlightPatternMatches = Configuration::get().variateMainSearchHighlight();
 
@@ -2362,7 +2929,7 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
         patternHighlight->setForeColor( Qt::black );
     }
 
-    klogg::vector<Highlighter> additionalHighlighters;
+    klogg::vector<std::tuple<QString, QColor, QColor>> quickWords;
     for ( auto i = 0u; i < quickHighlighters_.size(); ++i ) {
         const auto quickHighlighterIndex = static_cast<int>( i );
         if ( quickHighlighterIndex >= quickHighlighters.size() ) {
@@ -2370,28 +2937,96 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
             break;
         }
 
-        const auto quickHighlighter = quickHighlighters.at( quickHighlighterIndex );
+        const auto& color = quickHighlighters.at( quickHighlighterIndex ).color;
+        for ( const auto& word : quickHighlighters_[ i ] ) {
+            quickWords.emplace_back( word, color.foreColor, color.backColor );
+        }
+    }
+
+    if ( !quickHighlights_ || quickHighlights_->words != quickWords ) {
+        QStringList words;
+        for ( const auto& quickWord : quickWords ) {
+            words.append( std::get<0>( quickWord ) );
+        }
+        quickHighlights_ = std::make_shared<const QuickHighlights>(
+            QuickHighlights{ std::move( quickWords ), WordsMatcher( words ) } );
+    }
 
-        std::transform( quickHighlighters_[ i ].begin(), quickHighlighters_[ i ].end(),
-                        std::back_inserter( additionalHighlighters ),
-                        [ quickHighlighter ]( const QString& word ) {
-                            Highlighter h{ word, false, true, quickHighlighter.color.foreColor,
-                                           quickHighlighter.color.backColor };
-                            h.setUseRegex( false );
-                            return h;
-                        } );
+    HighlightsKey highlightsKey{ highlighterSet, patternHighlight, quickHighlights_,
+                                 quickFindGeneration_, Configuration::get().qfBackColor() };
+    if ( !( highlightsKey == highlightsKey_ ) ) {
+        highlightsCache_.clear();
+        highlightsInsertedBytes_ = 0;
+        highlightsInsertedCost_ = 0;
+        highlightsKey_ = std::move( highlightsKey );
+        ++highlightsGeneration_;
     }
 
+    // Lines without highlights are drawn with default colors until they are matched
+    klogg::vector<LineNumber> unmatchedLines;
+
+    // Types and numbers of the lines drawn are found once for the page
+    auto phaseStart = Clock::now();
+    const auto pageLineTypes = lineTypes( firstLine, nbLines );
+    const auto pageLineNumbers = lineNumbersVisible_ ? displayLineNumbers( firstLine, nbLines )
+                                                     : klogg::vector<LineNumber>{};
+    textFetch += Clock::now() - phaseStart;
+
     // Position in pixel of the base line of the line to print
-    int yPos = 0;
+    int yPos = top;
     wrappedLinesNumbers_.clear();
     for ( auto currentLine = 0_lcount; currentLine < nbLines; ++currentLine ) {
-        const auto lineNumber = firstLine_ + currentLine;
-        const QString logLine = logData_->getLineString( lineNumber );
+        const auto lineNumber = firstLine + currentLine;
+
+        // Columns of a windowed line start at the first visible one
+        phaseStart = Clock::now();
+        const auto isWindowedLine
+            = !useTextWrap_ && logData_->getLineSize( lineNumber ) > LongLineWindowSize;
+        const auto windowFirstColumn = isWindowedLine ? firstCol_ : 0_lcol;
+        const auto drawnFirstColumn = isWindowedLine ? 0_lcol : firstCol_;
+
+        const QString logLine
+            = isWindowedLine ? logData_->getExpandedLineWindow( lineNumber, firstCol_,
+                                                               nbVisibleCols + 1_length )
+                             : logData_->getLineString( lineNumber );
+
+        // string to print, cut to fit the length and position of the view
+        const QString expandedLine = isWindowedLine ? logLine : untabify( QString( logLine ) );
 
         const int xPos = contentStartPosX + ContentMarginWidth;
 
-        klogg::vector<HighlightedMatch> highlighterMatches;
+        const auto highlightingStart = Clock::now();
+        textFetch += highlightingStart - phaseStart;
+
+        const auto isSearchMatch = isSearchHighlighted( pageLineTypes[ currentLine.get() ] );
+
+        std::optional<LineHighlights> windowHighlights;
+        const LineHighlights* lineHighlights = nullptr;
+        if ( isWindowedLine ) {
+            windowHighlights = matchHighlights( highlightsKey_, quickFindPattern_->getMatcher(),
+                                                logLine, expandedLine, isSearchMatch );
+            lineHighlights = &*windowHighlights;
+        }
+        else {
+            // Lines are compared as line numbers may show other lines after the data has changed,
+            // lines found by the search since they were matched are matched again
+            lineHighlights = highlightsCache_.object( lineNumber.get() );
+            if ( lineHighlights != nullptr
+                 && ( lineHighlights->line != logLine
+                      || lineHighlights->isSearchMatch != isSearchMatch ) ) {
+                lineHighlights = nullptr;
+            }
+            if ( lineHighlights == nullptr ) {
+                unmatchedLines.push_back( lineNumber );
+                ++renderStats_.highlightsMisses;
+            }
+            else {
+                ++renderStats_.highlightsHits;
+            }
+        }
+        highlighting += Clock::now() - highlightingStart;
+
+        klogg::vector<HighlightedMatch> allHighlights;
 
         if ( selection_.isLineSelected( lineNumber ) && !selection_.isSingleLine() ) {
             // Reverse the selected line
@@ -2400,12 +3035,11 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
             painter->setPen( palette.color( QPalette::Text ) );
         }
         else {
-            const auto highlightType = highlighterSet.matchLine( logLine, highlighterMatches );
-
-            if ( highlightType == HighlighterMatchType::LineMatch ) {
+            if ( lineHighlights != nullptr
+                 && lineHighlights->matchType == HighlighterMatchType::LineMatch ) {
                 // color applies to whole line
-                foreColor = highlighterMatches.front().foreColor();
-                backColor = highlighterMatches.front().backColor();
+                foreColor = lineHighlights->matches.front().foreColor();
+                backColor = lineHighlights->matches.front().backColor();
             }
             else {
                 // Use the default colors
@@ -2419,73 +3053,24 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
                 backColor = palette.color( QPalette::Base );
             }
 
-            if ( patternHighlight ) {
-                klogg::vector<HighlightedMatch> patternMatches;
-                patternHighlight->matchLine( logLine, patternMatches );
-                highlighterMatches.insert( highlighterMatches.end(), patternMatches.begin(),
-                                           patternMatches.end() );
-            }
-
-            highlighterMatches.reserve( additionalHighlighters.size() );
-            for ( const auto& highlighter : additionalHighlighters ) {
-                klogg::vector<HighlightedMatch> patternMatches;
-                highlighter.matchLine( logLine, patternMatches );
-                highlighterMatches.insert( highlighterMatches.end(), patternMatches.begin(),
-                                           patternMatches.end() );
+            if ( lineHighlights != nullptr ) {
+                allHighlights = lineHighlights->matches;
             }
         }
 
-        const auto untabifyHighlight = [ &logLine ]( const auto& match ) {
-#if QT_VERSION >= QT_VERSION_CHECK( 5, 10, 0 )
-            const auto prefix = QStringView{ logLine }.left( match.startColumn().get() );
-            const auto matchPart
-                = QStringView{ logLine }.mid( match.startColumn().get(), match.size().get() );
-#else
-            const auto prefix = logLine.leftRef( match.startColumn().get() );
-            const auto matchPart = logLine.midRef( match.startColumn().get(), match.size().get() );
-#endif
-            const auto expandedPrefixLength = untabify( prefix.toString() ).size();
-            const LineLength startDelta
-                = LineLength{ type_safe::narrow_cast<LineLength::UnderlyingType>(
-                    expandedPrefixLength - prefix.size() ) };
-
-            const LineLength expandedMatchLength = LineLength{
-                untabify( matchPart.toString(),
-                          LineColumn{ type_safe::narrow_cast<LineColumn::UnderlyingType>(
-                              expandedPrefixLength ) } )
-                    .size()
-            };
-
-            const auto lengthDelta
-                = expandedMatchLength
-                  - LineLength{ type_safe::narrow_cast<LineLength::UnderlyingType>(
-                      matchPart.size() ) };
-
-            return HighlightedMatch{ match.startColumn() + startDelta, match.size() + lengthDelta,
-                                     match.foreColor(), match.backColor() };
-        };
-
-        klogg::vector<HighlightedMatch> allHighlights;
-        allHighlights.reserve( highlighterMatches.size() );
-        std::transform( highlighterMatches.cbegin(), highlighterMatches.cend(),
-                        std::back_inserter( allHighlights ), untabifyHighlight );
-
-        // string to print, cut to fit the length and position of the view
-        const QString& expandedLine = expandedLines[ currentLine.get() ];
-
-        // Has the line got elements to be highlighted
-        klogg::vector<HighlightedMatch> quickFindMatches;
-        quickFindPattern_->matchLine( expandedLine, quickFindMatches );
-        allHighlights.insert( allHighlights.end(),
-                              std::make_move_iterator( quickFindMatches.begin() ),
-                              std::make_move_iterator( quickFindMatches.end() ) );
+        if ( lineHighlights != nullptr ) {
+            allHighlights.insert( allHighlights.end(), lineHighlights->quickFindMatches.begin(),
+                                  lineHighlights->quickFindMatches.end() );
+        }
 
         // Is there something selected in the line?
         const auto selectionPortion = selection_.getPortionForLine( lineNumber );
-        if ( selectionPortion.isValid() ) {
-            allHighlights.emplace_back( selectionPortion.startColumn(), selectionPortion.size(),
-                                        palette.color( QPalette::HighlightedText ),
-                                        palette.color( QPalette::Highlight ) );
+        const auto selectionStart = std::max( selectionPortion.startColumn(), windowFirstColumn );
+        if ( selectionPortion.isValid() && selectionPortion.endColumn() >= selectionStart ) {
+            allHighlights.emplace_back(
+                LineColumn{ selectionStart.get() - windowFirstColumn.get() },
+                ( selectionPortion.endColumn() - selectionStart ) + 1_length,
+                palette.color( QPalette::HighlightedText ), palette.color( QPalette::Highlight ) );
         }
 
         const auto wrappedLineLength
@@ -2524,7 +3109,7 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
             auto columnIndexIt = columnIndexes.begin();
 
             const auto firstVisibleColumn
-                = std::clamp( useTextWrap_ ? 0_lcol : firstCol_, 0_lcol,
+                = std::clamp( useTextWrap_ ? 0_lcol : drawnFirstColumn, 0_lcol,
                               LineColumn{ klogg::isize( expandedLine ) } );
             std::advance( columnIndexIt, firstVisibleColumn.get() );
             while ( columnIndexIt != columnIndexes.end() ) {
@@ -2565,11 +3150,12 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
                                      backColor );
             }
             else {
-                lineDrawer.addChunk( firstCol_, firstCol_ + nbVisibleCols, foreColor, backColor );
+                lineDrawer.addChunk( drawnFirstColumn, drawnFirstColumn + nbVisibleCols, foreColor,
+                                     backColor );
             }
         }
         lineDrawer.draw( painter.get(), xPos, yPos, viewport()->width(), wrappedLineView,
-                         ContentMarginWidth );
+                         ContentMarginWidth, staticTextCache_ );
 
         if ( ( selection_.isLineSelected( lineNumber ) && selection_.isSingleLine() )
              || selection_.getPortionForLine( lineNumber ).isValid() ) {
@@ -2583,6 +3169,15 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
                                viewport()->width(), yPos + finalLineHeight );
         }
 
+        using LineTypeFlags = AbstractLogData::LineTypeFlags;
+        const auto currentLineType = pageLineTypes[ currentLine.get() ];
+
+        // Lines not shown before this one are marked by a separator
+        if ( currentLineType.testFlag( LineTypeFlags::Gap ) ) {
+            painter->setPen( QPen( palette.color( QPalette::Mid ), 1, Qt::DashLine ) );
+            painter->drawLine( xPos - ContentMarginWidth, yPos, viewport()->width(), yPos );
+        }
+
         // Then draw the bullet
         painter->setPen( Qt::black );
         const int circleSize = 3;
@@ -2590,8 +3185,6 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
         const int middleXLine = BulletAreaWidth / 2;
         const int middleYLine = yPos + ( fontHeight / 2 );
 
-        using LineTypeFlags = AbstractLogData::LineTypeFlags;
-        const auto currentLineType = lineType( lineNumber );
         if ( currentLineType.testFlag( LineTypeFlags::Mark ) ) {
             // A pretty arrow if the line is marked
             const QPointF points[ 7 ] = {
@@ -2624,7 +3217,7 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
         if ( lineNumbersVisible_ ) {
             static const QString lineNumberFormat( "%1" );
             const QString& lineNumberStr = lineNumberFormat.arg(
-                displayLineNumber( lineNumber ).get(), nbDigitsInLineNumber );
+                pageLineNumbers[ currentLine.get() ].get(), nbDigitsInLineNumber );
             painter->setPen( Qt::white );
             painter->drawText( lineNumberAreaStartX + LineNumberPadding, yPos + fontAscent,
                                lineNumberStr );
@@ -2638,6 +3231,231 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
             break;
         }
     } // For each line
+
+    phaseStart = Clock::now();
+    if ( !unmatchedLines.empty() ) {
+        requestHighlights( std::move( unmatchedLines ), getNbVisibleLines() );
+    }
+    highlighting += Clock::now() - phaseStart;
+
+    renderStats_.textFetch += textFetch;
+    renderStats_.highlighting += highlighting;
+    renderStats_.drawing += Clock::now() - drawStart - textFetch - highlighting;
+}
+
+void AbstractLogView::toggleRenderStats()
+{
+    // Background work is shown as it changes
+    static constexpr int RenderStatsIntervalMs = 500;
+
+    isRenderStatsVisible_ = !isRenderStatsVisible_;
+    if ( isRenderStatsVisible_ ) {
+        renderStats_ = {};
+        renderStats_.linePagesHits = Metrics::get().counter( "lines.page_cache_hits" ).value();
+        renderStats_.linePagesMisses = Metrics::get().counter( "lines.page_cache_misses" ).value();
+        renderStatsTimer_.start( RenderStatsIntervalMs, this );
+    }
+    else {
+        renderStatsTimer_.stop();
+    }
+
+    viewport()->update();
+}
+
+void AbstractLogView::drawRenderStats( QPainter& painter ) const
+{
+    static constexpr int Padding = 4;
+
+    const auto toMs = []( RenderStats::Duration duration ) {
+        return std::chrono::duration<double, std::milli>( duration ).count();
+    };
+    const auto percent = []( uint64_t part, uint64_t total ) {
+        return total > 0 ? static_cast<double>( part ) * 100 / static_cast<double>( total ) : 0;
+    };
+
+    // Metrics could have been reset since the statistics were shown
+    const auto sinceShown = []( const QString& counter, uint64_t shown ) {
+        const auto value = Metrics::get().counter( counter ).value();
+        return value >= shown ? value - shown : value;
+    };
+    const auto linePagesHits = sinceShown( "lines.page_cache_hits", renderStats_.linePagesHits );
+    const auto linePagesMisses
+        = sinceShown( "lines.page_cache_misses", renderStats_.linePagesMisses );
+    const auto textAreaPaints = renderStats_.textAreaReused + renderStats_.textAreaScrolled
+                                + renderStats_.textAreaDrawn;
+
+    const QStringList lines = {
+        tr( "%1 frames per second" ).arg( renderStats_.framesPerSecond ),
+        tr( "Last paint %1 ms: text %2 ms, highlights %3 ms, drawing %4 ms" )
+            .arg( toMs( renderStats_.paint ), 0, 'f', 2 )
+            .arg( toMs( renderStats_.textFetch ), 0, 'f', 2 )
+            .arg( toMs( renderStats_.highlighting ), 0, 'f', 2 )
+            .arg( toMs( renderStats_.drawing ), 0, 'f', 2 ),
+        tr( "Hits: line cache %1%, highlights cache %2%" )
+            .arg( percent( linePagesHits, linePagesHits + linePagesMisses ), 0, 'f', 1 )
+            .arg( percent( renderStats_.highlightsHits,
+                           renderStats_.highlightsHits + renderStats_.highlightsMisses ),
+                  0, 'f', 1 ),
+        tr( "Text area: %1% reused, %2% scrolled, %3% drawn" )
+            .arg( percent( renderStats_.textAreaReused, textAreaPaints ), 0, 'f', 1 )
+            .arg( percent( renderStats_.textAreaScrolled, textAreaPaints ), 0, 'f', 1 )
+            .arg( percent( renderStats_.textAreaDrawn, textAreaPaints ), 0, 'f', 1 ),
+        tr( "Background: %1, %2 busy threads" )
+            .arg( highlightsWatcher_.isRunning() ? tr( "matching highlights" ) : tr( "idle" ) )
+            .arg( QThreadPool::globalInstance()->activeThreadCount() ),
+    };
+
+    painter.save();
+    painter.setFont( font() );
+    const auto metrics = painter.fontMetrics();
+
+    auto width = 0;
+    for ( const auto& line : lines ) {
+        width = std::max( width, textWidth( metrics, line ) );
+    }
+
+    const QRect box( viewport()->width() - width - 3 * Padding, Padding, width + 2 * Padding,
+                     metrics.height() * klogg::isize( lines ) + 2 * Padding );
+    painter.fillRect( box, QColor( 0, 0, 0, 192 ) );
+    painter.setPen( Qt::white );
+
+    auto baseline = box.top() + Padding + metrics.ascent();
+    for ( const auto& line : lines ) {
+        painter.drawText( box.left() + Padding, baseline, line );
+        baseline += metrics.height();
+    }
+    painter.restore();
+}
+
+void AbstractLogView::requestHighlights( klogg::vector<LineNumber> lines, LinesCount nbLines )
+{
+    if ( highlightsWatcher_.isRunning() ) {
+        // View is drawn again with new highlights and requests the rest
+        return;
+    }
+
+    // Lines around the view are matched too, so they are ready when scrolled to
+    const auto linesInFile = logData_->getNbLine();
+    const auto prefetchBegin = firstLine_.get() > nbLines.get() ? firstLine_ - nbLines : 0_lnum;
+    const auto prefetchEnd = std::min( linesInFile.get(), firstLine_.get() + 2 * nbLines.get() );
+    for ( auto line = prefetchBegin; line.get() < prefetchEnd; ++line ) {
+        if ( !highlightsCache_.contains( line.get() ) ) {
+            lines.push_back( line );
+        }
+    }
+    std::sort( lines.begin(), lines.end() );
+    lines.erase( std::unique( lines.begin(), lines.end() ), lines.end() );
+    if ( lines.empty() ) {
+        return;
+    }
+
+    // Types of the lines are found at once, the search pattern is matched only in matches
+    const auto firstLine = lines.front();
+    const auto nbRangeLines = LinesCount( lines.back().get() - firstLine.get() + 1 );
+    const auto types = highlightsKey_.patternHighlight
+                           ? lineTypes( firstLine, nbRangeLines )
+                           : klogg::vector<AbstractLogData::LineType>{};
+
+    // Lines are read here, the data can change while the job runs, e.g. when
+    // a search adds matches to the filtered data. They are read at once,
+    // the lines are around the view and are mostly in the line cache already.
+    auto rangeLines = logData_->getLines( firstLine, nbRangeLines );
+    auto rangeExpandedLines = logData_->getExpandedLines( firstLine, nbRangeLines );
+
+    struct MatchedLine {
+        LineNumber line;
+        QString logLine;
+        QString expandedLine;
+        bool isSearchMatch = false;
+    };
+    klogg::vector<MatchedLine> matchedLines;
+    matchedLines.reserve( lines.size() );
+    for ( const auto line : lines ) {
+        const auto index = static_cast<size_t>( line.get() - firstLine.get() );
+        if ( index >= rangeLines.size() || index >= rangeExpandedLines.size() ) {
+            break;
+        }
+
+        const auto isSearchMatch
+            = index < types.size() && isSearchHighlighted( types[ index ] );
+        matchedLines.push_back( { line, std::move( rangeLines[ index ] ),
+                                  std::move( rangeExpandedLines[ index ] ), isSearchMatch } );
+    }
+
+    // Job has its own matcher, the view matches lines it draws at the same time
+    auto key = highlightsKey_;
+    key.highlighterSet = key.highlighterSet.withOwnMatcher();
+
+    highlightsWatcher_.setFuture( QtConcurrent::run(
+        [ key = std::move( key ), generation = highlightsGeneration_,
+          quickFindMatcher = quickFindPattern_->getMatcher(),
+          lines = std::move( matchedLines ) ]() {
+            HighlightsResult result;
+            result.generation = generation;
+            result.lines.reserve( lines.size() );
+            for ( const auto& matchedLine : lines ) {
+                result.lines.emplace_back(
+                    matchedLine.line,
+                    matchHighlights( key, quickFindMatcher, matchedLine.logLine,
+                                     matchedLine.expandedLine, matchedLine.isSearchMatch ) );
+            }
+            return result;
+        } ) );
+}
+
+void AbstractLogView::handleHighlightsReady()
+{
+    auto result = highlightsWatcher_.result();
+    if ( result.generation != highlightsGeneration_ ) {
+        forceRefresh();
+        return;
+    }
+
+    for ( auto& [ line, lineHighlights ] : result.lines ) {
+        const auto cost = 1 + lineHighlights.line.size() / HighlightsCacheLineLength;
+        highlightsInsertedCost_ += static_cast<uint64_t>( cost );
+        highlightsInsertedBytes_
+            += sizeof( LineHighlights )
+               + static_cast<uint64_t>( lineHighlights.line.capacity() ) * sizeof( QChar )
+               + ( lineHighlights.matches.capacity() + lineHighlights.quickFindMatches.capacity() )
+                     * sizeof( HighlightedMatch );
+        highlightsCache_.insert( line.get(), new LineHighlights( std::move( lineHighlights ) ),
+                                 cost );
+    }
+
+    forceRefresh();
+}
+
+void AbstractLogView::setMemoryGroup( const void* group )
+{
+    auto& memoryGovernor = MemoryGovernor::get();
+    memoryGovernor.removeCaches( this );
+    memoryGovernor.addUsage( this, group, MemoryGovernor::Kind::ViewCache,
+                             [ this ] { return cachesSize(); } );
+}
+
+uint64_t AbstractLogView::cachesSize() const
+{
+    const auto pixmapSize = []( const QPixmap& pixmap ) {
+        return static_cast<uint64_t>( pixmap.width() ) * static_cast<uint64_t>( pixmap.height() )
+               * static_cast<uint64_t>( pixmap.depth() ) / 8;
+    };
+
+    // Evicted highlights are not known, the cost of the cache is scaled
+    // by the bytes of the highlights inserted for the cost
+    const auto highlightsSize
+        = highlightsInsertedCost_ == 0
+              ? 0
+              : static_cast<uint64_t>( highlightsCache_.totalCost() ) * highlightsInsertedBytes_
+                    / highlightsInsertedCost_;
+
+    // Glyph layouts are not accounted, only the text
+    const auto staticTextsSize
+        = static_cast<uint64_t>( staticTextCache_.totalCost() ) * sizeof( QChar )
+          + static_cast<uint64_t>( staticTextCache_.size() ) * sizeof( QStaticText );
+
+    return pixmapSize( textAreaCache_.pixmap_ ) + pixmapSize( pullToFollowCache_.pixmap_ )
+           + highlightsSize + staticTextsSize;
 }
 
 // Draw the "pull to follow" bar and return a pixmap.
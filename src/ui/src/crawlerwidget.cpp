@@ -48,18 +48,30 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <utility>
 
 #include <QAction>
 #include <QApplication>
 #include <QCompleter>
+#include <QDateTime>
+#include <QDialog>
+#include <QFileDialog>
 #include <QInputDialog>
 #include <QJsonDocument>
 #include <QKeySequence>
 #include <QLineEdit>
 #include <QListView>
+#include <QMessageBox>
+#include <QPlainTextEdit>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QSaveFile>
 #include <QShortcut>
+#include <QSpinBox>
 #include <QStandardItemModel>
 #include <QStringListModel>
+#include <QTreeWidget>
+#include <QtConcurrent>
 #include <qglobal.h>
 #include <qobject.h>
 #include <string>
@@ -72,15 +84,45 @@
 #include "dispatch_to.h"
 #include "fontutils.h"
 #include "infoline.h"
+#include "linesexport.h"
 #include "quickfindpattern.h"
 #include "savedsearches.h"
 #include "shortcuts.h"
-
-static constexpr char AnsiColorSequenceRegex[] = "\\x1B\\[([0-9]{1,2}(;[0-9]{1,2})?)?[mK]";
+#include "timehistogramwidget.h"
 
 // Palette for error signaling (yellow background)
 const QPalette CrawlerWidget::ErrorPalette( Qt::darkYellow );
 
+namespace {
+// Views and searches follow loading lines at this pace,
+// updating them for every polled progress would slow down loading
+constexpr qint64 LiveUpdateIntervalMs = 500;
+
+// Lines shown around an offset that is not indexed yet
+constexpr LinesCount LinesAroundOffset = 200_lcount;
+
+// Byte offset in the file as "@1024" or "@0x400", or percentage of its size as "80%"
+std::optional<qint64> parseFileOffset( const QString& input, qint64 fileSize )
+{
+    const auto text = input.trimmed();
+    bool isOk = false;
+    if ( text.startsWith( '@' ) ) {
+        const auto offset = text.mid( 1 ).toLongLong( &isOk, 0 );
+        return isOk && offset >= 0 ? std::make_optional( offset ) : std::nullopt;
+    }
+
+    if ( text.endsWith( '%' ) ) {
+        const auto percent = text.chopped( 1 ).toDouble( &isOk );
+        if ( !isOk || percent < 0 || percent > 100 ) {
+            return std::nullopt;
+        }
+        return static_cast<qint64>( static_cast<double>( fileSize ) * percent / 100 );
+    }
+
+    return std::nullopt;
+}
+} // namespace
+
 // Implementation of the view context for the CrawlerWidget
 class CrawlerWidgetContext : public ViewContextInterface {
   public:
@@ -166,6 +208,23 @@ CrawlerWidget::CrawlerWidget( QWidget* parent )
 {
 }
 
+CrawlerWidget::~CrawlerWidget()
+{
+    // Counting holds the data until it stops
+    filterStatisticsInterrupt_->set();
+    logTemplatesInterrupt_->set();
+    fieldFacetsInterrupt_->set();
+    numberStatisticsInterrupt_->set();
+    lineOrderInterrupt_->set();
+    linesComparisonInterrupt_->set();
+    searchRegionsInterrupt_->set();
+    linesExportInterrupt_->set();
+
+    if ( speculativeData_ ) {
+        speculativeData_->interruptSearch();
+    }
+}
+
 // The top line is first one on the main display
 LineNumber CrawlerWidget::getTopLine() const
 {
@@ -258,19 +317,28 @@ void CrawlerWidget::changeEvent( QEvent* event )
 
 void CrawlerWidget::stopLoading()
 {
-    logFilteredData_->interruptSearch();
+    stopSearch();
     logData_->interruptLoading();
 }
 
+void CrawlerWidget::stopSearch()
+{
+    logFilteredData_->interruptSearch();
+}
+
 void CrawlerWidget::reload()
 {
     searchState_.resetState();
+    isSearchFollowingLoading_ = false;
     constexpr auto DropCache = true;
     logFilteredData_->clearSearch( DropCache );
     logFilteredData_->clearMarks();
     filteredView_->updateData();
     printSearchInfoMessage();
 
+    logMainView_->truncateQuickFindIndex( 0_lnum );
+    resetPredefinedFiltersMatchCounts();
+    cancelSpeculativeSearches();
     logData_->reload();
 
     // A reload is considered as a first load,
@@ -293,9 +361,47 @@ void CrawlerWidget::focusSearchEdit()
 
 void CrawlerWidget::goToLine()
 {
+    const auto& config = Configuration::get();
+    const auto timestampFormat = config.timestampFormat();
+
+    bool isOk = false;
+    const auto input = QInputDialog::getText(
+        this, "Jump to line",
+        timestampFormat.isEmpty()
+            ? QString( "Line number, percentage (50%) or byte offset (@1024)" )
+            : QString( "Line number, percentage (50%), byte offset (@1024),\n"
+                       "time or time range (%1..%1)" )
+                  .arg( timestampFormat ),
+        QLineEdit::Normal, {}, &isOk );
+
+    if ( !isOk ) {
+        return;
+    }
+
+    // Offsets don't need the file to be indexed up to them
+    if ( const auto offset = parseFileOffset( input, logData_->getFileSizeOnDisk() ) ) {
+        jumpToOffset( *offset );
+        return;
+    }
+
     bool isLineSelected = true;
-    auto newLine = QInputDialog::getText( this, "Jump to line", "Line number" )
-                       .toULongLong( &isLineSelected );
+    auto newLine = input.toULongLong( &isLineSelected );
+
+    if ( !isLineSelected && !timestampFormat.isEmpty() ) {
+        // Times are looked up in the file, a time range also limits searches
+        const auto times = input.split( ".." );
+        const auto fromTime = QDateTime::fromString( times.front().trimmed(), timestampFormat );
+        const auto toTime = QDateTime::fromString( times.back().trimmed(), timestampFormat );
+        if ( times.size() <= 2 && fromTime.isValid() && toTime.isValid() ) {
+            const auto fromLine = logData_->getLineAtTime( fromTime );
+            if ( times.size() == 2 ) {
+                setSearchLimits( fromLine, logData_->getLineAtTime( toTime.addMSecs( 1 ) ) );
+            }
+
+            isLineSelected = fromLine.get() < logData_->getNbLine().get();
+            newLine = fromLine.get() + 1;
+        }
+    }
 
     if ( isLineSelected ) {
         if ( newLine == 0 ) {
@@ -309,6 +415,857 @@ void CrawlerWidget::goToLine()
     }
 }
 
+void CrawlerWidget::jumpToOffset( qint64 offset )
+{
+    LOG_INFO << "jump to offset " << offset;
+
+    if ( const auto line = logData_->getLineAtOffset( offset ) ) {
+        pendingJumpOffset_.reset();
+        filteredView_->trySelectLine( logFilteredData_->getLineIndexNumber( *line ) );
+        logMainView_->trySelectLine( *line );
+        return;
+    }
+
+    pendingJumpOffset_ = offset;
+    showLinesAtOffset( offset );
+}
+
+void CrawlerWidget::showLinesAtOffset( qint64 offset )
+{
+    const auto linesAtOffset = logData_->getLinesAtOffset( offset, LinesAroundOffset );
+
+    QStringList text;
+    for ( auto index = 0u; index < linesAtOffset.lines.size(); ++index ) {
+        const auto lineNumber = linesAtOffset.estimatedFirstLine.get() + index + 1;
+        text.append( QString( "%1~%2: %3" )
+                         .arg( index == linesAtOffset.offsetLine ? ">" : " " )
+                         .arg( lineNumber )
+                         .arg( linesAtOffset.lines[ index ] ) );
+    }
+
+    if ( !linesAtOffsetDialog_ ) {
+        linesAtOffsetDialog_ = new QDialog( this );
+        linesAtOffsetDialog_->setAttribute( Qt::WA_DeleteOnClose );
+        linesAtOffsetDialog_->resize( logMainView_->size() );
+
+        auto* textView = new QPlainTextEdit( linesAtOffsetDialog_ );
+        textView->setReadOnly( true );
+        textView->setLineWrapMode( QPlainTextEdit::NoWrap );
+        textView->setFont( logMainView_->font() );
+
+        auto* layout = new QVBoxLayout( linesAtOffsetDialog_ );
+        layout->addWidget( textView );
+
+        connect( linesAtOffsetDialog_, &QDialog::finished, this,
+                 [ this ] { pendingJumpOffset_.reset(); } );
+    }
+
+    linesAtOffsetDialog_->setWindowTitle(
+        tr( "Around byte %1 (line numbers are approximate until the file is indexed)" )
+            .arg( offset ) );
+    linesAtOffsetDialog_->findChild<QPlainTextEdit*>()->setPlainText( text.join( '\n' ) );
+    linesAtOffsetDialog_->show();
+    linesAtOffsetDialog_->raise();
+}
+
+void CrawlerWidget::showLogTemplates()
+{
+    if ( !logTemplatesDialog_ ) {
+        logTemplatesDialog_ = new QDialog( this );
+        logTemplatesDialog_->setAttribute( Qt::WA_DeleteOnClose );
+        logTemplatesDialog_->resize( logMainView_->size() );
+
+        auto* templatesView = new QTreeWidget( logTemplatesDialog_ );
+        templatesView->setRootIsDecorated( false );
+        templatesView->setUniformRowHeights( true );
+        templatesView->setHeaderLabels( { tr( "Lines" ), tr( "Template" ) } );
+        templatesView->setFont( logMainView_->font() );
+
+        auto* layout = new QVBoxLayout( logTemplatesDialog_ );
+        layout->addWidget( templatesView );
+    }
+
+    logTemplatesDialog_->show();
+    logTemplatesDialog_->raise();
+
+    // Templates being mined are shown when they are found
+    logTemplatesDialog_->setWindowTitle( tr( "Finding message templates..." ) );
+    if ( logTemplatesWatcher_.isRunning() ) {
+        return;
+    }
+
+    logTemplatesDialog_->findChild<QTreeWidget*>()->clear();
+
+    logTemplatesWatcher_.setFuture( QtConcurrent::run(
+        [ logData = logData_, interrupt = logTemplatesInterrupt_ ]() {
+            return LogTemplates::mine( *logData, *interrupt );
+        } ) );
+}
+
+void CrawlerWidget::showMinedLogTemplates()
+{
+    if ( !logTemplatesDialog_ ) {
+        return;
+    }
+
+    // Lines of the templates are kept while they are listed
+    const auto logTemplates = std::make_shared<const LogTemplates>( logTemplatesWatcher_.result() );
+
+    auto title = tr( "%1 message templates in %2 lines" )
+                     .arg( logTemplates->templates.size() )
+                     .arg( logTemplates->minedLines.get() );
+    if ( logTemplates->unclusteredLines > 0_lcount ) {
+        title += tr( ", %1 lines not grouped" ).arg( logTemplates->unclusteredLines.get() );
+    }
+    logTemplatesDialog_->setWindowTitle( title );
+
+    auto* templatesView = logTemplatesDialog_->findChild<QTreeWidget*>();
+    templatesView->clear();
+
+    QList<QTreeWidgetItem*> items;
+    for ( auto index = 0u; index < logTemplates->templates.size(); ++index ) {
+        const auto& logTemplate = logTemplates->templates[ index ];
+        auto* item = new QTreeWidgetItem(
+            { QString::number( logTemplate.lines.cardinality() ), logTemplate.text } );
+        item->setData( 0, Qt::UserRole, index );
+        items.append( item );
+    }
+    templatesView->addTopLevelItems( items );
+    templatesView->resizeColumnToContents( 0 );
+
+    disconnect( templatesView, &QTreeWidget::itemActivated, this, nullptr );
+    connect( templatesView, &QTreeWidget::itemActivated, this,
+             [ this, logTemplates ]( QTreeWidgetItem* item ) {
+                 const auto index = item->data( 0, Qt::UserRole ).toUInt();
+                 const auto& logTemplate = logTemplates->templates[ index ];
+                 showLinesInNewTab( "Template \"" + logTemplate.text + "\"",
+                                    logTemplate.lines );
+             } );
+}
+
+void CrawlerWidget::showFieldFacets()
+{
+    if ( fieldFacetsWatcher_.isRunning() ) {
+        if ( fieldFacetsDialog_ ) {
+            fieldFacetsDialog_->show();
+            fieldFacetsDialog_->raise();
+        }
+        return;
+    }
+
+    if ( !askFacetField( tr( "Field values" ) ) ) {
+        return;
+    }
+
+    if ( !fieldFacetsDialog_ ) {
+        fieldFacetsDialog_ = new QDialog( this );
+        fieldFacetsDialog_->setAttribute( Qt::WA_DeleteOnClose );
+        fieldFacetsDialog_->resize( logMainView_->size() );
+
+        auto* valuesView = new QTreeWidget( fieldFacetsDialog_ );
+        valuesView->setRootIsDecorated( false );
+        valuesView->setUniformRowHeights( true );
+        valuesView->setHeaderLabels( { tr( "Lines" ), tr( "Value" ) } );
+        valuesView->setFont( logMainView_->font() );
+
+        auto* layout = new QVBoxLayout( fieldFacetsDialog_ );
+        layout->addWidget( valuesView );
+    }
+
+    fieldFacetsDialog_->show();
+    fieldFacetsDialog_->raise();
+    fieldFacetsDialog_->setWindowTitle(
+        tr( "Counting values of %1..." ).arg( facetField_->text() ) );
+    fieldFacetsDialog_->findChild<QTreeWidget*>()->clear();
+
+    fieldFacetsWatcher_.setFuture( QtConcurrent::run(
+        [ logData = logData_, field = *facetField_, lines = filteredOrAllLines(),
+          interrupt = fieldFacetsInterrupt_ ]() {
+            return FieldFacets::count( *logData, field, *lines, *interrupt );
+        } ) );
+}
+
+bool CrawlerWidget::askFacetField( const QString& title )
+{
+    bool isOk = false;
+    const auto input = QInputDialog::getText(
+        this, title,
+        tr( "Field name, column ($1, $2...) or regular expression with a capture group" ),
+        QLineEdit::Normal, facetField_ ? facetField_->text() : QString{}, &isOk );
+    if ( !isOk || input.trimmed().isEmpty() ) {
+        return false;
+    }
+
+    auto field = FacetField::parse( input );
+    if ( !field ) {
+        QMessageBox::warning( this, title, tr( "Invalid regular expression: %1" ).arg( input ) );
+        return false;
+    }
+
+    facetField_ = std::move( field );
+    return true;
+}
+
+std::shared_ptr<const SearchResultArray> CrawlerWidget::filteredOrAllLines() const
+{
+    auto lines = logFilteredData_->getMatchingLines();
+    if ( !lines->isEmpty() ) {
+        return lines;
+    }
+
+    auto allLines = std::make_shared<SearchResultArray>();
+    allLines->addRange( 0, logData_->getNbLine().get() );
+    return allLines;
+}
+
+void CrawlerWidget::showNumberStatistics()
+{
+    computeNumberStatistics( filteredOrAllLines() );
+}
+
+void CrawlerWidget::showSelectionStatistics( const klogg::vector<LineNumber>& lines )
+{
+    auto selectedLines = std::make_shared<SearchResultArray>();
+    for ( const auto line : lines ) {
+        selectedLines->add( line.get() );
+    }
+    selectedLines->runOptimize();
+
+    computeNumberStatistics( std::move( selectedLines ) );
+}
+
+void CrawlerWidget::computeNumberStatistics( std::shared_ptr<const SearchResultArray> lines )
+{
+    if ( numberStatisticsWatcher_.isRunning() ) {
+        if ( numberStatisticsDialog_ ) {
+            numberStatisticsDialog_->show();
+            numberStatisticsDialog_->raise();
+        }
+        return;
+    }
+
+    if ( !askFacetField( tr( "Number statistics" ) ) ) {
+        return;
+    }
+
+    if ( !numberStatisticsDialog_ ) {
+        numberStatisticsDialog_ = new QDialog( this );
+        numberStatisticsDialog_->setAttribute( Qt::WA_DeleteOnClose );
+
+        auto* statisticsView = new QTreeWidget( numberStatisticsDialog_ );
+        statisticsView->setRootIsDecorated( false );
+        statisticsView->setUniformRowHeights( true );
+        statisticsView->setHeaderLabels( { tr( "Statistic" ), tr( "Value" ) } );
+
+        auto* layout = new QVBoxLayout( numberStatisticsDialog_ );
+        layout->addWidget( statisticsView );
+    }
+
+    numberStatisticsDialog_->show();
+    numberStatisticsDialog_->raise();
+    numberStatisticsDialog_->setWindowTitle(
+        tr( "Reading numbers of %1..." ).arg( facetField_->text() ) );
+    numberStatisticsDialog_->findChild<QTreeWidget*>()->clear();
+
+    numberStatisticsWatcher_.setFuture( QtConcurrent::run(
+        [ logData = logData_, field = *facetField_, lines = std::move( lines ),
+          interrupt = numberStatisticsInterrupt_ ]() {
+            return FieldStatistics::compute( *logData, field, *lines, *interrupt );
+        } ) );
+}
+
+void CrawlerWidget::showComputedNumberStatistics()
+{
+    if ( !numberStatisticsDialog_ || !facetField_ ) {
+        return;
+    }
+
+    const auto statistics = numberStatisticsWatcher_.result();
+    const auto& numbers = statistics.numbers;
+
+    numberStatisticsDialog_->setWindowTitle( tr( "Numbers of %1 in %2 lines" )
+                                                 .arg( facetField_->text() )
+                                                 .arg( statistics.countedLines.get() ) );
+
+    const auto number = []( double value ) { return QString::number( value, 'g', 10 ); };
+    klogg::vector<std::pair<QString, QString>> rows = {
+        { tr( "Count" ), QString::number( numbers.count() ) },
+        { tr( "Min" ), number( numbers.min() ) },
+        { tr( "Max" ), number( numbers.max() ) },
+        { tr( "Mean" ), number( numbers.mean() ) },
+        { tr( "Sum" ), number( numbers.sum() ) },
+    };
+    for ( const auto percentile : { 50, 90, 95, 99 } ) {
+        rows.emplace_back( tr( "%1th percentile" ).arg( percentile ),
+                           number( numbers.percentile( percentile / 100.0 ) ) );
+    }
+    rows.emplace_back( tr( "99.9th percentile" ), number( numbers.percentile( 0.999 ) ) );
+
+    auto* statisticsView = numberStatisticsDialog_->findChild<QTreeWidget*>();
+    statisticsView->clear();
+
+    QList<QTreeWidgetItem*> items;
+    for ( const auto& [ name, value ] : rows ) {
+        auto* item = new QTreeWidgetItem( { name, value } );
+        item->setTextAlignment( 1, Qt::AlignRight );
+        items.append( item );
+    }
+    statisticsView->addTopLevelItems( items );
+    statisticsView->resizeColumnToContents( 0 );
+}
+
+void CrawlerWidget::showCountedFieldFacets()
+{
+    if ( !fieldFacetsDialog_ || !facetField_ ) {
+        return;
+    }
+
+    const auto facets = fieldFacetsWatcher_.result();
+
+    auto title = tr( "%1 values of %2 in %3 of %4 lines" )
+                     .arg( facets.values.size() )
+                     .arg( facetField_->text() )
+                     .arg( facets.linesWithField.get() )
+                     .arg( facets.countedLines.get() );
+    if ( facets.isApproximate ) {
+        title += tr( ", counts are approximate" );
+    }
+    fieldFacetsDialog_->setWindowTitle( title );
+
+    auto* valuesView = fieldFacetsDialog_->findChild<QTreeWidget*>();
+    valuesView->clear();
+
+    QList<QTreeWidgetItem*> items;
+    for ( const auto& value : facets.values ) {
+        // Counts that can be too high are marked
+        const auto count = value.error > 0 ? QString( "~%1" ).arg( value.count )
+                                           : QString::number( value.count );
+        auto* item = new QTreeWidgetItem( { count, value.value } );
+        item->setTextAlignment( 0, Qt::AlignRight );
+        items.append( item );
+    }
+    valuesView->addTopLevelItems( items );
+    valuesView->resizeColumnToContents( 0 );
+
+    // Lines with the value are searched for
+    disconnect( valuesView, &QTreeWidget::itemActivated, this, nullptr );
+    connect( valuesView, &QTreeWidget::itemActivated, this,
+             [ this, field = *facetField_ ]( QTreeWidgetItem* item ) {
+                 const auto value = item->text( 1 );
+                 const auto pattern = field.searchPattern( value );
+                 if ( pattern.isEmpty() ) {
+                     replaceSearch( value );
+                     return;
+                 }
+
+                 useRegexpButton_->setChecked( true );
+                 booleanButton_->setChecked( false );
+                 setSearchPattern( pattern );
+             } );
+}
+
+void CrawlerWidget::sortLines()
+{
+    // Sorting takes a part of the memory budget, sorted runs of lines are written to disk past it
+    constexpr uint64_t DefaultSortMemory = 512 * 1024 * 1024;
+
+    if ( lineOrderWatcher_.isRunning() ) {
+        if ( lineOrderProgress_ ) {
+            lineOrderProgress_->raise();
+        }
+        return;
+    }
+
+    const auto title = tr( "Sort lines" );
+    bool isOk = false;
+    const auto input = QInputDialog::getText(
+        this, title,
+        tr( "Field name, column ($1, $2...) or regular expression with a capture group "
+            "of the numbers to sort by, empty to sort by timestamps" ),
+        QLineEdit::Normal, facetField_ ? facetField_->text() : QString{}, &isOk );
+    if ( !isOk ) {
+        return;
+    }
+
+    SortKey key;
+    if ( input.trimmed().isEmpty() ) {
+        key = { SortKey::Kind::Timestamp, Configuration::get().timestampFormat() };
+        if ( key.text.isEmpty() ) {
+            QMessageBox::warning( this, title, tr( "Timestamp format is not set" ) );
+            return;
+        }
+    }
+    else {
+        auto field = FacetField::parse( input );
+        if ( !field ) {
+            QMessageBox::warning( this, title,
+                                  tr( "Invalid regular expression: %1" ).arg( input ) );
+            return;
+        }
+        facetField_ = std::move( field );
+        key = { SortKey::Kind::Field, input };
+    }
+
+    const auto ascending = tr( "Ascending" );
+    const auto order = QInputDialog::getItem( this, title, tr( "Order" ),
+                                              { ascending, tr( "Descending" ) }, 0, false, &isOk );
+    if ( !isOk ) {
+        return;
+    }
+    const auto isDescending = order != ascending;
+
+    const auto keyText = key.kind == SortKey::Kind::Field ? key.text : tr( "timestamp" );
+    sortedLinesText_ = isDescending ? tr( "Sorted by %1, descending" ).arg( keyText )
+                                    : tr( "Sorted by %1" ).arg( keyText );
+    sortedLines_ = filteredOrAllLines();
+
+    lineOrderInterrupt_->clear();
+    lineOrderProgress_ = new QProgressDialog(
+        tr( "Sorting %1 lines by %2..." ).arg( sortedLines_->cardinality() ).arg( keyText ),
+        tr( "Cancel" ), 0, 0, this );
+    lineOrderProgress_->setAttribute( Qt::WA_DeleteOnClose );
+    lineOrderProgress_->setWindowTitle( title );
+    connect( lineOrderProgress_, &QProgressDialog::canceled, this,
+             [ interrupt = lineOrderInterrupt_ ] { interrupt->set(); } );
+    lineOrderProgress_->show();
+
+    const auto memoryBudgetMb = static_cast<uint64_t>( Configuration::get().memoryBudgetMb() );
+    const auto memoryBytes
+        = memoryBudgetMb > 0 ? memoryBudgetMb * 1024 * 1024 / 4 : DefaultSortMemory;
+
+    lineOrderWatcher_.setFuture( QtConcurrent::run(
+        [ logData = logData_, key, lines = sortedLines_, isDescending, memoryBytes,
+          interrupt = lineOrderInterrupt_ ]() {
+            return LineOrder::sort( *logData, key, *lines, isDescending, memoryBytes,
+                                    *interrupt );
+        } ) );
+}
+
+void CrawlerWidget::showSortedLines()
+{
+    const auto isInterrupted = static_cast<bool>( *lineOrderInterrupt_ );
+    if ( lineOrderProgress_ ) {
+        // Progress dialog is closed without canceling the next sort
+        lineOrderProgress_->disconnect( this );
+        lineOrderProgress_->close();
+    }
+
+    auto order = lineOrderWatcher_.result();
+    auto lines = std::move( sortedLines_ );
+    if ( !order || !lines ) {
+        if ( !isInterrupted ) {
+            QMessageBox::warning( this, tr( "Sort lines" ), tr( "Lines could not be sorted" ) );
+        }
+        return;
+    }
+
+    showLinesInNewTab( sortedLinesText_, *lines,
+                       std::make_shared<const LineOrder>( std::move( *order ) ) );
+}
+
+void CrawlerWidget::compareLines( CrawlerWidget* other, bool maskNumbers )
+{
+    if ( linesComparisonWatcher_.isRunning() ) {
+        if ( linesComparisonProgress_ ) {
+            linesComparisonProgress_->raise();
+        }
+        return;
+    }
+
+    const auto title = tr( "Compare with file" );
+    comparedCrawler_ = other;
+
+    linesComparisonInterrupt_->clear();
+    linesComparisonProgress_
+        = new QProgressDialog( tr( "Comparing %1 lines with %2 lines..." )
+                                   .arg( logData_->getNbLine().get() )
+                                   .arg( other->logData_->getNbLine().get() ),
+                               tr( "Cancel" ), 0, 0, this );
+    linesComparisonProgress_->setAttribute( Qt::WA_DeleteOnClose );
+    linesComparisonProgress_->setWindowTitle( title );
+    connect( linesComparisonProgress_, &QProgressDialog::canceled, this,
+             [ interrupt = linesComparisonInterrupt_ ] { interrupt->set(); } );
+    linesComparisonProgress_->show();
+
+    linesComparisonWatcher_.setFuture( QtConcurrent::run(
+        [ first = logData_, second = other->logData_, maskNumbers,
+          interrupt = linesComparisonInterrupt_ ]() {
+            return LinesComparison::compare( *first, *second, maskNumbers, *interrupt );
+        } ) );
+}
+
+void CrawlerWidget::showComparedLines()
+{
+    const auto isInterrupted = static_cast<bool>( *linesComparisonInterrupt_ );
+    if ( linesComparisonProgress_ ) {
+        // Progress dialog is closed without canceling the next comparison
+        linesComparisonProgress_->disconnect( this );
+        linesComparisonProgress_->close();
+    }
+
+    auto comparison = linesComparisonWatcher_.result();
+    if ( !comparison ) {
+        if ( !isInterrupted ) {
+            QMessageBox::warning( this, tr( "Compare with file" ),
+                                  tr( "Lines could not be compared" ) );
+        }
+        return;
+    }
+
+    showLinesInNewTab( tr( "Only in this file" ), std::move( comparison->onlyInFirst ) );
+    // The other file may have been closed meanwhile
+    if ( comparedCrawler_ ) {
+        comparedCrawler_->showLinesInNewTab( tr( "Only in this file" ),
+                                             std::move( comparison->onlyInSecond ) );
+    }
+}
+
+QString CrawlerWidget::searchText() const
+{
+    return searchLineEdit_->currentText();
+}
+
+LogFilteredData* CrawlerWidget::searchInNewTab( const QString& searchText,
+                                                const RegularExpressionPattern& pattern )
+{
+    LOG_INFO << "searching " << searchText << " in new tab";
+    cancelSpeculativeSearches();
+
+    addFilteredViewTab();
+    tabbedFilteredView_->setTabText( tabbedFilteredView_->currentIndex(),
+                                     "Find \"" + searchText + "\"" );
+    searchLineEdit_->setEditText( searchText );
+
+    clearCurrentSearch();
+    runCurrentSearch( pattern, false );
+    return logFilteredData_.get();
+}
+
+void CrawlerWidget::showFilteredData( const LogFilteredData* filteredData )
+{
+    const auto view = std::find_if( filteredViewsData_.begin(), filteredViewsData_.end(),
+                                    [ filteredData ]( const auto& viewData ) {
+                                        return viewData.second.get() == filteredData;
+                                    } );
+    if ( view != filteredViewsData_.end() ) {
+        tabbedFilteredView_->setCurrentWidget( view->first );
+        view->first->setFocus();
+    }
+}
+
+void CrawlerWidget::searchBetweenMarkers()
+{
+    if ( searchRegionsWatcher_.isRunning() ) {
+        return;
+    }
+
+    const auto title = tr( "Search between markers" );
+    bool isOk = false;
+    const auto begin = QInputDialog::getText(
+        this, title,
+        tr( "Regular expression of the lines starting regions, empty to search all lines" ),
+        QLineEdit::Normal, searchRegionsBegin_, &isOk );
+    if ( !isOk ) {
+        return;
+    }
+
+    if ( begin.isEmpty() ) {
+        if ( logFilteredData_->searchedLines() ) {
+            logFilteredData_->setSearchedLines( {} );
+            startNewSearch();
+        }
+        return;
+    }
+
+    const auto end = QInputDialog::getText( this, title,
+                                            tr( "Regular expression of the lines ending regions" ),
+                                            QLineEdit::Normal, searchRegionsEnd_, &isOk );
+    if ( !isOk || end.isEmpty() ) {
+        return;
+    }
+
+    for ( const auto& pattern : { begin, end } ) {
+        if ( !QRegularExpression( pattern ).isValid() ) {
+            QMessageBox::warning( this, title,
+                                  tr( "Invalid regular expression: %1" ).arg( pattern ) );
+            return;
+        }
+    }
+
+    searchRegionsBegin_ = begin;
+    searchRegionsEnd_ = end;
+    searchRegionsLevel_.clear();
+    findSearchRegions();
+}
+
+void CrawlerWidget::filterByLevel()
+{
+    if ( searchRegionsWatcher_.isRunning() ) {
+        return;
+    }
+
+    // Levels are in the order of LogLevel
+    const QStringList levels
+        = { tr( "Errors" ), tr( "Warnings and errors" ), tr( "Info and more severe" ),
+            tr( "Debug and more severe" ), tr( "Trace and more severe" ), tr( "All lines" ) };
+    bool isOk = false;
+    const auto levelName = QInputDialog::getItem( this, tr( "Filter by level" ),
+                                                  tr( "Lines of level" ), levels, 0, false, &isOk );
+    if ( !isOk ) {
+        return;
+    }
+
+    const auto levelIndex = levels.indexOf( levelName );
+    if ( levelIndex == levels.size() - 1 ) {
+        if ( logFilteredData_->searchedLines() ) {
+            logFilteredData_->setSearchedLines( {} );
+            startNewSearch();
+        }
+        return;
+    }
+
+    searchRegionsLevel_ = levelName;
+    searchRegionsLogLevel_ = static_cast<LogLevel>( levelIndex );
+    findSearchRegions();
+}
+
+void CrawlerWidget::findSearchRegions()
+{
+    searchRegionsData_ = logFilteredData_;
+    searchRegionsNbLines_ = logData_->getNbLine();
+
+    if ( searchRegionsLevel_.isEmpty() ) {
+        searchRegionsWatcher_.setFuture( QtConcurrent::run(
+            [ logData = logData_, beginExpression = QRegularExpression( searchRegionsBegin_ ),
+              endExpression = QRegularExpression( searchRegionsEnd_ ),
+              interrupt = searchRegionsInterrupt_ ]() -> std::shared_ptr<const SearchResultArray> {
+                auto lines
+                    = linesBetweenMarkers( *logData, beginExpression, endExpression, *interrupt );
+                if ( !lines ) {
+                    return {};
+                }
+                return std::make_shared<const SearchResultArray>( std::move( *lines ) );
+            } ) );
+    }
+    else {
+        searchRegionsWatcher_.setFuture( QtConcurrent::run(
+            [ logData = logData_, level = searchRegionsLogLevel_,
+              interrupt = searchRegionsInterrupt_ ]() -> std::shared_ptr<const SearchResultArray> {
+                auto lines = linesOfLevel( *logData, level, *interrupt );
+                if ( !lines ) {
+                    return {};
+                }
+                return std::make_shared<const SearchResultArray>( std::move( *lines ) );
+            } ) );
+    }
+}
+
+void CrawlerWidget::searchFoundRegions()
+{
+    const auto isUpdate = std::exchange( isSearchRegionsUpdate_, false );
+    auto regions = searchRegionsWatcher_.result();
+    const auto data = searchRegionsData_.lock();
+    if ( !regions || !data ) {
+        return;
+    }
+
+    // Lines of a level are shown as they are when there is nothing to search in them
+    if ( !isUpdate && !searchRegionsLevel_.isEmpty() && data == logFilteredData_
+         && searchLineEdit_->currentText().isEmpty() ) {
+        showLinesInNewTab( tr( "Level %1" ).arg( searchRegionsLevel_ ), *regions );
+        return;
+    }
+
+    searchedLinesText_ = searchRegionsLevel_.isEmpty()
+                             ? tr( " between markers" )
+                             : tr( " in level %1" ).arg( searchRegionsLevel_ );
+    data->setSearchedLines( std::move( regions ) );
+    if ( data != logFilteredData_ ) {
+        return;
+    }
+
+    if ( !isUpdate ) {
+        startNewSearch();
+    }
+    else if ( searchRegionsNbLines_ != logData_->getNbLine() ) {
+        // File changed while the regions were found
+        updateSearchRegions();
+    }
+    else if ( !searchInfoLine_->text().isEmpty() ) {
+        replaceCurrentSearch( searchLineEdit_->currentText(), logFilteredData_->isCountOnly() );
+    }
+}
+
+void CrawlerWidget::updateSearchRegions()
+{
+    if ( !logFilteredData_->searchedLines() || searchRegionsWatcher_.isRunning() ) {
+        return;
+    }
+
+    // Only the last regions are known, other searched lines are dropped
+    if ( searchRegionsData_.lock() != logFilteredData_ ) {
+        logFilteredData_->setSearchedLines( {} );
+        return;
+    }
+
+    isSearchRegionsUpdate_ = true;
+    findSearchRegions();
+}
+
+void CrawlerWidget::exportSearchResults()
+{
+    if ( linesExportWatcher_.isRunning() ) {
+        if ( linesExportProgress_ ) {
+            linesExportProgress_->raise();
+        }
+        return;
+    }
+
+    const auto title = tr( "Export search results" );
+    const auto lines = logFilteredData_->getMatchingLines();
+    if ( lines->isEmpty() ) {
+        QMessageBox::information( this, title, tr( "There are no matching lines to export" ) );
+        return;
+    }
+
+    // Formats are in the order of LinesExportFormat
+    const QStringList formats = { tr( "Lines" ), tr( "Line numbers" ), tr( "Byte offsets" ),
+                                  tr( "Roaring bitmap" ) };
+    bool isOk = false;
+    const auto formatName
+        = QInputDialog::getItem( this, title, tr( "Export" ), formats, 0, false, &isOk );
+    if ( !isOk ) {
+        return;
+    }
+    const auto format = static_cast<LinesExportFormat>( formats.indexOf( formatName ) );
+
+    const auto toFile = tr( "File" );
+    const auto destination = QInputDialog::getItem( this, title, tr( "Write to" ),
+                                                    { toFile, tr( "Command" ) }, 0, false, &isOk );
+    if ( !isOk ) {
+        return;
+    }
+
+    QString fileName;
+    QString command;
+    if ( destination == toFile ) {
+        fileName = QFileDialog::getSaveFileName( this, title );
+        if ( fileName.isEmpty() ) {
+            return;
+        }
+    }
+    else {
+        command = QInputDialog::getText( this, title,
+                                         tr( "Command reading the export from standard input" ),
+                                         QLineEdit::Normal, linesExportCommand_, &isOk );
+        if ( !isOk || command.trimmed().isEmpty() ) {
+            return;
+        }
+        linesExportCommand_ = command;
+    }
+
+    linesExportInterrupt_->clear();
+    linesExportProgress_ = new QProgressDialog(
+        tr( "Exporting %1 lines..." ).arg( lines->cardinality() ), tr( "Cancel" ), 0, 0, this );
+    linesExportProgress_->setAttribute( Qt::WA_DeleteOnClose );
+    linesExportProgress_->setWindowTitle( title );
+    connect( linesExportProgress_, &QProgressDialog::canceled, this,
+             [ interrupt = linesExportInterrupt_ ] { interrupt->set(); } );
+    linesExportProgress_->show();
+
+    linesExportWatcher_.setFuture( QtConcurrent::run(
+        [ logData = logData_, lines, format, fileName, command,
+          interrupt = linesExportInterrupt_ ]() {
+            if ( !fileName.isEmpty() ) {
+                QSaveFile file( fileName );
+                return file.open( QIODevice::WriteOnly )
+                       && exportLines( *logData, *lines, format, file, *interrupt )
+                       && file.commit();
+            }
+
+            // Output of the command is not read, so it can't fill the pipe
+            QProcess process;
+            process.setProcessChannelMode( QProcess::ForwardedChannels );
+#ifdef Q_OS_WIN
+            process.start( "cmd", { "/c", command } );
+#else
+            process.start( "/bin/sh", { "-c", command } );
+#endif
+            if ( !process.waitForStarted( -1 ) ) {
+                LOG_ERROR << "Failed to start " << command.toStdString() << ": "
+                          << process.errorString().toStdString();
+                return false;
+            }
+
+            const auto isExported = exportLines( *logData, *lines, format, process, *interrupt );
+            if ( isExported ) {
+                process.closeWriteChannel();
+            }
+            else {
+                process.kill();
+            }
+            process.waitForFinished( -1 );
+
+            return isExported && process.exitStatus() == QProcess::NormalExit
+                   && process.exitCode() == 0;
+        } ) );
+}
+
+void CrawlerWidget::finishLinesExport()
+{
+    const auto isInterrupted = static_cast<bool>( *linesExportInterrupt_ );
+    if ( linesExportProgress_ ) {
+        linesExportProgress_->disconnect( this );
+        linesExportProgress_->close();
+    }
+
+    if ( !linesExportWatcher_.result() && !isInterrupted ) {
+        QMessageBox::warning( this, tr( "Export search results" ),
+                              tr( "Search results could not be exported" ) );
+    }
+}
+
+void CrawlerWidget::showLinesInNewTab( const QString& tabText, SearchResultArray lines,
+                                       std::shared_ptr<const LineOrder> order )
+{
+    addFilteredViewTab();
+    tabbedFilteredView_->setTabText( tabbedFilteredView_->currentIndex(), tabText );
+
+    // Lines are not searched for, so there is nothing to refresh
+    nbMatches_ = 0_lcount;
+    searchState_.startSearch();
+    searchState_.stopSearch();
+    isSearchFollowingLoading_ = false;
+    logMainView_->setSearchPattern( {} );
+    filteredView_->setSearchPattern( {} );
+    timeHistogram_->setHistogram( {} );
+
+    logFilteredData_->showLines( std::move( lines ), std::move( order ) );
+}
+
+void CrawlerWidget::selectPendingJumpLine()
+{
+    if ( !pendingJumpOffset_ ) {
+        return;
+    }
+
+    const auto line = logData_->getLineAtOffset( *pendingJumpOffset_ );
+    if ( !line ) {
+        return;
+    }
+
+    LOG_INFO << "offset " << *pendingJumpOffset_ << " is indexed at line " << *line;
+
+    // Dialog resets the pending jump when it is closed
+    pendingJumpOffset_.reset();
+    if ( linesAtOffsetDialog_ ) {
+        linesAtOffsetDialog_->close();
+    }
+
+    filteredView_->trySelectLine( logFilteredData_->getLineIndexNumber( *line ) );
+    logMainView_->trySelectLine( *line );
+}
+
 //
 // Protected functions
 //
@@ -359,10 +1316,18 @@ void CrawlerWidget::doSetViewContext( const QString& view_context )
 
 std::shared_ptr<const ViewContextInterface> CrawlerWidget::doGetViewContext() const
 {
+    // Restored marks are kept until the file is loaded
+    auto marks = logFilteredData_->getMarks();
+    if ( !firstLoadDone_ ) {
+        for ( const auto& line : savedMarkedLines_ ) {
+            marks.append( line );
+        }
+    }
+
     auto context = std::make_shared<const CrawlerWidgetContext>(
         sizes(), ( !matchCaseButton_->isChecked() ), searchRefreshButton_->isChecked(),
         logMainView_->isFollowEnabled(), useRegexpButton_->isChecked(), inverseButton_->isChecked(),
-        booleanButton_->isChecked(), logFilteredData_->getMarks() );
+        booleanButton_->isChecked(), marks );
 
     return static_cast<std::shared_ptr<const ViewContextInterface>>( context );
 }
@@ -373,30 +1338,11 @@ std::shared_ptr<const ViewContextInterface> CrawlerWidget::doGetViewContext() co
 
 void CrawlerWidget::startNewSearch()
 {
+    cancelSpeculativeSearches();
+
     if ( keepSearchResultsButton_->isChecked() ) {
         keepSearchResultsButton_->setChecked( false );
-
-        logFilteredData_->interruptSearch();
-        logFilteredData_ = logData_->getNewFilteredData();
-
-        filteredView_ = new FilteredView( logFilteredData_.get(), quickFindPattern_.get() );
-        filteredViewsData_[ filteredView_ ] = logFilteredData_;
-
-        connect(filteredView_, &QObject::destroyed, [this](QObject* view) {
-            filteredViewsData_.erase(qobject_cast<FilteredView*>(view));
-        });
-
-        connectAllFilteredViewSlots( filteredView_ );
-
-        auto index = tabbedFilteredView_->addTab( filteredView_, "" );
-        tabbedFilteredView_->setCurrentIndex( index );
-
-        connect( logFilteredData_.get(), &LogFilteredData::searchProgressed, this,
-                 &CrawlerWidget::updateFilteredView, Qt::QueuedConnection );
-
-        logMainView_->useNewFiltering( logFilteredData_.get() );
-
-        applyConfiguration();
+        addFilteredViewTab();
     }
 
     tabbedFilteredView_->setTabText( tabbedFilteredView_->currentIndex(),
@@ -410,8 +1356,36 @@ void CrawlerWidget::startNewSearch()
 
     // Update the SearchLine (history)
     updateSearchCombo();
-    // Call the private function to do the search
-    replaceCurrentSearch( searchLineEdit_->currentText() );
+    // Call the private function to do the search,
+    // matches are only counted if Shift is held
+    replaceCurrentSearch( searchLineEdit_->currentText(),
+                          QApplication::keyboardModifiers().testFlag( Qt::ShiftModifier ) );
+}
+
+void CrawlerWidget::addFilteredViewTab()
+{
+    logFilteredData_->interruptSearch();
+    logFilteredData_ = logData_->getNewFilteredData();
+
+    filteredView_ = new FilteredView( logFilteredData_.get(), quickFindPattern_.get() );
+    filteredView_->setMemoryGroup( logData_.get() );
+    filteredViewsData_[ filteredView_ ] = logFilteredData_;
+
+    connect(filteredView_, &QObject::destroyed, [this](QObject* view) {
+        filteredViewsData_.erase(qobject_cast<FilteredView*>(view));
+    });
+
+    connectAllFilteredViewSlots( filteredView_ );
+
+    auto index = tabbedFilteredView_->addTab( filteredView_, "" );
+    tabbedFilteredView_->setCurrentIndex( index );
+
+    connect( logFilteredData_.get(), &LogFilteredData::searchProgressed, this,
+             &CrawlerWidget::updateFilteredView, Qt::QueuedConnection );
+
+    logMainView_->useNewFiltering( logFilteredData_.get() );
+
+    applyConfiguration();
 }
 
 void CrawlerWidget::updatePredefinedFiltersWidget()
@@ -424,6 +1398,7 @@ void CrawlerWidget::stopSearch()
 {
     logFilteredData_->interruptSearch();
     searchState_.stopSearch();
+    isSearchFollowingLoading_ = false;
     printSearchInfoMessage();
 }
 
@@ -490,6 +1465,7 @@ void CrawlerWidget::updateFilteredView( LinesCount nbMatches, int progress,
 
     if ( progress == 100 ) {
         // Searching done
+        isSearchRunning_ = false;
         printSearchInfoMessage( nbMatches );
         searchInfoLine_->hideGauge();
         // De-activate the stop button
@@ -515,15 +1491,36 @@ void CrawlerWidget::updateFilteredView( LinesCount nbMatches, int progress,
         }
     }
 
+    // The chart of matches by time grows as they are found
+    timeHistogram_->setHistogram( logFilteredData_->getTimeHistogram() );
+
     // If more (or less, e.g. come back to 0) matches have been found
     if ( nbMatches != nbMatches_ ) {
+        const auto firstNewMatch = logFilteredData_->takeFirstNewMatch();
+        const auto isSearchProgress = nbMatches > nbMatches_ && firstNewMatch.has_value();
         nbMatches_ = nbMatches;
 
-        // Recompute the content of the filtered window.
-        filteredView_->updateData();
+        // Recompute the content of the filtered window,
+        // it is not repainted while matches are found below the shown ones
+        if ( isSearchProgress ) {
+            // Lines of context of a new match are shown before it
+            const auto contextLines = logFilteredData_->contextLines();
+            const auto firstAddedLine = firstNewMatch->get() > contextLines.get()
+                                            ? *firstNewMatch - contextLines
+                                            : 0_lnum;
+            filteredView_->updateDataAfter( firstAddedLine );
+        }
+        else {
+            filteredView_->updateData();
+        }
 
-        // Update the match overview
-        overview_.updateData( logData_->getNbLine() );
+        // Update the match overview, only below new matches while the search progresses
+        if ( isSearchProgress ) {
+            overview_.updateMatches( *firstNewMatch );
+        }
+        else {
+            overview_.updateData( logData_->getNbLine() );
+        }
 
         // New data found icon
         if ( initialPosition > 0_lnum ) {
@@ -533,6 +1530,11 @@ void CrawlerWidget::updateFilteredView( LinesCount nbMatches, int progress,
         // Also update the top window for the coloured bullets.
         update();
     }
+    else if ( progress == 100 && logFilteredData_->isCountOnly() ) {
+        // Counts in parts of the file are known when counting is done
+        overview_.updateData( logData_->getNbLine() );
+        update();
+    }
 
     // Try to restore the filtered window selection close to where it was
     // only for full searches to avoid disconnecting follow mode!
@@ -634,12 +1636,9 @@ void CrawlerWidget::applyConfiguration()
         font.setStyleStrategy( QFont::PreferAntialias );
     }
 
-    if ( config.hideAnsiColorSequences() ) {
-        logData_->setPrefilter( AnsiColorSequenceRegex );
-    }
-    else {
-        logData_->setPrefilter( {} );
-    }
+    logData_->setHideAnsiColorSequences( config.hideAnsiColorSequences() );
+    logMainView_->truncateQuickFindIndex( 0_lnum );
+    resetPredefinedFiltersMatchCounts();
 
     logMainView_->setLineNumbersVisible( config.mainLineNumbersVisible() );
 
@@ -692,10 +1691,51 @@ void CrawlerWidget::loadingFinishedHandler( LoadingStatus status )
 {
     LOG_INFO << "file loading finished, status " << static_cast<int>( status );
 
+    // Changes of followed files are coalesced until the view is activated
+    if ( !isActive_ && firstLoadDone_ && !loadingPreviewShown_
+         && status == LoadingStatus::Successful
+         && Configuration::get().deferInactiveUpdates() ) {
+        LOG_DEBUG << "deferring update of inactive view";
+        isUpdateDeferred_ = true;
+    }
+    else {
+        updateLoadedData( status );
+    }
+
+    // Also change the data available icon
+    if ( firstLoadDone_ ) {
+        changeDataStatus( DataStatus::NEW_DATA );
+    }
+    else {
+        firstLoadDone_ = true;
+        for ( const auto& m : savedMarkedLines_ ) {
+            logFilteredData_->addMark( m );
+        }
+    }
+
+    loadingInProgress_ = false;
+    Q_EMIT loadingFinished( status );
+}
+
+void CrawlerWidget::updateLoadedData( LoadingStatus status )
+{
+    isUpdateDeferred_ = false;
+
+    // Lines have been renumbered when the beginning of the file was loaded,
+    // so marks and search results made during preview are dropped.
+    if ( loadingPreviewShown_ ) {
+        loadingPreviewShown_ = false;
+        fileChangedHandler( MonitoredFileStatus::Truncated );
+    }
+
     // We need to refresh the main window because the view lines on the
     // overview have probably changed.
     overview_.updateData( logData_->getNbLine() );
 
+    liveIndexedLines_ = 0_lcount;
+    liveUpdateTimer_.invalidate();
+    logMainView_->setEstimatedNbLines( 0_lcount );
+
     // FIXME, handle topLine
     // logMainView_->updateData( logData_, topLine );
     logMainView_->updateData();
@@ -705,40 +1745,108 @@ void CrawlerWidget::loadingFinishedHandler( LoadingStatus status )
 
     // searchButton_->setEnabled( true );
 
-    // See if we need to auto-refresh the search
-    if ( searchState_.isAutorefreshAllowed() ) {
+    // Searched regions are found again in the changed file, the search is then restarted
+    if ( searchRegionsNbLines_ != logData_->getNbLine() ) {
+        updateSearchRegions();
+    }
+
+    // See if we need to auto-refresh the search,
+    // search started during loading goes on over the rest of the file
+    if ( isSearchRegionsUpdate_ ) {
+        isSearchFollowingLoading_ = false;
+    }
+    else if ( searchState_.isAutorefreshAllowed() || isSearchFollowingLoading_ ) {
         searchEndLine_ = LineNumber( logData_->getNbLine().get() );
-        if ( searchState_.isFileTruncated() )
+        if ( searchState_.isFileTruncated() ) {
             // We need to restart the search
-            replaceCurrentSearch( searchLineEdit_->currentText() );
-        else
+            replaceCurrentSearch( searchLineEdit_->currentText(),
+                                  logFilteredData_->isCountOnly() );
+        }
+        else {
+            isSearchRunning_ = true;
             logFilteredData_->updateSearch( searchStartLine_, searchEndLine_ );
+        }
     }
+    isSearchFollowingLoading_ = false;
 
     // Set the encoding for the views
     updateEncoding();
 
+    selectPendingJumpLine();
+
     clearSearchLimits();
 
-    // Also change the data available icon
-    if ( firstLoadDone_ ) {
-        changeDataStatus( DataStatus::NEW_DATA );
+    if ( status == LoadingStatus::Successful ) {
+        startSpeculativeSearches();
     }
-    else {
-        firstLoadDone_ = true;
-        for ( const auto& m : savedMarkedLines_ ) {
-            logFilteredData_->addMark( m );
-        }
+}
+
+void CrawlerWidget::loadingPreviewHandler()
+{
+    LOG_INFO << "file loading preview ready";
+
+    loadingPreviewShown_ = true;
+
+    overview_.updateData( logData_->getNbLine() );
+    logMainView_->updateData();
+
+    updateEncoding();
+}
+
+void CrawlerWidget::loadingProgressHandler( int progress )
+{
+    // Lines of the preview are numbered from the end of the file
+    if ( !loadingInProgress_ || loadingPreviewShown_ || progress >= 100
+         || !Configuration::get().liveViewWhileIndexing() ) {
+        return;
     }
 
-    loadingInProgress_ = false;
-    Q_EMIT loadingFinished( status );
+    if ( liveUpdateTimer_.isValid() && liveUpdateTimer_.elapsed() < LiveUpdateIntervalMs ) {
+        return;
+    }
+    liveUpdateTimer_.start();
+
+    const auto nbLines = logData_->getNbLine();
+    if ( nbLines == liveIndexedLines_ ) {
+        return;
+    }
+
+    // File is indexed again from the beginning, e.g. in another encoding
+    if ( nbLines < liveIndexedLines_ ) {
+        fileChangedHandler( MonitoredFileStatus::Truncated );
+        isSearchFollowingLoading_ = false;
+    }
+
+    // Search limits at the end of the loaded lines move with it
+    if ( searchEndLine_.get() >= liveIndexedLines_.get() ) {
+        setSearchLimits( searchStartLine_, LineNumber( nbLines.get() ) );
+    }
+    liveIndexedLines_ = nbLines;
+
+    LOG_DEBUG << "showing " << nbLines << " lines while loading";
+
+    overview_.updateData( nbLines );
+    logMainView_->setEstimatedNbLines( logData_->getEstimatedNbLine() );
+    logMainView_->updateData();
+    updateEncoding();
+
+    if ( isSearchFollowingLoading_ && !isSearchRunning_ ) {
+        isSearchRunning_ = true;
+        logFilteredData_->updateSearch( searchStartLine_, searchEndLine_ );
+    }
+
+    selectPendingJumpLine();
 }
 
 void CrawlerWidget::fileChangedHandler( MonitoredFileStatus status )
 {
     // Handle the case where the file has been truncated
     if ( status == MonitoredFileStatus::Truncated ) {
+        searchRegionsNbLines_ = 0_lcount;
+        logMainView_->truncateQuickFindIndex( 0_lnum );
+        resetPredefinedFiltersMatchCounts();
+        cancelSpeculativeSearches();
+
         // Clear all marks (TODO offer the option to keep them)
         logFilteredData_->clearMarks();
         if ( !searchInfoLine_->text().isEmpty() ) {
@@ -753,6 +1861,27 @@ void CrawlerWidget::fileChangedHandler( MonitoredFileStatus status )
     }
 }
 
+void CrawlerWidget::fileModifiedHandler( LineNumber firstModifiedLine )
+{
+    LOG_INFO << "file modified from line " << firstModifiedLine;
+
+    // Results before the modified line are still valid,
+    // the search is continued from it when loading is finished
+    logFilteredData_->truncateSearch( firstModifiedLine );
+    logMainView_->truncateQuickFindIndex( firstModifiedLine );
+    searchRegionsNbLines_ = 0_lcount;
+    resetPredefinedFiltersMatchCounts();
+    cancelSpeculativeSearches();
+    filteredView_->updateData();
+    overview_.updateData( logData_->getNbLine() );
+    logMainView_->updateData();
+
+    if ( !searchInfoLine_->text().isEmpty() ) {
+        nbMatches_ = logFilteredData_->getNbMatches();
+        printSearchInfoMessage( nbMatches_ );
+    }
+}
+
 // Returns a pointer to the window in which the search should be done
 AbstractLogView* CrawlerWidget::activeView() const
 {
@@ -795,6 +1924,77 @@ void CrawlerWidget::resetStateOnSearchPatternChanges()
 
     searchState_.changeExpression();
     printSearchInfoMessage( logFilteredData_->getNbMatches() );
+
+    // Errors are shown while typing, the search is started with the compiled result
+    isPatternErrorShown_ = false;
+    const auto searchText = searchLineEdit_->currentText();
+    if ( !searchText.isEmpty() ) {
+        patternValidator_.validate( searchPattern( searchText ) );
+    }
+}
+
+void CrawlerWidget::startSpeculativeSearches()
+{
+    cancelSpeculativeSearches();
+
+    const auto& config = Configuration::get();
+    if ( !config.useSpeculativeSearches() || !config.useSearchResultsCache() ) {
+        return;
+    }
+
+    speculativeSearches_
+        = savedSearches_->recentSearches().mid( 0, config.speculativeSearchesCount() );
+    if ( speculativeSearches_.isEmpty() ) {
+        return;
+    }
+
+    // Destroying data of the previous searches waits for them to stop,
+    // so their progress is never taken for the new ones
+    speculativeData_ = logData_->getNewFilteredData();
+    auto* data = speculativeData_.get();
+    connect(
+        data, &LogFilteredData::searchProgressed, data,
+        [ this, data ]( LinesCount, int progress, LineNumber ) {
+            if ( progress == 100 ) {
+                logFilteredData_->takeCachedSearchResults( *data );
+                runNextSpeculativeSearch();
+            }
+        },
+        Qt::QueuedConnection );
+
+    runNextSpeculativeSearch();
+}
+
+void CrawlerWidget::runNextSpeculativeSearch()
+{
+    while ( !speculativeSearches_.isEmpty() ) {
+        const auto searchText = speculativeSearches_.takeFirst();
+
+        // Selecting a search from the history keeps the current options
+        const auto regexpPattern = searchPattern( searchText );
+
+        if ( searchText.isEmpty() || searchText == searchLineEdit_->currentText()
+             || logFilteredData_->hasCachedSearchResults( regexpPattern, searchStartLine_,
+                                                          searchEndLine_ )
+             || !RegularExpression{ regexpPattern }.isValid() ) {
+            continue;
+        }
+
+        LOG_INFO << "running speculative search for " << searchText;
+        speculativeData_->runSearch( regexpPattern, searchStartLine_, searchEndLine_ );
+        return;
+    }
+}
+
+void CrawlerWidget::cancelSpeculativeSearches()
+{
+    speculativeSearches_.clear();
+
+    // Results found for the data before it changed are not taken
+    if ( speculativeData_ ) {
+        constexpr auto DropCache = true;
+        speculativeData_->clearSearch( DropCache );
+    }
 }
 
 void CrawlerWidget::searchRefreshChangedHandler( bool isRefreshing )
@@ -823,10 +2023,33 @@ void CrawlerWidget::useRegexpChangeHandler( bool )
 
 void CrawlerWidget::searchTextChangeHandler( QString )
 {
+    // Typing a new search is more important than the speculative ones
+    cancelSpeculativeSearches();
     resetStateOnSearchPatternChanges();
     updatePredefinedFiltersWidget();
 }
 
+void CrawlerWidget::patternValidatedHandler( bool isValid, const QString& errorString )
+{
+    // Search line could be replaced without typing meanwhile
+    if ( !patternValidator_.result( searchPattern( searchLineEdit_->currentText() ) ) ) {
+        return;
+    }
+
+    if ( isValid ) {
+        if ( isPatternErrorShown_ ) {
+            isPatternErrorShown_ = false;
+            printSearchInfoMessage( logFilteredData_->getNbMatches() );
+        }
+        return;
+    }
+
+    isPatternErrorShown_ = true;
+    searchInfoLine_->setPalette( ErrorPalette );
+    searchInfoLine_->setText( tr( "Error in expression" ) + ": " + errorString );
+    searchInfoLine_->show();
+}
+
 void CrawlerWidget::changeFilteredViewVisibility( int index )
 {
     QStandardItem* item = visibilityModel_->item( index );
@@ -840,6 +2063,56 @@ void CrawlerWidget::changeFilteredViewVisibility( int index )
     }
 }
 
+void CrawlerWidget::changeFilteredViewContextLines( int contextLines )
+{
+    logFilteredData_->setContextLines(
+        LinesCount( static_cast<LinesCount::UnderlyingType>( contextLines ) ) );
+    filteredView_->updateData();
+
+    if ( logFilteredData_->getNbLine() > 0_lcount ) {
+        const auto lineIndex = logFilteredData_->getLineIndexNumber( currentLineNumber_ );
+        filteredView_->selectAndDisplayLine( lineIndex );
+    }
+}
+
+void CrawlerWidget::resetPredefinedFiltersMatchCounts()
+{
+    filterStatisticsKey_.reset();
+    filterMatchCounts_.clear();
+    predefinedFilters_->setMatchCounts( filterMatchCounts_ );
+}
+
+void CrawlerWidget::updatePredefinedFiltersMatchCounts()
+{
+    if ( filterStatisticsWatcher_.isRunning() ) {
+        return;
+    }
+
+    // Filters are matched the way they are searched for
+    klogg::vector<RegularExpressionPattern> patterns;
+    for ( const auto& filter : predefinedFilters_->filters() ) {
+        patterns.emplace_back( filter.pattern, matchCaseButton_->isChecked(), false, false,
+                               !filter.useRegex );
+    }
+
+    auto key = std::make_pair( patterns, logData_->getNbLine() );
+    if ( filterStatisticsKey_ == key ) {
+        // Filters shown again are given the same counts
+        predefinedFilters_->setMatchCounts( filterMatchCounts_ );
+        return;
+    }
+
+    filterStatisticsKey_ = std::move( key );
+    filterMatchCounts_.clear();
+    predefinedFilters_->setMatchCounts( filterMatchCounts_ );
+
+    filterStatisticsWatcher_.setFuture( QtConcurrent::run(
+        [ logData = logData_, patterns = std::move( patterns ),
+          interrupt = filterStatisticsInterrupt_ ]() {
+            return FilterStatistics::collect( *logData, patterns, *interrupt );
+        } ) );
+}
+
 void CrawlerWidget::setSearchPatternFromPredefinedFilters( const QList<PredefinedFilter>& filters )
 {
     QString searchPattern;
@@ -911,6 +2184,18 @@ void CrawlerWidget::replaceSearch( const QString& searchString )
     setSearchPattern( escapeSearchPattern( searchString ) );
 }
 
+void CrawlerWidget::showIdenticalLines( LineNumber line )
+{
+    const auto lineText = logData_->getLineString( line );
+    auto identicalLines = logData_->getIdenticalLines( line );
+    if ( !identicalLines ) {
+        replaceSearch( lineText );
+        return;
+    }
+
+    showLinesInNewTab( "Same as \"" + lineText + "\"", std::move( *identicalLines ) );
+}
+
 void CrawlerWidget::setSearchPattern( const QString& searchPattern )
 {
     searchLineEdit_->setEditText( searchPattern );
@@ -971,8 +2256,10 @@ void CrawlerWidget::setup()
     logMainView_
         = new LogMainView( logData_.get(), quickFindPattern_.get(), &overview_, overviewWidget_ );
     logMainView_->setContentsMargins( 2, 0, 2, 0 );
+    logMainView_->setMemoryGroup( logData_.get() );
 
     filteredView_ = new FilteredView( logFilteredData_.get(), quickFindPattern_.get() );
+    filteredView_->setMemoryGroup( logData_.get() );
     filteredViewsData_[ filteredView_ ] = logFilteredData_;
     filteredView_->setContentsMargins( 2, 0, 2, 0 );
 
@@ -1124,10 +2411,17 @@ void CrawlerWidget::setup()
 
     predefinedFilters_ = new PredefinedFiltersComboBox( this );
 
+    contextLinesBox_ = new QSpinBox();
+    contextLinesBox_->setRange( 0, 1000 );
+    contextLinesBox_->setPrefix( QStringLiteral( "±" ) );
+    contextLinesBox_->setToolTip( tr( "Lines of context shown around each line" ) );
+    contextLinesBox_->setContentsMargins( 2, 2, 2, 2 );
+
     auto* searchLineLayout = new QHBoxLayout;
     searchLineLayout->setContentsMargins( 2, 2, 2, 2 );
 
     searchLineLayout->addWidget( visibilityBox_ );
+    searchLineLayout->addWidget( contextLinesBox_ );
     searchLineLayout->addWidget( matchCaseButton_ );
     searchLineLayout->addWidget( useRegexpButton_ );
     searchLineLayout->addWidget( inverseButton_ );
@@ -1141,6 +2435,9 @@ void CrawlerWidget::setup()
     searchLineLayout->addWidget( stopButton_ );
     searchLineLayout->addWidget( searchInfoLine_ );
 
+    timeHistogram_ = new TimeHistogramWidget();
+    timeHistogram_->setContentsMargins( 2, 2, 2, 2 );
+
     // Construct the bottom window
     tabbedFilteredView_ = new QTabWidget;
     tabbedFilteredView_->setTabsClosable( true );
@@ -1150,6 +2447,7 @@ void CrawlerWidget::setup()
 
     auto* bottomMainLayout = new QVBoxLayout;
     bottomMainLayout->addLayout( searchLineLayout );
+    bottomMainLayout->addWidget( timeHistogram_ );
     bottomMainLayout->addWidget( tabbedFilteredView_ );
     bottomMainLayout->setContentsMargins( 2, 2, 2, 2 );
     bottomWindow->setLayout( bottomMainLayout );
@@ -1180,12 +2478,42 @@ void CrawlerWidget::setup()
              &QToolButton::click );
     connect( searchLineEdit_->lineEdit(), &QLineEdit::textEdited, this,
              &CrawlerWidget::searchTextChangeHandler );
+    connect( &patternValidator_, &PatternValidator::validated, this,
+             &CrawlerWidget::patternValidatedHandler );
 
     connect( searchLineEdit_, QOverload<int>::of( &QComboBox::currentIndexChanged ), this,
              [ this ]( auto ) { updatePredefinedFiltersWidget(); } );
 
     connect( predefinedFilters_, &PredefinedFiltersComboBox::filterChanged, this,
              &CrawlerWidget::setSearchPatternFromPredefinedFilters );
+    connect( predefinedFilters_, &PredefinedFiltersComboBox::matchCountsRequested, this,
+             &CrawlerWidget::updatePredefinedFiltersMatchCounts );
+    connect( &filterStatisticsWatcher_, &QFutureWatcher<FilterStatistics>::finished, this,
+             [ this ] {
+                 // Counts of lines changed while they were counted are dropped
+                 const auto statistics = filterStatisticsWatcher_.result();
+                 if ( !statistics.isValid || !filterStatisticsKey_ ) {
+                     filterStatisticsKey_.reset();
+                     return;
+                 }
+                 filterMatchCounts_ = statistics.matches;
+                 predefinedFilters_->setMatchCounts( filterMatchCounts_ );
+             } );
+    connect( &logTemplatesWatcher_, &QFutureWatcher<LogTemplates>::finished, this,
+             &CrawlerWidget::showMinedLogTemplates );
+    connect( &fieldFacetsWatcher_, &QFutureWatcher<FieldFacets>::finished, this,
+             &CrawlerWidget::showCountedFieldFacets );
+    connect( &numberStatisticsWatcher_, &QFutureWatcher<FieldStatistics>::finished, this,
+             &CrawlerWidget::showComputedNumberStatistics );
+    connect( &lineOrderWatcher_, &QFutureWatcher<std::optional<LineOrder>>::finished, this,
+             &CrawlerWidget::showSortedLines );
+    connect( &linesComparisonWatcher_, &QFutureWatcher<std::optional<LinesComparison>>::finished,
+             this, &CrawlerWidget::showComparedLines );
+    connect( &searchRegionsWatcher_,
+             &QFutureWatcher<std::shared_ptr<const SearchResultArray>>::finished, this,
+             &CrawlerWidget::searchFoundRegions );
+    connect( &linesExportWatcher_, &QFutureWatcher<bool>::finished, this,
+             &CrawlerWidget::finishLinesExport );
 
     connect( searchLineEdit_, &QWidget::customContextMenuRequested, this,
              &CrawlerWidget::showSearchContextMenu );
@@ -1201,6 +2529,8 @@ void CrawlerWidget::setup()
 
     connect( visibilityBox_, QOverload<int>::of( &QComboBox::currentIndexChanged ), this,
              &CrawlerWidget::changeFilteredViewVisibility );
+    connect( contextLinesBox_, QOverload<int>::of( &QSpinBox::valueChanged ), this,
+             &CrawlerWidget::changeFilteredViewContextLines );
 
     connect( logMainView_, &LogMainView::newSelection,
              [ this ]( auto ) { logMainView_->update(); } );
@@ -1219,6 +2549,11 @@ void CrawlerWidget::setup()
     connect( logMainView_, QOverload<const QString&>::of( &LogMainView::replaceSearch ), this,
              &CrawlerWidget::replaceSearch );
 
+    connect( logMainView_, &LogMainView::showIdenticalLines, this,
+             &CrawlerWidget::showIdenticalLines );
+    connect( logMainView_, &LogMainView::showSelectionStatistics, this,
+             &CrawlerWidget::showSelectionStatistics );
+
     // Follow option (up and down)
     connect( this, &CrawlerWidget::followSet, logMainView_, &LogMainView::followSet );
     connect( logMainView_, &LogMainView::followModeChanged, this,
@@ -1235,12 +2570,22 @@ void CrawlerWidget::setup()
     connect( logMainView_, &LogMainView::clearSearchLimits, this,
              &CrawlerWidget::clearSearchLimits );
 
+    connect( timeHistogram_, &TimeHistogramWidget::lineClicked, this, [ this ]( LineNumber line ) {
+        filteredView_->trySelectLine( logFilteredData_->getLineIndexNumber( line ) );
+        logMainView_->trySelectLine( line );
+    } );
+
     connect( tabbedFilteredView_, &QTabWidget::currentChanged, [ this ]( int index ) {
         logFilteredData_->interruptSearch();
         if ( index >= 0 ) {
             filteredView_ = qobject_cast<FilteredView*>( tabbedFilteredView_->widget( index ) );
             logFilteredData_ = filteredViewsData_.at( filteredView_ );
             logMainView_->useNewFiltering( logFilteredData_.get() );
+            timeHistogram_->setHistogram( logFilteredData_->getTimeHistogram() );
+
+            const auto contextLines = logFilteredData_->contextLines();
+            const QSignalBlocker blocker( contextLinesBox_ );
+            contextLinesBox_->setValue( static_cast<int>( contextLines.get() ) );
         }
     } );
 
@@ -1265,9 +2610,22 @@ void CrawlerWidget::setup()
 
     // Sent load file update to MainWindow (for status update)
     connect( logData_.get(), &LogData::loadingProgressed, this, &CrawlerWidget::loadingProgressed );
+    connect( logData_.get(), &LogData::loadingProgressed, this,
+             &CrawlerWidget::loadingProgressHandler );
     connect( logData_.get(), &LogData::loadingFinished, this,
              &CrawlerWidget::loadingFinishedHandler );
+    connect( logData_.get(), &LogData::loadingPreviewReady, this,
+             &CrawlerWidget::loadingPreviewHandler );
     connect( logData_.get(), &LogData::fileChanged, this, &CrawlerWidget::fileChangedHandler );
+    connect( logData_.get(), &LogData::fileModified, this,
+             &CrawlerWidget::fileModifiedHandler );
+
+    // Log shared with another view of the file may be loaded already
+    if ( const auto loadingStatus = logData_->lastLoadingStatus() ) {
+        QMetaObject::invokeMethod(
+            this, [ this, status = *loadingStatus ] { loadingFinishedHandler( status ); },
+            Qt::QueuedConnection );
+    }
 
     // Search auto-refresh
     connect( searchRefreshButton_, &QPushButton::toggled, this,
@@ -1360,6 +2718,10 @@ void CrawlerWidget::connectAllFilteredViewSlots( FilteredView* view )
     connect( view, QOverload<const QString&>::of( &FilteredView::replaceSearch ), this,
              &CrawlerWidget::replaceSearch );
 
+    connect( view, &FilteredView::showIdenticalLines, this, &CrawlerWidget::showIdenticalLines );
+    connect( view, &FilteredView::showSelectionStatistics, this,
+             &CrawlerWidget::showSelectionStatistics );
+
     connect( view, &FilteredView::mouseHoveredOverLine, this,
              &CrawlerWidget::mouseHoveredOverMatch );
 
@@ -1401,6 +2763,20 @@ void CrawlerWidget::connectAllFilteredViewSlots( FilteredView* view )
              QOverload<>::of( &FilteredView::setFocus ) );
 }
 
+void CrawlerWidget::setActive( bool isActive )
+{
+    if ( logData_ ) {
+        logData_->setTaskPriority( isActive ? TaskPriority::Foreground
+                                            : TaskPriority::Background );
+    }
+
+    isActive_ = isActive;
+    if ( isActive_ && isUpdateDeferred_ && !loadingInProgress_ ) {
+        LOG_INFO << "updating view with changes deferred while inactive";
+        updateLoadedData( LoadingStatus::Successful );
+    }
+}
+
 void CrawlerWidget::registerShortcuts()
 {
     LOG_INFO << "registering shortcuts for crawler widget";
@@ -1479,59 +2855,27 @@ void CrawlerWidget::loadIcons()
 
 // Create a new search using the text passed, replace the currently
 // used one and destroy the old one.
-void CrawlerWidget::replaceCurrentSearch( const QString& searchText )
+void CrawlerWidget::replaceCurrentSearch( const QString& searchText, bool countOnly )
 {
     LOG_INFO << "replacing current search with " << searchText;
-    // Interrupt the search if it's ongoing
-    logFilteredData_->interruptSearch();
-
-    // We have to wait for the last search update (100%)
-    // before clearing/restarting to avoid having remaining results.
-
-    // FIXME: this is a bit of a hack, we call processEvents
-    // for Qt to empty its event queue, including (hopefully)
-    // the search update event sent by logFilteredData_. It saves
-    // us the overhead of having proper sync.
-    QApplication::processEvents( QEventLoop::ExcludeUserInputEvents );
-
-    nbMatches_ = 0_lcount;
-
-    // Switch to "Marks and matches" view when in "Marks" view
-    using VisibilityFlags = LogFilteredData::VisibilityFlags;
-    if ( !filteredView_->visibility().testFlag( VisibilityFlags::Matches ) ) {
-        visibilityBox_->setCurrentIndex( 0 );
-    }
-
-    // Clear and recompute the content of the filtered window.
-    logFilteredData_->clearSearch();
-    filteredView_->updateData();
-
-    // Update the match overview
-    overview_.updateData( logData_->getNbLine() );
+    clearCurrentSearch();
 
     if ( !searchText.isEmpty() ) {
 
         // Constructs the regexp
-        auto regexpPattern = RegularExpressionPattern(
-            searchText, matchCaseButton_->isChecked(), inverseButton_->isChecked(),
-            booleanButton_->isChecked(), !useRegexpButton_->isChecked() );
-
-        RegularExpression hsExpression{ regexpPattern };
-        auto isValidExpression = hsExpression.isValid();
+        const auto regexpPattern = searchPattern( searchText );
+
+        // Pattern typed on the search line has usually been compiled in the background
+        auto validation = patternValidator_.result( regexpPattern );
+        if ( !validation ) {
+            const RegularExpression hsExpression{ regexpPattern };
+            validation = PatternValidator::Result{ regexpPattern, hsExpression.isValid(),
+                                                   hsExpression.errorString() };
+        }
+        const auto isValidExpression = validation->isValid;
 
         if ( isValidExpression ) {
-            // Activate the stop button
-            stopButton_->setEnabled( true );
-            stopButton_->show();
-            clearButton_->hide();
-            searchButton_->hide();
-            // Start a new asynchronous search
-            logFilteredData_->runSearch( regexpPattern, searchStartLine_, searchEndLine_ );
-            // Accept auto-refresh of the search
-            searchState_.startSearch();
-            searchInfoLine_->hide();
-            logMainView_->setSearchPattern( regexpPattern );
-            filteredView_->setSearchPattern( regexpPattern );
+            runCurrentSearch( regexpPattern, countOnly );
         }
         else {
             // The regexp is wrong
@@ -1540,7 +2884,7 @@ void CrawlerWidget::replaceCurrentSearch( const QString& searchText )
             searchState_.resetState();
 
             // Inform the user
-            QString errorString = hsExpression.errorString();
+            QString errorString = validation->errorString;
             QString errorMessage = tr( "Error in expression" );
             // const int offset = regexp.patternErrorOffset();
             // if ( offset != -1 ) {
@@ -1559,10 +2903,69 @@ void CrawlerWidget::replaceCurrentSearch( const QString& searchText )
     }
     else {
         searchState_.resetState();
+        isSearchFollowingLoading_ = false;
         printSearchInfoMessage();
     }
 }
 
+void CrawlerWidget::clearCurrentSearch()
+{
+    // Interrupt the search if it's ongoing
+    logFilteredData_->interruptSearch();
+
+    // We have to wait for the last search update (100%)
+    // before clearing/restarting to avoid having remaining results.
+
+    // FIXME: this is a bit of a hack, we call processEvents
+    // for Qt to empty its event queue, including (hopefully)
+    // the search update event sent by logFilteredData_. It saves
+    // us the overhead of having proper sync.
+    QApplication::processEvents( QEventLoop::ExcludeUserInputEvents );
+
+    nbMatches_ = 0_lcount;
+
+    // Switch to "Marks and matches" view when in "Marks" view
+    using VisibilityFlags = LogFilteredData::VisibilityFlags;
+    if ( !filteredView_->visibility().testFlag( VisibilityFlags::Matches ) ) {
+        visibilityBox_->setCurrentIndex( 0 );
+    }
+
+    // Clear and recompute the content of the filtered window.
+    logFilteredData_->clearSearch();
+    filteredView_->updateData();
+
+    // Update the match overview
+    overview_.updateData( logData_->getNbLine() );
+    timeHistogram_->setHistogram( {} );
+}
+
+void CrawlerWidget::runCurrentSearch( const RegularExpressionPattern& regexpPattern,
+                                      bool countOnly )
+{
+    // Activate the stop button
+    stopButton_->setEnabled( true );
+    stopButton_->show();
+    clearButton_->hide();
+    searchButton_->hide();
+    // Start a new asynchronous search
+    // Matches near the shown lines, or the end of file when following, come first
+    if ( countOnly ) {
+        logFilteredData_->runCount( regexpPattern, searchStartLine_, searchEndLine_,
+                                    OverviewBuckets );
+    }
+    else {
+        logFilteredData_->runSearch( regexpPattern, searchStartLine_, searchEndLine_,
+                                     logMainView_->getTopLine() );
+    }
+    isSearchRunning_ = true;
+    isSearchFollowingLoading_ = loadingInProgress_ && !loadingPreviewShown_;
+    // Accept auto-refresh of the search
+    searchState_.startSearch();
+    searchInfoLine_->hide();
+    logMainView_->setSearchPattern( regexpPattern );
+    filteredView_->setSearchPattern( regexpPattern );
+}
+
 // Updates the content of the drop down list for the saved searches,
 // called when the SavedSearch has been changed.
 void CrawlerWidget::updateSearchCombo()
@@ -1593,6 +2996,9 @@ void CrawlerWidget::printSearchInfoMessage( LinesCount nbMatches )
         // Some languages translate the plural the same as the singular, so use the full string
         text = nbMatches.get() > 1 ? tr( "%1 matches found" ).arg( nbMatches.get() )
                                    : tr( "%1 match found" ).arg( nbMatches.get() );
+        if ( logFilteredData_->searchedLines() ) {
+            text += searchedLinesText_;
+        }
         break;
     case SearchState::FileTruncated:
     case SearchState::TruncatedAutorefreshing:
@@ -1616,6 +3022,13 @@ void CrawlerWidget::changeDataStatus( DataStatus status )
     }
 }
 
+RegularExpressionPattern CrawlerWidget::searchPattern( const QString& searchText ) const
+{
+    return RegularExpressionPattern( searchText, matchCaseButton_->isChecked(),
+                                     inverseButton_->isChecked(), booleanButton_->isChecked(),
+                                     !useRegexpButton_->isChecked() );
+}
+
 // Determine the right encoding and set the views.
 void CrawlerWidget::updateEncoding()
 {
@@ -1633,9 +3046,19 @@ void CrawlerWidget::updateEncoding()
     QString encodingPrefix = encodingMib_ ? tr( "Displayed as %1" ) : tr( "Detected as %1" );
     encodingText_ = encodingPrefix.arg( textCodec->name().constData() );
 
+    // Encoding is set again each time loading finishes,
+    // lines found by quick find and filter statistics stay valid if it is the same
+    const auto* currentCodec = logData_->getDisplayEncoding();
+    const auto isEncodingChanged
+        = currentCodec == nullptr || currentCodec->mibEnum() != textCodec->mibEnum();
+
     logData_->interruptLoading();
 
     logData_->setDisplayEncoding( textCodec->name().constData() );
+    if ( isEncodingChanged ) {
+        logMainView_->truncateQuickFindIndex( 0_lnum );
+        resetPredefinedFiltersMatchCounts();
+    }
     logMainView_->forceRefresh();
     logFilteredData_->setDisplayEncoding( textCodec->name().constData() );
     filteredView_->forceRefresh();
@@ -18,6 +18,7 @@
  */
 
 #include <memory>
+#include <optional>
 
 #include <QFileInfo>
 #include <QMimeDatabase>
@@ -28,6 +29,7 @@
 #include <ktar.h>
 #include <kzip.h>
 
+#include "framedaccess.h"
 #include "log.h"
 
 #include "decompressor.h"
@@ -217,7 +219,7 @@ bool doDecompress( std::shared_ptr<KCompressionDevice> input, const QString& arc
             QByteArray data = input->read( 4 * 1024 * 1024 );
             if ( data.size() > 0 ) {
                 const auto writtenBytes = outputFile->write( data );
-                if ( writtenBytes < 0 ) {
+                if ( writtenBytes < 0 || !outputFile->flush() ) {
                     LOG_ERROR << "Error decompressing " << archiveFilePath;
                     success = false;
                     break;
@@ -234,6 +236,53 @@ bool doDecompress( std::shared_ptr<KCompressionDevice> input, const QString& arc
     return success;
 }
 
+// Empty if the file is not made of frames, nothing is written then
+std::optional<bool> doDecompressFrames( std::shared_ptr<FramedAccess> access,
+                                        const QString& archiveFilePath, QFile* outputFile,
+                                        AtomicFlag& interrupt )
+{
+    QFile input( archiveFilePath );
+    if ( !input.open( QIODevice::ReadOnly ) ) {
+        LOG_WARNING << "Cannot open " << archiveFilePath;
+        return false;
+    }
+
+    const auto readCompressed = [ &input ]( qint64 offset, char* data, qint64 size ) {
+        return input.seek( offset ) ? input.read( data, size ) : qint64{ -1 };
+    };
+    // Frames are only looked for, access to other files would decompress them once more
+    if ( !access->FramedAccess::build( readCompressed, input.size() ) ) {
+        LOG_INFO << "Cannot read frames of " << archiveFilePath;
+        return {};
+    }
+
+    // Sequential reads decompress the frames ahead of them in parallel
+    auto reader = access->makeReader( readCompressed );
+    QByteArray data( 4 * 1024 * 1024, Qt::Uninitialized );
+
+    bool success = true;
+    for ( qint64 offset = 0; offset < access->size(); ) {
+        if ( interrupt ) {
+            success = false;
+            LOG_INFO << "Interrupted decompress of " << archiveFilePath;
+            break;
+        }
+
+        const auto readBytes = reader->read( offset, data.data(), data.size() );
+        if ( readBytes <= 0 || outputFile->write( data.constData(), readBytes ) < 0
+             || !outputFile->flush() ) {
+            LOG_ERROR << "Error decompressing " << archiveFilePath;
+            success = false;
+            break;
+        }
+        offset += readBytes;
+    }
+
+    outputFile->close();
+
+    return success;
+}
+
 } // namespace
 
 Decompressor::Decompressor( QObject* parent )
@@ -245,6 +294,12 @@ Decompressor::Decompressor( QObject* parent )
     } );
 }
 
+Decompressor::~Decompressor()
+{
+    interrupt_.set();
+    future_.waitForFinished();
+}
+
 bool Decompressor::waitForResult()
 {
     return watcher_.result();
@@ -271,6 +326,27 @@ DecompressAction Decompressor::action( const QString& archiveFilePath )
 bool Decompressor::decompress( const QString& archiveFilePath, QFile* outputFile,
                                AtomicFlag& interrupt )
 {
+    // Independent members of BGZF files are decompressed in parallel
+    auto framedAccess
+        = std::dynamic_pointer_cast<FramedAccess>( CompressedAccess::create( archiveFilePath ) );
+    if ( framedAccess ) {
+        future_ = QtConcurrent::run( [ access = std::move( framedAccess ), archiveFilePath,
+                                       outputFile, &interrupt ] {
+            if ( const auto result
+                 = doDecompressFrames( access, archiveFilePath, outputFile, interrupt ) ) {
+                return *result;
+            }
+
+            // Members after the first one are not all frames
+            auto decompressor = makeDecompressor( archiveType( archiveFilePath ), archiveFilePath );
+            return decompressor != nullptr
+                   && doDecompress( decompressor, archiveFilePath, outputFile, interrupt );
+        } );
+        watcher_.setFuture( future_ );
+
+        return true;
+    }
+
     auto decompressor = makeDecompressor( archiveType( archiveFilePath ), archiveFilePath );
     if ( !decompressor ) {
         LOG_WARNING << "Unsupported archive " << archiveFilePath.constData();
@@ -286,6 +362,11 @@ bool Decompressor::decompress( const QString& archiveFilePath, QFile* outputFile
     return true;
 }
 
+bool Decompressor::decompress( const QString& archiveFilePath, QFile* outputFile )
+{
+    return decompress( archiveFilePath, outputFile, interrupt_ );
+}
+
 bool Decompressor::extract( const QString& archiveFilePath, const QString& destination,
                             AtomicFlag& interrupt )
 {
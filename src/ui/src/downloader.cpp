@@ -80,5 +80,7 @@ void Downloader::downloadFinished()
 
 void Downloader::downloadReadyRead()
 {
+    // Data is flushed for the log reading the file while it is downloaded
     output_->write( currentDownload_->readAll() );
+    output_->flush();
 }
\ No newline at end of file
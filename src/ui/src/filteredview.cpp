@@ -43,6 +43,7 @@
 #include <cassert>
 
 #include "filteredview.h"
+#include "logdata.h"
 #include "shortcuts.h"
 
 FilteredView::FilteredView( LogFilteredData* newLogData,
@@ -76,12 +77,28 @@ AbstractLogData::LineType FilteredView::lineType( LineNumber lineNumber ) const
     return logFilteredData_->lineTypeByIndex( lineNumber );
 }
 
+klogg::vector<AbstractLogData::LineType> FilteredView::lineTypes( LineNumber first,
+                                                                  LinesCount number ) const
+{
+    return logFilteredData_->lineTypesByIndex( first, number );
+}
+
 LineNumber FilteredView::displayLineNumber( LineNumber lineNumber ) const
 {
     // Display a 1-based index
     return logFilteredData_->getMatchingLineNumber( lineNumber ) + 1_lcount;
 }
 
+klogg::vector<LineNumber> FilteredView::displayLineNumbers( LineNumber first,
+                                                            LinesCount number ) const
+{
+    auto lineNumbers = logFilteredData_->getMatchingLineNumbers( first, number );
+    for ( auto& lineNumber : lineNumbers ) {
+        lineNumber = lineNumber + 1_lcount;
+    }
+    return lineNumbers;
+}
+
 LineNumber FilteredView::lineIndex( LineNumber lineNumber ) const
 {
     return logFilteredData_->getLineIndexNumber( lineNumber );
@@ -92,6 +109,17 @@ LineNumber FilteredView::maxDisplayLineNumber() const
     return LineNumber( logFilteredData_->getNbTotalLines().get() );
 }
 
+const AbstractLogData* FilteredView::sourceData() const
+{
+    return logFilteredData_->getSourceLogData();
+}
+
+klogg::vector<LineNumber> FilteredView::sourceLineNumbers( LineNumber first,
+                                                           LinesCount number ) const
+{
+    return logFilteredData_->getMatchingLineNumbers( first, number );
+}
+
 void FilteredView::doRegisterShortcuts()
 {
     LOG_INFO << "Registering shortcuts for filtered view";
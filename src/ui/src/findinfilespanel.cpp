@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "findinfilespanel.h"
+
+#include <QCheckBox>
+#include <QDirIterator>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <QtConcurrent>
+
+#include "log.h"
+#include "regularexpressionpattern.h"
+
+namespace {
+constexpr int OffsetRole = Qt::UserRole;
+constexpr int FileNameRole = Qt::UserRole + 1;
+} // namespace
+
+FindInFilesPanel::FindInFilesPanel( QWidget* parent )
+    : QWidget( parent )
+{
+    patternEdit_ = new QLineEdit;
+    patternEdit_->setPlaceholderText( tr( "Pattern" ) );
+    ignoreCaseCheck_ = new QCheckBox( tr( "Ignore case" ) );
+    plainTextCheck_ = new QCheckBox( tr( "Plain text" ) );
+    booleanCheck_ = new QCheckBox( tr( "Boolean" ) );
+    findButton_ = new QPushButton( tr( "Find" ) );
+    findButton_->setDefault( true );
+    stopButton_ = new QPushButton( tr( "Stop" ) );
+    stopButton_->setEnabled( false );
+
+    auto* patternLayout = new QHBoxLayout;
+    patternLayout->addWidget( patternEdit_, 1 );
+    patternLayout->addWidget( ignoreCaseCheck_ );
+    patternLayout->addWidget( plainTextCheck_ );
+    patternLayout->addWidget( booleanCheck_ );
+    patternLayout->addWidget( findButton_ );
+    patternLayout->addWidget( stopButton_ );
+
+    auto* addFilesButton = new QPushButton( tr( "Add files..." ) );
+    auto* addFolderButton = new QPushButton( tr( "Add folder..." ) );
+    nameFilterEdit_ = new QLineEdit( "*.log*" );
+    nameFilterEdit_->setToolTip( tr( "Names of the files added from folders, e.g. *.log *.txt" ) );
+    auto* clearButton = new QPushButton( tr( "Clear" ) );
+
+    auto* filesLayout = new QHBoxLayout;
+    filesLayout->addWidget( addFilesButton );
+    filesLayout->addWidget( addFolderButton );
+    filesLayout->addWidget( nameFilterEdit_, 1 );
+    filesLayout->addWidget( clearButton );
+
+    resultsTree_ = new QTreeWidget;
+    resultsTree_->setHeaderLabels( { tr( "File" ), tr( "Matches" ) } );
+    resultsTree_->setMinimumSize( 600, 400 );
+    resultsTree_->header()->setSectionResizeMode( 0, QHeaderView::Stretch );
+    resultsTree_->header()->setSectionResizeMode( 1, QHeaderView::ResizeToContents );
+    resultsTree_->header()->setStretchLastSection( false );
+    resultsTree_->setSortingEnabled( true );
+    resultsTree_->sortByColumn( 1, Qt::DescendingOrder );
+
+    statusLabel_ = new QLabel;
+
+    auto* layout = new QVBoxLayout;
+    layout->addLayout( patternLayout );
+    layout->addLayout( filesLayout );
+    layout->addWidget( resultsTree_ );
+    layout->addWidget( statusLabel_ );
+    this->setLayout( layout );
+
+    connect( addFilesButton, &QPushButton::clicked, this, &FindInFilesPanel::addFiles );
+    connect( addFolderButton, &QPushButton::clicked, this, &FindInFilesPanel::addFolder );
+    connect( clearButton, &QPushButton::clicked, this, &FindInFilesPanel::clearFiles );
+    connect( findButton_, &QPushButton::clicked, this, &FindInFilesPanel::startSearch );
+    connect( patternEdit_, &QLineEdit::returnPressed, this, &FindInFilesPanel::startSearch );
+    connect( stopButton_, &QPushButton::clicked, this, &FindInFilesPanel::stopSearch );
+    connect( resultsTree_, &QTreeWidget::itemActivated, this,
+             [ this ]( QTreeWidgetItem* item ) { openItem( item ); } );
+
+    updateStatus();
+}
+
+FindInFilesPanel::~FindInFilesPanel()
+{
+    stopSearch();
+    searchFuture_.waitForFinished();
+}
+
+void FindInFilesPanel::addFiles()
+{
+    const auto fileNames = QFileDialog::getOpenFileNames( this, tr( "Add files" ) );
+    for ( const auto& fileName : fileNames ) {
+        if ( !fileNames_.contains( fileName ) ) {
+            fileNames_.append( fileName );
+        }
+    }
+    updateStatus();
+}
+
+void FindInFilesPanel::addFolder()
+{
+    const auto folder = QFileDialog::getExistingDirectory( this, tr( "Add folder" ) );
+    if ( folder.isEmpty() ) {
+        return;
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK( 5, 15, 0 )
+    const auto nameFilters = nameFilterEdit_->text().split( ' ', Qt::SkipEmptyParts );
+#else
+    const auto nameFilters = nameFilterEdit_->text().split( ' ', QString::SkipEmptyParts );
+#endif
+    QDirIterator files( folder, nameFilters, QDir::Files | QDir::Readable,
+                        QDirIterator::Subdirectories );
+    while ( files.hasNext() ) {
+        const auto fileName = files.next();
+        if ( !fileNames_.contains( fileName ) ) {
+            fileNames_.append( fileName );
+        }
+    }
+    updateStatus();
+}
+
+void FindInFilesPanel::clearFiles()
+{
+    stopSearch();
+    fileNames_.clear();
+    resultsTree_->clear();
+    nbSearched_ = 0;
+    nbWithMatches_ = 0;
+    nbMatches_ = 0;
+    updateStatus();
+}
+
+void FindInFilesPanel::startSearch()
+{
+    if ( patternEdit_->text().isEmpty() || fileNames_.isEmpty() ) {
+        return;
+    }
+
+    auto findInFiles = std::make_shared<const FindInFiles>( RegularExpressionPattern{
+        patternEdit_->text(), !ignoreCaseCheck_->isChecked(), false, booleanCheck_->isChecked(),
+        plainTextCheck_->isChecked() } );
+    if ( !findInFiles->isValid() ) {
+        statusLabel_->setText( tr( "Invalid pattern: %1" ).arg( findInFiles->errorString() ) );
+        return;
+    }
+
+    stopSearch();
+
+    resultsTree_->clear();
+    nbSearched_ = 0;
+    nbWithMatches_ = 0;
+    nbMatches_ = 0;
+
+    const auto searchId = ++searchId_;
+    interruptRequested_ = std::make_shared<std::atomic<bool>>( false );
+
+    LOG_INFO << "Find in " << fileNames_.size() << " files started";
+
+    klogg::vector<QString> fileNames( fileNames_.begin(), fileNames_.end() );
+    searchFuture_ = QtConcurrent::run(
+        [ this, searchId, findInFiles = std::move( findInFiles ),
+          fileNames = std::move( fileNames ), interrupt = interruptRequested_ ] {
+            findInFiles->run(
+                fileNames,
+                [ this, searchId ]( FindInFiles::FileMatches matches ) {
+                    // Calls posted to the panel are dropped if it is destroyed
+                    QMetaObject::invokeMethod(
+                        this,
+                        [ this, searchId, matches = std::move( matches ) ] {
+                            addFileMatches( searchId, matches );
+                        },
+                        Qt::QueuedConnection );
+                },
+                *interrupt );
+
+            QMetaObject::invokeMethod(
+                this, [ this, searchId ] { searchFinished( searchId ); },
+                Qt::QueuedConnection );
+        } );
+
+    findButton_->setEnabled( false );
+    stopButton_->setEnabled( true );
+    updateStatus();
+}
+
+void FindInFilesPanel::stopSearch()
+{
+    if ( interruptRequested_ ) {
+        interruptRequested_->store( true );
+    }
+}
+
+void FindInFilesPanel::addFileMatches( uint64_t searchId, const FindInFiles::FileMatches& matches )
+{
+    if ( searchId != searchId_ ) {
+        return;
+    }
+
+    nbSearched_++;
+
+    if ( !matches.error.isEmpty() ) {
+        LOG_WARNING << "Find in " << matches.fileName.toStdString() << ": "
+                    << matches.error.toStdString();
+    }
+
+    if ( matches.nbMatches == 0 && matches.error.isEmpty() ) {
+        updateStatus();
+        return;
+    }
+
+    auto* fileItem = new QTreeWidgetItem;
+    fileItem->setText( 0, QDir::toNativeSeparators( matches.fileName ) );
+    fileItem->setData( 0, FileNameRole, matches.fileName );
+    fileItem->setData( 0, OffsetRole, qint64{ -1 } );
+    if ( matches.error.isEmpty() ) {
+        fileItem->setData( 1, Qt::DisplayRole, static_cast<qulonglong>( matches.nbMatches ) );
+        fileItem->setToolTip( 0, tr( "%1 lines" ).arg( matches.nbLines ) );
+    }
+    else {
+        fileItem->setText( 1, matches.error );
+    }
+
+    for ( const auto& match : matches.firstMatches ) {
+        auto* matchItem = new QTreeWidgetItem( fileItem );
+        matchItem->setText( 0, QString( "%1: %2" ).arg( match.line.get() + 1 ).arg( match.text ) );
+        matchItem->setData( 0, FileNameRole, matches.fileName );
+        matchItem->setData( 0, OffsetRole, match.offset );
+    }
+
+    resultsTree_->addTopLevelItem( fileItem );
+
+    nbWithMatches_ += matches.nbMatches > 0 ? 1 : 0;
+    nbMatches_ += matches.nbMatches;
+    updateStatus();
+}
+
+void FindInFilesPanel::searchFinished( uint64_t searchId )
+{
+    if ( searchId != searchId_ ) {
+        return;
+    }
+
+    LOG_INFO << "Find in files finished, " << nbSearched_ << " files searched";
+
+    interruptRequested_.reset();
+    findButton_->setEnabled( true );
+    stopButton_->setEnabled( false );
+    updateStatus();
+}
+
+void FindInFilesPanel::updateStatus()
+{
+    if ( interruptRequested_ || nbSearched_ > 0 ) {
+        statusLabel_->setText( tr( "%1 of %2 files searched, %3 matches in %4 files" )
+                                   .arg( nbSearched_ )
+                                   .arg( fileNames_.size() )
+                                   .arg( nbMatches_ )
+                                   .arg( nbWithMatches_ ) );
+    }
+    else {
+        statusLabel_->setText( tr( "%1 files to search" ).arg( fileNames_.size() ) );
+    }
+}
+
+void FindInFilesPanel::openItem( QTreeWidgetItem* item )
+{
+    const auto fileName = item->data( 0, FileNameRole ).toString();
+    if ( fileName.isEmpty() ) {
+        return;
+    }
+
+    Q_EMIT openFileRequested( fileName, item->data( 0, OffsetRole ).toLongLong() );
+}
@@ -38,22 +38,48 @@
 
 // This file implements classes Highlighter and HighlighterSet
 
+#include <algorithm>
 #include <iterator>
 #include <qcolor.h>
 #include <qnamespace.h>
 #include <random>
+#include <string>
+#include <string_view>
 #include <utility>
+#include <variant>
 
 #include <QSettings>
 
 #include "crc32.h"
 #include "highlightersetedit.h"
+#include "hsregularexpression.h"
 #include "linetypes.h"
 #include "log.h"
+#include "synchronization.h"
 #include "uuid.h"
+#include "xxhash.h"
 
 #include "highlighterset.h"
 
+// Matcher of the combined set is used by one thread at a time, jobs on
+// the thread pool make their own matchers of the same compiled expression
+struct HighlighterSet::Matcher {
+    explicit Matcher( std::shared_ptr<const HsRegularExpression> hsExpression )
+        : expression( std::move( hsExpression ) )
+        , matcher( expression->createMatcher() )
+    {
+    }
+
+    std::shared_ptr<const HsRegularExpression> expression;
+    Mutex mutex;
+    MatcherVariant matcher;
+};
+
+namespace {
+// Varied colors kept for a highlighter, all are dropped beyond it
+constexpr size_t MaxVariedColors = 16 * 1024;
+} // namespace
+
 QRegularExpression::PatternOptions getPatternOptions( bool ignoreCase )
 {
     QRegularExpression::PatternOptions options = QRegularExpression::UseUnicodePropertiesOption;
@@ -70,6 +96,8 @@ Highlighter::Highlighter( const QString& pattern, bool ignoreCase, bool onlyMatc
     , highlightOnlyMatch_( onlyMatch )
     , color_{ foreColor, backColor }
 {
+    updateMatchingRegex();
+
     LOG_DEBUG << "New Highlighter, fore: " << color_.foreColor.name()
               << " back: " << color_.backColor.name();
 }
@@ -82,6 +110,7 @@ QString Highlighter::pattern() const
 void Highlighter::setPattern( const QString& pattern )
 {
     regexp_.setPattern( pattern );
+    updateMatchingRegex();
 }
 
 bool Highlighter::ignoreCase() const
@@ -92,6 +121,7 @@ bool Highlighter::ignoreCase() const
 void Highlighter::setIgnoreCase( bool ignoreCase )
 {
     regexp_.setPatternOptions( getPatternOptions( ignoreCase ) );
+    updateMatchingRegex();
 }
 
 bool Highlighter::useRegex() const
@@ -102,6 +132,7 @@ bool Highlighter::useRegex() const
 void Highlighter::setUseRegex( bool useRegex )
 {
     useRegex_ = useRegex;
+    updateMatchingRegex();
 }
 
 bool Highlighter::highlightOnlyMatch() const
@@ -131,6 +162,7 @@ int Highlighter::colorVariance() const
 void Highlighter::setColorVariance( int colorVariance )
 {
     colorVariance_ = colorVariance;
+    variedColors_ = std::make_shared<VariedColors>();
 }
 
 const QColor& Highlighter::foreColor() const
@@ -141,6 +173,7 @@ const QColor& Highlighter::foreColor() const
 void Highlighter::setForeColor( const QColor& foreColor )
 {
     color_.foreColor = foreColor;
+    variedColors_ = std::make_shared<VariedColors>();
 }
 
 const QColor& Highlighter::backColor() const
@@ -151,6 +184,7 @@ const QColor& Highlighter::backColor() const
 void Highlighter::setBackColor( const QColor& backColor )
 {
     color_.backColor = backColor;
+    variedColors_ = std::make_shared<VariedColors>();
 }
 
 std::pair<QColor, QColor> Highlighter::vairateColors( const QString& match ) const
@@ -159,29 +193,61 @@ std::pair<QColor, QColor> Highlighter::vairateColors( const QString& match ) con
         return std::make_pair( color_.foreColor, color_.backColor );
     }
 
+    const auto matchHash = XXH3_64bits( match.constData(),
+                                        static_cast<size_t>( match.size() ) * sizeof( QChar ) );
+    {
+        SharedLock lock( variedColors_->mutex );
+        const auto colors = variedColors_->colors.find( matchHash );
+        if ( colors != variedColors_->colors.end() ) {
+            return colors->second;
+        }
+    }
+
+    // Colors stay the ones derived from the CRC of the UTF-8 text
     std::uniform_int_distribution<int> colorDistribution( 100 - colorVariance_,
                                                           100 + colorVariance_ );
 
     std::minstd_rand0 generator( Crc32::calculate( match.toUtf8() ) );
     const auto factor = colorDistribution( generator );
 
-    return std::make_pair( color_.foreColor.darker( factor ), color_.backColor.darker( factor ) );
+    const auto colors
+        = std::make_pair( color_.foreColor.darker( factor ), color_.backColor.darker( factor ) );
+
+    UniqueLock lock( variedColors_->mutex );
+    if ( variedColors_->colors.size() >= MaxVariedColors ) {
+        variedColors_->colors.clear();
+    }
+    variedColors_->colors.emplace( matchHash, colors );
+    return colors;
 }
 
-bool Highlighter::matchLine( const QString& line, klogg::vector<HighlightedMatch>& matches ) const
+bool Highlighter::operator==( const Highlighter& other ) const
 {
-    matches.clear();
+    return regexp_ == other.regexp_ && useRegex_ == other.useRegex_
+           && highlightOnlyMatch_ == other.highlightOnlyMatch_
+           && variateColors_ == other.variateColors_ && colorVariance_ == other.colorVariance_
+           && color_.foreColor == other.color_.foreColor
+           && color_.backColor == other.color_.backColor;
+}
 
+void Highlighter::updateMatchingRegex()
+{
     const auto pattern
         = useRegex_ ? regexp_.pattern() : QRegularExpression::escape( regexp_.pattern() );
 
-    const auto matchingRegex = QRegularExpression( pattern, regexp_.patternOptions() );
+    matchingRegex_ = QRegularExpression( pattern, regexp_.patternOptions() );
+}
+
+bool Highlighter::matchLine( const QString& line, klogg::vector<HighlightedMatch>& matches ) const
+{
+    matches.clear();
 
-    QRegularExpressionMatchIterator matchIterator = matchingRegex.globalMatch( line );
+    const auto captureCount = matchingRegex_.captureCount();
+    QRegularExpressionMatchIterator matchIterator = matchingRegex_.globalMatch( line );
 
     while ( matchIterator.hasNext() ) {
         QRegularExpressionMatch match = matchIterator.next();
-        if ( matchingRegex.captureCount() > 0 ) {
+        if ( captureCount > 0 ) {
             matches.reserve( static_cast<size_t>( match.lastCapturedIndex() ) );
             for ( int i = 1; i <= match.lastCapturedIndex(); ++i ) {
 
@@ -230,11 +296,86 @@ bool HighlighterSet::isEmpty() const
     return highlighterList_.isEmpty();
 }
 
+bool HighlighterSet::operator==( const HighlighterSet& other ) const
+{
+    return name_ == other.name_ && id_ == other.id_ && highlighterList_ == other.highlighterList_;
+}
+
+bool HighlighterSet::hasSamePatterns( const HighlighterSet& other ) const
+{
+    return std::equal( highlighterList_.begin(), highlighterList_.end(),
+                       other.highlighterList_.begin(), other.highlighterList_.end(),
+                       []( const Highlighter& lhs, const Highlighter& rhs ) {
+                           return lhs.pattern() == rhs.pattern()
+                                  && lhs.ignoreCase() == rhs.ignoreCase()
+                                  && lhs.useRegex() == rhs.useRegex();
+                       } );
+}
+
+void HighlighterSet::compileMatcher()
+{
+    matcher_.reset();
+
+#ifdef KLOGG_HAS_HS
+    if ( highlighterList_.isEmpty() ) {
+        return;
+    }
+
+    klogg::vector<RegularExpressionPattern> patterns;
+    patterns.reserve( static_cast<size_t>( highlighterList_.size() ) );
+    for ( const auto& highlighter : qAsConst( highlighterList_ ) ) {
+        patterns.emplace_back( highlighter.pattern(), !highlighter.ignoreCase(), false, false,
+                               !highlighter.useRegex() );
+    }
+
+    auto expression = std::make_shared<const HsRegularExpression>( patterns );
+    if ( !expression->isValid() ) {
+        return;
+    }
+
+    // Without Hyperscan this would be one more regex pass over the line
+    auto matcher = std::make_shared<Matcher>( std::move( expression ) );
+    const auto isHsMatcher = std::holds_alternative<HsSingleMatcher>( matcher->matcher )
+                             || std::holds_alternative<HsMultiMatcher>( matcher->matcher )
+                             || std::holds_alternative<HsMixedMatcher>( matcher->matcher );
+    if ( isHsMatcher ) {
+        matcher_ = std::move( matcher );
+    }
+#endif
+}
+
+HighlighterSet HighlighterSet::withOwnMatcher() const
+{
+    auto set = *this;
+    if ( matcher_ ) {
+        set.matcher_ = std::make_shared<Matcher>( matcher_->expression );
+    }
+    return set;
+}
+
 HighlighterMatchType HighlighterSet::matchLine( const QString& line,
                                                 klogg::vector<HighlightedMatch>& matches ) const
 {
+    // Spans are found only for highlighters matching the line
+    std::string matchedHighlighters;
+    if ( matcher_ ) {
+        const auto utf8Line = line.toUtf8();
+        ScopedLock lock( matcher_->mutex );
+        matchedHighlighters = std::string{ std::visit(
+            [ &utf8Line ]( const auto& matcher ) {
+                return matcher.match( std::string_view{ utf8Line.constData(),
+                                                        static_cast<size_t>( utf8Line.size() ) } );
+            },
+            matcher_->matcher ) };
+    }
+
     auto matchType = HighlighterMatchType::NoMatch;
     for ( auto hl = highlighterList_.rbegin(); hl != highlighterList_.rend(); ++hl ) {
+        const auto index = static_cast<size_t>( std::distance( hl, highlighterList_.rend() ) - 1 );
+        if ( index < matchedHighlighters.size() && matchedHighlighters[ index ] == 0 ) {
+            continue;
+        }
+
         klogg::vector<HighlightedMatch> thisMatches;
         if ( !hl->matchLine( line, thisMatches ) ) {
             continue;
@@ -288,10 +429,12 @@ void Highlighter::retrieveFromStorage( QSettings& settings )
         getPatternOptions( settings.value( "ignore_case", false ).toBool() ) );
     highlightOnlyMatch_ = settings.value( "match_only", false ).toBool();
     useRegex_ = settings.value( "use_regex", true ).toBool();
+    updateMatchingRegex();
     variateColors_ = settings.value( "variate_colors", false ).toBool();
     colorVariance_ = settings.value( "color_variance", 15 ).toInt();
     color_.foreColor = QColor( settings.value( "fore_colour" ).toString() );
     color_.backColor = QColor( settings.value( "back_colour" ).toString() );
+    variedColors_ = std::make_shared<VariedColors>();
 }
 
 void HighlighterSet::saveToStorage( QSettings& settings ) const
@@ -389,6 +532,14 @@ HighlighterSet HighlighterSetCollection::currentActiveSet() const
         combinedSet.highlighterList_.append( set.highlighterList_ );
     }
 
+    if ( combinedSet.hasSamePatterns( activeSet_ ) ) {
+        combinedSet.matcher_ = activeSet_.matcher_;
+    }
+    else {
+        combinedSet.compileMatcher();
+    }
+
+    activeSet_ = combinedSet;
     return combinedSet;
 }
 
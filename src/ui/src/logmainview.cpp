@@ -79,6 +79,21 @@ AbstractLogData::LineType LogMainView::lineType( LineNumber lineNumber ) const
     return AbstractLogData::LineTypeFlags::Plain;
 }
 
+klogg::vector<AbstractLogData::LineType> LogMainView::lineTypes( LineNumber first,
+                                                                 LinesCount number ) const
+{
+    if ( filteredData_ ) {
+        return filteredData_->lineTypesByLine( first, number );
+    }
+    return klogg::vector<AbstractLogData::LineType>( number.get(),
+                                                     AbstractLogData::LineTypeFlags::Plain );
+}
+
+bool LogMainView::isDataAppendOnly() const
+{
+    return true;
+}
+
 void LogMainView::doRegisterShortcuts()
 {
     LOG_INFO << "Registering shortcuts for main view";
@@ -66,6 +66,7 @@
 #include <QMenuBar>
 #include <QMessageBox>
 #include <QMimeData>
+#include <QMimeDatabase>
 #include <QProgressDialog>
 #include <QResource>
 #include <QScreen>
@@ -75,6 +76,7 @@
 #include <QTemporaryFile>
 #include <QTextBrowser>
 #include <QToolBar>
+#include <QTreeWidget>
 #include <QUrl>
 #include <QUrlQuery>
 #include <QWindow>
@@ -87,17 +89,21 @@
 #include "downloader.h"
 #include "encodings.h"
 #include "favoritefiles.h"
+#include "filewatcher.h"
+#include "compressedaccess.h"
 #include "highlightersdialog.h"
 #include "highlightersmenu.h"
 #include "issuereporter.h"
 #include "klogg_version.h"
 #include "logger.h"
 #include "mainwindowtext.h"
+#include "mergedaccess.h"
 #include "openfilehelper.h"
 #include "optionsdialog.h"
 #include "predefinedfiltersdialog.h"
 #include "progress.h"
 #include "readablesize.h"
+#include "regularexpression.h"
 #include "recentfiles.h"
 #include "sessioninfo.h"
 #include "shortcuts.h"
@@ -193,6 +199,22 @@ MainWindow::MainWindow( WindowSession session )
     scratchPad_.setWindowIcon( mainIcon_ );
     scratchPad_.setWindowTitle( tr( "klogg - scratchpad" ) );
 
+    performancePanel_.setWindowIcon( mainIcon_ );
+    performancePanel_.setWindowTitle( tr( "klogg - performance" ) );
+
+    findInFilesPanel_.setWindowIcon( mainIcon_ );
+    findInFilesPanel_.setWindowTitle( tr( "klogg - find in files" ) );
+    connect( &findInFilesPanel_, &FindInFilesPanel::openFileRequested, this,
+             [ this ]( const QString& fileName, qint64 offset ) {
+                 if ( !loadFile( fileName ) || offset < 0 ) {
+                     return;
+                 }
+                 auto* crawler = static_cast<CrawlerWidget*>( session_.getViewIfOpen( fileName ) );
+                 if ( crawler ) {
+                     crawler->jumpToOffset( offset );
+                 }
+             } );
+
     connect( &mainTabWidget_, &TabbedCrawlerWidget::tabCloseRequested, this,
              [ this ]( int index ) { this->closeTab( index, ActionInitiator::User ); } );
     connect( &mainTabWidget_, &TabbedCrawlerWidget::currentChanged, this,
@@ -253,6 +275,8 @@ void MainWindow::reloadSession()
     const auto openedFiles
         = session_.restore( [] { return new CrawlerWidget(); }, &current_file_index );
 
+    // Tabs shown while they are added are not loaded, only the restored current one is
+    isRestoringSession_ = true;
     for ( const auto& open_file : openedFiles ) {
         QString file_name = { open_file.first };
         auto* crawler_widget = static_cast<CrawlerWidget*>( open_file.second );
@@ -265,6 +289,7 @@ void MainWindow::reloadSession()
             }
         }
     }
+    isRestoringSession_ = false;
 
     if ( current_file_index >= 0 ) {
         mainTabWidget_.setCurrentIndex( current_file_index );
@@ -281,12 +306,33 @@ void MainWindow::loadInitialFile( QString fileName, bool followFile )
 {
     LOG_DEBUG << "loadInitialFile";
 
+    // Standard input is spooled to a file that is followed as it grows
+    if ( fileName == "-" ) {
+        loadStandardInput();
+        return;
+    }
+
     // Is there a file passed as argument?
     if ( !fileName.isEmpty() ) {
         loadFile( fileName, followFile );
     }
 }
 
+void MainWindow::loadStandardInput()
+{
+    if ( !stdinSpool_ ) {
+        // Descriptor 0 is the standard input on all platforms
+        constexpr int StandardInputDescriptor = 0;
+        const auto sizeLimit
+            = static_cast<qint64>( Configuration::get().stdinSpoolLimitMb() ) * 1024 * 1024;
+
+        stdinSpool_ = std::make_unique<StreamSpool>(
+            StandardInputDescriptor, tempDir_.filePath( "klogg_stdin.log" ), sizeLimit );
+    }
+
+    loadFile( stdinSpool_->fileName(), true );
+}
+
 void MainWindow::reTranslateUI()
 {
     using namespace klogg::mainwindow;
@@ -359,6 +405,9 @@ void MainWindow::reTranslateUI()
     openUrlAction->setText( transAction( action::openUrlText ) );
     openUrlAction->setStatusTip( transAction( action::openUrlStatusTip ) );
 
+    openMergedAction->setText( transAction( action::openMergedText ) );
+    openMergedAction->setStatusTip( transAction( action::openMergedStatusTip ) );
+
     overviewVisibleAction->setText( transAction( action::overviewVisibleText ) );
 
     lineNumbersVisibleInMainAction->setText( transAction( action::lineNumbersVisibleInMainText ) );
@@ -400,6 +449,41 @@ void MainWindow::reTranslateUI()
     showScratchPadAction->setText( transAction( action::showScratchPadText ) );
     showScratchPadAction->setStatusTip( transAction( action::showScratchPadStatusTip ) );
 
+    showPerformanceAction->setText( transAction( action::showPerformanceText ) );
+    showPerformanceAction->setStatusTip( transAction( action::showPerformanceStatusTip ) );
+
+    showFindInFilesAction->setText( transAction( action::showFindInFilesText ) );
+    showFindInFilesAction->setStatusTip( transAction( action::showFindInFilesStatusTip ) );
+
+    showLogTemplatesAction->setText( transAction( action::showLogTemplatesText ) );
+    showLogTemplatesAction->setStatusTip( transAction( action::showLogTemplatesStatusTip ) );
+
+    showFieldFacetsAction->setText( transAction( action::showFieldFacetsText ) );
+    showFieldFacetsAction->setStatusTip( transAction( action::showFieldFacetsStatusTip ) );
+
+    showNumberStatisticsAction->setText( transAction( action::showNumberStatisticsText ) );
+    showNumberStatisticsAction->setStatusTip(
+        transAction( action::showNumberStatisticsStatusTip ) );
+
+    sortLinesAction->setText( transAction( action::sortLinesText ) );
+    sortLinesAction->setStatusTip( transAction( action::sortLinesStatusTip ) );
+
+    searchBetweenMarkersAction->setText( transAction( action::searchBetweenMarkersText ) );
+    searchBetweenMarkersAction->setStatusTip(
+        transAction( action::searchBetweenMarkersStatusTip ) );
+
+    filterByLevelAction->setText( transAction( action::filterByLevelText ) );
+    filterByLevelAction->setStatusTip( transAction( action::filterByLevelStatusTip ) );
+
+    compareWithFileAction->setText( transAction( action::compareWithFileText ) );
+    compareWithFileAction->setStatusTip( transAction( action::compareWithFileStatusTip ) );
+
+    searchAllTabsAction->setText( transAction( action::searchAllTabsText ) );
+    searchAllTabsAction->setStatusTip( transAction( action::searchAllTabsStatusTip ) );
+
+    exportSearchResultsAction->setText( transAction( action::exportSearchResultsText ) );
+    exportSearchResultsAction->setStatusTip( transAction( action::exportSearchResultsStatusTip ) );
+
     auto curFavoritesIconText = addToFavoritesAction->data().toBool()
                                     ? transAction( action::addToFavoritesText )
                                     : transAction( action::removeFromFavoritesText );
@@ -540,6 +624,11 @@ void MainWindow::createActions()
     openUrlAction->setStatusTip( tr( action::openUrlStatusTip ) );
     connect( openUrlAction, &QAction::triggered, this, [ this ]( auto ) { this->openUrl(); } );
 
+    openMergedAction = new QAction( tr( action::openMergedText ), this );
+    openMergedAction->setStatusTip( tr( action::openMergedStatusTip ) );
+    connect( openMergedAction, &QAction::triggered, this,
+             [ this ]( auto ) { this->openMerged(); } );
+
     overviewVisibleAction = new QAction( tr( action::overviewVisibleText ), this );
     overviewVisibleAction->setCheckable( true );
     overviewVisibleAction->setChecked( config.isOverviewVisible() );
@@ -630,6 +719,57 @@ void MainWindow::createActions()
     connect( showScratchPadAction, &QAction::triggered, this,
              [ this ]( auto ) { this->showScratchPad(); } );
 
+    showPerformanceAction = new QAction( tr( action::showPerformanceText ), this );
+    showPerformanceAction->setStatusTip( tr( action::showPerformanceStatusTip ) );
+    connect( showPerformanceAction, &QAction::triggered, this,
+             [ this ]( auto ) { this->showPerformancePanel(); } );
+
+    showFindInFilesAction = new QAction( tr( action::showFindInFilesText ), this );
+    showFindInFilesAction->setStatusTip( tr( action::showFindInFilesStatusTip ) );
+    connect( showFindInFilesAction, &QAction::triggered, this,
+             [ this ]( auto ) { this->showFindInFilesPanel(); } );
+
+    showLogTemplatesAction = new QAction( tr( action::showLogTemplatesText ), this );
+    showLogTemplatesAction->setStatusTip( tr( action::showLogTemplatesStatusTip ) );
+    signalMux_.connect( showLogTemplatesAction, SIGNAL( triggered() ), SLOT( showLogTemplates() ) );
+
+    showFieldFacetsAction = new QAction( tr( action::showFieldFacetsText ), this );
+    showFieldFacetsAction->setStatusTip( tr( action::showFieldFacetsStatusTip ) );
+    signalMux_.connect( showFieldFacetsAction, SIGNAL( triggered() ), SLOT( showFieldFacets() ) );
+
+    showNumberStatisticsAction = new QAction( tr( action::showNumberStatisticsText ), this );
+    showNumberStatisticsAction->setStatusTip( tr( action::showNumberStatisticsStatusTip ) );
+    signalMux_.connect( showNumberStatisticsAction, SIGNAL( triggered() ),
+                        SLOT( showNumberStatistics() ) );
+
+    sortLinesAction = new QAction( tr( action::sortLinesText ), this );
+    sortLinesAction->setStatusTip( tr( action::sortLinesStatusTip ) );
+    signalMux_.connect( sortLinesAction, SIGNAL( triggered() ), SLOT( sortLines() ) );
+
+    searchBetweenMarkersAction = new QAction( tr( action::searchBetweenMarkersText ), this );
+    searchBetweenMarkersAction->setStatusTip( tr( action::searchBetweenMarkersStatusTip ) );
+    signalMux_.connect( searchBetweenMarkersAction, SIGNAL( triggered() ),
+                        SLOT( searchBetweenMarkers() ) );
+
+    filterByLevelAction = new QAction( tr( action::filterByLevelText ), this );
+    filterByLevelAction->setStatusTip( tr( action::filterByLevelStatusTip ) );
+    signalMux_.connect( filterByLevelAction, SIGNAL( triggered() ), SLOT( filterByLevel() ) );
+
+    compareWithFileAction = new QAction( tr( action::compareWithFileText ), this );
+    compareWithFileAction->setStatusTip( tr( action::compareWithFileStatusTip ) );
+    connect( compareWithFileAction, &QAction::triggered, this,
+             [ this ]( auto ) { this->compareWithFile(); } );
+
+    searchAllTabsAction = new QAction( tr( action::searchAllTabsText ), this );
+    searchAllTabsAction->setStatusTip( tr( action::searchAllTabsStatusTip ) );
+    connect( searchAllTabsAction, &QAction::triggered, this,
+             [ this ]( auto ) { this->searchAllTabs(); } );
+
+    exportSearchResultsAction = new QAction( tr( action::exportSearchResultsText ), this );
+    exportSearchResultsAction->setStatusTip( tr( action::exportSearchResultsStatusTip ) );
+    signalMux_.connect( exportSearchResultsAction, SIGNAL( triggered() ),
+                        SLOT( exportSearchResults() ) );
+
     encodingGroup = new QActionGroup( this );
     connect( encodingGroup, &QActionGroup::triggered, this, &MainWindow::encodingChanged );
 
@@ -735,6 +875,7 @@ void MainWindow::createMenus()
     fileMenu->addAction( openAction );
     fileMenu->addAction( openClipboardAction );
     fileMenu->addAction( openUrlAction );
+    fileMenu->addAction( openMergedAction );
     recentFilesMenu = fileMenu->addMenu( tr( "Open Recent" ) );
     for ( auto i = 0u; i < recentFileActions.size(); ++i ) {
         recentFilesMenu->addAction( recentFileActions[ i ] );
@@ -793,6 +934,17 @@ void MainWindow::createMenus()
 
     toolsMenu->addSeparator();
     toolsMenu->addAction( showScratchPadAction );
+    toolsMenu->addAction( showPerformanceAction );
+    toolsMenu->addAction( showFindInFilesAction );
+    toolsMenu->addAction( showLogTemplatesAction );
+    toolsMenu->addAction( showFieldFacetsAction );
+    toolsMenu->addAction( showNumberStatisticsAction );
+    toolsMenu->addAction( sortLinesAction );
+    toolsMenu->addAction( searchBetweenMarkersAction );
+    toolsMenu->addAction( filterByLevelAction );
+    toolsMenu->addAction( compareWithFileAction );
+    toolsMenu->addAction( searchAllTabsAction );
+    toolsMenu->addAction( exportSearchResultsAction );
 
     menuBar()->addMenu( EncodingMenu::generate( encodingGroup ) );
     menuBar()->addSeparator();
@@ -939,23 +1091,34 @@ void MainWindow::open()
 
 void MainWindow::openRemoteFile( const QUrl& url )
 {
-    Downloader downloader;
+    auto tempFile = new QTemporaryFile( tempDir_.filePath( url.fileName() ), this );
+    if ( !tempFile->open() ) {
+        delete tempFile;
+        QMessageBox::critical( this, tr( "Klogg - File download" ),
+                               tr( "Failed to create temp file" ) );
+        return;
+    }
 
-    QProgressDialog progressDialog;
-    progressDialog.setLabelText( tr( "Downloading %1" ).arg( url.toString() ) );
+    // Archives are recognized by the content of the downloaded file,
+    // so only plain text files are opened before the download is finished.
+    const auto mime
+        = QMimeDatabase{}.mimeTypeForFile( url.fileName(), QMimeDatabase::MatchExtension );
+    if ( !mime.inherits( "text/plain" ) ) {
+        Downloader downloader;
 
-    connect( &downloader, &Downloader::downloadProgress,
-             [ &progressDialog ]( qint64 bytesReceived, qint64 bytesTotal ) {
-                 const auto progress = calculateProgress( bytesReceived, bytesTotal );
-                 progressDialog.setRange( 0, 100 );
-                 progressDialog.setValue( progress );
-             } );
+        QProgressDialog progressDialog;
+        progressDialog.setLabelText( tr( "Downloading %1" ).arg( url.toString() ) );
 
-    connect( &downloader, &Downloader::finished,
-             [ &progressDialog ]( bool isOk ) { progressDialog.done( isOk ? 0 : 1 ); } );
+        connect( &downloader, &Downloader::downloadProgress,
+                 [ &progressDialog ]( qint64 bytesReceived, qint64 bytesTotal ) {
+                     const auto progress = calculateProgress( bytesReceived, bytesTotal );
+                     progressDialog.setRange( 0, 100 );
+                     progressDialog.setValue( progress );
+                 } );
+
+        connect( &downloader, &Downloader::finished,
+                 [ &progressDialog ]( bool isOk ) { progressDialog.done( isOk ? 0 : 1 ); } );
 
-    auto tempFile = new QTemporaryFile( tempDir_.filePath( url.fileName() ), this );
-    if ( tempFile->open() ) {
         downloader.download( url, tempFile );
         if ( !progressDialog.exec() ) {
             loadFile( tempFile->fileName() );
@@ -963,11 +1126,36 @@ void MainWindow::openRemoteFile( const QUrl& url )
         else {
             QMessageBox::critical( this, tr( "Klogg - File download" ), downloader.lastError() );
         }
+        return;
     }
-    else {
-        QMessageBox::critical( this, tr( "Klogg - File download" ),
-                               tr( "Failed to create temp file" ) );
-    }
+
+    // Downloaded data is indexed as it is appended to the file,
+    // so first lines can be read and searched before the download is finished.
+    const auto fileName = tempFile->fileName();
+    auto downloader = new Downloader( this );
+
+    connect( downloader, &Downloader::downloadProgress, this,
+             [ fileName ] { FileWatcher::getFileWatcher().fileChangedOnDisk( fileName ); } );
+
+    connect( downloader, &Downloader::finished, this, [ this, downloader, fileName ]( bool isOk ) {
+        if ( isOk ) {
+            FileWatcher::getFileWatcher().fileChangedOnDisk( fileName );
+        }
+        else {
+            // Truncated file is not left open as if it was the whole file
+            for ( auto tab = mainTabWidget_.count() - 1; tab >= 0; --tab ) {
+                const auto view = qobject_cast<CrawlerWidget*>( mainTabWidget_.widget( tab ) );
+                if ( session_.getFilename( view ) == fileName ) {
+                    closeTab( tab, ActionInitiator::App );
+                }
+            }
+            QMessageBox::critical( this, tr( "Klogg - File download" ), downloader->lastError() );
+        }
+        downloader->deleteLater();
+    } );
+
+    downloader->download( url, tempFile );
+    loadFile( fileName );
 }
 
 void MainWindow::switchToOpenedFile( QAction* action )
@@ -1095,6 +1283,145 @@ void MainWindow::clearLog()
     }
 }
 
+void MainWindow::compareWithFile()
+{
+    auto* current = currentCrawlerWidget();
+    if ( !current ) {
+        return;
+    }
+
+    std::vector<CrawlerWidget*> others;
+    QStringList files;
+    for ( int tab = 0; tab < mainTabWidget_.count(); ++tab ) {
+        auto* crawler = static_cast<CrawlerWidget*>( mainTabWidget_.widget( tab ) );
+        if ( crawler != current ) {
+            others.push_back( crawler );
+            files.append( DisplayFilePath{ session_.getFilename( crawler ) }.nativeFullPath() );
+        }
+    }
+
+    if ( others.empty() ) {
+        QMessageBox::information( this, tr( "Compare with file" ),
+                                  tr( "Open another file to compare this file with" ) );
+        return;
+    }
+
+    bool ok = false;
+    const auto selectedFile
+        = QInputDialog::getItem( this, tr( "Compare with file" ),
+                                 tr( "Select file to compare with" ), files, 0, false, &ok );
+    if ( !ok ) {
+        return;
+    }
+
+    // The user might have closed the other tab while the dialog was open
+    const auto other = others.at( static_cast<size_t>( files.indexOf( selectedFile ) ) );
+    if ( mainTabWidget_.indexOf( other ) < 0 || mainTabWidget_.indexOf( current ) < 0 ) {
+        return;
+    }
+
+    const auto maskNumbers
+        = QMessageBox::question( this, tr( "Compare with file" ),
+                                 tr( "Ignore words with digits, like timestamps and ids?" ) )
+          == QMessageBox::Yes;
+
+    current->compareLines( other, maskNumbers );
+}
+
+void MainWindow::searchAllTabs()
+{
+    auto* current = currentCrawlerWidget();
+    if ( !current ) {
+        return;
+    }
+
+    const auto title = tr( "Search all tabs" );
+    bool ok = false;
+    const auto searchText
+        = QInputDialog::getText( this, title, tr( "Search in all opened files:" ),
+                                 QLineEdit::Normal, current->searchText(), &ok );
+    if ( !ok || searchText.isEmpty() ) {
+        return;
+    }
+
+    // All files are searched with the options of the search line of the current tab,
+    // the expression compiled here is cached for their searches
+    const auto pattern = current->searchPattern( searchText );
+    const RegularExpression expression{ pattern };
+    if ( !expression.isValid() ) {
+        QMessageBox::warning(
+            this, title, tr( "Error in expression: %1" ).arg( expression.errorString() ) );
+        return;
+    }
+
+    auto* dialog = new QDialog( this );
+    dialog->setAttribute( Qt::WA_DeleteOnClose );
+    dialog->resize( size() / 2 );
+
+    auto* filesView = new QTreeWidget( dialog );
+    filesView->setRootIsDecorated( false );
+    filesView->setUniformRowHeights( true );
+    filesView->setHeaderLabels( { tr( "Matches" ), tr( "File" ) } );
+
+    auto* layout = new QVBoxLayout( dialog );
+    layout->addWidget( filesView );
+
+    struct SearchedFile {
+        QPointer<CrawlerWidget> crawler;
+        QPointer<LogFilteredData> filteredData;
+        uint64_t nbMatches = 0;
+    };
+    auto searchedFiles = std::make_shared<std::vector<SearchedFile>>();
+
+    const auto updateTitle = [ dialog, searchText, searchedFiles ] {
+        uint64_t nbMatches = 0;
+        for ( const auto& file : *searchedFiles ) {
+            nbMatches += file.nbMatches;
+        }
+        dialog->setWindowTitle( tr( "%1 matches of \"%2\" in %3 files" )
+                                    .arg( nbMatches )
+                                    .arg( searchText )
+                                    .arg( searchedFiles->size() ) );
+    };
+
+    // Searches of all files share the threads of the task scheduler,
+    // the one of the current tab comes first
+    for ( int tab = 0; tab < mainTabWidget_.count(); ++tab ) {
+        auto* crawler = static_cast<CrawlerWidget*>( mainTabWidget_.widget( tab ) );
+        auto* filteredData = crawler->searchInNewTab( searchText, pattern );
+
+        const auto index = searchedFiles->size();
+        searchedFiles->push_back( { crawler, filteredData } );
+
+        const auto path = DisplayFilePath{ session_.getFilename( crawler ) }.nativeFullPath();
+        auto* item = new QTreeWidgetItem( filesView, { tr( "Searching..." ), path } );
+        connect( filteredData, &LogFilteredData::searchProgressed, filesView,
+                 [ item, index, searchedFiles, updateTitle ]( LinesCount nbMatches, int progress,
+                                                               LineNumber ) {
+                     searchedFiles->at( index ).nbMatches = nbMatches.get();
+                     item->setText( 0, progress < 100 ? tr( "%1 (%2 %)" )
+                                                            .arg( nbMatches.get() )
+                                                            .arg( progress )
+                                                      : QString::number( nbMatches.get() ) );
+                     updateTitle();
+                 } );
+    }
+
+    // Activating a file shows the tab with its matches
+    connect( filesView, &QTreeWidget::itemActivated, this,
+             [ this, filesView, searchedFiles ]( QTreeWidgetItem* item ) {
+                 const auto index = static_cast<size_t>( filesView->indexOfTopLevelItem( item ) );
+                 const auto& file = searchedFiles->at( index );
+                 if ( file.crawler ) {
+                     mainTabWidget_.setCurrentWidget( file.crawler );
+                     file.crawler->showFilteredData( file.filteredData );
+                 }
+             } );
+
+    updateTitle();
+    dialog->show();
+}
+
 void MainWindow::copyFullPath()
 {
     const auto current_file = session_.getFilename( currentCrawlerWidget() );
@@ -1149,6 +1476,38 @@ void MainWindow::openUrl()
     }
 }
 
+// Opens the logs selected in the file dialog merged by time, through a merge list
+// saved where the user chooses
+void MainWindow::openMerged()
+{
+    QString defaultDir = ".";
+    if ( auto current = currentCrawlerWidget() ) {
+        defaultDir = QFileInfo( session_.getFilename( current ) ).path();
+    }
+
+    const auto logFileNames = QFileDialog::getOpenFileNames(
+        this, tr( "Open files merged by time" ), defaultDir, tr( "All files (*)" ) );
+    if ( logFileNames.isEmpty() ) {
+        return;
+    }
+
+    const auto listFileName = QFileDialog::getSaveFileName(
+        this, tr( "Save merge list" ),
+        QFileInfo( logFileNames.front() ).dir().filePath( "merged.klogg-merge" ),
+        tr( "Merge lists (*.klogg-merge)" ) );
+    if ( listFileName.isEmpty() ) {
+        return;
+    }
+
+    if ( !MergedAccess::writeMergeList( listFileName, logFileNames ) ) {
+        QMessageBox::critical( this, tr( "Klogg - Merge logs" ),
+                               tr( "Failed to write the merge list %1" ).arg( listFileName ) );
+        return;
+    }
+
+    loadFile( listFileName );
+}
+
 // Opens the 'Highlighters' dialog box
 void MainWindow::editHighlighters()
 {
@@ -1246,6 +1605,26 @@ void MainWindow::showScratchPad()
     scratchPad_.activateWindow();
 }
 
+void MainWindow::showPerformancePanel()
+{
+    auto state = performancePanel_.windowState();
+    state.setFlag( Qt::WindowMinimized, false );
+    performancePanel_.setWindowState( state );
+
+    performancePanel_.show();
+    performancePanel_.activateWindow();
+}
+
+void MainWindow::showFindInFilesPanel()
+{
+    auto state = findInFilesPanel_.windowState();
+    state.setFlag( Qt::WindowMinimized, false );
+    findInFilesPanel_.setWindowState( state );
+
+    findInFilesPanel_.show();
+    findInFilesPanel_.activateWindow();
+}
+
 void MainWindow::sendToScratchpad( QString newData )
 {
     scratchPad_.addData( newData );
@@ -1430,26 +1809,59 @@ void MainWindow::closeTab( int index, ActionInitiator initiator )
 
     assert( widget );
 
-    widget->stopLoading();
+    // Log shared with other views of the file keeps loading for them
+    if ( session_.isLogShared( widget ) ) {
+        widget->stopSearch();
+    }
+    else {
+        widget->stopLoading();
+    }
     mainTabWidget_.removeCrawler( index );
 
+    const auto fileName = session_.getFilename( widget );
     if ( initiator == ActionInitiator::User ) {
-        addRecentFile( session_.getFilename( widget ) );
+        addRecentFile( fileName );
     }
 
     session_.close( widget );
 
+    // Decompressor waits for the decompression before its file is removed
+    const auto decompressedFile = decompressedFiles_.find( fileName );
+    if ( decompressedFile != decompressedFiles_.end()
+         && session_.getViewIfOpen( fileName ) == nullptr ) {
+        decompressedFile->second->deleteLater();
+        decompressedFiles_.erase( decompressedFile );
+    }
+
     updateOpenedFilesMenu();
 
     widget->deleteLater();
 }
 
+void MainWindow::updateTabsActivity()
+{
+    // Files of other tabs and of minimized windows are indexed with lower priority,
+    // their views are updated when they are shown again
+    const auto isShown = this->isVisible() && !this->isMinimized();
+    const auto currentTab = mainTabWidget_.currentIndex();
+    for ( int tab = 0; tab < mainTabWidget_.count(); ++tab ) {
+        static_cast<CrawlerWidget*>( mainTabWidget_.widget( tab ) )
+            ->setActive( isShown && tab == currentTab );
+    }
+}
+
 void MainWindow::currentTabChanged( int index )
 {
     LOG_DEBUG << "currentTabChanged";
 
+    updateTabsActivity();
+
     if ( index >= 0 ) {
         auto* crawler_widget = static_cast<CrawlerWidget*>( mainTabWidget_.widget( index ) );
+        if ( !isRestoringSession_ ) {
+            session_.loadIfDeferred( crawler_widget );
+        }
+
         signalMux_.setCurrentDocument( crawler_widget );
         quickFindMux_.registerSelector( crawler_widget );
 
@@ -1556,6 +1968,7 @@ void MainWindow::changeEvent( QEvent* event )
 {
     if ( event->type() == QEvent::WindowStateChange ) {
         isMaximized_ = windowState().testFlag( Qt::WindowMaximized );
+        updateTabsActivity();
 
         if ( this->windowState() & Qt::WindowMinimized ) {
             if ( Configuration::get().minimizeToTray() ) {
@@ -1615,6 +2028,10 @@ bool MainWindow::event( QEvent* event )
                          [ this ]( QScreen* screen ) { logScreenInfo( screen ); } );
             } );
         }
+        updateTabsActivity();
+    }
+    else if ( event->type() == QEvent::Hide ) {
+        updateTabsActivity();
     }
 
     return QMainWindow::event( event );
@@ -1642,6 +2059,39 @@ bool MainWindow::extractAndLoadFile( const QString& fileName )
 
     const auto decompressAction = Decompressor::action( fileName );
 
+    if ( decompressAction == DecompressAction::Decompress && config.anyFileWatchEnabled() ) {
+        // Decompressed data is indexed as it is appended to the file,
+        // so first lines can be read and searched before decompression is finished.
+        // The file is removed after the decompressor stops writing to it.
+        auto decompressor = new Decompressor( this );
+        auto tempFile = new QTemporaryFile(
+            this->tempDir_.filePath( QFileInfo( fileName ).fileName() ), decompressor );
+
+        connect( decompressor, &Decompressor::finished, this, [ this, fileName ]( bool isOk ) {
+            if ( !isOk ) {
+                QMessageBox::warning(
+                    this, tr( "klogg" ),
+                    tr( "Failed to decompress %1" ).arg( QDir::toNativeSeparators( fileName ) ) );
+            }
+        } );
+
+        if ( tempFile->open() && decompressor->decompress( fileName, tempFile ) ) {
+            if ( this->loadFile( tempFile->fileName() ) ) {
+                decompressedFiles_[ tempFile->fileName() ] = decompressor;
+                return true;
+            }
+
+            delete decompressor;
+            return false;
+        }
+
+        delete decompressor;
+        QMessageBox::warning(
+            this, tr( "klogg" ),
+            tr( "Failed to decompress %1" ).arg( QDir::toNativeSeparators( fileName ) ) );
+        return false;
+    }
+
     Decompressor decompressor;
     AtomicFlag decompressInterrupt;
 
@@ -1669,7 +2119,13 @@ bool MainWindow::extractAndLoadFile( const QString& fileName )
                 return false;
             }
 
-            return this->loadFile( tempFile->fileName() );
+            if ( this->loadFile( tempFile->fileName() ) ) {
+                decompressedFiles_[ tempFile->fileName() ] = tempFile;
+                return true;
+            }
+
+            delete tempFile;
+            return false;
         }
         else {
             QMessageBox::warning(
@@ -1723,7 +2179,11 @@ bool MainWindow::loadFile( const QString& fileName, bool followFile )
         return true;
     }
 
-    const auto decompressAction = Decompressor::action( fileName );
+    // Files opened in place are decompressed by the log data
+    const auto isOpenedInPlace = Configuration::get().openCompressedInPlace()
+                                 && CompressedAccess::create( fileName ) != nullptr;
+    const auto decompressAction
+        = isOpenedInPlace ? DecompressAction::None : Decompressor::action( fileName );
 
     if ( decompressAction == DecompressAction::None || !Configuration::get().extractArchives() ) {
         // Load the file
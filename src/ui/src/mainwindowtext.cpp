@@ -60,6 +60,9 @@ const char* action::openClipboardText = QT_TR_NOOP( "Open from clipboard" );
 const char* action::openClipboardStatusTip = QT_TR_NOOP( "Open clipboard as log file" );
 const char* action::openUrlText = QT_TR_NOOP( "Open from URL..." );
 const char* action::openUrlStatusTip = QT_TR_NOOP( "Open URL as log file" );
+const char* action::openMergedText = QT_TR_NOOP( "Open merged by time..." );
+const char* action::openMergedStatusTip
+    = QT_TR_NOOP( "Open several log files with their lines merged by time" );
 const char* action::overviewVisibleText = QT_TR_NOOP( "Matches &overview" );
 const char* action::lineNumbersVisibleInMainText = QT_TR_NOOP( "Line &numbers in main view" );
 const char* action::lineNumbersVisibleInFilteredText
@@ -90,6 +93,39 @@ const char* action::generateDumpText = QT_TR_NOOP( "Generate crash dump" );
 const char* action::generateDumpStatusTip = QT_TR_NOOP( "Generate diagnostic crash dump" );
 const char* action::showScratchPadText = QT_TR_NOOP( "Scratchpad" );
 const char* action::showScratchPadStatusTip = QT_TR_NOOP( "Show the scratchpad" );
+const char* action::showPerformanceText = QT_TR_NOOP( "Performance" );
+const char* action::showPerformanceStatusTip
+    = QT_TR_NOOP( "Show metrics of indexing, searching and drawing" );
+const char* action::showFindInFilesText = QT_TR_NOOP( "Find in files..." );
+const char* action::showFindInFilesStatusTip
+    = QT_TR_NOOP( "Search a pattern in many files without opening them" );
+const char* action::showLogTemplatesText = QT_TR_NOOP( "Message templates..." );
+const char* action::showLogTemplatesStatusTip
+    = QT_TR_NOOP( "Group lines of the file by their message templates" );
+const char* action::showFieldFacetsText = QT_TR_NOOP( "Field values..." );
+const char* action::showFieldFacetsStatusTip
+    = QT_TR_NOOP( "Count the most common values of a field of the filtered lines" );
+const char* action::showNumberStatisticsText = QT_TR_NOOP( "Number statistics..." );
+const char* action::showNumberStatisticsStatusTip
+    = QT_TR_NOOP( "Show statistics of the numbers of a field of the filtered lines" );
+const char* action::sortLinesText = QT_TR_NOOP( "Sort lines..." );
+const char* action::sortLinesStatusTip
+    = QT_TR_NOOP( "Open the filtered lines sorted by a field or by timestamps in a new tab" );
+const char* action::searchBetweenMarkersText = QT_TR_NOOP( "Search between markers..." );
+const char* action::searchBetweenMarkersStatusTip
+    = QT_TR_NOOP( "Search only the lines between lines matching begin and end markers" );
+const char* action::filterByLevelText = QT_TR_NOOP( "Filter by level..." );
+const char* action::filterByLevelStatusTip
+    = QT_TR_NOOP( "Search only the lines of a log level, or show them in a new tab" );
+const char* action::compareWithFileText = QT_TR_NOOP( "Compare with file..." );
+const char* action::compareWithFileStatusTip
+    = QT_TR_NOOP( "Show the lines found only in this file or only in another opened file" );
+const char* action::searchAllTabsText = QT_TR_NOOP( "Search all tabs..." );
+const char* action::searchAllTabsStatusTip
+    = QT_TR_NOOP( "Search all opened files and list the number of matches of each file" );
+const char* action::exportSearchResultsText = QT_TR_NOOP( "Export search results..." );
+const char* action::exportSearchResultsStatusTip = QT_TR_NOOP(
+    "Write the matching lines, their numbers, offsets or bitmap to a file or a command" );
 const char* action::addToFavoritesText = QT_TR_NOOP( "Add to favorites" );
 const char* action::removeFromFavoritesText = QT_TR_NOOP( "Remove from favorites..." );
 const char* action::selectOpenFileText = QT_TR_NOOP( "Switch to opened file..." );
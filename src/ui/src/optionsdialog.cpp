@@ -46,7 +46,9 @@
 #include "fontutils.h"
 #include "highlighteredit.h"
 #include "log.h"
+#include "logfiltereddata.h"
 #include "mainwindow.h"
+#include "readablesize.h"
 #include "recentfiles.h"
 #include "savedsearches.h"
 #include "shortcuts.h"
@@ -79,6 +81,8 @@ OptionsDialog::OptionsDialog( QWidget* parent )
     connect( pollingCheckBox, &QCheckBox::toggled, [ this ]( auto ) { this->setupPolling(); } );
     connect( searchResultsCacheCheckBox, &QCheckBox::toggled,
              [ this ]( auto ) { this->setupSearchResultsCache(); } );
+    connect( speculativeSearchesCheckBox, &QCheckBox::toggled,
+             [ this ]( auto ) { this->setupSearchResultsCache(); } );
     connect( loggingCheckBox, &QCheckBox::toggled, [ this ]( auto ) { this->setupLogging(); } );
 
     connect( extractArchivesCheckBox, &QCheckBox::toggled,
@@ -202,7 +206,20 @@ void OptionsDialog::setupPolling()
 
 void OptionsDialog::setupSearchResultsCache()
 {
+    // Set by the low memory profile
+    const auto isLowMemoryProfile = Configuration::get().lowMemoryProfile();
+
     searchCacheSpinBox->setEnabled( searchResultsCacheCheckBox->isChecked() );
+    searchCacheMemorySpinBox->setEnabled( searchResultsCacheCheckBox->isChecked()
+                                          && !isLowMemoryProfile );
+    searchResultsDiskCacheCheckBox->setEnabled( searchResultsCacheCheckBox->isChecked()
+                                                && !isLowMemoryProfile );
+
+    // Results of speculative searches are kept in the cache
+    speculativeSearchesCheckBox->setEnabled( searchResultsCacheCheckBox->isChecked()
+                                             && !isLowMemoryProfile );
+    speculativeSearchesSpinBox->setEnabled( speculativeSearchesCheckBox->isEnabled()
+                                            && speculativeSearchesCheckBox->isChecked() );
 }
 
 void OptionsDialog::setupLogging()
@@ -338,12 +355,14 @@ void OptionsDialog::updateDialogFromConfig()
     // Polling
     nativeFileWatchCheckBox->setChecked( config.nativeFileWatchEnabled() );
     fastModificationDetectionCheckBox->setChecked( config.fastModificationDetection() );
+    chainRotatedFilesCheckBox->setChecked( config.chainRotatedFiles() );
     pollingCheckBox->setChecked( config.pollingEnabled() );
     pollIntervalLineEdit->setText( QString::number( config.pollIntervalMs() ) );
     allowFollowOnScrollCheckBox->setChecked( config.allowFollowOnScroll() );
 
     // Last session
     loadLastSessionCheckBox->setChecked( config.loadLastSession() );
+    loadSessionLazilyCheckBox->setChecked( config.loadSessionLazily() );
     followFileOnLoadCheckBox->setChecked( config.followFileOnLoad() );
     minimizeToTrayCheckBox->setChecked( config.minimizeToTray() );
     multipleWindowsCheckBox->setChecked( config.allowMultipleWindows() );
@@ -353,16 +372,35 @@ void OptionsDialog::updateDialogFromConfig()
 
     extractArchivesCheckBox->setChecked( config.extractArchives() );
     extractArchivesAlwaysCheckBox->setChecked( config.extractArchivesAlways() );
+    openCompressedInPlaceCheckBox->setChecked( config.openCompressedInPlace() );
 
     // Perf
     parallelSearchCheckBox->setChecked( config.useParallelSearch() );
+    parallelIndexingCheckBox->setChecked( config.useParallelIndexing() );
+    mappedFileIndexingCheckBox->setChecked( config.useMappedFileIndexing() );
+    indexCacheCheckBox->setChecked( config.useIndexCache() );
+    tailFirstIndexingCheckBox->setChecked( config.useTailFirstIndexing() );
+    lazyTabExpansionCheckBox->setChecked( config.useLazyTabExpansion() );
+    sparseLineIndexCheckBox->setChecked( config.useSparseLineIndex() );
     searchResultsCacheCheckBox->setChecked( config.useSearchResultsCache() );
     searchCacheSpinBox->setValue( static_cast<int>( config.searchResultsCacheLines() ) );
+    searchCacheMemorySpinBox->setValue( config.searchResultsCacheSizeMb() );
+    searchCacheUsageLabel->setText(
+        tr( "Used by open files: %1" )
+            .arg( readableSize( LogFilteredData::searchResultsCacheBytes() ) ) );
+    searchResultsDiskCacheCheckBox->setChecked( config.keepSearchResultsOnDisk() );
+    speculativeSearchesCheckBox->setChecked( config.useSpeculativeSearches() );
+    speculativeSearchesSpinBox->setValue( config.speculativeSearchesCount() );
     indexReadBufferSpinBox->setValue( config.indexReadBufferSizeMb() );
     searchReadBufferSpinBox->setValue( config.searchReadBufferSizeLines() );
     keepFileClosedCheckBox->setChecked( config.keepFileClosed() );
     optimizeForNotLatinEncodingsCheckBox->setChecked( config.optimizeForNotLatinEncodings() );
 
+    // The low memory profile shows its values, the configured ones are kept
+    mappedFileIndexingCheckBox->setEnabled( !config.lowMemoryProfile() );
+    sparseLineIndexCheckBox->setEnabled( !config.lowMemoryProfile() );
+    indexReadBufferSpinBox->setEnabled( !config.lowMemoryProfile() );
+
     // version checking
     checkForNewVersionCheckBox->setChecked( config.versionCheckingEnabled() );
 
@@ -510,9 +548,11 @@ void OptionsDialog::updateConfigFromDialog()
 
     config.setPollIntervalMs( pollInterval );
     config.setFastModificationDetection( fastModificationDetectionCheckBox->isChecked() );
+    config.setChainRotatedFiles( chainRotatedFilesCheckBox->isChecked() );
     config.setAllowFollowOnScroll( allowFollowOnScrollCheckBox->isChecked() );
 
     config.setLoadLastSession( loadLastSessionCheckBox->isChecked() );
+    config.setLoadSessionLazily( loadSessionLazilyCheckBox->isChecked() );
     config.setFollowFileOnLoad( followFileOnLoadCheckBox->isChecked() );
     config.setAllowMultipleWindows( multipleWindowsCheckBox->isChecked() );
     config.setMinimizeToTray( minimizeToTrayCheckBox->isChecked() );
@@ -521,11 +561,25 @@ void OptionsDialog::updateConfigFromDialog()
 
     config.setExtractArchives( extractArchivesCheckBox->isChecked() );
     config.setExtractArchivesAlways( extractArchivesAlwaysCheckBox->isChecked() );
+    config.setOpenCompressedInPlace( openCompressedInPlaceCheckBox->isChecked() );
 
     config.setUseParallelSearch( parallelSearchCheckBox->isChecked() );
+    config.setUseParallelIndexing( parallelIndexingCheckBox->isChecked() );
+    // Settings overridden by the low memory profile keep their configured values
+    if ( !config.lowMemoryProfile() ) {
+        config.setUseMappedFileIndexing( mappedFileIndexingCheckBox->isChecked() );
+        config.setUseSparseLineIndex( sparseLineIndexCheckBox->isChecked() );
+        config.setSearchResultsCacheSizeMb( searchCacheMemorySpinBox->value() );
+        config.setKeepSearchResultsOnDisk( searchResultsDiskCacheCheckBox->isChecked() );
+        config.setUseSpeculativeSearches( speculativeSearchesCheckBox->isChecked() );
+        config.setIndexReadBufferSizeMb( indexReadBufferSpinBox->value() );
+    }
+    config.setUseIndexCache( indexCacheCheckBox->isChecked() );
+    config.setUseTailFirstIndexing( tailFirstIndexingCheckBox->isChecked() );
+    config.setUseLazyTabExpansion( lazyTabExpansionCheckBox->isChecked() );
     config.setUseSearchResultsCache( searchResultsCacheCheckBox->isChecked() );
     config.setSearchResultsCacheLines( static_cast<unsigned>( searchCacheSpinBox->value() ) );
-    config.setIndexReadBufferSizeMb( indexReadBufferSpinBox->value() );
+    config.setSpeculativeSearchesCount( speculativeSearchesSpinBox->value() );
     config.setSearchReadBufferSizeLines( searchReadBufferSpinBox->value() );
     config.setKeepFileClosed( keepFileClosedCheckBox->isChecked() );
     config.setOptimizeForNotLatinEncodings( optimizeForNotLatinEncodingsCheckBox->isChecked() );
@@ -21,8 +21,11 @@
 // It provides support for drawing the match overview sidebar but
 // the actual drawing is done in AbstractLogView which uses this class.
 
+#include <algorithm>
+
 #include "linetypes.h"
 #include "log.h"
+#include "tracing.h"
 
 #include "logfiltereddata.h"
 
@@ -52,16 +55,34 @@ void Overview::updateData( LinesCount totalNbLine )
 
     linesInFile_ = totalNbLine;
     dirty_ = true;
+    firstDirtyPosition_ = {};
+}
+
+void Overview::updateMatches( LineNumber firstNewMatch )
+{
+    if ( dirty_ ) {
+        return;
+    }
+
+    const auto position = static_cast<unsigned>( yFromFileLine( firstNewMatch ) );
+    if ( !firstDirtyPosition_ || position < *firstDirtyPosition_ ) {
+        firstDirtyPosition_ = position;
+    }
 }
 
 void Overview::updateView( unsigned height )
 {
+    const TraceSpan span( "update overview", "view" );
+
     // We don't touch the cache if the height hasn't changed
     if ( ( height != height_ ) || ( dirty_ == true ) ) {
         height_ = height;
 
         recalculatesLines();
     }
+    else if ( firstDirtyPosition_ ) {
+        recalculatesLines( *firstDirtyPosition_ );
+    }
 }
 
 const klogg::vector<Overview::WeightedLine>* Overview::getMatchLines() const
@@ -107,44 +128,82 @@ int Overview::yFromFileLine( LineNumber fileLine ) const
     return position;
 }
 
-// Update the internal cache
-void Overview::recalculatesLines()
+// Update the internal cache from the passed position
+void Overview::recalculatesLines( unsigned firstPosition )
 {
-    LOG_INFO << "OverviewWidget::recalculatesLines";
+    LOG_INFO << "OverviewWidget::recalculatesLines from " << firstPosition;
+
+    // Counts of count only searches are not added to the cache in order
+    if ( logFilteredData_ != nullptr && logFilteredData_->isCountOnly() ) {
+        firstPosition = 0;
+    }
 
     if ( logFilteredData_ != nullptr ) {
-        matchLines_.clear();
-        markLines_.clear();
+        const auto isBefore = [ firstPosition ]( const WeightedLine& line ) {
+            return line.position() < static_cast<int>( firstPosition );
+        };
+        matchLines_.erase( std::partition_point( matchLines_.begin(), matchLines_.end(), isBefore ),
+                           matchLines_.end() );
+        markLines_.erase( std::partition_point( markLines_.begin(), markLines_.end(), isBefore ),
+                          markLines_.end() );
 
         if ( linesInFile_.get() > 0 ) {
-            logFilteredData_->iterateOverLines( [ this ]( LineNumber line ) {
-                const auto lineType = logFilteredData_->lineTypeByLine( line );
-                const auto position = yFromFileLine( line );
-                if ( lineType.testFlag( LogFilteredData::LineTypeFlags::Match ) ) {
-                    if ( ( !matchLines_.empty() ) && matchLines_.back().position() == position ) {
-                        // If the line is already there, we increase its weight
-                        matchLines_.back().load();
+            // Lines are counted per pixel, lines of a pixel start at the first one
+            // yFromFileLine puts there
+            const auto pixelFirstLine = [ this ]( uint64_t position ) {
+                return LineNumber( ( position * linesInFile_.get() + height_ - 1 ) / height_ );
+            };
+            const auto addLines = []( klogg::vector<WeightedLine>& lines, int position,
+                                      uint64_t count ) {
+                if ( count == 0 ) {
+                    return;
+                }
+                lines.emplace_back( position );
+                const auto weight = qMin<uint64_t>( count, WeightedLine::WEIGHT_STEPS );
+                for ( uint64_t line = 1; line < weight; ++line ) {
+                    lines.back().load();
+                }
+            };
+
+            auto linesBefore
+                = logFilteredData_->getNbShownLinesBefore( pixelFirstLine( firstPosition ) );
+            for ( unsigned position = firstPosition; position < height_; ++position ) {
+                const auto linesAfter
+                    = logFilteredData_->getNbShownLinesBefore( pixelFirstLine( position + 1 ) );
+                const auto nbMatches = linesAfter.second.get() - linesBefore.second.get();
+                const auto nbShownLines = linesAfter.first.get() - linesBefore.first.get();
+
+                addLines( matchLines_, static_cast<int>( position ), nbMatches );
+                addLines( markLines_, static_cast<int>( position ), nbShownLines - nbMatches );
+
+                linesBefore = linesAfter;
+            }
+
+            // Count only searches have numbers of matches in parts of the file instead
+            if ( logFilteredData_->isCountOnly() ) {
+                const auto counts = logFilteredData_->getMatchCounts();
+                for ( size_t bucket = 0; bucket < counts.buckets.size(); ++bucket ) {
+                    const auto count = counts.buckets[ bucket ];
+                    if ( count == 0 ) {
+                        continue;
                     }
-                    else {
-                        // If not we just add it
+
+                    const auto position
+                        = yFromFileLine( LineNumber( bucket * counts.bucketLines.get() ) );
+                    if ( matchLines_.empty() || matchLines_.back().position() != position ) {
                         matchLines_.emplace_back( position );
                     }
-                }
-                else {
-                    if ( ( !markLines_.empty() ) && markLines_.back().position() == position ) {
-                        // If the line is already there, we increase its weight
-                        markLines_.back().load();
-                    }
-                    else {
-                        // If not we just add it
-                        markLines_.emplace_back( position );
+                    const auto weight = qMin<uint64_t>( count, WeightedLine::WEIGHT_STEPS );
+                    for ( uint64_t line = 1; line < weight; ++line ) {
+                        matchLines_.back().load();
                     }
                 }
-            } );
+            }
         }
     }
     else
         LOG_INFO << "Overview::recalculatesLines: logFilteredData_ == NULL";
 
     dirty_ = false;
+    firstDirtyPosition_ = {};
 }
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "patternvalidator.h"
+
+#include <QtConcurrent>
+
+#include "log.h"
+#include "regularexpression.h"
+
+PatternValidator::PatternValidator( QObject* parent )
+    : QObject( parent )
+    , generation_( std::make_shared<std::atomic<uint64_t>>( 0 ) )
+{
+    compilePool_.setMaxThreadCount( 1 );
+}
+
+PatternValidator::~PatternValidator()
+{
+    generation_->fetch_add( 1 );
+    compilePool_.waitForDone();
+}
+
+void PatternValidator::validate( const RegularExpressionPattern& pattern )
+{
+    if ( ( pendingPattern_ && *pendingPattern_ == pattern )
+         || ( !pendingPattern_ && lastResult_ && lastResult_->pattern == pattern ) ) {
+        return;
+    }
+
+    pendingPattern_ = pattern;
+    const auto generation = generation_->fetch_add( 1 ) + 1;
+
+    QtConcurrent::run( &compilePool_, [ this, pattern, generation, latest = generation_ ] {
+        if ( latest->load() != generation ) {
+            return;
+        }
+
+        const RegularExpression expression{ pattern };
+        Result result{ pattern, expression.isValid(), expression.errorString() };
+
+        // Calls posted to the validator are dropped if it is destroyed
+        QMetaObject::invokeMethod(
+            this,
+            [ this, generation, result = std::move( result ) ] {
+                if ( generation_->load() != generation ) {
+                    return;
+                }
+
+                LOG_DEBUG << "pattern " << result.pattern.pattern << " is "
+                          << ( result.isValid ? "valid" : "invalid" );
+                pendingPattern_.reset();
+                lastResult_ = result;
+                Q_EMIT validated( result.isValid, result.errorString );
+            },
+            Qt::QueuedConnection );
+    } );
+}
+
+std::optional<PatternValidator::Result>
+PatternValidator::result( const RegularExpressionPattern& pattern ) const
+{
+    if ( lastResult_ && lastResult_->pattern == pattern ) {
+        return lastResult_;
+    }
+    return {};
+}
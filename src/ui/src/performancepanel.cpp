@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "performancepanel.h"
+
+#include <cmath>
+#include <memory>
+#include <numeric>
+
+#include <QAction>
+#include <QApplication>
+#include <QClipboard>
+#include <QDateTime>
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QScrollBar>
+#include <QStatusBar>
+#include <QSysInfo>
+#include <QThread>
+#include <QToolBar>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include "klogg_version.h"
+#include "log.h"
+#include "memory_info.h"
+#include "memorygovernor.h"
+#include "metrics.h"
+#include "readablesize.h"
+#include "stallwatchdog.h"
+#include "tracing.h"
+
+namespace {
+constexpr int RefreshIntervalMs = 1000;
+constexpr int StatusTimeout = 2000;
+
+constexpr int NameColumn = 0;
+
+QString formatNumber( double value )
+{
+    return QString::number( value, 'f', value == std::floor( value ) ? 0 : 1 );
+}
+
+QTreeWidgetItem* addGroup( QTreeWidget* tree, const QString& title )
+{
+    auto group = std::make_unique<QTreeWidgetItem>( QStringList{ title } );
+    auto font = group->font( NameColumn );
+    font.setBold( true );
+    group->setFont( NameColumn, font );
+    auto* item = group.release();
+    tree->addTopLevelItem( item );
+    item->setExpanded( true );
+    return item;
+}
+
+uint64_t totalBytes( const MemoryGovernor::GroupUsage& group )
+{
+    return std::accumulate( group.bytes.begin(), group.bytes.end(), uint64_t{ 0 } );
+}
+
+QJsonObject memoryJson()
+{
+    QJsonArray groups;
+    for ( const auto& group : MemoryGovernor::get().usage() ) {
+        QJsonObject bytes;
+        for ( auto kind = 0u; kind < MemoryGovernor::KindsCount; ++kind ) {
+            bytes[ MemoryGovernor::kindName( static_cast<MemoryGovernor::Kind>( kind ) ) ]
+                = static_cast<qint64>( group.bytes[ kind ] );
+        }
+
+        QJsonObject groupJson;
+        groupJson[ "name" ] = group.name;
+        groupJson[ "total" ] = static_cast<qint64>( totalBytes( group ) );
+        groupJson[ "bytes" ] = bytes;
+        groups.append( groupJson );
+    }
+
+    QJsonObject json;
+    json[ "process" ] = static_cast<qint64>( usedMemory() );
+    json[ "budget" ] = static_cast<qint64>( MemoryGovernor::budget() );
+    json[ "files" ] = groups;
+    return json;
+}
+} // namespace
+
+PerformancePanel::PerformancePanel( QWidget* parent )
+    : QWidget( parent )
+{
+    this->hide();
+
+    auto toolBar = std::make_unique<QToolBar>();
+
+    auto resetAction = std::make_unique<QAction>( tr( "Reset" ) );
+    connect( resetAction.get(), &QAction::triggered, [ this ]( auto ) { reset(); } );
+    toolBar->addAction( resetAction.release() );
+
+    toolBar->addSeparator();
+
+    auto copyAction = std::make_unique<QAction>( tr( "Copy json" ) );
+    connect( copyAction.get(), &QAction::triggered, [ this ]( auto ) { copyJson(); } );
+    toolBar->addAction( copyAction.release() );
+
+    auto saveAction = std::make_unique<QAction>( tr( "Export json..." ) );
+    connect( saveAction.get(), &QAction::triggered, [ this ]( auto ) { saveJson(); } );
+    toolBar->addAction( saveAction.release() );
+
+    toolBar->addSeparator();
+
+    auto traceAction = std::make_unique<QAction>( tr( "Record trace" ) );
+    traceAction->setCheckable( true );
+    traceAction->setChecked( Tracing::isEnabled() );
+    connect( traceAction.get(), &QAction::toggled, [ this ]( bool isChecked ) {
+        if ( isChecked ) {
+            Tracing::get().clear();
+        }
+        Tracing::get().setEnabled( isChecked );
+        statusBar_->showMessage( isChecked ? tr( "Recording trace" ) : tr( "Trace stopped" ),
+                                 StatusTimeout );
+    } );
+    toolBar->addAction( traceAction.release() );
+
+    auto saveTraceAction = std::make_unique<QAction>( tr( "Export trace..." ) );
+    connect( saveTraceAction.get(), &QAction::triggered, [ this ]( auto ) { saveTrace(); } );
+    toolBar->addAction( saveTraceAction.release() );
+
+    toolBar->addSeparator();
+
+    auto watchStallsAction = std::make_unique<QAction>( tr( "Watch stalls" ) );
+    watchStallsAction->setCheckable( true );
+    watchStallsAction->setChecked( StallWatchdog::get().isRunning() );
+    connect( watchStallsAction.get(), &QAction::toggled, [ this ]( bool isChecked ) {
+        if ( isChecked ) {
+            StallWatchdog::get().start();
+        }
+        else {
+            StallWatchdog::get().stop();
+        }
+        statusBar_->showMessage( isChecked ? tr( "Watching event loop stalls" )
+                                           : tr( "Stopped watching event loop stalls" ),
+                                 StatusTimeout );
+    } );
+    toolBar->addAction( watchStallsAction.release() );
+
+    auto metricsTree = std::make_unique<QTreeWidget>();
+    metricsTree->setHeaderLabels( { tr( "Metric" ), tr( "Value" ), tr( "Count" ), tr( "Mean" ),
+                                    tr( "p50" ), tr( "p90" ), tr( "p99" ), tr( "Max" ) } );
+    metricsTree->setRootIsDecorated( false );
+    metricsTree->setSelectionMode( QAbstractItemView::NoSelection );
+    metricsTree->setMinimumSize( 600, 400 );
+    metricsTree->header()->setSectionResizeMode( QHeaderView::ResizeToContents );
+
+    auto statusBar = std::make_unique<QStatusBar>();
+
+    auto layout = std::make_unique<QVBoxLayout>();
+    layout->addWidget( toolBar.release() );
+    layout->addWidget( metricsTree.get() );
+    layout->addWidget( statusBar.get() );
+
+    metricsTree_ = metricsTree.release();
+    statusBar_ = statusBar.release();
+
+    this->setLayout( layout.release() );
+
+    connect( &refreshTimer_, &QTimer::timeout, this, &PerformancePanel::refresh );
+}
+
+QJsonObject PerformancePanel::report()
+{
+    QJsonObject machine;
+    machine[ "os" ] = QSysInfo::prettyProductName();
+    machine[ "kernel" ] = QSysInfo::kernelVersion();
+    machine[ "cpu_architecture" ] = QSysInfo::currentCpuArchitecture();
+    machine[ "cpu_threads" ] = QThread::idealThreadCount();
+
+    QJsonObject json;
+    json[ "klogg_version" ] = QString( kloggVersion() );
+    json[ "qt_version" ] = QString::fromLatin1( qVersion() );
+    json[ "time" ] = QDateTime::currentDateTime().toString( Qt::ISODate );
+    json[ "machine" ] = machine;
+    json[ "metrics" ] = Metrics::get().toJson();
+    json[ "memory" ] = memoryJson();
+    json[ "stalls" ] = StallWatchdog::get().toJson();
+    return json;
+}
+
+void PerformancePanel::showEvent( QShowEvent* event )
+{
+    refresh();
+    refreshTimer_.start( RefreshIntervalMs );
+    QWidget::showEvent( event );
+}
+
+void PerformancePanel::hideEvent( QHideEvent* event )
+{
+    refreshTimer_.stop();
+    QWidget::hideEvent( event );
+}
+
+void PerformancePanel::refresh()
+{
+    const auto metrics = Metrics::get().toJson();
+
+    const auto scrollPosition = metricsTree_->verticalScrollBar()->value();
+    metricsTree_->clear();
+
+    auto* counters = addGroup( metricsTree_, tr( "Counters" ) );
+    const auto countersJson = metrics[ "counters" ].toObject();
+    for ( auto counter = countersJson.begin(); counter != countersJson.end(); ++counter ) {
+        counters->addChild( new QTreeWidgetItem(
+            { counter.key(), formatNumber( counter.value().toDouble() ) } ) );
+    }
+
+    auto* gauges = addGroup( metricsTree_, tr( "Gauges" ) );
+    const auto gaugesJson = metrics[ "gauges" ].toObject();
+    for ( auto gauge = gaugesJson.begin(); gauge != gaugesJson.end(); ++gauge ) {
+        gauges->addChild(
+            new QTreeWidgetItem( { gauge.key(), formatNumber( gauge.value().toDouble() ) } ) );
+    }
+
+    auto* histograms = addGroup( metricsTree_, tr( "Histograms" ) );
+    const auto histogramsJson = metrics[ "histograms" ].toObject();
+    for ( auto histogram = histogramsJson.begin(); histogram != histogramsJson.end();
+          ++histogram ) {
+        const auto values = histogram.value().toObject();
+        const auto value
+            = [ &values ]( const char* key ) { return formatNumber( values[ key ].toDouble() ); };
+        histograms->addChild( new QTreeWidgetItem( { histogram.key(), value( "sum" ),
+                                                     value( "count" ), value( "mean" ),
+                                                     value( "p50" ), value( "p90" ),
+                                                     value( "p99" ), value( "max" ) } ) );
+    }
+
+    auto* memory = addGroup( metricsTree_, tr( "Memory" ) );
+    const auto usedBytes = usedMemory();
+    memory->addChild( new QTreeWidgetItem( { tr( "process" ), readableSize( usedBytes ) } ) );
+    if ( const auto budget = MemoryGovernor::budget(); budget > 0 ) {
+        const auto usedPercent
+            = 100.0 * static_cast<double>( usedBytes ) / static_cast<double>( budget );
+        const auto budgetText
+            = tr( "%1, %2% used" ).arg( readableSize( budget ) ).arg( usedPercent, 0, 'f', 0 );
+        memory->addChild( new QTreeWidgetItem( { tr( "budget" ), budgetText } ) );
+    }
+    for ( const auto& group : MemoryGovernor::get().usage() ) {
+        auto* groupItem
+            = new QTreeWidgetItem( { group.name, readableSize( totalBytes( group ) ) } );
+        memory->addChild( groupItem );
+        for ( auto kind = 0u; kind < MemoryGovernor::KindsCount; ++kind ) {
+            if ( group.bytes[ kind ] == 0 ) {
+                continue;
+            }
+            groupItem->addChild( new QTreeWidgetItem(
+                { MemoryGovernor::kindName( static_cast<MemoryGovernor::Kind>( kind ) ),
+                  readableSize( group.bytes[ kind ] ) } ) );
+        }
+        groupItem->setExpanded( true );
+    }
+
+    auto* stalls = addGroup( metricsTree_, tr( "Stalls" ) );
+    for ( const auto& stall : StallWatchdog::get().stalls() ) {
+        const auto totalMs = static_cast<double>( stall.totalMs );
+        const auto count = static_cast<double>( stall.count );
+        stalls->addChild( new QTreeWidgetItem(
+            { stall.spans, formatNumber( totalMs ), formatNumber( count ),
+              formatNumber( totalMs / count ), {}, {}, {},
+              formatNumber( static_cast<double>( stall.maxMs ) ) } ) );
+    }
+
+    metricsTree_->verticalScrollBar()->setValue( scrollPosition );
+}
+
+void PerformancePanel::reset()
+{
+    Metrics::get().reset();
+    StallWatchdog::get().clear();
+    refresh();
+    statusBar_->showMessage( tr( "Metrics reset" ), StatusTimeout );
+}
+
+void PerformancePanel::copyJson()
+{
+    QApplication::clipboard()->setText( QJsonDocument( report() ).toJson() );
+    statusBar_->showMessage( tr( "Copied to clipboard" ), StatusTimeout );
+}
+
+void PerformancePanel::saveJson()
+{
+    auto fileName = QFileDialog::getSaveFileName( this, tr( "Export performance metrics" ), "",
+                                                  tr( "Metrics (*.json)" ) );
+    if ( fileName.isEmpty() ) {
+        return;
+    }
+
+    if ( !fileName.endsWith( ".json" ) ) {
+        fileName += ".json";
+    }
+
+    QSaveFile file( fileName );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        LOG_ERROR << "Failed to open " << fileName << " to export metrics";
+        statusBar_->showMessage( tr( "Failed to export metrics" ), StatusTimeout );
+        return;
+    }
+
+    file.write( QJsonDocument( report() ).toJson() );
+    if ( !file.commit() ) {
+        LOG_ERROR << "Failed to write metrics to " << fileName;
+        statusBar_->showMessage( tr( "Failed to export metrics" ), StatusTimeout );
+        return;
+    }
+
+    statusBar_->showMessage( tr( "Metrics exported to %1" ).arg( fileName ), StatusTimeout );
+}
+
+void PerformancePanel::saveTrace()
+{
+    auto fileName = QFileDialog::getSaveFileName( this, tr( "Export trace" ), "",
+                                                  tr( "Chrome trace (*.json)" ) );
+    if ( fileName.isEmpty() ) {
+        return;
+    }
+
+    if ( !fileName.endsWith( ".json" ) ) {
+        fileName += ".json";
+    }
+
+    QSaveFile file( fileName );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        LOG_ERROR << "Failed to open " << fileName << " to export trace";
+        statusBar_->showMessage( tr( "Failed to export trace" ), StatusTimeout );
+        return;
+    }
+
+    file.write( Tracing::get().chromeTrace() );
+    if ( !file.commit() ) {
+        LOG_ERROR << "Failed to write trace to " << fileName;
+        statusBar_->showMessage( tr( "Failed to export trace" ), StatusTimeout );
+        return;
+    }
+
+    statusBar_->showMessage( tr( "Trace exported to %1" ).arg( fileName ), StatusTimeout );
+}
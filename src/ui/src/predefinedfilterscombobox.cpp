@@ -46,6 +46,7 @@
 
 constexpr int PatternRole = Qt::UserRole + 1;
 constexpr int RegexRole = PatternRole + 1;
+constexpr int NameRole = RegexRole + 1;
 
 class QCheckListStyledItemDelegate : public QStyledItemDelegate {
   public:
@@ -119,6 +120,8 @@ void PredefinedFiltersComboBox::updateSearchPattern( const QString newSearchPatt
 
 void PredefinedFiltersComboBox::showPopup()
 {
+    Q_EMIT matchCountsRequested();
+
     if ( searchPattern_.newOne_ == searchPattern_.lastOne_ ) {
         QComboBox::showPopup();
         return;
@@ -165,6 +168,45 @@ void PredefinedFiltersComboBox::showPopup()
     QComboBox::showPopup();
 }
 
+QList<PredefinedFilter> PredefinedFiltersComboBox::filters() const
+{
+    QList<PredefinedFilter> filters;
+    for ( auto filterIndex = 0; filterIndex < model_->rowCount(); ++filterIndex ) {
+        const auto item = model_->item( filterIndex );
+        if ( !item->isCheckable() ) {
+            continue;
+        }
+
+        filters.append( { item->data( NameRole ).toString(), item->data( PatternRole ).toString(),
+                          item->data( RegexRole ).toBool() } );
+    }
+    return filters;
+}
+
+void PredefinedFiltersComboBox::setMatchCounts( const klogg::vector<LinesCount>& counts )
+{
+    ignoreCollecting_ = true;
+
+    size_t filter = 0;
+    for ( auto filterIndex = 0; filterIndex < model_->rowCount(); ++filterIndex ) {
+        const auto item = model_->item( filterIndex );
+        if ( !item->isCheckable() ) {
+            continue;
+        }
+
+        const auto name = item->data( NameRole ).toString();
+        if ( filter < counts.size() ) {
+            item->setText( tr( "%1 (%2)" ).arg( name ).arg( counts[ filter ].get() ) );
+        }
+        else {
+            item->setText( name );
+        }
+        ++filter;
+    }
+
+    ignoreCollecting_ = false;
+}
+
 void PredefinedFiltersComboBox::setTitle( const QString& title )
 {
     auto* titleItem = new QStandardItem( title );
@@ -182,6 +224,7 @@ void PredefinedFiltersComboBox::insertFilters(
 
         item->setData( filter.pattern, PatternRole );
         item->setData( filter.useRegex, RegexRole );
+        item->setData( filter.name, NameRole );
 
         model_->insertRow( model_->rowCount(), item );
     }
@@ -206,7 +249,8 @@ void PredefinedFiltersComboBox::collectFilters()
             continue;
         }
 
-        selectedPatterns.append( { item->text(), item->data( PatternRole ).toString(),
+        selectedPatterns.append( { item->data( NameRole ).toString(),
+                                   item->data( PatternRole ).toString(),
                                    item->data( RegexRole ).toBool() } );
     }
 
@@ -42,12 +42,15 @@
 // Search is started just after the selection and the selection is updated
 // if a match is found.
 
+#include <numeric>
+
 #include <QtConcurrent>
 
 #include "abstractlogdata.h"
 #include "dispatch_to.h"
 #include "linetypes.h"
 #include "log.h"
+#include "logfiltereddataworker.h"
 #include "quickfindpattern.h"
 #include "selection.h"
 
@@ -317,22 +320,40 @@ Portion QuickFind::doSearchForward( const FilePosition& start_position, const Se
     }
     else {
         searchingNotifier_.reset();
-        // And then the rest of the file
+        prepareIndex( matcher );
+        std::unique_ptr<PatternMatcher> patternMatcher;
+
+        // And then the rest of the file, lines not indexed yet are scanned in chunks
         const auto nb_lines = logData_.getNbLine();
         ++line;
-        while ( line < nb_lines ) {
-            if ( matcher.isLineMatching( logData_.getExpandedLineString( line ) ) ) {
-                std::tie( found_start_col, found_end_col ) = matcher.getLastMatch();
-                found = true;
-                break;
+        while ( line < nb_lines && !found && !interruptRequested_ ) {
+            if ( !index_.isIndexed( line ) ) {
+                auto chunkEnd = LineNumber( std::min( line.get() + SearchChunkLines,
+                                                      nb_lines.get() ) );
+                if ( index_.begin > line && index_.begin < chunkEnd ) {
+                    chunkEnd = index_.begin;
+                }
+
+                if ( !patternMatcher ) {
+                    patternMatcher = createPatternMatcher( matcher );
+                }
+                indexChunk( line, chunkEnd - line, matcher, patternMatcher.get() );
             }
-            ++line;
 
-            // See if we need to notify of the ongoing search
-            searchingNotifier_.ping( line, nb_lines, false );
+            const auto match = nextIndexedMatch( line );
+            if ( !match ) {
+                line = index_.end;
 
-            if ( interruptRequested_ ) {
-                break;
+                // See if we need to notify of the ongoing search
+                searchingNotifier_.ping( line, nb_lines, false );
+            }
+            else if ( matcher.isLineMatching( logData_.getExpandedLineString( *match ) ) ) {
+                std::tie( found_start_col, found_end_col ) = matcher.getLastMatch();
+                found = true;
+                line = *match;
+            }
+            else {
+                line = *match + 1_lcount;
             }
         }
     }
@@ -401,28 +422,40 @@ Portion QuickFind::doSearchBackward( const FilePosition& start_position, const S
     }
     else {
         searchingNotifier_.reset();
-        // And then the rest of the file
+        prepareIndex( matcher );
+        std::unique_ptr<PatternMatcher> patternMatcher;
+
+        // And then the rest of the file, lines before the search end are searched
         const auto nb_lines = logData_.getNbLine();
-        if ( line > 0_lnum ) {
-            --line;
-            while ( true ) {
-                if ( matcher.isLineMatchingBackward( logData_.getExpandedLineString( line ) ) ) {
-                    std::tie( start_col, end_col ) = matcher.getLastMatch();
-                    found = true;
-                    break;
+        auto searchEnd = std::min( line, LineNumber( nb_lines.get() ) );
+        while ( searchEnd > 0_lnum && !found && !interruptRequested_ ) {
+            if ( !index_.isIndexed( searchEnd - 1_lcount ) ) {
+                auto chunkStart
+                    = searchEnd - LinesCount( std::min( SearchChunkLines, searchEnd.get() ) );
+                if ( index_.end < searchEnd && index_.end > chunkStart ) {
+                    chunkStart = index_.end;
                 }
-                if ( line == 0_lnum ) {
-                    break;
+
+                if ( !patternMatcher ) {
+                    patternMatcher = createPatternMatcher( matcher );
                 }
+                indexChunk( chunkStart, searchEnd - chunkStart, matcher, patternMatcher.get() );
+            }
 
-                --line;
+            const auto match = previousIndexedMatch( searchEnd );
+            if ( !match ) {
+                searchEnd = index_.begin;
 
                 // See if we need to notify of the ongoing search
-                searchingNotifier_.ping( line, nb_lines, true );
-
-                if ( interruptRequested_ ) {
-                    break;
-                }
+                searchingNotifier_.ping( searchEnd, nb_lines, true );
+            }
+            else if ( matcher.isLineMatchingBackward( logData_.getExpandedLineString( *match ) ) ) {
+                std::tie( start_col, end_col ) = matcher.getLastMatch();
+                found = true;
+                line = *match;
+            }
+            else {
+                searchEnd = *match;
             }
         }
     }
@@ -451,6 +484,143 @@ Portion QuickFind::doSearchBackward( const FilePosition& start_position, const S
     }
 }
 
+void QuickFind::truncateIndex( LineNumber firstChangedLine )
+{
+    ScopedLock lock( indexTruncationMutex_ );
+    if ( !indexTruncation_ || firstChangedLine < *indexTruncation_ ) {
+        indexTruncation_ = firstChangedLine;
+    }
+}
+
+void QuickFind::prepareIndex( const QuickFindMatcher& matcher )
+{
+    OptionalLineNumber truncation;
+    {
+        ScopedLock lock( indexTruncationMutex_ );
+        std::swap( truncation, indexTruncation_ );
+    }
+
+    if ( truncation && *truncation < index_.end ) {
+        index_.end = std::max( index_.begin, *truncation );
+        index_.lines = linesBefore( index_.lines, index_.end );
+    }
+
+    const auto pattern = matcher.searchPattern();
+    if ( !( pattern == index_.pattern ) || index_.end.get() > logData_.getNbLine().get() ) {
+        LOG_DEBUG << "Quick find index is reset";
+        index_ = OccurrenceIndex{};
+        index_.pattern = pattern;
+    }
+}
+
+void QuickFind::indexChunk( LineNumber chunkStart, LinesCount chunkLines,
+                            const QuickFindMatcher& matcher, const PatternMatcher* patternMatcher )
+{
+    // Lines are prefiltered as they are matched, with tabs expanded
+    auto lines = logData_.getLines( chunkStart, chunkLines );
+    for ( auto& line : lines ) {
+        line = untabify( std::move( line ) );
+    }
+
+    roaring::Roaring64Map chunkMatches;
+    for ( const auto index : findCandidateLines( lines, patternMatcher ) ) {
+        if ( matcher.isLineMatching( lines[ index ] ) ) {
+            chunkMatches.add( chunkStart.get() + index );
+        }
+    }
+
+    const auto chunkEnd = chunkStart + chunkLines;
+    if ( index_.begin < index_.end && chunkStart == index_.end ) {
+        index_.end = chunkEnd;
+        index_.lines |= chunkMatches;
+    }
+    else if ( index_.begin < index_.end && chunkEnd == index_.begin ) {
+        index_.begin = chunkStart;
+        index_.lines |= chunkMatches;
+    }
+    else {
+        index_.begin = chunkStart;
+        index_.end = chunkEnd;
+        index_.lines = std::move( chunkMatches );
+    }
+}
+
+OptionalLineNumber QuickFind::nextIndexedMatch( LineNumber line ) const
+{
+    const auto matchesBefore = line > 0_lnum ? index_.lines.rank( line.get() - 1 ) : 0;
+
+    uint64_t match = 0;
+    if ( index_.lines.select( matchesBefore, &match ) && match < index_.end.get() ) {
+        return LineNumber( match );
+    }
+    return {};
+}
+
+OptionalLineNumber QuickFind::previousIndexedMatch( LineNumber line ) const
+{
+    const auto matchesBefore = line > 0_lnum ? index_.lines.rank( line.get() - 1 ) : 0;
+
+    uint64_t match = 0;
+    if ( matchesBefore > 0 && index_.lines.select( matchesBefore - 1, &match )
+         && match >= index_.begin.get() ) {
+        return LineNumber( match );
+    }
+    return {};
+}
+
+std::unique_ptr<PatternMatcher> QuickFind::createPatternMatcher( const QuickFindMatcher& matcher )
+{
+    const auto pattern = matcher.searchPattern();
+    if ( !expression_ || !( pattern == expressionPattern_ ) ) {
+        expressionPattern_ = pattern;
+        expression_ = std::make_unique<RegularExpression>( pattern );
+    }
+
+    if ( !expression_->isValid() ) {
+        LOG_WARNING << "Quick find pattern can't be used by searches: "
+                    << expression_->errorString();
+        return {};
+    }
+
+    return expression_->createMatcher();
+}
+
+klogg::vector<size_t> QuickFind::findCandidateLines( const klogg::vector<QString>& lines,
+                                                     const PatternMatcher* patternMatcher )
+{
+    klogg::vector<size_t> candidateLines;
+    if ( patternMatcher == nullptr ) {
+        candidateLines.resize( lines.size() );
+        std::iota( candidateLines.begin(), candidateLines.end(), size_t{ 0 } );
+        return candidateLines;
+    }
+
+    // Lines are matched as one UTF-8 text separated by line feeds, as searches do
+    QByteArray utf8Text;
+    klogg::vector<int> lineEnds;
+    lineEnds.reserve( lines.size() );
+    for ( const auto& line : lines ) {
+        utf8Text.append( line.toUtf8() );
+        lineEnds.push_back( utf8Text.size() );
+        utf8Text.append( '\n' );
+    }
+
+    klogg::vector<std::string_view> utf8Lines;
+    utf8Lines.reserve( lines.size() );
+    int lineStart = 0;
+    for ( const auto lineEnd : lineEnds ) {
+        utf8Lines.emplace_back( utf8Text.constData() + lineStart,
+                                static_cast<size_t>( lineEnd - lineStart ) );
+        lineStart = lineEnd + 1;
+    }
+
+    if ( !patternMatcher->matchLines( utf8Lines, candidateLines ) ) {
+        patternMatcher->findMatchingLines( utf8Lines, candidateLines );
+    }
+
+    return candidateLines;
+}
+
 void QuickFind::resetLimits()
 {
     lastMatch_.reset();
@@ -99,6 +99,13 @@ std::pair<LineColumn, LineColumn> QuickFindMatcher::getLastMatch() const
     return std::make_pair( lastMatchStart_, lastMatchEnd_ );
 }
 
+RegularExpressionPattern QuickFindMatcher::searchPattern() const
+{
+    const auto isCaseSensitive
+        = !regexp_.patternOptions().testFlag( QRegularExpression::CaseInsensitiveOption );
+    return RegularExpressionPattern( regexp_.pattern(), isCaseSensitive, false, false, false );
+}
+
 void QuickFindPattern::changeSearchPattern( const QString& pattern, bool isRegex )
 {
     // Determine the type of regexp depending on the config
@@ -137,10 +144,16 @@ void QuickFindPattern::changeSearchPattern( const QString& pattern, bool ignoreC
 
 bool QuickFindPattern::matchLine( const QString& line,
                                   klogg::vector<HighlightedMatch>& matches ) const
+{
+    return getMatcher().matchLine( line, matches );
+}
+
+bool QuickFindMatcher::matchLine( const QString& line,
+                                  klogg::vector<HighlightedMatch>& matches ) const
 {
     matches.clear();
 
-    if ( active_ ) {
+    if ( isActive_ ) {
         QRegularExpressionMatchIterator matchIterator = regexp_.globalMatch( line );
         const auto& config = Configuration::get();
         const auto backColor = config.qfBackColor();
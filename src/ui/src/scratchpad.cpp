@@ -28,10 +28,14 @@
 #include <QDateTime>
 #include <QDomDocument>
 #include <QFormLayout>
+#include <QFutureWatcher>
 #include <QJsonDocument>
 #include <QLineEdit>
 #include <QPlainTextEdit>
+#include <QProgressBar>
+#include <QPushButton>
 #include <QStatusBar>
+#include <QtConcurrent>
 #include <QToolBar>
 #include <QUrl>
 #include <QVBoxLayout>
@@ -54,6 +58,13 @@ QString formatDec( T value )
 
 constexpr int StatusTimeout = 2000;
 
+// Text longer than this is transformed in the background
+constexpr int BackgroundTextLength = 1024 * 1024;
+// Longer text is never a number
+constexpr int MaxNumberLength = 32;
+// Boxes are not updated on each typed character
+constexpr int BoxesUpdateDelayMs = 100;
+
 constexpr qint64 FileTimeTicks = 10000000;
 constexpr qint64 SecondsToEpoch = 11644473600LL;
 
@@ -62,6 +73,60 @@ qint64 windowsTickToUnixSeconds( qint64 windowsTicks )
     return ( windowsTicks / FileTimeTicks - SecondsToEpoch );
 }
 
+QString unixTime( const QString& text )
+{
+    bool isOk = false;
+    const auto unixTime = text.toUtf8().toLongLong( &isOk );
+    if ( isOk ) {
+        QDateTime dateTime;
+        dateTime.setTimeSpec( Qt::UTC );
+        dateTime.setSecsSinceEpoch( unixTime );
+        return dateTime.toString( Qt::ISODate );
+    }
+    else {
+        return QString{};
+    }
+}
+
+QString fileTime( const QString& text )
+{
+    bool isOk = false;
+    const auto time = text.toUtf8().toLongLong( &isOk );
+    if ( isOk ) {
+        QDateTime dateTime;
+        dateTime.setTimeSpec( Qt::UTC );
+        dateTime.setSecsSinceEpoch( windowsTickToUnixSeconds( time ) );
+        return dateTime.toString( Qt::ISODate );
+    }
+    else {
+        return QString{};
+    }
+}
+
+QString decToHex( const QString& text )
+{
+    bool isOk = false;
+    const auto value = text.toUtf8().toLongLong( &isOk );
+    if ( isOk ) {
+        return formatHex( value );
+    }
+    else {
+        return QString{};
+    }
+}
+
+QString hexToDec( const QString& text )
+{
+    bool isOk = false;
+    const auto value = text.toUtf8().toLongLong( &isOk, 16 );
+    if ( isOk ) {
+        return formatDec( value );
+    }
+    else {
+        return QString{};
+    }
+}
+
 } // namespace
 
 ScratchPad::ScratchPad( QWidget* parent )
@@ -109,44 +174,72 @@ ScratchPad::ScratchPad( QWidget* parent )
 
     auto statusBar = std::make_unique<QStatusBar>();
 
-    auto transLayout = std::make_unique<QFormLayout>();
+    auto transformProgress = std::make_unique<QProgressBar>();
+    transformProgress->setRange( 0, 0 );
+    transformProgress->setMaximumWidth( 200 );
+    transformProgress->hide();
+
+    auto cancelTransformButton = std::make_unique<QPushButton>( "Cancel" );
+    connect( cancelTransformButton.get(), &QPushButton::clicked, this,
+             &ScratchPad::cancelTransformation );
+    cancelTransformButton->hide();
 
-    auto addBoxToLayout
-        = [ &transLayout, this ]( const QString& label, QLineEdit** widget, auto changeFunction ) {
-              auto box = std::make_unique<QLineEdit>();
-              box->setReadOnly( true );
-              *widget = box.get();
-              transLayout->addRow( label, box.release() );
+    auto transLayout = std::make_unique<QFormLayout>();
 
-              connect( this, &ScratchPad::updateTransformation, this, changeFunction );
-          };
+    auto addBoxToLayout = [ &transLayout ]( const QString& label, QLineEdit** widget ) {
+        auto box = std::make_unique<QLineEdit>();
+        box->setReadOnly( true );
+        *widget = box.get();
+        transLayout->addRow( label, box.release() );
+    };
 
-    addBoxToLayout( "CRC32 hex", &crc32HexBox_, &ScratchPad::crc32Hex );
-    addBoxToLayout( "CRC32 dec", &crc32DecBox_, &ScratchPad::crc32Dec );
-    addBoxToLayout( "Unix time", &unixTimeBox_, &ScratchPad::unixTime );
-    addBoxToLayout( "File time", &fileTimeBox_, &ScratchPad::fileTime );
-    addBoxToLayout( "Dec->Hex", &decToHexBox_, &ScratchPad::decToHex );
-    addBoxToLayout( "Hex->Dec", &hexToDecBox_, &ScratchPad::hexToDec );
+    addBoxToLayout( "CRC32 hex", &crc32HexBox_ );
+    addBoxToLayout( "CRC32 dec", &crc32DecBox_ );
+    addBoxToLayout( "Unix time", &unixTimeBox_ );
+    addBoxToLayout( "File time", &fileTimeBox_ );
+    addBoxToLayout( "Dec->Hex", &decToHexBox_ );
+    addBoxToLayout( "Hex->Dec", &hexToDecBox_ );
 
     auto hLayout = std::make_unique<QHBoxLayout>();
     hLayout->addWidget( textEdit.get(), 3 );
     hLayout->addLayout( transLayout.release(), 2 );
 
     auto vLayout = std::make_unique<QVBoxLayout>();
-    vLayout->addWidget( toolBar.release() );
+    vLayout->addWidget( toolBar.get() );
     vLayout->addLayout( hLayout.release() );
     vLayout->addWidget( statusBar.get() );
 
+    statusBar->addPermanentWidget( transformProgress.get() );
+    statusBar->addPermanentWidget( cancelTransformButton.get() );
+
     textEdit_ = textEdit.release();
+    toolBar_ = toolBar.release();
     statusBar_ = statusBar.release();
+    transformProgress_ = transformProgress.release();
+    cancelTransformButton_ = cancelTransformButton.release();
 
     this->setLayout( vLayout.release() );
 
+    boxesTimer_.setSingleShot( true );
+    boxesTimer_.setInterval( BoxesUpdateDelayMs );
+    connect( &boxesTimer_, &QTimer::timeout, this, &ScratchPad::updateBoxes );
+    connect( this, &ScratchPad::updateTransformation, &boxesTimer_,
+             QOverload<>::of( &QTimer::start ) );
+
     connect( textEdit_, &QPlainTextEdit::textChanged, this, &ScratchPad::updateTransformation );
     connect( textEdit_, &QPlainTextEdit::selectionChanged, this,
              &ScratchPad::updateTransformation );
 }
 
+void ScratchPad::showEvent( QShowEvent* event )
+{
+    QWidget::showEvent( event );
+
+    if ( areBoxesOutdated_ ) {
+        updateBoxes();
+    }
+}
+
 void ScratchPad::addData( QString newData )
 {
     if ( newData.isEmpty() ) {
@@ -165,29 +258,55 @@ void ScratchPad::replaceData( QString newData )
     textEdit_->setPlainText( newData );
 }
 
-QString ScratchPad::transformText( const std::function<QString( QString )>& transform )
+QTextCursor ScratchPad::selectedTextCursor() const
 {
     auto cursor = textEdit_->textCursor();
-    auto text = cursor.selectedText();
-    if ( text.isEmpty() ) {
+    if ( !cursor.hasSelection() ) {
         cursor.select( QTextCursor::Document );
-        text = cursor.selectedText();
     }
 
-    return transform( text );
+    return cursor;
 }
 
 void ScratchPad::transformTextInPlace( const std::function<QString( QString )>& transform )
 {
-    auto cursor = textEdit_->textCursor();
+    if ( transformWatcher_ ) {
+        return;
+    }
+
+    auto cursor = selectedTextCursor();
     auto text = cursor.selectedText();
-    if ( text.isEmpty() ) {
-        cursor.select( QTextCursor::Document );
-        text = cursor.selectedText();
+
+    if ( text.size() < BackgroundTextLength ) {
+        insertTransformedText( cursor, transform( text ) );
+        return;
     }
 
-    auto transformedText = transform( text );
+    // The document is read only until the transformation finishes,
+    // so the cursor still selects the transformed text
+    transformCursor_ = cursor;
+
+    auto watcher = new QFutureWatcher<QString>( this );
+    connect( watcher, &QFutureWatcher<QString>::finished, this, [ this, watcher ] {
+        watcher->deleteLater();
+        if ( watcher != transformWatcher_ ) {
+            return;
+        }
+
+        const auto cursor = transformCursor_;
+        setTransformationRunning( false );
+        insertTransformedText( cursor, watcher->result() );
+    } );
+
+    transformWatcher_ = watcher;
+    setTransformationRunning( true );
 
+    watcher->setFuture( QtConcurrent::run(
+        [ transform, text = std::move( text ) ]() { return transform( text ); } ) );
+}
+
+void ScratchPad::insertTransformedText( QTextCursor cursor, const QString& transformedText )
+{
     if ( !transformedText.isEmpty() ) {
         cursor.insertText( transformedText );
         textEdit_->setTextCursor( cursor );
@@ -201,6 +320,80 @@ void ScratchPad::transformTextInPlace( const std::function<QString( QString )>&
     }
 }
 
+void ScratchPad::cancelTransformation()
+{
+    if ( !transformWatcher_ ) {
+        return;
+    }
+
+    // Transformations can't be interrupted, the result is dropped when it's ready
+    setTransformationRunning( false );
+    statusBar_->showMessage( "Transformation cancelled", StatusTimeout );
+}
+
+void ScratchPad::setTransformationRunning( bool isRunning )
+{
+    if ( !isRunning ) {
+        transformWatcher_ = nullptr;
+        transformCursor_ = {};
+        statusBar_->clearMessage();
+    }
+    else {
+        statusBar_->showMessage( "Transforming..." );
+    }
+
+    textEdit_->setReadOnly( isRunning );
+    toolBar_->setEnabled( !isRunning );
+    transformProgress_->setVisible( isRunning );
+    cancelTransformButton_->setVisible( isRunning );
+}
+
+void ScratchPad::updateBoxes()
+{
+    if ( !isVisible() ) {
+        areBoxesOutdated_ = true;
+        return;
+    }
+    areBoxesOutdated_ = false;
+
+    const auto text = selectedTextCursor().selectedText();
+
+    const auto isNumber = text.size() <= MaxNumberLength;
+    unixTimeBox_->setText( isNumber ? unixTime( text ) : QString{} );
+    fileTimeBox_->setText( isNumber ? fileTime( text ) : QString{} );
+    decToHexBox_->setText( isNumber ? decToHex( text ) : QString{} );
+    hexToDecBox_->setText( isNumber ? hexToDec( text ) : QString{} );
+
+    const auto setCrc32 = [ this ]( quint32 crc32 ) {
+        crc32HexBox_->setText( formatHex( crc32 ).prepend( "0x" ) );
+        crc32DecBox_->setText( formatDec( crc32 ) );
+    };
+
+    if ( text.size() < BackgroundTextLength ) {
+        crc32Watcher_ = nullptr;
+        setCrc32( Crc32::calculate( text.toUtf8() ) );
+        return;
+    }
+
+    crc32HexBox_->clear();
+    crc32DecBox_->clear();
+
+    auto watcher = new QFutureWatcher<quint32>( this );
+    connect( watcher, &QFutureWatcher<quint32>::finished, this, [ this, watcher, setCrc32 ] {
+        watcher->deleteLater();
+        if ( watcher != crc32Watcher_ ) {
+            return;
+        }
+
+        crc32Watcher_ = nullptr;
+        setCrc32( watcher->result() );
+    } );
+
+    crc32Watcher_ = watcher;
+    watcher->setFuture(
+        QtConcurrent::run( [ text ]() { return Crc32::calculate( text.toUtf8() ); } ) );
+}
+
 void ScratchPad::decodeUrl()
 {
     transformTextInPlace(
@@ -239,84 +432,6 @@ void ScratchPad::encodeHex()
     } );
 }
 
-void ScratchPad::crc32Hex()
-{
-    crc32HexBox_->setText( transformText( []( QString text ) {
-        const auto decoded = Crc32::calculate( text.toUtf8() );
-        return formatHex( decoded ).prepend( "0x" );
-    } ) );
-}
-
-void ScratchPad::crc32Dec()
-{
-    crc32DecBox_->setText( transformText( []( QString text ) {
-        const auto decoded = Crc32::calculate( text.toUtf8() );
-        return formatDec( decoded );
-    } ) );
-}
-
-void ScratchPad::unixTime()
-{
-    unixTimeBox_->setText( transformText( []( QString text ) {
-        bool isOk = false;
-        const auto unixTime = text.toUtf8().toLongLong( &isOk );
-        if ( isOk ) {
-            QDateTime dateTime;
-            dateTime.setTimeSpec( Qt::UTC );
-            dateTime.setSecsSinceEpoch( unixTime );
-            return dateTime.toString( Qt::ISODate );
-        }
-        else {
-            return QString{};
-        }
-    } ) );
-}
-
-void ScratchPad::fileTime()
-{
-    fileTimeBox_->setText( transformText( []( QString text ) {
-        bool isOk = false;
-        const auto time = text.toUtf8().toLongLong( &isOk );
-        if ( isOk ) {
-            QDateTime dateTime;
-            dateTime.setTimeSpec( Qt::UTC );
-            dateTime.setSecsSinceEpoch( windowsTickToUnixSeconds( time ) );
-            return dateTime.toString( Qt::ISODate );
-        }
-        else {
-            return QString{};
-        }
-    } ) );
-}
-
-void ScratchPad::decToHex()
-{
-    decToHexBox_->setText( transformText( []( QString text ) {
-        bool isOk = false;
-        const auto value = text.toUtf8().toLongLong( &isOk );
-        if ( isOk ) {
-            return formatHex( value );
-        }
-        else {
-            return QString{};
-        }
-    } ) );
-}
-
-void ScratchPad::hexToDec()
-{
-    hexToDecBox_->setText( transformText( []( QString text ) {
-        bool isOk = false;
-        const auto value = text.toUtf8().toLongLong( &isOk, 16 );
-        if ( isOk ) {
-            return formatDec( value );
-        }
-        else {
-            return QString{};
-        }
-    } ) );
-}
-
 void ScratchPad::formatJson()
 {
     transformTextInPlace( []( QString text ) {
@@ -156,33 +156,114 @@ LinesCount Selection::getSelectedLinesCount() const
     return selectedRange_.size();
 }
 
+std::optional<std::pair<LineNumber, LineNumber>> Selection::getSelectedRange() const
+{
+    if ( selectedRange_.startLine.has_value() ) {
+        return std::make_pair( *selectedRange_.startLine, selectedRange_.endLine );
+    }
+    return {};
+}
+
 // The tab behaviour is a bit odd at the moment, full lines are not expanded
 // but partials (part of line) are, they probably should not ideally.
 QString Selection::getSelectedText( const AbstractLogData* logData, bool lineNumbers ) const
 {
-    const auto selectionData = getSelectionWithLineNumbers( logData );
+    return getSelectedText( logData, lineNumbers, []( LinesCount ) { return true; } );
+}
+
+namespace {
+void appendLine( QString& text, bool lineNumbers, LineNumber lineNumber, const QString& line )
+{
+    if ( !text.isEmpty() ) {
+#if defined( Q_OS_WIN )
+        text.append( QChar::CarriageReturn );
+#endif
+        text.append( QChar::LineFeed );
+    }
+
+    if ( lineNumbers ) {
+        text.append( QStringLiteral( "%1: %2" ).arg( lineNumber.get() ).arg( line ) );
+    }
+    else {
+        text.append( line );
+    }
+}
+
+// Lines of ranges are not all kept in memory along with the text
+constexpr LinesCount::UnderlyingType ChunkLines = 5000;
+} // namespace
 
+QString Selection::getSelectedText( const AbstractLogData* logData, bool lineNumbers,
+                                    const std::function<bool( LinesCount )>& progress ) const
+{
     QString text;
 
-    const auto selectionSizeEstimate = std::accumulate(
-        selectionData.begin(), selectionData.end(), klogg::isize( selectionData ),
-        []( const auto& acc, const auto& next ) { return acc + next.second.size(); } );
+    const auto appendLine = [ &text, lineNumbers ]( LineNumber lineNumber, const QString& line ) {
+        ::appendLine( text, lineNumbers, lineNumber, line );
+    };
 
-    text.reserve( selectionSizeEstimate );
+    if ( !selectedRange_.startLine.has_value() ) {
+        const auto selectionData = getSelectionWithLineNumbers( logData );
+        for ( const auto& [ lineNumber, line ] : selectionData ) {
+            appendLine( lineNumber, line );
+        }
+        return text;
+    }
 
-    for ( const auto& [ lineNumber, line ] : selectionData ) {
-        if ( !text.isEmpty() ) {
-#if defined( Q_OS_WIN )
-            text.append( QChar::CarriageReturn );
-#endif
-            text.append( QChar::LineFeed );
+    const auto firstLine = *selectedRange_.startLine;
+    const auto nbLines = selectedRange_.size();
+    for ( auto linesAdded = 0_lcount; linesAdded < nbLines; ) {
+        const auto chunkStart = firstLine + linesAdded;
+        const auto chunkLines
+            = LinesCount( std::min( ChunkLines, ( nbLines - linesAdded ).get() ) );
+        const auto lines = logData->getLines( chunkStart, chunkLines );
+
+        auto line = chunkStart;
+        for ( const auto& lineText : lines ) {
+            appendLine( logData->getLineNumber( line ), lineText );
+            ++line;
         }
 
-        if ( lineNumbers ) {
-            text.append( QStringLiteral( "%1: %2" ).arg( lineNumber.get() ).arg( line ) );
+        linesAdded += chunkLines;
+        if ( !progress( linesAdded ) ) {
+            return {};
         }
-        else {
-            text.append( line );
+    }
+
+    return text;
+}
+
+QString Selection::getLinesText( const AbstractLogData* logData,
+                                 const klogg::vector<LineNumber>& lines, bool lineNumbers,
+                                 const std::function<bool( LinesCount )>& progress )
+{
+    QString text;
+
+    for ( size_t chunkStart = 0; chunkStart < lines.size(); chunkStart += ChunkLines ) {
+        const auto chunkEnd = std::min( chunkStart + ChunkLines, lines.size() );
+
+        // Consecutive lines are read at once
+        auto runStart = chunkStart;
+        while ( runStart < chunkEnd ) {
+            const auto firstLine = lines[ runStart ];
+            auto runEnd = runStart + 1;
+            if ( firstLine != maxValue<LineNumber>() ) {
+                while ( runEnd < chunkEnd
+                        && lines[ runEnd ].get() == lines[ runEnd - 1 ].get() + 1 ) {
+                    ++runEnd;
+                }
+            }
+
+            const auto runLines = logData->getLines( firstLine, LinesCount( runEnd - runStart ) );
+            for ( auto index = runStart; index < runEnd && index - runStart < runLines.size();
+                  ++index ) {
+                appendLine( text, lineNumbers, lines[ index ], runLines[ index - runStart ] );
+            }
+            runStart = runEnd;
+        }
+
+        if ( !progress( LinesCount( chunkEnd ) ) ) {
+            return {};
         }
     }
 
@@ -24,8 +24,10 @@
 #include <algorithm>
 #include <cassert>
 
+#include "configuration.h"
 #include "logdata.h"
 #include "logfiltereddata.h"
+#include "recentfiles.h"
 #include "savedsearches.h"
 #include "sessioninfo.h"
 #include "viewinterface.h"
@@ -69,6 +71,53 @@ void Session::close( const ViewInterface* view )
     openFiles_.erase( openFiles_.find( view ) );
 }
 
+void Session::loadIfDeferred( const ViewInterface* view )
+{
+    OpenFile* file = findOpenFileFromView( view );
+
+    if ( !file->isDeferred ) {
+        return;
+    }
+
+    // Other views sharing the log are loaded too
+    for ( auto& [ otherView, otherFile ] : openFiles_ ) {
+        if ( otherFile.logData == file->logData ) {
+            otherFile.isDeferred = false;
+        }
+    }
+
+    if ( !file->logData->isAttached() ) {
+        LOG_INFO << "Loading deferred file " << file->fileName;
+        file->logData->attachFile( file->fileName );
+    }
+}
+
+bool Session::isLogShared( const ViewInterface* view ) const
+{
+    const OpenFile* file = findOpenFileFromView( view );
+
+    return std::any_of( openFiles_.begin(), openFiles_.end(), [ file ]( const auto& openFile ) {
+        return openFile.second.view != file->view && openFile.second.logData == file->logData;
+    } );
+}
+
+std::shared_ptr<LogData> Session::findSharedLogData( const QString& file_name ) const
+{
+    const auto fileId = FileId::getFileId( file_name );
+    if ( fileId == FileId{} ) {
+        return {};
+    }
+
+    // Same file can be opened by another path, e.g. through a link
+    const auto sameFile = std::find_if(
+        openFiles_.begin(), openFiles_.end(), [ &file_name, &fileId ]( const auto& openFile ) {
+            return openFile.second.fileName == file_name
+                   || FileId::getFileId( openFile.second.fileName ) == fileId;
+        } );
+
+    return sameFile != openFiles_.end() ? sameFile->second.logData : nullptr;
+}
+
 QString Session::getFilename( const ViewInterface* view ) const
 {
     const OpenFile* file = findOpenFileFromView( view );
@@ -92,10 +141,18 @@ void Session::getFileInfo( const ViewInterface* view, uint64_t* fileSize, uint64
 
 ViewInterface* Session::openAlways( const QString& file_name,
                                     const std::function<ViewInterface*()>& view_factory,
-                                    const QString& view_context )
+                                    const QString& view_context, bool isDeferred )
 {
-    // Create the data objects
-    auto log_data = std::make_shared<LogData>();
+    // Create the data objects, the log of a file opened in another view is shared,
+    // so the file is indexed and watched once. Each view searches it separately.
+    auto log_data = findSharedLogData( file_name );
+    const auto isShared = log_data != nullptr;
+    if ( isShared ) {
+        LOG_INFO << "Sharing log data of " << file_name;
+    }
+    else {
+        log_data = std::make_shared<LogData>();
+    }
     auto log_filtered_data = std::shared_ptr<LogFilteredData>( log_data->getNewFilteredData() );
 
     ViewInterface* view = view_factory();
@@ -107,10 +164,14 @@ ViewInterface* Session::openAlways( const QString& file_name,
         view->setViewContext( view_context );
 
     // Insert in the hash
-    openFiles_.insert( { view, { file_name, log_data, log_filtered_data, view } } );
+    openFiles_.insert(
+        { view, { file_name, log_data, log_filtered_data, view,
+                  isDeferred && !( isShared && log_data->isAttached() ) } } );
 
     // Start loading the file
-    log_data->attachFile( file_name );
+    if ( !isDeferred && !log_data->isAttached() ) {
+        log_data->attachFile( file_name );
+    }
 
     return view;
 }
@@ -190,10 +251,24 @@ WindowSession::restore( const std::function<ViewInterface*()>& view_factory,
     LOG_DEBUG << "Session returned " << session_files.size();
     std::vector<std::pair<QString, ViewInterface*>> result;
 
+    // The current file is the last one, other files are loaded later
+    // unless they are among the most recently opened files.
+    const auto& config = Configuration::get();
+    QStringList preloadedFiles;
+    if ( !session_files.empty() ) {
+        preloadedFiles.append( session_files.back().fileName );
+    }
+    if ( config.loadSessionLazily() && config.sessionPreloadedFiles() > 0 ) {
+        preloadedFiles.append(
+            RecentFiles::get().recentFiles().mid( 0, config.sessionPreloadedFiles() ) );
+    }
+
     for ( const auto& file : session_files ) {
         LOG_DEBUG << "Create view for " << file.fileName;
-        ViewInterface* view
-            = appSession_->openAlways( file.fileName, view_factory, file.viewContext );
+        const auto isDeferred
+            = config.loadSessionLazily() && !preloadedFiles.contains( file.fileName );
+        ViewInterface* view = appSession_->openAlways( file.fileName, view_factory,
+                                                       file.viewContext, isDeferred );
         result.emplace_back( file.fileName, view );
         openedFiles_.emplace_back( file.fileName );
     }
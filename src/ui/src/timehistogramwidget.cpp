@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timehistogramwidget.h"
+
+#include <algorithm>
+
+#include <QDate>
+#include <QHelpEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QTime>
+#include <QToolTip>
+
+namespace {
+constexpr int64_t SecondsPerDay = 24 * 60 * 60;
+constexpr qint64 JulianDayOfEpoch = 2440588;
+
+// Times are shown as they are written in the file, without time zones
+QString formatTime( int64_t seconds )
+{
+    auto days = seconds / SecondsPerDay;
+    auto secondOfDay = seconds % SecondsPerDay;
+    if ( secondOfDay < 0 ) {
+        --days;
+        secondOfDay += SecondsPerDay;
+    }
+
+    const auto date = QDate::fromJulianDay( JulianDayOfEpoch + days );
+    const auto time = QTime::fromMSecsSinceStartOfDay( static_cast<int>( secondOfDay * 1000 ) );
+    return date.toString( Qt::ISODate ) + " " + time.toString( "HH:mm:ss" );
+}
+} // namespace
+
+TimeHistogramWidget::TimeHistogramWidget( QWidget* parent )
+    : QWidget( parent )
+{
+    setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Fixed );
+    setFixedHeight( fontMetrics().height() * 2 );
+    setCursor( Qt::PointingHandCursor );
+
+    // Shown when a search finds lines with timestamps
+    hide();
+}
+
+void TimeHistogramWidget::setHistogram( TimeHistogram histogram )
+{
+    histogram_ = std::move( histogram );
+    updateColumns();
+    setVisible( !histogram_.isEmpty() );
+    update();
+}
+
+bool TimeHistogramWidget::event( QEvent* event )
+{
+    if ( event->type() != QEvent::ToolTip ) {
+        return QWidget::event( event );
+    }
+
+    const auto* helpEvent = static_cast<QHelpEvent*>( event );
+    const auto column = helpEvent->pos().x();
+    if ( column < 0 || column >= klogg::isize( columns_ ) ) {
+        QToolTip::hideText();
+        event->ignore();
+        return true;
+    }
+
+    const auto& histogramColumn = columns_[ static_cast<size_t>( column ) ];
+    const auto matches = histogramColumn.isKnown
+                             ? tr( "%n match(es)", "", static_cast<int>( histogramColumn.count ) )
+                             : tr( "unknown number of matches" );
+    QToolTip::showText( helpEvent->globalPos(),
+                        tr( "%1 - %2: %3" )
+                            .arg( formatTime( columnTime( column ) ),
+                                  formatTime( columnTime( column + 1 ) ), matches ) );
+    return true;
+}
+
+void TimeHistogramWidget::paintEvent( QPaintEvent* /* paintEvent */ )
+{
+    QPainter painter( this );
+    painter.fillRect( rect(), palette().brush( QPalette::Base ) );
+
+    if ( columns_.empty() ) {
+        return;
+    }
+
+    const auto barsHeight = height() - 2;
+    for ( int column = 0; column < klogg::isize( columns_ ); ++column ) {
+        const auto& histogramColumn = columns_[ static_cast<size_t>( column ) ];
+        if ( !histogramColumn.isKnown ) {
+            // Columns with an unknown number of matches are drawn at full height, dimmed
+            painter.setPen( palette().color( QPalette::Mid ) );
+            painter.drawLine( column, height() - 1, column, height() - barsHeight );
+            continue;
+        }
+
+        const auto count = histogramColumn.count;
+        if ( count == 0 || maxCount_ == 0 ) {
+            continue;
+        }
+
+        // Intervals with any matches are visible
+        const auto barHeight = std::max(
+            1, static_cast<int>( static_cast<double>( count ) * barsHeight / maxCount_ ) );
+        painter.setPen( palette().color( QPalette::Highlight ) );
+        painter.drawLine( column, height() - 1, column, height() - barHeight );
+    }
+}
+
+void TimeHistogramWidget::mousePressEvent( QMouseEvent* mouseEvent )
+{
+    if ( mouseEvent->button() != Qt::LeftButton ) {
+        return;
+    }
+
+    // Empty columns jump to the next matches
+    const auto first = std::clamp( mouseEvent->pos().x(), 0, klogg::isize( columns_ ) );
+    const auto column
+        = std::find_if( columns_.begin() + first, columns_.end(), []( const Column& candidate ) {
+              return candidate.count > 0 || !candidate.isKnown;
+          } );
+    if ( column != columns_.end() ) {
+        Q_EMIT lineClicked( column->firstLine );
+    }
+}
+
+void TimeHistogramWidget::resizeEvent( QResizeEvent* /* resizeEvent */ )
+{
+    updateColumns();
+}
+
+void TimeHistogramWidget::updateColumns()
+{
+    columns_.clear();
+    maxCount_ = 0;
+
+    const auto buckets = histogram_.buckets();
+    if ( buckets.empty() || width() <= 0 ) {
+        return;
+    }
+
+    startTime_ = buckets.front().start;
+    endTime_ = buckets.back().start + histogram_.bucketSeconds();
+    columns_.resize( static_cast<size_t>( width() ) );
+
+    const auto secondsPerColumn
+        = static_cast<double>( endTime_ - startTime_ ) / static_cast<double>( width() );
+    const auto columnAt = [ this, secondsPerColumn ]( int64_t time ) {
+        return static_cast<int>( static_cast<double>( time - startTime_ ) / secondsPerColumn );
+    };
+
+    // Buckets wider than a column are drawn in all of their columns
+    for ( const auto& bucket : buckets ) {
+        const auto first = std::min( columnAt( bucket.start ), width() - 1 );
+        const auto last = std::max(
+            first + 1, std::min( columnAt( bucket.start + histogram_.bucketSeconds() ), width() ) );
+        for ( auto index = first; index < last; ++index ) {
+            auto& column = columns_[ static_cast<size_t>( index ) ];
+            const auto isEmpty = column.count == 0 && column.isKnown;
+            column.firstLine
+                = isEmpty ? bucket.firstLine : qMin( column.firstLine, bucket.firstLine );
+            column.count += bucket.count;
+            column.isKnown = column.isKnown && bucket.isKnown;
+            if ( column.isKnown ) {
+                maxCount_ = std::max( maxCount_, column.count );
+            }
+        }
+    }
+}
+
+int64_t TimeHistogramWidget::columnTime( int column ) const
+{
+    if ( columns_.empty() ) {
+        return startTime_;
+    }
+
+    return startTime_
+           + static_cast<int64_t>( static_cast<double>( endTime_ - startTime_ ) * column
+                                   / static_cast<double>( columns_.size() ) );
+}
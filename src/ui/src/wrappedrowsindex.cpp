@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wrappedrowsindex.h"
+
+#include <algorithm>
+
+namespace {
+size_t lowestBit( size_t index )
+{
+    return index & ( ~index + 1 );
+}
+} // namespace
+
+void WrappedRowsIndex::reset( LinesCount nbLines )
+{
+    tree_.clear();
+    blockRows_.clear();
+    lineRowsBefore_.clear();
+
+    nbLines_ = nbLines;
+    appendBlocks( blockOfLine( LineNumber( nbLines.get() + BlockLines - 1 ) ) );
+}
+
+void WrappedRowsIndex::resize( LinesCount nbLines )
+{
+    if ( nbLines == nbLines_ ) {
+        return;
+    }
+
+    // Blocks from the one with the first changed line are added again
+    const auto firstChangedBlock
+        = std::min( blockOfLine( LineNumber( std::min( nbLines, nbLines_ ).get() ) ),
+                    tree_.size() );
+    tree_.resize( firstChangedBlock );
+    blockRows_.resize( firstChangedBlock );
+    lineRowsBefore_.resize( firstChangedBlock );
+
+    nbLines_ = nbLines;
+    appendBlocks( blockOfLine( LineNumber( nbLines.get() + BlockLines - 1 ) ) );
+}
+
+LinesCount WrappedRowsIndex::nbLines() const
+{
+    return nbLines_;
+}
+
+uint64_t WrappedRowsIndex::nbRows() const
+{
+    return blocksRows( tree_.size() );
+}
+
+size_t WrappedRowsIndex::blockOfLine( LineNumber line ) const
+{
+    return static_cast<size_t>( line.get() / BlockLines );
+}
+
+LineNumber WrappedRowsIndex::firstLineOfBlock( size_t block ) const
+{
+    return LineNumber( block * BlockLines );
+}
+
+LinesCount WrappedRowsIndex::linesInBlock( size_t block ) const
+{
+    const auto firstLine = firstLineOfBlock( block ).get();
+    return LinesCount(
+        firstLine < nbLines_.get() ? std::min( BlockLines, nbLines_.get() - firstLine ) : 0 );
+}
+
+bool WrappedRowsIndex::isMeasured( size_t block ) const
+{
+    return block < lineRowsBefore_.size() && !lineRowsBefore_[ block ].empty();
+}
+
+void WrappedRowsIndex::setBlockRows( size_t block, const klogg::vector<uint64_t>& lineRows )
+{
+    if ( block >= tree_.size() || lineRows.size() != linesInBlock( block ).get() ) {
+        return;
+    }
+
+    auto& rowsBefore = lineRowsBefore_[ block ];
+    rowsBefore.resize( lineRows.size() );
+
+    // Any line takes at least one row
+    uint64_t rows = 0;
+    for ( auto line = 0u; line < lineRows.size(); ++line ) {
+        rowsBefore[ line ] = rows;
+        rows += std::max( lineRows[ line ], uint64_t{ 1 } );
+    }
+
+    addBlockRows( block, rows - blockRows_[ block ] );
+}
+
+uint64_t WrappedRowsIndex::rowsBefore( LineNumber line ) const
+{
+    if ( line.get() >= nbLines_.get() ) {
+        return nbRows();
+    }
+
+    const auto block = blockOfLine( line );
+    const auto lineInBlock = line.get() - firstLineOfBlock( block ).get();
+    return blocksRows( block )
+           + ( isMeasured( block ) ? lineRowsBefore_[ block ][ lineInBlock ] : lineInBlock );
+}
+
+LineNumber WrappedRowsIndex::lineAtRow( uint64_t row ) const
+{
+    if ( nbLines_.get() == 0 ) {
+        return 0_lnum;
+    }
+    if ( row >= nbRows() ) {
+        return LineNumber( nbLines_.get() - 1 );
+    }
+
+    // Find the number of whole blocks before the row
+    size_t step = 1;
+    while ( step * 2 <= tree_.size() ) {
+        step *= 2;
+    }
+
+    size_t block = 0;
+    auto rowInBlock = row;
+    for ( ; step > 0; step /= 2 ) {
+        if ( block + step <= tree_.size() && tree_[ block + step - 1 ] <= rowInBlock ) {
+            block += step;
+            rowInBlock -= tree_[ block - 1 ];
+        }
+    }
+
+    auto lineInBlock = rowInBlock;
+    if ( isMeasured( block ) ) {
+        const auto& rowsBefore = lineRowsBefore_[ block ];
+        const auto nextLine = std::upper_bound( rowsBefore.begin(), rowsBefore.end(), rowInBlock );
+        lineInBlock = static_cast<uint64_t>( std::distance( rowsBefore.begin(), nextLine ) - 1 );
+    }
+
+    return LineNumber( firstLineOfBlock( block ).get() + lineInBlock );
+}
+
+uint64_t WrappedRowsIndex::blocksRows( size_t endBlock ) const
+{
+    uint64_t rows = 0;
+    for ( auto index = endBlock; index > 0; index -= lowestBit( index ) ) {
+        rows += tree_[ index - 1 ];
+    }
+    return rows;
+}
+
+void WrappedRowsIndex::addBlockRows( size_t block, uint64_t rows )
+{
+    blockRows_[ block ] += rows;
+    for ( auto index = block + 1; index <= tree_.size(); index += lowestBit( index ) ) {
+        tree_[ index - 1 ] += rows;
+    }
+}
+
+void WrappedRowsIndex::appendBlocks( size_t blocksCount )
+{
+    tree_.reserve( blocksCount );
+    blockRows_.reserve( blocksCount );
+    lineRowsBefore_.reserve( blocksCount );
+
+    while ( tree_.size() < blocksCount ) {
+        const auto block = tree_.size();
+        const auto rows = linesInBlock( block ).get();
+
+        // New element sums the rows of the blocks it covers
+        const auto firstCoveredBlock = block + 1 - lowestBit( block + 1 );
+        tree_.push_back( rows + blocksRows( block ) - blocksRows( firstCoveredBlock ) );
+        blockRows_.push_back( rows );
+        lineRowsBefore_.emplace_back();
+    }
+}
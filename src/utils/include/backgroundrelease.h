@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_BACKGROUNDRELEASE_H
+#define KLOGG_BACKGROUNDRELEASE_H
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <QThreadPool>
+
+// Frees objects on a background thread. Freeing the index and the search
+// results of a large file takes seconds, so closed files give them here
+// instead of freeing them in the GUI thread. The object is freed there if
+// the given pointer is its last owner, objects are freed in the order given.
+class BackgroundRelease {
+  public:
+    static BackgroundRelease& get();
+
+    template <typename T>
+    void release( std::shared_ptr<T> object )
+    {
+        if ( object ) {
+            releaseObject( std::shared_ptr<const void>( std::move( object ) ) );
+        }
+    }
+
+    // Objects kept by value are moved out to be freed
+    template <typename T>
+    void releaseValue( T&& value )
+    {
+        release( std::make_shared<std::decay_t<T>>( std::forward<T>( value ) ) );
+    }
+
+    // Waits for the objects given so far, objects given later are freed by the caller.
+    // Called before exit, so no object is freed while the process ends.
+    void stop();
+
+  private:
+    BackgroundRelease();
+
+    void releaseObject( std::shared_ptr<const void> object );
+
+  private:
+    QThreadPool pool_;
+    std::atomic<bool> isStopped_{ false };
+};
+
+#endif
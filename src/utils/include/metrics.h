@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_METRICS_H
+#define KLOGG_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+
+#include <QJsonObject>
+#include <QString>
+
+#include "synchronization.h"
+
+// Counters, gauges and histograms of indexing, searching and drawing.
+// Metrics are created on first use and live until the process ends,
+// so call sites keep references to them:
+//
+//     static auto& searches = Metrics::get().counter( "search.runs" );
+//     searches.add();
+//
+// Names end with the unit of values, e.g. "search.duration_us".
+// Updates are lock free and can be done from any thread.
+class Metrics {
+  public:
+    class Counter {
+      public:
+        void add( uint64_t value = 1 )
+        {
+            value_.fetch_add( value, std::memory_order_relaxed );
+        }
+
+        uint64_t value() const
+        {
+            return value_.load( std::memory_order_relaxed );
+        }
+
+        void reset()
+        {
+            value_.store( 0, std::memory_order_relaxed );
+        }
+
+      private:
+        std::atomic<uint64_t> value_{};
+    };
+
+    // Last value set
+    class Gauge {
+      public:
+        void set( double value )
+        {
+            value_.store( value, std::memory_order_relaxed );
+        }
+
+        double value() const
+        {
+            return value_.load( std::memory_order_relaxed );
+        }
+
+        void reset()
+        {
+            set( 0 );
+        }
+
+      private:
+        std::atomic<double> value_{};
+    };
+
+    // Distribution of values in power of two buckets,
+    // percentiles are the upper bounds of buckets.
+    class Histogram {
+      public:
+        struct Snapshot {
+            uint64_t count = 0;
+            uint64_t sum = 0;
+            uint64_t min = 0;
+            uint64_t max = 0;
+
+            double mean() const
+            {
+                return count > 0 ? static_cast<double>( sum ) / static_cast<double>( count ) : 0;
+            }
+
+            uint64_t percentile( double fraction ) const;
+
+            std::array<uint64_t, 65> buckets{};
+        };
+
+        void record( uint64_t value );
+
+        Snapshot snapshot() const;
+
+        void reset();
+
+      private:
+        std::atomic<uint64_t> count_{};
+        std::atomic<uint64_t> sum_{};
+        std::atomic<uint64_t> min_{ UINT64_MAX };
+        std::atomic<uint64_t> max_{};
+        // Bucket 0 has zeros, bucket i has values in [2^(i-1), 2^i)
+        std::array<std::atomic<uint64_t>, 65> buckets_{};
+    };
+
+    // Records microseconds from construction to destruction
+    class ScopedTimer {
+      public:
+        explicit ScopedTimer( Histogram& histogram )
+            : histogram_( histogram )
+            , start_( std::chrono::steady_clock::now() )
+        {
+        }
+
+        ~ScopedTimer()
+        {
+            histogram_.record( static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start_ )
+                    .count() ) );
+        }
+
+        ScopedTimer( const ScopedTimer& ) = delete;
+        ScopedTimer& operator=( const ScopedTimer& ) = delete;
+
+      private:
+        Histogram& histogram_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    static Metrics& get();
+
+    Counter& counter( const QString& name );
+    Gauge& gauge( const QString& name );
+    Histogram& histogram( const QString& name );
+
+    // { "counters": { name: value }, "gauges": { name: value },
+    //   "histograms": { name: { count, sum, min, max, mean, p50, p90, p99 } } }
+    QJsonObject toJson() const;
+
+    // Values are cleared, metrics stay registered
+    void reset();
+
+  private:
+    Metrics() = default;
+
+  private:
+    mutable Mutex mutex_;
+    std::map<QString, std::unique_ptr<Counter>> counters_;
+    std::map<QString, std::unique_ptr<Gauge>> gauges_;
+    std::map<QString, std::unique_ptr<Histogram>> histograms_;
+};
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_STALLWATCHDOG_H
+#define KLOGG_STALLWATCHDOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include <QJsonArray>
+#include <QString>
+
+#include "containers.h"
+#include "synchronization.h"
+#include "tracing.h"
+
+class QTimer;
+
+// Detects stalls of the event loop of the GUI thread. A timer of the event
+// loop marks it alive, the watchdog thread checks the mark and when the loop
+// has not run for longer than the threshold it takes the names of the trace
+// spans the GUI thread is in, e.g. "paint > draw text area". Stalls are
+// aggregated by these names, stalls outside of any span are "unknown".
+class StallWatchdog {
+  public:
+    static constexpr std::chrono::milliseconds DefaultThreshold{ 250 };
+
+    struct Stalls {
+        QString spans;
+        uint64_t count = 0;
+        uint64_t totalMs = 0;
+        uint64_t maxMs = 0;
+    };
+
+    static StallWatchdog& get();
+
+    // Called in the GUI thread
+    void start( std::chrono::milliseconds threshold = DefaultThreshold );
+    void stop();
+
+    bool isRunning() const;
+
+    // Longest total duration first
+    klogg::vector<Stalls> stalls() const;
+    void clear();
+
+    // [ { "spans", "count", "total_ms", "max_ms" } ]
+    QJsonArray toJson() const;
+
+  private:
+    StallWatchdog() = default;
+
+    void watch( int64_t threshold );
+    void addStall( const klogg::vector<const char*>& spans, int64_t duration );
+
+  private:
+    std::unique_ptr<QTimer> heartbeatTimer_;
+    std::thread watchThread_;
+
+    // Nanoseconds of Tracing::now() when the event loop last ran
+    std::atomic<int64_t> heartbeat_{ 0 };
+    const OpenSpans* guiSpans_ = nullptr;
+
+    mutable Mutex mutex_;
+    std::condition_variable_any stopRequested_;
+    bool isStopping_ = false;
+    klogg::vector<Stalls> stalls_;
+};
+
+#endif
@@ -20,6 +20,9 @@
 #ifndef KLOGG_SYNCHRONIZATION_H
 #define KLOGG_SYNCHRONIZATION_H
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <mutex>
 #include <shared_mutex>
 
@@ -33,4 +36,55 @@ using SharedMutex = std::shared_mutex;
 using SharedLock = std::shared_lock<SharedMutex>;
 using UniqueLock = std::unique_lock<SharedMutex>;
 
+// Shared mutex for data read by many threads at once and rarely changed.
+// Each thread takes shared locks on its own shard, so readers on different
+// cores don't write to the same cache line. Exclusive lock takes all shards.
+// Shared lock must be released by the thread that took it.
+class ShardedSharedMutex {
+  public:
+    void lock()
+    {
+        for ( auto& shard : shards_ ) {
+            shard.mutex.lock();
+        }
+    }
+
+    void unlock()
+    {
+        for ( auto shard = shards_.rbegin(); shard != shards_.rend(); ++shard ) {
+            shard->mutex.unlock();
+        }
+    }
+
+    void lock_shared()
+    {
+        threadShard().lock_shared();
+    }
+
+    void unlock_shared()
+    {
+        threadShard().unlock_shared();
+    }
+
+  private:
+    static constexpr std::size_t ShardsCount = 16;
+
+    struct alignas( 64 ) Shard {
+        SharedMutex mutex;
+    };
+
+    SharedMutex& threadShard()
+    {
+        static std::atomic<std::size_t> threadsCount{};
+        thread_local const std::size_t shardIndex
+            = threadsCount.fetch_add( 1, std::memory_order_relaxed ) % ShardsCount;
+        return shards_[ shardIndex ].mutex;
+    }
+
+    std::array<Shard, ShardsCount> shards_;
+};
+
+using ShardedSharedLock = std::shared_lock<ShardedSharedMutex>;
+using ShardedUniqueLock = std::unique_lock<ShardedSharedMutex>;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TRACING_H
+#define KLOGG_TRACING_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include <QByteArray>
+
+#include "containers.h"
+#include "synchronization.h"
+
+// Spans of work of indexing, searching and drawing for a timeline view.
+// Spans are recorded only while tracing is enabled, each thread keeps the
+// latest of them in its own ring buffer. The trace is dumped in the Chrome
+// trace event format, it opens in chrome://tracing and ui.perfetto.dev.
+class Tracing {
+  public:
+    // Events kept for each thread, older ones are overwritten
+    static constexpr size_t EventsPerThread = 16 * 1024;
+
+    static Tracing& get();
+
+    static bool isEnabled()
+    {
+        return enabled_.load( std::memory_order_relaxed );
+    }
+
+    void setEnabled( bool isEnabled );
+
+    // Drops recorded events
+    void clear();
+
+    QByteArray chromeTrace() const;
+
+    // Nanoseconds since the start of the process
+    static int64_t now();
+
+    // Name, category and argName must be string literals
+    static void record( const char* name, const char* category, int64_t start, int64_t end,
+                        const char* argName, int64_t argValue );
+
+  private:
+    Tracing() = default;
+
+    struct Event {
+        const char* name;
+        const char* category;
+        int64_t start;
+        int64_t end;
+        const char* argName;
+        int64_t argValue;
+    };
+
+    struct ThreadBuffer {
+        Mutex mutex;
+        int threadId = 0;
+        QByteArray threadName;
+        klogg::vector<Event> events;
+        size_t next = 0;
+    };
+
+    ThreadBuffer& threadBuffer();
+
+  private:
+    static std::atomic<bool> enabled_;
+
+    mutable Mutex mutex_;
+    // Buffers of finished threads are kept for the dump
+    klogg::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+};
+
+// Names of the spans a thread is in, kept only while something reads them,
+// e.g. to tell what a stalled thread is doing. The thread pushes and pops
+// names without locks, other threads read a possibly stale copy.
+class OpenSpans {
+  public:
+    // Spans nested deeper are counted but not named
+    static constexpr int MaxDepth = 16;
+
+    static bool isTracked()
+    {
+        return tracked_.load( std::memory_order_relaxed );
+    }
+
+    static void setTracked( bool isTracked );
+
+    // Spans of the calling thread
+    static OpenSpans& current()
+    {
+        thread_local OpenSpans spans;
+        return spans;
+    }
+
+    void push( const char* name )
+    {
+        const auto depth = depth_.load( std::memory_order_relaxed );
+        if ( depth < MaxDepth ) {
+            names_[ static_cast<size_t>( depth ) ].store( name, std::memory_order_relaxed );
+        }
+        depth_.store( depth + 1, std::memory_order_release );
+    }
+
+    void pop()
+    {
+        depth_.store( depth_.load( std::memory_order_relaxed ) - 1, std::memory_order_release );
+    }
+
+    // Outermost first, called by any thread
+    klogg::vector<const char*> names() const;
+
+  private:
+    static std::atomic<bool> tracked_;
+
+    std::atomic<int> depth_{ 0 };
+    std::array<std::atomic<const char*>, MaxDepth> names_{};
+};
+
+// Records a span from construction to destruction if tracing is enabled.
+// Argument is e.g. the offset of the block or the first line of the chunk.
+class TraceSpan {
+  public:
+    TraceSpan( const char* name, const char* category, const char* argName = nullptr,
+               int64_t argValue = 0 )
+        : name_( name )
+        , category_( category )
+        , argName_( argName )
+        , argValue_( argValue )
+        , start_( Tracing::isEnabled() ? Tracing::now() : -1 )
+        , isOpenSpanTracked_( OpenSpans::isTracked() )
+    {
+        if ( isOpenSpanTracked_ ) {
+            OpenSpans::current().push( name );
+        }
+    }
+
+    ~TraceSpan()
+    {
+        if ( isOpenSpanTracked_ ) {
+            OpenSpans::current().pop();
+        }
+        if ( start_ >= 0 ) {
+            Tracing::record( name_, category_, start_, Tracing::now(), argName_, argValue_ );
+        }
+    }
+
+    TraceSpan( const TraceSpan& ) = delete;
+    TraceSpan& operator=( const TraceSpan& ) = delete;
+
+  private:
+    const char* name_;
+    const char* category_;
+    const char* argName_;
+    int64_t argValue_;
+    int64_t start_;
+    bool isOpenSpanTracked_;
+};
+
+#endif
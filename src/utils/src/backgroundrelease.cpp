@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "backgroundrelease.h"
+
+#include "runnable_lambda.h"
+#include "tracing.h"
+
+BackgroundRelease& BackgroundRelease::get()
+{
+    static auto* const instance = new BackgroundRelease;
+    return *instance;
+}
+
+BackgroundRelease::BackgroundRelease()
+{
+    pool_.setMaxThreadCount( 1 );
+    // Thread is kept between closed files, memory of several of them is often freed at once
+    pool_.setExpiryTimeout( 10 * 1000 );
+}
+
+void BackgroundRelease::releaseObject( std::shared_ptr<const void> object )
+{
+    if ( isStopped_ ) {
+        return;
+    }
+
+    pool_.start( createRunnable( [ object = std::move( object ) ]() mutable {
+        const TraceSpan span( "release", "memory" );
+        object.reset();
+    } ) );
+}
+
+void BackgroundRelease::stop()
+{
+    isStopped_ = true;
+    pool_.waitForDone();
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+size_t bucketIndex( uint64_t value )
+{
+    size_t index = 0;
+    while ( value != 0 ) {
+        value >>= 1;
+        ++index;
+    }
+    return index;
+}
+
+uint64_t bucketUpperBound( size_t index )
+{
+    if ( index == 0 ) {
+        return 0;
+    }
+    return index >= 64 ? UINT64_MAX : ( uint64_t{ 1 } << index ) - 1;
+}
+
+template <typename Metric, typename Make>
+Metric& findOrAdd( Mutex& mutex, std::map<QString, std::unique_ptr<Metric>>& metrics,
+                   const QString& name, Make make )
+{
+    ScopedLock lock( mutex );
+    auto& metric = metrics[ name ];
+    if ( !metric ) {
+        metric = make();
+    }
+    return *metric;
+}
+} // namespace
+
+uint64_t Metrics::Histogram::Snapshot::percentile( double fraction ) const
+{
+    if ( count == 0 ) {
+        return 0;
+    }
+
+    const auto rank = static_cast<uint64_t>( std::ceil( fraction * static_cast<double>( count ) ) );
+    uint64_t seen = 0;
+    for ( size_t index = 0; index < buckets.size(); ++index ) {
+        seen += buckets[ index ];
+        if ( seen >= rank ) {
+            // Values of the bucket are between the extremes
+            return std::min( std::max( bucketUpperBound( index ), min ), max );
+        }
+    }
+    return max;
+}
+
+void Metrics::Histogram::record( uint64_t value )
+{
+    count_.fetch_add( 1, std::memory_order_relaxed );
+    sum_.fetch_add( value, std::memory_order_relaxed );
+    buckets_[ bucketIndex( value ) ].fetch_add( 1, std::memory_order_relaxed );
+
+    auto min = min_.load( std::memory_order_relaxed );
+    while ( value < min
+            && !min_.compare_exchange_weak( min, value, std::memory_order_relaxed ) ) {
+    }
+
+    auto max = max_.load( std::memory_order_relaxed );
+    while ( value > max
+            && !max_.compare_exchange_weak( max, value, std::memory_order_relaxed ) ) {
+    }
+}
+
+Metrics::Histogram::Snapshot Metrics::Histogram::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.count = count_.load( std::memory_order_relaxed );
+    snapshot.sum = sum_.load( std::memory_order_relaxed );
+    snapshot.min = snapshot.count > 0 ? min_.load( std::memory_order_relaxed ) : 0;
+    snapshot.max = max_.load( std::memory_order_relaxed );
+    for ( size_t index = 0; index < buckets_.size(); ++index ) {
+        snapshot.buckets[ index ] = buckets_[ index ].load( std::memory_order_relaxed );
+    }
+    return snapshot;
+}
+
+void Metrics::Histogram::reset()
+{
+    count_.store( 0, std::memory_order_relaxed );
+    sum_.store( 0, std::memory_order_relaxed );
+    min_.store( UINT64_MAX, std::memory_order_relaxed );
+    max_.store( 0, std::memory_order_relaxed );
+    for ( auto& bucket : buckets_ ) {
+        bucket.store( 0, std::memory_order_relaxed );
+    }
+}
+
+Metrics& Metrics::get()
+{
+    static auto* const instance = new Metrics;
+    return *instance;
+}
+
+Metrics::Counter& Metrics::counter( const QString& name )
+{
+    return findOrAdd( mutex_, counters_, name, [] { return std::make_unique<Counter>(); } );
+}
+
+Metrics::Gauge& Metrics::gauge( const QString& name )
+{
+    return findOrAdd( mutex_, gauges_, name, [] { return std::make_unique<Gauge>(); } );
+}
+
+Metrics::Histogram& Metrics::histogram( const QString& name )
+{
+    return findOrAdd( mutex_, histograms_, name, [] { return std::make_unique<Histogram>(); } );
+}
+
+QJsonObject Metrics::toJson() const
+{
+    SharedLock lock( mutex_ );
+
+    QJsonObject counters;
+    for ( const auto& [ name, counter ] : counters_ ) {
+        counters[ name ] = static_cast<qint64>( counter->value() );
+    }
+
+    QJsonObject gauges;
+    for ( const auto& [ name, gauge ] : gauges_ ) {
+        gauges[ name ] = gauge->value();
+    }
+
+    QJsonObject histograms;
+    for ( const auto& [ name, histogram ] : histograms_ ) {
+        const auto snapshot = histogram->snapshot();
+
+        QJsonObject json;
+        json[ "count" ] = static_cast<qint64>( snapshot.count );
+        json[ "sum" ] = static_cast<qint64>( snapshot.sum );
+        json[ "min" ] = static_cast<qint64>( snapshot.min );
+        json[ "max" ] = static_cast<qint64>( snapshot.max );
+        json[ "mean" ] = snapshot.mean();
+        json[ "p50" ] = static_cast<qint64>( snapshot.percentile( 0.5 ) );
+        json[ "p90" ] = static_cast<qint64>( snapshot.percentile( 0.9 ) );
+        json[ "p99" ] = static_cast<qint64>( snapshot.percentile( 0.99 ) );
+        histograms[ name ] = json;
+    }
+
+    QJsonObject json;
+    json[ "counters" ] = counters;
+    json[ "gauges" ] = gauges;
+    json[ "histograms" ] = histograms;
+    return json;
+}
+
+void Metrics::reset()
+{
+    SharedLock lock( mutex_ );
+
+    for ( auto& counter : counters_ ) {
+        counter.second->reset();
+    }
+    for ( auto& gauge : gauges_ ) {
+        gauge.second->reset();
+    }
+    for ( auto& histogram : histograms_ ) {
+        histogram.second->reset();
+    }
+}
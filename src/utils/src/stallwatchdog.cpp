@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stallwatchdog.h"
+
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTimer>
+
+#include "log.h"
+#include "metrics.h"
+
+namespace {
+constexpr int64_t NanosecondsPerMs = 1000 * 1000;
+
+QString spansName( const klogg::vector<const char*>& spans )
+{
+    if ( spans.empty() ) {
+        return QStringLiteral( "unknown" );
+    }
+
+    QStringList names;
+    for ( const auto* span : spans ) {
+        names.append( QString::fromLatin1( span ) );
+    }
+    return names.join( " > " );
+}
+} // namespace
+
+StallWatchdog& StallWatchdog::get()
+{
+    static auto* const instance = new StallWatchdog;
+    return *instance;
+}
+
+void StallWatchdog::start( std::chrono::milliseconds threshold )
+{
+    if ( isRunning() ) {
+        return;
+    }
+
+    LOG_INFO << "Watching for event loop stalls longer than " << threshold.count() << " ms";
+
+    OpenSpans::setTracked( true );
+    guiSpans_ = &OpenSpans::current();
+
+    // The loop is checked a few times per threshold,
+    // so a stall is detected soon after it exceeds the threshold
+    const auto checkInterval = std::max( threshold / 4, std::chrono::milliseconds{ 10 } );
+
+    heartbeat_.store( Tracing::now(), std::memory_order_release );
+    heartbeatTimer_ = std::make_unique<QTimer>();
+    QObject::connect( heartbeatTimer_.get(), &QTimer::timeout,
+                      [ this ] { heartbeat_.store( Tracing::now(), std::memory_order_release ); } );
+    heartbeatTimer_->start( static_cast<int>( checkInterval.count() ) );
+
+    // The thread must not outlive the spans of the GUI thread
+    QObject::connect( QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                      heartbeatTimer_.get(), [ this ] { stop(); } );
+
+    {
+        ScopedLock lock( mutex_ );
+        isStopping_ = false;
+    }
+    watchThread_ = std::thread( [ this, threshold ] {
+        watch( std::chrono::duration_cast<std::chrono::nanoseconds>( threshold ).count() );
+    } );
+}
+
+void StallWatchdog::stop()
+{
+    if ( !isRunning() ) {
+        return;
+    }
+
+    {
+        ScopedLock lock( mutex_ );
+        isStopping_ = true;
+    }
+    stopRequested_.notify_one();
+    watchThread_.join();
+
+    heartbeatTimer_.reset();
+    OpenSpans::setTracked( false );
+
+    LOG_INFO << "Stopped watching for event loop stalls";
+}
+
+bool StallWatchdog::isRunning() const
+{
+    return watchThread_.joinable();
+}
+
+void StallWatchdog::watch( int64_t threshold )
+{
+    const auto checkInterval = std::chrono::nanoseconds( threshold / 4 );
+
+    // Heartbeat before the stall, negative if the loop runs
+    int64_t stallStart = -1;
+    klogg::vector<const char*> stallSpans;
+
+    ScopedLock lock( mutex_ );
+    while ( !stopRequested_.wait_for( lock, checkInterval, [ this ] { return isStopping_; } ) ) {
+        const auto heartbeat = heartbeat_.load( std::memory_order_acquire );
+        if ( Tracing::now() - heartbeat > threshold ) {
+            if ( stallStart < 0 ) {
+                stallStart = heartbeat;
+            }
+
+            // Most nested spans tell the most about the stall
+            auto spans = guiSpans_->names();
+            if ( spans.size() > stallSpans.size() ) {
+                stallSpans = std::move( spans );
+            }
+        }
+        else if ( stallStart >= 0 ) {
+            addStall( stallSpans, heartbeat - stallStart );
+            stallStart = -1;
+            stallSpans.clear();
+        }
+    }
+}
+
+void StallWatchdog::addStall( const klogg::vector<const char*>& spans, int64_t duration )
+{
+    static auto& stallDuration = Metrics::get().histogram( "gui.stall_ms" );
+
+    const auto durationMs = static_cast<uint64_t>( duration / NanosecondsPerMs );
+    const auto name = spansName( spans );
+    LOG_WARNING << "Event loop stalled for " << durationMs << " ms in " << name;
+
+    stallDuration.record( durationMs );
+
+    auto stalls = std::find_if( stalls_.begin(), stalls_.end(),
+                                [ &name ]( const auto& stall ) { return stall.spans == name; } );
+    if ( stalls == stalls_.end() ) {
+        stalls = stalls_.insert( stalls_.end(), Stalls{ name } );
+    }
+
+    stalls->count++;
+    stalls->totalMs += durationMs;
+    stalls->maxMs = std::max( stalls->maxMs, durationMs );
+}
+
+klogg::vector<StallWatchdog::Stalls> StallWatchdog::stalls() const
+{
+    klogg::vector<Stalls> stalls;
+    {
+        SharedLock lock( mutex_ );
+        stalls = stalls_;
+    }
+
+    std::sort( stalls.begin(), stalls.end(),
+               []( const auto& lhs, const auto& rhs ) { return lhs.totalMs > rhs.totalMs; } );
+    return stalls;
+}
+
+void StallWatchdog::clear()
+{
+    ScopedLock lock( mutex_ );
+    stalls_.clear();
+}
+
+QJsonArray StallWatchdog::toJson() const
+{
+    QJsonArray json;
+    for ( const auto& stall : stalls() ) {
+        QJsonObject stallJson;
+        stallJson[ "spans" ] = stall.spans;
+        stallJson[ "count" ] = static_cast<qint64>( stall.count );
+        stallJson[ "total_ms" ] = static_cast<qint64>( stall.totalMs );
+        stallJson[ "max_ms" ] = static_cast<qint64>( stall.maxMs );
+        json.append( stallJson );
+    }
+    return json;
+}
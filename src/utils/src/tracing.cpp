@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tracing.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <QCoreApplication>
+#include <QThread>
+
+namespace {
+const auto ProcessStart = std::chrono::steady_clock::now();
+
+// Chrome trace timestamps are microseconds
+QByteArray microseconds( int64_t nanoseconds )
+{
+    return QByteArray::number( static_cast<double>( nanoseconds ) / 1000.0, 'f', 3 );
+}
+
+QByteArray escaped( QByteArray text )
+{
+    return text.replace( '\\', "\\\\" ).replace( '"', "\\\"" );
+}
+} // namespace
+
+std::atomic<bool> Tracing::enabled_{ false };
+std::atomic<bool> OpenSpans::tracked_{ false };
+
+void OpenSpans::setTracked( bool isTracked )
+{
+    tracked_.store( isTracked, std::memory_order_relaxed );
+}
+
+klogg::vector<const char*> OpenSpans::names() const
+{
+    const auto depth = std::min( depth_.load( std::memory_order_acquire ), MaxDepth );
+
+    klogg::vector<const char*> names;
+    for ( auto index = 0; index < depth; ++index ) {
+        names.push_back( names_[ static_cast<size_t>( index ) ].load( std::memory_order_relaxed ) );
+    }
+    return names;
+}
+
+Tracing& Tracing::get()
+{
+    static auto* const instance = new Tracing;
+    return *instance;
+}
+
+void Tracing::setEnabled( bool isEnabled )
+{
+    enabled_.store( isEnabled, std::memory_order_relaxed );
+}
+
+void Tracing::clear()
+{
+    SharedLock lock( mutex_ );
+    for ( const auto& buffer : buffers_ ) {
+        ScopedLock bufferLock( buffer->mutex );
+        buffer->events.clear();
+        buffer->next = 0;
+    }
+}
+
+int64_t Tracing::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now()
+                                                                 - ProcessStart )
+        .count();
+}
+
+Tracing::ThreadBuffer& Tracing::threadBuffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if ( buffer ) {
+        return *buffer;
+    }
+
+    buffer = std::make_shared<ThreadBuffer>();
+
+    const auto* thread = QThread::currentThread();
+    if ( QCoreApplication::instance() && thread == QCoreApplication::instance()->thread() ) {
+        buffer->threadName = "main";
+    }
+    else if ( !thread->objectName().isEmpty() ) {
+        buffer->threadName = thread->objectName().toUtf8();
+    }
+
+    ScopedLock lock( mutex_ );
+    buffer->threadId = static_cast<int>( buffers_.size() ) + 1;
+    if ( buffer->threadName.isEmpty() ) {
+        buffer->threadName = "worker " + QByteArray::number( buffer->threadId );
+    }
+    buffers_.push_back( buffer );
+
+    return *buffer;
+}
+
+void Tracing::record( const char* name, const char* category, int64_t start, int64_t end,
+                      const char* argName, int64_t argValue )
+{
+    auto& buffer = get().threadBuffer();
+
+    // Only the dump takes the lock of the buffer besides its thread
+    ScopedLock lock( buffer.mutex );
+    const Event event{ name, category, start, end, argName, argValue };
+    if ( buffer.events.size() < EventsPerThread ) {
+        buffer.events.push_back( event );
+    }
+    else {
+        buffer.events[ buffer.next ] = event;
+    }
+    buffer.next = ( buffer.next + 1 ) % EventsPerThread;
+}
+
+QByteArray Tracing::chromeTrace() const
+{
+    const auto processId = QByteArray::number( QCoreApplication::applicationPid() );
+
+    QByteArray trace = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    SharedLock lock( mutex_ );
+    auto isFirst = true;
+    for ( const auto& buffer : buffers_ ) {
+        ScopedLock bufferLock( buffer->mutex );
+
+        const auto threadId = QByteArray::number( buffer->threadId );
+        if ( !isFirst ) {
+            trace += ",\n";
+        }
+        isFirst = false;
+
+        trace += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + processId
+                 + ",\"tid\":" + threadId + ",\"args\":{\"name\":\""
+                 + escaped( buffer->threadName ) + "\"}}";
+
+        for ( const auto& event : buffer->events ) {
+            trace += ",\n{\"name\":\"";
+            trace += event.name;
+            trace += "\",\"cat\":\"";
+            trace += event.category;
+            trace += "\",\"ph\":\"X\",\"ts\":" + microseconds( event.start )
+                     + ",\"dur\":" + microseconds( event.end - event.start ) + ",\"pid\":"
+                     + processId + ",\"tid\":" + threadId;
+            if ( event.argName ) {
+                trace += ",\"args\":{\"";
+                trace += event.argName;
+                trace += "\":" + QByteArray::number( static_cast<qint64>( event.argValue ) ) + "}";
+            }
+            trace += "}";
+        }
+    }
+
+    trace += "\n]}\n";
+    return trace;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_BENCHMARK_DATA_H
+#define KLOGG_BENCHMARK_DATA_H
+
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "containers.h"
+#include "loggenerator.h"
+
+// A few MiB of lines, about the size of an indexing block, same on every run
+inline std::string generatedBlock(
+    LogGeneratorOptions::Encoding encoding = LogGeneratorOptions::Encoding::Utf8 )
+{
+    LogGeneratorOptions options;
+    options.lines = 32 * 1024;
+    options.encoding = encoding;
+    // Byte order mark is not a part of the block
+    options.firstLine = 1;
+    options.tabDensity = 0.02;
+
+    std::ostringstream block;
+    LogGenerator( options ).write( block );
+    return block.str();
+}
+
+// Offsets of line ends after line feeds, lineFeedWidth is 2 for UTF-16
+inline klogg::vector<int64_t> lineEnds( std::string_view block, size_t lineFeedWidth = 1 )
+{
+    klogg::vector<int64_t> ends;
+    for ( size_t i = 0; i + lineFeedWidth <= block.size(); i += lineFeedWidth ) {
+        if ( block[ i ] == '\n' && ( lineFeedWidth == 1 || block[ i + 1 ] == '\0' ) ) {
+            ends.push_back( static_cast<int64_t>( i + lineFeedWidth ) );
+        }
+    }
+    return ends;
+}
+
+inline klogg::vector<std::string_view> splitLines( std::string_view block )
+{
+    klogg::vector<std::string_view> lines;
+    size_t lineStart = 0;
+    for ( const auto end : lineEnds( block ) ) {
+        lines.push_back( block.substr( lineStart, static_cast<size_t>( end ) - lineStart - 1 ) );
+        lineStart = static_cast<size_t>( end );
+    }
+    return lines;
+}
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+
+#include <QTextCodec>
+
+#include "blockpool.h"
+#include "compressedlinestorage.h"
+#include "encodingdetector.h"
+#include "logdata.h"
+#include "logdataworker.h"
+
+#include "benchmark_data.h"
+
+namespace {
+struct Encoding {
+    const char* codecName;
+    LogGeneratorOptions::Encoding encoding;
+    size_t lineFeedWidth;
+};
+
+constexpr Encoding Encodings[] = {
+    { "UTF-8", LogGeneratorOptions::Encoding::Utf8, 1 },
+    { "UTF-16LE", LogGeneratorOptions::Encoding::Utf16le, 2 },
+    { "ISO-8859-1", LogGeneratorOptions::Encoding::Latin1, 1 },
+};
+
+IndexingState indexingState( QTextCodec* codec )
+{
+    IndexingState state;
+    state.encodingGuess = codec;
+    state.fileTextCodec = codec;
+    state.encodingParams = EncodingParameters( codec );
+    return state;
+}
+
+LogData::RawLines rawLines( const std::string& block, const Encoding& encoding )
+{
+    LogData::RawLines lines;
+    lines.buffer.assign( block.begin(), block.end() );
+    for ( const auto end : lineEnds( block, encoding.lineFeedWidth ) ) {
+        lines.endOfLines.push_back( end );
+    }
+    lines.textDecoder
+        = TextCodecHolder( QTextCodec::codecForName( encoding.codecName ) ).makeDecoder();
+    return lines;
+}
+} // namespace
+
+TEST_CASE( "Parsing lines of a block", "[!benchmark][indexing]" )
+{
+    for ( const auto& encoding : Encodings ) {
+        const auto block = generatedBlock( encoding.encoding );
+        const auto state = indexingState( QTextCodec::codecForName( encoding.codecName ) );
+
+        BENCHMARK( std::string( "parseDataBlock " ) + encoding.codecName )
+        {
+            auto blockState = state;
+            return IndexOperation::parseDataBlock( 0, block, blockState ).positions.size();
+        };
+    }
+}
+
+TEST_CASE( "Compressed line positions", "[!benchmark][indexing]" )
+{
+    // Line ends of several blocks, as for a file of a few hundred megabytes
+    const auto ends = lineEnds( generatedBlock() );
+    const auto blockSize = ends.back();
+    klogg::vector<OffsetInFile> positions;
+    for ( auto block = 0; block < 64; ++block ) {
+        for ( const auto end : ends ) {
+            positions.push_back( OffsetInFile( block * blockSize + end ) );
+        }
+    }
+
+    BENCHMARK( "CompressedLinePositionStorage::append_list" )
+    {
+        CompressedLinePositionStorage storage;
+        storage.append_list( positions );
+        return storage.size();
+    };
+
+    CompressedLinePositionStorage storage;
+    storage.append_list( positions );
+
+    BENCHMARK( "CompressedLinePositionStorage::at sequential" )
+    {
+        CompressedLinePositionStorage::Cache cache;
+        OffsetInFile sum;
+        for ( auto line = 0u; line < positions.size(); ++line ) {
+            sum = sum + storage.at( line, &cache );
+        }
+        return sum;
+    };
+
+    klogg::vector<size_t> randomLines( 64 * 1024 );
+    LogRandom random( 42 );
+    std::generate( randomLines.begin(), randomLines.end(),
+                   [ & ] { return random.below( positions.size() ); } );
+
+    BENCHMARK( "CompressedLinePositionStorage::at random" )
+    {
+        OffsetInFile sum;
+        for ( const auto line : randomLines ) {
+            sum = sum + storage.at( line );
+        }
+        return sum;
+    };
+}
+
+TEST_CASE( "Block pool growth", "[!benchmark][indexing]" )
+{
+    // Many blocks are taken as the index of a big file grows
+    BENCHMARK( "BlockPool growth" )
+    {
+        BlockPool<uint64_t> pool;
+        size_t offset = 0;
+        for ( auto block = 0u; block < 64 * 1024; ++block ) {
+            pool.get_block( 256, block, &offset );
+        }
+        return pool.allocatedSize();
+    };
+}
+
+TEST_CASE( "Decoding raw lines", "[!benchmark][lines]" )
+{
+    for ( const auto& encoding : Encodings ) {
+        const auto lines = rawLines( generatedBlock( encoding.encoding ), encoding );
+
+        BENCHMARK( std::string( "RawLines::buildUtf8View " ) + encoding.codecName )
+        {
+            return lines.buildUtf8View().size();
+        };
+
+        BENCHMARK( std::string( "RawLines::decodeLines " ) + encoding.codecName )
+        {
+            return lines.decodeLines().size();
+        };
+    }
+}
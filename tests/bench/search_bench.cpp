@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <utility>
+
+#include "configuration.h"
+#include "logfiltereddataworker.h"
+#include "regularexpression.h"
+
+#include "benchmark_data.h"
+
+namespace {
+constexpr std::pair<RegexpEngine, const char*> Engines[] = {
+#ifdef KLOGG_HAS_HS
+    { RegexpEngine::Hyperscan, "hyperscan" },
+#endif
+    { RegexpEngine::QRegularExpression, "qregularexpression" },
+};
+
+size_t countMatches( const PatternMatcher& matcher,
+                     const klogg::vector<std::string_view>& lines )
+{
+    size_t matches = 0;
+    for ( const auto& line : lines ) {
+        matches += matcher.hasMatch( line ) ? 1 : 0;
+    }
+    return matches;
+}
+} // namespace
+
+TEST_CASE( "Matching lines", "[!benchmark][search]" )
+{
+    const auto block = generatedBlock();
+    const auto lines = splitLines( block );
+
+    const auto rareWord = QString::fromLatin1( LogGenerator::RareWord.data(),
+                                               static_cast<int>( LogGenerator::RareWord.size() ) );
+
+    const std::pair<const char*, RegularExpressionPattern> patterns[] = {
+        { "regex", RegularExpressionPattern( "ERROR.*" + rareWord ) },
+        { "plain", RegularExpressionPattern( rareWord, true, false, false, true ) },
+        { "boolean",
+          RegularExpressionPattern( "\"ERROR\" and not \"" + rareWord + "\"", true, false, true,
+                                    false ) },
+    };
+
+    auto& config = Configuration::get();
+    const auto savedEngine = config.regexpEngine();
+
+    for ( const auto& [ engine, engineName ] : Engines ) {
+        config.setRegexpEnging( engine );
+
+        for ( const auto& [ patternName, pattern ] : patterns ) {
+            const RegularExpression expression( pattern );
+            const auto matcher = expression.createMatcher();
+            const auto name = std::string( patternName ) + " " + engineName;
+
+            BENCHMARK( "PatternMatcher::hasMatch " + name )
+            {
+                return countMatches( *matcher, lines );
+            };
+
+            klogg::vector<size_t> matchingLines;
+            BENCHMARK( "PatternMatcher::findMatchingLines " + name )
+            {
+                matchingLines.clear();
+                matcher->findMatchingLines( lines, matchingLines );
+                return matchingLines.size();
+            };
+        }
+    }
+
+    config.setRegexpEnging( savedEngine );
+}
+
+TEST_CASE( "Merging search results", "[!benchmark][search]" )
+{
+    // Matches of chunks of a big file, as the search workers send them
+    constexpr auto ChunkLines = 64 * 1024;
+    constexpr auto Chunks = 256;
+
+    LogRandom random( 42 );
+    klogg::vector<SearchResultArray> chunks( Chunks );
+    for ( auto chunk = 0u; chunk < chunks.size(); ++chunk ) {
+        for ( auto line = 0u; line < ChunkLines; ++line ) {
+            if ( random.below( 10 ) == 0 ) {
+                chunks[ chunk ].add( static_cast<uint64_t>( chunk * ChunkLines + line ) );
+            }
+        }
+        chunks[ chunk ].runOptimize();
+    }
+
+    BENCHMARK_ADVANCED( "Roaring64Map merge in file order" )( Catch::Benchmark::Chronometer meter )
+    {
+        meter.measure( [ & ] {
+            SearchResultArray results;
+            for ( const auto& chunk : chunks ) {
+                results |= chunk;
+            }
+            return results.cardinality();
+        } );
+    };
+
+    BENCHMARK_ADVANCED( "Roaring64Map merge out of order" )( Catch::Benchmark::Chronometer meter )
+    {
+        // Parallel searches finish chunks around the first one out of order
+        meter.measure( [ & ] {
+            SearchResultArray results;
+            for ( auto chunk = 0u; chunk < chunks.size(); ++chunk ) {
+                results |= chunks[ ( chunk * 7 ) % chunks.size() ];
+            }
+            return results.cardinality();
+        } );
+    };
+}
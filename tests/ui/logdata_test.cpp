@@ -21,6 +21,7 @@
 
 #include <iostream>
 
+#include <QBuffer>
 #include <QProcess>
 #include <QSignalSpy>
 #include <QTemporaryDir>
@@ -32,6 +33,10 @@
 #include "log.h"
 #include "test_utils.h"
 
+#include "configuration.h"
+#include "filterstatistics.h"
+#include "linescomparison.h"
+#include "linesexport.h"
 #include "logdata.h"
 
 static const qint64 SL_NB_LINES = 500LL;
@@ -130,7 +135,282 @@ TEST_CASE( "Logdata decoding lines", "[logdata]" )
     const auto utf8View = rawLines.buildUtf8View();
 
     REQUIRE( rawLines.endOfLines.size() == utf8View.size() );
+
+    // Columns of ASCII lines without tabs are their bytes
+    REQUIRE( logData.getLineSize( 20_lnum ) == SL_LINE_LENGTH + 1LL );
+    REQUIRE( logData.getExpandedLineWindow( 20_lnum, 10_lcol, 30_length )
+             == logData.getExpandedLineString( 20_lnum ).mid( 10, 30 ) );
+    REQUIRE( logData.getExpandedLineWindow( 20_lnum, 70_lcol, 30_length )
+             == logData.getExpandedLineString( 20_lnum ).mid( 70, 30 ) );
+
+    // Bytes of lines are the lines with their ends of line
+    const auto linesBytes = logData.getLinesBytes( 20_lnum, 2_lcount );
+    REQUIRE( linesBytes.has_value() );
+    const auto firstLines
+        = logData.getLineString( 20_lnum ) + "\n" + logData.getLineString( 21_lnum ) + "\n";
+    REQUIRE( *linesBytes == firstLines.toUtf8() );
+
+    const auto scatteredBytes = logData.readLinesBytes( { 20_lnum, 22_lnum, 100_lnum } );
+    REQUIRE( scatteredBytes.has_value() );
+    REQUIRE( *scatteredBytes
+             == ( logData.getLineString( 20_lnum ) + "\n" + logData.getLineString( 22_lnum ) + "\n"
+                  + logData.getLineString( 100_lnum ) + "\n" )
+                    .toUtf8() );
+
+    // Exported lines are written in the asked format
+    roaring::Roaring64Map exportedLines;
+    for ( const auto line : { 20, 22, 100 } ) {
+        exportedLines.add( static_cast<uint64_t>( line ) );
+    }
+    const auto exportAs = [ &logData, &exportedLines ]( LinesExportFormat format ) {
+        QBuffer output;
+        output.open( QIODevice::WriteOnly );
+        REQUIRE( exportLines( logData, exportedLines, format, output, AtomicFlag{} ) );
+        return output.data();
+    };
+    REQUIRE( exportAs( LinesExportFormat::Lines ) == *scatteredBytes );
+    REQUIRE( exportAs( LinesExportFormat::LineNumbers ) == "21\n23\n101\n" );
+    const auto lineSize = SL_LINE_LENGTH + 1LL;
+    REQUIRE( exportAs( LinesExportFormat::ByteOffsets )
+             == QString( "%1\n%2\n%3\n" )
+                    .arg( 20 * lineSize )
+                    .arg( 22 * lineSize )
+                    .arg( 100 * lineSize )
+                    .toUtf8() );
+    const auto bitmap = exportAs( LinesExportFormat::Bitmap );
+    REQUIRE( roaring::Roaring64Map::read( bitmap.data(), true ) == exportedLines );
+
+    // Lines matching each filter are counted in one scan
+    const AtomicFlag interrupt;
+    const auto statistics = FilterStatistics::collect(
+        logData,
+        { RegularExpressionPattern( "line 00019", true, false, false, true ),
+          RegularExpressionPattern( "line 00000[0-4]", true, false, false, false ),
+          RegularExpressionPattern( "beginning of line", true, false, false, true ) },
+        interrupt );
+    REQUIRE( statistics.isValid );
+    REQUIRE( statistics.processedLines == 400_lcount );
+    REQUIRE( statistics.matches == klogg::vector<LinesCount>{ 19_lcount, 10_lcount, 1_lcount } );
+}
+
+TEST_CASE( "Logdata reading several files as one log", "[logdata]" )
+{
+    QTemporaryFile firstFile{ "testchain_XXXXXX" };
+    if ( firstFile.open() ) {
+        writeDataToFile( firstFile, 100 );
+    }
+
+    QTemporaryFile secondFile{ "testchain_XXXXXX" };
+    if ( secondFile.open() ) {
+        writeDataToFile( secondFile, 150 );
+    }
+
+    LogData logData;
+
+    SafeQSignalSpy finishedSpy( &logData, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    logData.attachFiles( { firstFile.fileName(), secondFile.fileName() } );
+
+    REQUIRE( finishedSpy.safeWait() );
+    REQUIRE( finishedSpy.count() == 1 );
+
+    REQUIRE( logData.getNbLine() == 250_lcount );
+    REQUIRE( logData.getFileSize() == 250 * ( SL_LINE_LENGTH + 1LL ) );
+
+    // Lines of the second file follow the lines of the first one
+    REQUIRE( logData.getLineString( 99_lnum ).endsWith( "line 000099" ) );
+    REQUIRE( logData.getLineString( 100_lnum ).endsWith( "line 000000" ) );
+
+    const auto linesBytes = logData.getLinesBytes( 99_lnum, 2_lcount );
+    REQUIRE( linesBytes.has_value() );
+    REQUIRE( *linesBytes
+             == ( logData.getLineString( 99_lnum ) + "\n" + logData.getLineString( 100_lnum )
+                  + "\n" )
+                    .toUtf8() );
+}
+
+TEST_CASE( "Logdata reading a file without a final line feed before another", "[logdata]" )
+{
+    QTemporaryFile firstFile{ "testchain_XXXXXX" };
+    REQUIRE( firstFile.open() );
+    REQUIRE( firstFile.write( "first line\nlast line" ) == 20 );
+    REQUIRE( firstFile.flush() );
+
+    QTemporaryFile secondFile{ "testchain_XXXXXX" };
+    REQUIRE( secondFile.open() );
+    REQUIRE( secondFile.write( "next line\n" ) == 10 );
+    REQUIRE( secondFile.flush() );
+
+    LogData logData;
+
+    SafeQSignalSpy finishedSpy( &logData, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    logData.attachFiles( { firstFile.fileName(), secondFile.fileName() } );
+
+    REQUIRE( finishedSpy.safeWait() );
+
+    // Last line of the first file is not joined with the first line of the next one
+    REQUIRE( logData.getNbLine() == 3_lcount );
+    REQUIRE( logData.getLineString( 1_lnum ) == "last line" );
+    REQUIRE( logData.getLineString( 2_lnum ) == "next line" );
+}
+
+TEST_CASE( "Logdata comparing lines of two files", "[logdata]" )
+{
+    QTemporaryFile firstFile{ "testcompare_XXXXXX" };
+    if ( firstFile.open() ) {
+        writeDataToFile( firstFile, 100 );
+    }
+
+    QTemporaryFile secondFile{ "testcompare_XXXXXX" };
+    if ( secondFile.open() ) {
+        writeDataToFile( secondFile, 150 );
+    }
+
+    LogData firstData;
+    LogData secondData;
+
+    SafeQSignalSpy firstSpy( &firstData, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    SafeQSignalSpy secondSpy( &secondData, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    firstData.attachFile( firstFile.fileName() );
+    secondData.attachFile( secondFile.fileName() );
+    REQUIRE( firstSpy.safeWait() );
+    REQUIRE( secondSpy.safeWait() );
+
+    AtomicFlag interrupt;
+
+    // The second file has more lines
+    const auto comparison = LinesComparison::compare( firstData, secondData, false, interrupt );
+    REQUIRE( comparison.has_value() );
+    REQUIRE( comparison->onlyInFirst.isEmpty() );
+    REQUIRE( comparison->onlyInSecond.cardinality() == 50 );
+    REQUIRE( comparison->onlyInSecond.minimum() == 100 );
+    REQUIRE( comparison->onlyInSecond.maximum() == 149 );
+
+    // Lines differ only by their numbers
+    const auto maskedComparison
+        = LinesComparison::compare( firstData, secondData, true, interrupt );
+    REQUIRE( maskedComparison.has_value() );
+    REQUIRE( maskedComparison->onlyInFirst.isEmpty() );
+    REQUIRE( maskedComparison->onlyInSecond.isEmpty() );
+
+    interrupt.set();
+    REQUIRE_FALSE( LinesComparison::compare( firstData, secondData, false, interrupt ) );
+}
+
+TEST_CASE( "Logdata converting lines of other encodings to UTF-8", "[logdata]" )
+{
+    const auto encoding = GENERATE( as<std::string>{}, "ISO-8859-1", "UTF-16LE", "UTF-16BE" );
+    auto* codec = QTextCodec::codecForName( encoding.c_str() );
+    REQUIRE( codec != nullptr );
+
+    const auto text = QString::fromUtf8( "caf\xC3\xA9 line\nplain line\nna\xC3\xAFve line\n" );
+    QTextCodec::ConverterState state( QTextCodec::IgnoreHeader );
+
+    QTemporaryFile file{ "testencoding_XXXXXX" };
+    REQUIRE( file.open() );
+    file.write( codec->fromUnicode( text.constData(), text.size(), &state ) );
+    file.flush();
+
+    LogData logData;
+
+    SafeQSignalSpy finishedSpy( &logData, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    logData.attachFile( file.fileName() );
+    REQUIRE( finishedSpy.safeWait() );
+
+    finishedSpy.clear();
+    logData.reload( codec );
+    REQUIRE( finishedSpy.safeWait() );
+    logData.setDisplayEncoding( encoding.c_str() );
+
+    REQUIRE( logData.getNbLine() == 3_lcount );
+
+    // Lines are converted without the codec
+    const auto rawLines = logData.getLinesRaw( 0_lnum, 3_lcount );
+    const auto utf8View = rawLines.buildUtf8View();
+    REQUIRE( utf8View.size() == 3 );
+    REQUIRE( utf8View[ 0 ] == "caf\xC3\xA9 line" );
+    REQUIRE( utf8View[ 1 ] == "plain line" );
+    REQUIRE( utf8View[ 2 ] == "na\xC3\xAFve line" );
+}
+
+TEST_CASE( "Logdata indexing small files in one pass", "[logdata]" )
+{
+    auto& config = Configuration::get();
+    const auto savedSmallFileSize = config.smallFileSizeKb();
+
+    // Small file is indexed in one pass or by the indexing graph
+    const auto smallFileSizeKb = GENERATE( 0, 1024 );
+    config.setSmallFileSizeKb( smallFileSizeKb );
+
+    QTemporaryFile file{ "testsmall_XXXXXX" };
+    REQUIRE( file.open() );
+    for ( auto i = 0; i < 1000; ++i ) {
+        file.write( QString( "small file line %1\n" ).arg( i ).toUtf8() );
+    }
+    file.write( "unterminated line" );
+    file.flush();
+
+    LogData logData;
+
+    SafeQSignalSpy finishedSpy( &logData, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    logData.attachFile( file.fileName() );
+    REQUIRE( finishedSpy.safeWait() );
+
+    REQUIRE( logData.getNbLine() == 1001_lcount );
+    REQUIRE( logData.getLineString( 0_lnum ) == "small file line 0" );
+    REQUIRE( logData.getLineString( 999_lnum ) == "small file line 999" );
+    REQUIRE( logData.getLineString( 1000_lnum ) == "unterminated line" );
+    REQUIRE( logData.getMaxLength() == LineLength( 19 ) );
+
+    config.setSmallFileSizeKb( savedSmallFileSize );
+}
+
+#ifndef Q_OS_WIN
+TEST_CASE( "Logdata reading lines from a mapped file", "[logdata]" )
+{
+    auto& config = Configuration::get();
+    const auto savedMappedFileIndexing = config.useMappedFileIndexing();
+    const auto savedMapWritableFiles = config.mapWritableFiles();
+    config.setUseMappedFileIndexing( true );
+
+    // Files that can't be written are mapped, others only if it is allowed
+    const auto isReadOnly = GENERATE( true, false );
+    const auto mapWritableFiles = GENERATE( true, false );
+    config.setMapWritableFiles( mapWritableFiles );
+
+    QTemporaryFile file{ "testmapped_XXXXXX" };
+    REQUIRE( file.open() );
+    for ( auto i = 0; i < 1000; ++i ) {
+        file.write( QString( "mapped file line %1\n" ).arg( i ).toUtf8() );
+    }
+    file.flush();
+
+    const auto permissions = file.permissions();
+    if ( isReadOnly ) {
+        REQUIRE( file.setPermissions( QFileDevice::ReadOwner ) );
+    }
+
+    {
+        LogData logData;
+
+        SafeQSignalSpy finishedSpy( &logData, SIGNAL( loadingFinished( LoadingStatus ) ) );
+        logData.attachFile( file.fileName() );
+        REQUIRE( finishedSpy.safeWait() );
+        REQUIRE( logData.getNbLine() == 1000_lcount );
+
+        const auto rawLines = logData.getLinesRaw( 500_lnum, 10_lcount );
+        REQUIRE( ( rawLines.mapping != nullptr ) == ( isReadOnly || mapWritableFiles ) );
+
+        const auto& utf8View = rawLines.buildUtf8View();
+        REQUIRE( utf8View.size() == 10 );
+        REQUIRE( utf8View[ 0 ] == "mapped file line 500" );
+        REQUIRE( utf8View[ 9 ] == "mapped file line 509" );
+    }
+
+    REQUIRE( file.setPermissions( permissions ) );
+    config.setUseMappedFileIndexing( savedMappedFileIndexing );
+    config.setMapWritableFiles( savedMapWritableFiles );
 }
+#endif
 
 TEST_CASE( "Logdata reading changing file", "[logdata]" )
 {
@@ -19,7 +19,9 @@
 
 #include <catch2/catch.hpp>
 
+#include <QRegularExpression>
 #include <QSignalSpy>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QTest>
 #include <QTimer>
@@ -29,8 +31,11 @@
 #include "log.h"
 #include "test_utils.h"
 
+#include "linesorter.h"
 #include "logdata.h"
 #include "logfiltereddata.h"
+#include "logfiltereddataworker.h"
+#include "mergedaccess.h"
 
 static const qint64 SL_NB_LINES = 500LL;
 
@@ -304,6 +309,20 @@ SCENARIO( "marks and matches in filtered log data", "[logdata]" )
                 filtered_data->addMark( 9_lnum );
                 filtered_data->addMark( 5_lnum );
 
+                AND_WHEN( "Ask for types of consecutive lines" )
+                {
+                    const auto types = filtered_data->lineTypesByLine( 4_lnum, 16_lcount );
+
+                    THEN( "Return the type of each line" )
+                    {
+                        REQUIRE( types.size() == 16 );
+                        for ( auto i = 0u; i < types.size(); ++i ) {
+                            const auto type = filtered_data->lineTypeByLine( LineNumber( 4 + i ) );
+                            REQUIRE( toFlags( types[ i ] ) == toFlags( type ) );
+                        }
+                    }
+                }
+
                 AND_WHEN( "Only marks are visible" )
                 {
                     filtered_data->setVisibility( VisibilityFlags::Marks );
@@ -563,3 +582,261 @@ SCENARIO( "marks and matches in filtered log data", "[logdata]" )
         }
     }
 }
+
+SCENARIO( "context lines in filtered log data", "[logdata]" )
+{
+    LogDataLoader logDataLoader;
+
+    GIVEN( "loaded log data" )
+    {
+        auto filtered_data = logDataLoader.log_data.getNewFilteredData();
+
+        WHEN( "Searched for regex" )
+        {
+            SafeQSignalSpy searchProgressSpy{ filtered_data.get(),
+                                              &LogFilteredData::searchProgressed };
+
+            runSearch( filtered_data.get(), "this is line [0-9]{5}9", searchProgressSpy );
+
+            AND_WHEN( "One line of context is shown" )
+            {
+                filtered_data->setContextLines( 1_lcount );
+
+                THEN( "Lines around matches are shown" )
+                {
+                    // The last match is the last line of the file
+                    REQUIRE( filtered_data->getNbLine() == 149_lcount );
+                    REQUIRE( filtered_data->getMatchingLineNumber( 0_lnum ) == 8_lnum );
+                    REQUIRE( filtered_data->getMatchingLineNumber( 3_lnum ) == 18_lnum );
+                    REQUIRE( filtered_data->getNbMatches() == 50_lcount );
+                }
+
+                THEN( "Groups of lines are separated" )
+                {
+                    const auto types = filtered_data->lineTypesByIndex( 0_lnum, 4_lcount );
+                    REQUIRE( toFlags( types[ 0 ] ) == LineTypeFlags::Plain );
+                    REQUIRE( toFlags( types[ 1 ] ) == LineTypeFlags::Match );
+                    REQUIRE( toFlags( types[ 2 ] ) == LineTypeFlags::Plain );
+                    REQUIRE( toFlags( types[ 3 ] ) == LineTypeFlags::Gap );
+
+                    REQUIRE( filtered_data->lineTypeByIndex( 3_lnum ).testFlag(
+                        LineTypeFlags::Gap ) );
+                    REQUIRE_FALSE( filtered_data->lineTypeByIndex( 4_lnum ).testFlag(
+                        LineTypeFlags::Gap ) );
+                }
+            }
+
+            AND_WHEN( "Context of matches overlaps" )
+            {
+                filtered_data->setContextLines( 5_lcount );
+
+                THEN( "Lines are shown once" )
+                {
+                    REQUIRE( filtered_data->getNbLine() == 496_lcount );
+                }
+            }
+
+            AND_WHEN( "Context is hidden again" )
+            {
+                filtered_data->setContextLines( 1_lcount );
+                filtered_data->setContextLines( 0_lcount );
+
+                THEN( "Only matches are shown" )
+                {
+                    REQUIRE( filtered_data->getNbLine() == 50_lcount );
+                }
+            }
+        }
+    }
+}
+
+SCENARIO( "search between markers in filtered log data", "[logdata]" )
+{
+    LogDataLoader logDataLoader;
+
+    GIVEN( "loaded log data" )
+    {
+        auto filtered_data = logDataLoader.log_data.getNewFilteredData();
+
+        WHEN( "Regions between markers are found" )
+        {
+            AtomicFlag interrupt;
+            const auto regions = linesBetweenMarkers(
+                logDataLoader.log_data, QRegularExpression( "line 000(100|300)" ),
+                QRegularExpression( "line 000(199|349)" ), interrupt );
+
+            THEN( "Lines from begin to end markers are found" )
+            {
+                REQUIRE( regions.has_value() );
+                REQUIRE( regions->cardinality() == 150 );
+                REQUIRE( regions->minimum() == 100 );
+                REQUIRE( regions->maximum() == 349 );
+                REQUIRE_FALSE( regions->contains( 200ull ) );
+            }
+
+            AND_WHEN( "Searched for regex in the regions" )
+            {
+                filtered_data->setSearchedLines(
+                    std::make_shared<const SearchResultArray>( *regions ) );
+
+                SafeQSignalSpy searchProgressSpy{ filtered_data.get(),
+                                                  &LogFilteredData::searchProgressed };
+
+                runSearch( filtered_data.get(), "this is line [0-9]{5}9", searchProgressSpy );
+
+                THEN( "Only matches in the regions are found" )
+                {
+                    REQUIRE( filtered_data->getNbMatches() == 15_lcount );
+                    REQUIRE( filtered_data->getMatchingLineNumber( 0_lnum ) == 109_lnum );
+                    REQUIRE( filtered_data->getMatchingLineNumber( 10_lnum ) == 309_lnum );
+                }
+
+                AND_WHEN( "All lines are searched again" )
+                {
+                    filtered_data->setSearchedLines( {} );
+                    runSearch( filtered_data.get(), "this is line [0-9]{5}9",
+                               searchProgressSpy );
+
+                    THEN( "All matches are found" )
+                    {
+                        REQUIRE( filtered_data->getNbMatches() == 50_lcount );
+                    }
+                }
+            }
+        }
+    }
+
+    GIVEN( "begin markers without an end marker" )
+    {
+        SearchResultArray beginLines;
+        beginLines.add( 10ull );
+        beginLines.add( 15ull );
+        SearchResultArray endLines;
+        endLines.add( 5ull );
+
+        THEN( "The region lasts to the end of the file" )
+        {
+            const auto lines = linesBetween( beginLines, endLines, 20_lcount );
+            REQUIRE( lines.cardinality() == 10 );
+            REQUIRE( lines.minimum() == 10 );
+            REQUIRE( lines.maximum() == 19 );
+        }
+    }
+}
+
+SCENARIO( "sorted lines in filtered log data", "[logdata]" )
+{
+    LogDataLoader logDataLoader;
+
+    GIVEN( "lines shown in reverse order" )
+    {
+        auto filtered_data = logDataLoader.log_data.getNewFilteredData();
+
+        SearchResultArray lines;
+        lines.add( 10ull );
+        lines.add( 20ull );
+        auto order = std::make_shared<LineOrder>();
+        order->lines = { 20, 10 };
+        order->positions = { 1, 0 };
+        filtered_data->showLines( lines, order );
+
+        THEN( "Lines are in the order" )
+        {
+            REQUIRE( filtered_data->getMatchingLineNumber( 0_lnum ) == 20_lnum );
+        }
+
+        WHEN( "A matched line is marked" )
+        {
+            filtered_data->setVisibility( VisibilityFlags::Matches | VisibilityFlags::Marks );
+            filtered_data->addMark( 10_lnum );
+
+            THEN( "Lines are still in the order" )
+            {
+                REQUIRE( filtered_data->getMatchingLineNumber( 0_lnum ) == 20_lnum );
+            }
+        }
+
+        WHEN( "As many other lines are marked and only marks are shown" )
+        {
+            filtered_data->setVisibility( VisibilityFlags::Marks );
+            filtered_data->addMark( 30_lnum );
+            filtered_data->addMark( 40_lnum );
+
+            THEN( "Marks are in file order" )
+            {
+                REQUIRE( filtered_data->getMatchingLineNumber( 0_lnum ) == 30_lnum );
+                REQUIRE( filtered_data->getMatchingLineNumber( 1_lnum ) == 40_lnum );
+            }
+        }
+
+        WHEN( "Matches change" )
+        {
+            filtered_data->truncateSearch( 15_lnum );
+
+            THEN( "Lines are in file order" )
+            {
+                REQUIRE( filtered_data->getMatchingLineNumber( 0_lnum ) == 10_lnum );
+            }
+        }
+    }
+}
+
+SCENARIO( "search in logs merged by time", "[logdata]" )
+{
+    QTemporaryDir dir;
+    REQUIRE( dir.isValid() );
+
+    // Lines of two services alternate every second
+    QStringList logFileNames;
+    for ( const auto& service : { QStringLiteral( "front" ), QStringLiteral( "back" ) } ) {
+        QFile log( dir.filePath( service + ".log" ) );
+        REQUIRE( log.open( QIODevice::WriteOnly ) );
+        const auto first = service == "front" ? 0 : 1;
+        for ( auto second = first; second < 2 * SL_NB_LINES; second += 2 ) {
+            log.write( QStringLiteral( "2024-01-01 10:%1:%2 %3 request %4\n" )
+                           .arg( second / 60, 2, 10, QChar( '0' ) )
+                           .arg( second % 60, 2, 10, QChar( '0' ) )
+                           .arg( service )
+                           .arg( second )
+                           .toUtf8() );
+        }
+        logFileNames.append( log.fileName() );
+    }
+
+    Configuration::getSynced().setTimestampFormat( "yyyy-MM-dd HH:mm:ss" );
+
+    const auto listFileName = dir.filePath( "services.klogg-merge" );
+    REQUIRE( MergedAccess::writeMergeList( listFileName, logFileNames ) );
+
+    LogData logData;
+    SafeQSignalSpy loadEndSpy( &logData, SIGNAL( loadingFinished( LoadingStatus ) ) );
+    logData.attachFile( listFileName );
+    REQUIRE( loadEndSpy.safeWait( 10000 ) );
+
+    GIVEN( "logs merged by time" )
+    {
+        THEN( "Lines of the services are interleaved" )
+        {
+            REQUIRE( logData.getNbLine() == LinesCount( 2 * SL_NB_LINES ) );
+            REQUIRE( logData.getLineString( 0_lnum ).contains( "front request 0" ) );
+            REQUIRE( logData.getLineString( 1_lnum ).contains( "back request 1" ) );
+            REQUIRE( logData.getLineString( 2_lnum ).contains( "front request 2" ) );
+        }
+
+        WHEN( "Searched for lines of one service" )
+        {
+            auto filtered_data = logData.getNewFilteredData();
+            SafeQSignalSpy searchProgressSpy{ filtered_data.get(),
+                                              &LogFilteredData::searchProgressed };
+
+            runSearch( filtered_data.get(), "back request [0-9]*1\\b", searchProgressSpy );
+
+            THEN( "Matches are lines of the merged view" )
+            {
+                REQUIRE( filtered_data->getNbMatches() == LinesCount( SL_NB_LINES / 5 ) );
+                REQUIRE( filtered_data->getMatchingLineNumber( 0_lnum ) == 1_lnum );
+                REQUIRE( filtered_data->getMatchingLineNumber( 1_lnum ) == 11_lnum );
+            }
+        }
+    }
+}
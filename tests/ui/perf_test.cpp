@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Throughput of indexing and searches of generated files, compared with baselines
+// measured on the same machine. Hidden from the usual run, ctest runs them
+// with the "perf" label.
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <optional>
+#include <utility>
+
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTimer>
+
+#include "configuration.h"
+#include "log.h"
+#include "logdata.h"
+#include "logfiltereddata.h"
+#include "loggenerator.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr auto Runs = 3;
+constexpr auto TimeoutMs = 120000;
+
+// Baselines in MiB/s by measurement name, from the file passed at build time
+// or in KLOGG_PERF_BASELINES. Measurements are written to the file
+// in KLOGG_PERF_RECORD to make new baselines.
+class PerfBaselines {
+  public:
+    static PerfBaselines& get()
+    {
+        static PerfBaselines baselines;
+        return baselines;
+    }
+
+    void check( const QString& name, double throughput )
+    {
+        INFO( name.toStdString() << ": " << throughput << " MiB/s" );
+        LOG_INFO << "Perf " << name << ": " << throughput << " MiB/s";
+
+        recorded_[ name ] = throughput;
+        record();
+
+        if ( !baselines_.contains( name ) ) {
+            WARN( "No baseline for " << name.toStdString() );
+            return;
+        }
+
+        const auto baseline = baselines_[ name ].toDouble();
+        INFO( "Baseline " << baseline << " MiB/s, tolerance " << tolerance_ );
+        CHECK( throughput >= baseline * ( 1 - tolerance_ ) );
+    }
+
+  private:
+    PerfBaselines()
+    {
+        auto fileName = qEnvironmentVariable( "KLOGG_PERF_BASELINES" );
+        if ( fileName.isEmpty() ) {
+            fileName = QStringLiteral( KLOGG_PERF_BASELINES );
+        }
+
+        QFile file( fileName );
+        if ( file.open( QIODevice::ReadOnly ) ) {
+            const auto json = QJsonDocument::fromJson( file.readAll() ).object();
+            tolerance_ = json[ "tolerance" ].toDouble( tolerance_ );
+            baselines_ = json[ "baselines" ].toObject();
+        }
+
+        if ( qEnvironmentVariableIsSet( "KLOGG_PERF_TOLERANCE" ) ) {
+            tolerance_ = qEnvironmentVariable( "KLOGG_PERF_TOLERANCE" ).toDouble();
+        }
+
+        recordFileName_ = qEnvironmentVariable( "KLOGG_PERF_RECORD" );
+    }
+
+    void record() const
+    {
+        if ( recordFileName_.isEmpty() ) {
+            return;
+        }
+
+        QJsonObject json;
+        json[ "tolerance" ] = tolerance_;
+        json[ "baselines" ] = recorded_;
+
+        QFile file( recordFileName_ );
+        if ( file.open( QIODevice::WriteOnly ) ) {
+            file.write( QJsonDocument( json ).toJson() );
+        }
+    }
+
+  private:
+    // Allowed slowdown from the baseline
+    double tolerance_ = 0.25;
+    QJsonObject baselines_;
+
+    QString recordFileName_;
+    QJsonObject recorded_;
+};
+
+// Buffers of the usual configuration, tests run with small ones otherwise
+class PerfConfiguration {
+  public:
+    PerfConfiguration()
+        : saved_( Configuration::get() )
+    {
+        auto& config = Configuration::get();
+        config.setIndexReadBufferSizeMb( 16 );
+        config.setSearchReadBufferSizeLines( 10000 );
+        config.setUseIndexCache( false );
+        config.setUseSearchResultsCache( false );
+        config.setKeepSearchResultsOnDisk( false );
+    }
+
+    ~PerfConfiguration()
+    {
+        Configuration::get() = saved_;
+    }
+
+    PerfConfiguration( const PerfConfiguration& ) = delete;
+    PerfConfiguration& operator=( const PerfConfiguration& ) = delete;
+
+  private:
+    Configuration saved_;
+};
+
+QString generateFile( const QTemporaryDir& dir, LogGeneratorOptions::Encoding encoding )
+{
+    LogGeneratorOptions options;
+    options.lines = 1000000;
+    options.encoding = encoding;
+    options.tabDensity = 0.02;
+    options.ansiDensity = 0.05;
+
+    const auto fileName = dir.filePath( "perf.log" );
+    std::ofstream file( QFile::encodeName( fileName ).toStdString(), std::ios::binary );
+    LogGenerator( options ).write( file );
+    return fileName;
+}
+
+double mibPerSecond( qint64 bytes, Clock::duration duration )
+{
+    const auto seconds = std::chrono::duration<double>( duration ).count();
+    return seconds > 0 ? static_cast<double>( bytes ) / ( 1024.0 * 1024.0 ) / seconds : 0;
+}
+
+// Time to index the file, nothing if it fails
+std::optional<Clock::duration> indexFile( LogData& logData, const QString& fileName )
+{
+    QEventLoop loop;
+    auto status = LoadingStatus::Interrupted;
+    QObject::connect( &logData, &LogData::loadingFinished, &loop,
+                      [ & ]( LoadingStatus loadingStatus ) {
+                          status = loadingStatus;
+                          loop.quit();
+                      } );
+    QTimer::singleShot( TimeoutMs, &loop, &QEventLoop::quit );
+
+    const auto start = Clock::now();
+    logData.attachFile( fileName );
+    loop.exec();
+
+    if ( status != LoadingStatus::Successful ) {
+        return {};
+    }
+    return Clock::now() - start;
+}
+
+// Time to search the whole file, nothing if it doesn't finish
+std::optional<Clock::duration> searchFile( LogFilteredData& filteredData,
+                                           const RegularExpressionPattern& pattern )
+{
+    filteredData.clearSearch( true );
+
+    QEventLoop loop;
+    auto isFinished = false;
+    QObject::connect( &filteredData, &LogFilteredData::searchProgressed, &loop,
+                      [ & ]( LinesCount, int progress, LineNumber ) {
+                          if ( progress == 100 ) {
+                              isFinished = true;
+                              loop.quit();
+                          }
+                      } );
+    QTimer::singleShot( TimeoutMs, &loop, &QEventLoop::quit );
+
+    const auto start = Clock::now();
+    filteredData.runSearch( pattern );
+    loop.exec();
+
+    if ( !isFinished ) {
+        return {};
+    }
+    return Clock::now() - start;
+}
+} // namespace
+
+TEST_CASE( "Indexing throughput", "[.][perf]" )
+{
+    const PerfConfiguration configuration;
+    const QTemporaryDir dir;
+
+    const std::pair<const char*, LogGeneratorOptions::Encoding> encodings[] = {
+        { "utf8", LogGeneratorOptions::Encoding::Utf8 },
+        { "utf16le", LogGeneratorOptions::Encoding::Utf16le },
+    };
+
+    for ( const auto& [ name, encoding ] : encodings ) {
+        const auto fileName = generateFile( dir, encoding );
+        const auto fileSize = QFileInfo( fileName ).size();
+
+        // Best of several runs, others are slowed down by the machine
+        double best = 0;
+        for ( auto run = 0; run < Runs; ++run ) {
+            LogData logData;
+            const auto duration = indexFile( logData, fileName );
+            REQUIRE( duration );
+            best = std::max( best, mibPerSecond( fileSize, *duration ) );
+        }
+
+        PerfBaselines::get().check( QString( "indexing_%1" ).arg( name ), best );
+    }
+}
+
+TEST_CASE( "Search throughput", "[.][perf]" )
+{
+    const PerfConfiguration configuration;
+    const QTemporaryDir dir;
+
+    const auto fileName = generateFile( dir, LogGeneratorOptions::Encoding::Utf8 );
+    const auto fileSize = QFileInfo( fileName ).size();
+
+    LogData logData;
+    REQUIRE( indexFile( logData, fileName ) );
+    auto filteredData = logData.getNewFilteredData();
+
+    const auto rareWord = QString::fromLatin1( LogGenerator::RareWord.data(),
+                                               static_cast<int>( LogGenerator::RareWord.size() ) );
+    const std::pair<const char*, RegularExpressionPattern> patterns[] = {
+        { "regex", RegularExpressionPattern( "ERROR.*" + rareWord ) },
+        { "plain", RegularExpressionPattern( rareWord, true, false, false, true ) },
+        { "boolean",
+          RegularExpressionPattern( "\"ERROR\" and not \"" + rareWord + "\"", true, false, true,
+                                    false ) },
+    };
+
+    const std::pair<const char*, RegexpEngine> engines[] = {
+#ifdef KLOGG_HAS_HS
+        { "hyperscan", RegexpEngine::Hyperscan },
+#endif
+        { "qregularexpression", RegexpEngine::QRegularExpression },
+    };
+
+    for ( const auto& [ engineName, engine ] : engines ) {
+        Configuration::get().setRegexpEnging( engine );
+
+        for ( const auto& [ patternName, pattern ] : patterns ) {
+            double best = 0;
+            for ( auto run = 0; run < Runs; ++run ) {
+                const auto duration = searchFile( *filteredData, pattern );
+                REQUIRE( duration );
+                best = std::max( best, mibPerSecond( fileSize, *duration ) );
+            }
+
+            PerfBaselines::get().check(
+                QString( "search_%1_%2" ).arg( patternName, engineName ), best );
+        }
+    }
+}
@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Frame times of the views scrolled offscreen over generated files with
+// highlighters, quick highlighters, long lines and wrapped text. Hidden from
+// the usual run like the throughput tests, ctest runs them with the "perf"
+// label. Percentiles of frames and of drawing the text area are reported
+// to compare rendering changes on the same machine.
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <QApplication>
+#include <QEventLoop>
+#include <QFile>
+#include <QSettings>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimer>
+#include <QWheelEvent>
+
+#include "configuration.h"
+#include "filteredview.h"
+#include "highlighterset.h"
+#include "log.h"
+#include "logdata.h"
+#include "logfiltereddata.h"
+#include "loggenerator.h"
+#include "logmainview.h"
+#include "metrics.h"
+#include "overview.h"
+#include "overviewwidget.h"
+#include "quickfindpattern.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr auto Frames = 200;
+constexpr auto TimeoutMs = 120000;
+constexpr auto ViewWidth = 1280;
+constexpr auto ViewHeight = 800;
+
+constexpr std::array<const char*, 10> HighlightedWords
+    = { "request", "session", "failed",  "retry",   "queue",
+        "message", "payload", "handler", "данные", "worker-[0-9]+" };
+
+struct RenderScenario {
+    const char* name;
+    size_t meanLength = 100;
+    size_t maxLength = 4096;
+    int highlighters = 0;
+    int quickHighlighters = 0;
+    bool wrap = false;
+};
+
+// Settings and highlighters of the user are restored after the test
+class RenderConfiguration {
+  public:
+    RenderConfiguration()
+        : savedConfiguration_( Configuration::get() )
+        , savedHighlighters_( HighlighterSetCollection::get() )
+    {
+        auto& config = Configuration::get();
+        config.setUseTextWrap( false );
+        config.setIndexReadBufferSizeMb( 16 );
+        config.setSearchReadBufferSizeLines( 10000 );
+        config.setUseIndexCache( false );
+    }
+
+    ~RenderConfiguration()
+    {
+        Configuration::get() = savedConfiguration_;
+        HighlighterSetCollection::get() = savedHighlighters_;
+    }
+
+    RenderConfiguration( const RenderConfiguration& ) = delete;
+    RenderConfiguration& operator=( const RenderConfiguration& ) = delete;
+
+  private:
+    Configuration savedConfiguration_;
+    HighlighterSetCollection savedHighlighters_;
+};
+
+QString generateFile( const QTemporaryDir& dir, const RenderScenario& scenario )
+{
+    LogGeneratorOptions options;
+    options.lines = 200000;
+    options.meanLength = scenario.meanLength;
+    options.maxLength = scenario.maxLength;
+    options.tabDensity = 0.02;
+    options.ansiDensity = 0.05;
+
+    const auto fileName = dir.filePath( QString( "%1.log" ).arg( scenario.name ) );
+    std::ofstream file( QFile::encodeName( fileName ).toStdString(), std::ios::binary );
+    LogGenerator( options ).write( file );
+    return fileName;
+}
+
+// Highlighter sets are only read from settings, so the set is written to a file first
+void activateHighlighters( const QTemporaryDir& dir, int count )
+{
+    auto& collection = HighlighterSetCollection::get();
+    collection.deactivateAll();
+
+    QList<QuickHighlighter> quickHighlighters;
+    for ( const auto& color : { Qt::yellow, Qt::cyan, Qt::green, Qt::magenta } ) {
+        quickHighlighters.append( { "", { Qt::black, color }, true } );
+    }
+    collection.setQuickHighlighters( quickHighlighters );
+
+    if ( count == 0 ) {
+        return;
+    }
+
+    QSettings settings( dir.filePath( "highlighters.ini" ), QSettings::IniFormat );
+    settings.beginGroup( "HighlighterSet" );
+    settings.setValue( "version", 3 );
+    settings.setValue( "name", "Render" );
+    settings.beginWriteArray( "highlighters" );
+    for ( auto i = 0; i < count; ++i ) {
+        settings.setArrayIndex( i );
+        const Highlighter highlighter(
+            HighlightedWords[ static_cast<size_t>( i ) % HighlightedWords.size() ], false,
+            i % 2 == 0, Qt::black, QColor::fromHsv( i * 360 / count, 96, 255 ) );
+        highlighter.saveToStorage( settings );
+    }
+    settings.endArray();
+    settings.endGroup();
+
+    HighlighterSet set;
+    set.retrieveFromStorage( settings );
+    collection.setHighlighterSets( { set } );
+    collection.activateSet( set.id() );
+}
+
+void showView( AbstractLogView& view, const RenderScenario& scenario )
+{
+    view.resize( ViewWidth, ViewHeight );
+    view.show();
+    REQUIRE( QTest::qWaitForWindowExposed( &view ) );
+
+    view.updateData();
+    view.textWrapSet( scenario.wrap );
+
+    std::vector<AbstractLogView::QuickHighlighters> quickHighlighters;
+    for ( auto i = 0; i < scenario.quickHighlighters; ++i ) {
+        quickHighlighters.push_back(
+            { HighlightedWords[ HighlightedWords.size() - 2 - static_cast<size_t>( i ) ] } );
+    }
+    view.setQuickHighlighters( quickHighlighters );
+}
+
+void wheelDown( QWidget* viewport )
+{
+    const QPointF position( viewport->width() / 2, viewport->height() / 2 );
+    const QPointF globalPosition( viewport->mapToGlobal( position.toPoint() ) );
+    QWheelEvent event( position, globalPosition, QPoint{}, QPoint{ 0, -120 }, Qt::NoButton,
+                       Qt::NoModifier, Qt::NoScrollPhase, false );
+    QCoreApplication::sendEvent( viewport, &event );
+}
+
+// Time to paint each frame after a change of the view, in microseconds.
+// Highlights matched in the background are drawn by later frames, as they are
+// when the user scrolls.
+std::vector<uint64_t> paintFrames( AbstractLogView& view, const std::function<void()>& change )
+{
+    view.jumpToLine( 0_lnum );
+    view.viewport()->repaint();
+    QCoreApplication::processEvents();
+    Metrics::get().reset();
+
+    std::vector<uint64_t> frames;
+    frames.reserve( Frames );
+    for ( auto frame = 0; frame < Frames; ++frame ) {
+        change();
+
+        const auto start = Clock::now();
+        view.viewport()->repaint();
+        frames.push_back( static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>( Clock::now() - start )
+                .count() ) );
+
+        QCoreApplication::processEvents();
+    }
+    return frames;
+}
+
+void report( const QString& name, std::vector<uint64_t> frames )
+{
+    std::sort( frames.begin(), frames.end() );
+    const auto percentile = [ &frames ]( double fraction ) {
+        return frames[ static_cast<size_t>( fraction * static_cast<double>( frames.size() - 1 ) ) ];
+    };
+
+    const auto drawing = Metrics::get().histogram( "view.draw_text_area_us" ).snapshot();
+    const auto drawings = Metrics::get().counter( "view.text_area_drawings" ).value();
+
+    const auto text
+        = QString( "%1: frame p50 %2 us, p90 %3 us, p99 %4 us, max %5 us; "
+                   "text area p50 %6 us, p99 %7 us, %8 full redraws" )
+              .arg( name )
+              .arg( percentile( 0.5 ) )
+              .arg( percentile( 0.9 ) )
+              .arg( percentile( 0.99 ) )
+              .arg( frames.back() )
+              .arg( drawing.percentile( 0.5 ) )
+              .arg( drawing.percentile( 0.99 ) )
+              .arg( drawings );
+
+    LOG_INFO << "Perf " << text;
+    WARN( text.toStdString() );
+    CHECK( drawing.count > 0 );
+}
+
+void measureView( AbstractLogView& view, const QString& name )
+{
+    report( name + "_wheel", paintFrames( view, [ &view ] { wheelDown( view.viewport() ); } ) );
+    report( name + "_pagedown",
+            paintFrames( view, [ &view ] { QTest::keyClick( &view, Qt::Key_PageDown ); } ) );
+
+    // Each frame is drawn again with a new pattern to highlight
+    auto isOdd = false;
+    report( name + "_highlight", paintFrames( view, [ &view, &isOdd ] {
+                isOdd = !isOdd;
+                view.setSearchPattern( RegularExpressionPattern( isOdd ? "retry" : "queue" ) );
+            } ) );
+    view.setSearchPattern( {} );
+}
+
+bool indexFile( LogData& logData, const QString& fileName )
+{
+    QEventLoop loop;
+    auto status = LoadingStatus::Interrupted;
+    QObject::connect( &logData, &LogData::loadingFinished, &loop,
+                      [ & ]( LoadingStatus loadingStatus ) {
+                          status = loadingStatus;
+                          loop.quit();
+                      } );
+    QTimer::singleShot( TimeoutMs, &loop, &QEventLoop::quit );
+
+    logData.attachFile( fileName );
+    loop.exec();
+    return status == LoadingStatus::Successful;
+}
+
+bool searchFile( LogFilteredData& filteredData, const RegularExpressionPattern& pattern )
+{
+    QEventLoop loop;
+    auto isFinished = false;
+    QObject::connect( &filteredData, &LogFilteredData::searchProgressed, &loop,
+                      [ & ]( LinesCount, int progress, LineNumber ) {
+                          if ( progress == 100 ) {
+                              isFinished = true;
+                              loop.quit();
+                          }
+                      } );
+    QTimer::singleShot( TimeoutMs, &loop, &QEventLoop::quit );
+
+    filteredData.runSearch( pattern );
+    loop.exec();
+    return isFinished;
+}
+} // namespace
+
+TEST_CASE( "Rendering frame time", "[.][perf][render]" )
+{
+    const RenderConfiguration configuration;
+    const QTemporaryDir dir;
+
+    const RenderScenario scenarios[] = {
+        { "plain" },
+        { "highlighters", 100, 4096, 10, 0, false },
+        { "quick_highlighters", 100, 4096, 0, 2, false },
+        { "long_lines", 3000, 30000, 10, 2, false },
+        { "wrapped", 300, 4096, 10, 2, true },
+    };
+
+    for ( const auto& scenario : scenarios ) {
+        activateHighlighters( dir, scenario.highlighters );
+
+        LogData logData;
+        REQUIRE( indexFile( logData, generateFile( dir, scenario ) ) );
+
+        QuickFindPattern quickFindPattern;
+
+        {
+            Overview overview;
+            overview.setVisible( Configuration::get().isOverviewVisible() );
+            overview.updateData( logData.getNbLine() );
+
+            // The view owns the overview widget, as in the crawler widget
+            auto* overviewWidget = new OverviewWidget();
+            LogMainView view( &logData, &quickFindPattern, &overview, overviewWidget );
+            overviewWidget->setOverview( &overview );
+            overviewWidget->setParent( &view );
+
+            showView( view, scenario );
+            measureView( view, QString( "render_main_%1" ).arg( scenario.name ) );
+        }
+
+        {
+            auto filteredData = logData.getNewFilteredData();
+            REQUIRE( searchFile( *filteredData, RegularExpressionPattern( "ERROR|WARN" ) ) );
+
+            FilteredView view( filteredData.get(), &quickFindPattern );
+            showView( view, scenario );
+            measureView( view, QString( "render_filtered_%1" ).arg( scenario.name ) );
+        }
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "agentprotocol.h"
+
+TEST_CASE( "Agent messages are split from received data", "[agentprotocol]" )
+{
+    const auto first = agent::encodeMessage( agent::MessageType::GetLines,
+                                             agent::writePayload( quint64{ 10 }, quint64{ 20 } ) );
+    const auto second = agent::encodeMessage( agent::MessageType::StopSearch );
+
+    agent::MessageReader reader;
+
+    SECTION( "Message is read once all its data is received" )
+    {
+        const auto data = first + second;
+        reader.append( data.left( 5 ) );
+        REQUIRE_FALSE( reader.next().has_value() );
+
+        reader.append( data.mid( 5 ) );
+        const auto message = reader.next();
+        REQUIRE( message.has_value() );
+        REQUIRE( message->type == agent::MessageType::GetLines );
+
+        quint64 firstLine = 0;
+        quint64 count = 0;
+        REQUIRE( agent::readPayload( message->payload, firstLine, count ) );
+        REQUIRE( firstLine == 10 );
+        REQUIRE( count == 20 );
+
+        const auto stop = reader.next();
+        REQUIRE( stop.has_value() );
+        REQUIRE( stop->type == agent::MessageType::StopSearch );
+        REQUIRE( stop->payload.isEmpty() );
+        REQUIRE_FALSE( reader.next().has_value() );
+    }
+
+    SECTION( "Payload with fewer values is not read" )
+    {
+        reader.append( second );
+        quint64 value = 0;
+        REQUIRE_FALSE( agent::readPayload( reader.next()->payload, value ) );
+    }
+
+    SECTION( "Oversized message breaks the stream" )
+    {
+        reader.append( QByteArray( "\xff\xff\xff\xff\x01", 5 ) );
+        REQUIRE_FALSE( reader.next().has_value() );
+        REQUIRE( reader.isBroken() );
+    }
+}
+
+TEST_CASE( "Agent matching lines are sent as bitmaps", "[agentprotocol]" )
+{
+    SearchResultArray lines;
+    for ( uint64_t line = 100; line < 200; ++line ) {
+        lines.add( line );
+    }
+    lines.add( uint64_t{ 5'000'000'000 } );
+
+    const auto decoded = agent::decodeLines( agent::encodeLines( lines ) );
+    REQUIRE( decoded.has_value() );
+    REQUIRE( *decoded == lines );
+
+    REQUIRE_FALSE( agent::decodeLines( QByteArray( "\x05\x00", 2 ) ).has_value() );
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "ansicolorsequences.h"
+
+#include <random>
+#include <regex>
+#include <string>
+
+namespace {
+std::string strip( std::string text )
+{
+    text.resize( stripAnsiColorSequences( text, text.data() ) );
+    return text;
+}
+} // namespace
+
+SCENARIO( "ANSI color sequences are removed from text", "[ansicolorsequences]" )
+{
+    GIVEN( "Text with color sequences" )
+    {
+        const std::string text = "\x1B[1;31mERROR\x1B[0m: \x1B[Kdone\x1B[32M ok\x1B[m";
+
+        THEN( "Sequences are removed" )
+        {
+            REQUIRE( strip( text ) == "ERROR: done ok" );
+        }
+    }
+
+    GIVEN( "Text with incomplete sequences" )
+    {
+        const std::string text = "\x1B[123m \x1B[1;m \x1B[;1m \x1B[1;234m \x1B[1 \x1B \x1B[";
+
+        THEN( "Text is not changed" )
+        {
+            REQUIRE( strip( text ) == text );
+        }
+    }
+
+    GIVEN( "Random text with escapes" )
+    {
+        const std::regex colorSequence( AnsiColorSequenceRegex, std::regex::icase );
+        const std::string alphabet = "\x1B[;0123456789mMkKa\n";
+
+        std::mt19937 generator( 42 );
+        for ( auto i = 0; i < 2000; ++i ) {
+            std::string text;
+            const auto length = generator() % 40;
+            for ( size_t c = 0; c < length; ++c ) {
+                text.push_back( alphabet[ generator() % alphabet.size() ] );
+            }
+
+            REQUIRE( strip( text ) == std::regex_replace( text, colorSequence, "" ) );
+        }
+    }
+}
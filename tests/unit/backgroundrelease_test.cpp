@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "backgroundrelease.h"
+
+#include <future>
+#include <thread>
+
+namespace {
+struct ReleasedObject {
+    explicit ReleasedObject( std::promise<std::thread::id>* promise )
+        : releasedIn( promise )
+    {
+    }
+
+    ~ReleasedObject()
+    {
+        releasedIn->set_value( std::this_thread::get_id() );
+    }
+
+    std::promise<std::thread::id>* releasedIn;
+};
+} // namespace
+
+SCENARIO( "BackgroundRelease frees objects in another thread", "[backgroundrelease]" )
+{
+    std::promise<std::thread::id> releasedIn;
+    auto released = releasedIn.get_future();
+
+    GIVEN( "Object given by its last owner" )
+    {
+        BackgroundRelease::get().release( std::make_shared<ReleasedObject>( &releasedIn ) );
+
+        THEN( "It is freed by the background thread" )
+        {
+            REQUIRE( released.wait_for( std::chrono::seconds( 10 ) )
+                     == std::future_status::ready );
+            REQUIRE( released.get() != std::this_thread::get_id() );
+        }
+    }
+
+    GIVEN( "Object with another owner" )
+    {
+        auto object = std::make_shared<ReleasedObject>( &releasedIn );
+        BackgroundRelease::get().release( object );
+
+        THEN( "It is freed by the other owner" )
+        {
+            while ( object.use_count() > 1 ) {
+                std::this_thread::yield();
+            }
+            object.reset();
+            REQUIRE( released.get() == std::this_thread::get_id() );
+        }
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "blockreadqueue.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace {
+const std::string FileData = "0123456789abcdefghijklmnopqrstuvwxyz";
+} // namespace
+
+SCENARIO( "BlockReadQueue returns reads in submission order", "[blockreadqueue]" )
+{
+    std::atomic<int> readsInFlight{ 0 };
+    std::atomic<int> maxReadsInFlight{ 0 };
+
+    // Earlier blocks take longer, so they are done after the later ones
+    const auto read = [ & ]( qint64 offset, char* data, qint64 size ) -> qint64 {
+        const auto inFlight = ++readsInFlight;
+        auto maxInFlight = maxReadsInFlight.load();
+        while ( inFlight > maxInFlight
+                && !maxReadsInFlight.compare_exchange_weak( maxInFlight, inFlight ) ) {
+        }
+
+        std::this_thread::sleep_for( milliseconds( 40 - offset ) );
+        const auto bytesRead = std::min( size, static_cast<qint64>( FileData.size() ) - offset );
+        FileData.copy( data, static_cast<size_t>( bytesRead ), static_cast<size_t>( offset ) );
+
+        --readsInFlight;
+        return bytesRead;
+    };
+
+    GIVEN( "Queue with a few reads in flight" )
+    {
+        BlockReadQueue queue( read, 4 );
+        std::string buffer( FileData.size() + 8, '\0' );
+
+        WHEN( "Blocks are read until the end of data" )
+        {
+            qint64 offset = 0;
+            while ( !queue.isFull() ) {
+                queue.submit( offset, buffer.data() + offset, 10 );
+                offset += 10;
+            }
+
+            THEN( "Blocks are taken in order with their data" )
+            {
+                REQUIRE( queue.isFull() );
+                for ( qint64 expectedOffset = 0; expectedOffset < offset; expectedOffset += 10 ) {
+                    const auto block = queue.take();
+                    REQUIRE( block.offset == expectedOffset );
+                    REQUIRE( block.bytesRead == ( expectedOffset < 30 ? 10 : 6 ) );
+                }
+                REQUIRE( queue.isEmpty() );
+                REQUIRE( buffer.substr( 0, FileData.size() ) == FileData );
+            }
+
+            THEN( "Blocks are read at the same time" )
+            {
+                while ( !queue.isEmpty() ) {
+                    queue.take();
+                }
+                REQUIRE( maxReadsInFlight.load() > 1 );
+            }
+        }
+    }
+
+    GIVEN( "Queue destroyed with reads in flight" )
+    {
+        std::string buffer( FileData.size(), '\0' );
+        {
+            BlockReadQueue queue( read, 2 );
+            queue.submit( 0, buffer.data(), 10 );
+            queue.submit( 10, buffer.data() + 10, 10 );
+        }
+
+        THEN( "Reads are done before it is destroyed" )
+        {
+            REQUIRE( readsInFlight.load() == 0 );
+        }
+    }
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "configuration.h"
+#include "fileholder.h"
+
+#include <QTemporaryFile>
+
+#include <memory>
+
+namespace {
+std::unique_ptr<QTemporaryFile> makeFile( const QByteArray& data )
+{
+    auto file = std::make_unique<QTemporaryFile>();
+    REQUIRE( file->open() );
+    REQUIRE( file->write( data ) == data.size() );
+    REQUIRE( file->flush() );
+    return file;
+}
+
+std::shared_ptr<const FileReader> makeReader( const QString& fileName )
+{
+    auto file = std::make_shared<QFile>( fileName );
+    REQUIRE( file->open( QIODevice::ReadOnly ) );
+    return std::make_shared<const FileReader>( file );
+}
+} // namespace
+
+SCENARIO( "ChainedFile reads rotated files before the file", "[chainedfile]" )
+{
+    const auto rotated = makeFile( "line 1\nline 2\n" );
+    const auto current = makeFile( "line 3\n" );
+
+    auto chain = std::make_shared<FileChain>();
+    chain->append( makeReader( rotated->fileName() ), rotated->size() );
+
+    GIVEN( "File opened with the chain" )
+    {
+        ChainedFile file( current->fileName(), chain );
+        REQUIRE( file.open( QIODevice::ReadOnly ) );
+
+        THEN( "Data of all files is read at the offsets of the concatenation" )
+        {
+            REQUIRE( file.chainedSize() == 14 );
+            REQUIRE( file.size() == 21 );
+            REQUIRE( !file.canMap() );
+            REQUIRE( file.readAll() == "line 1\nline 2\nline 3\n" );
+
+            REQUIRE( file.seek( 10 ) );
+            REQUIRE( file.read( 8 ) == "e 2\nline" );
+        }
+
+        THEN( "Its reader reads at the same offsets" )
+        {
+            const auto reader = file.reader();
+            REQUIRE( reader );
+
+            QByteArray data( 8, '\0' );
+            REQUIRE( reader->read( 10, data.data(), data.size() ) == 8 );
+            REQUIRE( data == "e 2\nline" );
+        }
+
+        WHEN( "More files are chained" )
+        {
+            chain->append( makeReader( current->fileName() ), current->size() );
+
+            THEN( "The opened file keeps its chain" )
+            {
+                REQUIRE( file.size() == 21 );
+            }
+        }
+    }
+
+    GIVEN( "File with the name is missing" )
+    {
+        ChainedFile file( current->fileName() + ".missing", chain );
+
+        THEN( "Chained files are still read" )
+        {
+            REQUIRE( file.open( QIODevice::ReadOnly ) );
+            REQUIRE( file.size() == 14 );
+            REQUIRE( file.readAll() == "line 1\nline 2\n" );
+            REQUIRE( !file.reader() );
+        }
+    }
+
+    GIVEN( "Reader of the chained data" )
+    {
+        auto file = std::make_shared<QFile>( current->fileName() );
+        REQUIRE( file->open( QIODevice::ReadOnly ) );
+        const FileReader reader( file, chain->segments() );
+
+        THEN( "Reads cross the end of the chained files" )
+        {
+            QByteArray data( 9, '\0' );
+            REQUIRE( reader.read( 12, data.data(), data.size() ) == 9 );
+            REQUIRE( data == "2\nline 3\n" );
+        }
+    }
+}
+
+SCENARIO( "ChainedFile separates files without a final line feed", "[chainedfile]" )
+{
+    const auto first = makeFile( "line 1\nline 2" );
+    const auto current = makeFile( "line 3\n" );
+
+    auto chain = std::make_shared<FileChain>();
+    chain->append( makeReader( first->fileName() ), first->size(), true );
+
+    GIVEN( "File opened with the chain" )
+    {
+        ChainedFile file( current->fileName(), chain );
+        REQUIRE( file.open( QIODevice::ReadOnly ) );
+
+        THEN( "Line feed is read after the data of the chained file" )
+        {
+            REQUIRE( file.chainedSize() == 14 );
+            REQUIRE( file.readAll() == "line 1\nline 2\nline 3\n" );
+
+            REQUIRE( file.seek( 13 ) );
+            REQUIRE( file.read( 5 ) == "\nline" );
+        }
+
+        THEN( "Its reader reads the line feed too" )
+        {
+            const auto reader = file.reader();
+            REQUIRE( reader );
+
+            QByteArray data( 3, '\0' );
+            REQUIRE( reader->read( 12, data.data(), data.size() ) == 3 );
+            REQUIRE( data == "2\nl" );
+        }
+    }
+}
+
+SCENARIO( "Files are mapped only if mapping them is allowed", "[chainedfile]" )
+{
+    const auto data = QByteArray( "line 1\nline 2\n" );
+    const auto current = makeFile( data );
+    const auto permissions = current->permissions();
+
+    auto& config = Configuration::get();
+    const auto mapWritableFiles = config.mapWritableFiles();
+    config.setMapWritableFiles( false );
+
+    GIVEN( "File that can't be written" )
+    {
+        REQUIRE( current->setPermissions( QFileDevice::ReadOwner ) );
+
+        THEN( "It is indexed from a mapping" )
+        {
+            ChainedFile file( current->fileName(), std::make_shared<FileChain>() );
+            REQUIRE( file.open( QIODevice::ReadOnly ) );
+            REQUIRE( file.canMap() );
+
+            const auto* mapped = file.map( 0, file.size() );
+            REQUIRE( mapped != nullptr );
+            REQUIRE( QByteArray( reinterpret_cast<const char*>( mapped ), data.size() ) == data );
+        }
+
+        REQUIRE( current->setPermissions( permissions ) );
+    }
+
+    GIVEN( "File that can be written" )
+    {
+        ChainedFile file( current->fileName(), std::make_shared<FileChain>() );
+        REQUIRE( file.open( QIODevice::ReadOnly ) );
+
+        THEN( "It is not mapped by default" )
+        {
+            REQUIRE( !file.canMap() );
+        }
+
+        WHEN( "Mapping writable files is allowed" )
+        {
+            config.setMapWritableFiles( true );
+
+            THEN( "It is mapped" )
+            {
+                REQUIRE( file.canMap() );
+            }
+        }
+    }
+
+    config.setMapWritableFiles( mapWritableFiles );
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "delimetermasks.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+std::vector<size_t> findAll( const std::string& data, char delimeter, size_t from, size_t to )
+{
+    std::vector<size_t> positions;
+    for ( auto i = from; i < to; ++i ) {
+        if ( data[ i ] == delimeter ) {
+            positions.push_back( i );
+        }
+    }
+    return positions;
+}
+} // namespace
+
+SCENARIO( "DelimeterMasks finds line feeds and tabs", "[delimetermasks]" )
+{
+    GIVEN( "Block with random line feeds and tabs" )
+    {
+        std::mt19937 generator( 42 );
+        // Not a multiple of 64 to check the partial last chunk
+        std::string data( 64 * 20 + 17, 'a' );
+        for ( auto& c : data ) {
+            const auto value = generator() % 16;
+            if ( value == 0 ) {
+                c = '\n';
+            }
+            else if ( value == 1 ) {
+                c = '\t';
+            }
+            else if ( value == 2 ) {
+                c = '\xe9';
+            }
+        }
+
+        DelimeterMasks masks;
+        masks.scan( data.data(), data.size() );
+
+        WHEN( "Looking for next line feed" )
+        {
+            THEN( "Same positions as std::string::find returned" )
+            {
+                for ( size_t from = 0; from <= data.size(); ++from ) {
+                    const auto expected = std::min( data.find( '\n', from ), data.size() );
+                    REQUIRE( masks.nextLineFeed( from ) == expected );
+                }
+            }
+        }
+
+        WHEN( "Enumerating tabs between line feeds" )
+        {
+            THEN( "All tabs in range returned in order" )
+            {
+                size_t lineStart = 0;
+                while ( lineStart < data.size() ) {
+                    const auto lineEnd = masks.nextLineFeed( lineStart );
+
+                    std::vector<size_t> tabs;
+                    masks.forEachTab( lineStart, lineEnd,
+                                      [ &tabs ]( size_t pos ) { tabs.push_back( pos ); } );
+
+                    REQUIRE( tabs == findAll( data, '\t', lineStart, lineEnd ) );
+                    lineStart = lineEnd + 1;
+                }
+            }
+        }
+
+        WHEN( "Checking ranges for tabs and non ASCII bytes" )
+        {
+            THEN( "Same result as looking at each byte" )
+            {
+                for ( size_t from = 0; from < data.size(); from += 7 ) {
+                    for ( auto to = from; to <= std::min( data.size(), from + 200 ); ++to ) {
+                        const auto begin = data.begin() + static_cast<std::ptrdiff_t>( from );
+                        const auto end = data.begin() + static_cast<std::ptrdiff_t>( to );
+                        REQUIRE( masks.hasTab( from, to )
+                                 == ( std::find( begin, end, '\t' ) != end ) );
+                        REQUIRE( masks.hasNonAscii( from, to )
+                                 == std::any_of( begin, end, []( char c ) {
+                                        return ( static_cast<unsigned char>( c ) & 0x80 ) != 0;
+                                    } ) );
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO( "Wide line feeds are found in whole code units", "[delimetermasks]" )
+{
+    for ( const auto& [ unitWidth, delimeterIndex ] :
+          std::vector<std::pair<int, int>>{ { 2, 0 }, { 2, 1 }, { 4, 0 }, { 4, 3 } } ) {
+        GIVEN( "Text with code units of width " << unitWidth << ", line feed at "
+                                                  << delimeterIndex )
+        {
+            std::mt19937 generator( 42 );
+            const auto width = static_cast<size_t>( unitWidth );
+            const auto index = static_cast<size_t>( delimeterIndex );
+
+            // Line feed bytes inside other code units must not match
+            std::string data( width * 700 + 1, 'a' );
+            std::vector<size_t> lineFeeds;
+            for ( size_t unit = 0; unit + width <= data.size(); unit += width ) {
+                const auto value = generator() % 8;
+                for ( size_t i = 0; i < width; ++i ) {
+                    data[ unit + i ] = i == index ? ( value < 4 ? '\n' : 'b' ) : '\0';
+                }
+                if ( value == 0 ) {
+                    lineFeeds.push_back( unit + index );
+                }
+                else if ( value < 4 ) {
+                    data[ unit + ( index + 1 ) % width ] = '\n';
+                }
+            }
+
+            THEN( "Positions of line feed bytes of matching units are returned" )
+            {
+                for ( size_t from = 0; from < data.size(); from += width ) {
+                    const auto expected
+                        = std::lower_bound( lineFeeds.begin(), lineFeeds.end(), from );
+                    const auto found = from
+                                       + findWideDelimeter( data.data() + from,
+                                                            data.size() - from, '\n', unitWidth,
+                                                            delimeterIndex );
+                    REQUIRE( found
+                             == ( expected != lineFeeds.end() ? *expected : data.size() ) );
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "fieldfacets.h"
+
+#include <string>
+
+namespace {
+using Counts = klogg::vector<std::pair<std::string, uint64_t>>;
+
+Counts valuesAndCounts( klogg::vector<FieldFacets::Value> values )
+{
+    Counts counts;
+    for ( const auto& value : values ) {
+        counts.emplace_back( value.value.toStdString(), value.count );
+    }
+    return counts;
+}
+
+std::optional<std::string> fieldValue( const FacetField& field, std::string_view line )
+{
+    std::string buffer;
+    const auto value = field.value( line, buffer );
+    if ( !value ) {
+        return {};
+    }
+    return std::string( *value );
+}
+} // namespace
+
+TEST_CASE( "Values are counted exactly while they fit", "[fieldfacets]" )
+{
+    FacetCounter counter;
+    for ( const auto* value : { "10.0.0.1", "10.0.0.2", "10.0.0.1", "10.0.0.3", "10.0.0.1",
+                                "10.0.0.2" } ) {
+        counter.add( value );
+    }
+
+    REQUIRE_FALSE( counter.isApproximate() );
+    REQUIRE( valuesAndCounts( counter.takeTop( 2 ) )
+             == Counts{ { "10.0.0.1", 3 }, { "10.0.0.2", 2 } } );
+}
+
+TEST_CASE( "Common values are kept when values don't fit", "[fieldfacets]" )
+{
+    FacetCounter counter;
+    for ( uint64_t index = 0; index < 4 * FacetCounter::MaxValues; ++index ) {
+        counter.add( std::to_string( index ) );
+        if ( index % 4 == 0 ) {
+            counter.add( "common" );
+        }
+    }
+
+    REQUIRE( counter.isApproximate() );
+    const auto values = counter.takeTop( 1 );
+    REQUIRE( values.front().value == "common" );
+    REQUIRE( values.front().count >= FacetCounter::MaxValues );
+    REQUIRE( values.front().count - values.front().error <= FacetCounter::MaxValues );
+}
+
+TEST_CASE( "Counters of threads are merged", "[fieldfacets]" )
+{
+    FacetCounter counter;
+    counter.add( "GET" );
+    counter.add( "POST" );
+
+    FacetCounter otherCounter;
+    otherCounter.add( "GET" );
+    otherCounter.add( "PUT" );
+    otherCounter.add( "GET" );
+
+    counter.merge( std::move( otherCounter ) );
+
+    REQUIRE_FALSE( counter.isApproximate() );
+    REQUIRE( valuesAndCounts( counter.takeTop( 10 ) )
+             == Counts{ { "GET", 3 }, { "POST", 1 }, { "PUT", 1 } } );
+}
+
+TEST_CASE( "Percentiles of numbers are close to the actual ones", "[fieldfacets]" )
+{
+    NumberHistogram numbers;
+    NumberHistogram otherNumbers;
+    for ( auto number = 1; number <= 1000; ++number ) {
+        ( number % 2 == 0 ? numbers : otherNumbers ).add( number );
+    }
+    numbers.merge( otherNumbers );
+
+    REQUIRE( numbers.count() == 1000 );
+    REQUIRE( numbers.min() == 1 );
+    REQUIRE( numbers.max() == 1000 );
+    REQUIRE( numbers.mean() == Approx( 500.5 ) );
+    REQUIRE( numbers.percentile( 0.5 ) == Approx( 500 ).epsilon( 0.004 ) );
+    REQUIRE( numbers.percentile( 0.99 ) == Approx( 990 ).epsilon( 0.004 ) );
+    REQUIRE( numbers.percentile( 1 ) == 1000 );
+}
+
+TEST_CASE( "Negative numbers are ordered", "[fieldfacets]" )
+{
+    NumberHistogram numbers;
+    for ( const auto number : { -250.0, -0.5, 0.0, 0.25, 3e9 } ) {
+        numbers.add( number );
+    }
+
+    REQUIRE( numbers.percentile( 0.2 ) == -250 );
+    REQUIRE( numbers.percentile( 0.4 ) == Approx( -0.5 ).epsilon( 0.004 ) );
+    REQUIRE( numbers.percentile( 0.6 ) == 0 );
+    REQUIRE( numbers.percentile( 0.8 ) == Approx( 0.25 ).epsilon( 0.004 ) );
+    REQUIRE( numbers.percentile( 1 ) == 3e9 );
+}
+
+TEST_CASE( "Values of facet fields", "[fieldfacets]" )
+{
+    SECTION( "Column" )
+    {
+        const auto field = FacetField::parse( "$2" );
+        REQUIRE( field );
+        REQUIRE( fieldValue( *field, "10.0.0.1 GET /index.html 200" ) == "GET" );
+        REQUIRE_FALSE( fieldValue( *field, "10.0.0.1" ) );
+        REQUIRE( field->searchPattern( "GET" ) == "@$2=GET" );
+    }
+
+    SECTION( "Named field" )
+    {
+        const auto field = FacetField::parse( "client_ip" );
+        REQUIRE( field );
+        REQUIRE( fieldValue( *field, R"({"client_ip":"10.0.0.1","status":200})" ) == "10.0.0.1" );
+        REQUIRE( fieldValue( *field, "level=info client_ip=10.0.0.2" ) == "10.0.0.2" );
+        REQUIRE_FALSE( fieldValue( *field, "level=info" ) );
+        REQUIRE( field->searchPattern( "a \"b\"" ) == R"(@client_ip="a \"b\"")" );
+    }
+
+    SECTION( "Capture group" )
+    {
+        const auto field = FacetField::parse( "user (\\w+) logged" );
+        REQUIRE( field );
+        REQUIRE( fieldValue( *field, "12:00 user alice logged in" ) == "alice" );
+        REQUIRE_FALSE( fieldValue( *field, "12:00 cache miss" ) );
+        REQUIRE( field->searchPattern( "alice" ).isEmpty() );
+    }
+
+    SECTION( "Invalid regular expression" )
+    {
+        REQUIRE_FALSE( FacetField::parse( "user (" ) );
+    }
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "fieldindex.h"
+#include "fieldquery.h"
+
+#include <map>
+#include <string>
+
+namespace {
+using Fields = std::multimap<std::string, std::string>;
+
+Fields fieldsOf( std::string_view line )
+{
+    Fields fields;
+    FieldQuery::forEachField( line, [ &fields ]( std::string_view key, std::string_view value ) {
+        fields.emplace( std::string( key ), std::string( value ) );
+    } );
+    return fields;
+}
+
+const klogg::vector<std::string_view> Lines = {
+    R"({"level":"error","service":"billing","id":1})",
+    R"(ts=1 level=info service=billing msg="card declined")",
+    R"({"level":"ERROR","service":"auth","nested":{"level":"info"}})",
+    R"(plain text line level error)",
+    R"(ts=2 level=error service=billing)",
+    R"({"level":"info","service":"auth"})",
+};
+} // namespace
+
+TEST_CASE( "Fields of JSON lines are top level members", "[fieldindex]" )
+{
+    const auto fields = fieldsOf(
+        R"({"level":"error", "msg" : "say \"hi\"!", "n": 42, "ok":true, "o":{"a":"}"}, "a":[1]})" );
+
+    REQUIRE( fields == Fields{ { "level", "error" },
+                               { "msg", "say \"hi\"!" },
+                               { "n", "42" },
+                               { "ok", "true" } } );
+}
+
+TEST_CASE( "Fields of logfmt lines are key value pairs", "[fieldindex]" )
+{
+    const auto fields = fieldsOf( R"(ts=2021 level=info msg="hello \"world\"" empty=)" );
+
+    REQUIRE( fields == Fields{ { "ts", "2021" },
+                               { "level", "info" },
+                               { "msg", "hello \"world\"" },
+                               { "empty", "" } } );
+}
+
+TEST_CASE( "Field queries are made only of field terms", "[fieldindex]" )
+{
+    const auto query = FieldQuery::parse( R"(@level=error @msg="card declined")", true );
+    REQUIRE( query );
+    REQUIRE( query->predicates().size() == 2 );
+    REQUIRE( query->predicates()[ 1 ].value == "card declined" );
+
+    REQUIRE( !FieldQuery::parse( "level=error", true ) );
+    REQUIRE( !FieldQuery::parse( "@level=error and more", true ) );
+    REQUIRE( !FieldQuery::parse( "@=error", true ) );
+    REQUIRE( !FieldQuery::parse( R"(@msg="unterminated)", true ) );
+    REQUIRE( !FieldQuery::parse( "@level!error", true ) );
+
+    const auto comparison = FieldQuery::parse( "@latency_ms>=500 @$9<600", true );
+    REQUIRE( comparison );
+    REQUIRE( comparison->predicates()[ 0 ].op == FieldQuery::Operator::GreaterOrEqual );
+    REQUIRE( comparison->predicates()[ 0 ].number == 500.0 );
+    REQUIRE( comparison->predicates()[ 1 ].column == 9 );
+}
+
+TEST_CASE( "Field queries match lines with all fields", "[fieldindex]" )
+{
+    const auto query = FieldQuery::parse( "@level=error @service=billing", true );
+    REQUIRE( query );
+    REQUIRE( query->matches( Lines[ 0 ] ) );
+    REQUIRE( !query->matches( Lines[ 1 ] ) );
+    REQUIRE( !query->matches( Lines[ 2 ] ) );
+    REQUIRE( !query->matches( Lines[ 3 ] ) );
+    REQUIRE( query->matches( Lines[ 4 ] ) );
+
+    const auto ignoringCase = FieldQuery::parse( "@level=error", false );
+    REQUIRE( ignoringCase );
+    REQUIRE( ignoringCase->matches( Lines[ 2 ] ) );
+}
+
+TEST_CASE( "Field queries compare values and columns", "[fieldindex]" )
+{
+    const auto matches = []( const char* pattern, std::string_view line ) {
+        const auto query = FieldQuery::parse( pattern, false );
+        REQUIRE( query );
+        return query->matches( line );
+    };
+
+    REQUIRE( matches( "@latency_ms>500", "latency_ms=750.5 level=info" ) );
+    REQUIRE( !matches( "@latency_ms>500", "latency_ms=500 level=info" ) );
+    REQUIRE( matches( "@latency_ms>=500", "latency_ms=500 level=info" ) );
+    REQUIRE( !matches( "@latency_ms<500", "latency_ms=slow" ) );
+    REQUIRE( matches( "@level!=info", R"({"level":"warn"})" ) );
+    REQUIRE( !matches( "@level!=info", R"({"level":"INFO"})" ) );
+    REQUIRE( !matches( "@level!=info", R"({"service":"auth"})" ) );
+    REQUIRE( matches( "@ts>=2021-03-01 @ts<2021-03-02", "ts=2021-03-01T10:00 level=info" ) );
+
+    const std::string_view accessLine = "10.0.0.1 - - GET /api 503 1024";
+    REQUIRE( matches( "@$6>=500 @$6<600", accessLine ) );
+    REQUIRE( !matches( "@$6>=500 @$6<600 @$5=/home", accessLine ) );
+    REQUIRE( !matches( "@$9=1", accessLine ) );
+}
+
+SCENARIO( "FieldIndex finds the lines a query matches", "[fieldindex]" )
+{
+    constexpr uint64_t Generation = 1;
+
+    GIVEN( "Index of lines added in two parts" )
+    {
+        FieldIndex index;
+        const klogg::vector<std::string_view> firstLines( Lines.begin(), Lines.begin() + 3 );
+        const klogg::vector<std::string_view> lastLines( Lines.begin() + 3, Lines.end() );
+
+        const auto position = index.position( Generation );
+        REQUIRE( index.addLines( position, firstLines ) );
+        REQUIRE( !index.addLines( position, lastLines ) );
+        REQUIRE( index.addLines( index.position( Generation ), lastLines ) );
+        REQUIRE( index.indexedLines() == LinesCount( Lines.size() ) );
+
+        THEN( "Lines are the ones matched by scanning" )
+        {
+            for ( const auto isCaseSensitive : { true, false } ) {
+                for ( const auto* pattern :
+                      { "@level=error @service=billing", "@level=info", "@service=auth",
+                        "@msg=\"card declined\"", "@missing=1", "@level!=info",
+                        "@service>b @ts<2" } ) {
+                    const auto query = FieldQuery::parse( pattern, isCaseSensitive );
+                    REQUIRE( query );
+
+                    roaring::Roaring64Map scanned;
+                    for ( size_t line = 1; line < Lines.size(); ++line ) {
+                        if ( query->matches( Lines[ line ] ) ) {
+                            scanned.add( static_cast<uint64_t>( line ) );
+                        }
+                    }
+
+                    const auto indexed = index.matchingLines(
+                        *query, Generation, 1_lnum, LinesCount( Lines.size() - 1 ) );
+                    REQUIRE( indexed );
+                    REQUIRE( *indexed == scanned );
+                }
+            }
+        }
+
+        THEN( "Lines not indexed or of another generation are not answered" )
+        {
+            const auto query = FieldQuery::parse( "@level=info", true );
+            REQUIRE( !index.matchingLines( *query, Generation, 0_lnum,
+                                           LinesCount( Lines.size() + 1 ) ) );
+            REQUIRE( !index.matchingLines( *query, Generation + 1, 0_lnum, 1_lcount ) );
+            REQUIRE( !index.matchingLines( *FieldQuery::parse( "@$1=ts=1", true ), Generation,
+                                           0_lnum, 1_lcount ) );
+        }
+
+        WHEN( "Index is cleared" )
+        {
+            index.clear();
+
+            THEN( "Lines read before are not added" )
+            {
+                REQUIRE( !index.addLines( position, firstLines ) );
+                REQUIRE( index.indexedLines() == 0_lcount );
+            }
+        }
+    }
+
+    GIVEN( "Field with more different values than kept" )
+    {
+        klogg::vector<std::string> lines;
+        for ( size_t line = 0; line <= FieldIndex::MaxValuesPerField; ++line ) {
+            lines.push_back( "id=" + std::to_string( line ) + " level=info" );
+        }
+
+        FieldIndex index;
+        REQUIRE( index.addLines( index.position( Generation ),
+                                 klogg::vector<std::string_view>( lines.begin(), lines.end() ) ) );
+
+        THEN( "Queries on the field are answered by scanning" )
+        {
+            const auto count = LinesCount( lines.size() );
+            REQUIRE( !index.matchingLines( *FieldQuery::parse( "@id=5", true ), Generation,
+                                           0_lnum, count ) );
+            REQUIRE( index.matchingLines( *FieldQuery::parse( "@level=info", true ), Generation,
+                                          0_lnum, count )
+                         ->cardinality()
+                     == lines.size() );
+        }
+    }
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "findinfiles.h"
+
+#include <map>
+#include <mutex>
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextCodec>
+
+namespace {
+QString writeFile( const QTemporaryDir& dir, const QString& name, const QByteArray& data )
+{
+    const auto fileName = dir.filePath( name );
+    QFile file( fileName );
+    REQUIRE( file.open( QIODevice::WriteOnly ) );
+    REQUIRE( file.write( data ) == data.size() );
+    return fileName;
+}
+
+std::map<QString, FindInFiles::FileMatches> findInFiles( const QString& pattern,
+                                                         const klogg::vector<QString>& fileNames )
+{
+    FindInFiles find( RegularExpressionPattern( pattern, true, false, false, false ) );
+    REQUIRE( find.isValid() );
+
+    std::mutex mutex;
+    std::map<QString, FindInFiles::FileMatches> results;
+    std::atomic<bool> interruptRequested{ false };
+    find.run(
+        fileNames,
+        [ &mutex, &results ]( FindInFiles::FileMatches matches ) {
+            std::lock_guard<std::mutex> lock( mutex );
+            results[ matches.fileName ] = std::move( matches );
+        },
+        interruptRequested );
+    return results;
+}
+} // namespace
+
+SCENARIO( "Find in files", "[findinfiles]" )
+{
+    QTemporaryDir dir;
+    REQUIRE( dir.isValid() );
+
+    GIVEN( "Files in different encodings" )
+    {
+        const auto crlfFile = writeFile( dir, "crlf.log",
+                                         "INFO start\r\nERROR one\r\nINFO x\r\nERROR two" );
+
+        const auto* utf16 = QTextCodec::codecForName( "UTF-16LE" );
+        const auto utf16File
+            = writeFile( dir, "utf16.log",
+                         QByteArray( "\xFF\xFE", 2 ) + utf16->fromUnicode( "INFO a\nERROR b\n" ) );
+
+        const auto missingFile = dir.filePath( "missing.log" );
+
+        const auto results = findInFiles( "ERROR \\w+$", { crlfFile, utf16File, missingFile } );
+        REQUIRE( results.size() == 3 );
+
+        THEN( "Lines are matched without line feeds" )
+        {
+            const auto& crlf = results.at( crlfFile );
+            REQUIRE( crlf.error.isEmpty() );
+            REQUIRE( crlf.nbLines == 4 );
+            REQUIRE( crlf.nbMatches == 2 );
+            REQUIRE( crlf.firstMatches.size() == 2 );
+            REQUIRE( crlf.firstMatches[ 0 ].line == 1_lnum );
+            REQUIRE( crlf.firstMatches[ 0 ].offset == 12 );
+            REQUIRE( crlf.firstMatches[ 0 ].text == "ERROR one" );
+            REQUIRE( crlf.firstMatches[ 1 ].line == 3_lnum );
+            REQUIRE( crlf.firstMatches[ 1 ].offset == 31 );
+            REQUIRE( crlf.firstMatches[ 1 ].text == "ERROR two" );
+        }
+
+        THEN( "Wide encodings are decoded" )
+        {
+            const auto& wide = results.at( utf16File );
+            REQUIRE( wide.error.isEmpty() );
+            REQUIRE( wide.nbLines == 2 );
+            REQUIRE( wide.nbMatches == 1 );
+            REQUIRE( wide.firstMatches.front().line == 1_lnum );
+            REQUIRE( wide.firstMatches.front().offset == 16 );
+            REQUIRE( wide.firstMatches.front().text == "ERROR b" );
+        }
+
+        THEN( "Missing files are reported" )
+        {
+            REQUIRE_FALSE( results.at( missingFile ).error.isEmpty() );
+        }
+    }
+
+    GIVEN( "File larger than one block" )
+    {
+        QByteArray data;
+        for ( auto i = 0; i < 200000; ++i ) {
+            data.append( QStringLiteral( "line %1\n" ).arg( i, 6, 10, QChar( '0' ) ).toLatin1() );
+        }
+        const auto largeFile = writeFile( dir, "large.log", data );
+
+        const auto results = findInFiles( "line 1234\\d\\d", { largeFile } );
+        const auto& large = results.at( largeFile );
+
+        THEN( "All lines are searched" )
+        {
+            REQUIRE( large.nbLines == 200000 );
+            REQUIRE( large.nbMatches == 100 );
+            REQUIRE( large.firstMatches.size() == FindInFiles::MaxFirstMatches );
+            REQUIRE( large.firstMatches.front().line == 123400_lnum );
+            REQUIRE( large.firstMatches.front().offset == 123400 * 12 );
+        }
+    }
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "bgzfaccess.h"
+#include "fileholder.h"
+#include "gzipaccess.h"
+
+#include <QTemporaryFile>
+#include <QtEndian>
+
+#include <memory>
+
+#include <zlib.h>
+
+namespace {
+QByteArray gzip( const QByteArray& data )
+{
+    z_stream stream{};
+    REQUIRE( deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                           Z_DEFAULT_STRATEGY )
+             == Z_OK );
+
+    QByteArray compressed( static_cast<int>( deflateBound( &stream, data.size() ) ), '\0' );
+    stream.next_in = reinterpret_cast<Bytef*>( const_cast<char*>( data.data() ) );
+    stream.avail_in = static_cast<uInt>( data.size() );
+    stream.next_out = reinterpret_cast<Bytef*>( compressed.data() );
+    stream.avail_out = static_cast<uInt>( compressed.size() );
+    REQUIRE( deflate( &stream, Z_FINISH ) == Z_STREAM_END );
+
+    compressed.resize( static_cast<int>( stream.total_out ) );
+    deflateEnd( &stream );
+    return compressed;
+}
+
+// Members of at most 64 KiB with their size in the BC subfield, as written by bgzip
+QByteArray bgzf( const QByteArray& data )
+{
+    QByteArray compressed;
+    for ( auto offset = 0; offset < data.size(); offset += 32 * 1024 ) {
+        const auto block = data.mid( offset, 32 * 1024 );
+
+        z_stream stream{};
+        REQUIRE( deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                               Z_DEFAULT_STRATEGY )
+                 == Z_OK );
+        QByteArray deflated( static_cast<int>( deflateBound( &stream, block.size() ) ), '\0' );
+        stream.next_in = reinterpret_cast<Bytef*>( const_cast<char*>( block.data() ) );
+        stream.avail_in = static_cast<uInt>( block.size() );
+        stream.next_out = reinterpret_cast<Bytef*>( deflated.data() );
+        stream.avail_out = static_cast<uInt>( deflated.size() );
+        REQUIRE( deflate( &stream, Z_FINISH ) == Z_STREAM_END );
+        deflated.resize( static_cast<int>( stream.total_out ) );
+        deflateEnd( &stream );
+
+        QByteArray header( "\x1f\x8b\x08\x04\0\0\0\0\0\xff\x06\0BC\x02\0\0\0", 18 );
+        qToLittleEndian<quint16>( static_cast<quint16>( 18 + deflated.size() + 8 - 1 ),
+                                  header.data() + 16 );
+
+        QByteArray trailer( 8, '\0' );
+        const auto crc = crc32( 0, reinterpret_cast<const Bytef*>( block.data() ),
+                                static_cast<uInt>( block.size() ) );
+        qToLittleEndian<quint32>( static_cast<quint32>( crc ), trailer.data() );
+        qToLittleEndian<quint32>( static_cast<quint32>( block.size() ), trailer.data() + 4 );
+
+        compressed.append( header + deflated + trailer );
+    }
+    return compressed;
+}
+
+QByteArray makeLines( int first, int count )
+{
+    QByteArray lines;
+    for ( auto line = first; line < first + count; ++line ) {
+        lines.append( QByteArray( "line " ) + QByteArray::number( line ) + " value "
+                      + QByteArray::number( line * 7919 % 1000 ) + "\n" );
+    }
+    return lines;
+}
+} // namespace
+
+SCENARIO( "Gzip file is read at random offsets", "[gzipaccess]" )
+{
+    // Two members, the first one spans several access points
+    const auto firstPart = makeLines( 0, 300000 );
+    const auto secondPart = makeLines( 300000, 1000 );
+    const auto data = firstPart + secondPart;
+
+    QTemporaryFile file;
+    REQUIRE( file.open() );
+    file.write( gzip( firstPart ) + gzip( secondPart ) );
+    REQUIRE( file.flush() );
+
+    auto compressedAccess = CompressedAccess::create( file.fileName() );
+    REQUIRE( std::dynamic_pointer_cast<GzipAccess>( compressedAccess ) );
+
+    auto chain = std::make_shared<FileChain>();
+    chain->setCompressedAccess( std::move( compressedAccess ) );
+
+    GIVEN( "Gzip file opened with its access" )
+    {
+        ChainedFile chainedFile( file.fileName(), chain );
+        REQUIRE( chainedFile.open( QIODevice::ReadOnly ) );
+
+        THEN( "Decompressed data is read" )
+        {
+            REQUIRE( chain->compressedAccess()->isBuilt() );
+            REQUIRE( chainedFile.size() == data.size() );
+            REQUIRE( !chainedFile.canMap() );
+            REQUIRE( chainedFile.readAll() == data );
+        }
+
+        THEN( "Data is read at offsets before and after the reads" )
+        {
+            const auto end = static_cast<int>( data.size() );
+            for ( const int offset : { 5000000, 100, end - 20, 4200000, 4199990 } ) {
+                REQUIRE( chainedFile.seek( offset ) );
+                REQUIRE( chainedFile.read( 64 ) == data.mid( offset, 64 ) );
+            }
+        }
+
+        THEN( "Reader of the file decompresses the data" )
+        {
+            auto opened = std::make_shared<QFile>( file.fileName() );
+            REQUIRE( opened->open( QIODevice::ReadOnly ) );
+            const FileReader reader( opened, {}, chain->compressedAccess() );
+
+            QByteArray buffer( 100, '\0' );
+            REQUIRE( reader.read( firstPart.size() - 50, buffer.data(), buffer.size() ) == 100 );
+            REQUIRE( buffer == data.mid( firstPart.size() - 50, 100 ) );
+
+            REQUIRE( reader.read( 10, buffer.data(), buffer.size() ) == 100 );
+            REQUIRE( buffer == data.mid( 10, 100 ) );
+        }
+    }
+}
+
+SCENARIO( "BGZF file is read by its members", "[gzipaccess]" )
+{
+    const auto data = makeLines( 0, 50000 );
+
+    QTemporaryFile file;
+    REQUIRE( file.open() );
+    file.write( bgzf( data ) );
+    REQUIRE( file.flush() );
+
+    auto compressedAccess = CompressedAccess::create( file.fileName() );
+    REQUIRE( std::dynamic_pointer_cast<BgzfAccess>( compressedAccess ) );
+
+    auto chain = std::make_shared<FileChain>();
+    chain->setCompressedAccess( std::move( compressedAccess ) );
+
+    GIVEN( "BGZF file opened with its access" )
+    {
+        ChainedFile chainedFile( file.fileName(), chain );
+        REQUIRE( chainedFile.open( QIODevice::ReadOnly ) );
+
+        THEN( "Members are decompressed in order" )
+        {
+            REQUIRE( chainedFile.size() == data.size() );
+            REQUIRE( chainedFile.readAll() == data );
+        }
+
+        THEN( "Data is read across members at any offset" )
+        {
+            for ( const int offset : { 500000, 32760, 10 } ) {
+                REQUIRE( chainedFile.seek( offset ) );
+                REQUIRE( chainedFile.read( 100 ) == data.mid( offset, 100 ) );
+            }
+        }
+    }
+}
+
+SCENARIO( "BGZF file followed by plain gzip members is read as gzip", "[gzipaccess]" )
+{
+    const auto firstPart = makeLines( 0, 50000 );
+    const auto secondPart = makeLines( 50000, 1000 );
+    const auto data = firstPart + secondPart;
+
+    QTemporaryFile file;
+    REQUIRE( file.open() );
+    file.write( bgzf( firstPart ) + gzip( secondPart ) );
+    REQUIRE( file.flush() );
+
+    // Only the first member is checked when the file is opened
+    auto compressedAccess = CompressedAccess::create( file.fileName() );
+    REQUIRE( std::dynamic_pointer_cast<BgzfAccess>( compressedAccess ) );
+
+    auto chain = std::make_shared<FileChain>();
+    chain->setCompressedAccess( std::move( compressedAccess ) );
+
+    ChainedFile chainedFile( file.fileName(), chain );
+    REQUIRE( chainedFile.open( QIODevice::ReadOnly ) );
+
+    REQUIRE( chain->compressedAccess()->isBuilt() );
+    REQUIRE( chainedFile.size() == data.size() );
+    REQUIRE( chainedFile.readAll() == data );
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QTextCodec>
+
+#include "configuration.h"
+#include "filedigest.h"
+#include "indexcache.h"
+#include "linepositionarray.h"
+#include "logdataworker.h"
+
+namespace {
+// Smaller files are not cached
+constexpr qint64 FileSize = 65 * 1024 * 1024;
+constexpr qint64 LineSize = 1024 * 1024;
+constexpr qint64 DigestSize = 4096;
+
+quint64 digestOf( QFile& file, qint64 offset, qint64 size )
+{
+    REQUIRE( file.seek( offset ) );
+    FileDigest digest;
+    digest.addData( file.read( size ) );
+    return digest.digest();
+}
+
+// Index of lines of one megabyte, as if the file was indexed
+void indexFile( QFile& file, IndexingData& indexingData )
+{
+    IndexedHash hash;
+    hash.size = file.size();
+    hash.fullDigest = digestOf( file, 0, hash.size );
+    hash.headerSize = DigestSize;
+    hash.headerDigest = digestOf( file, 0, DigestSize );
+    hash.tailOffset = hash.size - DigestSize;
+    hash.tailSize = DigestSize;
+    hash.tailDigest = digestOf( file, hash.tailOffset, DigestSize );
+
+    FastLinePositionArray positions;
+    for ( auto lineEnd = LineSize; lineEnd <= hash.size; lineEnd += LineSize ) {
+        positions.append( OffsetInFile( lineEnd ) );
+    }
+    LinePositionArray linePositions;
+    linePositions.append_list( positions );
+
+    IndexingData::MutateAccessor scopedAccessor{ &indexingData };
+    REQUIRE( scopedAccessor.restore( std::move( linePositions ), 1_length, hash,
+                                     scopedAccessor.getHashBuilderState(),
+                                     QTextCodec::codecForName( "UTF-8" ) ) );
+}
+
+// Lines of one megabyte ending with line feeds
+void writeLines( QFile& file )
+{
+    QByteArray line( static_cast<int>( LineSize - 1 ), 'a' );
+    line.append( '\n' );
+
+    REQUIRE( file.open( QIODevice::ReadWrite | QIODevice::Truncate ) );
+    for ( auto size = LineSize; size <= FileSize; size += LineSize ) {
+        REQUIRE( file.write( line ) == LineSize );
+    }
+    REQUIRE( file.flush() );
+}
+
+LinesCount nbLines( const IndexingData& indexingData )
+{
+    return IndexingData::ConstAccessor{ &indexingData }.getNbLines();
+}
+} // namespace
+
+SCENARIO( "Index cache of a file", "[indexcache]" )
+{
+    QStandardPaths::setTestModeEnabled( true );
+
+    QTemporaryFile file;
+    REQUIRE( file.open() );
+    REQUIRE( file.write( "first line\n" ) == 11 );
+    REQUIRE( file.resize( FileSize ) );
+
+    GIVEN( "Saved index of the file" )
+    {
+        IndexingData indexingData;
+        indexFile( file, indexingData );
+        saveIndexToCache( file.fileName(), indexingData );
+
+        THEN( "The same index is loaded" )
+        {
+            IndexingData loadedData;
+            REQUIRE( loadCachedIndex( file.fileName(), loadedData ) );
+            REQUIRE( nbLines( loadedData ) == LinesCount( FileSize / LineSize ) );
+            REQUIRE( IndexingData::ConstAccessor{ &loadedData }.getIndexedSize() == FileSize );
+        }
+
+        WHEN( "Data is appended to the file" )
+        {
+            REQUIRE( file.resize( FileSize + LineSize ) );
+
+            THEN( "The index of the data before is loaded" )
+            {
+                IndexingData loadedData;
+                REQUIRE( loadCachedIndex( file.fileName(), loadedData ) );
+                REQUIRE( nbLines( loadedData ) == LinesCount( FileSize / LineSize ) );
+            }
+        }
+
+        WHEN( "The beginning of the file changes" )
+        {
+            REQUIRE( file.resize( FileSize + LineSize ) );
+            REQUIRE( file.seek( 0 ) );
+            REQUIRE( file.write( "other line\n" ) == 11 );
+            REQUIRE( file.flush() );
+
+            THEN( "The index is not loaded" )
+            {
+                IndexingData loadedData;
+                REQUIRE_FALSE( loadCachedIndex( file.fileName(), loadedData ) );
+                REQUIRE( nbLines( loadedData ) == 0_lcount );
+            }
+        }
+    }
+}
+
+SCENARIO( "Index image in the shared directory", "[indexcache]" )
+{
+    QStandardPaths::setTestModeEnabled( true );
+
+    QTemporaryDir sharedDirectory;
+    QTemporaryDir firstDirectory;
+    QTemporaryDir secondDirectory;
+    REQUIRE( sharedDirectory.isValid() );
+    REQUIRE( firstDirectory.isValid() );
+    REQUIRE( secondDirectory.isValid() );
+
+    auto& config = Configuration::get();
+    const auto previousSharedDirectory = config.sharedIndexDirectory();
+    config.setSharedIndexDirectory( sharedDirectory.path() );
+
+    QFile file( firstDirectory.filePath( "shared.log" ) );
+    writeLines( file );
+
+    IndexingData indexingData;
+    indexFile( file, indexingData );
+    saveIndexToCache( file.fileName(), indexingData );
+
+    GIVEN( "Copy of the file with the same name" )
+    {
+        QFile copy( secondDirectory.filePath( "shared.log" ) );
+        writeLines( copy );
+
+        THEN( "The shared image is loaded" )
+        {
+            IndexingData loadedData;
+            REQUIRE( loadCachedIndex( copy.fileName(), loadedData ) );
+            REQUIRE( nbLines( loadedData ) == LinesCount( FileSize / LineSize ) );
+        }
+
+        WHEN( "A line in the middle of the copy ends elsewhere" )
+        {
+            REQUIRE( copy.seek( FileSize / 2 / LineSize * LineSize - 2 ) );
+            REQUIRE( copy.write( "\nb" ) == 2 );
+            REQUIRE( copy.flush() );
+
+            THEN( "The shared image is not loaded" )
+            {
+                IndexingData loadedData;
+                REQUIRE_FALSE( loadCachedIndex( copy.fileName(), loadedData ) );
+            }
+        }
+    }
+
+    config.setSharedIndexDirectory( previousSharedDirectory );
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "levelindex.h"
+
+namespace {
+roaring::Roaring64Map linesOf( std::initializer_list<uint64_t> lines )
+{
+    roaring::Roaring64Map map;
+    for ( const auto line : lines ) {
+        map.add( line );
+    }
+    return map;
+}
+} // namespace
+
+TEST_CASE( "Level is the first level word of the line", "[levelindex]" )
+{
+    constexpr auto Bytes = LevelIndex::DefaultSearchedBytes;
+
+    REQUIRE( LevelIndex::levelOf( "2021-01-01 12:00:00 ERROR failed to start", Bytes )
+             == LogLevel::Error );
+    REQUIRE( LevelIndex::levelOf( "[warn] disk is full, error expected", Bytes )
+             == LogLevel::Warning );
+    REQUIRE( LevelIndex::levelOf( "{\"level\":\"Info\",\"msg\":\"started\"}", Bytes )
+             == LogLevel::Info );
+    REQUIRE( LevelIndex::levelOf( "<DBG> value", Bytes ) == LogLevel::Debug );
+    REQUIRE( LevelIndex::levelOf( "main FINEST entering", Bytes ) == LogLevel::Trace );
+
+    REQUIRE_FALSE( LevelIndex::levelOf( "everything is fine", Bytes ) );
+    REQUIRE_FALSE( LevelIndex::levelOf( "ERRORS=0 INFORMATION", Bytes ) );
+    REQUIRE_FALSE( LevelIndex::levelOf( "no_error here", Bytes ) );
+    REQUIRE_FALSE( LevelIndex::levelOf( "", Bytes ) );
+}
+
+TEST_CASE( "Level words are looked for at the beginning of lines", "[levelindex]" )
+{
+    REQUIRE( LevelIndex::levelOf( "12345 ERROR", 7 ) == LogLevel::Error );
+    REQUIRE_FALSE( LevelIndex::levelOf( "12345 ERROR", 6 ) );
+}
+
+TEST_CASE( "Lines are found by level", "[levelindex]" )
+{
+    LevelIndex index;
+    auto position = index.position( 1 );
+    REQUIRE( index.addLines( position, { "ERROR a", "INFO b", "continued", "WARN c" } ) );
+    position = index.position( 1 );
+    REQUIRE( position.nextLine == 4_lnum );
+    REQUIRE( index.addLines( position, { "DEBUG d", "FATAL e", "TRACE f" } ) );
+
+    REQUIRE( index.indexedLines() == 7_lcount );
+    REQUIRE( index.linesUpTo( LogLevel::Error, 1, 7_lcount ) == linesOf( { 0, 5 } ) );
+    REQUIRE( index.linesUpTo( LogLevel::Warning, 1, 7_lcount ) == linesOf( { 0, 3, 5 } ) );
+    REQUIRE( index.linesUpTo( LogLevel::Info, 1, 7_lcount ) == linesOf( { 0, 1, 3, 5 } ) );
+    REQUIRE( index.linesUpTo( LogLevel::Trace, 1, 7_lcount )
+             == linesOf( { 0, 1, 3, 4, 5, 6 } ) );
+}
+
+TEST_CASE( "Levels are known only when all lines are indexed", "[levelindex]" )
+{
+    LevelIndex index;
+    const auto position = index.position( 1 );
+    REQUIRE( index.addLines( position, { "ERROR a", "INFO b" } ) );
+
+    REQUIRE_FALSE( index.linesUpTo( LogLevel::Error, 1, 3_lcount ) );
+    REQUIRE_FALSE( index.linesUpTo( LogLevel::Error, 2, 2_lcount ) );
+
+    SECTION( "Lines added at a stale position are dropped" )
+    {
+        REQUIRE_FALSE( index.addLines( position, { "ERROR c" } ) );
+        REQUIRE( index.indexedLines() == 2_lcount );
+    }
+
+    SECTION( "Lines of another generation reset the index" )
+    {
+        index.position( 2 );
+        REQUIRE( index.indexedLines() == 0_lcount );
+        REQUIRE_FALSE( index.linesUpTo( LogLevel::Error, 1, 2_lcount ) );
+    }
+}
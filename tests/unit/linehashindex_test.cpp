@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "linehashindex.h"
+
+namespace {
+roaring::Roaring64Map linesOf( std::initializer_list<uint64_t> lines )
+{
+    roaring::Roaring64Map map;
+    for ( const auto line : lines ) {
+        map.add( line );
+    }
+    return map;
+}
+} // namespace
+
+TEST_CASE( "Identical lines are found by any of them", "[linehashindex]" )
+{
+    LineHashIndex index;
+    auto position = index.position( 1 );
+    REQUIRE( index.addLines( position, { "a", "b", "a", "c" } ) );
+    position = index.position( 1 );
+    REQUIRE( position.nextLine == 4_lnum );
+    REQUIRE( index.addLines( position, { "b", "a", "", "" } ) );
+
+    REQUIRE( index.indexedLines() == 8_lcount );
+    REQUIRE( index.identicalLines( 0_lnum, 1 ) == linesOf( { 0, 2, 5 } ) );
+    REQUIRE( index.identicalLines( 5_lnum, 1 ) == linesOf( { 0, 2, 5 } ) );
+    REQUIRE( index.identicalLines( 1_lnum, 1 ) == linesOf( { 1, 4 } ) );
+    REQUIRE( index.identicalLines( 3_lnum, 1 ) == linesOf( { 3 } ) );
+    REQUIRE( index.identicalLines( 7_lnum, 1 ) == linesOf( { 6, 7 } ) );
+}
+
+TEST_CASE( "Lines not indexed have no identical lines", "[linehashindex]" )
+{
+    LineHashIndex index;
+    REQUIRE( index.addLines( index.position( 1 ), { "a", "a" } ) );
+
+    REQUIRE_FALSE( index.identicalLines( 2_lnum, 1 ) );
+    REQUIRE_FALSE( index.identicalLines( 0_lnum, 2 ) );
+}
+
+TEST_CASE( "Lines are dropped if the index changed since the position", "[linehashindex]" )
+{
+    LineHashIndex index;
+    const auto position = index.position( 1 );
+
+    SECTION( "cleared" )
+    {
+        index.clear();
+        REQUIRE_FALSE( index.addLines( position, { "a" } ) );
+    }
+
+    SECTION( "other lines added" )
+    {
+        REQUIRE( index.addLines( position, { "a" } ) );
+        REQUIRE_FALSE( index.addLines( position, { "a" } ) );
+    }
+
+    SECTION( "another generation of lines" )
+    {
+        index.position( 2 );
+        REQUIRE_FALSE( index.addLines( position, { "a" } ) );
+        REQUIRE( index.indexedLines() == 0_lcount );
+    }
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "linetypes.h"
+
+#include "linelengtharray.h"
+
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+std::vector<std::optional<LineLength>> generateLengths( size_t count )
+{
+    std::mt19937 generator( 42 );
+    std::vector<std::optional<LineLength>> lengths;
+    for ( size_t i = 0; i < count; ++i ) {
+        const auto value = generator() % 100;
+        if ( value == 0 ) {
+            lengths.emplace_back( std::nullopt );
+        }
+        else if ( value == 1 ) {
+            lengths.emplace_back( LineLength( 100000 ) );
+        }
+        else if ( value < 10 ) {
+            lengths.emplace_back( LineLength( static_cast<int>( generator() % 20000 ) ) );
+        }
+        else {
+            lengths.emplace_back( LineLength( static_cast<int>( generator() % 200 ) ) );
+        }
+    }
+    return lengths;
+}
+} // namespace
+
+SCENARIO( "LineLengthArray stores lengths of lines", "[linelengtharray]" )
+{
+    GIVEN( "LineLengthArray with several blocks of lines" )
+    {
+        const auto lengths = generateLengths( 2000 );
+
+        FastLineLengthArray fastArray;
+        for ( const auto& length : lengths ) {
+            fastArray.append( length );
+        }
+
+        LineLengthArray lengthArray;
+        lengthArray.append_list( fastArray );
+
+        REQUIRE( lengthArray.size() == LinesCount( lengths.size() ) );
+
+        WHEN( "Accessing lines" )
+        {
+            THEN( "Stored lengths are returned" )
+            {
+                for ( size_t i = 0; i < lengths.size(); ++i ) {
+                    REQUIRE( lengthArray.at( LineNumber( i ) ) == lengths[ i ] );
+                }
+                REQUIRE( !lengthArray.at( LineNumber( lengths.size() ) ) );
+            }
+        }
+
+        WHEN( "Decoding ranges of lines" )
+        {
+            THEN( "Lengths of lines in the range are returned" )
+            {
+                for ( const auto first : { 0u, 100u, 256u, 1900u } ) {
+                    const auto range = lengthArray.range( LineNumber( first ), 200_lcount );
+                    REQUIRE( range.size() == 200u );
+                    for ( size_t i = 0; i < range.size(); ++i ) {
+                        const auto line = first + i;
+                        REQUIRE( range.at( i )
+                                 == ( line < lengths.size() ? lengths[ line ] : std::nullopt ) );
+                    }
+                }
+            }
+        }
+
+        WHEN( "Storing lengths too long to be encoded" )
+        {
+            lengthArray.append( LineLength( 3000000 ) );
+
+            THEN( "Length is not known" )
+            {
+                REQUIRE( !lengthArray.at( LineNumber( lengths.size() ) ) );
+            }
+        }
+
+        WHEN( "Truncating and appending lines" )
+        {
+            for ( const auto newSize : { 1500u, 1024u, 700u, 0u } ) {
+                lengthArray.truncate( LinesCount( newSize ) );
+                REQUIRE( lengthArray.size() == LinesCount( newSize ) );
+
+                lengthArray.appendUnknown( 3_lcount );
+                lengthArray.append( 5_length );
+                REQUIRE( lengthArray.size() == LinesCount( newSize + 4 ) );
+
+                for ( size_t i = 0; i < newSize; ++i ) {
+                    REQUIRE( lengthArray.at( LineNumber( i ) ) == lengths[ i ] );
+                }
+                for ( size_t i = newSize; i < newSize + 3; ++i ) {
+                    REQUIRE( !lengthArray.at( LineNumber( i ) ) );
+                }
+                REQUIRE( lengthArray.at( LineNumber( newSize + 3 ) ) == 5_length );
+
+                lengthArray.truncate( LinesCount( newSize ) );
+                for ( size_t i = newSize; i < lengths.size(); ++i ) {
+                    lengthArray.append( lengths[ i ] );
+                }
+            }
+
+            THEN( "Stored lengths are returned" )
+            {
+                REQUIRE( lengthArray.size() == LinesCount( lengths.size() ) );
+                for ( size_t i = 0; i < lengths.size(); ++i ) {
+                    REQUIRE( lengthArray.at( LineNumber( i ) ) == lengths[ i ] );
+                }
+            }
+        }
+    }
+}
+
+SCENARIO( "Tab spaces are counted as untabify adds them", "[linelengtharray]" )
+{
+    for ( const std::string line : { "\t", "a\tb", "\t\tx", "abcdefg\th\t\ti", "12345678\t\t" } ) {
+        GIVEN( "Line " << line )
+        {
+            LineLength::UnderlyingType addedSpaces = 0;
+            for ( size_t i = 0; i < line.size(); ++i ) {
+                if ( line[ i ] == '\t' ) {
+                    addedSpaces += untabifiedTabSpaces(
+                        static_cast<LineLength::UnderlyingType>( i ), addedSpaces );
+                }
+            }
+
+            THEN( "Length is the same as of untabified line" )
+            {
+                REQUIRE( static_cast<LineLength::UnderlyingType>( line.size() ) + addedSpaces
+                         == untabify( QString::fromStdString( line ) ).size() );
+            }
+        }
+    }
+}
+
+SCENARIO( "Tabs are expanded to the next tab stop", "[linelengtharray]" )
+{
+    REQUIRE( untabify( QString( "abc" ) ) == QString( "abc" ) );
+    REQUIRE( untabify( QString( "a\tb" ) ) == QString( "a       b" ) );
+    REQUIRE( untabify( QString( "\tb" ), LineColumn( 3 ) ) == QString( "     b" ) );
+    REQUIRE( untabify( QString::fromLatin1( "a\0\tb", 4 ) ) == QString( "a       b" ) );
+}
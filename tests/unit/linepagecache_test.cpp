@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "linepagecache.h"
+
+#include <memory>
+
+namespace {
+constexpr int LineLength = 100;
+
+LinePageCache::Page makePage( uint64_t page )
+{
+    klogg::vector<QString> lines( LinePageCache::PageLines,
+                                  QString( LineLength, QChar( 'a' + static_cast<int>( page ) ) ) );
+    return std::make_shared<const klogg::vector<QString>>( std::move( lines ) );
+}
+} // namespace
+
+SCENARIO( "LinePageCache keeps recently used pages", "[linepagecache]" )
+{
+    GIVEN( "Cache with space for a few pages" )
+    {
+        // Lines can have some more capacity than their size
+        const auto pageBytes
+            = LinePageCache::PageLines * ( sizeof( QString ) + LineLength * sizeof( QChar ) );
+        LinePageCache cache( pageBytes * 7 / 2 );
+        const auto generation = cache.startReading( 0 );
+
+        for ( uint64_t page = 0; page < 3; ++page ) {
+            REQUIRE( !cache.get( page ) );
+            cache.add( page, makePage( page ), generation );
+        }
+
+        WHEN( "Reading a cached page" )
+        {
+            const auto page = cache.get( 1 );
+
+            THEN( "Its lines are returned" )
+            {
+                REQUIRE( page );
+                REQUIRE( page->at( 5 ) == QString( LineLength, 'b' ) );
+                REQUIRE( cache.stats().hits == 1 );
+                REQUIRE( cache.stats().misses == 3 );
+            }
+        }
+
+        WHEN( "Adding pages over the limit" )
+        {
+            cache.get( 0 );
+            cache.add( 3, makePage( 3 ), generation );
+
+            THEN( "Least recently used page is dropped" )
+            {
+                REQUIRE( cache.get( 0 ) );
+                REQUIRE( !cache.get( 1 ) );
+                REQUIRE( cache.get( 3 ) );
+                REQUIRE( cache.stats().pages == 3 );
+            }
+        }
+
+        WHEN( "Index generation changes" )
+        {
+            const auto newGeneration = cache.startReading( 1 );
+
+            THEN( "All pages are dropped" )
+            {
+                REQUIRE( cache.stats().pages == 0 );
+                REQUIRE( !cache.get( 0 ) );
+            }
+
+            THEN( "Pages read before are not added" )
+            {
+                cache.add( 0, makePage( 0 ), generation );
+                REQUIRE( !cache.get( 0 ) );
+
+                cache.add( 0, makePage( 0 ), newGeneration );
+                REQUIRE( cache.get( 0 ) );
+            }
+        }
+
+        WHEN( "Cache is cleared" )
+        {
+            cache.clear();
+
+            THEN( "Pages read before are not added" )
+            {
+                cache.add( 0, makePage( 0 ), generation );
+                REQUIRE( !cache.get( 0 ) );
+                REQUIRE( cache.startReading( 0 ) != generation );
+            }
+        }
+    }
+}
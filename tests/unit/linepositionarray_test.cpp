@@ -269,3 +269,344 @@ SCENARIO( "LinePositionArray with UINT32_MAX offsets", "[linepositionarray]" )
         }
     }
 }
+
+SCENARIO( "LinePositionArray truncation", "[linepositionarray]" )
+{
+    GIVEN( "LinePositionArray with several blocks of lines" )
+    {
+        LinePositionArray line_array;
+
+        // Mix of one byte, two bytes and absolute encoded lines
+        const std::array<uint64_t, 3> lineSizes = { 50, 500, 20000 };
+        klogg::vector<OffsetInFile> offsets;
+        uint64_t lineEnd = 0;
+        for ( auto i = 0u; i < 1000; ++i ) {
+            lineEnd += lineSizes[ i % lineSizes.size() ];
+            offsets.emplace_back( lineEnd );
+        }
+        for ( const auto& offset : offsets ) {
+            line_array.append( offset );
+        }
+
+        WHEN( "Truncating and appending lines" )
+        {
+            const auto newSize = GENERATE( 0, 1, 255, 256, 300, 511, 512, 999 );
+            line_array.truncate( LinesCount( static_cast<LinesCount::UnderlyingType>( newSize ) ) );
+
+            REQUIRE( line_array.size().get() == static_cast<uint64_t>( newSize ) );
+            for ( auto i = 0; i < newSize; ++i ) {
+                REQUIRE( line_array.at( i ) == offsets[ i ] );
+            }
+
+            for ( auto i = newSize; i < 1000; ++i ) {
+                line_array.append( offsets[ i ] );
+            }
+
+            THEN( "Correct offsets are returned" )
+            {
+                REQUIRE( line_array.size() == 1000_lcount );
+                for ( auto i = 0u; i < offsets.size(); ++i ) {
+                    REQUIRE( line_array.at( i ) == offsets[ i ] );
+                }
+            }
+        }
+
+        WHEN( "Truncating after fake lf" )
+        {
+            line_array.append( offsets.back() + 10_offset );
+            line_array.setFakeFinalLF();
+            line_array.truncate( 500_lcount );
+            line_array.append( 1_offset + offsets[ 499 ] );
+
+            THEN( "Fake lf is dropped" )
+            {
+                REQUIRE( line_array.size() == 501_lcount );
+                REQUIRE( !line_array.hasFakeFinalLF() );
+                REQUIRE( line_array.at( 500 ) == 1_offset + offsets[ 499 ] );
+            }
+        }
+    }
+
+    GIVEN( "LinePositionArray with long offsets" )
+    {
+        std::array<OffsetInFile, 6> offsets = { 4_offset,
+                                                8_offset,
+                                                OffsetInFile( UINT32_MAX - 10 ),
+                                                OffsetInFile( (uint64_t)UINT32_MAX + 10LL ),
+                                                OffsetInFile( (uint64_t)UINT32_MAX + 30LL ),
+                                                OffsetInFile( (uint64_t)2 * UINT32_MAX ) };
+
+        LinePositionArray line_array;
+        for ( const auto& offset : offsets ) {
+            line_array.append( offset );
+        }
+
+        WHEN( "Truncating at the first long offset" )
+        {
+            line_array.truncate( 3_lcount );
+            line_array.append( OffsetInFile( UINT32_MAX - 5 ) );
+            line_array.append( OffsetInFile( (uint64_t)UINT32_MAX + 20LL ) );
+
+            THEN( "Correct offsets are returned" )
+            {
+                REQUIRE( line_array.size() == 5_lcount );
+                REQUIRE( line_array.at( 2 ) == offsets[ 2 ] );
+                REQUIRE( line_array.at( 3 ) == OffsetInFile( UINT32_MAX - 5 ) );
+                REQUIRE( line_array.at( 4 ) == OffsetInFile( (uint64_t)UINT32_MAX + 20LL ) );
+            }
+        }
+
+        WHEN( "Truncating within long offsets" )
+        {
+            line_array.truncate( 4_lcount );
+            line_array.append( OffsetInFile( (uint64_t)UINT32_MAX + 20LL ) );
+
+            THEN( "Correct offsets are returned" )
+            {
+                REQUIRE( line_array.size() == 5_lcount );
+                REQUIRE( line_array.at( 3 ) == offsets[ 3 ] );
+                REQUIRE( line_array.at( 4 ) == OffsetInFile( (uint64_t)UINT32_MAX + 20LL ) );
+            }
+        }
+    }
+}
+
+SCENARIO( "LinePositionArray with flat positions", "[linepositionarray]" )
+{
+    GIVEN( "LinePositionArray using 32 bit positions" )
+    {
+        LinePositionArray line_array( AdaptiveLinePositionStorage( true ) );
+
+        FastLinePositionArray other_array;
+        for ( int64_t i = 1; i <= 1000; ++i ) {
+            other_array.append( OffsetInFile( i * 35 ) );
+        }
+        other_array.setFakeFinalLF();
+        line_array.append_list( other_array );
+
+        REQUIRE( line_array.storage().isShort() );
+        REQUIRE( line_array.size() == 1000_lcount );
+
+        THEN( "Positions after the last line are not read" )
+        {
+            REQUIRE_THROWS( line_array.at( 1000 ) );
+
+            OffsetInFile positions[ 2 ];
+            REQUIRE_THROWS( line_array.at_range( 999_lnum, 2_lcount, positions ) );
+        }
+
+        WHEN( "Adding lines after fake lf" )
+        {
+            line_array.append( OffsetInFile( 1000 * 35 + 5 ) );
+
+            THEN( "Correct offsets are returned" )
+            {
+                REQUIRE( line_array.storage().isShort() );
+                REQUIRE( line_array.size() == 1000_lcount );
+                REQUIRE( !line_array.hasFakeFinalLF() );
+                for ( int64_t i = 0; i < 999; ++i ) {
+                    REQUIRE( line_array.at( static_cast<uint64_t>( i ) )
+                             == OffsetInFile( ( i + 1 ) * 35 ) );
+                }
+                REQUIRE( line_array.at( 999 ) == OffsetInFile( 1000 * 35 + 5 ) );
+            }
+        }
+
+        WHEN( "Adding offsets that don't fit in 32 bits" )
+        {
+            line_array.append( OffsetInFile( UINT32_MAX - 10 ) );
+            line_array.append( OffsetInFile( (uint64_t)UINT32_MAX + 10LL ) );
+            line_array.append( OffsetInFile( (uint64_t)2 * UINT32_MAX ) );
+
+            THEN( "Positions are compressed" )
+            {
+                REQUIRE( !line_array.storage().isShort() );
+                REQUIRE( line_array.size() == 1002_lcount );
+                for ( int64_t i = 0; i < 999; ++i ) {
+                    REQUIRE( line_array.at( static_cast<uint64_t>( i ) )
+                             == OffsetInFile( ( i + 1 ) * 35 ) );
+                }
+                REQUIRE( line_array.at( 999 ) == OffsetInFile( UINT32_MAX - 10 ) );
+                REQUIRE( line_array.at( 1000 ) == OffsetInFile( (uint64_t)UINT32_MAX + 10LL ) );
+                REQUIRE( line_array.at( 1001 ) == OffsetInFile( (uint64_t)2 * UINT32_MAX ) );
+            }
+        }
+
+        WHEN( "Truncating and appending lines" )
+        {
+            line_array.truncate( 500_lcount );
+            line_array.append( OffsetInFile( 500 * 35 + 1 ) );
+
+            THEN( "Correct offsets are returned" )
+            {
+                REQUIRE( line_array.size() == 501_lcount );
+                REQUIRE( !line_array.hasFakeFinalLF() );
+                REQUIRE( line_array.at( 499 ) == OffsetInFile( 500 * 35 ) );
+                REQUIRE( line_array.at( 500 ) == OffsetInFile( 500 * 35 + 1 ) );
+            }
+        }
+    }
+}
+
+SCENARIO( "LinePositionArray range access", "[linepositionarray]" )
+{
+    std::mt19937 generator( 42 );
+    std::vector<OffsetInFile> offsets;
+    int64_t pos = 0;
+    for ( auto i = 0; i < 3000; ++i ) {
+        const auto kind = generator() % 100;
+        pos += kind == 0 ? 100000 : ( kind < 10 ? 1000 : 40 ) + generator() % 20;
+        if ( i == 2000 ) {
+            pos += (int64_t)UINT32_MAX;
+        }
+        offsets.emplace_back( pos );
+    }
+
+    for ( const auto useShortPositions : { false, true } ) {
+        GIVEN( "LinePositionArray with short and long offsets, flat " << useShortPositions )
+        {
+            LinePositionArray line_array{ AdaptiveLinePositionStorage( useShortPositions ) };
+            for ( const auto& offset : offsets ) {
+                line_array.append( offset );
+            }
+
+            WHEN( "Accessing ranges of lines" )
+            {
+                THEN( "Same offsets are returned as for single lines" )
+                {
+                    for ( auto i = 0; i < 200; ++i ) {
+                        const auto first = generator() % offsets.size();
+                        const auto count = generator() % ( offsets.size() - first + 1 );
+
+                        std::vector<OffsetInFile> range( count );
+                        line_array.at_range( LineNumber( first ), LinesCount( count ),
+                                             range.data() );
+                        for ( size_t line = 0; line < count; ++line ) {
+                            REQUIRE( range[ line ] == offsets[ first + line ] );
+                        }
+                    }
+                }
+            }
+
+            WHEN( "Accessing consecutive ranges with the last position" )
+            {
+                THEN( "Same offsets are returned as for single lines" )
+                {
+                    LinePositionArray::Cache lastPosition;
+                    size_t first = 0;
+                    while ( first < offsets.size() ) {
+                        const auto count = std::min<size_t>( 1 + generator() % 300,
+                                                             offsets.size() - first );
+
+                        std::vector<OffsetInFile> range( count );
+                        line_array.at_range( LineNumber( first ), LinesCount( count ),
+                                             range.data(), &lastPosition );
+                        for ( size_t line = 0; line < count; ++line ) {
+                            REQUIRE( range[ line ] == offsets[ first + line ] );
+                        }
+
+                        // Next range starts at the last line read or after it
+                        first += count - ( count > 1 ? generator() % 2 : 0 );
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO( "LinePositionArray with packed blocks", "[linepositionarray]" )
+{
+    std::mt19937 generator( 7 );
+    std::vector<OffsetInFile> offsets;
+    int64_t pos = 0;
+    for ( auto i = 0; i < 2000; ++i ) {
+        // Lines of two bytes entries are packed in fewer bits
+        pos += 150 + generator() % 100;
+        if ( i == 1500 ) {
+            pos += (int64_t)UINT32_MAX;
+        }
+        offsets.emplace_back( pos );
+    }
+
+    GIVEN( "LinePositionArray with lines of a few hundred bytes" )
+    {
+        CompressedLinePositionStorage storage;
+        for ( const auto& offset : offsets ) {
+            storage.append( offset );
+        }
+
+        WHEN( "Accessing lines in any order" )
+        {
+            THEN( "Correct offsets are returned" )
+            {
+                for ( auto i = 0; i < 1000; ++i ) {
+                    const auto line = generator() % offsets.size();
+                    REQUIRE( storage.at( line ) == offsets[ line ] );
+                }
+
+                std::vector<OffsetInFile> range( offsets.size() );
+                storage.at_range( LineNumber( 0 ), LinesCount( offsets.size() ), range.data() );
+                REQUIRE( range == offsets );
+            }
+        }
+
+        WHEN( "Popping lines around the end of a block" )
+        {
+            storage.truncate( LinesCount( 511 ) );
+            storage.append( offsets[ 511 ] );
+            storage.pop_back();
+            storage.append( offsets[ 511 ] );
+            storage.append( offsets[ 512 ] );
+            storage.pop_back();
+            storage.append( offsets[ 512 ] );
+            storage.append( offsets[ 513 ] );
+
+            THEN( "Correct offsets are returned" )
+            {
+                for ( size_t line = 0; line < 514; ++line ) {
+                    REQUIRE( storage.at( line ) == offsets[ line ] );
+                }
+            }
+        }
+
+        WHEN( "Truncating within a packed block" )
+        {
+            storage.truncate( LinesCount( 300 ) );
+            for ( size_t line = 300; line < offsets.size(); ++line ) {
+                storage.append( offsets[ line ] );
+            }
+
+            THEN( "Correct offsets are returned" )
+            {
+                for ( size_t line = 0; line < offsets.size(); ++line ) {
+                    REQUIRE( storage.at( line ) == offsets[ line ] );
+                }
+            }
+        }
+    }
+}
+
+SCENARIO( "LinePositionArray over the line index memory limit", "[linepositionarray]" )
+{
+    auto& config = Configuration::get();
+    const auto memoryLimit = config.lineIndexMemoryMb();
+    config.setLineIndexMemoryMb( 1 );
+
+    GIVEN( "LinePositionArray with blocks in more than one chunk" )
+    {
+        LinePositionArray line_array;
+        const auto lines = 1000000;
+        for ( int i = 0; i < lines; ++i ) {
+            line_array.append( OffsetInFile( i * 200LL + i % 7 ) );
+        }
+
+        THEN( "Correct offsets are returned" )
+        {
+            for ( int i = 0; i < lines; i += 997 ) {
+                REQUIRE( line_array.at( i ) == OffsetInFile( i * 200LL + i % 7 ) );
+            }
+        }
+    }
+
+    config.setLineIndexMemoryMb( memoryLimit );
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "linesorter.h"
+
+#include <random>
+
+namespace {
+using Records = klogg::vector<std::pair<uint64_t, uint64_t>>;
+
+Records keysAndLines( const klogg::vector<KeySorter::Record>& records )
+{
+    Records keysAndLines;
+    for ( const auto& record : records ) {
+        keysAndLines.emplace_back( record.key, record.line );
+    }
+    return keysAndLines;
+}
+
+Records mergedRecords( klogg::vector<KeySorter>& sorters )
+{
+    Records records;
+    AtomicFlag interruptRequested;
+    REQUIRE( KeySorter::merge( sorters, interruptRequested,
+                               [ &records ]( const KeySorter::Record& record ) {
+                                   records.emplace_back( record.key, record.line );
+                               } ) );
+    return records;
+}
+} // namespace
+
+TEST_CASE( "Keys are ordered as numbers", "[linesorter]" )
+{
+    const auto numbers = { -1e300, -42.5, -1.0, -0.0, 0.0, 1e-300, 1.0, 2.0, 12.5, 1e300 };
+    klogg::vector<uint64_t> keys;
+    for ( const auto number : numbers ) {
+        keys.push_back( KeySorter::keyOf( number ) );
+    }
+
+    REQUIRE( std::is_sorted( keys.begin(), keys.end() ) );
+    REQUIRE( keys.back() < KeySorter::MissingKey );
+}
+
+TEST_CASE( "Records are sorted by keys then lines", "[linesorter]" )
+{
+    klogg::vector<KeySorter::Record> records
+        = { { 3, 10 }, { 1, 7 }, { 3, 2 }, { 0x100, 1 }, { 1, 0x10000 }, { 1, 3 } };
+
+    KeySorter::radixSort( records, true );
+
+    REQUIRE( keysAndLines( records )
+             == Records{ { 1, 3 }, { 1, 7 }, { 1, 0x10000 }, { 3, 2 }, { 3, 10 }, { 0x100, 1 } } );
+}
+
+TEST_CASE( "Records that don't fit in memory are merged from runs", "[linesorter]" )
+{
+    constexpr uint64_t NbRecords = 10 * 1000;
+
+    std::mt19937_64 random( 42 );
+    klogg::vector<KeySorter> sorters;
+    sorters.emplace_back( 1024 );
+    sorters.emplace_back( 1024 );
+
+    Records expected;
+    for ( uint64_t line = 0; line < NbRecords; ++line ) {
+        const auto key = random() % 100;
+        sorters[ line % 2 ].add( key, line );
+        expected.emplace_back( key, line );
+    }
+    std::sort( expected.begin(), expected.end() );
+
+    REQUIRE( sorters[ 0 ].runs() > 0 );
+    REQUIRE( mergedRecords( sorters ) == expected );
+}
+
+TEST_CASE( "Records in memory are merged without runs", "[linesorter]" )
+{
+    klogg::vector<KeySorter> sorters;
+    sorters.emplace_back( 1024 );
+    sorters.emplace_back( 1024 );
+    sorters[ 0 ].add( KeySorter::MissingKey, 0 );
+    sorters[ 1 ].add( 5, 1 );
+    sorters[ 0 ].add( 5, 2 );
+    sorters[ 1 ].add( 2, 3 );
+
+    REQUIRE( sorters[ 0 ].runs() == 0 );
+    REQUIRE( mergedRecords( sorters )
+             == Records{ { 2, 3 }, { 5, 1 }, { 5, 2 }, { KeySorter::MissingKey, 0 } } );
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "logtemplates.h"
+
+#include <string>
+
+namespace {
+using Templates = klogg::vector<std::pair<std::string, uint64_t>>;
+
+Templates textsAndCounts( TemplateMiner& miner )
+{
+    Templates templates;
+    for ( const auto& logTemplate : miner.takeTemplates() ) {
+        templates.emplace_back( logTemplate.text.toStdString(),
+                                logTemplate.lines.cardinality() );
+    }
+    return templates;
+}
+
+void addLines( TemplateMiner& miner, const klogg::vector<std::string_view>& lines,
+               LineNumber firstLine = 0_lnum )
+{
+    for ( size_t offset = 0; offset < lines.size(); ++offset ) {
+        miner.add( lines[ offset ], firstLine + LinesCount( offset ) );
+    }
+}
+} // namespace
+
+TEST_CASE( "Lines of the same shape share a template", "[logtemplates]" )
+{
+    TemplateMiner miner;
+    addLines( miner, {
+                         "2024-03-01 10:00:01 user alice logged in from 10.0.0.1",
+                         "2024-03-01 10:00:02 user bob logged in from 10.0.0.2",
+                         "2024-03-01 10:00:03 cache miss for key=42",
+                         "2024-03-01 10:00:04 user carol logged in from 10.0.0.3",
+                         "2024-03-01 10:00:05 cache miss for key=43",
+                         "",
+                     } );
+
+    REQUIRE( textsAndCounts( miner )
+             == Templates{ { "<*> <*> user <*> logged in from <*>", 3 },
+                           { "<*> <*> cache miss for <*>", 2 },
+                           { "", 1 } } );
+}
+
+TEST_CASE( "Templates keep their lines", "[logtemplates]" )
+{
+    TemplateMiner miner;
+    addLines( miner, { "start job 1", "stop job 1", "start job 2" }, 10_lnum );
+
+    const auto templates = miner.takeTemplates();
+    REQUIRE( templates.size() == 2 );
+    REQUIRE( templates[ 0 ].text.toStdString() == "start job <*>" );
+
+    roaring::Roaring64Map expectedLines;
+    expectedLines.add( 10 );
+    expectedLines.add( 12 );
+    REQUIRE( templates[ 0 ].lines == expectedLines );
+}
+
+TEST_CASE( "Templates of different miners are merged", "[logtemplates]" )
+{
+    TemplateMiner first;
+    addLines( first, { "request GET /users done", "worker idle" } );
+
+    TemplateMiner second;
+    addLines( second, { "request GET /orders done", "request GET /items done", "worker idle" },
+              100_lnum );
+
+    first.merge( std::move( second ) );
+    REQUIRE( textsAndCounts( first )
+             == Templates{ { "request GET <*> done", 3 }, { "worker idle", 2 } } );
+}
+
+TEST_CASE( "Lines beyond the templates limit are not clustered", "[logtemplates]" )
+{
+    TemplateMiner miner;
+    for ( size_t index = 0; index < TemplateMiner::MaxTemplates + 10; ++index ) {
+        // Letters only, so each line has its own first token
+        std::string line = "event";
+        for ( auto value = index; value > 0; value /= 26 ) {
+            line.push_back( static_cast<char>( 'a' + value % 26 ) );
+        }
+        miner.add( line, LineNumber( index ) );
+    }
+
+    REQUIRE( miner.unclusteredLines() == 10 );
+    REQUIRE( miner.takeTemplates().size() == TemplateMiner::MaxTemplates );
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "fileholder.h"
+#include "mergedaccess.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTime>
+
+#include <memory>
+
+namespace {
+constexpr auto TimestampFormat = "yyyy-MM-dd HH:mm:ss.zzz";
+
+void writeFile( const QString& fileName, const QByteArray& data )
+{
+    QFile file( fileName );
+    REQUIRE( file.open( QIODevice::WriteOnly ) );
+    REQUIRE( file.write( data ) == data.size() );
+}
+
+QByteArray makeLine( int second, const QByteArray& text )
+{
+    return "2024-01-01 " + QTime( 0, 0 ).addSecs( second ).toString( "HH:mm:ss" ).toUtf8()
+           + ".000 " + text + "\n";
+}
+
+std::shared_ptr<FileChain> mergedChain( const QString& listFileName )
+{
+    auto chain = std::make_shared<FileChain>();
+    chain->setCompressedAccess( std::make_shared<MergedAccess>( listFileName, TimestampFormat ) );
+    return chain;
+}
+} // namespace
+
+SCENARIO( "Logs of a merge list are merged by time", "[mergedaccess]" )
+{
+    QTemporaryDir dir;
+    REQUIRE( dir.isValid() );
+
+    writeFile( dir.filePath( "a.log" ), "2024-01-01 10:00:00.100 a1\n"
+                                        "2024-01-01 10:00:00.300 a2\n"
+                                        "  at trace\n"
+                                        "2024-01-01 10:00:00.500 a3" );
+    writeFile( dir.filePath( "b.log" ), "header\n"
+                                        "2024-01-01 10:00:00.200 b1\n"
+                                        "2024-01-01 10:00:00.300 b2\n"
+                                        "2024-01-01 10:00:00.600 b3\n" );
+
+    const auto listFileName = dir.filePath( "logs.klogg-merge" );
+    writeFile( listFileName, "# services\n"
+                             + dir.filePath( "a.log" ).toUtf8() + "\n"
+                             + "\n"
+                             + "b.log\n" );
+
+    const QByteArray merged = "header\n"
+                              "2024-01-01 10:00:00.100 a1\n"
+                              "2024-01-01 10:00:00.200 b1\n"
+                              "2024-01-01 10:00:00.300 a2\n"
+                              "  at trace\n"
+                              "2024-01-01 10:00:00.300 b2\n"
+                              "2024-01-01 10:00:00.500 a3\n"
+                              "2024-01-01 10:00:00.600 b3\n";
+
+    GIVEN( "Merge list opened with its access" )
+    {
+        auto chain = mergedChain( listFileName );
+        ChainedFile chainedFile( listFileName, chain );
+        REQUIRE( chainedFile.open( QIODevice::ReadOnly ) );
+
+        THEN( "Records of the logs are interleaved by time" )
+        {
+            REQUIRE( chain->compressedAccess()->isBuilt() );
+            REQUIRE( chainedFile.size() == merged.size() );
+            REQUIRE( !chainedFile.canMap() );
+            REQUIRE( chainedFile.readAll() == merged );
+        }
+
+        THEN( "Merged data is read at any offset" )
+        {
+            for ( int offset = 0; offset < merged.size(); offset += 7 ) {
+                REQUIRE( chainedFile.seek( offset ) );
+                REQUIRE( chainedFile.read( 40 ) == merged.mid( offset, 40 ) );
+            }
+        }
+
+        THEN( "Relative paths start in the directory of the list" )
+        {
+            const auto access
+                = std::dynamic_pointer_cast<MergedAccess>( chain->compressedAccess() );
+            REQUIRE( access->logFileNames()
+                     == QStringList{ QDir::cleanPath( dir.filePath( "a.log" ) ),
+                                     QDir::cleanPath( dir.filePath( "b.log" ) ) } );
+        }
+    }
+
+    GIVEN( "Merge list with a missing log" )
+    {
+        writeFile( listFileName, "a.log\nmissing.log\n" );
+
+        THEN( "List is not opened" )
+        {
+            ChainedFile chainedFile( listFileName, mergedChain( listFileName ) );
+            REQUIRE( !chainedFile.open( QIODevice::ReadOnly ) );
+        }
+    }
+}
+
+SCENARIO( "Merge lists are written and recognized", "[mergedaccess]" )
+{
+    QTemporaryDir dir;
+    REQUIRE( dir.isValid() );
+
+    const auto listFileName = dir.filePath( "logs.klogg-merge" );
+    REQUIRE( MergedAccess::writeMergeList( listFileName, { dir.filePath( "a.log" ),
+                                                           dir.filePath( "b.log" ) } ) );
+
+    REQUIRE( MergedAccess::isMergeList( listFileName ) );
+    REQUIRE( !MergedAccess::isMergeList( dir.filePath( "a.log" ) ) );
+    REQUIRE( std::dynamic_pointer_cast<MergedAccess>( CompressedAccess::create( listFileName ) ) );
+
+    QFile list( listFileName );
+    REQUIRE( list.open( QIODevice::ReadOnly ) );
+    REQUIRE( list.readAll()
+             == QDir::toNativeSeparators( dir.filePath( "a.log" ) ).toUtf8() + "\n"
+                    + QDir::toNativeSeparators( dir.filePath( "b.log" ) ).toUtf8() + "\n" );
+}
+
+SCENARIO( "Large logs are merged line by line", "[mergedaccess]" )
+{
+    QTemporaryDir dir;
+    REQUIRE( dir.isValid() );
+
+    // Logs are longer than a read chunk, lines of even and odd seconds alternate
+    constexpr auto LinesCount = 3000;
+    QByteArray even;
+    QByteArray odd;
+    QByteArray merged;
+    for ( auto second = 0; second < 2 * LinesCount; ++second ) {
+        const auto line = makeLine( second, QByteArray( 400, second % 2 ? 'o' : 'e' ) );
+        ( second % 2 ? odd : even ).append( line );
+        merged.append( line );
+    }
+
+    writeFile( dir.filePath( "odd.log" ), odd );
+    writeFile( dir.filePath( "even.log" ), even );
+
+    const auto listFileName = dir.filePath( "logs.klogg-merge" );
+    writeFile( listFileName, "odd.log\neven.log\n" );
+
+    auto chain = mergedChain( listFileName );
+    ChainedFile chainedFile( listFileName, chain );
+    REQUIRE( chainedFile.open( QIODevice::ReadOnly ) );
+
+    REQUIRE( chainedFile.size() == merged.size() );
+    REQUIRE( chainedFile.readAll() == merged );
+
+    auto opened = std::make_shared<QFile>( listFileName );
+    REQUIRE( opened->open( QIODevice::ReadOnly ) );
+    const FileReader reader( opened, {}, chain->compressedAccess() );
+
+    const auto end = static_cast<int>( merged.size() );
+    QByteArray buffer( 1000, '\0' );
+    for ( const int offset : { end - 1000, 100, end / 2 + 3 } ) {
+        REQUIRE( reader.read( offset, buffer.data(), buffer.size() ) == buffer.size() );
+        REQUIRE( buffer == merged.mid( offset, buffer.size() ) );
+    }
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "metrics.h"
+
+#include <thread>
+#include <vector>
+
+SCENARIO( "Metrics are registered once by name", "[metrics]" )
+{
+    auto& metrics = Metrics::get();
+
+    THEN( "The same metric is returned for the same name" )
+    {
+        REQUIRE( &metrics.counter( "test.registered" ) == &metrics.counter( "test.registered" ) );
+        REQUIRE( &metrics.counter( "test.registered" ) != &metrics.counter( "test.other" ) );
+    }
+
+    WHEN( "Values are recorded" )
+    {
+        metrics.reset();
+        metrics.counter( "test.events" ).add( 3 );
+        metrics.counter( "test.events" ).add();
+        metrics.gauge( "test.size_bytes" ).set( 42 );
+        metrics.histogram( "test.duration_us" ).record( 10 );
+
+        THEN( "They are exported as json" )
+        {
+            const auto json = metrics.toJson();
+            REQUIRE( json[ "counters" ].toObject()[ "test.events" ].toInt() == 4 );
+            REQUIRE( json[ "gauges" ].toObject()[ "test.size_bytes" ].toDouble() == 42 );
+
+            const auto histogram
+                = json[ "histograms" ].toObject()[ "test.duration_us" ].toObject();
+            REQUIRE( histogram[ "count" ].toInt() == 1 );
+            REQUIRE( histogram[ "p50" ].toInt() == 10 );
+        }
+
+        THEN( "Reset clears them" )
+        {
+            metrics.reset();
+            REQUIRE( metrics.counter( "test.events" ).value() == 0 );
+            REQUIRE( metrics.histogram( "test.duration_us" ).snapshot().count == 0 );
+        }
+    }
+}
+
+SCENARIO( "Histogram summarizes recorded values", "[metrics]" )
+{
+    Metrics::Histogram histogram;
+
+    GIVEN( "No values" )
+    {
+        const auto snapshot = histogram.snapshot();
+        REQUIRE( snapshot.count == 0 );
+        REQUIRE( snapshot.min == 0 );
+        REQUIRE( snapshot.percentile( 0.5 ) == 0 );
+    }
+
+    GIVEN( "Values from 1 to 100" )
+    {
+        for ( uint64_t value = 1; value <= 100; ++value ) {
+            histogram.record( value );
+        }
+
+        const auto snapshot = histogram.snapshot();
+        REQUIRE( snapshot.count == 100 );
+        REQUIRE( snapshot.sum == 5050 );
+        REQUIRE( snapshot.min == 1 );
+        REQUIRE( snapshot.max == 100 );
+        REQUIRE( snapshot.mean() == Approx( 50.5 ) );
+
+        THEN( "Percentiles are bounds of power of two buckets" )
+        {
+            REQUIRE( snapshot.percentile( 0.5 ) == 63 );
+            REQUIRE( snapshot.percentile( 0.99 ) == 100 );
+            REQUIRE( snapshot.percentile( 0 ) == 1 );
+        }
+    }
+
+    GIVEN( "Values recorded by many threads" )
+    {
+        constexpr auto Threads = 4;
+        constexpr auto ValuesPerThread = 10000;
+
+        std::vector<std::thread> threads;
+        for ( auto thread = 0; thread < Threads; ++thread ) {
+            threads.emplace_back( [ &histogram ] {
+                for ( auto value = 0; value < ValuesPerThread; ++value ) {
+                    histogram.record( static_cast<uint64_t>( value ) );
+                }
+            } );
+        }
+        for ( auto& thread : threads ) {
+            thread.join();
+        }
+
+        const auto snapshot = histogram.snapshot();
+        REQUIRE( snapshot.count == Threads * ValuesPerThread );
+        REQUIRE( snapshot.min == 0 );
+        REQUIRE( snapshot.max == ValuesPerThread - 1 );
+    }
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "mpscqueue.h"
+
+#include <thread>
+#include <vector>
+
+SCENARIO( "Values pushed by many threads are popped by one", "[mpscqueue]" )
+{
+    MpscQueue<int> queue;
+
+    GIVEN( "An empty queue" )
+    {
+        int value = 0;
+        REQUIRE_FALSE( queue.pop( value ) );
+    }
+
+    GIVEN( "Values pushed by one thread" )
+    {
+        for ( int value = 0; value < 10; ++value ) {
+            queue.push( value );
+        }
+
+        THEN( "They are popped in order" )
+        {
+            int value = -1;
+            for ( int expected = 0; expected < 10; ++expected ) {
+                REQUIRE( queue.pop( value ) );
+                REQUIRE( value == expected );
+            }
+            REQUIRE_FALSE( queue.pop( value ) );
+        }
+    }
+
+    GIVEN( "Values pushed by several threads at once" )
+    {
+        constexpr int Producers = 4;
+        constexpr int ValuesPerProducer = 10000;
+
+        std::vector<std::thread> producers;
+        for ( int producer = 0; producer < Producers; ++producer ) {
+            producers.emplace_back( [ &queue, producer ] {
+                for ( int value = 0; value < ValuesPerProducer; ++value ) {
+                    queue.push( producer * ValuesPerProducer + value );
+                }
+            } );
+        }
+
+        // Popped while the threads push
+        std::vector<int> values;
+        int value = 0;
+        while ( values.size() < static_cast<size_t>( Producers * ValuesPerProducer ) ) {
+            if ( queue.pop( value ) ) {
+                values.push_back( value );
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+
+        for ( auto& producer : producers ) {
+            producer.join();
+        }
+
+        THEN( "All are popped, values of each thread in order" )
+        {
+            REQUIRE_FALSE( queue.pop( value ) );
+
+            std::vector<int> lastValues( Producers, -1 );
+            for ( const auto popped : values ) {
+                const auto producer = popped / ValuesPerProducer;
+                REQUIRE( popped % ValuesPerProducer > lastValues[ producer ] );
+                lastValues[ producer ] = popped % ValuesPerProducer;
+            }
+            for ( const auto last : lastValues ) {
+                REQUIRE( last == ValuesPerProducer - 1 );
+            }
+        }
+    }
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+
+#include "networkfilecache.h"
+
+namespace {
+constexpr qint64 BlockSize = NetworkFileCache::BlockSize;
+
+// Three whole blocks and a part of the block at the end of the file
+QByteArray makeData( char first )
+{
+    QByteArray data( static_cast<int>( 3 * BlockSize + BlockSize / 2 ), '\0' );
+    for ( auto i = 0; i < data.size(); ++i ) {
+        data[ i ] = static_cast<char>( first + ( i * 7 + i / 1000 ) % 26 );
+    }
+    return data;
+}
+
+// Reads of the file standing for the share, counted to tell hits from misses
+struct Share {
+    QFile& file;
+    int reads = 0;
+
+    qint64 operator()( qint64 offset, char* data, qint64 size )
+    {
+        ++reads;
+        return file.seek( offset ) ? file.read( data, size ) : qint64{ -1 };
+    }
+};
+
+QByteArray readAll( NetworkFileCache& cache, Share& share, qint64 size )
+{
+    QByteArray data( static_cast<int>( size ), '\0' );
+    const auto readShare = [ &share ]( qint64 offset, char* buffer, qint64 bufferSize ) {
+        return share( offset, buffer, bufferSize );
+    };
+    REQUIRE( cache.read( 0, data.data(), size, readShare ) == size );
+    return data;
+}
+} // namespace
+
+SCENARIO( "Network file cache", "[networkfilecache]" )
+{
+    QStandardPaths::setTestModeEnabled( true );
+
+    const auto data = makeData( 'a' );
+
+    QTemporaryFile file;
+    REQUIRE( file.open() );
+    REQUIRE( file.write( data ) == data.size() );
+    REQUIRE( file.flush() );
+
+    Share share{ file };
+
+    auto cache = NetworkFileCache::forAnyFile( file, FileId{} );
+    REQUIRE( cache );
+    REQUIRE( cache->cachedBlocks() == 0 );
+
+    GIVEN( "File read once through the cache" )
+    {
+        REQUIRE( readAll( *cache, share, data.size() ) == data );
+        REQUIRE( share.reads == 4 );
+        REQUIRE( cache->cachedBlocks() == 3 );
+
+        THEN( "Whole blocks are read from the cache" )
+        {
+            share.reads = 0;
+            REQUIRE( readAll( *cache, share, data.size() ) == data );
+            REQUIRE( share.reads == 1 );
+
+            QByteArray middle( 100, '\0' );
+            const auto readShare = [ &share ]( qint64 offset, char* buffer, qint64 size ) {
+                return share( offset, buffer, size );
+            };
+            REQUIRE( cache->read( BlockSize - 50, middle.data(), middle.size(), readShare )
+                     == middle.size() );
+            REQUIRE( middle == data.mid( static_cast<int>( BlockSize - 50 ), 100 ) );
+            REQUIRE( share.reads == 1 );
+        }
+
+        WHEN( "Cache of the unchanged file is opened again" )
+        {
+            cache.reset();
+            cache = NetworkFileCache::forAnyFile( file, FileId{} );
+            REQUIRE( cache );
+
+            THEN( "Blocks are still cached" )
+            {
+                share.reads = 0;
+                REQUIRE( cache->cachedBlocks() == 3 );
+                const auto cachedSize = static_cast<int>( 3 * BlockSize );
+                REQUIRE( readAll( *cache, share, cachedSize ) == data.left( cachedSize ) );
+                REQUIRE( share.reads == 0 );
+            }
+        }
+
+        WHEN( "Data is appended to the file" )
+        {
+            cache.reset();
+            REQUIRE( file.seek( file.size() ) );
+            REQUIRE( file.write( data ) == data.size() );
+            REQUIRE( file.flush() );
+            REQUIRE( file.setFileTime( QDateTime::currentDateTime().addSecs( 3600 ),
+                                       QFileDevice::FileModificationTime ) );
+
+            cache = NetworkFileCache::forAnyFile( file, FileId{} );
+            REQUIRE( cache );
+
+            THEN( "Blocks before are kept" )
+            {
+                REQUIRE( cache->cachedBlocks() == 3 );
+            }
+        }
+
+        WHEN( "Beginning of the file is changed" )
+        {
+            cache.reset();
+            const auto changedData = makeData( 'A' );
+            REQUIRE( file.seek( 0 ) );
+            REQUIRE( file.write( changedData ) == changedData.size() );
+            REQUIRE( file.flush() );
+            REQUIRE( file.setFileTime( QDateTime::currentDateTime().addSecs( 3600 ),
+                                       QFileDevice::FileModificationTime ) );
+
+            cache = NetworkFileCache::forAnyFile( file, FileId{} );
+            REQUIRE( cache );
+
+            THEN( "Cached blocks are dropped" )
+            {
+                share.reads = 0;
+                REQUIRE( cache->cachedBlocks() == 0 );
+                REQUIRE( readAll( *cache, share, changedData.size() ) == changedData );
+                REQUIRE( share.reads == 4 );
+            }
+        }
+    }
+
+    GIVEN( "File of another id with the same name" )
+    {
+        REQUIRE( readAll( *cache, share, data.size() ) == data );
+
+        const auto otherCache = NetworkFileCache::forAnyFile( file, FileId{ 1, 0 } );
+        REQUIRE( otherCache );
+
+        THEN( "It has its own cache" )
+        {
+            REQUIRE( otherCache != cache );
+            REQUIRE( otherCache->cachedBlocks() == 0 );
+        }
+    }
+}
@@ -57,6 +57,51 @@ SCENARIO( "Pattern matcher in boolean mode", "[patternmatcher]" )
         REQUIRE( matcher->hasMatch( matchLine ) );
     }
 
+    WHEN( "Using field predicates with patterns" )
+    {
+        const std::string_view fieldsLine = R"(ts=1 latency_ms=750 msg="upstream timeout")";
+
+        RegularExpression slowTimeout( RegularExpressionPattern(
+            R"("@latency_ms>500" and "timeout")", true, false, true, false ) );
+        REQUIRE( slowTimeout.isValid() );
+        REQUIRE( slowTimeout.createMatcher()->hasMatch( fieldsLine ) );
+
+        RegularExpression fastOrMissing( RegularExpressionPattern(
+            R"("@latency_ms<=500" or not("@msg=\"upstream timeout\""))", true, false, true,
+            false ) );
+        REQUIRE( fastOrMissing.isValid() );
+        REQUIRE_FALSE( fastOrMissing.createMatcher()->hasMatch( fieldsLine ) );
+    }
+
+    WHEN( "Using several matchers of one expression" )
+    {
+        RegularExpression expression( RegularExpressionPattern(
+            "\"matching\" and not(\"pattern\")", false, false, true, false ) );
+        const auto firstMatcher = expression.createMatcher();
+        const auto secondMatcher = expression.createMatcher();
+        REQUIRE_FALSE( firstMatcher->hasMatch( matchLine ) );
+        REQUIRE( secondMatcher->hasMatch( "matching line" ) );
+        REQUIRE_FALSE( secondMatcher->hasMatch( matchLine ) );
+    }
+
+    WHEN( "Using too many patterns to tabulate results" )
+    {
+        QString pattern = "\"matching\" and not(\"word0\"";
+        for ( auto word = 1; word < 20; ++word ) {
+            pattern += QString( " or \"word%1\"" ).arg( word );
+        }
+        pattern += ")";
+
+        RegularExpression expression(
+            RegularExpressionPattern( pattern, false, false, true, true ) );
+        REQUIRE( expression.isValid() );
+        const auto firstMatcher = expression.createMatcher();
+        const auto secondMatcher = expression.createMatcher();
+        REQUIRE( firstMatcher->hasMatch( matchLine ) );
+        REQUIRE_FALSE( secondMatcher->hasMatch( "matching word19" ) );
+        REQUIRE( secondMatcher->hasMatch( matchLine ) );
+    }
+
     WHEN( "Using pattern with not matched quotes" )
     {
         RegularExpression expression(
@@ -65,3 +110,272 @@ SCENARIO( "Pattern matcher in boolean mode", "[patternmatcher]" )
         REQUIRE_FALSE( expression.isValid() );
     }
 }
+
+SCENARIO( "Pattern matcher for blocks of lines", "[patternmatcher]" )
+{
+    const std::string_view text = "foo bar\n\nbar foo\nbaz\nfoo\n\nbar";
+
+    klogg::vector<std::string_view> lines;
+    size_t lineStart = 0;
+    for ( auto lineFeed = text.find( '\n' ); lineFeed != std::string_view::npos;
+          lineFeed = text.find( '\n', lineStart ) ) {
+        lines.push_back( text.substr( lineStart, lineFeed - lineStart ) );
+        lineStart = lineFeed + 1;
+    }
+    lines.push_back( text.substr( lineStart ) );
+
+    for ( const auto* pattern : { "foo", "^bar", "o$", "^$", "ba[rz]", "\\sfoo" } ) {
+        for ( const auto isExclude : { false, true } ) {
+            RegularExpression expression(
+                RegularExpressionPattern( pattern, true, isExclude, false, false ) );
+            const auto matcher = expression.createMatcher();
+
+            klogg::vector<size_t> expectedLines;
+            for ( size_t index = 0; index < lines.size(); ++index ) {
+                if ( matcher->hasMatch( lines[ index ] ) ) {
+                    expectedLines.push_back( index );
+                }
+            }
+
+            klogg::vector<size_t> matchingLines;
+            if ( matcher->matchLines( lines, matchingLines ) ) {
+                INFO( "Pattern " << pattern << ", exclude " << isExclude );
+                REQUIRE( matchingLines == expectedLines );
+            }
+        }
+    }
+}
+
+SCENARIO( "Pattern matcher for lines read in parts", "[patternmatcher]" )
+{
+    const std::string_view line = "connection to upstream timed out";
+
+    for ( const auto* pattern : { "upstream", "upstream timed? out$", "^connection", "^timed" } ) {
+        for ( const auto isExclude : { false, true } ) {
+            RegularExpression expression(
+                RegularExpressionPattern( pattern, true, isExclude, false, false ) );
+            const auto matcher = expression.createMatcher();
+
+            // Parts split the pattern
+            const auto isMatching = matcher->hasMatchInParts( [ &line ]( const auto& consume ) {
+                for ( size_t partStart = 0; partStart < line.size(); partStart += 5 ) {
+                    if ( !consume( line.substr( partStart, 5 ) ) ) {
+                        break;
+                    }
+                }
+                return true;
+            } );
+
+            if ( isMatching.has_value() ) {
+                INFO( "Pattern " << pattern << ", exclude " << isExclude );
+                REQUIRE( *isMatching == matcher->hasMatch( line ) );
+            }
+        }
+    }
+
+    WHEN( "Using boolean combination" )
+    {
+        RegularExpression expression( RegularExpressionPattern(
+            "\"upstream\" and not \"error\"", false, false, true, true ) );
+        const auto isMatching = expression.createMatcher()->hasMatchInParts(
+            []( const auto& ) { return true; } );
+        REQUIRE_FALSE( isMatching.has_value() );
+    }
+}
+
+SCENARIO( "Pattern matcher with required literal", "[patternmatcher]" )
+{
+    const std::string_view text = "ERROR: request timeout\nuser_id=42 ok\nERROR: bad\n"
+                                  "user_id=x\nINFO: timeout of ERROR\n(a.b) ab\nfoo\nERRORtimeout";
+
+    klogg::vector<std::string_view> lines;
+    size_t lineStart = 0;
+    for ( auto lineFeed = text.find( '\n' ); lineFeed != std::string_view::npos;
+          lineFeed = text.find( '\n', lineStart ) ) {
+        lines.push_back( text.substr( lineStart, lineFeed - lineStart ) );
+        lineStart = lineFeed + 1;
+    }
+    lines.push_back( text.substr( lineStart ) );
+
+    const auto checkPattern = [ &lines ]( const RegularExpressionPattern& pattern ) {
+        RegularExpression expression( pattern );
+        const auto matcher = expression.createMatcher();
+
+        klogg::vector<size_t> expectedLines;
+        for ( size_t index = 0; index < lines.size(); ++index ) {
+            if ( matcher->hasMatch( lines[ index ] ) ) {
+                expectedLines.push_back( index );
+            }
+        }
+
+        klogg::vector<size_t> matchingLines;
+        const auto isBlockMatched = matcher->matchLines( lines, matchingLines );
+        INFO( "Pattern " << pattern.pattern.toStdString() );
+        if ( isBlockMatched ) {
+            REQUIRE( matchingLines == expectedLines );
+        }
+        return isBlockMatched;
+    };
+
+    for ( const auto* pattern : { "ERROR.*timeout", "user_id=\\d+", "ERRORS?: bad", "(ERROR|INFO)",
+                                  "E+RROR[:]", "\\(a\\.b\\)", "f[o]+", "ab|foo" } ) {
+        for ( const auto isExclude : { false, true } ) {
+            checkPattern( RegularExpressionPattern( pattern, true, isExclude, false, false ) );
+        }
+    }
+
+    WHEN( "Using plain text pattern" )
+    {
+        REQUIRE( checkPattern( RegularExpressionPattern( "(a.b)", true, false, false, true ) ) );
+        REQUIRE( checkPattern( RegularExpressionPattern( "ERROR", true, true, false, true ) ) );
+    }
+}
+
+SCENARIO( "Pattern matcher for plain text", "[patternmatcher]" )
+{
+    const std::string_view line = "GET /api?q=(a+b)*2 [x] {y} ^$ | Größe";
+
+    const auto hasMatch = [ &line ]( const QString& text, bool isCaseSensitive ) {
+        RegularExpression expression(
+            RegularExpressionPattern( text, isCaseSensitive, false, false, true ) );
+        REQUIRE( expression.isValid() );
+        return expression.createMatcher()->hasMatch( line );
+    };
+
+    WHEN( "Text has characters of regular expressions" )
+    {
+        REQUIRE( hasMatch( "?q=(a+b)*2", true ) );
+        REQUIRE( hasMatch( "[x] {y} ^$ |", true ) );
+        REQUIRE_FALSE( hasMatch( "(a+b)*3", true ) );
+    }
+
+    WHEN( "Case is ignored" )
+    {
+        REQUIRE( hasMatch( "get /API", false ) );
+        REQUIRE_FALSE( hasMatch( "get /API", true ) );
+        REQUIRE( hasMatch( "GRÖßE", false ) );
+        REQUIRE_FALSE( hasMatch( "GRÖßE", true ) );
+    }
+
+    WHEN( "Plain text and regular expressions are matched at once" )
+    {
+        HsRegularExpression expression( klogg::vector<RegularExpressionPattern>{
+            RegularExpressionPattern( "(a+b)*2", true, false, false, true ),
+            RegularExpressionPattern( "q=\\(a", true, false, false, false ),
+            RegularExpressionPattern( "[X]", false, false, false, true ),
+            RegularExpressionPattern( "\\d{3}", true, false, false, false ),
+            RegularExpressionPattern( "[y]", true, false, false, true ) } );
+        REQUIRE( expression.isValid() );
+
+        const auto matcher = expression.createMatcher();
+        const auto matched = std::visit(
+            [ &line ]( const auto& patternsMatcher ) {
+                return std::string( patternsMatcher.match( line ) );
+            },
+            matcher );
+
+        REQUIRE( matched.size() == 5 );
+        REQUIRE( matched[ 0 ] != 0 );
+        REQUIRE( matched[ 1 ] != 0 );
+        REQUIRE( matched[ 2 ] != 0 );
+        REQUIRE( matched[ 3 ] == 0 );
+        REQUIRE( matched[ 4 ] == 0 );
+    }
+}
+
+SCENARIO( "Pattern matcher for UTF-16 lines", "[patternmatcher]" )
+{
+    const std::string_view text = "ERROR: request timeout\nuser_id=42 ok\nERROR: bad\n"
+                                  "user_id=x\nINFO: timeout of ERROR\n\nERRORtimeout\n";
+
+    klogg::vector<std::string_view> lines;
+    size_t lineStart = 0;
+    for ( auto lineFeed = text.find( '\n' ); lineFeed != std::string_view::npos;
+          lineFeed = text.find( '\n', lineStart ) ) {
+        lines.push_back( text.substr( lineStart, lineFeed - lineStart ) );
+        lineStart = lineFeed + 1;
+    }
+
+    for ( const auto isBigEndian : { false, true } ) {
+        // Code units of latin text have one zero byte
+        std::string data;
+        klogg::vector<qint64> endOfLines;
+        for ( const auto c : text ) {
+            data.push_back( isBigEndian ? '\0' : c );
+            data.push_back( isBigEndian ? c : '\0' );
+            if ( c == '\n' ) {
+                endOfLines.push_back( static_cast<qint64>( data.size() ) );
+            }
+        }
+
+        for ( const auto* pattern : { "ERROR.*timeout", "user_id=\\d+", "ERRORS?: bad", "ok$" } ) {
+            for ( const auto isExclude : { false, true } ) {
+                RegularExpression expression(
+                    RegularExpressionPattern( pattern, true, isExclude, false, false ) );
+                const auto matcher = expression.createMatcher();
+
+                klogg::vector<size_t> expectedLines;
+                for ( size_t index = 0; index < lines.size(); ++index ) {
+                    if ( matcher->hasMatch( lines[ index ] ) ) {
+                        expectedLines.push_back( index );
+                    }
+                }
+
+                klogg::vector<size_t> matchingLines;
+                INFO( "Pattern " << pattern << ", exclude " << isExclude << ", big endian "
+                                 << isBigEndian );
+                REQUIRE( matcher->matchUtf16Lines( data, endOfLines, isBigEndian,
+                                                   matchingLines ) );
+                REQUIRE( matchingLines == expectedLines );
+            }
+        }
+
+        WHEN( "Pattern has no required literal" )
+        {
+            RegularExpression expression(
+                RegularExpressionPattern( "error", false, false, false, true ) );
+            klogg::vector<size_t> matchingLines;
+            REQUIRE_FALSE( expression.createMatcher()->matchUtf16Lines( data, endOfLines,
+                                                                        isBigEndian,
+                                                                        matchingLines ) );
+        }
+    }
+}
+
+SCENARIO( "Patterns narrowing other patterns", "[patternmatcher]" )
+{
+    const auto regex = []( const QString& text ) {
+        return RegularExpressionPattern( text, true, false, false, false );
+    };
+    const auto plainText = []( const QString& text ) {
+        return RegularExpressionPattern( text, false, false, false, true );
+    };
+
+    WHEN( "Plain text is extended" )
+    {
+        REQUIRE( plainText( "db ERROR:" ).narrows( plainText( "error" ) ) );
+        REQUIRE_FALSE( plainText( "ERRO" ).narrows( plainText( "ERROR" ) ) );
+        REQUIRE_FALSE( plainText( "ERROR" ).narrows( regex( "ERR" ) ) );
+    }
+
+    WHEN( "Regular expression starting with a word is extended" )
+    {
+        REQUIRE( regex( "ERROR.*db" ).narrows( regex( "ERROR" ) ) );
+        REQUIRE( regex( "ERROR" ).narrows( regex( "ERR" ) ) );
+        REQUIRE_FALSE( regex( "ERROR|db" ).narrows( regex( "ERROR" ) ) );
+        REQUIRE_FALSE( regex( "ERRORS?" ).narrows( regex( "ERRORS" ) ) );
+        REQUIRE_FALSE( regex( "E.R.*db" ).narrows( regex( "E.R" ) ) );
+        REQUIRE_FALSE( regex( "ERROR" ).narrows( regex( "ERROR" ) ) );
+    }
+
+    WHEN( "Options differ" )
+    {
+        const auto ignoreCase = RegularExpressionPattern( "ERROR", false, false, false, false );
+        REQUIRE_FALSE( ignoreCase.narrows( regex( "ERR" ) ) );
+
+        const auto exclude = []( const QString& text ) {
+            return RegularExpressionPattern( text, true, true, false, false );
+        };
+        REQUIRE_FALSE( exclude( "ERROR" ).narrows( exclude( "ERR" ) ) );
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+
+#include "plaintextmatcher.h"
+
+namespace {
+PlainTextMatcher makeMatcher( const QString& text )
+{
+    return PlainTextMatcher( RegularExpressionPattern( text, false, false, false, true ) );
+}
+} // namespace
+
+SCENARIO( "Plain text matcher ignores case", "[plaintextmatcher]" )
+{
+    const std::string_view longLine
+        = "2021-03-04 12:00:01.123 [worker-7] INFO Disk Full on /dev/sda1, retrying";
+
+    THEN( "ASCII text is found in any case" )
+    {
+        const auto matcher = makeMatcher( "disk full" );
+        REQUIRE( matcher.hasMatch( longLine ) );
+        REQUIRE( matcher.hasMatch( "DISK FULL" ) );
+        REQUIRE( !matcher.hasMatch( "disk is full" ) );
+        REQUIRE( !matcher.hasMatch( "disk ful" ) );
+        REQUIRE( matcher.match( "Disk full" ) == std::string_view( "\1", 1 ) );
+    }
+
+    THEN( "Text is found at the edges of long lines" )
+    {
+        REQUIRE( makeMatcher( "2021-03-04" ).hasMatch( longLine ) );
+        REQUIRE( makeMatcher( "RETRYING" ).hasMatch( longLine ) );
+        REQUIRE( !makeMatcher( "retrying!" ).hasMatch( longLine ) );
+        REQUIRE( !makeMatcher( "[Worker-8]" ).hasMatch( longLine ) );
+    }
+
+    THEN( "Punctuation is not folded" )
+    {
+        REQUIRE( !makeMatcher( "@" ).hasMatch( "`" ) );
+        REQUIRE( !makeMatcher( "[" ).hasMatch( "{" ) );
+    }
+
+    THEN( "Characters folding to ASCII letters are found" )
+    {
+        // Kelvin sign
+        REQUIRE( makeMatcher( "5k" ).hasMatch( "5\xe2\x84\xaa" ) );
+        REQUIRE( makeMatcher( "maße" ).hasMatch( "MAßE" ) );
+        REQUIRE( makeMatcher( "файл" ).hasMatch( "ФАЙЛ" ) );
+    }
+
+    THEN( "Empty text matches every line" )
+    {
+        REQUIRE( makeMatcher( "" ).hasMatch( "" ) );
+        REQUIRE( makeMatcher( "" ).hasMatch( longLine ) );
+    }
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "prefetchdepth.h"
+
+#include <thread>
+
+using namespace std::chrono;
+
+namespace {
+// Blocks read in readTime each and indexed every indexTime
+void indexBlocks( PrefetchDepth& depth, size_t count, microseconds readTime,
+                  microseconds indexTime, PrefetchDepth::Clock::time_point& time )
+{
+    for ( size_t block = 0; block < count; ++block ) {
+        depth.blockSent();
+        depth.blockRead( readTime );
+        time += indexTime;
+        depth.blockIndexed( time );
+    }
+}
+} // namespace
+
+SCENARIO( "Blocks read ahead of indexing", "[prefetchdepth]" )
+{
+    auto time = PrefetchDepth::Clock::now();
+
+    GIVEN( "A fixed depth" )
+    {
+        PrefetchDepth depth( 16, 4, false );
+
+        THEN( "It doesn't change" )
+        {
+            indexBlocks( depth, 100, milliseconds{ 100 }, milliseconds{ 1 }, time );
+            REQUIRE( depth.depth() == 16 );
+            REQUIRE( depth.maxDepth() == 16 );
+        }
+
+        THEN( "The reader sends blocks while fewer are in flight" )
+        {
+            for ( int block = 0; block < 16; ++block ) {
+                REQUIRE( depth.canSend() );
+                depth.blockSent();
+            }
+            REQUIRE_FALSE( depth.canSend() );
+
+            depth.blockIndexed( time );
+            REQUIRE( depth.canSend() );
+        }
+
+        THEN( "The reader waits until a block is indexed" )
+        {
+            for ( int block = 0; block < 16; ++block ) {
+                depth.blockSent();
+            }
+
+            AtomicFlag interruptRequest;
+            std::thread indexer( [ &depth, time ] {
+                std::this_thread::sleep_for( milliseconds{ 10 } );
+                depth.blockIndexed( time );
+            } );
+            REQUIRE( depth.waitToSend( interruptRequest ) );
+            indexer.join();
+        }
+
+        THEN( "The reader stops waiting when interrupted" )
+        {
+            for ( int block = 0; block < 16; ++block ) {
+                depth.blockSent();
+            }
+
+            AtomicFlag interruptRequest;
+            std::thread interrupter( [ &interruptRequest ] {
+                std::this_thread::sleep_for( milliseconds{ 10 } );
+                interruptRequest.set();
+            } );
+            REQUIRE_FALSE( depth.waitToSend( interruptRequest ) );
+            interrupter.join();
+        }
+    }
+
+    GIVEN( "An adaptive depth" )
+    {
+        PrefetchDepth depth( 16, 4, true );
+        REQUIRE( depth.depth() == 16 );
+        REQUIRE( depth.maxDepth() == PrefetchDepth::MaxAdaptiveDepth );
+
+        WHEN( "Reads are faster than indexing" )
+        {
+            indexBlocks( depth, 2 * PrefetchDepth::WindowBlocks, microseconds{ 100 },
+                         milliseconds{ 2 }, time );
+
+            THEN( "Only the minimal depth is read ahead" )
+            {
+                REQUIRE( depth.depth() == 4 );
+            }
+        }
+
+        WHEN( "Some reads stall" )
+        {
+            // Times of blocks are measured from the first indexed one
+            indexBlocks( depth, 2 * PrefetchDepth::WindowBlocks, microseconds{ 100 },
+                         milliseconds{ 2 }, time );
+            indexBlocks( depth, 1, milliseconds{ 40 }, milliseconds{ 2 }, time );
+
+            THEN( "Enough blocks are read ahead to index them during the stall" )
+            {
+                REQUIRE( depth.depth() == 21 );
+            }
+        }
+
+        WHEN( "Reads stall for longer than the maximal depth covers" )
+        {
+            indexBlocks( depth, PrefetchDepth::WindowBlocks + 1, seconds{ 1 }, milliseconds{ 1 },
+                         time );
+
+            THEN( "The maximal depth is read ahead" )
+            {
+                REQUIRE( depth.depth() == PrefetchDepth::MaxAdaptiveDepth );
+            }
+        }
+    }
+
+    GIVEN( "A minimal depth larger than the maximal adaptive one" )
+    {
+        PrefetchDepth depth( 16, 100, true );
+
+        THEN( "The minimal depth is used" )
+        {
+            REQUIRE( depth.depth() == 100 );
+            REQUIRE( depth.maxDepth() == 100 );
+        }
+    }
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "linetypes.h"
+
+#include "sparselinepositionarray.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+struct SparseIndex {
+    std::string data;
+    std::vector<OffsetInFile> lineEnds;
+    std::unique_ptr<SparseLinePositionArray> positions;
+    int scans = 0;
+
+    explicit SparseIndex( LinesCount::UnderlyingType step )
+    {
+        std::mt19937 generator( 42 );
+        for ( auto line = 0; line < 1000; ++line ) {
+            data.append( generator() % 300, 'a' );
+            data.push_back( '\n' );
+            lineEnds.emplace_back( static_cast<OffsetInFile::UnderlyingType>( data.size() ) );
+        }
+
+        positions = std::make_unique<SparseLinePositionArray>(
+            [ this ]( OffsetInFile begin, OffsetInFile end ) {
+                ++scans;
+                klogg::vector<OffsetInFile> ends;
+                for ( auto pos = begin.get(); pos < end.get(); ++pos ) {
+                    if ( data[ static_cast<size_t>( pos ) ] == '\n' ) {
+                        ends.emplace_back( pos + 1 );
+                    }
+                }
+                return ends;
+            },
+            step );
+    }
+
+    void append( size_t first, size_t last, bool fakeFinalLF = false )
+    {
+        FastLinePositionArray chunk;
+        for ( auto line = first; line < last; ++line ) {
+            chunk.append( lineEnds[ line ] );
+        }
+        chunk.setFakeFinalLF( fakeFinalLF );
+        positions->append_list( chunk );
+    }
+};
+} // namespace
+
+SCENARIO( "SparseLinePositionArray finds ends of all lines", "[sparselinepositionarray]" )
+{
+    GIVEN( "Sparse array of lines appended in chunks" )
+    {
+        SparseIndex index( 16 );
+        for ( size_t chunk = 0; chunk < index.lineEnds.size(); chunk += 100 ) {
+            index.append( chunk, chunk + 100 );
+        }
+
+        REQUIRE( index.positions->size() == LinesCount( index.lineEnds.size() ) );
+
+        WHEN( "Accessing lines in linear order" )
+        {
+            THEN( "Correct offsets are returned and each group is scanned once" )
+            {
+                for ( size_t line = 0; line < index.lineEnds.size(); ++line ) {
+                    REQUIRE( index.positions->at( LineNumber( line ) ) == index.lineEnds[ line ] );
+                }
+                REQUIRE( index.scans == 62 );
+            }
+        }
+
+        WHEN( "Accessing lines in random order" )
+        {
+            THEN( "Correct offsets are returned" )
+            {
+                std::mt19937 generator( 7 );
+                for ( auto i = 0; i < 5000; ++i ) {
+                    const auto line = generator() % index.lineEnds.size();
+                    REQUIRE( index.positions->at( LineNumber( line ) ) == index.lineEnds[ line ] );
+                }
+            }
+        }
+
+        WHEN( "Truncating and appending lines" )
+        {
+            for ( const auto newSize : { 999u, 640u, 641u, 15u, 0u } ) {
+                index.positions->truncate( LinesCount( newSize ) );
+                REQUIRE( index.positions->size() == LinesCount( newSize ) );
+
+                for ( size_t line = 0; line < newSize; ++line ) {
+                    REQUIRE( index.positions->at( LineNumber( line ) ) == index.lineEnds[ line ] );
+                }
+
+                index.append( newSize, index.lineEnds.size() );
+            }
+
+            THEN( "Correct offsets are returned" )
+            {
+                REQUIRE( index.positions->size() == LinesCount( index.lineEnds.size() ) );
+                for ( size_t line = 0; line < index.lineEnds.size(); ++line ) {
+                    REQUIRE( index.positions->at( LineNumber( line ) ) == index.lineEnds[ line ] );
+                }
+            }
+        }
+    }
+
+    GIVEN( "Sparse array ending with a fake final LF" )
+    {
+        SparseIndex index( 16 );
+        index.append( 0, 32 );
+        index.append( 32, 33, true );
+
+        REQUIRE( index.positions->hasFakeFinalLF() );
+        REQUIRE( index.positions->size() == 33_lcount );
+
+        WHEN( "Adding more lines" )
+        {
+            index.append( 32, 100 );
+
+            THEN( "Fake LF is replaced" )
+            {
+                REQUIRE( !index.positions->hasFakeFinalLF() );
+                REQUIRE( index.positions->size() == 100_lcount );
+                for ( size_t line = 0; line < 100; ++line ) {
+                    REQUIRE( index.positions->at( LineNumber( line ) ) == index.lineEnds[ line ] );
+                }
+            }
+        }
+    }
+}
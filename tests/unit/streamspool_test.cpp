@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "streamspool.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QThread>
+
+namespace {
+QByteArray makeLines( int count )
+{
+    QByteArray data;
+    for ( auto i = 0; i < count; ++i ) {
+        data.append( QStringLiteral( "line %1\n" ).arg( i, 3, 10, QChar( '0' ) ).toLatin1() );
+    }
+    return data;
+}
+
+QByteArray spoolData( const QByteArray& data, qint64 sizeLimit, qint64& droppedBytes )
+{
+    QTemporaryFile input;
+    REQUIRE( input.open() );
+    REQUIRE( input.write( data ) == data.size() );
+    REQUIRE( input.flush() );
+
+    QFile stream( input.fileName() );
+    REQUIRE( stream.open( QIODevice::ReadOnly ) );
+
+    QTemporaryDir spoolDir;
+    StreamSpool spool( stream.handle(), spoolDir.filePath( "spool.log" ), sizeLimit );
+    for ( auto i = 0; i < 500 && !spool.isAtEnd(); ++i ) {
+        QThread::msleep( 10 );
+    }
+    REQUIRE( spool.isAtEnd() );
+    droppedBytes = spool.droppedBytes();
+
+    QFile spoolFile( spool.fileName() );
+    REQUIRE( spoolFile.open( QIODevice::ReadOnly ) );
+    return spoolFile.readAll();
+}
+} // namespace
+
+TEST_CASE( "Kept lines start after the first line feed", "[streamspool]" )
+{
+    REQUIRE( StreamSpool::findKeptStart( "ne 1\nline 2\n" ) == 5 );
+    REQUIRE( StreamSpool::findKeptStart( "\nline 2\n" ) == 1 );
+    REQUIRE( StreamSpool::findKeptStart( "no line feed" ) == 0 );
+    REQUIRE( StreamSpool::findKeptStart( std::string_view( "a\0\n\0b\0", 6 ) ) == 4 );
+    REQUIRE( StreamSpool::findKeptStart( std::string_view( "\0a\0\n\0b", 6 ) ) == 4 );
+}
+
+SCENARIO( "Stream is spooled to a file", "[streamspool]" )
+{
+    const auto data = makeLines( 100 );
+
+    GIVEN( "Spool without a limit" )
+    {
+        qint64 droppedBytes = -1;
+        const auto spooled = spoolData( data, 0, droppedBytes );
+
+        THEN( "All data is in the file" )
+        {
+            REQUIRE( spooled == data );
+            REQUIRE( droppedBytes == 0 );
+        }
+    }
+
+    GIVEN( "Spool limited to a part of the data" )
+    {
+        constexpr qint64 SizeLimit = 256;
+        qint64 droppedBytes = -1;
+        const auto spooled = spoolData( data, SizeLimit, droppedBytes );
+
+        THEN( "Whole lines at the end of the data are kept within the limit" )
+        {
+            REQUIRE( spooled.size() < SizeLimit );
+            REQUIRE( spooled.startsWith( "line " ) );
+            REQUIRE( data.endsWith( spooled ) );
+            REQUIRE( droppedBytes + spooled.size() == data.size() );
+        }
+    }
+}
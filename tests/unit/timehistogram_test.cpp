@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "timehistogram.h"
+
+namespace {
+// 2024-03-01 00:00:00
+constexpr int64_t March2024 = 1709251200;
+} // namespace
+
+TEST_CASE( "Numeric timestamps are parsed in place", "[timehistogram]" )
+{
+    const TimestampParser parser( "yyyy-MM-dd HH:mm:ss.zzz" );
+    REQUIRE( parser.isFast() );
+
+    REQUIRE( parser.parse( "2024-03-01 00:00:00.000 start" ) == March2024 );
+    REQUIRE( parser.parse( "[2024-03-01 10:20:30.456] msg" ) == March2024 + 37230 );
+    REQUIRE( parser.parse( "  1970-01-01 00:00:01.000" ) == 1 );
+    REQUIRE( parser.parse( "1969-12-31 23:59:59.000" ) == -1 );
+    REQUIRE( parser.parse( "2024-02-29 00:00:00.000" ) == March2024 - 86400 );
+
+    REQUIRE( parser.parseMilliseconds( "[2024-03-01 10:20:30.456] msg" )
+             == ( March2024 + 37230 ) * 1000 + 456 );
+    REQUIRE( parser.parseMilliseconds( "1969-12-31 23:59:59.500" ) == -500 );
+    REQUIRE( parser.parse( "1969-12-31 23:59:59.500" ) == -1 );
+
+    REQUIRE_FALSE( parser.parse( "2023-02-29 00:00:00.000" ) );
+    REQUIRE_FALSE( parser.parse( "2024-13-01 00:00:00.000" ) );
+    REQUIRE_FALSE( parser.parse( "2024-03-01 24:00:00.000" ) );
+    REQUIRE_FALSE( parser.parse( "2024-03-01T00:00:00.000" ) );
+    REQUIRE_FALSE( parser.parse( "2024-03-01 00:00" ) );
+    REQUIRE_FALSE( parser.parse( "continuation of a message" ) );
+}
+
+TEST_CASE( "Quoted text of formats is literal", "[timehistogram]" )
+{
+    const TimestampParser parser( "yyyy-MM-dd'T'HH:mm:ss" );
+    REQUIRE( parser.isFast() );
+    REQUIRE( parser.parse( "2024-03-01T00:01:00Z" ) == March2024 + 60 );
+    REQUIRE_FALSE( parser.parse( "2024-03-01 00:01:00" ) );
+
+    REQUIRE( TimestampParser( "HH:mm:ss" ).parse( "00:00:10" )
+             == ( -25567 * int64_t{ 86400 } ) + 10 );
+
+    REQUIRE_FALSE( TimestampParser( "d MMM yyyy" ).isFast() );
+    REQUIRE_FALSE( TimestampParser( "" ).parse( "2024-03-01" ) );
+}
+
+TEST_CASE( "Matching lines are counted by their time", "[timehistogram]" )
+{
+    TimeHistogram histogram;
+    histogram.add( March2024 + 5, 10_lnum );
+    histogram.add( March2024 + 5, 3_lnum );
+    histogram.add( March2024 + 7, 12_lnum );
+
+    REQUIRE( histogram.bucketSeconds() == 1 );
+    auto buckets = histogram.buckets();
+    REQUIRE( buckets.size() == 2 );
+    REQUIRE( buckets[ 0 ].start == March2024 + 5 );
+    REQUIRE( buckets[ 0 ].count == 2 );
+    REQUIRE( buckets[ 0 ].firstLine == 3_lnum );
+    REQUIRE( buckets[ 1 ].count == 1 );
+
+    SECTION( "Buckets get wider when there are too many of them" )
+    {
+        for ( int64_t minute = 0; minute < 3000; ++minute ) {
+            histogram.add( March2024 + minute * 60, LineNumber( 100 + minute ) );
+        }
+
+        REQUIRE( histogram.buckets().size() <= TimeHistogram::MaxBuckets );
+        REQUIRE( histogram.bucketSeconds() == 300 );
+
+        buckets = histogram.buckets();
+        REQUIRE( buckets.front().start == March2024 );
+        REQUIRE( buckets.front().count == 3 + 5 );
+        REQUIRE( buckets.front().firstLine == 3_lnum );
+
+        uint64_t total = 0;
+        for ( const auto& bucket : buckets ) {
+            REQUIRE( bucket.start % 300 == 0 );
+            total += bucket.count;
+        }
+        REQUIRE( total == 3003 );
+    }
+
+    SECTION( "Histograms of chunks are merged" )
+    {
+        TimeHistogram other;
+        other.add( March2024 + 5, 1_lnum );
+        other.add( March2024 + 3600, 50_lnum );
+        for ( int64_t second = 0; second < 4000; ++second ) {
+            other.add( March2024 + 7200 + second, LineNumber( 100 + second ) );
+        }
+        REQUIRE( other.bucketSeconds() == 5 );
+
+        histogram.merge( other );
+        REQUIRE( histogram.bucketSeconds() == 5 );
+
+        buckets = histogram.buckets();
+        REQUIRE( buckets.front().start == March2024 + 5 );
+        REQUIRE( buckets.front().count == 4 );
+        REQUIRE( buckets.front().firstLine == 1_lnum );
+        REQUIRE( buckets[ 1 ].start == March2024 + 3600 );
+    }
+
+    SECTION( "Buckets of dropped lines are dropped" )
+    {
+        histogram.truncate( 11_lcount );
+        buckets = histogram.buckets();
+        REQUIRE( buckets.size() == 1 );
+        REQUIRE( buckets.front().count == 2 );
+        REQUIRE( buckets.front().isKnown );
+
+        histogram.clear();
+        REQUIRE( histogram.isEmpty() );
+    }
+
+    SECTION( "Buckets of kept and dropped lines are not known" )
+    {
+        histogram.truncate( 5_lcount );
+        buckets = histogram.buckets();
+        REQUIRE( buckets.size() == 1 );
+        REQUIRE( !buckets.front().isKnown );
+
+        // Dropped lines searched again don't make it known
+        histogram.add( March2024 + 5, 10_lnum );
+        buckets = histogram.buckets();
+        REQUIRE( buckets.size() == 1 );
+        REQUIRE( !buckets.front().isKnown );
+        REQUIRE( buckets.front().firstLine == 3_lnum );
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+
+#include "timestampindex.h"
+
+#include <QDateTime>
+
+namespace {
+const QString Format = "yyyy-MM-dd HH:mm:ss";
+const auto FirstTime = QDateTime::fromString( "2021-03-01 10:00:00", Format );
+
+// Every tenth line continues the previous one
+QString lineAt( uint64_t line )
+{
+    if ( line % 10 == 9 ) {
+        return "    at continuation";
+    }
+    return FirstTime.addSecs( static_cast<qint64>( line ) ).toString( Format ) + " message";
+}
+
+qint64 timeAt( uint64_t line )
+{
+    return FirstTime.addSecs( static_cast<qint64>( line ) ).toMSecsSinceEpoch();
+}
+} // namespace
+
+SCENARIO( "TimestampIndex parses timestamps at the beginning of lines", "[timestampindex]" )
+{
+    TimestampIndex index( Format );
+
+    REQUIRE( index.parse( "2021-03-01 10:00:00 message" ) == FirstTime.toMSecsSinceEpoch() );
+    REQUIRE( index.parse( "[2021-03-01 10:00:00] message" ) == FirstTime.toMSecsSinceEpoch() );
+    REQUIRE( !index.parse( "message 2021-03-01 10:00:00" ) );
+    REQUIRE( !TimestampIndex{}.parse( "2021-03-01 10:00:00 message" ) );
+}
+
+SCENARIO( "TimestampIndex finds lines by time", "[timestampindex]" )
+{
+    GIVEN( "Lines with increasing timestamps" )
+    {
+        const auto nbLines = LinesCount( 100000 );
+
+        uint64_t readLinesCount = 0;
+        const auto readLines = [ &readLinesCount ]( LineNumber first, LinesCount number ) {
+            klogg::vector<QString> lines;
+            for ( auto line = first.get(); line < first.get() + number.get(); ++line ) {
+                lines.push_back( lineAt( line ) );
+            }
+            readLinesCount += number.get();
+            return lines;
+        };
+
+        TimestampIndex index( Format );
+
+        THEN( "First line at or after the time is found" )
+        {
+            REQUIRE( index.lineAtTime( timeAt( 50000 ), nbLines, readLines ) == 50000_lnum );
+            REQUIRE( index.lineAtTime( timeAt( 9 ), nbLines, readLines ) == 10_lnum );
+            REQUIRE( index.lineAtTime( timeAt( 12345 ) - 500, nbLines, readLines )
+                     == 12345_lnum );
+        }
+
+        THEN( "Times out of the lines are found at the edges" )
+        {
+            REQUIRE( index.lineAtTime( timeAt( 0 ) - 1000, nbLines, readLines ) == 0_lnum );
+            REQUIRE( index.lineAtTime( timeAt( nbLines.get() ), nbLines, readLines )
+                     == LineNumber( nbLines.get() ) );
+        }
+
+        THEN( "Only a few lines are read" )
+        {
+            index.lineAtTime( timeAt( 70001 ), nbLines, readLines );
+            REQUIRE( readLinesCount < 1000 );
+        }
+
+        WHEN( "Lines are truncated" )
+        {
+            index.lineAtTime( timeAt( 70001 ), nbLines, readLines );
+            index.truncate( 1000_lcount );
+
+            THEN( "Times of kept lines are found" )
+            {
+                REQUIRE( index.lineAtTime( timeAt( 501 ), 1000_lcount, readLines ) == 501_lnum );
+                REQUIRE( index.lineAtTime( timeAt( 70001 ), 1000_lcount, readLines )
+                         == 1000_lnum );
+            }
+        }
+    }
+}
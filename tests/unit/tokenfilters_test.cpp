@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "tokenfilters.h"
+
+#include <string>
+
+#include <QBuffer>
+#include <QDataStream>
+
+namespace {
+const std::string FirstBlock = "request 7f3a9c started\nrequest 7f3a9c fini";
+const std::string SecondBlock = "shed\nrequest 11bd02 started\n";
+
+qint64 size( const std::string& block )
+{
+    return static_cast<qint64>( block.size() );
+}
+
+klogg::vector<std::string> tokens( std::initializer_list<std::string> list )
+{
+    return klogg::vector<std::string>( list );
+}
+} // namespace
+
+SCENARIO( "TokenFilters finds whole tokens of text", "[tokenfilters]" )
+{
+    THEN( "Tokens at edges of the text are whole only at boundaries" )
+    {
+        REQUIRE( TokenFilters::wholeTokens( "id=7f3a ok", false, false )
+                 == tokens( { "7f3a" } ) );
+        REQUIRE( TokenFilters::wholeTokens( "id=7f3a ok", true, true )
+                 == tokens( { "7f3a", "id", "ok" } ) );
+        REQUIRE( TokenFilters::wholeTokens( "7f3a", false, false ).empty() );
+        REQUIRE( TokenFilters::wholeTokens( " 7f3a ", false, false ) == tokens( { "7f3a" } ) );
+    }
+}
+
+SCENARIO( "TokenFilters finds blocks that may contain tokens", "[tokenfilters]" )
+{
+    GIVEN( "Filters of two blocks" )
+    {
+        TokenFilters filters;
+        filters.addBlock( 0, FirstBlock );
+        filters.addBlock( size( FirstBlock ), SecondBlock );
+
+        const auto secondStart = size( FirstBlock );
+        const auto end = secondStart + size( SecondBlock );
+
+        THEN( "Blocks without a token are skipped" )
+        {
+            REQUIRE( filters.endOffset() == end );
+            REQUIRE( filters.mayContain( 0, end, tokens( { "7f3a9c" } ) ) );
+            REQUIRE( filters.mayContain( secondStart, end, tokens( { "11bd02" } ) ) );
+            REQUIRE( !filters.mayContain( 0, secondStart, tokens( { "11bd02" } ) ) );
+            REQUIRE( !filters.mayContain( 0, end, tokens( { "deadbeef" } ) ) );
+        }
+
+        THEN( "Token spanning blocks belongs to the later block" )
+        {
+            REQUIRE( filters.mayContain( secondStart, end, tokens( { "finished" } ) ) );
+        }
+
+        THEN( "Tokens of a line spanning blocks are found in both blocks" )
+        {
+            REQUIRE( filters.mayContain( 0, end, tokens( { "7f3a9c", "finished" } ) ) );
+            REQUIRE( !filters.mayContain( 0, end, tokens( { "7f3a9c", "deadbeef" } ) ) );
+        }
+
+        THEN( "Empty tokens and data out of the filters may contain anything" )
+        {
+            REQUIRE( filters.mayContain( 0, secondStart, {} ) );
+            REQUIRE( filters.mayContain( secondStart, end + 1, tokens( { "deadbeef" } ) ) );
+        }
+
+        WHEN( "Filters are written and read back" )
+        {
+            QBuffer buffer;
+            buffer.open( QIODevice::ReadWrite );
+            QDataStream stream( &buffer );
+            filters.write( stream );
+
+            buffer.seek( 0 );
+            TokenFilters restoredFilters;
+            REQUIRE( restoredFilters.read( stream ) );
+
+            THEN( "They find the same blocks" )
+            {
+                REQUIRE( restoredFilters.endOffset() == end );
+                REQUIRE( restoredFilters.mayContain( secondStart, end, tokens( { "11bd02" } ) ) );
+                REQUIRE( !restoredFilters.mayContain( 0, secondStart, tokens( { "11bd02" } ) ) );
+            }
+        }
+    }
+
+    GIVEN( "Filters of the beginning of data and filters of the rest" )
+    {
+        TokenFilters prefix;
+        prefix.addBlock( 0, FirstBlock + SecondBlock );
+
+        const auto tailStart = size( FirstBlock ) + size( SecondBlock );
+        const std::string tailBlock = "request c0ffee started\n";
+        TokenFilters tail( tailStart );
+        tail.addBlock( tailStart, tailBlock );
+
+        WHEN( "The rest is appended" )
+        {
+            prefix.append( tail );
+
+            THEN( "Blocks of both are found" )
+            {
+                REQUIRE( prefix.endOffset() == tailStart + size( tailBlock ) );
+                REQUIRE( !prefix.mayContain( 0, tailStart, tokens( { "c0ffee" } ) ) );
+                REQUIRE( prefix.mayContain( tailStart, prefix.endOffset(),
+                                            tokens( { "c0ffee" } ) ) );
+            }
+        }
+    }
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "tracing.h"
+
+#include <thread>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+// Complete events of the trace with the name
+klogg::vector<QJsonObject> spans( const char* name )
+{
+    QJsonParseError error;
+    const auto trace = QJsonDocument::fromJson( Tracing::get().chromeTrace(), &error );
+    REQUIRE( error.error == QJsonParseError::NoError );
+
+    klogg::vector<QJsonObject> events;
+    for ( const auto& event : trace.object()[ "traceEvents" ].toArray() ) {
+        const auto object = event.toObject();
+        if ( object[ "ph" ].toString() == "X" && object[ "name" ].toString() == name ) {
+            events.push_back( object );
+        }
+    }
+    return events;
+}
+} // namespace
+
+SCENARIO( "Trace spans are recorded when tracing is enabled", "[tracing]" )
+{
+    auto& tracing = Tracing::get();
+    tracing.clear();
+
+    GIVEN( "Tracing is disabled" )
+    {
+        tracing.setEnabled( false );
+        {
+            const TraceSpan span( "disabled span", "test" );
+        }
+        REQUIRE( spans( "disabled span" ).empty() );
+    }
+
+    GIVEN( "Tracing is enabled" )
+    {
+        tracing.setEnabled( true );
+
+        WHEN( "Spans are recorded by two threads" )
+        {
+            {
+                const TraceSpan span( "test span", "test", "offset", 42 );
+            }
+            std::thread thread( [] { const TraceSpan span( "test span", "test", "offset", 43 ); } );
+            thread.join();
+
+            THEN( "Both are dumped with their threads and arguments" )
+            {
+                const auto events = spans( "test span" );
+                REQUIRE( events.size() == 2 );
+                REQUIRE( events[ 0 ][ "cat" ].toString() == "test" );
+                REQUIRE( events[ 0 ][ "dur" ].toDouble() >= 0 );
+                REQUIRE( events[ 0 ][ "tid" ].toInt() != events[ 1 ][ "tid" ].toInt() );
+
+                const auto offsets = events[ 0 ][ "args" ].toObject()[ "offset" ].toInt()
+                                     + events[ 1 ][ "args" ].toObject()[ "offset" ].toInt();
+                REQUIRE( offsets == 42 + 43 );
+            }
+        }
+
+        WHEN( "More spans than the buffer holds are recorded" )
+        {
+            for ( size_t span = 0; span < Tracing::EventsPerThread + 10; ++span ) {
+                const TraceSpan traceSpan( "ring span", "test" );
+            }
+
+            THEN( "Only the latest ones are kept" )
+            {
+                REQUIRE( spans( "ring span" ).size() == Tracing::EventsPerThread );
+            }
+        }
+
+        tracing.setEnabled( false );
+        tracing.clear();
+    }
+}
+
+SCENARIO( "Open spans of a thread are read by other threads", "[tracing]" )
+{
+    OpenSpans::setTracked( true );
+    const auto& spans = OpenSpans::current();
+
+    {
+        const TraceSpan outer( "outer span", "test" );
+        const TraceSpan inner( "inner span", "test" );
+
+        klogg::vector<const char*> names;
+        std::thread thread( [ &spans, &names ] { names = spans.names(); } );
+        thread.join();
+
+        REQUIRE( names.size() == 2 );
+        REQUIRE( QByteArray( names[ 0 ] ) == "outer span" );
+        REQUIRE( QByteArray( names[ 1 ] ) == "inner span" );
+    }
+    REQUIRE( spans.names().empty() );
+
+    OpenSpans::setTracked( false );
+    {
+        const TraceSpan untracked( "untracked span", "test" );
+        REQUIRE( spans.names().empty() );
+    }
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "trigramindex.h"
+
+#include <string>
+
+#include <QBuffer>
+#include <QDataStream>
+
+namespace {
+const std::string FirstBlock = "first row\nsecond li";
+const std::string SecondBlock = "ne\nanother line\n";
+const std::string ThirdBlock = "warning: disk full\n";
+
+qint64 size( const std::string& block )
+{
+    return static_cast<qint64>( block.size() );
+}
+} // namespace
+
+SCENARIO( "TrigramIndex finds blocks that may contain text", "[trigramindex]" )
+{
+    GIVEN( "Index of three blocks" )
+    {
+        TrigramIndex index;
+        index.addBlock( 0, FirstBlock );
+        index.addBlock( size( FirstBlock ), SecondBlock );
+        index.addBlock( size( FirstBlock ) + size( SecondBlock ), ThirdBlock );
+        index.optimize();
+
+        const auto secondStart = size( FirstBlock );
+        const auto thirdStart = secondStart + size( SecondBlock );
+        const auto end = thirdStart + size( ThirdBlock );
+
+        THEN( "Text is found only in blocks that have all its trigrams" )
+        {
+            REQUIRE( index.endOffset() == end );
+            REQUIRE( index.mayContain( 0, end, "disk" ) );
+            REQUIRE( index.mayContain( thirdStart, end, "disk" ) );
+            REQUIRE( !index.mayContain( 0, thirdStart, "disk" ) );
+            REQUIRE( !index.mayContain( 0, end, "error" ) );
+        }
+
+        THEN( "Trigrams spanning blocks belong to the later block" )
+        {
+            REQUIRE( index.mayContain( 0, thirdStart, "second line" ) );
+            REQUIRE( index.mayContain( secondStart, thirdStart, "line" ) );
+            REQUIRE( !index.mayContain( 0, secondStart, "d line" ) );
+        }
+
+        THEN( "Short text and data out of the index may contain anything" )
+        {
+            REQUIRE( index.mayContain( 0, thirdStart, "di" ) );
+            REQUIRE( index.mayContain( thirdStart, end + 1, "error" ) );
+        }
+
+        WHEN( "Index is written and read back" )
+        {
+            QBuffer buffer;
+            buffer.open( QIODevice::ReadWrite );
+            QDataStream stream( &buffer );
+            index.write( stream );
+
+            buffer.seek( 0 );
+            TrigramIndex restoredIndex;
+            REQUIRE( restoredIndex.read( stream ) );
+
+            THEN( "It finds the same blocks" )
+            {
+                REQUIRE( restoredIndex.endOffset() == end );
+                REQUIRE( restoredIndex.mayContain( thirdStart, end, "disk" ) );
+                REQUIRE( !restoredIndex.mayContain( 0, thirdStart, "disk" ) );
+            }
+        }
+    }
+
+    GIVEN( "Index of the beginning of data and index of the rest" )
+    {
+        TrigramIndex prefix;
+        prefix.addBlock( 0, FirstBlock + SecondBlock );
+
+        const auto tailStart = size( FirstBlock ) + size( SecondBlock );
+        TrigramIndex tail( tailStart );
+        tail.addBlock( tailStart, ThirdBlock );
+
+        WHEN( "The rest is appended" )
+        {
+            prefix.append( tail );
+
+            THEN( "Blocks of both are found" )
+            {
+                REQUIRE( prefix.endOffset() == tailStart + size( ThirdBlock ) );
+                REQUIRE( prefix.mayContain( 0, tailStart, "another" ) );
+                REQUIRE( !prefix.mayContain( 0, tailStart, "disk" ) );
+                REQUIRE( prefix.mayContain( tailStart, prefix.endOffset(), "disk" ) );
+            }
+        }
+    }
+
+    GIVEN( "Index with a missing block" )
+    {
+        TrigramIndex index;
+        index.addBlock( 0, FirstBlock );
+        index.addBlock( size( FirstBlock ) + 1, SecondBlock );
+
+        THEN( "It is not used" )
+        {
+            REQUIRE( index.mayContain( 0, size( FirstBlock ), "error" ) );
+        }
+    }
+}
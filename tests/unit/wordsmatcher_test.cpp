@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <tuple>
+
+#include "wordsmatcher.h"
+
+namespace {
+using Spans = std::vector<std::tuple<int, int, int>>;
+
+Spans findWords( const WordsMatcher& matcher, const QString& line )
+{
+    klogg::vector<WordsMatcher::Match> matches;
+    matcher.match( line, matches );
+
+    Spans spans;
+    for ( const auto& match : matches ) {
+        spans.emplace_back( match.word, match.start, match.length );
+    }
+    return spans;
+}
+} // namespace
+
+SCENARIO( "Words matcher finds all words in one pass", "[wordsmatcher]" )
+{
+    GIVEN( "words sharing prefixes and suffixes" )
+    {
+        const WordsMatcher matcher( QStringList{ "he", "she", "his", "hers" } );
+
+        THEN( "Words inside other words are found" )
+        {
+            REQUIRE( findWords( matcher, "ushers" )
+                     == Spans{ { 0, 2, 2 }, { 1, 1, 3 }, { 3, 2, 4 } } );
+        }
+
+        THEN( "Matches are sorted by word then by start" )
+        {
+            REQUIRE( findWords( matcher, "his she he" )
+                     == Spans{ { 0, 5, 2 }, { 0, 8, 2 }, { 1, 4, 3 }, { 2, 0, 3 } } );
+        }
+
+        THEN( "Words are case sensitive" )
+        {
+            REQUIRE( findWords( matcher, "HE SHE" ).empty() );
+        }
+    }
+
+    GIVEN( "a word overlapping itself" )
+    {
+        const WordsMatcher matcher( QStringList{ "aa" } );
+
+        THEN( "Occurrences don't overlap, as with a regular expression" )
+        {
+            REQUIRE( findWords( matcher, "aaaaa" ) == Spans{ { 0, 0, 2 }, { 0, 2, 2 } } );
+        }
+    }
+
+    GIVEN( "empty and repeated words" )
+    {
+        const WordsMatcher matcher( QStringList{ "", "ok", "ok" } );
+
+        THEN( "Empty words are not found, repeated ones are found for each" )
+        {
+            REQUIRE( !matcher.isEmpty() );
+            REQUIRE( findWords( matcher, "ok" ) == Spans{ { 1, 0, 2 }, { 2, 0, 2 } } );
+        }
+
+        THEN( "Only empty words make an empty matcher" )
+        {
+            REQUIRE( WordsMatcher( QStringList{ "" } ).isEmpty() );
+            REQUIRE( findWords( WordsMatcher( QStringList{ "" } ), "text" ).empty() );
+        }
+    }
+
+    GIVEN( "words out of the ASCII range" )
+    {
+        const WordsMatcher matcher( QStringList{ "данные", "日志" } );
+
+        THEN( "They are found by their UTF-16 code units" )
+        {
+            REQUIRE( findWords( matcher, "ошибка: данные 日志" )
+                     == Spans{ { 0, 8, 6 }, { 1, 15, 2 } } );
+        }
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "wrappedrowsindex.h"
+
+SCENARIO( "WrappedRowsIndex converts rows and lines", "[wrappedrowsindex]" )
+{
+    GIVEN( "Index of lines that were not measured" )
+    {
+        WrappedRowsIndex index;
+        index.reset( 2500_lcount );
+
+        THEN( "Each line takes one row" )
+        {
+            REQUIRE( index.nbRows() == 2500 );
+            REQUIRE( index.rowsBefore( 1500_lnum ) == 1500 );
+            REQUIRE( index.lineAtRow( 2499 ) == 2499_lnum );
+            REQUIRE( index.lineAtRow( 5000 ) == 2499_lnum );
+        }
+
+        WHEN( "Lines of the second block take two rows" )
+        {
+            index.setBlockRows( 1, klogg::vector<uint64_t>( WrappedRowsIndex::BlockLines, 2 ) );
+
+            THEN( "Rows of the block are counted" )
+            {
+                REQUIRE( index.isMeasured( 1 ) );
+                REQUIRE( index.nbRows() == 1024 + 2048 + 452 );
+                REQUIRE( index.rowsBefore( 1030_lnum ) == 1036 );
+                REQUIRE( index.lineAtRow( 1037 ) == 1030_lnum );
+                REQUIRE( index.lineAtRow( 1024 + 2048 ) == 2048_lnum );
+            }
+
+            THEN( "Adding lines keeps measured blocks" )
+            {
+                index.resize( 3000_lcount );
+                REQUIRE( index.isMeasured( 1 ) );
+                REQUIRE( index.nbRows() == 1024 + 2048 + 952 );
+            }
+
+            THEN( "Dropping lines of a block drops its rows" )
+            {
+                index.resize( 1500_lcount );
+                REQUIRE( !index.isMeasured( 1 ) );
+                REQUIRE( index.nbRows() == 1500 );
+            }
+        }
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "fileholder.h"
+#include "zstdaccess.h"
+
+#include <QTemporaryFile>
+#include <QtEndian>
+
+#include <memory>
+
+#include <zstd.h>
+
+namespace {
+QByteArray littleEndian( quint32 value )
+{
+    QByteArray bytes( 4, '\0' );
+    qToLittleEndian( value, bytes.data() );
+    return bytes;
+}
+
+// Independent frames of frameSize bytes followed by the seek table
+QByteArray seekableZstd( const QByteArray& data, int frameSize )
+{
+    QByteArray compressed;
+    QByteArray entries;
+    quint32 framesCount = 0;
+    for ( auto offset = 0; offset < data.size(); offset += frameSize ) {
+        const auto frame = data.mid( offset, frameSize );
+        QByteArray compressedFrame( static_cast<int>( ZSTD_compressBound( frame.size() ) ), '\0' );
+        const auto compressedSize = ZSTD_compress( compressedFrame.data(), compressedFrame.size(),
+                                                   frame.data(), frame.size(), 3 );
+        REQUIRE( !ZSTD_isError( compressedSize ) );
+        compressedFrame.resize( static_cast<int>( compressedSize ) );
+
+        compressed.append( compressedFrame );
+        entries.append( littleEndian( static_cast<quint32>( compressedSize ) ) );
+        entries.append( littleEndian( static_cast<quint32>( frame.size() ) ) );
+        ++framesCount;
+    }
+
+    const auto footer = littleEndian( framesCount ) + QByteArray( 1, '\0' )
+                        + littleEndian( ZstdAccess::SeekableMagic );
+    return compressed + littleEndian( 0x184D2A5E )
+           + littleEndian( static_cast<quint32>( entries.size() + footer.size() ) ) + entries
+           + footer;
+}
+
+QByteArray makeLines( int count )
+{
+    QByteArray lines;
+    for ( auto line = 0; line < count; ++line ) {
+        lines.append( QByteArray( "line " ) + QByteArray::number( line ) + "\n" );
+    }
+    return lines;
+}
+} // namespace
+
+SCENARIO( "Seekable zstd file is read at random offsets", "[zstdaccess]" )
+{
+    const auto data = makeLines( 100000 );
+
+    QTemporaryFile file;
+    REQUIRE( file.open() );
+    file.write( seekableZstd( data, 64 * 1024 ) );
+    REQUIRE( file.flush() );
+
+    auto compressedAccess = CompressedAccess::create( file.fileName() );
+    REQUIRE( std::dynamic_pointer_cast<ZstdAccess>( compressedAccess ) );
+
+    auto chain = std::make_shared<FileChain>();
+    chain->setCompressedAccess( std::move( compressedAccess ) );
+
+    GIVEN( "Zstd file opened with its access" )
+    {
+        ChainedFile chainedFile( file.fileName(), chain );
+        REQUIRE( chainedFile.open( QIODevice::ReadOnly ) );
+
+        THEN( "Frames are decompressed in order" )
+        {
+            REQUIRE( chainedFile.size() == data.size() );
+            REQUIRE( chainedFile.readAll() == data );
+        }
+
+        THEN( "Data is read across frames at any offset" )
+        {
+            const auto end = static_cast<int>( data.size() );
+            for ( const int offset : { 300000, 65530, end - 10, 10 } ) {
+                REQUIRE( chainedFile.seek( offset ) );
+                REQUIRE( chainedFile.read( 100 ) == data.mid( offset, 100 ) );
+            }
+        }
+    }
+}
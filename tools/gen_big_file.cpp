@@ -1,13 +1,94 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
-#include <limits>
+#include <string>
 
-int main()
+#include "loggenerator.h"
+
+namespace {
+void printUsage()
+{
+    std::cerr << "Usage: gen_big_file [options] [output]\n"
+                 "  --lines N          number of lines (1000000)\n"
+                 "  --first-line N     number of the first line, to append to a dataset (0)\n"
+                 "  --length DIST      fixed, uniform or lognormal message length (lognormal)\n"
+                 "  --mean-length N    mean message length (100)\n"
+                 "  --max-length N     maximal message length (4096)\n"
+                 "  --encoding ENC     utf8, utf16le or latin1 (utf8)\n"
+                 "  --tabs P           probability of a tab between words (0)\n"
+                 "  --ansi P           probability of ANSI colors in a line (0)\n"
+                 "  --seed N           seed of the dataset (42)\n"
+                 "Lines are written to stdout if no output is passed.\n";
+}
+} // namespace
+
+int main( int argc, char* argv[] )
 {
-    std::cout << std::numeric_limits<unsigned int>::max() << std::endl;
-    for (auto line = 0ull; line < std::numeric_limits<unsigned int>::max(); ++line)
-    {
-        std::cout << (line % 10) << "\n";
+    LogGeneratorOptions options;
+    std::string output;
+
+    for ( auto i = 1; i < argc; ++i ) {
+        const std::string argument = argv[ i ];
+        const auto hasValue = i + 1 < argc;
+        const char* value = hasValue ? argv[ i + 1 ] : "";
+
+        if ( argument == "--help" || argument == "-h" ) {
+            printUsage();
+            return EXIT_SUCCESS;
+        }
+        else if ( argument.rfind( "--", 0 ) != 0 ) {
+            output = argument;
+            continue;
+        }
+        else if ( !hasValue ) {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+
+        if ( argument == "--lines" ) {
+            options.lines = std::strtoull( value, nullptr, 10 );
+        }
+        else if ( argument == "--first-line" ) {
+            options.firstLine = std::strtoull( value, nullptr, 10 );
+        }
+        else if ( argument == "--length" && LogGeneratorOptions::parseLength( value ) ) {
+            options.length = *LogGeneratorOptions::parseLength( value );
+        }
+        else if ( argument == "--mean-length" ) {
+            options.meanLength = std::strtoull( value, nullptr, 10 );
+        }
+        else if ( argument == "--max-length" ) {
+            options.maxLength = std::strtoull( value, nullptr, 10 );
+        }
+        else if ( argument == "--encoding" && LogGeneratorOptions::parseEncoding( value ) ) {
+            options.encoding = *LogGeneratorOptions::parseEncoding( value );
+        }
+        else if ( argument == "--tabs" ) {
+            options.tabDensity = std::strtod( value, nullptr );
+        }
+        else if ( argument == "--ansi" ) {
+            options.ansiDensity = std::strtod( value, nullptr );
+        }
+        else if ( argument == "--seed" ) {
+            options.seed = std::strtoull( value, nullptr, 10 );
+        }
+        else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+        ++i;
+    }
+
+    LogGenerator generator( options );
+    if ( output.empty() ) {
+        std::ios::sync_with_stdio( false );
+        generator.write( std::cout );
+    }
+    else {
+        std::ofstream file( output, std::ios::binary | std::ios::app );
+        generator.write( file );
     }
 
-    return 0;
-}
\ No newline at end of file
+    return EXIT_SUCCESS;
+}
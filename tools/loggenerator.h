@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LOGGENERATOR_H
+#define KLOGG_LOGGENERATOR_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Synthetic log lines for benchmarks. The same options and seed give the same
+// bytes on every platform, so the random numbers don't use std distributions.
+struct LogGeneratorOptions {
+    enum class Length { Fixed, Uniform, LogNormal };
+    enum class Encoding { Utf8, Utf16le, Latin1 };
+
+    uint64_t lines = 1000000;
+    // Line number of the first line, to append to an existing dataset
+    uint64_t firstLine = 0;
+
+    Length length = Length::LogNormal;
+    // Mean length of the message after the line header
+    size_t meanLength = 100;
+    size_t maxLength = 4096;
+
+    Encoding encoding = Encoding::Utf8;
+
+    // Probability for a word to be followed by a tab instead of a space
+    double tabDensity = 0;
+    // Probability for a line to have ANSI color sequences
+    double ansiDensity = 0;
+
+    uint64_t seed = 42;
+
+    static std::optional<Length> parseLength( std::string_view name )
+    {
+        if ( name == "fixed" ) {
+            return Length::Fixed;
+        }
+        if ( name == "uniform" ) {
+            return Length::Uniform;
+        }
+        if ( name == "lognormal" ) {
+            return Length::LogNormal;
+        }
+        return {};
+    }
+
+    static std::optional<Encoding> parseEncoding( std::string_view name )
+    {
+        if ( name == "utf8" ) {
+            return Encoding::Utf8;
+        }
+        if ( name == "utf16le" ) {
+            return Encoding::Utf16le;
+        }
+        if ( name == "latin1" ) {
+            return Encoding::Latin1;
+        }
+        return {};
+    }
+};
+
+// splitmix64, also used by benchmarks to pick the same lines on every run
+class LogRandom {
+  public:
+    explicit LogRandom( uint64_t seed )
+        : state_( seed )
+    {
+    }
+
+    uint64_t next()
+    {
+        auto z = ( state_ += 0x9E3779B97F4A7C15ull );
+        z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+        z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+        return z ^ ( z >> 31 );
+    }
+
+    uint64_t below( uint64_t bound )
+    {
+        return bound != 0 ? next() % bound : 0;
+    }
+
+    double unit()
+    {
+        return static_cast<double>( next() >> 11 ) * ( 1.0 / 9007199254740992.0 );
+    }
+
+  private:
+    uint64_t state_;
+};
+
+class LogGenerator {
+  public:
+    explicit LogGenerator( const LogGeneratorOptions& options )
+        : options_( options )
+        , random_( options.seed ^ ( options.firstLine * 0x9E3779B97F4A7C15ull ) )
+    {
+    }
+
+    // Writes the lines, with the byte order mark of UTF-16 if the dataset starts there
+    void write( std::ostream& output )
+    {
+        if ( options_.encoding == LogGeneratorOptions::Encoding::Utf16le
+             && options_.firstLine == 0 ) {
+            output.write( "\xFF\xFE", 2 );
+        }
+
+        std::string line;
+        std::string encoded;
+        for ( auto number = options_.firstLine; number < options_.firstLine + options_.lines;
+              ++number ) {
+            makeLine( number, line );
+            encode( line, encoded );
+            output.write( encoded.data(), static_cast<std::streamsize>( encoded.size() ) );
+        }
+    }
+
+    // Word used by benchmark searches, about one word in a hundred
+    static constexpr std::string_view RareWord = "timeout";
+
+  private:
+    uint64_t next()
+    {
+        return random_.next();
+    }
+
+    uint64_t nextBelow( uint64_t bound )
+    {
+        return random_.below( bound );
+    }
+
+    double nextUnit()
+    {
+        return random_.unit();
+    }
+
+    bool nextChance( double probability )
+    {
+        return probability > 0 && nextUnit() < probability;
+    }
+
+    size_t messageLength()
+    {
+        const auto mean = static_cast<double>( options_.meanLength );
+        double length = mean;
+        switch ( options_.length ) {
+        case LogGeneratorOptions::Length::Fixed:
+            break;
+        case LogGeneratorOptions::Length::Uniform:
+            length = nextUnit() * 2 * mean;
+            break;
+        case LogGeneratorOptions::Length::LogNormal: {
+            // Box-Muller, sigma 1 gives a long tail of big lines
+            constexpr auto Sigma = 1.0;
+            constexpr auto Pi = 3.14159265358979323846;
+            const auto u1 = std::max( nextUnit(), 1e-12 );
+            const auto u2 = nextUnit();
+            const auto normal = std::sqrt( -2 * std::log( u1 ) ) * std::cos( 2 * Pi * u2 );
+            length = std::exp( std::log( std::max( mean, 1.0 ) ) - Sigma * Sigma / 2
+                               + Sigma * normal );
+            break;
+        }
+        }
+        return std::min( static_cast<size_t>( length ), options_.maxLength );
+    }
+
+    void makeLine( uint64_t number, std::string& line )
+    {
+        static constexpr std::array<std::string_view, 5> Levels
+            = { "DEBUG", "INFO", "INFO", "WARN", "ERROR" };
+        static constexpr std::array<std::string_view, 5> Colors
+            = { "\x1b[32m", "\x1b[34m", "\x1b[1;33m", "\x1b[31m", "\x1b[36m" };
+        static constexpr std::array<std::string_view, 24> Words
+            = { "request", "connection", "user",    "session", "cache",   "started",
+                "stopped", "received",   "sent",    "bytes",   "failed",  "retry",
+                "queue",   "worker",     "handler", "message", "payload", "state",
+                "café",    "naïve",      "данные",  "日志",    "Straße",  "ok" };
+
+        const auto seconds = number / 100;
+        char header[ 64 ];
+        const auto headerSize
+            = std::snprintf( header, sizeof( header ), "2021-03-%02u %02u:%02u:%02u.%03u ",
+                             static_cast<unsigned>( 1 + seconds / 86400 % 28 ),
+                             static_cast<unsigned>( seconds / 3600 % 24 ),
+                             static_cast<unsigned>( seconds / 60 % 60 ),
+                             static_cast<unsigned>( seconds % 60 ),
+                             static_cast<unsigned>( number % 100 * 10 ) );
+
+        line.assign( header, static_cast<size_t>( headerSize ) );
+
+        const auto isColored = nextChance( options_.ansiDensity );
+        const auto level = Levels[ nextBelow( Levels.size() ) ];
+        if ( isColored ) {
+            line += Colors[ nextBelow( Colors.size() ) ];
+        }
+        line += level;
+        if ( isColored ) {
+            line += "\x1b[0m";
+        }
+        line += " [worker-";
+        line += std::to_string( nextBelow( 16 ) );
+        line += "] line ";
+        line += std::to_string( number );
+
+        const auto messageEnd = line.size() + messageLength();
+        while ( line.size() < messageEnd ) {
+            line += nextChance( options_.tabDensity ) ? '\t' : ' ';
+            line += nextChance( 0.01 ) ? RareWord : Words[ nextBelow( Words.size() ) ];
+        }
+        line += '\n';
+    }
+
+    // Code points of the UTF-8 line in the dataset encoding,
+    // ones Latin-1 can't represent are replaced by '?'
+    void encode( const std::string& line, std::string& encoded ) const
+    {
+        if ( options_.encoding == LogGeneratorOptions::Encoding::Utf8 ) {
+            encoded = line;
+            return;
+        }
+
+        encoded.clear();
+        for ( size_t i = 0; i < line.size(); ) {
+            const auto lead = static_cast<unsigned char>( line[ i ] );
+            const auto size = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+            uint32_t codePoint = size == 1   ? lead
+                                 : size == 2 ? lead & 0x1F
+                                 : size == 3 ? lead & 0x0F
+                                             : lead & 0x07;
+            for ( auto k = 1; k < size; ++k ) {
+                codePoint = ( codePoint << 6 )
+                            | ( static_cast<unsigned char>( line[ i + k ] ) & 0x3F );
+            }
+            i += static_cast<size_t>( size );
+
+            if ( options_.encoding == LogGeneratorOptions::Encoding::Latin1 ) {
+                encoded += codePoint <= 0xFF ? static_cast<char>( codePoint ) : '?';
+            }
+            else if ( codePoint < 0x10000 ) {
+                appendUtf16( encoded, codePoint );
+            }
+            else {
+                codePoint -= 0x10000;
+                appendUtf16( encoded, 0xD800 + ( codePoint >> 10 ) );
+                appendUtf16( encoded, 0xDC00 + ( codePoint & 0x3FF ) );
+            }
+        }
+    }
+
+    static void appendUtf16( std::string& encoded, uint32_t unit )
+    {
+        encoded += static_cast<char>( unit & 0xFF );
+        encoded += static_cast<char>( unit >> 8 );
+    }
+
+  private:
+    LogGeneratorOptions options_;
+    LogRandom random_;
+};
+
+#endif